@@ -19,7 +19,15 @@
 #define ICONNMANAGERSERVICE_H
 
 #include "IConnManagerServiceTypes.h"
-#include "Poco/BasicEvent.h"
+#include "IConnManagerServiceHistory.h"
+#include "Poco/SnapshotEvent.h"
+#include "Poco/CoalescingEvent.h"
+#include "Poco/SharedActiveMethod.h"
+#include "Poco/IsolatingEvent.h"
+#include "Poco/Delegate.h"
+#include "Poco/LocalTimeCache.h"
+#include "Poco/Mutex.h"
+#include "Poco/AtomicCounter.h"
 #include "Poco/OSP/Service.h"
 
 namespace Stla {
@@ -32,6 +40,9 @@ const char* const CONNMANAGER_SERVICE_NAME = "stla.connectivity.connmanager.serv
 
 /**
  * IConnManagerService is the interface that provides information about Connection Manager
+ *
+ * Subscribers can restrict event delivery to relevant changes with the filters
+ * declared in IConnManagerServiceFilters.h.
  */
 #ifdef DOXYGEN_WORKING
 class IConnManagerService : public Poco::OSP::Service
@@ -46,6 +57,26 @@ public:
      */
     typedef Poco::AutoPtr<IConnManagerService> Ptr;
 
+    /**
+     * IConnManagerService constructor
+     *
+     * Forwards \link onDataPathTypeChanged \endlink to the legacy \link onDataPathChanged \endlink event,
+     * \link onCellularSignalStrengthChanged \endlink to \link onCellularSignalChanged \endlink,
+     * and invalidates the cached local time zone (Poco::LocalTimeCache) on every \link onCellularTime \endlink
+     * update whose time zone or daylight saving time differs from the previous one.
+     */
+    IConnManagerService():
+        getCellularNbCellsAsync(this, &IConnManagerService::cellularNbCellsImpl),
+        getRegistrationStatusAsync(this, &IConnManagerService::registrationStatusImpl),
+        getCellularTimeAsync(this, &IConnManagerService::cellularTimeImpl),
+        _networkType(ConMgrNtwType_Unknown)
+    {
+        onDataPathTypeChanged += Poco::delegate(this, &IConnManagerService::forwardDataPathChanged);
+        onCellularTime += Poco::delegate(this, &IConnManagerService::invalidateLocalTime);
+        onCellularNetworkTypeChanged += Poco::delegate(this, &IConnManagerService::trackNetworkType);
+        onCellularSignalStrengthChanged += Poco::delegate(this, &IConnManagerService::forwardSignalStrength);
+    }
+
     /**
      * IConnManagerService destructor
      */
@@ -66,15 +97,14 @@ public:
 
     bool isA(const std::type_info& obj) const
     {
-        std::string name(type().name());
-        return name == obj.name();
+        return isSameType(type(), obj);
     }
 
     /**
      * @brief Poco Event triggered when cellular network type is available or when it changes
      *
      */
-    Poco::BasicEvent<const ConMgrNetworkType> onCellularNetworkTypeChanged;
+    Poco::SnapshotEvent<const ConMgrNetworkType> onCellularNetworkTypeChanged;
 
     /**
      * @brief Getter for cellular network type
@@ -92,7 +122,7 @@ public:
      * - interface Name of the interface: ApnName_Telematic or ApnName_Public
      * - available Status of the connection: true if connected, false if not connected
      */
-    Poco::BasicEvent<const APNConnState> onApnConStateChanged;
+    Poco::SnapshotEvent<const APNConnState> onApnConStateChanged;
 
     /**
      * @brief Getter for cellular APN connection state
@@ -109,11 +139,45 @@ public:
      */
     virtual ConMgrErrno getApnConState(ConApnName interface, bool& result) = 0;
 
+    /**
+     * @brief Poco Event triggered once per APN transition, carrying the state of all interfaces
+     *
+     * Fired after \link onApnConStateChanged \endlink has been fired for every changed interface,
+     * so subscribers interested in the overall state get a single notification when several
+     * interfaces come up or go down together, e.g. after a modem reset.
+     * The structure is described in \link ApnConStates \endlink.
+     */
+    Poco::SnapshotEvent<const ApnConStates> onApnStatesChanged;
+
+    /**
+     * @brief Getter for the connection state of all APN interfaces
+     *
+     * The default implementation calls \link getApnConState \endlink for every interface,
+     * implementations should override it to return the state with a single lookup.
+     *
+     * @param[out] mask Bit mask of the connected interfaces, see \link ConMgrApnBit \endlink
+     *
+     * @return Error number described in \link ConMgrErrno \endlink.
+     */
+    virtual ConMgrErrno getApnConStates(uint32_t& mask)
+    {
+        uint32_t result = 0;
+        for (int i = 0; i < MAX_APN_COUNT; ++i)
+        {
+            bool available = false;
+            ConMgrErrno err = getApnConState(static_cast<ConApnName>(i), available);
+            if (err != ConMgrErr_OK) return err;
+            if (available) result |= ConMgrApnBit(static_cast<ConApnName>(i));
+        }
+        mask = result;
+        return ConMgrErr_OK;
+    }
+
     /**
      * @brief Poco Event triggered when cellular mobile country code (MCC) is available
      * or when it changes (e.g. crossing the border)
      */
-    Poco::BasicEvent<const int> onCellularMCCChanged;
+    Poco::SnapshotEvent<const int> onCellularMCCChanged;
 
     /**
      * @brief Getter for cellular cellular mobile country code (MCC)
@@ -131,7 +195,7 @@ public:
      * - true if connected
      * - false if not connected
      */
-    Poco::BasicEvent<const bool> onWifiDataConStateChanged;
+    Poco::SnapshotEvent<const bool> onWifiDataConStateChanged;
 
     /**
      * @brief Getter for wifi data connection state
@@ -168,7 +232,18 @@ public:
     </table>
      *
      */
-    Poco::BasicEvent<const unsigned char> onCellularSignalStrengthChanged;
+    Poco::SnapshotEvent<const unsigned char> onCellularSignalStrengthChanged;
+
+    /**
+     * @brief Poco Event triggered with every \link onCellularSignalStrengthChanged \endlink
+     *
+     * Carries the signal strength together with the network type last notified with
+     * \link onCellularNetworkTypeChanged \endlink, so that subscribers, e.g. with
+     * \link SignalRangeFilter \endlink, can compute the range without calling back
+     * into the service. Implementations must not notify this event; it is notified
+     * from onCellularSignalStrengthChanged.
+     */
+    Poco::SnapshotEvent<const CellularSignal> onCellularSignalChanged;
 
     /**
      * @brief Getter for cellular signal strength
@@ -194,7 +269,7 @@ public:
     /**
      * @brief Poco Event triggered when cellular modem availability changes
      */
-    Poco::BasicEvent<const bool> onCellularModemAvailabilityChanged;
+    Poco::SnapshotEvent<const bool> onCellularModemAvailabilityChanged;
 
     /**
      * @brief Getter for cellular modem availability
@@ -213,8 +288,11 @@ public:
      *  The structure has the following fields:
      * -The Received Signal Strength Indicator (RSSI).
      * -The Bit Error Rate (BER).
+     *
+     * Delivery is coalesced: delegates are invoked asynchronously with the latest value only,
+     * at most once per minimum interval configured by the implementation.
      */
-    Poco::BasicEvent<const GsmMetrics> onGsmMetrics;
+    Poco::CoalescingEvent<const GsmMetrics> onGsmMetrics;
 
     /**
      * @brief Getter for Gsm Metrics
@@ -230,8 +308,10 @@ public:
      * -The Received Signal Strength Indicator (RSSI).
      * -The measured Received Signal Code Power (RSCP).
      * -EC/IO. This is the measure of the quality/cleanliness of the signal from the tower to the modem and indicates the signal-to noise ratio.
+     *
+     * Delivery is coalesced, see \link onGsmMetrics \endlink.
      */
-    Poco::BasicEvent<const UmtsMetrics> onUmtsMetrics;
+    Poco::CoalescingEvent<const UmtsMetrics> onUmtsMetrics;
 
     /**
      * @brief Getter for Umts Metrics
@@ -248,8 +328,10 @@ public:
      * -The measured Reference Signal Received Quality (RSRQ).
      * -The measured Reference Signal Received Power (RSRP).
      * -The Signal to Noise Ratio (SNR).
+     *
+     * Delivery is coalesced, see \link onGsmMetrics \endlink.
      */
-    Poco::BasicEvent<const LteMetrics> onLteMetrics;
+    Poco::CoalescingEvent<const LteMetrics> onLteMetrics;
 
     /**
      * @brief Getter for Lte Metrics
@@ -261,8 +343,10 @@ public:
     /**
      * @brief Poco Event triggered when cellular neighboring cells are available or when they change
      * Provides the number of neighbor cells per technology (gsm, umts and lte).
+     *
+     * Delivery is coalesced, see \link onGsmMetrics \endlink.
      */
-    Poco::BasicEvent<const CellularNbCells> onCellularNbCellsChanged;
+    Poco::CoalescingEvent<const CellularNbCells> onCellularNbCellsChanged;
 
     /**
      * @brief Getter for Cellular neighboring cells
@@ -271,6 +355,22 @@ public:
      */
     virtual ConMgrErrno getCellularNbCells(CellularNbCells& result) = 0;
 
+    /**
+     * @brief Asynchronous variant of \link getCellularNbCells \endlink
+     *
+     * Runs the getter in a thread of the default thread pool and returns immediately:
+     *
+     *     Poco::ActiveResult<ConMgrResult<CellularNbCells> > result = service->getCellularNbCellsAsync();
+     *     ...
+     *     result.wait();
+     *     if (result.data().error == ConMgrErr_OK) use(result.data().value);
+     *
+     * Callers invoking it while a previous call is in progress share that call and its result.
+ * The call keeps a reference to the service until it has completed, so the service is not
+ * destroyed while the getter runs.
+     */
+    Poco::SharedActiveMethod<ConMgrResult<CellularNbCells>, IConnManagerService, Poco::RetainingActiveStarter<IConnManagerService> > getCellularNbCellsAsync;
+
     /**
      * @brief Poco Event triggered when registration status is available or when it changes
      *
@@ -285,7 +385,7 @@ public:
      * -Tracking area code
      * -Local area code
      */
-    Poco::BasicEvent<const RegistrationStatus> onRegistrationStatusChanged;
+    Poco::SnapshotEvent<const RegistrationStatus> onRegistrationStatusChanged;
 
     /**
      * @brief Getter for Registration status
@@ -294,6 +394,22 @@ public:
      */
     virtual ConMgrErrno getRegistrationStatus(RegistrationStatus& result) = 0;
 
+    /**
+     * @brief Asynchronous variant of \link getRegistrationStatus \endlink
+     *
+     * Runs the getter in a thread of the default thread pool and returns immediately:
+     *
+     *     Poco::ActiveResult<ConMgrResult<RegistrationStatus> > result = service->getRegistrationStatusAsync();
+     *     ...
+     *     result.wait();
+     *     if (result.data().error == ConMgrErr_OK) use(result.data().value);
+     *
+     * Callers invoking it while a previous call is in progress share that call and its result.
+ * The call keeps a reference to the service until it has completed, so the service is not
+ * destroyed while the getter runs.
+     */
+    Poco::SharedActiveMethod<ConMgrResult<RegistrationStatus>, IConnManagerService, Poco::RetainingActiveStarter<IConnManagerService> > getRegistrationStatusAsync;
+
     /**
      * @brief Poco Event triggered every 5 minutes
      *
@@ -302,7 +418,7 @@ public:
      * - Local time zone.
      * - Daylight saving time.
      */
-    Poco::BasicEvent<const DateTime> onCellularTime;
+    Poco::SnapshotEvent<const DateTime> onCellularTime;
 
     /**
      * @brief Getter for Cellular time
@@ -311,6 +427,22 @@ public:
      */
     virtual ConMgrErrno getCellularTime(DateTime& result) = 0;
 
+    /**
+     * @brief Asynchronous variant of \link getCellularTime \endlink
+     *
+     * Runs the getter in a thread of the default thread pool and returns immediately:
+     *
+     *     Poco::ActiveResult<ConMgrResult<DateTime> > result = service->getCellularTimeAsync();
+     *     ...
+     *     result.wait();
+     *     if (result.data().error == ConMgrErr_OK) use(result.data().value);
+     *
+     * Callers invoking it while a previous call is in progress share that call and its result.
+ * The call keeps a reference to the service until it has completed, so the service is not
+ * destroyed while the getter runs.
+     */
+    Poco::SharedActiveMethod<ConMgrResult<DateTime>, IConnManagerService, Poco::RetainingActiveStarter<IConnManagerService> > getCellularTimeAsync;
+
     /**
      * @brief Getter for System time
      * @param [out] result System time as time_t
@@ -320,17 +452,169 @@ public:
 
     /**
      * @brief Poco Event triggered when data path changes
+     *
+     * Implementations must notify this event only; \link onDataPathChanged \endlink
+     * is notified from it.
+     */
+    Poco::SnapshotEvent<const ConMgrDataPath> onDataPathTypeChanged;
+
+    /**
+     * @brief Getter for data path mode
+     *
+     * @param[out] result current data path as \link ConMgrDataPath \endlink
+     *
+     * @return Error number described in \link ConMgrErrno \endlink.
+     */
+    virtual ConMgrErrno getDataPathType(ConMgrDataPath& result) = 0;
+
+    /**
+     * @brief Poco Event triggered when data path changes
+     *
+     * Compatibility event carrying the data path as string "no data", "cellular", "wifi".
+     * Prefer \link onDataPathTypeChanged \endlink, which does not allocate.
+     *
+     * Delegates are invoked asynchronously from Poco::IsolatingEventDispatcher, each with
+     * its own queue, so a slow subscriber (e.g. writing to flash) does not delay the others.
+     * Critical subscribers register with Poco::priorityDelegate() to be served first.
      */
-    Poco::BasicEvent<const std::string> onDataPathChanged;
+    Poco::IsolatingEvent<const std::string> onDataPathChanged;
 
     /**
      * @brief Getter for data path mode
      *
+     * Compatibility getter, prefer \link getDataPathType \endlink.
+     *
      * @param[out] result current data path "no data", "cellular", "wifi"
      *
      * @return Error number described in \link ConMgrErrno \endlink.
      */
-    virtual ConMgrErrno getDataPath(std::string& result) = 0;
+    virtual ConMgrErrno getDataPath(std::string& result)
+    {
+        ConMgrDataPath dataPath;
+        ConMgrErrno err = getDataPathType(dataPath);
+        if (err == ConMgrErr_OK) result = ConMgrDataPathName(dataPath);
+        return err;
+    }
+
+    /**
+     * @brief Getter for a coherent copy of all connectivity state
+     *
+     * Implementations should keep the state in a Poco::SeqLock<ConnectivitySnapshot>
+     * updated by the modem thread and override this method to return SeqLock::read().
+     * Readers then neither block nor allocate, and never observe partially updated state.
+     *
+     * The default implementation assembles the snapshot from the individual getters
+     * and therefore may return inconsistent state.
+     *
+     * Implementations may additionally publish the snapshot with ConnectivitySnapshotPublisher,
+     * see IConnManagerServiceSharedState.h, for readers in other processes.
+     *
+     * @param [out] result Connectivity state as \link ConnectivitySnapshot \endlink
+     * @return Error number described in \link ConMgrErrno \endlink.
+     */
+    virtual ConMgrErrno getConnectivitySnapshot(ConnectivitySnapshot& result)
+    {
+        ConMgrErrno err = getCellularNetworkType(result.network_type);
+        for (int i = 0; i < MAX_APN_COUNT && err == ConMgrErr_OK; ++i)
+        {
+            result.apn_state[i].interface = static_cast<ConApnName>(i);
+            err = getApnConState(result.apn_state[i].interface, result.apn_state[i].available);
+        }
+        if (err == ConMgrErr_OK) err = getCellularMCC(result.mcc);
+        if (err == ConMgrErr_OK) err = getWiFiDataConState(result.wifi_data_con_state);
+        if (err == ConMgrErr_OK) err = getCellularSignalStrength(result.signal_strength);
+        if (err == ConMgrErr_OK) err = getCellularModemAvailability(result.modem_available);
+        if (err == ConMgrErr_OK) err = getGsmMetrics(result.gsm);
+        if (err == ConMgrErr_OK) err = getUmtsMetrics(result.umts);
+        if (err == ConMgrErr_OK) err = getLteMetrics(result.lte);
+        if (err == ConMgrErr_OK) err = getCellularNbCells(result.nb_cells);
+        if (err == ConMgrErr_OK) err = getRegistrationStatus(result.registration);
+        if (err == ConMgrErr_OK) err = getCellularTime(result.cellular_time);
+        if (err == ConMgrErr_OK) err = getDataPathType(result.data_path);
+        return err;
+    }
+
+    /**
+     * @brief Query of the recorded history of a metric
+     *
+     * Visits the samples of metric recorded between from and to and reports their
+     * min/max/mean aggregate, without copying the history. Implementations typically
+     * forward to a \link ConnectivityHistory \endlink fed from their own events.
+     *
+     * @param[in] metric Metric to be queried as \link ConMgrHistoryMetric \endlink
+     * @param[in] from Start of the time window
+     * @param[in] to End of the time window
+     * @param[in] callback Receives the samples and the aggregate
+     *
+     * @return Error number described in \link ConMgrErrno \endlink.
+     * The default implementation returns ConMgrErr_UnavailableService.
+     */
+    virtual ConMgrErrno queryHistory(ConMgrHistoryMetric metric, const Poco::Timestamp& from, const Poco::Timestamp& to, ConnectivityHistoryCallback& callback)
+    {
+        (void) metric; (void) from; (void) to; (void) callback;
+        return ConMgrErr_UnavailableService;
+    }
+
+private:
+    ConMgrResult<CellularNbCells> cellularNbCellsImpl()
+    {
+        ConMgrResult<CellularNbCells> result;
+        result.error = getCellularNbCells(result.value);
+        return result;
+    }
+
+    ConMgrResult<RegistrationStatus> registrationStatusImpl()
+    {
+        ConMgrResult<RegistrationStatus> result;
+        result.error = getRegistrationStatus(result.value);
+        return result;
+    }
+
+    ConMgrResult<DateTime> cellularTimeImpl()
+    {
+        ConMgrResult<DateTime> result;
+        result.error = getCellularTime(result.value);
+        return result;
+    }
+
+    void forwardDataPathChanged(const void* pSender, const ConMgrDataPath& dataPath)
+    {
+        if (!onDataPathChanged.empty())
+        {
+            const std::string name(ConMgrDataPathName(dataPath));
+            onDataPathChanged.notify(pSender, name);
+        }
+    }
+
+    void trackNetworkType(const void*, const ConMgrNetworkType& networkType)
+    {
+        _networkType = networkType;
+    }
+
+    void forwardSignalStrength(const void* pSender, const unsigned char& signalStrength)
+    {
+        if (!onCellularSignalChanged.empty())
+        {
+            CellularSignal signal;
+            signal.network_type = static_cast<ConMgrNetworkType>(_networkType.value());
+            signal.signal_strength = signalStrength;
+            onCellularSignalChanged.notify(pSender, signal);
+        }
+    }
+
+    void invalidateLocalTime(const void*, const DateTime& time)
+    {
+        Poco::FastMutex::ScopedLock lock(_timeZoneMutex);
+        if (time.offset != _timeZone.offset || time.timezone != _timeZone.timezone || time.daylt_sav != _timeZone.daylt_sav)
+        {
+            _timeZone = time;
+            Poco::LocalTimeCache::invalidate();
+        }
+    }
+
+    DateTime _timeZone;
+    Poco::FastMutex _timeZoneMutex;
+    Poco::AtomicCounter _networkType;
    
 };
 }
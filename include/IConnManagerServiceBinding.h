@@ -0,0 +1,188 @@
+/**
+ * \file
+ *         IConnManagerServiceBinding.h
+ * \brief
+ *         Binds HTTP and RemotingNG client connections to the network interface of an APN
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICEBINDING_H
+#define ICONNMANAGERSERVICEBINDING_H
+
+#include "IConnManagerService.h"
+#include "Poco/Net/InterfaceBinder.h"
+#include "Poco/Net/HTTPSessionPool.h"
+#include "Poco/RemotingNG/TCP/SecureSocketFactory.h"
+#include "Poco/Delegate.h"
+#include "Poco/Mutex.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * @brief Names of the network interfaces of the data paths:
+ * - apn (Interface of each cellular APN, indexed by \link ConApnName \endlink)
+ * - wifi (Interface used when the data path is \link ConMgrDataPath_WiFi \endlink)
+ */
+struct ConMgrInterfaceNames
+{
+    std::string apn[MAX_APN_COUNT];
+    std::string wifi;
+};
+
+/**
+ * DataPathSocketBinder binds the connections of HTTPSessionPool and RemotingNG SecureSocketFactory
+ * objects to the network interface serving an APN, and tears them down when the data path or the
+ * state of the APN changes, so that requests fail and new connections are made over the new path
+ * immediately, instead of after TCP retransmission timeouts on the previous interface.
+ *
+ * Traffic for ApnName_Public uses the wifi interface while the data path is wifi, and the APN
+ * interface otherwise. Traffic for ApnName_Telematic always uses the telematic APN interface.
+ *
+ *     ConMgrInterfaceNames names;
+ *     names.apn[ApnName_Public] = "rmnet_data0";
+ *     names.apn[ApnName_Telematic] = "rmnet_data1";
+ *     names.wifi = "wlan0";
+ *     DataPathSocketBinder binder(service, ApnName_Public, names);
+ *     binder.add(pool);
+ *     binder.add(pSocketFactory); // passed to the RemotingNG ConnectionManager
+ *
+ * The service and all added pools must outlive the binder.
+ */
+class DataPathSocketBinder
+{
+public:
+    DataPathSocketBinder(IConnManagerService::Ptr pService, ConApnName apn, const ConMgrInterfaceNames& names):
+        _pService(pService), _apn(apn), _names(names), _dataPath(ConMgrDataPath_NoData)
+    {
+        _pService->getDataPathType(_dataPath);
+        _binder = Poco::Net::InterfaceBinder(interfaceFor(_apn, _dataPath, _names));
+        _pService->onDataPathTypeChanged += Poco::delegate(this, &DataPathSocketBinder::onDataPathTypeChanged);
+        _pService->onApnStatesChanged += Poco::delegate(this, &DataPathSocketBinder::onApnStatesChanged);
+    }
+
+    ~DataPathSocketBinder()
+    {
+        _pService->onApnStatesChanged -= Poco::delegate(this, &DataPathSocketBinder::onApnStatesChanged);
+        _pService->onDataPathTypeChanged -= Poco::delegate(this, &DataPathSocketBinder::onDataPathTypeChanged);
+    }
+
+    /**
+     * @brief Binds the sessions of the pool to the current interface. Existing sessions are closed.
+     */
+    void add(Poco::Net::HTTPSessionPool& pool)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        pool.setInterface(_binder);
+        _pools.push_back(&pool);
+    }
+
+    /**
+     * @brief Stops updating the interface of the pool.
+     */
+    void remove(Poco::Net::HTTPSessionPool& pool)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        _pools.erase(std::remove(_pools.begin(), _pools.end(), &pool), _pools.end());
+    }
+
+    /**
+     * @brief Binds the sockets created by the factory to the current interface.
+     */
+    void add(Poco::RemotingNG::TCP::SecureSocketFactory::Ptr pFactory)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        pFactory->setInterface(_binder);
+        _factories.push_back(pFactory);
+    }
+
+    /**
+     * @brief Stops updating the interface of the factory.
+     */
+    void remove(Poco::RemotingNG::TCP::SecureSocketFactory::Ptr pFactory)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        _factories.erase(std::remove(_factories.begin(), _factories.end(), pFactory), _factories.end());
+    }
+
+    /**
+     * @brief Returns the name of the interface connections are currently bound to.
+     */
+    std::string interfaceName() const
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        return _binder.interfaceName();
+    }
+
+    /**
+     * @brief Returns the name of the interface serving traffic for an APN on the given data path.
+     */
+    static std::string interfaceFor(ConApnName apn, ConMgrDataPath dataPath, const ConMgrInterfaceNames& names)
+    {
+        if (apn == ApnName_Public && dataPath == ConMgrDataPath_WiFi) return names.wifi;
+        return names.apn[apn];
+    }
+
+private:
+    DataPathSocketBinder(const DataPathSocketBinder&);
+    DataPathSocketBinder& operator=(const DataPathSocketBinder&);
+
+    /**
+     * @brief Rebinds all pools and factories, tearing down their existing connections.
+     */
+    void rebind()
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        _binder = Poco::Net::InterfaceBinder(interfaceFor(_apn, _dataPath, _names));
+        for (std::vector<Poco::Net::HTTPSessionPool*>::iterator it = _pools.begin(); it != _pools.end(); ++it)
+        {
+            (*it)->setInterface(_binder);
+        }
+        for (std::vector<Poco::RemotingNG::TCP::SecureSocketFactory::Ptr>::iterator it = _factories.begin(); it != _factories.end(); ++it)
+        {
+            (*it)->setInterface(_binder);
+        }
+    }
+
+    void onDataPathTypeChanged(const void*, const ConMgrDataPath& dataPath)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            if (dataPath == _dataPath) return;
+            _dataPath = dataPath;
+        }
+        // only public APN traffic moves between cellular and wifi
+        if (_apn == ApnName_Public) rebind();
+    }
+
+    void onApnStatesChanged(const void*, const ApnConStates& states)
+    {
+        if (states.hasChanged(_apn)) rebind();
+    }
+
+    IConnManagerService::Ptr _pService;
+    ConApnName _apn;
+    ConMgrInterfaceNames _names;
+    ConMgrDataPath _dataPath;
+    Poco::Net::InterfaceBinder _binder;
+    std::vector<Poco::Net::HTTPSessionPool*> _pools;
+    std::vector<Poco::RemotingNG::TCP::SecureSocketFactory::Ptr> _factories;
+    mutable Poco::FastMutex _mutex;
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+#endif // ICONNMANAGERSERVICEBINDING_H
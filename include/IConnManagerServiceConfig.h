@@ -0,0 +1,254 @@
+/**
+ * \file
+ *         IConnManagerServiceConfig.h
+ * \brief
+ *         Run time tuning of the IConnManagerService signal ranges and event rates
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICECONFIG_H
+#define ICONNMANAGERSERVICECONFIG_H
+
+#include "IConnManagerService.h"
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/Exception.h"
+#include "Poco/Mutex.h"
+#include <string>
+#include <vector>
+#if __cplusplus >= 201103L
+#include <atomic>
+#endif
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * @brief Tuning of the connection manager, published by ConnManagerConfig:
+ * - gsm, wcdma, lte (Signal strength ranges per network type, other types use gsm)
+ * - metricsMinInterval (Minimum interval in milliseconds between two deliveries of onGsmMetrics,
+ *   onUmtsMetrics and onLteMetrics)
+ * - nbCellsMinInterval (Minimum interval in milliseconds between two deliveries of onCellularNbCellsChanged)
+ *
+ * The defaults are the ranges documented for onCellularSignalStrengthChanged and no rate limit.
+ */
+struct ConMgrTuning
+{
+    ConMgrSignalThresholds gsm;
+    ConMgrSignalThresholds wcdma;
+    ConMgrSignalThresholds lte;
+    long metricsMinInterval;
+    long nbCellsMinInterval;
+
+    ConMgrTuning():
+        gsm(ConMgrDefaultSignalThresholds(ConMgrNtwType_GSM)),
+        wcdma(ConMgrDefaultSignalThresholds(ConMgrNtwType_WCDMA)),
+        lte(ConMgrDefaultSignalThresholds(ConMgrNtwType_LTE)),
+        metricsMinInterval(0),
+        nbCellsMinInterval(0)
+    {
+    }
+
+    const ConMgrSignalThresholds& thresholds(ConMgrNetworkType networkType) const
+    {
+        if (networkType == ConMgrNtwType_WCDMA) return wcdma;
+        if (networkType == ConMgrNtwType_LTE) return lte;
+        return gsm;
+    }
+
+    ConMgrSignalRange signalRange(ConMgrNetworkType networkType, unsigned char signalStrength) const
+    {
+        return ConMgrSignalRangeOf(thresholds(networkType), signalStrength);
+    }
+};
+
+/**
+ * ConnManagerConfig holds the current \link ConMgrTuning \endlink of the connection manager
+ * and replaces it when the configuration is reloaded, without a lock on the event path.
+ *
+ * Every tuning is immutable once published. current() returns the last published one with a
+ * single atomic load, so the implementation can look up signal ranges for every signal strength
+ * update. Reloading builds a new tuning, validates it and swaps the pointer; the superseded
+ * tunings are kept until the ConnManagerConfig is destroyed, so that a reference obtained from
+ * current() stays valid. As reloads are rare, this costs a few dozen bytes per reload.
+ *
+ * The tuning is read from a configuration, e.g. the Preferences of the bundle
+ * (PreferencesService) or the LayeredConfiguration of the application, with these
+ * keys below the given prefix, each of them optional:
+ *
+ *     connmanager.signal.gsm.excellent = 64
+ *     connmanager.signal.gsm.good = 40
+ *     connmanager.signal.gsm.fair = 18
+ *     connmanager.signal.wcdma.excellent = 42
+ *     ...
+ *     connmanager.signal.lte.fair = 9
+ *     connmanager.events.metricsMinInterval = 1000
+ *     connmanager.events.nbCellsMinInterval = 5000
+ *
+ * Example:
+ *
+ *     ConnManagerConfig config;
+ *     if (config.load(*pPreferences) == ConMgrErr_OK) config.apply(*pService);
+ *     ...
+ *     ConMgrSignalRange range = config.current().signalRange(networkType, signalStrength);
+ */
+class ConnManagerConfig
+{
+public:
+    ConnManagerConfig():
+        _pCurrent(new ConMgrTuning)
+    {
+        _retired.push_back(loadCurrent());
+    }
+
+    ~ConnManagerConfig()
+    {
+        for (std::vector<const ConMgrTuning*>::iterator it = _retired.begin(); it != _retired.end(); ++it)
+        {
+            delete *it;
+        }
+    }
+
+    /**
+     * @brief Returns the current tuning. Does not take a lock.
+     *
+     * The returned reference stays valid for the lifetime of the ConnManagerConfig,
+     * but a later reload is only seen by calling current() again.
+     */
+    const ConMgrTuning& current() const
+    {
+        return *loadCurrent();
+    }
+
+    /**
+     * @brief Publishes tuning, if it is valid.
+     *
+     * @return ConMgrErr_OK, or ConMgrErr_InvalidArgument if the ranges of a network type are not
+     * ordered (0 < fair < good < excellent <= 100) or an interval is negative, in which case the
+     * current tuning is kept.
+     */
+    ConMgrErrno publish(const ConMgrTuning& tuning)
+    {
+        if (!isValid(tuning)) return ConMgrErr_InvalidArgument;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        const ConMgrTuning* pTuning = new ConMgrTuning(tuning);
+        _retired.push_back(pTuning);
+        storeCurrent(pTuning);
+        return ConMgrErr_OK;
+    }
+
+    /**
+     * @brief Reads the tuning from config and publishes it. Keys that are not present
+     * take their default values.
+     *
+     * @return ConMgrErr_OK, or ConMgrErr_InvalidArgument if a value is not a number or the
+     * tuning is not valid (see \link publish \endlink), in which case the current tuning is kept.
+     */
+    ConMgrErrno load(const Poco::Util::AbstractConfiguration& config, const std::string& prefix = "connmanager")
+    {
+        ConMgrTuning tuning;
+        try
+        {
+            loadThresholds(config, prefix + ".signal.gsm", tuning.gsm);
+            loadThresholds(config, prefix + ".signal.wcdma", tuning.wcdma);
+            loadThresholds(config, prefix + ".signal.lte", tuning.lte);
+            tuning.metricsMinInterval = config.getInt(prefix + ".events.metricsMinInterval", 0);
+            tuning.nbCellsMinInterval = config.getInt(prefix + ".events.nbCellsMinInterval", 0);
+        }
+        catch (Poco::SyntaxException&)
+        {
+            return ConMgrErr_InvalidArgument;
+        }
+        return publish(tuning);
+    }
+
+    /**
+     * @brief Applies the event rates of the current tuning to the coalesced events of service.
+     */
+    void apply(IConnManagerService& service) const
+    {
+        const ConMgrTuning& tuning = current();
+        service.onGsmMetrics.setMinInterval(tuning.metricsMinInterval);
+        service.onUmtsMetrics.setMinInterval(tuning.metricsMinInterval);
+        service.onLteMetrics.setMinInterval(tuning.metricsMinInterval);
+        service.onCellularNbCellsChanged.setMinInterval(tuning.nbCellsMinInterval);
+    }
+
+    /**
+     * @brief Returns true if the ranges of all network types are ordered and the intervals are not negative.
+     */
+    static bool isValid(const ConMgrTuning& tuning)
+    {
+        return isValid(tuning.gsm) && isValid(tuning.wcdma) && isValid(tuning.lte)
+            && tuning.metricsMinInterval >= 0 && tuning.nbCellsMinInterval >= 0;
+    }
+
+    static bool isValid(const ConMgrSignalThresholds& thresholds)
+    {
+        return thresholds.fair > 0 && thresholds.fair < thresholds.good
+            && thresholds.good < thresholds.excellent && thresholds.excellent <= 100;
+    }
+
+private:
+    ConnManagerConfig(const ConnManagerConfig&);
+    ConnManagerConfig& operator=(const ConnManagerConfig&);
+
+    static void loadThresholds(const Poco::Util::AbstractConfiguration& config, const std::string& prefix, ConMgrSignalThresholds& thresholds)
+    {
+        thresholds.excellent = clamp(config.getInt(prefix + ".excellent", thresholds.excellent));
+        thresholds.good = clamp(config.getInt(prefix + ".good", thresholds.good));
+        thresholds.fair = clamp(config.getInt(prefix + ".fair", thresholds.fair));
+    }
+
+    /**
+     * @brief Maps values outside of 0 to 255 to 255, which isValid() rejects.
+     */
+    static unsigned char clamp(int value)
+    {
+        return (value < 0 || value > 0xFF) ? 0xFF : static_cast<unsigned char>(value);
+    }
+
+#if __cplusplus >= 201103L
+    const ConMgrTuning* loadCurrent() const
+    {
+        return _pCurrent.load(std::memory_order_acquire);
+    }
+
+    void storeCurrent(const ConMgrTuning* pTuning)
+    {
+        _pCurrent.store(pTuning, std::memory_order_release);
+    }
+
+    std::atomic<const ConMgrTuning*> _pCurrent;
+#else
+    const ConMgrTuning* loadCurrent() const
+    {
+        const ConMgrTuning* pTuning = _pCurrent;
+        __sync_synchronize();
+        return pTuning;
+    }
+
+    void storeCurrent(const ConMgrTuning* pTuning)
+    {
+        __sync_synchronize();
+        _pCurrent = pTuning;
+    }
+
+    const ConMgrTuning* volatile _pCurrent;
+#endif
+    std::vector<const ConMgrTuning*> _retired;
+    Poco::FastMutex _mutex;
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+#endif // ICONNMANAGERSERVICECONFIG_H
@@ -0,0 +1,86 @@
+/**
+ * \file
+ *         IConnManagerServiceDNS.h
+ * \brief
+ *         Flushes cached host name resolutions when the data path or APN state changes
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICEDNS_H
+#define ICONNMANAGERSERVICEDNS_H
+
+#include "IConnManagerService.h"
+#include "Poco/Net/DNSCache.h"
+#include "Poco/Net/DNS.h"
+#include "Poco/Delegate.h"
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * DataPathDNSCacheFlusher flushes a Poco::Net::DNSCache whenever the data path or the
+ * APN connection states change, since addresses and negative results obtained through
+ * the previous interface (and its DNS servers) may no longer be valid. The system
+ * resolver configuration is reloaded as well.
+ *
+ *     DataPathDNSCacheFlusher flusher(service);
+ *     Poco::Net::HostEntry entry = Poco::Net::DNSCache::defaultCache().resolve(host);
+ *
+ * The service and the cache must outlive the flusher.
+ */
+class DataPathDNSCacheFlusher
+{
+public:
+    explicit DataPathDNSCacheFlusher(IConnManagerService::Ptr pService, Poco::Net::DNSCache& cache = Poco::Net::DNSCache::defaultCache()):
+        _pService(pService), _cache(cache)
+    {
+        _pService->onDataPathTypeChanged += Poco::delegate(this, &DataPathDNSCacheFlusher::onDataPathTypeChanged);
+        _pService->onApnStatesChanged += Poco::delegate(this, &DataPathDNSCacheFlusher::onApnStatesChanged);
+    }
+
+    ~DataPathDNSCacheFlusher()
+    {
+        _pService->onApnStatesChanged -= Poco::delegate(this, &DataPathDNSCacheFlusher::onApnStatesChanged);
+        _pService->onDataPathTypeChanged -= Poco::delegate(this, &DataPathDNSCacheFlusher::onDataPathTypeChanged);
+    }
+
+    /**
+     * @brief Flushes the cache and reloads the resolver configuration.
+     */
+    void flush()
+    {
+        Poco::Net::DNS::reload();
+        _cache.flush();
+    }
+
+private:
+    DataPathDNSCacheFlusher(const DataPathDNSCacheFlusher&);
+    DataPathDNSCacheFlusher& operator=(const DataPathDNSCacheFlusher&);
+
+    void onDataPathTypeChanged(const void*, const ConMgrDataPath&)
+    {
+        flush();
+    }
+
+    void onApnStatesChanged(const void*, const ApnConStates&)
+    {
+        flush();
+    }
+
+    IConnManagerService::Ptr _pService;
+    Poco::Net::DNSCache& _cache;
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+#endif // ICONNMANAGERSERVICEDNS_H
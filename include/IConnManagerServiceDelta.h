@@ -0,0 +1,469 @@
+/**
+ * \file
+ *         IConnManagerServiceDelta.h
+ * \brief
+ *         Delta encoding of IConnManagerService registration status events for remote subscribers
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICEDELTA_H
+#define ICONNMANAGERSERVICEDELTA_H
+
+#include "IConnManagerServiceTypes.h"
+#include "Poco/RemotingNG/TypeSerializer.h"
+#include "Poco/RemotingNG/TypeDeserializer.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/Types.h"
+#include "Poco/Mutex.h"
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * \brief Fields of \link RegistrationStatus \endlink, as bits of RegistrationStatusDelta::fields.
+ */
+enum RegistrationStatusField
+{
+    RegStatusField_NetworkType = 0x0001,
+    RegStatusField_CsRegStatus = 0x0002,
+    RegStatusField_PsRegStatus = 0x0004,
+    RegStatusField_Mnc         = 0x0008,
+    RegStatusField_Mcc         = 0x0010,
+    RegStatusField_Tac         = 0x0020,
+    RegStatusField_NetworkName = 0x0040,
+    RegStatusField_Cid         = 0x0080,
+    RegStatusField_Lac         = 0x0100,
+    RegStatusField_All         = 0x01FF
+};
+
+/**
+ * @brief A registration status, as a delta against a previous one or as a keyframe:
+ * - sequence (Sequence number of the status, never 0)
+ * - baseSequence (Sequence number of the status the delta applies to, 0 for a keyframe)
+ * - fields (\link RegistrationStatusField \endlink bits of the fields included, all in a keyframe)
+ * - status (The status, only the included fields are meaningful)
+ *
+ * Only the included fields are serialized, with the character fields without their blank padding.
+ */
+struct RegistrationStatusDelta
+{
+    Poco::UInt32 sequence;
+    Poco::UInt32 baseSequence;
+    Poco::UInt16 fields;
+    RegistrationStatus status;
+    RegistrationStatusDelta(): sequence(0), baseSequence(0), fields(0) {}
+
+    bool isKeyframe() const
+    {
+        return baseSequence == 0;
+    }
+};
+
+/**
+ * \brief Returns the \link RegistrationStatusField \endlink bits of the fields that differ between a and b.
+ */
+inline Poco::UInt16 RegistrationStatusDiff(const RegistrationStatus& a, const RegistrationStatus& b)
+{
+    Poco::UInt16 fields = 0;
+    if (a.network_type != b.network_type) fields |= RegStatusField_NetworkType;
+    if (a.cs_reg_status != b.cs_reg_status) fields |= RegStatusField_CsRegStatus;
+    if (a.ps_reg_status != b.ps_reg_status) fields |= RegStatusField_PsRegStatus;
+    if (a.mnc != b.mnc) fields |= RegStatusField_Mnc;
+    if (a.mcc != b.mcc) fields |= RegStatusField_Mcc;
+    if (a.tac != b.tac) fields |= RegStatusField_Tac;
+    if (strncmp(a.network_name, b.network_name, MAX_NETWORK_NAME_LEN) != 0) fields |= RegStatusField_NetworkName;
+    if (strncmp(a.cid, b.cid, MAX_CID_LEN) != 0) fields |= RegStatusField_Cid;
+    if (strncmp(a.lac, b.lac, MAX_LAC_LEN) != 0) fields |= RegStatusField_Lac;
+    return fields;
+}
+
+/**
+ * \brief Copies the fields given by \link RegistrationStatusField \endlink bits from source to target.
+ */
+inline void RegistrationStatusApply(const RegistrationStatus& source, Poco::UInt16 fields, RegistrationStatus& target)
+{
+    if (fields & RegStatusField_NetworkType) target.network_type = source.network_type;
+    if (fields & RegStatusField_CsRegStatus) target.cs_reg_status = source.cs_reg_status;
+    if (fields & RegStatusField_PsRegStatus) target.ps_reg_status = source.ps_reg_status;
+    if (fields & RegStatusField_Mnc) target.mnc = source.mnc;
+    if (fields & RegStatusField_Mcc) target.mcc = source.mcc;
+    if (fields & RegStatusField_Tac) target.tac = source.tac;
+    if (fields & RegStatusField_NetworkName) memcpy(target.network_name, source.network_name, MAX_NETWORK_NAME_LEN);
+    if (fields & RegStatusField_Cid) memcpy(target.cid, source.cid, MAX_CID_LEN);
+    if (fields & RegStatusField_Lac) memcpy(target.lac, source.lac, MAX_LAC_LEN);
+}
+
+/**
+ * RegistrationStatusDeltaEncoder turns the registration statuses sent to one remote subscriber
+ * into deltas against the last status the subscriber has acknowledged, so that an update of
+ * tac or ps_reg_status costs a few bytes instead of the whole status with its strings.
+ *
+ * A keyframe is sent first, when no status has been acknowledged yet, after reset(), and every
+ * keyframeInterval statuses. Statuses that have been sent but not acknowledged are remembered
+ * (up to a window), so an acknowledgement can arrive after later statuses have been sent; until
+ * it does, the deltas remain relative to the previously acknowledged status, and therefore can
+ * be applied even if intermediate ones have been lost.
+ *
+ * When events are delivered with two-way RemotingNG calls, the status is acknowledged once the
+ * call returns; with one-way events, the subscriber acknowledges through a method of its own.
+ *
+ * RegistrationStatusDeltaEncoder is not thread-safe, see \link RegistrationStatusDeltaStreams \endlink.
+ */
+class RegistrationStatusDeltaEncoder
+{
+public:
+    enum
+    {
+        DEFAULT_KEYFRAME_INTERVAL = 32,
+        WINDOW_SIZE = 16
+    };
+
+    RegistrationStatusDeltaEncoder(unsigned keyframeInterval = DEFAULT_KEYFRAME_INTERVAL):
+        _keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1), _sinceKeyframe(0), _sequence(0), _baseSequence(0)
+    {
+    }
+
+    /**
+     * @brief Encodes status into delta, as a delta against the last acknowledged status or as a keyframe.
+     */
+    void encode(const RegistrationStatus& status, RegistrationStatusDelta& delta)
+    {
+        if (++_sequence == 0) _sequence = 1;
+        delta.sequence = _sequence;
+        delta.status = status;
+        if (_baseSequence == 0 || _sinceKeyframe + 1 >= _keyframeInterval)
+        {
+            delta.baseSequence = 0;
+            delta.fields = RegStatusField_All;
+            _sinceKeyframe = 0;
+        }
+        else
+        {
+            delta.baseSequence = _baseSequence;
+            delta.fields = RegistrationStatusDiff(_base, status);
+            ++_sinceKeyframe;
+        }
+        if (_pending.size() >= WINDOW_SIZE) _pending.pop_front();
+        _pending.push_back(Pending(_sequence, status));
+    }
+
+    /**
+     * @brief Makes the status with the given sequence number the base of the following deltas.
+     *
+     * Returns false if the sequence number is unknown, e.g. because it fell out of the window
+     * or has already been superseded by a later acknowledgement.
+     */
+    bool acknowledge(Poco::UInt32 sequence)
+    {
+        for (std::deque<Pending>::iterator it = _pending.begin(); it != _pending.end(); ++it)
+        {
+            if (it->sequence == sequence)
+            {
+                _base = it->status;
+                _baseSequence = sequence;
+                _pending.erase(_pending.begin(), it + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Forgets the acknowledged status, so that the next status is sent as a keyframe,
+     * e.g. after the subscriber reconnected or failed to apply a delta.
+     */
+    void reset()
+    {
+        _baseSequence = 0;
+        _pending.clear();
+    }
+
+    Poco::UInt32 acknowledgedSequence() const
+    {
+        return _baseSequence;
+    }
+
+private:
+    struct Pending
+    {
+        Pending(Poco::UInt32 seq, const RegistrationStatus& st): sequence(seq), status(st) {}
+
+        Poco::UInt32 sequence;
+        RegistrationStatus status;
+    };
+
+    unsigned _keyframeInterval;
+    unsigned _sinceKeyframe;
+    Poco::UInt32 _sequence;
+    Poco::UInt32 _baseSequence;
+    RegistrationStatus _base;
+    std::deque<Pending> _pending;
+};
+
+/**
+ * RegistrationStatusDeltaDecoder rebuilds the registration statuses on the subscriber side.
+ *
+ * The last statuses decoded are kept (up to a window), as a delta refers to the last status
+ * acknowledged by the subscriber, which may not be the last one decoded.
+ */
+class RegistrationStatusDeltaDecoder
+{
+public:
+    enum
+    {
+        WINDOW_SIZE = 16
+    };
+
+    RegistrationStatusDeltaDecoder()
+    {
+    }
+
+    /**
+     * @brief Applies delta and stores the resulting status in status.
+     *
+     * Returns false if delta refers to a status that is not known (anymore), in which case the
+     * subscriber should not acknowledge the sequence number and should ask for a keyframe.
+     */
+    bool decode(const RegistrationStatusDelta& delta, RegistrationStatus& status)
+    {
+        if (delta.isKeyframe())
+        {
+            status = delta.status;
+        }
+        else
+        {
+            const RegistrationStatus* pBase = find(delta.baseSequence);
+            if (!pBase) return false;
+            status = *pBase;
+            RegistrationStatusApply(delta.status, delta.fields, status);
+        }
+        if (_history.size() >= WINDOW_SIZE) _history.pop_front();
+        _history.push_back(Decoded(delta.sequence, status));
+        return true;
+    }
+
+    /**
+     * @brief Forgets all statuses, so that only a keyframe can be decoded next.
+     */
+    void reset()
+    {
+        _history.clear();
+    }
+
+private:
+    struct Decoded
+    {
+        Decoded(Poco::UInt32 seq, const RegistrationStatus& st): sequence(seq), status(st) {}
+
+        Poco::UInt32 sequence;
+        RegistrationStatus status;
+    };
+
+    const RegistrationStatus* find(Poco::UInt32 sequence) const
+    {
+        for (std::deque<Decoded>::const_reverse_iterator it = _history.rbegin(); it != _history.rend(); ++it)
+        {
+            if (it->sequence == sequence) return &it->status;
+        }
+        return 0;
+    }
+
+    std::deque<Decoded> _history;
+};
+
+/**
+ * RegistrationStatusDeltaStreams keeps a \link RegistrationStatusDeltaEncoder \endlink for every
+ * remote subscriber of onRegistrationStatusChanged, identified by its subscriber URI, e.g. in the
+ * event dispatcher of the service:
+ *
+ *     RegistrationStatusDelta delta;
+ *     _streams.encode(subscriberURI, status, delta);
+ *     pEventSubscriber->registrationStatusDelta(delta);   // a two-way remote event
+ *     _streams.acknowledge(subscriberURI, delta.sequence);
+ *
+ * RegistrationStatusDeltaStreams is thread-safe.
+ */
+class RegistrationStatusDeltaStreams
+{
+public:
+    RegistrationStatusDeltaStreams(unsigned keyframeInterval = RegistrationStatusDeltaEncoder::DEFAULT_KEYFRAME_INTERVAL):
+        _keyframeInterval(keyframeInterval)
+    {
+    }
+
+    void encode(const std::string& subscriberURI, const RegistrationStatus& status, RegistrationStatusDelta& delta)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        EncoderMap::iterator it = _encoders.find(subscriberURI);
+        if (it == _encoders.end())
+            it = _encoders.insert(EncoderMap::value_type(subscriberURI, RegistrationStatusDeltaEncoder(_keyframeInterval))).first;
+        it->second.encode(status, delta);
+    }
+
+    bool acknowledge(const std::string& subscriberURI, Poco::UInt32 sequence)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        EncoderMap::iterator it = _encoders.find(subscriberURI);
+        return it != _encoders.end() && it->second.acknowledge(sequence);
+    }
+
+    /**
+     * @brief Sends the next status to the subscriber as a keyframe.
+     */
+    void reset(const std::string& subscriberURI)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        EncoderMap::iterator it = _encoders.find(subscriberURI);
+        if (it != _encoders.end()) it->second.reset();
+    }
+
+    /**
+     * @brief Forgets the subscriber, e.g. when it unsubscribes.
+     */
+    void remove(const std::string& subscriberURI)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        _encoders.erase(subscriberURI);
+    }
+
+private:
+    RegistrationStatusDeltaStreams(const RegistrationStatusDeltaStreams&);
+    RegistrationStatusDeltaStreams& operator=(const RegistrationStatusDeltaStreams&);
+
+    typedef std::map<std::string, RegistrationStatusDeltaEncoder> EncoderMap;
+
+    unsigned _keyframeInterval;
+    EncoderMap _encoders;
+    Poco::FastMutex _mutex;
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+namespace Poco {
+namespace RemotingNG {
+
+/**
+ * Serializes a RegistrationStatusDelta as a struct with the members sequence, baseSequence and
+ * fields, followed by the included fields only. Enumerations are serialized as their numeric
+ * values, and the character fields without the trailing blanks they are padded with.
+ */
+template <>
+class TypeSerializer<Stla::Connectivity::RegistrationStatusDelta>
+{
+public:
+    static void serialize(const std::string& name, const Stla::Connectivity::RegistrationStatusDelta& value, Serializer& ser)
+    {
+        using namespace Stla::Connectivity;
+        const RegistrationStatus& status = value.status;
+        ser.serializeStructBegin(name);
+        TypeSerializer<Poco::UInt32>::serialize("sequence", value.sequence, ser);
+        TypeSerializer<Poco::UInt32>::serialize("baseSequence", value.baseSequence, ser);
+        TypeSerializer<Poco::UInt16>::serialize("fields", value.fields, ser);
+        if (value.fields & RegStatusField_NetworkType) TypeSerializer<Poco::Int32>::serialize("network_type", status.network_type, ser);
+        if (value.fields & RegStatusField_CsRegStatus) TypeSerializer<Poco::Int32>::serialize("cs_reg_status", status.cs_reg_status, ser);
+        if (value.fields & RegStatusField_PsRegStatus) TypeSerializer<Poco::Int32>::serialize("ps_reg_status", status.ps_reg_status, ser);
+        if (value.fields & RegStatusField_Mnc) TypeSerializer<Poco::UInt16>::serialize("mnc", status.mnc, ser);
+        if (value.fields & RegStatusField_Mcc) TypeSerializer<Poco::UInt16>::serialize("mcc", status.mcc, ser);
+        if (value.fields & RegStatusField_Tac) TypeSerializer<Poco::UInt16>::serialize("tac", status.tac, ser);
+        if (value.fields & RegStatusField_NetworkName) TypeSerializer<std::string>::serialize("network_name", trimmed(status.network_name, MAX_NETWORK_NAME_LEN), ser);
+        if (value.fields & RegStatusField_Cid) TypeSerializer<std::string>::serialize("cid", trimmed(status.cid, MAX_CID_LEN), ser);
+        if (value.fields & RegStatusField_Lac) TypeSerializer<std::string>::serialize("lac", trimmed(status.lac, MAX_LAC_LEN), ser);
+        ser.serializeStructEnd(name);
+    }
+
+private:
+    static std::string trimmed(const char* field, std::size_t size)
+    {
+        std::size_t length = strnlen(field, size);
+        while (length > 0 && field[length - 1] == ' ') --length;
+        return std::string(field, length);
+    }
+};
+
+template <>
+class TypeDeserializer<Stla::Connectivity::RegistrationStatusDelta>
+{
+public:
+    static bool deserialize(const std::string& name, bool isMandatory, Deserializer& deser, Stla::Connectivity::RegistrationStatusDelta& value)
+    {
+        using namespace Stla::Connectivity;
+        if (deser.deserializeStructBegin(name, isMandatory))
+        {
+            RegistrationStatus& status = value.status;
+            status = RegistrationStatus();
+            TypeDeserializer<Poco::UInt32>::deserialize("sequence", true, deser, value.sequence);
+            TypeDeserializer<Poco::UInt32>::deserialize("baseSequence", true, deser, value.baseSequence);
+            TypeDeserializer<Poco::UInt16>::deserialize("fields", true, deser, value.fields);
+            if (value.fields & ~RegStatusField_All) throw DeserializerException("Unknown RegistrationStatus fields");
+            if (value.isKeyframe() && value.fields != RegStatusField_All) throw DeserializerException("Incomplete RegistrationStatus keyframe");
+            Poco::Int32 enumValue;
+            std::string str;
+            if (value.fields & RegStatusField_NetworkType)
+            {
+                TypeDeserializer<Poco::Int32>::deserialize("network_type", true, deser, enumValue);
+                status.network_type = static_cast<ConMgrNetworkType>(enumValue);
+            }
+            if (value.fields & RegStatusField_CsRegStatus)
+            {
+                TypeDeserializer<Poco::Int32>::deserialize("cs_reg_status", true, deser, enumValue);
+                status.cs_reg_status = static_cast<ConMgrRegistrationStatus>(enumValue);
+            }
+            if (value.fields & RegStatusField_PsRegStatus)
+            {
+                TypeDeserializer<Poco::Int32>::deserialize("ps_reg_status", true, deser, enumValue);
+                status.ps_reg_status = static_cast<ConMgrRegistrationStatus>(enumValue);
+            }
+            if (value.fields & RegStatusField_Mnc) TypeDeserializer<Poco::UInt16>::deserialize("mnc", true, deser, status.mnc);
+            if (value.fields & RegStatusField_Mcc) TypeDeserializer<Poco::UInt16>::deserialize("mcc", true, deser, status.mcc);
+            if (value.fields & RegStatusField_Tac) TypeDeserializer<Poco::UInt16>::deserialize("tac", true, deser, status.tac);
+            if (value.fields & RegStatusField_NetworkName)
+            {
+                TypeDeserializer<std::string>::deserialize("network_name", true, deser, str);
+                padded(str, status.network_name, MAX_NETWORK_NAME_LEN);
+            }
+            if (value.fields & RegStatusField_Cid)
+            {
+                TypeDeserializer<std::string>::deserialize("cid", true, deser, str);
+                padded(str, status.cid, MAX_CID_LEN);
+            }
+            if (value.fields & RegStatusField_Lac)
+            {
+                TypeDeserializer<std::string>::deserialize("lac", true, deser, str);
+                padded(str, status.lac, MAX_LAC_LEN);
+            }
+            deser.deserializeStructEnd(name);
+            return true;
+        }
+        else return false;
+    }
+
+private:
+    /**
+     * @brief Stores str in field, padded with blanks and terminated by a NULL, like RegistrationStatus does.
+     */
+    static void padded(const std::string& str, char* field, std::size_t size)
+    {
+        if (str.size() > size - 1) throw DeserializerException("RegistrationStatus field too long", str);
+        memcpy(field, str.data(), str.size());
+        memset(field + str.size(), ' ', size - 1 - str.size());
+        field[size - 1] = '\0';
+    }
+};
+
+} } // namespace Poco::RemotingNG
+
+#endif // ICONNMANAGERSERVICEDELTA_H
@@ -0,0 +1,208 @@
+/**
+ * \file
+ *         IConnManagerServiceFilters.h
+ * \brief
+ *         Subscription filters for IConnManagerService events
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICEFILTERS_H
+#define ICONNMANAGERSERVICEFILTERS_H
+
+#include "IConnManagerService.h"
+#include "IConnManagerServiceConfig.h"
+#include "Poco/FilteredDelegate.h"
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * The filters below are used with Poco::filtered() when registering a delegate
+ * with an IConnManagerService event. They are evaluated in the connection manager
+ * before the delegate is invoked, so the subscriber is only woken up for changes
+ * it is interested in:
+ *
+ *     service->onLteMetrics += Poco::filtered(Poco::delegate(this, &Client::onLte), LteMetricsDeltaFilter(3, 0, 0));
+ *
+ * Each registration keeps its own filter state. The first notification is always delivered.
+ */
+
+/**
+ * @brief Delivers LteMetrics only if a field changed by at least the given delta
+ * since the last delivered value. A delta of 0 ignores the field.
+ */
+class LteMetricsDeltaFilter : public Poco::AbstractDelegateFilter<const LteMetrics>
+{
+public:
+    LteMetricsDeltaFilter(short rsrpDelta, short rsrqDelta, short snrDelta, short rssiDelta = 0):
+        _rsrpDelta(rsrpDelta), _rsrqDelta(rsrqDelta), _snrDelta(snrDelta), _rssiDelta(rssiDelta), _first(true)
+    {
+    }
+
+    bool accept(const LteMetrics& metrics)
+    {
+        if (_first || exceeds(metrics.rsrp, _last.rsrp, _rsrpDelta) || exceeds(metrics.rsrq, _last.rsrq, _rsrqDelta)
+            || exceeds(metrics.snr, _last.snr, _snrDelta) || exceeds(metrics.raw_rssi, _last.raw_rssi, _rssiDelta))
+        {
+            _first = false;
+            _last = metrics;
+            return true;
+        }
+        return false;
+    }
+
+    Poco::AbstractDelegateFilter<const LteMetrics>* clone() const
+    {
+        return new LteMetricsDeltaFilter(*this);
+    }
+
+    /**
+     * @brief Returns true if value differs from last by at least delta, with delta 0 meaning never.
+     */
+    static bool exceeds(int value, int last, int delta)
+    {
+        return delta > 0 && (value - last >= delta || last - value >= delta);
+    }
+
+private:
+    short _rsrpDelta;
+    short _rsrqDelta;
+    short _snrDelta;
+    short _rssiDelta;
+    bool _first;
+    LteMetrics _last;
+};
+
+/**
+ * @brief Delivers UmtsMetrics only if a field changed by at least the given delta
+ * since the last delivered value. A delta of 0 ignores the field.
+ */
+class UmtsMetricsDeltaFilter : public Poco::AbstractDelegateFilter<const UmtsMetrics>
+{
+public:
+    UmtsMetricsDeltaFilter(short rscpDelta, short ecioDelta, short rssiDelta = 0):
+        _rscpDelta(rscpDelta), _ecioDelta(ecioDelta), _rssiDelta(rssiDelta), _first(true)
+    {
+    }
+
+    bool accept(const UmtsMetrics& metrics)
+    {
+        if (_first || LteMetricsDeltaFilter::exceeds(metrics.rscp, _last.rscp, _rscpDelta)
+            || LteMetricsDeltaFilter::exceeds(metrics.ecio, _last.ecio, _ecioDelta)
+            || LteMetricsDeltaFilter::exceeds(metrics.raw_rssi, _last.raw_rssi, _rssiDelta))
+        {
+            _first = false;
+            _last = metrics;
+            return true;
+        }
+        return false;
+    }
+
+    Poco::AbstractDelegateFilter<const UmtsMetrics>* clone() const
+    {
+        return new UmtsMetricsDeltaFilter(*this);
+    }
+
+private:
+    short _rscpDelta;
+    short _ecioDelta;
+    short _rssiDelta;
+    bool _first;
+    UmtsMetrics _last;
+};
+
+/**
+ * @brief Delivers GsmMetrics only if a field changed by at least the given delta
+ * since the last delivered value. A delta of 0 ignores the field.
+ */
+class GsmMetricsDeltaFilter : public Poco::AbstractDelegateFilter<const GsmMetrics>
+{
+public:
+    GsmMetricsDeltaFilter(short rssiDelta, short blerDelta = 0):
+        _rssiDelta(rssiDelta), _blerDelta(blerDelta), _first(true)
+    {
+    }
+
+    bool accept(const GsmMetrics& metrics)
+    {
+        if (_first || LteMetricsDeltaFilter::exceeds(metrics.raw_rssi, _last.raw_rssi, _rssiDelta)
+            || LteMetricsDeltaFilter::exceeds(metrics.bler, _last.bler, _blerDelta))
+        {
+            _first = false;
+            _last = metrics;
+            return true;
+        }
+        return false;
+    }
+
+    Poco::AbstractDelegateFilter<const GsmMetrics>* clone() const
+    {
+        return new GsmMetricsDeltaFilter(*this);
+    }
+
+private:
+    short _rssiDelta;
+    short _blerDelta;
+    bool _first;
+    GsmMetrics _last;
+};
+
+/**
+ * @brief Delivers a \link CellularSignal \endlink only if its \link ConMgrSignalRange \endlink
+ * changed since the last delivered value.
+ *
+ * The range is computed for the network type carried by the event, with the default ranges
+ * or with the current tuning of the given ConnManagerConfig, which must outlive the registration:
+ *
+ *     service->onCellularSignalChanged += Poco::filtered(Poco::delegate(this, &Client::onSignal), SignalRangeFilter());
+ */
+class SignalRangeFilter : public Poco::AbstractDelegateFilter<const CellularSignal>
+{
+public:
+    SignalRangeFilter():
+        _pConfig(0), _last(ConMgrSignalRange_Unknown), _first(true)
+    {
+    }
+
+    explicit SignalRangeFilter(const ConnManagerConfig& config):
+        _pConfig(&config), _last(ConMgrSignalRange_Unknown), _first(true)
+    {
+    }
+
+    bool accept(const CellularSignal& signal)
+    {
+        ConMgrSignalRange range = _pConfig ? _pConfig->current().signalRange(signal.network_type, signal.signal_strength)
+            : ConMgrSignalRangeOf(signal.network_type, signal.signal_strength);
+        if (_first || range != _last)
+        {
+            _first = false;
+            _last = range;
+            return true;
+        }
+        return false;
+    }
+
+    Poco::AbstractDelegateFilter<const CellularSignal>* clone() const
+    {
+        return new SignalRangeFilter(*this);
+    }
+
+private:
+    const ConnManagerConfig* _pConfig;
+    ConMgrSignalRange _last;
+    bool _first;
+};
+
+}
+}
+
+#endif // ICONNMANAGERSERVICEFILTERS_H
@@ -0,0 +1,89 @@
+/**
+ * \file
+ *         IConnManagerServiceHeartbeat.h
+ * \brief
+ *         Adapts RemotingNG TCP heartbeat intervals to the current data path
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICEHEARTBEAT_H
+#define ICONNMANAGERSERVICEHEARTBEAT_H
+
+#include "IConnManagerService.h"
+#include "Poco/RemotingNG/TCP/HeartbeatScheduler.h"
+#include "Poco/Delegate.h"
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * @brief Maps a ConMgrDataPath to the HeartbeatScheduler link class of remote connections.
+ */
+inline Poco::RemotingNG::TCP::HeartbeatScheduler::LinkClass ConMgrDataPathLinkClass(ConMgrDataPath dataPath)
+{
+    switch (dataPath)
+    {
+    case ConMgrDataPath_Cellular:
+        return Poco::RemotingNG::TCP::HeartbeatScheduler::LINK_CELLULAR;
+    case ConMgrDataPath_WiFi:
+        return Poco::RemotingNG::TCP::HeartbeatScheduler::LINK_LAN;
+    default:
+        return Poco::RemotingNG::TCP::HeartbeatScheduler::LINK_DOWN;
+    }
+}
+
+/**
+ * DataPathHeartbeatAdapter keeps the link class of a HeartbeatScheduler in sync with
+ * the data path reported by the connection manager, so that remote RemotingNG connections
+ * are probed less often over cellular links, and not at all while no data path is available.
+ * Connections to the local host keep the loopback policy.
+ *
+ *     Poco::RemotingNG::TCP::HeartbeatScheduler scheduler;
+ *     DataPathHeartbeatAdapter adapter(service, scheduler);
+ *     scheduler.add(pConnection);
+ *
+ * Both the service and the scheduler must outlive the adapter.
+ */
+class DataPathHeartbeatAdapter
+{
+public:
+    DataPathHeartbeatAdapter(IConnManagerService::Ptr pService, Poco::RemotingNG::TCP::HeartbeatScheduler& scheduler):
+        _pService(pService), _scheduler(scheduler)
+    {
+        _pService->onDataPathTypeChanged += Poco::delegate(this, &DataPathHeartbeatAdapter::onDataPathTypeChanged);
+        ConMgrDataPath dataPath;
+        if (_pService->getDataPathType(dataPath) == ConMgrErr_OK)
+            _scheduler.setRemoteLinkClass(ConMgrDataPathLinkClass(dataPath));
+    }
+
+    ~DataPathHeartbeatAdapter()
+    {
+        _pService->onDataPathTypeChanged -= Poco::delegate(this, &DataPathHeartbeatAdapter::onDataPathTypeChanged);
+    }
+
+private:
+    DataPathHeartbeatAdapter(const DataPathHeartbeatAdapter&);
+    DataPathHeartbeatAdapter& operator=(const DataPathHeartbeatAdapter&);
+
+    void onDataPathTypeChanged(const void*, const ConMgrDataPath& dataPath)
+    {
+        _scheduler.setRemoteLinkClass(ConMgrDataPathLinkClass(dataPath));
+    }
+
+    IConnManagerService::Ptr _pService;
+    Poco::RemotingNG::TCP::HeartbeatScheduler& _scheduler;
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+#endif // ICONNMANAGERSERVICEHEARTBEAT_H
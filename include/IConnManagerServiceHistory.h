@@ -0,0 +1,241 @@
+/**
+ * \file
+ *         IConnManagerServiceHistory.h
+ * \brief
+ *         Bounded history of connectivity metrics with time window queries
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICEHISTORY_H
+#define ICONNMANAGERSERVICEHISTORY_H
+
+#include "IConnManagerServiceTypes.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Mutex.h"
+#include <cstddef>
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * \brief The ConMgrHistoryMetric defines the metrics recorded by ConnectivityHistory.
+ */
+//@serialize
+enum ConMgrHistoryMetric
+{
+    ConMgrHistory_LteRssi = 0,          /**< LteMetrics::raw_rssi */
+    ConMgrHistory_LteRsrq,              /**< LteMetrics::rsrq */
+    ConMgrHistory_LteRsrp,              /**< LteMetrics::rsrp */
+    ConMgrHistory_LteSnr,               /**< LteMetrics::snr */
+    ConMgrHistory_UmtsRssi,             /**< UmtsMetrics::raw_rssi */
+    ConMgrHistory_UmtsRscp,             /**< UmtsMetrics::rscp */
+    ConMgrHistory_UmtsEcio,             /**< UmtsMetrics::ecio */
+    ConMgrHistory_GsmRssi,              /**< GsmMetrics::raw_rssi */
+    ConMgrHistory_GsmBler,              /**< GsmMetrics::bler */
+    ConMgrHistory_ApnPublic,            /**< APNConnState::available of ApnName_Public, 1 or 0 */
+    ConMgrHistory_ApnTelematic,         /**< APNConnState::available of ApnName_Telematic, 1 or 0 */
+    ConMgrHistory_Last                  /**< Guard, add metrics before this line */
+};
+
+/**
+ * @brief Structure contains the aggregate of a metric over a time window:
+ * - count (Number of samples in the window)
+ * - min (Minimum value)
+ * - max (Maximum value)
+ * - mean (Arithmetic mean of the values)
+ * - drops (Number of transitions from a non-zero to a zero value, e.g. APN disconnections)
+ */
+struct ConnectivityHistoryAggregate
+{
+    std::size_t count;
+    int min;
+    int max;
+    double mean;
+    std::size_t drops;
+    ConnectivityHistoryAggregate(): count(0), min(0), max(0), mean(0), drops(0) {}
+};
+
+/**
+ * @brief Callback interface for ConnectivityHistory::queryHistory()
+ *
+ * The callback is invoked with the history lock held and must not call back into the history.
+ */
+class ConnectivityHistoryCallback
+{
+public:
+    virtual ~ConnectivityHistoryCallback() {}
+
+    /**
+     * @brief Called for every sample in the window, in recording order. The default implementation does nothing.
+     */
+    virtual void onSample(Poco::Timestamp::TimeVal /*time*/, int /*value*/) {}
+
+    /**
+     * @brief Called once after all samples with the aggregate of the window.
+     */
+    virtual void onAggregate(const ConnectivityHistoryAggregate& aggregate) = 0;
+};
+
+/**
+ * @brief Fixed-size history of connectivity metrics.
+ *
+ * Samples are stored per metric in a ring buffer of Capacity entries, with time stamps
+ * and values in separate arrays, so that window queries only touch the data they need.
+ * Recording and querying never allocate.
+ *
+ * The record methods have the signature of the corresponding IConnManagerService event
+ * delegates and can be registered directly:
+ *
+ *     service->onLteMetrics += Poco::delegate(&history, &ConnectivityHistory<>::onLteMetrics);
+ */
+template <std::size_t Capacity = 1024>
+class ConnectivityHistory
+{
+public:
+    ConnectivityHistory()
+    {
+        for (int i = 0; i < ConMgrHistory_Last; ++i)
+        {
+            _head[i] = 0;
+            _size[i] = 0;
+        }
+    }
+
+    void onLteMetrics(const void* /*pSender*/, const LteMetrics& metrics)
+    {
+        Poco::Timestamp now;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        push(ConMgrHistory_LteRssi, now.epochMicroseconds(), metrics.raw_rssi);
+        push(ConMgrHistory_LteRsrq, now.epochMicroseconds(), metrics.rsrq);
+        push(ConMgrHistory_LteRsrp, now.epochMicroseconds(), metrics.rsrp);
+        push(ConMgrHistory_LteSnr, now.epochMicroseconds(), metrics.snr);
+    }
+
+    void onUmtsMetrics(const void* /*pSender*/, const UmtsMetrics& metrics)
+    {
+        Poco::Timestamp now;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        push(ConMgrHistory_UmtsRssi, now.epochMicroseconds(), metrics.raw_rssi);
+        push(ConMgrHistory_UmtsRscp, now.epochMicroseconds(), metrics.rscp);
+        push(ConMgrHistory_UmtsEcio, now.epochMicroseconds(), metrics.ecio);
+    }
+
+    void onGsmMetrics(const void* /*pSender*/, const GsmMetrics& metrics)
+    {
+        Poco::Timestamp now;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        push(ConMgrHistory_GsmRssi, now.epochMicroseconds(), metrics.raw_rssi);
+        push(ConMgrHistory_GsmBler, now.epochMicroseconds(), metrics.bler);
+    }
+
+    void onApnConStateChanged(const void* /*pSender*/, const APNConnState& state)
+    {
+        Poco::Timestamp now;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        push(state.interface == ApnName_Public ? ConMgrHistory_ApnPublic : ConMgrHistory_ApnTelematic, now.epochMicroseconds(), state.available ? 1 : 0);
+    }
+
+    /**
+     * @brief Records a sample of metric taken at time.
+     */
+    void record(ConMgrHistoryMetric metric, const Poco::Timestamp& time, int value)
+    {
+        if (metric < 0 || metric >= ConMgrHistory_Last) return;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        push(metric, time.epochMicroseconds(), value);
+    }
+
+    /**
+     * @brief Visits all samples of metric with from <= time <= to and reports their aggregate.
+     *
+     * All recorded samples are examined, as samples recorded with record() need not be in
+     * time order.
+     *
+     * @return ConMgrErr_InvalidArgument if metric is out of range, ConMgrErr_OK otherwise.
+     */
+    ConMgrErrno queryHistory(ConMgrHistoryMetric metric, const Poco::Timestamp& from, const Poco::Timestamp& to, ConnectivityHistoryCallback& callback) const
+    {
+        if (metric < 0 || metric >= ConMgrHistory_Last) return ConMgrErr_InvalidArgument;
+        const Poco::Timestamp::TimeVal first = from.epochMicroseconds();
+        const Poco::Timestamp::TimeVal last = to.epochMicroseconds();
+        ConnectivityHistoryAggregate aggregate;
+        double sum = 0;
+        int previous = 0;
+
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        const std::size_t size = _size[metric];
+        const std::size_t oldest = (_head[metric] + Capacity - size) % Capacity;
+        const Poco::Timestamp::TimeVal* times = _times[metric];
+        const int* values = _values[metric];
+        for (std::size_t n = 0; n < size; ++n)
+        {
+            const std::size_t i = (oldest + n) % Capacity;
+            if (times[i] < first || times[i] > last) continue;
+            const int value = values[i];
+            callback.onSample(times[i], value);
+            if (aggregate.count == 0)
+            {
+                aggregate.min = value;
+                aggregate.max = value;
+            }
+            else
+            {
+                if (value < aggregate.min) aggregate.min = value;
+                if (value > aggregate.max) aggregate.max = value;
+                if (previous != 0 && value == 0) ++aggregate.drops;
+            }
+            sum += value;
+            previous = value;
+            ++aggregate.count;
+        }
+        if (aggregate.count > 0) aggregate.mean = sum/aggregate.count;
+        callback.onAggregate(aggregate);
+        return ConMgrErr_OK;
+    }
+
+    /**
+     * @brief Removes all samples.
+     */
+    void clear()
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        for (int i = 0; i < ConMgrHistory_Last; ++i)
+        {
+            _head[i] = 0;
+            _size[i] = 0;
+        }
+    }
+
+private:
+    void push(ConMgrHistoryMetric metric, Poco::Timestamp::TimeVal time, int value)
+    {
+        std::size_t& head = _head[metric];
+        _times[metric][head] = time;
+        _values[metric][head] = value;
+        head = (head + 1) % Capacity;
+        if (_size[metric] < Capacity) ++_size[metric];
+    }
+
+    ConnectivityHistory(const ConnectivityHistory&);
+    ConnectivityHistory& operator = (const ConnectivityHistory&);
+
+    Poco::Timestamp::TimeVal _times[ConMgrHistory_Last][Capacity];
+    int _values[ConMgrHistory_Last][Capacity];
+    std::size_t _head[ConMgrHistory_Last];
+    std::size_t _size[ConMgrHistory_Last];
+    mutable Poco::FastMutex _mutex;
+};
+
+}
+}
+
+#endif // ICONNMANAGERSERVICEHISTORY_H
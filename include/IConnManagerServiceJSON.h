@@ -0,0 +1,197 @@
+/**
+ * \file
+ *         IConnManagerServiceJSON.h
+ * \brief
+ *         Writes the IConnManagerService types as JSON with Poco::JSON::Writer
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Specializations of Poco::JSON::TypeWriter for the structures of
+ * IConnManagerServiceTypes.h, so that they can be streamed to JSON without
+ * building Poco::JSON::Object trees:
+ *
+ *     Poco::JSON::Writer writer(ostr);
+ *     writer.write(snapshot);
+ *
+ * Member names are the names of the structure fields. Enumerations are written
+ * as their numeric values, like RemotingNG does, and reserved fields are left out.
+ */
+
+#ifndef ICONNMANAGERSERVICEJSON_H
+#define ICONNMANAGERSERVICEJSON_H
+
+#include "IConnManagerServiceTypes.h"
+#include "Poco/JSON/Writer.h"
+
+namespace Poco {
+namespace JSON {
+
+template <>
+class TypeWriter<Stla::Connectivity::APNConnState>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::APNConnState& value)
+    {
+        writer.beginObject();
+        writer.member("interface", value.interface);
+        writer.member("available", value.available);
+        writer.endObject();
+    }
+};
+
+template <>
+class TypeWriter<Stla::Connectivity::ApnConStates>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::ApnConStates& value)
+    {
+        writer.beginObject();
+        writer.member("available", value.available);
+        writer.member("changed", value.changed);
+        writer.endObject();
+    }
+};
+
+template <class T>
+class TypeWriter<Stla::Connectivity::ConMgrResult<T> >
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::ConMgrResult<T>& value)
+    {
+        writer.beginObject();
+        writer.member("error", value.error);
+        if (value.error == Stla::Connectivity::ConMgrErr_OK)
+            writer.member("value", value.value);
+        writer.endObject();
+    }
+};
+
+template <>
+class TypeWriter<Stla::Connectivity::GsmMetrics>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::GsmMetrics& value)
+    {
+        writer.beginObject();
+        writer.member("raw_rssi", value.raw_rssi);
+        writer.member("bler", value.bler);
+        writer.endObject();
+    }
+};
+
+template <>
+class TypeWriter<Stla::Connectivity::UmtsMetrics>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::UmtsMetrics& value)
+    {
+        writer.beginObject();
+        writer.member("rscp", value.rscp);
+        writer.member("ecio", value.ecio);
+        writer.member("bler", value.bler);
+        writer.member("raw_rssi", value.raw_rssi);
+        writer.endObject();
+    }
+};
+
+template <>
+class TypeWriter<Stla::Connectivity::LteMetrics>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::LteMetrics& value)
+    {
+        writer.beginObject();
+        writer.member("raw_rssi", value.raw_rssi);
+        writer.member("rsrq", value.rsrq);
+        writer.member("rsrp", value.rsrp);
+        writer.member("snr", value.snr);
+        writer.endObject();
+    }
+};
+
+template <>
+class TypeWriter<Stla::Connectivity::CellularNbCells>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::CellularNbCells& value)
+    {
+        writer.beginObject();
+        writer.member("num_gsm_cells", value.num_gsm_cells);
+        writer.member("num_wcdma_cells", value.num_wcdma_cells);
+        writer.member("num_lte_cells", value.num_lte_cells);
+        writer.endObject();
+    }
+};
+
+template <>
+class TypeWriter<Stla::Connectivity::RegistrationStatus>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::RegistrationStatus& value)
+    {
+        writer.beginObject();
+        writer.member("network_type", value.network_type);
+        writer.member("cs_reg_status", value.cs_reg_status);
+        writer.member("ps_reg_status", value.ps_reg_status);
+        writer.member("mnc", value.mnc);
+        writer.member("mcc", value.mcc);
+        writer.member("tac", value.tac);
+        writer.member("network_name", value.network_name);
+        writer.member("cid", value.cid);
+        writer.member("lac", value.lac);
+        writer.endObject();
+    }
+};
+
+template <>
+class TypeWriter<Stla::Connectivity::DateTime>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::DateTime& value)
+    {
+        writer.beginObject();
+        writer.member("local_time", static_cast<Poco::Int64>(value.local_time));
+        writer.member("offset", value.offset);
+        writer.member("timezone", value.timezone);
+        writer.member("daylt_sav", value.daylt_sav);
+        writer.endObject();
+    }
+};
+
+template <>
+class TypeWriter<Stla::Connectivity::ConnectivitySnapshot>
+{
+public:
+    static void write(Writer& writer, const Stla::Connectivity::ConnectivitySnapshot& value)
+    {
+        writer.beginObject();
+        writer.member("sequence", value.sequence);
+        writer.member("network_type", value.network_type);
+        writer.member("apn_state", value.apn_state);
+        writer.member("mcc", value.mcc);
+        writer.member("wifi_data_con_state", value.wifi_data_con_state);
+        writer.member("signal_strength", value.signal_strength);
+        writer.member("modem_available", value.modem_available);
+        writer.member("gsm", value.gsm);
+        writer.member("umts", value.umts);
+        writer.member("lte", value.lte);
+        writer.member("nb_cells", value.nb_cells);
+        writer.member("registration", value.registration);
+        writer.member("cellular_time", value.cellular_time);
+        writer.member("data_path", value.data_path);
+        writer.endObject();
+    }
+};
+
+} // namespace JSON
+} // namespace Poco
+
+#endif // ICONNMANAGERSERVICEJSON_H
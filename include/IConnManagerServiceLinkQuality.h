@@ -0,0 +1,355 @@
+/**
+ * \file
+ *         IConnManagerServiceLinkQuality.h
+ * \brief
+ *         Link quality estimation from the IConnManagerService radio metrics
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICELINKQUALITY_H
+#define ICONNMANAGERSERVICELINKQUALITY_H
+
+#include "IConnManagerService.h"
+#include "Poco/SnapshotEvent.h"
+#include "Poco/Delegate.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Mutex.h"
+#include <cmath>
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * @brief Estimated quality of the cellular link, published by LinkQualityEstimator:
+ * - available (True if registered to the packet switch)
+ * - networkType (Network type the estimate is for)
+ * - quality (Smoothed quality, from 0 (no service) to 100 (excellent))
+ * - trend (Smoothed change of quality, in points per second, negative while the link degrades)
+ * - loss (Smoothed error rate, from 0 to 1)
+ * - throughput (Coarse estimate of the achievable throughput in kbit/s)
+ */
+struct ConMgrLinkQuality
+{
+    bool available;
+    ConMgrNetworkType networkType;
+    double quality;
+    double trend;
+    double loss;
+    double throughput;
+    ConMgrLinkQuality(): available(false), networkType(ConMgrNtwType_Unknown), quality(0), trend(0), loss(0), throughput(0) {}
+
+    /**
+     * @brief Returns the quality extrapolated horizon milliseconds ahead from the trend, from 0 to 100.
+     */
+    double predictedQuality(long horizon) const
+    {
+        double predicted = quality + trend*horizon/1000.0;
+        return predicted < 0 ? 0 : (predicted > 100 ? 100 : predicted);
+    }
+};
+
+/**
+ * LinkQualityEstimator fuses the GSM, UMTS and LTE metrics and the registration status of the
+ * connection manager into a smoothed estimate of the cellular link quality, so that bulk
+ * transfers can be scheduled into good radio windows instead of cells that are degrading.
+ *
+ * Every metrics sample is scored from 0 to 100, and folded into the estimate with an exponentially
+ * weighted moving average whose weight depends on the time elapsed since the previous sample
+ * (time constant given to the constructor), so irregular, coalesced deliveries are weighted
+ * correctly. The trend is the smoothed rate of change of the score. Every update is O(1).
+ *
+ * The scores use:
+ * - GSM: raw_rssi from -105 to -65 dBm, bler as RXQUAL (0 to 7) for the bit error rate
+ * - UMTS: rscp from -115 to -75 dBm, ecio (tenths of dB) from -15 to -3 dB, bler in percent
+ * - LTE: rsrp from -120 to -80 dBm, rsrq from -20 to -8 dB, snr (tenths of dB) from -5 to 20 dB;
+ *   the loss is derived from the snr as LTE reports no error rate
+ *
+ * Fields set to their "not available" defaults are ignored. The estimate is restarted when the
+ * network type or the cell (cid) changes, as the previous samples say nothing about the new cell,
+ * and drops to no service while the packet switch is not registered.
+ *
+ *     LinkQualityEstimator estimator(pService);
+ *     estimator.onLinkQualityChanged += Poco::delegate(this, &Uploader::onLinkQualityChanged);
+ *     ...
+ *     if (estimator.isGoodWindow(60)) startBulkUpload();
+ *
+ * linkQuality() and isGoodWindow() are cheap and can be called from any thread. The service must
+ * outlive the estimator.
+ */
+class LinkQualityEstimator
+{
+public:
+    enum
+    {
+        DEFAULT_TIME_CONSTANT = 10000, /**< milliseconds */
+        DEFAULT_HYSTERESIS = 5,        /**< quality points */
+        PREDICTION_HORIZON = 10000     /**< milliseconds, used by isGoodWindow() */
+    };
+
+    /**
+     * @brief Poco Event triggered when the availability or the network type changes, or when the
+     * quality moved by at least the hysteresis since the last notification.
+     */
+    Poco::SnapshotEvent<const ConMgrLinkQuality> onLinkQualityChanged;
+
+    LinkQualityEstimator(IConnManagerService::Ptr pService, long timeConstant = DEFAULT_TIME_CONSTANT, double hysteresis = DEFAULT_HYSTERESIS):
+        _pService(pService),
+        _timeConstant(timeConstant > 0 ? timeConstant : 1),
+        _hysteresis(hysteresis),
+        _hasSample(false),
+        _cid(),
+        _registered(false)
+    {
+        RegistrationStatus status;
+        if (_pService->getRegistrationStatus(status) == ConMgrErr_OK) update(status);
+        _pService->onRegistrationStatusChanged += Poco::delegate(this, &LinkQualityEstimator::onRegistrationStatusChanged);
+        _pService->onGsmMetrics += Poco::delegate(this, &LinkQualityEstimator::onGsmMetrics);
+        _pService->onUmtsMetrics += Poco::delegate(this, &LinkQualityEstimator::onUmtsMetrics);
+        _pService->onLteMetrics += Poco::delegate(this, &LinkQualityEstimator::onLteMetrics);
+    }
+
+    ~LinkQualityEstimator()
+    {
+        _pService->onLteMetrics -= Poco::delegate(this, &LinkQualityEstimator::onLteMetrics);
+        _pService->onUmtsMetrics -= Poco::delegate(this, &LinkQualityEstimator::onUmtsMetrics);
+        _pService->onGsmMetrics -= Poco::delegate(this, &LinkQualityEstimator::onGsmMetrics);
+        _pService->onRegistrationStatusChanged -= Poco::delegate(this, &LinkQualityEstimator::onRegistrationStatusChanged);
+    }
+
+    /**
+     * @brief Returns the current estimate.
+     */
+    ConMgrLinkQuality linkQuality() const
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        return _estimate;
+    }
+
+    /**
+     * @brief Returns true if the link is available, its quality is at least minQuality,
+     * and it is not predicted to fall below minQuality within the prediction horizon.
+     */
+    bool isGoodWindow(double minQuality) const
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        return _estimate.available && _estimate.quality >= minQuality
+            && _estimate.predictedQuality(PREDICTION_HORIZON) >= minQuality;
+    }
+
+    /**
+     * @brief Folds a metrics sample, received at the given time, into the estimate.
+     *
+     * Called for the events of the service; can also be used to replay recorded metrics.
+     */
+    void update(const GsmMetrics& metrics, const Poco::Timestamp& at = Poco::Timestamp())
+    {
+        Score score;
+        if (metrics.raw_rssi != static_cast<signed char>(0xFF)) score.add(0.6, ramp(metrics.raw_rssi, -105, -65));
+        if (metrics.bler <= 7)
+        {
+            // RXQUAL 0 to 7 stands for bit error rates from below 0.2% to above 12.8%, doubling with every step.
+            double ber = 0.0014*std::pow(2.0, metrics.bler);
+            score.add(0.4, 1 - ramp(metrics.bler, 0, 7));
+            score.loss(ber);
+        }
+        sample(ConMgrNtwType_GSM, score, at);
+    }
+
+    void update(const UmtsMetrics& metrics, const Poco::Timestamp& at = Poco::Timestamp())
+    {
+        Score score;
+        if (metrics.rscp < 0) score.add(0.5, ramp(metrics.rscp, -115, -75));
+        if (metrics.ecio != 0x7FFF) score.add(0.5, ramp(metrics.ecio, -150, -30));
+        if (metrics.bler <= 100) score.loss(metrics.bler/100.0);
+        sample(ConMgrNtwType_WCDMA, score, at);
+    }
+
+    void update(const LteMetrics& metrics, const Poco::Timestamp& at = Poco::Timestamp())
+    {
+        Score score;
+        if (metrics.rsrp < 0) score.add(0.4, ramp(metrics.rsrp, -120, -80));
+        if (metrics.rsrq != 0x7F) score.add(0.2, ramp(metrics.rsrq, -20, -8));
+        if (metrics.snr != 0x7FFF)
+        {
+            double snrScore = ramp(metrics.snr, -50, 200);
+            score.add(0.4, snrScore);
+            score.loss(0.1*(1 - snrScore));
+        }
+        sample(ConMgrNtwType_LTE, score, at);
+    }
+
+    void update(const RegistrationStatus& status)
+    {
+        bool registered = status.ps_reg_status == NADIF_REG_STAT_REGISTERED || status.ps_reg_status == NADIF_REG_STAT_REGISTERED_ROAMING;
+        bool notify = false;
+        ConMgrLinkQuality estimate;
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            if (status.network_type != _estimate.networkType || strncmp(status.cid, _cid, MAX_CID_LEN) != 0)
+            {
+                _hasSample = false;
+                memcpy(_cid, status.cid, MAX_CID_LEN);
+            }
+            _registered = registered;
+            _estimate.networkType = status.network_type;
+            if (!registered)
+            {
+                _hasSample = false;
+                _estimate.quality = 0;
+                _estimate.trend = 0;
+                _estimate.throughput = 0;
+            }
+            _estimate.available = registered && _hasSample;
+            notify = mustNotify();
+            estimate = _estimate;
+        }
+        if (notify) onLinkQualityChanged.notify(this, estimate);
+    }
+
+private:
+    LinkQualityEstimator(const LinkQualityEstimator&);
+    LinkQualityEstimator& operator=(const LinkQualityEstimator&);
+
+    /**
+     * @brief Weighted average of the available metrics of one sample.
+     */
+    struct Score
+    {
+        Score(): weight(0), sum(0), errorRate(0) {}
+
+        void add(double w, double value)
+        {
+            weight += w;
+            sum += w*value;
+        }
+
+        void loss(double rate)
+        {
+            errorRate = rate < 0 ? 0 : (rate > 1 ? 1 : rate);
+        }
+
+        double weight;
+        double sum;
+        double errorRate;
+    };
+
+    /**
+     * @brief Maps value linearly from [low, high] to [0, 1], clamped.
+     */
+    static double ramp(double value, double low, double high)
+    {
+        double r = (value - low)/(high - low);
+        return r < 0 ? 0 : (r > 1 ? 1 : r);
+    }
+
+    /**
+     * @brief Returns the nominal throughput in kbit/s of the network type under good conditions.
+     */
+    static double nominalThroughput(ConMgrNetworkType networkType)
+    {
+        switch (networkType)
+        {
+        case ConMgrNtwType_GSM:       return 200;
+        case ConMgrNtwType_WCDMA:     return 7000;
+        case ConMgrNtwType_LTE:       return 40000;
+        case ConMgrNtwType_CDMA_1X:   return 150;
+        case ConMgrNtwType_CDMA_EVDO: return 2000;
+        default:                      return 0;
+        }
+    }
+
+    void sample(ConMgrNetworkType networkType, const Score& score, const Poco::Timestamp& at)
+    {
+        if (score.weight == 0) return;
+        double quality = 100*score.sum/score.weight;
+        bool notify = false;
+        ConMgrLinkQuality estimate;
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            // Metrics of another network type are stale deliveries from before a change of the registration status.
+            if (networkType != _estimate.networkType || !_registered) return;
+            if (!_hasSample)
+            {
+                _estimate.quality = quality;
+                _estimate.trend = 0;
+                _estimate.loss = score.errorRate;
+                _hasSample = true;
+            }
+            else
+            {
+                double elapsed = (at - _lastSample)/1000.0;
+                if (elapsed < 1) elapsed = 1;
+                double alpha = 1 - std::exp(-elapsed/_timeConstant);
+                double previous = _estimate.quality;
+                _estimate.quality += alpha*(quality - _estimate.quality);
+                _estimate.trend += alpha*((_estimate.quality - previous)*1000/elapsed - _estimate.trend);
+                _estimate.loss += alpha*(score.errorRate - _estimate.loss);
+            }
+            _lastSample = at;
+            double fraction = _estimate.quality/100;
+            _estimate.throughput = nominalThroughput(networkType)*fraction*fraction*(1 - _estimate.loss);
+            _estimate.available = true;
+            notify = mustNotify();
+            estimate = _estimate;
+        }
+        if (notify) onLinkQualityChanged.notify(this, estimate);
+    }
+
+    /**
+     * @brief Returns true, and remembers the estimate as notified, if it differs enough
+     * from the last notified one. Must be called with the mutex held.
+     */
+    bool mustNotify()
+    {
+        if (_estimate.available == _notified.available && _estimate.networkType == _notified.networkType
+            && std::fabs(_estimate.quality - _notified.quality) < _hysteresis)
+            return false;
+        _notified = _estimate;
+        return true;
+    }
+
+    void onRegistrationStatusChanged(const void*, const RegistrationStatus& status)
+    {
+        update(status);
+    }
+
+    void onGsmMetrics(const void*, const GsmMetrics& metrics)
+    {
+        update(metrics);
+    }
+
+    void onUmtsMetrics(const void*, const UmtsMetrics& metrics)
+    {
+        update(metrics);
+    }
+
+    void onLteMetrics(const void*, const LteMetrics& metrics)
+    {
+        update(metrics);
+    }
+
+    IConnManagerService::Ptr _pService;
+    double _timeConstant;
+    double _hysteresis;
+    bool _hasSample;
+    char _cid[MAX_CID_LEN];
+    bool _registered;
+    Poco::Timestamp _lastSample;
+    ConMgrLinkQuality _estimate;
+    ConMgrLinkQuality _notified;
+    mutable Poco::FastMutex _mutex;
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+#endif // ICONNMANAGERSERVICELINKQUALITY_H
@@ -0,0 +1,162 @@
+/**
+ * \file
+ *         IConnManagerServiceSharedState.h
+ * \brief
+ *         Shared memory publication of the connectivity state for out-of-process readers
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICESHAREDSTATE_H
+#define ICONNMANAGERSERVICESHAREDSTATE_H
+
+#include "IConnManagerServiceTypes.h"
+#include "Poco/SharedMemory.h"
+#include "Poco/Exception.h"
+#include <string>
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * @brief Default name of the shared memory segment holding the connectivity state
+ */
+const char* const CONNMANAGER_SHARED_STATE_NAME = "stla.connectivity.connmanager.state";
+
+/**
+ * @brief Magic number identifying a ConnectivitySharedState segment ("CMSS")
+ */
+const unsigned int CONNMANAGER_SHARED_STATE_MAGIC = 0x434D5353;
+
+/**
+ * @brief Layout version of ConnectivitySharedState, incremented on incompatible changes
+ */
+const unsigned int CONNMANAGER_SHARED_STATE_VERSION = 1;
+
+/**
+ * @brief Layout of the shared memory segment:
+ * - magic (CONNMANAGER_SHARED_STATE_MAGIC)
+ * - version (CONNMANAGER_SHARED_STATE_VERSION)
+ * - size (sizeof(ConnectivitySharedState), guards against mismatching builds)
+ * - sequence (Sequence lock counter, odd while the snapshot is being written)
+ * - snapshot (Last published connectivity state)
+ */
+struct ConnectivitySharedState
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int size;
+    volatile unsigned int sequence;
+    ConnectivitySnapshot snapshot;
+};
+
+/**
+ * @brief Publishes ConnectivitySnapshot values into a shared memory segment.
+ *
+ * Used by the IConnManagerService implementation, which is the only writer.
+ * Publishing does not involve a system call.
+ */
+class ConnectivitySnapshotPublisher
+{
+public:
+    ConnectivitySnapshotPublisher(const std::string& name = CONNMANAGER_SHARED_STATE_NAME):
+        _shm(name, sizeof(ConnectivitySharedState), Poco::SharedMemory::AM_WRITE),
+        _pState(reinterpret_cast<ConnectivitySharedState*>(_shm.begin()))
+    {
+        if (!_pState) throw Poco::SystemException("cannot map connectivity shared state", name);
+        _pState->magic = 0;
+        __sync_synchronize();
+        _pState->version = CONNMANAGER_SHARED_STATE_VERSION;
+        _pState->size = sizeof(ConnectivitySharedState);
+        _pState->sequence = 0;
+        _pState->snapshot = ConnectivitySnapshot();
+        __sync_synchronize();
+        _pState->magic = CONNMANAGER_SHARED_STATE_MAGIC;
+    }
+
+    /**
+     * @brief Publishes snapshot. snapshot.sequence is ignored, readers get the sequence of the segment.
+     */
+    void publish(const ConnectivitySnapshot& snapshot)
+    {
+        unsigned int sequence = _pState->sequence;
+        _pState->sequence = sequence + 1;
+        __sync_synchronize();
+        memcpy(static_cast<void*>(&_pState->snapshot), &snapshot, sizeof(ConnectivitySnapshot));
+        _pState->snapshot.sequence = (sequence + 2)/2;
+        __sync_synchronize();
+        _pState->sequence = sequence + 2;
+    }
+
+private:
+    ConnectivitySnapshotPublisher(const ConnectivitySnapshotPublisher&);
+    ConnectivitySnapshotPublisher& operator = (const ConnectivitySnapshotPublisher&);
+
+    Poco::SharedMemory _shm;
+    ConnectivitySharedState* _pState;
+};
+
+/**
+ * @brief Reads ConnectivitySnapshot values published by ConnectivitySnapshotPublisher.
+ *
+ * Reading does not involve a system call nor a lock, and never blocks the publisher.
+ */
+class ConnectivitySnapshotReader
+{
+public:
+    ConnectivitySnapshotReader(const std::string& name = CONNMANAGER_SHARED_STATE_NAME):
+        _shm(name, sizeof(ConnectivitySharedState), Poco::SharedMemory::AM_READ, 0, false),
+        _pState(reinterpret_cast<const ConnectivitySharedState*>(_shm.begin()))
+    {
+        if (!_pState) throw Poco::SystemException("cannot map connectivity shared state", name);
+    }
+
+    /**
+     * @brief Copies the last published snapshot into result.
+     *
+     * @param [out] result Connectivity state as \link ConnectivitySnapshot \endlink
+     * @param [in] maxRetries Number of attempts if the snapshot is concurrently being published
+     *
+     * @return ConMgrErr_OK on success, ConMgrErr_UnavailableService if the segment has not been
+     * initialized or has an incompatible layout, ConMgrErr_Fail if no coherent copy could be taken.
+     */
+    ConMgrErrno read(ConnectivitySnapshot& result, int maxRetries = 1000) const
+    {
+        if (_pState->magic != CONNMANAGER_SHARED_STATE_MAGIC
+            || _pState->version != CONNMANAGER_SHARED_STATE_VERSION
+            || _pState->size != sizeof(ConnectivitySharedState))
+        {
+            return ConMgrErr_UnavailableService;
+        }
+        for (int i = 0; i < maxRetries; ++i)
+        {
+            unsigned int sequence = _pState->sequence;
+            __sync_synchronize();
+            if (sequence & 1) continue;
+            memcpy(static_cast<void*>(&result), &_pState->snapshot, sizeof(ConnectivitySnapshot));
+            __sync_synchronize();
+            if (_pState->sequence == sequence) return ConMgrErr_OK;
+        }
+        return ConMgrErr_Fail;
+    }
+
+private:
+    ConnectivitySnapshotReader(const ConnectivitySnapshotReader&);
+    ConnectivitySnapshotReader& operator = (const ConnectivitySnapshotReader&);
+
+    Poco::SharedMemory _shm;
+    const ConnectivitySharedState* _pState;
+};
+
+}
+}
+
+#endif // ICONNMANAGERSERVICESHAREDSTATE_H
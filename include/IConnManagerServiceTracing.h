@@ -0,0 +1,121 @@
+/**
+ * \file
+ *         IConnManagerServiceTracing.h
+ * \brief
+ *         Records the events of the Connection Manager Service with Poco::Tracer
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICETRACING_H
+#define ICONNMANAGERSERVICETRACING_H
+
+#include "IConnManagerService.h"
+#include "Poco/Tracer.h"
+#include "Poco/Delegate.h"
+#include <vector>
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * ConnManagerEventTracer records every delivery of an IConnManagerService event as an
+ * instant event in category "connmanager", named after the event (e.g. "onLteMetrics"),
+ * while tracing is enabled (see Poco::Tracer and Poco::OSP::TracingService).
+ *
+ *     ConnManagerEventTracer tracer(pService);
+ *
+ * Events delivered synchronously are recorded in the thread firing the event, within
+ * its notify span; coalesced and isolated events in the thread delivering them.
+ *
+ * The tracer subscribes to all events of the service, so it should only be created
+ * when the trace is wanted. The service must outlive the tracer.
+ */
+class ConnManagerEventTracer
+{
+public:
+    explicit ConnManagerEventTracer(IConnManagerService::Ptr pService):
+        _pService(pService)
+    {
+        trace(_pService->onCellularNetworkTypeChanged, "onCellularNetworkTypeChanged");
+        trace(_pService->onApnConStateChanged, "onApnConStateChanged");
+        trace(_pService->onApnStatesChanged, "onApnStatesChanged");
+        trace(_pService->onCellularMCCChanged, "onCellularMCCChanged");
+        trace(_pService->onWifiDataConStateChanged, "onWifiDataConStateChanged");
+        trace(_pService->onCellularSignalStrengthChanged, "onCellularSignalStrengthChanged");
+        trace(_pService->onCellularModemAvailabilityChanged, "onCellularModemAvailabilityChanged");
+        trace(_pService->onGsmMetrics, "onGsmMetrics");
+        trace(_pService->onUmtsMetrics, "onUmtsMetrics");
+        trace(_pService->onLteMetrics, "onLteMetrics");
+        trace(_pService->onCellularNbCellsChanged, "onCellularNbCellsChanged");
+        trace(_pService->onRegistrationStatusChanged, "onRegistrationStatusChanged");
+        trace(_pService->onCellularTime, "onCellularTime");
+        trace(_pService->onDataPathTypeChanged, "onDataPathTypeChanged");
+        trace(_pService->onDataPathChanged, "onDataPathChanged");
+    }
+
+    ~ConnManagerEventTracer()
+    {
+        for (std::vector<Subscription*>::iterator it = _subscriptions.begin(); it != _subscriptions.end(); ++it)
+        {
+            delete *it;
+        }
+    }
+
+private:
+    ConnManagerEventTracer(const ConnManagerEventTracer&);
+    ConnManagerEventTracer& operator=(const ConnManagerEventTracer&);
+
+    class Subscription
+    {
+    public:
+        virtual ~Subscription() {}
+    };
+
+    template <class TEvent, class TArgs>
+    class EventSubscription : public Subscription
+    {
+    public:
+        EventSubscription(TEvent& event, const char* name):
+            _event(event), _name(name)
+        {
+            _event += Poco::delegate(this, &EventSubscription::onEvent);
+        }
+
+        ~EventSubscription()
+        {
+            _event -= Poco::delegate(this, &EventSubscription::onEvent);
+        }
+
+    private:
+        void onEvent(const void*, TArgs&)
+        {
+            Poco::Tracer::instant("connmanager", _name);
+        }
+
+        TEvent& _event;
+        const char* _name;
+    };
+
+    template <template <class, class> class TEvent, class TArgs, class TMutex>
+    void trace(TEvent<TArgs, TMutex>& event, const char* name)
+    {
+        _subscriptions.push_back(new EventSubscription<TEvent<TArgs, TMutex>, TArgs>(event, name));
+    }
+
+    IConnManagerService::Ptr _pService;
+    std::vector<Subscription*> _subscriptions;
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+#endif // ICONNMANAGERSERVICETRACING_H
@@ -0,0 +1,52 @@
+/**
+ * \file
+ *         IConnManagerServiceTracker.h
+ * \brief
+ *         Tracks the registration of the Connection Manager Service in OSP
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICETRACKER_H
+#define ICONNMANAGERSERVICETRACKER_H
+
+#include "IConnManagerService.h"
+#include "Poco/OSP/ServiceTracker.h"
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * ConnManagerServiceTracker keeps the current IConnManagerService instance registered
+ * under \link CONNMANAGER_SERVICE_NAME \endlink, so that bundles do not have to look the
+ * service up in the registry before every use.
+ *
+ *     ConnManagerServiceTracker tracker(context()->registry());
+ *     IConnManagerService::Ptr pService = tracker.instance();
+ *     if (pService)
+ *         pService->getDataPathType(dataPath);
+ *
+ * instance() returns a NULL pointer while the service is not registered. Subscribe to
+ * serviceAdded and serviceRemoved to be notified when the service comes and goes.
+ */
+class ConnManagerServiceTracker : public Poco::OSP::ServiceTracker<IConnManagerService>
+{
+public:
+    explicit ConnManagerServiceTracker(Poco::OSP::ServiceRegistry& registry):
+        Poco::OSP::ServiceTracker<IConnManagerService>(registry, CONNMANAGER_SERVICE_NAME)
+    {
+    }
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+#endif // ICONNMANAGERSERVICETRACKER_H
@@ -0,0 +1,513 @@
+/**
+ * \file
+ *         IConnManagerServiceTransfer.h
+ * \brief
+ *         Scheduling of bulk network transfers around the IConnManagerService data path
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef ICONNMANAGERSERVICETRANSFER_H
+#define ICONNMANAGERSERVICETRANSFER_H
+
+#include "IConnManagerService.h"
+#include "Poco/Net/HTTPSessionPool.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Exception.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/Condition.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Delegate.h"
+#include "Poco/Mutex.h"
+#include "Poco/Types.h"
+#include <algorithm>
+#include <list>
+#include <vector>
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * TransferJob is a network transfer queued in a \link TransferScheduler \endlink, e.g. an upload
+ * of a bundle. Subclasses implement run() with a session from the pool of the scheduler.
+ *
+ * The priority orders the jobs (higher first, in submission order for equal priorities), the size
+ * in bytes is used for the rate limits, and bulk jobs wait for Wi-Fi (see \link ConMgrTransferLimits \endlink).
+ * Jobs for ApnName_Telematic run while the telematic APN is connected, other jobs while the data path
+ * is wifi, or cellular with the public APN connected.
+ */
+class TransferJob : public Poco::RefCountedObject
+{
+public:
+    typedef Poco::AutoPtr<TransferJob> Ptr;
+
+    TransferJob(int priority, Poco::UInt64 size, bool bulk = false, ConApnName apn = ApnName_Public):
+        _priority(priority), _size(size), _bulk(bulk), _apn(apn), _attempts(0)
+    {
+    }
+
+    /**
+     * @brief Performs the transfer, using a session acquired from pool.
+     *
+     * Runs in a thread of the thread pool of the scheduler. Returns true if the transfer is done,
+     * or false to have it retried later; exceptions count as false.
+     */
+    virtual bool run(Poco::Net::HTTPSessionPool& pool) = 0;
+
+    /**
+     * @brief Called when the transfer failed for the last allowed time, or the job was cancelled
+     * by the destruction of the scheduler. Does nothing by default.
+     */
+    virtual void failed()
+    {
+    }
+
+    int priority() const
+    {
+        return _priority;
+    }
+
+    Poco::UInt64 size() const
+    {
+        return _size;
+    }
+
+    bool isBulk() const
+    {
+        return _bulk;
+    }
+
+    ConApnName apn() const
+    {
+        return _apn;
+    }
+
+    /**
+     * @brief Returns the number of times run() has been called.
+     */
+    int attempts() const
+    {
+        return _attempts;
+    }
+
+protected:
+    ~TransferJob()
+    {
+    }
+
+private:
+    TransferJob(const TransferJob&);
+    TransferJob& operator=(const TransferJob&);
+
+    int _priority;
+    Poco::UInt64 _size;
+    bool _bulk;
+    ConApnName _apn;
+    int _attempts;
+    Poco::Timestamp _submitted;
+    Poco::Timestamp _notBefore;
+
+    friend class TransferScheduler;
+};
+
+/**
+ * @brief Limits of the transfers released by TransferScheduler:
+ * - maxBatchJobs (Maximum number of jobs released together, and running at the same time)
+ * - maxBatchBytes (Jobs are added to a batch until their sizes reach this, a batch has at least one job)
+ * - cellularBytesPerSecond (Average rate of the batches over cellular, 0 for no limit)
+ * - wifiBytesPerSecond (Average rate of the batches over wifi, 0 for no limit)
+ * - settleDelay (Delay in milliseconds after a data path becomes available before the first batch)
+ * - bulkWifiWait (Time in milliseconds a bulk job waits for wifi before it may use cellular, negative for forever)
+ * - maxAttempts (Number of times a job is run before it is given up)
+ * - retryDelay (Delay in milliseconds before a failed job is retried, doubled with every attempt)
+ */
+struct ConMgrTransferLimits
+{
+    std::size_t maxBatchJobs;
+    Poco::UInt64 maxBatchBytes;
+    Poco::UInt64 cellularBytesPerSecond;
+    Poco::UInt64 wifiBytesPerSecond;
+    long settleDelay;
+    long bulkWifiWait;
+    int maxAttempts;
+    long retryDelay;
+
+    ConMgrTransferLimits():
+        maxBatchJobs(4),
+        maxBatchBytes(1024*1024),
+        cellularBytesPerSecond(64*1024),
+        wifiBytesPerSecond(0),
+        settleDelay(3000),
+        bulkWifiWait(-1),
+        maxAttempts(5),
+        retryDelay(10000)
+    {
+    }
+};
+
+/**
+ * TransferScheduler queues the network transfers of all bundles and releases them in batches
+ * while a data path is available, instead of every bundle retrying on its own whenever
+ * onDataPathChanged reports "cellular" or "wifi", which saturates the modem right after a reconnect.
+ *
+ * The state of the data path and of the APNs is taken from onDataPathTypeChanged and
+ * onApnStatesChanged, and the first batch is released settleDelay after the data path became
+ * available. The jobs of a batch run concurrently in the thread pool; the next batch is released
+ * once all of them are done, and no earlier than the configured rate of the data path allows for the
+ * bytes transferred. Failed jobs are retried with an exponential backoff.
+ *
+ *     Poco::Net::HTTPSessionPool pool;
+ *     binder.add(pool);   // DataPathSocketBinder
+ *     TransferScheduler scheduler(pService, pool);
+ *     scheduler.start();
+ *     scheduler.submit(new LogUploadJob(priority, size));
+ *
+ * The service, the pool and the thread pool must outlive the scheduler.
+ */
+class TransferScheduler : public Poco::Runnable
+{
+public:
+    TransferScheduler(IConnManagerService::Ptr pService, Poco::Net::HTTPSessionPool& pool, const ConMgrTransferLimits& limits = ConMgrTransferLimits(), Poco::ThreadPool& threadPool = Poco::ThreadPool::defaultPool()):
+        _pService(pService),
+        _pool(pool),
+        _limits(limits),
+        _threadPool(threadPool),
+        _dataPath(ConMgrDataPath_NoData),
+        _apnMask(0),
+        _running(0),
+        _stopped(true)
+    {
+        if (_limits.maxBatchJobs == 0) _limits.maxBatchJobs = 1;
+        _pService->getDataPathType(_dataPath);
+        uint32_t mask = 0;
+        if (_pService->getApnConStates(mask) == ConMgrErr_OK) _apnMask = mask;
+        _pService->onDataPathTypeChanged += Poco::delegate(this, &TransferScheduler::onDataPathTypeChanged);
+        _pService->onApnStatesChanged += Poco::delegate(this, &TransferScheduler::onApnStatesChanged);
+    }
+
+    /**
+     * @brief Stops the scheduler, and calls failed() for the jobs that are still queued.
+     */
+    ~TransferScheduler()
+    {
+        _pService->onApnStatesChanged -= Poco::delegate(this, &TransferScheduler::onApnStatesChanged);
+        _pService->onDataPathTypeChanged -= Poco::delegate(this, &TransferScheduler::onDataPathTypeChanged);
+        stop();
+        for (JobList::iterator it = _queue.begin(); it != _queue.end(); ++it)
+        {
+            (*it)->failed();
+        }
+    }
+
+    /**
+     * @brief Starts the thread releasing the jobs.
+     */
+    void start()
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        if (!_stopped) return;
+        _stopped = false;
+        _thread.start(*this);
+    }
+
+    /**
+     * @brief Waits for the running jobs to finish and stops the thread. Queued jobs are kept.
+     */
+    void stop()
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            if (_stopped) return;
+            _stopped = true;
+            _cond.broadcast();
+        }
+        _thread.join();
+    }
+
+    /**
+     * @brief Queues pJob.
+     */
+    void submit(TransferJob::Ptr pJob)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        pJob->_submitted.update();
+        pJob->_notBefore = pJob->_submitted;
+        JobList::iterator it = _queue.begin();
+        while (it != _queue.end() && (*it)->priority() >= pJob->priority()) ++it;
+        _queue.insert(it, pJob);
+        _cond.broadcast();
+    }
+
+    /**
+     * @brief Removes pJob from the queue. Returns false if it is not queued, e.g. because it is running.
+     */
+    bool cancel(TransferJob::Ptr pJob)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        JobList::iterator it = std::find(_queue.begin(), _queue.end(), pJob);
+        if (it == _queue.end()) return false;
+        _queue.erase(it);
+        return true;
+    }
+
+    /**
+     * @brief Returns the number of queued jobs, not counting the running ones.
+     */
+    std::size_t pending() const
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        return _queue.size();
+    }
+
+    void run()
+    {
+        Batch batch;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        while (!_stopped)
+        {
+            Poco::Timestamp now;
+            long wait = select(now, batch);
+            if (batch.empty())
+            {
+                _cond.tryWait(_mutex, wait);
+                continue;
+            }
+            ConMgrDataPath dataPath = _dataPath;
+            Poco::UInt64 bytes = 0;
+            {
+                Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+                bytes = runBatch(batch);
+            }
+            requeue(batch);
+            batch.clear();
+            Poco::UInt64 rate = dataPath == ConMgrDataPath_WiFi ? _limits.wifiBytesPerSecond : _limits.cellularBytesPerSecond;
+            if (rate > 0)
+            {
+                Poco::Timestamp until = now + static_cast<Poco::Timestamp::TimeDiff>(bytes*1000000/rate);
+                Poco::Timestamp current;
+                while (!_stopped && current < until)
+                {
+                    _cond.tryWait(_mutex, static_cast<long>((until - current)/1000) + 1);
+                    current.update();
+                }
+            }
+        }
+    }
+
+private:
+    TransferScheduler(const TransferScheduler&);
+    TransferScheduler& operator=(const TransferScheduler&);
+
+    typedef std::list<TransferJob::Ptr> JobList;
+
+    enum
+    {
+        MAX_WAIT = 60000 /**< milliseconds the thread sleeps at most without a notification */
+    };
+
+    /**
+     * @brief Runs a job of a batch in the thread pool.
+     */
+    class Task : public Poco::Runnable
+    {
+    public:
+        Task(TransferScheduler& scheduler, TransferJob::Ptr pJob): _scheduler(scheduler), _pJob(pJob), _done(false) {}
+
+        void run()
+        {
+            bool done = false;
+            try
+            {
+                done = _pJob->run(_scheduler._pool);
+            }
+            catch (...)
+            {
+            }
+            Poco::FastMutex::ScopedLock lock(_scheduler._mutex);
+            _done = done;
+            --_scheduler._running;
+            _scheduler._cond.broadcast();
+        }
+
+        TransferScheduler& _scheduler;
+        TransferJob::Ptr _pJob;
+        bool _done;
+    };
+
+    typedef std::vector<Poco::SharedPtr<Task> > Batch;
+
+    /**
+     * @brief Returns true if the data path for jobs of apn is available, and sets since to the time it became available.
+     * Must be called with the mutex held.
+     */
+    bool isAvailable(ConApnName apn, Poco::Timestamp& since) const
+    {
+        bool available;
+        if (apn == ApnName_Public)
+            available = _dataPath == ConMgrDataPath_WiFi || (_dataPath == ConMgrDataPath_Cellular && (_apnMask & ConMgrApnBit(apn)));
+        else
+            available = (_apnMask & ConMgrApnBit(apn)) != 0;
+        since = _availableSince[apn];
+        return available;
+    }
+
+    /**
+     * @brief Moves the jobs to release now from the queue to batch, and returns the time in milliseconds
+     * until a job may become ready. Must be called with the mutex held.
+     */
+    long select(const Poco::Timestamp& now, Batch& batch)
+    {
+        Poco::Timestamp::TimeDiff wait = static_cast<Poco::Timestamp::TimeDiff>(MAX_WAIT)*1000;
+        Poco::UInt64 bytes = 0;
+        JobList::iterator it = _queue.begin();
+        while (it != _queue.end() && batch.size() < _limits.maxBatchJobs && (batch.empty() || bytes < _limits.maxBatchBytes))
+        {
+            TransferJob& job = **it;
+            Poco::Timestamp since;
+            Poco::Timestamp readyAt = job._notBefore;
+            bool ready = isAvailable(job.apn(), since);
+            if (ready)
+            {
+                Poco::Timestamp settled = since + static_cast<Poco::Timestamp::TimeDiff>(_limits.settleDelay)*1000;
+                if (settled > readyAt) readyAt = settled;
+                if (job.isBulk() && job.apn() == ApnName_Public && _dataPath != ConMgrDataPath_WiFi)
+                {
+                    if (_limits.bulkWifiWait < 0)
+                        ready = false;
+                    else
+                    {
+                        Poco::Timestamp given = job._submitted + static_cast<Poco::Timestamp::TimeDiff>(_limits.bulkWifiWait)*1000;
+                        if (given > readyAt) readyAt = given;
+                    }
+                }
+            }
+            if (ready && readyAt > now)
+            {
+                ready = false;
+                if (readyAt - now < wait) wait = readyAt - now;
+            }
+            if (ready)
+            {
+                bytes += job.size();
+                ++job._attempts;
+                batch.push_back(new Task(*this, *it));
+                it = _queue.erase(it);
+            }
+            else ++it;
+        }
+        return static_cast<long>(wait/1000) + 1;
+    }
+
+    /**
+     * @brief Runs the jobs of batch and waits for them, returning the number of bytes transferred.
+     */
+    Poco::UInt64 runBatch(Batch& batch)
+    {
+        Poco::UInt64 bytes = 0;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        for (Batch::iterator it = batch.begin(); it != batch.end(); ++it)
+        {
+            bytes += (*it)->_pJob->size();
+            ++_running;
+            try
+            {
+                Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+                _threadPool.start(**it);
+            }
+            catch (Poco::NoThreadAvailableException&)
+            {
+                Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+                (*it)->run();
+            }
+        }
+        while (_running > 0) _cond.wait(_mutex);
+        return bytes;
+    }
+
+    /**
+     * @brief Queues the failed jobs of batch again, or gives them up. Must be called with the mutex held.
+     */
+    void requeue(Batch& batch)
+    {
+        Poco::Timestamp now;
+        for (Batch::iterator it = batch.begin(); it != batch.end(); ++it)
+        {
+            if ((*it)->_done) continue;
+            TransferJob::Ptr pJob = (*it)->_pJob;
+            if (pJob->attempts() >= _limits.maxAttempts)
+            {
+                Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+                pJob->failed();
+                continue;
+            }
+            int shift = pJob->attempts() - 1 < 16 ? pJob->attempts() - 1 : 16;
+            pJob->_notBefore = now + static_cast<Poco::Timestamp::TimeDiff>(_limits.retryDelay)*1000*(1 << shift);
+            JobList::iterator pos = _queue.begin();
+            while (pos != _queue.end() && (*pos)->priority() >= pJob->priority()) ++pos;
+            _queue.insert(pos, pJob);
+        }
+    }
+
+    /**
+     * @brief Updates the times the data paths became available. Must be called with the mutex held.
+     */
+    void updateAvailability(ConMgrDataPath dataPath, uint32_t apnMask)
+    {
+        Poco::Timestamp since[MAX_APN_COUNT];
+        bool was[MAX_APN_COUNT];
+        for (int i = 0; i < MAX_APN_COUNT; ++i) was[i] = isAvailable(static_cast<ConApnName>(i), since[i]);
+        _dataPath = dataPath;
+        _apnMask = apnMask;
+        Poco::Timestamp now;
+        for (int i = 0; i < MAX_APN_COUNT; ++i)
+        {
+            if (!was[i] && isAvailable(static_cast<ConApnName>(i), since[i])) _availableSince[i] = now;
+        }
+        _cond.broadcast();
+    }
+
+    void onDataPathTypeChanged(const void*, const ConMgrDataPath& dataPath)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        // moving between cellular and wifi also settles the new path
+        if (dataPath != _dataPath && _dataPath != ConMgrDataPath_NoData) updateAvailability(ConMgrDataPath_NoData, _apnMask);
+        updateAvailability(dataPath, _apnMask);
+    }
+
+    void onApnStatesChanged(const void*, const ApnConStates& states)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        updateAvailability(_dataPath, states.available);
+    }
+
+    IConnManagerService::Ptr _pService;
+    Poco::Net::HTTPSessionPool& _pool;
+    ConMgrTransferLimits _limits;
+    Poco::ThreadPool& _threadPool;
+    ConMgrDataPath _dataPath;
+    uint32_t _apnMask;
+    Poco::Timestamp _availableSince[MAX_APN_COUNT];
+    JobList _queue;
+    int _running;
+    bool _stopped;
+    Poco::Thread _thread;
+    Poco::Condition _cond;
+    mutable Poco::FastMutex _mutex;
+};
+
+} // namespace Connectivity
+} // namespace Stla
+
+#endif // ICONNMANAGERSERVICETRANSFER_H
@@ -22,10 +22,30 @@
 #include <stdio.h>
 #include <assert.h>
 #include <time.h>
+#include <stdint.h>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
 
 #define MAX_NETWORK_NAME_LEN 30 /*Maximum length of the network_name, including the NULL*/
 #define MAX_CID_LEN 16          /*Maximum length of the CID field, including the NULL*/
 #define MAX_LAC_LEN 5           /*Maximum length of the LAC field, including the NULL*/
+#define MAX_APN_COUNT 2         /*Number of apn interfaces defined in ConApnName*/
+
+/*
+ * The structures below are trivially copyable. Except for APNConnState, they have no
+ * implicit padding: holes are filled with explicit, zero-initialized reserved members.
+ * They can therefore be copied and serialized with memcpy between peers sharing the
+ * same ABI. CONMGR_ASSERT_LAYOUT guards their sizes against accidental changes.
+ */
+#if __cplusplus >= 201103L && (defined(__clang__) || !defined(__GNUC__) || __GNUC__ >= 5)
+#define CONMGR_ASSERT_LAYOUT(type, size) \
+    static_assert(sizeof(type) == (size) && std::is_trivially_copyable<type>::value, #type " layout changed")
+#elif __cplusplus >= 201103L
+#define CONMGR_ASSERT_LAYOUT(type, size) static_assert(sizeof(type) == (size), #type " layout changed")
+#else
+#define CONMGR_ASSERT_LAYOUT(type, size) typedef char type##_layout_changed[(sizeof(type) == (size)) ? 1 : -1]
+#endif
 
 using namespace std;
 
@@ -53,6 +73,8 @@ enum ConApnName
  *   Values can be
  *   - true Connected
  *   - false Not connected
+ *
+ * Kept an aggregate for brace initialization, so its 3 trailing bytes are implicit padding.
  */
 #ifdef DOXYGEN_WORKING
 struct APNConnectionState_s
@@ -68,6 +90,35 @@ struct __attribute__((visibility("default"))) APNConnectionState_s
  * @brief APNConnState defines the type for the APN Connection State
  */
 typedef APNConnectionState_s APNConnState;
+CONMGR_ASSERT_LAYOUT(APNConnState, 8);
+
+/**
+ * @brief Returns the bit of interface in an APN state mask, as used by ApnConStates
+ */
+inline uint32_t ConMgrApnBit(ConApnName interface)
+{
+    return static_cast<uint32_t>(1) << interface;
+}
+
+/**
+ * @brief Structure contains the state of all APN interfaces, as bit masks indexed by \link ConApnName \endlink:
+ * - available (Bit set if the interface is connected)
+ * - changed (Bit set if the state of the interface changed in this transition)
+ */
+#ifdef DOXYGEN_WORKING
+struct ApnConStates
+#else
+struct __attribute__((visibility("default"))) ApnConStates
+#endif
+{
+    uint32_t available;
+    uint32_t changed;
+    ApnConStates(): available(0), changed(0) {}
+    bool isAvailable(ConApnName interface) const { return (available & ConMgrApnBit(interface)) != 0; }
+    bool hasChanged(ConApnName interface) const { return (changed & ConMgrApnBit(interface)) != 0; }
+};
+CONMGR_ASSERT_LAYOUT(ApnConStates, 8);
+
 /**
  * \brief The ConMgrErrno defines different Error types.
  */
@@ -80,6 +131,19 @@ enum ConMgrErrno
     ConMgrErr_UnavailableService,  /**< Service is unavailablee */
     ConMgrErr_Last                 /**< Guard, add errors before this line */
 };
+
+/**
+ * @brief Result of an asynchronous getter of IConnManagerService:
+ * - error (Error number described in \link ConMgrErrno \endlink)
+ * - value (Value returned by the getter, valid if error is ConMgrErr_OK)
+ */
+template <class T>
+struct ConMgrResult
+{
+    ConMgrErrno error;
+    T value;
+    ConMgrResult(): error(ConMgrErr_Fail), value() {}
+};
 /**
  * \brief The ConMgrNetworkType defines different type of network.
  */
@@ -94,6 +158,111 @@ enum ConMgrNetworkType
     ConMgrNtwType_CDMA_EVDO      /**< CDMA_EVDO NADIF network type is 2G/CDMA EVDO */
 };
 
+/**
+ * \brief The ConMgrSignalRange defines the signal strength ranges used by onCellularSignalStrengthChanged.
+ */
+//@serialize
+enum ConMgrSignalRange
+{
+    ConMgrSignalRange_Lost = 0,     /**< No signal */
+    ConMgrSignalRange_Poor,         /**< Poor signal */
+    ConMgrSignalRange_Fair,         /**< Fair signal */
+    ConMgrSignalRange_Good,         /**< Good signal */
+    ConMgrSignalRange_Excellent,    /**< Excellent signal */
+    ConMgrSignalRange_Unknown       /**< Signal strength not available (255) */
+};
+
+/**
+ * @brief Lower bounds of the signal strength ranges of a network type:
+ * - excellent (Lowest signal strength in the Excellent range)
+ * - good (Lowest signal strength in the Good range)
+ * - fair (Lowest signal strength in the Fair range, values from 1 below are Poor)
+ * - reserved (Explicit padding, always zero)
+ */
+struct ConMgrSignalThresholds
+{
+    unsigned char excellent;
+    unsigned char good;
+    unsigned char fair;
+    unsigned char reserved;
+    ConMgrSignalThresholds(): excellent(64), good(40), fair(18), reserved(0){}
+    ConMgrSignalThresholds(unsigned char e, unsigned char g, unsigned char f): excellent(e), good(g), fair(f), reserved(0){}
+};
+CONMGR_ASSERT_LAYOUT(ConMgrSignalThresholds, 4);
+
+/**
+ * \brief Returns the default signal strength ranges of a network type.
+ *
+ * <table>
+ * <tr><th>Range    <th>GSM   <th>WCDMA      <th>LTE-4G
+ * <tr><td>Excellent <td>>= 64 <td>>=42 <td>>=34
+ * <tr><td>Good <td>40 to 63 <td>30 to 41 <td>26 to 33
+ * <tr><td>Fair <td>18 to 39 <td>18 to 29 <td>9 to 25
+ * <tr><td>Poor <td><= 17 <td><= 17 <td><= 8
+ * <tr><td>Lost <td>0 <td>0 <td>0
+ * </table>
+ *
+ * Network types not listed use the GSM ranges.
+ */
+inline ConMgrSignalThresholds ConMgrDefaultSignalThresholds(ConMgrNetworkType networkType)
+{
+    if (networkType == ConMgrNtwType_WCDMA) return ConMgrSignalThresholds(42, 30, 18);
+    if (networkType == ConMgrNtwType_LTE) return ConMgrSignalThresholds(34, 26, 9);
+    return ConMgrSignalThresholds(64, 40, 18);
+}
+
+/**
+ * \brief Returns the range of a cellular signal strength for the given thresholds.
+ */
+inline ConMgrSignalRange ConMgrSignalRangeOf(const ConMgrSignalThresholds& thresholds, unsigned char signalStrength)
+{
+    if (signalStrength == 0xFF) return ConMgrSignalRange_Unknown;
+    if (signalStrength == 0) return ConMgrSignalRange_Lost;
+    if (signalStrength >= thresholds.excellent) return ConMgrSignalRange_Excellent;
+    if (signalStrength >= thresholds.good) return ConMgrSignalRange_Good;
+    if (signalStrength >= thresholds.fair) return ConMgrSignalRange_Fair;
+    return ConMgrSignalRange_Poor;
+}
+
+/**
+ * \brief Returns the range of a cellular signal strength for a network type,
+ * using the default ranges (see \link ConMgrDefaultSignalThresholds \endlink).
+ *
+ * Ranges tuned at run time are available from ConnManagerConfig (IConnManagerServiceConfig.h).
+ */
+inline ConMgrSignalRange ConMgrSignalRangeOf(ConMgrNetworkType networkType, unsigned char signalStrength)
+{
+    return ConMgrSignalRangeOf(ConMgrDefaultSignalThresholds(networkType), signalStrength);
+}
+
+/**
+ * \brief The ConMgrDataPath defines the path used for data traffic.
+ */
+//@serialize
+enum ConMgrDataPath
+{
+    ConMgrDataPath_NoData = 0,   /**< "no data"  No data path available */
+    ConMgrDataPath_Cellular,     /**< "cellular" Data is routed over the cellular network */
+    ConMgrDataPath_WiFi          /**< "wifi"     Data is routed over wifi */
+};
+
+/**
+ * \brief Returns the legacy string representation of a ConMgrDataPath
+ * as used by IConnManagerService::getDataPath(std::string&).
+ */
+inline const char* ConMgrDataPathName(ConMgrDataPath dataPath)
+{
+    switch (dataPath)
+    {
+    case ConMgrDataPath_Cellular:
+        return "cellular";
+    case ConMgrDataPath_WiFi:
+        return "wifi";
+    default:
+        return "no data";
+    }
+}
+
 /**
  * \brief The ConMgrRegistrationStatus defines Registration Status.
  */
@@ -120,22 +289,26 @@ struct GsmMetrics
     unsigned char bler;
     GsmMetrics(): raw_rssi(0xFF),  bler(99){}
 };
+CONMGR_ASSERT_LAYOUT(GsmMetrics, 2);
 
 /**
  * @brief Structure contains information about Umts metrics:
- * - raw_rssi (The Received Signal Strength Indicator)
  * - rscp (The measured Received Signal Code Power)
  * - ecio (This is the measure of the quality/cleanliness of the signal from the tower to the modem and indicates the signal-to noise ratio.)
  * - bler (The Block Error Rate)
+ * - raw_rssi (The Received Signal Strength Indicator)
+ * - reserved (Explicit padding, always zero)
  */
 struct UmtsMetrics
 {
-    signed char raw_rssi;
     short int rscp;
     short int ecio;
     unsigned short int bler;
-    UmtsMetrics(): raw_rssi(0xFF), rscp(0), ecio(0x7FFF), bler(0xFFFF){}
+    signed char raw_rssi;
+    unsigned char reserved;
+    UmtsMetrics(): rscp(0), ecio(0x7FFF), bler(0xFFFF), raw_rssi(0xFF), reserved(0){}
 };
+CONMGR_ASSERT_LAYOUT(UmtsMetrics, 8);
 
 /**
  * @brief Structure contains information about Lte metrics:
@@ -152,6 +325,7 @@ struct LteMetrics
     short int snr;
     LteMetrics(): raw_rssi(0xFF), rsrq(0x7F), rsrp(0), snr(0x7FFF){}
 };
+CONMGR_ASSERT_LAYOUT(LteMetrics, 6);
 
 /**
  * @brief Structure contains information about number of Cellular neighboring cells:
@@ -166,58 +340,131 @@ struct CellularNbCells
     unsigned char num_lte_cells;
     CellularNbCells(): num_gsm_cells(0), num_wcdma_cells(0), num_lte_cells(0){}
 };
+CONMGR_ASSERT_LAYOUT(CellularNbCells, 3);
 
 /**
  * @brief Structure contains information about Registration status:
- * - mnc (Mobile Network Code)
- * - mcc (Mobile Country Code)
  * - network_type (Network type (GSM, UMTS, LTE, ...))
- * - network_name (Network name)
  * - cs_reg_status (Registration to the cellular circuit switch)
  * - ps_reg_status (Registration to the cellular packet switch)
- * - cid (Cell Identifier)
+ * - mnc (Mobile Network Code)
+ * - mcc (Mobile Country Code)
  * - tac (Tracking area code)
+ * - network_name (Network name)
+ * - cid (Cell Identifier)
  * - lac (Local area code)
+ * - reserved (Explicit padding, always zero)
+ *
+ * The character fields default to blanks terminated by a NULL.
  */
 struct RegistrationStatus
 {
-    unsigned short int mnc;
-    unsigned short int mcc;
     ConMgrNetworkType network_type;
-    char network_name[MAX_NETWORK_NAME_LEN];
     ConMgrRegistrationStatus cs_reg_status;
     ConMgrRegistrationStatus ps_reg_status;
-    char cid[MAX_CID_LEN];
+    unsigned short int mnc;
+    unsigned short int mcc;
     unsigned short int tac;
+    char network_name[MAX_NETWORK_NAME_LEN];
+    char cid[MAX_CID_LEN];
     char lac[MAX_LAC_LEN];
-    RegistrationStatus(): mnc(0xFFFF), mcc(0xFFFF), network_type(ConMgrNtwType_Unknown), cs_reg_status(NADIF_REG_STAT_UNKNOWN), ps_reg_status(NADIF_REG_STAT_UNKNOWN), tac(0xFFFF)
+    unsigned char reserved[3];
+    RegistrationStatus(): network_type(ConMgrNtwType_Unknown), cs_reg_status(NADIF_REG_STAT_UNKNOWN), ps_reg_status(NADIF_REG_STAT_UNKNOWN), mnc(0xFFFF), mcc(0xFFFF), tac(0xFFFF)
     {
-        static char const default_network_name[] = "                             ";
-        static char const default_cid[] = "               ";
-        static char const default_lac[] = "    ";
-        assert( strlen( default_network_name ) < MAX_NETWORK_NAME_LEN );
-        assert( strlen( default_cid ) < MAX_CID_LEN );
-        assert( strlen( default_lac ) < MAX_LAC_LEN );
-        strcpy( network_name, default_network_name );
-        strcpy( cid, default_cid );
-        strcpy( lac, default_lac );
+        memset( network_name, ' ', MAX_NETWORK_NAME_LEN - 1 );
+        network_name[MAX_NETWORK_NAME_LEN - 1] = '\0';
+        memset( cid, ' ', MAX_CID_LEN - 1 );
+        cid[MAX_CID_LEN - 1] = '\0';
+        memset( lac, ' ', MAX_LAC_LEN - 1 );
+        lac[MAX_LAC_LEN - 1] = '\0';
+        memset( reserved, 0, sizeof(reserved) );
     }
 };
+CONMGR_ASSERT_LAYOUT(RegistrationStatus, 72);
 
 /**
  * @brief Structure contains information about Date time:
  * - local_time (Universal time)
+ * - offset (difference between system_time and local_time)
  * - timezone (Local time zone)
  * - daylt_sav (Daylight saving time)
- * - offset (difference between system_time and local_time)
+ * - reserved (Explicit padding, always zero)
  */
 struct DateTime
 {
     time_t local_time;
+    int offset;
     unsigned char timezone;
     unsigned char daylt_sav;
-    int offset;
-    DateTime(): local_time(0), timezone(0), daylt_sav(0xFF), offset(0) {}
+    unsigned char reserved[2];
+    DateTime(): local_time(0), offset(0), timezone(0), daylt_sav(0xFF)
+    {
+        memset( reserved, 0, sizeof(reserved) );
+    }
+};
+CONMGR_ASSERT_LAYOUT(DateTime, sizeof(time_t) + 8);
+
+/**
+ * @brief Structure contains a cellular signal strength with the network type it was measured on:
+ * - network_type (Cellular network type)
+ * - signal_strength (Cellular signal strength, 255 as error value)
+ * - reserved (Explicit padding, always zero)
+ */
+struct CellularSignal
+{
+    ConMgrNetworkType network_type;
+    unsigned char signal_strength;
+    unsigned char reserved[3];
+    CellularSignal(): network_type(ConMgrNtwType_Unknown), signal_strength(0xFF)
+    {
+        memset( reserved, 0, sizeof(reserved) );
+    }
+};
+CONMGR_ASSERT_LAYOUT(CellularSignal, 8);
+
+/**
+ * @brief Structure contains a coherent copy of all connectivity state:
+ * - sequence (Incremented with every update of the snapshot)
+ * - network_type (Cellular network type)
+ * - apn_state (Connection state per apn interface, indexed by ConApnName)
+ * - mcc (Cellular mobile country code)
+ * - wifi_data_con_state (Wifi data connection state)
+ * - signal_strength (Cellular signal strength, 255 as error value)
+ * - modem_available (Cellular modem availability)
+ * - gsm (Gsm metrics)
+ * - umts (Umts metrics)
+ * - lte (Lte metrics)
+ * - nb_cells (Cellular neighboring cells)
+ * - registration (Registration status)
+ * - cellular_time (Cellular time)
+ * - data_path (Current data path)
+ *
+ * The structure is trivially copyable and does not allocate.
+ */
+struct ConnectivitySnapshot
+{
+    unsigned int sequence;
+    ConMgrNetworkType network_type;
+    APNConnState apn_state[MAX_APN_COUNT];
+    int mcc;
+    bool wifi_data_con_state;
+    unsigned char signal_strength;
+    bool modem_available;
+    GsmMetrics gsm;
+    UmtsMetrics umts;
+    LteMetrics lte;
+    CellularNbCells nb_cells;
+    RegistrationStatus registration;
+    DateTime cellular_time;
+    ConMgrDataPath data_path;
+    ConnectivitySnapshot(): sequence(0), network_type(ConMgrNtwType_Unknown), mcc(0), wifi_data_con_state(false), signal_strength(0xFF), modem_available(false), data_path(ConMgrDataPath_NoData)
+    {
+        for (int i = 0; i < MAX_APN_COUNT; ++i)
+        {
+            apn_state[i].interface = static_cast<ConApnName>(i);
+            apn_state[i].available = false;
+        }
+    }
 };
 
 }
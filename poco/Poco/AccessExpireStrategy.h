@@ -58,7 +58,7 @@ public:
 		if (it != this->_keys.end())
 		{
 			this->_keyIndex.erase(it->second);
-			Timestamp now;
+			Timestamp now = Timestamp::fast();
 			typename ExpireStrategy<TKey, TValue>::IndexIterator itIdx =
 				this->_keyIndex.insert(typename ExpireStrategy<TKey, TValue>::TimeIndex::value_type(now, key));
 			it->second = itIdx;
@@ -0,0 +1,378 @@
+//
+// Base64.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Streams
+// Module:  Base64
+//
+// Definition of the Base64 class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_Base64_INCLUDED
+#define Foundation_Base64_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Exception.h"
+#include <cstddef>
+#include <cstring>
+#include <string>
+#if defined(__SSE2__) && !defined(POCO_BASE64_NO_SIMD)
+#include <emmintrin.h>
+#define POCO_BASE64_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(POCO_BASE64_NO_SIMD)
+#include <arm_neon.h>
+#define POCO_BASE64_NEON 1
+#endif
+
+
+namespace Poco {
+
+
+class Base64
+	/// This class contains functions for base64-encoding and
+	/// decoding memory buffers, which process 12 bytes (SSE2) or
+	/// 48 bytes (NEON, on AArch64) at a time, and 3 bytes at a
+	/// time otherwise.
+	///
+	/// The encoding is the same as the one of Base64Encoder (with
+	/// a line length of 0), and decode() accepts everything that
+	/// Base64Decoder accepts, so that both can be mixed. Unlike the
+	/// stream classes, which process one character at a time through
+	/// a streambuf, these functions work on whole buffers:
+	///
+	///     std::string encoded = Base64::encode(data.data(), data.size());
+	///     std::string decoded = Base64::decode(encoded);
+{
+public:
+	enum Options
+	{
+		BASE64_URL_ENCODING = 0x01,
+			/// Use the URL and filename safe alphabet of RFC 4648,
+			/// with '-' and '_' instead of '+' and '/'.
+
+		BASE64_NO_PADDING = 0x02
+			/// Do not append '=' characters when encoding, and
+			/// accept input without them when decoding.
+	};
+
+	static std::size_t encodedLength(std::size_t size, int options = 0)
+		/// Returns the number of characters encode() writes for
+		/// size bytes.
+	{
+		if (options & BASE64_NO_PADDING)
+			return (size/3)*4 + (size % 3 ? size % 3 + 1 : 0);
+		else
+			return ((size + 2)/3)*4;
+	}
+
+	static std::size_t maxDecodedLength(std::size_t length)
+		/// Returns the maximum number of bytes decode() writes
+		/// for length characters.
+	{
+		return ((length + 3)/4)*3;
+	}
+
+	static std::size_t encode(const void* data, std::size_t size, char* buffer, int options = 0)
+		/// Encodes size bytes at data into buffer, which must have room for
+		/// encodedLength(size, options) characters. No line feeds are inserted,
+		/// and the buffer is not zero-terminated.
+		///
+		/// Returns the number of characters written.
+	{
+		const unsigned char* in = static_cast<const unsigned char*>(data);
+		const char* chars = alphabet(options);
+		char* out = buffer;
+		std::size_t i = 0;
+#if defined(POCO_BASE64_SSE2)
+		const __m128i mask = _mm_set1_epi32(0x3F);
+		const char off62 = static_cast<char>(chars[62] - 58);
+		const char off63 = static_cast<char>(chars[63] - 59 - off62);
+		for (; i + 16 <= size; i += 12)
+		{
+			__m128i w = _mm_set_epi32(load24(in + i + 9), load24(in + i + 6), load24(in + i + 3), load24(in + i));
+			__m128i idx = _mm_or_si128(
+				_mm_or_si128(_mm_srli_epi32(w, 18), _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(w, 12), mask), 8)),
+				_mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(w, 6), mask), 16), _mm_slli_epi32(_mm_and_si128(w, mask), 24)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), translate(idx, off62, off63));
+			out += 16;
+		}
+#elif defined(POCO_BASE64_NEON)
+		const uint8_t* table = reinterpret_cast<const uint8_t*>(chars);
+		uint8x16x4_t lookup;
+		lookup.val[0] = vld1q_u8(table);
+		lookup.val[1] = vld1q_u8(table + 16);
+		lookup.val[2] = vld1q_u8(table + 32);
+		lookup.val[3] = vld1q_u8(table + 48);
+		for (; i + 48 <= size; i += 48)
+		{
+			uint8x16x3_t x = vld3q_u8(in + i);
+			uint8x16x4_t r;
+			r.val[0] = vqtbl4q_u8(lookup, vshrq_n_u8(x.val[0], 2));
+			r.val[1] = vqtbl4q_u8(lookup, vorrq_u8(vshlq_n_u8(vandq_u8(x.val[0], vdupq_n_u8(0x03)), 4), vshrq_n_u8(x.val[1], 4)));
+			r.val[2] = vqtbl4q_u8(lookup, vorrq_u8(vshlq_n_u8(vandq_u8(x.val[1], vdupq_n_u8(0x0F)), 2), vshrq_n_u8(x.val[2], 6)));
+			r.val[3] = vqtbl4q_u8(lookup, vandq_u8(x.val[2], vdupq_n_u8(0x3F)));
+			vst4q_u8(reinterpret_cast<uint8_t*>(out), r);
+			out += 64;
+		}
+#endif
+		for (; i + 3 <= size; i += 3)
+		{
+			*out++ = chars[in[i] >> 2];
+			*out++ = chars[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+			*out++ = chars[((in[i + 1] & 0x0F) << 2) | (in[i + 2] >> 6)];
+			*out++ = chars[in[i + 2] & 0x3F];
+		}
+		if (i < size)
+		{
+			*out++ = chars[in[i] >> 2];
+			if (i + 1 < size)
+			{
+				*out++ = chars[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+				*out++ = chars[(in[i + 1] & 0x0F) << 2];
+			}
+			else
+			{
+				*out++ = chars[(in[i] & 0x03) << 4];
+				if (!(options & BASE64_NO_PADDING)) *out++ = '=';
+			}
+			if (!(options & BASE64_NO_PADDING)) *out++ = '=';
+		}
+		return static_cast<std::size_t>(out - buffer);
+	}
+
+	static std::string encode(const void* data, std::size_t size, int options = 0)
+		/// Returns the base64 encoding of size bytes at data.
+	{
+		std::string result(encodedLength(size, options), '\0');
+		if (size) encode(data, size, &result[0], options);
+		return result;
+	}
+
+	static std::string encode(const std::string& data, int options = 0)
+		/// Returns the base64 encoding of data.
+	{
+		return encode(data.data(), data.size(), options);
+	}
+
+	static std::size_t decode(const char* encoded, std::size_t length, void* buffer, int options = 0)
+		/// Decodes length characters at encoded into buffer, which must
+		/// have room for maxDecodedLength(length) bytes. Whitespace
+		/// (e.g. line feeds) is ignored.
+		///
+		/// Returns the number of bytes written.
+		///
+		/// Throws a DataFormatException if the input contains invalid
+		/// characters, or is incomplete. Input without padding is only
+		/// accepted with BASE64_NO_PADDING.
+	{
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(encoded);
+		unsigned char* out = static_cast<unsigned char*>(buffer);
+		const unsigned char c62 = (options & BASE64_URL_ENCODING) ? '-' : '+';
+		const unsigned char c63 = (options & BASE64_URL_ENCODING) ? '_' : '/';
+		Poco::UInt32 group = 0;
+		int count = 0;
+		int padding = 0;
+		std::size_t i = 0;
+		while (i < length)
+		{
+#if defined(POCO_BASE64_SSE2)
+			const __m128i v62 = _mm_set1_epi8(static_cast<char>(c62));
+			const __m128i v63 = _mm_set1_epi8(static_cast<char>(c63));
+			for (; i + 16 <= length; i += 16)
+			{
+				__m128i v;
+				if (!values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), v62, v63, v)) break;
+				// combine the four 6 bit values of every 32 bit lane into 24 bits
+				__m128i t = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x00FF)), 6), _mm_srli_epi16(v, 8));
+				__m128i w = _mm_madd_epi16(t, _mm_set1_epi32(0x00011000));
+				Poco::UInt32 lanes[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), w);
+				for (int k = 0; k < 4; ++k)
+				{
+					*out++ = static_cast<unsigned char>(lanes[k] >> 16);
+					*out++ = static_cast<unsigned char>(lanes[k] >> 8);
+					*out++ = static_cast<unsigned char>(lanes[k]);
+				}
+			}
+			const std::size_t end = i + 16;
+#elif defined(POCO_BASE64_NEON)
+			const uint8x16_t v62 = vdupq_n_u8(c62);
+			const uint8x16_t v63 = vdupq_n_u8(c63);
+			for (; i + 64 <= length; i += 64)
+			{
+				uint8x16x4_t x = vld4q_u8(in + i);
+				uint8x16_t v0, v1, v2, v3;
+				if (!values(x.val[0], v62, v63, v0) || !values(x.val[1], v62, v63, v1) ||
+				    !values(x.val[2], v62, v63, v2) || !values(x.val[3], v62, v63, v3)) break;
+				uint8x16x3_t r;
+				r.val[0] = vorrq_u8(vshlq_n_u8(v0, 2), vshrq_n_u8(v1, 4));
+				r.val[1] = vorrq_u8(vshlq_n_u8(v1, 4), vshrq_n_u8(v2, 2));
+				r.val[2] = vorrq_u8(vshlq_n_u8(v2, 6), v3);
+				vst3q_u8(out, r);
+				out += 48;
+			}
+			const std::size_t end = i + 64;
+#else
+			const std::size_t end = length;
+#endif
+			// one character at a time, for whitespace and padding, until
+			// the block rejected above has been passed and a group is complete
+			for (; i < length && (i < end || count != 0); ++i)
+			{
+				unsigned char c = in[i];
+				int v = value(c, c62, c63);
+				if (v >= 0)
+				{
+					if (padding) throw DataFormatException("Invalid Base64 data after padding");
+					group = (group << 6) | static_cast<Poco::UInt32>(v);
+					if (++count == 4)
+					{
+						*out++ = static_cast<unsigned char>(group >> 16);
+						*out++ = static_cast<unsigned char>(group >> 8);
+						*out++ = static_cast<unsigned char>(group);
+						group = 0;
+						count = 0;
+					}
+				}
+				else if (c == '=')
+				{
+					if (count < 2 || count + ++padding > 4) throw DataFormatException("Invalid Base64 padding");
+				}
+				else if (!isSpace(c))
+				{
+					throw DataFormatException("Invalid Base64 character");
+				}
+			}
+		}
+		if (count)
+		{
+			if (count == 1 || (padding && count + padding != 4) || (!padding && !(options & BASE64_NO_PADDING)))
+				throw DataFormatException("Incomplete Base64 data");
+			if (count == 2)
+			{
+				*out++ = static_cast<unsigned char>(group >> 4);
+			}
+			else
+			{
+				*out++ = static_cast<unsigned char>(group >> 10);
+				*out++ = static_cast<unsigned char>(group >> 2);
+			}
+		}
+		return static_cast<std::size_t>(out - static_cast<unsigned char*>(buffer));
+	}
+
+	static std::string decode(const std::string& encoded, int options = 0)
+		/// Returns the bytes decoded from encoded.
+		///
+		/// Throws a DataFormatException if encoded is not valid.
+	{
+		std::string result(maxDecodedLength(encoded.size()), '\0');
+		if (!encoded.empty()) result.resize(decode(encoded.data(), encoded.size(), &result[0], options));
+		return result;
+	}
+
+private:
+	static bool isSpace(unsigned char c)
+	{
+		return c == ' ' || (c >= '\t' && c <= '\r');
+	}
+
+	static int value(unsigned char c, unsigned char c62, unsigned char c63)
+	{
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == c62) return 62;
+		if (c == c63) return 63;
+		return -1;
+	}
+
+#if defined(POCO_BASE64_SSE2)
+	static int load24(const unsigned char* p)
+	{
+		return (p[0] << 16) | (p[1] << 8) | p[2];
+	}
+
+	static __m128i translate(__m128i idx, char off62, char off63)
+		/// Maps the 6 bit values in idx to the characters of the alphabet.
+	{
+		__m128i r = _mm_add_epi8(idx, _mm_set1_epi8('A'));
+		r = _mm_add_epi8(r, _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(25)), _mm_set1_epi8('a' - 'A' - 26)));
+		r = _mm_sub_epi8(r, _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(51)), _mm_set1_epi8(75)));
+		r = _mm_add_epi8(r, _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(61)), _mm_set1_epi8(off62)));
+		r = _mm_add_epi8(r, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(63)), _mm_set1_epi8(off63)));
+		return r;
+	}
+
+	static __m128i inRange(__m128i x, char first, char last)
+	{
+		return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(first - 1))), _mm_cmplt_epi8(x, _mm_set1_epi8(static_cast<char>(last + 1))));
+	}
+
+	static bool values(__m128i x, __m128i v62, __m128i v63, __m128i& v)
+		/// Maps 16 characters to their 6 bit values, and returns
+		/// false if any of them is not in the alphabet.
+	{
+		__m128i upper = inRange(x, 'A', 'Z');
+		__m128i lower = inRange(x, 'a', 'z');
+		__m128i digit = inRange(x, '0', '9');
+		__m128i is62 = _mm_cmpeq_epi8(x, v62);
+		__m128i is63 = _mm_cmpeq_epi8(x, v63);
+		__m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, is62)), is63);
+		if (_mm_movemask_epi8(valid) != 0xFFFF) return false;
+		v = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(upper, _mm_sub_epi8(x, _mm_set1_epi8('A'))), _mm_and_si128(lower, _mm_sub_epi8(x, _mm_set1_epi8('a' - 26)))),
+			_mm_or_si128(_mm_and_si128(digit, _mm_add_epi8(x, _mm_set1_epi8(52 - '0'))),
+				_mm_or_si128(_mm_and_si128(is62, _mm_set1_epi8(62)), _mm_and_si128(is63, _mm_set1_epi8(63)))));
+		return true;
+	}
+#elif defined(POCO_BASE64_NEON)
+	static uint8x16_t inRange(uint8x16_t x, unsigned char first, unsigned char last)
+	{
+		return vandq_u8(vcgeq_u8(x, vdupq_n_u8(first)), vcleq_u8(x, vdupq_n_u8(last)));
+	}
+
+	static bool values(uint8x16_t x, uint8x16_t v62, uint8x16_t v63, uint8x16_t& v)
+		/// Maps 16 characters to their 6 bit values, and returns
+		/// false if any of them is not in the alphabet.
+	{
+		uint8x16_t upper = inRange(x, 'A', 'Z');
+		uint8x16_t lower = inRange(x, 'a', 'z');
+		uint8x16_t digit = inRange(x, '0', '9');
+		uint8x16_t is62 = vceqq_u8(x, v62);
+		uint8x16_t is63 = vceqq_u8(x, v63);
+		uint8x16_t valid = vorrq_u8(vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, is62)), is63);
+		if (vminvq_u8(valid) == 0) return false;
+		v = vorrq_u8(
+			vorrq_u8(vandq_u8(upper, vsubq_u8(x, vdupq_n_u8('A'))), vandq_u8(lower, vsubq_u8(x, vdupq_n_u8('a' - 26)))),
+			vorrq_u8(vandq_u8(digit, vaddq_u8(x, vdupq_n_u8(52 - '0'))),
+				vorrq_u8(vandq_u8(is62, vdupq_n_u8(62)), vandq_u8(is63, vdupq_n_u8(63)))));
+		return true;
+	}
+#endif
+
+	static const char* alphabet(int options)
+	{
+		return (options & BASE64_URL_ENCODING)
+			? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+			: "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	}
+
+	Base64();
+	~Base64();
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_Base64_INCLUDED
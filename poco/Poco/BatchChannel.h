@@ -0,0 +1,73 @@
+//
+// BatchChannel.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  BatchChannel
+//
+// Definition of the BatchChannel class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_BatchChannel_INCLUDED
+#define Foundation_BatchChannel_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Channel.h"
+#include "Poco/Message.h"
+#include <vector>
+
+
+namespace Poco {
+
+
+class BatchChannel
+	/// A mixin for channels that can write several messages
+	/// at once more efficiently than one after the other,
+	/// e.g. with a single write to a file.
+	///
+	/// Use logMany() to pass a batch of messages to any channel.
+{
+public:
+	virtual void logMany(const std::vector<Message>& messages) = 0;
+		/// Logs the given messages, in order.
+
+protected:
+	virtual ~BatchChannel()
+	{
+	}
+};
+
+
+inline void logMany(Channel* pChannel, const std::vector<Message>& messages)
+	/// Passes the messages to the given channel, with a single call
+	/// if the channel is a BatchChannel, otherwise one by one.
+{
+	if (!pChannel || messages.empty()) return;
+	BatchChannel* pBatchChannel = dynamic_cast<BatchChannel*>(pChannel);
+	if (pBatchChannel)
+	{
+		pBatchChannel->logMany(messages);
+	}
+	else
+	{
+		for (std::vector<Message>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+		{
+			pChannel->log(*it);
+		}
+	}
+}
+
+
+} // namespace Poco
+
+
+#endif // Foundation_BatchChannel_INCLUDED
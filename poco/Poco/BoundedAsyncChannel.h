@@ -0,0 +1,490 @@
+//
+// BoundedAsyncChannel.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  BoundedAsyncChannel
+//
+// Definition of the BoundedAsyncChannel class.
+//
+// Copyright (c) 2004-2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_BoundedAsyncChannel_INCLUDED
+#define Foundation_BoundedAsyncChannel_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Channel.h"
+#include "Poco/BatchChannel.h"
+#include "Poco/LogRecord.h"
+#include "Poco/Logger.h"
+#include "Poco/LoggingRegistry.h"
+#include "Poco/Message.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/NumberParser.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/String.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+namespace Poco {
+
+
+struct AsyncChannelStatistics
+	/// Counters of a BoundedAsyncChannel.
+{
+	AsyncChannelStatistics():
+		queued(0),
+		written(0),
+		droppedOldest(0),
+		droppedPriority(0),
+		blocked(0),
+		highWaterMark(0)
+	{
+	}
+
+	UInt64 queued;          /// Messages accepted by log().
+	UInt64 written;         /// Messages passed to the target channel.
+	UInt64 droppedOldest;   /// Queued messages replaced by newer ones.
+	UInt64 droppedPriority; /// Messages dropped because of their priority.
+	UInt64 blocked;         /// Calls to log() that had to wait for space.
+	std::size_t highWaterMark; /// The largest number of queued messages.
+
+	UInt64 dropped() const
+		/// Returns the total number of dropped messages.
+	{
+		return droppedOldest + droppedPriority;
+	}
+};
+
+
+class BoundedAsyncChannel: public Channel, public Runnable, public RecordChannel, public BatchChannel
+	/// A channel that uses a separate thread for logging, like
+	/// AsyncChannel, but with a queue of bounded size.
+	///
+	/// What happens if the queue is full is determined by the
+	/// overflow policy:
+	///   * POLICY_DROP_OLDEST: the oldest queued message is dropped.
+	///   * POLICY_DROP_BELOW_PRIORITY: the new message is dropped if it
+	///     is less important than the threshold priority, otherwise the
+	///     oldest queued message is dropped.
+	///   * POLICY_BLOCK: log() waits until there is space in the queue.
+	///
+	/// The background thread takes up to batchSize messages from the
+	/// queue at a time and passes them to the target channel, with a
+	/// single logMany() call if the target is a BatchChannel.
+	///
+	/// LogRecords passed in by the poco_*_fmt macros are queued as they
+	/// are and only formatted by the background thread. Batches passed
+	/// in with logMany() are queued with a single lock of the queue.
+	///
+	/// Dropped messages are counted in statistics(). Unless the
+	/// reportDrops property is false, the background thread also logs
+	/// a warning to the target channel after messages have been dropped.
+	///
+	/// The following properties are supported:
+	///   * channel:       The name of the target channel (set-only).
+	///   * priority:      The priority of the background thread: lowest,
+	///                    low, normal (default), high or highest (set-only).
+	///   * capacity:      The maximum number of queued messages (default
+	///                    1024). Must be set before the channel is opened.
+	///   * policy:        dropOldest (default), dropBelowPriority or block.
+	///   * threshold:     The least important priority not dropped by
+	///                    dropBelowPriority, as name or number (default
+	///                    warning).
+	///   * batchSize:     The maximum number of messages passed to the
+	///                    target channel at once (default 64).
+	///   * reportDrops:   true (default) or false.
+{
+public:
+	typedef AutoPtr<BoundedAsyncChannel> Ptr;
+
+	enum OverflowPolicy
+	{
+		POLICY_DROP_OLDEST,
+		POLICY_DROP_BELOW_PRIORITY,
+		POLICY_BLOCK
+	};
+
+	enum
+	{
+		DEFAULT_CAPACITY   = 1024,
+		DEFAULT_BATCH_SIZE = 64
+	};
+
+	BoundedAsyncChannel(Channel* pChannel = 0, OverflowPolicy policy = POLICY_DROP_OLDEST, Thread::Priority prio = Thread::PRIO_NORMAL):
+		_pChannel(pChannel),
+		_policy(policy),
+		_threshold(Message::PRIO_WARNING),
+		_capacity(DEFAULT_CAPACITY),
+		_batchSize(DEFAULT_BATCH_SIZE),
+		_reportDrops(true),
+		_head(0),
+		_count(0),
+		_reported(0),
+		_open(false),
+		_stop(false)
+		/// Creates the BoundedAsyncChannel and connects it to
+		/// the given channel.
+	{
+		if (_pChannel) _pChannel->duplicate();
+		_thread.setPriority(prio);
+	}
+
+	void setChannel(Channel* pChannel)
+		/// Connects the BoundedAsyncChannel to the given target channel.
+	{
+		FastMutex::ScopedLock lock(_channelMutex);
+		if (_pChannel) _pChannel->release();
+		_pChannel = pChannel;
+		if (_pChannel) _pChannel->duplicate();
+	}
+
+	Channel* getChannel() const
+		/// Returns the target channel.
+	{
+		return _pChannel;
+	}
+
+	void open()
+		/// Opens the channel and starts the background thread.
+	{
+		FastMutex::ScopedLock threadLock(_threadMutex);
+		if (_open) return;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_entries.resize(_capacity > 0 ? _capacity : 1);
+			_head  = 0;
+			_count = 0;
+			_stop  = false;
+			_open  = true;
+		}
+		_thread.start(*this);
+	}
+
+	void close()
+		/// Passes the queued messages to the target channel and
+		/// stops the background thread.
+	{
+		FastMutex::ScopedLock threadLock(_threadMutex);
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (!_open) return;
+			_open = false;
+			_stop = true;
+			_notEmpty.broadcast();
+			_notFull.broadcast();
+		}
+		_thread.join();
+	}
+
+	void log(const Message& msg)
+		/// Queues the message for the background thread.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		Entry* pEntry = reserve(msg.getPriority());
+		if (!pEntry) return;
+		pEntry->deferred = false;
+		pEntry->message  = msg;
+		commit();
+	}
+
+	void log(const LogRecord& record)
+		/// Queues the record for the background thread,
+		/// which formats it.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		Entry* pEntry = reserve(record.priority());
+		if (!pEntry) return;
+		pEntry->deferred = true;
+		pEntry->record   = record;
+		commit();
+	}
+
+	void logMany(const std::vector<Message>& messages)
+		/// Queues the messages for the background thread.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		for (std::vector<Message>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+		{
+			Entry* pEntry = reserve(it->getPriority());
+			if (!pEntry) continue;
+			pEntry->deferred = false;
+			pEntry->message  = *it;
+			commit();
+		}
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+		/// Sets or changes a configuration property.
+		///
+		/// See the class documentation for the supported properties.
+	{
+		if (name == "channel")
+			setChannel(LoggingRegistry::defaultRegistry().channelForName(value));
+		else if (name == "priority")
+			setPriority(value);
+		else if (name == "capacity")
+			_capacity = NumberParser::parseUnsigned(value);
+		else if (name == "policy")
+			setPolicy(value);
+		else if (name == "threshold")
+			_threshold = static_cast<Message::Priority>(Logger::parseLevel(value));
+		else if (name == "batchSize")
+			_batchSize = NumberParser::parseUnsigned(value);
+		else if (name == "reportDrops")
+			_reportDrops = icompare(value, "true") == 0;
+		else
+			Channel::setProperty(name, value);
+	}
+
+	std::string getProperty(const std::string& name) const
+		/// Returns the value of the property with the given name.
+	{
+		if (name == "capacity")
+			return NumberFormatter::format(_capacity);
+		else if (name == "policy")
+			return _policy == POLICY_BLOCK ? "block" : (_policy == POLICY_DROP_BELOW_PRIORITY ? "dropBelowPriority" : "dropOldest");
+		else if (name == "threshold")
+			return NumberFormatter::format(static_cast<int>(_threshold));
+		else if (name == "batchSize")
+			return NumberFormatter::format(_batchSize);
+		else if (name == "reportDrops")
+			return _reportDrops ? "true" : "false";
+		else
+			return Channel::getProperty(name);
+	}
+
+	void setPolicy(OverflowPolicy policy)
+		/// Sets the overflow policy.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_policy = policy;
+		_notFull.broadcast();
+	}
+
+	OverflowPolicy getPolicy() const
+		/// Returns the overflow policy.
+	{
+		return _policy;
+	}
+
+	AsyncChannelStatistics statistics() const
+		/// Returns the current counters.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _statistics;
+	}
+
+	std::size_t size() const
+		/// Returns the number of queued messages.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _count;
+	}
+
+	Timestamp::TimeDiff lag() const
+		/// Returns the time in microseconds since the oldest queued
+		/// message was logged, or 0 if the queue is empty.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (_count == 0) return 0;
+		const Entry& entry = _entries[_head];
+		Timestamp::TimeDiff elapsed = (entry.deferred ? entry.record.time() : entry.message.getTime()).elapsed();
+		return elapsed > 0 ? elapsed : 0;
+	}
+
+protected:
+	~BoundedAsyncChannel()
+		/// Destroys the BoundedAsyncChannel.
+	{
+		try
+		{
+			close();
+			if (_pChannel) _pChannel->release();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void run()
+	{
+		std::vector<Entry> batch;
+		std::vector<Message> messages;
+		for (;;)
+		{
+			bool stop;
+			UInt64 dropped;
+			{
+				FastMutex::ScopedLock lock(_mutex);
+				while (_count == 0 && !_stop) _notEmpty.wait(_mutex);
+				stop = _stop;
+				std::size_t n = _count < _batchSize ? _count : (_batchSize > 0 ? _batchSize : 1);
+				if (batch.size() < n) batch.resize(n);
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					Entry& entry = _entries[_head];
+					batch[i].deferred = entry.deferred;
+					if (entry.deferred)
+						batch[i].record.swap(entry.record);
+					else
+						batch[i].message.swap(entry.message);
+					_head = (_head + 1) % _entries.size();
+				}
+				_count -= n;
+				_statistics.written += n;
+				dropped = _statistics.dropped();
+				if (n > 0) _notFull.broadcast();
+				messages.resize(n);
+			}
+			for (std::size_t i = 0; i < messages.size(); ++i)
+			{
+				if (batch[i].deferred)
+					batch[i].record.message().swap(messages[i]);
+				else
+					messages[i].swap(batch[i].message);
+			}
+			if (_reportDrops && dropped != _reported)
+			{
+				messages.push_back(dropReport(dropped - _reported));
+				_reported = dropped;
+			}
+			{
+				FastMutex::ScopedLock lock(_channelMutex);
+				Poco::logMany(_pChannel, messages);
+			}
+			if (stop && messages.empty()) break;
+		}
+	}
+
+	void setPriority(const std::string& value)
+	{
+		Thread::Priority prio = Thread::PRIO_NORMAL;
+
+		if (value == "lowest")
+			prio = Thread::PRIO_LOWEST;
+		else if (value == "low")
+			prio = Thread::PRIO_LOW;
+		else if (value == "normal")
+			prio = Thread::PRIO_NORMAL;
+		else if (value == "high")
+			prio = Thread::PRIO_HIGH;
+		else if (value == "highest")
+			prio = Thread::PRIO_HIGHEST;
+		else
+			throw InvalidArgumentException("thread priority", value);
+
+		_thread.setPriority(prio);
+	}
+
+	void setPolicy(const std::string& value)
+	{
+		if (icompare(value, "dropOldest") == 0)
+			setPolicy(POLICY_DROP_OLDEST);
+		else if (icompare(value, "dropBelowPriority") == 0)
+			setPolicy(POLICY_DROP_BELOW_PRIORITY);
+		else if (icompare(value, "block") == 0)
+			setPolicy(POLICY_BLOCK);
+		else
+			throw InvalidArgumentException("overflow policy", value);
+	}
+
+private:
+	struct Entry
+	{
+		Entry():
+			deferred(false)
+		{
+		}
+
+		bool      deferred;
+		Message   message;
+		LogRecord record;
+	};
+
+	BoundedAsyncChannel(const BoundedAsyncChannel&);
+	BoundedAsyncChannel& operator = (const BoundedAsyncChannel&);
+
+	Entry* reserve(Message::Priority prio)
+		/// Returns the entry for a new message, with _mutex locked,
+		/// or null if the message must be dropped.
+	{
+		if (!_open) return 0;
+		if (_count == _entries.size())
+		{
+			if (_policy == POLICY_BLOCK)
+			{
+				++_statistics.blocked;
+				while (_open && _policy == POLICY_BLOCK && _count == _entries.size()) _notFull.wait(_mutex);
+				if (!_open) return 0;
+			}
+			if (_count == _entries.size())
+			{
+				if (_policy == POLICY_DROP_BELOW_PRIORITY && prio > _threshold)
+				{
+					++_statistics.droppedPriority;
+					return 0;
+				}
+				++_statistics.droppedOldest;
+				_head = (_head + 1) % _entries.size();
+				--_count;
+			}
+		}
+		return &_entries[(_head + _count) % _entries.size()];
+	}
+
+	void commit()
+	{
+		++_count;
+		++_statistics.queued;
+		if (_count > _statistics.highWaterMark) _statistics.highWaterMark = _count;
+		_notEmpty.signal();
+	}
+
+	static Message dropReport(UInt64 dropped)
+	{
+		std::string text("BoundedAsyncChannel dropped ");
+		NumberFormatter::append(text, dropped);
+		text += " message(s)";
+		return Message("BoundedAsyncChannel", text, Message::PRIO_WARNING);
+	}
+
+	Channel* _pChannel;
+	OverflowPolicy _policy;
+	Message::Priority _threshold;
+	std::size_t _capacity;
+	std::size_t _batchSize;
+	bool _reportDrops;
+	std::vector<Entry> _entries;
+	std::size_t _head;
+	std::size_t _count;
+	UInt64 _reported;
+	bool _open;
+	bool _stop;
+	AsyncChannelStatistics _statistics;
+	Condition _notEmpty;
+	Condition _notFull;
+	Thread _thread;
+	mutable FastMutex _mutex;
+	FastMutex _threadMutex;
+	FastMutex _channelMutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_BoundedAsyncChannel_INCLUDED
@@ -0,0 +1,392 @@
+//
+// BufferStream.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Streams
+// Module:  BufferStream
+//
+// Definition of the BufferStreamBuf, BufferIOS and BufferOutputStream classes.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_BufferStream_INCLUDED
+#define Foundation_BufferStream_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Buffer.h"
+#include "Poco/StreamUtil.h"
+#include "Poco/Mutex.h"
+#include "Poco/SingletonHolder.h"
+#include <streambuf>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+
+namespace Poco {
+
+
+class BufferPool
+	/// A pool of idle Buffer<char> objects, used by
+	/// BufferStreamBuf to obtain and grow its buffer.
+	///
+	/// Buffers with a capacity up to the maximum pooled capacity
+	/// are kept for reuse, up to a maximum number of buffers.
+	/// Larger buffers are released.
+{
+public:
+	enum
+	{
+		DEFAULT_MAX_CAPACITY = 65536,
+		DEFAULT_MAX_IDLE     = 32
+	};
+
+	explicit BufferPool(std::size_t maxCapacity = DEFAULT_MAX_CAPACITY, std::size_t maxIdle = DEFAULT_MAX_IDLE):
+		_maxCapacity(maxCapacity),
+		_maxIdle(maxIdle)
+		/// Creates the BufferPool, keeping up to maxIdle buffers
+		/// of up to maxCapacity bytes.
+	{
+	}
+
+	~BufferPool()
+		/// Destroys the BufferPool and releases all idle buffers.
+	{
+		for (std::vector<Buffer<char>*>::iterator it = _idle.begin(); it != _idle.end(); ++it)
+		{
+			delete *it;
+		}
+	}
+
+	bool acquire(Buffer<char>& buffer, std::size_t minCapacity)
+		/// Swaps an idle buffer with at least minCapacity bytes,
+		/// if there is one, into the given buffer, and returns true.
+		/// The previous contents of buffer are released.
+		/// Returns false if there is no such buffer.
+	{
+		Buffer<char>* pIdle = 0;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			for (std::vector<Buffer<char>*>::iterator it = _idle.begin(); it != _idle.end(); ++it)
+			{
+				if ((*it)->capacity() >= minCapacity)
+				{
+					pIdle = *it;
+					*it = _idle.back();
+					_idle.pop_back();
+					break;
+				}
+			}
+		}
+		if (!pIdle) return false;
+		buffer.swap(*pIdle);
+		delete pIdle;
+		return true;
+	}
+
+	void recycle(Buffer<char>& buffer)
+		/// Takes the memory of the given buffer into the pool,
+		/// if the buffer can be pooled. The buffer's memory is
+		/// released otherwise. In both cases, buffer is left empty.
+	{
+		if (buffer.capacity() > 0 && buffer.capacity() <= _maxCapacity)
+		{
+			Buffer<char>* pIdle = new Buffer<char>(0);
+			pIdle->swap(buffer);
+			FastMutex::ScopedLock lock(_mutex);
+			if (_idle.size() < _maxIdle)
+			{
+				_idle.push_back(pIdle);
+				return;
+			}
+			buffer.swap(*pIdle);
+			delete pIdle;
+		}
+		buffer.setCapacity(0, false);
+	}
+
+	std::size_t idle() const
+		/// Returns the number of idle buffers.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _idle.size();
+	}
+
+	static BufferPool& defaultPool()
+		/// Returns the BufferPool used by BufferStreamBuf.
+	{
+		static SingletonHolder<BufferPool> sh;
+		return *sh.get();
+	}
+
+private:
+	BufferPool(const BufferPool&);
+	BufferPool& operator = (const BufferPool&);
+
+	std::size_t _maxCapacity;
+	std::size_t _maxIdle;
+	std::vector<Buffer<char>*> _idle;
+	mutable FastMutex _mutex;
+};
+
+
+class BufferStreamBuf: public std::streambuf
+	/// This stream buffer writes into a Buffer<char> that
+	/// grows as needed.
+	///
+	/// The buffer, and larger buffers when it has to grow,
+	/// are taken from the default BufferPool, and are given back
+	/// to it when the BufferStreamBuf is destroyed, unless the
+	/// buffer has been taken over with release().
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY = 256
+	};
+
+	explicit BufferStreamBuf(std::size_t initialCapacity = DEFAULT_CAPACITY):
+		_buffer(0)
+		/// Creates the BufferStreamBuf with a buffer of at
+		/// least initialCapacity bytes.
+	{
+		allocate(initialCapacity > 0 ? initialCapacity : static_cast<std::size_t>(DEFAULT_CAPACITY));
+	}
+
+	~BufferStreamBuf()
+		/// Gives the buffer back to the default BufferPool.
+	{
+		BufferPool::defaultPool().recycle(_buffer);
+	}
+
+	const char* data() const
+		/// Returns a pointer to the characters written so far.
+	{
+		return _buffer.begin();
+	}
+
+	std::size_t size() const
+		/// Returns the number of characters written so far.
+	{
+		return static_cast<std::size_t>(pptr() - pbase());
+	}
+
+	void release(Buffer<char>& buffer)
+		/// Swaps the buffer, with its size set to the number of
+		/// characters written, into the given buffer, without
+		/// copying it, and starts over with an empty buffer.
+		///
+		/// When the caller is done with the buffer, it can
+		/// give it back with BufferPool::defaultPool().recycle().
+	{
+		std::size_t written = size();
+		_buffer.resize(written);
+		buffer.swap(_buffer);
+		Buffer<char> empty(0);
+		_buffer.swap(empty);
+		setp(0, 0);
+	}
+
+	void reset()
+		/// Discards the characters written so far,
+		/// keeping the buffer.
+	{
+		setp(pbase(), epptr());
+	}
+
+protected:
+	int_type overflow(int_type c)
+	{
+		if (c == traits_type::eof()) return traits_type::not_eof(c);
+		grow(size() + 1);
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+		return c;
+	}
+
+	std::streamsize xsputn(const char_type* s, std::streamsize n)
+	{
+		if (n <= 0) return 0;
+		std::size_t length = static_cast<std::size_t>(n);
+		if (length > static_cast<std::size_t>(epptr() - pptr())) grow(size() + length);
+		std::memcpy(pptr(), s, length);
+		advance(length);
+		return n;
+	}
+
+	pos_type seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode which)
+	{
+		// only the current position can be queried, e.g. with tellp()
+		if (off != 0 || dir != std::ios::cur || (which & std::ios::out) == 0) return pos_type(off_type(-1));
+		return pos_type(static_cast<off_type>(size()));
+	}
+
+private:
+	enum
+	{
+		INT_MAX_CHUNK = 0x40000000
+	};
+
+	void allocate(std::size_t minCapacity)
+	{
+		if (!BufferPool::defaultPool().acquire(_buffer, minCapacity))
+		{
+			Buffer<char> buffer(minCapacity);
+			_buffer.swap(buffer);
+		}
+		_buffer.resize(_buffer.capacity(), false);
+		setp(_buffer.begin(), _buffer.begin() + _buffer.capacity());
+	}
+
+	void grow(std::size_t minCapacity)
+		/// Replaces the buffer with one of at least twice the
+		/// size, or minCapacity, whichever is larger, preserving
+		/// the characters written.
+	{
+		std::size_t written = size();
+		std::size_t capacity = 2*_buffer.capacity();
+		if (capacity < minCapacity) capacity = minCapacity;
+		if (capacity < DEFAULT_CAPACITY) capacity = DEFAULT_CAPACITY;
+
+		Buffer<char> old(0);
+		old.swap(_buffer);
+		allocate(capacity);
+		if (written > 0) std::memcpy(_buffer.begin(), old.begin(), written);
+		advance(written);
+		BufferPool::defaultPool().recycle(old);
+	}
+
+	void advance(std::size_t length)
+		/// Calls pbump(), which takes an int, for any length.
+	{
+		while (length > static_cast<std::size_t>(INT_MAX_CHUNK))
+		{
+			pbump(INT_MAX_CHUNK);
+			length -= INT_MAX_CHUNK;
+		}
+		pbump(static_cast<int>(length));
+	}
+
+	BufferStreamBuf(const BufferStreamBuf&);
+	BufferStreamBuf& operator = (const BufferStreamBuf&);
+
+	Buffer<char> _buffer;
+};
+
+
+class BufferIOS: public virtual std::ios
+	/// The base class for BufferOutputStream.
+	///
+	/// This class is needed to ensure the correct initialization
+	/// order of the stream buffer and base classes.
+{
+public:
+	explicit BufferIOS(std::size_t initialCapacity):
+		_buf(initialCapacity)
+		/// Creates the basic stream.
+	{
+		poco_ios_init(&_buf);
+	}
+
+	~BufferIOS()
+		/// Destroys the stream.
+	{
+	}
+
+	BufferStreamBuf* rdbuf()
+		/// Returns a pointer to the underlying streambuf.
+	{
+		return &_buf;
+	}
+
+protected:
+	BufferStreamBuf _buf;
+};
+
+
+class BufferOutputStream: public BufferIOS, public std::ostream
+	/// An output stream writing into a growing Buffer<char>.
+	///
+	/// Unlike MemoryOutputStream, BufferOutputStream does not
+	/// need a preallocated buffer and never fails because the
+	/// buffer is full, and unlike std::ostringstream, the result
+	/// can be taken over with release() without copying it.
+	/// Buffers are taken from, and given back to, a BufferPool,
+	/// so that streams created repeatedly for serializing messages
+	/// do not allocate memory once the pool has been filled.
+	///
+	/// BufferOutputStream can be used as the target of any class
+	/// writing to an std::ostream, e.g. BinaryWriter, the
+	/// RemotingNG BinarySerializer, JSON::Stringifier and
+	/// XML::XMLWriter:
+	///
+	///     Poco::BufferOutputStream ostr;
+	///     Poco::JSON::Stringifier::stringify(object, ostr);
+	///     Poco::Buffer<char> json(0);
+	///     ostr.release(json);
+{
+public:
+	explicit BufferOutputStream(std::size_t initialCapacity = BufferStreamBuf::DEFAULT_CAPACITY):
+		BufferIOS(initialCapacity),
+		std::ostream(&_buf)
+		/// Creates a BufferOutputStream with a buffer of
+		/// at least initialCapacity bytes.
+	{
+	}
+
+	~BufferOutputStream()
+		/// Destroys the BufferOutputStream.
+	{
+	}
+
+	const char* data() const
+		/// Returns a pointer to the characters written so far.
+	{
+		return _buf.data();
+	}
+
+	std::size_t size() const
+		/// Returns the number of characters written so far.
+	{
+		return _buf.size();
+	}
+
+	std::string str() const
+		/// Returns a copy of the characters written so far.
+	{
+		return std::string(_buf.data(), _buf.size());
+	}
+
+	void release(Buffer<char>& buffer)
+		/// Swaps the characters written so far into the given
+		/// buffer, without copying them, and starts over with
+		/// an empty buffer. See BufferStreamBuf::release().
+	{
+		flush();
+		_buf.release(buffer);
+	}
+
+	void reset()
+		/// Discards the characters written so far, keeping the
+		/// buffer, and clears the stream state.
+	{
+		_buf.reset();
+		clear();
+	}
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_BufferStream_INCLUDED
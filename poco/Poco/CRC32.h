@@ -0,0 +1,403 @@
+//
+// CRC32.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  CRC32
+//
+// Definition of the CRC32 class.
+//
+// Copyright (c) 2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_CRC32_INCLUDED
+#define Foundation_CRC32_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include <cstring>
+#include <string>
+
+
+#if defined(__ARM_FEATURE_CRC32)
+	#define POCO_CRC32_ARMV8
+	#include <arm_acle.h>
+#elif defined(__GNUC__) && (POCO_ARCH == POCO_ARCH_AMD64 || POCO_ARCH == POCO_ARCH_IA32) && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+	#define POCO_CRC32_SSE42
+	#include <nmmintrin.h>
+	#include <cpuid.h>
+#endif
+
+
+namespace Poco {
+
+
+class CRC32
+	/// This class calculates CRC-32 checksums, compatible with
+	/// zlib, Zip and Checksum::TYPE_CRC32, and CRC-32C (Castagnoli)
+	/// checksums, as used by iSCSI, SCTP and ext4.
+	///
+	/// The CRC instructions of the processor are used for CRC-32C
+	/// on x86 and x86_64 processors with SSE 4.2, which is detected at
+	/// runtime, and for both checksums on ARMv8 processors, if the code
+	/// is compiled with the CRC extension enabled (for example, with
+	/// -march=armv8-a+crc). Otherwise, a table driven slicing-by-8
+	/// implementation, processing eight bytes per step, is used.
+	///
+	/// With combine(), the checksums of consecutive chunks of data can
+	/// be computed independently, for example on several threads, and
+	/// merged into the checksum of the whole data:
+	///
+	///     Poco::UInt32 crc1 = CRC32::compute(CRC32::TYPE_CRC32, pData, half);
+	///     Poco::UInt32 crc2 = CRC32::compute(CRC32::TYPE_CRC32, pData + half, size - half);
+	///     Poco::UInt32 crc = CRC32::combine(CRC32::TYPE_CRC32, crc1, crc2, size - half);
+{
+public:
+	enum Type
+	{
+		TYPE_CRC32 = 0,
+		TYPE_CRC32C
+	};
+
+	explicit CRC32(Type type = TYPE_CRC32):
+		_type(type),
+		_value(0)
+		/// Creates the CRC32, using the given type, initialized to 0.
+	{
+	}
+
+	~CRC32()
+		/// Destroys the CRC32.
+	{
+	}
+
+	void update(const void* data, std::size_t length)
+		/// Updates the checksum with the given data.
+	{
+		_value = compute(_type, data, length, _value);
+	}
+
+	void update(const std::string& data)
+		/// Updates the checksum with the given data.
+	{
+		update(data.data(), data.size());
+	}
+
+	void update(char data)
+		/// Updates the checksum with the given data.
+	{
+		update(&data, 1);
+	}
+
+	void append(Poco::UInt32 checksum, Poco::UInt64 length)
+		/// Updates the checksum as if the data of length bytes,
+		/// with the given checksum, had been passed to update().
+	{
+		_value = combine(_type, _value, checksum, length);
+	}
+
+	void reset()
+		/// Resets the checksum to 0.
+	{
+		_value = 0;
+	}
+
+	Poco::UInt32 checksum() const
+		/// Returns the calculated checksum.
+	{
+		return _value;
+	}
+
+	Type type() const
+		/// Returns the type of the checksum.
+	{
+		return _type;
+	}
+
+	static Poco::UInt32 compute(Type type, const void* data, std::size_t length, Poco::UInt32 crc = 0)
+		/// Returns the checksum of the given data, continuing
+		/// the given checksum of the preceding data.
+	{
+		return ~process(type, ~crc, static_cast<const Poco::UInt8*>(data), length);
+	}
+
+	static Poco::UInt32 combine(Type type, Poco::UInt32 crc1, Poco::UInt32 crc2, Poco::UInt64 length2)
+		/// Returns the checksum of two consecutive blocks of data,
+		/// given the checksum crc1 of the first block, and the
+		/// checksum crc2 and length of the second block.
+	{
+		const Tables& tab = tables(type);
+		return multModP(tab.poly, shift(tab, length2), crc1) ^ crc2;
+	}
+
+	static Poco::UInt32 combineAdler32(Poco::UInt32 adler1, Poco::UInt32 adler2, Poco::UInt64 length2)
+		/// Returns the Adler-32 checksum (see Checksum::TYPE_ADLER32)
+		/// of two consecutive blocks of data, given the checksum adler1
+		/// of the first block, and the checksum adler2 and length of
+		/// the second block.
+	{
+		const Poco::UInt32 BASE = 65521;
+		const Poco::UInt32 rem = static_cast<Poco::UInt32>(length2 % BASE);
+		Poco::UInt32 sum1 = adler1 & 0xffff;
+		Poco::UInt32 sum2 = static_cast<Poco::UInt32>((static_cast<Poco::UInt64>(rem)*sum1) % BASE);
+		sum1 += (adler2 & 0xffff) + BASE - 1;
+		sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + BASE - rem;
+		if (sum1 >= BASE) sum1 -= BASE;
+		if (sum1 >= BASE) sum1 -= BASE;
+		if (sum2 >= 2*BASE) sum2 -= 2*BASE;
+		if (sum2 >= BASE) sum2 -= BASE;
+		return sum1 | (sum2 << 16);
+	}
+
+	static bool isAccelerated(Type type)
+		/// Returns true if the CRC instructions of the processor
+		/// are used for the given type of checksum.
+	{
+#if defined(POCO_CRC32_ARMV8)
+		(void) type;
+		return true;
+#elif defined(POCO_CRC32_SSE42)
+		return type == TYPE_CRC32C && hasSSE42();
+#else
+		(void) type;
+		return false;
+#endif
+	}
+
+protected:
+	enum
+	{
+		INTERLEAVE_THRESHOLD = 1024
+			/// Minimum length of data processed as three interleaved
+			/// streams.
+	};
+
+	struct Tables
+	{
+		explicit Tables(Poco::UInt32 polynomial):
+			poly(polynomial)
+		{
+			for (Poco::UInt32 i = 0; i < 256; ++i)
+			{
+				Poco::UInt32 c = i;
+				for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ poly : c >> 1;
+				slice[0][i] = c;
+			}
+			for (int k = 1; k < 8; ++k)
+			{
+				for (int i = 0; i < 256; ++i)
+				{
+					slice[k][i] = (slice[k - 1][i] >> 8) ^ slice[0][slice[k - 1][i] & 0xff];
+				}
+			}
+			x2n[0] = Poco::UInt32(1) << 30;
+			for (int k = 1; k < 32; ++k) x2n[k] = multModP(poly, x2n[k - 1], x2n[k - 1]);
+		}
+
+		Poco::UInt32 poly;
+			/// The reversed polynomial.
+		Poco::UInt32 slice[8][256];
+		Poco::UInt32 x2n[32];
+			/// x^(2^k) modulo the polynomial.
+	};
+
+	static const Tables& tables(Type type)
+	{
+		static const Tables crc32(0xedb88320);
+		static const Tables crc32c(0x82f63b78);
+		return type == TYPE_CRC32C ? crc32c : crc32;
+	}
+
+	static Poco::UInt32 multModP(Poco::UInt32 poly, Poco::UInt32 a, Poco::UInt32 b)
+		/// Multiplies a and b modulo the polynomial.
+		/// a must not be 0.
+	{
+		Poco::UInt32 m = Poco::UInt32(1) << 31;
+		Poco::UInt32 p = 0;
+		for (;;)
+		{
+			if (a & m)
+			{
+				p ^= b;
+				if ((a & (m - 1)) == 0) break;
+			}
+			m >>= 1;
+			b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+		}
+		return p;
+	}
+
+	static Poco::UInt32 shift(const Tables& tab, Poco::UInt64 length)
+		/// Returns x^(8*length) modulo the polynomial.
+	{
+		Poco::UInt32 p = Poco::UInt32(1) << 31;
+		for (int k = 3; length > 0; length >>= 1, ++k)
+		{
+			if (length & 1) p = multModP(tab.poly, tab.x2n[k & 31], p);
+		}
+		return p;
+	}
+
+	static Poco::UInt32 step8(const Tables& tab, Poco::UInt32 crc, const Poco::UInt8* data)
+		/// Processes eight bytes of data.
+	{
+		const Poco::UInt32 lo = crc ^ (Poco::UInt32(data[0]) | (Poco::UInt32(data[1]) << 8) | (Poco::UInt32(data[2]) << 16) | (Poco::UInt32(data[3]) << 24));
+		const Poco::UInt32 hi = Poco::UInt32(data[4]) | (Poco::UInt32(data[5]) << 8) | (Poco::UInt32(data[6]) << 16) | (Poco::UInt32(data[7]) << 24);
+		return tab.slice[7][lo & 0xff] ^ tab.slice[6][(lo >> 8) & 0xff] ^ tab.slice[5][(lo >> 16) & 0xff] ^ tab.slice[4][lo >> 24]
+		     ^ tab.slice[3][hi & 0xff] ^ tab.slice[2][(hi >> 8) & 0xff] ^ tab.slice[1][(hi >> 16) & 0xff] ^ tab.slice[0][hi >> 24];
+	}
+
+	static Poco::UInt32 processSlicing8(const Tables& tab, Poco::UInt32 crc, const Poco::UInt8* data, std::size_t length)
+	{
+		if (length >= INTERLEAVE_THRESHOLD)
+		{
+			// Three independent streams keep more table lookups in flight;
+			// their checksums are merged like in combine().
+			const std::size_t lane = (length/3) & ~std::size_t(7);
+			const Poco::UInt8* data2 = data + lane;
+			const Poco::UInt8* data3 = data2 + lane;
+			Poco::UInt32 crc2 = 0;
+			Poco::UInt32 crc3 = 0;
+			for (std::size_t i = 0; i < lane; i += 8)
+			{
+				crc  = step8(tab, crc, data + i);
+				crc2 = step8(tab, crc2, data2 + i);
+				crc3 = step8(tab, crc3, data3 + i);
+			}
+			const Poco::UInt32 x = shift(tab, lane);
+			crc = multModP(tab.poly, x, crc) ^ crc2;
+			crc = multModP(tab.poly, x, crc) ^ crc3;
+			data += 3*lane;
+			length -= 3*lane;
+		}
+		for (; length >= 8; data += 8, length -= 8)
+		{
+			crc = step8(tab, crc, data);
+		}
+		while (length-- > 0)
+		{
+			crc = tab.slice[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+#if defined(POCO_CRC32_ARMV8)
+
+	static Poco::UInt32 process(Type type, Poco::UInt32 crc, const Poco::UInt8* data, std::size_t length)
+	{
+		Poco::UInt64 v;
+		if (type == TYPE_CRC32C)
+		{
+			for (; length >= 8; data += 8, length -= 8)
+			{
+				std::memcpy(&v, data, 8);
+				crc = __crc32cd(crc, v);
+			}
+			while (length-- > 0) crc = __crc32cb(crc, *data++);
+		}
+		else
+		{
+			for (; length >= 8; data += 8, length -= 8)
+			{
+				std::memcpy(&v, data, 8);
+				crc = __crc32d(crc, v);
+			}
+			while (length-- > 0) crc = __crc32b(crc, *data++);
+		}
+		return crc;
+	}
+
+#else
+
+#if defined(POCO_CRC32_SSE42)
+
+	static bool hasSSE42()
+	{
+		static const bool sse42 = detectSSE42();
+		return sse42;
+	}
+
+	static bool detectSSE42()
+	{
+		unsigned eax, ebx, ecx, edx;
+		return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+	}
+
+	__attribute__((target("sse4.2")))
+	static Poco::UInt32 processSSE42(Poco::UInt32 crc, const Poco::UInt8* data, std::size_t length)
+	{
+#if POCO_ARCH == POCO_ARCH_AMD64
+		Poco::UInt64 c = crc;
+		Poco::UInt64 v;
+		if (length >= INTERLEAVE_THRESHOLD)
+		{
+			// the crc32 instruction has a latency of three cycles,
+			// so three independent streams can be processed at once
+			const std::size_t lane = (length/3) & ~std::size_t(7);
+			const Poco::UInt8* data2 = data + lane;
+			const Poco::UInt8* data3 = data2 + lane;
+			Poco::UInt64 c2 = 0;
+			Poco::UInt64 c3 = 0;
+			Poco::UInt64 v2;
+			Poco::UInt64 v3;
+			for (std::size_t i = 0; i < lane; i += 8)
+			{
+				std::memcpy(&v, data + i, 8);
+				std::memcpy(&v2, data2 + i, 8);
+				std::memcpy(&v3, data3 + i, 8);
+				c  = _mm_crc32_u64(c, v);
+				c2 = _mm_crc32_u64(c2, v2);
+				c3 = _mm_crc32_u64(c3, v3);
+			}
+			const Tables& tab = tables(TYPE_CRC32C);
+			const Poco::UInt32 x = shift(tab, lane);
+			c = multModP(tab.poly, x, static_cast<Poco::UInt32>(c)) ^ static_cast<Poco::UInt32>(c2);
+			c = multModP(tab.poly, x, static_cast<Poco::UInt32>(c)) ^ static_cast<Poco::UInt32>(c3);
+			data += 3*lane;
+			length -= 3*lane;
+		}
+		for (; length >= 8; data += 8, length -= 8)
+		{
+			std::memcpy(&v, data, 8);
+			c = _mm_crc32_u64(c, v);
+		}
+		crc = static_cast<Poco::UInt32>(c);
+#endif
+		Poco::UInt32 w;
+		for (; length >= 4; data += 4, length -= 4)
+		{
+			std::memcpy(&w, data, 4);
+			crc = _mm_crc32_u32(crc, w);
+		}
+		while (length-- > 0) crc = _mm_crc32_u8(crc, *data++);
+		return crc;
+	}
+
+#endif
+
+	static Poco::UInt32 process(Type type, Poco::UInt32 crc, const Poco::UInt8* data, std::size_t length)
+	{
+#if defined(POCO_CRC32_SSE42)
+		if (type == TYPE_CRC32C && hasSSE42()) return processSSE42(crc, data, length);
+#endif
+		return processSlicing8(tables(type), crc, data, length);
+	}
+
+#endif
+
+private:
+	Type _type;
+	Poco::UInt32 _value;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_CRC32_INCLUDED
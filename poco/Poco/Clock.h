@@ -21,6 +21,12 @@
 
 
 #include "Poco/Foundation.h"
+#if defined(__linux__)
+#include <time.h>
+#if defined(CLOCK_MONOTONIC_COARSE) && defined(CLOCK_REALTIME_COARSE)
+#define POCO_HAVE_COARSE_CLOCK 1
+#endif
+#endif
 
 
 namespace Poco {
@@ -75,6 +81,10 @@ public:
 	void update();
 		/// Updates the Clock with the current system clock.
 
+	void updateFast();
+		/// Updates the Clock with the current system clock, with the
+		/// accuracy of the system timer tick, like fast().
+
 	bool operator == (const Clock& ts) const;
 	bool operator != (const Clock& ts) const;
 	bool operator >  (const Clock& ts) const;
@@ -119,6 +129,19 @@ public:
 	static bool monotonic();
 		/// Returns true iff the system's clock is monotonic.
 
+	static Clock fast();
+		/// Returns the current clock value with the accuracy of the
+		/// system timer tick (typically 1 to 10 milliseconds), for hot
+		/// paths such as idle and expiry checks, where millisecond
+		/// accuracy suffices.
+		///
+		/// On Linux, the value is read with CLOCK_MONOTONIC_COARSE,
+		/// which costs a fraction of a precise clock read. It has the
+		/// same epoch as Clock(), but can lag behind it by up to one
+		/// tick, so intervals between fast and precise values can be
+		/// slightly off. On other platforms, fast() is
+		/// equivalent to Clock().
+
 private:
 	ClockVal _clock;
 };
@@ -222,6 +245,28 @@ inline Clock::ClockDiff Clock::resolution()
 }
 
 
+inline void Clock::updateFast()
+{
+#if defined(POCO_HAVE_COARSE_CLOCK)
+	struct timespec ts;
+	if (clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) == 0)
+	{
+		_clock = ClockVal(ts.tv_sec)*resolution() + ts.tv_nsec/1000;
+		return;
+	}
+#endif
+	update();
+}
+
+
+inline Clock Clock::fast()
+{
+	Clock clock(0);
+	clock.updateFast();
+	return clock;
+}
+
+
 inline void swap(Clock& s1, Clock& s2)
 {
 	s1.swap(s2);
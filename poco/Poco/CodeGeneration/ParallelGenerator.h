@@ -0,0 +1,163 @@
+//
+// ParallelGenerator.h
+//
+// $Id$
+//
+// Library: CodeGeneration
+// Package: CodeGeneration
+// Module:  ParallelGenerator
+//
+// Definition of the ParallelGenerator class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef CodeGeneration_ParallelGenerator_INCLUDED
+#define CodeGeneration_ParallelGenerator_INCLUDED
+
+
+#include "Poco/CodeGeneration/CodeGeneration.h"
+#include "Poco/CodeGeneration/GenerationCache.h"
+#include "Poco/Process.h"
+#include "Poco/Environment.h"
+#include <deque>
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace CodeGeneration {
+
+
+class ParallelGenerator
+	/// ParallelGenerator runs a code generator for a set of
+	/// independent headers, in up to the given number of processes
+	/// at a time, and skips the headers found to be up to date in
+	/// a GenerationCache.
+	///
+	/// The CppParser builds its symbols in a process-wide symbol table
+	/// (see NameSpace::root()), so headers cannot be parsed on several
+	/// threads of the same process. Each job therefore runs the
+	/// generator command as a separate process, with the header
+	/// appended to the job's arguments.
+	///
+	/// Usage example:
+	///
+	///     GenerationCache cache("RemoteGen.cache");
+	///     ParallelGenerator gen("RemoteGen", cache);
+	///     ParallelGenerator::Job job;
+	///     job.header = "include/IConnManagerService.h";
+	///     job.hash = cache.hash(job.header, dependencies, options);
+	///     job.args.push_back("RemoteGen.xml");
+	///     job.outputs = generatedFiles;
+	///     gen.add(job);
+	///     int failed = gen.run();
+	///     cache.save();
+{
+public:
+	struct Job
+	{
+		std::string header;
+			/// The header to generate code for.
+
+		std::string hash;
+			/// The hash of the header (see GenerationCache::hash()).
+
+		Poco::Process::Args args;
+			/// The arguments passed to the generator before the header.
+
+		GenerationCache::Files outputs;
+			/// The files generated from the header.
+	};
+
+	ParallelGenerator(const std::string& command, GenerationCache& cache, int processes = 0):
+		_command(command),
+		_cache(cache),
+		_processes(processes > 0 ? processes : static_cast<int>(Poco::Environment::processorCount())),
+		_skipped(0)
+		/// Creates the ParallelGenerator for the given generator command.
+		///
+		/// If processes is 0, one process per processor is used.
+	{
+	}
+
+	~ParallelGenerator()
+		/// Destroys the ParallelGenerator.
+	{
+	}
+
+	void add(const Job& job)
+		/// Adds a job, unless the header is up to date.
+	{
+		if (_cache.isUpToDate(job.header, job.hash))
+			++_skipped;
+		else
+			_jobs.push_back(job);
+	}
+
+	int run()
+		/// Runs all added jobs and returns the number of jobs that
+		/// failed. The cache is updated for all jobs that succeeded.
+	{
+		int failed = 0;
+		std::deque<Running> running;
+		while (!_jobs.empty() || !running.empty())
+		{
+			while (!_jobs.empty() && static_cast<int>(running.size()) < _processes)
+			{
+				Job& job = _jobs.front();
+				Poco::Process::Args args(job.args);
+				args.push_back(job.header);
+				running.push_back(Running(job, Poco::Process::launch(_command, args)));
+				_jobs.pop_front();
+			}
+			Running& oldest = running.front();
+			if (oldest.handle.wait() == 0)
+				_cache.update(oldest.job.header, oldest.job.hash, oldest.job.outputs);
+			else
+				++failed;
+			running.pop_front();
+		}
+		return failed;
+	}
+
+	int skipped() const
+		/// Returns the number of jobs skipped because
+		/// the header was up to date.
+	{
+		return _skipped;
+	}
+
+protected:
+	struct Running
+	{
+		Running(const Job& j, const Poco::ProcessHandle& h):
+			job(j),
+			handle(h)
+		{
+		}
+
+		Job job;
+		Poco::ProcessHandle handle;
+	};
+
+private:
+	ParallelGenerator(const ParallelGenerator&);
+	ParallelGenerator& operator = (const ParallelGenerator&);
+
+	std::string _command;
+	GenerationCache& _cache;
+	int _processes;
+	int _skipped;
+	std::deque<Job> _jobs;
+};
+
+
+} } // namespace Poco::CodeGeneration
+
+
+#endif // CodeGeneration_ParallelGenerator_INCLUDED
@@ -0,0 +1,469 @@
+//
+// ConcurrentObjectPool.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  ConcurrentObjectPool
+//
+// Definition of the ConcurrentObjectPool template class.
+//
+// Copyright (c) 2010-2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_ConcurrentObjectPool_INCLUDED
+#define Foundation_ConcurrentObjectPool_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/ObjectPool.h"
+#include "Poco/Mutex.h"
+#include <vector>
+#include <set>
+
+
+#if !defined(POCO_HAVE_GCC_ATOMICS) && !defined(__clang__)
+#error "ConcurrentObjectPool requires GCC atomic builtins"
+#endif
+
+
+#if !defined(POCO_NO_POOL_THREAD_CACHE) && __cplusplus >= 201103L
+#define POCO_POOL_THREAD_CACHE
+#endif
+
+
+namespace Poco {
+
+
+template <class C, class P = C*, class F = PoolableObjectFactory<C, P> >
+class ConcurrentObjectPool
+	/// An ObjectPool for pools shared by many threads.
+	///
+	/// Idle objects are kept in a bounded, lock-free, multi-producer
+	/// multi-consumer ring (see RingNotificationQueue) of the pool's
+	/// capacity, and the number of created objects is maintained with
+	/// atomic operations, so borrowing and returning objects never
+	/// take a lock.
+	///
+	/// With C++11, every thread additionally keeps up to MAGAZINE_SIZE
+	/// idle objects of up to MAX_THREAD_POOLS pools, so a thread
+	/// returning and borrowing objects usually does not even touch
+	/// the shared ring. Objects cached by a thread are returned to the
+	/// pool when the thread exits. Objects cached by other threads when
+	/// the pool is destroyed are never destroyed; thread caches are
+	/// therefore best used with pools living as long as the process
+	/// (define POCO_NO_POOL_THREAD_CACHE to disable them).
+	///
+	/// Like with ObjectPool, borrowObject() returns null if the peak
+	/// capacity has been reached. The PoolableObjectFactory is called
+	/// concurrently from multiple threads and must be thread-safe.
+{
+public:
+	enum
+	{
+		MAGAZINE_SIZE    = 8,
+		MAX_THREAD_POOLS = 4
+	};
+
+	ConcurrentObjectPool(std::size_t capacity, std::size_t peakCapacity):
+		/// Creates a new ConcurrentObjectPool with the given capacity
+		/// and peak capacity.
+		///
+		/// The PoolableObjectFactory must have a public default constructor.
+		_capacity(capacity),
+		_peakCapacity(peakCapacity),
+		_size(0),
+		_idle(0),
+		_cells(roundUp(capacity)),
+		_mask(_cells.size() - 1),
+		_enqueuePos(0),
+		_dequeuePos(0),
+		_id(nextId())
+	{
+		poco_assert (capacity <= peakCapacity);
+		init();
+	}
+
+	ConcurrentObjectPool(const F& factory, std::size_t capacity, std::size_t peakCapacity):
+		/// Creates a new ConcurrentObjectPool with the given PoolableObjectFactory,
+		/// capacity and peak capacity. The PoolableObjectFactory must have
+		/// a public copy constructor.
+		_factory(factory),
+		_capacity(capacity),
+		_peakCapacity(peakCapacity),
+		_size(0),
+		_idle(0),
+		_cells(roundUp(capacity)),
+		_mask(_cells.size() - 1),
+		_enqueuePos(0),
+		_dequeuePos(0),
+		_id(nextId())
+	{
+		poco_assert (capacity <= peakCapacity);
+		init();
+	}
+
+	~ConcurrentObjectPool()
+		/// Destroys the ConcurrentObjectPool and all idle
+		/// objects in the shared ring.
+	{
+		try
+		{
+			{
+				FastMutex::ScopedLock lock(registryMutex());
+				registry().erase(_id);
+			}
+			__sync_fetch_and_add(&generation(), 1);
+			P pObject;
+			while (tryDequeue(pObject))
+			{
+				_factory.destroyObject(pObject);
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	P borrowObject()
+		/// Obtains an object from the pool, or creates a new object if
+		/// possible.
+		///
+		/// Returns null if no object is available.
+		///
+		/// If activating the object fails, the object is destroyed and
+		/// the exception is passed on to the caller.
+	{
+		P pObject;
+#if defined(POCO_POOL_THREAD_CACHE)
+		Magazine* pMag = magazine();
+		if (pMag && pMag->count > 0)
+		{
+			pObject = pMag->objects[--pMag->count];
+			pMag->objects[pMag->count] = P();
+			return activateObject(pObject);
+		}
+#endif
+		if (tryDequeue(pObject))
+		{
+			return activateObject(pObject);
+		}
+		for (;;)
+		{
+			long n = _size;
+			if (static_cast<std::size_t>(n) >= _peakCapacity) return 0;
+			if (__sync_bool_compare_and_swap(&_size, n, n + 1)) break;
+		}
+		try
+		{
+			pObject = _factory.createObject();
+		}
+		catch (...)
+		{
+			__sync_fetch_and_sub(&_size, 1);
+			throw;
+		}
+		return activateObject(pObject);
+	}
+
+	P tryBorrowObject()
+		/// Same as borrowObject(), which never waits.
+	{
+		return borrowObject();
+	}
+
+	void returnObject(P pObject)
+		/// Returns an object to the pool.
+	{
+		if (_factory.validateObject(pObject))
+		{
+			_factory.deactivateObject(pObject);
+#if defined(POCO_POOL_THREAD_CACHE)
+			Magazine* pMag = magazine();
+			if (pMag && pMag->count < MAGAZINE_SIZE)
+			{
+				pMag->objects[pMag->count++] = pObject;
+				return;
+			}
+#endif
+			if (tryEnqueue(pObject)) return;
+		}
+		destroy(pObject);
+	}
+
+	void trim(std::size_t highWaterMark)
+		/// Destroys idle objects in the shared ring until at most
+		/// highWaterMark objects are left in it. Objects cached by
+		/// threads are not affected.
+	{
+		P pObject;
+		while (static_cast<std::size_t>(_idle) > highWaterMark && tryDequeue(pObject))
+		{
+			destroy(pObject);
+		}
+	}
+
+	std::size_t capacity() const
+	{
+		return _capacity;
+	}
+
+	std::size_t peakCapacity() const
+	{
+		return _peakCapacity;
+	}
+
+	std::size_t size() const
+		/// Returns the number of objects created by the pool
+		/// and not yet destroyed.
+	{
+		return static_cast<std::size_t>(_size);
+	}
+
+	std::size_t available() const
+		/// Returns the number of objects that can be borrowed,
+		/// not counting objects cached by threads. The result
+		/// may be outdated when it is returned.
+	{
+		long n = _idle + static_cast<long>(_peakCapacity) - _size;
+		return n > 0 ? static_cast<std::size_t>(n) : 0;
+	}
+
+protected:
+	P activateObject(P pObject)
+	{
+		try
+		{
+			_factory.activateObject(pObject);
+		}
+		catch (...)
+		{
+			destroy(pObject);
+			throw;
+		}
+		return pObject;
+	}
+
+private:
+	struct Cell
+	{
+		volatile long sequence;
+		P             object;
+	};
+
+	ConcurrentObjectPool();
+	ConcurrentObjectPool(const ConcurrentObjectPool&);
+	ConcurrentObjectPool& operator = (const ConcurrentObjectPool&);
+
+	void init()
+	{
+		for (std::size_t i = 0; i < _cells.size(); ++i)
+		{
+			_cells[i].sequence = static_cast<long>(i);
+		}
+		FastMutex::ScopedLock lock(registryMutex());
+		registry().insert(_id);
+	}
+
+	void destroy(P pObject)
+	{
+		_factory.destroyObject(pObject);
+		__sync_fetch_and_sub(&_size, 1);
+	}
+
+	static std::size_t roundUp(std::size_t capacity)
+	{
+		std::size_t n = 2;
+		while (n < capacity) n <<= 1;
+		return n;
+	}
+
+	bool tryEnqueue(P pObject)
+	{
+		if (__sync_add_and_fetch(&_idle, 1) > static_cast<long>(_capacity))
+		{
+			__sync_fetch_and_sub(&_idle, 1);
+			return false;
+		}
+		Cell* pCell;
+		long pos = _enqueuePos;
+		for (;;)
+		{
+			pCell = &_cells[pos & _mask];
+			long sequence = pCell->sequence;
+			__sync_synchronize();
+			long diff = sequence - pos;
+			if (diff == 0)
+			{
+				if (__sync_bool_compare_and_swap(&_enqueuePos, pos, pos + 1)) break;
+				pos = _enqueuePos;
+			}
+			else if (diff < 0)
+			{
+				__sync_fetch_and_sub(&_idle, 1);
+				return false;
+			}
+			else pos = _enqueuePos;
+		}
+		pCell->object = pObject;
+		__sync_synchronize();
+		pCell->sequence = pos + 1;
+		return true;
+	}
+
+	bool tryDequeue(P& pObject)
+	{
+		Cell* pCell;
+		long pos = _dequeuePos;
+		for (;;)
+		{
+			pCell = &_cells[pos & _mask];
+			long sequence = pCell->sequence;
+			__sync_synchronize();
+			long diff = sequence - (pos + 1);
+			if (diff == 0)
+			{
+				if (__sync_bool_compare_and_swap(&_dequeuePos, pos, pos + 1)) break;
+				pos = _dequeuePos;
+			}
+			else if (diff < 0) return false;
+			else pos = _dequeuePos;
+		}
+		pObject = pCell->object;
+		pCell->object = P();
+		__sync_synchronize();
+		pCell->sequence = pos + static_cast<long>(_mask) + 1;
+		__sync_fetch_and_sub(&_idle, 1);
+		return true;
+	}
+
+	static Poco::UInt64 nextId()
+	{
+		static Poco::UInt64 id = 0;
+		return __sync_add_and_fetch(&id, 1);
+	}
+
+	static FastMutex& registryMutex()
+	{
+		static FastMutex mutex;
+		return mutex;
+	}
+
+	static std::set<Poco::UInt64>& registry()
+		/// The ids of the live pools, used by exiting threads
+		/// to find out whether a pool still exists.
+	{
+		static std::set<Poco::UInt64> ids;
+		return ids;
+	}
+
+	static volatile int& generation()
+		/// Incremented whenever a pool is destroyed.
+	{
+		static volatile int gen = 0;
+		return gen;
+	}
+
+#if defined(POCO_POOL_THREAD_CACHE)
+	struct Magazine
+	{
+		Magazine():
+			id(0),
+			pPool(0),
+			count(0)
+		{
+		}
+
+		Poco::UInt64          id;
+		ConcurrentObjectPool* pPool;
+		int                   count;
+		P                     objects[MAGAZINE_SIZE];
+	};
+
+	struct Cache
+	{
+		Cache():
+			generation(-1)
+		{
+		}
+
+		~Cache()
+		{
+			FastMutex::ScopedLock lock(registryMutex());
+			for (int i = 0; i < MAX_THREAD_POOLS; ++i)
+			{
+				Magazine& mag = magazines[i];
+				if (mag.count > 0 && registry().count(mag.id))
+				{
+					while (mag.count > 0)
+					{
+						P pObject = mag.objects[--mag.count];
+						if (!mag.pPool->tryEnqueue(pObject)) mag.pPool->destroy(pObject);
+					}
+				}
+			}
+		}
+
+		Magazine magazines[MAX_THREAD_POOLS];
+		int      generation;
+	};
+
+	Magazine* magazine()
+	{
+		static thread_local Cache cache;
+		for (int i = 0; i < MAX_THREAD_POOLS; ++i)
+		{
+			if (cache.magazines[i].id == _id) return &cache.magazines[i];
+		}
+		// Claim a free magazine, or one of a pool that no longer
+		// exists, which needs the registry and is only tried after
+		// a pool has been destroyed. Objects left in a magazine of
+		// a destroyed pool are abandoned.
+		Magazine* pFree = 0;
+		for (int i = 0; i < MAX_THREAD_POOLS && !pFree; ++i)
+		{
+			if (cache.magazines[i].id == 0) pFree = &cache.magazines[i];
+		}
+		if (!pFree && cache.generation != generation())
+		{
+			FastMutex::ScopedLock lock(registryMutex());
+			cache.generation = generation();
+			for (int i = 0; i < MAX_THREAD_POOLS && !pFree; ++i)
+			{
+				if (!registry().count(cache.magazines[i].id)) pFree = &cache.magazines[i];
+			}
+		}
+		if (pFree)
+		{
+			for (int k = 0; k < MAGAZINE_SIZE; ++k) pFree->objects[k] = P();
+			pFree->id    = _id;
+			pFree->pPool = this;
+			pFree->count = 0;
+		}
+		return pFree;
+	}
+#endif
+
+	F _factory;
+	std::size_t _capacity;
+	std::size_t _peakCapacity;
+	volatile long _size;
+	volatile long _idle;
+	std::vector<Cell> _cells;
+	std::size_t _mask;
+	volatile long _enqueuePos;
+	volatile long _dequeuePos;
+	Poco::UInt64 _id;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_ConcurrentObjectPool_INCLUDED
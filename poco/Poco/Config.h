@@ -89,6 +89,11 @@
 // !!! Only comment this out if your compiler has support  !!!
 // !!! for std::aligned_storage.                           !!!
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+//
+// Small object optimization changes the layout of Any and
+// Dynamic::Var. Define POCO_ENABLE_SOO for applications only
+// if the POCO libraries they link with (Foundation, JSON,
+// RemotingNG, ...) have been built with POCO_ENABLE_SOO, too.
 // 
 #ifndef POCO_ENABLE_SOO
 #define POCO_NO_SOO
@@ -0,0 +1,755 @@
+//
+// Coroutine.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  Coroutine
+//
+// Definition of the CoTask, CoroutineScheduler and CoNotificationQueue classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_Coroutine_INCLUDED
+#define Foundation_Coroutine_INCLUDED
+
+
+#include "Poco/Foundation.h"
+
+
+#if defined(__cpp_impl_coroutine) && __cplusplus >= 202002L
+
+
+#include "Poco/ThreadPool.h"
+#include "Poco/Runnable.h"
+#include "Poco/ActiveResult.h"
+#include "Poco/NotificationQueue.h"
+#include "Poco/Notification.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/SingletonHolder.h"
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <type_traits>
+#include <deque>
+#include <vector>
+
+
+namespace Poco {
+
+
+class CoroutineScheduler
+	/// Resumes coroutines on a fixed number of threads taken
+	/// from a ThreadPool, so that any number of suspended
+	/// coroutines waiting for an ActiveResult, a notification
+	/// or a blocking call only occupy their coroutine frame,
+	/// instead of a thread and its stack each.
+	///
+	/// Blocking functions, such as synchronous RemotingNG proxy
+	/// calls, are run with call() on a separate, fixed number of
+	/// threads; coroutines waiting for them are queued without
+	/// occupying a thread.
+	///
+	///     CoTask<void> refresh(IConnManagerService::Ptr pService)
+	///     {
+	///         ConMgrResult<int> cells = co_await pService->getCellularNbCellsAsync();
+	///         std::string status = co_await CoroutineScheduler::defaultScheduler().call(
+	///             [&] { return proxy->status(); });
+	///         ...
+	///     }
+	///
+	///     CoroutineScheduler::defaultScheduler().spawn(refresh(pService));
+	///
+	/// Coroutines must not block; they are resumed on the threads
+	/// of the scheduler.
+{
+public:
+	enum
+	{
+		DEFAULT_THREADS = 2,
+		DEFAULT_BLOCKING_THREADS = 2
+	};
+
+	explicit CoroutineScheduler(int threads = DEFAULT_THREADS, int blockingThreads = DEFAULT_BLOCKING_THREADS, ThreadPool& pool = ThreadPool::defaultPool()):
+		_stop(false),
+		_active(0)
+		/// Creates the scheduler, starting threads + blockingThreads
+		/// runners in the given pool. Throws a NoThreadAvailableException
+		/// if the pool has not enough threads.
+	{
+		if (threads < 1) threads = 1;
+		for (int i = 0; i < threads + blockingThreads; ++i)
+		{
+			_runners.push_back(new Runner(*this, i >= threads));
+		}
+		try
+		{
+			for (std::vector<Runner*>::iterator it = _runners.begin(); it != _runners.end(); ++it)
+			{
+				{
+					FastMutex::ScopedLock lock(_mutex);
+					++_active;
+				}
+				try
+				{
+					pool.start(**it, "CoroutineScheduler");
+				}
+				catch (...)
+				{
+					FastMutex::ScopedLock lock(_mutex);
+					--_active;
+					throw;
+				}
+			}
+		}
+		catch (...)
+		{
+			shutdown();
+			throw;
+		}
+	}
+
+	~CoroutineScheduler()
+		/// Stops the runners. Coroutines still suspended
+		/// are never resumed.
+	{
+		shutdown();
+	}
+
+	void schedule(std::coroutine_handle<> handle)
+		/// Queues the coroutine for resumption.
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_ready.push_back(handle);
+		}
+		_readyAvailable.signal();
+	}
+
+	template <class Task>
+	void spawn(Task task)
+		/// Starts a CoTask without waiting for its completion.
+		/// The coroutine frame is destroyed when the coroutine
+		/// returns; an exception leaving it goes to the ErrorHandler.
+	{
+		schedule(task.detach());
+	}
+
+	auto yield()
+		/// Returns an awaitable that reschedules the awaiting
+		/// coroutine, letting other coroutines run. Awaiting it
+		/// from a thread not owned by the scheduler moves the
+		/// coroutine to the scheduler.
+	{
+		struct Awaiter
+		{
+			CoroutineScheduler& scheduler;
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				scheduler.schedule(handle);
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+		};
+		return Awaiter{*this};
+	}
+
+	template <class Fn>
+	auto call(Fn fn)
+		/// Returns an awaitable that runs fn on one of the blocking
+		/// threads and resumes the awaiting coroutine with its result,
+		/// or rethrows its exception.
+	{
+		typedef decltype(fn()) R;
+
+		struct Awaiter
+		{
+			CoroutineScheduler& scheduler;
+			Fn fn;
+			std::conditional_t<std::is_void_v<R>, bool, std::optional<R>> value;
+			std::exception_ptr exc;
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				scheduler.block([this, handle]()
+				{
+					try
+					{
+						if constexpr (std::is_void_v<R>)
+							fn();
+						else
+							value.emplace(fn());
+					}
+					catch (...)
+					{
+						exc = std::current_exception();
+					}
+					scheduler.schedule(handle);
+				});
+			}
+
+			R await_resume()
+			{
+				if (exc) std::rethrow_exception(exc);
+				if constexpr (!std::is_void_v<R>) return std::move(*value);
+			}
+		};
+		return Awaiter{*this, std::move(fn), {}, {}};
+	}
+
+	static CoroutineScheduler& defaultScheduler()
+		/// Returns the default CoroutineScheduler.
+	{
+		static SingletonHolder<CoroutineScheduler> sh;
+		return *sh.get();
+	}
+
+private:
+	class Runner: public Runnable
+	{
+	public:
+		Runner(CoroutineScheduler& scheduler, bool blocking):
+			_scheduler(scheduler),
+			_blocking(blocking)
+		{
+		}
+
+		void run()
+		{
+			if (_blocking) _scheduler.runBlocking();
+			else _scheduler.runReady();
+			_scheduler.runnerDone();
+		}
+
+	private:
+		CoroutineScheduler& _scheduler;
+		bool _blocking;
+	};
+
+	CoroutineScheduler(const CoroutineScheduler&);
+	CoroutineScheduler& operator = (const CoroutineScheduler&);
+
+	void block(std::function<void()> job)
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_blocking.push_back(std::move(job));
+		}
+		_blockingAvailable.signal();
+	}
+
+	void runReady()
+	{
+		for (;;)
+		{
+			std::coroutine_handle<> handle;
+			{
+				FastMutex::ScopedLock lock(_mutex);
+				while (_ready.empty() && !_stop) _readyAvailable.wait(_mutex);
+				if (_stop) return;
+				handle = _ready.front();
+				_ready.pop_front();
+			}
+			handle.resume();
+		}
+	}
+
+	void runBlocking()
+	{
+		for (;;)
+		{
+			std::function<void()> job;
+			{
+				FastMutex::ScopedLock lock(_mutex);
+				while (_blocking.empty() && !_stop) _blockingAvailable.wait(_mutex);
+				if (_stop) return;
+				job = std::move(_blocking.front());
+				_blocking.pop_front();
+			}
+			job();
+		}
+	}
+
+	void runnerDone()
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		--_active;
+		_stopped.broadcast();
+	}
+
+	void shutdown()
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_stop = true;
+		}
+		_readyAvailable.broadcast();
+		_blockingAvailable.broadcast();
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			while (_active > 0) _stopped.wait(_mutex);
+		}
+		for (std::vector<Runner*>::iterator it = _runners.begin(); it != _runners.end(); ++it)
+		{
+			delete *it;
+		}
+		_runners.clear();
+	}
+
+	std::vector<Runner*>                _runners;
+	std::deque<std::coroutine_handle<> > _ready;
+	std::deque<std::function<void()> >  _blocking;
+	bool      _stop;
+	int       _active;
+	FastMutex _mutex;
+	Condition _readyAvailable;
+	Condition _blockingAvailable;
+	Condition _stopped;
+};
+
+
+template <class T>
+class CoTask;
+
+
+class CoPromiseBase
+	/// The part of the promise type of CoTask
+	/// not depending on the result type.
+{
+public:
+	std::suspend_always initial_suspend() const noexcept
+	{
+		return {};
+	}
+
+	struct FinalAwaiter
+	{
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		template <class Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			CoPromiseBase& promise = handle.promise();
+			if (promise._continuation) return promise._continuation;
+			if (promise._detached)
+			{
+				if (promise._exception)
+				{
+					try
+					{
+						std::rethrow_exception(promise._exception);
+					}
+					catch (Exception& exc)
+					{
+						ErrorHandler::handle(exc);
+					}
+					catch (std::exception& exc)
+					{
+						ErrorHandler::handle(exc);
+					}
+					catch (...)
+					{
+						ErrorHandler::handle();
+					}
+				}
+				handle.destroy();
+			}
+			return std::noop_coroutine();
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	FinalAwaiter final_suspend() const noexcept
+	{
+		return {};
+	}
+
+	void unhandled_exception() noexcept
+	{
+		_exception = std::current_exception();
+	}
+
+protected:
+	void rethrow() const
+	{
+		if (_exception) std::rethrow_exception(_exception);
+	}
+
+	std::coroutine_handle<> _continuation;
+	std::exception_ptr      _exception;
+	bool                    _detached = false;
+
+	template <class T>
+	friend class CoTask;
+};
+
+
+template <class T>
+class CoPromise: public CoPromiseBase
+	/// The promise type of CoTask<T>.
+{
+public:
+	CoTask<T> get_return_object() noexcept;
+
+	template <class U>
+	void return_value(U&& value)
+	{
+		_value.emplace(std::forward<U>(value));
+	}
+
+	T result()
+	{
+		rethrow();
+		return std::move(*_value);
+	}
+
+private:
+	std::optional<T> _value;
+};
+
+
+template <>
+class CoPromise<void>: public CoPromiseBase
+	/// The promise type of CoTask<void>.
+{
+public:
+	CoTask<void> get_return_object() noexcept;
+
+	void return_void() const noexcept
+	{
+	}
+
+	void result()
+	{
+		rethrow();
+	}
+};
+
+
+template <class T>
+class CoTask
+	/// A lazily started coroutine returning T.
+	///
+	/// The coroutine starts when the CoTask is awaited from
+	/// another coroutine, or when it is passed to
+	/// CoroutineScheduler::spawn().
+{
+public:
+	typedef CoPromise<T> promise_type;
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	explicit CoTask(Handle handle) noexcept:
+		_handle(handle)
+	{
+	}
+
+	CoTask(CoTask&& other) noexcept:
+		_handle(std::exchange(other._handle, Handle()))
+	{
+	}
+
+	CoTask& operator = (CoTask&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (_handle) _handle.destroy();
+			_handle = std::exchange(other._handle, Handle());
+		}
+		return *this;
+	}
+
+	~CoTask()
+	{
+		if (_handle) _handle.destroy();
+	}
+
+	auto operator co_await () && noexcept
+		/// Starts the coroutine and suspends the awaiting
+		/// coroutine until it returns.
+	{
+		struct Awaiter
+		{
+			Handle handle;
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+			{
+				handle.promise()._continuation = awaiting;
+				return handle;
+			}
+
+			T await_resume()
+			{
+				return handle.promise().result();
+			}
+		};
+		return Awaiter{_handle};
+	}
+
+	Handle detach() noexcept
+		/// Releases the coroutine, which destroys its frame
+		/// when it returns. For use by CoroutineScheduler::spawn().
+	{
+		_handle.promise()._detached = true;
+		return std::exchange(_handle, Handle());
+	}
+
+private:
+	CoTask(const CoTask&);
+	CoTask& operator = (const CoTask&);
+
+	Handle _handle;
+};
+
+
+template <class T>
+inline CoTask<T> CoPromise<T>::get_return_object() noexcept
+{
+	return CoTask<T>(CoTask<T>::Handle::from_promise(*this));
+}
+
+
+inline CoTask<void> CoPromise<void>::get_return_object() noexcept
+{
+	return CoTask<void>(CoTask<void>::Handle::from_promise(*this));
+}
+
+
+template <class T>
+class ActiveResultAwaiter
+	/// Suspends the awaiting coroutine until an ActiveResult is
+	/// available, using ActiveResult::then(), and resumes it on a
+	/// CoroutineScheduler. Returned by operator co_await for
+	/// ActiveResult.
+{
+public:
+	ActiveResultAwaiter(const ActiveResult<T>& result, CoroutineScheduler& scheduler):
+		_result(result),
+		_scheduler(scheduler)
+	{
+	}
+
+	bool await_ready() const
+	{
+		return _result.available();
+	}
+
+	void await_suspend(std::coroutine_handle<> handle)
+	{
+		CoroutineScheduler* pScheduler = &_scheduler;
+		_result.then([pScheduler, handle](ActiveResult<T>&) { pScheduler->schedule(handle); });
+	}
+
+	T await_resume()
+	{
+		if (_result.failed()) _result.exception()->rethrow();
+		if constexpr (!std::is_void_v<T>) return _result.data();
+	}
+
+private:
+	ActiveResult<T>     _result;
+	CoroutineScheduler& _scheduler;
+};
+
+
+template <class T>
+inline ActiveResultAwaiter<T> operator co_await (const ActiveResult<T>& result)
+	/// Awaits an ActiveResult, resuming on the default CoroutineScheduler.
+{
+	return ActiveResultAwaiter<T>(result, CoroutineScheduler::defaultScheduler());
+}
+
+
+class CoNotificationQueue
+	/// Lets coroutines await notifications from a NotificationQueue.
+	///
+	/// A single runner, started in a ThreadPool, waits for the queue
+	/// and hands every notification to the coroutine waiting longest,
+	/// or keeps it until a coroutine awaits dequeue(). The queue must
+	/// not be used by other consumers.
+{
+public:
+	CoNotificationQueue(NotificationQueue& queue, CoroutineScheduler& scheduler = CoroutineScheduler::defaultScheduler(), ThreadPool& pool = ThreadPool::defaultPool()):
+		_queue(queue),
+		_scheduler(scheduler),
+		_pump(*this),
+		_stop(false),
+		_running(true)
+		/// Creates the CoNotificationQueue and starts its runner.
+	{
+		pool.start(_pump, "CoNotificationQueue");
+	}
+
+	~CoNotificationQueue()
+		/// Stops the runner. Coroutines still waiting
+		/// are resumed with a null notification.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_stop = true;
+		while (_running)
+		{
+			// the runner may be busy and miss a single wakeUpAll()
+			_queue.wakeUpAll();
+			_stopped.tryWait(_mutex, 100);
+		}
+	}
+
+	auto dequeue()
+		/// Returns an awaitable yielding the next notification, or
+		/// null if the CoNotificationQueue is being destroyed.
+	{
+		struct Awaiter
+		{
+			CoNotificationQueue& queue;
+			Notification::Ptr pNf;
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle)
+			{
+				return queue.wait(handle, pNf);
+			}
+
+			Notification::Ptr await_resume()
+			{
+				return pNf;
+			}
+		};
+		return Awaiter{*this, Notification::Ptr()};
+	}
+
+private:
+	struct Waiter
+	{
+		std::coroutine_handle<> handle;
+		Notification::Ptr*      pNf;
+	};
+
+	class Pump: public Runnable
+	{
+	public:
+		Pump(CoNotificationQueue& queue):
+			_queue(queue)
+		{
+		}
+
+		void run()
+		{
+			_queue.pump();
+		}
+
+	private:
+		CoNotificationQueue& _queue;
+	};
+
+	CoNotificationQueue(const CoNotificationQueue&);
+	CoNotificationQueue& operator = (const CoNotificationQueue&);
+
+	bool wait(std::coroutine_handle<> handle, Notification::Ptr& pNf)
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_buffer.empty())
+		{
+			pNf = _buffer.front();
+			_buffer.pop_front();
+			return false;
+		}
+		if (_stop) return false;
+		Waiter waiter = {handle, &pNf};
+		_waiters.push_back(waiter);
+		return true;
+	}
+
+	void pump()
+	{
+		for (;;)
+		{
+			Notification::Ptr pNf(_queue.waitDequeueNotification());
+			std::vector<std::coroutine_handle<> > resume;
+			{
+				FastMutex::ScopedLock lock(_mutex);
+				if (!pNf && _stop)
+				{
+					for (std::deque<Waiter>::iterator it = _waiters.begin(); it != _waiters.end(); ++it)
+					{
+						resume.push_back(it->handle);
+					}
+					_waiters.clear();
+					for (std::vector<std::coroutine_handle<> >::iterator it = resume.begin(); it != resume.end(); ++it)
+					{
+						_scheduler.schedule(*it);
+					}
+					_running = false;
+					_stopped.broadcast();
+					return;
+				}
+				if (!pNf) continue;
+				if (_waiters.empty())
+				{
+					_buffer.push_back(pNf);
+					continue;
+				}
+				Waiter waiter = _waiters.front();
+				_waiters.pop_front();
+				*waiter.pNf = pNf;
+				resume.push_back(waiter.handle);
+			}
+			_scheduler.schedule(resume.front());
+		}
+	}
+
+	NotificationQueue&            _queue;
+	CoroutineScheduler&           _scheduler;
+	Pump                          _pump;
+	std::deque<Waiter>            _waiters;
+	std::deque<Notification::Ptr> _buffer;
+	bool      _stop;
+	bool      _running;
+	FastMutex _mutex;
+	Condition _stopped;
+};
+
+
+} // namespace Poco
+
+
+#endif // __cpp_impl_coroutine
+
+
+#endif // Foundation_Coroutine_INCLUDED
@@ -0,0 +1,145 @@
+//
+// AEADCipher.h
+//
+// Library: Crypto
+// Package: Cipher
+// Module:  AEADCipher
+//
+// Definition of the AEADCipher class.
+//
+// Copyright (c) 2008, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Crypto_AEADCipher_INCLUDED
+#define Crypto_AEADCipher_INCLUDED
+
+
+#include "Poco/Crypto/Crypto.h"
+#include "Poco/Crypto/Cipher.h"
+#include "Poco/Crypto/CipherKey.h"
+#include "Poco/Crypto/EVPTransform.h"
+#include "Poco/Crypto/CryptoException.h"
+#include "Poco/Crypto/OpenSSLInitializer.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Exception.h"
+#include <cstring>
+
+
+namespace Poco {
+namespace Crypto {
+
+
+class AEADCipher: public Cipher
+	/// A Cipher for authenticated encryption with associated data,
+	/// like "aes-128-gcm", "aes-256-gcm" or "chacha20-poly1305".
+	///
+	/// In addition to the stream based interface, AEADCipher encrypts
+	/// and decrypts messages in place, in a contiguous buffer, with
+	/// a nonce given per message:
+	///
+	///     AEADCipher::Ptr pCipher = CipherFactory::defaultFactory().createAEADCipher(CipherKey("chacha20-poly1305", key, iv));
+	///     unsigned char tag[AEADCipher::TAG_SIZE];
+	///     pCipher->seal(nonce, header, headerSize, payload, payloadSize, tag);
+	///     ...
+	///     if (!pCipher->open(nonce, header, headerSize, payload, payloadSize, tag))
+	///         throw Poco::DataException("corrupt payload");
+	///
+	/// A nonce must never be used twice with the same key.
+	///
+	/// seal() and open() can be called by several threads at the same time.
+	/// To encrypt many small messages on one thread, keep an EVPTransform
+	/// from createEncryptor() or createDecryptor() and start every message
+	/// with EVPTransform::reset().
+{
+public:
+	typedef Poco::AutoPtr<AEADCipher> Ptr;
+
+	enum
+	{
+		TAG_SIZE = 16
+	};
+
+	explicit AEADCipher(const CipherKey& key):
+		_key(key)
+		/// Creates the AEADCipher for the given key. Throws an
+		/// InvalidArgumentException if the cipher is not an AEAD cipher.
+	{
+		const EVP_CIPHER* pCipher = _key.impl()->cipher();
+		if (EVP_CIPHER_mode(pCipher) != EVP_CIPH_GCM_MODE && (EVP_CIPHER_flags(pCipher) & EVP_CIPH_FLAG_AEAD_CIPHER) == 0)
+			throw Poco::InvalidArgumentException("Not an AEAD cipher", _key.name());
+	}
+
+	~AEADCipher()
+		/// Destroys the AEADCipher.
+	{
+	}
+
+	void seal(const ByteVec& nonce, const unsigned char* aad, std::size_t aadLength, unsigned char* data, std::size_t length, unsigned char* tag, std::size_t tagLength = TAG_SIZE)
+		/// Encrypts length bytes at data in place, authenticating them
+		/// together with aadLength bytes of additional data at aad, and
+		/// stores the authentication tag at tag.
+	{
+		EVPTransform transform(_key.impl()->cipher(), _key.getKey(), nonce, EVPTransform::DIR_ENCRYPT);
+		if (aadLength > 0) transform.setAAD(aad, aadLength);
+		transform.transform(data, length);
+		transform.finalize();
+		std::string t = transform.getTag(tagLength);
+		std::memcpy(tag, t.data(), tagLength);
+	}
+
+	bool open(const ByteVec& nonce, const unsigned char* aad, std::size_t aadLength, unsigned char* data, std::size_t length, const unsigned char* tag, std::size_t tagLength = TAG_SIZE)
+		/// Decrypts length bytes at data in place and verifies them,
+		/// together with aadLength bytes of additional data at aad,
+		/// against the authentication tag at tag.
+		///
+		/// Returns false if the data or the tag have been modified, in
+		/// which case the contents of the buffer must not be used.
+	{
+		EVPTransform transform(_key.impl()->cipher(), _key.getKey(), nonce, EVPTransform::DIR_DECRYPT);
+		if (aadLength > 0) transform.setAAD(aad, aadLength);
+		transform.setTag(std::string(reinterpret_cast<const char*>(tag), tagLength));
+		transform.transform(data, length);
+		try
+		{
+			transform.finalize();
+		}
+		catch (CryptoException&)
+		{
+			return false;
+		}
+		return true;
+	}
+
+	// Cipher
+	const std::string& name() const
+	{
+		return _key.name();
+	}
+
+	EVPTransform* createEncryptor()
+	{
+		return new EVPTransform(_key.impl()->cipher(), _key.getKey(), _key.getIV(), EVPTransform::DIR_ENCRYPT);
+	}
+
+	EVPTransform* createDecryptor()
+	{
+		return new EVPTransform(_key.impl()->cipher(), _key.getKey(), _key.getIV(), EVPTransform::DIR_DECRYPT);
+	}
+
+private:
+	AEADCipher(const AEADCipher&);
+	AEADCipher& operator = (const AEADCipher&);
+
+	CipherKey _key;
+	OpenSSLInitializer _openSSLInitializer;
+};
+
+
+} } // namespace Poco::Crypto
+
+
+#endif // Crypto_AEADCipher_INCLUDED
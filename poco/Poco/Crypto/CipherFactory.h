@@ -19,6 +19,7 @@
 
 
 #include "Poco/Crypto/Crypto.h"
+#include "Poco/Crypto/AEADCipher.h"
 
 
 namespace Poco {
@@ -59,6 +60,13 @@ public:
 	Cipher* createCipher(const RSAKey& key, RSAPaddingMode paddingMode = RSA_PADDING_PKCS1);
 		/// Creates a RSACipher using the given RSA key and padding mode
 		/// for public key encryption/private key decryption.
+
+	AEADCipher* createAEADCipher(const CipherKey& key);
+		/// Creates an AEADCipher for the given authenticated encryption
+		/// cipher, like "aes-128-gcm", "aes-256-gcm" or "chacha20-poly1305".
+		///
+		/// Throws an InvalidArgumentException if the cipher given by
+		/// the key is not an AEAD cipher.
 	
 	static CipherFactory& defaultFactory();
 		/// Returns the default CipherFactory.
@@ -69,6 +77,15 @@ private:
 };
 
 
+//
+// inlines
+//
+inline AEADCipher* CipherFactory::createAEADCipher(const CipherKey& key)
+{
+	return new AEADCipher(key);
+}
+
+
 } } // namespace Poco::Crypto
 
 
@@ -0,0 +1,917 @@
+//
+// CompactDocument.h
+//
+// $Id$
+//
+// Library: XML
+// Package: DOM
+// Module:  CompactDocument
+//
+// Definition of the CompactDocument and CompactNode classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef DOM_CompactDocument_INCLUDED
+#define DOM_CompactDocument_INCLUDED
+
+
+#include "Poco/XML/XML.h"
+#include "Poco/XML/XMLPullParser.h"
+#include "Poco/XML/XMLString.h"
+#include "Poco/DOM/Node.h"
+#include "Poco/NumberParser.h"
+#include "Poco/FileStream.h"
+#include "Poco/Types.h"
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstring>
+#include <algorithm>
+#include <istream>
+
+
+#if !defined(XML_UNICODE)
+
+
+namespace Poco {
+namespace XML {
+
+
+class CompactDocument;
+
+
+class CompactNode
+	/// A CompactNode refers to an element, attribute, text, CDATA section,
+	/// comment or processing instruction of a CompactDocument, or to the
+	/// document itself. CompactNode objects are small values that are
+	/// copied, not allocated; they are only valid as long as their
+	/// document.
+	///
+	/// A null CompactNode (see isNull()) is returned for nodes that
+	/// don't exist, e.g. by firstChild() of an empty element.
+{
+public:
+	CompactNode();
+		/// Creates a null CompactNode.
+
+	bool isNull() const;
+		/// Returns true if the node does not refer to a node.
+
+	unsigned short nodeType() const;
+		/// Returns the type of the node, using the constants of Node,
+		/// e.g. Node::ELEMENT_NODE.
+
+	const XMLString& nodeName() const;
+		/// Returns the qualified name of an element or attribute, or the
+		/// target of a processing instruction. For other nodes, returns
+		/// an empty string.
+
+	const XMLString& localName() const;
+		/// Returns the local name of an element or attribute.
+
+	const XMLString& namespaceURI() const;
+		/// Returns the namespace URI of an element or attribute.
+
+	const char* value() const;
+		/// Returns the value of an attribute, the text of a text, CDATA
+		/// section or comment node, or the data of a processing instruction,
+		/// as a zero-terminated string, or an empty string for other nodes.
+
+	std::size_t valueLength() const;
+		/// Returns the length of value().
+
+	XMLString getNodeValue() const;
+		/// Returns value() as a string.
+
+	CompactNode parentNode() const;
+		/// Returns the parent node, or the element of an attribute.
+
+	CompactNode firstChild() const;
+		/// Returns the first child node.
+
+	CompactNode lastChild() const;
+		/// Returns the last child node.
+
+	CompactNode nextSibling() const;
+		/// Returns the next sibling node.
+
+	CompactNode getChildElement(const XMLString& name) const;
+		/// Returns the first child element with the given qualified name.
+
+	CompactNode nextElement() const;
+		/// Returns the next sibling element with the same name.
+
+	std::size_t attributeCount() const;
+		/// Returns the number of attributes of an element.
+
+	CompactNode attribute(std::size_t index) const;
+		/// Returns the attribute with the given index.
+
+	bool hasAttribute(const XMLString& name) const;
+		/// Returns true if the element has an attribute with the given
+		/// qualified name.
+
+	const char* getAttribute(const XMLString& name) const;
+		/// Returns the value of the attribute with the given qualified
+		/// name, or an empty string if the element has no such attribute.
+
+	XMLString innerText() const;
+		/// Returns the text of all text and CDATA section descendants.
+
+	CompactNode getNodeByPath(const XMLString& path) const;
+		/// Searches a node (element or attribute) based on the simplified
+		/// XPath expressions supported by Node::getNodeByPath(), starting
+		/// at this node.
+
+	bool operator == (const CompactNode& node) const;
+	bool operator != (const CompactNode& node) const;
+
+private:
+	CompactNode(const CompactDocument* pDocument, Poco::UInt32 index, bool isAttribute);
+
+	const CompactDocument* _pDocument;
+	Poco::UInt32 _index;
+	bool _isAttribute;
+
+	friend class CompactDocument;
+};
+
+
+class CompactDocument
+	/// CompactDocument is a read-only document object model for
+	/// documents that are loaded once and then only queried, like
+	/// configuration files, extensions.xml and bundle manifests.
+	///
+	/// Compared to Document, it does not allocate and reference count
+	/// every node. Nodes and attributes are stored in two arrays and
+	/// refer to each other by index. All text and attribute values are
+	/// stored in a document-scoped arena, and every distinct name is
+	/// stored only once. Destroying the document releases a few large
+	/// blocks instead of walking all nodes.
+	///
+	/// For each element, the children with the same name are linked and
+	/// indexed by name, so that getNodeByPath() and getChildElement() do
+	/// not compare the names of all siblings.
+	///
+	///     CompactDocument doc;
+	///     doc.parse(istr);
+	///     CompactNode ext = doc.getNodeByPath("/extensions/extension[@point='osp.web.server.directory']");
+	///     std::string path = ext.getAttribute("path");
+	///
+	/// The document is read with XMLPullParser, with namespace
+	/// processing enabled.
+{
+public:
+	enum
+	{
+		BLOCK_SIZE = 16384
+	};
+
+	explicit CompactDocument(bool filterWhitespace = false):
+		_filterWhitespace(filterWhitespace),
+		_pBlock(0),
+		_available(0),
+		_arenaSize(0)
+		/// Creates an empty CompactDocument. If filterWhitespace is true,
+		/// text nodes that only contain white space are not stored.
+	{
+		clear();
+	}
+
+	~CompactDocument()
+		/// Destroys the CompactDocument and all its nodes.
+	{
+		releaseArena();
+	}
+
+	void parse(std::istream& istr)
+		/// Reads the document from the given stream.
+	{
+		XMLPullParser parser(istr);
+		parse(parser);
+	}
+
+	void parse(const XMLString& path)
+		/// Reads the document from the file with the given path.
+	{
+		Poco::FileInputStream istr(path);
+		parse(istr);
+	}
+
+	void parseMemory(const char* xml, std::size_t size)
+		/// Reads the document from the given buffer.
+	{
+		XMLPullParser parser(xml, size);
+		parse(parser);
+	}
+
+	void parseString(const std::string& xml)
+		/// Reads the document from the given string.
+	{
+		parseMemory(xml.data(), xml.size());
+	}
+
+	void parse(XMLPullParser& parser)
+		/// Reads the document from the given parser, replacing the
+		/// current content of the document.
+	{
+		clear();
+		std::map<const XMLPullParser::Name*, Poco::UInt32> names;
+		std::map<Poco::UInt64, Poco::UInt32> lastByName;
+		std::vector<Poco::UInt32> stack;
+		stack.push_back(0);
+		bool cdata = false;
+		for (;;)
+		{
+			switch (parser.next())
+			{
+			case XMLPullParser::START_ELEMENT:
+				{
+					Poco::UInt32 index = addNode(Node::ELEMENT_NODE, stack.back());
+					NodeData& node = _nodes[index];
+					node.name = nameId(names, parser.name());
+					node.firstAttribute = static_cast<Poco::UInt32>(_attributes.size());
+					node.attributeCount = static_cast<Poco::UInt32>(parser.attributeCount());
+					for (std::size_t i = 0; i < parser.attributeCount(); ++i)
+					{
+						AttributeData attribute;
+						attribute.element = index;
+						attribute.name = nameId(names, parser.attributeName(i));
+						attribute.value = copy(parser.attributeValue(i), parser.attributeLength(i));
+						attribute.length = static_cast<Poco::UInt32>(parser.attributeLength(i));
+						_attributes.push_back(attribute);
+					}
+					Poco::UInt64 key = (static_cast<Poco::UInt64>(stack.back()) << 32) | _names[node.name].qnameId;
+					std::map<Poco::UInt64, Poco::UInt32>::iterator it = lastByName.find(key);
+					if (it == lastByName.end())
+					{
+						lastByName[key] = index;
+						_firstByName.push_back(std::make_pair(key, index));
+					}
+					else
+					{
+						_nodes[it->second].nextSameName = index;
+						it->second = index;
+					}
+					stack.push_back(index);
+				}
+				break;
+			case XMLPullParser::END_ELEMENT:
+				stack.pop_back();
+				break;
+			case XMLPullParser::CHARACTERS:
+				if (!_filterWhitespace || cdata || !isWhitespace(parser.text(), parser.textLength()))
+				{
+					Poco::UInt32 index = addNode(cdata ? Node::CDATA_SECTION_NODE : Node::TEXT_NODE, stack.back());
+					_nodes[index].value = copy(parser.text(), parser.textLength());
+					_nodes[index].length = static_cast<Poco::UInt32>(parser.textLength());
+				}
+				break;
+			case XMLPullParser::START_CDATA:
+				cdata = true;
+				break;
+			case XMLPullParser::END_CDATA:
+				cdata = false;
+				break;
+			case XMLPullParser::PROCESSING_INSTRUCTION:
+				{
+					Poco::UInt32 index = addNode(Node::PROCESSING_INSTRUCTION_NODE, stack.back());
+					_nodes[index].name = nameId(parser.target());
+					_nodes[index].value = copy(parser.text(), parser.textLength());
+					_nodes[index].length = static_cast<Poco::UInt32>(parser.textLength());
+				}
+				break;
+			case XMLPullParser::COMMENT:
+				{
+					Poco::UInt32 index = addNode(Node::COMMENT_NODE, stack.back());
+					_nodes[index].value = copy(parser.text(), parser.textLength());
+					_nodes[index].length = static_cast<Poco::UInt32>(parser.textLength());
+				}
+				break;
+			case XMLPullParser::END_DOCUMENT:
+				std::sort(_firstByName.begin(), _firstByName.end());
+				return;
+			case XMLPullParser::START_DOCUMENT:
+				break;
+			}
+		}
+	}
+
+	void clear()
+		/// Removes all nodes from the document.
+	{
+		releaseArena();
+		_nodes.clear();
+		_attributes.clear();
+		_names.clear();
+		_nameIds.clear();
+		_qnameIds.clear();
+		_firstByName.clear();
+		_empty = XMLString();
+		addNode(Node::DOCUMENT_NODE, NO_NODE);
+	}
+
+	CompactNode document() const
+		/// Returns the document node.
+	{
+		return CompactNode(this, 0, false);
+	}
+
+	CompactNode documentElement() const
+		/// Returns the root element.
+	{
+		for (Poco::UInt32 index = _nodes[0].firstChild; index != NO_NODE; index = _nodes[index].nextSibling)
+		{
+			if (_nodes[index].type == Node::ELEMENT_NODE) return CompactNode(this, index, false);
+		}
+		return CompactNode();
+	}
+
+	CompactNode getNodeByPath(const XMLString& path) const
+		/// Searches a node (element or attribute) based on the simplified
+		/// XPath expressions supported by Node::getNodeByPath():
+		///
+		///     elem1/elem2/elem3
+		///     /elem1/elem2[1]
+		///     /elem1/elem2[@attr1]
+		///     /elem1/elem2[@attr1='value']
+		///     //elem2[@attr1='value']
+		///     //[@attr1='value']
+	{
+		return document().getNodeByPath(path);
+	}
+
+	std::size_t nodeCount() const
+		/// Returns the number of nodes, excluding attributes and
+		/// the document node.
+	{
+		return _nodes.size() - 1;
+	}
+
+	std::size_t memoryUsage() const
+		/// Returns the approximate number of bytes used by the document.
+	{
+		std::size_t size = _arenaSize;
+		size += _nodes.capacity()*sizeof(NodeData);
+		size += _attributes.capacity()*sizeof(AttributeData);
+		size += _firstByName.capacity()*sizeof(std::pair<Poco::UInt64, Poco::UInt32>);
+		for (std::deque<NameData>::const_iterator it = _names.begin(); it != _names.end(); ++it)
+		{
+			size += sizeof(NameData) + it->qname.capacity() + it->localName.capacity() + it->namespaceURI.capacity();
+		}
+		return size;
+	}
+
+protected:
+	enum
+	{
+		NO_NODE = 0xFFFFFFFF
+	};
+
+	struct NodeData
+	{
+		Poco::UInt32 parent;
+		Poco::UInt32 firstChild;
+		Poco::UInt32 lastChild;
+		Poco::UInt32 nextSibling;
+		Poco::UInt32 nextSameName;
+		Poco::UInt32 name;
+		Poco::UInt32 firstAttribute;
+		Poco::UInt32 attributeCount;
+		const char* value;
+		Poco::UInt32 length;
+		unsigned short type;
+	};
+
+	struct AttributeData
+	{
+		Poco::UInt32 element;
+		Poco::UInt32 name;
+		const char* value;
+		Poco::UInt32 length;
+	};
+
+	struct NameData
+	{
+		XMLString qname;
+		XMLString localName;
+		XMLString namespaceURI;
+		Poco::UInt32 qnameId;
+	};
+
+	Poco::UInt32 addNode(unsigned short type, Poco::UInt32 parent)
+	{
+		NodeData node;
+		node.parent = parent;
+		node.firstChild = NO_NODE;
+		node.lastChild = NO_NODE;
+		node.nextSibling = NO_NODE;
+		node.nextSameName = NO_NODE;
+		node.name = NO_NODE;
+		node.firstAttribute = 0;
+		node.attributeCount = 0;
+		node.value = "";
+		node.length = 0;
+		node.type = type;
+		Poco::UInt32 index = static_cast<Poco::UInt32>(_nodes.size());
+		_nodes.push_back(node);
+		if (parent != NO_NODE)
+		{
+			NodeData& parentNode = _nodes[parent];
+			if (parentNode.lastChild == NO_NODE)
+				parentNode.firstChild = index;
+			else
+				_nodes[parentNode.lastChild].nextSibling = index;
+			parentNode.lastChild = index;
+		}
+		return index;
+	}
+
+	Poco::UInt32 nameId(std::map<const XMLPullParser::Name*, Poco::UInt32>& names, const XMLPullParser::Name& name)
+		/// Returns the id of the given parser name. Interned parser
+		/// names are mapped by address.
+	{
+		std::map<const XMLPullParser::Name*, Poco::UInt32>::iterator it = names.find(&name);
+		if (it != names.end()) return it->second;
+		Poco::UInt32 id = static_cast<Poco::UInt32>(_names.size());
+		_names.push_back(NameData());
+		_names.back().qname = name.qname();
+		_names.back().localName = name.localName();
+		_names.back().namespaceURI = name.namespaceURI();
+		_names.back().qnameId = qnameId(name.qname(), true);
+		names[&name] = id;
+		return id;
+	}
+
+	Poco::UInt32 nameId(const XMLString& target)
+		/// Returns the id for a processing instruction target.
+	{
+		std::map<XMLString, Poco::UInt32>::const_iterator it = _nameIds.find(target);
+		if (it != _nameIds.end()) return it->second;
+		Poco::UInt32 id = static_cast<Poco::UInt32>(_names.size());
+		_names.push_back(NameData());
+		_names.back().qname = target;
+		_names.back().localName = target;
+		_names.back().qnameId = qnameId(target, true);
+		_nameIds[target] = id;
+		return id;
+	}
+
+	Poco::UInt32 qnameId(const XMLString& qname, bool add)
+		/// Returns the id shared by all names with the given qualified
+		/// name, or NO_NODE if there is none and add is false.
+	{
+		std::map<XMLString, Poco::UInt32>::const_iterator it = _qnameIds.find(qname);
+		if (it != _qnameIds.end()) return it->second;
+		if (!add) return NO_NODE;
+		Poco::UInt32 id = static_cast<Poco::UInt32>(_qnameIds.size());
+		_qnameIds[qname] = id;
+		return id;
+	}
+
+	Poco::UInt32 qnameId(const XMLString& qname) const
+	{
+		std::map<XMLString, Poco::UInt32>::const_iterator it = _qnameIds.find(qname);
+		return it != _qnameIds.end() ? it->second : static_cast<Poco::UInt32>(NO_NODE);
+	}
+
+	Poco::UInt32 firstByName(Poco::UInt32 parent, Poco::UInt32 qname) const
+		/// Returns the first child element of parent with the given
+		/// qualified name id.
+	{
+		if (qname == NO_NODE) return NO_NODE;
+		std::pair<Poco::UInt64, Poco::UInt32> key((static_cast<Poco::UInt64>(parent) << 32) | qname, 0);
+		std::vector<std::pair<Poco::UInt64, Poco::UInt32> >::const_iterator it = std::lower_bound(_firstByName.begin(), _firstByName.end(), key);
+		if (it != _firstByName.end() && it->first == key.first) return it->second;
+		return NO_NODE;
+	}
+
+	Poco::UInt32 findAttribute(Poco::UInt32 element, Poco::UInt32 qname) const
+		/// Returns the index of the attribute of element with the given
+		/// qualified name id.
+	{
+		const NodeData& node = _nodes[element];
+		if (node.type != Node::ELEMENT_NODE || qname == NO_NODE) return NO_NODE;
+		for (Poco::UInt32 i = node.firstAttribute; i < node.firstAttribute + node.attributeCount; ++i)
+		{
+			if (_names[_attributes[i].name].qnameId == qname) return i;
+		}
+		return NO_NODE;
+	}
+
+	bool hasAttributeValue(Poco::UInt32 element, Poco::UInt32 qname, const XMLString& value) const
+	{
+		Poco::UInt32 attribute = findAttribute(element, qname);
+		return attribute != NO_NODE && _attributes[attribute].length == value.size() && std::memcmp(_attributes[attribute].value, value.data(), value.size()) == 0;
+	}
+
+	CompactNode findByPath(Poco::UInt32 start, const XMLString& path) const
+	{
+		XMLString::const_iterator it = path.begin();
+		if (it != path.end() && *it == '/')
+		{
+			++it;
+			if (it != path.end() && *it == '/')
+			{
+				++it;
+				XMLString name;
+				while (it != path.end() && *it != '/' && *it != '@' && *it != '[') name += *it++;
+				if (it != path.end() && *it == '/') ++it;
+				Poco::UInt32 qname = name.empty() ? static_cast<Poco::UInt32>(NO_NODE) : qnameId(name);
+				if (!name.empty() && qname == NO_NODE) return CompactNode();
+				// nodes are stored in document order, so the descendants
+				// of start are the following nodes up to its next sibling
+				Poco::UInt32 end = static_cast<Poco::UInt32>(_nodes.size());
+				for (Poco::UInt32 ancestor = start; ancestor != NO_NODE; ancestor = _nodes[ancestor].parent)
+				{
+					if (_nodes[ancestor].nextSibling != NO_NODE)
+					{
+						end = _nodes[ancestor].nextSibling;
+						break;
+					}
+				}
+				for (Poco::UInt32 index = start + 1; index < end; ++index)
+				{
+					const NodeData& node = _nodes[index];
+					if (node.type == Node::ELEMENT_NODE && (name.empty() || _names[node.name].qnameId == qname))
+					{
+						XMLString::const_iterator beg = it;
+						CompactNode found = findNode(beg, path.end(), CompactNode(this, index, false));
+						if (!found.isNull()) return found;
+					}
+				}
+				return CompactNode();
+			}
+		}
+		return findNode(it, path.end(), CompactNode(this, start, false));
+	}
+
+	CompactNode findNode(XMLString::const_iterator& it, const XMLString::const_iterator& end, CompactNode node) const
+		/// Evaluates the path from it for node, following
+		/// AbstractContainerNode::findNode().
+	{
+		if (node.isNull() || it == end) return node;
+		if (node._isAttribute) return CompactNode();
+
+		if (*it == '[')
+		{
+			++it;
+			if (it != end && *it == '@')
+			{
+				++it;
+				XMLString attr;
+				while (it != end && *it != ']' && *it != '=') attr += *it++;
+				if (it != end && *it == '=')
+				{
+					++it;
+					XMLString value;
+					if (it != end && *it == '\'')
+					{
+						++it;
+						while (it != end && *it != '\'') value += *it++;
+						if (it != end) ++it;
+					}
+					else
+					{
+						while (it != end && *it != ']') value += *it++;
+					}
+					if (it != end) ++it;
+					Poco::UInt32 qname = qnameId(attr);
+					Poco::UInt32 index = node._index;
+					while (index != NO_NODE && !hasAttributeValue(index, qname, value)) index = _nodes[index].nextSameName;
+					return findNode(it, end, index == NO_NODE ? CompactNode() : CompactNode(this, index, false));
+				}
+				else
+				{
+					if (it != end) ++it;
+					Poco::UInt32 attribute = findAttribute(node._index, qnameId(attr));
+					return attribute == NO_NODE ? CompactNode() : CompactNode(this, attribute, true);
+				}
+			}
+			else
+			{
+				XMLString index;
+				while (it != end && *it != ']') index += *it++;
+				if (it != end) ++it;
+				Poco::UInt32 current = node._index;
+				for (int n = Poco::NumberParser::parse(index); n > 0 && current != NO_NODE; --n) current = _nodes[current].nextSameName;
+				return findNode(it, end, current == NO_NODE ? CompactNode() : CompactNode(this, current, false));
+			}
+		}
+		else
+		{
+			while (it != end && *it == '/') ++it;
+			XMLString key;
+			while (it != end && *it != '/' && *it != '[') key += *it++;
+
+			XMLString::const_iterator itStart(it);
+			CompactNode found;
+			Poco::UInt32 element = firstByName(node._index, qnameId(key));
+			while (found.isNull() && element != NO_NODE)
+			{
+				found = findNode(it, end, CompactNode(this, element, false));
+				if (found.isNull()) element = _nodes[element].nextSameName;
+				it = itStart;
+			}
+			return found;
+		}
+	}
+
+	const char* copy(const char* value, std::size_t length)
+		/// Copies the value into the arena and terminates it with
+		/// a zero byte.
+	{
+		if (length == 0) return "";
+		if (length + 1 > _available)
+		{
+			std::size_t size = length + 1 > BLOCK_SIZE ? length + 1 : static_cast<std::size_t>(BLOCK_SIZE);
+			char* pBlock = new char[size];
+			_blocks.push_back(pBlock);
+			_arenaSize += size;
+			if (size == static_cast<std::size_t>(BLOCK_SIZE))
+			{
+				_pBlock = pBlock;
+				_available = size;
+			}
+			else
+			{
+				std::memcpy(pBlock, value, length);
+				pBlock[length] = 0;
+				return pBlock;
+			}
+		}
+		char* pResult = _pBlock;
+		std::memcpy(pResult, value, length);
+		pResult[length] = 0;
+		_pBlock += length + 1;
+		_available -= length + 1;
+		return pResult;
+	}
+
+	void releaseArena()
+	{
+		for (std::vector<char*>::iterator it = _blocks.begin(); it != _blocks.end(); ++it)
+		{
+			delete [] *it;
+		}
+		_blocks.clear();
+		_pBlock = 0;
+		_available = 0;
+		_arenaSize = 0;
+	}
+
+	static bool isWhitespace(const char* text, std::size_t length)
+	{
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			if (text[i] != ' ' && text[i] != '\t' && text[i] != '\r' && text[i] != '\n') return false;
+		}
+		return true;
+	}
+
+private:
+	CompactDocument(const CompactDocument&);
+	CompactDocument& operator = (const CompactDocument&);
+
+	bool _filterWhitespace;
+	std::vector<NodeData> _nodes;
+	std::vector<AttributeData> _attributes;
+	std::deque<NameData> _names;
+	std::map<XMLString, Poco::UInt32> _nameIds;
+	std::map<XMLString, Poco::UInt32> _qnameIds;
+	std::vector<std::pair<Poco::UInt64, Poco::UInt32> > _firstByName;
+	std::vector<char*> _blocks;
+	char* _pBlock;
+	std::size_t _available;
+	std::size_t _arenaSize;
+	XMLString _empty;
+
+	friend class CompactNode;
+};
+
+
+//
+// inlines
+//
+inline CompactNode::CompactNode():
+	_pDocument(0),
+	_index(0),
+	_isAttribute(false)
+{
+}
+
+
+inline CompactNode::CompactNode(const CompactDocument* pDocument, Poco::UInt32 index, bool isAttribute):
+	_pDocument(pDocument),
+	_index(index),
+	_isAttribute(isAttribute)
+{
+}
+
+
+inline bool CompactNode::isNull() const
+{
+	return _pDocument == 0;
+}
+
+
+inline unsigned short CompactNode::nodeType() const
+{
+	poco_check_ptr (_pDocument);
+
+	return _isAttribute ? static_cast<unsigned short>(Node::ATTRIBUTE_NODE) : _pDocument->_nodes[_index].type;
+}
+
+
+inline const XMLString& CompactNode::nodeName() const
+{
+	poco_check_ptr (_pDocument);
+
+	Poco::UInt32 name = _isAttribute ? _pDocument->_attributes[_index].name : _pDocument->_nodes[_index].name;
+	return name == CompactDocument::NO_NODE ? _pDocument->_empty : _pDocument->_names[name].qname;
+}
+
+
+inline const XMLString& CompactNode::localName() const
+{
+	poco_check_ptr (_pDocument);
+
+	Poco::UInt32 name = _isAttribute ? _pDocument->_attributes[_index].name : _pDocument->_nodes[_index].name;
+	return name == CompactDocument::NO_NODE ? _pDocument->_empty : _pDocument->_names[name].localName;
+}
+
+
+inline const XMLString& CompactNode::namespaceURI() const
+{
+	poco_check_ptr (_pDocument);
+
+	Poco::UInt32 name = _isAttribute ? _pDocument->_attributes[_index].name : _pDocument->_nodes[_index].name;
+	return name == CompactDocument::NO_NODE ? _pDocument->_empty : _pDocument->_names[name].namespaceURI;
+}
+
+
+inline const char* CompactNode::value() const
+{
+	poco_check_ptr (_pDocument);
+
+	return _isAttribute ? _pDocument->_attributes[_index].value : _pDocument->_nodes[_index].value;
+}
+
+
+inline std::size_t CompactNode::valueLength() const
+{
+	poco_check_ptr (_pDocument);
+
+	return _isAttribute ? _pDocument->_attributes[_index].length : _pDocument->_nodes[_index].length;
+}
+
+
+inline XMLString CompactNode::getNodeValue() const
+{
+	return XMLString(value(), valueLength());
+}
+
+
+inline CompactNode CompactNode::parentNode() const
+{
+	poco_check_ptr (_pDocument);
+
+	Poco::UInt32 parent = _isAttribute ? _pDocument->_attributes[_index].element : _pDocument->_nodes[_index].parent;
+	return parent == CompactDocument::NO_NODE ? CompactNode() : CompactNode(_pDocument, parent, false);
+}
+
+
+inline CompactNode CompactNode::firstChild() const
+{
+	poco_check_ptr (_pDocument);
+
+	if (_isAttribute) return CompactNode();
+	Poco::UInt32 child = _pDocument->_nodes[_index].firstChild;
+	return child == CompactDocument::NO_NODE ? CompactNode() : CompactNode(_pDocument, child, false);
+}
+
+
+inline CompactNode CompactNode::lastChild() const
+{
+	poco_check_ptr (_pDocument);
+
+	if (_isAttribute) return CompactNode();
+	Poco::UInt32 child = _pDocument->_nodes[_index].lastChild;
+	return child == CompactDocument::NO_NODE ? CompactNode() : CompactNode(_pDocument, child, false);
+}
+
+
+inline CompactNode CompactNode::nextSibling() const
+{
+	poco_check_ptr (_pDocument);
+
+	if (_isAttribute) return CompactNode();
+	Poco::UInt32 sibling = _pDocument->_nodes[_index].nextSibling;
+	return sibling == CompactDocument::NO_NODE ? CompactNode() : CompactNode(_pDocument, sibling, false);
+}
+
+
+inline CompactNode CompactNode::getChildElement(const XMLString& name) const
+{
+	poco_check_ptr (_pDocument);
+
+	if (_isAttribute) return CompactNode();
+	Poco::UInt32 child = _pDocument->firstByName(_index, _pDocument->qnameId(name));
+	return child == CompactDocument::NO_NODE ? CompactNode() : CompactNode(_pDocument, child, false);
+}
+
+
+inline CompactNode CompactNode::nextElement() const
+{
+	poco_check_ptr (_pDocument);
+
+	if (_isAttribute) return CompactNode();
+	Poco::UInt32 sibling = _pDocument->_nodes[_index].nextSameName;
+	return sibling == CompactDocument::NO_NODE ? CompactNode() : CompactNode(_pDocument, sibling, false);
+}
+
+
+inline std::size_t CompactNode::attributeCount() const
+{
+	poco_check_ptr (_pDocument);
+
+	return _isAttribute ? 0 : _pDocument->_nodes[_index].attributeCount;
+}
+
+
+inline CompactNode CompactNode::attribute(std::size_t index) const
+{
+	poco_assert (index < attributeCount());
+
+	return CompactNode(_pDocument, _pDocument->_nodes[_index].firstAttribute + static_cast<Poco::UInt32>(index), true);
+}
+
+
+inline bool CompactNode::hasAttribute(const XMLString& name) const
+{
+	poco_check_ptr (_pDocument);
+
+	return !_isAttribute && _pDocument->findAttribute(_index, _pDocument->qnameId(name)) != CompactDocument::NO_NODE;
+}
+
+
+inline const char* CompactNode::getAttribute(const XMLString& name) const
+{
+	poco_check_ptr (_pDocument);
+
+	if (_isAttribute) return "";
+	Poco::UInt32 attribute = _pDocument->findAttribute(_index, _pDocument->qnameId(name));
+	return attribute == CompactDocument::NO_NODE ? "" : _pDocument->_attributes[attribute].value;
+}
+
+
+inline XMLString CompactNode::innerText() const
+{
+	poco_check_ptr (_pDocument);
+
+	if (_isAttribute) return getNodeValue();
+	XMLString result;
+	const CompactDocument::NodeData& node = _pDocument->_nodes[_index];
+	if (node.type == Node::TEXT_NODE || node.type == Node::CDATA_SECTION_NODE) result.append(node.value, node.length);
+	for (CompactNode child = firstChild(); !child.isNull(); child = child.nextSibling())
+	{
+		unsigned short type = child.nodeType();
+		if (type == Node::ELEMENT_NODE || type == Node::TEXT_NODE || type == Node::CDATA_SECTION_NODE) result += child.innerText();
+	}
+	return result;
+}
+
+
+inline CompactNode CompactNode::getNodeByPath(const XMLString& path) const
+{
+	poco_check_ptr (_pDocument);
+
+	if (_isAttribute) return CompactNode();
+	return _pDocument->findByPath(_index, path);
+}
+
+
+inline bool CompactNode::operator == (const CompactNode& node) const
+{
+	return _pDocument == node._pDocument && (_pDocument == 0 || (_index == node._index && _isAttribute == node._isAttribute));
+}
+
+
+inline bool CompactNode::operator != (const CompactNode& node) const
+{
+	return !(*this == node);
+}
+
+
+} } // namespace Poco::XML
+
+
+#endif // !XML_UNICODE
+
+
+#endif // DOM_CompactDocument_INCLUDED
@@ -0,0 +1,627 @@
+//
+// BatchSQLChannel.h
+//
+// $Id$
+//
+// Library: Data
+// Package: Logging
+// Module:  BatchSQLChannel
+//
+// Definition of the BatchSQLChannel class.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Data_BatchSQLChannel_INCLUDED
+#define Data_BatchSQLChannel_INCLUDED
+
+
+#include "Poco/Data/Data.h"
+#include "Poco/Data/Session.h"
+#include "Poco/Data/Statement.h"
+#include "Poco/Channel.h"
+#include "Poco/BatchChannel.h"
+#include "Poco/Message.h"
+#include "Poco/Logger.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Timestamp.h"
+#include "Poco/DateTime.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/NumberParser.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/String.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+namespace Poco {
+namespace Data {
+
+
+struct SQLChannelStatistics
+	/// Counters of a BatchSQLChannel.
+{
+	SQLChannelStatistics():
+		queued(0),
+		written(0),
+		failed(0),
+		droppedOldest(0),
+		droppedPriority(0),
+		blocked(0),
+		flushes(0),
+		highWaterMark(0),
+		lastFlushLatency(0),
+		maxFlushLatency(0),
+		totalFlushLatency(0),
+		lastInsertTime(0),
+		maxInsertTime(0)
+	{
+	}
+
+	Poco::UInt64 queued;          /// Messages accepted by log().
+	Poco::UInt64 written;         /// Messages inserted into the database.
+	Poco::UInt64 failed;          /// Messages lost because an insert failed.
+	Poco::UInt64 droppedOldest;   /// Queued messages replaced by newer ones.
+	Poco::UInt64 droppedPriority; /// Messages dropped because of their priority.
+	Poco::UInt64 blocked;         /// Calls to log() that had to wait for space.
+	Poco::UInt64 flushes;         /// Batches inserted (or failed).
+	std::size_t highWaterMark;    /// The largest number of queued messages.
+	Poco::Timestamp::TimeDiff lastFlushLatency;  /// Time from queuing the oldest message of the last batch to its commit, in microseconds.
+	Poco::Timestamp::TimeDiff maxFlushLatency;   /// The largest flush latency, in microseconds.
+	Poco::Timestamp::TimeDiff totalFlushLatency; /// The sum of all flush latencies, in microseconds.
+	Poco::Timestamp::TimeDiff lastInsertTime;    /// Duration of the last batch transaction, in microseconds.
+	Poco::Timestamp::TimeDiff maxInsertTime;     /// The longest batch transaction, in microseconds.
+
+	Poco::UInt64 dropped() const
+		/// Returns the total number of dropped messages.
+	{
+		return droppedOldest + droppedPriority;
+	}
+
+	Poco::Timestamp::TimeDiff averageFlushLatency() const
+		/// Returns the average flush latency, in microseconds.
+	{
+		return flushes > 0 ? totalFlushLatency/static_cast<Poco::Timestamp::TimeDiff>(flushes) : 0;
+	}
+};
+
+
+class BatchSQLChannel: public Poco::Channel, public Poco::Runnable, public Poco::BatchChannel
+	/// A channel that logs to a SQL database, like SQLChannel, using the
+	/// same table layout, but inserts messages in batches from a
+	/// background thread.
+	///
+	/// Messages are queued in a queue of bounded size. The background
+	/// thread inserts the queued messages once batchSize messages are
+	/// queued, or flushInterval milliseconds after the oldest queued
+	/// message was logged, whichever comes first. Every batch is
+	/// inserted within one transaction, with a single execution of a
+	/// statement prepared once, with the message fields bound as
+	/// vectors ("bulk" binding).
+	///
+	/// What happens if the queue is full is determined by the
+	/// overflow policy:
+	///   * POLICY_DROP_OLDEST: the oldest queued message is dropped.
+	///   * POLICY_DROP_BELOW_PRIORITY: the new message is dropped if it
+	///     is less important than the threshold priority, otherwise the
+	///     oldest queued message is dropped.
+	///   * POLICY_BLOCK: log() waits until there is space in the queue.
+	///
+	/// If a batch cannot be inserted, its messages are counted as failed,
+	/// the exception is passed to the ErrorHandler, and the statement is
+	/// prepared again for the next batch.
+	///
+	/// statistics() returns counters for queued, written, dropped and
+	/// failed messages, and the flush latency (the time from logging the
+	/// oldest message of a batch to the commit of the batch).
+	///
+	/// The following properties are supported:
+	///   * name:          The name used to identify the source of log messages.
+	///                    Defaults to "-".
+	///   * connector:     The target data storage connector name.
+	///   * connect:       The target data storage connection string.
+	///   * table:         Destination log table name. Defaults to "T_POCO_LOG".
+	///                    Table must exist in the target database.
+	///   * capacity:      The maximum number of queued messages (default
+	///                    8192). Must be set before the channel is opened.
+	///   * batchSize:     The maximum number of messages inserted at once
+	///                    (default 256).
+	///   * flushInterval: The maximum time in milliseconds a message is
+	///                    queued before a batch is inserted (default 1000).
+	///   * policy:        dropOldest (default), dropBelowPriority or block.
+	///   * threshold:     The least important priority not dropped by
+	///                    dropBelowPriority, as name or number (default
+	///                    warning).
+	///
+	/// Archiving (the keep and archive properties of SQLChannel) is not
+	/// supported.
+{
+public:
+	typedef Poco::AutoPtr<BatchSQLChannel> Ptr;
+
+	enum OverflowPolicy
+	{
+		POLICY_DROP_OLDEST,
+		POLICY_DROP_BELOW_PRIORITY,
+		POLICY_BLOCK
+	};
+
+	enum
+	{
+		DEFAULT_CAPACITY       = 8192,
+		DEFAULT_BATCH_SIZE     = 256,
+		DEFAULT_FLUSH_INTERVAL = 1000
+	};
+
+	BatchSQLChannel():
+		_name("-"),
+		_table("T_POCO_LOG"),
+		_policy(POLICY_DROP_OLDEST),
+		_threshold(Poco::Message::PRIO_WARNING),
+		_capacity(DEFAULT_CAPACITY),
+		_batchSize(DEFAULT_BATCH_SIZE),
+		_flushInterval(DEFAULT_FLUSH_INTERVAL),
+		_head(0),
+		_count(0),
+		_busy(false),
+		_flush(false),
+		_open(false),
+		_stop(false)
+		/// Creates the BatchSQLChannel.
+	{
+	}
+
+	BatchSQLChannel(const std::string& connector, const std::string& connect, const std::string& name = "-"):
+		_connector(connector),
+		_connect(connect),
+		_name(name),
+		_table("T_POCO_LOG"),
+		_policy(POLICY_DROP_OLDEST),
+		_threshold(Poco::Message::PRIO_WARNING),
+		_capacity(DEFAULT_CAPACITY),
+		_batchSize(DEFAULT_BATCH_SIZE),
+		_flushInterval(DEFAULT_FLUSH_INTERVAL),
+		_head(0),
+		_count(0),
+		_busy(false),
+		_flush(false),
+		_open(false),
+		_stop(false)
+		/// Creates the BatchSQLChannel with the given connector, connect
+		/// string and name. The connector must be already registered.
+	{
+	}
+
+	void open()
+		/// Opens the session to the database and starts the
+		/// background thread.
+	{
+		Poco::FastMutex::ScopedLock threadLock(_threadMutex);
+		if (_open) return;
+		if (_connector.empty() || _connect.empty())
+			throw Poco::IllegalStateException("BatchSQLChannel: connector and connect must be set");
+		_pSession = new Session(_connector, _connect);
+		_pStatement = 0;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_entries.resize(_capacity > 0 ? _capacity : 1);
+			_head  = 0;
+			_count = 0;
+			_stop  = false;
+			_open  = true;
+		}
+		_thread.start(*this);
+	}
+
+	void close()
+		/// Inserts the queued messages, stops the background
+		/// thread and closes the session.
+	{
+		Poco::FastMutex::ScopedLock threadLock(_threadMutex);
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (!_open) return;
+			_open = false;
+			_stop = true;
+			_notEmpty.broadcast();
+			_notFull.broadcast();
+		}
+		_thread.join();
+		_pStatement = 0;
+		_pSession = 0;
+	}
+
+	void log(const Poco::Message& msg)
+		/// Queues the message for insertion.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Entry* pEntry = reserve(msg.getPriority());
+		if (!pEntry) return;
+		pEntry->message = msg;
+		commit(pEntry);
+	}
+
+	void logMany(const std::vector<Poco::Message>& messages)
+		/// Queues the messages for insertion.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (std::vector<Poco::Message>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+		{
+			Entry* pEntry = reserve(it->getPriority());
+			if (!pEntry) continue;
+			pEntry->message = *it;
+			commit(pEntry);
+		}
+	}
+
+	void flush()
+		/// Inserts all queued messages without waiting for
+		/// the flush interval, and waits until they have been
+		/// inserted.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (!_open) return;
+		_flush = true;
+		_notEmpty.signal();
+		while (_open && (_count > 0 || _busy)) _idle.wait(_mutex);
+		_flush = false;
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+		/// Sets or changes a configuration property.
+		///
+		/// See the class documentation for the supported properties.
+	{
+		if (name == "name")
+			_name = value;
+		else if (name == "connector")
+			_connector = value;
+		else if (name == "connect")
+			_connect = value;
+		else if (name == "table")
+			_table = value;
+		else if (name == "capacity")
+			_capacity = Poco::NumberParser::parseUnsigned(value);
+		else if (name == "batchSize")
+			setBatchSize(Poco::NumberParser::parseUnsigned(value));
+		else if (name == "flushInterval")
+			setFlushInterval(Poco::NumberParser::parse(value));
+		else if (name == "policy")
+			setPolicy(value);
+		else if (name == "threshold")
+			_threshold = static_cast<Poco::Message::Priority>(Poco::Logger::parseLevel(value));
+		else
+			Channel::setProperty(name, value);
+	}
+
+	std::string getProperty(const std::string& name) const
+		/// Returns the value of the property with the given name.
+	{
+		if (name == "name")
+			return _name;
+		else if (name == "connector")
+			return _connector;
+		else if (name == "connect")
+			return _connect;
+		else if (name == "table")
+			return _table;
+		else if (name == "capacity")
+			return Poco::NumberFormatter::format(_capacity);
+		else if (name == "batchSize")
+			return Poco::NumberFormatter::format(_batchSize);
+		else if (name == "flushInterval")
+			return Poco::NumberFormatter::format(_flushInterval);
+		else if (name == "policy")
+			return _policy == POLICY_BLOCK ? "block" : (_policy == POLICY_DROP_BELOW_PRIORITY ? "dropBelowPriority" : "dropOldest");
+		else if (name == "threshold")
+			return Poco::NumberFormatter::format(static_cast<int>(_threshold));
+		else
+			return Channel::getProperty(name);
+	}
+
+	void setBatchSize(std::size_t batchSize)
+		/// Sets the maximum number of messages inserted at once.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_batchSize = batchSize > 0 ? batchSize : 1;
+		_notEmpty.signal();
+	}
+
+	void setFlushInterval(long milliseconds)
+		/// Sets the maximum time in milliseconds a message is queued
+		/// before it is inserted.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_flushInterval = milliseconds > 0 ? milliseconds : 0;
+		_notEmpty.signal();
+	}
+
+	void setPolicy(OverflowPolicy policy)
+		/// Sets the overflow policy.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_policy = policy;
+		_notFull.broadcast();
+	}
+
+	OverflowPolicy getPolicy() const
+		/// Returns the overflow policy.
+	{
+		return _policy;
+	}
+
+	SQLChannelStatistics statistics() const
+		/// Returns the current counters.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _statistics;
+	}
+
+	std::size_t size() const
+		/// Returns the number of queued messages.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _count;
+	}
+
+protected:
+	~BatchSQLChannel()
+		/// Destroys the BatchSQLChannel.
+	{
+		try
+		{
+			close();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void run()
+	{
+		std::vector<Poco::Message> batch;
+		for (;;)
+		{
+			bool stop;
+			Poco::Timestamp oldest;
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				_busy = false;
+				if (_count == 0) _idle.broadcast();
+				while (_count == 0 && !_stop) _notEmpty.wait(_mutex);
+				while (!_stop && !_flush && _count > 0 && _count < _batchSize)
+				{
+					Poco::Timestamp::TimeDiff remaining = Poco::Timestamp::TimeDiff(_flushInterval)*1000 - _entries[_head].queued.elapsed();
+					if (remaining <= 0) break;
+					_notEmpty.tryWait(_mutex, static_cast<long>(remaining/1000) + 1);
+				}
+				stop = _stop;
+				std::size_t n = _count < _batchSize ? _count : _batchSize;
+				if (n > 0) oldest = _entries[_head].queued;
+				batch.resize(n);
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					batch[i].swap(_entries[_head].message);
+					_head = (_head + 1) % _entries.size();
+				}
+				_count -= n;
+				_busy = n > 0;
+				if (n > 0) _notFull.broadcast();
+			}
+			if (!batch.empty()) insert(batch, oldest);
+			if (stop && batch.empty()) break;
+		}
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_busy = false;
+		_idle.broadcast();
+	}
+
+	void insert(const std::vector<Poco::Message>& batch, const Poco::Timestamp& oldest)
+		/// Inserts the batch within one transaction.
+	{
+		_sources.clear();
+		_names.clear();
+		_pids.clear();
+		_threads.clear();
+		_tids.clear();
+		_priorities.clear();
+		_texts.clear();
+		_dateTimes.clear();
+		for (std::vector<Poco::Message>::const_iterator it = batch.begin(); it != batch.end(); ++it)
+		{
+			_sources.push_back(it->getSource());
+			_names.push_back(_name);
+			_pids.push_back(static_cast<Poco::Int64>(it->getPid()));
+			_threads.push_back(it->getThread());
+			_tids.push_back(static_cast<Poco::Int64>(it->getTid()));
+			_priorities.push_back(static_cast<Poco::Int32>(it->getPriority()));
+			_texts.push_back(it->getText());
+			_dateTimes.push_back(Poco::DateTime(it->getTime()));
+		}
+
+		Poco::Timestamp start;
+		bool ok = false;
+		try
+		{
+			if (!_pStatement) prepare();
+			_pSession->begin();
+			_pStatement->execute();
+			_pSession->commit();
+			ok = true;
+		}
+		catch (Poco::Exception& exc)
+		{
+			rollback();
+			Poco::ErrorHandler::handle(exc);
+		}
+		catch (std::exception& exc)
+		{
+			rollback();
+			Poco::ErrorHandler::handle(exc);
+		}
+		Poco::Timestamp::TimeDiff insertTime = start.elapsed();
+		Poco::Timestamp::TimeDiff latency = oldest.elapsed();
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (ok)
+			_statistics.written += batch.size();
+		else
+			_statistics.failed += batch.size();
+		++_statistics.flushes;
+		_statistics.lastFlushLatency = latency;
+		if (latency > _statistics.maxFlushLatency) _statistics.maxFlushLatency = latency;
+		_statistics.totalFlushLatency += latency;
+		_statistics.lastInsertTime = insertTime;
+		if (insertTime > _statistics.maxInsertTime) _statistics.maxInsertTime = insertTime;
+	}
+
+	void prepare()
+		/// Prepares the insert statement, bound to the column vectors,
+		/// which must not be empty.
+	{
+		std::string sql("INSERT INTO ");
+		sql += _table;
+		sql += " VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+		StatementPtr pStatement = new Statement(*_pSession);
+		*pStatement << sql,
+			Keywords::use(_sources),
+			Keywords::use(_names),
+			Keywords::use(_pids),
+			Keywords::use(_threads),
+			Keywords::use(_tids),
+			Keywords::use(_priorities),
+			Keywords::use(_texts),
+			Keywords::use(_dateTimes);
+		_pStatement = pStatement;
+	}
+
+	void rollback()
+		/// Rolls back a failed batch and discards the statement.
+	{
+		_pStatement = 0;
+		try
+		{
+			if (_pSession->isTransaction()) _pSession->rollback();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void setPolicy(const std::string& value)
+	{
+		if (Poco::icompare(value, "dropOldest") == 0)
+			setPolicy(POLICY_DROP_OLDEST);
+		else if (Poco::icompare(value, "dropBelowPriority") == 0)
+			setPolicy(POLICY_DROP_BELOW_PRIORITY);
+		else if (Poco::icompare(value, "block") == 0)
+			setPolicy(POLICY_BLOCK);
+		else
+			throw Poco::InvalidArgumentException("overflow policy", value);
+	}
+
+private:
+	struct Entry
+	{
+		Poco::Message message;
+		Poco::Timestamp queued;
+	};
+
+	typedef Poco::SharedPtr<Session> SessionPtr;
+	typedef Poco::SharedPtr<Statement> StatementPtr;
+
+	BatchSQLChannel(const BatchSQLChannel&);
+	BatchSQLChannel& operator = (const BatchSQLChannel&);
+
+	Entry* reserve(Poco::Message::Priority prio)
+		/// Returns the entry for a new message, with _mutex locked,
+		/// or null if the message must be dropped.
+	{
+		if (!_open) return 0;
+		if (_count == _entries.size())
+		{
+			if (_policy == POLICY_BLOCK)
+			{
+				++_statistics.blocked;
+				while (_open && _policy == POLICY_BLOCK && _count == _entries.size()) _notFull.wait(_mutex);
+				if (!_open) return 0;
+			}
+			if (_count == _entries.size())
+			{
+				if (_policy == POLICY_DROP_BELOW_PRIORITY && prio > _threshold)
+				{
+					++_statistics.droppedPriority;
+					return 0;
+				}
+				++_statistics.droppedOldest;
+				_head = (_head + 1) % _entries.size();
+				--_count;
+			}
+		}
+		return &_entries[(_head + _count) % _entries.size()];
+	}
+
+	void commit(Entry* pEntry)
+	{
+		pEntry->queued.update();
+		++_count;
+		++_statistics.queued;
+		if (_count > _statistics.highWaterMark) _statistics.highWaterMark = _count;
+		// wake up the background thread only for the first message
+		// of a batch and when a batch is complete
+		if (_count == 1 || _count >= _batchSize) _notEmpty.signal();
+	}
+
+	std::string _connector;
+	std::string _connect;
+	std::string _name;
+	std::string _table;
+	OverflowPolicy _policy;
+	Poco::Message::Priority _threshold;
+	std::size_t _capacity;
+	std::size_t _batchSize;
+	long _flushInterval;
+	SessionPtr _pSession;
+	StatementPtr _pStatement;
+
+	// column vectors bound to _pStatement, used by the background thread only
+	std::vector<std::string> _sources;
+	std::vector<std::string> _names;
+	std::vector<Poco::Int64> _pids;
+	std::vector<std::string> _threads;
+	std::vector<Poco::Int64> _tids;
+	std::vector<Poco::Int32> _priorities;
+	std::vector<std::string> _texts;
+	std::vector<Poco::DateTime> _dateTimes;
+
+	std::vector<Entry> _entries;
+	std::size_t _head;
+	std::size_t _count;
+	bool _busy;
+	bool _flush;
+	bool _open;
+	bool _stop;
+	SQLChannelStatistics _statistics;
+	Poco::Condition _notEmpty;
+	Poco::Condition _notFull;
+	Poco::Condition _idle;
+	Poco::Thread _thread;
+	mutable Poco::FastMutex _mutex;
+	Poco::FastMutex _threadMutex;
+};
+
+
+} } // namespace Poco::Data
+
+
+#endif // Data_BatchSQLChannel_INCLUDED
@@ -0,0 +1,331 @@
+//
+// BlobStream.h
+//
+// $Id$
+//
+// Library: Data/SQLite
+// Package: SQLite
+// Module:  BlobStream
+//
+// Definition of the IncrementalBlob, BlobStreamBuf, BlobIOS,
+// BlobInputStream and BlobOutputStream classes.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Data_SQLite_BlobStream_INCLUDED
+#define Data_SQLite_BlobStream_INCLUDED
+
+
+#include "Poco/Data/SQLite/SQLite.h"
+#include "Poco/Data/SQLite/Utility.h"
+#include "Poco/Data/Session.h"
+#include "Poco/BufferedStreamBuf.h"
+#include "Poco/Exception.h"
+#include "Poco/Types.h"
+#include <istream>
+#include <ostream>
+#include "sqlite3.h"
+
+
+namespace Poco {
+namespace Data {
+namespace SQLite {
+
+
+class IncrementalBlob
+	/// IncrementalBlob gives access to a BLOB value stored in an SQLite
+	/// database with the incremental I/O functions of SQLite (sqlite3_blob_open(),
+	/// sqlite3_blob_read() and sqlite3_blob_write()), so that parts of the value
+	/// can be read or written without loading all of it into memory, as a
+	/// BLOB extracted with a Statement is.
+	///
+	/// The value is identified by table, column and rowid. Writing cannot
+	/// change the size of the value, so a value to be written incrementally
+	/// must first be inserted with the final size, e.g. with zeroblob():
+	///
+	///     CachedStatement::Ptr pInsert = cache.prepare("INSERT INTO snapshot (time, data) VALUES (?, ?)");
+	///     pInsert->bind(1, time).bindZeroBlob(2, size).execute();
+	///     IncrementalBlob blob(session, "snapshot", "data", pInsert->lastInsertRowid(), IncrementalBlob::MODE_READ_WRITE);
+	///     BlobOutputStream ostr(blob);
+	///     Poco::DeflatingOutputStream deflater(ostr);
+	///     ...
+	///
+	/// An IncrementalBlob becomes invalid, and all further reads and writes
+	/// fail with an exception, when the row is changed or deleted by another
+	/// statement. reopen() moves the IncrementalBlob to another row of the same
+	/// table, which is faster than opening a new one.
+	///
+	/// Like a Session, an IncrementalBlob must not be used by more than
+	/// one thread at a time, and the Session must outlive it.
+{
+public:
+	enum Mode
+	{
+		MODE_READ = 0,
+		MODE_READ_WRITE = 1
+	};
+
+	IncrementalBlob(const Session& session, const std::string& table, const std::string& column, Poco::Int64 rowid, Mode mode = MODE_READ, const std::string& database = "main"):
+		_pDB(Utility::dbHandle(session)),
+		_pBlob(0)
+		/// Opens the value in the given column of the row in the given table
+		/// and database. Throws an exception if the value cannot be opened,
+		/// e.g. because the row does not exist or the value is not a BLOB
+		/// or text.
+	{
+		open(database, table, column, rowid, mode);
+	}
+
+	IncrementalBlob(sqlite3* pDB, const std::string& table, const std::string& column, Poco::Int64 rowid, Mode mode = MODE_READ, const std::string& database = "main"):
+		_pDB(pDB),
+		_pBlob(0)
+		/// Opens the value in the given column of the row in the given
+		/// table and database of the given SQLite database handle.
+	{
+		poco_check_ptr (_pDB);
+
+		open(database, table, column, rowid, mode);
+	}
+
+	~IncrementalBlob()
+		/// Closes the IncrementalBlob.
+	{
+		if (_pBlob) sqlite3_blob_close(_pBlob);
+	}
+
+	std::size_t size() const
+		/// Returns the size of the value in bytes.
+	{
+		return static_cast<std::size_t>(sqlite3_blob_bytes(handle()));
+	}
+
+	void read(void* buffer, std::size_t length, std::size_t offset)
+		/// Reads length bytes, starting at offset, into buffer. Throws an
+		/// exception if the range is not within the value.
+	{
+		check(sqlite3_blob_read(handle(), buffer, static_cast<int>(length), static_cast<int>(offset)));
+	}
+
+	std::size_t readAll(void* buffer, std::size_t capacity)
+		/// Reads the entire value into buffer, without any intermediate copy,
+		/// if it fits into capacity bytes, and returns the size of the value.
+		/// If the value is larger than capacity, nothing is read, and the
+		/// returned size can be used to provide a larger buffer.
+	{
+		std::size_t n = size();
+		if (n <= capacity && n > 0) read(buffer, n, 0);
+		return n;
+	}
+
+	void write(const void* buffer, std::size_t length, std::size_t offset)
+		/// Writes length bytes from buffer, starting at offset. Throws an
+		/// exception if the range is not within the value or the
+		/// IncrementalBlob has been opened with MODE_READ.
+	{
+		check(sqlite3_blob_write(handle(), buffer, static_cast<int>(length), static_cast<int>(offset)));
+	}
+
+	void reopen(Poco::Int64 rowid)
+		/// Moves the IncrementalBlob to the value in the row with the given
+		/// rowid of the same table and column.
+	{
+		check(sqlite3_blob_reopen(handle(), static_cast<sqlite3_int64>(rowid)));
+	}
+
+	void close()
+		/// Closes the IncrementalBlob. Throws an exception if a pending
+		/// write cannot be committed.
+	{
+		if (_pBlob)
+		{
+			sqlite3_blob* pBlob = _pBlob;
+			_pBlob = 0;
+			check(sqlite3_blob_close(pBlob));
+		}
+	}
+
+	bool isOpen() const
+		/// Returns true unless the IncrementalBlob has been closed.
+	{
+		return _pBlob != 0;
+	}
+
+	sqlite3_blob* handle() const
+		/// Returns the SQLite BLOB handle.
+	{
+		if (!_pBlob) throw Poco::InvalidAccessException("IncrementalBlob has been closed");
+		return _pBlob;
+	}
+
+private:
+	IncrementalBlob(const IncrementalBlob&);
+	IncrementalBlob& operator = (const IncrementalBlob&);
+
+	void open(const std::string& database, const std::string& table, const std::string& column, Poco::Int64 rowid, Mode mode)
+	{
+		int rc = sqlite3_blob_open(_pDB, database.c_str(), table.c_str(), column.c_str(), static_cast<sqlite3_int64>(rowid), mode, &_pBlob);
+		if (rc != SQLITE_OK)
+		{
+			std::string msg(Utility::lastError(_pDB));
+			if (_pBlob) sqlite3_blob_close(_pBlob);
+			_pBlob = 0;
+			Utility::throwException(rc, msg + ": " + table + "." + column);
+		}
+	}
+
+	void check(int rc)
+	{
+		if (rc != SQLITE_OK) Utility::throwException(rc, Utility::lastError(_pDB));
+	}
+
+	sqlite3* _pDB;
+	sqlite3_blob* _pBlob;
+};
+
+
+class BlobStreamBuf: public Poco::BufferedStreamBuf
+	/// This is the streambuf class used for reading from and
+	/// writing to an IncrementalBlob, one buffer at a time.
+{
+public:
+	enum
+	{
+		DEFAULT_BUFFER_SIZE = 16384
+	};
+
+	BlobStreamBuf(IncrementalBlob& blob, openmode mode, std::streamsize bufferSize = DEFAULT_BUFFER_SIZE):
+		Poco::BufferedStreamBuf(bufferSize, mode),
+		_blob(blob),
+		_size(blob.size()),
+		_offset(0)
+		/// Creates the BlobStreamBuf for the given IncrementalBlob.
+	{
+	}
+
+	~BlobStreamBuf()
+		/// Destroys the BlobStreamBuf.
+	{
+	}
+
+	std::size_t offset() const
+		/// Returns the offset of the next byte read from or
+		/// written to the IncrementalBlob.
+	{
+		return _offset;
+	}
+
+protected:
+	int readFromDevice(char* buffer, std::streamsize length)
+	{
+		std::size_t n = _size - _offset;
+		if (n > static_cast<std::size_t>(length)) n = static_cast<std::size_t>(length);
+		if (n > 0)
+		{
+			_blob.read(buffer, n, _offset);
+			_offset += n;
+		}
+		return static_cast<int>(n);
+	}
+
+	int writeToDevice(const char* buffer, std::streamsize length)
+	{
+		std::size_t n = static_cast<std::size_t>(length);
+		if (n > _size - _offset) return -1;
+		_blob.write(buffer, n, _offset);
+		_offset += n;
+		return static_cast<int>(n);
+	}
+
+private:
+	IncrementalBlob& _blob;
+	std::size_t _size;
+	std::size_t _offset;
+};
+
+
+class BlobIOS: public virtual std::ios
+	/// The base class for BlobInputStream and
+	/// BlobOutputStream.
+	///
+	/// This class is needed to ensure the correct initialization
+	/// order of the stream buffer and base classes.
+{
+public:
+	BlobIOS(IncrementalBlob& blob, openmode mode, std::streamsize bufferSize):
+		_buf(blob, mode, bufferSize)
+		/// Creates the BlobIOS with the given IncrementalBlob.
+	{
+		poco_ios_init(&_buf);
+	}
+
+	~BlobIOS()
+		/// Destroys the BlobIOS.
+	{
+	}
+
+	BlobStreamBuf* rdbuf()
+		/// Returns a pointer to the internal BlobStreamBuf.
+	{
+		return &_buf;
+	}
+
+protected:
+	BlobStreamBuf _buf;
+};
+
+
+class BlobInputStream: public BlobIOS, public std::istream
+	/// An input stream for reading an IncrementalBlob from
+	/// beginning to end, one buffer at a time.
+{
+public:
+	explicit BlobInputStream(IncrementalBlob& blob, std::streamsize bufferSize = BlobStreamBuf::DEFAULT_BUFFER_SIZE):
+		BlobIOS(blob, std::ios::in, bufferSize),
+		std::istream(&_buf)
+		/// Creates the BlobInputStream with the given IncrementalBlob.
+	{
+	}
+
+	~BlobInputStream()
+		/// Destroys the BlobInputStream.
+	{
+	}
+};
+
+
+class BlobOutputStream: public BlobIOS, public std::ostream
+	/// An output stream for writing an IncrementalBlob from the beginning,
+	/// one buffer at a time. Writing beyond the size of the value sets
+	/// the badbit of the stream.
+{
+public:
+	explicit BlobOutputStream(IncrementalBlob& blob, std::streamsize bufferSize = BlobStreamBuf::DEFAULT_BUFFER_SIZE):
+		BlobIOS(blob, std::ios::out, bufferSize),
+		std::ostream(&_buf)
+		/// Creates the BlobOutputStream with the given IncrementalBlob.
+	{
+	}
+
+	~BlobOutputStream()
+		/// Flushes and destroys the BlobOutputStream.
+	{
+		try
+		{
+			flush();
+		}
+		catch (...)
+		{
+		}
+	}
+};
+
+
+} } } // namespace Poco::Data::SQLite
+
+
+#endif // Data_SQLite_BlobStream_INCLUDED
@@ -0,0 +1,244 @@
+//
+// BulkInserter.h
+//
+// $Id$
+//
+// Library: Data/SQLite
+// Package: SQLite
+// Module:  BulkInserter
+//
+// Definition of the BulkInserter class.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Data_SQLite_BulkInserter_INCLUDED
+#define Data_SQLite_BulkInserter_INCLUDED
+
+
+#include "Poco/Data/SQLite/SQLite.h"
+#include "Poco/Data/SQLite/StatementCache.h"
+#include "Poco/Data/Session.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+namespace Poco {
+namespace Data {
+namespace SQLite {
+
+
+class BulkInserter
+	/// BulkInserter inserts many rows with a single prepared statement
+	/// from a StatementCache, and groups them into transactions of up to
+	/// a batch size, since with SQLite every transaction (and every
+	/// statement outside of a transaction) costs at least one sync of the
+	/// journal.
+	///
+	/// Rows can be inserted one at a time:
+	///
+	///     BulkInserter inserter(cache, "INSERT INTO metrics VALUES (?, ?, ?)");
+	///     inserter.row().bind(1, time).bind(2, rssi).bind(3, rsrp);
+	///     inserter.insert();
+	///     ...
+	///     inserter.commit();
+	///
+	/// or from column vectors, as used with Poco::Data::use() for bulk
+	/// binding:
+	///
+	///     inserter.insert(times, rssis, rsrps);
+	///
+	/// If the session is already in a transaction, rows become part of
+	/// it, and the BulkInserter does not commit. Otherwise, a transaction
+	/// is begun for the first row, and committed after batchSize rows,
+	/// by commit(), by the column vector overloads of insert(), and when
+	/// the BulkInserter is destroyed.
+{
+public:
+	enum
+	{
+		DEFAULT_BATCH_SIZE = 1000
+	};
+
+	BulkInserter(StatementCache& cache, const std::string& sql, std::size_t batchSize = DEFAULT_BATCH_SIZE):
+		_cache(cache),
+		_pStmt(cache.prepare(sql)),
+		_batchSize(batchSize > 0 ? batchSize : 1),
+		_pending(0),
+		_inTransaction(false)
+		/// Creates the BulkInserter for the given INSERT
+		/// (or other DML) statement.
+	{
+	}
+
+	~BulkInserter()
+		/// Commits pending rows and destroys the BulkInserter.
+	{
+		try
+		{
+			commit();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	CachedStatement& row()
+		/// Returns the statement, for binding the parameters
+		/// of the next row.
+	{
+		return *_pStmt;
+	}
+
+	void insert()
+		/// Executes the statement with the current bindings.
+	{
+		if (!_inTransaction && !_cache.session().isTransaction())
+		{
+			_cache.session().begin();
+			_inTransaction = true;
+		}
+		_pStmt->execute();
+		if (_inTransaction && ++_pending >= _batchSize) commit();
+	}
+
+	template <class T1>
+	std::size_t insert(const std::vector<T1>& c1)
+		/// Inserts one row per element of the column vector,
+		/// and commits. Returns the number of rows.
+	{
+		for (std::size_t i = 0; i < c1.size(); ++i)
+		{
+			_pStmt->bind(1, c1[i]);
+			insert();
+		}
+		commit();
+		return c1.size();
+	}
+
+	template <class T1, class T2>
+	std::size_t insert(const std::vector<T1>& c1, const std::vector<T2>& c2)
+		/// Inserts one row per element of the column vectors,
+		/// which must have the same size, and commits. Returns
+		/// the number of rows.
+	{
+		checkSize(c1.size(), c2.size());
+		for (std::size_t i = 0; i < c1.size(); ++i)
+		{
+			_pStmt->bind(1, c1[i]).bind(2, c2[i]);
+			insert();
+		}
+		commit();
+		return c1.size();
+	}
+
+	template <class T1, class T2, class T3>
+	std::size_t insert(const std::vector<T1>& c1, const std::vector<T2>& c2, const std::vector<T3>& c3)
+		/// Inserts one row per element of the column vectors,
+		/// which must have the same size, and commits. Returns
+		/// the number of rows.
+	{
+		checkSize(c1.size(), c2.size());
+		checkSize(c1.size(), c3.size());
+		for (std::size_t i = 0; i < c1.size(); ++i)
+		{
+			_pStmt->bind(1, c1[i]).bind(2, c2[i]).bind(3, c3[i]);
+			insert();
+		}
+		commit();
+		return c1.size();
+	}
+
+	template <class T1, class T2, class T3, class T4>
+	std::size_t insert(const std::vector<T1>& c1, const std::vector<T2>& c2, const std::vector<T3>& c3, const std::vector<T4>& c4)
+		/// Inserts one row per element of the column vectors,
+		/// which must have the same size, and commits. Returns
+		/// the number of rows.
+	{
+		checkSize(c1.size(), c2.size());
+		checkSize(c1.size(), c3.size());
+		checkSize(c1.size(), c4.size());
+		for (std::size_t i = 0; i < c1.size(); ++i)
+		{
+			_pStmt->bind(1, c1[i]).bind(2, c2[i]).bind(3, c3[i]).bind(4, c4[i]);
+			insert();
+		}
+		commit();
+		return c1.size();
+	}
+
+	template <class T1, class T2, class T3, class T4, class T5>
+	std::size_t insert(const std::vector<T1>& c1, const std::vector<T2>& c2, const std::vector<T3>& c3, const std::vector<T4>& c4, const std::vector<T5>& c5)
+		/// Inserts one row per element of the column vectors,
+		/// which must have the same size, and commits. Returns
+		/// the number of rows.
+	{
+		checkSize(c1.size(), c2.size());
+		checkSize(c1.size(), c3.size());
+		checkSize(c1.size(), c4.size());
+		checkSize(c1.size(), c5.size());
+		for (std::size_t i = 0; i < c1.size(); ++i)
+		{
+			_pStmt->bind(1, c1[i]).bind(2, c2[i]).bind(3, c3[i]).bind(4, c4[i]).bind(5, c5[i]);
+			insert();
+		}
+		commit();
+		return c1.size();
+	}
+
+	void commit()
+		/// Commits the transaction begun by the BulkInserter, if any.
+	{
+		if (_inTransaction)
+		{
+			_inTransaction = false;
+			_pending = 0;
+			_cache.session().commit();
+		}
+	}
+
+	void rollback()
+		/// Rolls back the transaction begun by the BulkInserter, if any,
+		/// discarding the rows inserted since the last commit.
+	{
+		if (_inTransaction)
+		{
+			_inTransaction = false;
+			_pending = 0;
+			_cache.session().rollback();
+		}
+	}
+
+	std::size_t pending() const
+		/// Returns the number of rows inserted since the last commit.
+	{
+		return _pending;
+	}
+
+protected:
+	static void checkSize(std::size_t expected, std::size_t size)
+	{
+		if (size != expected) throw Poco::InvalidArgumentException("Column vectors must have the same size");
+	}
+
+private:
+	BulkInserter(const BulkInserter&);
+	BulkInserter& operator = (const BulkInserter&);
+
+	StatementCache& _cache;
+	CachedStatement::Ptr _pStmt;
+	std::size_t _batchSize;
+	std::size_t _pending;
+	bool _inTransaction;
+};
+
+
+} } } // namespace Poco::Data::SQLite
+
+
+#endif // Data_SQLite_BulkInserter_INCLUDED
@@ -0,0 +1,358 @@
+//
+// ChangeNotifier.h
+//
+// $Id$
+//
+// Library: Data/SQLite
+// Package: SQLite
+// Module:  ChangeNotifier
+//
+// Definition of the ChangeNotifier class.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Data_SQLite_ChangeNotifier_INCLUDED
+#define Data_SQLite_ChangeNotifier_INCLUDED
+
+
+#include "Poco/Data/SQLite/SQLite.h"
+#include "Poco/Data/SQLite/Utility.h"
+#include "Poco/Data/Session.h"
+#include "Poco/Data/DataException.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/Types.h"
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstring>
+#include "sqlite3.h"
+
+
+namespace Poco {
+namespace Data {
+namespace SQLite {
+
+
+struct RowRange
+	/// A range of rows of a table changed by the same operation.
+{
+	enum Operation
+	{
+		OP_INSERT = SQLITE_INSERT,
+		OP_UPDATE = SQLITE_UPDATE,
+		OP_DELETE = SQLITE_DELETE
+	};
+
+	std::string table;       /// The name of the table.
+	Operation operation;     /// The operation.
+	Poco::Int64 firstRow;    /// The lowest rowid in the range.
+	Poco::Int64 lastRow;     /// The highest rowid in the range.
+	Poco::UInt64 count;      /// The number of row changes in the range.
+};
+
+
+struct ChangeSet
+	/// The changes of one committed transaction.
+{
+	ChangeSet():
+		sequence(0),
+		rows(0)
+	{
+	}
+
+	Poco::UInt64 sequence;          /// Numbers the committed transactions, starting at 1.
+	Poco::UInt64 rows;              /// The total number of row changes.
+	std::vector<RowRange> ranges;   /// The changed row ranges, in order of their first change.
+};
+
+
+class ChangeNotifier: public Poco::Runnable
+	/// ChangeNotifier is an alternative to Notifier for applications
+	/// that need to know which rows have been changed, but do not want
+	/// to be called for every row: it collects the changes of a
+	/// transaction from SQLite's update hook into row ranges (consecutive
+	/// rowids of a table changed by the same operation are merged), and
+	/// fires the changed event once, when the transaction is committed.
+	/// The changes of a transaction that is rolled back are discarded.
+	///
+	/// With DELIVER_SYNC, the event is fired from SQLite's commit hook,
+	/// in the thread executing the commit; delegates must then not use
+	/// the database connection. With DELIVER_ASYNC, change sets are
+	/// queued and the event is fired from a separate thread, in commit
+	/// order, so that listeners never delay writes.
+	///
+	///     ChangeNotifier notifier(session, ChangeNotifier::DELIVER_ASYNC);
+	///     notifier.changed += Poco::delegate(&history, &History::onChanged);
+	///
+	/// Like Notifier, ChangeNotifier registers SQLite's update, commit
+	/// and rollback hooks, of which there can only be one each per
+	/// session. A ChangeNotifier therefore cannot be used together with
+	/// a Notifier on the same session. SQLite does not report changes of
+	/// WITHOUT ROWID tables, or rows deleted by DROP TABLE or by a
+	/// DELETE without WHERE clause (truncate optimization).
+{
+public:
+	enum Delivery
+	{
+		DELIVER_SYNC,
+		DELIVER_ASYNC
+	};
+
+	Poco::BasicEvent<const ChangeSet> changed;
+		/// Fired for every committed transaction that has changed rows.
+
+	explicit ChangeNotifier(const Session& session, Delivery delivery = DELIVER_SYNC):
+		_session(session),
+		_delivery(delivery),
+		_pLast(0),
+		_sequence(0),
+		_stop(false)
+		/// Creates the ChangeNotifier and registers the SQLite hooks.
+		/// The session must outlive the ChangeNotifier.
+	{
+		if (_delivery == DELIVER_ASYNC) _thread.start(*this);
+		if (!Utility::registerUpdateHandler(Utility::dbHandle(_session), &updateCallback, this) ||
+			!Utility::registerUpdateHandler(Utility::dbHandle(_session), &commitCallback, this) ||
+			!Utility::registerUpdateHandler(Utility::dbHandle(_session), &rollbackCallback, this))
+		{
+			unregister();
+			stop();
+			throw Poco::Data::DataException("Cannot register SQLite hooks; another notifier is registered?");
+		}
+	}
+
+	~ChangeNotifier()
+		/// Unregisters the SQLite hooks, delivers the queued change
+		/// sets and destroys the ChangeNotifier.
+	{
+		try
+		{
+			unregister();
+			stop();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	Delivery delivery() const
+		/// Returns the delivery mode.
+	{
+		return _delivery;
+	}
+
+	std::size_t queued() const
+		/// Returns the number of change sets waiting for
+		/// asynchronous delivery.
+	{
+		Poco::FastMutex::ScopedLock lock(_queueMutex);
+		return _queue.size();
+	}
+
+	bool operator == (const ChangeNotifier& other) const
+		/// Returns true iff both are the same object. Required by
+		/// Utility::registerUpdateHandler().
+	{
+		return this == &other;
+	}
+
+protected:
+	static void updateCallback(void* pVal, int opCode, const char*, const char* pTable, Poco::Int64 row)
+	{
+		reinterpret_cast<ChangeNotifier*>(pVal)->add(static_cast<RowRange::Operation>(opCode), pTable, row);
+	}
+
+	static int commitCallback(void* pVal)
+	{
+		try
+		{
+			reinterpret_cast<ChangeNotifier*>(pVal)->commit();
+		}
+		catch (Poco::Exception& exc)
+		{
+			Poco::ErrorHandler::handle(exc);
+		}
+		catch (std::exception& exc)
+		{
+			Poco::ErrorHandler::handle(exc);
+		}
+		catch (...)
+		{
+			Poco::ErrorHandler::handle();
+		}
+		// a failing listener must not turn the commit into a rollback
+		return 0;
+	}
+
+	static void rollbackCallback(void* pVal)
+	{
+		reinterpret_cast<ChangeNotifier*>(pVal)->rollback();
+	}
+
+	void add(RowRange::Operation op, const char* pTable, Poco::Int64 row)
+		/// Adds a row change to the current transaction. Runs within
+		/// SQLite's update hook for every row, so it must be cheap.
+	{
+		++_pending.rows;
+		if (_pLast && _pLast->operation == op && std::strcmp(_pLast->table.c_str(), pTable) == 0 && extend(*_pLast, row))
+			return;
+
+		Key key(pTable, op);
+		RangeIndex::iterator it = _index.find(key);
+		if (it != _index.end() && extend(_pending.ranges[it->second], row))
+		{
+			_pLast = &_pending.ranges[it->second];
+			return;
+		}
+		RowRange range;
+		range.table = key.first;
+		range.operation = op;
+		range.firstRow = row;
+		range.lastRow = row;
+		range.count = 1;
+		_pending.ranges.push_back(range);
+		_index[key] = _pending.ranges.size() - 1;
+		_pLast = &_pending.ranges.back();
+	}
+
+	static bool extend(RowRange& range, Poco::Int64 row)
+		/// Adds the row to the range if it is within or adjacent
+		/// to the range.
+	{
+		if (row >= range.firstRow - 1 && row <= range.lastRow + 1)
+		{
+			if (row < range.firstRow) range.firstRow = row;
+			if (row > range.lastRow) range.lastRow = row;
+			++range.count;
+			return true;
+		}
+		return false;
+	}
+
+	void commit()
+		/// Fires or queues the collected changes.
+	{
+		if (_pending.rows == 0) return;
+		ChangeSet changeSet;
+		changeSet.ranges.swap(_pending.ranges);
+		changeSet.rows = _pending.rows;
+		changeSet.sequence = ++_sequence;
+		discard();
+		if (_delivery == DELIVER_ASYNC)
+		{
+			Poco::FastMutex::ScopedLock lock(_queueMutex);
+			_queue.push_back(ChangeSet());
+			_queue.back().ranges.swap(changeSet.ranges);
+			_queue.back().rows = changeSet.rows;
+			_queue.back().sequence = changeSet.sequence;
+			_notEmpty.signal();
+		}
+		else
+		{
+			changed.notify(this, changeSet);
+		}
+	}
+
+	void rollback()
+		/// Discards the collected changes.
+	{
+		discard();
+	}
+
+	void discard()
+	{
+		_pending.ranges.clear();
+		_pending.rows = 0;
+		_index.clear();
+		_pLast = 0;
+	}
+
+	void unregister()
+	{
+		sqlite3* pDB = Utility::dbHandle(_session);
+		Utility::registerUpdateHandler(pDB, (Utility::UpdateCallbackType) 0, this);
+		Utility::registerUpdateHandler(pDB, (Utility::CommitCallbackType) 0, this);
+		Utility::registerUpdateHandler(pDB, (Utility::RollbackCallbackType) 0, this);
+	}
+
+	void stop()
+	{
+		if (_delivery != DELIVER_ASYNC) return;
+		{
+			Poco::FastMutex::ScopedLock lock(_queueMutex);
+			_stop = true;
+			_notEmpty.signal();
+		}
+		_thread.join();
+	}
+
+	void run()
+		/// Fires the event for the queued change sets.
+	{
+		for (;;)
+		{
+			ChangeSet changeSet;
+			{
+				Poco::FastMutex::ScopedLock lock(_queueMutex);
+				while (_queue.empty() && !_stop) _notEmpty.wait(_queueMutex);
+				if (_queue.empty()) break;
+				changeSet.ranges.swap(_queue.front().ranges);
+				changeSet.rows = _queue.front().rows;
+				changeSet.sequence = _queue.front().sequence;
+				_queue.pop_front();
+			}
+			try
+			{
+				changed.notify(this, changeSet);
+			}
+			catch (Poco::Exception& exc)
+			{
+				Poco::ErrorHandler::handle(exc);
+			}
+			catch (std::exception& exc)
+			{
+				Poco::ErrorHandler::handle(exc);
+			}
+			catch (...)
+			{
+				Poco::ErrorHandler::handle();
+			}
+		}
+	}
+
+private:
+	typedef std::pair<std::string, int> Key;
+	typedef std::map<Key, std::size_t> RangeIndex;
+
+	ChangeNotifier(const ChangeNotifier&);
+	ChangeNotifier& operator = (const ChangeNotifier&);
+
+	const Session& _session;
+	Delivery _delivery;
+	ChangeSet _pending;
+	RangeIndex _index;
+	RowRange* _pLast;
+	Poco::UInt64 _sequence;
+	std::deque<ChangeSet> _queue;
+	bool _stop;
+	Poco::Thread _thread;
+	Poco::Condition _notEmpty;
+	mutable Poco::FastMutex _queueMutex;
+};
+
+
+} } } // namespace Poco::Data::SQLite
+
+
+#endif // Data_SQLite_ChangeNotifier_INCLUDED
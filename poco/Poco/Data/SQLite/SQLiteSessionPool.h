@@ -0,0 +1,284 @@
+//
+// SQLiteSessionPool.h
+//
+// $Id$
+//
+// Library: Data/SQLite
+// Package: SQLite
+// Module:  SQLiteSessionPool
+//
+// Definition of the ConnectionSettings, SQLiteSessionPool
+// and SQLiteReadWritePool classes.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Data_SQLite_SQLiteSessionPool_INCLUDED
+#define Data_SQLite_SQLiteSessionPool_INCLUDED
+
+
+#include "Poco/Data/SQLite/SQLite.h"
+#include "Poco/Data/SQLite/Connector.h"
+#include "Poco/Data/SQLite/Utility.h"
+#include "Poco/Data/SessionPool.h"
+#include "Poco/Data/Session.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Mutex.h"
+#include <vector>
+#include "sqlite3.h"
+
+
+namespace Poco {
+namespace Data {
+namespace SQLite {
+
+
+class ConnectionSettings
+	/// Per-connection SQLite settings, applied once to every new
+	/// physical connection by SQLiteSessionPool and SQLiteReadWritePool,
+	/// or to any SQLite session with apply().
+	///
+	/// The defaults are suited for an application with one writer and
+	/// concurrent readers: WAL journal mode (readers and the writer do
+	/// not block each other), synchronous NORMAL (safe with WAL, no
+	/// sync per transaction), a busy timeout of 5 seconds, and SQLite's
+	/// defaults otherwise.
+{
+public:
+	enum
+	{
+		DEFAULT_BUSY_TIMEOUT = 5000
+	};
+
+	ConnectionSettings():
+		journalMode("WAL"),
+		synchronous("NORMAL"),
+		mmapSize(-1),
+		cacheSize(0),
+		busyTimeout(DEFAULT_BUSY_TIMEOUT),
+		queryOnly(false)
+	{
+	}
+
+	std::string journalMode;
+		/// The journal mode (PRAGMA journal_mode), e.g. "WAL",
+		/// or empty to keep the database's journal mode.
+
+	std::string synchronous;
+		/// The synchronous level (PRAGMA synchronous): "OFF", "NORMAL",
+		/// "FULL" or "EXTRA", or empty for SQLite's default.
+
+	Poco::Int64 mmapSize;
+		/// The maximum number of bytes of the database file accessed through
+		/// memory-mapped I/O (PRAGMA mmap_size), or -1 for SQLite's default.
+
+	int cacheSize;
+		/// The page cache size (PRAGMA cache_size): pages if positive,
+		/// KiB if negative, or 0 for SQLite's default.
+
+	int busyTimeout;
+		/// The time in milliseconds to wait for a lock held by another
+		/// connection before failing with SQLITE_BUSY, or 0 to fail at once.
+
+	bool queryOnly;
+		/// If true, the connection cannot change the database
+		/// (PRAGMA query_only).
+
+	std::vector<std::string> pragmas;
+		/// Additional statements executed for every connection,
+		/// e.g. "PRAGMA foreign_keys=ON".
+
+	void apply(Session& session) const
+		/// Applies the settings to the given SQLite session.
+	{
+		sqlite3* pDB = Utility::dbHandle(session);
+		int rc = sqlite3_busy_timeout(pDB, busyTimeout);
+		if (rc != SQLITE_OK) Utility::throwException(rc, Utility::lastError(pDB));
+		if (!journalMode.empty()) exec(pDB, "PRAGMA journal_mode=" + journalMode);
+		if (!synchronous.empty()) exec(pDB, "PRAGMA synchronous=" + synchronous);
+		if (mmapSize >= 0) exec(pDB, "PRAGMA mmap_size=" + Poco::NumberFormatter::format(mmapSize));
+		if (cacheSize != 0) exec(pDB, "PRAGMA cache_size=" + Poco::NumberFormatter::format(cacheSize));
+		if (queryOnly) exec(pDB, "PRAGMA query_only=ON");
+		for (std::vector<std::string>::const_iterator it = pragmas.begin(); it != pragmas.end(); ++it)
+		{
+			exec(pDB, *it);
+		}
+	}
+
+protected:
+	static void exec(sqlite3* pDB, const std::string& sql)
+	{
+		char* pError = 0;
+		int rc = sqlite3_exec(pDB, sql.c_str(), 0, 0, &pError);
+		if (rc != SQLITE_OK)
+		{
+			std::string msg(pError ? pError : "");
+			sqlite3_free(pError);
+			Utility::throwException(rc, msg + ": " + sql);
+		}
+	}
+};
+
+
+class SQLiteSessionPool: public Poco::Data::SessionPool
+	/// A SessionPool for SQLite sessions that applies ConnectionSettings
+	/// (journal mode, synchronous level, mmap size, cache size, busy
+	/// timeout) once to every new connection, instead of every user of
+	/// a pooled session doing so.
+	///
+	/// The SQLite connector must have been registered with
+	/// Poco::Data::SQLite::Connector::registerConnector().
+{
+public:
+	typedef Poco::AutoPtr<SQLiteSessionPool> Ptr;
+
+	SQLiteSessionPool(const std::string& fileName,
+		const ConnectionSettings& settings = ConnectionSettings(),
+		int minSessions = 1,
+		int maxSessions = 32,
+		int idleTime = 60):
+		SessionPool(Connector::KEY, fileName, minSessions, maxSessions, idleTime),
+		_settings(settings)
+		/// Creates the SQLiteSessionPool for the given database file.
+	{
+	}
+
+	~SQLiteSessionPool()
+		/// Destroys the SQLiteSessionPool.
+	{
+	}
+
+	const ConnectionSettings& settings() const
+		/// Returns the connection settings.
+	{
+		return _settings;
+	}
+
+protected:
+	void customizeSession(Session& session)
+	{
+		_settings.apply(session);
+	}
+
+private:
+	ConnectionSettings _settings;
+};
+
+
+class SQLiteReadWritePool
+	/// SQLiteReadWritePool separates writing to an SQLite database from
+	/// reading it: there is a single writer session (SQLite allows only
+	/// one writer at a time anyway), used under a lock, and a pool of
+	/// query-only reader sessions. With WAL journal mode, readers see the
+	/// last committed state and never block the writer, or vice versa.
+	///
+	///     SQLiteReadWritePool pool("history.db");
+	///     {
+	///         SQLiteReadWritePool::Writer writer(pool);
+	///         writer.session() << "INSERT INTO history VALUES (?, ?)", use(time), use(value), now;
+	///     }
+	///     Session reader = pool.reader();
+	///     reader << "SELECT ...", into(values), now;
+	///
+	/// The SQLite connector must have been registered with
+	/// Poco::Data::SQLite::Connector::registerConnector().
+{
+public:
+	class Writer
+		/// Provides exclusive access to the writer session
+		/// during its lifetime.
+	{
+	public:
+		explicit Writer(SQLiteReadWritePool& pool):
+			_lock(pool._writerMutex),
+			_session(pool._writer)
+		{
+		}
+
+		~Writer()
+		{
+		}
+
+		Session& session()
+			/// Returns the writer session.
+		{
+			return _session;
+		}
+
+	private:
+		Writer(const Writer&);
+		Writer& operator = (const Writer&);
+
+		Poco::FastMutex::ScopedLock _lock;
+		Session& _session;
+	};
+
+	explicit SQLiteReadWritePool(const std::string& fileName,
+		const ConnectionSettings& settings = ConnectionSettings(),
+		int maxReaders = 8,
+		int idleTime = 60):
+		_writer(Connector::KEY, fileName),
+		_pReaders(new SQLiteSessionPool(fileName, readerSettings(settings), 1, maxReaders, idleTime))
+		/// Creates the SQLiteReadWritePool for the given database file,
+		/// opening the writer session. The journal mode is set by the
+		/// writer only; readers are query-only.
+	{
+		settings.apply(_writer);
+	}
+
+	~SQLiteReadWritePool()
+		/// Shuts down the reader pool and closes the writer session.
+	{
+		try
+		{
+			_pReaders->shutdown();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	Session reader()
+		/// Returns a reader session from the pool. Throws a
+		/// SessionPoolExhaustedException if all readers are in use.
+	{
+		return _pReaders->get();
+	}
+
+	SQLiteSessionPool& readers()
+		/// Returns the reader pool.
+	{
+		return *_pReaders;
+	}
+
+protected:
+	static ConnectionSettings readerSettings(const ConnectionSettings& settings)
+	{
+		ConnectionSettings result(settings);
+		result.journalMode.clear();
+		result.queryOnly = true;
+		return result;
+	}
+
+private:
+	SQLiteReadWritePool(const SQLiteReadWritePool&);
+	SQLiteReadWritePool& operator = (const SQLiteReadWritePool&);
+
+	Session _writer;
+	Poco::FastMutex _writerMutex;
+	SQLiteSessionPool::Ptr _pReaders;
+
+	friend class Writer;
+};
+
+
+} } } // namespace Poco::Data::SQLite
+
+
+#endif // Data_SQLite_SQLiteSessionPool_INCLUDED
@@ -0,0 +1,419 @@
+//
+// StatementCache.h
+//
+// $Id$
+//
+// Library: Data/SQLite
+// Package: SQLite
+// Module:  StatementCache
+//
+// Definition of the CachedStatement and StatementCache classes.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Data_SQLite_StatementCache_INCLUDED
+#define Data_SQLite_StatementCache_INCLUDED
+
+
+#include "Poco/Data/SQLite/SQLite.h"
+#include "Poco/Data/SQLite/Utility.h"
+#include "Poco/Data/SQLite/SQLiteException.h"
+#include "Poco/Data/Session.h"
+#include "Poco/Data/LOB.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Types.h"
+#include <map>
+#include <list>
+#include "sqlite3.h"
+
+
+namespace Poco {
+namespace Data {
+namespace SQLite {
+
+
+class StatementCache;
+
+
+class CachedStatement
+	/// A prepared SQLite statement obtained from a StatementCache.
+	/// The statement is given back to the cache, with its bindings
+	/// cleared, when the CachedStatement is destroyed.
+	///
+	/// Parameters are bound by position, starting at 1, and result
+	/// columns are accessed by index, starting at 0, as in the SQLite
+	/// C API.
+{
+public:
+	typedef Poco::SharedPtr<CachedStatement> Ptr;
+
+	~CachedStatement();
+		/// Gives the statement back to the StatementCache.
+
+	CachedStatement& bind(int pos, Poco::Int32 value)
+	{
+		check(sqlite3_bind_int(_pStmt, pos, value));
+		return *this;
+	}
+
+	CachedStatement& bind(int pos, Poco::UInt32 value)
+	{
+		check(sqlite3_bind_int64(_pStmt, pos, static_cast<sqlite3_int64>(value)));
+		return *this;
+	}
+
+	CachedStatement& bind(int pos, Poco::Int64 value)
+	{
+		check(sqlite3_bind_int64(_pStmt, pos, static_cast<sqlite3_int64>(value)));
+		return *this;
+	}
+
+	CachedStatement& bind(int pos, bool value)
+	{
+		check(sqlite3_bind_int(_pStmt, pos, value ? 1 : 0));
+		return *this;
+	}
+
+	CachedStatement& bind(int pos, double value)
+	{
+		check(sqlite3_bind_double(_pStmt, pos, value));
+		return *this;
+	}
+
+	CachedStatement& bind(int pos, const std::string& value)
+		/// Binds a string. The string must not change until
+		/// the statement has been executed.
+	{
+		check(sqlite3_bind_text(_pStmt, pos, value.data(), static_cast<int>(value.size()), SQLITE_STATIC));
+		return *this;
+	}
+
+	CachedStatement& bind(int pos, const char* value)
+		/// Binds a null-terminated string, which must not
+		/// change until the statement has been executed.
+	{
+		check(sqlite3_bind_text(_pStmt, pos, value, -1, SQLITE_STATIC));
+		return *this;
+	}
+
+	CachedStatement& bind(int pos, const Poco::Data::BLOB& value)
+		/// Binds a BLOB, which must not change until
+		/// the statement has been executed.
+	{
+		check(sqlite3_bind_blob(_pStmt, pos, value.rawContent(), static_cast<int>(value.size()), SQLITE_STATIC));
+		return *this;
+	}
+
+	CachedStatement& bindZeroBlob(int pos, std::size_t size)
+		/// Binds a BLOB of the given size filled with zeros, to be
+		/// written later with an IncrementalBlob.
+	{
+#if SQLITE_VERSION_NUMBER >= 3008011
+		check(sqlite3_bind_zeroblob64(_pStmt, pos, static_cast<sqlite3_uint64>(size)));
+#else
+		check(sqlite3_bind_zeroblob(_pStmt, pos, static_cast<int>(size)));
+#endif
+		return *this;
+	}
+
+	CachedStatement& bindNull(int pos)
+	{
+		check(sqlite3_bind_null(_pStmt, pos));
+		return *this;
+	}
+
+	bool step()
+		/// Executes the statement until the next result row. Returns
+		/// true if a row is available, or false if the statement is done.
+	{
+		int rc = sqlite3_step(_pStmt);
+		if (rc == SQLITE_ROW) return true;
+		if (rc == SQLITE_DONE) return false;
+		sqlite3_reset(_pStmt);
+		Utility::throwException(rc, Utility::lastError(_pDB));
+		return false;
+	}
+
+	int execute()
+		/// Executes the statement, discarding result rows, resets it
+		/// for the next execution (keeping the bindings), and returns
+		/// the number of rows changed.
+	{
+		while (step())
+		{
+		}
+		reset();
+		return sqlite3_changes(_pDB);
+	}
+
+	void reset()
+		/// Resets the statement for the next execution.
+		/// Bindings are kept.
+	{
+		sqlite3_reset(_pStmt);
+	}
+
+	void clearBindings()
+		/// Sets all parameters to NULL.
+	{
+		sqlite3_clear_bindings(_pStmt);
+	}
+
+	int columnCount() const
+	{
+		return sqlite3_column_count(_pStmt);
+	}
+
+	bool isNull(int col) const
+	{
+		return sqlite3_column_type(_pStmt, col) == SQLITE_NULL;
+	}
+
+	Poco::Int64 int64(int col) const
+	{
+		return static_cast<Poco::Int64>(sqlite3_column_int64(_pStmt, col));
+	}
+
+	double real(int col) const
+	{
+		return sqlite3_column_double(_pStmt, col);
+	}
+
+	std::string text(int col) const
+	{
+		const char* p = reinterpret_cast<const char*>(sqlite3_column_text(_pStmt, col));
+		return p ? std::string(p, static_cast<std::size_t>(sqlite3_column_bytes(_pStmt, col))) : std::string();
+	}
+
+	const unsigned char* blob(int col) const
+		/// Returns a pointer to the BLOB value of the given column of the
+		/// current row, without copying it, or a null pointer if the value
+		/// is NULL or empty. The pointer is valid until the next call to
+		/// step() or reset(). The size is returned by bytes().
+	{
+		return static_cast<const unsigned char*>(sqlite3_column_blob(_pStmt, col));
+	}
+
+	std::size_t bytes(int col) const
+		/// Returns the size in bytes of the BLOB or text value
+		/// of the given column of the current row.
+	{
+		return static_cast<std::size_t>(sqlite3_column_bytes(_pStmt, col));
+	}
+
+	Poco::Int64 lastInsertRowid() const
+		/// Returns the rowid of the last row inserted
+		/// through the database connection.
+	{
+		return static_cast<Poco::Int64>(sqlite3_last_insert_rowid(_pDB));
+	}
+
+	sqlite3_stmt* handle() const
+		/// Returns the SQLite statement handle.
+	{
+		return _pStmt;
+	}
+
+protected:
+	CachedStatement(StatementCache& cache, const std::string& sql, sqlite3* pDB, sqlite3_stmt* pStmt):
+		_cache(cache),
+		_sql(sql),
+		_pDB(pDB),
+		_pStmt(pStmt)
+	{
+	}
+
+	void check(int rc)
+	{
+		if (rc != SQLITE_OK) Utility::throwException(rc, Utility::lastError(_pDB));
+	}
+
+private:
+	CachedStatement(const CachedStatement&);
+	CachedStatement& operator = (const CachedStatement&);
+
+	StatementCache& _cache;
+	std::string _sql;
+	sqlite3* _pDB;
+	sqlite3_stmt* _pStmt;
+
+	friend class StatementCache;
+};
+
+
+class StatementCache
+	/// StatementCache keeps prepared SQLite statements of a Session,
+	/// keyed by SQL text, so that statements executed repeatedly (e.g.
+	/// the INSERT of a metric log) are compiled only once. The least
+	/// recently used statements are finalized when the capacity is
+	/// exceeded.
+	///
+	/// A statement obtained with prepare() is removed from the cache
+	/// while in use, so the same SQL can be in use more than once.
+	///
+	///     StatementCache cache(session);
+	///     CachedStatement::Ptr pStmt = cache.prepare("INSERT INTO log VALUES (?, ?)");
+	///     pStmt->bind(1, time).bind(2, value).execute();
+	///
+	/// Like a Session, a StatementCache must not be used by more than
+	/// one thread at a time. The StatementCache must outlive all
+	/// CachedStatements obtained from it.
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY = 32
+	};
+
+	explicit StatementCache(const Session& session, std::size_t capacity = DEFAULT_CAPACITY):
+		_session(session),
+		_pDB(Utility::dbHandle(session)),
+		_capacity(capacity > 0 ? capacity : 1),
+		_hits(0),
+		_misses(0)
+		/// Creates the StatementCache for the given SQLite session.
+	{
+	}
+
+	~StatementCache()
+		/// Finalizes all cached statements.
+	{
+		clear();
+	}
+
+	CachedStatement::Ptr prepare(const std::string& sql)
+		/// Returns a prepared statement for the given SQL, from the
+		/// cache if possible.
+	{
+		sqlite3_stmt* pStmt = 0;
+		Map::iterator it = _map.find(sql);
+		if (it != _map.end())
+		{
+			pStmt = it->second->pStmt;
+			_lru.erase(it->second);
+			_map.erase(it);
+			++_hits;
+		}
+		else
+		{
+			const char* pTail = 0;
+#if SQLITE_VERSION_NUMBER >= 3020000
+			int rc = sqlite3_prepare_v3(_pDB, sql.data(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &pStmt, &pTail);
+#else
+			int rc = sqlite3_prepare_v2(_pDB, sql.data(), static_cast<int>(sql.size()), &pStmt, &pTail);
+#endif
+			if (rc != SQLITE_OK) Utility::throwException(rc, Utility::lastError(_pDB) + ": " + sql);
+			if (!pStmt) throw InvalidSQLStatementException("Empty statement", sql);
+			++_misses;
+		}
+		return new CachedStatement(*this, sql, _pDB, pStmt);
+	}
+
+	void clear()
+		/// Finalizes all cached statements.
+	{
+		for (List::iterator it = _lru.begin(); it != _lru.end(); ++it)
+		{
+			sqlite3_finalize(it->pStmt);
+		}
+		_lru.clear();
+		_map.clear();
+	}
+
+	std::size_t size() const
+		/// Returns the number of cached statements.
+	{
+		return _map.size();
+	}
+
+	std::size_t capacity() const
+		/// Returns the maximum number of cached statements.
+	{
+		return _capacity;
+	}
+
+	Poco::UInt64 hits() const
+		/// Returns the number of statements taken from the cache.
+	{
+		return _hits;
+	}
+
+	Poco::UInt64 misses() const
+		/// Returns the number of statements that had to be prepared.
+	{
+		return _misses;
+	}
+
+	Session& session()
+		/// Returns the Session.
+	{
+		return _session;
+	}
+
+protected:
+	struct Entry
+	{
+		std::string sql;
+		sqlite3_stmt* pStmt;
+	};
+
+	typedef std::list<Entry> List;
+	typedef std::map<std::string, List::iterator> Map;
+
+	void giveBack(const std::string& sql, sqlite3_stmt* pStmt)
+		/// Resets the statement and puts it back into the cache.
+	{
+		sqlite3_reset(pStmt);
+		sqlite3_clear_bindings(pStmt);
+		if (_map.find(sql) != _map.end())
+		{
+			sqlite3_finalize(pStmt);
+			return;
+		}
+		Entry entry;
+		entry.sql = sql;
+		entry.pStmt = pStmt;
+		_lru.push_front(entry);
+		_map[sql] = _lru.begin();
+		if (_map.size() > _capacity)
+		{
+			sqlite3_finalize(_lru.back().pStmt);
+			_map.erase(_lru.back().sql);
+			_lru.pop_back();
+		}
+	}
+
+private:
+	StatementCache(const StatementCache&);
+	StatementCache& operator = (const StatementCache&);
+
+	Session _session;
+	sqlite3* _pDB;
+	std::size_t _capacity;
+	List _lru;
+	Map _map;
+	Poco::UInt64 _hits;
+	Poco::UInt64 _misses;
+
+	friend class CachedStatement;
+};
+
+
+//
+// inlines
+//
+inline CachedStatement::~CachedStatement()
+{
+	_cache.giveBack(_sql, _pStmt);
+}
+
+
+} } } // namespace Poco::Data::SQLite
+
+
+#endif // Data_SQLite_StatementCache_INCLUDED
@@ -0,0 +1,307 @@
+//
+// FastAscii.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  FastAscii
+//
+// Definition of the FastAscii class.
+//
+// Copyright (c) 2010, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FastAscii_INCLUDED
+#define Foundation_FastAscii_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include <cstddef>
+#include <cstring>
+#if defined(__SSE2__) && !defined(POCO_FASTASCII_NO_SIMD)
+#include <emmintrin.h>
+#define POCO_FASTASCII_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(POCO_FASTASCII_NO_SIMD)
+#include <arm_neon.h>
+#define POCO_FASTASCII_NEON 1
+#endif
+
+
+namespace Poco {
+
+
+class FastAscii
+	/// This class contains vectorized implementations of the
+	/// character classification and conversion loops of the
+	/// string functions in String.h, working on 16 characters
+	/// at a time with SSE2 or NEON (on AArch64), and one
+	/// character at a time otherwise.
+	///
+	/// All functions give exactly the same results as the
+	/// corresponding loops using the Ascii class: only the
+	/// ASCII characters 'A' to 'Z' and 'a' to 'z' are
+	/// converted, and only ' ', '\t', '\n', '\v', '\f'
+	/// and '\r' are whitespace. Characters outside the
+	/// ASCII range are never changed.
+	///
+	/// The functions are used by the std::string overloads
+	/// of toLower(), toUpper(), icompare(), trim(),
+	/// replace() and translate() in String.h.
+{
+public:
+	enum
+	{
+		BLOCK_SIZE = 16
+	};
+
+	static void toLowerInPlace(char* p, std::size_t n)
+		/// Converts all upper-case characters to lower case.
+	{
+		convert(p, n, 'A');
+	}
+
+	static void toUpperInPlace(char* p, std::size_t n)
+		/// Converts all lower-case characters to upper case.
+	{
+		convert(p, n, 'a');
+	}
+
+	static int icompare(const char* p1, std::size_t n1, const char* p2, std::size_t n2)
+		/// Compares two strings, ignoring case, like Poco::icompare(),
+		/// returning -1, 0 or 1.
+	{
+		std::size_t n = n1 < n2 ? n1 : n2;
+		std::size_t i = 0;
+#if defined(POCO_FASTASCII_SSE2)
+		for (; i + BLOCK_SIZE <= n; i += BLOCK_SIZE)
+		{
+			__m128i x1 = lower(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p1 + i)));
+			__m128i x2 = lower(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p2 + i)));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x1, x2)));
+			if (mask != 0xFFFF)
+			{
+				i += countTrailingZeros(~mask);
+				break;
+			}
+		}
+#elif defined(POCO_FASTASCII_NEON)
+		for (; i + BLOCK_SIZE <= n; i += BLOCK_SIZE)
+		{
+			uint8x16_t x1 = lower(vld1q_u8(reinterpret_cast<const uint8_t*>(p1 + i)));
+			uint8x16_t x2 = lower(vld1q_u8(reinterpret_cast<const uint8_t*>(p2 + i)));
+			if (vminvq_u8(vceqq_u8(x1, x2)) == 0) break;
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			char c1 = toLower(p1[i]);
+			char c2 = toLower(p2[i]);
+			if (c1 < c2)
+				return -1;
+			else if (c1 > c2)
+				return 1;
+		}
+		if (n1 == n2)
+			return 0;
+		else
+			return n1 < n2 ? -1 : 1;
+	}
+
+	static std::size_t findFirstNonSpace(const char* p, std::size_t n)
+		/// Returns the position of the first character that is not
+		/// whitespace, or n, if all characters are whitespace.
+	{
+		std::size_t i = 0;
+#if defined(POCO_FASTASCII_SSE2)
+		for (; i + BLOCK_SIZE <= n; i += BLOCK_SIZE)
+		{
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(space(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)))));
+			if (mask != 0xFFFF) return i + countTrailingZeros(~mask);
+		}
+#elif defined(POCO_FASTASCII_NEON)
+		for (; i + BLOCK_SIZE <= n; i += BLOCK_SIZE)
+		{
+			if (vminvq_u8(space(vld1q_u8(reinterpret_cast<const uint8_t*>(p + i)))) == 0) break;
+		}
+#endif
+		while (i < n && isSpace(p[i])) ++i;
+		return i;
+	}
+
+	static std::size_t findLastNonSpace(const char* p, std::size_t n)
+		/// Returns the position after the last character that is
+		/// not whitespace, or 0, if all characters are whitespace.
+	{
+#if defined(POCO_FASTASCII_SSE2)
+		for (; n >= BLOCK_SIZE; n -= BLOCK_SIZE)
+		{
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(space(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n - BLOCK_SIZE)))));
+			if (mask != 0xFFFF) return n - BLOCK_SIZE + highestBit(~mask & 0xFFFF) + 1;
+		}
+#elif defined(POCO_FASTASCII_NEON)
+		for (; n >= BLOCK_SIZE; n -= BLOCK_SIZE)
+		{
+			if (vminvq_u8(space(vld1q_u8(reinterpret_cast<const uint8_t*>(p + n - BLOCK_SIZE)))) == 0) break;
+		}
+#endif
+		while (n > 0 && isSpace(p[n - 1])) --n;
+		return n;
+	}
+
+	static void replaceInPlace(char* p, std::size_t n, char from, char to)
+		/// Replaces all occurrences of from with to.
+	{
+		std::size_t i = 0;
+#if defined(POCO_FASTASCII_SSE2)
+		const __m128i vfrom = _mm_set1_epi8(from);
+		const __m128i vto = _mm_set1_epi8(to);
+		for (; i + BLOCK_SIZE <= n; i += BLOCK_SIZE)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			__m128i m = _mm_cmpeq_epi8(x, vfrom);
+			if (_mm_movemask_epi8(m))
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_or_si128(_mm_andnot_si128(m, x), _mm_and_si128(m, vto)));
+			}
+		}
+#elif defined(POCO_FASTASCII_NEON)
+		const uint8x16_t vfrom = vdupq_n_u8(static_cast<uint8_t>(from));
+		const uint8x16_t vto = vdupq_n_u8(static_cast<uint8_t>(to));
+		for (; i + BLOCK_SIZE <= n; i += BLOCK_SIZE)
+		{
+			uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t*>(p + i));
+			uint8x16_t m = vceqq_u8(x, vfrom);
+			if (vmaxvq_u8(m))
+			{
+				vst1q_u8(reinterpret_cast<uint8_t*>(p + i), vbslq_u8(m, vto, x));
+			}
+		}
+#else
+		// without SIMD, memchr() is faster than a loop
+		char* end = p + n;
+		while ((p = static_cast<char*>(std::memchr(p, from, end - p))))
+		{
+			*p++ = to;
+		}
+		return;
+#endif
+		for (; i < n; ++i)
+		{
+			if (p[i] == from) p[i] = to;
+		}
+	}
+
+	static char toLower(char ch)
+	{
+		return static_cast<unsigned char>(ch - 'A') < 26 ? static_cast<char>(ch + 32) : ch;
+	}
+
+	static char toUpper(char ch)
+	{
+		return static_cast<unsigned char>(ch - 'a') < 26 ? static_cast<char>(ch - 32) : ch;
+	}
+
+	static bool isSpace(char ch)
+	{
+		return ch == ' ' || static_cast<unsigned char>(ch - '\t') < 5;
+	}
+
+protected:
+	static void convert(char* p, std::size_t n, char first)
+		/// Flips the case of all characters from first to first + 25.
+	{
+		std::size_t i = 0;
+#if defined(POCO_FASTASCII_SSE2)
+		const __m128i offset = _mm_set1_epi8(static_cast<char>(0x80 - first));
+		const __m128i limit = _mm_set1_epi8(static_cast<char>(0x80 + 26));
+		const __m128i flip = _mm_set1_epi8(0x20);
+		for (; i + BLOCK_SIZE <= n; i += BLOCK_SIZE)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			__m128i m = _mm_cmplt_epi8(_mm_add_epi8(x, offset), limit);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(x, _mm_and_si128(m, flip)));
+		}
+#elif defined(POCO_FASTASCII_NEON)
+		const uint8x16_t vfirst = vdupq_n_u8(static_cast<uint8_t>(first));
+		const uint8x16_t limit = vdupq_n_u8(26);
+		const uint8x16_t flip = vdupq_n_u8(0x20);
+		for (; i + BLOCK_SIZE <= n; i += BLOCK_SIZE)
+		{
+			uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t*>(p + i));
+			uint8x16_t m = vcltq_u8(vsubq_u8(x, vfirst), limit);
+			vst1q_u8(reinterpret_cast<uint8_t*>(p + i), veorq_u8(x, vandq_u8(m, flip)));
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			if (static_cast<unsigned char>(p[i] - first) < 26) p[i] = static_cast<char>(p[i] ^ 0x20);
+		}
+	}
+
+#if defined(POCO_FASTASCII_SSE2)
+
+	static __m128i lower(__m128i x)
+	{
+		__m128i m = _mm_cmplt_epi8(_mm_add_epi8(x, _mm_set1_epi8(static_cast<char>(0x80 - 'A'))), _mm_set1_epi8(static_cast<char>(0x80 + 26)));
+		return _mm_or_si128(x, _mm_and_si128(m, _mm_set1_epi8(0x20)));
+	}
+
+	static __m128i space(__m128i x)
+	{
+		__m128i ctrl = _mm_cmplt_epi8(_mm_add_epi8(x, _mm_set1_epi8(static_cast<char>(0x80 - '\t'))), _mm_set1_epi8(static_cast<char>(0x80 + 5)));
+		return _mm_or_si128(ctrl, _mm_cmpeq_epi8(x, _mm_set1_epi8(' ')));
+	}
+
+	static std::size_t countTrailingZeros(unsigned mask)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<std::size_t>(__builtin_ctz(mask));
+#else
+		std::size_t n = 0;
+		while ((mask & 1) == 0)
+		{
+			mask >>= 1;
+			++n;
+		}
+		return n;
+#endif
+	}
+
+	static std::size_t highestBit(unsigned mask)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<std::size_t>(31 - __builtin_clz(mask));
+#else
+		std::size_t n = 0;
+		while (mask >>= 1) ++n;
+		return n;
+#endif
+	}
+
+#elif defined(POCO_FASTASCII_NEON)
+
+	static uint8x16_t lower(uint8x16_t x)
+	{
+		uint8x16_t m = vcltq_u8(vsubq_u8(x, vdupq_n_u8('A')), vdupq_n_u8(26));
+		return vorrq_u8(x, vandq_u8(m, vdupq_n_u8(0x20)));
+	}
+
+	static uint8x16_t space(uint8x16_t x)
+	{
+		uint8x16_t ctrl = vcltq_u8(vsubq_u8(x, vdupq_n_u8('\t')), vdupq_n_u8(5));
+		return vorrq_u8(ctrl, vceqq_u8(x, vdupq_n_u8(' ')));
+	}
+
+#endif
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FastAscii_INCLUDED
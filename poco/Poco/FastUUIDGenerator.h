@@ -0,0 +1,193 @@
+//
+// FastUUIDGenerator.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: UUID
+// Module:  FastUUIDGenerator
+//
+// Definition of the FastUUIDGenerator class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FastUUIDGenerator_INCLUDED
+#define Foundation_FastUUIDGenerator_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/UUID.h"
+#include "Poco/RandomPool.h"
+#include "Poco/Environment.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Mutex.h"
+#include "Poco/AtomicCounter.h"
+#if defined(POCO_HAVE_STD_ATOMICS)
+#include <atomic>
+#endif
+#include <cstring>
+
+
+namespace Poco {
+
+
+class FastUUIDGenerator
+	/// FastUUIDGenerator creates the same kinds of UUIDs as the
+	/// create(), createRandom() and createOne() member functions
+	/// of UUIDGenerator, without serializing the threads calling it.
+	///
+	/// UUIDGenerator takes a mutex for every UUID, and reads random
+	/// UUIDs from a shared RandomInputStream. FastUUIDGenerator
+	/// takes the random bytes from the per-thread pools of
+	/// RandomPool, and reserves the timestamps of time-based UUIDs
+	/// with an atomic compare-and-swap on the last timestamp used,
+	/// so that no two UUIDs created by the process get the same
+	/// timestamp, even if many are created within 100 nanoseconds.
+	///
+	/// The clock sequence of time-based UUIDs is chosen randomly
+	/// for every FastUUIDGenerator, the MAC address is determined
+	/// once, by the constructor.
+{
+public:
+	FastUUIDGenerator():
+		_haveNode(false),
+		_clockSeq(static_cast<UInt16>((RandomPool::next32() & 0x3FFF) | 0x8000)),
+		_lastTime(0)
+		/// Creates the FastUUIDGenerator.
+	{
+		try
+		{
+			Environment::nodeId(_node);
+			_haveNode = true;
+		}
+		catch (Exception&)
+		{
+		}
+	}
+
+	~FastUUIDGenerator()
+		/// Destroys the FastUUIDGenerator.
+	{
+	}
+
+	UUID create()
+		/// Creates a new time-based UUID, using the MAC address of
+		/// one of the system's ethernet adapters.
+		///
+		/// Throws a SystemException if no MAC address can be
+		/// obtained.
+	{
+		if (!_haveNode) throw SystemException("cannot get MAC address");
+
+		UInt64 time = timeStamp();
+		unsigned char bytes[16];
+		UInt32 timeLow = static_cast<UInt32>(time & 0xFFFFFFFF);
+		UInt16 timeMid = static_cast<UInt16>((time >> 32) & 0xFFFF);
+		UInt16 timeHiAndVersion = static_cast<UInt16>(((time >> 48) & 0x0FFF) | (UUID::UUID_TIME_BASED << 12));
+		bytes[0]  = static_cast<unsigned char>(timeLow >> 24);
+		bytes[1]  = static_cast<unsigned char>(timeLow >> 16);
+		bytes[2]  = static_cast<unsigned char>(timeLow >> 8);
+		bytes[3]  = static_cast<unsigned char>(timeLow);
+		bytes[4]  = static_cast<unsigned char>(timeMid >> 8);
+		bytes[5]  = static_cast<unsigned char>(timeMid);
+		bytes[6]  = static_cast<unsigned char>(timeHiAndVersion >> 8);
+		bytes[7]  = static_cast<unsigned char>(timeHiAndVersion);
+		bytes[8]  = static_cast<unsigned char>(_clockSeq >> 8);
+		bytes[9]  = static_cast<unsigned char>(_clockSeq);
+		std::memcpy(bytes + 10, _node, 6);
+		UUID uuid;
+		uuid.copyFrom(reinterpret_cast<const char*>(bytes));
+		return uuid;
+	}
+
+	UUID createRandom()
+		/// Creates a random UUID.
+	{
+		unsigned char bytes[16];
+		RandomPool::fill(bytes, sizeof(bytes));
+		bytes[6] = static_cast<unsigned char>((bytes[6] & 0x0F) | (UUID::UUID_RANDOM << 4));
+		bytes[8] = static_cast<unsigned char>((bytes[8] & 0x3F) | 0x80);
+		UUID uuid;
+		uuid.copyFrom(reinterpret_cast<const char*>(bytes));
+		return uuid;
+	}
+
+	UUID createOne()
+		/// Creates a time-based UUID (see create()) if the MAC
+		/// address is known, and a random UUID (see createRandom())
+		/// otherwise.
+	{
+		return _haveNode ? create() : createRandom();
+	}
+
+	bool haveNode() const
+		/// Returns true if the MAC address is known,
+		/// and time-based UUIDs can be created.
+	{
+		return _haveNode;
+	}
+
+	static FastUUIDGenerator& defaultGenerator()
+		/// Returns a reference to the default FastUUIDGenerator.
+	{
+		static FastUUIDGenerator generator;
+		return generator;
+	}
+
+protected:
+	UInt64 timeStamp()
+		/// Returns a timestamp, in 100 nanosecond intervals since
+		/// the Gregorian calendar reform, greater than all
+		/// timestamps returned before.
+	{
+		UInt64 now = static_cast<UInt64>(Timestamp().utcTime());
+#if defined(POCO_HAVE_STD_ATOMICS)
+		UInt64 last = _lastTime.load(std::memory_order_relaxed);
+		UInt64 next;
+		do
+		{
+			next = now > last ? now : last + 1;
+		}
+		while (!_lastTime.compare_exchange_weak(last, next, std::memory_order_relaxed));
+		return next;
+#elif defined(POCO_HAVE_GCC_ATOMICS)
+		for (;;)
+		{
+			UInt64 last = _lastTime;
+			UInt64 next = now > last ? now : last + 1;
+			if (__sync_bool_compare_and_swap(&_lastTime, last, next)) return next;
+		}
+#else
+		FastMutex::ScopedLock lock(_mutex);
+		_lastTime = now > _lastTime ? now : _lastTime + 1;
+		return _lastTime;
+#endif
+	}
+
+private:
+	FastUUIDGenerator(const FastUUIDGenerator&);
+	FastUUIDGenerator& operator = (const FastUUIDGenerator&);
+
+	Environment::NodeId _node;
+	bool _haveNode;
+	UInt16 _clockSeq;
+#if defined(POCO_HAVE_STD_ATOMICS)
+	std::atomic<UInt64> _lastTime;
+#elif defined(POCO_HAVE_GCC_ATOMICS)
+	volatile UInt64 _lastTime;
+#else
+	UInt64 _lastTime;
+	FastMutex _mutex;
+#endif
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FastUUIDGenerator_INCLUDED
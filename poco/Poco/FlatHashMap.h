@@ -0,0 +1,221 @@
+//
+// FlatHashMap.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Hashing
+// Module:  FlatHashMap
+//
+// Definition of the FlatHashMap class.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FlatHashMap_INCLUDED
+#define Foundation_FlatHashMap_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/FlatHashTable.h"
+#include "Poco/Exception.h"
+#include <utility>
+
+
+namespace Poco {
+
+
+template <class Key, class Mapped>
+struct FlatHashMapKeyOf
+	/// This class template is used internally by FlatHashMap.
+{
+	const Key& operator () (const std::pair<const Key, Mapped>& value) const
+	{
+		return value.first;
+	}
+};
+
+
+template <class Key, class Mapped, class HashFunc = FlatHashFunction<Key> >
+class FlatHashMap
+	/// This class implements a map using a FlatHashTable.
+	///
+	/// A FlatHashMap can be used just like a HashMap, except
+	/// that its value type is std::pair<const Key, Mapped>,
+	/// and that inserts and erases invalidate all iterators.
+	/// Lookups are a lot faster, and a FlatHashMap with
+	/// std::string keys can be searched with a C string,
+	/// without constructing a std::string:
+	///
+	///     Poco::FlatHashMap<std::string, int> map;
+	///     map.insert(std::make_pair(std::string("osp.core"), 1));
+	///     if (map.find("osp.core") != map.end()) ...
+	///
+	/// See FlatHashTable for more information.
+{
+public:
+	typedef Key                          KeyType;
+	typedef Mapped                       MappedType;
+	typedef Mapped&                      Reference;
+	typedef const Mapped&                ConstReference;
+	typedef Mapped*                      Pointer;
+	typedef const Mapped*                ConstPointer;
+
+	typedef std::pair<const Key, Mapped> ValueType;
+	typedef ValueType                    PairType;
+
+	typedef HashFunc                     Hash;
+
+	typedef FlatHashTable<ValueType, KeyType, FlatHashMapKeyOf<Key, Mapped>, HashFunc> HashTable;
+
+	typedef typename HashTable::Iterator      Iterator;
+	typedef typename HashTable::ConstIterator ConstIterator;
+
+	FlatHashMap()
+		/// Creates an empty FlatHashMap.
+	{
+	}
+
+	FlatHashMap(std::size_t initialReserve):
+		_table(initialReserve)
+		/// Creates the FlatHashMap with room for the
+		/// given number of elements.
+	{
+	}
+
+	FlatHashMap(const FlatHashMap& map):
+		_table(map._table)
+		/// Creates the FlatHashMap by copying another one.
+	{
+	}
+
+	~FlatHashMap()
+		/// Destroys the FlatHashMap.
+	{
+	}
+
+	FlatHashMap& operator = (const FlatHashMap& map)
+		/// Assigns another FlatHashMap.
+	{
+		FlatHashMap tmp(map);
+		swap(tmp);
+		return *this;
+	}
+
+	void swap(FlatHashMap& map)
+		/// Swaps the FlatHashMap with another one.
+	{
+		_table.swap(map._table);
+	}
+
+	ConstIterator begin() const
+	{
+		return _table.begin();
+	}
+
+	ConstIterator end() const
+	{
+		return _table.end();
+	}
+
+	Iterator begin()
+	{
+		return _table.begin();
+	}
+
+	Iterator end()
+	{
+		return _table.end();
+	}
+
+	template <class K>
+	ConstIterator find(const K& key) const
+	{
+		return _table.find(key);
+	}
+
+	template <class K>
+	Iterator find(const K& key)
+	{
+		return _table.find(key);
+	}
+
+	template <class K>
+	std::size_t count(const K& key) const
+	{
+		return _table.count(key);
+	}
+
+	std::pair<Iterator, bool> insert(const ValueType& pair)
+	{
+		return _table.insert(pair);
+	}
+
+	void erase(Iterator it)
+	{
+		_table.erase(it);
+	}
+
+	template <class K>
+	std::size_t erase(const K& key)
+	{
+		return _table.erase(key);
+	}
+
+	void clear()
+	{
+		_table.clear();
+	}
+
+	void reserve(std::size_t size)
+	{
+		_table.reserve(size);
+	}
+
+	std::size_t size() const
+	{
+		return _table.size();
+	}
+
+	bool empty() const
+	{
+		return _table.empty();
+	}
+
+	HashStatistic currentState(bool details = false) const
+	{
+		return _table.currentState(details);
+	}
+
+	template <class K>
+	ConstReference operator [] (const K& key) const
+	{
+		ConstIterator it = _table.find(key);
+		if (it != _table.end())
+			return it->second;
+		else
+			throw NotFoundException();
+	}
+
+	Reference operator [] (const KeyType& key)
+	{
+		Iterator it = _table.find(key);
+		if (it != _table.end())
+			return it->second;
+		else
+			return _table.insert(ValueType(key, Mapped())).first->second;
+	}
+
+private:
+	HashTable _table;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FlatHashMap_INCLUDED
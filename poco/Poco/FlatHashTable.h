@@ -0,0 +1,845 @@
+//
+// FlatHashTable.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Hashing
+// Module:  FlatHashTable
+//
+// Definition of the FlatHashTable class template.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FlatHashTable_INCLUDED
+#define Foundation_FlatHashTable_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Hash.h"
+#include "Poco/HashStatistic.h"
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstddef>
+#if defined(__SSE2__) && !defined(POCO_FLATHASH_NO_SSE2)
+#include <emmintrin.h>
+#define POCO_FLATHASH_SSE2 1
+#endif
+
+
+namespace Poco {
+
+
+template <class T>
+struct FlatHashFunction
+	/// The default hash function for FlatHashTable,
+	/// FlatHashMap and FlatHashSet, using Poco::hash().
+{
+	std::size_t operator () (const T& value) const
+	{
+		return Poco::hash(value);
+	}
+};
+
+
+template <>
+struct FlatHashFunction<std::string>
+	/// The default hash function for std::string keys.
+	///
+	/// Also accepts C strings, giving the same hash value
+	/// as for the equivalent std::string, so that a table
+	/// with std::string keys can be searched with a C string
+	/// without constructing a temporary std::string.
+{
+	std::size_t operator () (const std::string& value) const
+	{
+		return hashBytes(value.data(), value.size());
+	}
+
+	std::size_t operator () (const char* value) const
+	{
+		return hashBytes(value, std::strlen(value));
+	}
+
+	static std::size_t hashBytes(const char* data, std::size_t length)
+	{
+		const UInt64 M = 0x9E3779B97F4A7C15ULL;
+		UInt64 h = static_cast<UInt64>(length)*M;
+		while (length >= 8)
+		{
+			UInt64 v;
+			std::memcpy(&v, data, 8);
+			h = (h ^ v)*M;
+			h ^= h >> 32;
+			data += 8;
+			length -= 8;
+		}
+		if (length > 0)
+		{
+			UInt64 v = 0;
+			for (std::size_t i = 0; i < length; ++i)
+			{
+				v |= static_cast<UInt64>(static_cast<unsigned char>(data[i])) << (8*i);
+			}
+			h = (h ^ v)*M;
+			h ^= h >> 32;
+		}
+		return static_cast<std::size_t>(h);
+	}
+};
+
+
+template <class Value, class Key, class KeyOf, class HashFunc = FlatHashFunction<Key> >
+class FlatHashTable
+	/// This class implements an open addressing hash table with
+	/// flat storage, in the style of Google's SwissTable.
+	///
+	/// All values are stored in a single array of slots, and
+	/// every slot has a control byte in a separate array, telling
+	/// whether the slot is empty, deleted, or full, in which case
+	/// the control byte holds 7 bits of the hash value of the
+	/// value's key. Lookups compare the control bytes of a group
+	/// of 16 slots at once (with SSE2, or 8 slots with portable
+	/// 64-bit arithmetic, otherwise), and only compare keys
+	/// when the 7 hash bits match, therefore rarely touching
+	/// more than one cache line of slots.
+	///
+	/// Groups are probed quadratically. The table is grown
+	/// as soon as it is 7/8 full, and erased slots are reused
+	/// by later inserts or dropped when the table is rehashed.
+	///
+	/// Compared with LinearHashTable, there is no bucket vector
+	/// and no allocation per bucket, which makes FlatHashTable
+	/// considerably faster for lookups, especially for
+	/// registries that are built once and then mostly read.
+	/// However, inserts and erases invalidate all iterators,
+	/// and, if the table has to grow, references to values.
+	///
+	/// KeyOf is a function object that returns the key of
+	/// a value. Values are copied when the table grows.
+	///
+	/// All functions that take a key are templates, so that
+	/// a table can be searched with any type for which the
+	/// HashFunc has an overload giving the same hash value
+	/// as for the equivalent key, and which can be compared
+	/// with the key using operator ==, like a C string with
+	/// std::string keys and FlatHashFunction<std::string>.
+	///
+	/// This class is used internally by FlatHashMap and FlatHashSet.
+{
+public:
+	typedef Value               ValueType;
+	typedef Key                 KeyType;
+	typedef Value&              Reference;
+	typedef const Value&        ConstReference;
+	typedef Value*              Pointer;
+	typedef const Value*        ConstPointer;
+	typedef HashFunc            Hash;
+	typedef std::size_t         SizeType;
+
+	enum
+	{
+#if defined(POCO_FLATHASH_SSE2)
+		GROUP_WIDTH = 16
+#else
+		GROUP_WIDTH = 8
+#endif
+	};
+
+	enum Control
+	{
+		CTRL_EMPTY    = -128,
+		CTRL_DELETED  = -2,
+		CTRL_SENTINEL = -1
+	};
+
+	class ConstIterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Value                     value_type;
+		typedef std::ptrdiff_t            difference_type;
+		typedef const Value*              pointer;
+		typedef const Value&              reference;
+
+		ConstIterator():
+			_pCtrl(0),
+			_pSlot(0)
+		{
+		}
+
+		ConstIterator(const Int8* pCtrl, const Value* pSlot):
+			_pCtrl(pCtrl),
+			_pSlot(pSlot)
+		{
+		}
+
+		const Value& operator * () const
+		{
+			return *_pSlot;
+		}
+
+		const Value* operator -> () const
+		{
+			return _pSlot;
+		}
+
+		ConstIterator& operator ++ () // prefix
+		{
+			++_pCtrl;
+			++_pSlot;
+			skip();
+			return *this;
+		}
+
+		ConstIterator operator ++ (int) // postfix
+		{
+			ConstIterator tmp(*this);
+			++*this;
+			return tmp;
+		}
+
+		bool operator == (const ConstIterator& it) const
+		{
+			return _pCtrl == it._pCtrl;
+		}
+
+		bool operator != (const ConstIterator& it) const
+		{
+			return _pCtrl != it._pCtrl;
+		}
+
+	protected:
+		void skip()
+		{
+			while (*_pCtrl < CTRL_SENTINEL)
+			{
+				++_pCtrl;
+				++_pSlot;
+			}
+		}
+
+		const Int8* _pCtrl;
+		const Value* _pSlot;
+
+		friend class FlatHashTable;
+	};
+
+	class Iterator: public ConstIterator
+	{
+	public:
+		typedef Value* pointer;
+		typedef Value& reference;
+
+		Iterator()
+		{
+		}
+
+		Iterator(const Int8* pCtrl, Value* pSlot):
+			ConstIterator(pCtrl, pSlot)
+		{
+		}
+
+		Value& operator * () const
+		{
+			return *const_cast<Value*>(this->_pSlot);
+		}
+
+		Value* operator -> () const
+		{
+			return const_cast<Value*>(this->_pSlot);
+		}
+
+		Iterator& operator ++ () // prefix
+		{
+			ConstIterator::operator ++ ();
+			return *this;
+		}
+
+		Iterator operator ++ (int) // postfix
+		{
+			Iterator tmp(*this);
+			++*this;
+			return tmp;
+		}
+	};
+
+	FlatHashTable(std::size_t initialReserve = 0, const HashFunc& hash = HashFunc()):
+		_pCtrl(emptyControl()),
+		_pSlots(0),
+		_capacity(0),
+		_size(0),
+		_growthLeft(0),
+		_hash(hash)
+		/// Creates the FlatHashTable, with room for
+		/// the given number of values.
+	{
+		if (initialReserve > 0) reserve(initialReserve);
+	}
+
+	FlatHashTable(const FlatHashTable& table):
+		_pCtrl(emptyControl()),
+		_pSlots(0),
+		_capacity(0),
+		_size(0),
+		_growthLeft(0),
+		_hash(table._hash)
+		/// Creates the FlatHashTable by copying another one.
+	{
+		reserve(table._size);
+		for (ConstIterator it = table.begin(); it != table.end(); ++it)
+		{
+			insertUnique(*it, hashOf(KeyOf()(*it)));
+		}
+	}
+
+	~FlatHashTable()
+		/// Destroys the FlatHashTable.
+	{
+		destroy();
+	}
+
+	FlatHashTable& operator = (const FlatHashTable& table)
+		/// Assigns another FlatHashTable.
+	{
+		FlatHashTable tmp(table);
+		swap(tmp);
+		return *this;
+	}
+
+	void swap(FlatHashTable& table)
+		/// Swaps the FlatHashTable with another one.
+	{
+		using std::swap;
+		swap(_pCtrl, table._pCtrl);
+		swap(_pSlots, table._pSlots);
+		swap(_capacity, table._capacity);
+		swap(_size, table._size);
+		swap(_growthLeft, table._growthLeft);
+		swap(_hash, table._hash);
+	}
+
+	ConstIterator begin() const
+		/// Returns an iterator pointing to the first entry, if one exists.
+	{
+		ConstIterator it(_pCtrl, _pSlots);
+		it.skip();
+		return it;
+	}
+
+	ConstIterator end() const
+		/// Returns an iterator pointing to the end of the table.
+	{
+		return ConstIterator(_pCtrl + _capacity, _pSlots + _capacity);
+	}
+
+	Iterator begin()
+		/// Returns an iterator pointing to the first entry, if one exists.
+	{
+		Iterator it(_pCtrl, _pSlots);
+		it.skip();
+		return it;
+	}
+
+	Iterator end()
+		/// Returns an iterator pointing to the end of the table.
+	{
+		return Iterator(_pCtrl + _capacity, _pSlots + _capacity);
+	}
+
+	template <class K>
+	ConstIterator find(const K& key) const
+		/// Finds an entry in the table.
+	{
+		std::size_t i = findIndex(key, hashOf(key));
+		return ConstIterator(_pCtrl + i, _pSlots + i);
+	}
+
+	template <class K>
+	Iterator find(const K& key)
+		/// Finds an entry in the table.
+	{
+		std::size_t i = findIndex(key, hashOf(key));
+		return Iterator(_pCtrl + i, _pSlots + i);
+	}
+
+	template <class K>
+	std::size_t count(const K& key) const
+		/// Returns the number of elements with the given
+		/// key, which is either 1 or 0.
+	{
+		return findIndex(key, hashOf(key)) != _capacity ? 1 : 0;
+	}
+
+	std::pair<Iterator, bool> insert(const Value& value)
+		/// Inserts an element into the table.
+		///
+		/// If the element already exists in the table,
+		/// a pair(iterator, false) with iterator pointing to the
+		/// existing element is returned.
+		/// Otherwise, the element is inserted an a
+		/// pair(iterator, true) with iterator
+		/// pointing to the new element is returned.
+	{
+		std::size_t h = hashOf(KeyOf()(value));
+		std::size_t i = findIndex(KeyOf()(value), h);
+		if (i != _capacity)
+		{
+			return std::make_pair(Iterator(_pCtrl + i, _pSlots + i), false);
+		}
+		else
+		{
+			i = insertUnique(value, h);
+			return std::make_pair(Iterator(_pCtrl + i, _pSlots + i), true);
+		}
+	}
+
+	void erase(Iterator it)
+		/// Erases the element pointed to by it.
+	{
+		if (it != end())
+		{
+			eraseIndex(static_cast<std::size_t>(it._pSlot - _pSlots));
+		}
+	}
+
+	template <class K>
+	std::size_t erase(const K& key)
+		/// Erases the element with the given key, if it exists,
+		/// and returns the number of elements erased.
+	{
+		std::size_t i = findIndex(key, hashOf(key));
+		if (i != _capacity)
+		{
+			eraseIndex(i);
+			return 1;
+		}
+		else return 0;
+	}
+
+	void clear()
+		/// Erases all elements, keeping the table's capacity.
+	{
+		if (_capacity == 0) return;
+		for (std::size_t i = 0; i < _capacity; ++i)
+		{
+			if (_pCtrl[i] >= 0) _pSlots[i].~Value();
+		}
+		resetControl();
+		_size = 0;
+		_growthLeft = maxLoad(_capacity);
+	}
+
+	void reserve(std::size_t size)
+		/// Makes room for at least the given number of
+		/// elements, so that they can be inserted without
+		/// growing the table.
+	{
+		if (size > _size + _growthLeft)
+		{
+			rehash(capacityFor(size));
+		}
+	}
+
+	std::size_t size() const
+		/// Returns the number of elements in the table.
+	{
+		return _size;
+	}
+
+	bool empty() const
+		/// Returns true iff the table is empty.
+	{
+		return _size == 0;
+	}
+
+	std::size_t capacity() const
+		/// Returns the number of slots in the table.
+	{
+		return _capacity;
+	}
+
+	HashStatistic currentState(bool details = false) const
+		/// Returns the current internal state.
+		///
+		/// The number of zero entries is the number of slots
+		/// that are empty or have been erased. The maximum
+		/// entry is the largest number of groups that must be
+		/// probed to find an element. If details is true,
+		/// the detail vector holds that number of groups
+		/// for every slot, or 0 for a slot without a value.
+	{
+		UInt32 numberOfEntries = static_cast<UInt32>(_size);
+		UInt32 numZeroEntries = static_cast<UInt32>(_capacity - _size);
+		UInt32 maxEntriesPerHash = 0;
+		std::vector<UInt32> detailedEntriesPerHash;
+		if (details) detailedEntriesPerHash.reserve(_capacity);
+		for (std::size_t i = 0; i < _capacity; ++i)
+		{
+			UInt32 groups = 0;
+			if (_pCtrl[i] >= 0)
+			{
+				groups = probeLength(i, hashOf(KeyOf()(_pSlots[i])));
+				if (groups > maxEntriesPerHash) maxEntriesPerHash = groups;
+			}
+			if (details) detailedEntriesPerHash.push_back(groups);
+		}
+		return HashStatistic(static_cast<UInt32>(_capacity), numberOfEntries, numZeroEntries, maxEntriesPerHash, detailedEntriesPerHash);
+	}
+
+protected:
+	class BitMask
+		/// The result of matching the control bytes of a group.
+	{
+	public:
+		BitMask(UInt64 mask):
+			_mask(mask)
+		{
+		}
+
+		operator bool () const
+		{
+			return _mask != 0;
+		}
+
+		std::size_t lowest() const
+			/// Returns the offset of the first matching slot.
+		{
+#if defined(POCO_FLATHASH_SSE2)
+			return countTrailingZeros(_mask);
+#else
+			return countTrailingZeros(_mask) >> 3;
+#endif
+		}
+
+		void next()
+			/// Removes the first matching slot.
+		{
+			_mask &= _mask - 1;
+		}
+
+	private:
+		static std::size_t countTrailingZeros(UInt64 mask)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return static_cast<std::size_t>(__builtin_ctzll(mask));
+#else
+			std::size_t n = 0;
+			while ((mask & 1) == 0)
+			{
+				mask >>= 1;
+				++n;
+			}
+			return n;
+#endif
+		}
+
+		UInt64 _mask;
+	};
+
+#if defined(POCO_FLATHASH_SSE2)
+
+	class Group
+		/// The control bytes of 16 consecutive slots, matched with SSE2.
+	{
+	public:
+		explicit Group(const Int8* pCtrl):
+			_ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pCtrl)))
+		{
+		}
+
+		BitMask match(Int8 h2) const
+		{
+			return BitMask(static_cast<UInt32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_ctrl, _mm_set1_epi8(h2)))));
+		}
+
+		BitMask matchEmpty() const
+		{
+			return BitMask(static_cast<UInt32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_ctrl, _mm_set1_epi8(static_cast<char>(CTRL_EMPTY))))));
+		}
+
+		BitMask matchEmptyOrDeleted() const
+		{
+			return BitMask(static_cast<UInt32>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(CTRL_SENTINEL)), _ctrl))));
+		}
+
+	private:
+		__m128i _ctrl;
+	};
+
+#else
+
+	class Group
+		/// The control bytes of 8 consecutive slots, matched
+		/// with 64-bit arithmetic. Every matching slot sets the
+		/// most significant bit of its byte in the mask.
+	{
+	public:
+		explicit Group(const Int8* pCtrl):
+			_ctrl(0)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				_ctrl |= static_cast<UInt64>(static_cast<UInt8>(pCtrl[i])) << (8*i);
+			}
+		}
+
+		BitMask match(Int8 h2) const
+		{
+			// may report a false match next to a real one, which is
+			// harmless since the keys are compared anyway
+			const UInt64 LSBS = 0x0101010101010101ULL;
+			const UInt64 MSBS = 0x8080808080808080ULL;
+			UInt64 x = _ctrl ^ (LSBS*static_cast<UInt8>(h2));
+			return BitMask((x - LSBS) & ~x & MSBS);
+		}
+
+		BitMask matchEmpty() const
+		{
+			// only CTRL_EMPTY has bit 7 set and bit 1 cleared
+			return BitMask(_ctrl & (~_ctrl << 6) & 0x8080808080808080ULL);
+		}
+
+		BitMask matchEmptyOrDeleted() const
+		{
+			// only CTRL_EMPTY and CTRL_DELETED have bit 7 set and bit 0 cleared
+			return BitMask(_ctrl & (~_ctrl << 7) & 0x8080808080808080ULL);
+		}
+
+	private:
+		UInt64 _ctrl;
+	};
+
+#endif
+
+	static std::size_t mix(std::size_t hash)
+		/// Mixes the bits of a hash value, as the hash values
+		/// of Poco::hash() for integers are poor in the low bits.
+	{
+		UInt64 h = static_cast<UInt64>(hash);
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 33;
+		return static_cast<std::size_t>(h);
+	}
+
+	template <class K>
+	std::size_t hashOf(const K& key) const
+	{
+		return mix(_hash(key));
+	}
+
+	static Int8 h2(std::size_t hash)
+		/// Returns the 7 hash bits stored in the control byte.
+	{
+		return static_cast<Int8>(hash & 0x7F);
+	}
+
+	template <class K>
+	std::size_t findIndex(const K& key, std::size_t hash) const
+		/// Returns the index of the slot holding the given key,
+		/// or the capacity, if the key is not found.
+	{
+		if (_size == 0) return _capacity;
+		std::size_t pos = (hash >> 7) & _capacity;
+		std::size_t step = 0;
+		for (;;)
+		{
+			Group group(_pCtrl + pos);
+			for (BitMask mask = group.match(h2(hash)); mask; mask.next())
+			{
+				std::size_t i = (pos + mask.lowest()) & _capacity;
+				if (KeyOf()(_pSlots[i]) == key) return i;
+			}
+			if (group.matchEmpty()) return _capacity;
+			step += GROUP_WIDTH;
+			pos = (pos + step) & _capacity;
+		}
+	}
+
+	std::size_t findFirstNonFull(std::size_t hash) const
+		/// Returns the index of the first empty or deleted
+		/// slot in the probe sequence of the given hash value.
+	{
+		std::size_t pos = (hash >> 7) & _capacity;
+		std::size_t step = 0;
+		for (;;)
+		{
+			BitMask mask = Group(_pCtrl + pos).matchEmptyOrDeleted();
+			if (mask) return (pos + mask.lowest()) & _capacity;
+			step += GROUP_WIDTH;
+			pos = (pos + step) & _capacity;
+		}
+	}
+
+	UInt32 probeLength(std::size_t index, std::size_t hash) const
+		/// Returns the number of groups probed to reach the given slot.
+	{
+		std::size_t pos = (hash >> 7) & _capacity;
+		std::size_t step = 0;
+		UInt32 groups = 1;
+		while (((index - pos) & _capacity) >= static_cast<std::size_t>(GROUP_WIDTH))
+		{
+			step += GROUP_WIDTH;
+			pos = (pos + step) & _capacity;
+			++groups;
+		}
+		return groups;
+	}
+
+	std::size_t insertUnique(const Value& value, std::size_t hash)
+		/// Inserts a value whose key is not in the table yet,
+		/// and returns the index of its slot.
+	{
+		std::size_t i = _capacity > 0 ? findFirstNonFull(hash) : 0;
+		if (_growthLeft == 0 && (_capacity == 0 || _pCtrl[i] != CTRL_DELETED))
+		{
+			grow();
+			i = findFirstNonFull(hash);
+		}
+		new (_pSlots + i) Value(value);
+		if (_pCtrl[i] == CTRL_EMPTY) --_growthLeft;
+		setControl(i, h2(hash));
+		++_size;
+		return i;
+	}
+
+	void eraseIndex(std::size_t i)
+	{
+		_pSlots[i].~Value();
+		--_size;
+		if (_size == 0)
+		{
+			resetControl();
+			_growthLeft = maxLoad(_capacity);
+		}
+		else setControl(i, CTRL_DELETED);
+	}
+
+	void setControl(std::size_t i, Int8 ctrl)
+		/// Sets the control byte of a slot, and its copy after
+		/// the sentinel, if it is one of the first GROUP_WIDTH - 1.
+	{
+		_pCtrl[i] = ctrl;
+		_pCtrl[((i - (GROUP_WIDTH - 1)) & _capacity) + (GROUP_WIDTH - 1)] = ctrl;
+	}
+
+	void resetControl()
+	{
+		std::memset(_pCtrl, CTRL_EMPTY, _capacity + GROUP_WIDTH);
+		_pCtrl[_capacity] = CTRL_SENTINEL;
+	}
+
+	static std::size_t maxLoad(std::size_t capacity)
+		/// Returns the number of elements at which the table must
+		/// grow, leaving at least one empty slot for probing to stop.
+	{
+		return capacity - (capacity + 1)/8;
+	}
+
+	static std::size_t capacityFor(std::size_t size)
+		/// Returns the smallest capacity, of the form 2^n - 1,
+		/// for the given number of elements.
+	{
+		std::size_t capacity = GROUP_WIDTH - 1;
+		while (maxLoad(capacity) < size) capacity = capacity*2 + 1;
+		return capacity;
+	}
+
+	void grow()
+		/// Makes room for one more element, either by dropping
+		/// erased entries, if there are many, or by doubling
+		/// the capacity.
+	{
+		if (_capacity > 0 && _size <= maxLoad(_capacity)/2)
+			rehash(_capacity);
+		else
+			rehash(_capacity == 0 ? capacityFor(1) : _capacity*2 + 1);
+	}
+
+	void rehash(std::size_t capacity)
+	{
+		std::allocator<Value> alloc;
+		Int8* pOldCtrl = _pCtrl;
+		Value* pOldSlots = _pSlots;
+		std::size_t oldCapacity = _capacity;
+
+		_pSlots = alloc.allocate(capacity);
+		try
+		{
+			_pCtrl = new Int8[capacity + GROUP_WIDTH];
+		}
+		catch (...)
+		{
+			alloc.deallocate(_pSlots, capacity);
+			_pSlots = pOldSlots;
+			throw;
+		}
+		_capacity = capacity;
+		resetControl();
+		_size = 0;
+		_growthLeft = maxLoad(capacity);
+		for (std::size_t i = 0; i < oldCapacity; ++i)
+		{
+			if (pOldCtrl[i] >= 0)
+			{
+				std::size_t h = hashOf(KeyOf()(pOldSlots[i]));
+				std::size_t j = findFirstNonFull(h);
+				new (_pSlots + j) Value(pOldSlots[i]);
+				setControl(j, h2(h));
+				--_growthLeft;
+				++_size;
+				pOldSlots[i].~Value();
+			}
+		}
+		if (oldCapacity > 0)
+		{
+			delete [] pOldCtrl;
+			alloc.deallocate(pOldSlots, oldCapacity);
+		}
+	}
+
+	void destroy()
+	{
+		if (_capacity > 0)
+		{
+			for (std::size_t i = 0; i < _capacity; ++i)
+			{
+				if (_pCtrl[i] >= 0) _pSlots[i].~Value();
+			}
+			delete [] _pCtrl;
+			std::allocator<Value>().deallocate(_pSlots, _capacity);
+		}
+	}
+
+	static Int8* emptyControl()
+		/// Returns the control bytes of a table without
+		/// slots, which are shared by all empty tables.
+	{
+		static Int8 ctrl[GROUP_WIDTH] = {CTRL_SENTINEL};
+		return ctrl;
+	}
+
+private:
+	Int8* _pCtrl;
+	Value* _pSlots;
+	std::size_t _capacity;
+	std::size_t _size;
+	std::size_t _growthLeft;
+	HashFunc _hash;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FlatHashTable_INCLUDED
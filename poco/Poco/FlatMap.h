@@ -0,0 +1,325 @@
+//
+// FlatMap.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  FlatMap
+//
+// Definition of the FlatMap class template.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FlatMap_INCLUDED
+#define Foundation_FlatMap_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+
+namespace Poco {
+
+
+template <class Key, class Mapped, class Compare = std::less<Key> >
+class FlatMap
+	/// This class implements a map as a vector of key-value
+	/// pairs, sorted by key.
+	///
+	/// For the small maps typical of attributes and dynamic structs,
+	/// with up to a few dozen elements, a FlatMap is faster and smaller
+	/// than a std::map: all elements are stored in a single allocation,
+	/// and lookups are binary searches over contiguous memory instead of
+	/// a walk through separately allocated tree nodes. Inserting and
+	/// erasing are linear in the number of elements, so a FlatMap is
+	/// not suited for large maps that change frequently.
+	///
+	/// A FlatMap can be used like a std::map, except
+	/// that its value type is std::pair<Key, Mapped>, the key of which
+	/// must not be changed through an iterator, and that inserts and
+	/// erases invalidate all iterators.
+	///
+	///     Poco::FlatMap<std::string, Poco::Any> attrs;
+	///     attrs.reserve(8);
+	///     attrs["user"] = user;
+	///     Poco::FlatMap<std::string, Poco::Any>::ConstIterator it = attrs.find("user");
+{
+public:
+	typedef Key                          KeyType;
+	typedef Mapped                       MappedType;
+	typedef Mapped&                      Reference;
+	typedef const Mapped&                ConstReference;
+	typedef Mapped*                      Pointer;
+	typedef const Mapped*                ConstPointer;
+
+	typedef std::pair<Key, Mapped>       ValueType;
+	typedef ValueType                    PairType;
+	typedef Compare                      KeyCompare;
+
+	typedef std::vector<ValueType>       Container;
+	typedef typename Container::iterator       Iterator;
+	typedef typename Container::const_iterator ConstIterator;
+	typedef typename Container::size_type      SizeType;
+
+	// STL-compatible names, so that a FlatMap can
+	// replace a std::map in a class template.
+	typedef KeyType        key_type;
+	typedef MappedType     mapped_type;
+	typedef ValueType      value_type;
+	typedef KeyCompare     key_compare;
+	typedef Iterator       iterator;
+	typedef ConstIterator  const_iterator;
+	typedef SizeType       size_type;
+
+	FlatMap()
+		/// Creates an empty FlatMap.
+	{
+	}
+
+	explicit FlatMap(std::size_t initialReserve)
+		/// Creates the FlatMap with room for the
+		/// given number of elements.
+	{
+		_data.reserve(initialReserve);
+	}
+
+	template <class InputIterator>
+	FlatMap(InputIterator first, InputIterator last)
+		/// Creates the FlatMap from the given range of key-value pairs.
+		/// Of several pairs with the same key, the first one is kept.
+	{
+		insert(first, last);
+	}
+
+	FlatMap(const FlatMap& map):
+		_data(map._data),
+		_compare(map._compare)
+		/// Creates the FlatMap by copying another one.
+	{
+	}
+
+	~FlatMap()
+		/// Destroys the FlatMap.
+	{
+	}
+
+	FlatMap& operator = (const FlatMap& map)
+		/// Assigns another FlatMap.
+	{
+		FlatMap tmp(map);
+		swap(tmp);
+		return *this;
+	}
+
+	void swap(FlatMap& map)
+		/// Swaps the FlatMap with another one.
+	{
+		_data.swap(map._data);
+		std::swap(_compare, map._compare);
+	}
+
+	ConstIterator begin() const
+	{
+		return _data.begin();
+	}
+
+	ConstIterator end() const
+	{
+		return _data.end();
+	}
+
+	Iterator begin()
+	{
+		return _data.begin();
+	}
+
+	Iterator end()
+	{
+		return _data.end();
+	}
+
+	ConstIterator lower_bound(const KeyType& key) const
+		/// Returns an iterator pointing to the first element
+		/// with a key not less than the given key.
+	{
+		return std::lower_bound(_data.begin(), _data.end(), key, KeyLess(_compare));
+	}
+
+	Iterator lower_bound(const KeyType& key)
+		/// Returns an iterator pointing to the first element
+		/// with a key not less than the given key.
+	{
+		return std::lower_bound(_data.begin(), _data.end(), key, KeyLess(_compare));
+	}
+
+	ConstIterator find(const KeyType& key) const
+	{
+		ConstIterator it = lower_bound(key);
+		return (it != _data.end() && !_compare(key, it->first)) ? it : _data.end();
+	}
+
+	Iterator find(const KeyType& key)
+	{
+		Iterator it = lower_bound(key);
+		return (it != _data.end() && !_compare(key, it->first)) ? it : _data.end();
+	}
+
+	std::size_t count(const KeyType& key) const
+	{
+		return find(key) != _data.end() ? 1 : 0;
+	}
+
+	std::pair<Iterator, bool> insert(const ValueType& pair)
+		/// Inserts the pair, unless there already is an element
+		/// with the same key, and returns an iterator pointing to
+		/// the element with the key and whether the pair has been
+		/// inserted.
+	{
+		Iterator it = lower_bound(pair.first);
+		if (it != _data.end() && !_compare(pair.first, it->first))
+			return std::make_pair(it, false);
+		else
+			return std::make_pair(_data.insert(it, pair), true);
+	}
+
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+		/// Inserts the given range of key-value pairs. Of several pairs
+		/// with the same key, the one already in the FlatMap or the first
+		/// one of the range is kept.
+	{
+		Container data(_data);
+		for (; first != last; ++first) data.push_back(ValueType(first->first, first->second));
+		std::stable_sort(data.begin(), data.end(), PairLess(_compare));
+		Iterator out = data.begin();
+		for (Iterator it = data.begin(); it != data.end(); ++it)
+		{
+			if (out == data.begin() || _compare((out - 1)->first, it->first))
+			{
+				if (out != it) *out = *it;
+				++out;
+			}
+		}
+		data.erase(out, data.end());
+		_data.swap(data);
+	}
+
+	void erase(Iterator it)
+	{
+		_data.erase(it);
+	}
+
+	std::size_t erase(const KeyType& key)
+	{
+		Iterator it = find(key);
+		if (it == _data.end()) return 0;
+		_data.erase(it);
+		return 1;
+	}
+
+	void clear()
+	{
+		_data.clear();
+	}
+
+	void reserve(std::size_t size)
+	{
+		_data.reserve(size);
+	}
+
+	std::size_t capacity() const
+	{
+		return _data.capacity();
+	}
+
+	std::size_t size() const
+	{
+		return _data.size();
+	}
+
+	bool empty() const
+	{
+		return _data.empty();
+	}
+
+	ConstReference operator [] (const KeyType& key) const
+	{
+		ConstIterator it = find(key);
+		if (it != _data.end())
+			return it->second;
+		else
+			throw NotFoundException();
+	}
+
+	Reference operator [] (const KeyType& key)
+	{
+		Iterator it = lower_bound(key);
+		if (it == _data.end() || _compare(key, it->first))
+			it = _data.insert(it, ValueType(key, Mapped()));
+		return it->second;
+	}
+
+	bool operator == (const FlatMap& map) const
+	{
+		return _data == map._data;
+	}
+
+	bool operator != (const FlatMap& map) const
+	{
+		return _data != map._data;
+	}
+
+private:
+	class KeyLess
+	{
+	public:
+		explicit KeyLess(const Compare& compare):
+			_compare(compare)
+		{
+		}
+
+		bool operator () (const ValueType& value, const KeyType& key) const
+		{
+			return _compare(value.first, key);
+		}
+
+	private:
+		const Compare& _compare;
+	};
+
+	class PairLess
+	{
+	public:
+		explicit PairLess(const Compare& compare):
+			_compare(compare)
+		{
+		}
+
+		bool operator () (const ValueType& left, const ValueType& right) const
+		{
+			return _compare(left.first, right.first);
+		}
+
+	private:
+		const Compare& _compare;
+	};
+
+	Container _data;
+	Compare _compare;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FlatMap_INCLUDED
@@ -0,0 +1,266 @@
+//
+// HexBinary.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Streams
+// Module:  HexBinary
+//
+// Definition of the HexBinary class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_HexBinary_INCLUDED
+#define Foundation_HexBinary_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Exception.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#if defined(__SSE2__) && !defined(POCO_HEXBINARY_NO_SIMD)
+#include <emmintrin.h>
+#define POCO_HEXBINARY_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(POCO_HEXBINARY_NO_SIMD)
+#include <arm_neon.h>
+#define POCO_HEXBINARY_NEON 1
+#endif
+
+
+namespace Poco {
+
+
+class HexBinary
+	/// This class contains functions for hex-encoding (base16) and
+	/// decoding memory buffers, which process 16 bytes at a time
+	/// using SSE2 or NEON (on AArch64) instructions, if available.
+	///
+	/// The encoding is the same as the one of HexBinaryEncoder (with
+	/// a line length of 0) and of DigestEngine::digestToHex(), but
+	/// without going through a stream or formatting every byte
+	/// separately.
+{
+public:
+	typedef std::vector<unsigned char> Bytes;
+
+	static std::size_t encode(const void* data, std::size_t size, char* buffer, bool uppercase = false)
+		/// Encodes size bytes at data into buffer, which must have room
+		/// for 2*size characters. The buffer is not zero-terminated.
+		///
+		/// Returns the number of characters written.
+	{
+		const unsigned char* in = static_cast<const unsigned char*>(data);
+		const char* digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+		char* out = buffer;
+		std::size_t i = 0;
+#if defined(POCO_HEXBINARY_SSE2)
+		const __m128i nibble = _mm_set1_epi8(0x0F);
+		const __m128i letter = _mm_set1_epi8(static_cast<char>(digits[10] - '0' - 10));
+		for (; i + 16 <= size; i += 16)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			__m128i hi = toDigits(_mm_and_si128(_mm_srli_epi16(x, 4), nibble), letter);
+			__m128i lo = toDigits(_mm_and_si128(x, nibble), letter);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(hi, lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(hi, lo));
+			out += 32;
+		}
+#elif defined(POCO_HEXBINARY_NEON)
+		const uint8x16_t table = vld1q_u8(reinterpret_cast<const uint8_t*>(digits));
+		for (; i + 16 <= size; i += 16)
+		{
+			uint8x16_t x = vld1q_u8(in + i);
+			uint8x16x2_t r;
+			r.val[0] = vqtbl1q_u8(table, vshrq_n_u8(x, 4));
+			r.val[1] = vqtbl1q_u8(table, vandq_u8(x, vdupq_n_u8(0x0F)));
+			vst2q_u8(reinterpret_cast<uint8_t*>(out), r);
+			out += 32;
+		}
+#endif
+		for (; i < size; ++i)
+		{
+			*out++ = digits[in[i] >> 4];
+			*out++ = digits[in[i] & 0x0F];
+		}
+		return static_cast<std::size_t>(out - buffer);
+	}
+
+	static std::string encode(const void* data, std::size_t size, bool uppercase = false)
+		/// Returns the hex encoding of size bytes at data.
+	{
+		std::string result(2*size, '\0');
+		if (size) encode(data, size, &result[0], uppercase);
+		return result;
+	}
+
+	static std::string encode(const std::string& data, bool uppercase = false)
+		/// Returns the hex encoding of data.
+	{
+		return encode(data.data(), data.size(), uppercase);
+	}
+
+	static std::string encode(const Bytes& data, bool uppercase = false)
+		/// Returns the hex encoding of data, e.g. of a
+		/// DigestEngine::Digest.
+	{
+		return data.empty() ? std::string() : encode(&data[0], data.size(), uppercase);
+	}
+
+	static std::size_t decode(const char* encoded, std::size_t length, void* buffer)
+		/// Decodes length characters at encoded into buffer, which must
+		/// have room for length/2 bytes. Both lowercase and uppercase
+		/// digits are accepted, and whitespace is ignored.
+		///
+		/// Returns the number of bytes written.
+		///
+		/// Throws a DataFormatException if the input contains
+		/// invalid characters or an odd number of digits.
+	{
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(encoded);
+		unsigned char* out = static_cast<unsigned char*>(buffer);
+		std::size_t i = 0;
+		int high = -1;
+		while (i < length)
+		{
+#if defined(POCO_HEXBINARY_SSE2)
+			for (; i + 32 <= length; i += 32)
+			{
+				__m128i a;
+				__m128i b;
+				if (!values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), a) ||
+				    !values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 16)), b)) break;
+				const __m128i low = _mm_set1_epi16(0x00FF);
+				a = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(a, low), 4), _mm_srli_epi16(a, 8));
+				b = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b, low), 4), _mm_srli_epi16(b, 8));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+				out += 16;
+			}
+			const std::size_t end = i + 32;
+#elif defined(POCO_HEXBINARY_NEON)
+			for (; i + 32 <= length; i += 32)
+			{
+				uint8x16x2_t x = vld2q_u8(in + i);
+				uint8x16_t hi;
+				uint8x16_t lo;
+				if (!values(x.val[0], hi) || !values(x.val[1], lo)) break;
+				vst1q_u8(out, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+				out += 16;
+			}
+			const std::size_t end = i + 32;
+#else
+			const std::size_t end = length;
+#endif
+			// one character at a time, for whitespace, until the block
+			// rejected above has been passed and a byte is complete
+			for (; i < length && (i < end || high >= 0); ++i)
+			{
+				unsigned char c = in[i];
+				int v = value(c);
+				if (v >= 0)
+				{
+					if (high < 0)
+					{
+						high = v;
+					}
+					else
+					{
+						*out++ = static_cast<unsigned char>((high << 4) | v);
+						high = -1;
+					}
+				}
+				else if (!isSpace(c))
+				{
+					throw DataFormatException("Invalid hex digit");
+				}
+			}
+		}
+		if (high >= 0) throw DataFormatException("Incomplete hex data");
+		return static_cast<std::size_t>(out - static_cast<unsigned char*>(buffer));
+	}
+
+	static std::string decode(const std::string& encoded)
+		/// Returns the bytes decoded from encoded.
+		///
+		/// Throws a DataFormatException if encoded is not valid.
+	{
+		std::string result(encoded.size()/2, '\0');
+		if (!result.empty()) result.resize(decode(encoded.data(), encoded.size(), &result[0]));
+		else if (!encoded.empty()) decode(encoded.data(), encoded.size(), 0);
+		return result;
+	}
+
+private:
+	static bool isSpace(unsigned char c)
+	{
+		return c == ' ' || (c >= '\t' && c <= '\r');
+	}
+
+	static int value(unsigned char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+
+#if defined(POCO_HEXBINARY_SSE2)
+	static __m128i toDigits(__m128i v, __m128i letter)
+	{
+		return _mm_add_epi8(_mm_add_epi8(v, _mm_set1_epi8('0')), _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(9)), letter));
+	}
+
+	static __m128i inRange(__m128i x, char first, char last)
+	{
+		return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(first - 1))), _mm_cmplt_epi8(x, _mm_set1_epi8(static_cast<char>(last + 1))));
+	}
+
+	static bool values(__m128i x, __m128i& v)
+		/// Maps 16 hex digits to their values, and returns
+		/// false if any of them is not a hex digit.
+	{
+		__m128i digit = inRange(x, '0', '9');
+		__m128i lower = inRange(x, 'a', 'f');
+		__m128i upper = inRange(x, 'A', 'F');
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(digit, lower), upper)) != 0xFFFF) return false;
+		v = _mm_or_si128(
+			_mm_and_si128(digit, _mm_sub_epi8(x, _mm_set1_epi8('0'))),
+			_mm_or_si128(_mm_and_si128(lower, _mm_sub_epi8(x, _mm_set1_epi8('a' - 10))), _mm_and_si128(upper, _mm_sub_epi8(x, _mm_set1_epi8('A' - 10)))));
+		return true;
+	}
+#elif defined(POCO_HEXBINARY_NEON)
+	static uint8x16_t inRange(uint8x16_t x, unsigned char first, unsigned char last)
+	{
+		return vandq_u8(vcgeq_u8(x, vdupq_n_u8(first)), vcleq_u8(x, vdupq_n_u8(last)));
+	}
+
+	static bool values(uint8x16_t x, uint8x16_t& v)
+		/// Maps 16 hex digits to their values, and returns
+		/// false if any of them is not a hex digit.
+	{
+		uint8x16_t digit = inRange(x, '0', '9');
+		uint8x16_t lower = inRange(x, 'a', 'f');
+		uint8x16_t upper = inRange(x, 'A', 'F');
+		if (vminvq_u8(vorrq_u8(vorrq_u8(digit, lower), upper)) == 0) return false;
+		v = vorrq_u8(
+			vandq_u8(digit, vsubq_u8(x, vdupq_n_u8('0'))),
+			vorrq_u8(vandq_u8(lower, vsubq_u8(x, vdupq_n_u8('a' - 10))), vandq_u8(upper, vsubq_u8(x, vdupq_n_u8('A' - 10)))));
+		return true;
+	}
+#endif
+
+	HexBinary();
+	~HexBinary();
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_HexBinary_INCLUDED
@@ -0,0 +1,548 @@
+//
+// Instrumentation.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  Instrumentation
+//
+// Definition of the Instrumentation class and the instrumentation macros.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_Instrumentation_INCLUDED
+#define Foundation_Instrumentation_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstddef>
+#if __cplusplus >= 201103L
+#include <atomic>
+#else
+#include "Poco/FastThreadLocal.h"
+#endif
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <time.h>
+#include <sched.h>
+#else
+#include "Poco/Clock.h"
+#include "Poco/UnWindows.h"
+#endif
+
+
+namespace Poco {
+
+
+class Instrumentation
+	/// Instrumentation is the registry of the probes, i.e. counters and
+	/// histograms, recorded by the instrumentation points in Foundation
+	/// and in applications.
+	///
+	/// Instrumentation points are compiled in only if POCO_ENABLE_INSTRUMENTATION
+	/// is defined, and are written with the following macros:
+	///
+	///   * poco_instrument_count(name) increments the counter with the given name.
+	///   * poco_instrument_value(name, value) records a value in the
+	///     histogram with the given name.
+	///   * poco_instrument_scope(name) records the time, in nanoseconds,
+	///     from the macro to the end of the enclosing scope in the timer
+	///     histogram with the given name.
+	///
+	/// Every thread records into its own block of values, with plain
+	/// (relaxed) loads and stores, so that recording takes no lock and
+	/// threads do not share cache lines. The probe of an instrumentation
+	/// point is registered once, when it is first reached. snapshot() and
+	/// dump() add up the values of all threads, including the threads
+	/// that have terminated.
+	///
+	/// Histograms have HISTOGRAM_BUCKETS buckets: bucket 0 counts the
+	/// value 0, bucket i counts the values from 2^(i-1) to 2^i - 1, and
+	/// the last bucket also counts all larger values.
+	///
+	/// With POCO_ENABLE_INSTRUMENTATION, the following probes are recorded
+	/// by Foundation:
+	///
+	///   * FastMutex.contended and FastMutex.wait: the lock() calls that
+	///     found the mutex locked, and the time they waited.
+	///   * RingNotificationQueue.wait: the time threads waited for a
+	///     notification or for room in the queue.
+	///   * ObjectPool.exhausted: the borrowObject() calls that found
+	///     no object available.
+	///   * AbstractEvent.notify: the time taken by the delegates of a
+	///     synchronous notification.
+	///   * WorkStealingThreadPool.threads: the threads started.
+	///
+	/// The registry can be dumped with dump(), on a signal with
+	/// InstrumentationDumper, or through the OSP InstrumentationService.
+{
+public:
+	enum ProbeType
+	{
+		PROBE_COUNTER,   /// a counter
+		PROBE_HISTOGRAM, /// a histogram of values
+		PROBE_TIMER      /// a histogram of durations, in nanoseconds
+	};
+
+	enum
+	{
+		HISTOGRAM_BUCKETS = 40,
+		MAX_SLOTS         = 2048
+	};
+
+	struct Sample
+		/// The values of a probe, added up over all threads.
+	{
+		Sample():
+			type(PROBE_COUNTER),
+			count(0),
+			sum(0)
+		{
+		}
+
+		UInt64 percentile(double fraction) const
+			/// Returns an upper bound of the given percentile, e.g. 0.99,
+			/// of the values in a histogram, from the bucket that contains it.
+		{
+			UInt64 rank = static_cast<UInt64>(fraction*static_cast<double>(count));
+			UInt64 seen = 0;
+			for (std::size_t i = 0; i < buckets.size(); ++i)
+			{
+				seen += buckets[i];
+				if (seen > rank || (seen == count && seen > 0)) return i == 0 ? 0 : (UInt64(1) << i) - 1;
+			}
+			return 0;
+		}
+
+		std::string name;
+		ProbeType type;
+		UInt64 count;
+			/// The value of a counter, or the number of values in a histogram.
+		UInt64 sum;
+			/// The sum of the values in a histogram.
+		std::vector<UInt64> buckets;
+			/// The bucket counts of a histogram.
+	};
+
+	class Counter
+		/// A counter probe.
+	{
+	public:
+		explicit Counter(const std::string& name):
+			_slot(instance().registerProbe(name, PROBE_COUNTER))
+			/// Creates the Counter, or refers to the counter
+			/// registered under the given name.
+		{
+		}
+
+		void add(UInt64 n = 1)
+			/// Adds n to the calling thread's value of the counter.
+		{
+			increment(threadBlock().values[_slot], n);
+		}
+
+	private:
+		Counter();
+		Counter(const Counter&);
+		Counter& operator = (const Counter&);
+
+		std::size_t _slot;
+	};
+
+	class Histogram
+		/// A histogram probe.
+	{
+	public:
+		explicit Histogram(const std::string& name):
+			_slot(instance().registerProbe(name, PROBE_HISTOGRAM))
+			/// Creates the Histogram, or refers to the histogram
+			/// registered under the given name.
+		{
+		}
+
+		void record(UInt64 value)
+			/// Records a value in the calling thread's histogram.
+		{
+			Value* pValues = threadBlock().values + _slot;
+			increment(pValues[0], 1);
+			increment(pValues[1], value);
+			increment(pValues[2 + bucket(value)], 1);
+		}
+
+	protected:
+		Histogram(const std::string& name, ProbeType type):
+			_slot(instance().registerProbe(name, type))
+		{
+		}
+
+	private:
+		Histogram();
+		Histogram(const Histogram&);
+		Histogram& operator = (const Histogram&);
+
+		std::size_t _slot;
+	};
+
+	class Timer: public Histogram
+		/// A histogram of durations, in nanoseconds.
+	{
+	public:
+		explicit Timer(const std::string& name):
+			Histogram(name, PROBE_TIMER)
+			/// Creates the Timer, or refers to the timer
+			/// registered under the given name.
+		{
+		}
+	};
+
+	class ScopedTimer
+		/// Records the lifetime of the ScopedTimer in a Timer.
+	{
+	public:
+		explicit ScopedTimer(Timer& timer):
+			_timer(timer),
+			_start(now())
+		{
+		}
+
+		~ScopedTimer()
+		{
+			_timer.record(now() - _start);
+		}
+
+	private:
+		ScopedTimer();
+		ScopedTimer(const ScopedTimer&);
+		ScopedTimer& operator = (const ScopedTimer&);
+
+		Timer& _timer;
+		UInt64 _start;
+	};
+
+	std::size_t registerProbe(const std::string& name, ProbeType type)
+		/// Registers a probe, or returns the existing probe with the given
+		/// name and type, and returns its first slot. If all slots are in
+		/// use, the probe records into slots that are never reported.
+	{
+		SpinLock lock(_lock);
+		for (std::vector<Probe>::const_iterator it = _probes.begin(); it != _probes.end(); ++it)
+		{
+			if (it->type == type && it->name == name) return it->slot;
+		}
+		std::size_t span = slots(type);
+		if (_nextSlot + span > MAX_SLOTS) return 0;
+		Probe probe;
+		probe.name = name;
+		probe.type = type;
+		probe.slot = _nextSlot;
+		_probes.push_back(probe);
+		_nextSlot += span;
+		return probe.slot;
+	}
+
+	void snapshot(std::vector<Sample>& samples) const
+		/// Appends the values of all probes, added up over all threads,
+		/// to samples.
+	{
+		std::vector<UInt64> totals;
+		std::vector<Probe> probes;
+		{
+			SpinLock lock(_lock);
+			totals.assign(_retired, _retired + MAX_SLOTS);
+			probes = _probes;
+			for (std::vector<Block*>::const_iterator it = _blocks.begin(); it != _blocks.end(); ++it)
+			{
+				for (std::size_t i = 0; i < _nextSlot; ++i)
+				{
+					totals[i] += load((*it)->values[i]);
+				}
+			}
+		}
+		for (std::vector<Probe>::const_iterator it = probes.begin(); it != probes.end(); ++it)
+		{
+			Sample sample;
+			sample.name = it->name;
+			sample.type = it->type;
+			sample.count = totals[it->slot];
+			if (it->type != PROBE_COUNTER)
+			{
+				sample.sum = totals[it->slot + 1];
+				sample.buckets.assign(totals.begin() + it->slot + 2, totals.begin() + it->slot + 2 + HISTOGRAM_BUCKETS);
+			}
+			samples.push_back(sample);
+		}
+	}
+
+	void dump(std::ostream& ostr) const
+		/// Writes the values of all probes to the given stream,
+		/// one probe per line.
+	{
+		std::vector<Sample> samples;
+		snapshot(samples);
+		for (std::vector<Sample>::const_iterator it = samples.begin(); it != samples.end(); ++it)
+		{
+			ostr << it->name << " count=" << it->count;
+			if (it->type != PROBE_COUNTER)
+			{
+				const char* unit = it->type == PROBE_TIMER ? "ns" : "";
+				UInt64 mean = it->count > 0 ? it->sum/it->count : 0;
+				ostr << " mean=" << mean << unit
+				     << " p50<=" << it->percentile(0.5) << unit
+				     << " p99<=" << it->percentile(0.99) << unit
+				     << " max<=" << it->percentile(1.0) << unit;
+			}
+			ostr << '\n';
+		}
+	}
+
+	static Instrumentation& instance()
+		/// Returns the Instrumentation registry.
+	{
+		// never destroyed, as threads may record during static destruction
+		static Instrumentation* pInstance = new Instrumentation;
+		return *pInstance;
+	}
+
+	static UInt64 now()
+		/// Returns the value of a monotonic clock, in nanoseconds.
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<UInt64>(ts.tv_sec)*1000000000 + static_cast<UInt64>(ts.tv_nsec);
+#else
+		return static_cast<UInt64>(Poco::Clock().raw())*1000;
+#endif
+	}
+
+private:
+#if __cplusplus >= 201103L
+	typedef std::atomic<UInt64> Value;
+
+	static void increment(Value& value, UInt64 n)
+	{
+		// only the owning thread writes the value
+		value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		return value.load(std::memory_order_relaxed);
+	}
+#else
+	typedef volatile UInt64 Value;
+
+	static void increment(Value& value, UInt64 n)
+	{
+		value = value + n;
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		return value;
+	}
+#endif
+
+	struct Probe
+	{
+		std::string name;
+		ProbeType type;
+		std::size_t slot;
+	};
+
+	struct Block
+		/// The values recorded by one thread.
+	{
+		Block()
+		{
+			for (std::size_t i = 0; i < MAX_SLOTS; ++i) values[i] = 0;
+		}
+
+		Value values[MAX_SLOTS];
+	};
+
+	class SpinLock
+		/// Protects the registry. Mutex cannot be used, as FastMutex
+		/// itself is instrumented.
+	{
+	public:
+		explicit SpinLock(volatile int& flag):
+			_flag(flag)
+		{
+#if defined(POCO_OS_FAMILY_WINDOWS)
+			while (InterlockedExchange(reinterpret_cast<volatile LONG*>(&_flag), 1)) SwitchToThread();
+#else
+			while (__sync_lock_test_and_set(&_flag, 1)) sched_yield();
+#endif
+		}
+
+		~SpinLock()
+		{
+#if defined(POCO_OS_FAMILY_WINDOWS)
+			InterlockedExchange(reinterpret_cast<volatile LONG*>(&_flag), 0);
+#else
+			__sync_lock_release(&_flag);
+#endif
+		}
+
+	private:
+		SpinLock();
+		SpinLock(const SpinLock&);
+		SpinLock& operator = (const SpinLock&);
+
+		volatile int& _flag;
+	};
+
+#if __cplusplus < 201103L
+	struct Holder
+	{
+		Holder():
+			pBlock(0)
+		{
+		}
+
+		~Holder()
+		{
+			if (pBlock) instance().detach(pBlock);
+		}
+
+		Block* pBlock;
+	};
+#else
+	struct Cleanup
+	{
+		~Cleanup()
+		{
+			Block*& pBlock = threadBlockPointer();
+			Block* pDone = pBlock;
+			pBlock = 0;
+			if (pDone) instance().detach(pDone);
+		}
+	};
+
+	static Block*& threadBlockPointer()
+	{
+		static thread_local Block* pBlock = 0;
+		return pBlock;
+	}
+#endif
+
+	Instrumentation():
+		_nextSlot(slots(PROBE_HISTOGRAM)),
+		_lock(0)
+		/// The first slots take the values of the
+		/// probes that did not get slots of their own.
+	{
+		for (std::size_t i = 0; i < MAX_SLOTS; ++i) _retired[i] = 0;
+	}
+
+	~Instrumentation()
+	{
+	}
+
+	static Block& threadBlock()
+	{
+#if __cplusplus >= 201103L
+		Block*& pBlock = threadBlockPointer();
+		if (!pBlock)
+		{
+			pBlock = instance().attach();
+			static thread_local Cleanup cleanup;
+		}
+		return *pBlock;
+#else
+		static Poco::FastThreadLocal<Holder> holder;
+		Block*& pBlock = holder->pBlock;
+		if (!pBlock) pBlock = instance().attach();
+		return *pBlock;
+#endif
+	}
+
+	Block* attach()
+	{
+		Block* pBlock = new Block;
+		SpinLock lock(_lock);
+		_blocks.push_back(pBlock);
+		return pBlock;
+	}
+
+	void detach(Block* pBlock)
+		/// Adds the values of a terminating thread to the retired values.
+	{
+		{
+			SpinLock lock(_lock);
+			for (std::size_t i = 0; i < MAX_SLOTS; ++i)
+			{
+				_retired[i] += load(pBlock->values[i]);
+			}
+			for (std::vector<Block*>::iterator it = _blocks.begin(); it != _blocks.end(); ++it)
+			{
+				if (*it == pBlock)
+				{
+					_blocks.erase(it);
+					break;
+				}
+			}
+		}
+		delete pBlock;
+	}
+
+	static std::size_t slots(ProbeType type)
+		/// Returns the number of slots taken by a probe:
+		/// count, sum and buckets for histograms.
+	{
+		return type == PROBE_COUNTER ? 1 : 2 + HISTOGRAM_BUCKETS;
+	}
+
+	static std::size_t bucket(UInt64 value)
+	{
+		if (value == 0) return 0;
+#if defined(__GNUC__) || defined(__clang__)
+		std::size_t b = 64 - static_cast<std::size_t>(__builtin_clzll(value));
+#else
+		std::size_t b = 0;
+		while (value) { value >>= 1; ++b; }
+#endif
+		return b < HISTOGRAM_BUCKETS ? b : HISTOGRAM_BUCKETS - 1;
+	}
+
+	Instrumentation(const Instrumentation&);
+	Instrumentation& operator = (const Instrumentation&);
+
+	std::vector<Probe> _probes;
+	std::vector<Block*> _blocks;
+	UInt64 _retired[MAX_SLOTS];
+	std::size_t _nextSlot;
+	mutable volatile int _lock;
+};
+
+
+} // namespace Poco
+
+
+#if defined(POCO_ENABLE_INSTRUMENTATION)
+	#define POCO_INSTRUMENT_JOIN_(a, b) a##b
+	#define POCO_INSTRUMENT_JOIN(a, b) POCO_INSTRUMENT_JOIN_(a, b)
+	#define poco_instrument_count(name) \
+		do { static Poco::Instrumentation::Counter pocoInstrumentCounter(name); pocoInstrumentCounter.add(1); } while (false)
+	#define poco_instrument_value(name, value) \
+		do { static Poco::Instrumentation::Histogram pocoInstrumentHistogram(name); pocoInstrumentHistogram.record(value); } while (false)
+	#define poco_instrument_scope(name) \
+		static Poco::Instrumentation::Timer POCO_INSTRUMENT_JOIN(pocoInstrumentTimer, __LINE__)(name); \
+		Poco::Instrumentation::ScopedTimer POCO_INSTRUMENT_JOIN(pocoInstrumentScope, __LINE__)(POCO_INSTRUMENT_JOIN(pocoInstrumentTimer, __LINE__))
+#else
+	#define poco_instrument_count(name)
+	#define poco_instrument_value(name, value)
+	#define poco_instrument_scope(name)
+#endif
+
+
+#endif // Foundation_Instrumentation_INCLUDED
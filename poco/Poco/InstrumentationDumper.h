@@ -0,0 +1,185 @@
+//
+// InstrumentationDumper.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  Instrumentation
+//
+// Definition of the InstrumentationDumper class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_InstrumentationDumper_INCLUDED
+#define Foundation_InstrumentationDumper_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Instrumentation.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/FileStream.h"
+#include "Poco/Timestamp.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/Exception.h"
+#include <iostream>
+#include <string>
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+
+namespace Poco {
+
+
+#if defined(POCO_OS_FAMILY_UNIX)
+
+
+class InstrumentationDumper: public Runnable
+	/// InstrumentationDumper writes the probes of the Instrumentation
+	/// registry to a file, or to std::cerr, whenever the process
+	/// receives a signal, e.g. with
+	///
+	///     kill -USR2 <pid>
+	///
+	/// The signal handler merely writes a byte to a pipe. The dump
+	/// is written by a thread started by the InstrumentationDumper,
+	/// so that the signal may arrive in any thread at any time.
+	///
+	/// Only one InstrumentationDumper may exist at a time.
+	/// This class is only available on POSIX platforms.
+{
+public:
+	explicit InstrumentationDumper(int signal = SIGUSR2, const std::string& path = std::string()):
+		_signal(signal),
+		_path(path),
+		_thread("Instrumentation")
+		/// Creates the InstrumentationDumper, which appends a dump to the
+		/// file with the given path, or writes it to std::cerr if the path
+		/// is empty, whenever the given signal is received.
+	{
+		poco_assert (writeFd() < 0);
+
+		if (pipe(_pipe) != 0) throw SystemException("cannot create pipe for InstrumentationDumper");
+		fcntl(_pipe[0], F_SETFD, FD_CLOEXEC);
+		fcntl(_pipe[1], F_SETFD, FD_CLOEXEC);
+		fcntl(_pipe[1], F_SETFL, fcntl(_pipe[1], F_GETFL) | O_NONBLOCK);
+		_thread.start(*this);
+		writeFd() = _pipe[1];
+
+		struct sigaction sa;
+		sa.sa_handler = onSignal;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		sigaction(_signal, &sa, &_oldAction);
+	}
+
+	~InstrumentationDumper()
+		/// Restores the previous signal handler and stops the thread.
+	{
+		try
+		{
+			sigaction(_signal, &_oldAction, 0);
+			writeFd() = -1;
+			char stop = 'q';
+			while (write(_pipe[1], &stop, 1) < 0 && errno == EINTR)
+			{
+			}
+			_thread.join();
+			close(_pipe[0]);
+			close(_pipe[1]);
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void dump()
+		/// Writes a dump, as on the signal.
+	{
+		if (_path.empty())
+		{
+			dump(std::cerr);
+		}
+		else
+		{
+			Poco::FileOutputStream ostr(_path, std::ios::out | std::ios::app);
+			dump(ostr);
+		}
+	}
+
+protected:
+	void run()
+	{
+		for (;;)
+		{
+			char c;
+			ssize_t n = read(_pipe[0], &c, 1);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0 || c == 'q') break;
+			try
+			{
+				dump();
+			}
+			catch (Poco::Exception&)
+			{
+			}
+		}
+	}
+
+	void dump(std::ostream& ostr)
+	{
+		ostr << "# instrumentation " << Poco::DateTimeFormatter::format(Poco::Timestamp(), Poco::DateTimeFormat::ISO8601_FRAC_FORMAT) << '\n';
+		Instrumentation::instance().dump(ostr);
+		ostr.flush();
+	}
+
+private:
+	InstrumentationDumper(const InstrumentationDumper&);
+	InstrumentationDumper& operator = (const InstrumentationDumper&);
+
+	static void onSignal(int)
+	{
+		int savedErrno = errno;
+		int fd = writeFd();
+		if (fd >= 0)
+		{
+			char c = 'd';
+			ssize_t n = write(fd, &c, 1);
+			(void) n;
+		}
+		errno = savedErrno;
+	}
+
+	static volatile int& writeFd()
+	{
+		static volatile int fd = -1;
+		return fd;
+	}
+
+	int _signal;
+	std::string _path;
+	int _pipe[2];
+	struct sigaction _oldAction;
+	Thread _thread;
+};
+
+
+#endif // POCO_OS_FAMILY_UNIX
+
+
+} // namespace Poco
+
+
+#endif // Foundation_InstrumentationDumper_INCLUDED
@@ -0,0 +1,88 @@
+//
+// IsolatingEvent.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Events
+// Module:  IsolatingEvent
+//
+// Implementation of the IsolatingEvent template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_IsolatingEvent_INCLUDED
+#define Foundation_IsolatingEvent_INCLUDED
+
+
+#include "Poco/AbstractEvent.h"
+#include "Poco/IsolatingStrategy.h"
+#include "Poco/AbstractDelegate.h"
+
+
+namespace Poco {
+
+
+template <class TArgs, class TMutex = FastMutex> 
+class IsolatingEvent: public AbstractEvent < 
+	TArgs, IsolatingStrategy<TArgs, AbstractDelegate<TArgs> >,
+	AbstractDelegate<TArgs>,
+	TMutex
+>
+	/// An IsolatingEvent uses the IsolatingStrategy, which
+	/// gives every delegate its own bounded queue, served by the
+	/// worker threads of the IsolatingEventDispatcher.
+	///
+	/// notify() returns as soon as the arguments have been queued.
+	/// Delegates are invoked asynchronously, each one in the order
+	/// of its notifications, and never concurrently with itself.
+	/// A delegate that falls behind by more than the queue capacity
+	/// loses its oldest notifications.
+	///
+	/// Delegates registered as PriorityDelegate have strict priority
+	/// over the other delegates, lower priority values first:
+	///
+	///     event += priorityDelegate(this, &Router::onDataPathChanged, 0);
+	///     event += delegate(this, &Logger::onDataPathChanged);
+	///
+	/// Exceptions thrown by delegates are caught and ignored.
+	///
+	/// Please see the AbstractEvent class template documentation
+	/// for more information.
+{
+public:
+	IsolatingEvent(std::size_t queueCapacity = IsolatingStrategy<TArgs, AbstractDelegate<TArgs> >::DEFAULT_CAPACITY):
+		AbstractEvent<TArgs, IsolatingStrategy<TArgs, AbstractDelegate<TArgs> >, AbstractDelegate<TArgs>, TMutex>(
+			IsolatingStrategy<TArgs, AbstractDelegate<TArgs> >(queueCapacity))
+		/// Creates the IsolatingEvent with the given capacity of the
+		/// per-delegate queues.
+	{
+	}
+
+	~IsolatingEvent()
+	{
+	}
+
+	std::size_t dropped() const
+		/// Returns the number of notifications dropped because
+		/// the queue of a delegate was full.
+	{
+		typename TMutex::ScopedLock lock(this->_mutex);
+		return this->_strategy.dropped();
+	}
+
+private:
+	IsolatingEvent(const IsolatingEvent&);
+	IsolatingEvent& operator = (const IsolatingEvent&);
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_IsolatingEvent_INCLUDED
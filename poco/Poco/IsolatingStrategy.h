@@ -0,0 +1,438 @@
+//
+// IsolatingStrategy.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Events
+// Module:  IsolatingStrategy
+//
+// Implementation of the IsolatingStrategy template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_IsolatingStrategy_INCLUDED
+#define Foundation_IsolatingStrategy_INCLUDED
+
+
+#include "Poco/NotificationStrategy.h"
+#include "Poco/AbstractPriorityDelegate.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/MetaProgramming.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Thread.h"
+#include "Poco/SingletonHolder.h"
+#include <vector>
+#include <deque>
+#include <list>
+#include <climits>
+
+
+namespace Poco {
+
+
+class IsolatedSubscriber: public RefCountedObject
+	/// The interface between a subscriber queue of an
+	/// IsolatingStrategy and the IsolatingEventDispatcher.
+{
+public:
+	typedef AutoPtr<IsolatedSubscriber> Ptr;
+
+	IsolatedSubscriber(int prio):
+		_priority(prio)
+	{
+	}
+
+	int priority() const
+		/// Returns the priority of the subscriber. Lower
+		/// values are served first, as with PriorityEvent.
+	{
+		return _priority;
+	}
+
+	virtual bool serve() = 0;
+		/// Delivers the oldest queued notification.
+		///
+		/// Returns true if more notifications are queued,
+		/// in which case the subscriber is scheduled again.
+
+protected:
+	~IsolatedSubscriber()
+	{
+	}
+
+private:
+	int _priority;
+};
+
+
+class IsolatingEventDispatcher
+	/// The process-wide pool of worker threads serving the
+	/// subscriber queues of all IsolatingEvent instances.
+	///
+	/// A subscriber with queued notifications is scheduled once.
+	/// Workers always serve the scheduled subscriber with the
+	/// highest priority first, and deliver a single notification
+	/// before rescheduling it, so a subscriber is never served by
+	/// two workers at a time and a slow subscriber only occupies
+	/// one worker.
+	///
+	/// One worker is reserved for subscribers registered with a
+	/// priority, so they are served even if all other workers are
+	/// blocked by slow subscribers.
+	///
+	/// The workers are started when the first notification is queued.
+{
+public:
+	enum
+	{
+		POOL_SIZE = 3,
+		NORMAL_PRIORITY = INT_MAX
+			/// Priority of subscribers registered without a priority.
+	};
+
+	IsolatingEventDispatcher():
+		_started(false),
+		_stop(false)
+	{
+		for (int i = 0; i < POOL_SIZE; ++i)
+		{
+			_workers[i]._pDispatcher = this;
+			_workers[i]._critical    = (i == 0);
+		}
+	}
+
+	~IsolatingEventDispatcher()
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (!_started) return;
+			_stop = true;
+			_ready.clear();
+		}
+		_wakeUp.broadcast();
+		for (int i = 0; i < POOL_SIZE; ++i) _threads[i].join();
+	}
+
+	static IsolatingEventDispatcher& instance()
+		/// Returns the default IsolatingEventDispatcher.
+	{
+		static SingletonHolder<IsolatingEventDispatcher> sh;
+		return *sh.get();
+	}
+
+	void schedule(IsolatedSubscriber* pSubscriber)
+		/// Schedules a subscriber with queued notifications.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (_stop) return;
+		if (!_started)
+		{
+			_started = true;
+			for (int i = 0; i < POOL_SIZE; ++i)
+			{
+				_threads[i].setName("IsolatingEventDispatcher");
+				_threads[i].start(_workers[i]);
+			}
+		}
+		std::list<IsolatedSubscriber::Ptr>::iterator it = _ready.begin();
+		while (it != _ready.end() && (*it)->priority() <= pSubscriber->priority()) ++it;
+		_ready.insert(it, IsolatedSubscriber::Ptr(pSubscriber, true));
+		_wakeUp.broadcast();
+	}
+
+private:
+	struct Worker: public Runnable
+	{
+		void run()
+		{
+			_pDispatcher->work(_critical);
+		}
+
+		IsolatingEventDispatcher* _pDispatcher;
+		bool _critical;
+	};
+
+	bool eligible(bool critical) const
+	{
+		return !_ready.empty() && (!critical || _ready.front()->priority() < NORMAL_PRIORITY);
+	}
+
+	void work(bool critical)
+	{
+		for (;;)
+		{
+			IsolatedSubscriber::Ptr pSubscriber;
+			{
+				FastMutex::ScopedLock lock(_mutex);
+				while (!_stop && !eligible(critical)) _wakeUp.wait(_mutex);
+				if (_stop) return;
+				pSubscriber = _ready.front();
+				_ready.pop_front();
+			}
+			if (pSubscriber->serve()) schedule(pSubscriber);
+		}
+	}
+
+	IsolatingEventDispatcher(const IsolatingEventDispatcher&);
+	IsolatingEventDispatcher& operator = (const IsolatingEventDispatcher&);
+
+	std::list<IsolatedSubscriber::Ptr> _ready;
+	bool      _started;
+	bool      _stop;
+	FastMutex _mutex;
+	Condition _wakeUp;
+	Worker    _workers[POOL_SIZE];
+	Thread    _threads[POOL_SIZE];
+};
+
+
+template <class TArgs, class TDelegate>
+class IsolatingSubscriber: public IsolatedSubscriber
+	/// The bounded notification queue of a delegate
+	/// registered with an IsolatingStrategy.
+	///
+	/// If the queue is full, the oldest notification is dropped.
+{
+public:
+	typedef AutoPtr<IsolatingSubscriber> Ptr;
+	typedef SharedPtr<TDelegate> DelegatePtr;
+	typedef typename TypeWrapper<TArgs>::TYPE Value;
+
+	IsolatingSubscriber(const TDelegate& delegate, std::size_t capacity):
+		IsolatedSubscriber(priorityOf(delegate)),
+		_pDelegate(static_cast<TDelegate*>(delegate.clone())),
+		_capacity(capacity > 0 ? capacity : 1),
+		_dropped(0),
+		_scheduled(false)
+	{
+	}
+
+	void enqueue(const void* pSender, TArgs& args)
+		/// Queues a notification and schedules the subscriber
+		/// if it is not scheduled yet.
+	{
+		bool signal;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (_queue.size() >= _capacity)
+			{
+				_queue.pop_front();
+				++_dropped;
+			}
+			_queue.push_back(Notification(pSender, args));
+			signal = !_scheduled;
+			_scheduled = true;
+		}
+		if (signal) IsolatingEventDispatcher::instance().schedule(this);
+	}
+
+	bool serve()
+	{
+		Notification notification;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (_queue.empty())
+			{
+				_scheduled = false;
+				return false;
+			}
+			notification = _queue.front();
+			_queue.pop_front();
+		}
+		try
+		{
+			_pDelegate->notify(notification.first, notification.second);
+		}
+		catch (...)
+		{
+		}
+		FastMutex::ScopedLock lock(_mutex);
+		if (_queue.empty())
+		{
+			_scheduled = false;
+			return false;
+		}
+		return true;
+	}
+
+	void disable()
+		/// Disables the delegate and discards queued notifications.
+	{
+		_pDelegate->disable();
+		FastMutex::ScopedLock lock(_mutex);
+		_queue.clear();
+	}
+
+	TDelegate* delegate()
+	{
+		return _pDelegate.get();
+	}
+
+	std::size_t dropped() const
+		/// Returns the number of notifications dropped
+		/// because the queue was full.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _dropped;
+	}
+
+protected:
+	~IsolatingSubscriber()
+	{
+	}
+
+private:
+	typedef std::pair<const void*, Value> Notification;
+
+	static int priorityOf(const TDelegate& delegate)
+	{
+		const AbstractPriorityDelegate<TArgs>* pPriorityDelegate = dynamic_cast<const AbstractPriorityDelegate<TArgs>*>(&delegate);
+		return pPriorityDelegate ? pPriorityDelegate->priority() : static_cast<int>(IsolatingEventDispatcher::NORMAL_PRIORITY);
+	}
+
+	DelegatePtr              _pDelegate;
+	std::deque<Notification> _queue;
+	std::size_t              _capacity;
+	std::size_t              _dropped;
+	bool                     _scheduled;
+	mutable FastMutex        _mutex;
+};
+
+
+template <class TArgs, class TDelegate>
+class IsolatingStrategy: public NotificationStrategy<TArgs, TDelegate>
+	/// NotificationStrategy for IsolatingEvent.
+	///
+	/// Every delegate gets its own bounded queue. notify() only
+	/// queues the arguments; the delegates are invoked by the
+	/// worker threads of the IsolatingEventDispatcher, so a slow
+	/// delegate delays neither the notifying thread nor the
+	/// other delegates.
+	///
+	/// Delegates registered as PriorityDelegate are served in
+	/// the order of their priority, before all other delegates.
+{
+public:
+	typedef IsolatingSubscriber<TArgs, TDelegate> Subscriber;
+	typedef TDelegate*                            DelegateHandle;
+	typedef typename Subscriber::Ptr              SubscriberPtr;
+	typedef std::vector<SubscriberPtr>            Subscribers;
+	typedef typename Subscribers::iterator        Iterator;
+
+	enum
+	{
+		DEFAULT_CAPACITY = 16
+	};
+
+public:
+	IsolatingStrategy(std::size_t capacity = DEFAULT_CAPACITY):
+		_capacity(capacity)
+	{
+	}
+
+	IsolatingStrategy(const IsolatingStrategy& s):
+		_subscribers(s._subscribers),
+		_capacity(s._capacity)
+	{
+	}
+
+	~IsolatingStrategy()
+	{
+	}
+
+	void notify(const void* sender, TArgs& arguments)
+	{
+		for (Iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+		{
+			(*it)->enqueue(sender, arguments);
+		}
+	}
+
+	DelegateHandle add(const TDelegate& delegate)
+	{
+		SubscriberPtr pSubscriber(new Subscriber(delegate, _capacity));
+		_subscribers.push_back(pSubscriber);
+		return pSubscriber->delegate();
+	}
+
+	void remove(const TDelegate& delegate)
+	{
+		for (Iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+		{
+			if (delegate.equals(*(*it)->delegate()))
+			{
+				(*it)->disable();
+				_subscribers.erase(it);
+				return;
+			}
+		}
+	}
+
+	void remove(DelegateHandle delegateHandle)
+	{
+		for (Iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+		{
+			if ((*it)->delegate() == delegateHandle)
+			{
+				(*it)->disable();
+				_subscribers.erase(it);
+				return;
+			}
+		}
+	}
+
+	IsolatingStrategy& operator = (const IsolatingStrategy& s)
+	{
+		if (this != &s)
+		{
+			_subscribers = s._subscribers;
+			_capacity    = s._capacity;
+		}
+		return *this;
+	}
+
+	void clear()
+	{
+		for (Iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+		{
+			(*it)->disable();
+		}
+		_subscribers.clear();
+	}
+
+	bool empty() const
+	{
+		return _subscribers.empty();
+	}
+
+	std::size_t dropped() const
+		/// Returns the total number of notifications dropped
+		/// because a subscriber queue was full.
+	{
+		std::size_t n = 0;
+		for (typename Subscribers::const_iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+		{
+			n += (*it)->dropped();
+		}
+		return n;
+	}
+
+protected:
+	Subscribers _subscribers;
+	std::size_t _capacity;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_IsolatingStrategy_INCLUDED
@@ -0,0 +1,492 @@
+//
+// CompiledTemplate.h
+//
+// $Id$
+//
+// Library: JSON
+// Package: JSON
+// Module:  CompiledTemplate
+//
+// Definition of the CompiledTemplate class.
+//
+// Copyright (c) 2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef JSON_CompiledTemplate_INCLUDED
+#define JSON_CompiledTemplate_INCLUDED
+
+
+#include "Poco/JSON/JSON.h"
+#include "Poco/JSON/Template.h"
+#include "Poco/JSON/QueryPath.h"
+#include "Poco/Dynamic/Var.h"
+#include "Poco/FileStream.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Path.h"
+#include <ostream>
+#include <string>
+#include <vector>
+#include <deque>
+
+
+namespace Poco {
+namespace JSON {
+
+
+class CompiledTemplate
+	/// CompiledTemplate renders templates written in the syntax of
+	/// Template (echo, if, ifexist, elsif, elsifexist, else, for and
+	/// include commands), but compiles them into a flat vector of
+	/// instructions with pre-split QueryPath queries. Rendering executes
+	/// the instructions, appending to a string buffer that can be reused
+	/// for many requests:
+	///
+	///     CompiledTemplate tpl(Path("status.tpl"));
+	///     tpl.parse();
+	///     std::string page;
+	///     for (...)
+	///     {
+	///         page.clear();
+	///         tpl.render(data, page, &cache);
+	///         response.sendBuffer(page.data(), page.size());
+	///     }
+	///
+	/// Unlike Template, a for loop does not add its variable to the data
+	/// object; loop variables are kept in a scope while rendering, so
+	/// that the same data can be rendered concurrently. A CompiledTemplate
+	/// is not changed by rendering and can be shared by multiple threads.
+	///
+	/// Templates included with <? include "file" ?> are obtained from
+	/// the Loader given to render(), e.g. a CompiledTemplateCache, or
+	/// read from the file system if none is given.
+{
+public:
+	typedef SharedPtr<CompiledTemplate> Ptr;
+
+	class Loader
+		/// Provides included templates.
+	{
+	public:
+		virtual ~Loader()
+		{
+		}
+
+		virtual Ptr load(const Path& path) = 0;
+			/// Returns the parsed template with the given path.
+	};
+
+	enum Opcode
+	{
+		OP_TEXT,            /// Append text.
+		OP_ECHO,            /// Append the value of query.
+		OP_JUMP,            /// Continue at target.
+		OP_JUMP_IF_FALSE,   /// Continue at target if the value of query is false.
+		OP_JUMP_IF_MISSING, /// Continue at target if query does not find a value.
+		OP_FOR,             /// Start a loop over the array found by query, binding text, or continue at target.
+		OP_ENDFOR,          /// Advance the loop started at target.
+		OP_INCLUDE          /// Render the template with the path text.
+	};
+
+	struct Instruction
+	{
+		Opcode opcode;
+		std::string text;
+		QueryPath query;
+		std::size_t target;
+	};
+
+	typedef std::vector<Instruction> Program;
+
+	enum
+	{
+		MAX_INCLUDE_DEPTH = 16
+	};
+
+	CompiledTemplate()
+		/// Creates a CompiledTemplate.
+	{
+	}
+
+	explicit CompiledTemplate(const Path& templatePath):
+		_templatePath(templatePath)
+		/// Creates a CompiledTemplate from the file with the given templatePath.
+		/// The file is read by parse().
+	{
+	}
+
+	~CompiledTemplate()
+		/// Destroys the CompiledTemplate.
+	{
+	}
+
+	void parse()
+		/// Reads and compiles the template file.
+	{
+		Poco::FileInputStream istr(_templatePath.toString());
+		std::string source;
+		Poco::StreamCopier::copyToString(istr, source);
+		parse(source);
+	}
+
+	void parse(const std::string& source)
+		/// Compiles the given template source. Throws a
+		/// JSONTemplateException if the source is not valid.
+	{
+		Program program;
+		std::vector<Block> blocks;
+		std::size_t label = 0;
+		std::string::size_type pos = 0;
+		while (pos < source.size())
+		{
+			std::string::size_type start = source.find("<?", pos);
+			if (start == std::string::npos) start = source.size();
+			if (start > pos) addText(program, label, source, pos, start);
+			if (start == source.size()) break;
+			pos = start + 2;
+
+			std::string command;
+			if (pos < source.size() && source[pos] == '=')
+			{
+				command = "echo";
+				++pos;
+			}
+			else
+			{
+				skipSpace(source, pos);
+				command = readWord(source, pos);
+			}
+			skipSpace(source, pos);
+
+			if (command == "echo")
+			{
+				add(program, OP_ECHO, readQuery(source, pos));
+			}
+			else if (command == "if" || command == "ifexist")
+			{
+				Block block;
+				block.loop = false;
+				block.hasElse = false;
+				block.start = program.size();
+				block.condition = program.size();
+				add(program, command == "if" ? OP_JUMP_IF_FALSE : OP_JUMP_IF_MISSING, readQuery(source, pos));
+				blocks.push_back(block);
+			}
+			else if (command == "elsif" || command == "elsifexist" || command == "else")
+			{
+				if (blocks.empty() || blocks.back().loop || blocks.back().hasElse) throw JSONTemplateException("Unexpected " + command);
+				Block& block = blocks.back();
+				block.exits.push_back(program.size());
+				add(program, OP_JUMP);
+				program[block.condition].target = program.size();
+				label = program.size();
+				if (command == "else")
+				{
+					block.hasElse = true;
+				}
+				else
+				{
+					block.condition = program.size();
+					add(program, command == "elsif" ? OP_JUMP_IF_FALSE : OP_JUMP_IF_MISSING, readQuery(source, pos));
+				}
+			}
+			else if (command == "endif")
+			{
+				if (blocks.empty() || blocks.back().loop) throw JSONTemplateException("Unexpected endif");
+				Block& block = blocks.back();
+				if (!block.hasElse) program[block.condition].target = program.size();
+				for (std::vector<std::size_t>::const_iterator it = block.exits.begin(); it != block.exits.end(); ++it)
+				{
+					program[*it].target = program.size();
+				}
+				label = program.size();
+				blocks.pop_back();
+			}
+			else if (command == "for")
+			{
+				std::string variable = readWord(source, pos);
+				if (variable.empty()) throw JSONTemplateException("Missing variable in for command");
+				skipSpace(source, pos);
+				std::string query = readQuery(source, pos);
+				if (query.empty()) throw JSONTemplateException("Missing query in for command");
+				Block block;
+				block.loop = true;
+				block.hasElse = false;
+				block.start = program.size();
+				block.condition = program.size();
+				add(program, OP_FOR, query);
+				program.back().text = variable;
+				blocks.push_back(block);
+			}
+			else if (command == "endfor")
+			{
+				if (blocks.empty() || !blocks.back().loop) throw JSONTemplateException("Unexpected endfor");
+				add(program, OP_ENDFOR);
+				program.back().target = blocks.back().start;
+				program[blocks.back().start].target = program.size();
+				label = program.size();
+				blocks.pop_back();
+			}
+			else if (command == "include")
+			{
+				std::string filename = readString(source, pos);
+				if (filename.empty()) throw JSONTemplateException("Missing filename");
+				Path resolvePath(_templatePath);
+				resolvePath.makeParent();
+				resolvePath.resolve(Path(filename));
+				add(program, OP_INCLUDE);
+				program.back().text = resolvePath.toString();
+			}
+			else
+			{
+				throw JSONTemplateException("Unknown command " + command);
+			}
+
+			skipSpace(source, pos);
+			if (source.compare(pos, 2, "?>") != 0) throw JSONTemplateException("Missing ?>");
+			pos += 2;
+		}
+		if (!blocks.empty()) throw JSONTemplateException(blocks.back().loop ? "Missing endfor" : "Missing endif");
+
+		_program.swap(program);
+		_parseTime.update();
+	}
+
+	void render(const Dynamic::Var& data, std::string& out, Loader* pLoader = 0) const
+		/// Renders the template with the given data, appending the
+		/// output to out. Included templates are obtained from pLoader.
+	{
+		Loops loops;
+		execute(data, out, pLoader, loops, 0);
+	}
+
+	void render(const Dynamic::Var& data, std::ostream& out, Loader* pLoader = 0) const
+		/// Renders the template with the given data to the given stream.
+	{
+		std::string buffer;
+		render(data, buffer, pLoader);
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	}
+
+	const Program& program() const
+		/// Returns the compiled instructions.
+	{
+		return _program;
+	}
+
+	const Path& path() const
+		/// Returns the path of the template file.
+	{
+		return _templatePath;
+	}
+
+	Timestamp parseTime() const
+		/// Returns the time when the template was parsed.
+	{
+		return _parseTime;
+	}
+
+protected:
+	struct Block
+	{
+		bool loop;
+		bool hasElse;
+		std::size_t start;
+		std::size_t condition;
+		std::vector<std::size_t> exits;
+	};
+
+	struct Loop
+	{
+		const std::string* pName;
+		Dynamic::Var array;
+		std::size_t index;
+	};
+
+	typedef std::deque<Loop> Loops;
+
+	void execute(const Dynamic::Var& data, std::string& out, Loader* pLoader, Loops& loops, int depth) const
+	{
+		const std::size_t size = _program.size();
+		std::size_t pc = 0;
+		while (pc < size)
+		{
+			const Instruction& instruction = _program[pc];
+			switch (instruction.opcode)
+			{
+			case OP_TEXT:
+				out += instruction.text;
+				break;
+			case OP_ECHO:
+				{
+					Dynamic::Var value = evaluate(instruction.query, data, loops);
+					if (value.type() == typeid(std::string))
+						out += value.extract<std::string>();
+					else if (!value.isEmpty())
+						out += value.convert<std::string>();
+				}
+				break;
+			case OP_JUMP:
+				pc = instruction.target;
+				continue;
+			case OP_JUMP_IF_FALSE:
+				if (!isTrue(evaluate(instruction.query, data, loops)))
+				{
+					pc = instruction.target;
+					continue;
+				}
+				break;
+			case OP_JUMP_IF_MISSING:
+				if (evaluate(instruction.query, data, loops).isEmpty())
+				{
+					pc = instruction.target;
+					continue;
+				}
+				break;
+			case OP_FOR:
+				{
+					Dynamic::Var value = evaluate(instruction.query, data, loops);
+					const Array* pArray = QueryPath::array(value);
+					if (!pArray || pArray->size() == 0)
+					{
+						pc = instruction.target;
+						continue;
+					}
+					loops.push_back(Loop());
+					loops.back().pName = &instruction.text;
+					loops.back().array.swap(value);
+					loops.back().index = 0;
+				}
+				break;
+			case OP_ENDFOR:
+				{
+					Loop& loop = loops.back();
+					if (++loop.index < QueryPath::array(loop.array)->size())
+					{
+						pc = instruction.target + 1;
+						continue;
+					}
+					loops.pop_back();
+				}
+				break;
+			case OP_INCLUDE:
+				{
+					if (depth >= MAX_INCLUDE_DEPTH) throw JSONTemplateException("Includes nested too deeply", instruction.text);
+					Path path(instruction.text);
+					if (pLoader)
+					{
+						pLoader->load(path)->execute(data, out, pLoader, loops, depth + 1);
+					}
+					else
+					{
+						CompiledTemplate tpl(path);
+						tpl.parse();
+						tpl.execute(data, out, pLoader, loops, depth + 1);
+					}
+				}
+				break;
+			}
+			++pc;
+		}
+	}
+
+	static Dynamic::Var evaluate(const QueryPath& query, const Dynamic::Var& data, const Loops& loops)
+		/// Evaluates the query, resolving its first segment against
+		/// the innermost loop variable with the same name, if any.
+	{
+		const QueryPath::Segments& segments = query.segments();
+		if (!segments.empty() && !segments[0].isIndex())
+		{
+			for (Loops::const_reverse_iterator it = loops.rbegin(); it != loops.rend(); ++it)
+			{
+				if (*it->pName == segments[0].name)
+				{
+					const Array* pArray = QueryPath::array(it->array);
+					return query.find(*(pArray->begin() + it->index), 1);
+				}
+			}
+		}
+		return query.find(data);
+	}
+
+	static bool isTrue(const Dynamic::Var& value)
+		/// Same as Template: empty values, empty strings, empty
+		/// objects and arrays, zero and false are false.
+	{
+		if (value.isEmpty()) return false;
+		if (value.isString()) return !value.convert<std::string>().empty();
+		return value.convert<bool>();
+	}
+
+	static void add(Program& program, Opcode opcode, const std::string& query = std::string())
+	{
+		program.push_back(Instruction());
+		program.back().opcode = opcode;
+		program.back().target = 0;
+		if (!query.empty()) program.back().query = QueryPath(query);
+	}
+
+	static void addText(Program& program, std::size_t label, const std::string& source, std::string::size_type begin, std::string::size_type end)
+		/// Appends text, merging it with a preceding text instruction
+		/// unless a jump targets the position after it (label).
+	{
+		if (program.size() <= label || program.back().opcode != OP_TEXT) add(program, OP_TEXT);
+		program.back().text.append(source, begin, end - begin);
+	}
+
+	static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+	}
+
+	static void skipSpace(const std::string& source, std::string::size_type& pos)
+	{
+		while (pos < source.size() && isSpace(source[pos])) ++pos;
+	}
+
+	static std::string readWord(const std::string& source, std::string::size_type& pos)
+		/// Reads a command or variable name, which ends at white space or '?'.
+	{
+		std::string::size_type start = pos;
+		while (pos < source.size() && !isSpace(source[pos]) && source[pos] != '?') ++pos;
+		return source.substr(start, pos - start);
+	}
+
+	static std::string readQuery(const std::string& source, std::string::size_type& pos)
+		/// Reads a query, which ends at white space or "?>".
+	{
+		std::string::size_type start = pos;
+		while (pos < source.size() && !isSpace(source[pos]) && source.compare(pos, 2, "?>") != 0) ++pos;
+		return source.substr(start, pos - start);
+	}
+
+	static std::string readString(const std::string& source, std::string::size_type& pos)
+		/// Reads a string enclosed in double quotes.
+	{
+		if (pos >= source.size() || source[pos] != '"') return std::string();
+		std::string::size_type end = source.find('"', pos + 1);
+		if (end == std::string::npos) throw JSONTemplateException("Missing \" after filename");
+		std::string result(source, pos + 1, end - pos - 1);
+		pos = end + 1;
+		return result;
+	}
+
+private:
+	CompiledTemplate(const CompiledTemplate&);
+	CompiledTemplate& operator = (const CompiledTemplate&);
+
+	Path _templatePath;
+	Program _program;
+	Timestamp _parseTime;
+};
+
+
+} } // namespace Poco::JSON
+
+
+#endif // JSON_CompiledTemplate_INCLUDED
@@ -0,0 +1,109 @@
+//
+// LatencyHistogramWriter.h
+//
+// $Id$
+//
+// Library: JSON
+// Package: JSON
+// Module:  LatencyHistogramWriter
+//
+// Definition of the TypeWriter specialization for Poco::LatencyHistogram
+// and the LatencyHistogramReader class.
+//
+// Copyright (c) 2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef JSON_LatencyHistogramWriter_INCLUDED
+#define JSON_LatencyHistogramWriter_INCLUDED
+
+
+#include "Poco/JSON/JSON.h"
+#include "Poco/JSON/Writer.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/JSON/JSONException.h"
+#include "Poco/LatencyHistogram.h"
+#include <vector>
+
+
+namespace Poco {
+namespace JSON {
+
+
+template <>
+class TypeWriter<Poco::LatencyHistogram>
+	/// Writes a LatencyHistogram as an object with the members count,
+	/// total, min, max, mean, p50, p90, p99 and p999 (all in nanoseconds),
+	/// and the non-empty buckets as the arrays indexes and counts.
+	/// LatencyHistogramReader reads the histogram back.
+{
+public:
+	static void write(Writer& writer, const Poco::LatencyHistogram& value)
+	{
+		std::vector<Poco::UInt32> indexes;
+		std::vector<Poco::UInt64> counts;
+		value.buckets(indexes, counts);
+		writer.beginObject();
+		writer.member("count", value.count());
+		writer.member("total", value.total());
+		writer.member("min", value.min());
+		writer.member("max", value.max());
+		writer.member("mean", value.mean());
+		writer.member("p50", value.percentile(0.5));
+		writer.member("p90", value.percentile(0.9));
+		writer.member("p99", value.percentile(0.99));
+		writer.member("p999", value.percentile(0.999));
+		writer.member("indexes", indexes);
+		writer.member("counts", counts);
+		writer.endObject();
+	}
+};
+
+
+class LatencyHistogramReader
+	/// Reads a LatencyHistogram from a JSON object written
+	/// by TypeWriter<Poco::LatencyHistogram>.
+{
+public:
+	static void read(const Object& object, Poco::LatencyHistogram& histogram)
+		/// Replaces the counts of histogram with those of the given object.
+		///
+		/// Throws a JSONException if the object is not a valid histogram.
+	{
+		Array::Ptr pIndexes = object.getArray("indexes");
+		Array::Ptr pCounts = object.getArray("counts");
+		if (!pIndexes || !pCounts) throw JSONException("LatencyHistogram: missing indexes or counts");
+		std::vector<Poco::UInt32> indexes;
+		std::vector<Poco::UInt64> counts;
+		for (unsigned i = 0; i < pIndexes->size(); ++i) indexes.push_back(pIndexes->getElement<Poco::UInt32>(i));
+		for (unsigned i = 0; i < pCounts->size(); ++i) counts.push_back(pCounts->getElement<Poco::UInt64>(i));
+		try
+		{
+			histogram.assign(indexes, counts, value(object, "total"), value(object, "min"), value(object, "max"));
+		}
+		catch (Poco::InvalidArgumentException& exc)
+		{
+			throw JSONException(exc.message());
+		}
+	}
+
+private:
+	static Poco::UInt64 value(const Object& object, const std::string& name)
+	{
+		if (!object.has(name)) throw JSONException("LatencyHistogram: missing " + name);
+		return object.getValue<Poco::UInt64>(name);
+	}
+
+	LatencyHistogramReader();
+	~LatencyHistogramReader();
+};
+
+
+} } // namespace Poco::JSON
+
+
+#endif // JSON_LatencyHistogramWriter_INCLUDED
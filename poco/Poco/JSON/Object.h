@@ -24,6 +24,7 @@
 #include "Poco/JSON/Array.h"
 #include "Poco/JSON/Stringifier.h"
 #include "Poco/SharedPtr.h"
+#include "Poco/BufferStream.h"
 #include "Poco/Dynamic/Var.h"
 #include "Poco/Dynamic/Struct.h"
 #include "Poco/Nullable.h"
@@ -435,9 +436,9 @@ public:
 
 	void convert(std::string& s) const
 	{
-		std::ostringstream oss;
+		Poco::BufferOutputStream oss;
 		_val->stringify(oss, 2);
-		s = oss.str();
+		s.assign(oss.data(), oss.size());
 	}
 
 	void convert(DateTime& /*val*/) const
@@ -577,9 +578,9 @@ public:
 
 	void convert(std::string& s) const
 	{
-		std::ostringstream oss;
+		Poco::BufferOutputStream oss;
 		_val.stringify(oss, 2);
-		s = oss.str();
+		s.assign(oss.data(), oss.size());
 	}
 
 	void convert(DateTime& /*val*/) const
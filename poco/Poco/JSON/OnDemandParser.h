@@ -0,0 +1,971 @@
+//
+// OnDemandParser.h
+//
+// $Id$
+//
+// Library: JSON
+// Package: JSON
+// Module:  OnDemandParser
+//
+// Definition of the OnDemandParser and OnDemandValue classes.
+//
+// Copyright (c) 2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef JSON_OnDemandParser_INCLUDED
+#define JSON_OnDemandParser_INCLUDED
+
+
+#include "Poco/JSON/JSON.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/JSON/JSONException.h"
+#include "Poco/Dynamic/Var.h"
+#include "Poco/NumericString.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/FastUTF8.h"
+#include "Poco/Types.h"
+#include <vector>
+#include <string>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace Poco {
+namespace JSON {
+
+
+class OnDemandParser;
+
+
+class OnDemandValue
+	/// A value within a JSON document parsed by an OnDemandParser.
+	///
+	/// An OnDemandValue is a lightweight handle (a pointer to the parser
+	/// and an index) that can be copied freely. Scalar values are only
+	/// parsed, and strings only decoded, when they are accessed; objects
+	/// and arrays are navigated using the structural index built by the
+	/// parser, skipping nested containers in constant time.
+	///
+	/// Looking up a member or element that does not exist returns an
+	/// undefined value; accessing an undefined value, or a value as the
+	/// wrong type, throws a JSONException.
+	///
+	/// A value is valid until the parser is destroyed or parses
+	/// another document.
+{
+public:
+	enum Type
+	{
+		TYPE_UNDEFINED,
+		TYPE_NULL,
+		TYPE_BOOLEAN,
+		TYPE_NUMBER,
+		TYPE_STRING,
+		TYPE_ARRAY,
+		TYPE_OBJECT
+	};
+
+	class Iterator
+		/// Iterates over the members of an object or the elements of
+		/// an array:
+		///
+		///     for (OnDemandValue::Iterator it = obj.begin(); it.valid(); ++it)
+		///     {
+		///         std::string name = it.key().getString();
+		///         OnDemandValue value = it.value();
+		///     }
+	{
+	public:
+		Iterator():
+			_pParser(0),
+			_index(0),
+			_close(0),
+			_object(false)
+		{
+		}
+
+		bool valid() const
+			/// Returns true unless the iterator is past the end.
+		{
+			return _pParser != 0 && _index < _close;
+		}
+
+		Iterator& operator ++ ();
+			/// Moves to the next member or element.
+
+		OnDemandValue key() const;
+			/// Returns the name of the current member,
+			/// which is a string value.
+
+		OnDemandValue value() const;
+			/// Returns the value of the current member or element.
+
+	private:
+		Iterator(const OnDemandParser* pParser, Poco::UInt32 index, Poco::UInt32 close, bool object):
+			_pParser(pParser),
+			_index(index),
+			_close(close),
+			_object(object)
+		{
+			check();
+		}
+
+		void check() const;
+
+		const OnDemandParser* _pParser;
+		Poco::UInt32 _index;
+		Poco::UInt32 _close;
+		bool _object;
+
+		friend class OnDemandValue;
+	};
+
+	OnDemandValue():
+		_pParser(0),
+		_index(0)
+		/// Creates an undefined value.
+	{
+	}
+
+	Type type() const;
+		/// Returns the type of the value.
+
+	bool isUndefined() const
+	{
+		return _pParser == 0;
+	}
+
+	bool isNull() const
+	{
+		return type() == TYPE_NULL;
+	}
+
+	bool isObject() const
+	{
+		return type() == TYPE_OBJECT;
+	}
+
+	bool isArray() const
+	{
+		return type() == TYPE_ARRAY;
+	}
+
+	bool isString() const
+	{
+		return type() == TYPE_STRING;
+	}
+
+	bool isNumber() const
+	{
+		return type() == TYPE_NUMBER;
+	}
+
+	bool isInteger() const;
+		/// Returns true if the value is a number without
+		/// fraction and exponent.
+
+	bool getBool() const;
+		/// Returns the value of a boolean.
+
+	Poco::Int64 getInt64() const;
+		/// Returns the value of an integer number. Throws a JSONException
+		/// if the value is not an integer or does not fit.
+
+	double getDouble() const;
+		/// Returns the value of a number.
+
+	std::string getString() const;
+		/// Returns the decoded value of a string. Throws a
+		/// JSONException if the string is not valid UTF-8.
+
+	bool equals(const char* str, std::size_t length) const;
+		/// Returns true if the value is a string equal to the given
+		/// UTF-8 string. Strings without escapes are compared in place.
+
+	std::size_t size() const;
+		/// Returns the number of members of an object, or elements
+		/// of an array.
+
+	OnDemandValue operator [] (const std::string& name) const;
+		/// Returns the value of the first member of an object with the
+		/// given name, or an undefined value.
+
+	OnDemandValue operator [] (const char* name) const;
+		/// Returns the value of the first member of an object with the
+		/// given name, or an undefined value.
+
+	OnDemandValue operator [] (std::size_t index) const;
+		/// Returns the element of an array with the given index,
+		/// or an undefined value.
+
+	Iterator begin() const;
+		/// Returns an iterator over the members of an object
+		/// or the elements of an array.
+
+	std::string raw() const;
+		/// Returns the JSON text of the value.
+
+	Poco::Dynamic::Var toVar() const;
+		/// Converts the value, including all nested values, into a
+		/// Dynamic::Var as created by Parser with the default
+		/// ParseHandler (Object::Ptr, Array::Ptr, std::string, Int64,
+		/// double, bool or empty for null).
+
+private:
+	OnDemandValue(const OnDemandParser* pParser, Poco::UInt32 index):
+		_pParser(pParser),
+		_index(index)
+	{
+	}
+
+	char first() const;
+	void expect(Type type) const;
+	void scalar(const char*& begin, const char*& end) const;
+	void string(const char*& begin, const char*& end) const;
+	bool decimal(const char* begin, const char* end, bool& integer) const;
+	int hex4(const char* p, const char* end) const;
+	static void appendUTF8(std::string& str, int cp);
+
+	const OnDemandParser* _pParser;
+	Poco::UInt32 _index;
+
+	friend class OnDemandParser;
+	friend class Iterator;
+};
+
+
+class OnDemandParser
+	/// OnDemandParser is an alternative to Parser for large documents
+	/// of which only parts are used, e.g. configuration and telemetry
+	/// payloads of several MB.
+	///
+	/// Instead of building a DOM of Object, Array and Dynamic::Var
+	/// instances, parse() only builds a structural index of the document
+	/// (the positions of brackets, braces, colons, commas, and of the
+	/// first characters of strings and scalars), in the style of
+	/// simdjson: the input is classified 16 bytes at a time with SSE2,
+	/// where available, and strings and whitespace are skipped
+	/// without looking at individual characters. A second pass over the
+	/// index matches brackets, so that nested containers can be skipped.
+	///
+	/// Values are then accessed on demand, through OnDemandValue:
+	///
+	///     OnDemandParser parser;
+	///     OnDemandValue root = parser.parse(json);
+	///     Poco::Int64 rsrp = root["lte"]["rsrp"].getInt64();
+	///
+	/// parse() checks that strings are terminated and brackets match;
+	/// scalars, string escapes and the object/array grammar are checked
+	/// when the values are accessed. The input is not copied and must
+	/// stay unchanged as long as values are used. The index buffers are
+	/// kept across calls to parse(), so parsing a series of documents
+	/// with one parser does not allocate memory once the buffers are
+	/// large enough.
+{
+public:
+	OnDemandParser()
+		/// Creates the OnDemandParser.
+	{
+		reset();
+	}
+
+	~OnDemandParser()
+		/// Destroys the OnDemandParser.
+	{
+	}
+
+	OnDemandValue parse(const std::string& json)
+		/// Indexes the given JSON document and returns its root value.
+		/// The string must stay unchanged as long as values are used.
+	{
+		return parse(json.data(), json.size());
+	}
+
+	OnDemandValue parse(const char* data, std::size_t length)
+		/// Indexes the given JSON document and returns its root value.
+		/// The data must stay unchanged as long as values are used.
+	{
+		reset();
+		if (length > 0xFFFFFFFEu) throw JSONException("Document too large");
+		_pData = data;
+		_length = static_cast<Poco::UInt32>(length);
+		index();
+		match();
+		return OnDemandValue(this, 0);
+	}
+
+	std::size_t structurals() const
+		/// Returns the number of entries of the structural
+		/// index of the last document.
+	{
+		return _index.size();
+	}
+
+private:
+	OnDemandParser(const OnDemandParser&);
+	OnDemandParser& operator = (const OnDemandParser&);
+
+	enum CharClass
+	{
+		CC_OTHER,
+		CC_STRUCTURAL,
+		CC_WHITESPACE
+	};
+
+	void reset()
+	{
+		_pData = "";
+		_length = 0;
+		_index.clear();
+		_jump.clear();
+	}
+
+	static CharClass charClass(char c)
+	{
+		switch (c)
+		{
+		case '{': case '}': case '[': case ']': case ':': case ',':
+			return CC_STRUCTURAL;
+		case ' ': case '\t': case '\n': case '\r':
+			return CC_WHITESPACE;
+		default:
+			return CC_OTHER;
+		}
+	}
+
+	struct ScanState
+	{
+		ScanState():
+			inString(false),
+			escape(false),
+			inScalar(false)
+		{
+		}
+
+		bool inString;
+		bool escape;
+		bool inScalar;
+	};
+
+	void scanScalar(Poco::UInt32 pos, Poco::UInt32 end, ScanState& state)
+		/// Indexes the given range one character at a time.
+	{
+		for (; pos < end; ++pos)
+		{
+			char c = _pData[pos];
+			if (state.inString)
+			{
+				if (state.escape)
+					state.escape = false;
+				else if (c == '\\')
+					state.escape = true;
+				else if (c == '"')
+					state.inString = false;
+				continue;
+			}
+			if (c == '"')
+			{
+				_index.push_back(pos);
+				state.inString = true;
+				state.inScalar = false;
+				continue;
+			}
+			switch (charClass(c))
+			{
+			case CC_STRUCTURAL:
+				_index.push_back(pos);
+				state.inScalar = false;
+				break;
+			case CC_WHITESPACE:
+				state.inScalar = false;
+				break;
+			default:
+				if (!state.inScalar) _index.push_back(pos);
+				state.inScalar = true;
+				break;
+			}
+		}
+	}
+
+	static unsigned trailingZeros(unsigned mask)
+	{
+#if defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+		unsigned n = 0;
+		while ((mask & 1) == 0)
+		{
+			mask >>= 1;
+			++n;
+		}
+		return n;
+#endif
+	}
+
+	void index()
+		/// Builds the structural index.
+	{
+		_index.reserve(_length/4 + 16);
+		ScanState state;
+		Poco::UInt32 pos = 0;
+#if defined(__SSE2__)
+		const __m128i quote  = _mm_set1_epi8('"');
+		const __m128i bslash = _mm_set1_epi8('\\');
+		const __m128i lbrace = _mm_set1_epi8('{');
+		const __m128i rbrace = _mm_set1_epi8('}');
+		const __m128i lbrack = _mm_set1_epi8('[');
+		const __m128i rbrack = _mm_set1_epi8(']');
+		const __m128i colon  = _mm_set1_epi8(':');
+		const __m128i comma  = _mm_set1_epi8(',');
+		const __m128i space  = _mm_set1_epi8(' ');
+		const __m128i tab    = _mm_set1_epi8('\t');
+		const __m128i lf     = _mm_set1_epi8('\n');
+		const __m128i cr     = _mm_set1_epi8('\r');
+		for (; pos + 16 <= _length; pos += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_pData + pos));
+			unsigned bs = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, bslash)));
+			if (bs != 0 || state.escape)
+			{
+				// blocks with escapes are rare; index them one character at a time
+				scanScalar(pos, pos + 16, state);
+				continue;
+			}
+			unsigned qm = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)));
+			__m128i st = _mm_or_si128(
+				_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lbrace), _mm_cmpeq_epi8(v, rbrace)), _mm_or_si128(_mm_cmpeq_epi8(v, lbrack), _mm_cmpeq_epi8(v, rbrack))),
+				_mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+			__m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)), _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+			unsigned sm = static_cast<unsigned>(_mm_movemask_epi8(st));
+			unsigned wm = static_cast<unsigned>(_mm_movemask_epi8(ws));
+
+			// bits inside strings, including opening quotes, by prefix xor of the quotes
+			unsigned inside = qm;
+			inside ^= inside << 1;
+			inside ^= inside << 2;
+			inside ^= inside << 4;
+			inside ^= inside << 8;
+			if (state.inString) inside = ~inside;
+			inside &= 0xFFFF;
+			state.inString = (inside & 0x8000) != 0;
+
+			unsigned outside = ~(inside | qm) & 0xFFFF;
+			unsigned scalars = outside & ~(sm | wm);
+			unsigned starts = scalars & ~((scalars << 1) | (state.inScalar ? 1u : 0u));
+			state.inScalar = (scalars & 0x8000) != 0;
+
+			unsigned mask = ((sm & outside) | (qm & inside) | starts) & 0xFFFF;
+			while (mask)
+			{
+				_index.push_back(pos + trailingZeros(mask));
+				mask &= mask - 1;
+			}
+		}
+#endif
+		scanScalar(pos, _length, state);
+		if (state.inString) throw JSONException("Unterminated string");
+		if (_index.empty()) throw JSONException("Empty document");
+	}
+
+	void match()
+		/// Matches brackets. For every opening bracket, _jump holds
+		/// the index of the matching closing bracket.
+	{
+		_jump.resize(_index.size());
+		std::vector<Poco::UInt32>& stack = _stack;
+		stack.clear();
+		for (Poco::UInt32 k = 0; k < _index.size(); ++k)
+		{
+			_jump[k] = k;
+			char c = _pData[_index[k]];
+			if (c == '{' || c == '[')
+			{
+				stack.push_back(k);
+			}
+			else if (c == '}' || c == ']')
+			{
+				if (stack.empty()) throw JSONException("Unexpected closing bracket", position(k));
+				Poco::UInt32 open = stack.back();
+				if ((_pData[_index[open]] == '{') != (c == '}')) throw JSONException("Mismatched bracket", position(k));
+				_jump[open] = k;
+				stack.pop_back();
+			}
+		}
+		if (!stack.empty()) throw JSONException("Unterminated object or array");
+		if (_jump[0] + 1 != _index.size()) throw JSONException("Unexpected content after document", position(_jump[0] + 1));
+	}
+
+	std::string position(Poco::UInt32 k) const
+	{
+		std::string result("at offset ");
+		Poco::NumberFormatter::append(result, k < _index.size() ? _index[k] : _length);
+		return result;
+	}
+
+	char at(Poco::UInt32 k) const
+	{
+		return k < _index.size() ? _pData[_index[k]] : '\0';
+	}
+
+	Poco::UInt32 next(Poco::UInt32 k) const
+		/// Returns the index following the value at k.
+	{
+		return _jump[k] + 1;
+	}
+
+	void member(Poco::UInt32 k) const
+		/// Checks the "name": of the member at k.
+	{
+		if (at(k) != '"') throw JSONException("Expected member name", position(k));
+		if (at(k + 1) != ':') throw JSONException("Expected ':'", position(k + 1));
+	}
+
+	Poco::UInt32 separator(Poco::UInt32 k, Poco::UInt32 close) const
+		/// Checks the ',' or closing bracket at k, and returns the
+		/// index of the next member or element, or close.
+	{
+		if (k == close) return close;
+		if (at(k) != ',' || k + 1 == close) throw JSONException("Expected ','", position(k));
+		return k + 1;
+	}
+
+	const char* _pData;
+	Poco::UInt32 _length;
+	std::vector<Poco::UInt32> _index;
+	std::vector<Poco::UInt32> _jump;
+	std::vector<Poco::UInt32> _stack;
+
+	friend class OnDemandValue;
+	friend class OnDemandValue::Iterator;
+};
+
+
+//
+// inlines
+//
+inline OnDemandValue::Iterator& OnDemandValue::Iterator::operator ++ ()
+{
+	if (valid())
+	{
+		_index = _pParser->separator(_pParser->next(_object ? _index + 2 : _index), _close);
+		check();
+	}
+	return *this;
+}
+
+
+inline void OnDemandValue::Iterator::check() const
+{
+	if (_object && valid()) _pParser->member(_index);
+}
+
+
+inline OnDemandValue OnDemandValue::Iterator::key() const
+{
+	if (!valid() || !_object) throw JSONException("No member name");
+	return OnDemandValue(_pParser, _index);
+}
+
+
+inline OnDemandValue OnDemandValue::Iterator::value() const
+{
+	if (!valid()) throw JSONException("Iterator past the end");
+	return OnDemandValue(_pParser, _object ? _index + 2 : _index);
+}
+
+
+inline char OnDemandValue::first() const
+{
+	if (!_pParser) throw JSONException("Undefined value");
+	return _pParser->at(_index);
+}
+
+
+inline OnDemandValue::Type OnDemandValue::type() const
+{
+	if (!_pParser) return TYPE_UNDEFINED;
+	switch (_pParser->at(_index))
+	{
+	case '{': return TYPE_OBJECT;
+	case '[': return TYPE_ARRAY;
+	case '"': return TYPE_STRING;
+	case 't': case 'f': return TYPE_BOOLEAN;
+	case 'n': return TYPE_NULL;
+	case '}': case ']': case ':': case ',': throw JSONException("Unexpected character", _pParser->position(_index));
+	default: return TYPE_NUMBER;
+	}
+}
+
+
+inline void OnDemandValue::expect(Type t) const
+{
+	if (type() != t) throw JSONException("Unexpected value type", _pParser ? _pParser->position(_index) : std::string());
+}
+
+
+inline void OnDemandValue::scalar(const char*& begin, const char*& end) const
+{
+	const OnDemandParser& p = *_pParser;
+	begin = p._pData + p._index[_index];
+	end = p._pData + (_index + 1 < p._index.size() ? p._index[_index + 1] : p._length);
+	while (end > begin && OnDemandParser::charClass(end[-1]) == OnDemandParser::CC_WHITESPACE) --end;
+}
+
+
+inline void OnDemandValue::string(const char*& begin, const char*& end) const
+{
+	expect(TYPE_STRING);
+	scalar(begin, end);
+	// only whitespace may follow the closing quote
+	if (end - begin < 2 || end[-1] != '"') throw JSONException("Invalid string", _pParser->position(_index));
+	++begin;
+	--end;
+}
+
+
+inline bool OnDemandValue::getBool() const
+{
+	expect(TYPE_BOOLEAN);
+	const char* begin;
+	const char* end;
+	scalar(begin, end);
+	if (end - begin == 4 && std::memcmp(begin, "true", 4) == 0) return true;
+	if (end - begin == 5 && std::memcmp(begin, "false", 5) == 0) return false;
+	throw JSONException("Invalid boolean", _pParser->position(_index));
+}
+
+
+inline bool OnDemandValue::decimal(const char* begin, const char* end, bool& integer) const
+	/// Checks the JSON number grammar.
+{
+	const char* p = begin;
+	integer = true;
+	if (p < end && *p == '-') ++p;
+	if (p == end) return false;
+	if (*p == '0')
+		++p;
+	else if (*p >= '1' && *p <= '9')
+		while (p < end && *p >= '0' && *p <= '9') ++p;
+	else
+		return false;
+	if (p < end && *p == '.')
+	{
+		integer = false;
+		++p;
+		if (p == end || *p < '0' || *p > '9') return false;
+		while (p < end && *p >= '0' && *p <= '9') ++p;
+	}
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		integer = false;
+		++p;
+		if (p < end && (*p == '+' || *p == '-')) ++p;
+		if (p == end || *p < '0' || *p > '9') return false;
+		while (p < end && *p >= '0' && *p <= '9') ++p;
+	}
+	return p == end;
+}
+
+
+inline bool OnDemandValue::isInteger() const
+{
+	if (type() != TYPE_NUMBER) return false;
+	const char* begin;
+	const char* end;
+	scalar(begin, end);
+	bool integer;
+	return decimal(begin, end, integer) && integer;
+}
+
+
+inline Poco::Int64 OnDemandValue::getInt64() const
+{
+	expect(TYPE_NUMBER);
+	const char* begin;
+	const char* end;
+	scalar(begin, end);
+	bool integer;
+	if (!decimal(begin, end, integer) || !integer) throw JSONException("Not an integer", _pParser->position(_index));
+	const char* p = begin;
+	bool negative = *p == '-';
+	if (negative) ++p;
+	Poco::UInt64 value = 0;
+	const Poco::UInt64 limit = negative ? Poco::UInt64(1) << 63 : (Poco::UInt64(1) << 63) - 1;
+	for (; p < end; ++p)
+	{
+		Poco::UInt64 digit = static_cast<Poco::UInt64>(*p - '0');
+		if (value > (limit - digit)/10) throw JSONException("Integer out of range", _pParser->position(_index));
+		value = value*10 + digit;
+	}
+	return negative ? static_cast<Poco::Int64>(~value + 1) : static_cast<Poco::Int64>(value);
+}
+
+
+inline double OnDemandValue::getDouble() const
+{
+	expect(TYPE_NUMBER);
+	const char* begin;
+	const char* end;
+	scalar(begin, end);
+	bool integer;
+	if (!decimal(begin, end, integer)) throw JSONException("Invalid number", _pParser->position(_index));
+	std::size_t length = static_cast<std::size_t>(end - begin);
+	char buffer[64];
+	if (length < sizeof(buffer))
+	{
+		std::memcpy(buffer, begin, length);
+		buffer[length] = '\0';
+		return Poco::strToDouble(buffer);
+	}
+	return Poco::strToDouble(std::string(begin, end).c_str());
+}
+
+
+inline int OnDemandValue::hex4(const char* p, const char* end) const
+{
+	if (end - p < 4) throw JSONException("Invalid escape", _pParser->position(_index));
+	int value = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		char c = p[i];
+		value <<= 4;
+		if (c >= '0' && c <= '9')
+			value += c - '0';
+		else if (c >= 'a' && c <= 'f')
+			value += c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			value += c - 'A' + 10;
+		else
+			throw JSONException("Invalid escape", _pParser->position(_index));
+	}
+	return value;
+}
+
+
+inline void OnDemandValue::appendUTF8(std::string& str, int cp)
+{
+	if (cp < 0x80)
+	{
+		str += static_cast<char>(cp);
+	}
+	else if (cp < 0x800)
+	{
+		str += static_cast<char>(0xC0 | (cp >> 6));
+		str += static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	else if (cp < 0x10000)
+	{
+		str += static_cast<char>(0xE0 | (cp >> 12));
+		str += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		str += static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	else
+	{
+		str += static_cast<char>(0xF0 | (cp >> 18));
+		str += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+		str += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		str += static_cast<char>(0x80 | (cp & 0x3F));
+	}
+}
+
+
+inline std::string OnDemandValue::getString() const
+{
+	const char* begin;
+	const char* end;
+	string(begin, end);
+	if (!FastUTF8::isValid(begin, static_cast<std::size_t>(end - begin))) throw JSONException("Invalid UTF-8 string", _pParser->position(_index));
+	const char* bs = static_cast<const char*>(std::memchr(begin, '\\', static_cast<std::size_t>(end - begin)));
+	if (!bs) return std::string(begin, end);
+
+	std::string result(begin, bs);
+	result.reserve(static_cast<std::size_t>(end - begin));
+	for (const char* p = bs; p < end; ++p)
+	{
+		if (*p != '\\')
+		{
+			result += *p;
+			continue;
+		}
+		if (++p == end) throw JSONException("Invalid escape", _pParser->position(_index));
+		switch (*p)
+		{
+		case '"': result += '"'; break;
+		case '\\': result += '\\'; break;
+		case '/': result += '/'; break;
+		case 'b': result += '\b'; break;
+		case 'f': result += '\f'; break;
+		case 'n': result += '\n'; break;
+		case 'r': result += '\r'; break;
+		case 't': result += '\t'; break;
+		case 'u':
+			{
+				int cp = 0;
+				for (int n = 0; n < 2; ++n)
+				{
+					int unit = hex4(p + 1, end);
+					p += 4;
+					if (n == 0)
+					{
+						cp = unit;
+						// a high surrogate must be followed by an escaped low surrogate
+						if (cp < 0xD800 || cp > 0xDBFF) break;
+						if (end - p < 3 || p[1] != '\\' || p[2] != 'u') throw JSONException("Invalid surrogate pair", _pParser->position(_index));
+						p += 2;
+					}
+					else
+					{
+						if (unit < 0xDC00 || unit > 0xDFFF) throw JSONException("Invalid surrogate pair", _pParser->position(_index));
+						cp = 0x10000 + ((cp - 0xD800) << 10) + (unit - 0xDC00);
+					}
+				}
+				appendUTF8(result, cp);
+			}
+			break;
+		default:
+			throw JSONException("Invalid escape", _pParser->position(_index));
+		}
+	}
+	return result;
+}
+
+
+inline bool OnDemandValue::equals(const char* str, std::size_t length) const
+{
+	if (type() != TYPE_STRING) return false;
+	const char* begin;
+	const char* end;
+	string(begin, end);
+	if (!std::memchr(begin, '\\', static_cast<std::size_t>(end - begin)))
+		return static_cast<std::size_t>(end - begin) == length && std::memcmp(begin, str, length) == 0;
+	std::string value = getString();
+	return value.size() == length && std::memcmp(value.data(), str, length) == 0;
+}
+
+
+inline OnDemandValue::Iterator OnDemandValue::begin() const
+{
+	char c = first();
+	if (c != '{' && c != '[') throw JSONException("Not an object or array", _pParser->position(_index));
+	Poco::UInt32 close = _pParser->_jump[_index];
+	return Iterator(_pParser, _index + 1, close, c == '{');
+}
+
+
+inline std::size_t OnDemandValue::size() const
+{
+	std::size_t n = 0;
+	for (Iterator it = begin(); it.valid(); ++it) ++n;
+	return n;
+}
+
+
+inline OnDemandValue OnDemandValue::operator [] (const char* name) const
+{
+	expect(TYPE_OBJECT);
+	std::size_t length = std::strlen(name);
+	for (Iterator it = begin(); it.valid(); ++it)
+	{
+		if (it.key().equals(name, length)) return it.value();
+	}
+	return OnDemandValue();
+}
+
+
+inline OnDemandValue OnDemandValue::operator [] (const std::string& name) const
+{
+	expect(TYPE_OBJECT);
+	for (Iterator it = begin(); it.valid(); ++it)
+	{
+		if (it.key().equals(name.data(), name.size())) return it.value();
+	}
+	return OnDemandValue();
+}
+
+
+inline OnDemandValue OnDemandValue::operator [] (std::size_t index) const
+{
+	expect(TYPE_ARRAY);
+	std::size_t i = 0;
+	for (Iterator it = begin(); it.valid(); ++it, ++i)
+	{
+		if (i == index) return it.value();
+	}
+	return OnDemandValue();
+}
+
+
+inline std::string OnDemandValue::raw() const
+{
+	first();
+	const OnDemandParser& p = *_pParser;
+	const char* begin = p._pData + p._index[_index];
+	Poco::UInt32 last = p._jump[_index];
+	const char* end;
+	if (last != _index)
+	{
+		end = p._pData + p._index[last] + 1;
+	}
+	else
+	{
+		scalar(begin, end);
+	}
+	return std::string(begin, end);
+}
+
+
+inline Poco::Dynamic::Var OnDemandValue::toVar() const
+{
+	switch (type())
+	{
+	case TYPE_UNDEFINED:
+		throw JSONException("Undefined value");
+	case TYPE_NULL:
+		{
+			const char* begin;
+			const char* end;
+			scalar(begin, end);
+			if (end - begin != 4 || std::memcmp(begin, "null", 4) != 0) throw JSONException("Invalid null", _pParser->position(_index));
+			return Poco::Dynamic::Var();
+		}
+	case TYPE_BOOLEAN:
+		return getBool();
+	case TYPE_NUMBER:
+		if (isInteger()) return getInt64();
+		return getDouble();
+	case TYPE_STRING:
+		return getString();
+	case TYPE_ARRAY:
+		{
+			Array::Ptr pArray = new Array;
+			for (Iterator it = begin(); it.valid(); ++it)
+			{
+				pArray->add(it.value().toVar());
+			}
+			return pArray;
+		}
+	case TYPE_OBJECT:
+	default:
+		{
+			Object::Ptr pObject = new Object;
+			for (Iterator it = begin(); it.valid(); ++it)
+			{
+				pObject->set(it.key().getString(), it.value().toVar());
+			}
+			return pObject;
+		}
+	}
+}
+
+
+} } // namespace Poco::JSON
+
+
+#endif // JSON_OnDemandParser_INCLUDED
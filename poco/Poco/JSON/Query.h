@@ -23,6 +23,8 @@
 #include "Poco/JSON/JSON.h"
 #include "Poco/JSON/Object.h"
 #include "Poco/JSON/Array.h"
+#include "Poco/JSON/QueryPath.h"
+#include "Poco/SingletonHolder.h"
 
 
 namespace Poco {
@@ -116,6 +118,68 @@ public:
 		return findValue<std::string>(path, def);
 	}
 
+	static QueryPath compile(const std::string& path)
+		/// Returns the compiled form of the given path, for use with
+		/// the QueryPath overloads below, which do not parse the path
+		/// again. Compiled paths are kept in a shared LRU cache, so
+		/// repeated calls with the same path are cheap as well.
+	{
+		static SingletonHolder<QueryPathCache> sh;
+		return sh.get()->compile(path);
+	}
+
+	Dynamic::Var find(const QueryPath& path) const
+		/// Searches a value, using a compiled path.
+		/// When the value can't be found an empty value is returned.
+	{
+		return path.find(_source);
+	}
+
+	Object::Ptr findObject(const QueryPath& path) const
+		/// Search for an object, using a compiled path.
+		/// See findObject(const std::string&).
+	{
+		Dynamic::Var result = path.find(_source);
+		if (result.type() == typeid(Object::Ptr))
+			return result.extract<Object::Ptr>();
+		else if (result.type() == typeid(Object))
+			return new Object(result.extract<Object>());
+		return 0;
+	}
+
+	Array::Ptr findArray(const QueryPath& path) const
+		/// Search for an array, using a compiled path.
+		/// See findArray(const std::string&).
+	{
+		Dynamic::Var result = path.find(_source);
+		if (result.type() == typeid(Array::Ptr))
+			return result.extract<Array::Ptr>();
+		else if (result.type() == typeid(Array))
+			return new Array(result.extract<Array>());
+		return 0;
+	}
+
+	template<typename T>
+	T findValue(const QueryPath& path, const T& def) const
+		/// Searches for a value, using a compiled path, and converts
+		/// it to the given type. When the value can't be found or has
+		/// an invalid type the default value will be returned.
+	{
+		T result = def;
+		Dynamic::Var value = path.find(_source);
+		if (!value.isEmpty())
+		{
+			try
+			{
+				result = value.convert<T>();
+			}
+			catch (...) 
+			{ 
+			}
+		}
+		return result;
+	}
+
 private:
 	Dynamic::Var _source;
 };
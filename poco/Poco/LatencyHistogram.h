@@ -0,0 +1,508 @@
+//
+// LatencyHistogram.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  LatencyHistogram
+//
+// Definition of the LatencyHistogram class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_LatencyHistogram_INCLUDED
+#define Foundation_LatencyHistogram_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Instrumentation.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Clock.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <cstddef>
+#if __cplusplus >= 201103L
+#include <atomic>
+#elif defined(POCO_OS_FAMILY_WINDOWS)
+#include "Poco/UnWindows.h"
+#elif !defined(POCO_HAVE_GCC_ATOMICS)
+#include "Poco/Mutex.h"
+#endif
+
+
+namespace Poco {
+
+
+class LatencyHistogram
+	/// A histogram of durations in nanoseconds, with a bounded
+	/// relative error, in the manner of HdrHistogram.
+	///
+	/// Durations below SUB_BUCKETS nanoseconds are counted exactly.
+	/// Larger durations are counted in buckets whose width is at most
+	/// 1/SUB_BUCKETS (about 3%) of their lowest value, so that every
+	/// percentile is reported with at most that relative error.
+	/// Durations of 2^(MAX_MAGNITUDE + 1) nanoseconds (about 9.7 hours)
+	/// or more are counted in the last bucket.
+	///
+	/// All buckets are counted with atomic operations, so that any
+	/// number of threads can record into the same histogram without
+	/// a lock. Alternatively, every thread records into a histogram
+	/// of its own, and the histograms are combined with merge().
+	///
+	/// Durations can be taken with a Stopwatch, a Clock or a Scope:
+	///
+	///     static Poco::LatencyHistogram latency;
+	///     {
+	///         Poco::LatencyHistogram::Scope scope(latency);
+	///         ...
+	///     }
+	///     std::cout << latency.percentile(0.99) << " ns" << std::endl;
+	///
+	/// See Poco/RemotingNG/LatencyHistogramSerializer.h and
+	/// Poco/JSON/LatencyHistogramWriter.h for serialization.
+{
+public:
+	enum
+	{
+		PRECISION_BITS = 5,
+		SUB_BUCKETS = 1 << PRECISION_BITS,
+			/// Number of buckets per power of two.
+		MAX_MAGNITUDE = 44,
+			/// Durations from 2^MAX_MAGNITUDE to 2^(MAX_MAGNITUDE + 1)
+			/// nanoseconds are counted in the last buckets.
+		BUCKETS = (MAX_MAGNITUDE - PRECISION_BITS + 2)*SUB_BUCKETS
+	};
+
+	class Scope
+		/// Records the time from its construction until
+		/// its destruction in a LatencyHistogram.
+	{
+	public:
+		explicit Scope(LatencyHistogram& histogram):
+			_histogram(histogram),
+			_start(Instrumentation::now())
+		{
+		}
+
+		~Scope()
+		{
+			_histogram.record(Instrumentation::now() - _start);
+		}
+
+	private:
+		Scope();
+		Scope(const Scope&);
+		Scope& operator = (const Scope&);
+
+		LatencyHistogram& _histogram;
+		UInt64 _start;
+	};
+
+	LatencyHistogram()
+		/// Creates an empty LatencyHistogram.
+	{
+		reset();
+	}
+
+	LatencyHistogram(const LatencyHistogram& other)
+		/// Creates a copy of the given LatencyHistogram.
+	{
+		reset();
+		merge(other);
+	}
+
+	~LatencyHistogram()
+		/// Destroys the LatencyHistogram.
+	{
+	}
+
+	LatencyHistogram& operator = (const LatencyHistogram& other)
+		/// Replaces the counts with those of the given LatencyHistogram.
+		/// Must not be called while other threads record.
+	{
+		if (&other != this)
+		{
+			reset();
+			merge(other);
+		}
+		return *this;
+	}
+
+	void record(UInt64 duration)
+		/// Adds a duration, given in nanoseconds.
+	{
+		record(duration, 1);
+	}
+
+	void record(UInt64 duration, UInt64 times)
+		/// Adds the given duration, in nanoseconds, the given number of times.
+	{
+		if (times == 0) return;
+		add(_buckets[bucketIndex(duration)], times);
+		add(_count, times);
+		add(_total, duration*times);
+		lower(_min, duration);
+		raise(_max, duration);
+	}
+
+	void record(const Stopwatch& stopwatch)
+		/// Adds the elapsed time of the given Stopwatch.
+	{
+		record(static_cast<UInt64>(stopwatch.elapsed())*1000);
+	}
+
+	void recordSince(const Clock& start)
+		/// Adds the time elapsed since the given Clock value.
+	{
+		Clock::ClockDiff elapsed = start.elapsed();
+		record(elapsed > 0 ? static_cast<UInt64>(elapsed)*1000 : 0);
+	}
+
+	void merge(const LatencyHistogram& other)
+		/// Adds the counts of the given LatencyHistogram.
+	{
+		if (load(other._count) == 0) return;
+		for (std::size_t i = 0; i < BUCKETS; ++i)
+		{
+			UInt64 n = load(other._buckets[i]);
+			if (n) add(_buckets[i], n);
+		}
+		add(_count, load(other._count));
+		add(_total, load(other._total));
+		lower(_min, load(other._min));
+		raise(_max, load(other._max));
+	}
+
+	void reset()
+		/// Removes all recorded durations. Must not be
+		/// called while other threads record.
+	{
+		for (std::size_t i = 0; i < BUCKETS; ++i) store(_buckets[i], 0);
+		store(_count, 0);
+		store(_total, 0);
+		store(_min, ~UInt64(0));
+		store(_max, 0);
+	}
+
+	UInt64 count() const
+		/// Returns the number of recorded durations.
+	{
+		return load(_count);
+	}
+
+	UInt64 total() const
+		/// Returns the sum of all recorded durations.
+	{
+		return load(_total);
+	}
+
+	UInt64 min() const
+		/// Returns the shortest recorded duration, or 0
+		/// if no duration has been recorded.
+	{
+		return load(_count) ? load(_min) : 0;
+	}
+
+	UInt64 max() const
+		/// Returns the longest recorded duration.
+	{
+		return load(_max);
+	}
+
+	double mean() const
+		/// Returns the average recorded duration.
+	{
+		UInt64 n = load(_count);
+		return n ? static_cast<double>(load(_total))/static_cast<double>(n) : 0.0;
+	}
+
+	UInt64 percentile(double fraction) const
+		/// Returns the duration at or below which the given fraction
+		/// (0.0 - 1.0) of the recorded durations lie, i.e. the highest
+		/// duration counted in the bucket containing that rank, limited
+		/// to the range of the recorded durations.
+	{
+		UInt64 n = load(_count);
+		if (n == 0) return 0;
+		UInt64 rank = static_cast<UInt64>(fraction*static_cast<double>(n) + 0.5);
+		if (rank < 1) rank = 1;
+		if (rank > n) rank = n;
+		UInt64 sum = 0;
+		for (std::size_t i = 0; i < BUCKETS; ++i)
+		{
+			sum += load(_buckets[i]);
+			if (sum >= rank) return clamp(highestValue(i));
+		}
+		return load(_max);
+	}
+
+	UInt64 bucket(std::size_t index) const
+		/// Returns the number of durations counted in the given bucket.
+	{
+		poco_assert (index < BUCKETS);
+
+		return load(_buckets[index]);
+	}
+
+	void buckets(std::vector<UInt32>& indexes, std::vector<UInt64>& counts) const
+		/// Appends the indexes and counts of all buckets that are
+		/// not empty, e.g. for serialization.
+	{
+		for (std::size_t i = 0; i < BUCKETS; ++i)
+		{
+			UInt64 n = load(_buckets[i]);
+			if (n)
+			{
+				indexes.push_back(static_cast<UInt32>(i));
+				counts.push_back(n);
+			}
+		}
+	}
+
+	void assign(const std::vector<UInt32>& indexes, const std::vector<UInt64>& counts, UInt64 total, UInt64 min, UInt64 max)
+		/// Replaces the counts with the given ones, as obtained from buckets(),
+		/// total(), min() and max(), e.g. for deserialization.
+		///
+		/// Throws an InvalidArgumentException if the indexes and counts
+		/// do not match or an index is out of range.
+	{
+		if (indexes.size() != counts.size()) throw InvalidArgumentException("LatencyHistogram bucket indexes and counts do not match");
+		for (std::vector<UInt32>::const_iterator it = indexes.begin(); it != indexes.end(); ++it)
+		{
+			if (*it >= BUCKETS) throw InvalidArgumentException("LatencyHistogram bucket index out of range");
+		}
+		reset();
+		UInt64 n = 0;
+		for (std::size_t i = 0; i < indexes.size(); ++i)
+		{
+			add(_buckets[indexes[i]], counts[i]);
+			n += counts[i];
+		}
+		store(_count, n);
+		store(_total, total);
+		if (n)
+		{
+			store(_min, min);
+			store(_max, max);
+		}
+	}
+
+	static std::size_t bucketIndex(UInt64 duration)
+		/// Returns the index of the bucket counting the given duration.
+	{
+		if (duration < SUB_BUCKETS) return static_cast<std::size_t>(duration);
+		int magnitude = highestBit(duration);
+		if (magnitude > MAX_MAGNITUDE) return BUCKETS - 1;
+		int shift = magnitude - PRECISION_BITS;
+		return static_cast<std::size_t>(shift + 1)*SUB_BUCKETS + static_cast<std::size_t>((duration >> shift) - SUB_BUCKETS);
+	}
+
+	static UInt64 lowestValue(std::size_t index)
+		/// Returns the shortest duration counted in the given bucket.
+	{
+		if (index < SUB_BUCKETS) return index;
+		std::size_t shift = index/SUB_BUCKETS - 1;
+		return (static_cast<UInt64>(SUB_BUCKETS) + index % SUB_BUCKETS) << shift;
+	}
+
+	static UInt64 highestValue(std::size_t index)
+		/// Returns the longest duration counted in the given bucket.
+	{
+		if (index < SUB_BUCKETS) return index;
+		std::size_t shift = index/SUB_BUCKETS - 1;
+		return lowestValue(index) + (UInt64(1) << shift) - 1;
+	}
+
+private:
+#if __cplusplus >= 201103L
+	typedef std::atomic<UInt64> Value;
+
+	static void add(Value& value, UInt64 n)
+	{
+		value.fetch_add(n, std::memory_order_relaxed);
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		return value.load(std::memory_order_relaxed);
+	}
+
+	static void store(Value& value, UInt64 n)
+	{
+		value.store(n, std::memory_order_relaxed);
+	}
+
+	static void lower(Value& value, UInt64 n)
+	{
+		UInt64 current = value.load(std::memory_order_relaxed);
+		while (n < current && !value.compare_exchange_weak(current, n, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	static void raise(Value& value, UInt64 n)
+	{
+		UInt64 current = value.load(std::memory_order_relaxed);
+		while (n > current && !value.compare_exchange_weak(current, n, std::memory_order_relaxed))
+		{
+		}
+	}
+#elif defined(POCO_OS_FAMILY_WINDOWS)
+	typedef volatile LONGLONG Value;
+
+	static void add(Value& value, UInt64 n)
+	{
+		InterlockedExchangeAdd64(&value, static_cast<LONGLONG>(n));
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		return static_cast<UInt64>(InterlockedCompareExchange64(const_cast<Value*>(&value), 0, 0));
+	}
+
+	static void store(Value& value, UInt64 n)
+	{
+		InterlockedExchange64(&value, static_cast<LONGLONG>(n));
+	}
+
+	static void lower(Value& value, UInt64 n)
+	{
+		UInt64 current = load(value);
+		while (n < current)
+		{
+			UInt64 previous = static_cast<UInt64>(InterlockedCompareExchange64(&value, static_cast<LONGLONG>(n), static_cast<LONGLONG>(current)));
+			if (previous == current) break;
+			current = previous;
+		}
+	}
+
+	static void raise(Value& value, UInt64 n)
+	{
+		UInt64 current = load(value);
+		while (n > current)
+		{
+			UInt64 previous = static_cast<UInt64>(InterlockedCompareExchange64(&value, static_cast<LONGLONG>(n), static_cast<LONGLONG>(current)));
+			if (previous == current) break;
+			current = previous;
+		}
+	}
+#elif defined(POCO_HAVE_GCC_ATOMICS)
+	typedef volatile UInt64 Value;
+
+	static void add(Value& value, UInt64 n)
+	{
+		__sync_fetch_and_add(&value, n);
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		return __sync_fetch_and_add(const_cast<Value*>(&value), 0);
+	}
+
+	static void store(Value& value, UInt64 n)
+	{
+		UInt64 current = load(value);
+		UInt64 previous;
+		while ((previous = __sync_val_compare_and_swap(&value, current, n)) != current) current = previous;
+	}
+
+	static void lower(Value& value, UInt64 n)
+	{
+		UInt64 current = load(value);
+		while (n < current)
+		{
+			UInt64 previous = __sync_val_compare_and_swap(&value, current, n);
+			if (previous == current) break;
+			current = previous;
+		}
+	}
+
+	static void raise(Value& value, UInt64 n)
+	{
+		UInt64 current = load(value);
+		while (n > current)
+		{
+			UInt64 previous = __sync_val_compare_and_swap(&value, current, n);
+			if (previous == current) break;
+			current = previous;
+		}
+	}
+#else
+	typedef UInt64 Value;
+
+	static FastMutex& mutex()
+	{
+		static FastMutex m;
+		return m;
+	}
+
+	static void add(Value& value, UInt64 n)
+	{
+		FastMutex::ScopedLock lock(mutex());
+		value += n;
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		FastMutex::ScopedLock lock(mutex());
+		return value;
+	}
+
+	static void store(Value& value, UInt64 n)
+	{
+		FastMutex::ScopedLock lock(mutex());
+		value = n;
+	}
+
+	static void lower(Value& value, UInt64 n)
+	{
+		FastMutex::ScopedLock lock(mutex());
+		if (n < value) value = n;
+	}
+
+	static void raise(Value& value, UInt64 n)
+	{
+		FastMutex::ScopedLock lock(mutex());
+		if (n > value) value = n;
+	}
+#endif
+
+	static int highestBit(UInt64 value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return 63 - __builtin_clzll(value);
+#else
+		int bit = 0;
+		while (value >>= 1) ++bit;
+		return bit;
+#endif
+	}
+
+	UInt64 clamp(UInt64 value) const
+	{
+		UInt64 lo = load(_min);
+		UInt64 hi = load(_max);
+		if (value < lo) return lo;
+		if (value > hi) return hi;
+		return value;
+	}
+
+	Value _buckets[BUCKETS];
+	Value _count;
+	Value _total;
+	Value _min;
+	Value _max;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_LatencyHistogram_INCLUDED
@@ -0,0 +1,724 @@
+//
+// MappedFileChannel.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  MappedFileChannel
+//
+// Definition of the MappedFileChannel class.
+//
+// Copyright (c) 2004-2008, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_MappedFileChannel_INCLUDED
+#define Foundation_MappedFileChannel_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Channel.h"
+#include "Poco/BatchChannel.h"
+#include "Poco/Message.h"
+#include "Poco/Thread.h"
+#include "Poco/RunnableAdapter.h"
+#include "Poco/Event.h"
+#include "Poco/Mutex.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/LocalDateTime.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/String.h"
+#include "Poco/Ascii.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace Poco {
+
+
+class MappedFileChannel: public Channel, public BatchChannel
+	/// A channel that appends messages to a memory-mapped log file,
+	/// for POSIX platforms.
+	///
+	/// The log file is written in segments of a fixed size, which is
+	/// also the size at which the file is rotated. log() reserves the
+	/// space for a message in the current segment with a single atomic
+	/// addition and copies the message text, followed by a newline,
+	/// into the mapping. No lock is taken and no system call is made
+	/// on the logging path.
+	///
+	/// A background thread prepares the next segment before it is
+	/// needed, in a temporary file next to the log file. When a message
+	/// does not fit into the current segment any longer, the logging
+	/// thread switches to the prepared segment, and the background
+	/// thread unmaps, truncates and archives the full one, and renames
+	/// the new file to the log file path. Only if the background thread
+	/// has fallen behind, the logging thread creates the segment itself.
+	///
+	/// Archived files are named like with FileChannel's "timestamp"
+	/// archive mode (<path>.<yyyyMMddHHmmssiii>). If compression is
+	/// enabled, a single lowest priority thread compresses them with
+	/// gzip, one after the other.
+	///
+	/// Messages are written as they are; use a FormattingChannel to
+	/// format them. A message longer than the segment size is truncated.
+	/// The file contents are written back to disk by the kernel; they
+	/// survive a crash of the process, but not necessarily of the system.
+	///
+	/// The following properties are supported:
+	///   * path:     The log file's path.
+	///   * rotation: The segment size, as <n>, <n> K or <n> M
+	///               (default 4 M). Must be set before the channel is
+	///               opened.
+	///   * compress: true or false (default). Enables or disables
+	///               compression of archived files.
+{
+public:
+	typedef AutoPtr<MappedFileChannel> Ptr;
+
+	enum
+	{
+		DEFAULT_SEGMENT_SIZE = 4*1024*1024
+	};
+
+	MappedFileChannel():
+		_segmentSize(DEFAULT_SEGMENT_SIZE),
+		_compress(false),
+		_pCurrent(0),
+		_pStandby(0),
+		_switching(0),
+		_sequence(0),
+		_open(false),
+		_stop(false),
+		_stopCompress(false),
+		_rotateRunnable(*this, &MappedFileChannel::rotate),
+		_compressRunnable(*this, &MappedFileChannel::compress)
+		/// Creates the MappedFileChannel.
+	{
+	}
+
+	MappedFileChannel(const std::string& path):
+		_path(path),
+		_segmentSize(DEFAULT_SEGMENT_SIZE),
+		_compress(false),
+		_pCurrent(0),
+		_pStandby(0),
+		_switching(0),
+		_sequence(0),
+		_open(false),
+		_stop(false),
+		_stopCompress(false),
+		_rotateRunnable(*this, &MappedFileChannel::rotate),
+		_compressRunnable(*this, &MappedFileChannel::compress)
+		/// Creates the MappedFileChannel for the file with the given path.
+	{
+	}
+
+	void open()
+		/// Opens or creates the log file and starts the
+		/// background threads.
+		///
+		/// New messages are appended to an existing log file,
+		/// unless it is not smaller than the segment size, in
+		/// which case it is archived first.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (_open) return;
+		{
+			FastMutex::ScopedLock segmentLock(_segmentMutex);
+			File file(_path);
+			if (file.exists() && file.getSize() >= _segmentSize)
+			{
+				archive(_path);
+			}
+			createSegment(_segments[0], _path, true);
+			_segments[0].state = SEGMENT_CURRENT;
+			_pStandby = 0;
+			_stop = false;
+			_stopCompress = false;
+			__sync_synchronize();
+			_pCurrent = &_segments[0];
+			_open = true;
+		}
+		_compressThread.setName("MappedFileChannel compressor");
+		_compressThread.setPriority(Thread::PRIO_LOWEST);
+		_compressThread.start(_compressRunnable);
+		_rotateThread.setName("MappedFileChannel");
+		_rotateThread.start(_rotateRunnable);
+		_rotateEvent.set();
+	}
+
+	void close()
+		/// Waits for ongoing writes, truncates the log file
+		/// to its contents and stops the background threads.
+		///
+		/// Archives queued for compression are compressed
+		/// before close() returns.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_open) return;
+		_open = false;
+		Segment* pCurrent;
+		do
+		{
+			pCurrent = _pCurrent;
+		}
+		while (!__sync_bool_compare_and_swap(&_pCurrent, pCurrent, static_cast<Segment*>(0)));
+		while (_switching > 0) Thread::yield();
+		_stop = true;
+		_rotateEvent.set();
+		_rotateThread.join();
+		{
+			FastMutex::ScopedLock segmentLock(_segmentMutex);
+			for (int i = 0; i < SEGMENT_SLOTS; ++i)
+			{
+				Segment& seg = _segments[i];
+				if (&seg == pCurrent)
+				{
+					finalize(seg);
+					if (seg.path != _path) File(seg.path).renameTo(_path);
+				}
+				else if (seg.state == SEGMENT_STANDBY)
+				{
+					seg.end = 0;
+					finalize(seg);
+					File(seg.path).remove();
+				}
+				seg.state = SEGMENT_FREE;
+			}
+			_pStandby = 0;
+		}
+		_stopCompress = true;
+		_compressEvent.set();
+		_compressThread.join();
+	}
+
+	void log(const Message& msg)
+		/// Appends the message text and a newline to the log file.
+	{
+		const std::string& text = msg.getText();
+		std::size_t length = text.size() + 1;
+		if (length > _segmentSize) length = _segmentSize;
+		std::size_t offset;
+		Segment* pSeg = reserve(length, offset);
+		if (!pSeg) return;
+		char* pDest = pSeg->pBase + offset;
+		std::memcpy(pDest, text.data(), length - 1);
+		pDest[length - 1] = '\n';
+		__sync_fetch_and_sub(&pSeg->writers, 1);
+	}
+
+	void logMany(const std::vector<Message>& messages)
+		/// Appends the texts of the messages, each followed by
+		/// a newline, to the log file, with a single reservation
+		/// if they fit into one segment.
+	{
+		std::size_t length = 0;
+		for (std::vector<Message>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+		{
+			length += it->getText().size() + 1;
+		}
+		if (length == 0) return;
+		if (length > _segmentSize)
+		{
+			for (std::vector<Message>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+			{
+				log(*it);
+			}
+			return;
+		}
+		std::size_t offset;
+		Segment* pSeg = reserve(length, offset);
+		if (!pSeg) return;
+		char* pDest = pSeg->pBase + offset;
+		for (std::vector<Message>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+		{
+			const std::string& text = it->getText();
+			std::memcpy(pDest, text.data(), text.size());
+			pDest += text.size();
+			*pDest++ = '\n';
+		}
+		__sync_fetch_and_sub(&pSeg->writers, 1);
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+		/// Sets the property with the given name to the given value.
+		///
+		/// See the class documentation for the supported properties.
+	{
+		if (name == "path")
+			_path = value;
+		else if (name == "rotation")
+			_segmentSize = parseSize(value);
+		else if (name == "compress")
+			_compress = icompare(value, "true") == 0;
+		else
+			Channel::setProperty(name, value);
+	}
+
+	std::string getProperty(const std::string& name) const
+		/// Returns the value of the property with the given name.
+	{
+		if (name == "path")
+			return _path;
+		else if (name == "rotation")
+			return NumberFormatter::format(static_cast<UInt64>(_segmentSize));
+		else if (name == "compress")
+			return _compress ? "true" : "false";
+		else
+			return Channel::getProperty(name);
+	}
+
+	const std::string& path() const
+		/// Returns the log file's path.
+	{
+		return _path;
+	}
+
+protected:
+	~MappedFileChannel()
+		/// Destroys the MappedFileChannel.
+	{
+		try
+		{
+			close();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void rotate()
+	{
+		for (;;)
+		{
+			_rotateEvent.wait();
+			try
+			{
+				FastMutex::ScopedLock lock(_segmentMutex);
+				archiveRetired();
+				if (!_stop) prepareStandby();
+			}
+			catch (Exception& exc)
+			{
+				ErrorHandler::handle(exc);
+			}
+			catch (...)
+			{
+				ErrorHandler::handle();
+			}
+			if (_stop) break;
+		}
+	}
+
+	void compress()
+	{
+		for (;;)
+		{
+			_compressEvent.wait();
+			for (;;)
+			{
+				std::string path;
+				{
+					FastMutex::ScopedLock lock(_compressMutex);
+					if (_compressQueue.empty()) break;
+					path = _compressQueue.front();
+					_compressQueue.pop_front();
+				}
+				try
+				{
+					compressFile(path);
+				}
+				catch (Exception& exc)
+				{
+					ErrorHandler::handle(exc);
+				}
+				catch (...)
+				{
+					ErrorHandler::handle();
+				}
+			}
+			if (_stopCompress) break;
+		}
+	}
+
+	static std::size_t parseSize(const std::string& value)
+	{
+		std::string::const_iterator it  = value.begin();
+		std::string::const_iterator end = value.end();
+		UInt64 n = 0;
+		while (it != end && Ascii::isDigit(*it)) n = n*10 + (*it++ - '0');
+		while (it != end && Ascii::isSpace(*it)) ++it;
+		std::string unit(it, end);
+		if (unit == "K")
+			n *= 1024;
+		else if (unit == "M")
+			n *= 1024*1024;
+		else if (!unit.empty())
+			throw InvalidArgumentException("rotation", value);
+		if (n == 0)
+			throw InvalidArgumentException("rotation", value);
+		return static_cast<std::size_t>(n);
+	}
+
+private:
+	enum
+	{
+		SEGMENT_SLOTS = 4
+	};
+
+	enum SegmentState
+	{
+		SEGMENT_FREE,
+		SEGMENT_STANDBY,
+		SEGMENT_CURRENT,
+		SEGMENT_RETIRED
+	};
+
+	struct Segment
+		/// A mapped file.
+		///
+		/// Segments are never deleted while the channel is open,
+		/// only reused, so a logging thread may always access
+		/// one it has seen as current, and then checks whether
+		/// it still is.
+	{
+		Segment():
+			writers(0),
+			reserved(0),
+			end(NO_END),
+			switching(0),
+			state(SEGMENT_FREE),
+			pBase(0),
+			capacity(0),
+			fd(-1),
+			sequence(0)
+		{
+		}
+
+		static const std::size_t NO_END = ~std::size_t(0);
+
+		volatile long        writers;   /// Threads currently accessing the segment.
+		volatile std::size_t reserved;  /// Bytes reserved, may exceed capacity.
+		volatile std::size_t end;       /// Size of the contents, once full.
+		volatile int         switching; /// A thread is switching away from the segment.
+		volatile int         state;
+		char*       pBase;
+		std::size_t capacity;
+		int         fd;
+		long        sequence;
+		std::string path;
+	};
+
+	MappedFileChannel(const MappedFileChannel&);
+	MappedFileChannel& operator = (const MappedFileChannel&);
+
+	Segment* reserve(std::size_t length, std::size_t& offset)
+		/// Reserves length bytes in the current segment and returns
+		/// it, with its writer count incremented, and the offset of
+		/// the reserved space in offset. Returns null if the channel
+		/// is closed.
+	{
+		for (;;)
+		{
+			Segment* pSeg = _pCurrent;
+			__sync_synchronize();
+			if (!pSeg) return 0;
+			__sync_fetch_and_add(&pSeg->writers, 1);
+			if (pSeg != _pCurrent)
+			{
+				__sync_fetch_and_sub(&pSeg->writers, 1);
+				continue;
+			}
+			offset = __sync_fetch_and_add(&pSeg->reserved, length);
+			if (offset + length <= pSeg->capacity) return pSeg;
+			__sync_fetch_and_sub(&pSeg->writers, 1);
+			if (offset <= pSeg->capacity)
+			{
+				// This reservation is the one crossing the end
+				// of the segment; nothing has been reserved after
+				// offset, so that is the size of the contents.
+				pSeg->end = offset;
+			}
+			// Every thread waiting for the switch may try it, so
+			// that an error of the crossing thread does not block
+			// the others, and is reported to all of them.
+			while (pSeg == _pCurrent && pSeg->end != Segment::NO_END)
+			{
+				switchSegment(pSeg);
+				if (pSeg == _pCurrent) Thread::yield();
+			}
+		}
+	}
+
+	void switchSegment(Segment* pOld)
+	{
+		if (!__sync_bool_compare_and_swap(&pOld->switching, 0, 1)) return;
+		__sync_fetch_and_add(&_switching, 1);
+		try
+		{
+			// Only this thread or close() can change
+			// the current segment now.
+			Segment* pNext = pOld == _pCurrent ? takeStandby() : 0;
+			if (pNext)
+			{
+				pNext->state = SEGMENT_CURRENT;
+				__sync_synchronize();
+				if (__sync_bool_compare_and_swap(&_pCurrent, pOld, pNext))
+				{
+					pOld->state = SEGMENT_RETIRED;
+					_rotateEvent.set();
+				}
+				else
+				{
+					// The channel has been closed, which
+					// discards standby segments.
+					pNext->state = SEGMENT_STANDBY;
+				}
+			}
+		}
+		catch (...)
+		{
+			pOld->switching = 0;
+			__sync_fetch_and_sub(&_switching, 1);
+			throw;
+		}
+		pOld->switching = 0;
+		__sync_fetch_and_sub(&_switching, 1);
+	}
+
+	Segment* takeStandby()
+		/// Takes the prepared segment, or creates one if none is.
+	{
+		for (;;)
+		{
+			Segment* pNext = _pStandby;
+			if (pNext)
+			{
+				if (__sync_bool_compare_and_swap(&_pStandby, pNext, static_cast<Segment*>(0))) return pNext;
+				continue;
+			}
+			{
+				FastMutex::ScopedLock lock(_segmentMutex);
+				if (_pStandby) continue;
+				if (!_pCurrent) return 0;
+				Segment* pFree = freeSegment();
+				if (pFree)
+				{
+					createSegment(*pFree, standbyPath(), false);
+					return pFree;
+				}
+			}
+			// All segments wait for the background thread
+			// to archive them.
+			_rotateEvent.set();
+			Thread::sleep(1);
+		}
+	}
+
+	void prepareStandby()
+	{
+		if (_pStandby) return;
+		Segment* pFree = freeSegment();
+		if (!pFree) return;
+		createSegment(*pFree, standbyPath(), false);
+		pFree->state = SEGMENT_STANDBY;
+		__sync_synchronize();
+		_pStandby = pFree;
+	}
+
+	void archiveRetired()
+		/// Archives the retired segments, oldest first, and
+		/// renames the current one to the log file path.
+	{
+		for (;;)
+		{
+			Segment* pOldest = 0;
+			for (int i = 0; i < SEGMENT_SLOTS; ++i)
+			{
+				Segment& seg = _segments[i];
+				if (seg.state == SEGMENT_RETIRED && (!pOldest || seg.sequence < pOldest->sequence))
+					pOldest = &seg;
+			}
+			if (!pOldest) break;
+			finalize(*pOldest);
+			archive(pOldest->path);
+			pOldest->state = SEGMENT_FREE;
+		}
+		Segment* pCurrent = _pCurrent;
+		if (pCurrent && pCurrent->path != _path)
+		{
+			File(pCurrent->path).renameTo(_path);
+			pCurrent->path = _path;
+		}
+	}
+
+	Segment* freeSegment()
+	{
+		for (int i = 0; i < SEGMENT_SLOTS; ++i)
+		{
+			if (_segments[i].state == SEGMENT_FREE) return &_segments[i];
+		}
+		return 0;
+	}
+
+	std::string standbyPath()
+	{
+		std::string path(_path);
+		path += ".next";
+		NumberFormatter::append(path, _sequence + 1);
+		return path;
+	}
+
+	void createSegment(Segment& seg, const std::string& path, bool append)
+		/// Creates and maps the file for the segment.
+		/// Must be called with _segmentMutex locked.
+	{
+		int flags = O_RDWR | O_CREAT;
+		if (!append) flags |= O_TRUNC;
+#if defined(O_CLOEXEC)
+		flags |= O_CLOEXEC;
+#endif
+		int fd = ::open(path.c_str(), flags, 0644);
+		if (fd < 0) throw OpenFileException(path, errno);
+		std::size_t used = 0;
+		if (append)
+		{
+			struct stat st;
+			if (::fstat(fd, &st) == 0) used = static_cast<std::size_t>(st.st_size);
+		}
+		// Allocating the blocks now avoids a SIGBUS when the
+		// file system is full, and allocation while logging.
+#if defined(__linux__)
+		if (::posix_fallocate(fd, 0, static_cast<off_t>(_segmentSize)) != 0 && ::ftruncate(fd, static_cast<off_t>(_segmentSize)) != 0)
+#else
+		if (::ftruncate(fd, static_cast<off_t>(_segmentSize)) != 0)
+#endif
+		{
+			int err = errno;
+			::close(fd);
+			throw WriteFileException(path, err);
+		}
+		void* pBase = ::mmap(0, _segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (pBase == MAP_FAILED)
+		{
+			int err = errno;
+			::close(fd);
+			throw SystemException("cannot map log file", path, err);
+		}
+		seg.pBase     = static_cast<char*>(pBase);
+		seg.capacity  = _segmentSize;
+		seg.fd        = fd;
+		seg.sequence  = ++_sequence;
+		seg.path      = path;
+		seg.writers   = 0;
+		seg.reserved  = used;
+		seg.end       = Segment::NO_END;
+		seg.switching = 0;
+	}
+
+	void finalize(Segment& seg)
+		/// Waits until no thread accesses the segment, then
+		/// unmaps it and truncates the file to its contents.
+	{
+		if (!seg.pBase) return;
+		while (seg.writers > 0) Thread::sleep(1);
+		std::size_t size = seg.end;
+		if (size == Segment::NO_END) size = seg.reserved < seg.capacity ? seg.reserved : seg.capacity;
+		::munmap(seg.pBase, seg.capacity);
+		int rc = ::ftruncate(seg.fd, static_cast<off_t>(size));
+		(void) rc;
+		::close(seg.fd);
+		seg.pBase = 0;
+		seg.fd    = -1;
+	}
+
+	void archive(const std::string& path)
+		/// Renames the given file for archiving and
+		/// queues it for compression.
+	{
+		std::string archivePath(_path);
+		archivePath += '.';
+		DateTimeFormatter::append(archivePath, LocalDateTime(), "%Y%m%d%H%M%S%i");
+		std::string uniquePath(archivePath);
+		int n = 0;
+		while (File(uniquePath).exists() || File(uniquePath + ".gz").exists())
+		{
+			uniquePath = archivePath;
+			uniquePath += '.';
+			NumberFormatter::append(uniquePath, ++n);
+		}
+		File(path).renameTo(uniquePath);
+		if (_compress)
+		{
+			{
+				FastMutex::ScopedLock lock(_compressMutex);
+				_compressQueue.push_back(uniquePath);
+			}
+			_compressEvent.set();
+		}
+	}
+
+	static void compressFile(const std::string& path)
+	{
+		std::string gzPath(path);
+		gzPath += ".gz";
+		{
+			FileInputStream istr(path);
+			FileOutputStream ostr(gzPath);
+			DeflatingOutputStream deflater(ostr, DeflatingStreamBuf::STREAM_GZIP);
+			StreamCopier::copyStream(istr, deflater);
+			deflater.close();
+			if (!ostr.good()) throw WriteFileException(gzPath);
+		}
+		File(path).remove();
+	}
+
+	std::string _path;
+	std::size_t _segmentSize;
+	bool _compress;
+	Segment _segments[SEGMENT_SLOTS];
+	Segment* volatile _pCurrent;
+	Segment* volatile _pStandby;
+	volatile long _switching;
+	long _sequence;
+	volatile bool _open;
+	volatile bool _stop;
+	volatile bool _stopCompress;
+	std::deque<std::string> _compressQueue;
+	Event _rotateEvent;
+	Event _compressEvent;
+	RunnableAdapter<MappedFileChannel> _rotateRunnable;
+	RunnableAdapter<MappedFileChannel> _compressRunnable;
+	Thread _rotateThread;
+	Thread _compressThread;
+	FastMutex _mutex;
+	FastMutex _segmentMutex;
+	FastMutex _compressMutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_MappedFileChannel_INCLUDED
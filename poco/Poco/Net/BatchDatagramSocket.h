@@ -0,0 +1,342 @@
+//
+// BatchDatagramSocket.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Sockets
+// Module:  BatchDatagramSocket
+//
+// Definition of the DatagramBatch and BatchDatagramSocket classes.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_BatchDatagramSocket_INCLUDED
+#define Net_BatchDatagramSocket_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/SocketImpl.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/Exception.h"
+#include "Poco/Buffer.h"
+#include <vector>
+#include <cstring>
+#if defined(POCO_OS_FAMILY_UNIX) && defined(__linux__)
+#include <sys/socket.h>
+#include <cerrno>
+#define POCO_NET_HAVE_MMSG 1
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+class BatchDatagramSocket;
+
+
+class DatagramBatch
+	/// DatagramBatch is a preallocated vector of datagrams, each with its
+	/// own buffer and peer address, for receiving or sending several
+	/// datagrams with a single system call using BatchDatagramSocket.
+	///
+	/// All memory is allocated when the DatagramBatch is created, so
+	/// it can be reused for any number of receive or send operations
+	/// without further allocations.
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY    = 64,
+		DEFAULT_BUFFER_SIZE = 2048
+	};
+
+	explicit DatagramBatch(std::size_t capacity = DEFAULT_CAPACITY, std::size_t bufferSize = DEFAULT_BUFFER_SIZE):
+		_capacity(capacity > 0 ? capacity : 1),
+		_bufferSize(bufferSize > 0 ? bufferSize : 1),
+		_size(0),
+		_buffer(_capacity*_bufferSize),
+		_lengths(_capacity),
+		_addresses(_capacity),
+		_addressLengths(_capacity)
+#if defined(POCO_NET_HAVE_MMSG)
+		, _iov(_capacity),
+		_messages(_capacity)
+#endif
+		/// Creates a DatagramBatch holding up to capacity
+		/// datagrams of up to bufferSize bytes each.
+	{
+		std::memset(&_addresses[0], 0, _capacity*sizeof(struct sockaddr_storage));
+	}
+
+	~DatagramBatch()
+		/// Destroys the DatagramBatch.
+	{
+	}
+
+	std::size_t capacity() const
+		/// Returns the maximum number of datagrams.
+	{
+		return _capacity;
+	}
+
+	std::size_t bufferSize() const
+		/// Returns the maximum size of a datagram.
+	{
+		return _bufferSize;
+	}
+
+	std::size_t size() const
+		/// Returns the number of datagrams in the batch.
+	{
+		return _size;
+	}
+
+	bool empty() const
+		/// Returns true if the batch contains no datagrams.
+	{
+		return _size == 0;
+	}
+
+	bool full() const
+		/// Returns true if no more datagrams can be added.
+	{
+		return _size == _capacity;
+	}
+
+	void clear()
+		/// Removes all datagrams from the batch.
+	{
+		_size = 0;
+	}
+
+	const char* data(std::size_t index) const
+		/// Returns the payload of the datagram with the given index.
+	{
+		poco_assert_dbg (index < _size);
+
+		return _buffer.begin() + index*_bufferSize;
+	}
+
+	std::size_t length(std::size_t index) const
+		/// Returns the payload size of the datagram with the given index.
+	{
+		poco_assert_dbg (index < _size);
+
+		return _lengths[index];
+	}
+
+	SocketAddress address(std::size_t index) const
+		/// Returns the sender (received datagrams) or destination
+		/// (datagrams to send) of the datagram with the given index.
+	{
+		poco_assert_dbg (index < _size);
+
+		return SocketAddress(reinterpret_cast<const struct sockaddr*>(&_addresses[index]), _addressLengths[index]);
+	}
+
+	void add(const void* data, std::size_t length, const SocketAddress& address)
+		/// Adds a datagram to be sent to the given address.
+		/// Throws a RangeException if the batch is full or
+		/// the datagram is larger than the buffer size.
+	{
+		if (_size == _capacity) throw Poco::RangeException("DatagramBatch is full");
+		if (length > _bufferSize) throw Poco::RangeException("Datagram too large for DatagramBatch");
+
+		std::memcpy(_buffer.begin() + _size*_bufferSize, data, length);
+		_lengths[_size] = length;
+		std::memcpy(&_addresses[_size], address.addr(), address.length());
+		_addressLengths[_size] = address.length();
+		++_size;
+	}
+
+private:
+	DatagramBatch(const DatagramBatch&);
+	DatagramBatch& operator = (const DatagramBatch&);
+
+	std::size_t _capacity;
+	std::size_t _bufferSize;
+	std::size_t _size;
+	Poco::Buffer<char> _buffer;
+	std::vector<std::size_t> _lengths;
+	std::vector<struct sockaddr_storage> _addresses;
+	std::vector<poco_socklen_t> _addressLengths;
+#if defined(POCO_NET_HAVE_MMSG)
+	std::vector<struct iovec> _iov;
+	std::vector<struct mmsghdr> _messages;
+#endif
+
+	friend class BatchDatagramSocket;
+};
+
+
+class BatchDatagramSocket: public DatagramSocket
+	/// BatchDatagramSocket is a DatagramSocket that can receive and send
+	/// several datagrams with a single system call, using recvmmsg() and
+	/// sendmmsg() on Linux. On other platforms, the batch operations fall
+	/// back to one receiveFrom() or sendTo() call per datagram.
+	///
+	/// A BatchDatagramSocket can also be created from an existing
+	/// DatagramSocket or MulticastSocket, sharing its socket:
+	///
+	///     MulticastSocket ms(SocketAddress("0.0.0.0", 5000), true);
+	///     ms.joinGroup(group);
+	///     BatchDatagramSocket socket(ms);
+	///     DatagramBatch batch(64, 1500);
+	///     int n = socket.receiveMulti(batch);
+{
+public:
+	BatchDatagramSocket()
+		/// Creates an unconnected, unbound IPv4 datagram socket.
+	{
+	}
+
+	explicit BatchDatagramSocket(IPAddress::Family family):
+		DatagramSocket(family)
+		/// Creates an unconnected, unbound datagram socket
+		/// for the given address family.
+	{
+	}
+
+	BatchDatagramSocket(const SocketAddress& address, bool reuseAddress = false):
+		DatagramSocket(address, reuseAddress)
+		/// Creates a datagram socket and binds it
+		/// to the given address.
+	{
+	}
+
+	BatchDatagramSocket(const Socket& socket):
+		DatagramSocket(socket)
+		/// Creates the BatchDatagramSocket with the SocketImpl
+		/// from another socket, which must be a DatagramSocket
+		/// or MulticastSocket.
+	{
+	}
+
+	~BatchDatagramSocket()
+		/// Destroys the BatchDatagramSocket.
+	{
+	}
+
+	BatchDatagramSocket& operator = (const Socket& socket)
+		/// Assigns a socket, which must be a DatagramSocket
+		/// or MulticastSocket.
+	{
+		DatagramSocket::operator = (socket);
+		return *this;
+	}
+
+	int receiveMulti(DatagramBatch& batch, int flags = 0)
+		/// Receives up to batch.capacity() datagrams into the batch,
+		/// replacing its contents, and returns the number of datagrams
+		/// received. Waits (subject to the receive timeout) for the first
+		/// datagram only, and returns the datagrams available then.
+		///
+		/// Datagrams larger than the batch buffer size are truncated.
+		/// Throws a TimeoutException if a receive timeout is set and
+		/// no datagram arrives within it.
+	{
+		batch.clear();
+#if defined(POCO_NET_HAVE_MMSG)
+		prepare(batch, batch._capacity, true);
+		int rc;
+		do
+		{
+			rc = ::recvmmsg(impl()->sockfd(), &batch._messages[0], static_cast<unsigned>(batch._capacity), flags | MSG_WAITFORONE, 0);
+		}
+		while (rc < 0 && errno == EINTR);
+		if (rc < 0) error(errno);
+		for (int i = 0; i < rc; ++i)
+		{
+			batch._lengths[i] = batch._messages[i].msg_len;
+			batch._addressLengths[i] = batch._messages[i].msg_hdr.msg_namelen;
+		}
+		batch._size = static_cast<std::size_t>(rc);
+#else
+		while (batch._size < batch._capacity)
+		{
+			if (batch._size > 0 && !poll(Poco::Timespan(), Socket::SELECT_READ)) break;
+			SocketAddress sender;
+			int n = receiveFrom(batch._buffer.begin() + batch._size*batch._bufferSize, static_cast<int>(batch._bufferSize), sender, flags);
+			batch._lengths[batch._size] = static_cast<std::size_t>(n);
+			std::memcpy(&batch._addresses[batch._size], sender.addr(), sender.length());
+			batch._addressLengths[batch._size] = sender.length();
+			++batch._size;
+		}
+#endif
+		return static_cast<int>(batch._size);
+	}
+
+	int sendMulti(const DatagramBatch& batch, int flags = 0)
+		/// Sends all datagrams in the batch to their addresses, and
+		/// returns the number of datagrams sent, which may be smaller
+		/// than batch.size() for a non-blocking socket.
+	{
+		if (batch._size == 0) return 0;
+#if defined(POCO_NET_HAVE_MMSG)
+		DatagramBatch& b = const_cast<DatagramBatch&>(batch);
+		prepare(b, b._size, false);
+		std::size_t sent = 0;
+		while (sent < b._size)
+		{
+			int rc = ::sendmmsg(impl()->sockfd(), &b._messages[sent], static_cast<unsigned>(b._size - sent), flags);
+			if (rc < 0)
+			{
+				if (errno == EINTR) continue;
+				if (sent > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+				error(errno);
+			}
+			sent += static_cast<std::size_t>(rc);
+		}
+		return static_cast<int>(sent);
+#else
+		for (std::size_t i = 0; i < batch._size; ++i)
+		{
+			sendTo(batch.data(i), static_cast<int>(batch._lengths[i]), batch.address(i), flags);
+		}
+		return static_cast<int>(batch._size);
+#endif
+	}
+
+protected:
+#if defined(POCO_NET_HAVE_MMSG)
+	static void prepare(DatagramBatch& batch, std::size_t count, bool receive)
+		/// Sets up the message headers for the first count datagrams.
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			batch._iov[i].iov_base = batch._buffer.begin() + i*batch._bufferSize;
+			batch._iov[i].iov_len  = receive ? batch._bufferSize : batch._lengths[i];
+			struct msghdr& hdr = batch._messages[i].msg_hdr;
+			std::memset(&hdr, 0, sizeof(hdr));
+			hdr.msg_name    = &batch._addresses[i];
+			hdr.msg_namelen = receive ? sizeof(struct sockaddr_storage) : batch._addressLengths[i];
+			hdr.msg_iov     = &batch._iov[i];
+			hdr.msg_iovlen  = 1;
+			batch._messages[i].msg_len = 0;
+		}
+	}
+
+	static void error(int code)
+	{
+		if (code == EAGAIN || code == EWOULDBLOCK)
+			throw Poco::TimeoutException();
+		else
+			throw NetException("Batch datagram operation failed", code);
+	}
+#endif
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_BatchDatagramSocket_INCLUDED
@@ -0,0 +1,209 @@
+//
+// BatchRemoteSyslogListener.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Logging
+// Module:  BatchRemoteSyslogListener
+//
+// Definition of the BatchRemoteSyslogListener class.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_BatchRemoteSyslogListener_INCLUDED
+#define Net_BatchRemoteSyslogListener_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/RemoteSyslogListener.h"
+#include "Poco/Net/BatchDatagramSocket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/IPAddress.h"
+#include "Poco/LoggingFactory.h"
+#include "Poco/Instantiator.h"
+#include "Poco/RunnableAdapter.h"
+#include "Poco/Thread.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/NumberParser.h"
+#include "Poco/NumberFormatter.h"
+
+
+namespace Poco {
+namespace Net {
+
+
+class BatchRemoteSyslogListener: public RemoteSyslogListener
+	/// BatchRemoteSyslogListener is a RemoteSyslogListener that receives
+	/// syslog messages with a BatchDatagramSocket, i.e. up to a batch size
+	/// of datagrams per system call (using recvmmsg() on Linux), instead of
+	/// one datagram per call.
+	///
+	/// Received messages are parsed and dispatched by the parser threads
+	/// of RemoteSyslogListener, as usual. The RemoteSyslogListener itself
+	/// is configured not to listen for UDP messages (port 0).
+	///
+	/// In addition to the properties supported by RemoteSyslogListener,
+	/// BatchRemoteSyslogListener supports:
+	///     * batch: The maximum number of datagrams received with
+	///       one system call. Defaults to 64.
+	///     * bufferSize: The maximum size of a datagram; longer
+	///       datagrams are truncated. Defaults to 8192.
+	///
+	/// The properties must be set before the listener is opened.
+{
+public:
+	enum
+	{
+		DEFAULT_BATCH_SIZE  = 64,
+		DEFAULT_BUFFER_SIZE = 8192,
+		POLL_INTERVAL       = 250
+	};
+
+	BatchRemoteSyslogListener():
+		RemoteSyslogListener(0),
+		_port(514),
+		_batchSize(DEFAULT_BATCH_SIZE),
+		_bufferSize(DEFAULT_BUFFER_SIZE),
+		_runnable(*this, &BatchRemoteSyslogListener::run),
+		_stop(false)
+		/// Creates the BatchRemoteSyslogListener.
+	{
+	}
+
+	explicit BatchRemoteSyslogListener(Poco::UInt16 port, int threads = 1):
+		RemoteSyslogListener(0, threads),
+		_port(port),
+		_batchSize(DEFAULT_BATCH_SIZE),
+		_bufferSize(DEFAULT_BUFFER_SIZE),
+		_runnable(*this, &BatchRemoteSyslogListener::run),
+		_stop(false)
+		/// Creates the BatchRemoteSyslogListener, listening on the given port
+		/// number and using the number of threads for message processing.
+	{
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+	{
+		if (name == PROP_PORT)
+			_port = static_cast<Poco::UInt16>(Poco::NumberParser::parseUnsigned(value));
+		else if (name == "batch")
+			_batchSize = Poco::NumberParser::parseUnsigned(value);
+		else if (name == "bufferSize")
+			_bufferSize = Poco::NumberParser::parseUnsigned(value);
+		else
+			RemoteSyslogListener::setProperty(name, value);
+	}
+
+	std::string getProperty(const std::string& name) const
+	{
+		if (name == PROP_PORT)
+			return Poco::NumberFormatter::format(_port);
+		else if (name == "batch")
+			return Poco::NumberFormatter::format(_batchSize);
+		else if (name == "bufferSize")
+			return Poco::NumberFormatter::format(_bufferSize);
+		else
+			return RemoteSyslogListener::getProperty(name);
+	}
+
+	void open()
+		/// Starts the parser threads and the receiver thread.
+	{
+		RemoteSyslogListener::open();
+		if (_port > 0 && !_thread.isRunning())
+		{
+			_socket = BatchDatagramSocket(SocketAddress(IPAddress(), _port));
+			_stop = false;
+			_thread.start(_runnable);
+		}
+	}
+
+	void close()
+		/// Stops the receiver thread and the parser threads.
+	{
+		stopReceiver();
+		RemoteSyslogListener::close();
+	}
+
+	static void registerChannel()
+		/// Registers the channel with the global LoggingFactory.
+	{
+		Poco::LoggingFactory::defaultFactory().registerChannelClass("BatchRemoteSyslogListener", new Poco::Instantiator<BatchRemoteSyslogListener, Poco::Channel>);
+	}
+
+protected:
+	~BatchRemoteSyslogListener()
+		/// Destroys the BatchRemoteSyslogListener.
+	{
+		try
+		{
+			stopReceiver();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void run()
+	{
+		DatagramBatch batch(_batchSize, _bufferSize);
+		Poco::Timespan interval(0, POLL_INTERVAL*1000);
+		while (!_stop)
+		{
+			try
+			{
+				if (_socket.poll(interval, Socket::SELECT_READ))
+				{
+					int n = _socket.receiveMulti(batch);
+					for (int i = 0; i < n; ++i)
+					{
+						if (batch.length(i) > 0)
+						{
+							enqueueMessage(std::string(batch.data(i), batch.length(i)), batch.address(i));
+						}
+					}
+				}
+			}
+			catch (Poco::Exception& exc)
+			{
+				Poco::ErrorHandler::handle(exc);
+			}
+			catch (...)
+			{
+				Poco::ErrorHandler::handle();
+			}
+		}
+	}
+
+	void stopReceiver()
+	{
+		if (_thread.isRunning())
+		{
+			_stop = true;
+			_thread.join();
+			_socket.close();
+		}
+	}
+
+private:
+	Poco::UInt16 _port;
+	std::size_t _batchSize;
+	std::size_t _bufferSize;
+	BatchDatagramSocket _socket;
+	Poco::RunnableAdapter<BatchRemoteSyslogListener> _runnable;
+	Poco::Thread _thread;
+	volatile bool _stop;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_BatchRemoteSyslogListener_INCLUDED
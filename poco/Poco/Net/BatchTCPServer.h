@@ -0,0 +1,558 @@
+//
+// BatchTCPServer.h
+//
+// $Id$
+//
+// Library: Net
+// Package: TCPServer
+// Module:  BatchTCPServer
+//
+// Definition of the BatchTCPServerParams and BatchTCPServer classes.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_BatchTCPServer_INCLUDED
+#define Net_BatchTCPServer_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/StreamSocketImpl.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/Net/TCPServerParams.h"
+#include "Poco/Net/TCPServerConnection.h"
+#include "Poco/Net/TCPServerConnectionFactory.h"
+#include "Poco/RingNotificationQueue.h"
+#include "Poco/WorkStealingThreadPool.h"
+#include "Poco/ThreadPoolMetrics.h"
+#include "Poco/Notification.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/Error.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include <vector>
+#if POCO_OS == POCO_OS_LINUX
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+class BatchTCPServerParams: public TCPServerParams
+	/// Parameters for a BatchTCPServer.
+	///
+	/// In addition to the TCPServerParams, the dispatch mode, the
+	/// number of connections accepted per wakeup and the behavior
+	/// when the connection queue is full can be set.
+	///
+	/// The maximum number of queued connections (setMaxQueued()) is the
+	/// capacity of the connection queue. The maximum number of threads
+	/// (setMaxThreads()) is the fixed number of worker threads, or 16
+	/// if not set. The thread idle time is not used.
+{
+public:
+	typedef Poco::AutoPtr<BatchTCPServerParams> Ptr;
+
+	enum DispatchMode
+	{
+		DISPATCH_RING_QUEUE,
+			/// Connections are queued in a lock-free RingNotificationQueue
+			/// and handled by dedicated worker threads (default).
+		DISPATCH_WORK_STEALING
+			/// Connections are handled by a WorkStealingThreadPool.
+	};
+
+	enum
+	{
+		DEFAULT_ACCEPT_BATCH = 32
+	};
+
+	BatchTCPServerParams():
+		_dispatchMode(DISPATCH_RING_QUEUE),
+		_acceptBatch(DEFAULT_ACCEPT_BATCH),
+		_blockWhenFull(true)
+		/// Creates the BatchTCPServerParams.
+	{
+	}
+
+	void setDispatchMode(DispatchMode mode)
+		/// Sets the dispatch mode.
+	{
+		_dispatchMode = mode;
+	}
+
+	DispatchMode getDispatchMode() const
+		/// Returns the dispatch mode.
+	{
+		return _dispatchMode;
+	}
+
+	void setAcceptBatch(int count)
+		/// Sets the maximum number of connections
+		/// accepted per wakeup of the accepting thread.
+	{
+		poco_assert (count > 0);
+
+		_acceptBatch = count;
+	}
+
+	int getAcceptBatch() const
+		/// Returns the maximum number of connections
+		/// accepted per wakeup of the accepting thread.
+	{
+		return _acceptBatch;
+	}
+
+	void setBlockWhenFull(bool flag)
+		/// Specifies what happens to a new connection while the
+		/// connection queue is full. If true (default), the
+		/// server stops accepting connections until there is room,
+		/// leaving new connections in the listen backlog. If false,
+		/// the connection is refused (closed).
+	{
+		_blockWhenFull = flag;
+	}
+
+	bool getBlockWhenFull() const
+		/// Returns true if the server stops accepting
+		/// connections while the queue is full.
+	{
+		return _blockWhenFull;
+	}
+
+protected:
+	~BatchTCPServerParams()
+	{
+	}
+
+private:
+	DispatchMode _dispatchMode;
+	int _acceptBatch;
+	bool _blockWhenFull;
+};
+
+
+class BatchTCPServer: public Poco::Runnable
+	/// BatchTCPServer is a multithreaded TCP server, equivalent to
+	/// TCPServer in its use of TCPServerConnectionFactory and
+	/// TCPServerConnection objects, designed to absorb bursts of
+	/// connections.
+	///
+	/// Whenever the listening socket becomes readable, the
+	/// accepting thread accepts up to BatchTCPServerParams::getAcceptBatch()
+	/// connections, using accept4() on a non-blocking listening socket
+	/// on Linux. The connections are passed to a fixed number of worker
+	/// threads through a lock-free RingNotificationQueue, or to a
+	/// WorkStealingThreadPool, depending on the dispatch mode. No thread
+	/// is started per connection.
+	///
+	/// By default, the server stops accepting connections while the
+	/// queue is full, so that a burst of connections waits in the
+	/// listen backlog instead of being refused.
+	///
+	/// The time each connection has waited in the queue is recorded in a
+	/// histogram, available from queueWaitTimes().
+{
+public:
+	BatchTCPServer(TCPServerConnectionFactory::Ptr pFactory, const ServerSocket& socket, BatchTCPServerParams::Ptr pParams = 0):
+		_pFactory(pFactory),
+		_socket(socket),
+		_pParams(pParams),
+		_worker(*this),
+		_stopped(true),
+		_stopWorkers(true),
+		_maxConcurrent(0)
+		/// Creates the BatchTCPServer, using the given ServerSocket.
+		///
+		/// The server takes ownership of the TCPServerConnectionFactory
+		/// and the BatchTCPServerParams. If no parameters are given,
+		/// default parameters are used.
+	{
+		if (!_pParams) _pParams = new BatchTCPServerParams;
+		if (_pParams->getMaxThreads() <= 0) _pParams->setMaxThreads(DEFAULT_THREADS);
+		if (_pParams->getDispatchMode() == BatchTCPServerParams::DISPATCH_WORK_STEALING)
+			_pPool = new Poco::WorkStealingThreadPool(_pParams->getMaxThreads(), static_cast<std::size_t>(_pParams->getMaxQueued()), "tcpserver");
+		else
+			_pQueue = new Poco::RingNotificationQueue(static_cast<std::size_t>(_pParams->getMaxQueued()));
+	}
+
+	~BatchTCPServer()
+		/// Stops and destroys the BatchTCPServer.
+	{
+		try
+		{
+			stop();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	const BatchTCPServerParams& params() const
+		/// Returns a const reference to the BatchTCPServerParam object
+		/// used by the server's connection dispatcher.
+	{
+		return *_pParams;
+	}
+
+	void start()
+		/// Starts the server. A new thread will be
+		/// created that waits for and accepts incoming
+		/// connections.
+	{
+		poco_assert (_stopped);
+
+		_stopped = false;
+		_stopWorkers = false;
+#if POCO_OS == POCO_OS_LINUX
+		_socket.setBlocking(false);
+#endif
+		if (_pQueue)
+		{
+			for (int i = 0; i < _pParams->getMaxThreads(); ++i)
+			{
+				Poco::Thread* pThread = new Poco::Thread("TCPServerWorker");
+				pThread->setPriority(_pParams->getThreadPriority());
+				_workers.push_back(pThread);
+				pThread->start(_worker);
+			}
+		}
+		_thread.start(*this);
+	}
+
+	void stop()
+		/// Stops the server.
+		///
+		/// No new connections will be accepted. In ring queue mode,
+		/// connections still waiting in the queue are closed. In work
+		/// stealing mode, they are handled before the pool is destroyed.
+		/// Already handled connections continue to be served.
+	{
+		if (_stopped) return;
+		_stopped = true;
+		// Workers keep draining the queue until the accepting
+		// thread, which may wait for room in the queue, has stopped.
+		_thread.join();
+		_stopWorkers = true;
+		if (_pQueue)
+		{
+			_pQueue->wakeUpAll();
+			for (std::vector<Poco::Thread*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+			{
+				(*it)->join();
+				delete *it;
+			}
+			_workers.clear();
+			_pQueue->clear();
+			_queued = 0;
+		}
+	}
+
+	int currentThreads() const
+		/// Returns the number of threads handling connections.
+	{
+		return _current.value();
+	}
+
+	int maxThreads() const
+		/// Returns the number of worker threads.
+	{
+		return _pParams->getMaxThreads();
+	}
+
+	int totalConnections() const
+		/// Returns the total number of handled connections.
+	{
+		return _total.value();
+	}
+
+	int currentConnections() const
+		/// Returns the number of currently handled connections.
+	{
+		return _current.value();
+	}
+
+	int maxConcurrentConnections() const
+		/// Returns the maximum number of concurrently handled connections.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _maxConcurrent;
+	}
+
+	int queuedConnections() const
+		/// Returns the number of queued connections.
+	{
+		return _queued.value();
+	}
+
+	int refusedConnections() const
+		/// Returns the number of refused connections.
+	{
+		return _refused.value();
+	}
+
+	Poco::TimeHistogram queueWaitTimes() const
+		/// Returns a copy of the histogram of the times connections
+		/// have waited in the queue before being handled.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _waitTimes;
+	}
+
+	const ServerSocket& socket() const
+		/// Returns the underlying server socket.
+	{
+		return _socket;
+	}
+
+	Poco::UInt16 port() const
+		/// Returns the port the server socket listens on.
+	{
+		return _socket.address().port();
+	}
+
+protected:
+	enum
+	{
+		DEFAULT_THREADS = 16,
+		POLL_TIMEOUT = 250000
+	};
+
+	class ConnectionNotification: public Poco::Notification
+	{
+	public:
+		ConnectionNotification(const StreamSocket& socket):
+			_socket(socket)
+		{
+		}
+
+		const StreamSocket& socket() const
+		{
+			return _socket;
+		}
+
+		const Poco::Clock& accepted() const
+		{
+			return _accepted;
+		}
+
+	private:
+		StreamSocket _socket;
+		Poco::Clock _accepted;
+	};
+
+	class ConnectionTask: public Poco::Runnable
+		/// Runs a connection on the WorkStealingThreadPool.
+	{
+	public:
+		ConnectionTask(BatchTCPServer& server, ConnectionNotification* pNf):
+			_server(server),
+			_pNf(pNf)
+		{
+		}
+
+		void run()
+		{
+			_server.handle(*_pNf);
+			delete this;
+		}
+
+	private:
+		BatchTCPServer& _server;
+		Poco::AutoPtr<ConnectionNotification> _pNf;
+	};
+
+	class Worker: public Poco::Runnable
+		/// Takes connections from the RingNotificationQueue.
+	{
+	public:
+		Worker(BatchTCPServer& server):
+			_server(server)
+		{
+		}
+
+		void run()
+		{
+			while (!_server._stopWorkers)
+			{
+				// A worker busy with a connection when the server is stopped
+				// misses wakeUpAll(), so waiting is limited.
+				Poco::AutoPtr<Poco::Notification> pNf(_server._pQueue->waitDequeueNotification(POLL_TIMEOUT/1000));
+				if (!pNf) continue;
+				ConnectionNotification* pConnNf = dynamic_cast<ConnectionNotification*>(pNf.get());
+				if (pConnNf) _server.handle(*pConnNf);
+			}
+		}
+
+	private:
+		BatchTCPServer& _server;
+	};
+
+	void run()
+	{
+		Poco::Timespan timeout(POLL_TIMEOUT);
+		while (!_stopped)
+		{
+			try
+			{
+				if (!_socket.poll(timeout, Socket::SELECT_READ)) continue;
+				for (int i = 0; i < _pParams->getAcceptBatch() && !_stopped; ++i)
+				{
+					StreamSocket ss;
+					if (!accept(ss)) break;
+					// enable nodelay per default: OSX really needs that
+					ss.setNoDelay(true);
+					enqueue(ss);
+				}
+			}
+			catch (Poco::Exception& exc)
+			{
+				Poco::ErrorHandler::handle(exc);
+			}
+			catch (std::exception& exc)
+			{
+				Poco::ErrorHandler::handle(exc);
+			}
+			catch (...)
+			{
+				Poco::ErrorHandler::handle();
+			}
+		}
+	}
+
+	bool accept(StreamSocket& socket)
+		/// Accepts the next connection, if there is one.
+	{
+#if POCO_OS == POCO_OS_LINUX
+		for (;;)
+		{
+			int fd = ::accept4(_socket.impl()->sockfd(), 0, 0, SOCK_CLOEXEC);
+			if (fd >= 0)
+			{
+				socket = StreamSocket(new StreamSocketImpl(fd));
+				return true;
+			}
+			int err = Poco::Error::last();
+			if (err == EINTR) continue;
+			if (err == EAGAIN || err == EWOULDBLOCK || err == ECONNABORTED) return false;
+			throw Poco::Net::NetException("accept4 failed", Poco::Error::getMessage(err));
+		}
+#else
+		if (!_socket.poll(Poco::Timespan(0), Socket::SELECT_READ)) return false;
+		socket = _socket.acceptConnection();
+		return true;
+#endif
+	}
+
+	void enqueue(const StreamSocket& socket)
+	{
+		Poco::AutoPtr<ConnectionNotification> pNf = new ConnectionNotification(socket);
+		bool block = _pParams->getBlockWhenFull();
+		bool queued;
+		++_queued;
+		if (_pPool)
+		{
+			ConnectionTask* pTask = new ConnectionTask(*this, pNf.duplicate());
+			queued = true;
+			if (block)
+				_pPool->start(*pTask);
+			else if (!_pPool->tryStart(*pTask))
+			{
+				delete pTask;
+				queued = false;
+			}
+		}
+		else if (block)
+		{
+			_pQueue->enqueueNotification(pNf);
+			queued = true;
+		}
+		else queued = _pQueue->tryEnqueueNotification(pNf);
+
+		if (!queued)
+		{
+			--_queued;
+			++_refused;
+		}
+	}
+
+	void handle(const ConnectionNotification& nf)
+	{
+		--_queued;
+		int current = ++_current;
+		++_total;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_waitTimes.record(nf.accepted().elapsed());
+			if (current > _maxConcurrent) _maxConcurrent = current;
+		}
+		try
+		{
+			Poco::SharedPtr<TCPServerConnection> pConnection(_pFactory->createConnection(nf.socket()));
+			poco_check_ptr (pConnection.get());
+			// TCPServerConnection::start() is only accessible to
+			// TCPServerDispatcher; it calls run() in the same way.
+			static_cast<Poco::Runnable&>(*pConnection).run();
+		}
+		catch (Poco::Exception& exc)
+		{
+			Poco::ErrorHandler::handle(exc);
+		}
+		catch (std::exception& exc)
+		{
+			Poco::ErrorHandler::handle(exc);
+		}
+		catch (...)
+		{
+			Poco::ErrorHandler::handle();
+		}
+		--_current;
+	}
+
+private:
+	BatchTCPServer();
+	BatchTCPServer(const BatchTCPServer&);
+	BatchTCPServer& operator = (const BatchTCPServer&);
+
+	TCPServerConnectionFactory::Ptr _pFactory;
+	ServerSocket _socket;
+	BatchTCPServerParams::Ptr _pParams;
+	Poco::SharedPtr<Poco::RingNotificationQueue> _pQueue;
+	Poco::SharedPtr<Poco::WorkStealingThreadPool> _pPool;
+	Worker _worker;
+	std::vector<Poco::Thread*> _workers;
+	Poco::Thread _thread;
+	volatile bool _stopped;
+	volatile bool _stopWorkers;
+	Poco::AtomicCounter _queued;
+	Poco::AtomicCounter _refused;
+	Poco::AtomicCounter _current;
+	Poco::AtomicCounter _total;
+	int _maxConcurrent;
+	Poco::TimeHistogram _waitTimes;
+	mutable Poco::FastMutex _mutex;
+
+	friend class Worker;
+	friend class ConnectionTask;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_BatchTCPServer_INCLUDED
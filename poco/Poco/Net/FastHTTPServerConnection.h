@@ -0,0 +1,994 @@
+//
+// FastHTTPServerConnection.h
+//
+// $Id$
+//
+// Library: Net
+// Package: HTTPServer
+// Module:  FastHTTPServerConnection
+//
+// Definition of the HTTPRequestScanner, FastHTTPServerSession,
+// FastHTTPServerRequest, FastHTTPServerResponse, FastHTTPServerConnection
+// and FastHTTPServerConnectionFactory classes.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_FastHTTPServerConnection_INCLUDED
+#define Net_FastHTTPServerConnection_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/TCPServerConnection.h"
+#include "Poco/Net/TCPServerConnectionFactory.h"
+#include "Poco/Net/HTTPServerSession.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPHeaderStream.h"
+#include "Poco/Net/HTTPFixedLengthStream.h"
+#include "Poco/Net/HTTPChunkedStream.h"
+#include "Poco/Net/HTTPStream.h"
+#include "Poco/Net/HTTPFileSender.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/Ascii.h"
+#include "Poco/BufferedStreamBuf.h"
+#include "Poco/CountingStream.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Timestamp.h"
+#include "Poco/File.h"
+#include "Poco/Buffer.h"
+#include "Poco/SharedPtr.h"
+#include <istream>
+#include <ostream>
+#include <cstring>
+
+
+namespace Poco {
+namespace Net {
+
+
+class HTTPRequestScanner
+	/// HTTPRequestScanner parses the request line and header of an
+	/// HTTP request in a memory buffer, without copying or allocating
+	/// memory. Method, URI, version and header fields are returned as
+	/// pointers into the buffer.
+	///
+	/// The header fields most relevant to request handling (Host,
+	/// Content-Length, Transfer-Encoding, Connection and Expect)
+	/// are identified while scanning, so that they can be accessed
+	/// without a search.
+	///
+	/// The same limits as for MessageHeader and HTTPRequest apply.
+{
+public:
+	struct Field
+	{
+		const char* name;
+		std::size_t nameLength;
+		const char* value;
+		std::size_t valueLength;
+		bool folded;
+			/// True if the value continues on further lines,
+			/// which are included in value.
+	};
+
+	enum Result
+	{
+		SCAN_INCOMPLETE,
+			/// The buffer does not contain a complete header yet.
+		SCAN_COMPLETE,
+			/// The request line and header have been parsed.
+		SCAN_ERROR
+			/// The request is malformed or exceeds a limit.
+	};
+
+	enum KnownField
+	{
+		FIELD_HOST,
+		FIELD_CONTENT_LENGTH,
+		FIELD_TRANSFER_ENCODING,
+		FIELD_CONNECTION,
+		FIELD_EXPECT,
+		FIELD_COUNT
+	};
+
+	enum
+	{
+		MAX_FIELDS         = 100,
+		MAX_NAME_LENGTH    = 256,
+		MAX_VALUE_LENGTH   = 8192,
+		MAX_METHOD_LENGTH  = 32,
+		MAX_URI_LENGTH     = 16384,
+		MAX_VERSION_LENGTH = 8,
+		MAX_HEADER_SIZE    = 65536
+	};
+
+	HTTPRequestScanner()
+	{
+		reset();
+	}
+
+	void reset()
+		/// Clears the results of the last scan.
+	{
+		method = uri = version = 0;
+		methodLength = uriLength = versionLength = 0;
+		fieldCount = 0;
+		for (int i = 0; i < FIELD_COUNT; ++i) known[i] = -1;
+	}
+
+	Result scan(const char* begin, const char* end, std::size_t& consumed)
+		/// Scans the buffer [begin, end). If the result is SCAN_COMPLETE,
+		/// consumed is set to the size of the request line and header.
+	{
+		reset();
+		const char* p = begin;
+		// Empty lines before the request line are ignored (RFC 7230, 3.5).
+		while (p < end && (*p == '\r' || *p == '\n')) ++p;
+		const char* eol = findLine(p, end);
+		if (!eol) return static_cast<std::size_t>(end - begin) > MAX_HEADER_SIZE ? SCAN_ERROR : SCAN_INCOMPLETE;
+		if (!scanRequestLine(p, trimCR(p, eol))) return SCAN_ERROR;
+		p = eol + 1;
+
+		Field* pField = 0;
+		for (;;)
+		{
+			eol = findLine(p, end);
+			if (!eol) return static_cast<std::size_t>(end - begin) > MAX_HEADER_SIZE ? SCAN_ERROR : SCAN_INCOMPLETE;
+			const char* lineEnd = trimCR(p, eol);
+			if (lineEnd == p)
+			{
+				consumed = static_cast<std::size_t>(eol + 1 - begin);
+				return SCAN_COMPLETE;
+			}
+			if (*p == ' ' || *p == '\t')
+			{
+				if (!pField) return SCAN_ERROR;
+				pField->valueLength = static_cast<std::size_t>(trimRight(pField->value, lineEnd) - pField->value);
+				pField->folded = true;
+			}
+			else
+			{
+				if (fieldCount == MAX_FIELDS) return SCAN_ERROR;
+				const char* colon = static_cast<const char*>(std::memchr(p, ':', static_cast<std::size_t>(lineEnd - p)));
+				if (!colon || colon == p) return SCAN_ERROR;
+				pField = &fields[fieldCount];
+				pField->name = p;
+				pField->nameLength = static_cast<std::size_t>(trimRight(p, colon) - p);
+				const char* v = colon + 1;
+				while (v < lineEnd && (*v == ' ' || *v == '\t')) ++v;
+				pField->value = v;
+				pField->valueLength = static_cast<std::size_t>(trimRight(v, lineEnd) - v);
+				pField->folded = false;
+				if (pField->nameLength > MAX_NAME_LENGTH) return SCAN_ERROR;
+				classify(fieldCount);
+				++fieldCount;
+			}
+			if (pField->valueLength > MAX_VALUE_LENGTH) return SCAN_ERROR;
+			p = eol + 1;
+		}
+	}
+
+	const Field* field(KnownField which) const
+		/// Returns the given known field, or null if
+		/// the request does not contain it.
+	{
+		return known[which] < 0 ? 0 : &fields[known[which]];
+	}
+
+	static bool equals(const char* s, std::size_t length, const char* literal)
+		/// Compares s case-insensitively with the given
+		/// lowercase literal.
+	{
+		std::size_t i = 0;
+		for (; i < length && literal[i]; ++i)
+		{
+			char c = s[i];
+			if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+			if (c != literal[i]) return false;
+		}
+		return i == length && literal[i] == 0;
+	}
+
+	static bool contains(const char* s, std::size_t length, const char* token)
+		/// Returns true if s contains the given lowercase
+		/// token, compared case-insensitively.
+	{
+		std::size_t n = std::strlen(token);
+		for (std::size_t i = 0; i + n <= length; ++i)
+		{
+			if (equals(s + i, n, token)) return true;
+		}
+		return false;
+	}
+
+	const char* method;
+	std::size_t methodLength;
+	const char* uri;
+	std::size_t uriLength;
+	const char* version;
+	std::size_t versionLength;
+	Field fields[MAX_FIELDS];
+	int fieldCount;
+	int known[FIELD_COUNT];
+
+protected:
+	static const char* findLine(const char* p, const char* end)
+	{
+		return static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+	}
+
+	static const char* trimCR(const char* begin, const char* eol)
+	{
+		return (eol > begin && eol[-1] == '\r') ? eol - 1 : eol;
+	}
+
+	static const char* trimRight(const char* begin, const char* end)
+	{
+		while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) --end;
+		return end;
+	}
+
+	bool scanRequestLine(const char* p, const char* end)
+	{
+		const char* sp1 = static_cast<const char*>(std::memchr(p, ' ', static_cast<std::size_t>(end - p)));
+		if (!sp1) return false;
+		method = p;
+		methodLength = static_cast<std::size_t>(sp1 - p);
+		const char* u = sp1 + 1;
+		while (u < end && *u == ' ') ++u;
+		const char* sp2 = static_cast<const char*>(std::memchr(u, ' ', static_cast<std::size_t>(end - u)));
+		if (!sp2) return false;
+		uri = u;
+		uriLength = static_cast<std::size_t>(sp2 - u);
+		const char* v = sp2 + 1;
+		while (v < end && *v == ' ') ++v;
+		version = v;
+		versionLength = static_cast<std::size_t>(trimRight(v, end) - v);
+		return methodLength > 0 && methodLength <= MAX_METHOD_LENGTH
+			&& uriLength > 0 && uriLength <= MAX_URI_LENGTH
+			&& versionLength > 0 && versionLength <= MAX_VERSION_LENGTH;
+	}
+
+	void classify(int index)
+	{
+		const Field& f = fields[index];
+		switch (f.nameLength)
+		{
+		case 4:
+			if (equals(f.name, f.nameLength, "host")) known[FIELD_HOST] = index;
+			break;
+		case 6:
+			if (equals(f.name, f.nameLength, "expect")) known[FIELD_EXPECT] = index;
+			break;
+		case 10:
+			if (equals(f.name, f.nameLength, "connection")) known[FIELD_CONNECTION] = index;
+			break;
+		case 14:
+			if (equals(f.name, f.nameLength, "content-length")) known[FIELD_CONTENT_LENGTH] = index;
+			break;
+		case 17:
+			if (equals(f.name, f.nameLength, "transfer-encoding")) known[FIELD_TRANSFER_ENCODING] = index;
+			break;
+		default:
+			break;
+		}
+	}
+};
+
+
+class FastHTTPServerSession: public HTTPServerSession
+	/// FastHTTPServerSession is the HTTPServerSession used by
+	/// FastHTTPServerConnection. It keeps the data received from the
+	/// client in its own buffer, so that request headers can be parsed
+	/// in place by HTTPRequestScanner, and data following a request,
+	/// e.g. the next pipelined request, remains available for the
+	/// next request.
+{
+public:
+	enum
+	{
+		DEFAULT_BUFFER_SIZE = 8192
+	};
+
+	FastHTTPServerSession(const StreamSocket& socket, HTTPServerParams::Ptr pParams, std::size_t bufferSize = DEFAULT_BUFFER_SIZE):
+		HTTPServerSession(socket, pParams),
+		_buffer(bufferSize),
+		_begin(0),
+		_end(0),
+		_firstRequest(true),
+		_keepAliveTimeout(pParams->getKeepAliveTimeout()),
+		_maxKeepAliveRequests(pParams->getMaxKeepAliveRequests())
+	{
+	}
+
+	~FastHTTPServerSession()
+	{
+	}
+
+	bool hasMoreRequests()
+		/// Returns true if there are data for another request,
+		/// either already received, or arriving within the
+		/// timeout (or keep-alive timeout).
+	{
+		if (!socket().impl()->initialized()) return false;
+		if (_firstRequest)
+		{
+			_firstRequest = false;
+			--_maxKeepAliveRequests;
+			return pending() > 0 || socket().poll(getTimeout(), Socket::SELECT_READ);
+		}
+		else if (_maxKeepAliveRequests != 0 && getKeepAlive())
+		{
+			if (_maxKeepAliveRequests > 0) --_maxKeepAliveRequests;
+			return pending() > 0 || socket().poll(_keepAliveTimeout, Socket::SELECT_READ);
+		}
+		else return false;
+	}
+
+	bool canKeepAlive() const
+		/// Returns true if the session can be kept alive.
+	{
+		return _maxKeepAliveRequests != 0;
+	}
+
+	const char* begin() const
+		/// Returns the beginning of the received data.
+	{
+		return _buffer.begin() + _begin;
+	}
+
+	const char* end() const
+		/// Returns the end of the received data.
+	{
+		return _buffer.begin() + _end;
+	}
+
+	std::size_t pending() const
+		/// Returns the number of received bytes not consumed yet.
+	{
+		return _end - _begin;
+	}
+
+	void consume(std::size_t n)
+		/// Marks n bytes of the received data as consumed.
+	{
+		poco_assert (n <= pending());
+
+		_begin += n;
+		if (_begin == _end) _begin = _end = 0;
+	}
+
+	bool fill()
+		/// Receives more data from the client. Returns false if the
+		/// client has closed the connection, or the buffer is full.
+	{
+		if (_begin > 0)
+		{
+			std::memmove(_buffer.begin(), _buffer.begin() + _begin, _end - _begin);
+			_end -= _begin;
+			_begin = 0;
+		}
+		if (_end == _buffer.size())
+		{
+			if (_buffer.size() >= HTTPRequestScanner::MAX_HEADER_SIZE) return false;
+			_buffer.resize(_buffer.size()*2);
+		}
+		int n = receive(_buffer.begin() + _end, static_cast<int>(_buffer.size() - _end));
+		if (n <= 0) return false;
+		_end += static_cast<std::size_t>(n);
+		return true;
+	}
+
+	int getByte()
+		/// Returns the next byte, or -1 at the end of the connection.
+	{
+		if (pending() == 0 && !fill()) return -1;
+		int c = static_cast<unsigned char>(_buffer[_begin]);
+		consume(1);
+		return c;
+	}
+
+	int read(char* buffer, std::streamsize length)
+		/// Reads up to length bytes, taking received
+		/// data from the buffer first.
+	{
+		if (pending() > 0)
+		{
+			std::size_t n = pending() < static_cast<std::size_t>(length) ? pending() : static_cast<std::size_t>(length);
+			std::memcpy(buffer, begin(), n);
+			consume(n);
+			return static_cast<int>(n);
+		}
+		return receive(buffer, static_cast<int>(length));
+	}
+
+	int write(const char* buffer, std::streamsize length)
+		/// Sends the given data to the client.
+	{
+		return HTTPSession::write(buffer, length);
+	}
+
+private:
+	Poco::Buffer<char> _buffer;
+	std::size_t _begin;
+	std::size_t _end;
+	bool _firstRequest;
+	Poco::Timespan _keepAliveTimeout;
+	int _maxKeepAliveRequests;
+};
+
+
+class FastHTTPChunkedStreamBuf: public Poco::BufferedStreamBuf
+	/// Decodes a chunked request body received
+	/// by a FastHTTPServerSession.
+{
+public:
+	explicit FastHTTPChunkedStreamBuf(FastHTTPServerSession& session):
+		Poco::BufferedStreamBuf(BUFFER_SIZE, std::ios::in),
+		_session(session),
+		_chunk(0),
+		_eof(false)
+	{
+	}
+
+protected:
+	enum
+	{
+		BUFFER_SIZE = 4096
+	};
+
+	int readFromDevice(char* buffer, std::streamsize length)
+	{
+		if (_eof) return 0;
+		if (_chunk == 0)
+		{
+			int c = _session.getByte();
+			while (c == '\r' || c == '\n') c = _session.getByte();
+			std::string size;
+			while (c >= 0 && Poco::Ascii::isHexDigit(c) && size.size() < 16)
+			{
+				size += static_cast<char>(c);
+				c = _session.getByte();
+			}
+			while (c >= 0 && c != '\n') c = _session.getByte();
+			unsigned chunk;
+			if (size.empty() || !Poco::NumberParser::tryParseHex(size, chunk)) throw MessageException("Invalid chunk size");
+			_chunk = chunk;
+			if (_chunk == 0)
+			{
+				// skip the trailer
+				for (;;)
+				{
+					c = _session.getByte();
+					if (c == '\r') c = _session.getByte();
+					if (c == '\n' || c < 0) break;
+					while (c >= 0 && c != '\n') c = _session.getByte();
+				}
+				_eof = true;
+				return 0;
+			}
+		}
+		if (static_cast<std::streamsize>(_chunk) < length) length = static_cast<std::streamsize>(_chunk);
+		int n = _session.read(buffer, length);
+		if (n <= 0) throw MessageException("Unexpected end of chunked request body");
+		_chunk -= static_cast<std::size_t>(n);
+		return n;
+	}
+
+private:
+	FastHTTPServerSession& _session;
+	std::size_t _chunk;
+	bool _eof;
+};
+
+
+class FastHTTPChunkedInputStream: public std::istream
+	/// An input stream for a chunked request
+	/// body received by a FastHTTPServerSession.
+{
+public:
+	explicit FastHTTPChunkedInputStream(FastHTTPServerSession& session):
+		std::istream(&_buf),
+		_buf(session)
+	{
+	}
+
+private:
+	FastHTTPChunkedStreamBuf _buf;
+};
+
+
+class FastHTTPServerResponse;
+
+
+class FastHTTPServerRequest: public HTTPServerRequest
+	/// The HTTPServerRequest used by FastHTTPServerConnection.
+	/// The object is reused for all requests on a connection.
+{
+public:
+	FastHTTPServerRequest(FastHTTPServerResponse& response, FastHTTPServerSession& session, HTTPServerParams::Ptr pParams):
+		_response(response),
+		_session(session),
+		_pParams(pParams),
+		_clientAddress(session.clientAddress()),
+		_serverAddress(session.serverAddress()),
+		_expectContinue(false)
+	{
+	}
+
+	~FastHTTPServerRequest()
+	{
+	}
+
+	void assign(const HTTPRequestScanner& scanner)
+		/// Sets method, URI, version and header fields
+		/// from the given scanner, and creates the request
+		/// body stream.
+	{
+		clear();
+		setMethod(std::string(scanner.method, scanner.methodLength));
+		setURI(std::string(scanner.uri, scanner.uriLength));
+		setVersion(std::string(scanner.version, scanner.versionLength));
+		for (int i = 0; i < scanner.fieldCount; ++i)
+		{
+			const HTTPRequestScanner::Field& f = scanner.fields[i];
+			std::string value(f.value, f.valueLength);
+			if (f.folded)
+			{
+				std::string unfolded;
+				for (std::string::const_iterator it = value.begin(); it != value.end(); ++it)
+				{
+					if (*it != '\r' && *it != '\n') unfolded += *it;
+				}
+				value.swap(unfolded);
+			}
+			add(std::string(f.name, f.nameLength), value);
+		}
+
+		const HTTPRequestScanner::Field* pExpect = scanner.field(HTTPRequestScanner::FIELD_EXPECT);
+		_expectContinue = pExpect && HTTPRequestScanner::contains(pExpect->value, pExpect->valueLength, "100-continue");
+
+		const HTTPRequestScanner::Field* pTE = scanner.field(HTTPRequestScanner::FIELD_TRANSFER_ENCODING);
+		const HTTPRequestScanner::Field* pCL = scanner.field(HTTPRequestScanner::FIELD_CONTENT_LENGTH);
+		if (pTE && HTTPRequestScanner::contains(pTE->value, pTE->valueLength, "chunked"))
+		{
+			_pStream = new FastHTTPChunkedInputStream(_session);
+		}
+		else
+		{
+			Poco::UInt64 length = 0;
+			if (pCL && !Poco::NumberParser::tryParseUnsigned64(std::string(pCL->value, pCL->valueLength), length))
+			{
+				throw MessageException("Invalid Content-Length");
+			}
+			_pStream = new HTTPFixedLengthInputStream(_session, static_cast<HTTPFixedLengthStreamBuf::ContentLength>(length));
+		}
+	}
+
+	bool drain(std::streamsize limit)
+		/// Discards the unread part of the request body, so that the next
+		/// pipelined request can be read. Returns false if more than limit
+		/// bytes are left, in which case the connection must be closed.
+	{
+		if (!_pStream) return true;
+		char buffer[1024];
+		std::streamsize total = 0;
+		while (_pStream->read(buffer, sizeof(buffer)) || _pStream->gcount() > 0)
+		{
+			total += _pStream->gcount();
+			if (total > limit) return false;
+		}
+		return true;
+	}
+
+	void finish()
+		/// Releases the request body stream.
+	{
+		_pStream = 0;
+	}
+
+	std::istream& stream()
+	{
+		poco_check_ptr (_pStream.get());
+
+		return *_pStream;
+	}
+
+	bool expectContinue() const
+	{
+		return _expectContinue;
+	}
+
+	const SocketAddress& clientAddress() const
+	{
+		return _clientAddress;
+	}
+
+	const SocketAddress& serverAddress() const
+	{
+		return _serverAddress;
+	}
+
+	const HTTPServerParams& serverParams() const
+	{
+		return *_pParams;
+	}
+
+	HTTPServerResponse& response() const;
+
+	StreamSocket& socket()
+		/// Returns the socket of the connection, e.g.
+		/// for HTTPFileSender::send().
+	{
+		return _session.socket();
+	}
+
+private:
+	FastHTTPServerResponse& _response;
+	FastHTTPServerSession& _session;
+	HTTPServerParams::Ptr _pParams;
+	SocketAddress _clientAddress;
+	SocketAddress _serverAddress;
+	Poco::SharedPtr<std::istream> _pStream;
+	bool _expectContinue;
+};
+
+
+class FastHTTPServerResponse: public HTTPServerResponse
+	/// The HTTPServerResponse used by FastHTTPServerConnection.
+	/// The object is reused for all requests on a connection.
+{
+public:
+	explicit FastHTTPServerResponse(FastHTTPServerSession& session):
+		_session(session),
+		_head(false)
+	{
+	}
+
+	~FastHTTPServerResponse()
+	{
+	}
+
+	void reset(bool head)
+		/// Prepares the response for the next request. If head is
+		/// true, the request is a HEAD request, and no body is sent.
+	{
+		_pStream = 0;
+		clear();
+		setVersion(HTTP_1_1);
+		setStatusAndReason(HTTP_OK);
+		_head = head;
+	}
+
+	void finish()
+		/// Completes the response, e.g. by sending the
+		/// last chunk of a chunked response.
+	{
+		_pStream = 0;
+	}
+
+	void sendContinue()
+	{
+		static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+		_session.write(CONTINUE, sizeof(CONTINUE) - 1);
+	}
+
+	std::ostream& send()
+	{
+		poco_assert (!_pStream);
+
+		if (_head)
+		{
+			HTTPHeaderOutputStream hs(_session);
+			write(hs);
+			_pStream = new HTTPFixedLengthOutputStream(_session, 0);
+		}
+		else if (getChunkedTransferEncoding())
+		{
+			HTTPHeaderOutputStream hs(_session);
+			write(hs);
+			_pStream = new HTTPChunkedOutputStream(_session);
+		}
+		else if (hasContentLength())
+		{
+			// header and body share the stream buffer
+			Poco::CountingOutputStream cs;
+			write(cs);
+			_pStream = new HTTPFixedLengthOutputStream(_session, getContentLength64() + cs.chars());
+			write(*_pStream);
+		}
+		else
+		{
+			_pStream = new HTTPOutputStream(_session);
+			setKeepAlive(false);
+			write(*_pStream);
+		}
+		return *_pStream;
+	}
+
+	void sendFile(const std::string& path, const std::string& mediaType)
+	{
+		poco_assert (!_pStream);
+
+		Poco::File f(path);
+		Poco::Timestamp dateTime = f.getLastModified();
+		Poco::File::FileSize length = f.getSize();
+		if (!f.canRead()) throw Poco::OpenFileException(path);
+		set("Last-Modified", Poco::DateTimeFormatter::format(dateTime, Poco::DateTimeFormat::HTTP_FORMAT));
+		setContentLength64(length);
+		setContentType(mediaType);
+		setChunkedTransferEncoding(false);
+
+		std::ostream& ostr = send();
+		if (!_head) HTTPFileSender::transfer(ostr, &_session.socket(), path, 0, length);
+	}
+
+	void sendBuffer(const void* pBuffer, std::size_t length)
+	{
+		poco_assert (!_pStream);
+
+		setContentLength(static_cast<int>(length));
+		setChunkedTransferEncoding(false);
+		std::ostream& ostr = send();
+		if (!_head) ostr.write(static_cast<const char*>(pBuffer), static_cast<std::streamsize>(length));
+	}
+
+	void redirect(const std::string& uri, HTTPStatus status = HTTP_FOUND)
+	{
+		poco_assert (!_pStream);
+
+		setContentLength(0);
+		setChunkedTransferEncoding(false);
+		setStatusAndReason(status);
+		set("Location", uri);
+		send();
+	}
+
+	void requireAuthentication(const std::string& realm)
+	{
+		poco_assert (!_pStream);
+
+		setStatusAndReason(HTTP_UNAUTHORIZED);
+		std::string auth("Basic realm=\"");
+		auth.append(realm);
+		auth.append("\"");
+		set("WWW-Authenticate", auth);
+		setContentLength(0);
+		send();
+	}
+
+	bool sent() const
+	{
+		return !_pStream.isNull();
+	}
+
+private:
+	FastHTTPServerSession& _session;
+	Poco::SharedPtr<std::ostream> _pStream;
+	bool _head;
+};
+
+
+inline HTTPServerResponse& FastHTTPServerRequest::response() const
+{
+	return _response;
+}
+
+
+class FastHTTPServerConnection: public TCPServerConnection
+	/// FastHTTPServerConnection handles HTTP requests on a connection,
+	/// like HTTPServerConnection, with less work per request on
+	/// keep-alive connections:
+	///
+	///   - The request and response objects are created once per
+	///     connection and reset for every request, instead of being
+	///     created for every request.
+	///   - The request line and header are parsed in place by
+	///     HTTPRequestScanner, instead of being read character by
+	///     character through a stream by MessageHeader::read().
+	///   - The Date header is formatted once per second.
+	///
+	/// Pipelined requests are handled in order: data received after a
+	/// request, including further requests, is kept by the session, and
+	/// the unread part of a request body is discarded before the next
+	/// request is parsed, so that a request handler not reading the
+	/// body does not corrupt the following requests. If more than
+	/// MAX_DRAIN bytes of the body are left, the connection is closed.
+	///
+	/// Unlike HTTPServerConnection, which is notified through
+	/// HTTPRequestHandlerFactory::serverStopped by HTTPServer, a
+	/// FastHTTPServerConnection ends when the client closes the
+	/// connection, or the keep-alive timeout or request limit
+	/// given in HTTPServerParams is reached.
+{
+public:
+	enum
+	{
+		MAX_DRAIN = 65536
+	};
+
+	FastHTTPServerConnection(const StreamSocket& socket, HTTPServerParams::Ptr pParams, HTTPRequestHandlerFactory::Ptr pFactory):
+		TCPServerConnection(socket),
+		_pParams(pParams),
+		_pFactory(pFactory),
+		_dateSecond(0)
+	{
+		poco_check_ptr (pFactory);
+	}
+
+	~FastHTTPServerConnection()
+	{
+	}
+
+	void run()
+	{
+		std::string server = _pParams->getSoftwareVersion();
+		FastHTTPServerSession session(socket(), _pParams);
+		FastHTTPServerResponse response(session);
+		FastHTTPServerRequest request(response, session, _pParams);
+		HTTPRequestScanner scanner;
+		while (session.hasMoreRequests())
+		{
+			try
+			{
+				if (!readRequest(session, scanner)) break;
+				std::string method(scanner.method, scanner.methodLength);
+				response.reset(method == HTTPRequest::HTTP_HEAD);
+				request.assign(scanner);
+
+				response.set("Date", date());
+				response.setVersion(request.getVersion());
+				response.setKeepAlive(_pParams->getKeepAlive() && request.getKeepAlive() && session.canKeepAlive());
+				if (!server.empty()) response.set("Server", server);
+				try
+				{
+					Poco::SharedPtr<HTTPRequestHandler> pHandler(_pFactory->createRequestHandler(request));
+					if (pHandler)
+					{
+						if (request.expectContinue()) response.sendContinue();
+						pHandler->handleRequest(request, response);
+						if (!response.sent()) response.send();
+						bool drained = request.drain(MAX_DRAIN);
+						session.setKeepAlive(_pParams->getKeepAlive() && response.getKeepAlive() && session.canKeepAlive() && drained);
+					}
+					else sendErrorResponse(session, HTTPResponse::HTTP_NOT_IMPLEMENTED);
+				}
+				catch (Poco::Exception&)
+				{
+					if (!response.sent())
+					{
+						try
+						{
+							sendErrorResponse(session, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+						}
+						catch (...)
+						{
+						}
+					}
+					throw;
+				}
+				response.finish();
+				request.finish();
+			}
+			catch (NoMessageException&)
+			{
+				break;
+			}
+			catch (MessageException&)
+			{
+				sendErrorResponse(session, HTTPResponse::HTTP_BAD_REQUEST);
+			}
+			catch (Poco::Exception&)
+			{
+				if (session.networkException())
+				{
+					session.networkException()->rethrow();
+				}
+				else throw;
+			}
+		}
+	}
+
+protected:
+	bool readRequest(FastHTTPServerSession& session, HTTPRequestScanner& scanner)
+		/// Parses the next request. Returns false if the client
+		/// has closed the connection before sending a request.
+	{
+		for (;;)
+		{
+			std::size_t consumed = 0;
+			HTTPRequestScanner::Result result = scanner.scan(session.begin(), session.end(), consumed);
+			if (result == HTTPRequestScanner::SCAN_COMPLETE)
+			{
+				session.consume(consumed);
+				return true;
+			}
+			if (result == HTTPRequestScanner::SCAN_ERROR) throw MessageException("Malformed HTTP request header");
+			bool empty = session.pending() == 0;
+			if (!session.fill())
+			{
+				if (empty) return false;
+				throw MessageException("Incomplete HTTP request header");
+			}
+		}
+	}
+
+	const std::string& date()
+		/// Returns the Date header value, formatted
+		/// at most once per second.
+	{
+		Poco::Timestamp now;
+		std::time_t second = now.epochTime();
+		if (second != _dateSecond)
+		{
+			_date = Poco::DateTimeFormatter::format(now, Poco::DateTimeFormat::HTTP_FORMAT);
+			_dateSecond = second;
+		}
+		return _date;
+	}
+
+	void sendErrorResponse(FastHTTPServerSession& session, HTTPResponse::HTTPStatus status)
+	{
+		FastHTTPServerResponse response(session);
+		response.reset(false);
+		response.setStatusAndReason(status);
+		response.setKeepAlive(false);
+		response.setContentLength(0);
+		response.send();
+		response.finish();
+		session.setKeepAlive(false);
+	}
+
+private:
+	HTTPServerParams::Ptr _pParams;
+	HTTPRequestHandlerFactory::Ptr _pFactory;
+	std::time_t _dateSecond;
+	std::string _date;
+};
+
+
+class FastHTTPServerConnectionFactory: public TCPServerConnectionFactory
+	/// A TCPServerConnectionFactory creating FastHTTPServerConnection
+	/// objects. Use it with a TCPServer (or BatchTCPServer) instead
+	/// of HTTPServer:
+	///
+	///     TCPServer server(new FastHTTPServerConnectionFactory(pParams, pFactory), socket, pParams);
+{
+public:
+	FastHTTPServerConnectionFactory(HTTPServerParams::Ptr pParams, HTTPRequestHandlerFactory::Ptr pFactory):
+		_pParams(pParams),
+		_pFactory(pFactory)
+	{
+		poco_check_ptr (pFactory);
+	}
+
+	~FastHTTPServerConnectionFactory()
+	{
+	}
+
+	TCPServerConnection* createConnection(const StreamSocket& socket)
+	{
+		return new FastHTTPServerConnection(socket, _pParams, _pFactory);
+	}
+
+private:
+	HTTPServerParams::Ptr _pParams;
+	HTTPRequestHandlerFactory::Ptr _pFactory;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_FastHTTPServerConnection_INCLUDED
@@ -0,0 +1,288 @@
+//
+// HTTPFileSender.h
+//
+// $Id$
+//
+// Library: Net
+// Package: HTTPServer
+// Module:  HTTPFileSender
+//
+// Definition of the HTTPFileSender class.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_HTTPFileSender_INCLUDED
+#define Net_HTTPFileSender_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerRequestImpl.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/SocketImpl.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+#include "Poco/Buffer.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Exception.h"
+#include <ostream>
+#if defined(POCO_OS_FAMILY_UNIX) && defined(__linux__)
+#include <sys/types.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#define POCO_NET_HAVE_SENDFILE 1
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+class HTTPFileSender
+	/// HTTPFileSender sends the content of a file as the body of an
+	/// HTTP response, with sendfile() on Linux for plain (non-TLS)
+	/// connections, so that the file content is not copied through
+	/// user space, and with a large buffer otherwise.
+	///
+	/// send() also supports single byte range requests (RFC 7233),
+	/// including If-Range, so that clients can resume interrupted
+	/// transfers of large files:
+	///
+	///     void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response)
+	///     {
+	///         HTTPFileSender::send(request, response, path, "application/octet-stream");
+	///     }
+	///
+	/// Requests for multiple ranges are answered with the entire file.
+{
+public:
+	enum
+	{
+		COPY_BUFFER_SIZE   = 256*1024,
+			/// The buffer size for copying the file if sendfile() cannot be used.
+		MAX_SENDFILE_CHUNK = 0x40000000
+			/// The maximum number of bytes sent with a single sendfile() call.
+	};
+
+	static void send(HTTPServerRequest& request, HTTPServerResponse& response, const std::string& path, const std::string& mediaType, StreamSocket* pSocket = 0)
+		/// Sends the response header to the client, followed by the
+		/// content of the given file, or the requested range of it.
+		///
+		/// The response has Last-Modified, ETag and Accept-Ranges headers.
+		/// If the request has a satisfiable Range header (and If-Range,
+		/// if present, matches the ETag or Last-Modified date), the response
+		/// is 206 (Partial Content) with the range; an unsatisfiable range
+		/// results in a 416 (Range Not Satisfiable) response.
+		///
+		/// The socket used for sendfile() is the given socket, which must be
+		/// the connection of the request, or else the socket of the request,
+		/// if it is an HTTPServerRequestImpl. Otherwise the file is copied
+		/// to the response stream.
+		///
+		/// Must not be called after send(), sendFile(), sendBuffer()
+		/// or redirect() has been called on the response.
+		///
+		/// Throws a FileNotFoundException if the file cannot be found,
+		/// or an OpenFileException if the file cannot be opened.
+	{
+		Poco::File f(path);
+		Poco::Timestamp dateTime = f.getLastModified();
+		Poco::UInt64 length = f.getSize();
+		if (!f.canRead()) throw Poco::OpenFileException(path);
+		std::string lastModified = Poco::DateTimeFormatter::format(dateTime, Poco::DateTimeFormat::HTTP_FORMAT);
+		std::string etag("\"");
+		etag += Poco::NumberFormatter::formatHex(static_cast<Poco::UInt64>(dateTime.epochMicroseconds()));
+		etag += '-';
+		etag += Poco::NumberFormatter::formatHex(length);
+		etag += '"';
+
+		response.set("Last-Modified", lastModified);
+		response.set("ETag", etag);
+		response.set("Accept-Ranges", "bytes");
+		response.setChunkedTransferEncoding(false);
+
+		Poco::UInt64 offset = 0;
+		Poco::UInt64 count = length;
+		if (request.has("Range") && (!request.has("If-Range") || request.get("If-Range") == etag || request.get("If-Range") == lastModified))
+		{
+			Poco::UInt64 first;
+			Poco::UInt64 last;
+			if (parseRange(request.get("Range"), length, first, last))
+			{
+				if (first >= length || first > last)
+				{
+					response.setStatusAndReason(HTTPResponse::HTTP_REQUESTED_RANGE_NOT_SATISFIABLE);
+					response.set("Content-Range", "bytes */" + Poco::NumberFormatter::format(length));
+					response.setContentLength(0);
+					response.send();
+					return;
+				}
+				offset = first;
+				count = last - first + 1;
+				response.setStatusAndReason(HTTPResponse::HTTP_PARTIAL_CONTENT);
+				std::string range("bytes ");
+				range += Poco::NumberFormatter::format(first);
+				range += '-';
+				range += Poco::NumberFormatter::format(last);
+				range += '/';
+				range += Poco::NumberFormatter::format(length);
+				response.set("Content-Range", range);
+			}
+		}
+		response.setContentLength64(count);
+		response.setContentType(mediaType);
+
+		if (!pSocket)
+		{
+			HTTPServerRequestImpl* pRequestImpl = dynamic_cast<HTTPServerRequestImpl*>(&request);
+			if (pRequestImpl) pSocket = &pRequestImpl->socket();
+		}
+		if (request.getMethod() == HTTPRequest::HTTP_HEAD)
+		{
+			response.send();
+		}
+		else
+		{
+			std::ostream& ostr = response.send();
+			transfer(ostr, pSocket, path, offset, count);
+		}
+	}
+
+	static void transfer(std::ostream& ostr, StreamSocket* pSocket, const std::string& path, Poco::UInt64 offset, Poco::UInt64 count)
+		/// Sends count bytes of the given file, starting at offset, after
+		/// flushing the response stream ostr. If a plain (non-TLS) socket
+		/// is given, the file is sent with sendfile() where available,
+		/// bypassing the response stream. Otherwise, the file is copied
+		/// to the response stream.
+	{
+		ostr.flush();
+		if (!ostr.good()) throw Poco::WriteFileException("Cannot send file", path);
+#if defined(POCO_NET_HAVE_SENDFILE)
+		if (pSocket && !pSocket->secure())
+		{
+			sendFile(*pSocket, path, offset, count);
+			return;
+		}
+#endif
+		copyFile(ostr, path, offset, count);
+	}
+
+	static bool parseRange(const std::string& range, Poco::UInt64 length, Poco::UInt64& first, Poco::UInt64& last)
+		/// Parses a Range header with a single byte range ("bytes=first-last",
+		/// "bytes=first-" or "bytes=-suffix") for a file with the given length.
+		/// Returns false if the header is malformed or specifies more than one
+		/// range, in which case it must be ignored. If the range is not
+		/// satisfiable, first is greater than or equal to length or last.
+	{
+		if (range.compare(0, 6, "bytes=") != 0) return false;
+		std::string spec(range, 6);
+		if (spec.find(',') != std::string::npos) return false;
+		std::string::size_type dash = spec.find('-');
+		if (dash == std::string::npos) return false;
+		std::string firstStr = trim(spec.substr(0, dash));
+		std::string lastStr = trim(spec.substr(dash + 1));
+		if (firstStr.empty())
+		{
+			Poco::UInt64 suffix;
+			if (!Poco::NumberParser::tryParseUnsigned64(lastStr, suffix)) return false;
+			first = suffix == 0 ? length : (suffix < length ? length - suffix : 0);
+			last = length > 0 ? length - 1 : 0;
+			return true;
+		}
+		if (!Poco::NumberParser::tryParseUnsigned64(firstStr, first)) return false;
+		if (lastStr.empty())
+		{
+			last = length > 0 ? length - 1 : 0;
+		}
+		else
+		{
+			if (!Poco::NumberParser::tryParseUnsigned64(lastStr, last)) return false;
+			if (last < first) return false;
+			if (length > 0 && last >= length) last = length - 1;
+		}
+		return true;
+	}
+
+protected:
+	static std::string trim(const std::string& str)
+	{
+		std::string::size_type begin = str.find_first_not_of(" \t");
+		if (begin == std::string::npos) return std::string();
+		std::string::size_type end = str.find_last_not_of(" \t");
+		return str.substr(begin, end - begin + 1);
+	}
+
+	static void copyFile(std::ostream& ostr, const std::string& path, Poco::UInt64 offset, Poco::UInt64 count)
+	{
+		Poco::FileInputStream istr(path);
+		if (!istr.good()) throw Poco::OpenFileException(path);
+		if (offset > 0) istr.seekg(static_cast<std::streamoff>(offset));
+
+		Poco::Buffer<char> buffer(static_cast<std::size_t>(count < Poco::UInt64(COPY_BUFFER_SIZE) ? count : Poco::UInt64(COPY_BUFFER_SIZE)));
+		while (count > 0 && istr.good())
+		{
+			std::streamsize n = static_cast<std::streamsize>(count < buffer.size() ? count : buffer.size());
+			istr.read(buffer.begin(), n);
+			n = istr.gcount();
+			if (n <= 0) break;
+			ostr.write(buffer.begin(), n);
+			count -= static_cast<Poco::UInt64>(n);
+		}
+		if (count > 0) throw Poco::ReadFileException("File truncated", path);
+	}
+
+#if defined(POCO_NET_HAVE_SENDFILE)
+	struct FileDescriptor
+	{
+		explicit FileDescriptor(int f): fd(f)
+		{
+		}
+
+		~FileDescriptor()
+		{
+			if (fd >= 0) ::close(fd);
+		}
+
+		int fd;
+	};
+
+	static void sendFile(StreamSocket& socket, const std::string& path, Poco::UInt64 offset, Poco::UInt64 count)
+	{
+		FileDescriptor file(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+		if (file.fd < 0) throw Poco::OpenFileException(path);
+
+		off_t off = static_cast<off_t>(offset);
+		while (count > 0)
+		{
+			std::size_t chunk = static_cast<std::size_t>(count < Poco::UInt64(MAX_SENDFILE_CHUNK) ? count : Poco::UInt64(MAX_SENDFILE_CHUNK));
+			ssize_t n = ::sendfile(socket.impl()->sockfd(), file.fd, &off, chunk);
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK) throw Poco::TimeoutException("Cannot send file", path);
+				throw NetException("Cannot send file", errno);
+			}
+			if (n == 0) throw Poco::ReadFileException("File truncated", path);
+			count -= static_cast<Poco::UInt64>(n);
+		}
+	}
+#endif
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_HTTPFileSender_INCLUDED
@@ -0,0 +1,453 @@
+//
+// LinkProber.h
+//
+// $Id$
+//
+// Library: Net
+// Package: ICMP
+// Module:  LinkProber
+//
+// Definition of the LinkProber class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_LinkProber_INCLUDED
+#define Net_LinkProber_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/RawSocket.h"
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/SocketReactor.h"
+#include "Poco/Net/SocketNotification.h"
+#include "Poco/Net/NTPPacket.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/NObserver.h"
+#include "Poco/Process.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include <map>
+#include <vector>
+#include <cstring>
+
+
+namespace Poco {
+namespace Net {
+
+
+class LinkProber
+	/// LinkProber measures round trip times to many hosts at the same time,
+	/// with ICMP echo requests and NTP requests, without blocking a thread
+	/// per request.
+	///
+	/// All ICMP probes share one raw socket, and all NTP probes share one
+	/// UDP socket. Both sockets are handled by a SocketReactor (which can
+	/// also handle other sockets), and replies are matched to requests by
+	/// the ICMP sequence number or by the NTP originate timestamp.
+	///
+	/// Results are reported with the probeReplied and probeTimedOut events,
+	/// which are fired from the reactor thread, and summarized per target
+	/// in Statistics. Probes can be started from any thread, e.g. from a
+	/// Timer for continuous monitoring.
+	///
+	/// Raw ICMP sockets require appropriate privileges (e.g., CAP_NET_RAW
+	/// on Linux). If the raw socket cannot be created, only NTP probes are
+	/// available; see icmpAvailable().
+{
+public:
+	enum ProbeType
+	{
+		PROBE_ICMP,
+		PROBE_NTP
+	};
+
+	struct ProbeResult
+	{
+		ProbeType type;
+		SocketAddress address;
+		Poco::Timespan rtt;
+			/// The round trip time (excluding the server's processing
+			/// time for NTP). Zero if the probe timed out.
+		Poco::Timespan offset;
+			/// For NTP probes, the offset of the server's clock from
+			/// the local clock.
+	};
+
+	struct Statistics
+	{
+		Statistics():
+			sent(0),
+			received(0),
+			lost(0)
+		{
+		}
+
+		Poco::UInt64 sent;
+		Poco::UInt64 received;
+		Poco::UInt64 lost;
+		Poco::Timespan minRTT;
+		Poco::Timespan maxRTT;
+		Poco::Timespan avgRTT;
+		Poco::Timespan jitter;
+			/// Smoothed mean deviation of consecutive round trip
+			/// times, as for RTP (RFC 3550).
+		Poco::Timespan lastRTT;
+	};
+
+	Poco::BasicEvent<const ProbeResult> probeReplied;
+		/// Fired when a reply to a probe has been received.
+
+	Poco::BasicEvent<const ProbeResult> probeTimedOut;
+		/// Fired when no reply to a probe has been received in time.
+
+	enum
+	{
+		NTP_PORT        = 123,
+		NTP_PACKET_SIZE = 48,
+		ICMP_DATA_SIZE  = 32
+	};
+
+	explicit LinkProber(SocketReactor& reactor, IPAddress::Family family = IPAddress::IPv4):
+		_reactor(reactor),
+		_family(family),
+		_ntpSocket(family),
+		_icmpAvailable(false),
+		_id(static_cast<Poco::UInt16>(Poco::Process::id())),
+		_sequence(0),
+		_token(0)
+		/// Creates the LinkProber and registers its sockets with the reactor.
+	{
+		try
+		{
+#if defined(POCO_HAVE_IPv6)
+			_icmpSocket = RawSocket(family, family == IPAddress::IPv6 ? int(IPPROTO_ICMPV6) : int(IPPROTO_ICMP));
+#else
+			_icmpSocket = RawSocket(family, IPPROTO_ICMP);
+#endif
+			_icmpAvailable = true;
+		}
+		catch (Poco::Exception&)
+		{
+		}
+		if (_icmpAvailable)
+		{
+			_reactor.addEventHandler(_icmpSocket, Poco::NObserver<LinkProber, ReadableNotification>(*this, &LinkProber::onICMPReadable));
+			_reactor.addEventHandler(_icmpSocket, Poco::NObserver<LinkProber, TimeoutNotification>(*this, &LinkProber::onTimeout));
+		}
+		_reactor.addEventHandler(_ntpSocket, Poco::NObserver<LinkProber, ReadableNotification>(*this, &LinkProber::onNTPReadable));
+		_reactor.addEventHandler(_ntpSocket, Poco::NObserver<LinkProber, TimeoutNotification>(*this, &LinkProber::onTimeout));
+	}
+
+	~LinkProber()
+		/// Unregisters the sockets from the reactor
+		/// and destroys the LinkProber.
+	{
+		try
+		{
+			_reactor.removeEventHandler(_ntpSocket, Poco::NObserver<LinkProber, TimeoutNotification>(*this, &LinkProber::onTimeout));
+			_reactor.removeEventHandler(_ntpSocket, Poco::NObserver<LinkProber, ReadableNotification>(*this, &LinkProber::onNTPReadable));
+			if (_icmpAvailable)
+			{
+				_reactor.removeEventHandler(_icmpSocket, Poco::NObserver<LinkProber, TimeoutNotification>(*this, &LinkProber::onTimeout));
+				_reactor.removeEventHandler(_icmpSocket, Poco::NObserver<LinkProber, ReadableNotification>(*this, &LinkProber::onICMPReadable));
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	bool icmpAvailable() const
+		/// Returns true if ICMP probes can be sent.
+	{
+		return _icmpAvailable;
+	}
+
+	void probeICMP(const IPAddress& address, const Poco::Timespan& timeout)
+		/// Sends an ICMP echo request to the given address.
+	{
+		if (!_icmpAvailable) throw Poco::IllegalStateException("ICMP probing not available");
+
+		Poco::UInt8 packet[8 + ICMP_DATA_SIZE];
+		std::memset(packet, 0, sizeof(packet));
+		SocketAddress target(address, 0);
+		Poco::UInt16 sequence;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			sequence = ++_sequence;
+			addPending(PROBE_ICMP, sequence, target, timeout);
+		}
+		packet[0] = static_cast<Poco::UInt8>(_family == IPAddress::IPv6 ? 128 : 8);
+		packet[4] = static_cast<Poco::UInt8>(_id >> 8);
+		packet[5] = static_cast<Poco::UInt8>(_id);
+		packet[6] = static_cast<Poco::UInt8>(sequence >> 8);
+		packet[7] = static_cast<Poco::UInt8>(sequence);
+		if (_family == IPAddress::IPv4)
+		{
+			// the kernel computes the checksum for ICMPv6
+			Poco::UInt16 sum = checksum(packet, sizeof(packet));
+			packet[2] = static_cast<Poco::UInt8>(sum >> 8);
+			packet[3] = static_cast<Poco::UInt8>(sum);
+		}
+		send(_icmpSocket, packet, sizeof(packet), target, PROBE_ICMP, sequence);
+	}
+
+	void probeNTP(const SocketAddress& address, const Poco::Timespan& timeout)
+		/// Sends an NTP (client mode) request to the given address.
+	{
+		Poco::UInt8 packet[NTP_PACKET_SIZE];
+		std::memset(packet, 0, sizeof(packet));
+		Poco::UInt64 token;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			token = (Poco::UInt64(Poco::Timestamp().epochTime() + 2208988800UL) << 32) | (++_token & 0xFFFFFFFF);
+			addPending(PROBE_NTP, token, address, timeout);
+		}
+		packet[0] = (4 << 3) | 3; // version 4, client mode
+		for (int i = 0; i < 8; ++i) packet[40 + i] = static_cast<Poco::UInt8>(token >> (56 - 8*i));
+		send(_ntpSocket, packet, sizeof(packet), address, PROBE_NTP, token);
+	}
+
+	void probeNTP(const IPAddress& address, const Poco::Timespan& timeout)
+		/// Sends an NTP request to the given address and the NTP port.
+	{
+		probeNTP(SocketAddress(address, NTP_PORT), timeout);
+	}
+
+	Statistics statistics(ProbeType type, const SocketAddress& address) const
+		/// Returns the statistics for the given target. For ICMP
+		/// probes, the port of the address must be 0.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		StatisticsMap::const_iterator it = _statistics.find(statisticsKey(type, address));
+		return it != _statistics.end() ? it->second : Statistics();
+	}
+
+	void resetStatistics()
+		/// Clears all statistics.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_statistics.clear();
+	}
+
+	std::size_t pending() const
+		/// Returns the number of probes waiting for a reply.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _pending.size();
+	}
+
+protected:
+	struct Pending
+	{
+		ProbeType type;
+		SocketAddress address;
+		Poco::Timestamp sent;
+		Poco::Timestamp deadline;
+	};
+
+	typedef std::pair<int, Poco::UInt64> PendingKey;
+	typedef std::map<PendingKey, Pending> PendingMap;
+	typedef std::pair<int, std::string> StatisticsKey;
+	typedef std::map<StatisticsKey, Statistics> StatisticsMap;
+
+	static StatisticsKey statisticsKey(ProbeType type, const SocketAddress& address)
+	{
+		return std::make_pair(static_cast<int>(type), address.toString());
+	}
+
+	void addPending(ProbeType type, Poco::UInt64 id, const SocketAddress& address, const Poco::Timespan& timeout)
+		/// Must be called with the mutex locked.
+	{
+		Pending& p = _pending[PendingKey(type, id)];
+		p.type = type;
+		p.address = address;
+		p.deadline = p.sent + timeout;
+		++_statistics[statisticsKey(type, address)].sent;
+	}
+
+	void send(Socket& socket, const Poco::UInt8* packet, int length, const SocketAddress& address, ProbeType type, Poco::UInt64 id)
+	{
+		try
+		{
+			int n;
+			if (type == PROBE_ICMP)
+				n = static_cast<RawSocket&>(socket).sendTo(packet, length, address);
+			else
+				n = static_cast<DatagramSocket&>(socket).sendTo(packet, length, address);
+			if (n != length) throw NetException("Cannot send probe");
+		}
+		catch (...)
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_pending.erase(PendingKey(type, id));
+			--_statistics[statisticsKey(type, address)].sent;
+			throw;
+		}
+	}
+
+	void onICMPReadable(const Poco::AutoPtr<ReadableNotification>&)
+	{
+		Poco::UInt8 buffer[1024];
+		SocketAddress sender;
+		int n = _icmpSocket.receiveFrom(buffer, sizeof(buffer), sender);
+		Poco::Timestamp now;
+		const Poco::UInt8* p = buffer;
+		if (_family == IPAddress::IPv4 && n > 0)
+		{
+			// raw IPv4 sockets receive the IP header
+			int headerLength = (buffer[0] & 0x0F)*4;
+			p += headerLength;
+			n -= headerLength;
+		}
+		Poco::UInt8 replyType = _family == IPAddress::IPv6 ? 129 : 0;
+		if (n >= 8 && p[0] == replyType && ((p[4] << 8) | p[5]) == _id)
+		{
+			Poco::UInt16 sequence = static_cast<Poco::UInt16>((p[6] << 8) | p[7]);
+			complete(PendingKey(PROBE_ICMP, sequence), sender.host(), now, Poco::Timespan(), Poco::Timespan());
+		}
+		expire(now);
+	}
+
+	void onNTPReadable(const Poco::AutoPtr<ReadableNotification>&)
+	{
+		Poco::UInt8 buffer[NTP_PACKET_SIZE*2];
+		SocketAddress sender;
+		int n = _ntpSocket.receiveFrom(buffer, sizeof(buffer), sender);
+		Poco::Timestamp now;
+		if (n >= NTP_PACKET_SIZE && (buffer[0] & 0x07) == 4)
+		{
+			NTPPacket packet(buffer);
+			Poco::UInt64 token = static_cast<Poco::UInt64>(packet.originateTimestamp());
+			Pending pending;
+			if (find(PendingKey(PROBE_NTP, token), pending))
+			{
+				// RFC 5905: delay = (t4 - t1) - (t3 - t2), offset = ((t2 - t1) + (t3 - t4))/2
+				Poco::Timestamp::TimeDiff t21 = packet.receiveTime() - pending.sent;
+				Poco::Timestamp::TimeDiff t34 = packet.transmitTime() - now;
+				Poco::Timestamp::TimeDiff processing = packet.transmitTime() - packet.receiveTime();
+				Poco::Timespan delay((now - pending.sent) - processing);
+				complete(PendingKey(PROBE_NTP, token), sender.host(), now, delay, Poco::Timespan((t21 + t34)/2));
+			}
+		}
+		expire(now);
+	}
+
+	void onTimeout(const Poco::AutoPtr<TimeoutNotification>&)
+	{
+		expire(Poco::Timestamp());
+	}
+
+	bool find(const PendingKey& key, Pending& pending) const
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		PendingMap::const_iterator it = _pending.find(key);
+		if (it == _pending.end()) return false;
+		pending = it->second;
+		return true;
+	}
+
+	void complete(const PendingKey& key, const IPAddress& sender, const Poco::Timestamp& now, Poco::Timespan rtt, const Poco::Timespan& offset)
+		/// Completes the probe with the given key, if it is pending and
+		/// the reply comes from the probed host.
+	{
+		ProbeResult result;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			PendingMap::iterator it = _pending.find(key);
+			if (it == _pending.end() || it->second.address.host() != sender) return;
+			if (it->second.type == PROBE_ICMP) rtt = now - it->second.sent;
+			result.type = it->second.type;
+			result.address = it->second.address;
+			result.rtt = rtt;
+			result.offset = offset;
+			_pending.erase(it);
+			update(_statistics[statisticsKey(result.type, result.address)], rtt);
+		}
+		probeReplied(this, result);
+	}
+
+	void expire(const Poco::Timestamp& now)
+		/// Reports all probes whose deadline has passed.
+	{
+		std::vector<ProbeResult> expired;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (PendingMap::iterator it = _pending.begin(); it != _pending.end();)
+			{
+				if (it->second.deadline <= now)
+				{
+					ProbeResult result;
+					result.type = it->second.type;
+					result.address = it->second.address;
+					expired.push_back(result);
+					++_statistics[statisticsKey(result.type, result.address)].lost;
+					_pending.erase(it++);
+				}
+				else ++it;
+			}
+		}
+		for (std::vector<ProbeResult>::const_iterator it = expired.begin(); it != expired.end(); ++it)
+		{
+			probeTimedOut(this, *it);
+		}
+	}
+
+	static void update(Statistics& stats, const Poco::Timespan& rtt)
+	{
+		if (stats.received == 0 || rtt < stats.minRTT) stats.minRTT = rtt;
+		if (stats.received == 0 || rtt > stats.maxRTT) stats.maxRTT = rtt;
+		if (stats.received > 0)
+		{
+			Poco::Timespan::TimeDiff d = rtt.totalMicroseconds() - stats.lastRTT.totalMicroseconds();
+			if (d < 0) d = -d;
+			stats.jitter += (d - stats.jitter.totalMicroseconds())/16;
+		}
+		++stats.received;
+		stats.avgRTT += (rtt.totalMicroseconds() - stats.avgRTT.totalMicroseconds())/static_cast<Poco::Timespan::TimeDiff>(stats.received);
+		stats.lastRTT = rtt;
+	}
+
+	static Poco::UInt16 checksum(const Poco::UInt8* data, std::size_t length)
+	{
+		Poco::UInt32 sum = 0;
+		for (std::size_t i = 0; i + 1 < length; i += 2)
+		{
+			sum += (Poco::UInt32(data[i]) << 8) | data[i + 1];
+		}
+		if (length & 1) sum += Poco::UInt32(data[length - 1]) << 8;
+		while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+		return static_cast<Poco::UInt16>(~sum);
+	}
+
+private:
+	LinkProber(const LinkProber&);
+	LinkProber& operator = (const LinkProber&);
+
+	SocketReactor& _reactor;
+	IPAddress::Family _family;
+	RawSocket _icmpSocket;
+	DatagramSocket _ntpSocket;
+	bool _icmpAvailable;
+	Poco::UInt16 _id;
+	Poco::UInt16 _sequence;
+	Poco::UInt64 _token;
+	PendingMap _pending;
+	StatisticsMap _statistics;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_LinkProber_INCLUDED
@@ -27,6 +27,8 @@
 #include "Poco/NObserver.h"
 #include "Poco/Thread.h"
 #include "Poco/SharedPtr.h"
+#include "Poco/ThreadAffinity.h"
+#include "Poco/AtomicCounter.h"
 
 
 using Poco::Net::Socket;
@@ -50,13 +52,26 @@ class ParallelSocketReactor: public SR
 public:
 	typedef Poco::SharedPtr<ParallelSocketReactor> Ptr;
 
-	ParallelSocketReactor()
+	ParallelSocketReactor():
+		_affinityGroup("reactor")
 	{
 		_thread.start(*this);
 	}
 	
 	ParallelSocketReactor(const Poco::Timespan& timeout):
-		SR(timeout)
+		SR(timeout),
+		_affinityGroup("reactor")
+	{
+		_thread.start(*this);
+	}
+
+	ParallelSocketReactor(const Poco::Timespan& timeout, const std::string& affinityGroup):
+		SR(timeout),
+		_affinityGroup(affinityGroup)
+		/// Creates the ParallelSocketReactor, pinning its thread according
+		/// to the policy registered under affinityGroup in the
+		/// ThreadAffinityRegistry. The other constructors use the
+		/// group "reactor".
 	{
 		_thread.start(*this);
 	}
@@ -74,15 +89,61 @@ public:
 		}
 	}
 	
+	void run()
+	{
+		Poco::ThreadAffinityRegistry::instance().pinCurrentThread(_affinityGroup);
+		SR::run();
+	}
+
+	void connectionOpened()
+		/// Increments the number of connections handled by
+		/// the reactor. Called by ParallelSocketAcceptor when
+		/// it passes a connection to the reactor.
+	{
+		++_connections;
+	}
+
+	void connectionClosed()
+		/// Decrements the number of connections handled by the reactor.
+		///
+		/// Must be called by service handlers when they close their
+		/// connection, if the reactor is used by a ParallelSocketAcceptor
+		/// distributing connections by number of connections.
+	{
+		--_connections;
+	}
+
+	int connections() const
+		/// Returns the number of connections handled by the reactor.
+	{
+		return _connections.value();
+	}
+
+	int busyCount() const
+		/// Returns the number of times the reactor has woken
+		/// up with sockets ready for dispatching.
+	{
+		return _busy.value();
+	}
+
 protected:
 	void onIdle()
 	{
 		SR::onIdle();
 		Poco::Thread::yield();
 	}
+
+	void onBusy()
+	{
+		SR::onBusy();
+		++_busy;
+	}
 	
 private:
+	std::string  _affinityGroup;
 	Poco::Thread _thread;
+	Poco::AtomicCounter _connections;
+	Poco::AtomicCounter _busy;
 };
 
 
@@ -0,0 +1,331 @@
+//
+// PollSet.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Sockets
+// Module:  PollSet
+//
+// Definition of the PollSet class.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_PollSet_INCLUDED
+#define Net_PollSet_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/Socket.h"
+#include "Poco/Net/SocketImpl.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include "Poco/Error.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <map>
+#if defined(POCO_OS_FAMILY_UNIX) && POCO_OS == POCO_OS_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#define POCO_POLLSET_EPOLL 1
+#elif defined(POCO_OS_FAMILY_BSD)
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define POCO_POLLSET_KQUEUE 1
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+class PollSet
+	/// A PollSet keeps a set of sockets, each with the events it is
+	/// interested in (Socket::SELECT_READ, Socket::SELECT_WRITE,
+	/// Socket::SELECT_ERROR), registered with the operating system
+	/// for as long as the socket is part of the set.
+	///
+	/// On Linux, the set is an epoll instance; on BSD platforms,
+	/// including OS X, it is a kqueue. Waiting for events therefore
+	/// costs time proportional to the number of sockets ready, not to
+	/// the number of sockets in the set. Events are level-triggered,
+	/// like with Socket::select() and Socket::poll(). On other platforms,
+	/// Socket::select() is used.
+	///
+	/// A thread waiting in poll() can be interrupted with wakeUp().
+	/// Sockets can be added, updated and removed while another thread
+	/// waits in poll(); events for a socket removed in the meantime
+	/// are not reported.
+{
+public:
+	typedef std::vector<std::pair<Socket, int> > SocketModeList;
+
+	PollSet():
+		_fd(-1),
+		_wakeFd(-1)
+		/// Creates an empty PollSet.
+	{
+#if defined(POCO_POLLSET_EPOLL)
+		_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (_fd < 0) throw Poco::IOException("Cannot create epoll instance", Poco::Error::getMessage(Poco::Error::last()));
+		_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (_wakeFd < 0)
+		{
+			::close(_fd);
+			throw Poco::IOException("Cannot create eventfd", Poco::Error::getMessage(Poco::Error::last()));
+		}
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.fd = _wakeFd;
+		epoll_ctl(_fd, EPOLL_CTL_ADD, _wakeFd, &ev);
+#elif defined(POCO_POLLSET_KQUEUE)
+		_fd = kqueue();
+		if (_fd < 0) throw Poco::IOException("Cannot create kqueue", Poco::Error::getMessage(Poco::Error::last()));
+		struct kevent ev;
+		EV_SET(&ev, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, 0);
+		kevent(_fd, &ev, 1, 0, 0, 0);
+#endif
+	}
+
+	~PollSet()
+		/// Destroys the PollSet.
+	{
+#if defined(POCO_POLLSET_EPOLL)
+		::close(_wakeFd);
+		::close(_fd);
+#elif defined(POCO_POLLSET_KQUEUE)
+		::close(_fd);
+#endif
+	}
+
+	void add(const Socket& socket, int mode)
+		/// Adds the socket to the set, or changes the events
+		/// the socket is interested in if it is already in the set.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		poco_socket_t fd = socket.impl()->sockfd();
+		SocketMap::iterator it = _sockets.find(fd);
+		int oldMode = 0;
+		if (it != _sockets.end())
+		{
+			oldMode = it->second.second;
+			it->second.second = mode;
+		}
+		else _sockets[fd] = std::make_pair(socket, mode);
+		control(fd, oldMode, mode, oldMode != 0);
+	}
+
+	void remove(const Socket& socket)
+		/// Removes the socket from the set.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		poco_socket_t fd = socket.impl()->sockfd();
+		SocketMap::iterator it = _sockets.find(fd);
+		if (it == _sockets.end()) return;
+		control(fd, it->second.second, 0, it->second.second != 0);
+		_sockets.erase(it);
+	}
+
+	bool has(const Socket& socket) const
+		/// Returns true if the socket is in the set.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _sockets.find(socket.impl()->sockfd()) != _sockets.end();
+	}
+
+	bool empty() const
+		/// Returns true if the set contains no sockets.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _sockets.empty();
+	}
+
+	void clear()
+		/// Removes all sockets from the set.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (SocketMap::iterator it = _sockets.begin(); it != _sockets.end(); ++it)
+		{
+			control(it->first, it->second.second, 0, it->second.second != 0);
+		}
+		_sockets.clear();
+	}
+
+	int poll(const Poco::Timespan& timeout, SocketModeList& ready)
+		/// Waits until at least one socket in the set is ready for
+		/// one of the events it is interested in, the timeout expires,
+		/// or wakeUp() is called. The ready sockets, with their
+		/// events, are stored in ready.
+		///
+		/// Returns the number of ready sockets.
+	{
+		ready.clear();
+#if defined(POCO_POLLSET_EPOLL)
+		struct epoll_event events[MAX_EVENTS];
+		int n = epoll_wait(_fd, events, MAX_EVENTS, static_cast<int>(timeout.totalMilliseconds()));
+		if (n < 0)
+		{
+			if (errno == EINTR) return 0;
+			throw Poco::IOException("epoll_wait failed", Poco::Error::getMessage(Poco::Error::last()));
+		}
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (int i = 0; i < n; ++i)
+		{
+			if (events[i].data.fd == _wakeFd)
+			{
+				Poco::UInt64 value;
+				while (::read(_wakeFd, &value, sizeof(value)) > 0);
+				continue;
+			}
+			SocketMap::const_iterator it = _sockets.find(events[i].data.fd);
+			if (it == _sockets.end()) continue;
+			int mode = 0;
+			if (events[i].events & (EPOLLIN | EPOLLHUP)) mode |= Socket::SELECT_READ;
+			if (events[i].events & EPOLLOUT) mode |= Socket::SELECT_WRITE;
+			if (events[i].events & (EPOLLERR | EPOLLPRI)) mode |= Socket::SELECT_ERROR;
+			mode &= it->second.second;
+			if (mode) ready.push_back(std::make_pair(it->second.first, mode));
+		}
+#elif defined(POCO_POLLSET_KQUEUE)
+		struct kevent events[MAX_EVENTS];
+		struct timespec ts;
+		ts.tv_sec = static_cast<time_t>(timeout.totalSeconds());
+		ts.tv_nsec = static_cast<long>(timeout.useconds())*1000;
+		int n = kevent(_fd, 0, 0, events, MAX_EVENTS, &ts);
+		if (n < 0)
+		{
+			if (errno == EINTR) return 0;
+			throw Poco::IOException("kevent failed", Poco::Error::getMessage(Poco::Error::last()));
+		}
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (int i = 0; i < n; ++i)
+		{
+			if (events[i].filter == EVFILT_USER) continue;
+			SocketMap::const_iterator it = _sockets.find(static_cast<poco_socket_t>(events[i].ident));
+			if (it == _sockets.end()) continue;
+			int mode = 0;
+			if (events[i].filter == EVFILT_READ) mode |= Socket::SELECT_READ;
+			if (events[i].filter == EVFILT_WRITE) mode |= Socket::SELECT_WRITE;
+			if (events[i].flags & EV_ERROR) mode |= Socket::SELECT_ERROR;
+			mode &= it->second.second;
+			if (mode) ready.push_back(std::make_pair(it->second.first, mode));
+		}
+#else
+		Socket::SocketList readList;
+		Socket::SocketList writeList;
+		Socket::SocketList exceptList;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (SocketMap::const_iterator it = _sockets.begin(); it != _sockets.end(); ++it)
+			{
+				if (it->second.second & Socket::SELECT_READ) readList.push_back(it->second.first);
+				if (it->second.second & Socket::SELECT_WRITE) writeList.push_back(it->second.first);
+				if (it->second.second & Socket::SELECT_ERROR) exceptList.push_back(it->second.first);
+			}
+		}
+		if (readList.empty() && writeList.empty() && exceptList.empty()) return 0;
+		Socket::select(readList, writeList, exceptList, timeout);
+		std::map<poco_socket_t, int> modes;
+		for (Socket::SocketList::iterator it = readList.begin(); it != readList.end(); ++it)
+			modes[it->impl()->sockfd()] |= Socket::SELECT_READ;
+		for (Socket::SocketList::iterator it = writeList.begin(); it != writeList.end(); ++it)
+			modes[it->impl()->sockfd()] |= Socket::SELECT_WRITE;
+		for (Socket::SocketList::iterator it = exceptList.begin(); it != exceptList.end(); ++it)
+			modes[it->impl()->sockfd()] |= Socket::SELECT_ERROR;
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (std::map<poco_socket_t, int>::const_iterator it = modes.begin(); it != modes.end(); ++it)
+		{
+			SocketMap::const_iterator itSocket = _sockets.find(it->first);
+			if (itSocket != _sockets.end()) ready.push_back(std::make_pair(itSocket->second.first, it->second));
+		}
+#endif
+		return static_cast<int>(ready.size());
+	}
+
+	void wakeUp()
+		/// Interrupts a thread waiting in poll().
+		///
+		/// If neither epoll nor kqueue is available, poll()
+		/// returns after its timeout only.
+	{
+#if defined(POCO_POLLSET_EPOLL)
+		Poco::UInt64 value = 1;
+		ssize_t rc = ::write(_wakeFd, &value, sizeof(value));
+		(void) rc;
+#elif defined(POCO_POLLSET_KQUEUE)
+		struct kevent ev;
+		EV_SET(&ev, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, 0);
+		kevent(_fd, &ev, 1, 0, 0, 0);
+#endif
+	}
+
+protected:
+	enum
+	{
+		MAX_EVENTS = 256
+	};
+
+	typedef std::map<poco_socket_t, std::pair<Socket, int> > SocketMap;
+
+	void control(poco_socket_t fd, int oldMode, int mode, bool registered)
+	{
+#if defined(POCO_POLLSET_EPOLL)
+		if (mode == 0)
+		{
+			if (registered) epoll_ctl(_fd, EPOLL_CTL_DEL, fd, 0);
+			return;
+		}
+		struct epoll_event ev;
+		ev.events = 0;
+		if (mode & Socket::SELECT_READ) ev.events |= EPOLLIN;
+		if (mode & Socket::SELECT_WRITE) ev.events |= EPOLLOUT;
+		if (mode & Socket::SELECT_ERROR) ev.events |= EPOLLPRI;
+		ev.data.fd = fd;
+		if (epoll_ctl(_fd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0)
+		{
+			throw Poco::IOException("Cannot register socket with epoll", Poco::Error::getMessage(Poco::Error::last()));
+		}
+#elif defined(POCO_POLLSET_KQUEUE)
+		(void) registered;
+		struct kevent ev[2];
+		int n = 0;
+		if ((mode & Socket::SELECT_READ) != (oldMode & Socket::SELECT_READ))
+		{
+			EV_SET(&ev[n++], fd, EVFILT_READ, (mode & Socket::SELECT_READ) ? EV_ADD : EV_DELETE, 0, 0, 0);
+		}
+		if ((mode & Socket::SELECT_WRITE) != (oldMode & Socket::SELECT_WRITE))
+		{
+			EV_SET(&ev[n++], fd, EVFILT_WRITE, (mode & Socket::SELECT_WRITE) ? EV_ADD : EV_DELETE, 0, 0, 0);
+		}
+		if (n > 0) kevent(_fd, ev, n, 0, 0, 0);
+		return;
+#endif
+		(void) fd;
+		(void) oldMode;
+		(void) mode;
+		(void) registered;
+	}
+
+private:
+	PollSet(const PollSet&);
+	PollSet& operator = (const PollSet&);
+
+	int _fd;
+	int _wakeFd;
+	SocketMap _sockets;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_PollSet_INCLUDED
@@ -0,0 +1,206 @@
+//
+// SocketStreamCopier.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Sockets
+// Module:  SocketStreamCopier
+//
+// Definition of the SocketStreamCopier class.
+//
+// Copyright (c) 2005-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_SocketStreamCopier_INCLUDED
+#define Net_SocketStreamCopier_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/SocketStream.h"
+#include "Poco/Net/StreamSocketImpl.h"
+#include "Poco/FastStreamCopier.h"
+#include "Poco/FileStream.h"
+#include "Poco/Buffer.h"
+#include "Poco/Exception.h"
+#include <istream>
+#include <ostream>
+
+
+namespace Poco {
+namespace Net {
+
+
+class SocketStreamCopier
+	/// This class provides static methods to copy between socket
+	/// streams (SocketStream, SocketInputStream, SocketOutputStream)
+	/// and files or other socket streams in the kernel, with
+	/// FastStreamCopier::copyDescriptor(), instead of through
+	/// the stream buffers.
+	///
+	/// Data already buffered by an input socket stream is copied first,
+	/// and an output stream is flushed before the kernel copy begins.
+	/// Afterwards, the reading position of an input socket stream is
+	/// past the copied data, as if it had been read through the stream.
+	///
+	/// Streams on TLS connections, and streams other than socket streams,
+	/// are copied with FastStreamCopier::copyStream().
+	///
+	/// All methods return the number of bytes copied.
+	///
+	///     SocketStream str(socket);
+	///     Poco::UInt64 n = SocketStreamCopier::receiveFile(str, path, contentLength);
+{
+public:
+	static int descriptorOf(std::ios& ios)
+		/// Returns the descriptor of the socket of the given stream, if it
+		/// is a socket stream on a plain (non-TLS) socket, or -1 otherwise.
+	{
+		SocketStreamBuf* pBuf = dynamic_cast<SocketStreamBuf*>(ios.rdbuf());
+		if (!pBuf || !pBuf->socketImpl() || pBuf->socketImpl()->secure()) return -1;
+		return static_cast<int>(pBuf->socketImpl()->sockfd());
+	}
+
+	static Poco::UInt64 copyStream(std::istream& istr, std::ostream& ostr, std::size_t bufferSize = Poco::FastStreamCopier::DEFAULT_BUFFER_SIZE)
+		/// Writes all bytes readable from istr to ostr, with splice()
+		/// if both are socket streams.
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		int fdIn = descriptorOf(istr);
+		int fdOut = descriptorOf(ostr);
+		if (fdIn >= 0 && fdOut >= 0)
+		{
+			Poco::UInt64 n = drain(istr, ostr, ~Poco::UInt64(0));
+			ostr.flush();
+			if (!ostr.good()) throw Poco::WriteFileException("Cannot write to socket stream");
+			return n + Poco::FastStreamCopier::copyDescriptor(fdIn, fdOut, ~Poco::UInt64(0), bufferSize);
+		}
+#endif
+		return Poco::FastStreamCopier::copyStream(istr, ostr, bufferSize);
+	}
+
+	static Poco::UInt64 sendFile(const std::string& path, std::ostream& ostr, std::size_t bufferSize = Poco::FastStreamCopier::DEFAULT_BUFFER_SIZE)
+		/// Writes the content of the given file to ostr, with
+		/// sendfile() if ostr is a socket stream.
+	{
+		Poco::FileInputStream istr(path);
+		if (!istr.good()) throw Poco::OpenFileException(path);
+#if defined(POCO_OS_FAMILY_UNIX)
+		int fdOut = descriptorOf(ostr);
+		if (fdOut >= 0)
+		{
+			ostr.flush();
+			if (!ostr.good()) throw Poco::WriteFileException("Cannot write to socket stream", path);
+			istr.close();
+			FileDescriptor file(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+			if (file.fd < 0) throw Poco::OpenFileException(path);
+			return Poco::FastStreamCopier::copyDescriptor(file.fd, fdOut, ~Poco::UInt64(0), bufferSize);
+		}
+#endif
+		return Poco::FastStreamCopier::copyStream(istr, ostr, bufferSize);
+	}
+
+	static Poco::UInt64 receiveFile(std::istream& istr, const std::string& path, Poco::UInt64 length = ~Poco::UInt64(0), std::size_t bufferSize = Poco::FastStreamCopier::DEFAULT_BUFFER_SIZE)
+		/// Writes length bytes, or all bytes readable, from istr to the
+		/// given file, which is created or truncated, with splice() if
+		/// istr is a socket stream.
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		int fdIn = descriptorOf(istr);
+		if (fdIn >= 0)
+		{
+			FileDescriptor file(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+			if (file.fd < 0) throw Poco::CreateFileException(path);
+			Poco::UInt64 n = drain(istr, file.fd, length);
+			n += Poco::FastStreamCopier::copyDescriptor(fdIn, file.fd, length - n, bufferSize);
+			int fd = file.fd;
+			file.fd = -1;
+			if (::close(fd) != 0) throw Poco::WriteFileException(path);
+			return n;
+		}
+#endif
+		Poco::FileOutputStream ostr(path);
+		if (!ostr.good()) throw Poco::CreateFileException(path);
+		Poco::UInt64 n = 0;
+		if (length == ~Poco::UInt64(0))
+		{
+			n = Poco::FastStreamCopier::copyStream(istr, ostr, bufferSize);
+		}
+		else
+		{
+			Poco::Buffer<char> buffer(bufferSize > 0 ? bufferSize : 1);
+			while (n < length && istr.good())
+			{
+				istr.read(buffer.begin(), static_cast<std::streamsize>(length - n < buffer.size() ? length - n : buffer.size()));
+				std::streamsize k = istr.gcount();
+				if (k <= 0) break;
+				ostr.write(buffer.begin(), k);
+				n += static_cast<Poco::UInt64>(k);
+			}
+		}
+		ostr.close();
+		if (!ostr.good()) throw Poco::WriteFileException(path);
+		return n;
+	}
+
+protected:
+#if defined(POCO_OS_FAMILY_UNIX)
+	struct FileDescriptor
+	{
+		explicit FileDescriptor(int f): fd(f)
+		{
+		}
+
+		~FileDescriptor()
+		{
+			if (fd >= 0) ::close(fd);
+		}
+
+		int fd;
+	};
+
+	static Poco::UInt64 drain(std::istream& istr, std::ostream& ostr, Poco::UInt64 length)
+		/// Writes at most length of the bytes buffered by istr to ostr.
+	{
+		std::streamsize n = buffered(istr, length);
+		if (n <= 0) return 0;
+		Poco::Buffer<char> buffer(static_cast<std::size_t>(n));
+		n = istr.rdbuf()->sgetn(buffer.begin(), n);
+		ostr.write(buffer.begin(), n);
+		return static_cast<Poco::UInt64>(n);
+	}
+
+	static Poco::UInt64 drain(std::istream& istr, int fd, Poco::UInt64 length)
+		/// Writes at most length of the bytes buffered by istr to fd.
+	{
+		std::streamsize n = buffered(istr, length);
+		if (n <= 0) return 0;
+		Poco::Buffer<char> buffer(static_cast<std::size_t>(n));
+		n = istr.rdbuf()->sgetn(buffer.begin(), n);
+		Poco::FastStreamCopier::writeDescriptor(fd, buffer.begin(), static_cast<std::size_t>(n));
+		return static_cast<Poco::UInt64>(n);
+	}
+
+	static std::streamsize buffered(std::istream& istr, Poco::UInt64 length)
+	{
+		std::streamsize n = istr.rdbuf()->in_avail();
+		if (n > 0 && static_cast<Poco::UInt64>(n) > length) n = static_cast<std::streamsize>(length);
+		return n;
+	}
+#endif
+
+private:
+	SocketStreamCopier();
+	SocketStreamCopier(const SocketStreamCopier&);
+	SocketStreamCopier& operator = (const SocketStreamCopier&);
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_SocketStreamCopier_INCLUDED
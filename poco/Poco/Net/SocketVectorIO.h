@@ -0,0 +1,254 @@
+//
+// SocketVectorIO.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Sockets
+// Module:  SocketVectorIO
+//
+// Definition of the SocketVectorIO class.
+//
+// Copyright (c) 2005-2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_SocketVectorIO_INCLUDED
+#define Net_SocketVectorIO_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/SocketDefs.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/FIFOBuffer.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#if !defined(POCO_OS_FAMILY_WINDOWS)
+#include <sys/uio.h>
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+#if defined(POCO_OS_FAMILY_WINDOWS)
+typedef WSABUF SocketBuf;
+#else
+typedef struct iovec SocketBuf;
+#endif
+typedef std::vector<SocketBuf> SocketBufVec;
+
+
+class SocketVectorIO
+	/// Scatter/gather I/O for StreamSocket.
+	///
+	/// sendBytes() sends the contents of several buffers, and
+	/// receiveBytes() fills several buffers, with a single system
+	/// call (sendmsg()/recvmsg(), or WSASend()/WSARecv() on Windows),
+	/// so that, for instance, a header and a payload can be sent
+	/// without first copying them into one buffer.
+	///
+	/// The FIFOBuffer overloads send the readable contents of two
+	/// FIFOBuffers and drain what has been sent, or fill the writable
+	/// space of two FIFOBuffers and advance them by what has been
+	/// received, without an intermediate buffer.
+	///
+	/// Errors are reported like StreamSocket does: a TimeoutException
+	/// if a timeout has been set and has expired, -1 if a non-blocking
+	/// socket would block, and a NetException (or a subclass) for
+	/// other errors.
+{
+public:
+	static SocketBuf makeBuffer(void* buffer, std::size_t length)
+		/// Returns a SocketBuf for the given buffer.
+	{
+		SocketBuf buf;
+#if defined(POCO_OS_FAMILY_WINDOWS)
+		buf.buf = reinterpret_cast<char*>(buffer);
+		buf.len = static_cast<u_long>(length);
+#else
+		buf.iov_base = buffer;
+		buf.iov_len  = length;
+#endif
+		return buf;
+	}
+
+	static int sendBytes(StreamSocket& socket, const SocketBufVec& buffers, int flags = 0)
+		/// Sends the contents of the given buffers through the socket.
+		///
+		/// Returns the number of bytes sent, which may be less than
+		/// the total size of the buffers.
+	{
+		if (buffers.empty()) return 0;
+		return sendBuffers(socket, &const_cast<SocketBufVec&>(buffers)[0], buffers.size(), flags);
+	}
+
+	static int receiveBytes(StreamSocket& socket, SocketBufVec& buffers, int flags = 0)
+		/// Receives data from the socket and stores it in the given
+		/// buffers, filling one after the other.
+		///
+		/// Returns the number of bytes received. A return value of 0
+		/// means a graceful shutdown of the connection from the peer.
+	{
+		if (buffers.empty()) return 0;
+		return receiveBuffers(socket, &buffers[0], buffers.size(), flags);
+	}
+
+	static int sendBytes(StreamSocket& socket, Poco::FIFOBuffer& head, Poco::FIFOBuffer& body)
+		/// Sends the contents of head, followed by the contents of
+		/// body, through the socket, and drains the bytes sent from
+		/// both buffers.
+		///
+		/// Returns the number of bytes sent.
+	{
+		Poco::ScopedLock<Mutex> lockHead(head.mutex());
+		Poco::ScopedLock<Mutex> lockBody(body.mutex());
+		SocketBuf buffers[2];
+		std::size_t n = 0;
+		std::size_t headUsed = head.used();
+		if (headUsed > 0) buffers[n++] = makeBuffer(head.begin(), headUsed);
+		if (body.used() > 0) buffers[n++] = makeBuffer(body.begin(), body.used());
+		if (n == 0) return 0;
+		int rc = sendBuffers(socket, buffers, n, 0);
+		if (rc > 0)
+		{
+			std::size_t sent = static_cast<std::size_t>(rc);
+			if (sent >= headUsed)
+			{
+				if (headUsed > 0) head.drain(headUsed);
+				if (sent > headUsed) body.drain(sent - headUsed);
+			}
+			else head.drain(sent);
+		}
+		return rc;
+	}
+
+	static int receiveBytes(StreamSocket& socket, Poco::FIFOBuffer& buffer, Poco::FIFOBuffer& overflow)
+		/// Receives data from the socket into the writable space of
+		/// buffer, and what does not fit into buffer into the writable
+		/// space of overflow, and advances both buffers accordingly.
+		///
+		/// Returns the number of bytes received. A return value of 0
+		/// means a graceful shutdown of the connection from the peer.
+	{
+		Poco::ScopedLock<Mutex> lockBuffer(buffer.mutex());
+		Poco::ScopedLock<Mutex> lockOverflow(overflow.mutex());
+		SocketBuf buffers[2];
+		std::size_t n = 0;
+		std::size_t available = buffer.available();
+		if (available > 0) buffers[n++] = makeBuffer(buffer.next(), available);
+		if (overflow.available() > 0) buffers[n++] = makeBuffer(overflow.next(), overflow.available());
+		if (n == 0) return 0;
+		int rc = receiveBuffers(socket, buffers, n, 0);
+		if (rc > 0)
+		{
+			std::size_t received = static_cast<std::size_t>(rc);
+			if (received > available)
+			{
+				if (available > 0) buffer.advance(available);
+				overflow.advance(received - available);
+			}
+			else buffer.advance(received);
+		}
+		return rc;
+	}
+
+private:
+	SocketVectorIO();
+
+	static int sendBuffers(StreamSocket& socket, SocketBuf* pBuffers, std::size_t count, int flags)
+	{
+		poco_socket_t fd = socket.impl()->sockfd();
+		if (fd == POCO_INVALID_SOCKET) throw InvalidSocketException();
+		int rc;
+#if defined(POCO_OS_FAMILY_WINDOWS)
+		DWORD sent = 0;
+		rc = WSASend(fd, pBuffers, static_cast<DWORD>(count), &sent, static_cast<DWORD>(flags), 0, 0);
+		if (rc == 0) rc = static_cast<int>(sent);
+#else
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov    = pBuffers;
+		msg.msg_iovlen = count;
+#if defined(MSG_NOSIGNAL)
+		flags |= MSG_NOSIGNAL;
+#endif
+		do
+		{
+			rc = static_cast<int>(::sendmsg(fd, &msg, flags));
+		}
+		while (rc < 0 && lastError() == POCO_EINTR);
+#endif
+		if (rc < 0) handleError(socket);
+		return rc;
+	}
+
+	static int receiveBuffers(StreamSocket& socket, SocketBuf* pBuffers, std::size_t count, int flags)
+	{
+		poco_socket_t fd = socket.impl()->sockfd();
+		if (fd == POCO_INVALID_SOCKET) throw InvalidSocketException();
+		int rc;
+#if defined(POCO_OS_FAMILY_WINDOWS)
+		DWORD received = 0;
+		DWORD wsaFlags = static_cast<DWORD>(flags);
+		rc = WSARecv(fd, pBuffers, static_cast<DWORD>(count), &received, &wsaFlags, 0, 0);
+		if (rc == 0) rc = static_cast<int>(received);
+#else
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov    = pBuffers;
+		msg.msg_iovlen = count;
+		do
+		{
+			rc = static_cast<int>(::recvmsg(fd, &msg, flags));
+		}
+		while (rc < 0 && lastError() == POCO_EINTR);
+#endif
+		if (rc < 0) handleError(socket);
+		return rc;
+	}
+
+	static int lastError()
+	{
+#if defined(POCO_OS_FAMILY_WINDOWS)
+		return WSAGetLastError();
+#else
+		return errno;
+#endif
+	}
+
+	static void handleError(StreamSocket& socket)
+	{
+		int err = lastError();
+		if (err == POCO_EAGAIN && !socket.getBlocking())
+			return;
+		if (err == POCO_EAGAIN || err == POCO_ETIMEDOUT)
+			throw Poco::TimeoutException(err);
+		switch (err)
+		{
+		case POCO_ECONNRESET:
+			throw ConnectionResetException(err);
+		case POCO_ECONNABORTED:
+			throw ConnectionAbortedException(err);
+		case POCO_ENOTCONN:
+			throw NetException("Socket is not connected", err);
+		default:
+			throw NetException(Poco::Error::getMessage(err), err);
+		}
+	}
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_SocketVectorIO_INCLUDED
@@ -32,6 +32,8 @@
 #include <limits>
 #include <cmath>
 #include <cctype>
+#include <cstring>
+#include <cfloat>
 #if !defined(POCO_NO_LOCALE)
 	#include <locale>
 #endif
@@ -46,6 +48,15 @@
 #define POCO_FLT_NAN "nan"
 #define POCO_FLT_EXP 'e'
 
+// double arithmetic is done in double precision (not in x87 extended precision)
+#if defined(FLT_EVAL_METHOD)
+	#if FLT_EVAL_METHOD == 0
+		#define POCO_FLT_EVAL_DOUBLE 1
+	#endif
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__) || defined(_M_ARM64) || defined(__SSE2_MATH__)
+	#define POCO_FLT_EVAL_DOUBLE 1
+#endif
+
 
 namespace Poco {
 
@@ -254,6 +265,86 @@ namespace Impl {
 		const char* _end;
 };	
 
+	inline const char* digitPairs()
+		/// Returns the two-digit decimal representations of
+		/// the numbers 0 to 99, one after the other.
+	{
+		return
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+	}
+
+	inline char* formatDecimal(UInt64 value, char* end)
+		/// Writes the decimal digits of value backwards into the
+		/// characters before end, two digits at a time, and returns
+		/// a pointer to the first digit.
+	{
+		const char* pairs = digitPairs();
+		while (value >= 100)
+		{
+			unsigned i = static_cast<unsigned>(value % 100)*2;
+			value /= 100;
+			*--end = pairs[i + 1];
+			*--end = pairs[i];
+		}
+		if (value >= 10)
+		{
+			unsigned i = static_cast<unsigned>(value)*2;
+			*--end = pairs[i + 1];
+			*--end = pairs[i];
+		}
+		else *--end = static_cast<char>('0' + value);
+		return end;
+	}
+
+	inline std::size_t decimalDigits(UInt64 value)
+		/// Returns the number of decimal digits of value.
+	{
+		std::size_t n = 1;
+		for (; value >= 10000; value /= 10000) n += 4;
+		if (value >= 1000) return n + 3;
+		if (value >= 100) return n + 2;
+		if (value >= 10) return n + 1;
+		return n;
+	}
+
+	inline void decimalToStr(bool negative, UInt64 value, char* result, std::size_t& size, int width, char fill)
+		/// Formats a decimal number without thousand separators,
+		/// for intToStr() and uIntToStr(), with the same padding
+		/// as the generic code, but without reversing the result.
+		/// Throws a RangeException if the result, including the
+		/// terminating zero, does not fit into size characters.
+	{
+		std::size_t digits = decimalDigits(value);
+		std::size_t length = digits + (negative ? 1 : 0);
+		std::size_t padding = (width > 0 && length < std::size_t(width)) ? width - length : 0;
+		if (length + padding >= size) throw RangeException();
+
+		char* p = result;
+		if ('0' == fill)
+		{
+			if (negative) *p++ = '-';
+			for (; padding > 0; --padding) *p++ = '0';
+		}
+		else
+		{
+			for (; padding > 0; --padding) *p++ = fill;
+			if (negative) *p++ = '-';
+		}
+		p += digits;
+		formatDecimal(value, p);
+		*p = '\0';
+		size = p - result;
+	}
+
 } // namespace Impl
 
 
@@ -280,6 +371,16 @@ bool intToStr(T value,
 		return false;
 	}
 
+	if (base == 10 && thSep == 0)
+	{
+		// fast path for the common case
+		if (value < 0)
+			Impl::decimalToStr(true, UInt64(0) - UInt64(value), result, size, width, fill);
+		else
+			Impl::decimalToStr(false, UInt64(value), result, size, width, fill);
+		return true;
+	}
+
 	Impl::Ptr ptr(result, size);
 	int thCount = 0;
 	T tmpVal;
@@ -358,6 +459,13 @@ bool uIntToStr(T value,
 		return false;
 	}
 	
+	if (base == 10 && thSep == 0)
+	{
+		// fast path for the common case
+		Impl::decimalToStr(false, UInt64(value), result, size, width, fill);
+		return true;
+	}
+
 	Impl::Ptr ptr(result, size);
 	int thCount = 0;
 	T tmpVal;
@@ -556,6 +664,165 @@ Foundation_API bool strToDouble(const std::string& str, double& result, char dec
 	/// Returns true if succesful, false otherwise.
 
 
+//
+// Parsing of Character Ranges
+//
+
+template <typename I>
+const char* parseDecimal(const char* first, const char* last, I& result)
+	/// Parses a decimal integer from the beginning of the characters
+	/// in [first, last), like std::from_chars(): an optional minus sign
+	/// (for signed types only), followed by one or more digits. Leading
+	/// whitespace, a plus sign and thousand separators are not accepted.
+	///
+	/// Returns a pointer to the first character after the number.
+	/// If the range does not begin with a number, or the number does
+	/// not fit into I, returns a null pointer and leaves result unchanged.
+	/// The characters do not have to be zero-terminated, and no memory is
+	/// allocated, so that tokens can be parsed in place.
+{
+	const char* p = first;
+	bool negative = false;
+	if (std::numeric_limits<I>::is_signed && p != last && *p == '-')
+	{
+		negative = true;
+		++p;
+	}
+	const UInt64 limit = UInt64(std::numeric_limits<I>::max()) + (negative ? 1 : 0);
+	const UInt64 limitDiv = limit/10;
+	const unsigned limitMod = static_cast<unsigned>(limit % 10);
+	const char* pDigits = p;
+	UInt64 value = 0;
+	for (; p != last; ++p)
+	{
+		unsigned digit = static_cast<unsigned char>(*p) - '0';
+		if (digit > 9) break;
+		if (value >= limitDiv && (value > limitDiv || digit > limitMod)) return 0;
+		value = value*10 + digit;
+	}
+	if (p == pDigits) return 0;
+	if (negative)
+		result = static_cast<I>(-static_cast<I>(value - 1) - 1);
+	else
+		result = static_cast<I>(value);
+	return p;
+}
+
+
+inline const char* parseDouble(const char* first, const char* last, double& result)
+	/// Parses a floating-point number from the beginning of the characters
+	/// in [first, last), like std::from_chars(): an optional minus sign,
+	/// digits with an optional decimal point, and an optional exponent.
+	/// Leading whitespace, a plus sign, thousand separators, infinity
+	/// and NaN are not accepted, and the decimal separator is always '.'.
+	///
+	/// Returns a pointer to the first character after the number.
+	/// If the range does not begin with a number, or the number is
+	/// out of range, returns a null pointer and leaves result unchanged.
+	///
+	/// Numbers with up to 15 significant digits and a small exponent,
+	/// like the vast majority of numbers found in JSON documents and
+	/// configuration files, are converted exactly with a single
+	/// multiplication or division. All other numbers are converted
+	/// with strToDouble().
+{
+	const int MAX_DIGITS = 19; // a 19-digit mantissa always fits into UInt64
+
+	const char* p = first;
+	bool negative = false;
+	if (p != last && *p == '-')
+	{
+		negative = true;
+		++p;
+	}
+	UInt64 mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool haveDigits = false;
+	for (; p != last && *p == '0'; ++p) haveDigits = true;
+	for (; p != last && static_cast<unsigned>(*p - '0') < 10; ++p)
+	{
+		if (digits < MAX_DIGITS)
+			mantissa = mantissa*10 + (*p - '0');
+		else
+			++exponent;
+		++digits;
+		haveDigits = true;
+	}
+	if (p != last && *p == '.')
+	{
+		++p;
+		if (digits == 0)
+		{
+			for (; p != last && *p == '0'; ++p)
+			{
+				--exponent;
+				haveDigits = true;
+			}
+		}
+		for (; p != last && static_cast<unsigned>(*p - '0') < 10; ++p)
+		{
+			if (digits < MAX_DIGITS)
+			{
+				mantissa = mantissa*10 + (*p - '0');
+				--exponent;
+			}
+			++digits;
+			haveDigits = true;
+		}
+	}
+	if (!haveDigits) return 0;
+	if (p != last && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+		bool negativeExponent = false;
+		if (q != last && (*q == '+' || *q == '-'))
+		{
+			negativeExponent = (*q == '-');
+			++q;
+		}
+		if (q != last && static_cast<unsigned>(*q - '0') < 10)
+		{
+			int exp = 0;
+			for (; q != last && static_cast<unsigned>(*q - '0') < 10; ++q)
+			{
+				if (exp < 100000) exp = exp*10 + (*q - '0');
+			}
+			exponent += negativeExponent ? -exp : exp;
+			p = q;
+		}
+	}
+
+#if defined(POCO_FLT_EVAL_DOUBLE)
+	// Clinger's fast path: both the mantissa and the power of ten are
+	// exact doubles, so the correctly rounded result of a single
+	// multiplication or division is the correctly rounded value.
+	static const double powersOf10[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+		1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const UInt64 MAX_EXACT_MANTISSA = UInt64(1) << 53;
+	if (digits <= MAX_DIGITS && mantissa <= MAX_EXACT_MANTISSA && exponent >= -22 && exponent <= 22)
+	{
+		double value = static_cast<double>(mantissa);
+		if (exponent < 0)
+			value /= powersOf10[-exponent];
+		else
+			value *= powersOf10[exponent];
+		result = negative ? -value : value;
+		return p;
+	}
+#endif
+
+	double value;
+	if (!strToDouble(std::string(first, p), value)) return 0;
+	result = value;
+	return p;
+}
+
+
 } // namespace Poco
 
 
@@ -0,0 +1,475 @@
+//
+// AsyncBundleEvents.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Bundle
+// Module:  AsyncBundleEvents
+//
+// Definition of the EventStrandDispatcher, AsyncBundleEvents and
+// AsyncSystemEvents classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_AsyncBundleEvents_INCLUDED
+#define OSP_AsyncBundleEvents_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/BundleEvents.h"
+#include "Poco/OSP/BundleEvent.h"
+#include "Poco/OSP/SystemEvents.h"
+#include "Poco/Delegate.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/ScopedUnlock.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <deque>
+#include <map>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class EventStrandDispatcher: protected Poco::Runnable
+	/// EventStrandDispatcher runs tasks on a fixed number of worker
+	/// threads. Tasks are posted to strands, identified by an integer
+	/// key. The tasks of a strand run one after the other, in the order
+	/// in which they have been posted; tasks of different strands run
+	/// concurrently.
+{
+public:
+	class Task
+		/// A task posted to an EventStrandDispatcher.
+	{
+	public:
+		virtual ~Task()
+		{
+		}
+
+		virtual void run() = 0;
+	};
+
+	enum
+	{
+		DEFAULT_WORKERS = 2
+	};
+
+	explicit EventStrandDispatcher(int workers = DEFAULT_WORKERS):
+		_pending(0),
+		_stopped(false)
+		/// Creates the EventStrandDispatcher and starts the
+		/// given number of worker threads.
+	{
+		if (workers < 1) workers = 1;
+		for (int i = 0; i < workers; ++i)
+		{
+			Poco::Thread* pThread = new Poco::Thread("OSP.EventDispatcher");
+			_threads.push_back(pThread);
+			pThread->start(*this);
+		}
+	}
+
+	~EventStrandDispatcher()
+		/// Delivers all pending tasks, stops the
+		/// worker threads and destroys the dispatcher.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_stopped = true;
+			_changed.broadcast();
+		}
+		for (std::vector<Poco::Thread*>::iterator it = _threads.begin(); it != _threads.end(); ++it)
+		{
+			(*it)->join();
+			delete *it;
+		}
+	}
+
+	void post(Poco::Int64 strand, Task* pTask)
+		/// Appends the task to the given strand. The dispatcher
+		/// takes ownership of the task.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Strand& s = _strands[strand];
+		s.tasks.push_back(pTask);
+		++_pending;
+		if (!s.scheduled)
+		{
+			s.scheduled = true;
+			_ready.push_back(strand);
+			_changed.signal();
+		}
+	}
+
+	void barrier(Poco::Int64 strand)
+		/// Waits until all tasks posted to the given strand
+		/// have been run.
+		///
+		/// Must not be called from a task.
+	{
+		poco_assert (!isWorker());
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (;;)
+		{
+			StrandMap::const_iterator it = _strands.find(strand);
+			if (it == _strands.end()) return;
+			_changed.wait(_mutex);
+		}
+	}
+
+	void barrier()
+		/// Waits until all tasks posted to any strand have been run.
+		///
+		/// Must not be called from a task.
+	{
+		poco_assert (!isWorker());
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		while (_pending > 0) _changed.wait(_mutex);
+	}
+
+	bool tryBarrier(long milliseconds)
+		/// Waits up to the given time until all tasks posted to any
+		/// strand have been run, and returns true if they have.
+		///
+		/// Must not be called from a task.
+	{
+		poco_assert (!isWorker());
+
+		Poco::Timestamp start;
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		while (_pending > 0)
+		{
+			long remaining = milliseconds - static_cast<long>(start.elapsed()/1000);
+			if (remaining <= 0 || !_changed.tryWait(_mutex, remaining)) return _pending == 0;
+		}
+		return true;
+	}
+
+	bool isWorker() const
+		/// Returns true if called from one of the worker threads.
+	{
+		Poco::Thread* pCurrent = Poco::Thread::current();
+		for (std::vector<Poco::Thread*>::const_iterator it = _threads.begin(); it != _threads.end(); ++it)
+		{
+			if (*it == pCurrent) return true;
+		}
+		return false;
+	}
+
+protected:
+	struct Strand
+	{
+		Strand():
+			scheduled(false)
+		{
+		}
+
+		std::deque<Task*> tasks;
+		bool scheduled;
+	};
+
+	typedef std::map<Poco::Int64, Strand> StrandMap;
+
+	void run()
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (;;)
+		{
+			if (_ready.empty())
+			{
+				if (_stopped && _pending == 0) return;
+				_changed.wait(_mutex);
+				continue;
+			}
+			Poco::Int64 key = _ready.front();
+			_ready.pop_front();
+			for (;;)
+			{
+				StrandMap::iterator it = _strands.find(key);
+				if (it->second.tasks.empty())
+				{
+					_strands.erase(it);
+					break;
+				}
+				Task* pTask = it->second.tasks.front();
+				it->second.tasks.pop_front();
+				{
+					Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+					try
+					{
+						pTask->run();
+					}
+					catch (...)
+					{
+					}
+					delete pTask;
+				}
+				--_pending;
+			}
+			_changed.broadcast();
+		}
+	}
+
+private:
+	EventStrandDispatcher(const EventStrandDispatcher&);
+	EventStrandDispatcher& operator = (const EventStrandDispatcher&);
+
+	std::vector<Poco::Thread*> _threads;
+	StrandMap _strands;
+	std::deque<Poco::Int64> _ready;
+	std::size_t _pending;
+	bool _stopped;
+	Poco::Condition _changed;
+	Poco::FastMutex _mutex;
+};
+
+
+class AsyncBundleEvents: public BundleEvents
+	/// AsyncBundleEvents relays the events of a BundleEvents object,
+	/// usually the one of the BundleLoader, to its own events, which
+	/// are fired on the worker threads of an EventStrandDispatcher.
+	///
+	/// Listeners subscribed to AsyncBundleEvents therefore do not delay
+	/// the BundleLoader. The events of a bundle are delivered in the
+	/// order in which they have been fired; events of different bundles
+	/// may be delivered concurrently.
+	///
+	/// Listeners that need synchronous semantics, e.g. a bundle that
+	/// must have been processed by a listener before it is used, either
+	/// subscribe to the BundleLoader's events directly, or call barrier().
+	///
+	/// Usage example:
+	///
+	///     EventStrandDispatcher dispatcher;
+	///     AsyncBundleEvents events(loader.events(), dispatcher);
+	///     events.bundleStarted += Poco::delegate(this, &MyListener::onBundleStarted);
+	///     ...
+	///     events.barrier(pBundle);
+{
+public:
+	AsyncBundleEvents(BundleEvents& source, EventStrandDispatcher& dispatcher):
+		_source(source),
+		_dispatcher(dispatcher)
+		/// Creates the AsyncBundleEvents and subscribes
+		/// to all events of source.
+	{
+		subscribe(true);
+	}
+
+	~AsyncBundleEvents()
+		/// Unsubscribes from the source events and waits until
+		/// all pending events have been delivered.
+	{
+		try
+		{
+			subscribe(false);
+			if (!_dispatcher.isWorker()) _dispatcher.barrier();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void barrier(Bundle::ConstPtr pBundle)
+		/// Waits until all events of the given bundle fired so far
+		/// have been delivered to the listeners.
+		///
+		/// Must not be called from a listener.
+	{
+		_dispatcher.barrier(static_cast<Poco::Int64>(pBundle->id()));
+	}
+
+	void barrier()
+		/// Waits until all events fired so far have
+		/// been delivered to the listeners.
+		///
+		/// Must not be called from a listener.
+	{
+		_dispatcher.barrier();
+	}
+
+protected:
+	class DeliverTask: public EventStrandDispatcher::Task
+	{
+	public:
+		DeliverTask(AsyncBundleEvents& events, const BundleEvent& event):
+			_events(events),
+			_event(event)
+		{
+		}
+
+		void run()
+		{
+			_events.deliver(_event);
+		}
+
+	private:
+		AsyncBundleEvents& _events;
+		BundleEvent _event;
+	};
+
+	void subscribe(bool add)
+	{
+		Poco::BasicEvent<BundleEvent>* events[] =
+		{
+			&_source.bundleInstalled, &_source.bundleLoaded, &_source.bundleResolving, &_source.bundleResolved,
+			&_source.bundleStarting, &_source.bundleStarted, &_source.bundleStopping, &_source.bundleStopped,
+			&_source.bundleUninstalling, &_source.bundleUninstalled, &_source.bundleUnloaded, &_source.bundleFailed
+		};
+		for (std::size_t i = 0; i < sizeof(events)/sizeof(events[0]); ++i)
+		{
+			if (add)
+				*events[i] += Poco::delegate(this, &AsyncBundleEvents::onEvent);
+			else
+				*events[i] -= Poco::delegate(this, &AsyncBundleEvents::onEvent);
+		}
+	}
+
+	void onEvent(const void*, BundleEvent& event)
+	{
+		_dispatcher.post(event.bundle()->id(), new DeliverTask(*this, event));
+	}
+
+	void deliver(BundleEvent& event)
+	{
+		switch (event.what())
+		{
+		case BundleEvent::EV_BUNDLE_INSTALLED:   bundleInstalled(this, event); break;
+		case BundleEvent::EV_BUNDLE_LOADED:      bundleLoaded(this, event); break;
+		case BundleEvent::EV_BUNDLE_RESOLVING:   bundleResolving(this, event); break;
+		case BundleEvent::EV_BUNDLE_RESOLVED:    bundleResolved(this, event); break;
+		case BundleEvent::EV_BUNDLE_STARTING:    bundleStarting(this, event); break;
+		case BundleEvent::EV_BUNDLE_STARTED:     bundleStarted(this, event); break;
+		case BundleEvent::EV_BUNDLE_STOPPING:    bundleStopping(this, event); break;
+		case BundleEvent::EV_BUNDLE_STOPPED:     bundleStopped(this, event); break;
+		case BundleEvent::EV_BUNDLE_UNINSTALLING: bundleUninstalling(this, event); break;
+		case BundleEvent::EV_BUNDLE_UNINSTALLED: bundleUninstalled(this, event); break;
+		case BundleEvent::EV_BUNDLE_UNLOADED:    bundleUnloaded(this, event); break;
+		case BundleEvent::EV_BUNDLE_FAILED:      bundleFailed(this, event); break;
+		}
+	}
+
+private:
+	AsyncBundleEvents(const AsyncBundleEvents&);
+	AsyncBundleEvents& operator = (const AsyncBundleEvents&);
+
+	BundleEvents& _source;
+	EventStrandDispatcher& _dispatcher;
+};
+
+
+class AsyncSystemEvents: public SystemEvents
+	/// AsyncSystemEvents relays the events of a SystemEvents object
+	/// to its own events, which are fired, in order, on a worker
+	/// thread of an EventStrandDispatcher.
+{
+public:
+	enum
+	{
+		SYSTEM_STRAND = -1
+			/// The strand used for system events. Bundle
+			/// events use the bundle ID as strand.
+	};
+
+	AsyncSystemEvents(SystemEvents& source, EventStrandDispatcher& dispatcher):
+		_source(source),
+		_dispatcher(dispatcher)
+		/// Creates the AsyncSystemEvents and subscribes
+		/// to all events of source.
+	{
+		_source.systemStarted += Poco::delegate(this, &AsyncSystemEvents::onSystemStarted);
+		_source.systemShuttingDown += Poco::delegate(this, &AsyncSystemEvents::onSystemShuttingDown);
+		_source.customSystemEvent += Poco::delegate(this, &AsyncSystemEvents::onCustomSystemEvent);
+	}
+
+	~AsyncSystemEvents()
+		/// Unsubscribes from the source events and waits until
+		/// all pending events have been delivered.
+	{
+		try
+		{
+			_source.systemStarted -= Poco::delegate(this, &AsyncSystemEvents::onSystemStarted);
+			_source.systemShuttingDown -= Poco::delegate(this, &AsyncSystemEvents::onSystemShuttingDown);
+			_source.customSystemEvent -= Poco::delegate(this, &AsyncSystemEvents::onCustomSystemEvent);
+			if (!_dispatcher.isWorker()) _dispatcher.barrier(static_cast<Poco::Int64>(SYSTEM_STRAND));
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void barrier()
+		/// Waits until all system events fired so far
+		/// have been delivered to the listeners.
+		///
+		/// Must not be called from a listener.
+	{
+		_dispatcher.barrier(static_cast<Poco::Int64>(SYSTEM_STRAND));
+	}
+
+protected:
+	class DeliverTask: public EventStrandDispatcher::Task
+	{
+	public:
+		DeliverTask(AsyncSystemEvents& events, Poco::BasicEvent<EventKind>& target, EventKind kind):
+			_events(events),
+			_target(target),
+			_kind(kind)
+		{
+		}
+
+		void run()
+		{
+			_target(&_events, _kind);
+		}
+
+	private:
+		AsyncSystemEvents& _events;
+		Poco::BasicEvent<EventKind>& _target;
+		EventKind _kind;
+	};
+
+	void onSystemStarted(const void*, EventKind& kind)
+	{
+		_dispatcher.post(SYSTEM_STRAND, new DeliverTask(*this, systemStarted, kind));
+	}
+
+	void onSystemShuttingDown(const void*, EventKind& kind)
+	{
+		_dispatcher.post(SYSTEM_STRAND, new DeliverTask(*this, systemShuttingDown, kind));
+	}
+
+	void onCustomSystemEvent(const void*, EventKind& kind)
+	{
+		_dispatcher.post(SYSTEM_STRAND, new DeliverTask(*this, customSystemEvent, kind));
+	}
+
+private:
+	AsyncSystemEvents(const AsyncSystemEvents&);
+	AsyncSystemEvents& operator = (const AsyncSystemEvents&);
+
+	SystemEvents& _source;
+	EventStrandDispatcher& _dispatcher;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_AsyncBundleEvents_INCLUDED
@@ -0,0 +1,329 @@
+//
+// AuthorizationCache.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Auth
+// Module:  AuthorizationCache
+//
+// Definition of the AuthorizationCache, CachingAuthService and
+// CachingAuthorizer classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_Auth_AuthorizationCache_INCLUDED
+#define OSP_Auth_AuthorizationCache_INCLUDED
+
+
+#include "Poco/OSP/Auth/AuthService.h"
+#include "Poco/RemotingNG/Authorizer.h"
+#include "Poco/RemotingNG/Context.h"
+#include "Poco/RemotingNG/Credentials.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/SHA1Engine.h"
+#include "Poco/DigestEngine.h"
+#include "Poco/HexBinary.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/ConcurrentCache.h"
+#include "Poco/Mutex.h"
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+namespace Auth {
+
+
+class AuthorizationCache: public Poco::RefCountedObject
+	/// AuthorizationCache caches authorization decisions, keyed by
+	/// subject (a user name, or a digest of the credentials) and
+	/// permission, for a limited time.
+	///
+	/// The same cache can be shared by a CachingAuthService, used
+	/// by OSP Web for protected paths, and a CachingAuthorizer, used
+	/// by RemotingNG server transports.
+	///
+	/// When the authorization policy changes, e.g. when a user's
+	/// permissions are changed, the cache must be invalidated with
+	/// invalidate(). A decision made while the cache is invalidated
+	/// is not stored, as it may have been based on the old policy:
+	/// callers obtain the generation() before evaluating a decision,
+	/// and pass it to put().
+	///
+	/// Decisions are kept in a ConcurrentCache, so that lookups by
+	/// different threads do not contend for a single mutex. When the
+	/// cache is full, decisions not looked up recently are evicted.
+	///
+	/// AuthorizationCache is thread-safe.
+{
+public:
+	typedef Poco::AutoPtr<AuthorizationCache> Ptr;
+
+	enum
+	{
+		DEFAULT_TTL = 60,
+			/// Default time to live of a decision, in seconds.
+		DEFAULT_MAX_ENTRIES = 1024
+	};
+
+	explicit AuthorizationCache(const Poco::Timespan& ttl = Poco::Timespan(DEFAULT_TTL, 0), std::size_t maxEntries = DEFAULT_MAX_ENTRIES):
+		_generation(0),
+		_cache(maxEntries, ttl)
+		/// Creates the AuthorizationCache, keeping decisions
+		/// for the given time, and up to maxEntries decisions.
+	{
+	}
+
+	bool lookup(const std::string& subject, const std::string& permission, bool& authorized) const
+		/// Returns true and stores the cached decision in authorized
+		/// if a decision for subject and permission has been cached and
+		/// has not expired. Otherwise, returns false.
+	{
+		return _cache.get(key(subject, permission), authorized);
+	}
+
+	Poco::UInt64 generation() const
+		/// Returns the current generation of the cache,
+		/// which is incremented by invalidate().
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _generation;
+	}
+
+	void put(const std::string& subject, const std::string& permission, bool authorized, Poco::UInt64 generation)
+		/// Stores a decision, unless the cache has been invalidated
+		/// since the given generation has been obtained.
+	{
+		if (generation != this->generation()) return;
+		const std::string k(key(subject, permission));
+		_cache.add(k, authorized);
+		// invalidate() increments the generation before removing
+		// decisions, so a decision added after invalidate() has removed
+		// decisions is seen here, and removed.
+		if (generation != this->generation()) _cache.remove(k);
+	}
+
+	void invalidate()
+		/// Removes all decisions.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			++_generation;
+		}
+		_cache.clear();
+	}
+
+	void invalidate(const std::string& userName)
+		/// Removes all decisions for the given user, including
+		/// those cached by a CachingAuthorizer for the user's
+		/// credentials.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			++_generation;
+		}
+		_cache.removeIf(UserPredicate(userName));
+	}
+
+	std::size_t size() const
+		/// Returns the number of cached decisions,
+		/// including expired ones.
+	{
+		return _cache.size();
+	}
+
+protected:
+	typedef Poco::ConcurrentCache<std::string, bool> DecisionCache;
+
+	class UserPredicate
+	{
+	public:
+		explicit UserPredicate(const std::string& userName):
+			_userName(userName)
+		{
+		}
+
+		bool operator () (const std::string& key, bool) const
+			/// Returns true if the subject of the key is the user name,
+			/// or the user name followed by '#' and a credentials digest.
+		{
+			return key.size() > _userName.size()
+				&& key.compare(0, _userName.size(), _userName) == 0
+				&& (key[_userName.size()] == '\0' || key[_userName.size()] == '#');
+		}
+
+	private:
+		std::string _userName;
+	};
+
+	~AuthorizationCache()
+	{
+	}
+
+	static std::string key(const std::string& subject, const std::string& permission)
+	{
+		std::string k(subject);
+		k += '\0';
+		k += permission;
+		return k;
+	}
+
+private:
+	AuthorizationCache(const AuthorizationCache&);
+	AuthorizationCache& operator = (const AuthorizationCache&);
+
+	Poco::UInt64 _generation;
+	mutable Poco::FastMutex _mutex;
+	DecisionCache _cache;
+};
+
+
+class CachingAuthService: public AuthService
+	/// CachingAuthService is an AuthService that passes requests to
+	/// another AuthService, and caches the results of authorize()
+	/// in an AuthorizationCache.
+	///
+	/// The CachingAuthService is registered instead of the actual
+	/// AuthService (usually under the name "osp.auth"), so that OSP Web
+	/// and other users of the service benefit from the cache.
+	/// authenticate() is not cached.
+{
+public:
+	typedef Poco::AutoPtr<CachingAuthService> Ptr;
+
+	CachingAuthService(AuthService::Ptr pAuthService, AuthorizationCache::Ptr pCache):
+		_pAuthService(pAuthService),
+		_pCache(pCache)
+		/// Creates the CachingAuthService.
+	{
+	}
+
+	~CachingAuthService()
+		/// Destroys the CachingAuthService.
+	{
+	}
+
+	bool authenticate(const std::string& userName, const std::string& credentials) const
+	{
+		return _pAuthService->authenticate(userName, credentials);
+	}
+
+	bool authorize(const std::string& userName, const std::string& permission) const
+	{
+		AuthorizationCache::Ptr pCache(_pCache);
+		bool authorized;
+		if (pCache->lookup(userName, permission, authorized)) return authorized;
+		Poco::UInt64 generation = pCache->generation();
+		authorized = _pAuthService->authorize(userName, permission);
+		pCache->put(userName, permission, authorized, generation);
+		return authorized;
+	}
+
+	AuthorizationCache::Ptr cache() const
+		/// Returns the AuthorizationCache.
+	{
+		return _pCache;
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(CachingAuthService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(CachingAuthService), otherType) || AuthService::isA(otherType);
+	}
+
+private:
+	AuthService::Ptr _pAuthService;
+	AuthorizationCache::Ptr _pCache;
+};
+
+
+class CachingAuthorizer: public Poco::RemotingNG::Authorizer
+	/// CachingAuthorizer is a RemotingNG Authorizer that passes requests
+	/// to another Authorizer, and caches its decisions in an
+	/// AuthorizationCache.
+	///
+	/// Decisions are keyed by a digest of all credentials attributes
+	/// of the current request Context, so that a request is only
+	/// authorized from the cache if it presents the same credentials
+	/// as an earlier one, and by method and permission. Requests without
+	/// credentials, e.g. because the transport authenticates in a different
+	/// way, are always passed to the actual Authorizer.
+{
+public:
+	typedef Poco::AutoPtr<CachingAuthorizer> Ptr;
+
+	CachingAuthorizer(Poco::RemotingNG::Authorizer::Ptr pAuthorizer, AuthorizationCache::Ptr pCache):
+		_pAuthorizer(pAuthorizer),
+		_pCache(pCache)
+		/// Creates the CachingAuthorizer.
+	{
+	}
+
+	~CachingAuthorizer()
+		/// Destroys the CachingAuthorizer.
+	{
+	}
+
+	bool authorize(const std::string& method, const std::string& permission)
+	{
+		std::string subject = credentialsDigest();
+		if (subject.empty()) return _pAuthorizer->authorize(method, permission);
+
+		std::string key(permission);
+		key += '\n';
+		key += method;
+		bool authorized;
+		if (_pCache->lookup(subject, key, authorized)) return authorized;
+		Poco::UInt64 generation = _pCache->generation();
+		authorized = _pAuthorizer->authorize(method, permission);
+		_pCache->put(subject, key, authorized, generation);
+		return authorized;
+	}
+
+protected:
+	static std::string credentialsDigest()
+	{
+		Poco::RemotingNG::Context::Ptr pContext = Poco::RemotingNG::Context::get();
+		if (!pContext) return std::string();
+		const Poco::RemotingNG::Credentials& creds = pContext->getCredentials();
+		if (creds.countAttributes() == 0) return std::string();
+
+		Poco::SHA1Engine sha1;
+		std::vector<std::string> names = creds.enumerateAttributes();
+		for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+		{
+			sha1.update(*it);
+			sha1.update('\0');
+			sha1.update(creds.getAttribute(*it));
+			sha1.update('\0');
+		}
+		std::string subject(creds.getAttribute(Poco::RemotingNG::Credentials::ATTR_USERNAME, std::string()));
+		subject += '#';
+		subject += Poco::HexBinary::encode(sha1.digest());
+		return subject;
+	}
+
+private:
+	Poco::RemotingNG::Authorizer::Ptr _pAuthorizer;
+	AuthorizationCache::Ptr _pCache;
+};
+
+
+} } } // namespace Poco::OSP::Auth
+
+
+#endif // OSP_Auth_AuthorizationCache_INCLUDED
@@ -0,0 +1,710 @@
+//
+// BundleAccounting.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  BundleAccounting
+//
+// Definition of the BundleAccounting class and the accounted() decorator.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_BundleAccounting_INCLUDED
+#define OSP_BundleAccounting_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/OSP/BundleContext.h"
+#include "Poco/AbstractDelegate.h"
+#include "Poco/Instrumentation.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Mutex.h"
+#include <map>
+#include <set>
+#include <vector>
+#include <ostream>
+#if __cplusplus >= 201103L
+#include <atomic>
+#elif !defined(__GNUC__)
+#include "Poco/FastThreadLocal.h"
+#endif
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <pthread.h>
+#include <time.h>
+#endif
+
+
+namespace Poco {
+namespace OSP {
+
+
+class BundleAccounting
+	/// BundleAccounting attributes the resources used in the single
+	/// OSP process to the bundles owning them, so that a bundle
+	/// causing load can be found among many.
+	///
+	/// Attribution works by tagging threads with a bundle:
+	///   - Threads started with start(), or running an AccountedRunnable,
+	///     are owned by the bundle of the given BundleContext. All their
+	///     CPU time is charged to that bundle, except for the time spent
+	///     in Scopes of other bundles.
+	///   - Delegates decorated with accounted() run in a Scope of the
+	///     bundle that registered them. Their calls, wall time and CPU
+	///     time are charged to that bundle, whatever thread fires the event.
+	///   - A Scope charges the CPU time of the current thread, between its
+	///     construction and destruction, to a bundle. BundleAccountingService
+	///     uses Scopes for the start and stop of bundles.
+	///   - Heap allocations are charged to the bundle of the innermost
+	///     Scope or the owner of the current thread, if the executable
+	///     includes Poco/OSP/BundleAccountingNew.h, which replaces the
+	///     global operator new. Only the number and size of allocations
+	///     are counted, not deallocations.
+	///
+	/// Resources not used in a tagged thread or Scope are not attributed.
+	/// CPU times are taken from the per-thread CPU clocks, and are only
+	/// available on platforms providing them (POCO_OS_FAMILY_UNIX).
+	///
+	///     BundleAccounting::instance().start(context(), _thread, _worker);
+	///     context()->events().bundleStarted += accounted(context(), delegate(this, &MyActivator::onBundleStarted));
+{
+public:
+	class Account;
+	class Scope;
+	class AccountedRunnable;
+
+private:
+#if __cplusplus >= 201103L
+	typedef std::atomic<UInt64> Value;
+
+	static void add(Value& value, UInt64 n)
+	{
+		value.fetch_add(n, std::memory_order_relaxed);
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		return value.load(std::memory_order_relaxed);
+	}
+#elif defined(__GNUC__)
+	typedef volatile UInt64 Value;
+
+	static void add(Value& value, UInt64 n)
+	{
+		__sync_fetch_and_add(&value, n);
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		return __sync_fetch_and_add(const_cast<Value*>(&value), 0);
+	}
+#else
+	typedef volatile UInt64 Value;
+
+	static void add(Value& value, UInt64 n)
+	{
+		Poco::FastMutex::ScopedLock lock(valueMutex());
+		value = value + n;
+	}
+
+	static UInt64 load(const Value& value)
+	{
+		Poco::FastMutex::ScopedLock lock(valueMutex());
+		return value;
+	}
+
+	static Poco::FastMutex& valueMutex()
+	{
+		static Poco::FastMutex mutex;
+		return mutex;
+	}
+#endif
+
+	struct ThreadRecord
+		/// A running thread owned by a bundle.
+	{
+		ThreadRecord():
+			excluded(0)
+		{
+#if defined(POCO_OS_FAMILY_UNIX)
+			valid = pthread_getcpuclockid(pthread_self(), &clock) == 0;
+#endif
+		}
+
+		UInt64 cpuTime() const
+			/// Returns the CPU time of the thread, which can be called from any thread.
+		{
+#if defined(POCO_OS_FAMILY_UNIX)
+			struct timespec ts;
+			if (!valid || clock_gettime(clock, &ts) != 0) return 0;
+			return static_cast<UInt64>(ts.tv_sec)*1000000000 + static_cast<UInt64>(ts.tv_nsec);
+#else
+			return 0;
+#endif
+		}
+
+		Value excluded; /// CPU time of the thread spent in Scopes
+#if defined(POCO_OS_FAMILY_UNIX)
+		clockid_t clock;
+		bool valid;
+#endif
+	};
+
+	struct State
+		/// The accounting state of a thread. Trivially constructible,
+		/// so that it can be used from operator new.
+	{
+		Account* pAccount;
+		Scope* pScope;
+		ThreadRecord* pThread;
+	};
+
+	static State& state()
+	{
+#if __cplusplus >= 201103L
+		static thread_local State theState = {0, 0, 0};
+		return theState;
+#elif defined(__GNUC__)
+		static __thread State theState = {0, 0, 0};
+		return theState;
+#else
+		struct Holder
+		{
+			Holder()
+			{
+				state.pAccount = 0;
+				state.pScope = 0;
+				state.pThread = 0;
+			}
+
+			State state;
+		};
+		static Poco::FastThreadLocal<Holder> holder;
+		return holder->state;
+#endif
+	}
+
+public:
+	struct Usage
+		/// The resources used by a bundle. Times are in nanoseconds.
+	{
+		Usage():
+			bundleId(-1),
+			cpuTime(0),
+			threadsStarted(0),
+			threadsRunning(0),
+			allocations(0),
+			allocatedBytes(0),
+			delegateCalls(0),
+			delegateTime(0)
+		{
+		}
+
+		int bundleId;
+		std::string bundle;           /// symbolic name of the bundle
+		UInt64 cpuTime;               /// CPU time of owned threads and Scopes
+		UInt64 threadsStarted;        /// number of owned threads started
+		UInt64 threadsRunning;        /// number of owned threads currently running
+		UInt64 allocations;           /// number of heap allocations
+		UInt64 allocatedBytes;        /// total size of heap allocations
+		UInt64 delegateCalls;         /// number of accounted delegate calls
+		UInt64 delegateTime;          /// wall time of accounted delegate calls
+	};
+
+	typedef std::vector<Usage> UsageVec;
+
+	class Scope
+		/// Charges the CPU time and allocations of the current thread
+		/// to a bundle while the Scope exists. Scopes nest; the time
+		/// spent in an inner Scope is only charged to the inner Scope's
+		/// bundle.
+	{
+	public:
+		explicit Scope(Account& account):
+			_account(account),
+			_excluded(0)
+		{
+			State& state = BundleAccounting::state();
+			_pPreviousAccount = state.pAccount;
+			_pOuter = state.pScope;
+			state.pAccount = &account;
+			state.pScope = this;
+			_start = threadCpuTime();
+		}
+
+		~Scope()
+		{
+			UInt64 cpu = threadCpuTime() - _start;
+			_account.addCpuTime(cpu > _excluded ? cpu - _excluded : 0);
+			State& state = BundleAccounting::state();
+			if (_pOuter)
+				_pOuter->_excluded += cpu;
+			else if (state.pThread)
+				add(state.pThread->excluded, cpu);
+			state.pAccount = _pPreviousAccount;
+			state.pScope = _pOuter;
+		}
+
+	private:
+		Scope();
+		Scope(const Scope&);
+		Scope& operator = (const Scope&);
+
+		Account& _account;
+		Account* _pPreviousAccount;
+		Scope* _pOuter;
+		UInt64 _start;
+		UInt64 _excluded;
+	};
+
+	class Account
+		/// The counters of one bundle. Accounts are created by
+		/// BundleAccounting::account() and never destroyed.
+	{
+	public:
+		int bundleId() const
+		{
+			return _bundleId;
+		}
+
+		const std::string& bundle() const
+		{
+			return _bundle;
+		}
+
+		void addCpuTime(UInt64 ns)
+		{
+			if (ns) add(_cpuTime, ns);
+		}
+
+		void addAllocation(std::size_t size)
+		{
+			add(_allocations, 1);
+			add(_allocatedBytes, size);
+		}
+
+		void addDelegateCall(UInt64 ns)
+		{
+			add(_delegateCalls, 1);
+			add(_delegateTime, ns);
+		}
+
+		void usage(Usage& usage) const
+			/// Copies the counters into usage.
+		{
+			usage.bundleId = _bundleId;
+			usage.bundle = _bundle;
+			usage.allocations = load(_allocations);
+			usage.allocatedBytes = load(_allocatedBytes);
+			usage.delegateCalls = load(_delegateCalls);
+			usage.delegateTime = load(_delegateTime);
+			usage.threadsStarted = load(_threadsStarted);
+			UInt64 cpu = load(_cpuTime);
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			usage.threadsRunning = _threads.size();
+			for (std::set<ThreadRecord*>::const_iterator it = _threads.begin(); it != _threads.end(); ++it)
+			{
+				UInt64 total = (*it)->cpuTime();
+				UInt64 excluded = load((*it)->excluded);
+				if (total > excluded) cpu += total - excluded;
+			}
+			usage.cpuTime = cpu;
+		}
+
+	private:
+		Account(int bundleId, const std::string& bundle):
+			_bundleId(bundleId),
+			_bundle(bundle),
+			_cpuTime(0),
+			_threadsStarted(0),
+			_allocations(0),
+			_allocatedBytes(0),
+			_delegateCalls(0),
+			_delegateTime(0)
+		{
+		}
+
+		void attach(ThreadRecord* pRecord)
+		{
+			add(_threadsStarted, 1);
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_threads.insert(pRecord);
+		}
+
+		void detach(ThreadRecord* pRecord)
+			/// Charges the CPU time of the terminating thread.
+		{
+			UInt64 total = pRecord->cpuTime();
+			UInt64 excluded = load(pRecord->excluded);
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_threads.erase(pRecord);
+			if (total > excluded) add(_cpuTime, total - excluded);
+		}
+
+		Account();
+		Account(const Account&);
+		Account& operator = (const Account&);
+
+		int _bundleId;
+		std::string _bundle;
+		Value _cpuTime;
+		Value _threadsStarted;
+		Value _allocations;
+		Value _allocatedBytes;
+		Value _delegateCalls;
+		Value _delegateTime;
+		std::set<ThreadRecord*> _threads;
+		mutable Poco::FastMutex _mutex;
+
+		friend class BundleAccounting;
+		friend class AccountedRunnable;
+	};
+
+	class AccountedRunnable: public Poco::Runnable
+		/// Runs a Runnable in a thread owned by a bundle. Can be
+		/// passed to Poco::Thread::start() or Poco::ThreadPool::start(),
+		/// and must then remain valid while the thread runs.
+	{
+	public:
+		AccountedRunnable(Account& account, Poco::Runnable& target):
+			_account(account),
+			_target(target)
+		{
+		}
+
+		void run()
+		{
+			(*this)();
+		}
+
+		void operator () ()
+		{
+			State& state = BundleAccounting::state();
+			ThreadRecord record;
+			ThreadRecord* pPreviousThread = state.pThread;
+			Account* pPreviousAccount = state.pAccount;
+			Scope* pPreviousScope = state.pScope;
+			state.pThread = &record;
+			state.pAccount = &_account;
+			state.pScope = 0;
+			_account.attach(&record);
+			try
+			{
+				_target.run();
+			}
+			catch (...)
+			{
+				finish(state, record, pPreviousThread, pPreviousAccount, pPreviousScope);
+				throw;
+			}
+			finish(state, record, pPreviousThread, pPreviousAccount, pPreviousScope);
+		}
+
+	private:
+		void finish(State& state, ThreadRecord& record, ThreadRecord* pThread, Account* pAccount, Scope* pScope)
+		{
+			_account.detach(&record);
+			state.pThread = pThread;
+			state.pAccount = pAccount;
+			state.pScope = pScope;
+		}
+
+		AccountedRunnable();
+
+		Account& _account;
+		Poco::Runnable& _target;
+	};
+
+	static BundleAccounting& instance()
+		/// Returns the BundleAccounting registry.
+	{
+		// never destroyed, as threads may allocate during static destruction
+		static BundleAccounting* pInstance = new BundleAccounting;
+		return *pInstance;
+	}
+
+	Account& account(const Bundle& bundle)
+		/// Returns the Account of the given bundle, creating it if necessary.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Account*& pAccount = _accounts[bundle.id()];
+		if (!pAccount) pAccount = new Account(bundle.id(), bundle.symbolicName());
+		return *pAccount;
+	}
+
+	Account& account(const BundleContext::Ptr& pContext)
+		/// Returns the Account of the bundle of the given context.
+	{
+		return account(*pContext->thisBundle());
+	}
+
+	void start(const BundleContext::Ptr& pContext, Poco::Thread& thread, Poco::Runnable& target)
+		/// Starts the thread with the given target, owned by the
+		/// bundle of the given context. The target must remain valid
+		/// while the thread runs.
+	{
+		thread.startFunc(AccountedRunnable(account(pContext), target));
+	}
+
+	void usage(UsageVec& usage) const
+		/// Appends the usage of all bundles having an Account.
+	{
+		std::vector<const Account*> accounts;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (AccountMap::const_iterator it = _accounts.begin(); it != _accounts.end(); ++it)
+			{
+				accounts.push_back(it->second);
+			}
+		}
+		for (std::vector<const Account*>::const_iterator it = accounts.begin(); it != accounts.end(); ++it)
+		{
+			usage.push_back(Usage());
+			(*it)->usage(usage.back());
+		}
+	}
+
+	bool usage(int bundleId, Usage& usage) const
+		/// Copies the usage of the given bundle and returns true,
+		/// or returns false if the bundle has no Account.
+	{
+		const Account* pAccount = 0;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			AccountMap::const_iterator it = _accounts.find(bundleId);
+			if (it == _accounts.end()) return false;
+			pAccount = it->second;
+		}
+		pAccount->usage(usage);
+		return true;
+	}
+
+	static void dump(const UsageVec& usage, std::ostream& ostr)
+		/// Writes the given usage, one bundle per line.
+	{
+		for (UsageVec::const_iterator it = usage.begin(); it != usage.end(); ++it)
+		{
+			ostr << it->bundle
+			     << " cpu=" << it->cpuTime/1000000 << "ms"
+			     << " threads=" << it->threadsRunning << "/" << it->threadsStarted
+			     << " allocations=" << it->allocations
+			     << " bytes=" << it->allocatedBytes
+			     << " delegates=" << it->delegateCalls
+			     << " delegateTime=" << it->delegateTime/1000000 << "ms"
+			     << '\n';
+		}
+	}
+
+	static Account* current()
+		/// Returns the Account of the innermost Scope, or of the
+		/// owner of the current thread, or null.
+	{
+		return state().pAccount;
+	}
+
+	static void recordAllocation(std::size_t size)
+		/// Charges a heap allocation to the current Account, if any.
+		/// Called by the operator new of BundleAccountingNew.h.
+	{
+		Account* pAccount = state().pAccount;
+		if (pAccount) pAccount->addAllocation(size);
+	}
+
+	static UInt64 threadCpuTime()
+		/// Returns the CPU time of the current thread in nanoseconds,
+		/// or 0 if not supported by the platform.
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		struct timespec ts;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+		return static_cast<UInt64>(ts.tv_sec)*1000000000 + static_cast<UInt64>(ts.tv_nsec);
+#else
+		return 0;
+#endif
+	}
+
+private:
+	BundleAccounting()
+	{
+	}
+
+	~BundleAccounting()
+	{
+	}
+
+	BundleAccounting(const BundleAccounting&);
+	BundleAccounting& operator = (const BundleAccounting&);
+
+	typedef std::map<int, Account*> AccountMap;
+
+	AccountMap _accounts;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+template <class TArgs>
+class AccountedDelegate: public AbstractDelegate<TArgs>
+	/// Decorator for AbstractDelegate that runs the decorated
+	/// delegate in a BundleAccounting::Scope of the bundle that
+	/// registered it, and counts the calls and their wall time.
+	///
+	/// For removal, an AccountedDelegate compares equal to the
+	/// decorated delegate:
+	///
+	///     event -= delegate(this, &MyController::onDataChanged);
+{
+public:
+	AccountedDelegate(BundleAccounting::Account& account, const AbstractDelegate<TArgs>& delegate):
+		_account(account),
+		_pDelegate(delegate.clone())
+	{
+	}
+
+	AccountedDelegate(const AccountedDelegate& delegate):
+		AbstractDelegate<TArgs>(delegate),
+		_account(delegate._account),
+		_pDelegate(delegate._pDelegate->clone())
+	{
+	}
+
+	~AccountedDelegate()
+	{
+		delete _pDelegate;
+	}
+
+	bool notify(const void* sender, TArgs& arguments)
+	{
+		UInt64 start = Poco::Instrumentation::now();
+		bool result;
+		{
+			BundleAccounting::Scope scope(_account);
+			result = _pDelegate->notify(sender, arguments);
+		}
+		_account.addDelegateCall(Poco::Instrumentation::now() - start);
+		return result;
+	}
+
+	bool equals(const AbstractDelegate<TArgs>& other) const
+	{
+		return other.equals(*_pDelegate);
+	}
+
+	AbstractDelegate<TArgs>* clone() const
+	{
+		return new AccountedDelegate(*this);
+	}
+
+	void disable()
+	{
+		_pDelegate->disable();
+	}
+
+	const AbstractDelegate<TArgs>* unwrap() const
+	{
+		return this->_pDelegate;
+	}
+
+protected:
+	BundleAccounting::Account& _account;
+	AbstractDelegate<TArgs>*   _pDelegate;
+
+private:
+	AccountedDelegate();
+	AccountedDelegate& operator = (const AccountedDelegate&);
+};
+
+
+template <>
+class AccountedDelegate<void>: public AbstractDelegate<void>
+	/// Decorator for AbstractDelegate<void>, see AccountedDelegate.
+{
+public:
+	AccountedDelegate(BundleAccounting::Account& account, const AbstractDelegate<void>& delegate):
+		_account(account),
+		_pDelegate(delegate.clone())
+	{
+	}
+
+	AccountedDelegate(const AccountedDelegate& delegate):
+		AbstractDelegate<void>(delegate),
+		_account(delegate._account),
+		_pDelegate(delegate._pDelegate->clone())
+	{
+	}
+
+	~AccountedDelegate()
+	{
+		delete _pDelegate;
+	}
+
+	bool notify(const void* sender)
+	{
+		UInt64 start = Poco::Instrumentation::now();
+		bool result;
+		{
+			BundleAccounting::Scope scope(_account);
+			result = _pDelegate->notify(sender);
+		}
+		_account.addDelegateCall(Poco::Instrumentation::now() - start);
+		return result;
+	}
+
+	bool equals(const AbstractDelegate<void>& other) const
+	{
+		return other.equals(*_pDelegate);
+	}
+
+	AbstractDelegate<void>* clone() const
+	{
+		return new AccountedDelegate(*this);
+	}
+
+	void disable()
+	{
+		_pDelegate->disable();
+	}
+
+	const AbstractDelegate<void>* unwrap() const
+	{
+		return this->_pDelegate;
+	}
+
+protected:
+	BundleAccounting::Account& _account;
+	AbstractDelegate<void>*    _pDelegate;
+
+private:
+	AccountedDelegate();
+	AccountedDelegate& operator = (const AccountedDelegate&);
+};
+
+
+template <class TArgs>
+inline AccountedDelegate<TArgs> accounted(const BundleContext::Ptr& pContext, const AbstractDelegate<TArgs>& delegate)
+	/// Decorates delegate so that its calls are charged to the
+	/// bundle of the given context.
+{
+	return AccountedDelegate<TArgs>(BundleAccounting::instance().account(pContext), delegate);
+}
+
+
+inline AccountedDelegate<void> accounted(const BundleContext::Ptr& pContext, const AbstractDelegate<void>& delegate)
+	/// Decorates delegate so that its calls are charged to the
+	/// bundle of the given context.
+{
+	return AccountedDelegate<void>(BundleAccounting::instance().account(pContext), delegate);
+}
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_BundleAccounting_INCLUDED
@@ -0,0 +1,94 @@
+//
+// InstrumentationService.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  InstrumentationService
+//
+// Definition of the InstrumentationService class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_InstrumentationService_INCLUDED
+#define OSP_InstrumentationService_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/Instrumentation.h"
+#include <vector>
+#include <ostream>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class InstrumentationService: public Service
+	/// The InstrumentationService gives bundles access to the
+	/// probes of the Poco::Instrumentation registry, e.g. to
+	/// show them in a web interface or to report them to a
+	/// monitoring system.
+	///
+	/// Register the service with the ServiceRegistry under
+	/// serviceName().
+{
+public:
+	typedef Poco::AutoPtr<InstrumentationService> Ptr;
+
+	static const std::string& serviceName()
+		/// Returns the name under which the service
+		/// should be registered.
+	{
+		static const std::string name("osp.core.instrumentation");
+		return name;
+	}
+
+	InstrumentationService()
+		/// Creates the InstrumentationService.
+	{
+	}
+
+	void snapshot(std::vector<Poco::Instrumentation::Sample>& samples) const
+		/// Appends the values of all probes to samples.
+		/// See Poco::Instrumentation::snapshot().
+	{
+		Poco::Instrumentation::instance().snapshot(samples);
+	}
+
+	void dump(std::ostream& ostr) const
+		/// Writes the values of all probes to the given stream.
+		/// See Poco::Instrumentation::dump().
+	{
+		Poco::Instrumentation::instance().dump(ostr);
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(InstrumentationService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(InstrumentationService), otherType) || Service::isA(otherType);
+	}
+
+protected:
+	~InstrumentationService()
+	{
+	}
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_InstrumentationService_INCLUDED
@@ -0,0 +1,273 @@
+//
+// LazyServiceActivator.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Service
+// Module:  LazyServiceActivator
+//
+// Definition of the LazyServiceFactory and LazyServiceActivator classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_LazyServiceActivator_INCLUDED
+#define OSP_LazyServiceActivator_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/ServiceFactory.h"
+#include "Poco/OSP/ServiceRegistry.h"
+#include "Poco/OSP/ServiceRef.h"
+#include "Poco/OSP/Properties.h"
+#include "Poco/OSP/BundleLoader.h"
+#include "Poco/OSP/BundleEvents.h"
+#include "Poco/OSP/BundleEvent.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/Delegate.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class LazyServiceFactory: public ServiceFactory
+	/// LazyServiceFactory is the placeholder registered by the
+	/// LazyServiceActivator for a service provided by a bundle
+	/// that has not been started yet.
+	///
+	/// When an instance of the service is requested for the first
+	/// time, the factory unregisters itself, starts the bundle, which
+	/// registers the actual service under the same name, and returns
+	/// an instance of the actual service. Callers holding the placeholder's
+	/// ServiceRef therefore obtain the actual service, too.
+{
+public:
+	typedef Poco::AutoPtr<LazyServiceFactory> Ptr;
+
+	LazyServiceFactory(ServiceRegistry& registry, Bundle::Ptr pBundle, const std::string& name):
+		_registry(registry),
+		_pBundle(pBundle),
+		_name(name)
+		/// Creates the LazyServiceFactory for the service with
+		/// the given name, provided by the given bundle.
+	{
+	}
+
+	Service::Ptr createService()
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (!_pBundle->isStarted())
+		{
+			ServiceRef::Ptr pRef = _registry.findByName(_name);
+			if (pRef && isPlaceholder(*pRef)) _registry.unregisterService(pRef);
+			_pBundle->start();
+		}
+		ServiceRef::Ptr pRef = _registry.findByName(_name);
+		if (!pRef || isPlaceholder(*pRef))
+		{
+			throw Poco::NotFoundException("Service not registered by lazily started bundle", _name);
+		}
+		return pRef->instance();
+	}
+
+	static bool isPlaceholder(const ServiceRef& ref)
+		/// Returns true if the given ServiceRef
+		/// has been registered for a LazyServiceFactory.
+	{
+		return ref.properties().has(LAZY_PROPERTY());
+	}
+
+	static const std::string& LAZY_PROPERTY()
+		/// Returns the name of the service property
+		/// identifying placeholders.
+	{
+		static const std::string name("osp.lazy");
+		return name;
+	}
+
+	Bundle::Ptr bundle() const
+		/// Returns the bundle providing the service.
+	{
+		return _pBundle;
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(LazyServiceFactory);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(LazyServiceFactory), otherType) || ServiceFactory::isA(otherType);
+	}
+
+protected:
+	~LazyServiceFactory()
+	{
+	}
+
+private:
+	ServiceRegistry& _registry;
+	Bundle::Ptr _pBundle;
+	std::string _name;
+	Poco::FastMutex _mutex;
+};
+
+
+class LazyServiceActivator
+	/// LazyServiceActivator implements on-demand activation of
+	/// bundles: a bundle with the Lazy-Start manifest header set to
+	/// true, which is therefore not started by BundleLoader::startAllBundles(),
+	/// can list the services it provides in the osp.lazyServices bundle
+	/// property, separated by commas:
+	///
+	///     osp.lazyServices = com.example.diagnostics, com.example.webui
+	///
+	/// For each of these services, a LazyServiceFactory is registered
+	/// as placeholder, with the properties osp.lazy (true) and
+	/// osp.lazyBundle (the bundle's symbolic name). The bundle's
+	/// library is loaded and its activator started only when an
+	/// instance of one of the services is requested for the first time,
+	/// e.g. after a findByName() or find().
+	///
+	/// The placeholders are unregistered when the bundle is started,
+	/// either on demand or as a dependency of another bundle.
+	/// When the bundle is stopped, its placeholders are registered again.
+	///
+	/// Usage example:
+	///
+	///     loader.resolveAllBundles();
+	///     LazyServiceActivator lazy(loader, registry);
+	///     loader.startAllBundles();
+{
+public:
+	static const std::string& LAZY_SERVICES_PROPERTY()
+		/// Returns the name of the bundle property
+		/// listing the lazily provided services.
+	{
+		static const std::string name("osp.lazyServices");
+		return name;
+	}
+
+	LazyServiceActivator(BundleLoader& loader, ServiceRegistry& registry):
+		_loader(loader),
+		_registry(registry)
+		/// Creates the LazyServiceActivator and registers the placeholders
+		/// for all resolved lazy-start bundles that have not been started.
+	{
+		std::vector<Bundle::Ptr> bundles;
+		_loader.listBundles(bundles);
+		for (std::vector<Bundle::Ptr>::iterator it = bundles.begin(); it != bundles.end(); ++it)
+		{
+			if ((*it)->isResolved() && !(*it)->isStarted()) registerPlaceholders(*it);
+		}
+		_loader.events().bundleResolved += Poco::delegate(this, &LazyServiceActivator::onBundleResolved);
+		_loader.events().bundleStarting += Poco::delegate(this, &LazyServiceActivator::onBundleStarting);
+		_loader.events().bundleStopped += Poco::delegate(this, &LazyServiceActivator::onBundleStopped);
+	}
+
+	~LazyServiceActivator()
+		/// Unregisters all placeholders still registered
+		/// and destroys the LazyServiceActivator.
+	{
+		try
+		{
+			_loader.events().bundleResolved -= Poco::delegate(this, &LazyServiceActivator::onBundleResolved);
+			_loader.events().bundleStarting -= Poco::delegate(this, &LazyServiceActivator::onBundleStarting);
+			_loader.events().bundleStopped -= Poco::delegate(this, &LazyServiceActivator::onBundleStopped);
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (PlaceholderMap::iterator it = _placeholders.begin(); it != _placeholders.end(); ++it)
+			{
+				ServiceRef::Ptr pRef = _registry.findByName(it->first);
+				if (pRef && LazyServiceFactory::isPlaceholder(*pRef)) _registry.unregisterService(pRef);
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	std::size_t placeholders() const
+		/// Returns the number of placeholders registered so far.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _placeholders.size();
+	}
+
+protected:
+	typedef std::map<std::string, LazyServiceFactory::Ptr> PlaceholderMap;
+
+	void registerPlaceholders(Bundle::Ptr pBundle)
+	{
+		if (!pBundle->lazyStart()) return;
+
+		std::string services = pBundle->properties().getString(LAZY_SERVICES_PROPERTY(), "");
+		Poco::StringTokenizer tok(services, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (Poco::StringTokenizer::Iterator it = tok.begin(); it != tok.end(); ++it)
+		{
+			if (_registry.findByName(*it)) continue;
+
+			LazyServiceFactory::Ptr pFactory = new LazyServiceFactory(_registry, pBundle, *it);
+			Properties props;
+			props.set(LazyServiceFactory::LAZY_PROPERTY(), "true");
+			props.set("osp.lazyBundle", pBundle->symbolicName());
+			_registry.registerService(*it, pFactory, props);
+			_placeholders[*it] = pFactory;
+		}
+	}
+
+	void onBundleResolved(const void*, BundleEvent& event)
+	{
+		registerPlaceholders(Bundle::Ptr(event.bundle()));
+	}
+
+	void onBundleStarting(const void*, BundleEvent& event)
+	{
+		// The bundle may also be started as a dependency of another
+		// bundle; its activator then registers the actual services.
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (PlaceholderMap::iterator it = _placeholders.begin(); it != _placeholders.end(); ++it)
+		{
+			if (it->second->bundle() != event.bundle()) continue;
+			ServiceRef::Ptr pRef = _registry.findByName(it->first);
+			if (pRef && LazyServiceFactory::isPlaceholder(*pRef)) _registry.unregisterService(pRef);
+		}
+	}
+
+	void onBundleStopped(const void*, BundleEvent& event)
+	{
+		Bundle::Ptr pBundle(event.bundle());
+		if (pBundle->isResolved()) registerPlaceholders(pBundle);
+	}
+
+private:
+	LazyServiceActivator(const LazyServiceActivator&);
+	LazyServiceActivator& operator = (const LazyServiceActivator&);
+
+	BundleLoader& _loader;
+	ServiceRegistry& _registry;
+	PlaceholderMap _placeholders;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_LazyServiceActivator_INCLUDED
@@ -0,0 +1,362 @@
+//
+// LibraryPreloader.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  LibraryPreloader
+//
+// Definition of the LibraryPreloader class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_LibraryPreloader_INCLUDED
+#define OSP_LibraryPreloader_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/MappedFile.h"
+#include "Poco/Path.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <dlfcn.h>
+#endif
+#if defined(__linux__)
+#include <elf.h>
+#endif
+
+
+namespace Poco {
+namespace OSP {
+
+
+class LibraryPreloader
+	/// LibraryPreloader loads the libraries of the bundles, e.g. the
+	/// libraries in the code cache, before the BundleLoader loads the
+	/// bundle activators, in an order in which every library is loaded
+	/// after the other libraries it depends on, and with a bind policy
+	/// that can be chosen per library.
+	///
+	/// ClassLoader opens libraries with SharedLibrary, which always
+	/// binds lazily, and in the order in which bundles are resolved,
+	/// so that loading a library may first have to find and load the
+	/// libraries it depends on. When a library has been preloaded,
+	/// SharedLibrary merely obtains another reference to it.
+	///
+	/// With BIND_NOW, all symbols of a library are resolved when it
+	/// is preloaded (RTLD_NOW), which moves the cost of the symbol
+	/// lookups from the first calls into the library to startup, and
+	/// makes missing symbols show up in failed() instead of aborting
+	/// the process later on. With BIND_LAZY, function symbols are
+	/// resolved when they are first called (RTLD_LAZY). As with
+	/// SharedLibrary, libraries are loaded with RTLD_GLOBAL.
+	///
+	/// The dependencies of a library are the DT_NEEDED entries of its
+	/// ELF dynamic section. They are either read from the library
+	/// file, or passed in, e.g. by CodeCacheIndex::preload(), which
+	/// keeps them in the code cache index.
+	///
+	/// Usage example:
+	///
+	///     CodeCacheIndex index(codeCache, loader.osName(), loader.osArchitecture());
+	///     index.synchronize(bundlePaths);
+	///     LibraryPreloader preloader;
+	///     preloader.setBindPolicy("com.acme.core", LibraryPreloader::BIND_NOW);
+	///     index.preload(preloader);
+	///     preloader.preload();
+	///     loader.resolveAllBundles();
+	///
+	/// Preloading is only supported on platforms using dlopen(). Elsewhere,
+	/// preload() does nothing, and the libraries are loaded by ClassLoader
+	/// as usual.
+{
+public:
+	enum BindPolicy
+	{
+		BIND_LAZY, /// resolve function symbols when they are first called
+		BIND_NOW   /// resolve all symbols when the library is loaded
+	};
+
+	LibraryPreloader():
+		_defaultPolicy(BIND_LAZY)
+		/// Creates the LibraryPreloader, with BIND_LAZY as default bind policy.
+	{
+	}
+
+	explicit LibraryPreloader(BindPolicy defaultPolicy):
+		_defaultPolicy(defaultPolicy)
+		/// Creates the LibraryPreloader with the given default bind policy.
+	{
+	}
+
+	~LibraryPreloader()
+		/// Destroys the LibraryPreloader and releases its references to
+		/// the libraries. See unload().
+	{
+		try
+		{
+			unload();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void setBindPolicy(const std::string& name, BindPolicy policy)
+		/// Sets the bind policy of the library with the given name,
+		/// which is the file name of the library without suffix.
+	{
+		_policies[name] = policy;
+	}
+
+	BindPolicy getBindPolicy(const std::string& name) const
+		/// Returns the bind policy of the library with the given name.
+	{
+		std::map<std::string, BindPolicy>::const_iterator it = _policies.find(name);
+		return it == _policies.end() ? _defaultPolicy : it->second;
+	}
+
+	void add(const std::string& path)
+		/// Adds the library with the given path, and reads its
+		/// dependencies from the library file.
+	{
+		std::vector<std::string> needed;
+		readNeeded(path, needed);
+		add(path, needed);
+	}
+
+	void add(const std::string& path, const std::vector<std::string>& needed)
+		/// Adds the library with the given path, depending on the
+		/// libraries with the given names (DT_NEEDED entries).
+	{
+		Entry entry;
+		entry.path = path;
+		entry.name = libraryName(path);
+		entry.handle = 0;
+		for (std::vector<std::string>::const_iterator it = needed.begin(); it != needed.end(); ++it)
+		{
+			entry.needed.push_back(libraryName(*it));
+		}
+		_entries.push_back(entry);
+	}
+
+	std::vector<std::string> order() const
+		/// Returns the paths of the libraries in the order
+		/// in which preload() loads them.
+	{
+		std::vector<std::size_t> indexes;
+		sort(indexes);
+		std::vector<std::string> paths;
+		for (std::vector<std::size_t>::const_iterator it = indexes.begin(); it != indexes.end(); ++it)
+		{
+			paths.push_back(_entries[*it].path);
+		}
+		return paths;
+	}
+
+	std::size_t preload()
+		/// Loads all libraries that have not been loaded yet, each one
+		/// after the libraries it depends on, and returns the number
+		/// of libraries loaded.
+		///
+		/// Libraries that cannot be loaded are skipped, and are
+		/// reported by failed().
+	{
+		std::size_t loaded = 0;
+#if defined(POCO_OS_FAMILY_UNIX)
+		std::vector<std::size_t> indexes;
+		sort(indexes);
+		for (std::vector<std::size_t>::const_iterator it = indexes.begin(); it != indexes.end(); ++it)
+		{
+			Entry& entry = _entries[*it];
+			if (entry.handle) continue;
+			int flags = (getBindPolicy(entry.name) == BIND_NOW ? RTLD_NOW : RTLD_LAZY) | RTLD_GLOBAL;
+			entry.handle = dlopen(entry.path.c_str(), flags);
+			if (entry.handle)
+			{
+				++loaded;
+			}
+			else
+			{
+				const char* err = dlerror();
+				std::string message(entry.path);
+				if (err)
+				{
+					message += ": ";
+					message += err;
+				}
+				_failed.push_back(message);
+			}
+		}
+#endif
+		return loaded;
+	}
+
+	const std::vector<std::string>& failed() const
+		/// Returns the paths of the libraries that could not be loaded,
+		/// each one followed by the reason.
+	{
+		return _failed;
+	}
+
+	void unload()
+		/// Releases the references to the preloaded libraries.
+		/// Libraries that have been loaded by a ClassLoader in
+		/// the meantime stay loaded.
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		for (std::vector<Entry>::iterator it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			if (it->handle)
+			{
+				dlclose(it->handle);
+				it->handle = 0;
+			}
+		}
+#endif
+	}
+
+	static void readNeeded(const std::string& path, std::vector<std::string>& needed)
+		/// Appends the names of the libraries the library with the given
+		/// path depends on, as found in the DT_NEEDED entries of its ELF
+		/// dynamic section, to needed. Appends nothing if the file cannot
+		/// be read or is not an ELF shared library for this platform.
+	{
+#if defined(__linux__)
+		try
+		{
+			Poco::MappedFile file(path, Poco::MappedFile::ADVICE_RANDOM);
+			const char* data = file.data();
+			std::size_t size = file.size();
+			if (size < sizeof(Elf32_Ehdr) || std::memcmp(data, ELFMAG, SELFMAG) != 0) return;
+#if defined(POCO_ARCH_BIG_ENDIAN)
+			if (data[EI_DATA] != ELFDATA2MSB) return;
+#else
+			if (data[EI_DATA] != ELFDATA2LSB) return;
+#endif
+			if (data[EI_CLASS] == ELFCLASS64 && size >= sizeof(Elf64_Ehdr))
+				readNeededELF<Elf64_Ehdr, Elf64_Shdr, Elf64_Dyn>(data, size, needed);
+			else if (data[EI_CLASS] == ELFCLASS32)
+				readNeededELF<Elf32_Ehdr, Elf32_Shdr, Elf32_Dyn>(data, size, needed);
+		}
+		catch (Poco::Exception&)
+		{
+		}
+#else
+		(void) path;
+		(void) needed;
+#endif
+	}
+
+	static std::string libraryName(const std::string& path)
+		/// Returns the name of the library with the given path or
+		/// soname, i.e. its file name up to the ".so" suffix
+		/// and version number, if any.
+	{
+		std::string name = Poco::Path(path).getFileName();
+		std::string::size_type pos = 0;
+		while ((pos = name.find(".so", pos)) != std::string::npos)
+		{
+			if (pos + 3 == name.size() || name[pos + 3] == '.')
+			{
+				name.resize(pos);
+				break;
+			}
+			pos += 3;
+		}
+		return name;
+	}
+
+private:
+	struct Entry
+	{
+		std::string path;
+		std::string name;
+		std::vector<std::string> needed;
+		void* handle;
+	};
+
+	void sort(std::vector<std::size_t>& indexes) const
+		/// Puts the indexes of all entries into dependency order.
+	{
+		std::map<std::string, std::size_t> byName;
+		for (std::size_t i = 0; i < _entries.size(); ++i)
+		{
+			byName.insert(std::make_pair(_entries[i].name, i));
+		}
+		std::vector<bool> visited(_entries.size(), false);
+		for (std::size_t i = 0; i < _entries.size(); ++i)
+		{
+			visit(i, byName, visited, indexes);
+		}
+	}
+
+	void visit(std::size_t index, const std::map<std::string, std::size_t>& byName, std::vector<bool>& visited, std::vector<std::size_t>& indexes) const
+	{
+		// libraries with cyclic dependencies are loaded in the order found
+		if (visited[index]) return;
+		visited[index] = true;
+		const std::vector<std::string>& needed = _entries[index].needed;
+		for (std::vector<std::string>::const_iterator it = needed.begin(); it != needed.end(); ++it)
+		{
+			std::map<std::string, std::size_t>::const_iterator itN = byName.find(*it);
+			if (itN != byName.end()) visit(itN->second, byName, visited, indexes);
+		}
+		indexes.push_back(index);
+	}
+
+#if defined(__linux__)
+	template <class Ehdr, class Shdr, class Dyn>
+	static void readNeededELF(const char* data, std::size_t size, std::vector<std::string>& needed)
+	{
+		const Ehdr* pEhdr = reinterpret_cast<const Ehdr*>(data);
+		if (pEhdr->e_shoff == 0 || pEhdr->e_shentsize != sizeof(Shdr)) return;
+		if (pEhdr->e_shoff > size || pEhdr->e_shnum > (size - pEhdr->e_shoff)/sizeof(Shdr)) return;
+		const Shdr* pShdr = reinterpret_cast<const Shdr*>(data + pEhdr->e_shoff);
+		for (unsigned i = 0; i < pEhdr->e_shnum; ++i)
+		{
+			if (pShdr[i].sh_type != SHT_DYNAMIC) continue;
+			if (pShdr[i].sh_link >= pEhdr->e_shnum) return;
+			const Shdr& dynamic = pShdr[i];
+			const Shdr& strtab = pShdr[dynamic.sh_link];
+			if (dynamic.sh_offset > size || dynamic.sh_size > size - dynamic.sh_offset) return;
+			if (strtab.sh_offset > size || strtab.sh_size > size - strtab.sh_offset) return;
+			const Dyn* pDyn = reinterpret_cast<const Dyn*>(data + dynamic.sh_offset);
+			std::size_t count = dynamic.sh_size/sizeof(Dyn);
+			for (std::size_t k = 0; k < count && pDyn[k].d_tag != DT_NULL; ++k)
+			{
+				if (pDyn[k].d_tag != DT_NEEDED || pDyn[k].d_un.d_val >= strtab.sh_size) continue;
+				const char* pName = data + strtab.sh_offset + pDyn[k].d_un.d_val;
+				const char* pEnd = static_cast<const char*>(std::memchr(pName, 0, strtab.sh_size - pDyn[k].d_un.d_val));
+				if (pEnd) needed.push_back(std::string(pName, pEnd));
+			}
+			return;
+		}
+	}
+#endif
+
+	LibraryPreloader(const LibraryPreloader&);
+	LibraryPreloader& operator = (const LibraryPreloader&);
+
+	BindPolicy _defaultPolicy;
+	std::map<std::string, BindPolicy> _policies;
+	std::vector<Entry> _entries;
+	std::vector<std::string> _failed;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_LibraryPreloader_INCLUDED
@@ -0,0 +1,377 @@
+//
+// MappedBundleFile.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Bundle
+// Module:  MappedBundleFile
+//
+// Definition of the MappedBundleFile and MappedBundleFactory classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_MappedBundleFile_INCLUDED
+#define OSP_MappedBundleFile_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/BundleStorage.h"
+#include "Poco/OSP/BundleFactory.h"
+#include "Poco/OSP/BundleLoader.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/OSP/LanguageTag.h"
+#include "Poco/MappedFile.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/InflatingStream.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/LRUCache.h"
+#include "Poco/FlatHashMap.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/DateTime.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class MappedBundleFile: public BundleStorage
+	/// MappedBundleFile implements the BundleStorage interface for
+	/// bundles stored in Zip files, like BundleFile, but maps the
+	/// file into memory instead of reading it through a stream.
+	///
+	/// The central directory of the archive is read once, into a hash
+	/// index of the entries. Resources stored without compression are
+	/// read directly from the mapped file, without copying. Compressed
+	/// (deflated) resources up to a given size are decompressed once and
+	/// kept in an LRU cache, so that resources read repeatedly, like
+	/// web resources or extensions.xml, are only decompressed again after
+	/// having been evicted. Larger resources are decompressed while
+	/// they are read.
+	///
+	/// Zip64 archives, encrypted entries and compression methods
+	/// other than deflate are not supported.
+	///
+	/// The streams returned by getResource() keep the mapping valid.
+	/// MappedBundleFile must not be used for archives that are
+	/// modified while in use.
+{
+public:
+	enum
+	{
+		DEFAULT_CACHE_ENTRIES = 64,
+		DEFAULT_MAX_CACHED_SIZE = 64*1024
+	};
+
+	explicit MappedBundleFile(const std::string& path, int cacheEntries = DEFAULT_CACHE_ENTRIES, std::size_t maxCachedSize = DEFAULT_MAX_CACHED_SIZE):
+		_path(path),
+		_pMapping(new Poco::MappedFile(path, Poco::MappedFile::ADVICE_RANDOM)),
+		_cache(cacheEntries),
+		_maxCachedSize(maxCachedSize)
+		/// Creates the MappedBundleFile for the given Zip file.
+		///
+		/// Decompressed resources up to maxCachedSize bytes
+		/// are kept in a cache of up to cacheEntries resources.
+		///
+		/// Throws a Poco::DataFormatException if the file
+		/// is not a valid Zip file.
+	{
+		readDirectory();
+	}
+
+	// BundleStorage
+	std::istream* getResource(const std::string& path) const
+	{
+		IndexMap::ConstIterator it = _index.find(path);
+		if (it == _index.end()) return 0;
+		const Entry& entry = _entries[it->second];
+		if (entry.directory) return 0;
+
+		const char* pData = data(entry);
+		if (entry.method == METHOD_STORED)
+		{
+			return new Poco::MappedFile::Stream(_pMapping, pData, entry.size);
+		}
+		else if (entry.size <= _maxCachedSize)
+		{
+			Poco::SharedPtr<std::string> pContent = _cache.get(path);
+			if (!pContent)
+			{
+				pContent = new std::string;
+				pContent->reserve(entry.size);
+				Poco::MemoryInputStream istr(pData, entry.compressedSize);
+				Poco::InflatingInputStream inflater(istr, -15);
+				Poco::StreamCopier::copyToString(inflater, *pContent);
+				_cache.add(path, pContent);
+			}
+			return new CachedStream(pContent);
+		}
+		else
+		{
+			return new InflatingStream(_pMapping, pData, entry.compressedSize);
+		}
+	}
+
+	void list(const std::string& path, std::vector<std::string>& files) const
+	{
+		files.clear();
+		std::string parent(path);
+		if (!parent.empty() && parent[parent.size() - 1] != '/') parent += '/';
+		std::set<std::string> names;
+		std::vector<std::string>::const_iterator it = std::lower_bound(_sortedNames.begin(), _sortedNames.end(), parent);
+		for (; it != _sortedNames.end() && it->compare(0, parent.size(), parent) == 0; ++it)
+		{
+			std::string::size_type pos = it->find('/', parent.size());
+			std::string name(*it, parent.size(), pos == std::string::npos ? std::string::npos : pos - parent.size());
+			if (!name.empty() && names.insert(name).second) files.push_back(name);
+		}
+	}
+
+	Poco::Timestamp lastModified(const std::string& path) const
+	{
+		IndexMap::ConstIterator it = _index.find(path);
+		if (it == _index.end())
+		{
+			std::string dir(path);
+			dir += '/';
+			it = _index.find(dir);
+			if (it == _index.end()) throw Poco::NotFoundException(path);
+		}
+		return _entries[it->second].lastModified;
+	}
+
+	std::string path() const
+	{
+		return _path;
+	}
+
+protected:
+	enum
+	{
+		METHOD_STORED = 0,
+		METHOD_DEFLATED = 8
+	};
+
+	struct Entry
+	{
+		Entry():
+			method(0),
+			compressedSize(0),
+			size(0),
+			offset(0),
+			directory(false)
+		{
+		}
+
+		Poco::UInt16 method;
+		std::size_t compressedSize;
+		std::size_t size;
+		std::size_t offset;
+		bool directory;
+		Poco::Timestamp lastModified;
+	};
+
+	typedef Poco::FlatHashMap<std::string, std::size_t> IndexMap;
+
+	class CachedStream: public Poco::MemoryInputStream
+		/// Reads a cached decompressed resource.
+	{
+	public:
+		explicit CachedStream(Poco::SharedPtr<std::string> pContent):
+			Poco::MemoryInputStream(pContent->data(), static_cast<std::streamsize>(pContent->size())),
+			_pContent(pContent)
+		{
+		}
+
+	private:
+		Poco::SharedPtr<std::string> _pContent;
+	};
+
+	struct CompressedSource
+	{
+		CompressedSource(Poco::MappedFile::Ptr pMapping, const char* pData, std::size_t size):
+			pSourceMapping(pMapping),
+			source(pData, static_cast<std::streamsize>(size))
+		{
+		}
+
+		Poco::MappedFile::Ptr pSourceMapping;
+		Poco::MemoryInputStream source;
+	};
+
+	class InflatingStream: private CompressedSource, public Poco::InflatingInputStream
+		/// Decompresses a resource while it is read.
+	{
+	public:
+		InflatingStream(Poco::MappedFile::Ptr pMapping, const char* pData, std::size_t size):
+			CompressedSource(pMapping, pData, size),
+			Poco::InflatingInputStream(source, -15)
+		{
+		}
+	};
+
+	~MappedBundleFile()
+		/// Destroys the MappedBundleFile.
+	{
+	}
+
+	static Poco::UInt16 read16(const char* p)
+	{
+		const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+		return static_cast<Poco::UInt16>(u[0] | (u[1] << 8));
+	}
+
+	static Poco::UInt32 read32(const char* p)
+	{
+		const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+		return static_cast<Poco::UInt32>(u[0]) | (static_cast<Poco::UInt32>(u[1]) << 8) | (static_cast<Poco::UInt32>(u[2]) << 16) | (static_cast<Poco::UInt32>(u[3]) << 24);
+	}
+
+	static Poco::Timestamp dosTime(Poco::UInt16 time, Poco::UInt16 date)
+	{
+		int year = 1980 + (date >> 9);
+		int month = (date >> 5) & 0x0F;
+		int day = date & 0x1F;
+		int hour = time >> 11;
+		int minute = (time >> 5) & 0x3F;
+		int second = (time & 0x1F)*2;
+		if (!Poco::DateTime::isValid(year, month, day, hour, minute, second)) return Poco::Timestamp(0);
+		return Poco::DateTime(year, month, day, hour, minute, second).timestamp();
+	}
+
+	void readDirectory()
+	{
+		const char* pBegin = _pMapping->data();
+		std::size_t size = _pMapping->size();
+		if (size < 22) throw Poco::DataFormatException("Not a Zip file", _path);
+
+		// The end of central directory record is followed
+		// by a comment of up to 65535 bytes.
+		std::size_t eocd = size - 22;
+		std::size_t limit = size > 22 + 65535 ? size - 22 - 65535 : 0;
+		while (read32(pBegin + eocd) != 0x06054b50)
+		{
+			if (eocd == limit) throw Poco::DataFormatException("No Zip central directory", _path);
+			--eocd;
+		}
+		std::size_t count = read16(pBegin + eocd + 10);
+		std::size_t dirSize = read32(pBegin + eocd + 12);
+		std::size_t dirOffset = read32(pBegin + eocd + 16);
+		if (dirOffset + dirSize > eocd) throw Poco::DataFormatException("Invalid Zip central directory", _path);
+
+		_entries.reserve(count);
+		_sortedNames.reserve(count);
+		std::size_t pos = dirOffset;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (pos + 46 > eocd || read32(pBegin + pos) != 0x02014b50) throw Poco::DataFormatException("Invalid Zip central directory entry", _path);
+			const char* p = pBegin + pos;
+			Poco::UInt16 flags = read16(p + 8);
+			Entry entry;
+			entry.method = read16(p + 10);
+			entry.lastModified = dosTime(read16(p + 12), read16(p + 14));
+			entry.compressedSize = read32(p + 20);
+			entry.size = read32(p + 24);
+			std::size_t nameLength = read16(p + 28);
+			std::size_t extraLength = read16(p + 30);
+			std::size_t commentLength = read16(p + 32);
+			std::size_t localOffset = read32(p + 42);
+			std::string name(p + 46, nameLength);
+			pos += 46 + nameLength + extraLength + commentLength;
+
+			if (flags & 0x0001) continue; // encrypted
+			if (entry.method != METHOD_STORED && entry.method != METHOD_DEFLATED) continue;
+			if (localOffset + 30 > size || read32(pBegin + localOffset) != 0x04034b50) throw Poco::DataFormatException("Invalid Zip local header", name);
+			entry.offset = localOffset + 30 + read16(pBegin + localOffset + 26) + read16(pBegin + localOffset + 28);
+			if (entry.offset + entry.compressedSize > size) throw Poco::DataFormatException("Invalid Zip entry size", name);
+			entry.directory = !name.empty() && name[name.size() - 1] == '/';
+
+			_index[name] = _entries.size();
+			_entries.push_back(entry);
+			_sortedNames.push_back(name);
+		}
+		std::sort(_sortedNames.begin(), _sortedNames.end());
+	}
+
+	const char* data(const Entry& entry) const
+	{
+		return _pMapping->data() + entry.offset;
+	}
+
+private:
+	MappedBundleFile();
+	MappedBundleFile(const MappedBundleFile&);
+	MappedBundleFile& operator = (const MappedBundleFile&);
+
+	std::string _path;
+	Poco::MappedFile::Ptr _pMapping;
+	std::vector<Entry> _entries;
+	IndexMap _index;
+	std::vector<std::string> _sortedNames;
+	mutable Poco::LRUCache<std::string, std::string> _cache;
+	std::size_t _maxCachedSize;
+};
+
+
+class MappedBundleFactory: public BundleFactory
+	/// A BundleFactory that creates bundles stored in Zip files
+	/// with a MappedBundleFile. Bundles stored in directories are
+	/// created by BundleFactory.
+	///
+	/// Pass a MappedBundleFactory to the BundleLoader
+	/// to use MappedBundleFile for all bundle files.
+{
+public:
+	typedef Poco::AutoPtr<MappedBundleFactory> Ptr;
+
+	explicit MappedBundleFactory(const LanguageTag& language):
+		BundleFactory(language),
+		_language(language)
+		/// Creates the MappedBundleFactory.
+	{
+	}
+
+	Bundle* createBundle(BundleLoader& loader, const std::string& path)
+	{
+		if (Poco::File(path).isDirectory()) return BundleFactory::createBundle(loader, path);
+
+		BundleStorage::Ptr pStorage = new MappedBundleFile(path);
+		return new MappedBundle(loader.nextBundleId(), loader, pStorage, _language);
+	}
+
+protected:
+	class MappedBundle: public Bundle
+	{
+	public:
+		MappedBundle(int id, BundleLoader& loader, BundleStorage::Ptr pStorage, const LanguageTag& language):
+			Bundle(id, loader, pStorage, language)
+		{
+		}
+	};
+
+	~MappedBundleFactory()
+		/// Destroys the MappedBundleFactory.
+	{
+	}
+
+private:
+	LanguageTag _language;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_MappedBundleFile_INCLUDED
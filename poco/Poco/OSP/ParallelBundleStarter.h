@@ -0,0 +1,406 @@
+//
+// ParallelBundleStarter.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Bundle
+// Module:  ParallelBundleStarter
+//
+// Definition of the AsyncBundleActivator and ParallelBundleStarter classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_ParallelBundleStarter_INCLUDED
+#define OSP_ParallelBundleStarter_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/BundleLoader.h"
+#include "Poco/OSP/BundleActivator.h"
+#include "Poco/OSP/BundleContext.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Event.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/ScopedUnlock.h"
+#include "Poco/Clock.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class AsyncBundleActivator: public BundleActivator, protected Poco::Runnable
+	/// A BundleActivator whose start() returns immediately and
+	/// performs the work of startAsync() on a separate thread, for
+	/// bundles that need to wait for a device or a service during
+	/// their start, e.g. to connect to the modem.
+	///
+	/// ParallelBundleStarter waits for startAsync() to complete before
+	/// it starts the bundles requiring the bundle. With
+	/// BundleLoader::startAllBundles(), the other bundles are started
+	/// while startAsync() runs.
+	///
+	/// stop() waits for startAsync() to complete before
+	/// calling stopAsync().
+{
+public:
+	void start(BundleContext::Ptr pContext)
+	{
+		_pContext = pContext;
+		_started.reset();
+		_thread.start(*this);
+	}
+
+	void stop(BundleContext::Ptr pContext)
+	{
+		_thread.join();
+		stopAsync(pContext);
+		_pContext = 0;
+	}
+
+	bool waitStarted(long milliseconds)
+		/// Waits up to the given time for startAsync() to
+		/// complete, and returns true if it has completed.
+	{
+		return _started.tryWait(milliseconds);
+	}
+
+protected:
+	AsyncBundleActivator():
+		_started(false)
+	{
+	}
+
+	~AsyncBundleActivator()
+	{
+	}
+
+	virtual void startAsync(BundleContext::Ptr pContext) = 0;
+		/// Called on a separate thread to start the bundle.
+
+	virtual void stopAsync(BundleContext::Ptr pContext) = 0;
+		/// Called from stop(), after startAsync() has completed.
+
+	void run()
+	{
+		try
+		{
+			startAsync(_pContext);
+		}
+		catch (Poco::Exception& exc)
+		{
+			_pContext->logger().log(exc);
+		}
+		catch (...)
+		{
+			_pContext->logger().error("Unknown exception in AsyncBundleActivator::startAsync()");
+		}
+		_started.set();
+	}
+
+private:
+	BundleContext::Ptr _pContext;
+	Poco::Thread _thread;
+	Poco::Event _started;
+};
+
+
+class ParallelBundleStarter
+	/// ParallelBundleStarter starts the resolved bundles of a
+	/// BundleLoader on a bounded number of threads, as an alternative
+	/// to BundleLoader::startAllBundles().
+	///
+	/// Bundles are still started one run level after the other, and
+	/// lazy-start bundles are only started as dependencies of other
+	/// bundles. Within a run level, a bundle is started as soon as all
+	/// bundles it requires (Require-Bundle) have been started, so that
+	/// bundles that do not depend on each other are started
+	/// concurrently. A bundle whose activator is an AsyncBundleActivator
+	/// counts as started when its startAsync() has completed, or after
+	/// the async start timeout has expired.
+	///
+	/// Bundles are started with Bundle::start(), so that the loader's
+	/// bookkeeping, events and error handling, including the application
+	/// activation states, are the same as with startAllBundles(). The
+	/// loader serializes the start of bundles while an activator's
+	/// start() runs; therefore activators that block for a long time
+	/// should derive from AsyncBundleActivator.
+	///
+	/// The time taken to start each bundle is reported with
+	/// the bundleStarted event and by records().
+	///
+	/// Usage example:
+	///
+	///     loader.resolveAllBundles();
+	///     ParallelBundleStarter starter(loader);
+	///     starter.startAll();
+{
+public:
+	struct StartRecord
+	{
+		StartRecord():
+			startTime(0),
+			asyncTime(0),
+			failed(false)
+		{
+		}
+
+		Bundle::Ptr pBundle;
+		Poco::Clock::ClockDiff startTime;
+			/// Time in microseconds spent in Bundle::start().
+		Poco::Clock::ClockDiff asyncTime;
+			/// Time in microseconds spent waiting
+			/// for an AsyncBundleActivator.
+		bool failed;
+		std::string error;
+	};
+
+	typedef std::vector<StartRecord> Records;
+
+	Poco::BasicEvent<const StartRecord> bundleStarted;
+		/// Fired on a worker thread after a bundle has been started,
+		/// or has failed to start.
+
+	enum
+	{
+		DEFAULT_WORKERS = 4,
+		DEFAULT_ASYNC_TIMEOUT = 30000
+	};
+
+	explicit ParallelBundleStarter(BundleLoader& loader, int workers = DEFAULT_WORKERS, long asyncTimeout = DEFAULT_ASYNC_TIMEOUT):
+		_loader(loader),
+		_workers(workers > 0 ? workers : 1),
+		_asyncTimeout(asyncTimeout),
+		_remaining(0),
+		_running(0)
+		/// Creates the ParallelBundleStarter, using the given number of
+		/// threads, and waiting up to asyncTimeout milliseconds for
+		/// each AsyncBundleActivator.
+	{
+	}
+
+	~ParallelBundleStarter()
+		/// Destroys the ParallelBundleStarter.
+	{
+	}
+
+	void startAll()
+		/// Starts all resolved bundles that have not been started
+		/// and are not lazy-start bundles, and returns when all have
+		/// been started, or have failed.
+	{
+		std::vector<Bundle::Ptr> bundles;
+		_loader.listBundles(bundles);
+		std::map<std::string, std::vector<Bundle::Ptr> > levels;
+		for (std::vector<Bundle::Ptr>::iterator it = bundles.begin(); it != bundles.end(); ++it)
+		{
+			if ((*it)->isResolved() && !(*it)->isStarted() && !(*it)->lazyStart())
+			{
+				levels[(*it)->runLevel()].push_back(*it);
+			}
+		}
+		for (std::map<std::string, std::vector<Bundle::Ptr> >::iterator it = levels.begin(); it != levels.end(); ++it)
+		{
+			startLevel(it->second);
+		}
+	}
+
+	Records records() const
+		/// Returns the start records of all bundles started.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _records;
+	}
+
+protected:
+	struct Node
+	{
+		Node():
+			pending(0)
+		{
+		}
+
+		Bundle::Ptr pBundle;
+		int pending;
+		std::vector<std::size_t> dependents;
+	};
+
+	class Worker: public Poco::Runnable
+	{
+	public:
+		explicit Worker(ParallelBundleStarter& starter):
+			_starter(starter)
+		{
+		}
+
+		void run()
+		{
+			_starter.work();
+		}
+
+	private:
+		ParallelBundleStarter& _starter;
+	};
+
+	void startLevel(const std::vector<Bundle::Ptr>& bundles)
+	{
+		std::map<std::string, std::size_t> index;
+		_nodes.clear();
+		_nodes.resize(bundles.size());
+		for (std::size_t i = 0; i < bundles.size(); ++i)
+		{
+			_nodes[i].pBundle = bundles[i];
+			index[bundles[i]->symbolicName()] = i;
+		}
+		for (std::size_t i = 0; i < bundles.size(); ++i)
+		{
+			const BundleManifest::Dependencies& deps = bundles[i]->requiredBundles();
+			for (BundleManifest::Dependencies::const_iterator it = deps.begin(); it != deps.end(); ++it)
+			{
+				std::map<std::string, std::size_t>::const_iterator itI = index.find(it->symbolicName);
+				if (itI != index.end() && itI->second != i)
+				{
+					_nodes[itI->second].dependents.push_back(i);
+					++_nodes[i].pending;
+				}
+			}
+		}
+		_ready.clear();
+		for (std::size_t i = 0; i < _nodes.size(); ++i)
+		{
+			if (_nodes[i].pending == 0) _ready.push_back(i);
+		}
+		_remaining = _nodes.size();
+
+		int nThreads = static_cast<int>(_nodes.size()) < _workers ? static_cast<int>(_nodes.size()) : _workers;
+		std::vector<Poco::Thread*> threads;
+		Worker worker(*this);
+		for (int i = 0; i < nThreads; ++i)
+		{
+			Poco::Thread* pThread = new Poco::Thread("OSP.BundleStarter");
+			threads.push_back(pThread);
+			pThread->start(worker);
+		}
+		for (std::vector<Poco::Thread*>::iterator it = threads.begin(); it != threads.end(); ++it)
+		{
+			(*it)->join();
+			delete *it;
+		}
+	}
+
+	void work()
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		while (_remaining > 0)
+		{
+			if (_ready.empty())
+			{
+				if (_running == 0)
+				{
+					// The remaining bundles require each other;
+					// the loader starts their dependencies first.
+					for (std::size_t i = 0; i < _nodes.size(); ++i)
+					{
+						if (_nodes[i].pending > 0)
+						{
+							_nodes[i].pending = 0;
+							_ready.push_back(i);
+						}
+					}
+				}
+				else
+				{
+					_changed.wait(_mutex);
+				}
+				continue;
+			}
+			std::size_t i = _ready.front();
+			_ready.pop_front();
+			++_running;
+			StartRecord record;
+			{
+				Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+				record = start(_nodes[i].pBundle);
+				try
+				{
+					bundleStarted(this, record);
+				}
+				catch (...)
+				{
+				}
+			}
+			--_running;
+			--_remaining;
+			_records.push_back(record);
+			for (std::vector<std::size_t>::const_iterator it = _nodes[i].dependents.begin(); it != _nodes[i].dependents.end(); ++it)
+			{
+				if (_nodes[*it].pending > 0 && --_nodes[*it].pending == 0) _ready.push_back(*it);
+			}
+			_changed.broadcast();
+		}
+	}
+
+	StartRecord start(Bundle::Ptr pBundle)
+	{
+		StartRecord record;
+		record.pBundle = pBundle;
+		Poco::Clock clock;
+		try
+		{
+			if (!pBundle->isStarted()) pBundle->start();
+		}
+		catch (Poco::Exception& exc)
+		{
+			record.failed = true;
+			record.error = exc.displayText();
+		}
+		record.startTime = clock.elapsed();
+		AsyncBundleActivator* pAsync = dynamic_cast<AsyncBundleActivator*>(pBundle->activator());
+		if (pAsync && !record.failed)
+		{
+			clock.update();
+			if (!pAsync->waitStarted(_asyncTimeout))
+			{
+				record.error = "Timeout waiting for asynchronous start";
+			}
+			record.asyncTime = clock.elapsed();
+		}
+		return record;
+	}
+
+private:
+	ParallelBundleStarter(const ParallelBundleStarter&);
+	ParallelBundleStarter& operator = (const ParallelBundleStarter&);
+
+	BundleLoader& _loader;
+	int _workers;
+	long _asyncTimeout;
+	std::vector<Node> _nodes;
+	std::deque<std::size_t> _ready;
+	std::size_t _remaining;
+	int _running;
+	Records _records;
+	Poco::Condition _changed;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_ParallelBundleStarter_INCLUDED
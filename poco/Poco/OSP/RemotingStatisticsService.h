@@ -0,0 +1,110 @@
+//
+// RemotingStatisticsService.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  RemotingStatisticsService
+//
+// Definition of the RemotingStatisticsService class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_RemotingStatisticsService_INCLUDED
+#define OSP_RemotingStatisticsService_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/RemotingNG/MethodStatistics.h"
+#include <vector>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class RemotingStatisticsService: public Service
+	/// The RemotingStatisticsService gives bundles access to the
+	/// per-method call statistics of Remoting calls, as recorded by
+	/// TimingTransport and TimedMethodHandler in a MethodStatistics
+	/// object.
+	///
+	/// Register the service with the ServiceRegistry under
+	/// serviceName().
+{
+public:
+	typedef Poco::AutoPtr<RemotingStatisticsService> Ptr;
+	typedef Poco::RemotingNG::MethodStatistics MethodStatistics;
+
+	static const std::string& serviceName()
+		/// Returns the name under which the service
+		/// should be registered.
+	{
+		static const std::string name("osp.core.remotingstatistics");
+		return name;
+	}
+
+	explicit RemotingStatisticsService(MethodStatistics& statistics = MethodStatistics::defaultStatistics()):
+		_statistics(statistics)
+		/// Creates the RemotingStatisticsService for the given MethodStatistics.
+	{
+	}
+
+	bool statistics(MethodStatistics::Side side, const std::string& method, MethodStatistics::Snapshot& snapshot) const
+		/// Copies the statistics of the given method and returns true,
+		/// or returns false if no call of the method has been recorded.
+	{
+		return _statistics.statistics(side, method, snapshot);
+	}
+
+	void methods(MethodStatistics::Side side, std::vector<std::string>& names) const
+		/// Returns the names of all methods with recorded calls.
+	{
+		_statistics.methods(side, names);
+	}
+
+	void reset()
+		/// Removes all recorded statistics.
+	{
+		_statistics.reset();
+	}
+
+	MethodStatistics& methodStatistics()
+		/// Returns the MethodStatistics, e.g. to subscribe
+		/// to traced calls.
+	{
+		return _statistics;
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(RemotingStatisticsService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(RemotingStatisticsService), otherType) || Service::isA(otherType);
+	}
+
+protected:
+	~RemotingStatisticsService()
+	{
+	}
+
+private:
+	MethodStatistics& _statistics;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_RemotingStatisticsService_INCLUDED
@@ -72,7 +72,8 @@ public:
 		/// cannot be casted to the desired type.
 	{
 		Service::Ptr pService = instance();
-		if (pService->isA(typeid(Svc)))
+		const std::type_info& svcType = typeid(Svc);
+		if (Service::isSameType(pService->type(), svcType) || pService->isA(svcType))
 		{
 			// We'd like to use AutoPtr::unsafeCast<Svc>() here,
 			// but older GCC versions don't like it.
@@ -84,7 +85,7 @@ public:
 			std::string msg("Cannot cast from ");
 			msg += pService->type().name();
 			msg += " to ";
-			msg += typeid(Svc).name();
+			msg += svcType.name();
 			throw Poco::BadCastException(msg);
 		}
 	}
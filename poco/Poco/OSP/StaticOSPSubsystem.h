@@ -0,0 +1,98 @@
+//
+// StaticOSPSubsystem.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  StaticOSPSubsystem
+//
+// Definition of the StaticOSPSubsystem class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_StaticOSPSubsystem_INCLUDED
+#define OSP_StaticOSPSubsystem_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/OSPSubsystem.h"
+#include "Poco/OSP/StaticBundle.h"
+#include "Poco/OSP/BundleLoader.h"
+#include "Poco/OSP/LanguageTag.h"
+#include "Poco/Util/Application.h"
+
+
+namespace Poco {
+namespace OSP {
+
+
+class StaticOSPSubsystem: public OSPSubsystem
+	/// StaticOSPSubsystem sets up the OSP runtime environment like
+	/// OSPSubsystem, but installs the bundles linked into the executable,
+	/// from a table of StaticBundleInfo entries, with a StaticBundleRegistry,
+	/// instead of loading bundles from the bundle repositories.
+	///
+	/// This is the startup of a monolithic image, where OSP and all
+	/// bundles are linked statically into one executable, with
+	/// POCO_OSP_STATIC defined:
+	///
+	///     class ImageApplication: public Poco::Util::ServerApplication
+	///     {
+	///     public:
+	///         ImageApplication()
+	///         {
+	///             addSubsystem(new Poco::OSP::StaticOSPSubsystem(bundles));
+	///         }
+	///         ...
+	///     };
+	///
+	/// If the configuration property osp.static.loadRepository is true,
+	/// the bundle repositories are loaded as well, after the static
+	/// bundles, e.g. for additional bundles without code during
+	/// development.
+{
+public:
+	explicit StaticOSPSubsystem(const StaticBundleInfo* pBundles):
+		_registry(pBundles)
+		/// Creates the StaticOSPSubsystem for the given table, which
+		/// is terminated by POCO_OSP_STATIC_BUNDLE_END.
+	{
+	}
+
+	~StaticOSPSubsystem()
+		/// Destroys the StaticOSPSubsystem.
+	{
+	}
+
+	const StaticBundleRegistry& staticBundles() const
+		/// Returns the registry of the static bundles.
+	{
+		return _registry;
+	}
+
+protected:
+	void loadBundles(Poco::Util::Application& app)
+	{
+		std::string language = app.config().getString("osp.language", "");
+		_registry.install(bundleLoader(), language.empty() ? LanguageTag() : LanguageTag(language));
+		if (app.config().getBool("osp.static.loadRepository", false))
+		{
+			OSPSubsystem::loadBundles(app);
+		}
+	}
+
+private:
+	StaticBundleRegistry _registry;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_StaticOSPSubsystem_INCLUDED
@@ -0,0 +1,395 @@
+//
+// WebResourceCache.h
+//
+// $Id$
+//
+// Library: OSPWeb
+// Package: Web
+// Module:  WebResourceCache
+//
+// Definition of the WebResourceCache class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_Web_WebResourceCache_INCLUDED
+#define OSP_Web_WebResourceCache_INCLUDED
+
+
+#include "Poco/OSP/Web/Web.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/BufferStream.h"
+#include "Poco/SHA1Engine.h"
+#include "Poco/DigestEngine.h"
+#include "Poco/HexBinary.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeParser.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/DateTime.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Timestamp.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <cstring>
+#include <list>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+namespace Web {
+
+
+class WebResourceCache
+	/// WebResourceCache keeps bundle resources served by the web
+	/// server in memory, together with a gzip-compressed variant, an
+	/// entity tag and the last modification time, so that requests
+	/// for them are answered without reading and inflating the bundle
+	/// archive again.
+	///
+	/// Conditional requests (If-None-Match, If-Modified-Since) for cached
+	/// resources are answered with 304 Not Modified without touching the
+	/// bundle. Clients accepting gzip content encoding receive the
+	/// compressed variant, if one has been created for the media type.
+	///
+	/// Resources larger than the maximum entry size are not kept in
+	/// memory. If they are files in a bundle directory, they are sent
+	/// with HTTPServerResponse::sendFile(), which copies the file to the
+	/// socket without reading it into memory first; their entity tag is
+	/// derived from size and modification time.
+	///
+	/// The total size of the cached data is bounded; the least recently
+	/// used resources are removed first. When a bundle is stopped or
+	/// updated, its resources must be removed with uncacheBundle().
+	///
+	/// WebResourceCache is thread-safe.
+{
+public:
+	class Resource: public Poco::RefCountedObject
+		/// A cached resource.
+	{
+	public:
+		typedef Poco::AutoPtr<Resource> Ptr;
+
+		Resource()
+		{
+		}
+
+		std::string data;
+			/// The resource content, empty if filePath is set.
+		std::string gzipData;
+			/// The gzip-compressed content, or empty if
+			/// the resource is not sent compressed.
+		std::string filePath;
+			/// The path of a large resource in a bundle directory.
+		std::string etag;
+		Poco::Timestamp lastModified;
+		std::string mediaType;
+
+	protected:
+		~Resource()
+		{
+		}
+	};
+
+	enum
+	{
+		DEFAULT_MAX_SIZE = 8*1024*1024,
+		DEFAULT_MAX_ENTRY_SIZE = 256*1024,
+		MIN_COMPRESS_SIZE = 512
+	};
+
+	explicit WebResourceCache(std::size_t maxSize = DEFAULT_MAX_SIZE, std::size_t maxEntrySize = DEFAULT_MAX_ENTRY_SIZE):
+		_maxSize(maxSize),
+		_maxEntrySize(maxEntrySize),
+		_size(0)
+		/// Creates the WebResourceCache, keeping up to maxSize bytes
+		/// of content, and resources of up to maxEntrySize bytes.
+	{
+	}
+
+	~WebResourceCache()
+		/// Destroys the WebResourceCache.
+	{
+	}
+
+	Resource::Ptr get(Bundle::ConstPtr pBundle, const std::string& path, const std::string& mediaType)
+		/// Returns the resource with the given path from the given
+		/// bundle, loading it into the cache if necessary.
+		///
+		/// Returns a null pointer if the resource does not exist, or is
+		/// too large to cache and not a file in a bundle directory.
+	{
+		Key key(pBundle->symbolicName(), path);
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			EntryMap::iterator it = _entries.find(key);
+			if (it != _entries.end())
+			{
+				_lru.splice(_lru.begin(), _lru, it->second.lruPos);
+				return it->second.pResource;
+			}
+		}
+
+		Resource::Ptr pResource = load(*pBundle, path, mediaType);
+		if (!pResource) return pResource;
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		EntryMap::iterator it = _entries.find(key);
+		if (it != _entries.end()) return it->second.pResource;
+		std::size_t size = pResource->data.size() + pResource->gzipData.size();
+		if (size > _maxSize) return pResource;
+		while (_size + size > _maxSize && !_lru.empty())
+		{
+			removeEntry(_lru.back());
+		}
+		Entry& entry = _entries[key];
+		entry.pResource = pResource;
+		entry.size = size;
+		_lru.push_front(key);
+		entry.lruPos = _lru.begin();
+		_size += size;
+		return pResource;
+	}
+
+	bool send(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, Bundle::ConstPtr pBundle, const std::string& path, const std::string& mediaType)
+		/// Sends the resource with the given path from the
+		/// given bundle as response to the given request.
+		///
+		/// Returns false, without sending a response, if the resource
+		/// cannot be served from the cache (see get()).
+	{
+		Resource::Ptr pResource = get(pBundle, path, mediaType);
+		if (!pResource) return false;
+
+		response.set("ETag", pResource->etag);
+		response.set("Last-Modified", Poco::DateTimeFormatter::format(pResource->lastModified, Poco::DateTimeFormat::HTTP_FORMAT));
+		if (notModified(request, *pResource))
+		{
+			response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED);
+			response.setContentLength(0);
+			response.send();
+			return true;
+		}
+		if (!pResource->filePath.empty())
+		{
+			response.sendFile(pResource->filePath, pResource->mediaType);
+			return true;
+		}
+		response.setContentType(pResource->mediaType);
+		if (!pResource->gzipData.empty())
+		{
+			response.set("Vary", "Accept-Encoding");
+			if (acceptsGzip(request))
+			{
+				response.set("Content-Encoding", "gzip");
+				response.sendBuffer(pResource->gzipData.data(), pResource->gzipData.size());
+				return true;
+			}
+		}
+		response.sendBuffer(pResource->data.data(), pResource->data.size());
+		return true;
+	}
+
+	void uncacheBundle(Bundle::ConstPtr pBundle)
+		/// Removes all resources of the given bundle.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		EntryMap::iterator it = _entries.lower_bound(Key(pBundle->symbolicName(), std::string()));
+		while (it != _entries.end() && it->first.first == pBundle->symbolicName())
+		{
+			_lru.erase(it->second.lruPos);
+			_size -= it->second.size;
+			_entries.erase(it++);
+		}
+	}
+
+	void clear()
+		/// Removes all resources.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_entries.clear();
+		_lru.clear();
+		_size = 0;
+	}
+
+	void trim(std::size_t maxSize)
+		/// Removes the least recently used resources until the
+		/// total size of the cached content is at most maxSize,
+		/// without changing the maximum size of the cache.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		while (_size > maxSize && !_lru.empty())
+		{
+			removeEntry(_lru.back());
+		}
+	}
+
+	std::size_t maxSize() const
+		/// Returns the maximum size of the cached content.
+	{
+		return _maxSize;
+	}
+
+	std::size_t size() const
+		/// Returns the total size of the cached content.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _size;
+	}
+
+	static bool isCompressible(const std::string& mediaType)
+		/// Returns true if content with the given media type
+		/// benefits from compression.
+	{
+		static const char* types[] =
+		{
+			"text/",
+			"application/javascript",
+			"application/json",
+			"application/xml",
+			"image/svg+xml"
+		};
+		for (std::size_t i = 0; i < sizeof(types)/sizeof(types[0]); ++i)
+		{
+			if (mediaType.compare(0, std::strlen(types[i]), types[i]) == 0) return true;
+		}
+		return false;
+	}
+
+protected:
+	typedef std::pair<std::string, std::string> Key;
+	typedef std::list<Key> LRUList;
+
+	struct Entry
+	{
+		Entry():
+			size(0)
+		{
+		}
+
+		Resource::Ptr pResource;
+		std::size_t size;
+		LRUList::iterator lruPos;
+	};
+
+	typedef std::map<Key, Entry> EntryMap;
+
+	void removeEntry(const Key& key)
+	{
+		EntryMap::iterator it = _entries.find(key);
+		_size -= it->second.size;
+		_lru.erase(it->second.lruPos);
+		_entries.erase(it);
+	}
+
+	Resource::Ptr load(const Bundle& bundle, const std::string& path, const std::string& mediaType) const
+	{
+		Resource::Ptr pResource = new Resource;
+		pResource->mediaType = mediaType;
+
+		Poco::File bundleFile(bundle.path());
+		bool isFile = bundle.path().compare(0, 7, "static:") != 0; // see StaticBundleStorage
+		if (isFile && bundleFile.isDirectory())
+		{
+			Poco::Path filePath(bundle.path());
+			filePath.makeDirectory();
+			filePath.append(path);
+			Poco::File file(filePath);
+			if (!file.exists() || !file.isFile()) return Resource::Ptr();
+			pResource->lastModified = file.getLastModified();
+			if (file.getSize() > _maxEntrySize)
+			{
+				pResource->filePath = filePath.toString();
+				pResource->etag = "\"";
+				pResource->etag += Poco::NumberFormatter::formatHex(file.getSize());
+				pResource->etag += '-';
+				pResource->etag += Poco::NumberFormatter::formatHex(pResource->lastModified.epochMicroseconds());
+				pResource->etag += '"';
+				return pResource;
+			}
+		}
+		else if (isFile) pResource->lastModified = bundleFile.getLastModified();
+
+		Poco::SharedPtr<std::istream> pStream(bundle.getResource(path));
+		if (!pStream) return Resource::Ptr();
+		char buffer[8192];
+		while (pStream->read(buffer, sizeof(buffer)) || pStream->gcount() > 0)
+		{
+			pResource->data.append(buffer, static_cast<std::size_t>(pStream->gcount()));
+			if (pResource->data.size() > _maxEntrySize) return Resource::Ptr();
+		}
+
+		Poco::SHA1Engine sha1;
+		sha1.update(pResource->data);
+		pResource->etag = "\"";
+		pResource->etag += Poco::HexBinary::encode(sha1.digest()).substr(0, 20);
+		pResource->etag += '"';
+
+		if (pResource->data.size() >= MIN_COMPRESS_SIZE && isCompressible(mediaType))
+		{
+			Poco::BufferOutputStream ostr(pResource->data.size()/2);
+			Poco::DeflatingOutputStream deflater(ostr, Poco::DeflatingStreamBuf::STREAM_GZIP);
+			deflater.write(pResource->data.data(), static_cast<std::streamsize>(pResource->data.size()));
+			deflater.close();
+			if (ostr.size() < pResource->data.size()) pResource->gzipData.assign(ostr.data(), ostr.size());
+		}
+		return pResource;
+	}
+
+	static bool notModified(const Poco::Net::HTTPServerRequest& request, const Resource& resource)
+	{
+		if (request.has("If-None-Match"))
+		{
+			const std::string& tags = request.get("If-None-Match");
+			return tags == "*" || tags.find(resource.etag) != std::string::npos;
+		}
+		if (request.has("If-Modified-Since"))
+		{
+			Poco::DateTime since;
+			int tzd;
+			if (Poco::DateTimeParser::tryParse(Poco::DateTimeFormat::HTTP_FORMAT, request.get("If-Modified-Since"), since, tzd))
+			{
+				// HTTP dates have a resolution of one second.
+				return resource.lastModified.epochTime() <= since.timestamp().epochTime();
+			}
+		}
+		return false;
+	}
+
+	static bool acceptsGzip(const Poco::Net::HTTPServerRequest& request)
+	{
+		return request.has("Accept-Encoding") && request.get("Accept-Encoding").find("gzip") != std::string::npos;
+	}
+
+private:
+	WebResourceCache(const WebResourceCache&);
+	WebResourceCache& operator = (const WebResourceCache&);
+
+	std::size_t _maxSize;
+	std::size_t _maxEntrySize;
+	std::size_t _size;
+	EntryMap _entries;
+	LRUList _lru;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } } // namespace Poco::OSP::Web
+
+
+#endif // OSP_Web_WebResourceCache_INCLUDED
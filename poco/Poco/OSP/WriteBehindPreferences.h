@@ -0,0 +1,338 @@
+//
+// WriteBehindPreferences.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Preferences
+// Module:  WriteBehindPreferences
+//
+// Definition of the WriteBehindPreferences class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_WriteBehindPreferences_INCLUDED
+#define OSP_WriteBehindPreferences_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/PreferencesEvent.h"
+#include "Poco/Util/PropertyFileConfiguration.h"
+#include "Poco/Timer.h"
+#include "Poco/FileStream.h"
+#include "Poco/File.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <set>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class WriteBehindPreferences: public Poco::Util::PropertyFileConfiguration
+	/// WriteBehindPreferences is a replacement for Preferences for
+	/// bundles that change their preferences frequently, e.g. to remember
+	/// the last known mobile country code.
+	///
+	/// Changes are kept in memory, and the keys changed are coalesced
+	/// until the preferences are flushed, either periodically by a timer,
+	/// by an explicit call to flush(), or when the object is destroyed.
+	/// Changing the same key many times between two flushes therefore
+	/// results in a single write.
+	///
+	/// Two storage modes are supported:
+	///   - MODE_SNAPSHOT: on each flush, the whole properties file is
+	///     written to a temporary file, which is then renamed, so that
+	///     the file is never left partially written.
+	///   - MODE_JOURNAL: on each flush, only the changed keys are appended
+	///     to a journal file next to the properties file (path + ".journal").
+	///     When the journal contains more than the given number of records,
+	///     it is compacted into the properties file. A partially written
+	///     last journal record, e.g. after a power loss, is ignored.
+	///
+	/// In both modes, the properties file has the same format as the file
+	/// of a Preferences object, so existing preferences files can be used.
+	///
+	/// WriteBehindPreferences is thread-safe.
+{
+public:
+	typedef Poco::AutoPtr<WriteBehindPreferences> Ptr;
+
+	enum Mode
+	{
+		MODE_SNAPSHOT,
+		MODE_JOURNAL
+	};
+
+	enum
+	{
+		DEFAULT_FLUSH_INTERVAL = 5000,
+		DEFAULT_COMPACT_THRESHOLD = 1000
+	};
+
+	Poco::BasicEvent<PreferencesEvent> propertyChanged;
+		/// Fired whenever a property is about to be changed.
+
+	WriteBehindPreferences(const std::string& path, Mode mode = MODE_SNAPSHOT, long flushInterval = DEFAULT_FLUSH_INTERVAL, int compactThreshold = DEFAULT_COMPACT_THRESHOLD):
+		_path(path),
+		_journalPath(path + ".journal"),
+		_mode(mode),
+		_compactThreshold(compactThreshold),
+		_journalRecords(0),
+		_loading(true),
+		_timer(flushInterval, flushInterval)
+		/// Creates the WriteBehindPreferences, using the given path,
+		/// and loads the properties file and the journal, if they exist.
+		///
+		/// If flushInterval is greater than zero, changes are flushed
+		/// every flushInterval milliseconds.
+	{
+		if (Poco::File(_path).exists()) load(_path);
+		replayJournal();
+		_loading = false;
+		if (flushInterval > 0)
+		{
+			_timer.start(Poco::TimerCallback<WriteBehindPreferences>(*this, &WriteBehindPreferences::onTimer));
+		}
+	}
+
+	void flush()
+		/// Writes all changes made since the last flush.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (_dirty.empty()) return;
+
+		if (_mode == MODE_JOURNAL && _journalRecords + static_cast<int>(_dirty.size()) <= _compactThreshold)
+		{
+			appendJournal();
+		}
+		else
+		{
+			writeSnapshot();
+		}
+		_dirty.clear();
+	}
+
+	void compact()
+		/// Writes all properties to the properties file
+		/// and removes the journal.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		writeSnapshot();
+		_dirty.clear();
+	}
+
+	void save()
+		/// Same as flush(), for compatibility with Preferences.
+	{
+		flush();
+	}
+
+	std::size_t pending() const
+		/// Returns the number of keys changed since the last flush.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _dirty.size();
+	}
+
+protected:
+	~WriteBehindPreferences()
+	{
+		try
+		{
+			_timer.stop();
+			flush();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	bool getRaw(const std::string& key, std::string& value) const
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return PropertyFileConfiguration::getRaw(key, value);
+	}
+
+	void setRaw(const std::string& key, const std::string& value)
+	{
+		if (_loading)
+		{
+			// Called by PropertyFileConfiguration::load().
+			PropertyFileConfiguration::setRaw(key, value);
+			return;
+		}
+
+		std::string oldValue;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (PropertyFileConfiguration::getRaw(key, oldValue) && oldValue == value) return;
+		}
+		PreferencesEvent event(key, oldValue, value);
+		propertyChanged(this, event);
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		PropertyFileConfiguration::setRaw(key, value);
+		_dirty.insert(key);
+	}
+
+	void enumerate(const std::string& key, Keys& range) const
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		PropertyFileConfiguration::enumerate(key, range);
+	}
+
+	void removeRaw(const std::string& key)
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		std::string value;
+		if (!PropertyFileConfiguration::getRaw(key, value)) return;
+		PropertyFileConfiguration::removeRaw(key);
+		_dirty.insert(key);
+	}
+
+	void onTimer(Poco::Timer&)
+	{
+		try
+		{
+			flush();
+		}
+		catch (Poco::Exception&)
+		{
+			// The changes are still dirty and
+			// are written with the next flush.
+		}
+	}
+
+	void writeSnapshot()
+	{
+		std::string tmpPath(_path);
+		tmpPath += ".tmp";
+		PropertyFileConfiguration::save(tmpPath);
+		Poco::File(tmpPath).renameTo(_path);
+		Poco::File journal(_journalPath);
+		if (journal.exists()) journal.remove();
+		_journalRecords = 0;
+	}
+
+	void appendJournal()
+	{
+		Poco::FileOutputStream ostr(_journalPath, std::ios::out | std::ios::app);
+		for (std::set<std::string>::const_iterator it = _dirty.begin(); it != _dirty.end(); ++it)
+		{
+			std::string value;
+			if (PropertyFileConfiguration::getRaw(*it, value))
+				ostr << "S " << escape(*it) << '\t' << escape(value) << '\n';
+			else
+				ostr << "R " << escape(*it) << '\n';
+		}
+		ostr.close();
+		if (!ostr.good()) throw Poco::WriteFileException(_journalPath);
+		_journalRecords += static_cast<int>(_dirty.size());
+	}
+
+	void replayJournal()
+	{
+		if (!Poco::File(_journalPath).exists()) return;
+
+		Poco::FileInputStream istr(_journalPath);
+		std::string line;
+		bool torn = false;
+		while (std::getline(istr, line))
+		{
+			// A last line without terminating newline
+			// has not been written completely.
+			if (istr.eof())
+			{
+				torn = true;
+				break;
+			}
+			if (line.size() < 2 || line[1] != ' ') continue;
+			if (line[0] == 'S')
+			{
+				std::string::size_type pos = line.find('\t', 2);
+				if (pos == std::string::npos) continue;
+				PropertyFileConfiguration::setRaw(unescape(line.substr(2, pos - 2)), unescape(line.substr(pos + 1)));
+			}
+			else if (line[0] == 'R')
+			{
+				PropertyFileConfiguration::removeRaw(unescape(line.substr(2)));
+			}
+			++_journalRecords;
+		}
+		istr.close();
+		// Records must not be appended to an incomplete one.
+		if (torn) writeSnapshot();
+	}
+
+	static std::string escape(const std::string& str)
+	{
+		std::string result;
+		result.reserve(str.size());
+		for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+		{
+			switch (*it)
+			{
+			case '\\': result += "\\\\"; break;
+			case '\t': result += "\\t"; break;
+			case '\n': result += "\\n"; break;
+			case '\r': result += "\\r"; break;
+			default:   result += *it; break;
+			}
+		}
+		return result;
+	}
+
+	static std::string unescape(const std::string& str)
+	{
+		std::string result;
+		result.reserve(str.size());
+		for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+		{
+			if (*it == '\\' && it + 1 != str.end())
+			{
+				++it;
+				switch (*it)
+				{
+				case 't': result += '\t'; break;
+				case 'n': result += '\n'; break;
+				case 'r': result += '\r'; break;
+				default:  result += *it; break;
+				}
+			}
+			else result += *it;
+		}
+		return result;
+	}
+
+private:
+	WriteBehindPreferences();
+	WriteBehindPreferences(const WriteBehindPreferences&);
+	WriteBehindPreferences& operator = (const WriteBehindPreferences&);
+
+	std::string _path;
+	std::string _journalPath;
+	Mode _mode;
+	int _compactThreshold;
+	int _journalRecords;
+	bool _loading;
+	std::set<std::string> _dirty;
+	Poco::Timer _timer;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_WriteBehindPreferences_INCLUDED
@@ -22,6 +22,7 @@
 
 #include "Poco/NotificationStrategy.h"
 #include "Poco/SharedPtr.h"
+#include <algorithm>
 #include <vector>
 
 
@@ -32,22 +33,45 @@ template <class TArgs, class TDelegate>
 class PriorityStrategy: public NotificationStrategy<TArgs, TDelegate>
 	/// NotificationStrategy for PriorityEvent.
 	///
-	/// Delegates are kept in a std::vector<>, ordered
-	/// by their priority.
+	/// Delegates are kept in a contiguous std::vector<> of
+	/// (priority, delegate) pairs, ordered by priority, and
+	/// in the order in which they have been registered for
+	/// equal priorities. The priorities are kept next to the
+	/// delegates, so add() finds the insertion position with a
+	/// binary search, without calling priority() on every
+	/// registered delegate.
+	///
+	/// Like with SnapshotStrategy, the vector is immutable and
+	/// reference-counted, and replaced as a whole by add(),
+	/// remove() and clear(), so that the copy of the strategy
+	/// that AbstractEvent makes for every notify() only copies
+	/// a single SharedPtr.
+	///
+	/// For a fixed set of priority levels, FixedPriorityStrategy
+	/// does not even need the priorities at notify() time.
 {
 public:
 	typedef TDelegate*                   DelegateHandle;
 	typedef SharedPtr<TDelegate>         DelegatePtr;
-	typedef std::vector<DelegatePtr>     Delegates;
+
+	struct Entry
+	{
+		int priority;
+		DelegatePtr pDelegate;
+	};
+
+	typedef std::vector<Entry>           Delegates;
+	typedef SharedPtr<Delegates>         DelegatesPtr;
 	typedef typename Delegates::iterator Iterator;
 
 public:
-	PriorityStrategy()
+	PriorityStrategy():
+		_pDelegates(new Delegates)
 	{
 	}
 
 	PriorityStrategy(const PriorityStrategy& s):
-		_delegates(s._delegates)
+		_pDelegates(s._pDelegates)
 	{
 	}
 
@@ -57,36 +81,36 @@ public:
 
 	void notify(const void* sender, TArgs& arguments)
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
 		{
-			(*it)->notify(sender, arguments);
+			it->pDelegate->notify(sender, arguments);
 		}
 	}
 
 	DelegateHandle add(const TDelegate& delegate)
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
-		{
-			if ((*it)->priority() > delegate.priority())
-			{
-				DelegatePtr pDelegate(static_cast<TDelegate*>(delegate.clone()));
-				_delegates.insert(it, pDelegate);
-				return pDelegate.get();
-			}
-		}
-		DelegatePtr pDelegate(static_cast<TDelegate*>(delegate.clone()));
-		_delegates.push_back(pDelegate);
-		return pDelegate.get();
+		Entry entry;
+		entry.priority = delegate.priority();
+		entry.pDelegate = static_cast<TDelegate*>(delegate.clone());
+		Iterator pos = std::upper_bound(_pDelegates->begin(), _pDelegates->end(), entry, LessPriority());
+		DelegatesPtr pDelegates(new Delegates);
+		pDelegates->reserve(_pDelegates->size() + 1);
+		pDelegates->assign(_pDelegates->begin(), pos);
+		pDelegates->push_back(entry);
+		pDelegates->insert(pDelegates->end(), pos, _pDelegates->end());
+		_pDelegates = pDelegates;
+		return entry.pDelegate.get();
 	}
 
 	void remove(const TDelegate& delegate)
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
 		{
-			if (delegate.equals(**it))
+			if (delegate.equals(*it->pDelegate))
 			{
-				(*it)->disable();
-				_delegates.erase(it);
+				erase(it);
 				return;
 			}
 		}
@@ -94,12 +118,12 @@ public:
 
 	void remove(DelegateHandle delegateHandle)
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
 		{
-			if (*it == delegateHandle)
+			if (it->pDelegate == delegateHandle)
 			{
-				(*it)->disable();
-				_delegates.erase(it);
+				erase(it);
 				return;
 			}
 		}
@@ -107,79 +131,135 @@ public:
 
 	PriorityStrategy& operator = (const PriorityStrategy& s)
 	{
-		if (this != &s)
-		{
-			_delegates = s._delegates;
-		}
+		_pDelegates = s._pDelegates;
 		return *this;
 	}
 
 	void clear()
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
 		{
-			(*it)->disable();
+			it->pDelegate->disable();
 		}
-		_delegates.clear();
+		_pDelegates = new Delegates;
 	}
 
 	bool empty() const
 	{
-		return _delegates.empty();
+		return _pDelegates->empty();
 	}
 
 protected:
-	Delegates _delegates;
+	struct LessPriority
+	{
+		bool operator () (const Entry& a, const Entry& b) const
+		{
+			return a.priority < b.priority;
+		}
+	};
+
+	void erase(Iterator pos)
+		/// Disables the delegate at pos and publishes a new
+		/// delegate list without it. Snapshots held by notifications
+		/// in progress are not modified, but will skip the disabled
+		/// delegate.
+	{
+		pos->pDelegate->disable();
+		DelegatesPtr pDelegates(new Delegates);
+		pDelegates->reserve(_pDelegates->size() - 1);
+		Iterator begin = _pDelegates->begin();
+		pDelegates->assign(begin, pos);
+		pDelegates->insert(pDelegates->end(), pos + 1, _pDelegates->end());
+		_pDelegates = pDelegates;
+	}
+
+	DelegatesPtr _pDelegates;
 };
 
 
 template <class TDelegate>
-class PriorityStrategy<void, TDelegate>
+class PriorityStrategy<void, TDelegate>: public NotificationStrategy<void, TDelegate>
 	/// NotificationStrategy for PriorityEvent.
 	///
-	/// Delegates are kept in a std::vector<>, ordered
-	/// by their priority.
+	/// Delegates are kept in a contiguous std::vector<> of
+	/// (priority, delegate) pairs, ordered by priority, and
+	/// in the order in which they have been registered for
+	/// equal priorities. The priorities are kept next to the
+	/// delegates, so add() finds the insertion position with a
+	/// binary search, without calling priority() on every
+	/// registered delegate.
+	///
+	/// Like with SnapshotStrategy, the vector is immutable and
+	/// reference-counted, and replaced as a whole by add(),
+	/// remove() and clear(), so that the copy of the strategy
+	/// that AbstractEvent makes for every notify() only copies
+	/// a single SharedPtr.
+	///
+	/// For a fixed set of priority levels, FixedPriorityStrategy
+	/// does not even need the priorities at notify() time.
 {
 public:
 	typedef TDelegate*                   DelegateHandle;
 	typedef SharedPtr<TDelegate>         DelegatePtr;
-	typedef std::vector<DelegatePtr>     Delegates;
+
+	struct Entry
+	{
+		int priority;
+		DelegatePtr pDelegate;
+	};
+
+	typedef std::vector<Entry>           Delegates;
+	typedef SharedPtr<Delegates>         DelegatesPtr;
 	typedef typename Delegates::iterator Iterator;
 
 public:
+	PriorityStrategy():
+		_pDelegates(new Delegates)
+	{
+	}
+
+	PriorityStrategy(const PriorityStrategy& s):
+		_pDelegates(s._pDelegates)
+	{
+	}
+
+	~PriorityStrategy()
+	{
+	}
 
 	void notify(const void* sender)
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
 		{
-			(*it)->notify(sender);
+			it->pDelegate->notify(sender);
 		}
 	}
 
 	DelegateHandle add(const TDelegate& delegate)
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
-		{
-			if ((*it)->priority() > delegate.priority())
-			{
-				DelegatePtr pDelegate(static_cast<TDelegate*>(delegate.clone()));
-				_delegates.insert(it, pDelegate);
-				return pDelegate.get();
-			}
-		}
-		DelegatePtr pDelegate(static_cast<TDelegate*>(delegate.clone()));
-		_delegates.push_back(pDelegate);
-		return pDelegate.get();
+		Entry entry;
+		entry.priority = delegate.priority();
+		entry.pDelegate = static_cast<TDelegate*>(delegate.clone());
+		Iterator pos = std::upper_bound(_pDelegates->begin(), _pDelegates->end(), entry, LessPriority());
+		DelegatesPtr pDelegates(new Delegates);
+		pDelegates->reserve(_pDelegates->size() + 1);
+		pDelegates->assign(_pDelegates->begin(), pos);
+		pDelegates->push_back(entry);
+		pDelegates->insert(pDelegates->end(), pos, _pDelegates->end());
+		_pDelegates = pDelegates;
+		return entry.pDelegate.get();
 	}
 
 	void remove(const TDelegate& delegate)
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
 		{
-			if (delegate.equals(**it))
+			if (delegate.equals(*it->pDelegate))
 			{
-				(*it)->disable();
-				_delegates.erase(it);
+				erase(it);
 				return;
 			}
 		}
@@ -187,12 +267,12 @@ public:
 
 	void remove(DelegateHandle delegateHandle)
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
 		{
-			if (*it == delegateHandle)
+			if (it->pDelegate == delegateHandle)
 			{
-				(*it)->disable();
-				_delegates.erase(it);
+				erase(it);
 				return;
 			}
 		}
@@ -200,29 +280,50 @@ public:
 
 	PriorityStrategy& operator = (const PriorityStrategy& s)
 	{
-		if (this != &s)
-		{
-			_delegates = s._delegates;
-		}
+		_pDelegates = s._pDelegates;
 		return *this;
 	}
 
 	void clear()
 	{
-		for (Iterator it = _delegates.begin(); it != _delegates.end(); ++it)
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
 		{
-			(*it)->disable();
+			it->pDelegate->disable();
 		}
-		_delegates.clear();
+		_pDelegates = new Delegates;
 	}
 
 	bool empty() const
 	{
-		return _delegates.empty();
+		return _pDelegates->empty();
 	}
 
 protected:
-	Delegates _delegates;
+	struct LessPriority
+	{
+		bool operator () (const Entry& a, const Entry& b) const
+		{
+			return a.priority < b.priority;
+		}
+	};
+
+	void erase(Iterator pos)
+		/// Disables the delegate at pos and publishes a new
+		/// delegate list without it. Snapshots held by notifications
+		/// in progress are not modified, but will skip the disabled
+		/// delegate.
+	{
+		pos->pDelegate->disable();
+		DelegatesPtr pDelegates(new Delegates);
+		pDelegates->reserve(_pDelegates->size() - 1);
+		Iterator begin = _pDelegates->begin();
+		pDelegates->assign(begin, pos);
+		pDelegates->insert(pDelegates->end(), pos + 1, _pDelegates->end());
+		_pDelegates = pDelegates;
+	}
+
+	DelegatesPtr _pDelegates;
 };
 
 
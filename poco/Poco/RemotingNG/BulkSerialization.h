@@ -0,0 +1,301 @@
+//
+// BulkSerialization.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Serialization
+// Module:  BulkSerialization
+//
+// Definition of the BulkSerializer and BulkDeserializer interfaces.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_BulkSerialization_INCLUDED
+#define RemotingNG_BulkSerialization_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Serializer.h"
+#include "Poco/RemotingNG/Deserializer.h"
+#include <vector>
+#include <string>
+#include <cstddef>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+enum BulkType
+	/// The element types of sequences that can be
+	/// serialized in bulk.
+{
+	BULK_NONE,
+	BULK_INT8,
+	BULK_UINT8,
+	BULK_INT16,
+	BULK_UINT16,
+	BULK_INT32,
+	BULK_UINT32,
+	BULK_INT64,
+	BULK_UINT64,
+	BULK_FLOAT,
+	BULK_DOUBLE
+};
+
+
+template <typename T>
+struct BulkTraits
+	/// Tells whether sequences of T can be serialized in bulk
+	/// as a fixed-size arithmetic type.
+{
+	static const BulkType TYPE = BULK_NONE;
+};
+
+
+#define REMOTING_BULK_TRAITS(T, BT) \
+	template <> \
+	struct BulkTraits<T> \
+	{ \
+		static const BulkType TYPE = BT; \
+	};
+
+
+REMOTING_BULK_TRAITS(Poco::Int8, BULK_INT8)
+REMOTING_BULK_TRAITS(Poco::UInt8, BULK_UINT8)
+REMOTING_BULK_TRAITS(Poco::Int16, BULK_INT16)
+REMOTING_BULK_TRAITS(Poco::UInt16, BULK_UINT16)
+REMOTING_BULK_TRAITS(Poco::Int32, BULK_INT32)
+REMOTING_BULK_TRAITS(Poco::UInt32, BULK_UINT32)
+REMOTING_BULK_TRAITS(Poco::Int64, BULK_INT64)
+REMOTING_BULK_TRAITS(Poco::UInt64, BULK_UINT64)
+REMOTING_BULK_TRAITS(float, BULK_FLOAT)
+REMOTING_BULK_TRAITS(double, BULK_DOUBLE)
+
+
+#undef REMOTING_BULK_TRAITS
+
+
+template <typename T>
+struct BlobTraits
+	/// Tells whether sequences of T can be serialized in bulk
+	/// as a blob of sizeof(T) bytes per element.
+	///
+	/// This is only enabled for types declared with
+	/// REMOTING_BLOB_SERIALIZABLE().
+{
+	static const bool ENABLED = false;
+};
+
+
+//
+// REMOTING_BLOB_SERIALIZABLE(T) declares that sequences of T may be
+// serialized as blobs, with Serializers supporting it (see BulkSerializer).
+// It must be used in the global namespace, after the definition of T.
+//
+// T must be trivially copyable, which is checked at compile time with
+// C++11. Blobs are copied as they are in memory, including padding and
+// in host byte order, so T must have the same layout on both ends of a
+// connection.
+//
+#if __cplusplus >= 201103L
+#define REMOTING_BLOB_CHECK(T) \
+	static_assert(std::is_trivially_copyable<T>::value, "blob serializable types must be trivially copyable");
+#else
+#define REMOTING_BLOB_CHECK(T)
+#endif
+
+
+#define REMOTING_BLOB_SERIALIZABLE(T) \
+	namespace Poco { \
+	namespace RemotingNG { \
+	template <> \
+	struct BlobTraits<T> \
+	{ \
+		REMOTING_BLOB_CHECK(T) \
+		static const bool ENABLED = true; \
+	}; \
+	} }
+
+
+inline std::size_t bulkElementSize(BulkType type)
+	/// Returns the size of an element of the given type.
+{
+	switch (type)
+	{
+	case BULK_INT8:
+	case BULK_UINT8:
+		return 1;
+	case BULK_INT16:
+	case BULK_UINT16:
+		return 2;
+	case BULK_INT32:
+	case BULK_UINT32:
+	case BULK_FLOAT:
+		return 4;
+	case BULK_INT64:
+	case BULK_UINT64:
+	case BULK_DOUBLE:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+
+class BulkSerializer
+	/// A mixin for Serializers that can write the elements of
+	/// a sequence of a fixed-size arithmetic type at once.
+	///
+	/// The TypeSerializers for std::vector, std::array and Poco::Buffer
+	/// use serializeBulk() or serializeBlob(), between serializeSequenceBegin()
+	/// and serializeSequenceEnd(), instead of serializing every element,
+	/// if the Serializer implements BulkSerializer and the element type
+	/// is supported by BulkTraits or BlobTraits (see BulkSequence).
+{
+public:
+	virtual void serializeBulk(const std::string& name, const void* pData, std::size_t count, BulkType type) = 0;
+		/// Serializes count elements of the given type.
+
+	virtual void serializeBlob(const std::string& name, const void* pData, std::size_t count, std::size_t elementSize) = 0;
+		/// Serializes count elements of elementSize bytes each,
+		/// as they are in memory.
+
+protected:
+	virtual ~BulkSerializer()
+	{
+	}
+};
+
+
+class BulkDeserializer
+	/// A mixin for Deserializers that can read the elements of
+	/// a sequence of a fixed-size arithmetic type at once.
+	///
+	/// The TypeDeserializers for std::vector, std::array and Poco::Buffer
+	/// use deserializeBulk() or deserializeBlob(), between
+	/// deserializeSequenceBegin() and deserializeSequenceEnd(), if the
+	/// Deserializer implements BulkDeserializer and the element type is
+	/// supported by BulkTraits or BlobTraits (see BulkSequence). The
+	/// length hint returned by deserializeSequenceBegin() must then be
+	/// the exact number of elements, and is passed to checkBulkSize()
+	/// before the storage for the elements is allocated.
+{
+public:
+	virtual void checkBulkSize(const std::string& name, std::size_t count, std::size_t elementSize) = 0;
+		/// Throws a DeserializerException if the message cannot
+		/// contain count elements of elementSize bytes each.
+
+	virtual void deserializeBulk(const std::string& name, void* pData, std::size_t count, BulkType type) = 0;
+		/// Deserializes count elements of the given type.
+
+	virtual void deserializeBlob(const std::string& name, void* pData, std::size_t count, std::size_t elementSize) = 0;
+		/// Deserializes count elements of elementSize bytes each.
+
+protected:
+	virtual ~BulkDeserializer()
+	{
+	}
+};
+
+
+template <typename T>
+class BulkSequence
+	/// Serializes and deserializes the elements of contiguous
+	/// sequences in bulk, if both the element type and the
+	/// Serializer or Deserializer support it.
+{
+public:
+	static bool isBulk()
+		/// Returns true if T can be serialized in bulk.
+	{
+		return BulkTraits<T>::TYPE != BULK_NONE || BlobTraits<T>::ENABLED;
+	}
+
+	static bool serialize(const std::string& name, const T* pData, std::size_t count, Serializer& ser)
+		/// Serializes the count elements at pData in bulk and returns
+		/// true, or returns false if bulk serialization is not supported.
+	{
+		if (!isBulk()) return false;
+		BulkSerializer* pBulkSer = dynamic_cast<BulkSerializer*>(&ser);
+		if (!pBulkSer) return false;
+		if (count > 0)
+		{
+			if (BulkTraits<T>::TYPE != BULK_NONE)
+				pBulkSer->serializeBulk(name, pData, count, BulkTraits<T>::TYPE);
+			else
+				pBulkSer->serializeBlob(name, pData, count, sizeof(T));
+		}
+		return true;
+	}
+
+	static BulkDeserializer* deserializer(Deserializer& deser)
+		/// Returns the BulkDeserializer for deser, or null
+		/// if bulk deserialization is not supported.
+	{
+		return isBulk() ? dynamic_cast<BulkDeserializer*>(&deser) : 0;
+	}
+
+	static void checkSize(const std::string& name, std::size_t count, BulkDeserializer& deser)
+		/// Throws a DeserializerException if the message cannot contain
+		/// count elements, so that a length read from the message does
+		/// not allocate more storage than the message could fill.
+	{
+		if (count > 0) deser.checkBulkSize(name, count, sizeof(T));
+	}
+
+	static void deserialize(const std::string& name, T* pData, std::size_t count, BulkDeserializer& deser)
+		/// Deserializes count elements into pData.
+	{
+		if (count == 0) return;
+		if (BulkTraits<T>::TYPE != BULK_NONE)
+			deser.deserializeBulk(name, pData, count, BulkTraits<T>::TYPE);
+		else
+			deser.deserializeBlob(name, pData, count, sizeof(T));
+	}
+};
+
+
+template <typename T>
+inline T* bulkData(std::vector<T>& value)
+	/// Returns a pointer to the elements of value.
+{
+	return value.empty() ? 0 : &value[0];
+}
+
+
+template <typename T>
+inline const T* bulkData(const std::vector<T>& value)
+	/// Returns a pointer to the elements of value.
+{
+	return value.empty() ? 0 : &value[0];
+}
+
+
+inline bool* bulkData(std::vector<bool>&)
+	/// std::vector<bool> is never serialized in bulk.
+{
+	return 0;
+}
+
+
+inline const bool* bulkData(const std::vector<bool>&)
+	/// std::vector<bool> is never serialized in bulk.
+{
+	return 0;
+}
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_BulkSerialization_INCLUDED
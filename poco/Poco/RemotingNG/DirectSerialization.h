@@ -0,0 +1,233 @@
+//
+// DirectSerialization.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Serialization
+// Module:  DirectSerialization
+//
+// Definition of the DirectTypeSerializer and DirectTypeDeserializer class templates.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_DirectSerialization_INCLUDED
+#define RemotingNG_DirectSerialization_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/TypeSerializer.h"
+#include "Poco/RemotingNG/TypeDeserializer.h"
+#include "Poco/RemotingNG/BulkSerialization.h"
+#include "Poco/Bugcheck.h"
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+inline const std::string& directName()
+	/// Returns the empty element name passed to the serializer
+	/// by stubs generated in direct mode.
+	///
+	/// Binary serializers do not write element names, so direct
+	/// mode stubs do not need a name string for every parameter
+	/// and member.
+{
+	static const std::string name;
+	return name;
+}
+
+
+template <class S>
+inline S& directSerializer(Serializer& ser)
+	/// Returns ser as the concrete Serializer class S used
+	/// by stubs generated in direct mode.
+{
+	poco_assert_dbg (dynamic_cast<S*>(&ser) != 0);
+
+	return static_cast<S&>(ser);
+}
+
+
+template <class D>
+inline D& directDeserializer(Deserializer& deser)
+	/// Returns deser as the concrete Deserializer class D used
+	/// by stubs generated in direct mode.
+{
+	poco_assert_dbg (dynamic_cast<D*>(&deser) != 0);
+
+	return static_cast<D&>(deser);
+}
+
+
+template <class S, typename T>
+class DirectTypeSerializer
+	/// DirectTypeSerializer serializes a value with a known
+	/// concrete Serializer class S, e.g. BinarySerializer or
+	/// FlatBinarySerializer.
+	///
+	/// Proxies and Skeletons generated in direct mode use
+	/// DirectTypeSerializer instead of TypeSerializer. For the scalar
+	/// types, strings and vectors the calls to S are qualified and
+	/// therefore not virtual, so that the compiler can inline them
+	/// if S is defined in a header, as FlatBinarySerializer is.
+	/// Other types are forwarded to TypeSerializer, so that
+	/// existing TypeSerializer specializations for user-defined
+	/// types are still used.
+	///
+	/// The serialized data is the same as with TypeSerializer.
+{
+public:
+	static void serialize(S& ser, const T& value)
+	{
+		TypeSerializer<T>::serialize(directName(), value, ser);
+	}
+
+private:
+	DirectTypeSerializer();
+	~DirectTypeSerializer();
+
+	DirectTypeSerializer(const DirectTypeSerializer&);
+	DirectTypeSerializer& operator = (const DirectTypeSerializer&);
+};
+
+
+template <class D, typename T>
+class DirectTypeDeserializer
+	/// DirectTypeDeserializer deserializes a value with a known
+	/// concrete Deserializer class D, e.g. BinaryDeserializer or
+	/// FlatBinaryDeserializer.
+	///
+	/// See DirectTypeSerializer.
+{
+public:
+	static bool deserialize(D& deser, bool isMandatory, T& value)
+	{
+		return TypeDeserializer<T>::deserialize(directName(), isMandatory, deser, value);
+	}
+
+private:
+	DirectTypeDeserializer();
+	~DirectTypeDeserializer();
+
+	DirectTypeDeserializer(const DirectTypeDeserializer&);
+	DirectTypeDeserializer& operator = (const DirectTypeDeserializer&);
+};
+
+
+#define REMOTING_DIRECT_SERIALIZABLE(T) \
+	template <class S> \
+	class DirectTypeSerializer<S, T> \
+	{ \
+	public: \
+		static void serialize(S& ser, const T& value) \
+		{ \
+			ser.S::serialize(directName(), value); \
+		} \
+	}; \
+	template <class D> \
+	class DirectTypeDeserializer<D, T> \
+	{ \
+	public: \
+		static bool deserialize(D& deser, bool isMandatory, T& value) \
+		{ \
+			return deser.D::deserialize(directName(), isMandatory, value); \
+		} \
+	};
+
+
+REMOTING_DIRECT_SERIALIZABLE(Poco::Int8)
+REMOTING_DIRECT_SERIALIZABLE(Poco::UInt8)
+REMOTING_DIRECT_SERIALIZABLE(Poco::Int16)
+REMOTING_DIRECT_SERIALIZABLE(Poco::UInt16)
+REMOTING_DIRECT_SERIALIZABLE(Poco::Int32)
+REMOTING_DIRECT_SERIALIZABLE(Poco::UInt32)
+REMOTING_DIRECT_SERIALIZABLE(long)
+REMOTING_DIRECT_SERIALIZABLE(unsigned long)
+#ifndef POCO_LONG_IS_64_BIT
+REMOTING_DIRECT_SERIALIZABLE(Poco::Int64)
+REMOTING_DIRECT_SERIALIZABLE(Poco::UInt64)
+#endif
+REMOTING_DIRECT_SERIALIZABLE(float)
+REMOTING_DIRECT_SERIALIZABLE(double)
+REMOTING_DIRECT_SERIALIZABLE(bool)
+REMOTING_DIRECT_SERIALIZABLE(char)
+REMOTING_DIRECT_SERIALIZABLE(std::string)
+REMOTING_DIRECT_SERIALIZABLE(std::vector<char>)
+
+
+template <class S, typename T>
+class DirectTypeSerializer<S, std::vector<T> >
+{
+public:
+	static void serialize(S& ser, const std::vector<T>& value)
+	{
+		ser.S::serializeSequenceBegin(directName(), static_cast<Poco::UInt32>(value.size()));
+		if (!BulkSequence<T>::serialize(directName(), bulkData(value), value.size(), ser))
+		{
+			typename std::vector<T>::const_iterator it = value.begin();
+			typename std::vector<T>::const_iterator itEnd = value.end();
+			for (; it != itEnd; ++it)
+			{
+				DirectTypeSerializer<S, T>::serialize(ser, *it);
+			}
+		}
+		ser.S::serializeSequenceEnd(directName());
+	}
+};
+
+
+template <class D, typename T>
+class DirectTypeDeserializer<D, std::vector<T> >
+{
+public:
+	static bool deserialize(D& deser, bool isMandatory, std::vector<T>& value)
+	{
+		Poco::UInt32 sizeHint;
+		if (!deser.D::deserializeSequenceBegin(directName(), isMandatory, sizeHint)) return false;
+
+		value.clear();
+		BulkDeserializer* pBulkDeser = BulkSequence<T>::deserializer(deser);
+		if (pBulkDeser)
+		{
+			BulkSequence<T>::checkSize(directName(), sizeHint, *pBulkDeser);
+			value.resize(sizeHint);
+			BulkSequence<T>::deserialize(directName(), bulkData(value), sizeHint, *pBulkDeser);
+		}
+		else
+		{
+			if (sizeHint > 0) value.reserve(sizeHint);
+			bool found = true;
+			do
+			{
+				T elem;
+				found = DirectTypeDeserializer<D, T>::deserialize(deser, false, elem);
+				if (found)
+				{
+#if __cplusplus >= 201103L
+					value.push_back(std::move(elem));
+#else
+					value.push_back(elem);
+#endif
+				}
+			}
+			while (found);
+		}
+		deser.D::deserializeSequenceEnd(directName());
+		return true;
+	}
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_DirectSerialization_INCLUDED
@@ -0,0 +1,230 @@
+//
+// EventFilterTable.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: ORB
+// Module:  EventFilterTable
+//
+// Definition of the EventIndex and EventFilterTable classes.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_EventFilterTable_INCLUDED
+#define RemotingNG_EventFilterTable_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/EventFilter.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Timespan.h"
+#include "Poco/Clock.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+template <typename T>
+struct EventSlot
+	/// The typed index of an event in an EventIndex.
+{
+	explicit EventSlot(std::size_t i):
+		index(i)
+	{
+	}
+
+	std::size_t index;
+};
+
+
+class EventIndex
+	/// EventIndex assigns dense indexes to the events of an
+	/// EventDispatcher, when the dispatcher is constructed.
+	///
+	/// The EventSlot returned for an event is then used to look
+	/// up the filters of a subscriber in its EventFilterTable, with
+	/// a vector index instead of a string key, and without the
+	/// Poco::AnyCast of EventDispatcher::accept().
+{
+public:
+	EventIndex()
+		/// Creates an empty EventIndex.
+	{
+	}
+
+	~EventIndex()
+		/// Destroys the EventIndex.
+	{
+	}
+
+	template <typename T>
+	EventSlot<T> add(const std::string& event)
+		/// Adds the event with argument type T and returns its slot.
+	{
+		NameMap::const_iterator it = _names.find(event);
+		if (it != _names.end())
+		{
+			if (_types[it->second] != typeKey<T>()) throw Poco::InvalidArgumentException("Event already added with different type", event);
+			return EventSlot<T>(it->second);
+		}
+		std::size_t index = _types.size();
+		_names[event] = index;
+		_types.push_back(typeKey<T>());
+		return EventSlot<T>(index);
+	}
+
+	template <typename T>
+	EventSlot<T> slot(const std::string& event) const
+		/// Returns the slot of the given event.
+		///
+		/// Throws a Poco::NotFoundException if the event is unknown,
+		/// or a Poco::BadCastException if it has a different
+		/// argument type.
+	{
+		NameMap::const_iterator it = _names.find(event);
+		if (it == _names.end()) throw Poco::NotFoundException("Unknown event", event);
+		if (_types[it->second] != typeKey<T>()) throw Poco::BadCastException("Wrong event argument type", event);
+		return EventSlot<T>(it->second);
+	}
+
+	std::size_t size() const
+		/// Returns the number of events.
+	{
+		return _types.size();
+	}
+
+	template <typename T>
+	static const void* typeKey()
+		/// Returns a key unique for type T, without using RTTI.
+	{
+		static const char key = 0;
+		return &key;
+	}
+
+private:
+	typedef std::map<std::string, std::size_t> NameMap;
+
+	EventIndex(const EventIndex&);
+	EventIndex& operator = (const EventIndex&);
+
+	NameMap _names;
+	std::vector<const void*> _types;
+};
+
+
+class EventFilterTable
+	/// The filters of a subscriber, by event slot.
+	///
+	/// Besides an EventFilter, every event can have a minimum interval,
+	/// which is checked before the filter, so that high-rate events are
+	/// rate limited without a virtual call. As with EventDispatcher's
+	/// filters, the table is not synchronized; it is guarded by the
+	/// dispatcher's mutex.
+	///
+	/// Usage example, in an EventDispatcher subclass:
+	///
+	///     ServiceEventDispatcher():
+	///         _onLteMetrics(_events.add<LteMetrics>("onLteMetrics"))
+	///     ...
+	///     if (filters.accept(_onLteMetrics, metrics)) event__onLteMetricsImpl(subscriberURI, metrics);
+{
+public:
+	EventFilterTable()
+		/// Creates an empty EventFilterTable.
+	{
+	}
+
+	~EventFilterTable()
+		/// Destroys the EventFilterTable.
+	{
+	}
+
+	template <typename T>
+	void setFilter(EventSlot<T> slot, typename EventFilter<T>::Ptr pFilter)
+		/// Sets the filter for the event. If pFilter is null,
+		/// removes the filter.
+	{
+		entry(slot.index).pFilter = pFilter ? Poco::AutoPtr<Poco::RefCountedObject>(pFilter.get(), true) : Poco::AutoPtr<Poco::RefCountedObject>();
+	}
+
+	template <typename T>
+	void setFilter(const EventIndex& index, const std::string& event, typename EventFilter<T>::Ptr pFilter)
+		/// Sets the filter for the event with the given name.
+		///
+		/// Throws a Poco::BadCastException if the filter's type
+		/// does not match the event's argument type.
+	{
+		setFilter(index.slot<T>(event), pFilter);
+	}
+
+	template <typename T>
+	void setMinimumInterval(EventSlot<T> slot, Poco::Timespan interval)
+		/// Sets the minimum interval between two accepted events.
+		/// A zero interval removes the limit.
+	{
+		entry(slot.index).minInterval = interval.totalMicroseconds();
+	}
+
+	void clear()
+		/// Removes all filters.
+	{
+		_entries.clear();
+	}
+
+	template <typename T>
+	bool accept(EventSlot<T> slot, const T& value)
+		/// Returns true if the event should be delivered.
+	{
+		if (slot.index >= _entries.size()) return true;
+		Entry& e = _entries[slot.index];
+		if (e.minInterval > 0 && e.accepted && !e.last.isElapsed(e.minInterval)) return false;
+		if (e.pFilter && !static_cast<EventFilter<T>*>(e.pFilter.get())->accept(value)) return false;
+		if (e.minInterval > 0)
+		{
+			e.last.update();
+			e.accepted = true;
+		}
+		return true;
+	}
+
+private:
+	struct Entry
+	{
+		Entry():
+			minInterval(0),
+			accepted(false)
+		{
+		}
+
+		Poco::AutoPtr<Poco::RefCountedObject> pFilter;
+		Poco::Clock::ClockDiff minInterval;
+		Poco::Clock last;
+		bool accepted;
+	};
+
+	Entry& entry(std::size_t index)
+	{
+		if (index >= _entries.size()) _entries.resize(index + 1);
+		return _entries[index];
+	}
+
+	std::vector<Entry> _entries;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_EventFilterTable_INCLUDED
@@ -0,0 +1,96 @@
+//
+// LatencyHistogramSerializer.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Serialization
+// Module:  LatencyHistogramSerializer
+//
+// Definition of the TypeSerializer and TypeDeserializer specializations
+// for Poco::LatencyHistogram.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_LatencyHistogramSerializer_INCLUDED
+#define RemotingNG_LatencyHistogramSerializer_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/TypeSerializer.h"
+#include "Poco/RemotingNG/TypeDeserializer.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/LatencyHistogram.h"
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+template <>
+class TypeSerializer<Poco::LatencyHistogram>
+	/// Serializes a LatencyHistogram as a struct with the members
+	/// total, min, max, indexes and counts, where indexes and counts
+	/// hold the non-empty buckets.
+{
+public:
+	static void serialize(const std::string& name, const Poco::LatencyHistogram& value, Serializer& ser)
+	{
+		std::vector<Poco::UInt32> indexes;
+		std::vector<Poco::UInt64> counts;
+		value.buckets(indexes, counts);
+		ser.serializeStructBegin(name);
+		TypeSerializer<Poco::UInt64>::serialize("total", value.total(), ser);
+		TypeSerializer<Poco::UInt64>::serialize("min", value.min(), ser);
+		TypeSerializer<Poco::UInt64>::serialize("max", value.max(), ser);
+		TypeSerializer<std::vector<Poco::UInt32> >::serialize("indexes", indexes, ser);
+		TypeSerializer<std::vector<Poco::UInt64> >::serialize("counts", counts, ser);
+		ser.serializeStructEnd(name);
+	}
+};
+
+
+template <>
+class TypeDeserializer<Poco::LatencyHistogram>
+{
+public:
+	static bool deserialize(const std::string& name, bool isMandatory, Deserializer& deser, Poco::LatencyHistogram& value)
+	{
+		if (deser.deserializeStructBegin(name, isMandatory))
+		{
+			Poco::UInt64 total = 0;
+			Poco::UInt64 min = 0;
+			Poco::UInt64 max = 0;
+			std::vector<Poco::UInt32> indexes;
+			std::vector<Poco::UInt64> counts;
+			TypeDeserializer<Poco::UInt64>::deserialize("total", true, deser, total);
+			TypeDeserializer<Poco::UInt64>::deserialize("min", true, deser, min);
+			TypeDeserializer<Poco::UInt64>::deserialize("max", true, deser, max);
+			TypeDeserializer<std::vector<Poco::UInt32> >::deserialize("indexes", true, deser, indexes);
+			TypeDeserializer<std::vector<Poco::UInt64> >::deserialize("counts", true, deser, counts);
+			deser.deserializeStructEnd(name);
+			try
+			{
+				value.assign(indexes, counts, total, min, max);
+			}
+			catch (Poco::InvalidArgumentException& exc)
+			{
+				throw DeserializerException(exc.message());
+			}
+			return true;
+		}
+		else return false;
+	}
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_LatencyHistogramSerializer_INCLUDED
@@ -0,0 +1,193 @@
+//
+// LazyTransport.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Transport
+// Module:  LazyTransport
+//
+// Definition of the LazyTransport and LazyTransportFactory classes.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_LazyTransport_INCLUDED
+#define RemotingNG_LazyTransport_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Transport.h"
+#include "Poco/RemotingNG/TransportFactory.h"
+#include "Poco/RemotingNG/TransportFactoryManager.h"
+#include "Poco/Mutex.h"
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class LazyTransport: public Transport
+	/// A Transport that defers connecting the Transport it wraps
+	/// until the first message or request is sent.
+	///
+	/// Proxies are connected when they are created, e.g. by the
+	/// generated client helper, so that a bundle starting many proxies
+	/// waits for the connection handshakes with all their servers. With
+	/// a LazyTransport, connect() only stores the endpoint, and the
+	/// handshake takes place with the first method call.
+	///
+	/// Attributes set on the LazyTransport (e.g. credentials) are
+	/// copied to the wrapped Transport before it is connected.
+	///
+	/// Code that casts the Proxy's Transport to a specific Transport
+	/// class must use wrapped() instead.
+{
+public:
+	typedef Poco::AutoPtr<LazyTransport> Ptr;
+
+	explicit LazyTransport(Transport::Ptr pTransport):
+		_pTransport(pTransport),
+		_connect(false)
+		/// Creates the LazyTransport for the given Transport.
+	{
+	}
+
+	~LazyTransport()
+		/// Destroys the LazyTransport.
+	{
+	}
+
+	Transport& wrapped()
+		/// Returns the wrapped Transport.
+	{
+		return *_pTransport;
+	}
+
+	// Transport
+	const std::string& endPoint() const
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _connect ? _endPoint : _pTransport->endPoint();
+	}
+
+	void connect(const std::string& endPoint)
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_endPoint = endPoint;
+		_connect = true;
+	}
+
+	void disconnect()
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_connect = false;
+		if (_pTransport->connected()) _pTransport->disconnect();
+	}
+
+	bool connected() const
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _connect || _pTransport->connected();
+	}
+
+	Serializer& beginMessage(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType messageType)
+	{
+		return ensureConnected().beginMessage(oid, tid, messageName, messageType);
+	}
+
+	void sendMessage(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType messageType)
+	{
+		_pTransport->sendMessage(oid, tid, messageName, messageType);
+	}
+
+	Serializer& beginRequest(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType messageType)
+	{
+		return ensureConnected().beginRequest(oid, tid, messageName, messageType);
+	}
+
+	Deserializer& sendRequest(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType messageType)
+	{
+		return _pTransport->sendRequest(oid, tid, messageName, messageType);
+	}
+
+	void endRequest()
+	{
+		_pTransport->endRequest();
+	}
+
+protected:
+	Transport& ensureConnected()
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (_connect)
+		{
+			static_cast<AttributedObject&>(*_pTransport) = *this;
+			_pTransport->connect(_endPoint);
+			_connect = false;
+		}
+		return *_pTransport;
+	}
+
+private:
+	LazyTransport();
+	LazyTransport(const LazyTransport&);
+	LazyTransport& operator = (const LazyTransport&);
+
+	Transport::Ptr _pTransport;
+	std::string _endPoint;
+	bool _connect;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+class LazyTransportFactory: public TransportFactory
+	/// A TransportFactory creating LazyTransport objects that wrap
+	/// the Transports created by another TransportFactory.
+	///
+	/// Usage example:
+	///
+	///     LazyTransportFactory::registerFactory(Poco::RemotingNG::TCP::Transport::PROTOCOL, new Poco::RemotingNG::TCP::TransportFactory);
+{
+public:
+	explicit LazyTransportFactory(TransportFactory::Ptr pFactory):
+		_pFactory(pFactory)
+		/// Creates the LazyTransportFactory for the given TransportFactory.
+	{
+	}
+
+	~LazyTransportFactory()
+		/// Destroys the LazyTransportFactory.
+	{
+	}
+
+	// TransportFactory
+	Transport* createTransport()
+	{
+		return new LazyTransport(Transport::Ptr(_pFactory->createTransport()));
+	}
+
+	// Helpers
+	static void registerFactory(const std::string& protocol, TransportFactory::Ptr pFactory)
+		/// Helper function to register a LazyTransportFactory wrapping
+		/// the given factory for the given protocol with the
+		/// TransportFactoryManager, replacing the registered factory.
+	{
+		TransportFactoryManager& manager = TransportFactoryManager::instance();
+		if (manager.hasFactory(protocol)) manager.unregisterFactory(protocol);
+		manager.registerFactory(protocol, new LazyTransportFactory(pFactory));
+	}
+
+private:
+	TransportFactory::Ptr _pFactory;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_LazyTransport_INCLUDED
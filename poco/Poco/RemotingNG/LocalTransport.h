@@ -0,0 +1,335 @@
+//
+// LocalTransport.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Transport
+// Module:  LocalTransport
+//
+// Definition of the LocalListener, LocalTransport and LocalTransportFactory classes.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_LocalTransport_INCLUDED
+#define RemotingNG_LocalTransport_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Listener.h"
+#include "Poco/RemotingNG/Transport.h"
+#include "Poco/RemotingNG/ServerTransport.h"
+#include "Poco/RemotingNG/TransportFactory.h"
+#include "Poco/RemotingNG/TransportFactoryManager.h"
+#include "Poco/RemotingNG/ORB.h"
+#include "Poco/RemotingNG/URIUtility.h"
+#include "Poco/RemotingNG/FlatBinarySerializer.h"
+#include "Poco/RemotingNG/FlatBinaryDeserializer.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/URIView.h"
+#include <algorithm>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class LocalListener: public Listener
+	/// A Listener for service objects that are only used
+	/// within the process.
+	///
+	/// Objects registered with a LocalListener get URIs of the form
+	/// local://<endpoint>/local/<typeId>/<objectId>. As the ORB finds
+	/// these URIs among its registered objects, ORB::findObject() and the
+	/// generated client helpers return the RemoteObject itself for them,
+	/// so that calls go directly to the service object, without any
+	/// serialization or socket I/O.
+	///
+	/// Proxies for local URIs, e.g. created before the object has been
+	/// registered, use the LocalTransport, which invokes the Skeleton
+	/// directly.
+	///
+	/// Usage example:
+	///
+	///     LocalTransportFactory::registerFactory();
+	///     std::string listener = ORB::instance().registerListener(new LocalListener);
+	///     std::string uri = ServiceServerHelper::registerObject(pService, "service", listener);
+	///     IService::Ptr pInterface = ServiceClientHelper::find(uri);
+{
+public:
+	typedef Poco::AutoPtr<LocalListener> Ptr;
+
+	explicit LocalListener(const std::string& endPoint = "local"):
+		Listener(endPoint),
+		_protocol(LocalListener::protocolName())
+		/// Creates the LocalListener with the given endpoint name,
+		/// which must be unique among the local listeners.
+	{
+	}
+
+	~LocalListener()
+		/// Destroys the LocalListener.
+	{
+	}
+
+	static const std::string& protocolName()
+		/// Returns the protocol name, "local".
+	{
+		static const std::string protocol("local");
+		return protocol;
+	}
+
+	// Listener
+	void start()
+	{
+	}
+
+	void stop()
+	{
+	}
+
+	const std::string& protocol() const
+	{
+		return _protocol;
+	}
+
+	std::string createURI(const Identifiable::TypeId& typeId, const Identifiable::ObjectId& objectId)
+	{
+		std::string uri(_protocol);
+		uri += "://";
+		uri += endPoint();
+		uri += URIUtility::createURIPath(objectId, typeId, _protocol);
+		return uri;
+	}
+
+	bool handlesURI(const std::string& uri)
+	{
+		Poco::URIView view(uri);
+		return view.scheme() == _protocol && view.authority() == endPoint() && view.path().startsWith("/");
+	}
+
+	void registerObject(RemoteObject::Ptr /*pRemoteObject*/, Skeleton::Ptr /*pSkeleton*/)
+	{
+	}
+
+	void unregisterObject(RemoteObject::Ptr /*pRemoteObject*/)
+	{
+	}
+
+private:
+	std::string _protocol;
+};
+
+
+class LocalServerTransport: public ServerTransport
+	/// The ServerTransport used by LocalTransport, reading
+	/// the request from and writing the reply to memory.
+{
+public:
+	LocalServerTransport(const char* pRequest, std::size_t size):
+		_pRequest(pRequest),
+		_size(size),
+		_replied(false)
+	{
+	}
+
+	~LocalServerTransport()
+	{
+	}
+
+	bool replied() const
+		/// Returns true if a reply has been written.
+	{
+		return _replied;
+	}
+
+	const FlatBinarySerializer& reply() const
+		/// Returns the serializer holding the reply.
+	{
+		return _serializer;
+	}
+
+	// ServerTransport
+	Deserializer& beginRequest()
+	{
+		_deserializer.setup(_pRequest, _size);
+		return _deserializer;
+	}
+
+	Serializer& sendReply(SerializerBase::MessageType /*messageType*/)
+	{
+		_serializer.reset();
+		_replied = true;
+		return _serializer;
+	}
+
+	void endRequest()
+	{
+	}
+
+private:
+	const char* _pRequest;
+	std::size_t _size;
+	bool _replied;
+	FlatBinaryDeserializer _deserializer;
+	FlatBinarySerializer _serializer;
+};
+
+
+class LocalTransport: public Transport
+	/// A Transport for objects registered with a LocalListener.
+	///
+	/// Requests are serialized into memory with FlatBinarySerializer
+	/// and handed to the object's Skeleton through the ORB on the
+	/// calling thread; the reply is read directly from the Skeleton's
+	/// serializer buffer.
+{
+public:
+	typedef Poco::AutoPtr<LocalTransport> Ptr;
+
+	LocalTransport()
+		/// Creates the LocalTransport.
+	{
+	}
+
+	~LocalTransport()
+		/// Destroys the LocalTransport.
+	{
+	}
+
+	// Transport
+	const std::string& endPoint() const
+	{
+		return _endPoint;
+	}
+
+	void connect(const std::string& endPoint)
+	{
+		std::string name(endPoint);
+		std::string::size_type pos = name.find("://");
+		if (pos != std::string::npos)
+		{
+			name.erase(0, pos + 3);
+			name.erase(std::min(name.find('/'), name.size()));
+		}
+		ORB::ListenerVec listeners = ORB::instance().listeners();
+		for (ORB::ListenerVec::iterator it = listeners.begin(); it != listeners.end(); ++it)
+		{
+			if ((*it)->protocol() == LocalListener::protocolName() && (*it)->endPoint() == name)
+			{
+				_pListener = *it;
+				_endPoint = endPoint;
+				return;
+			}
+		}
+		throw TransportException("No local listener for endpoint", endPoint);
+	}
+
+	void disconnect()
+	{
+		_pListener = 0;
+		_endPoint.clear();
+	}
+
+	bool connected() const
+	{
+		return !_pListener.isNull();
+	}
+
+	Serializer& beginMessage(const Identifiable::ObjectId& /*oid*/, const Identifiable::TypeId& /*tid*/, const std::string& /*messageName*/, SerializerBase::MessageType /*messageType*/)
+	{
+		_serializer.reset();
+		return _serializer;
+	}
+
+	void sendMessage(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& /*messageName*/, SerializerBase::MessageType /*messageType*/)
+	{
+		LocalServerTransport serverTransport(_serializer.data(), _serializer.size());
+		invoke(oid, tid, serverTransport);
+	}
+
+	Serializer& beginRequest(const Identifiable::ObjectId& /*oid*/, const Identifiable::TypeId& /*tid*/, const std::string& /*messageName*/, SerializerBase::MessageType /*messageType*/)
+	{
+		_serializer.reset();
+		return _serializer;
+	}
+
+	Deserializer& sendRequest(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType /*messageType*/)
+	{
+		_pServerTransport = new LocalServerTransport(_serializer.data(), _serializer.size());
+		invoke(oid, tid, *_pServerTransport);
+		if (!_pServerTransport->replied()) throw TransportException("No reply received", messageName);
+		_deserializer.setup(_pServerTransport->reply().data(), _pServerTransport->reply().size());
+		return _deserializer;
+	}
+
+	void endRequest()
+	{
+		_pServerTransport = 0;
+	}
+
+protected:
+	void invoke(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, LocalServerTransport& serverTransport)
+	{
+		if (!_pListener) throw TransportException("Not connected");
+		std::string uri = _pListener->createURI(tid, oid);
+		if (!ORB::instance().invoke(*_pListener, uri, serverTransport)) throw UnknownObjectException(uri);
+	}
+
+private:
+	LocalTransport(const LocalTransport&);
+	LocalTransport& operator = (const LocalTransport&);
+
+	std::string _endPoint;
+	Listener::Ptr _pListener;
+	FlatBinarySerializer _serializer;
+	FlatBinaryDeserializer _deserializer;
+	Poco::SharedPtr<LocalServerTransport> _pServerTransport;
+};
+
+
+class LocalTransportFactory: public TransportFactory
+	/// The TransportFactory for LocalTransport objects.
+{
+public:
+	LocalTransportFactory()
+		/// Creates the LocalTransportFactory.
+	{
+	}
+
+	~LocalTransportFactory()
+		/// Destroys the LocalTransportFactory.
+	{
+	}
+
+	// TransportFactory
+	Transport* createTransport()
+	{
+		return new LocalTransport;
+	}
+
+	// Helpers
+	static void registerFactory()
+		/// Helper function to register the factory with the TransportFactoryManager.
+	{
+		TransportFactoryManager::instance().registerFactory(LocalListener::protocolName(), new LocalTransportFactory);
+	}
+
+	static void unregisterFactory()
+		/// Helper function to unregister the factory with the manager.
+	{
+		TransportFactoryManager::instance().unregisterFactory(LocalListener::protocolName());
+	}
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_LocalTransport_INCLUDED
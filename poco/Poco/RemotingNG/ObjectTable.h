@@ -0,0 +1,244 @@
+//
+// ObjectTable.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: ORB
+// Module:  ObjectTable
+//
+// Definition of the ObjectTable class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_ObjectTable_INCLUDED
+#define RemotingNG_ObjectTable_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/ORB.h"
+#include "Poco/RemotingNG/Skeleton.h"
+#include "Poco/RemotingNG/OrdinalSkeleton.h"
+#include "Poco/RemotingNG/RemoteObject.h"
+#include "Poco/RemotingNG/Listener.h"
+#include "Poco/RemotingNG/ServerTransport.h"
+#include "Poco/Delegate.h"
+#include "Poco/ScalableRWLock.h"
+#include "Poco/URIView.h"
+#include <map>
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class ObjectTable
+	/// A read-optimized table of the service objects registered
+	/// with an ORB, for dispatching requests without taking the
+	/// ORB's mutex.
+	///
+	/// ORB::invoke() looks up the object and its Skeleton in maps
+	/// guarded by the single ORB mutex, so that all server threads
+	/// contend on it for every request. The ObjectTable keeps the
+	/// RemoteObject and Skeleton of every object registered with the
+	/// ORB after the ObjectTable has been created, following the ORB's
+	/// objectRegistered and objectUnregistered events, in a number of
+	/// shards, each guarded by its own read/write lock. Requests take
+	/// a read lock on one shard only, and registrations, which are rare,
+	/// a write lock.
+	///
+	/// Requests for objects not in the table, e.g. objects registered
+	/// before the ObjectTable was created, or addressed by a path
+	/// template alias, are passed on to ORB::invoke().
+	///
+	/// Objects with an OrdinalSkeleton are invoked with
+	/// OrdinalSkeleton::dispatch().
+	///
+	/// A Listener would typically use the ObjectTable like this:
+	///
+	///     static ObjectTable objectTable;
+	///     ...
+	///     objectTable.invoke(*this, uri, transport);
+{
+public:
+	ObjectTable(ORB& orb = ORB::instance()):
+		_orb(orb)
+		/// Creates the ObjectTable for the given ORB.
+	{
+		_orb.objectRegistered += Poco::delegate(this, &ObjectTable::onObjectRegistered);
+		_orb.objectUnregistered += Poco::delegate(this, &ObjectTable::onObjectUnregistered);
+	}
+
+	~ObjectTable()
+		/// Destroys the ObjectTable.
+	{
+		try
+		{
+			_orb.objectRegistered -= Poco::delegate(this, &ObjectTable::onObjectRegistered);
+			_orb.objectUnregistered -= Poco::delegate(this, &ObjectTable::onObjectUnregistered);
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	bool invoke(const Listener& listener, const std::string& uri, ServerTransport& transport)
+		/// Invokes a method on the object registered for the given
+		/// Listener and URI, like ORB::invoke().
+		///
+		/// Returns true if the object was found, false otherwise.
+	{
+		RemoteObject::Ptr pRemoteObject;
+		Skeleton::Ptr pSkeleton;
+		if (find(listener, uri, pRemoteObject, pSkeleton))
+		{
+			OrdinalSkeleton* pOrdinalSkeleton = dynamic_cast<OrdinalSkeleton*>(pSkeleton.get());
+			if (pOrdinalSkeleton)
+				pOrdinalSkeleton->dispatch(transport, pRemoteObject);
+			else
+				pSkeleton->invoke(transport, pRemoteObject);
+			return true;
+		}
+		else return _orb.invoke(listener, uri, transport);
+	}
+
+	bool find(const Listener& listener, const std::string& uri, RemoteObject::Ptr& pRemoteObject, Skeleton::Ptr& pSkeleton) const
+		/// Looks up the object registered for the given Listener and URI.
+		/// URI can be a complete URI or a URI path.
+		///
+		/// Returns true and the object and its Skeleton if found,
+		/// otherwise false.
+	{
+		std::string path = pathOf(uri);
+		const Shard& shard = shardFor(path);
+		Poco::ScalableRWLock::ScopedReadLock lock(shard.lock);
+		EntryMap::const_iterator it = shard.entries.find(path);
+		if (it != shard.entries.end())
+		{
+			for (EntryVec::const_iterator itEntry = it->second.begin(); itEntry != it->second.end(); ++itEntry)
+			{
+				if (itEntry->pListener.get() == &listener)
+				{
+					pRemoteObject = itEntry->pRemoteObject;
+					pSkeleton = itEntry->pSkeleton;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+protected:
+	void onObjectRegistered(const void* /*pSender*/, const ORB::ObjectRegistration& reg)
+	{
+		if (!reg.pRemoteObject || !reg.pListener) return;
+		Entry entry;
+		entry.pRemoteObject = reg.pRemoteObject;
+		entry.pListener = reg.pListener;
+		entry.pSkeleton = _orb.skeletonForClass(reg.pRemoteObject->remoting__typeId());
+		add(pathOf(reg.uri), entry);
+		if (!reg.alias.empty()) add(pathOf(reg.alias), entry);
+	}
+
+	void onObjectUnregistered(const void* /*pSender*/, const ORB::ObjectRegistration& reg)
+	{
+		remove(pathOf(reg.uri), reg);
+		if (!reg.alias.empty()) remove(pathOf(reg.alias), reg);
+	}
+
+private:
+	enum
+	{
+		SHARD_COUNT = 16
+	};
+
+	struct Entry
+	{
+		RemoteObject::Ptr pRemoteObject;
+		Skeleton::Ptr pSkeleton;
+		Listener::Ptr pListener;
+	};
+
+	typedef std::vector<Entry> EntryVec;
+	typedef std::map<std::string, EntryVec> EntryMap;
+
+	struct Shard
+	{
+		mutable Poco::ScalableRWLock lock;
+		EntryMap entries;
+	};
+
+	ObjectTable(const ObjectTable&);
+	ObjectTable& operator = (const ObjectTable&);
+
+	static std::string pathOf(const std::string& uri)
+		/// Returns the path of the given URI, or the
+		/// URI itself if it is a path.
+	{
+		Poco::URIView view(uri);
+		if (view.path().empty() && !view.isRelative()) return "/";
+		return view.path().str();
+	}
+
+	Shard& shardFor(const std::string& path)
+	{
+		return _shards[hashOf(path) % SHARD_COUNT];
+	}
+
+	const Shard& shardFor(const std::string& path) const
+	{
+		return _shards[hashOf(path) % SHARD_COUNT];
+	}
+
+	static Poco::UInt32 hashOf(const std::string& path)
+	{
+		Poco::UInt32 hash = 2166136261u;
+		for (std::string::const_iterator it = path.begin(); it != path.end(); ++it)
+		{
+			hash = (hash ^ static_cast<unsigned char>(*it))*16777619u;
+		}
+		return hash;
+	}
+
+	void add(const std::string& path, const Entry& entry)
+	{
+		Shard& shard = shardFor(path);
+		Poco::ScalableRWLock::ScopedWriteLock lock(shard.lock);
+		shard.entries[path].push_back(entry);
+	}
+
+	void remove(const std::string& path, const ORB::ObjectRegistration& reg)
+	{
+		Shard& shard = shardFor(path);
+		Poco::ScalableRWLock::ScopedWriteLock lock(shard.lock);
+		EntryMap::iterator it = shard.entries.find(path);
+		if (it == shard.entries.end()) return;
+		EntryVec& entries = it->second;
+		for (EntryVec::iterator itEntry = entries.begin(); itEntry != entries.end();)
+		{
+			bool match = reg.pRemoteObject ? itEntry->pRemoteObject == reg.pRemoteObject : itEntry->pListener == reg.pListener;
+			if (match)
+				itEntry = entries.erase(itEntry);
+			else
+				++itEntry;
+		}
+		if (entries.empty()) shard.entries.erase(it);
+	}
+
+	ORB& _orb;
+	Shard _shards[SHARD_COUNT];
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_ObjectTable_INCLUDED
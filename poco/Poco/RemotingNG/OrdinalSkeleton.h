@@ -0,0 +1,173 @@
+//
+// OrdinalSkeleton.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: ORB
+// Module:  OrdinalSkeleton
+//
+// Definition of the OrdinalSkeleton class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_OrdinalSkeleton_INCLUDED
+#define RemotingNG_OrdinalSkeleton_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Skeleton.h"
+#include "Poco/RemotingNG/MethodHandler.h"
+#include "Poco/RemotingNG/RemoteObject.h"
+#include "Poco/RemotingNG/ServerTransport.h"
+#include "Poco/RemotingNG/Deserializer.h"
+#include "Poco/RemotingNG/Serializer.h"
+#include "Poco/RemotingNG/OrdinalSerialization.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/Atom.h"
+#include "Poco/FlatHashMap.h"
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class OrdinalSkeleton: public Skeleton
+	/// A Skeleton that finds the MethodHandler for a request by
+	/// the method ordinal sent with the request (see OrdinalSerializer),
+	/// in a flat array, instead of by the method name.
+	///
+	/// The method name is still compared with the name of the method
+	/// registered for the ordinal, so that peers using a different
+	/// version of the interface are detected. Requests without ordinal,
+	/// or with an ordinal not matching the name, are dispatched by name.
+	///
+	/// All MethodHandlers are also registered with the Skeleton base
+	/// class, so that invoke(), as called by the ORB, behaves exactly
+	/// as for a Skeleton. Ordinal dispatch is done by dispatch(), for
+	/// servers that look up the object and its Skeleton themselves.
+{
+public:
+	typedef Poco::AutoPtr<OrdinalSkeleton> Ptr;
+
+	OrdinalSkeleton()
+		/// Creates the OrdinalSkeleton.
+	{
+	}
+
+	~OrdinalSkeleton()
+		/// Destroys the OrdinalSkeleton.
+	{
+	}
+
+	bool dispatch(ServerTransport& transport, RemoteObject::Ptr pRemoteObject)
+		/// Invokes a method on the RemoteObject, like invoke().
+		///
+		/// Returns true if the method was found, false otherwise.
+	{
+		Deserializer& deser = transport.beginRequest();
+		bool found = false;
+		try
+		{
+			std::string name;
+			SerializerBase::MessageType type = deser.findMessage(name);
+			if (type != SerializerBase::MESSAGE_REQUEST && type != SerializerBase::MESSAGE_EVENT)
+				throw UnexpectedMessageException(name);
+
+			MethodHandler::Ptr pHandler = findHandler(deser, name);
+			if (pHandler)
+			{
+				found = true;
+				pHandler->invoke(transport, deser, pRemoteObject);
+			}
+			else if (type == SerializerBase::MESSAGE_REQUEST)
+			{
+				MethodNotFoundException exc(name);
+				Serializer& ser = transport.sendReply(SerializerBase::MESSAGE_FAULT);
+				ser.serializeFaultMessage(name, exc);
+			}
+		}
+		catch (...)
+		{
+			transport.endRequest();
+			throw;
+		}
+		transport.endRequest();
+		return found;
+	}
+
+protected:
+	void addMethodHandler(const std::string& name, MethodHandler::Ptr pMethodHandler)
+		/// Adds a MethodHandler for the method with the given name,
+		/// which can only be dispatched by name.
+	{
+		Skeleton::addMethodHandler(name, pMethodHandler);
+		_handlersByName[Poco::Atom(name)] = pMethodHandler;
+	}
+
+	void addMethodHandler(const std::string& name, Poco::UInt16 ordinal, MethodHandler::Ptr pMethodHandler)
+		/// Adds a MethodHandler for the method with the given
+		/// name and ordinal.
+	{
+		addMethodHandler(name, pMethodHandler);
+		if (ordinal >= _handlersByOrdinal.size()) _handlersByOrdinal.resize(ordinal + 1);
+		_handlersByOrdinal[ordinal] = OrdinalEntry(name, pMethodHandler);
+	}
+
+private:
+	struct OrdinalEntry
+	{
+		OrdinalEntry()
+		{
+		}
+
+		OrdinalEntry(const std::string& n, MethodHandler::Ptr pH):
+			name(n),
+			pHandler(pH)
+		{
+		}
+
+		std::string name;
+		MethodHandler::Ptr pHandler;
+	};
+
+	typedef std::vector<OrdinalEntry> OrdinalHandlers;
+	typedef Poco::FlatHashMap<Poco::Atom, MethodHandler::Ptr> NamedHandlers;
+
+	MethodHandler::Ptr findHandler(Deserializer& deser, const std::string& name) const
+	{
+		OrdinalDeserializer* pOrdinalDeser = dynamic_cast<OrdinalDeserializer*>(&deser);
+		if (pOrdinalDeser)
+		{
+			int ordinal = pOrdinalDeser->messageOrdinal();
+			if (ordinal >= 0 && static_cast<std::size_t>(ordinal) < _handlersByOrdinal.size())
+			{
+				const OrdinalEntry& entry = _handlersByOrdinal[ordinal];
+				if (entry.pHandler && entry.name == name) return entry.pHandler;
+			}
+		}
+		// method names from requests are looked up, not interned
+		Poco::Atom atom;
+		if (Poco::Atom::find(name, atom))
+		{
+			NamedHandlers::ConstIterator it = _handlersByName.find(atom);
+			if (it != _handlersByName.end()) return it->second;
+		}
+		return MethodHandler::Ptr();
+	}
+
+	OrdinalHandlers _handlersByOrdinal;
+	NamedHandlers _handlersByName;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_OrdinalSkeleton_INCLUDED
@@ -0,0 +1,300 @@
+//
+// ProxyCache.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: ORB
+// Module:  ProxyCache
+//
+// Definition of the ProxyCache class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_ProxyCache_INCLUDED
+#define RemotingNG_ProxyCache_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/ORB.h"
+#include "Poco/RemotingNG/Proxy.h"
+#include "Poco/RemotingNG/Identifiable.h"
+#include "Poco/FlatHashMap.h"
+#include "Poco/ScalableRWLock.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Thread.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include "Poco/NumberFormatter.h"
+#include <string>
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class ProxyCache
+	/// A cache of the Proxy objects created by ORB::findObject(),
+	/// keyed by URI, for clients that look up a remote service for
+	/// every call.
+	///
+	/// Every ORB::findObject() call for a remote object creates a new
+	/// Proxy through the ProxyFactoryManager, with a new Transport,
+	/// new serializers and possibly a new connection to set up.
+	/// ProxyCache returns the same Proxy (and hence Transport) for the
+	/// same URI instead, with a hash lookup under the read lock of one
+	/// of a number of shards. Objects that ORB::findObject() returns
+	/// for services registered locally (RemoteObject instances) are
+	/// not cached, as they are unregistered with their service.
+	///
+	/// As a Transport carries one request at a time, a Proxy is by
+	/// default only shared by calls from the same thread
+	/// (SHARE_PER_THREAD). Proxies whose Transport handles concurrent
+	/// requests, e.g. a TCP::PipelinedTransport, can be shared by all
+	/// threads (SHARE_GLOBAL).
+	///
+	/// Cached proxies that are not referenced outside of the cache,
+	/// and have not been looked up for about the idle timeout, are
+	/// released by sweep(), which is also called on a cache miss once
+	/// the idle timeout has passed since the previous sweep.
+	///
+	/// Instead of the find() function of a generated client helper,
+	/// e.g. SomeServiceClientHelper::find(uri):
+	///
+	///     ISomeService::Ptr pService = ProxyCache::defaultCache().find<ISomeService>(uri);
+	///
+	/// ProxyCache is thread-safe.
+{
+public:
+	enum Sharing
+	{
+		SHARE_PER_THREAD,
+			/// A Proxy is only returned to the thread that created it.
+		SHARE_GLOBAL
+			/// A Proxy is returned to all threads.
+	};
+
+	explicit ProxyCache(Sharing sharing = SHARE_PER_THREAD, const Poco::Timespan& idleTimeout = Poco::Timespan(DEFAULT_IDLE_TIMEOUT, 0), ORB& orb = ORB::instance()):
+		_sharing(sharing),
+		_idleTimeout(idleTimeout),
+		_orb(orb)
+		/// Creates a ProxyCache for objects found
+		/// with the given ORB.
+	{
+	}
+
+	~ProxyCache()
+		/// Destroys the ProxyCache.
+	{
+	}
+
+	Identifiable::Ptr findObject(const std::string& uri)
+		/// Returns the cached Proxy for the given URI, or the
+		/// object returned by ORB::findObject(uri), which is
+		/// cached if it is a Proxy.
+	{
+		std::string key(keyOf(uri));
+		Shard& shard = shardFor(key);
+		{
+			Poco::ScalableRWLock::ScopedReadLock lock(shard.lock);
+			EntryMap::ConstIterator it = shard.entries.find(key);
+			if (it != shard.entries.end())
+			{
+				it->second.used = 1;
+				return it->second.pObject;
+			}
+		}
+		sweepIfDue();
+		Identifiable::Ptr pObject = _orb.findObject(uri);
+		if (!dynamic_cast<Proxy*>(pObject.get())) return pObject;
+
+		Poco::ScalableRWLock::ScopedWriteLock lock(shard.lock);
+		std::pair<EntryMap::Iterator, bool> result = shard.entries.insert(EntryMap::ValueType(key, Entry(pObject)));
+		// another thread may have cached a Proxy for the URI in the meantime
+		return result.first->second.pObject;
+	}
+
+	template <class I>
+	Poco::AutoPtr<I> find(const std::string& uri)
+		/// Returns the cached Proxy, or the local object, for the
+		/// given URI, as the service interface I.
+		///
+		/// Throws a Poco::BadCastException if the object does not
+		/// implement I.
+	{
+		Poco::AutoPtr<I> pInterface = findObject(uri).template cast<I>();
+		if (!pInterface) throw Poco::BadCastException("The object does not implement the interface", uri);
+		return pInterface;
+	}
+
+	void remove(const std::string& uri)
+		/// Removes the Proxy objects for the given URI, e.g. after the
+		/// service has moved, so that the next lookup creates a new one.
+	{
+		for (int i = 0; i < SHARD_COUNT; ++i)
+		{
+			Shard& shard = _shards[i];
+			Poco::ScalableRWLock::ScopedWriteLock lock(shard.lock);
+			std::vector<std::string> keys;
+			for (EntryMap::ConstIterator it = shard.entries.begin(); it != shard.entries.end(); ++it)
+			{
+				if (uriOf(it->first) == uri) keys.push_back(it->first);
+			}
+			for (std::vector<std::string>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+			{
+				shard.entries.erase(*it);
+			}
+		}
+	}
+
+	void sweep()
+		/// Releases the cached proxies that are only referenced by
+		/// the cache and have not been looked up since the previous
+		/// sweep.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_sweepMutex);
+			_lastSweep.update();
+		}
+		for (int i = 0; i < SHARD_COUNT; ++i)
+		{
+			Shard& shard = _shards[i];
+			Poco::ScalableRWLock::ScopedWriteLock lock(shard.lock);
+			std::vector<std::string> keys;
+			for (EntryMap::ConstIterator it = shard.entries.begin(); it != shard.entries.end(); ++it)
+			{
+				if (it->second.used == 0 && it->second.pObject->referenceCount() == 1)
+					keys.push_back(it->first);
+				else
+					it->second.used = 0;
+			}
+			for (std::vector<std::string>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+			{
+				shard.entries.erase(*it);
+			}
+		}
+	}
+
+	void clear()
+		/// Removes all cached proxies.
+	{
+		for (int i = 0; i < SHARD_COUNT; ++i)
+		{
+			Poco::ScalableRWLock::ScopedWriteLock lock(_shards[i].lock);
+			_shards[i].entries.clear();
+		}
+	}
+
+	std::size_t size() const
+		/// Returns the number of cached proxies.
+	{
+		std::size_t n = 0;
+		for (int i = 0; i < SHARD_COUNT; ++i)
+		{
+			Poco::ScalableRWLock::ScopedReadLock lock(_shards[i].lock);
+			n += _shards[i].entries.size();
+		}
+		return n;
+	}
+
+	static ProxyCache& defaultCache()
+		/// Returns the process-wide ProxyCache, which
+		/// shares proxies per thread.
+	{
+		static ProxyCache* pCache = new ProxyCache;
+		return *pCache;
+	}
+
+private:
+	enum
+	{
+		SHARD_COUNT = 16,
+		DEFAULT_IDLE_TIMEOUT = 60
+			/// seconds
+	};
+
+	struct Entry
+	{
+		explicit Entry(Identifiable::Ptr pObj):
+			pObject(pObj),
+			used(1)
+		{
+		}
+
+		Identifiable::Ptr pObject;
+		mutable Poco::AtomicCounter used;
+	};
+
+	typedef Poco::FlatHashMap<std::string, Entry> EntryMap;
+
+	struct Shard
+	{
+		mutable Poco::ScalableRWLock lock;
+		EntryMap entries;
+	};
+
+	ProxyCache(const ProxyCache&);
+	ProxyCache& operator = (const ProxyCache&);
+
+	std::string keyOf(const std::string& uri) const
+		/// Returns the URI, followed by a NUL character and
+		/// the ID of the current thread for SHARE_PER_THREAD.
+	{
+		if (_sharing == SHARE_GLOBAL) return uri;
+		std::string key(uri);
+		key += '\0';
+		Poco::NumberFormatter::append(key, static_cast<Poco::UInt64>(Poco::Thread::currentTid()));
+		return key;
+	}
+
+	static std::string uriOf(const std::string& key)
+	{
+		return key.substr(0, key.find('\0'));
+	}
+
+	Shard& shardFor(const std::string& key)
+	{
+		return _shards[hashOf(key) % SHARD_COUNT];
+	}
+
+	static Poco::UInt32 hashOf(const std::string& key)
+	{
+		Poco::UInt32 hash = 2166136261u;
+		for (std::string::const_iterator it = key.begin(); it != key.end(); ++it)
+		{
+			hash = (hash ^ static_cast<unsigned char>(*it))*16777619u;
+		}
+		return hash;
+	}
+
+	void sweepIfDue()
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_sweepMutex);
+			if (!_lastSweep.isElapsed(_idleTimeout.totalMicroseconds())) return;
+		}
+		sweep();
+	}
+
+	Sharing _sharing;
+	Poco::Timespan _idleTimeout;
+	ORB& _orb;
+	Shard _shards[SHARD_COUNT];
+	Poco::Timestamp _lastSweep;
+	Poco::FastMutex _sweepMutex;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_ProxyCache_INCLUDED
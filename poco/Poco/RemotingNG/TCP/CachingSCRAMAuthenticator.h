@@ -0,0 +1,90 @@
+//
+// CachingSCRAMAuthenticator.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  CachingSCRAMAuthenticator
+//
+// Definition of the CachingSCRAMAuthenticator class.
+//
+// Copyright (c) 2017, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_CachingSCRAMAuthenticator_INCLUDED
+#define RemotingNG_TCP_CachingSCRAMAuthenticator_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/SCRAMAuthenticator.h"
+#include "Poco/RemotingNG/TCP/SaltedPasswordCache.h"
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class CachingSCRAMAuthenticator: public SCRAMAuthenticator
+	/// A SCRAMAuthenticator for user accounts that are stored with
+	/// a password, rather than with a salted hash.
+	///
+	/// The salted hash returned by hashForUser() is derived from the
+	/// password with PBKDF2 once, and then taken from a
+	/// SaltedPasswordCache, so that clients reconnecting with the same
+	/// account no longer each cost a full PBKDF2 run on the server.
+	///
+	/// Subclasses must implement userForName().
+{
+public:
+	typedef Poco::AutoPtr<CachingSCRAMAuthenticator> Ptr;
+
+	explicit CachingSCRAMAuthenticator(SaltedPasswordCache& cache = SaltedPasswordCache::defaultCache()):
+		_cache(cache)
+		/// Creates the CachingSCRAMAuthenticator using the given cache.
+	{
+	}
+
+	~CachingSCRAMAuthenticator()
+		/// Destroys the CachingSCRAMAuthenticator.
+	{
+	}
+
+protected:
+	virtual bool userForName(const std::string& username, std::string& password, std::string& salt, int& iterations) = 0;
+		/// Looks up the password, salt and PBKDF2 iteration count
+		/// of the given user.
+		///
+		/// Returns false if the user does not exist.
+
+	// SCRAMAuthenticator
+	std::string saltForUser(const std::string& username, int& iterations)
+	{
+		std::string password;
+		std::string salt;
+		if (userForName(username, password, salt, iterations)) return salt;
+		return std::string();
+	}
+
+	std::string hashForUser(const std::string& username)
+	{
+		std::string password;
+		std::string salt;
+		int iterations = 0;
+		if (userForName(username, password, salt, iterations)) return _cache.saltedPassword(password, salt, iterations);
+		return std::string();
+	}
+
+private:
+	SaltedPasswordCache& _cache;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_CachingSCRAMAuthenticator_INCLUDED
@@ -0,0 +1,181 @@
+//
+// ChannelRouter.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  ChannelRouter
+//
+// Definition of the ChannelRouter class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_ChannelRouter_INCLUDED
+#define RemotingNG_TCP_ChannelRouter_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/FrameHandler.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/Mutex.h"
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class ChannelRouter: public FrameHandler
+	/// A FrameHandler that routes frames to the FrameHandlers
+	/// registered for their channels, with a hash table indexed by
+	/// channel number.
+	///
+	/// Connection::processFrame() offers every received frame to the
+	/// pushed FrameHandlers one after the other, so that with thousands
+	/// of concurrent requests, each with a FrameQueue for its channel,
+	/// routing a frame takes a walk over thousands of handlers. With a
+	/// ChannelRouter pushed onto the Connection, and the per-channel
+	/// handlers added to the ChannelRouter instead, routing a frame takes
+	/// one lookup.
+	///
+	/// Several handlers can be added for the same channel, e.g. for
+	/// different frame types; they are offered the frame in the order
+	/// they have been added.
+{
+public:
+	typedef Poco::AutoPtr<ChannelRouter> Ptr;
+
+	ChannelRouter():
+		_buckets(INITIAL_BUCKETS),
+		_count(0)
+		/// Creates the ChannelRouter.
+	{
+	}
+
+	~ChannelRouter()
+		/// Destroys the ChannelRouter.
+	{
+	}
+
+	void addHandler(Poco::UInt32 channel, FrameHandler::Ptr pHandler)
+		/// Adds the FrameHandler for the given channel.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (_count + 1 > _buckets.size()) rehash(2*_buckets.size());
+		_buckets[channel & (_buckets.size() - 1)].push_back(Entry(channel, pHandler));
+		++_count;
+	}
+
+	void removeHandler(Poco::UInt32 channel, FrameHandler::Ptr pHandler)
+		/// Removes the FrameHandler for the given channel.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Bucket& bucket = _buckets[channel & (_buckets.size() - 1)];
+		for (Bucket::iterator it = bucket.begin(); it != bucket.end(); ++it)
+		{
+			if (it->channel == channel && it->pHandler == pHandler)
+			{
+				bucket.erase(it);
+				--_count;
+				return;
+			}
+		}
+	}
+
+	std::size_t count() const
+		/// Returns the number of registered handlers.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _count;
+	}
+
+	// FrameHandler
+	bool handleFrame(Connection::Ptr pConnection, Frame::Ptr pFrame)
+	{
+		Poco::UInt32 channel = pFrame->channel();
+		FrameHandler::Ptr handlers[MAX_INLINE_HANDLERS];
+		std::vector<FrameHandler::Ptr> moreHandlers;
+		std::size_t n = 0;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			const Bucket& bucket = _buckets[channel & (_buckets.size() - 1)];
+			for (Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+			{
+				if (it->channel == channel)
+				{
+					if (n < MAX_INLINE_HANDLERS)
+						handlers[n++] = it->pHandler;
+					else
+						moreHandlers.push_back(it->pHandler);
+				}
+			}
+		}
+		// Handlers are called without holding the mutex,
+		// as they may add or remove handlers.
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			if (handlers[i]->handleFrame(pConnection, pFrame)) return true;
+		}
+		for (std::vector<FrameHandler::Ptr>::iterator it = moreHandlers.begin(); it != moreHandlers.end(); ++it)
+		{
+			if ((*it)->handleFrame(pConnection, pFrame)) return true;
+		}
+		return false;
+	}
+
+private:
+	enum
+	{
+		INITIAL_BUCKETS = 64,
+		MAX_INLINE_HANDLERS = 4
+	};
+
+	struct Entry
+	{
+		Entry(Poco::UInt32 c, FrameHandler::Ptr pH):
+			channel(c),
+			pHandler(pH)
+		{
+		}
+
+		Poco::UInt32 channel;
+		FrameHandler::Ptr pHandler;
+	};
+
+	typedef std::vector<Entry> Bucket;
+	typedef std::vector<Bucket> BucketVec;
+
+	ChannelRouter(const ChannelRouter&);
+	ChannelRouter& operator = (const ChannelRouter&);
+
+	void rehash(std::size_t size)
+	{
+		BucketVec buckets(size);
+		for (BucketVec::iterator itBucket = _buckets.begin(); itBucket != _buckets.end(); ++itBucket)
+		{
+			for (Bucket::iterator it = itBucket->begin(); it != itBucket->end(); ++it)
+			{
+				buckets[it->channel & (size - 1)].push_back(*it);
+			}
+		}
+		_buckets.swap(buckets);
+	}
+
+	BucketVec _buckets;
+	std::size_t _count;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_ChannelRouter_INCLUDED
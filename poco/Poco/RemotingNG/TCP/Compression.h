@@ -0,0 +1,468 @@
+//
+// Compression.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  Compression
+//
+// Definition of the Codec and Compressor classes.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_Compression_INCLUDED
+#define RemotingNG_TCP_Compression_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/ByteOrder.h"
+#include "Poco/Mutex.h"
+#include "Poco/Clock.h"
+#include <vector>
+#include <cstring>
+#if defined(POCO_UNBUNDLED)
+#include <zlib.h>
+#else
+#include "Poco/zlib.h"
+#endif
+#if defined(POCO_REMOTING_HAVE_LZ4)
+#include <lz4.h>
+#endif
+#if defined(POCO_REMOTING_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+
+//
+// Compressed blocks.
+//
+// A message sent with FRAME_FLAG_CODEC is a compressed block, consisting
+// of a one byte codec ID (Codec::Type), the uncompressed size (UInt32,
+// network byte order) and the compressed data. Messages smaller than the
+// Compressor's threshold, or that do not get smaller, are sent as a block
+// with CODEC_NONE, so that the receiver can always decode a block without
+// knowing the sender's settings.
+//
+// LZ4 and zstd support must be enabled when building, by defining
+// POCO_REMOTING_HAVE_LZ4 and/or POCO_REMOTING_HAVE_ZSTD and linking
+// the respective library. Deflate is always available, via zlib.
+//
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class Codec: public Poco::RefCountedObject
+	/// A Codec compresses and decompresses blocks of bytes.
+{
+public:
+	typedef Poco::AutoPtr<Codec> Ptr;
+
+	enum Type
+	{
+		CODEC_NONE    = 0,
+			/// The block is not compressed.
+
+		CODEC_DEFLATE = 1,
+			/// zlib deflate.
+
+		CODEC_LZ4     = 2,
+			/// LZ4 block format.
+
+		CODEC_ZSTD    = 3
+			/// zstd frame format.
+	};
+
+	virtual Type type() const = 0;
+		/// Returns the type of the codec.
+
+	virtual std::size_t compress(const char* pData, std::size_t size, char* pBuffer, std::size_t bufferSize) = 0;
+		/// Compresses size bytes at pData into the buffer and returns the
+		/// compressed size, or 0 if the compressed data does not fit.
+
+	virtual void decompress(const char* pData, std::size_t size, char* pBuffer, std::size_t originalSize) = 0;
+		/// Decompresses the compressed block at pData into the buffer,
+		/// which must have the block's original size.
+		///
+		/// Throws a ProtocolException if the block is corrupt.
+
+	static Ptr create(Type type);
+		/// Creates the Codec for the given type.
+		///
+		/// Throws a NotImplementedException if the codec is
+		/// not available in this build.
+
+	static bool available(Type type);
+		/// Returns true if the codec is available in this build.
+
+	static void advertise(Connection& connection);
+		/// Adds the capabilities for the codecs available in this
+		/// build to the connection, which must be done before the
+		/// handshake.
+
+	static Type negotiate(Connection& connection);
+		/// Returns the preferred codec available on both endpoints of the
+		/// established connection: zstd, then LZ4, otherwise CODEC_NONE.
+
+protected:
+	Codec()
+	{
+	}
+
+	~Codec()
+	{
+	}
+};
+
+
+class DeflateCodec: public Codec
+	/// A Codec using zlib deflate.
+{
+public:
+	explicit DeflateCodec(int level = Z_BEST_SPEED):
+		_level(level)
+	{
+	}
+
+	Type type() const
+	{
+		return CODEC_DEFLATE;
+	}
+
+	std::size_t compress(const char* pData, std::size_t size, char* pBuffer, std::size_t bufferSize)
+	{
+		uLongf compressedSize = static_cast<uLongf>(bufferSize);
+		int rc = compress2(reinterpret_cast<Bytef*>(pBuffer), &compressedSize, reinterpret_cast<const Bytef*>(pData), static_cast<uLong>(size), _level);
+		return rc == Z_OK ? compressedSize : 0;
+	}
+
+	void decompress(const char* pData, std::size_t size, char* pBuffer, std::size_t originalSize)
+	{
+		uLongf uncompressedSize = static_cast<uLongf>(originalSize);
+		int rc = uncompress(reinterpret_cast<Bytef*>(pBuffer), &uncompressedSize, reinterpret_cast<const Bytef*>(pData), static_cast<uLong>(size));
+		if (rc != Z_OK || uncompressedSize != originalSize) throw Poco::RemotingNG::ProtocolException("Corrupt deflate block");
+	}
+
+private:
+	int _level;
+};
+
+
+#if defined(POCO_REMOTING_HAVE_LZ4)
+
+
+class LZ4Codec: public Codec
+	/// A Codec using the LZ4 block format.
+{
+public:
+	explicit LZ4Codec(int acceleration = 1):
+		_acceleration(acceleration)
+	{
+	}
+
+	Type type() const
+	{
+		return CODEC_LZ4;
+	}
+
+	std::size_t compress(const char* pData, std::size_t size, char* pBuffer, std::size_t bufferSize)
+	{
+		int rc = LZ4_compress_fast(pData, pBuffer, static_cast<int>(size), static_cast<int>(bufferSize), _acceleration);
+		return rc > 0 ? static_cast<std::size_t>(rc) : 0;
+	}
+
+	void decompress(const char* pData, std::size_t size, char* pBuffer, std::size_t originalSize)
+	{
+		int rc = LZ4_decompress_safe(pData, pBuffer, static_cast<int>(size), static_cast<int>(originalSize));
+		if (rc < 0 || static_cast<std::size_t>(rc) != originalSize) throw Poco::RemotingNG::ProtocolException("Corrupt LZ4 block");
+	}
+
+private:
+	int _acceleration;
+};
+
+
+#endif // POCO_REMOTING_HAVE_LZ4
+
+
+#if defined(POCO_REMOTING_HAVE_ZSTD)
+
+
+class ZstdCodec: public Codec
+	/// A Codec using the zstd frame format.
+{
+public:
+	explicit ZstdCodec(int level = 1):
+		_level(level)
+	{
+	}
+
+	Type type() const
+	{
+		return CODEC_ZSTD;
+	}
+
+	std::size_t compress(const char* pData, std::size_t size, char* pBuffer, std::size_t bufferSize)
+	{
+		std::size_t rc = ZSTD_compress(pBuffer, bufferSize, pData, size, _level);
+		return ZSTD_isError(rc) ? 0 : rc;
+	}
+
+	void decompress(const char* pData, std::size_t size, char* pBuffer, std::size_t originalSize)
+	{
+		std::size_t rc = ZSTD_decompress(pBuffer, originalSize, pData, size);
+		if (ZSTD_isError(rc) || rc != originalSize) throw Poco::RemotingNG::ProtocolException("Corrupt zstd block");
+	}
+
+private:
+	int _level;
+};
+
+
+#endif // POCO_REMOTING_HAVE_ZSTD
+
+
+class Compressor
+	/// Compressor encodes and decodes messages as compressed blocks, using
+	/// the codec negotiated for a connection, and keeps statistics.
+	///
+	/// Messages smaller than the threshold are not compressed, as the
+	/// latency of compressing them is not worth the few bytes saved. The
+	/// same applies to messages that do not get smaller, e.g. because
+	/// they contain already compressed data.
+	///
+	/// A Compressor can be shared by multiple threads.
+{
+public:
+	enum
+	{
+		DEFAULT_THRESHOLD = 1024,
+			/// Default minimum size of messages to compress.
+
+		BLOCK_HEADER_SIZE = 5,
+			/// Size of the block header (codec ID and original size).
+
+		DEFAULT_MAX_SIZE = 64*1024*1024
+			/// Default maximum original size of decoded blocks.
+	};
+
+	struct Statistics
+	{
+		Statistics():
+			messages(0),
+			compressed(0),
+			bytesIn(0),
+			bytesOut(0),
+			compressTime(0),
+			decompressTime(0)
+		{
+		}
+
+		double ratio() const
+			/// Returns the ratio of encoded to original bytes.
+		{
+			return bytesIn > 0 ? static_cast<double>(bytesOut)/static_cast<double>(bytesIn) : 1.0;
+		}
+
+		Poco::UInt64 messages;       /// Messages encoded.
+		Poco::UInt64 compressed;     /// Messages encoded with the codec.
+		Poco::UInt64 bytesIn;        /// Original size of the encoded messages.
+		Poco::UInt64 bytesOut;       /// Size of the encoded blocks.
+		Poco::Int64  compressTime;   /// Time spent compressing, in microseconds.
+		Poco::Int64  decompressTime; /// Time spent decompressing, in microseconds.
+	};
+
+	explicit Compressor(Codec::Type type, std::size_t threshold = DEFAULT_THRESHOLD, std::size_t maxSize = DEFAULT_MAX_SIZE):
+		_pCodec(type != Codec::CODEC_NONE ? Codec::create(type) : Codec::Ptr()),
+		_threshold(threshold),
+		_maxSize(maxSize)
+		/// Creates the Compressor for the given codec.
+	{
+	}
+
+	explicit Compressor(Connection& connection, std::size_t threshold = DEFAULT_THRESHOLD, std::size_t maxSize = DEFAULT_MAX_SIZE):
+		_threshold(threshold),
+		_maxSize(maxSize)
+		/// Creates the Compressor for the codec negotiated
+		/// for the established connection.
+	{
+		Codec::Type type = Codec::negotiate(connection);
+		if (type != Codec::CODEC_NONE) _pCodec = Codec::create(type);
+	}
+
+	~Compressor()
+		/// Destroys the Compressor.
+	{
+	}
+
+	Codec::Type codec() const
+		/// Returns the type of the codec used for compressing.
+	{
+		return _pCodec ? _pCodec->type() : Codec::CODEC_NONE;
+	}
+
+	void encode(const char* pData, std::size_t size, std::vector<char>& block)
+		/// Encodes the message as a block.
+	{
+		block.resize(BLOCK_HEADER_SIZE + size + size/8 + 64);
+		std::size_t compressedSize = 0;
+		Poco::Clock start;
+		if (_pCodec && size > 0 && size >= _threshold)
+		{
+			compressedSize = _pCodec->compress(pData, size, &block[BLOCK_HEADER_SIZE], size - 1);
+		}
+		Poco::Clock::ClockDiff elapsed = start.elapsed();
+		Codec::Type type = compressedSize > 0 ? _pCodec->type() : Codec::CODEC_NONE;
+		if (type == Codec::CODEC_NONE)
+		{
+			if (size > 0) std::memcpy(&block[BLOCK_HEADER_SIZE], pData, size);
+			compressedSize = size;
+		}
+		block.resize(BLOCK_HEADER_SIZE + compressedSize);
+		writeHeader(&block[0], type, size);
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		++_statistics.messages;
+		if (type != Codec::CODEC_NONE) ++_statistics.compressed;
+		_statistics.bytesIn  += size;
+		_statistics.bytesOut += block.size();
+		_statistics.compressTime += elapsed;
+	}
+
+	void decode(const char* pBlock, std::size_t size, std::vector<char>& message)
+		/// Decodes the block into the message.
+		///
+		/// Throws a ProtocolException if the block is corrupt, larger
+		/// than the maximum size, or uses an unavailable codec.
+	{
+		if (size < BLOCK_HEADER_SIZE) throw Poco::RemotingNG::ProtocolException("Truncated compressed block");
+		Codec::Type type = static_cast<Codec::Type>(static_cast<unsigned char>(pBlock[0]));
+		Poco::UInt32 originalSize;
+		std::memcpy(&originalSize, pBlock + 1, sizeof(originalSize));
+		originalSize = Poco::ByteOrder::fromNetwork(originalSize);
+		if (originalSize > _maxSize) throw Poco::RemotingNG::ProtocolException("Compressed block too large");
+
+		const char* pData = pBlock + BLOCK_HEADER_SIZE;
+		std::size_t dataSize = size - BLOCK_HEADER_SIZE;
+		message.resize(originalSize);
+		if (type == Codec::CODEC_NONE)
+		{
+			if (dataSize != originalSize) throw Poco::RemotingNG::ProtocolException("Corrupt uncompressed block");
+			if (dataSize > 0) std::memcpy(&message[0], pData, dataSize);
+			return;
+		}
+		if (!Codec::available(type)) throw Poco::RemotingNG::ProtocolException("Unsupported codec in compressed block");
+		Codec::Ptr pCodec = (_pCodec && _pCodec->type() == type) ? _pCodec : Codec::create(type);
+		Poco::Clock start;
+		pCodec->decompress(pData, dataSize, originalSize > 0 ? &message[0] : 0, originalSize);
+		Poco::Clock::ClockDiff elapsed = start.elapsed();
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_statistics.decompressTime += elapsed;
+	}
+
+	Statistics statistics() const
+		/// Returns the compression statistics.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _statistics;
+	}
+
+protected:
+	static void writeHeader(char* pHeader, Codec::Type type, std::size_t size)
+	{
+		pHeader[0] = static_cast<char>(type);
+		Poco::UInt32 originalSize = Poco::ByteOrder::toNetwork(static_cast<Poco::UInt32>(size));
+		std::memcpy(pHeader + 1, &originalSize, sizeof(originalSize));
+	}
+
+private:
+	Compressor(const Compressor&);
+	Compressor& operator = (const Compressor&);
+
+	Codec::Ptr _pCodec;
+	std::size_t _threshold;
+	std::size_t _maxSize;
+	Statistics _statistics;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+//
+// inlines
+//
+inline Codec::Ptr Codec::create(Type type)
+{
+	switch (type)
+	{
+	case CODEC_DEFLATE:
+		return new DeflateCodec;
+#if defined(POCO_REMOTING_HAVE_LZ4)
+	case CODEC_LZ4:
+		return new LZ4Codec;
+#endif
+#if defined(POCO_REMOTING_HAVE_ZSTD)
+	case CODEC_ZSTD:
+		return new ZstdCodec;
+#endif
+	default:
+		throw Poco::NotImplementedException("Codec not available");
+	}
+}
+
+
+inline bool Codec::available(Type type)
+{
+	switch (type)
+	{
+	case CODEC_NONE:
+	case CODEC_DEFLATE:
+		return true;
+#if defined(POCO_REMOTING_HAVE_LZ4)
+	case CODEC_LZ4:
+		return true;
+#endif
+#if defined(POCO_REMOTING_HAVE_ZSTD)
+	case CODEC_ZSTD:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+
+inline void Codec::advertise(Connection& connection)
+{
+	if (available(CODEC_LZ4)) connection.addCapability(Frame::CAPA_REMOTING_CODEC_LZ4);
+	if (available(CODEC_ZSTD)) connection.addCapability(Frame::CAPA_REMOTING_CODEC_ZSTD);
+}
+
+
+inline Codec::Type Codec::negotiate(Connection& connection)
+{
+	if (connection.hasCapability(Frame::CAPA_REMOTING_CODEC_ZSTD) && connection.peerHasCapability(Frame::CAPA_REMOTING_CODEC_ZSTD) && available(CODEC_ZSTD))
+		return CODEC_ZSTD;
+	if (connection.hasCapability(Frame::CAPA_REMOTING_CODEC_LZ4) && connection.peerHasCapability(Frame::CAPA_REMOTING_CODEC_LZ4) && available(CODEC_LZ4))
+		return CODEC_LZ4;
+	return CODEC_NONE;
+}
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_Compression_INCLUDED
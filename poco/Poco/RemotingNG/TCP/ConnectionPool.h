@@ -0,0 +1,304 @@
+//
+// ConnectionPool.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  ConnectionPool
+//
+// Definition of the ConnectionPool class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_ConnectionPool_INCLUDED
+#define RemotingNG_TCP_ConnectionPool_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/TCP/SocketFactory.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/URI.h"
+#include "Poco/URIView.h"
+#include "Poco/String.h"
+#include "Poco/NumberFormatter.h"
+#include <map>
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class ConnectionPool
+	/// ConnectionPool manages client Connections, like ConnectionManager,
+	/// but with up to a given number of connections per endpoint.
+	///
+	/// Endpoints are kept in a number of shards, each with its own mutex,
+	/// so that lookups for different endpoints do not contend. A new
+	/// connection is established outside of the shard's mutex, and only
+	/// by one thread per endpoint at a time; other threads either get
+	/// one of the existing connections, or, if there is none yet, wait
+	/// for the connection attempt to complete.
+	///
+	/// Until the endpoint has the configured number of connections, every
+	/// getConnection() creates a new one. After that, the connection with
+	/// the fewest references, i.e. used by the fewest Transports, is
+	/// returned, so that a slow reply on one connection does not hold up
+	/// all requests to a busy service.
+{
+public:
+	ConnectionPool(std::size_t connectionsPerEndpoint = 1, SocketFactory::Ptr pSocketFactory = new SocketFactory, Poco::ThreadPool& threadPool = Poco::ThreadPool::defaultPool()):
+		_connectionsPerEndpoint(connectionsPerEndpoint > 0 ? connectionsPerEndpoint : 1),
+		_pSocketFactory(pSocketFactory),
+		_threadPool(threadPool),
+		_idleTimeout(DEFAULT_IDLE_TIMEOUT, 0)
+		/// Creates the ConnectionPool with the given maximum number of
+		/// connections per endpoint, using the given SocketFactory and
+		/// ThreadPool.
+	{
+	}
+
+	~ConnectionPool()
+		/// Closes all connections and destroys the ConnectionPool.
+	{
+		try
+		{
+			shutdown();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void setIdleTimeout(Poco::Timespan timeout)
+		/// Sets the timeout after an idle connection is closed.
+	{
+		_idleTimeout = timeout;
+	}
+
+	Poco::Timespan getIdleTimeout() const
+		/// Returns the idle connection timeout.
+	{
+		return _idleTimeout;
+	}
+
+	Connection::Ptr getConnection(const Poco::URI& endpointURI)
+		/// Returns an established connection to the given endpoint,
+		/// creating a new one if the endpoint has fewer than the
+		/// configured number of connections.
+	{
+		return getConnection(keyOf(endpointURI), &endpointURI, std::string());
+	}
+
+	Connection::Ptr getConnection(const std::string& endpoint)
+		/// Returns an established connection to the given endpoint URI,
+		/// like getConnection(const Poco::URI&). The endpoint is looked up
+		/// with a Poco::URIView, and only parsed into a Poco::URI if a new
+		/// connection must be created.
+	{
+		return getConnection(keyOf(Poco::URIView(endpoint)), 0, endpoint);
+	}
+
+	void shutdown()
+		/// Closes all connections.
+	{
+		std::vector<Connection::Ptr> connections;
+		for (int i = 0; i < SHARDS; ++i)
+		{
+			Poco::FastMutex::ScopedLock lock(_shards[i].mutex);
+			for (EndpointMap::iterator it = _shards[i].endpoints.begin(); it != _shards[i].endpoints.end(); ++it)
+			{
+				connections.insert(connections.end(), it->second.connections.begin(), it->second.connections.end());
+				it->second.connections.clear();
+			}
+		}
+		for (std::vector<Connection::Ptr>::iterator it = connections.begin(); it != connections.end(); ++it)
+		{
+			if ((*it)->state() == Connection::STATE_ESTABLISHED) (*it)->close();
+		}
+	}
+
+	std::size_t count() const
+		/// Returns the number of pooled connections.
+	{
+		std::size_t n = 0;
+		for (int i = 0; i < SHARDS; ++i)
+		{
+			Poco::FastMutex::ScopedLock lock(_shards[i].mutex);
+			for (EndpointMap::const_iterator it = _shards[i].endpoints.begin(); it != _shards[i].endpoints.end(); ++it)
+			{
+				n += it->second.connections.size();
+			}
+		}
+		return n;
+	}
+
+	Poco::ThreadPool& threadPool()
+		/// Returns a reference to the ConnectionPool's thread pool.
+	{
+		return _threadPool;
+	}
+
+protected:
+	Connection::Ptr createConnection(const Poco::URI& endpointURI)
+	{
+		Connection::Ptr pConnection = new Connection(_pSocketFactory->createSocket(endpointURI), Connection::MODE_CLIENT);
+		pConnection->setIdleTimeout(_idleTimeout);
+		_threadPool.start(*pConnection);
+		if (!pConnection->waitReady())
+		{
+			pConnection->abort();
+			throw Poco::RemotingNG::TransportException("Connection handshake timed out", endpointURI.toString());
+		}
+		return pConnection;
+	}
+
+private:
+	enum
+	{
+		SHARDS = 16,
+		DEFAULT_IDLE_TIMEOUT = 60
+	};
+
+	struct Endpoint
+	{
+		Endpoint():
+			connecting(false)
+		{
+		}
+
+		std::vector<Connection::Ptr> connections;
+		bool connecting;
+	};
+
+	typedef std::map<std::string, Endpoint> EndpointMap;
+
+	struct Shard
+	{
+		EndpointMap endpoints;
+		Poco::Condition connected;
+		mutable Poco::FastMutex mutex;
+	};
+
+	ConnectionPool(const ConnectionPool&);
+	ConnectionPool& operator = (const ConnectionPool&);
+
+	Connection::Ptr getConnection(const std::string& key, const Poco::URI* pEndpointURI, const std::string& endpointStr)
+	{
+		Shard& shard = shardOf(key);
+		{
+			Poco::FastMutex::ScopedLock lock(shard.mutex);
+			for (;;)
+			{
+				Endpoint& endpoint = shard.endpoints[key];
+				prune(endpoint);
+				if (!endpoint.connecting && endpoint.connections.size() < _connectionsPerEndpoint)
+				{
+					endpoint.connecting = true;
+					break;
+				}
+				Connection::Ptr pConnection = leastLoaded(endpoint);
+				if (pConnection) return pConnection;
+				shard.connected.wait(shard.mutex);
+			}
+		}
+
+		Connection::Ptr pConnection;
+		try
+		{
+			pConnection = pEndpointURI ? createConnection(*pEndpointURI) : createConnection(Poco::URI(endpointStr));
+		}
+		catch (...)
+		{
+			Poco::FastMutex::ScopedLock lock(shard.mutex);
+			shard.endpoints[key].connecting = false;
+			shard.connected.broadcast();
+			throw;
+		}
+		Poco::FastMutex::ScopedLock lock(shard.mutex);
+		Endpoint& endpoint = shard.endpoints[key];
+		endpoint.connections.push_back(pConnection);
+		endpoint.connecting = false;
+		shard.connected.broadcast();
+		return pConnection;
+	}
+
+	static std::string keyOf(const Poco::URI& uri)
+	{
+		std::string key(uri.getScheme());
+		key += "://";
+		key += uri.getHost();
+		key += ':';
+		Poco::NumberFormatter::append(key, uri.getPort());
+		return key;
+	}
+
+	static std::string keyOf(const Poco::URIView& uri)
+	{
+		std::string key(uri.scheme().str());
+		Poco::toLowerInPlace(key);
+		key += "://";
+		key += uri.host().decoded();
+		key += ':';
+		Poco::NumberFormatter::append(key, uri.port());
+		return key;
+	}
+
+	Shard& shardOf(const std::string& key)
+	{
+		Poco::UInt32 hash = 2166136261U;
+		for (std::string::const_iterator it = key.begin(); it != key.end(); ++it)
+		{
+			hash ^= static_cast<unsigned char>(*it);
+			hash *= 16777619U;
+		}
+		return _shards[hash % SHARDS];
+	}
+
+	static void prune(Endpoint& endpoint)
+		/// Removes connections that are no longer established.
+	{
+		std::vector<Connection::Ptr>::iterator it = endpoint.connections.begin();
+		while (it != endpoint.connections.end())
+		{
+			if ((*it)->state() != Connection::STATE_ESTABLISHED)
+				it = endpoint.connections.erase(it);
+			else
+				++it;
+		}
+	}
+
+	static Connection::Ptr leastLoaded(Endpoint& endpoint)
+	{
+		Connection* pLeast = 0;
+		for (std::vector<Connection::Ptr>::iterator it = endpoint.connections.begin(); it != endpoint.connections.end(); ++it)
+		{
+			if (!pLeast || (*it)->referenceCount() < pLeast->referenceCount()) pLeast = it->get();
+		}
+		return Connection::Ptr(pLeast, true);
+	}
+
+	std::size_t _connectionsPerEndpoint;
+	SocketFactory::Ptr _pSocketFactory;
+	Poco::ThreadPool& _threadPool;
+	Poco::Timespan _idleTimeout;
+	Shard _shards[SHARDS];
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_ConnectionPool_INCLUDED
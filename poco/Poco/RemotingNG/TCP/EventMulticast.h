@@ -0,0 +1,191 @@
+//
+// EventMulticast.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  EventMulticast
+//
+// Definition of the SharedMessage and EventMulticaster classes.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_EventMulticast_INCLUDED
+#define RemotingNG_TCP_EventMulticast_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/FrameSize.h"
+#include "Poco/RemotingNG/FlatBinarySerializer.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class SharedMessage: public Poco::RefCountedObject
+	/// An immutable serialized message body, shared by
+	/// all subscribers an event is sent to.
+{
+public:
+	typedef Poco::AutoPtr<SharedMessage> Ptr;
+
+	SharedMessage(const char* pData, std::size_t size):
+		_data(pData, pData + size)
+		/// Creates the SharedMessage from a copy of the given data.
+	{
+	}
+
+	explicit SharedMessage(const FlatBinarySerializer& serializer):
+		_data(serializer.data(), serializer.data() + serializer.size())
+		/// Creates the SharedMessage from the data held by a
+		/// FlatBinarySerializer that has not been set up with
+		/// an output stream.
+	{
+	}
+
+	const char* data() const
+		/// Returns the message body.
+	{
+		return _data.empty() ? 0 : &_data[0];
+	}
+
+	std::size_t size() const
+		/// Returns the size of the message body.
+	{
+		return _data.size();
+	}
+
+protected:
+	~SharedMessage()
+	{
+	}
+
+private:
+	std::vector<char> _data;
+};
+
+
+class EventMulticaster
+	/// EventMulticaster sends an event message that has been serialized
+	/// once to any number of subscribers.
+	///
+	/// EventDispatcher serializes an event once per subscriber, as
+	/// every subscriber has its own Transport and Serializer, although
+	/// the messages only differ in the subscriber's endpoint (object and
+	/// type ID) and the channel. With EventMulticaster, the event body is
+	/// serialized once into a SharedMessage, and for every subscriber
+	/// only a small prefix with its endpoint is serialized (see
+	/// endpointPrefix()). The frames for a subscriber are then filled
+	/// with the prefix and the shared body, and sent on the subscriber's
+	/// connection and channel.
+{
+public:
+	struct Target
+		/// A subscriber to send the message to.
+	{
+		Target(Connection::Ptr pConn, Poco::UInt32 chan, const std::string& pfx):
+			pConnection(pConn),
+			channel(chan),
+			prefix(pfx)
+		{
+		}
+
+		Connection::Ptr pConnection;
+		Poco::UInt32 channel;
+		std::string prefix;
+	};
+
+	typedef std::vector<Target> TargetVec;
+
+	static std::string endpointPrefix(const std::string& oid, const std::string& tid)
+		/// Returns the serialized endpoint of a subscriber,
+		/// as written by FlatBinarySerializer::serializeEndPoint().
+	{
+		FlatBinarySerializer serializer;
+		serializer.serializeEndPoint(oid, tid);
+		return std::string(serializer.data(), serializer.size());
+	}
+
+	static std::size_t send(SharedMessage::Ptr pMessage, const TargetVec& targets, Poco::UInt32 frameType = Frame::FRAME_TYPE_EVNT, Poco::UInt16 flags = Frame::FRAME_FLAG_ONEWAY)
+		/// Sends the message to all targets and returns the number of
+		/// targets it has been sent to. Targets whose connection fails
+		/// are skipped.
+	{
+		std::size_t sent = 0;
+		for (TargetVec::const_iterator it = targets.begin(); it != targets.end(); ++it)
+		{
+			try
+			{
+				send(*pMessage, *it, frameType, flags);
+				++sent;
+			}
+			catch (Poco::Exception&)
+			{
+			}
+		}
+		return sent;
+	}
+
+	static void send(const SharedMessage& message, const Target& target, Poco::UInt32 frameType = Frame::FRAME_TYPE_EVNT, Poco::UInt16 flags = Frame::FRAME_FLAG_ONEWAY)
+		/// Sends the target's prefix, followed by the message,
+		/// to the target.
+	{
+		Connection::Ptr pConnection = target.pConnection;
+		Connection& connection = *pConnection;
+		std::size_t maxPayload = FrameSize::maxPayloadSize(connection);
+		std::size_t total = target.prefix.size() + message.size();
+		std::size_t offset = 0;
+		do
+		{
+			std::size_t n = total - offset;
+			if (n > maxPayload) n = maxPayload;
+			Poco::UInt16 frameFlags = flags;
+			if (offset > 0) frameFlags |= Frame::FRAME_FLAG_CONT;
+			if (offset + n == total) frameFlags |= Frame::FRAME_FLAG_EOM;
+			Frame::Ptr pFrame = FrameSize::createFrame(connection, frameType, target.channel, frameFlags, n);
+			char* p = pFrame->payloadBegin();
+			std::size_t end = offset + n;
+			if (offset < target.prefix.size())
+			{
+				std::size_t m = std::min(end, target.prefix.size()) - offset;
+				std::memcpy(p, target.prefix.data() + offset, m);
+				p += m;
+				offset += m;
+			}
+			if (offset < end)
+			{
+				std::memcpy(p, message.data() + (offset - target.prefix.size()), end - offset);
+				offset = end;
+			}
+			pFrame->setPayloadSize(static_cast<Poco::UInt16>(n));
+			connection.sendFrame(pFrame);
+		}
+		while (offset < total);
+	}
+
+private:
+	EventMulticaster();
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_EventMulticast_INCLUDED
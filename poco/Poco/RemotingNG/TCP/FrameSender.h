@@ -0,0 +1,280 @@
+//
+// FrameSender.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  FrameSender
+//
+// Definition of the FrameSender class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_FrameSender_INCLUDED
+#define RemotingNG_TCP_FrameSender_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/Net/SocketDefs.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Thread.h"
+#include "Poco/RunnableAdapter.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Clock.h"
+#include "Poco/Exception.h"
+#include <deque>
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class FrameSender
+	/// FrameSender sends the frames of a Connection from a queue,
+	/// in batches, on its own thread.
+	///
+	/// Threads sending many small frames, e.g. FRAME_TYPE_EVNT frames
+	/// for many channels, only append their frames to the queue, instead
+	/// of contending for the Connection. The sender thread takes all
+	/// queued frames, up to a byte budget, and sends them one after
+	/// the other. With corking enabled, the socket is corked while a
+	/// batch is sent (TCP_CORK on Linux, TCP_NOPUSH on BSD and OS X),
+	/// so that the frames of a batch leave in as few segments as
+	/// possible, regardless of Nagle's algorithm. With a maximum delay,
+	/// the sender thread waits up to the given time for more frames
+	/// before sending a batch that is smaller than the budget.
+	///
+	/// The frames are still sent with Connection::sendFrame(), which
+	/// writes to the socket under the Connection's mutex, as the
+	/// Connection also sends frames itself. Frames are released after
+	/// sending, so they must not be taken from the Connection's pool.
+{
+public:
+	enum
+	{
+		DEFAULT_BATCH_BYTES = 65536
+	};
+
+	FrameSender(Connection::Ptr pConnection, std::size_t batchBytes = DEFAULT_BATCH_BYTES, long maxDelay = 0, bool cork = true):
+		_pConnection(pConnection),
+		_batchBytes(batchBytes > 0 ? batchBytes : 1),
+		_maxDelay(maxDelay),
+		_cork(cork),
+		_queuedBytes(0),
+		_sending(false),
+		_stop(false),
+		_failed(false),
+		_flushRequests(0),
+		_sent(0),
+		_batches(0),
+		_runnable(*this, &FrameSender::run)
+		/// Creates the FrameSender for the given Connection and starts
+		/// the sender thread.
+		///
+		/// Batches are limited to batchBytes bytes, and the sender
+		/// thread waits up to maxDelay milliseconds for a batch to fill.
+	{
+		_thread.start(_runnable);
+	}
+
+	~FrameSender()
+		/// Sends all queued frames, stops the sender
+		/// thread and destroys the FrameSender.
+	{
+		try
+		{
+			stop();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void send(Frame::Ptr pFrame)
+		/// Queues the frame for sending.
+		///
+		/// Throws an IOException if sending a previous
+		/// frame has failed.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (_failed) throw Poco::IOException("Cannot send frame", _error);
+		if (_stop) throw Poco::IllegalStateException("FrameSender has been stopped");
+		_queue.push_back(pFrame);
+		_queuedBytes += pFrame->frameSize();
+		_notEmpty.signal();
+	}
+
+	void flush()
+		/// Waits until all queued frames have been sent.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		++_flushRequests;
+		_notEmpty.signal();
+		while ((!_queue.empty() || _sending) && !_failed) _idle.wait(_mutex);
+	}
+
+	void stop()
+		/// Sends all queued frames and stops the sender thread.
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (_stop) return;
+			_stop = true;
+			_notEmpty.signal();
+		}
+		_thread.join();
+	}
+
+	Poco::UInt64 sent() const
+		/// Returns the number of frames sent.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _sent;
+	}
+
+	Poco::UInt64 batches() const
+		/// Returns the number of batches sent.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _batches;
+	}
+
+protected:
+	void run()
+	{
+		std::vector<Frame::Ptr> batch;
+		for (;;)
+		{
+			{
+				FastMutex::ScopedLock lock(_mutex);
+				while (_queue.empty() && !_stop) _notEmpty.wait(_mutex);
+				if (_queue.empty()) break;
+				if (_maxDelay > 0)
+				{
+					// Give other threads the chance to add to the batch,
+					// unless it is full or someone waits for it.
+					Clock start;
+					Poco::UInt64 flushRequests = _flushRequests;
+					while (!_stop && _queuedBytes < _batchBytes && _flushRequests == flushRequests)
+					{
+						long remaining = static_cast<long>(_maxDelay - start.elapsed()/1000);
+						if (remaining <= 0 || !_notEmpty.tryWait(_mutex, remaining)) break;
+					}
+				}
+				std::size_t bytes = 0;
+				while (!_queue.empty() && (batch.empty() || bytes + _queue.front()->frameSize() <= _batchBytes))
+				{
+					bytes += _queue.front()->frameSize();
+					batch.push_back(_queue.front());
+					_queue.pop_front();
+				}
+				_queuedBytes -= bytes;
+				_sending = true;
+			}
+			bool failed = false;
+			std::string error;
+			try
+			{
+				sendBatch(batch);
+			}
+			catch (Poco::Exception& exc)
+			{
+				failed = true;
+				error = exc.displayText();
+			}
+			FastMutex::ScopedLock lock(_mutex);
+			if (failed)
+			{
+				_failed = true;
+				_error = error;
+				_queue.clear();
+				_queuedBytes = 0;
+			}
+			else
+			{
+				_sent += batch.size();
+				++_batches;
+			}
+			batch.clear();
+			_sending = false;
+			_idle.broadcast();
+		}
+		FastMutex::ScopedLock lock(_mutex);
+		_idle.broadcast();
+	}
+
+	void sendBatch(const std::vector<Frame::Ptr>& batch)
+	{
+		bool corked = _cork && batch.size() > 1 && setCork(true);
+		try
+		{
+			for (std::vector<Frame::Ptr>::const_iterator it = batch.begin(); it != batch.end(); ++it)
+			{
+				_pConnection->sendFrame(*it);
+			}
+		}
+		catch (...)
+		{
+			if (corked) setCork(false);
+			throw;
+		}
+		if (corked) setCork(false);
+	}
+
+	bool setCork(bool cork)
+		/// Corks or uncorks the socket, if supported.
+		/// Uncorking sends all pending data.
+	{
+#if defined(TCP_CORK)
+		_pConnection->socket().setOption(IPPROTO_TCP, TCP_CORK, cork ? 1 : 0);
+		return true;
+#elif defined(TCP_NOPUSH)
+		_pConnection->socket().setOption(IPPROTO_TCP, TCP_NOPUSH, cork ? 1 : 0);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+private:
+	FrameSender();
+	FrameSender(const FrameSender&);
+	FrameSender& operator = (const FrameSender&);
+
+	Connection::Ptr _pConnection;
+	std::size_t _batchBytes;
+	long _maxDelay;
+	bool _cork;
+	std::deque<Frame::Ptr> _queue;
+	std::size_t _queuedBytes;
+	bool _sending;
+	bool _stop;
+	bool _failed;
+	std::string _error;
+	Poco::UInt64 _flushRequests;
+	Poco::UInt64 _sent;
+	Poco::UInt64 _batches;
+	Poco::RunnableAdapter<FrameSender> _runnable;
+	Poco::Thread _thread;
+	Condition _notEmpty;
+	Condition _idle;
+	mutable FastMutex _mutex;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_FrameSender_INCLUDED
@@ -0,0 +1,419 @@
+//
+// HeartbeatScheduler.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  HeartbeatScheduler
+//
+// Definition of the HeartbeatScheduler class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_HeartbeatScheduler_INCLUDED
+#define RemotingNG_TCP_HeartbeatScheduler_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/TCP/FrameHandler.h"
+#include "Poco/RemotingNG/TCP/FrameSize.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/TimerWheel.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Clock.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <map>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class HeartbeatScheduler
+	/// HeartbeatScheduler checks the liveness of any number of
+	/// connections from a single periodic timer on a TimerWheel.
+	///
+	/// Connections added to the scheduler are only pinged if no frame
+	/// has been received from the peer within the ping interval, as
+	/// received traffic already proves that the peer is alive. Pings
+	/// due within a quarter of the ping interval are sent together in
+	/// the same tick, so that in a process with many mostly-idle
+	/// connections the CPU and the network link are woken up once
+	/// per round instead of once per connection.
+	///
+	/// Ping interval and idle timeout are taken from a Policy for the
+	/// connection's link class. Connections to a loopback address always
+	/// use the LINK_LOOPBACK policy, all other connections use the policy
+	/// of the current remote link class (see setRemoteLinkClass()), which
+	/// can be set, e.g., from the data path reported by the connection
+	/// manager, so that cellular links are probed less often.
+	///
+	/// The peer's Connection answers PING frames with PONG frames,
+	/// which reset the idle timers on both sides.
+{
+public:
+	enum LinkClass
+	{
+		LINK_LOOPBACK = 0,
+			/// Connections to the local host.
+
+		LINK_LAN,
+			/// Connections over a local network, e.g. WiFi or Ethernet.
+
+		LINK_CELLULAR,
+			/// Connections over a cellular (metered, power-hungry) link.
+
+		LINK_DOWN,
+			/// No data path is available, connections are not pinged.
+
+		LINK_COUNT
+	};
+
+	struct Policy
+		/// The heartbeat parameters for a link class.
+	{
+		Policy():
+			pingInterval(0),
+			idleTimeout(0)
+		{
+		}
+
+		Policy(Poco::Timespan ping, Poco::Timespan idle):
+			pingInterval(ping),
+			idleTimeout(idle)
+		{
+		}
+
+		Poco::Timespan pingInterval;
+			/// Time without received frames after which the connection
+			/// is pinged. Zero disables pings.
+
+		Poco::Timespan idleTimeout;
+			/// Idle timeout set on the connection (see
+			/// Connection::setIdleTimeout()). Zero leaves the
+			/// connection's idle timeout unchanged.
+	};
+
+	struct Statistics
+	{
+		Statistics():
+			pingsSent(0),
+			pingsSaved(0),
+			ticks(0)
+		{
+		}
+
+		Poco::UInt64 pingsSent;
+			/// Number of PING frames sent.
+
+		Poco::UInt64 pingsSaved;
+			/// Number of times a connection was not pinged, because
+			/// a frame had been received within the ping interval.
+
+		Poco::UInt64 ticks;
+			/// Number of scheduler rounds.
+	};
+
+	enum
+	{
+		DEFAULT_TICK = 1000
+			/// Default scheduler tick in milliseconds.
+	};
+
+	explicit HeartbeatScheduler(long tick = DEFAULT_TICK, Poco::TimerWheel& wheel = Poco::TimerWheel::defaultWheel()):
+		_wheel(wheel),
+		_remoteLink(LINK_LAN)
+		/// Creates the HeartbeatScheduler, running every tick
+		/// milliseconds on the given TimerWheel.
+	{
+		_policies[LINK_LOOPBACK] = Policy(Poco::Timespan(15, 0), Poco::Timespan(60, 0));
+		_policies[LINK_LAN]      = Policy(Poco::Timespan(30, 0), Poco::Timespan(120, 0));
+		_policies[LINK_CELLULAR] = Policy(Poco::Timespan(120, 0), Poco::Timespan(600, 0));
+		_policies[LINK_DOWN]     = Policy();
+
+		Poco::AutoPtr<TickTask> pTask = new TickTask(*this);
+		_pTask = pTask;
+		_pTimer = _wheel.scheduleAtFixedRate(pTask, tick, tick, tick/4);
+	}
+
+	~HeartbeatScheduler()
+		/// Destroys the HeartbeatScheduler and removes all connections.
+	{
+		try
+		{
+			_pTask->cancel();
+			_wheel.cancel(_pTimer);
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (EntryMap::iterator it = _entries.begin(); it != _entries.end(); ++it)
+			{
+				it->second.pConnection->popFrameHandler(it->second.pMonitor);
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void add(Connection::Ptr pConnection)
+		/// Adds the connection to the scheduler and applies the
+		/// idle timeout of its link class.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (_entries.find(pConnection->id()) != _entries.end()) return;
+
+		Entry entry;
+		entry.pConnection = pConnection;
+		entry.pMonitor = new Monitor;
+		entry.loopback = pConnection->remoteAddress().host().isLoopback();
+		pConnection->pushFrameHandler(entry.pMonitor);
+		applyIdleTimeout(entry);
+		_entries.insert(EntryMap::value_type(pConnection->id(), entry));
+	}
+
+	void remove(Connection::Ptr pConnection)
+		/// Removes the connection from the scheduler.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		EntryMap::iterator it = _entries.find(pConnection->id());
+		if (it != _entries.end())
+		{
+			pConnection->popFrameHandler(it->second.pMonitor);
+			_entries.erase(it);
+		}
+	}
+
+	void setPolicy(LinkClass link, const Policy& policy)
+		/// Sets the policy for the given link class and applies
+		/// its idle timeout to the affected connections.
+	{
+		poco_assert (link >= 0 && link < LINK_COUNT);
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_policies[link] = policy;
+		applyIdleTimeouts();
+	}
+
+	Policy getPolicy(LinkClass link) const
+		/// Returns the policy for the given link class.
+	{
+		poco_assert (link >= 0 && link < LINK_COUNT);
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _policies[link];
+	}
+
+	void setRemoteLinkClass(LinkClass link)
+		/// Sets the link class of all connections to
+		/// non-loopback addresses.
+	{
+		poco_assert (link >= 0 && link < LINK_COUNT);
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (link != _remoteLink)
+		{
+			_remoteLink = link;
+			applyIdleTimeouts();
+		}
+	}
+
+	LinkClass getRemoteLinkClass() const
+		/// Returns the link class of all connections to
+		/// non-loopback addresses.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _remoteLink;
+	}
+
+	std::size_t count() const
+		/// Returns the number of connections.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _entries.size();
+	}
+
+	Statistics statistics() const
+		/// Returns the scheduler statistics.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _statistics;
+	}
+
+protected:
+	class Monitor: public FrameHandler
+		/// Records that a frame has been received, and passes
+		/// the frame on to the next FrameHandler.
+	{
+	public:
+		typedef Poco::AutoPtr<Monitor> Ptr;
+
+		bool handleFrame(Connection::Ptr, Frame::Ptr)
+		{
+			_received = 1;
+			return false;
+		}
+
+		bool received()
+			/// Returns true if a frame has been received since the
+			/// last call. A frame received concurrently may be
+			/// missed, resulting in one unnecessary ping.
+		{
+			if (_received.value() == 0) return false;
+			_received = 0;
+			return true;
+		}
+
+	private:
+		Poco::AtomicCounter _received;
+	};
+
+	class TickTask: public Poco::RefCountedObject
+	{
+	public:
+		typedef Poco::AutoPtr<TickTask> Ptr;
+
+		explicit TickTask(HeartbeatScheduler& scheduler):
+			_pScheduler(&scheduler)
+		{
+		}
+
+		void run()
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (_pScheduler) _pScheduler->onTick();
+		}
+
+		void cancel()
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_pScheduler = 0;
+		}
+
+		bool isCancelled() const
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			return _pScheduler == 0;
+		}
+
+	private:
+		HeartbeatScheduler* _pScheduler;
+		mutable Poco::FastMutex _mutex;
+	};
+
+	struct Entry
+	{
+		Entry():
+			loopback(false)
+		{
+		}
+
+		Connection::Ptr pConnection;
+		Monitor::Ptr pMonitor;
+		Poco::Clock lastActivity;
+		bool loopback;
+	};
+
+	typedef std::map<Poco::UInt32, Entry> EntryMap;
+
+	const Policy& policyFor(const Entry& entry) const
+	{
+		return _policies[entry.loopback ? LINK_LOOPBACK : _remoteLink];
+	}
+
+	void applyIdleTimeout(Entry& entry)
+	{
+		const Policy& policy = policyFor(entry);
+		if (policy.idleTimeout > 0) entry.pConnection->setIdleTimeout(policy.idleTimeout);
+	}
+
+	void applyIdleTimeouts()
+	{
+		for (EntryMap::iterator it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			applyIdleTimeout(it->second);
+		}
+	}
+
+	void onTick()
+	{
+		std::vector<Connection::Ptr> pending;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			++_statistics.ticks;
+			EntryMap::iterator it = _entries.begin();
+			while (it != _entries.end())
+			{
+				Entry& entry = it->second;
+				Connection::ConnectionState state = entry.pConnection->state();
+				if (state == Connection::STATE_CLOSED || state == Connection::STATE_ABORTED)
+				{
+					entry.pConnection->popFrameHandler(entry.pMonitor);
+					_entries.erase(it++);
+					continue;
+				}
+				const Policy& policy = policyFor(entry);
+				Poco::Clock::ClockDiff interval = policy.pingInterval.totalMicroseconds();
+				bool due = interval > 0 && entry.lastActivity.isElapsed(interval - interval/4);
+				if (entry.pMonitor->received())
+				{
+					if (due) ++_statistics.pingsSaved;
+					entry.lastActivity.update();
+				}
+				else if (due && state == Connection::STATE_ESTABLISHED)
+				{
+					++_statistics.pingsSent;
+					pending.push_back(entry.pConnection);
+					entry.lastActivity.update();
+				}
+				++it;
+			}
+		}
+		for (std::vector<Connection::Ptr>::iterator it = pending.begin(); it != pending.end(); ++it)
+		{
+			ping(**it);
+		}
+	}
+
+	static void ping(Connection& connection)
+	{
+		try
+		{
+			Frame::Ptr pFrame = FrameSize::createFrame(connection, Frame::FRAME_TYPE_PING, 0, 0, 0);
+			pFrame->setPayloadSize(0);
+			connection.sendFrame(pFrame);
+		}
+		catch (Poco::Exception&)
+		{
+		}
+	}
+
+private:
+	HeartbeatScheduler(const HeartbeatScheduler&);
+	HeartbeatScheduler& operator = (const HeartbeatScheduler&);
+
+	Poco::TimerWheel& _wheel;
+	Policy _policies[LINK_COUNT];
+	LinkClass _remoteLink;
+	EntryMap _entries;
+	Statistics _statistics;
+	TickTask::Ptr _pTask;
+	Poco::TimerWheel::Timer::Ptr _pTimer;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_HeartbeatScheduler_INCLUDED
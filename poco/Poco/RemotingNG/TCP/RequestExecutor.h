@@ -0,0 +1,687 @@
+//
+// RequestExecutor.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  RequestExecutor
+//
+// Definition of the RequestExecutor class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_RequestExecutor_INCLUDED
+#define RemotingNG_TCP_RequestExecutor_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/TCP/FrameHandler.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/Listener.h"
+#include "Poco/RemotingNG/TCP/ZeroCopyChannelStream.h"
+#include "Poco/RemotingNG/ServerTransport.h"
+#include "Poco/RemotingNG/BinarySerializer.h"
+#include "Poco/RemotingNG/BinaryDeserializer.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/RemotingNG/ORB.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/NullStream.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Clock.h"
+#include "Poco/Logger.h"
+#include "Poco/Delegate.h"
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <algorithm>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class RequestExecutor
+	/// RequestExecutor executes the requests received by a Listener
+	/// on a fixed number of worker threads, instead of starting a
+	/// thread from the default ThreadPool for every request.
+	///
+	/// Complete requests are admitted to a bounded queue with one
+	/// FIFO per connection. Workers take requests from the connections
+	/// in round-robin order, so a single client sending a burst of
+	/// requests cannot starve the others. A request that exceeds the
+	/// queue capacity, or the capacity for its connection, is rejected
+	/// right away with a fault reply (a TransportException, "Server
+	/// busy"); rejected one-way requests are dropped. Under a request
+	/// storm, clients thus see growing latency and explicit rejections,
+	/// rather than requests failing because no thread is available.
+	///
+	/// The RequestExecutor attaches a FrameHandler to every connection
+	/// accepted by the Listener, taking over requests before they reach
+	/// the Listener's own request handling. Requests with authentication
+	/// tokens or compressed payloads are left to the Listener.
+	///
+	/// Request buffers are recycled, and every worker reuses its
+	/// ServerTransport, including serializer, deserializer, streams and
+	/// reply frame buffer, so that in steady state no allocations are
+	/// made for the transport infrastructure of a request.
+	///
+	/// Usage example:
+	///
+	///     Poco::RemotingNG::TCP::Listener::Ptr pListener = new Poco::RemotingNG::TCP::Listener("localhost:7777");
+	///     Poco::RemotingNG::TCP::RequestExecutor executor(*pListener, 8);
+	///     Poco::RemotingNG::ORB::instance().registerListener(pListener);
+{
+public:
+	struct Statistics
+	{
+		Statistics():
+			admitted(0),
+			rejected(0),
+			completed(0),
+			failed(0),
+			queued(0),
+			maxQueueTime(0)
+		{
+		}
+
+		Poco::UInt64 admitted;
+			/// Number of requests admitted to the queue.
+
+		Poco::UInt64 rejected;
+			/// Number of requests rejected because the queue was full.
+
+		Poco::UInt64 completed;
+			/// Number of requests executed.
+
+		Poco::UInt64 failed;
+			/// Number of requests that failed with an exception.
+
+		std::size_t queued;
+			/// Number of requests currently waiting in the queue.
+
+		Poco::Clock::ClockDiff maxQueueTime;
+			/// Longest time a request waited in the queue, in microseconds.
+	};
+
+	enum
+	{
+		MAX_RECYCLED_SIZE = 65536,
+			/// Request buffers growing beyond this size are not reused.
+
+		DEFAULT_WORKERS = 8,
+		DEFAULT_CAPACITY = 256,
+		DEFAULT_CONNECTION_CAPACITY = 32
+	};
+
+	RequestExecutor(Listener& listener, int workers = DEFAULT_WORKERS, std::size_t capacity = DEFAULT_CAPACITY, std::size_t connectionCapacity = DEFAULT_CONNECTION_CAPACITY):
+		_listener(listener),
+		_capacity(capacity),
+		_connectionCapacity(connectionCapacity),
+		_queued(0),
+		_stopped(false),
+		_logger(Poco::Logger::get("RemotingNG.TCP.RequestExecutor"))
+		/// Creates the RequestExecutor for the given Listener, with the
+		/// given number of worker threads. Up to capacity requests are
+		/// queued in total, and up to connectionCapacity per connection.
+	{
+		poco_assert (workers > 0 && capacity > 0 && connectionCapacity > 0);
+
+		for (int i = 0; i < workers; i++)
+		{
+			Worker* pWorker = new Worker(*this);
+			_workers.push_back(pWorker);
+			pWorker->start();
+		}
+		_listener.connectionAccepted += Poco::delegate(this, &RequestExecutor::onConnectionAccepted);
+	}
+
+	~RequestExecutor()
+		/// Stops the worker threads and destroys the RequestExecutor.
+	{
+		try
+		{
+			stop();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void attach(Connection::Ptr pConnection)
+		/// Attaches the RequestExecutor to a connection. Connections
+		/// accepted by the Listener are attached automatically.
+	{
+		RequestHandler::Ptr pHandler = new RequestHandler(*this);
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (_stopped || _handlers.find(pConnection->id()) != _handlers.end()) return;
+			_handlers[pConnection->id()] = Attachment(pConnection, pHandler);
+		}
+		pConnection->connectionClosed += Poco::delegate(this, &RequestExecutor::onConnectionClosed);
+		pConnection->connectionAborted += Poco::delegate(this, &RequestExecutor::onConnectionClosed);
+		pConnection->pushFrameHandler(pHandler);
+	}
+
+	void stop()
+		/// Detaches the RequestExecutor from all connections, discards
+		/// queued requests and stops the worker threads.
+	{
+		HandlerMap handlers;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (_stopped) return;
+			_stopped = true;
+			handlers.swap(_handlers);
+			_queues.clear();
+			_ready.clear();
+			_queued = 0;
+			_available.broadcast();
+		}
+		_listener.connectionAccepted -= Poco::delegate(this, &RequestExecutor::onConnectionAccepted);
+		for (HandlerMap::iterator it = handlers.begin(); it != handlers.end(); ++it)
+		{
+			detach(it->second);
+		}
+		for (std::vector<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+		{
+			(*it)->join();
+			delete *it;
+		}
+		_workers.clear();
+	}
+
+	Statistics statistics() const
+		/// Returns the executor statistics.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Statistics result = _statistics;
+		result.queued = _queued;
+		return result;
+	}
+
+protected:
+	class Request: public Poco::RefCountedObject
+		/// A complete request received on a connection.
+	{
+	public:
+		typedef Poco::AutoPtr<Request> Ptr;
+
+		Request():
+			channel(0),
+			oneWay(false)
+		{
+		}
+
+		void assign(Connection::Ptr pConn, Poco::UInt32 chan, bool ow)
+		{
+			pConnection = pConn;
+			channel = chan;
+			oneWay = ow;
+			data.clear();
+		}
+
+		Connection::Ptr pConnection;
+		Poco::UInt32 channel;
+		bool oneWay;
+		std::vector<char> data;
+		Poco::Clock admitted;
+	};
+
+	class RequestStreamBuf: public std::streambuf
+		/// A streambuf reading from a request buffer.
+	{
+	public:
+		void reset(const char* pData, std::size_t size)
+		{
+			char* p = const_cast<char*>(pData);
+			setg(p, p, p + size);
+		}
+	};
+
+	class RequestServerTransport: public Poco::RemotingNG::ServerTransport
+		/// The ServerTransport of a worker, reading the request from
+		/// memory and sending the reply as REPL frames.
+		///
+		/// The transport, its streams, serializer, deserializer and
+		/// reply frame buffer are reused for all requests executed
+		/// by the worker.
+		///
+		/// Requests executed by the RequestExecutor do not carry
+		/// authentication tokens, so authenticate() and authorize()
+		/// always fail.
+	{
+	public:
+		RequestServerTransport():
+			_pRequest(0),
+			_replied(false),
+			_replying(false),
+			_requestStream(&_requestBuf),
+			_replyStream(&_replyBuf)
+		{
+		}
+
+		void setup(Request& request, std::string& oid, std::string& tid)
+		{
+			_pRequest = &request;
+			_replied = false;
+			_requestBuf.reset(request.data.empty() ? "" : &request.data[0], request.data.size());
+			_requestStream.clear();
+			_deserializer.setup(_requestStream);
+			_deserializer.deserializeEndPoint(oid, tid);
+		}
+
+		bool replied() const
+		{
+			return _replied;
+		}
+
+		void fault(Poco::Exception& exc)
+		{
+			std::string name;
+			try
+			{
+				_deserializer.findMessage(name);
+			}
+			catch (Poco::Exception&)
+			{
+			}
+			Serializer& ser = sendReply(SerializerBase::MESSAGE_FAULT);
+			ser.serializeFaultMessage(name, exc);
+			endRequest();
+		}
+
+		void finish()
+		{
+			endRequest();
+			_requestBuf.reset("", 0);
+			_pRequest = 0;
+		}
+
+		// ServerTransport
+		bool authenticate(const std::string&)
+		{
+			return false;
+		}
+
+		bool authorize(const std::string&, const std::string&)
+		{
+			return false;
+		}
+
+		Deserializer& beginRequest()
+		{
+			return _deserializer;
+		}
+
+		Serializer& sendReply(SerializerBase::MessageType)
+		{
+			_replied = true;
+			if (_pRequest->oneWay)
+			{
+				_serializer.setup(_nullStream);
+			}
+			else
+			{
+				_replyBuf.reset(_pRequest->pConnection, Frame::FRAME_TYPE_REPL, _pRequest->channel, 0);
+				_replyStream.clear();
+				_replying = true;
+				_serializer.setup(_replyStream);
+			}
+			return _serializer;
+		}
+
+		void endRequest()
+		{
+			if (_replying)
+			{
+				_replying = false;
+				_replyBuf.close();
+			}
+		}
+
+	private:
+		Request* _pRequest;
+		bool _replied;
+		bool _replying;
+		RequestStreamBuf _requestBuf;
+		std::istream _requestStream;
+		ZeroCopyChannelStreamBuf _replyBuf;
+		std::ostream _replyStream;
+		Poco::NullOutputStream _nullStream;
+		Poco::RemotingNG::BinarySerializer _serializer;
+		Poco::RemotingNG::BinaryDeserializer _deserializer;
+	};
+
+	class RequestHandler: public FrameHandler
+		/// Collects the frames of requests on a connection.
+		///
+		/// Only called by the connection's thread.
+	{
+	public:
+		typedef Poco::AutoPtr<RequestHandler> Ptr;
+
+		explicit RequestHandler(RequestExecutor& executor):
+			_executor(executor)
+		{
+		}
+
+		bool handleFrame(Connection::Ptr pConnection, Frame::Ptr pFrame)
+		{
+			if (pFrame->type() != Frame::FRAME_TYPE_REQU) return false;
+
+			Poco::UInt32 channel = pFrame->channel();
+			Poco::UInt16 flags = pFrame->flags();
+			bool eom = (flags & Frame::FRAME_FLAG_EOM) != 0;
+			if ((flags & Frame::FRAME_FLAG_CONT) == 0)
+			{
+				if (flags & (Frame::FRAME_FLAG_AUTH | Frame::FRAME_FLAG_DEFLATE | Frame::FRAME_FLAG_CODEC))
+				{
+					if (!eom) _bypassed.insert(channel);
+					return false;
+				}
+				Request::Ptr pRequest = _executor.acquire();
+				pRequest->assign(pConnection, channel, (flags & Frame::FRAME_FLAG_ONEWAY) != 0);
+				RequestVec::iterator it = find(channel);
+				if (it != _pending.end())
+					it->second = pRequest;
+				else
+					_pending.push_back(RequestVec::value_type(channel, pRequest));
+			}
+			else if (_bypassed.find(channel) != _bypassed.end())
+			{
+				if (eom) _bypassed.erase(channel);
+				return false;
+			}
+
+			RequestVec::iterator it = find(channel);
+			if (it == _pending.end()) return false;
+			Request::Ptr pRequest = it->second;
+			pRequest->data.insert(pRequest->data.end(), pFrame->payloadBegin(), pFrame->payloadEnd());
+			pConnection->returnFrame(pFrame);
+			if (eom)
+			{
+				_pending.erase(it);
+				_executor.submit(pRequest);
+			}
+			return true;
+		}
+
+	private:
+		typedef std::vector<std::pair<Poco::UInt32, Request::Ptr> > RequestVec;
+
+		RequestVec::iterator find(Poco::UInt32 channel)
+		{
+			RequestVec::iterator it = _pending.begin();
+			while (it != _pending.end() && it->first != channel) ++it;
+			return it;
+		}
+
+		RequestExecutor& _executor;
+		RequestVec _pending;
+			/// Requests being received; usually only a few, so a
+			/// vector avoids allocating a node per request.
+		std::set<Poco::UInt32> _bypassed;
+	};
+
+	class Worker: public Poco::Runnable
+	{
+	public:
+		explicit Worker(RequestExecutor& executor):
+			_executor(executor)
+		{
+		}
+
+		void start()
+		{
+			_thread.start(*this);
+		}
+
+		void join()
+		{
+			_thread.join();
+		}
+
+		void run()
+		{
+			Request::Ptr pRequest;
+			while ((pRequest = _executor.next()))
+			{
+				_executor.execute(*pRequest, _transport);
+				_executor.recycle(pRequest);
+			}
+		}
+
+	private:
+		RequestExecutor& _executor;
+		RequestServerTransport _transport;
+		Poco::Thread _thread;
+	};
+
+	struct Attachment
+	{
+		Attachment()
+		{
+		}
+
+		Attachment(Connection::Ptr pConn, RequestHandler::Ptr pH):
+			pConnection(pConn),
+			pHandler(pH)
+		{
+		}
+
+		Connection::Ptr pConnection;
+		RequestHandler::Ptr pHandler;
+	};
+
+	typedef std::deque<Request::Ptr> RequestQueue;
+	typedef std::map<Poco::UInt32, RequestQueue> QueueMap;
+	typedef std::map<Poco::UInt32, Attachment> HandlerMap;
+
+	void submit(Request::Ptr pRequest)
+		/// Admits the request to the queue of its connection,
+		/// or rejects it.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (!_stopped && _queued < _capacity)
+			{
+				RequestQueue& queue = _queues[pRequest->pConnection->id()];
+				if (queue.size() < _connectionCapacity)
+				{
+					if (queue.empty()) _ready.push_back(pRequest->pConnection->id());
+					queue.push_back(pRequest);
+					pRequest->admitted.update();
+					++_queued;
+					++_statistics.admitted;
+					_available.signal();
+					return;
+				}
+			}
+			++_statistics.rejected;
+		}
+		reject(*pRequest);
+		recycle(pRequest);
+	}
+
+	Request::Ptr next()
+		/// Waits for the next request, taking connections in turn.
+		/// Returns null if the executor has been stopped.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		while (_ready.empty() && !_stopped) _available.wait(_mutex);
+		if (_stopped) return Request::Ptr();
+
+		Poco::UInt32 id = _ready.front();
+		_ready.pop_front();
+		QueueMap::iterator it = _queues.find(id);
+		Request::Ptr pRequest = it->second.front();
+		it->second.pop_front();
+		if (!it->second.empty()) _ready.push_back(id);
+		--_queued;
+		Poco::Clock::ClockDiff queueTime = pRequest->admitted.elapsed();
+		if (queueTime > _statistics.maxQueueTime) _statistics.maxQueueTime = queueTime;
+		return pRequest;
+	}
+
+	void execute(Request& request, RequestServerTransport& transport)
+		/// Executes the request through the ORB.
+	{
+		bool failed = false;
+		try
+		{
+			std::string oid;
+			std::string tid;
+			transport.setup(request, oid, tid);
+			std::string uri = _listener.createURI(tid, oid);
+			if (!Poco::RemotingNG::ORB::instance().invoke(_listener, uri, transport))
+			{
+				UnknownObjectException exc(uri);
+				transport.fault(exc);
+			}
+		}
+		catch (Poco::Exception& exc)
+		{
+			failed = true;
+			_logger.error("Request failed: " + exc.displayText());
+			try
+			{
+				if (!transport.replied() && !request.oneWay) transport.fault(exc);
+			}
+			catch (Poco::Exception&)
+			{
+			}
+		}
+		transport.finish();
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		++_statistics.completed;
+		if (failed) ++_statistics.failed;
+	}
+
+	void reject(Request& request)
+		/// Sends a fault reply for a rejected request.
+	{
+		if (request.oneWay) return;
+
+		Poco::FastMutex::ScopedLock lock(_rejectMutex);
+		try
+		{
+			std::string oid;
+			std::string tid;
+			_rejectTransport.setup(request, oid, tid);
+			TransportException exc("Server busy");
+			_rejectTransport.fault(exc);
+		}
+		catch (Poco::Exception& exc)
+		{
+			_logger.error("Failed to reject request: " + exc.displayText());
+		}
+		_rejectTransport.finish();
+	}
+
+	Request::Ptr acquire()
+		/// Returns a recycled Request, or a new one.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_poolMutex);
+			if (!_pool.empty())
+			{
+				Request::Ptr pRequest = _pool.back();
+				_pool.pop_back();
+				return pRequest;
+			}
+		}
+		return new Request;
+	}
+
+	void recycle(Request::Ptr pRequest)
+		/// Returns a Request that is no longer used for reuse,
+		/// keeping its buffer unless it has grown too large.
+	{
+		pRequest->pConnection = 0;
+		if (pRequest->data.capacity() > MAX_RECYCLED_SIZE)
+		{
+			std::vector<char> empty;
+			pRequest->data.swap(empty);
+		}
+		Poco::FastMutex::ScopedLock lock(_poolMutex);
+		if (_pool.size() < _capacity + _workers.size()) _pool.push_back(pRequest);
+	}
+
+	void detach(const Attachment& attachment)
+	{
+		Connection::Ptr pConnection = attachment.pConnection;
+		pConnection->popFrameHandler(attachment.pHandler);
+		pConnection->connectionClosed -= Poco::delegate(this, &RequestExecutor::onConnectionClosed);
+		pConnection->connectionAborted -= Poco::delegate(this, &RequestExecutor::onConnectionClosed);
+	}
+
+	void onConnectionAccepted(const void*, Connection::Ptr& pConnection)
+	{
+		attach(pConnection);
+	}
+
+	void onConnectionClosed(const void*, Connection::Ptr& pConnection)
+	{
+		Attachment attachment;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			HandlerMap::iterator it = _handlers.find(pConnection->id());
+			if (it == _handlers.end()) return;
+			attachment = it->second;
+			_handlers.erase(it);
+
+			// requests of a closed connection cannot be replied to
+			QueueMap::iterator itQueue = _queues.find(pConnection->id());
+			if (itQueue != _queues.end())
+			{
+				_queued -= itQueue->second.size();
+				_queues.erase(itQueue);
+				_ready.erase(std::remove(_ready.begin(), _ready.end(), pConnection->id()), _ready.end());
+			}
+		}
+		detach(attachment);
+	}
+
+private:
+	RequestExecutor(const RequestExecutor&);
+	RequestExecutor& operator = (const RequestExecutor&);
+
+	Listener& _listener;
+	std::size_t _capacity;
+	std::size_t _connectionCapacity;
+	std::size_t _queued;
+	bool _stopped;
+	std::vector<Worker*> _workers;
+	QueueMap _queues;
+	std::deque<Poco::UInt32> _ready;
+	HandlerMap _handlers;
+	Statistics _statistics;
+	std::vector<Request::Ptr> _pool;
+	RequestServerTransport _rejectTransport;
+	Poco::Logger& _logger;
+	Poco::Condition _available;
+	mutable Poco::FastMutex _mutex;
+	Poco::FastMutex _poolMutex;
+	Poco::FastMutex _rejectMutex;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_RequestExecutor_INCLUDED
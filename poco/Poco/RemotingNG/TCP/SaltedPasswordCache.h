@@ -0,0 +1,128 @@
+//
+// SaltedPasswordCache.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  SaltedPasswordCache
+//
+// Definition of the SaltedPasswordCache class.
+//
+// Copyright (c) 2017, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_SaltedPasswordCache_INCLUDED
+#define RemotingNG_TCP_SaltedPasswordCache_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/PBKDF2Engine.h"
+#include "Poco/HMACEngine.h"
+#include "Poco/SHA1Engine.h"
+#include "Poco/DigestEngine.h"
+#include "Poco/LRUCache.h"
+#include "Poco/RandomStream.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/SingletonHolder.h"
+#include <string>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class SaltedPasswordCache
+	/// A cache of PBKDF2-HMAC-SHA1 salted passwords, as used by SCRAM-SHA-1.
+	///
+	/// Deriving a salted password takes thousands of HMAC iterations,
+	/// and is repeated for every connection that is authenticated with
+	/// the same password, salt and iteration count. The cache keeps the
+	/// derivations of recently used passwords. Passwords are not stored,
+	/// entries are keyed with an HMAC of password, salt and iteration
+	/// count, using a random key generated for every cache instance.
+	///
+	/// SaltedPasswordCache is thread-safe.
+{
+public:
+	enum
+	{
+		DEFAULT_SIZE = 256
+	};
+
+	explicit SaltedPasswordCache(long size = DEFAULT_SIZE):
+		_cache(size)
+		/// Creates the SaltedPasswordCache, holding up to
+		/// the given number of derivations.
+	{
+		Poco::RandomInputStream random;
+		char key[20];
+		random.read(key, sizeof(key));
+		_key.assign(key, sizeof(key));
+	}
+
+	~SaltedPasswordCache()
+		/// Destroys the SaltedPasswordCache.
+	{
+	}
+
+	std::string saltedPassword(const std::string& password, const std::string& salt, int iterations)
+		/// Returns the raw bytes of PBKDF2-HMAC-SHA1(password, salt, iterations),
+		/// deriving it if it is not cached.
+	{
+		std::string key = keyOf(password, salt, iterations);
+		Poco::SharedPtr<std::string> pCached = _cache.get(key);
+		if (pCached) return *pCached;
+
+		Poco::PBKDF2Engine<Poco::HMACEngine<Poco::SHA1Engine> > pbkdf2(salt, static_cast<unsigned>(iterations));
+		pbkdf2.update(password);
+		const Poco::DigestEngine::Digest& digest = pbkdf2.digest();
+		std::string result(digest.begin(), digest.end());
+		_cache.add(key, result);
+		return result;
+	}
+
+	void clear()
+		/// Removes all cached derivations.
+	{
+		_cache.clear();
+	}
+
+	static SaltedPasswordCache& defaultCache()
+		/// Returns the process-wide SaltedPasswordCache.
+	{
+		static Poco::SingletonHolder<SaltedPasswordCache> sh;
+		return *sh.get();
+	}
+
+protected:
+	std::string keyOf(const std::string& password, const std::string& salt, int iterations) const
+	{
+		Poco::HMACEngine<Poco::SHA1Engine> hmac(_key);
+		hmac.update(password);
+		hmac.update('\0');
+		hmac.update(salt);
+		hmac.update('\0');
+		hmac.update(Poco::NumberFormatter::format(iterations));
+		const Poco::DigestEngine::Digest& digest = hmac.digest();
+		return std::string(digest.begin(), digest.end());
+	}
+
+private:
+	SaltedPasswordCache(const SaltedPasswordCache&);
+	SaltedPasswordCache& operator = (const SaltedPasswordCache&);
+
+	std::string _key;
+	Poco::LRUCache<std::string, std::string> _cache;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_SaltedPasswordCache_INCLUDED
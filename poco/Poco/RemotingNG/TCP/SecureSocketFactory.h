@@ -0,0 +1,167 @@
+//
+// SecureSocketFactory.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  SecureSocketFactory
+//
+// Definition of the SecureSocketFactory class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_SecureSocketFactory_INCLUDED
+#define RemotingNG_TCP_SecureSocketFactory_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/SocketFactory.h"
+#include "Poco/Net/TLSSessionCache.h"
+#include "Poco/Net/SecureStreamSocket.h"
+#include "Poco/Net/SSLManager.h"
+#include "Poco/Net/Context.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/DNSCache.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/Net/InterfaceBinder.h"
+#include "Poco/Mutex.h"
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class SecureSocketFactory: public SocketFactory
+	/// A SocketFactory creating Poco::Net::SecureStreamSocket objects
+	/// for "remoting.tcps" URIs, and plain Poco::Net::StreamSocket
+	/// objects for all other URIs.
+	///
+	/// TLS sessions are kept in a Poco::Net::TLSSessionCache (by default,
+	/// the framework-wide one, shared with HTTPSessionPool), so that
+	/// reconnecting to a server resumes the TLS session instead of doing
+	/// a full handshake. Host names are resolved through a Poco::Net::DNSCache.
+	///
+	/// Sockets can be bound to a network interface with setInterface().
+	/// When the network path changes, setInterface() or interrupt() shut
+	/// down all connections created over the previous path, so that the
+	/// Connection objects using them fail immediately and the
+	/// ConnectionManager creates new connections for subsequent requests.
+	///
+	/// The Listener on the server should use a SecureServerSocket with
+	/// a Context configured with TLSSessionCache::configureServer().
+{
+public:
+	typedef Poco::AutoPtr<SecureSocketFactory> Ptr;
+
+	explicit SecureSocketFactory(Poco::Net::Context::Ptr pContext = 0,
+		Poco::Net::TLSSessionCache& sessionCache = Poco::Net::TLSSessionCache::defaultCache(),
+		Poco::Net::DNSCache& dnsCache = Poco::Net::DNSCache::defaultCache()):
+		_pContext(pContext),
+		_sessionCache(sessionCache),
+		_dnsCache(dnsCache)
+		/// Creates the SecureSocketFactory, using the given Context,
+		/// or the default client Context of the SSLManager if none
+		/// is given.
+	{
+	}
+
+	~SecureSocketFactory()
+		/// Destroys the SecureSocketFactory.
+	{
+	}
+
+	Poco::Net::StreamSocket createSocket(const Poco::URI& uri)
+	{
+		Poco::Net::StreamSocket socket = connect(uri);
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		std::vector<Poco::Net::StreamSocket>::iterator it = _sockets.begin();
+		while (it != _sockets.end())
+		{
+			if (it->impl()->sockfd() == POCO_INVALID_SOCKET)
+				it = _sockets.erase(it);
+			else
+				++it;
+		}
+		_sockets.push_back(socket);
+		return socket;
+	}
+
+	void setInterface(const Poco::Net::InterfaceBinder& binder)
+		/// Sets the network interface that new sockets are bound to,
+		/// and interrupts all connections created before (see interrupt()).
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_binder = binder;
+		}
+		interrupt();
+	}
+
+	Poco::Net::InterfaceBinder getInterface() const
+		/// Returns the network interface that new sockets are bound to.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _binder;
+	}
+
+	void interrupt()
+		/// Shuts down all connections created by the SecureSocketFactory
+		/// that have not been closed yet, with Poco::Net::InterfaceBinder::interrupt().
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (std::vector<Poco::Net::StreamSocket>::iterator it = _sockets.begin(); it != _sockets.end(); ++it)
+		{
+			Poco::Net::InterfaceBinder::interrupt(*it);
+		}
+		_sockets.clear();
+	}
+
+protected:
+	Poco::Net::StreamSocket connect(const Poco::URI& uri)
+		/// Connects a socket to one of the addresses of the URI's host.
+	{
+		Poco::Net::InterfaceBinder binder = getInterface();
+		Poco::Net::HostEntry entry = _dnsCache.resolve(uri.getHost());
+		const Poco::Net::HostEntry::AddressList& addresses = entry.addresses();
+		if (addresses.empty()) throw Poco::Net::HostNotFoundException(uri.getHost());
+		for (Poco::Net::HostEntry::AddressList::const_iterator it = addresses.begin();; ++it)
+		{
+			try
+			{
+				Poco::Net::SocketAddress address(*it, uri.getPort());
+				if (uri.getScheme() == "remoting.tcps")
+				{
+					Poco::Net::Context::Ptr pContext = _pContext ? _pContext : Poco::Net::SSLManager::instance().defaultClientContext();
+					return _sessionCache.connect(address, uri.getHost(), pContext, binder);
+				}
+				else return binder.connect(address);
+			}
+			catch (Poco::Net::NetException&)
+			{
+				if (it + 1 == addresses.end()) throw;
+			}
+		}
+	}
+
+private:
+	Poco::Net::Context::Ptr _pContext;
+	Poco::Net::TLSSessionCache& _sessionCache;
+	Poco::Net::DNSCache& _dnsCache;
+	Poco::Net::InterfaceBinder _binder;
+	std::vector<Poco::Net::StreamSocket> _sockets;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_SecureSocketFactory_INCLUDED
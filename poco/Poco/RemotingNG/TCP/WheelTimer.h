@@ -0,0 +1,143 @@
+//
+// WheelTimer.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  WheelTimer
+//
+// Definition of the WheelTimer class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_WheelTimer_INCLUDED
+#define RemotingNG_TCP_WheelTimer_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Timer.h"
+#include "Poco/TimerWheel.h"
+#include "Poco/Mutex.h"
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class WheelTimer
+	/// A WheelTimer has the interface of Timer, but schedules its
+	/// tasks on a TimerWheel instead of running its own thread.
+	///
+	/// By default, all WheelTimer objects share the default
+	/// TimerWheel, together with Util::WheelTimer, so the
+	/// connection keep-alive timers of all transports are
+	/// served by a single thread.
+	///
+	/// With a slack, tasks may run up to the given number of
+	/// milliseconds late, so that the wheel can serve tasks with
+	/// similar deadlines with a single wakeup.
+{
+public:
+	explicit WheelTimer(long slack = 0);
+		/// Creates the WheelTimer, using the default TimerWheel.
+
+	WheelTimer(Poco::TimerWheel& wheel, long slack = 0);
+		/// Creates the WheelTimer, using the given TimerWheel.
+
+	~WheelTimer();
+		/// Destroys the WheelTimer, cancelling all pending tasks.
+
+	void cancel(bool wait = false);
+		/// Cancels all pending tasks.
+		///
+		/// If a task is currently running, it is allowed to finish.
+		/// If wait is true, waits until it has finished.
+
+	void scheduleAtFixedRate(TimerTask::Ptr pTask, long delay, long interval);
+		/// Schedules a task for periodic execution at a fixed rate.
+		///
+		/// The task is first executed after the given delay.
+		/// Subsequently, the task is executed periodically
+		/// every number of milliseconds specified by interval.
+
+private:
+	WheelTimer(const WheelTimer&);
+	WheelTimer& operator = (const WheelTimer&);
+
+	Poco::TimerWheel& _wheel;
+	long _slack;
+	std::vector<Poco::TimerWheel::Timer::Ptr> _timers;
+	Poco::FastMutex _mutex;
+};
+
+
+//
+// inlines
+//
+inline WheelTimer::WheelTimer(long slack):
+	_wheel(Poco::TimerWheel::defaultWheel()),
+	_slack(slack)
+{
+}
+
+
+inline WheelTimer::WheelTimer(Poco::TimerWheel& wheel, long slack):
+	_wheel(wheel),
+	_slack(slack)
+{
+}
+
+
+inline WheelTimer::~WheelTimer()
+{
+	try
+	{
+		cancel(true);
+	}
+	catch (...)
+	{
+		poco_unexpected();
+	}
+}
+
+
+inline void WheelTimer::cancel(bool)
+{
+	std::vector<Poco::TimerWheel::Timer::Ptr> timers;
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		timers.swap(_timers);
+	}
+	for (std::vector<Poco::TimerWheel::Timer::Ptr>::iterator it = timers.begin(); it != timers.end(); ++it)
+	{
+		_wheel.cancel(*it);
+	}
+}
+
+
+inline void WheelTimer::scheduleAtFixedRate(TimerTask::Ptr pTask, long delay, long interval)
+{
+	Poco::TimerWheel::Timer::Ptr pTimer = _wheel.scheduleAtFixedRate(pTask, delay, interval, _slack);
+	Poco::FastMutex::ScopedLock lock(_mutex);
+	std::vector<Poco::TimerWheel::Timer::Ptr>::iterator it = _timers.begin();
+	while (it != _timers.end())
+	{
+		if ((*it)->isScheduled()) ++it;
+		else it = _timers.erase(it);
+	}
+	_timers.push_back(pTimer);
+}
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_WheelTimer_INCLUDED
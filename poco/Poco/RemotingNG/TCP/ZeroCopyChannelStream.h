@@ -0,0 +1,295 @@
+//
+// ZeroCopyChannelStream.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  ZeroCopyChannelStream
+//
+// Definition of the ZeroCopyChannelStreamBuf, ZeroCopyChannelInputStream
+// and ZeroCopyChannelOutputStream classes.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_ZeroCopyChannelStream_INCLUDED
+#define RemotingNG_TCP_ZeroCopyChannelStream_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/FrameQueue.h"
+#include "Poco/RemotingNG/TCP/FrameSize.h"
+#include "Poco/Timespan.h"
+#include "Poco/ByteOrder.h"
+#include "Poco/Exception.h"
+#include <streambuf>
+#include <istream>
+#include <ostream>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class ZeroCopyChannelStreamBuf: public std::streambuf
+	/// A streambuf for reading from and writing to channels,
+	/// like ChannelStreamBuf, but without an intermediate buffer.
+	///
+	/// When reading, the payload of the current frame is the get area,
+	/// and the frame is returned to the Connection's frame pool as soon
+	/// as it has been consumed. When writing, the payload buffer of the
+	/// frame to be sent is the put area, and the frame is sent when it
+	/// is full, on sync() and on close().
+	///
+	/// Connection::sendFrame() sends the frame before it returns, so a
+	/// single frame buffer is reused for all frames of a message.
+{
+public:
+	ZeroCopyChannelStreamBuf(Connection::Ptr pConnection, Poco::UInt32 frameType, Poco::UInt32 channel, Poco::Timespan timeout):
+		_pConnection(pConnection),
+		_flags(0),
+		_timeout(timeout),
+		_eom(false),
+		_sent(false),
+		_closed(false)
+		/// Creates a ZeroCopyChannelStreamBuf for reading
+		/// the frames of the given type and channel.
+	{
+		_pQueue = new FrameQueue(pConnection, frameType, channel);
+		_pConnection->pushFrameHandler(_pQueue);
+	}
+
+	ZeroCopyChannelStreamBuf(Connection::Ptr pConnection, Poco::UInt32 frameType, Poco::UInt32 channel, Poco::UInt16 flags):
+		_pConnection(pConnection),
+		_flags(flags),
+		_eom(false),
+		_sent(false),
+		_closed(false)
+		/// Creates a ZeroCopyChannelStreamBuf for writing frames
+		/// of the given type and channel with the given flags.
+	{
+		_pFrame = FrameSize::createFrame(*_pConnection, frameType, channel, flags, FrameSize::maxPayloadSize(*_pConnection));
+		setp(_pFrame->payloadBegin(), _pFrame->payloadBegin() + _pFrame->maxPayloadSize());
+	}
+
+	ZeroCopyChannelStreamBuf():
+		_flags(0),
+		_eom(false),
+		_sent(false),
+		_closed(true)
+		/// Creates a ZeroCopyChannelStreamBuf for writing,
+		/// which must be set up with reset() before use.
+	{
+	}
+
+	~ZeroCopyChannelStreamBuf()
+		/// Destroys the ZeroCopyChannelStreamBuf.
+		///
+		/// When writing, sends the last frame of the message,
+		/// unless close() has been called.
+	{
+		try
+		{
+			close();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void close()
+		/// When writing, sends the last frame of the message, with
+		/// the FRAME_FLAG_EOM flag set. When reading, removes the
+		/// FrameQueue from the Connection.
+	{
+		if (_closed) return;
+		_closed = true;
+		if (_pQueue)
+		{
+			_pConnection->popFrameHandler(_pQueue);
+			if (_pFrame) _pConnection->returnFrame(_pFrame);
+			_pFrame = 0;
+			setg(0, 0, 0);
+		}
+		else
+		{
+			sendFrame(Frame::FRAME_FLAG_EOM);
+		}
+	}
+
+	void reset(Connection::Ptr pConnection, Poco::UInt32 frameType, Poco::UInt32 channel, Poco::UInt16 flags)
+		/// Prepares a closed ZeroCopyChannelStreamBuf for writing
+		/// the next message, with the given frame type, channel
+		/// and flags, possibly on a different connection.
+		///
+		/// The frame buffer is kept if its size fits the connection.
+	{
+		poco_assert (!_pQueue && _closed);
+
+		_pConnection = pConnection;
+		std::size_t maxPayload = FrameSize::maxPayloadSize(*pConnection);
+		if (_pFrame && _pFrame->maxPayloadSize() == maxPayload)
+		{
+			// Frame type and channel are the first two header fields,
+			// in network byte order (see Frame).
+			char* pHeader = _pFrame->bufferBegin();
+			*reinterpret_cast<Poco::UInt32*>(pHeader) = Poco::ByteOrder::toNetwork(frameType);
+			*reinterpret_cast<Poco::UInt32*>(pHeader + 4) = Poco::ByteOrder::toNetwork(channel);
+		}
+		else
+		{
+			_pFrame = FrameSize::createFrame(*pConnection, frameType, channel, flags, maxPayload);
+		}
+		_flags = flags;
+		_sent = false;
+		_closed = false;
+		setp(_pFrame->payloadBegin(), _pFrame->payloadBegin() + _pFrame->maxPayloadSize());
+	}
+
+	FrameQueue::Ptr queue()
+		/// Returns the FrameQueue, if reading.
+	{
+		return _pQueue;
+	}
+
+	Connection::Ptr connection()
+		/// Returns the Connection.
+	{
+		return _pConnection;
+	}
+
+protected:
+	int_type underflow()
+	{
+		if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+		if (!_pQueue) return traits_type::eof();
+		if (_pFrame)
+		{
+			_pConnection->returnFrame(_pFrame);
+			_pFrame = 0;
+			setg(0, 0, 0);
+		}
+		while (!_eom)
+		{
+			Frame::Ptr pFrame = _pQueue->dequeueFrame(_timeout);
+			if (!pFrame) throw Poco::TimeoutException("Timeout waiting for frame");
+			_eom = (pFrame->flags() & Frame::FRAME_FLAG_EOM) != 0;
+			if (pFrame->getPayloadSize() > 0)
+			{
+				_pFrame = pFrame;
+				setg(_pFrame->payloadBegin(), _pFrame->payloadBegin(), _pFrame->payloadEnd());
+				return traits_type::to_int_type(*gptr());
+			}
+			_pConnection->returnFrame(pFrame);
+		}
+		return traits_type::eof();
+	}
+
+	int_type overflow(int_type c)
+	{
+		if (_pQueue || _closed) return traits_type::eof();
+		sendFrame(0);
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	int sync()
+	{
+		if (!_pQueue && !_closed && pptr() > pbase()) sendFrame(0);
+		return 0;
+	}
+
+	void sendFrame(Poco::UInt16 flags)
+	{
+		flags |= _flags;
+		if (_sent) flags |= Frame::FRAME_FLAG_CONT;
+		_pFrame->updateFlags(flags);
+		_pFrame->setPayloadSize(static_cast<Poco::UInt16>(pptr() - pbase()));
+		_sent = true;
+		setp(_pFrame->payloadBegin(), _pFrame->payloadBegin() + _pFrame->maxPayloadSize());
+		_pConnection->sendFrame(_pFrame);
+	}
+
+private:
+	ZeroCopyChannelStreamBuf(const ZeroCopyChannelStreamBuf&);
+	ZeroCopyChannelStreamBuf& operator = (const ZeroCopyChannelStreamBuf&);
+
+	Connection::Ptr _pConnection;
+	FrameQueue::Ptr _pQueue;
+	Frame::Ptr _pFrame;
+	Poco::UInt16 _flags;
+	Poco::Timespan _timeout;
+	bool _eom;
+	bool _sent;
+	bool _closed;
+};
+
+
+class ZeroCopyChannelInputStream: public std::istream
+	/// Stream for reading from a Connection channel,
+	/// using a ZeroCopyChannelStreamBuf.
+{
+public:
+	ZeroCopyChannelInputStream(Connection::Ptr pConnection, Poco::UInt32 frameType, Poco::UInt32 channel, Poco::Timespan timeout):
+		std::istream(0),
+		_buf(pConnection, frameType, channel, timeout)
+	{
+		rdbuf(&_buf);
+	}
+
+	~ZeroCopyChannelInputStream()
+	{
+	}
+
+	void close()
+	{
+		_buf.close();
+	}
+
+private:
+	ZeroCopyChannelStreamBuf _buf;
+};
+
+
+class ZeroCopyChannelOutputStream: public std::ostream
+	/// Stream for writing to a Connection channel,
+	/// using a ZeroCopyChannelStreamBuf.
+{
+public:
+	ZeroCopyChannelOutputStream(Connection::Ptr pConnection, Poco::UInt32 frameType, Poco::UInt32 channel, Poco::UInt16 flags):
+		std::ostream(0),
+		_buf(pConnection, frameType, channel, flags)
+	{
+		rdbuf(&_buf);
+	}
+
+	~ZeroCopyChannelOutputStream()
+	{
+	}
+
+	void close()
+	{
+		_buf.close();
+	}
+
+private:
+	ZeroCopyChannelStreamBuf _buf;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_ZeroCopyChannelStream_INCLUDED
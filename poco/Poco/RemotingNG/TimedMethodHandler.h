@@ -0,0 +1,171 @@
+//
+// TimedMethodHandler.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: ORB
+// Module:  TimedMethodHandler
+//
+// Definition of the TimedMethodHandler class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TimedMethodHandler_INCLUDED
+#define RemotingNG_TimedMethodHandler_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/MethodHandler.h"
+#include "Poco/RemotingNG/MethodStatistics.h"
+#include "Poco/RemotingNG/ServerTransport.h"
+#include "Poco/Tracer.h"
+#include "Poco/Clock.h"
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class TimedMethodHandler: public MethodHandler
+	/// A MethodHandler that measures the calls handled by the
+	/// MethodHandler it wraps, and records them with MethodStatistics
+	/// (side SIDE_SERVER).
+	///
+	/// The time until the wrapped MethodHandler calls sendReply() is
+	/// recorded as PHASE_INVOKE (including the deserialization of the
+	/// request), the time from sendReply() until the MethodHandler
+	/// returns as PHASE_SERIALIZE, and the complete call as
+	/// PHASE_ROUNDTRIP. Calls that throw are counted as failed.
+	///
+	/// While tracing is enabled (see Poco::Tracer), every call is
+	/// also recorded as a span in category "remoting", named after
+	/// the qualified method name.
+	///
+	/// A Skeleton wraps its MethodHandlers when adding them:
+	///
+	///     addMethodHandler("getValue", new TimedMethodHandler("Sample.Service", "getValue", new ServiceGetValueMethodHandler));
+{
+public:
+	typedef Poco::AutoPtr<TimedMethodHandler> Ptr;
+
+	TimedMethodHandler(const std::string& typeId, const std::string& methodName, MethodHandler::Ptr pHandler, MethodStatistics& statistics = MethodStatistics::defaultStatistics()):
+		_method(MethodStatistics::method(typeId, methodName)),
+		_traceName(Poco::Tracer::instance().intern(_method)),
+		_pHandler(pHandler),
+		_statistics(statistics)
+		/// Creates the TimedMethodHandler for the given method and MethodHandler.
+	{
+	}
+
+	~TimedMethodHandler()
+		/// Destroys the TimedMethodHandler.
+	{
+	}
+
+	// MethodHandler
+	void invoke(ServerTransport& transport, Deserializer& deserializer, RemoteObject::Ptr pRemoteObject)
+	{
+		poco_trace_scope("remoting", _traceName);
+		MethodStatistics::CallRecord call(MethodStatistics::SIDE_SERVER, _method);
+		call.traceId = MethodStatistics::currentTraceId();
+		TimingServerTransport timingTransport(transport);
+		try
+		{
+			_pHandler->invoke(timingTransport, deserializer, pRemoteObject);
+		}
+		catch (...)
+		{
+			call.failed = true;
+			timingTransport.finish(call);
+			_statistics.record(call);
+			throw;
+		}
+		timingTransport.finish(call);
+		_statistics.record(call);
+	}
+
+protected:
+	class TimingServerTransport: public ServerTransport
+		/// Forwards to the ServerTransport of the request and
+		/// takes the time when the reply is started.
+		///
+		/// Attributes of the ServerTransport are not copied.
+	{
+	public:
+		explicit TimingServerTransport(ServerTransport& transport):
+			_transport(transport),
+			_replied(false)
+		{
+		}
+
+		void finish(MethodStatistics::CallRecord& call)
+		{
+			Poco::Clock::ClockDiff total = _start.elapsed();
+			if (_replied)
+			{
+				call.durations[MethodStatistics::PHASE_INVOKE] = _reply - _start;
+				call.durations[MethodStatistics::PHASE_SERIALIZE] = _reply.elapsed();
+			}
+			else
+			{
+				call.durations[MethodStatistics::PHASE_INVOKE] = total;
+			}
+			call.durations[MethodStatistics::PHASE_ROUNDTRIP] = total;
+		}
+
+		// ServerTransport
+		bool authenticate(const std::string& method)
+		{
+			return _transport.authenticate(method);
+		}
+
+		bool authorize(const std::string& method, const std::string& permission)
+		{
+			return _transport.authorize(method, permission);
+		}
+
+		Deserializer& beginRequest()
+		{
+			return _transport.beginRequest();
+		}
+
+		Serializer& sendReply(SerializerBase::MessageType messageType)
+		{
+			_reply.update();
+			_replied = true;
+			return _transport.sendReply(messageType);
+		}
+
+		void endRequest()
+		{
+			_transport.endRequest();
+		}
+
+	private:
+		ServerTransport& _transport;
+		Poco::Clock _start;
+		Poco::Clock _reply;
+		bool _replied;
+	};
+
+private:
+	TimedMethodHandler(const TimedMethodHandler&);
+	TimedMethodHandler& operator = (const TimedMethodHandler&);
+
+	std::string _method;
+	const char* _traceName;
+	MethodHandler::Ptr _pHandler;
+	MethodStatistics& _statistics;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_TimedMethodHandler_INCLUDED
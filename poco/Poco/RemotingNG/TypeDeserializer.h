@@ -23,10 +23,14 @@
 #include "Poco/RemotingNG/RemotingNG.h"
 #include "Poco/RemotingNG/Deserializer.h"
 #include "Poco/RemotingNG/Serializer.h"
+#include "Poco/RemotingNG/BulkSerialization.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/RemotingNG/RequestArena.h"
 #include "Poco/Optional.h"
 #include "Poco/Nullable.h"
 #include "Poco/AutoPtr.h"
 #include "Poco/SharedPtr.h"
+#include "Poco/Buffer.h"
 #include "Poco/URI.h"
 #include "Poco/UUID.h"
 #include "Poco/Timestamp.h"
@@ -37,6 +41,10 @@
 #include <vector>
 #include <list>
 #include <set>
+#include <utility>
+#if __cplusplus >= 201103L
+#include <array>
+#endif
 
 
 namespace Poco {
@@ -80,8 +88,19 @@ public:
 		Poco::UInt32 sizeHint;
 		if (deser.deserializeSequenceBegin(name, isMandatory, sizeHint))
 		{
-			if (sizeHint > 0) value.reserve(sizeHint);
-			deserializeImpl(name, false, deser, value);
+			BulkDeserializer* pBulkDeser = BulkSequence<T>::deserializer(deser);
+			if (pBulkDeser)
+			{
+				BulkSequence<T>::checkSize(name, sizeHint, *pBulkDeser);
+				value.clear();
+				value.resize(sizeHint);
+				BulkSequence<T>::deserialize(name, bulkData(value), sizeHint, *pBulkDeser);
+			}
+			else
+			{
+				if (sizeHint > 0) value.reserve(sizeHint);
+				deserializeImpl(name, false, deser, value);
+			}
 			deser.deserializeSequenceEnd(name);
 			return true;
 		}
@@ -98,7 +117,11 @@ public:
 			found = TypeDeserializer<T>::deserialize(name, isMandatory, deser, elem);
 			if (found)
 			{
+#if __cplusplus >= 201103L
+				value.push_back(std::move(elem));
+#else
 				value.push_back(elem);
+#endif
 			}
 		}
 		while (found);
@@ -106,6 +129,80 @@ public:
 };
 
 
+#if __cplusplus >= 201103L
+
+
+template <typename T, std::size_t N>
+class TypeDeserializer<std::array<T, N> >
+{
+public:
+	static bool deserialize(const std::string& name, bool isMandatory, Deserializer& deser, std::array<T, N>& value)
+	{
+		Poco::UInt32 sizeHint;
+		if (deser.deserializeSequenceBegin(name, isMandatory, sizeHint))
+		{
+			BulkDeserializer* pBulkDeser = BulkSequence<T>::deserializer(deser);
+			if (pBulkDeser)
+			{
+				if (sizeHint != N) throw DeserializerException("wrong number of elements", name);
+				BulkSequence<T>::deserialize(name, value.data(), N, *pBulkDeser);
+			}
+			else deserializeImpl(name, false, deser, value);
+			deser.deserializeSequenceEnd(name);
+			return true;
+		}
+		else return false;
+	}
+
+	static void deserializeImpl(const std::string& name, bool isMandatory, Deserializer& deser, std::array<T, N>& value)
+	{
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			if (!TypeDeserializer<T>::deserialize(name, isMandatory, deser, value[i]))
+				throw DeserializerException("wrong number of elements", name);
+		}
+	}
+};
+
+
+#endif
+
+
+template <typename T>
+class TypeDeserializer<Poco::Buffer<T> >
+{
+public:
+	static bool deserialize(const std::string& name, bool isMandatory, Deserializer& deser, Poco::Buffer<T>& value)
+	{
+		Poco::UInt32 sizeHint;
+		if (deser.deserializeSequenceBegin(name, isMandatory, sizeHint))
+		{
+			BulkDeserializer* pBulkDeser = BulkSequence<T>::deserializer(deser);
+			if (pBulkDeser)
+			{
+				BulkSequence<T>::checkSize(name, sizeHint, *pBulkDeser);
+				value.resize(sizeHint, false);
+				BulkSequence<T>::deserialize(name, value.begin(), sizeHint, *pBulkDeser);
+			}
+			else deserializeImpl(name, false, deser, value);
+			deser.deserializeSequenceEnd(name);
+			return true;
+		}
+		else return false;
+	}
+
+	static void deserializeImpl(const std::string& name, bool isMandatory, Deserializer& deser, Poco::Buffer<T>& value)
+	{
+		value.resize(0, false);
+		T elem;
+		while (TypeDeserializer<T>::deserialize(name, isMandatory, deser, elem))
+		{
+			value.append(elem);
+		}
+	}
+};
+
+
 template <typename T>
 class TypeDeserializer<std::list<T> >
 {
@@ -132,7 +229,11 @@ public:
 			found = TypeDeserializer<T>::deserialize(name, isMandatory, deser, elem);
 			if (found)
 			{
+#if __cplusplus >= 201103L
+				value.push_back(std::move(elem));
+#else
 				value.push_back(elem);
+#endif
 			}
 		}
 		while (found);
@@ -166,7 +267,11 @@ public:
 			found = TypeDeserializer<T>::deserialize(name, isMandatory, deser, elem);
 			if (found)
 			{
+#if __cplusplus >= 201103L
+				value.insert(std::move(elem));
+#else
 				value.insert(elem);
+#endif
 			}
 		}
 		while (found);
@@ -200,7 +305,11 @@ public:
 			found = TypeDeserializer<T>::deserialize(name, isMandatory, deser, elem);
 			if (found)
 			{
+#if __cplusplus >= 201103L
+				value.insert(std::move(elem));
+#else
 				value.insert(elem);
+#endif
 			}
 		}
 		while (found);
@@ -328,10 +437,10 @@ class TypeDeserializer<Poco::URI>
 public:
 	static bool deserialize(const std::string& name, bool isMandatory, Deserializer& deser, Poco::URI& value)
 	{
-		std::string uriStr;
-		bool found = deser.deserialize(name, isMandatory, uriStr);
+		ScratchString uriStr;
+		bool found = deser.deserialize(name, isMandatory, uriStr.value());
 		if (found)
-			value = uriStr;
+			value = uriStr.value();
 		else
 			value.clear();
 		return found;
@@ -345,10 +454,10 @@ class TypeDeserializer<Poco::UUID>
 public:
 	static bool deserialize(const std::string& name, bool isMandatory, Deserializer& deser, Poco::UUID& value)
 	{
-		std::string uuidStr;
-		bool found = deser.deserialize(name, isMandatory, uuidStr);
+		ScratchString uuidStr;
+		bool found = deser.deserialize(name, isMandatory, uuidStr.value());
 		if (found)
-			value.parse(uuidStr);
+			value.parse(uuidStr.value());
 		else
 			value = Poco::UUID();
 		return found;
@@ -373,12 +482,12 @@ class TypeDeserializer<Poco::DateTime>
 public:
 	static bool deserialize(const std::string& name, bool isMandatory, Deserializer& deser, Poco::DateTime& value)
 	{
-		std::string timeStr;
-		bool found = TypeDeserializer<std::string>::deserialize(name, isMandatory, deser, timeStr);
+		ScratchString timeStr;
+		bool found = TypeDeserializer<std::string>::deserialize(name, isMandatory, deser, timeStr.value());
 		if (found)
 		{
 			int tzd = 0; 
-			Poco::DateTimeParser::parse(Poco::DateTimeFormat::ISO8601_FRAC_FORMAT, timeStr, value, tzd);
+			Poco::DateTimeParser::parse(Poco::DateTimeFormat::ISO8601_FRAC_FORMAT, timeStr.value(), value, tzd);
 			value.makeUTC(tzd);
 		}
 		return found;
@@ -392,13 +501,13 @@ class TypeDeserializer<Poco::LocalDateTime>
 public:
 	static bool deserialize(const std::string& name, bool isMandatory, Deserializer& deser, Poco::LocalDateTime& value)
 	{
-		std::string timeStr;
-		bool found = TypeDeserializer<std::string>::deserialize(name, isMandatory, deser, timeStr);
+		ScratchString timeStr;
+		bool found = TypeDeserializer<std::string>::deserialize(name, isMandatory, deser, timeStr.value());
 		if (found)
 		{
 			int tzd = 0;
 			Poco::DateTime dt;
-			Poco::DateTimeParser::parse(Poco::DateTimeFormat::ISO8601_FRAC_FORMAT, timeStr, dt, tzd);
+			Poco::DateTimeParser::parse(Poco::DateTimeFormat::ISO8601_FRAC_FORMAT, timeStr.value(), dt, tzd);
 			value = Poco::LocalDateTime(tzd, dt, false);
 		}
 		return found;
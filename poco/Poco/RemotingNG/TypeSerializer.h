@@ -22,10 +22,12 @@
 
 #include "Poco/RemotingNG/RemotingNG.h"
 #include "Poco/RemotingNG/Serializer.h"
+#include "Poco/RemotingNG/BulkSerialization.h"
 #include "Poco/Optional.h"
 #include "Poco/Nullable.h"
 #include "Poco/SharedPtr.h"
 #include "Poco/AutoPtr.h"
+#include "Poco/Buffer.h"
 #include "Poco/URI.h"
 #include "Poco/UUID.h"
 #include "Poco/Timestamp.h"
@@ -36,6 +38,9 @@
 #include <vector>
 #include <list>
 #include <set>
+#if __cplusplus >= 201103L
+#include <array>
+#endif
 
 
 namespace Poco {
@@ -83,6 +88,7 @@ public:
 
 	static void serializeImpl(const std::string& name, const std::vector<T>& value, Serializer& ser)
 	{
+		if (BulkSequence<T>::serialize(name, bulkData(value), value.size(), ser)) return;
 		typename std::vector<T>::const_iterator it = value.begin();
 		typename std::vector<T>::const_iterator itEnd = value.end();
 		for (; it != itEnd; ++it)
@@ -93,6 +99,58 @@ public:
 };
 
 
+#if __cplusplus >= 201103L
+
+
+template <typename T, std::size_t N>
+class TypeSerializer<std::array<T, N> >
+{
+public:
+	static void serialize(const std::string& name, const std::array<T, N>& value, Serializer& ser)
+	{
+		ser.serializeSequenceBegin(name, static_cast<Poco::UInt32>(N));
+		serializeImpl(name, value, ser);
+		ser.serializeSequenceEnd(name);
+	}
+
+	static void serializeImpl(const std::string& name, const std::array<T, N>& value, Serializer& ser)
+	{
+		if (BulkSequence<T>::serialize(name, value.data(), N, ser)) return;
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			TypeSerializer<T>::serialize(name, value[i], ser);
+		}
+	}
+};
+
+
+#endif
+
+
+template <typename T>
+class TypeSerializer<Poco::Buffer<T> >
+{
+public:
+	static void serialize(const std::string& name, const Poco::Buffer<T>& value, Serializer& ser)
+	{
+		ser.serializeSequenceBegin(name, static_cast<Poco::UInt32>(value.size()));
+		serializeImpl(name, value, ser);
+		ser.serializeSequenceEnd(name);
+	}
+
+	static void serializeImpl(const std::string& name, const Poco::Buffer<T>& value, Serializer& ser)
+	{
+		if (BulkSequence<T>::serialize(name, value.begin(), value.size(), ser)) return;
+		const T* it = value.begin();
+		const T* itEnd = value.end();
+		for (; it != itEnd; ++it)
+		{
+			TypeSerializer<T>::serialize(name, *it, ser);
+		}
+	}
+};
+
+
 template <typename T>
 class TypeSerializer<std::list<T> >
 {
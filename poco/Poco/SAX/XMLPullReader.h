@@ -0,0 +1,319 @@
+//
+// XMLPullReader.h
+//
+// $Id$
+//
+// Library: XML
+// Package: SAX
+// Module:  SAX
+//
+// Implementation of the XMLReader interface based on XMLPullParser.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef SAX_XMLPullReader_INCLUDED
+#define SAX_XMLPullReader_INCLUDED
+
+
+#include "Poco/XML/XML.h"
+#include "Poco/XML/XMLPullParser.h"
+#include "Poco/SAX/XMLReader.h"
+#include "Poco/SAX/ContentHandler.h"
+#include "Poco/SAX/LexicalHandler.h"
+#include "Poco/SAX/ErrorHandler.h"
+#include "Poco/SAX/InputSource.h"
+#include "Poco/SAX/EntityResolverImpl.h"
+#include "Poco/SAX/AttributesImpl.h"
+#include "Poco/SAX/SAXException.h"
+#include <vector>
+
+
+#if !defined(XML_UNICODE)
+
+
+namespace Poco {
+namespace XML {
+
+
+class XMLPullReader: public XMLReader
+	/// An implementation of the SAX2 XMLReader interface that reads
+	/// the document with an XMLPullParser and passes its tokens to the
+	/// ContentHandler and LexicalHandler. It can be used instead of
+	/// SAXParser by existing handlers and by DOMBuilder:
+	///
+	///     XMLPullReader reader;
+	///     DOMBuilder builder(reader);
+	///     AutoPtr<Document> pDoc = builder.parse(&inputSource);
+	///
+	/// Compared to SAXParser, XMLPullReader does not call DTD and
+	/// declaration handlers, does not load external entities and
+	/// does not support the namespace-prefixes feature.
+{
+public:
+	XMLPullReader():
+		_pEntityResolver(0),
+		_pDTDHandler(0),
+		_pContentHandler(0),
+		_pErrorHandler(0),
+		_pLexicalHandler(0),
+		_namespaces(true)
+		/// Creates the XMLPullReader.
+	{
+	}
+
+	~XMLPullReader()
+		/// Destroys the XMLPullReader.
+	{
+	}
+
+	// XMLReader
+	void setEntityResolver(EntityResolver* pResolver)
+	{
+		_pEntityResolver = pResolver;
+	}
+
+	EntityResolver* getEntityResolver() const
+	{
+		return _pEntityResolver;
+	}
+
+	void setDTDHandler(DTDHandler* pDTDHandler)
+	{
+		_pDTDHandler = pDTDHandler;
+	}
+
+	DTDHandler* getDTDHandler() const
+	{
+		return _pDTDHandler;
+	}
+
+	void setContentHandler(ContentHandler* pContentHandler)
+	{
+		_pContentHandler = pContentHandler;
+	}
+
+	ContentHandler* getContentHandler() const
+	{
+		return _pContentHandler;
+	}
+
+	void setErrorHandler(ErrorHandler* pErrorHandler)
+	{
+		_pErrorHandler = pErrorHandler;
+	}
+
+	ErrorHandler* getErrorHandler() const
+	{
+		return _pErrorHandler;
+	}
+
+	void setFeature(const XMLString& featureId, bool state)
+	{
+		if (featureId == XMLReader::FEATURE_NAMESPACES)
+			_namespaces = state;
+		else if (featureId == XMLReader::FEATURE_NAMESPACE_PREFIXES || featureId == XMLReader::FEATURE_VALIDATION)
+		{
+			if (state) throw SAXNotSupportedException(fromXMLString(featureId));
+		}
+		else if (featureId != XMLReader::FEATURE_EXTERNAL_GENERAL_ENTITIES && featureId != XMLReader::FEATURE_EXTERNAL_PARAMETER_ENTITIES)
+			throw SAXNotRecognizedException(fromXMLString(featureId));
+	}
+
+	bool getFeature(const XMLString& featureId) const
+	{
+		if (featureId == XMLReader::FEATURE_NAMESPACES)
+			return _namespaces;
+		else if (featureId == XMLReader::FEATURE_NAMESPACE_PREFIXES || featureId == XMLReader::FEATURE_VALIDATION ||
+		         featureId == XMLReader::FEATURE_EXTERNAL_GENERAL_ENTITIES || featureId == XMLReader::FEATURE_EXTERNAL_PARAMETER_ENTITIES)
+			return false;
+		else
+			throw SAXNotRecognizedException(fromXMLString(featureId));
+	}
+
+	void setProperty(const XMLString& propertyId, const XMLString&)
+	{
+		if (propertyId == XMLReader::PROPERTY_DECLARATION_HANDLER || propertyId == XMLReader::PROPERTY_LEXICAL_HANDLER)
+			throw SAXNotSupportedException(std::string("property does not take a string value: ") + fromXMLString(propertyId));
+		else
+			throw SAXNotRecognizedException(fromXMLString(propertyId));
+	}
+
+	void setProperty(const XMLString& propertyId, void* value)
+	{
+		if (propertyId == XMLReader::PROPERTY_LEXICAL_HANDLER)
+			_pLexicalHandler = reinterpret_cast<LexicalHandler*>(value);
+		else if (propertyId != XMLReader::PROPERTY_DECLARATION_HANDLER)
+			throw SAXNotRecognizedException(fromXMLString(propertyId));
+	}
+
+	void* getProperty(const XMLString& propertyId) const
+	{
+		if (propertyId == XMLReader::PROPERTY_LEXICAL_HANDLER)
+			return _pLexicalHandler;
+		else if (propertyId == XMLReader::PROPERTY_DECLARATION_HANDLER)
+			return 0;
+		else
+			throw SAXNotRecognizedException(fromXMLString(propertyId));
+	}
+
+	void parse(InputSource* pInputSource)
+	{
+		if (pInputSource->getByteStream())
+		{
+			XMLPullParser parser(*pInputSource->getByteStream(), _namespaces, pInputSource->getEncoding());
+			parse(parser);
+		}
+		else if (pInputSource->getCharacterStream())
+		{
+			XMLPullParser parser(*pInputSource->getCharacterStream(), _namespaces, pInputSource->getEncoding());
+			parse(parser);
+		}
+		else throw XMLException("Input source has no stream");
+	}
+
+	void parse(const XMLString& systemId)
+	{
+		EntityResolverImpl entityResolver;
+		InputSource* pInputSource = entityResolver.resolveEntity(0, systemId);
+		if (pInputSource)
+		{
+			try
+			{
+				parse(pInputSource);
+			}
+			catch (...)
+			{
+				entityResolver.releaseInputSource(pInputSource);
+				throw;
+			}
+			entityResolver.releaseInputSource(pInputSource);
+		}
+		else throw XMLException("Cannot resolve system identifier", fromXMLString(systemId));
+	}
+
+	void parseMemoryNP(const char* xml, std::size_t size)
+	{
+		XMLPullParser parser(xml, size, _namespaces);
+		parse(parser);
+	}
+
+	void parseString(const std::string& xml)
+		/// Parses an XML document from the given string.
+	{
+		parseMemoryNP(xml.data(), xml.size());
+	}
+
+	void parse(XMLPullParser& parser)
+		/// Reads all tokens from the given parser and passes
+		/// them to the handlers.
+	{
+		try
+		{
+			dispatch(parser);
+		}
+		catch (SAXParseException& exc)
+		{
+			if (_pErrorHandler) _pErrorHandler->fatalError(exc);
+			throw;
+		}
+	}
+
+protected:
+	void dispatch(XMLPullParser& parser)
+	{
+		ContentHandler* pContentHandler = _pContentHandler;
+		LexicalHandler* pLexicalHandler = _pLexicalHandler;
+		std::vector<std::size_t> namespaceCounts;
+		std::vector<XMLString> prefixes;
+		AttributesImpl attributes;
+
+		if (pContentHandler)
+		{
+			pContentHandler->setDocumentLocator(&parser);
+			pContentHandler->startDocument();
+		}
+		for (;;)
+		{
+			switch (parser.next())
+			{
+			case XMLPullParser::START_ELEMENT:
+				namespaceCounts.push_back(parser.namespaceCount());
+				for (std::size_t i = 0; i < parser.namespaceCount(); ++i)
+				{
+					prefixes.push_back(parser.namespacePrefix(i));
+					if (pContentHandler) pContentHandler->startPrefixMapping(parser.namespacePrefix(i), parser.namespaceURI(i));
+				}
+				if (pContentHandler)
+				{
+					attributes.clear();
+					for (std::size_t i = 0; i < parser.attributeCount(); ++i)
+					{
+						const XMLPullParser::Name& name = parser.attributeName(i);
+						attributes.addAttribute(name.namespaceURI().c_str(), name.localName().c_str(), name.qname().c_str(), "CDATA", parser.attributeValue(i), parser.isAttributeSpecified(i));
+					}
+					const XMLPullParser::Name& name = parser.name();
+					pContentHandler->startElement(name.namespaceURI(), name.localName(), name.qname(), attributes);
+				}
+				break;
+			case XMLPullParser::END_ELEMENT:
+				if (pContentHandler)
+				{
+					const XMLPullParser::Name& name = parser.name();
+					pContentHandler->endElement(name.namespaceURI(), name.localName(), name.qname());
+				}
+				for (std::size_t n = namespaceCounts.back(); n > 0; --n)
+				{
+					if (pContentHandler) pContentHandler->endPrefixMapping(prefixes.back());
+					prefixes.pop_back();
+				}
+				namespaceCounts.pop_back();
+				break;
+			case XMLPullParser::CHARACTERS:
+				if (pContentHandler) pContentHandler->characters(parser.text(), 0, static_cast<int>(parser.textLength()));
+				break;
+			case XMLPullParser::START_CDATA:
+				if (pLexicalHandler) pLexicalHandler->startCDATA();
+				break;
+			case XMLPullParser::END_CDATA:
+				if (pLexicalHandler) pLexicalHandler->endCDATA();
+				break;
+			case XMLPullParser::PROCESSING_INSTRUCTION:
+				if (pContentHandler) pContentHandler->processingInstruction(parser.target(), parser.textString());
+				break;
+			case XMLPullParser::COMMENT:
+				if (pLexicalHandler) pLexicalHandler->comment(parser.text(), 0, static_cast<int>(parser.textLength()));
+				break;
+			case XMLPullParser::END_DOCUMENT:
+				if (pContentHandler) pContentHandler->endDocument();
+				return;
+			case XMLPullParser::START_DOCUMENT:
+				break;
+			}
+		}
+	}
+
+private:
+	XMLPullReader(const XMLPullReader&);
+	XMLPullReader& operator = (const XMLPullReader&);
+
+	EntityResolver* _pEntityResolver;
+	DTDHandler* _pDTDHandler;
+	ContentHandler* _pContentHandler;
+	ErrorHandler* _pErrorHandler;
+	LexicalHandler* _pLexicalHandler;
+	bool _namespaces;
+};
+
+
+} } // namespace Poco::XML
+
+
+#endif // !XML_UNICODE
+
+
+#endif // SAX_XMLPullReader_INCLUDED
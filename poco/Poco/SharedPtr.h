@@ -24,6 +24,7 @@
 #include "Poco/Exception.h"
 #include "Poco/AtomicCounter.h"
 #include <algorithm>
+#include <utility>
 
 
 namespace Poco {
@@ -57,6 +58,38 @@ private:
 };
 
 
+class NonAtomicReferenceCounter
+	/// A ReferenceCounter for SharedPtr objects that are only
+	/// ever used by one thread at a time, using a plain counter
+	/// instead of an AtomicCounter.
+	///
+	///     typedef SharedPtr<Buffer, NonAtomicReferenceCounter> LocalBufferPtr;
+{
+public:
+	NonAtomicReferenceCounter(): _cnt(1)
+	{
+	}
+
+	void duplicate()
+	{
+		++_cnt;
+	}
+
+	int release()
+	{
+		return --_cnt;
+	}
+
+	int referenceCount() const
+	{
+		return _cnt;
+	}
+
+private:
+	int _cnt;
+};
+
+
 template <class C>
 class ReleasePolicy
 	/// The default release policy for SharedPtr, which
@@ -133,13 +166,31 @@ public:
 	template <class Other, class OtherRP> 
 	SharedPtr(const SharedPtr<Other, RC, OtherRP>& ptr): _pCounter(ptr._pCounter), _ptr(const_cast<Other*>(ptr.get()))
 	{
-		_pCounter->duplicate();
+		if (_pCounter) _pCounter->duplicate();
 	}
 
 	SharedPtr(const SharedPtr& ptr): _pCounter(ptr._pCounter), _ptr(ptr._ptr)
 	{
-		_pCounter->duplicate();
+		if (_pCounter) _pCounter->duplicate();
+	}
+
+#if __cplusplus >= 201103L
+	SharedPtr(SharedPtr&& ptr) noexcept: _pCounter(ptr._pCounter), _ptr(ptr._ptr)
+		/// Takes over the object and reference count of ptr
+		/// without touching the count. ptr becomes null and
+		/// has no reference count until it is assigned again.
+	{
+		ptr._pCounter = 0;
+		ptr._ptr = 0;
+	}
+
+	template <class Other, class OtherRP>
+	SharedPtr(SharedPtr<Other, RC, OtherRP>&& ptr) noexcept: _pCounter(ptr._pCounter), _ptr(ptr._ptr)
+	{
+		ptr._pCounter = 0;
+		ptr._ptr = 0;
 	}
+#endif
 
 	~SharedPtr()
 	{
@@ -200,6 +251,26 @@ public:
 		return assign<Other>(ptr);
 	}
 
+#if __cplusplus >= 201103L
+	SharedPtr& operator = (SharedPtr&& ptr) noexcept
+	{
+		if (&ptr != this)
+		{
+			SharedPtr tmp(std::move(ptr));
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	template <class Other, class OtherRP>
+	SharedPtr& operator = (SharedPtr<Other, RC, OtherRP>&& ptr) noexcept
+	{
+		SharedPtr tmp(std::move(ptr));
+		swap(tmp);
+		return *this;
+	}
+#endif
+
 	void swap(SharedPtr& ptr)
 	{
 		std::swap(_ptr, ptr._ptr);
@@ -216,7 +287,7 @@ public:
 		///    poco_assert (sub.get());
 	{
 		Other* pOther = dynamic_cast<Other*>(_ptr);
-		if (pOther)
+		if (pOther && _pCounter)
 			return SharedPtr<Other, RC, RP>(_pCounter, pOther);
 		return SharedPtr<Other, RC, RP>();
 	}
@@ -224,11 +295,15 @@ public:
 	template <class Other> 
 	SharedPtr<Other, RC, RP> unsafeCast() const
 		/// Casts the SharedPtr via a static cast to the given type.
+		/// Returns an SharedPtr containing NULL if the SharedPtr
+		/// has been moved from.
 		/// Example: (assume class Sub: public Super)
 		///    SharedPtr<Super> super(new Sub());
 		///    SharedPtr<Sub> sub = super.unsafeCast<Sub>();
 		///    poco_assert (sub.get());
 	{
+		if (!_pCounter)
+			return SharedPtr<Other, RC, RP>();
 		Other* pOther = static_cast<Other*>(_ptr);
 		return SharedPtr<Other, RC, RP>(_pCounter, pOther);
 	}
@@ -375,7 +450,7 @@ public:
 	
 	int referenceCount() const
 	{
-		return _pCounter->referenceCount();
+		return _pCounter ? _pCounter->referenceCount() : 0;
 	}
 
 private:
@@ -389,7 +464,7 @@ private:
 
 	void release()
 	{
-		poco_assert_dbg (_pCounter);
+		if (!_pCounter) return;
 		int i = _pCounter->release();
 		if (i == 0)
 		{
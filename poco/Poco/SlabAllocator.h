@@ -0,0 +1,433 @@
+//
+// SlabAllocator.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  SlabAllocator
+//
+// Definition of the SlabAllocator class and the SlabStlAllocator template.
+//
+// Copyright (c) 2005-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_SlabAllocator_INCLUDED
+#define Foundation_SlabAllocator_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Mutex.h"
+#include "Poco/SingletonHolder.h"
+#include <vector>
+#include <new>
+#include <cstddef>
+
+
+#if !defined(POCO_NO_SLAB_THREAD_CACHE) && __cplusplus >= 201103L
+#define POCO_SLAB_THREAD_CACHE
+#endif
+
+
+namespace Poco {
+
+
+struct SlabStatistics
+	/// The statistics of a size class of a SlabAllocator.
+{
+	std::size_t blockSize;   /// Size of the blocks of the class.
+	std::size_t slabs;       /// Number of slabs allocated for the class.
+	std::size_t blocks;      /// Number of blocks carved from the slabs.
+	std::size_t centralFree; /// Number of free blocks in the central pool.
+	std::size_t refills;     /// Number of batches taken by thread caches.
+	std::size_t flushes;     /// Number of batches returned by thread caches.
+};
+
+
+class SlabAllocator
+	/// A general purpose allocator for small objects with
+	/// multiple size classes, generalising MemoryPool.
+	///
+	/// Requests up to MAX_BLOCK_SIZE bytes are rounded up to the
+	/// next size class and served from slabs of SLAB_SIZE bytes
+	/// carved into blocks of that size; larger requests go to
+	/// operator new. Memory of the slabs is only returned to the
+	/// system when the allocator is destroyed.
+	///
+	/// With C++11, every thread keeps a small cache of free blocks
+	/// per size class, so allocating and freeing usually take no
+	/// lock. The cache is refilled from, and flushed to, the central
+	/// pool of the size class in batches of BATCH_SIZE blocks. Without
+	/// C++11 thread_local support, every call locks the central pool.
+	///
+	/// Blocks must be released with the size they were allocated
+	/// with. Use SlabStlAllocator for containers, or derive from
+	/// SlabAllocated for classes that should be allocated from the
+	/// default SlabAllocator.
+{
+public:
+	enum
+	{
+		SIZE_CLASSES = 14,
+		MAX_BLOCK_SIZE = 2048,
+		SLAB_SIZE = 65536,
+		BATCH_SIZE = 32
+	};
+
+	SlabAllocator()
+		/// Creates the SlabAllocator.
+	{
+		for (int i = 0; i < SIZE_CLASSES; ++i)
+		{
+			_classes[i].blockSize = classSize(i);
+		}
+	}
+
+	~SlabAllocator()
+		/// Destroys the SlabAllocator and releases all slabs.
+	{
+		for (int i = 0; i < SIZE_CLASSES; ++i)
+		{
+			for (std::vector<char*>::iterator it = _classes[i].slabs.begin(); it != _classes[i].slabs.end(); ++it)
+			{
+				delete [] *it;
+			}
+		}
+	}
+
+	void* allocate(std::size_t size)
+		/// Allocates a block of at least size bytes.
+		/// Throws a std::bad_alloc if no memory is available.
+	{
+		int cls = sizeClass(size);
+		if (cls < 0) return ::operator new(size);
+#if defined(POCO_SLAB_THREAD_CACHE)
+		Cache& cache = threadCache();
+		if (cache.pAllocator == this)
+		{
+			Magazine& mag = cache.magazines[cls];
+			if (!mag.pHead) refill(cls, mag);
+			Block* pBlock = mag.pHead;
+			mag.pHead = pBlock->pNext;
+			--mag.count;
+			return pBlock;
+		}
+#endif
+		SizeClass& sc = _classes[cls];
+		FastMutex::ScopedLock lock(sc.mutex);
+		if (!sc.pFree) grow(sc);
+		Block* pBlock = sc.pFree;
+		sc.pFree = pBlock->pNext;
+		--sc.freeCount;
+		return pBlock;
+	}
+
+	void deallocate(void* ptr, std::size_t size)
+		/// Releases a block allocated with the given size.
+	{
+		if (!ptr) return;
+		int cls = sizeClass(size);
+		if (cls < 0)
+		{
+			::operator delete(ptr);
+			return;
+		}
+		Block* pBlock = static_cast<Block*>(ptr);
+#if defined(POCO_SLAB_THREAD_CACHE)
+		Cache& cache = threadCache();
+		if (cache.pAllocator == this)
+		{
+			Magazine& mag = cache.magazines[cls];
+			pBlock->pNext = mag.pHead;
+			mag.pHead = pBlock;
+			if (++mag.count > 2*BATCH_SIZE) flush(cls, mag, BATCH_SIZE);
+			return;
+		}
+#endif
+		SizeClass& sc = _classes[cls];
+		FastMutex::ScopedLock lock(sc.mutex);
+		pBlock->pNext = sc.pFree;
+		sc.pFree = pBlock;
+		++sc.freeCount;
+	}
+
+	void statistics(std::vector<SlabStatistics>& statistics) const
+		/// Returns the statistics of all size classes.
+	{
+		for (int i = 0; i < SIZE_CLASSES; ++i)
+		{
+			const SizeClass& sc = _classes[i];
+			FastMutex::ScopedLock lock(sc.mutex);
+			SlabStatistics s;
+			s.blockSize   = sc.blockSize;
+			s.slabs       = sc.slabs.size();
+			s.blocks      = sc.blocks;
+			s.centralFree = sc.freeCount;
+			s.refills     = sc.refills;
+			s.flushes     = sc.flushes;
+			statistics.push_back(s);
+		}
+	}
+
+	static std::size_t blockSize(std::size_t size)
+		/// Returns the size of the blocks serving requests of the
+		/// given size, or size itself if it exceeds MAX_BLOCK_SIZE.
+	{
+		int cls = sizeClass(size);
+		return cls < 0 ? size : classSize(cls);
+	}
+
+	static SlabAllocator& defaultAllocator()
+		/// Returns the default SlabAllocator, which is the
+		/// only one using thread caches.
+	{
+		static SingletonHolder<SlabAllocator> sh;
+		return *sh.get();
+	}
+
+private:
+	struct Block
+	{
+		Block* pNext;
+	};
+
+	struct SizeClass
+	{
+		SizeClass():
+			blockSize(0),
+			pFree(0),
+			freeCount(0),
+			blocks(0),
+			refills(0),
+			flushes(0)
+		{
+		}
+
+		std::size_t        blockSize;
+		Block*             pFree;
+		std::size_t        freeCount;
+		std::size_t        blocks;
+		std::size_t        refills;
+		std::size_t        flushes;
+		std::vector<char*> slabs;
+		mutable FastMutex  mutex;
+	};
+
+	struct Magazine
+	{
+		Magazine():
+			pHead(0),
+			count(0)
+		{
+		}
+
+		Block* pHead;
+		int    count;
+	};
+
+#if defined(POCO_SLAB_THREAD_CACHE)
+	struct Cache
+	{
+		Cache():
+			pAllocator(&defaultAllocator())
+		{
+		}
+
+		~Cache()
+		{
+			for (int i = 0; i < SIZE_CLASSES; ++i)
+			{
+				if (magazines[i].count > 0) pAllocator->flush(i, magazines[i], magazines[i].count);
+			}
+		}
+
+		SlabAllocator* pAllocator;
+		Magazine       magazines[SIZE_CLASSES];
+	};
+
+	static Cache& threadCache()
+	{
+		static thread_local Cache cache;
+		return cache;
+	}
+#endif
+
+	SlabAllocator(const SlabAllocator&);
+	SlabAllocator& operator = (const SlabAllocator&);
+
+	static std::size_t classSize(int cls)
+	{
+		static const std::size_t sizes[SIZE_CLASSES] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+		return sizes[cls];
+	}
+
+	static int sizeClass(std::size_t size)
+	{
+		if (size > MAX_BLOCK_SIZE) return -1;
+		int cls = 0;
+		while (classSize(cls) < size) ++cls;
+		return cls;
+	}
+
+	void grow(SizeClass& sc)
+	{
+		char* pSlab = new char[SLAB_SIZE];
+		sc.slabs.push_back(pSlab);
+		std::size_t n = SLAB_SIZE/sc.blockSize;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			Block* pBlock = reinterpret_cast<Block*>(pSlab + i*sc.blockSize);
+			pBlock->pNext = sc.pFree;
+			sc.pFree = pBlock;
+		}
+		sc.freeCount += n;
+		sc.blocks += n;
+	}
+
+	void refill(int cls, Magazine& mag)
+	{
+		SizeClass& sc = _classes[cls];
+		FastMutex::ScopedLock lock(sc.mutex);
+		for (int i = 0; i < BATCH_SIZE; ++i)
+		{
+			if (!sc.pFree) grow(sc);
+			Block* pBlock = sc.pFree;
+			sc.pFree = pBlock->pNext;
+			pBlock->pNext = mag.pHead;
+			mag.pHead = pBlock;
+		}
+		sc.freeCount -= BATCH_SIZE;
+		mag.count += BATCH_SIZE;
+		++sc.refills;
+	}
+
+	void flush(int cls, Magazine& mag, int count)
+	{
+		SizeClass& sc = _classes[cls];
+		FastMutex::ScopedLock lock(sc.mutex);
+		for (int i = 0; i < count && mag.pHead; ++i)
+		{
+			Block* pBlock = mag.pHead;
+			mag.pHead = pBlock->pNext;
+			pBlock->pNext = sc.pFree;
+			sc.pFree = pBlock;
+			--mag.count;
+			++sc.freeCount;
+		}
+		++sc.flushes;
+	}
+
+	SizeClass _classes[SIZE_CLASSES];
+};
+
+
+template <class T>
+class SlabStlAllocator
+	/// A std::allocator compatible allocator using
+	/// the default SlabAllocator.
+	///
+	///     std::vector<int, Poco::SlabStlAllocator<int> > v;
+{
+public:
+	typedef T              value_type;
+	typedef T*             pointer;
+	typedef const T*       const_pointer;
+	typedef T&             reference;
+	typedef const T&       const_reference;
+	typedef std::size_t    size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{
+		typedef SlabStlAllocator<U> other;
+	};
+
+	SlabStlAllocator()
+	{
+	}
+
+	template <class U>
+	SlabStlAllocator(const SlabStlAllocator<U>&)
+	{
+	}
+
+	pointer allocate(size_type n, const void* = 0)
+	{
+		return static_cast<pointer>(SlabAllocator::defaultAllocator().allocate(n*sizeof(T)));
+	}
+
+	void deallocate(pointer p, size_type n)
+	{
+		SlabAllocator::defaultAllocator().deallocate(p, n*sizeof(T));
+	}
+
+	void construct(pointer p, const T& value)
+	{
+		new (p) T(value);
+	}
+
+	void destroy(pointer p)
+	{
+		p->~T();
+	}
+
+	pointer address(reference r) const
+	{
+		return &r;
+	}
+
+	const_pointer address(const_reference r) const
+	{
+		return &r;
+	}
+
+	size_type max_size() const
+	{
+		return static_cast<size_type>(-1)/sizeof(T);
+	}
+
+	template <class U>
+	bool operator == (const SlabStlAllocator<U>&) const
+	{
+		return true;
+	}
+
+	template <class U>
+	bool operator != (const SlabStlAllocator<U>&) const
+	{
+		return false;
+	}
+};
+
+
+class SlabAllocated
+	/// Deriving from SlabAllocated makes new and delete allocate
+	/// objects of the class from the default SlabAllocator.
+	///
+	///     class MyNotification: public Notification, public SlabAllocated
+	///     {
+	///         ...
+	///     };
+{
+public:
+	static void* operator new (std::size_t size)
+	{
+		return SlabAllocator::defaultAllocator().allocate(size);
+	}
+
+	static void operator delete (void* ptr, std::size_t size)
+	{
+		SlabAllocator::defaultAllocator().deallocate(ptr, size);
+	}
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_SlabAllocator_INCLUDED
@@ -0,0 +1,68 @@
+//
+// SnapshotEvent.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Events
+// Module:  SnapshotEvent
+//
+// Implementation of the SnapshotEvent template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_SnapshotEvent_INCLUDED
+#define Foundation_SnapshotEvent_INCLUDED
+
+
+#include "Poco/AbstractEvent.h"
+#include "Poco/SnapshotStrategy.h"
+#include "Poco/AbstractDelegate.h"
+#include "Poco/Mutex.h"
+
+
+namespace Poco {
+
+
+template <class TArgs, class TMutex = FastMutex> 
+class SnapshotEvent: public AbstractEvent < 
+	TArgs, SnapshotStrategy<TArgs, AbstractDelegate<TArgs> >,
+	AbstractDelegate<TArgs>,
+	TMutex
+>
+	/// A SnapshotEvent uses the SnapshotStrategy which 
+	/// invokes delegates in the order they have been registered,
+	/// like BasicEvent does.
+	///
+	/// SnapshotEvent is intended for events with many delegates
+	/// that are fired much more often than delegates are added
+	/// or removed. The per-notify() cost is independent of the
+	/// number of registered delegates, apart from invoking them.
+	///
+	/// Please see the AbstractEvent class template documentation
+	/// for more information.
+{
+public:
+	SnapshotEvent()
+	{
+	}
+
+	~SnapshotEvent()
+	{
+	}
+
+private:
+	SnapshotEvent(const SnapshotEvent& e);
+	SnapshotEvent& operator = (const SnapshotEvent& e);
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_SnapshotEvent_INCLUDED
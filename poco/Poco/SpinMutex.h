@@ -0,0 +1,280 @@
+//
+// SpinMutex.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  SpinMutex
+//
+// Definition of the SpinMutex class.
+//
+// Copyright (c) 2004-2008, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_SpinMutex_INCLUDED
+#define Foundation_SpinMutex_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/ScopedLock.h"
+#include "Poco/Mutex.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Exception.h"
+#if defined(POCO_HAVE_STD_ATOMICS) || __cplusplus >= 201103L
+#include <atomic>
+#define POCO_SPINMUTEX_ATOMICS 1
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <time.h>
+#define POCO_SPINMUTEX_FUTEX 1
+#endif
+#endif
+#if (defined(__i386__) || defined(__x86_64__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
+
+
+namespace Poco {
+
+
+class SpinMutex
+	/// A SpinMutex is a non-recursive mutex, like FastMutex,
+	/// for short critical sections.
+	///
+	/// A thread that finds the SpinMutex locked first spins
+	/// for a while, expecting the owner to unlock it soon, and
+	/// only then parks until the SpinMutex is unlocked, instead
+	/// of going to sleep right away. The number of iterations
+	/// a thread spins adapts to the number of iterations that
+	/// were recently needed to acquire the SpinMutex while
+	/// spinning, so that threads stop wasting CPU time spinning
+	/// if the critical sections turn out to be long.
+	///
+	/// On Linux, the SpinMutex is a single atomic integer, and
+	/// threads park on it with the futex system call. On other
+	/// platforms, and without C++11 atomics, the SpinMutex
+	/// spins on FastMutex::tryLock() and then parks on the
+	/// FastMutex.
+	///
+	/// SpinMutex satisfies the same requirements as FastMutex,
+	/// and can be used wherever a template takes a mutex
+	/// class, such as AbstractEvent, BasicEvent, ObjectPool
+	/// or ScopedLock.
+{
+public:
+	typedef Poco::ScopedLock<SpinMutex> ScopedLock;
+
+	enum
+	{
+		MIN_SPINS = 16,   /// the number of iterations a thread spins at least
+		MAX_SPINS = 4096  /// the number of iterations a thread spins at most
+	};
+
+	SpinMutex():
+#if defined(POCO_SPINMUTEX_FUTEX)
+		_state(UNLOCKED),
+#endif
+		_spins(MIN_SPINS)
+		/// Creates the SpinMutex.
+	{
+	}
+
+	~SpinMutex()
+		/// Destroys the SpinMutex.
+	{
+	}
+
+	void lock()
+		/// Locks the SpinMutex. Spins, and then blocks,
+		/// if the SpinMutex is held by another thread.
+	{
+		if (!tryLock()) lockSlow(-1);
+	}
+
+	void lock(long milliseconds)
+		/// Locks the SpinMutex. Blocks up to the given number of
+		/// milliseconds if the SpinMutex is held by another thread.
+		/// Throws a TimeoutException if the SpinMutex can not be
+		/// locked within the given timeout.
+	{
+		if (!tryLock(milliseconds)) throw TimeoutException();
+	}
+
+	bool tryLock()
+		/// Tries to lock the SpinMutex. Returns false immediately
+		/// if the SpinMutex is already held by another thread.
+		/// Returns true if the SpinMutex was successfully locked.
+	{
+#if defined(POCO_SPINMUTEX_FUTEX)
+		int expected = UNLOCKED;
+		return _state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed);
+#else
+		return _mutex.tryLock();
+#endif
+	}
+
+	bool tryLock(long milliseconds)
+		/// Locks the SpinMutex. Blocks up to the given number of
+		/// milliseconds if the SpinMutex is held by another thread.
+		/// Returns true if the SpinMutex was successfully locked.
+	{
+		return tryLock() || lockSlow(milliseconds);
+	}
+
+	void unlock()
+		/// Unlocks the SpinMutex so that it can be
+		/// acquired by other threads.
+	{
+#if defined(POCO_SPINMUTEX_FUTEX)
+		if (_state.exchange(UNLOCKED, std::memory_order_release) == CONTENDED)
+		{
+			syscall(SYS_futex, &_state, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+		}
+#else
+		_mutex.unlock();
+#endif
+	}
+
+	static void relax()
+		/// Tells the CPU that the calling thread is spinning,
+		/// to save power and to let another hardware
+		/// thread of the same core run.
+	{
+#if (defined(__i386__) || defined(__x86_64__)) && (defined(__GNUC__) || defined(__clang__))
+		_mm_pause();
+#elif (defined(__arm__) || defined(__aarch64__)) && (defined(__GNUC__) || defined(__clang__))
+		__asm__ __volatile__("yield" ::: "memory");
+#endif
+	}
+
+private:
+	bool spin()
+		/// Spins until the SpinMutex can be locked, up to twice
+		/// the recent number of iterations, and adapts that
+		/// number. Returns true if the SpinMutex has been locked.
+	{
+		int spins = spinHint();
+		int limit = 2*spins + MIN_SPINS;
+		if (limit > MAX_SPINS) limit = MAX_SPINS;
+		for (int i = 0; i < limit; ++i)
+		{
+			relax();
+#if defined(POCO_SPINMUTEX_FUTEX)
+			if (_state.load(std::memory_order_relaxed) != UNLOCKED) continue;
+#endif
+			if (tryLock())
+			{
+				setSpinHint(spins + (i - spins)/8);
+				return true;
+			}
+		}
+		setSpinHint(spins + (limit - spins)/8);
+		return false;
+	}
+
+	bool lockSlow(long milliseconds)
+		/// Spins, and then parks until the SpinMutex can
+		/// be locked, or the timeout, if not negative, expires.
+	{
+		if (spin()) return true;
+#if defined(POCO_SPINMUTEX_FUTEX)
+		struct timespec deadline;
+		if (milliseconds >= 0)
+		{
+			clock_gettime(CLOCK_MONOTONIC, &deadline);
+			deadline.tv_sec  += milliseconds/1000;
+			deadline.tv_nsec += (milliseconds % 1000)*1000000;
+			if (deadline.tv_nsec >= 1000000000)
+			{
+				deadline.tv_nsec -= 1000000000;
+				++deadline.tv_sec;
+			}
+		}
+		// mark the SpinMutex as contended, so that unlock() wakes us
+		while (_state.exchange(CONTENDED, std::memory_order_acquire) != UNLOCKED)
+		{
+			if (milliseconds < 0)
+			{
+				syscall(SYS_futex, &_state, FUTEX_WAIT_PRIVATE, CONTENDED, 0, 0, 0);
+			}
+			else
+			{
+				struct timespec now;
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				struct timespec timeout;
+				timeout.tv_sec  = deadline.tv_sec - now.tv_sec;
+				timeout.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+				if (timeout.tv_nsec < 0)
+				{
+					timeout.tv_nsec += 1000000000;
+					--timeout.tv_sec;
+				}
+				if (timeout.tv_sec < 0) return false;
+				syscall(SYS_futex, &_state, FUTEX_WAIT_PRIVATE, CONTENDED, &timeout, 0, 0);
+			}
+		}
+		return true;
+#else
+		if (milliseconds < 0)
+		{
+			_mutex.lock();
+			return true;
+		}
+		return _mutex.tryLock(milliseconds);
+#endif
+	}
+
+	int spinHint() const
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		return _spins.load(std::memory_order_relaxed);
+#else
+		return _spins;
+#endif
+	}
+
+	void setSpinHint(int spins)
+		/// The number of iterations is only a hint, so
+		/// concurrent updates need not be atomic.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		_spins.store(spins, std::memory_order_relaxed);
+#else
+		_spins = spins;
+#endif
+	}
+
+	SpinMutex(const SpinMutex&);
+	SpinMutex& operator = (const SpinMutex&);
+
+#if defined(POCO_SPINMUTEX_FUTEX)
+	enum State
+	{
+		UNLOCKED  = 0,
+		LOCKED    = 1,
+		CONTENDED = 2 /// locked, and threads may be parked
+	};
+
+	std::atomic<int> _state;
+#else
+	FastMutex _mutex;
+#endif
+#if defined(POCO_SPINMUTEX_ATOMICS)
+	std::atomic<int> _spins;
+#else
+	volatile int _spins;
+#endif
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_SpinMutex_INCLUDED
@@ -0,0 +1,416 @@
+//
+// ThreadAffinity.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  ThreadAffinity
+//
+// Definition of the CpuSet, ThreadAffinity and ThreadAffinityRegistry classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_ThreadAffinity_INCLUDED
+#define Foundation_ThreadAffinity_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Runnable.h"
+#include "Poco/FastThreadLocal.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Mutex.h"
+#include "Poco/SingletonHolder.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/NumberParser.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Exception.h"
+#include "Poco/Types.h"
+#include <map>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace Poco {
+
+
+class CpuSet
+	/// A set of up to 64 CPUs, as used for thread affinity.
+{
+public:
+	enum
+	{
+		MAX_CPUS = 64
+	};
+
+	CpuSet():
+		_mask(0)
+	{
+	}
+
+	explicit CpuSet(UInt64 mask):
+		_mask(mask)
+	{
+	}
+
+	static CpuSet parse(const std::string& cpus)
+		/// Parses a list of CPUs and CPU ranges like "0-3,6".
+		/// Throws a SyntaxException if cpus is not valid.
+	{
+		CpuSet set;
+		StringTokenizer tok(cpus, ",", StringTokenizer::TOK_TRIM | StringTokenizer::TOK_IGNORE_EMPTY);
+		for (StringTokenizer::Iterator it = tok.begin(); it != tok.end(); ++it)
+		{
+			std::string::size_type pos = it->find('-');
+			unsigned first;
+			unsigned last;
+			if (pos == std::string::npos)
+			{
+				first = last = NumberParser::parseUnsigned(*it);
+			}
+			else
+			{
+				first = NumberParser::parseUnsigned(it->substr(0, pos));
+				last  = NumberParser::parseUnsigned(it->substr(pos + 1));
+			}
+			if (first > last || last >= MAX_CPUS) throw SyntaxException("Invalid CPU set", cpus);
+			for (unsigned cpu = first; cpu <= last; ++cpu) set.add(cpu);
+		}
+		return set;
+	}
+
+	void add(unsigned cpu)
+	{
+		poco_assert (cpu < MAX_CPUS);
+		_mask |= static_cast<UInt64>(1) << cpu;
+	}
+
+	bool contains(unsigned cpu) const
+	{
+		return cpu < MAX_CPUS && (_mask & (static_cast<UInt64>(1) << cpu)) != 0;
+	}
+
+	bool empty() const
+	{
+		return _mask == 0;
+	}
+
+	int count() const
+	{
+		int n = 0;
+		for (UInt64 m = _mask; m; m &= m - 1) ++n;
+		return n;
+	}
+
+	unsigned nth(int n) const
+		/// Returns the n-th CPU of the set, counting from 0,
+		/// wrapping around at count().
+	{
+		poco_assert (!empty());
+		n %= count();
+		for (unsigned cpu = 0; cpu < MAX_CPUS; ++cpu)
+		{
+			if (contains(cpu) && n-- == 0) return cpu;
+		}
+		return 0;
+	}
+
+	CpuSet operator & (const CpuSet& other) const
+	{
+		return CpuSet(_mask & other._mask);
+	}
+
+	CpuSet operator | (const CpuSet& other) const
+	{
+		return CpuSet(_mask | other._mask);
+	}
+
+	CpuSet operator ~ () const
+	{
+		return CpuSet(~_mask);
+	}
+
+	bool operator == (const CpuSet& other) const
+	{
+		return _mask == other._mask;
+	}
+
+	bool operator != (const CpuSet& other) const
+	{
+		return _mask != other._mask;
+	}
+
+	UInt64 mask() const
+	{
+		return _mask;
+	}
+
+	std::string toString() const
+		/// Returns the set in the format accepted by parse().
+	{
+		std::string result;
+		unsigned cpu = 0;
+		while (cpu < MAX_CPUS)
+		{
+			if (!contains(cpu))
+			{
+				++cpu;
+				continue;
+			}
+			unsigned last = cpu;
+			while (last + 1 < MAX_CPUS && contains(last + 1)) ++last;
+			if (!result.empty()) result += ',';
+			NumberFormatter::append(result, cpu);
+			if (last > cpu)
+			{
+				result += '-';
+				NumberFormatter::append(result, last);
+			}
+			cpu = last + 1;
+		}
+		return result;
+	}
+
+	bool applyToCurrentThread() const
+		/// Restricts the calling thread to the CPUs in the set.
+		/// Returns false if the set is empty, or thread affinity
+		/// is not supported on this platform or has been refused.
+	{
+#if defined(__linux__)
+		if (empty()) return false;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (unsigned cpu = 0; cpu < MAX_CPUS; ++cpu)
+		{
+			if (contains(cpu)) CPU_SET(cpu, &set);
+		}
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		return false;
+#endif
+	}
+
+private:
+	UInt64 _mask;
+};
+
+
+class ThreadAffinity
+	/// The CPU affinity policy for a group of threads, such
+	/// as the threads of a pool or the threads of the socket
+	/// reactors of a server.
+{
+public:
+	typedef SharedPtr<ThreadAffinity> Ptr;
+
+	enum Policy
+	{
+		POLICY_ANY,
+			/// Every thread may run on any CPU of the set.
+		POLICY_ROUND_ROBIN,
+			/// Every thread is pinned to a single CPU of the set,
+			/// taking turns over the set.
+		POLICY_ISOLATED
+			/// Like POLICY_ROUND_ROBIN, but the CPUs of the set
+			/// are taken away from all other groups in the
+			/// ThreadAffinityRegistry.
+	};
+
+	ThreadAffinity(const CpuSet& cpus, Policy policy = POLICY_ANY):
+		_cpus(cpus),
+		_effective(cpus),
+		_policy(policy)
+	{
+	}
+
+	static Policy parsePolicy(const std::string& policy)
+		/// Parses "any", "roundRobin" or "isolated".
+		/// Throws a SyntaxException otherwise.
+	{
+		if (policy == "any") return POLICY_ANY;
+		else if (policy == "roundRobin") return POLICY_ROUND_ROBIN;
+		else if (policy == "isolated") return POLICY_ISOLATED;
+		else throw SyntaxException("Invalid thread affinity policy", policy);
+	}
+
+	const CpuSet& cpus() const
+		/// Returns the configured CPUs.
+	{
+		return _cpus;
+	}
+
+	CpuSet effectiveCpus() const
+		/// Returns the configured CPUs without those
+		/// isolated for other groups.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _effective;
+	}
+
+	Policy policy() const
+	{
+		return _policy;
+	}
+
+	bool applyToCurrentThread()
+		/// Pins the calling thread according to the policy.
+		/// Returns false if pinning failed or is not supported.
+	{
+		CpuSet effective = effectiveCpus();
+		if (effective.empty()) return false;
+		if (_policy == POLICY_ANY) return effective.applyToCurrentThread();
+		CpuSet cpu;
+		cpu.add(effective.nth(_next++));
+		return cpu.applyToCurrentThread();
+	}
+
+private:
+	void exclude(const CpuSet& cpus)
+	{
+		CpuSet effective = _cpus & ~cpus;
+		FastMutex::ScopedLock lock(_mutex);
+		_effective = effective.empty() ? _cpus : effective;
+	}
+
+	CpuSet            _cpus;
+	CpuSet            _effective;
+	Policy            _policy;
+	AtomicCounter     _next;
+	mutable FastMutex _mutex;
+
+	friend class ThreadAffinityRegistry;
+};
+
+
+class ThreadAffinityRegistry
+	/// The process-wide map from thread group names, e.g. the
+	/// names of thread pools, to ThreadAffinity policies.
+	///
+	/// PriorityThreadPool, WorkStealingThreadPool and
+	/// Net::ParallelSocketReactor pin their threads according to
+	/// the policy registered under their name. Other threads, such
+	/// as the threads of a ThreadPool or a thread running a
+	/// SocketReactor, are pinned by calling pinCurrentThread() from
+	/// the thread, or by running their target through a
+	/// PinnedRunnable.
+	///
+	/// Util::ThreadAffinityConfigurator registers policies
+	/// from the application configuration.
+{
+public:
+	ThreadAffinityRegistry()
+	{
+	}
+
+	static ThreadAffinityRegistry& instance()
+		/// Returns the default ThreadAffinityRegistry.
+	{
+		static SingletonHolder<ThreadAffinityRegistry> sh;
+		return *sh.get();
+	}
+
+	void set(const std::string& group, ThreadAffinity::Ptr pAffinity)
+		/// Registers the policy for the given group, replacing a
+		/// previous one. Threads already pinned are not moved.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_affinities[group] = pAffinity;
+		isolate();
+	}
+
+	void remove(const std::string& group)
+		/// Removes the policy for the given group.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_affinities.erase(group);
+		isolate();
+	}
+
+	ThreadAffinity::Ptr get(const std::string& group) const
+		/// Returns the policy for the given group, or null.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		Affinities::const_iterator it = _affinities.find(group);
+		return it != _affinities.end() ? it->second : ThreadAffinity::Ptr();
+	}
+
+	bool pinCurrentThread(const std::string& group)
+		/// Pins the calling thread according to the policy for the
+		/// given group. Does nothing and returns false if no policy
+		/// is registered for the group. Calling the function again
+		/// from the same thread with the same group does nothing.
+	{
+		std::string& pinned = _pinned.get();
+		if (pinned == group) return true;
+		ThreadAffinity::Ptr pAffinity = get(group);
+		if (!pAffinity || !pAffinity->applyToCurrentThread()) return false;
+		pinned = group;
+		return true;
+	}
+
+private:
+	typedef std::map<std::string, ThreadAffinity::Ptr> Affinities;
+
+	ThreadAffinityRegistry(const ThreadAffinityRegistry&);
+	ThreadAffinityRegistry& operator = (const ThreadAffinityRegistry&);
+
+	void isolate()
+	{
+		for (Affinities::iterator it = _affinities.begin(); it != _affinities.end(); ++it)
+		{
+			CpuSet isolated;
+			for (Affinities::iterator other = _affinities.begin(); other != _affinities.end(); ++other)
+			{
+				if (other != it && other->second->policy() == ThreadAffinity::POLICY_ISOLATED)
+					isolated = isolated | other->second->cpus();
+			}
+			it->second->exclude(isolated);
+		}
+	}
+
+	Affinities              _affinities;
+	FastThreadLocal<std::string> _pinned;
+	mutable FastMutex       _mutex;
+};
+
+
+class PinnedRunnable: public Runnable
+	/// A Runnable that pins the thread running it according to
+	/// the policy registered for a group in the default
+	/// ThreadAffinityRegistry, then runs the target.
+	///
+	///     Poco::Net::SocketReactor reactor;
+	///     Poco::PinnedRunnable pinned(reactor, "io");
+	///     thread.start(pinned);
+{
+public:
+	PinnedRunnable(Runnable& target, const std::string& group):
+		_target(target),
+		_group(group)
+	{
+	}
+
+	void run()
+	{
+		ThreadAffinityRegistry::instance().pinCurrentThread(_group);
+		_target.run();
+	}
+
+private:
+	Runnable&   _target;
+	std::string _group;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_ThreadAffinity_INCLUDED
@@ -0,0 +1,487 @@
+//
+// CachedConfiguration.h
+//
+// $Id$
+//
+// Library: Util
+// Package: Configuration
+// Module:  CachedConfiguration
+//
+// Definition of the CachedConfiguration class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Util_CachedConfiguration_INCLUDED
+#define Util_CachedConfiguration_INCLUDED
+
+
+#include "Poco/Util/Util.h"
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/HashMap.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Delegate.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+namespace Poco {
+namespace Util {
+
+
+class CachedConfiguration: public AbstractConfiguration
+	/// CachedConfiguration is a read cache in front of another
+	/// configuration, typically the LayeredConfiguration of an
+	/// Application.
+	///
+	/// Reading a property from a LayeredConfiguration searches all
+	/// layers, and every call to getInt(), getBool(), etc. expands
+	/// the value and parses it again. CachedConfiguration remembers
+	/// the result of the layer search (including the fact that
+	/// a property does not exist), the expanded value and the
+	/// parsed values per key, so that repeated reads of the same
+	/// property cost a hash table lookup.
+	///
+	/// The cache is cleared whenever the propertyChanged or
+	/// propertyRemoved event of the configuration, or of one of the
+	/// configurations passed to watch(), is fired. Since expanded values
+	/// can refer to any other property, the whole cache is cleared.
+	/// Changes that do not fire events, like adding a layer to a
+	/// LayeredConfiguration, changing a layer directly or changing a
+	/// configuration with disabled events, require a call to
+	/// invalidate().
+	///
+	/// Writes and removals are passed on to the configuration.
+	///
+	/// Note that the typed getters of CachedConfiguration hide the ones
+	/// of AbstractConfiguration. Code that reads the properties through
+	/// an AbstractConfiguration reference or pointer only benefits from
+	/// the cached layer search and expansion of references.
+	///
+	///     AutoPtr<CachedConfiguration> pConfig = new CachedConfiguration(&config());
+	///     int timeout = pConfig->getInt("osp.web.sessionTimeout", 1800);
+{
+public:
+	typedef Poco::AutoPtr<CachedConfiguration> Ptr;
+
+	explicit CachedConfiguration(AbstractConfiguration* pConfig):
+		_pConfig(pConfig, true),
+		_generation(0)
+		/// Creates the CachedConfiguration for the given configuration.
+		/// The configuration's reference count is incremented.
+	{
+		poco_check_ptr (pConfig);
+
+		subscribe(_pConfig);
+	}
+
+	void watch(AbstractConfiguration* pConfig)
+		/// Also clears the cache if the given configuration, e.g. a layer
+		/// of the cached LayeredConfiguration, fires a propertyChanged
+		/// or propertyRemoved event.
+	{
+		poco_check_ptr (pConfig);
+
+		ConfigPtr ptr(pConfig, true);
+		subscribe(ptr);
+		Poco::FastMutex::ScopedLock lock(_cacheMutex);
+		_watched.push_back(ptr);
+		clearCache();
+	}
+
+	void unwatch(AbstractConfiguration* pConfig)
+		/// Stops watching the given configuration.
+	{
+		ConfigPtr ptr;
+		{
+			Poco::FastMutex::ScopedLock lock(_cacheMutex);
+			for (std::vector<ConfigPtr>::iterator it = _watched.begin(); it != _watched.end(); ++it)
+			{
+				if (it->get() == pConfig)
+				{
+					ptr = *it;
+					_watched.erase(it);
+					break;
+				}
+			}
+		}
+		if (ptr) unsubscribe(ptr);
+	}
+
+	void invalidate()
+		/// Clears the cache.
+	{
+		Poco::FastMutex::ScopedLock lock(_cacheMutex);
+		clearCache();
+	}
+
+	std::size_t size() const
+		/// Returns the number of cached keys.
+	{
+		Poco::FastMutex::ScopedLock lock(_cacheMutex);
+		return _cache.size();
+	}
+
+	AbstractConfiguration& configuration()
+		/// Returns the cached configuration.
+	{
+		return *_pConfig;
+	}
+
+	std::string getString(const std::string& key) const
+		/// Returns the expanded string value of the property with the
+		/// given name. Throws a NotFoundException if the key does not exist.
+	{
+		std::string value;
+		if (expanded(key, value))
+			return value;
+		else
+			throw NotFoundException(key);
+	}
+
+	std::string getString(const std::string& key, const std::string& defaultValue) const
+		/// If a property with the given key exists, returns the property's
+		/// expanded string value, otherwise returns the given default value.
+	{
+		std::string value;
+		if (expanded(key, value))
+			return value;
+		else
+			return defaultValue;
+	}
+
+	int getInt(const std::string& key) const
+		/// Returns the int value of the property with the given name.
+		/// See AbstractConfiguration::getInt().
+	{
+		int value = 0;
+		if (typed(key, INT_VALUE, &Entry::intValue, &AbstractConfiguration::parseInt, value))
+			return value;
+		else
+			throw NotFoundException(key);
+	}
+
+	int getInt(const std::string& key, int defaultValue) const
+		/// If a property with the given key exists, returns the property's
+		/// int value, otherwise returns the given default value.
+	{
+		int value = 0;
+		return typed(key, INT_VALUE, &Entry::intValue, &AbstractConfiguration::parseInt, value) ? value : defaultValue;
+	}
+
+	unsigned getUInt(const std::string& key) const
+		/// Returns the unsigned int value of the property with the given name.
+		/// See AbstractConfiguration::getUInt().
+	{
+		unsigned value = 0;
+		if (typed(key, UINT_VALUE, &Entry::uintValue, &AbstractConfiguration::parseUInt, value))
+			return value;
+		else
+			throw NotFoundException(key);
+	}
+
+	unsigned getUInt(const std::string& key, unsigned defaultValue) const
+		/// If a property with the given key exists, returns the property's
+		/// unsigned int value, otherwise returns the given default value.
+	{
+		unsigned value = 0;
+		return typed(key, UINT_VALUE, &Entry::uintValue, &AbstractConfiguration::parseUInt, value) ? value : defaultValue;
+	}
+
+#if defined(POCO_HAVE_INT64)
+
+	Int64 getInt64(const std::string& key) const
+		/// Returns the Int64 value of the property with the given name.
+		/// See AbstractConfiguration::getInt64().
+	{
+		Int64 value = 0;
+		if (typed(key, INT64_VALUE, &Entry::int64Value, &AbstractConfiguration::parseInt64, value))
+			return value;
+		else
+			throw NotFoundException(key);
+	}
+
+	Int64 getInt64(const std::string& key, Int64 defaultValue) const
+		/// If a property with the given key exists, returns the property's
+		/// Int64 value, otherwise returns the given default value.
+	{
+		Int64 value = 0;
+		return typed(key, INT64_VALUE, &Entry::int64Value, &AbstractConfiguration::parseInt64, value) ? value : defaultValue;
+	}
+
+	UInt64 getUInt64(const std::string& key) const
+		/// Returns the UInt64 value of the property with the given name.
+		/// See AbstractConfiguration::getUInt64().
+	{
+		UInt64 value = 0;
+		if (typed(key, UINT64_VALUE, &Entry::uint64Value, &AbstractConfiguration::parseUInt64, value))
+			return value;
+		else
+			throw NotFoundException(key);
+	}
+
+	UInt64 getUInt64(const std::string& key, UInt64 defaultValue) const
+		/// If a property with the given key exists, returns the property's
+		/// UInt64 value, otherwise returns the given default value.
+	{
+		UInt64 value = 0;
+		return typed(key, UINT64_VALUE, &Entry::uint64Value, &AbstractConfiguration::parseUInt64, value) ? value : defaultValue;
+	}
+
+#endif // defined(POCO_HAVE_INT64)
+
+	double getDouble(const std::string& key) const
+		/// Returns the double value of the property with the given name.
+		/// See AbstractConfiguration::getDouble().
+	{
+		double value = 0;
+		if (typed(key, DOUBLE_VALUE, &Entry::doubleValue, &CachedConfiguration::parseDouble, value))
+			return value;
+		else
+			throw NotFoundException(key);
+	}
+
+	double getDouble(const std::string& key, double defaultValue) const
+		/// If a property with the given key exists, returns the property's
+		/// double value, otherwise returns the given default value.
+	{
+		double value = 0;
+		return typed(key, DOUBLE_VALUE, &Entry::doubleValue, &CachedConfiguration::parseDouble, value) ? value : defaultValue;
+	}
+
+	bool getBool(const std::string& key) const
+		/// Returns the boolean value of the property with the given name.
+		/// See AbstractConfiguration::getBool().
+	{
+		bool value = false;
+		if (typed(key, BOOL_VALUE, &Entry::boolValue, &AbstractConfiguration::parseBool, value))
+			return value;
+		else
+			throw NotFoundException(key);
+	}
+
+	bool getBool(const std::string& key, bool defaultValue) const
+		/// If a property with the given key exists, returns the property's
+		/// boolean value, otherwise returns the given default value.
+	{
+		bool value = false;
+		return typed(key, BOOL_VALUE, &Entry::boolValue, &AbstractConfiguration::parseBool, value) ? value : defaultValue;
+	}
+
+protected:
+	typedef Poco::AutoPtr<AbstractConfiguration> ConfigPtr;
+
+	enum Flags
+	{
+		EXPANDED_VALUE = 0x01,
+		INT_VALUE      = 0x02,
+		UINT_VALUE     = 0x04,
+		INT64_VALUE    = 0x08,
+		UINT64_VALUE   = 0x10,
+		DOUBLE_VALUE   = 0x20,
+		BOOL_VALUE     = 0x40
+	};
+
+	struct Entry
+	{
+		Entry():
+			found(false),
+			flags(0),
+			intValue(0),
+			uintValue(0),
+			int64Value(0),
+			uint64Value(0),
+			doubleValue(0),
+			boolValue(false)
+		{
+		}
+
+		bool found;
+		int flags;
+		std::string raw;
+		std::string expanded;
+		int intValue;
+		unsigned uintValue;
+		Int64 int64Value;
+		UInt64 uint64Value;
+		double doubleValue;
+		bool boolValue;
+	};
+
+	typedef Poco::HashMap<std::string, Entry> Cache;
+
+	bool getRaw(const std::string& key, std::string& value) const
+	{
+		Poco::UInt32 generation;
+		{
+			Poco::FastMutex::ScopedLock lock(_cacheMutex);
+			Cache::ConstIterator it = _cache.find(key);
+			if (it != _cache.end())
+			{
+				if (it->second.found) value = it->second.raw;
+				return it->second.found;
+			}
+			generation = _generation;
+		}
+		bool found = _pConfig->hasProperty(key);
+		if (found) value = _pConfig->getRawString(key);
+
+		Poco::FastMutex::ScopedLock lock(_cacheMutex);
+		if (generation == _generation)
+		{
+			Entry& entry = _cache[key];
+			entry.found = found;
+			if (found) entry.raw = value;
+		}
+		return found;
+	}
+
+	void setRaw(const std::string& key, const std::string& value)
+	{
+		_pConfig->setString(key, value);
+		invalidate();
+	}
+
+	void enumerate(const std::string& key, Keys& range) const
+	{
+		_pConfig->keys(key, range);
+	}
+
+	void removeRaw(const std::string& key)
+	{
+		_pConfig->remove(key);
+		invalidate();
+	}
+
+	bool expanded(const std::string& key, std::string& value) const
+		/// Stores the expanded value of the property in value and returns
+		/// true, or returns false if the property does not exist.
+	{
+		Poco::UInt32 generation;
+		{
+			Poco::FastMutex::ScopedLock lock(_cacheMutex);
+			Cache::ConstIterator it = _cache.find(key);
+			if (it != _cache.end() && (!it->second.found || (it->second.flags & EXPANDED_VALUE)))
+			{
+				if (it->second.found) value = it->second.expanded;
+				return it->second.found;
+			}
+			generation = _generation;
+		}
+		std::string raw;
+		if (!getRaw(key, raw)) return false;
+		value = expand(raw);
+
+		Poco::FastMutex::ScopedLock lock(_cacheMutex);
+		if (generation == _generation)
+		{
+			Entry& entry = _cache[key];
+			entry.expanded = value;
+			entry.flags |= EXPANDED_VALUE;
+		}
+		return true;
+	}
+
+	template <typename T>
+	bool typed(const std::string& key, int flag, T Entry::* member, T (*parse)(const std::string&), T& value) const
+		/// Stores the parsed value of the property in value and returns
+		/// true, or returns false if the property does not exist.
+		/// Values that cannot be parsed are not cached.
+	{
+		Poco::UInt32 generation;
+		{
+			Poco::FastMutex::ScopedLock lock(_cacheMutex);
+			Cache::ConstIterator it = _cache.find(key);
+			if (it != _cache.end() && (!it->second.found || (it->second.flags & flag)))
+			{
+				if (it->second.found) value = it->second.*member;
+				return it->second.found;
+			}
+			generation = _generation;
+		}
+		std::string str;
+		if (!expanded(key, str)) return false;
+		value = parse(str);
+
+		Poco::FastMutex::ScopedLock lock(_cacheMutex);
+		if (generation == _generation)
+		{
+			Entry& entry = _cache[key];
+			entry.*member = value;
+			entry.flags |= flag;
+		}
+		return true;
+	}
+
+	static double parseDouble(const std::string& value)
+	{
+		return Poco::NumberParser::parseFloat(value);
+	}
+
+	void subscribe(AbstractConfiguration* pConfig)
+	{
+		pConfig->propertyChanged += Poco::delegate(this, &CachedConfiguration::onPropertyChanged);
+		pConfig->propertyRemoved += Poco::delegate(this, &CachedConfiguration::onPropertyRemoved);
+	}
+
+	void unsubscribe(AbstractConfiguration* pConfig)
+	{
+		pConfig->propertyChanged -= Poco::delegate(this, &CachedConfiguration::onPropertyChanged);
+		pConfig->propertyRemoved -= Poco::delegate(this, &CachedConfiguration::onPropertyRemoved);
+	}
+
+	void onPropertyChanged(const void*, const KeyValue&)
+	{
+		invalidate();
+	}
+
+	void onPropertyRemoved(const void*, const std::string&)
+	{
+		invalidate();
+	}
+
+	void clearCache()
+		/// Clears the cache. The cache mutex must be locked.
+	{
+		_cache.clear();
+		++_generation;
+	}
+
+	~CachedConfiguration()
+	{
+		try
+		{
+			unsubscribe(_pConfig);
+			for (std::vector<ConfigPtr>::iterator it = _watched.begin(); it != _watched.end(); ++it)
+			{
+				unsubscribe(*it);
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+private:
+	CachedConfiguration(const CachedConfiguration&);
+	CachedConfiguration& operator = (const CachedConfiguration&);
+
+	ConfigPtr _pConfig;
+	std::vector<ConfigPtr> _watched;
+	mutable Cache _cache;
+	mutable Poco::UInt32 _generation;
+	mutable Poco::FastMutex _cacheMutex;
+};
+
+
+} } // namespace Poco::Util
+
+
+#endif // Util_CachedConfiguration_INCLUDED
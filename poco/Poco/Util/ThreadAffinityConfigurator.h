@@ -0,0 +1,84 @@
+//
+// ThreadAffinityConfigurator.h
+//
+// $Id$
+//
+// Library: Util
+// Package: Configuration
+// Module:  ThreadAffinityConfigurator
+//
+// Definition of the ThreadAffinityConfigurator class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Util_ThreadAffinityConfigurator_INCLUDED
+#define Util_ThreadAffinityConfigurator_INCLUDED
+
+
+#include "Poco/Util/Util.h"
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/ThreadAffinity.h"
+
+
+namespace Poco {
+namespace Util {
+
+
+class ThreadAffinityConfigurator
+	/// This utility class uses a configuration object to register
+	/// thread affinity policies with the ThreadAffinityRegistry.
+	///
+	/// Every thread group, i.e. a thread pool or a group of socket
+	/// reactors, is configured with the "threads.affinity.<group>"
+	/// properties, where <group> is the name of the thread pool, or
+	/// the group name passed to PinnedRunnable or ParallelSocketReactor.
+	/// The mandatory "cpus" property lists CPUs and CPU ranges, the
+	/// optional "policy" property is one of "any" (default),
+	/// "roundRobin" and "isolated".
+	///
+	/// Examples:
+	///     threads.affinity.remoting.cpus = 4-7
+	///     threads.affinity.remoting.policy = isolated
+	///     threads.affinity.reactor.cpus = 4-7
+	///     threads.affinity.reactor.policy = roundRobin
+	///     threads.affinity.default.cpus = 0-3
+{
+public:
+	ThreadAffinityConfigurator()
+		/// Creates the ThreadAffinityConfigurator.
+	{
+	}
+
+	void configure(const AbstractConfiguration& config, ThreadAffinityRegistry& registry = ThreadAffinityRegistry::instance())
+		/// Registers the policies found under "threads.affinity"
+		/// in the given configuration with the given registry.
+		///
+		/// Throws a SyntaxException if a property is not valid.
+	{
+		AbstractConfiguration::Keys groups;
+		config.keys("threads.affinity", groups);
+		for (AbstractConfiguration::Keys::const_iterator it = groups.begin(); it != groups.end(); ++it)
+		{
+			std::string prefix("threads.affinity.");
+			prefix += *it;
+			CpuSet cpus = CpuSet::parse(config.getString(prefix + ".cpus"));
+			ThreadAffinity::Policy policy = ThreadAffinity::parsePolicy(config.getString(prefix + ".policy", "any"));
+			registry.set(*it, new ThreadAffinity(cpus, policy));
+		}
+	}
+
+private:
+	ThreadAffinityConfigurator(const ThreadAffinityConfigurator&);
+	ThreadAffinityConfigurator& operator = (const ThreadAffinityConfigurator&);
+};
+
+
+} } // namespace Poco::Util
+
+
+#endif // Util_ThreadAffinityConfigurator_INCLUDED
@@ -0,0 +1,193 @@
+//
+// WheelTimer.h
+//
+// $Id$
+//
+// Library: Util
+// Package: Timer
+// Module:  WheelTimer
+//
+// Definition of the WheelTimer class.
+//
+// Copyright (c) 2009, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Util_WheelTimer_INCLUDED
+#define Util_WheelTimer_INCLUDED
+
+
+#include "Poco/Util/Util.h"
+#include "Poco/Util/TimerTask.h"
+#include "Poco/TimerWheel.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include <vector>
+
+
+namespace Poco {
+namespace Util {
+
+
+class WheelTimer
+	/// A WheelTimer has the interface of Timer, but schedules its
+	/// tasks on a TimerWheel instead of running its own thread
+	/// with a TimedNotificationQueue.
+	///
+	/// By default, all WheelTimer objects share the default
+	/// TimerWheel, together with RemotingNG::TCP::WheelTimer.
+	/// Scheduling and cancelling a task take constant time.
+	///
+	/// With a slack, tasks may run up to the given number of
+	/// milliseconds late, so that the wheel can serve tasks with
+	/// similar deadlines with a single wakeup.
+	///
+	/// Unlike Timer, WheelTimer does not update
+	/// TimerTask::lastExecution().
+{
+public:
+	explicit WheelTimer(long slack = 0);
+		/// Creates the WheelTimer, using the default TimerWheel.
+
+	WheelTimer(TimerWheel& wheel, long slack = 0);
+		/// Creates the WheelTimer, using the given TimerWheel.
+
+	~WheelTimer();
+		/// Destroys the WheelTimer, cancelling all pending tasks.
+
+	void cancel(bool wait = false);
+		/// Cancels all pending tasks.
+		///
+		/// If a task is currently running, it is allowed to finish.
+		/// If wait is true, waits until it has finished.
+
+	void schedule(TimerTask::Ptr pTask, Poco::Timestamp time);
+		/// Schedules a task for execution at the specified time.
+		///
+		/// If the time lies in the past, the task is executed
+		/// immediately.
+
+	void schedule(TimerTask::Ptr pTask, Poco::Clock clock);
+		/// Schedules a task for execution at the specified time.
+		///
+		/// If the time lies in the past, the task is executed
+		/// immediately.
+
+	void schedule(TimerTask::Ptr pTask, long delay, long interval);
+		/// Schedules a task for periodic execution.
+		///
+		/// The task is first executed after the given delay.
+		/// Subsequently, the task is executed periodically with
+		/// the given interval in milliseconds between invocations.
+
+	void scheduleAtFixedRate(TimerTask::Ptr pTask, long delay, long interval);
+		/// Schedules a task for periodic execution at a fixed rate.
+		///
+		/// The task is first executed after the given delay.
+		/// Subsequently, the task is executed periodically
+		/// every number of milliseconds specified by interval.
+
+private:
+	WheelTimer(const WheelTimer&);
+	WheelTimer& operator = (const WheelTimer&);
+
+	void add(const TimerWheel::Timer::Ptr& pTimer);
+
+	TimerWheel& _wheel;
+	long        _slack;
+	std::vector<TimerWheel::Timer::Ptr> _timers;
+	FastMutex   _mutex;
+};
+
+
+//
+// inlines
+//
+inline WheelTimer::WheelTimer(long slack):
+	_wheel(TimerWheel::defaultWheel()),
+	_slack(slack)
+{
+}
+
+
+inline WheelTimer::WheelTimer(TimerWheel& wheel, long slack):
+	_wheel(wheel),
+	_slack(slack)
+{
+}
+
+
+inline WheelTimer::~WheelTimer()
+{
+	try
+	{
+		cancel(true);
+	}
+	catch (...)
+	{
+		poco_unexpected();
+	}
+}
+
+
+inline void WheelTimer::cancel(bool)
+{
+	std::vector<TimerWheel::Timer::Ptr> timers;
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		timers.swap(_timers);
+	}
+	for (std::vector<TimerWheel::Timer::Ptr>::iterator it = timers.begin(); it != timers.end(); ++it)
+	{
+		_wheel.cancel(*it);
+	}
+}
+
+
+inline void WheelTimer::schedule(TimerTask::Ptr pTask, Poco::Timestamp time)
+{
+	Poco::Timestamp::TimeDiff delay = time - Poco::Timestamp();
+	add(_wheel.schedule(pTask, delay > 0 ? static_cast<long>(delay/1000) : 0, 0, _slack));
+}
+
+
+inline void WheelTimer::schedule(TimerTask::Ptr pTask, Poco::Clock clock)
+{
+	Poco::Clock::ClockDiff delay = clock - Poco::Clock();
+	add(_wheel.schedule(pTask, delay > 0 ? static_cast<long>(delay/1000) : 0, 0, _slack));
+}
+
+
+inline void WheelTimer::schedule(TimerTask::Ptr pTask, long delay, long interval)
+{
+	add(_wheel.schedule(pTask, delay, interval, _slack));
+}
+
+
+inline void WheelTimer::scheduleAtFixedRate(TimerTask::Ptr pTask, long delay, long interval)
+{
+	add(_wheel.scheduleAtFixedRate(pTask, delay, interval, _slack));
+}
+
+
+inline void WheelTimer::add(const TimerWheel::Timer::Ptr& pTimer)
+{
+	FastMutex::ScopedLock lock(_mutex);
+	std::vector<TimerWheel::Timer::Ptr>::iterator it = _timers.begin();
+	while (it != _timers.end())
+	{
+		if ((*it)->isScheduled()) ++it;
+		else it = _timers.erase(it);
+	}
+	_timers.push_back(pTimer);
+}
+
+
+} } // namespace Poco::Util
+
+
+#endif // Util_WheelTimer_INCLUDED
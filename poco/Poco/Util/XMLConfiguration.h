@@ -31,6 +31,9 @@
 #include "Poco/DOM/AutoPtr.h"
 #include "Poco/DOM/DOMWriter.h"
 #include "Poco/SAX/InputSource.h"
+#include "Poco/DOM/DOMParser.h"
+#include "Poco/SAX/XMLReader.h"
+#include "Poco/MappedFile.h"
 #include <istream>
 
 
@@ -147,6 +150,12 @@ public:
 	void load(const std::string& path);
 		/// Loads the XML document containing the configuration data
 		/// from the given file.
+
+	void loadMapped(const std::string& path);
+		/// Loads the XML document containing the configuration data
+		/// from the given file, like load(path), but maps the file
+		/// into memory with MappedFile and parses the mapped contents
+		/// directly, instead of reading them through a stream.
 		
 	void load(const Poco::XML::Document* pDocument);
 		/// Loads the XML document containing the configuration data
@@ -202,6 +211,20 @@ private:
 };
 
 
+//
+// inlines
+//
+inline void XMLConfiguration::loadMapped(const std::string& path)
+{
+	Poco::MappedFile::Ptr pFile = new Poco::MappedFile(path, Poco::MappedFile::ADVICE_SEQUENTIAL);
+	Poco::XML::DOMParser parser;
+	parser.setFeature(Poco::XML::XMLReader::FEATURE_NAMESPACES, false);
+	parser.setFeature(Poco::XML::DOMParser::FEATURE_FILTER_WHITESPACE, true);
+	Poco::XML::AutoPtr<Poco::XML::Document> pDocument = parser.parseMemory(pFile->data(), pFile->size());
+	load(pDocument);
+}
+
+
 } } // namespace Poco::Util
 
 
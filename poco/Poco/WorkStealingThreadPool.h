@@ -0,0 +1,622 @@
+//
+// WorkStealingThreadPool.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  WorkStealingThreadPool
+//
+// Definition of the WorkStealingThreadPool class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_WorkStealingThreadPool_INCLUDED
+#define Foundation_WorkStealingThreadPool_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Exception.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/Environment.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/ThreadAffinity.h"
+#include "Poco/ActiveRunnable.h"
+#include "Poco/SingletonHolder.h"
+#include "Poco/Instrumentation.h"
+#include <vector>
+#include <deque>
+#if defined(POCO_HAVE_STD_ATOMICS)
+#include <atomic>
+#endif
+
+
+namespace Poco {
+
+
+template <class T>
+class WorkStealingDeque
+	/// A fixed-capacity, single-owner, multi-thief deque of pointers
+	/// (Chase and Lev, "Dynamic Circular Work-Stealing Deque").
+	///
+	/// The owning thread pushes and pops at the bottom, other threads
+	/// steal from the top. All operations are lock-free if atomics are
+	/// available (POCO_HAVE_STD_ATOMICS or POCO_HAVE_GCC_ATOMICS),
+	/// otherwise they are serialized with a FastMutex.
+	///
+	/// Capacity must be a power of two.
+{
+public:
+	WorkStealingDeque(std::size_t capacity):
+		_mask(capacity - 1),
+		_buffer(capacity, static_cast<T*>(0)),
+		_top(0),
+		_bottom(0)
+	{
+		poco_assert (capacity > 0 && (capacity & (capacity - 1)) == 0);
+	}
+
+	bool push(T* pItem)
+		/// Adds an item at the bottom. Owner only.
+		/// Returns false if the deque is full.
+	{
+#if defined(POCO_HAVE_STD_ATOMICS) || defined(POCO_HAVE_GCC_ATOMICS)
+		long b = load(_bottom);
+		long t = load(_top);
+		if (static_cast<std::size_t>(b - t) > _mask) return false;
+		_buffer[b & _mask] = pItem;
+		fence();
+		store(_bottom, b + 1);
+		return true;
+#else
+		FastMutex::ScopedLock lock(_mutex);
+		if (static_cast<std::size_t>(_bottom - _top) > _mask) return false;
+		_buffer[_bottom++ & _mask] = pItem;
+		return true;
+#endif
+	}
+
+	T* pop()
+		/// Removes the item at the bottom. Owner only.
+		/// Returns null if the deque is empty.
+	{
+#if defined(POCO_HAVE_STD_ATOMICS) || defined(POCO_HAVE_GCC_ATOMICS)
+		long b = load(_bottom) - 1;
+		store(_bottom, b);
+		fence();
+		long t = load(_top);
+		if (t > b)
+		{
+			store(_bottom, b + 1);
+			return 0;
+		}
+		T* pItem = _buffer[b & _mask];
+		if (t == b)
+		{
+			// last item, race against thieves
+			if (!compareAndSwap(_top, t, t + 1)) pItem = 0;
+			store(_bottom, b + 1);
+		}
+		return pItem;
+#else
+		FastMutex::ScopedLock lock(_mutex);
+		if (_bottom == _top) return 0;
+		return _buffer[--_bottom & _mask];
+#endif
+	}
+
+	T* steal()
+		/// Removes the item at the top. Any thread.
+		/// Returns null if the deque is empty or the
+		/// item has been taken by another thread.
+	{
+#if defined(POCO_HAVE_STD_ATOMICS) || defined(POCO_HAVE_GCC_ATOMICS)
+		long t = load(_top);
+		fence();
+		long b = load(_bottom);
+		if (t >= b) return 0;
+		T* pItem = _buffer[t & _mask];
+		if (!compareAndSwap(_top, t, t + 1)) return 0;
+		return pItem;
+#else
+		FastMutex::ScopedLock lock(_mutex);
+		if (_bottom == _top) return 0;
+		return _buffer[_top++ & _mask];
+#endif
+	}
+
+	bool empty() const
+		/// Returns true if the deque is empty. The result
+		/// may be outdated when it is returned.
+	{
+#if defined(POCO_HAVE_STD_ATOMICS) || defined(POCO_HAVE_GCC_ATOMICS)
+		return load(_bottom) <= load(_top);
+#else
+		FastMutex::ScopedLock lock(_mutex);
+		return _bottom == _top;
+#endif
+	}
+
+private:
+	WorkStealingDeque();
+	WorkStealingDeque(const WorkStealingDeque&);
+	WorkStealingDeque& operator = (const WorkStealingDeque&);
+
+#if defined(POCO_HAVE_STD_ATOMICS)
+	typedef std::atomic<long> Index;
+
+	static long load(const Index& index)
+	{
+		return index.load(std::memory_order_acquire);
+	}
+
+	static void store(Index& index, long value)
+	{
+		index.store(value, std::memory_order_release);
+	}
+
+	static bool compareAndSwap(Index& index, long expected, long desired)
+	{
+		return index.compare_exchange_strong(expected, desired, std::memory_order_seq_cst);
+	}
+
+	static void fence()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+#elif defined(POCO_HAVE_GCC_ATOMICS)
+	typedef volatile long Index;
+
+	static long load(const Index& index)
+	{
+		long value = index;
+		__sync_synchronize();
+		return value;
+	}
+
+	static void store(Index& index, long value)
+	{
+		__sync_synchronize();
+		index = value;
+	}
+
+	static bool compareAndSwap(Index& index, long expected, long desired)
+	{
+		return __sync_bool_compare_and_swap(&index, expected, desired);
+	}
+
+	static void fence()
+	{
+		__sync_synchronize();
+	}
+#else
+	typedef long Index;
+
+	mutable FastMutex _mutex;
+#endif
+
+	std::size_t     _mask;
+	std::vector<T*> _buffer;
+	Index           _top;
+	Index           _bottom;
+};
+
+
+class WorkStealingThreadPool
+	/// A thread pool with a fixed number of worker threads, each with
+	/// its own WorkStealingDeque.
+	///
+	/// Tasks started from a worker thread are pushed onto the deque of
+	/// that worker. Tasks started from other threads go to a bounded
+	/// shared queue. Idle workers take tasks from their own deque first,
+	/// then from the shared queue, then steal from the other workers.
+	///
+	/// Unlike ThreadPool, start() does not throw a NoThreadAvailableException
+	/// when all threads are busy. Tasks are queued instead, and start()
+	/// blocks while the shared queue is full (backpressure). tryStart()
+	/// returns false instead of blocking.
+	///
+	/// The start() overloads mirror those of ThreadPool. Thread names and
+	/// priorities are not supported per task, as tasks run on the workers.
+	/// Use WorkStealingStarter to run ActiveMethod instances on the pool.
+	///
+	/// The threads of a named pool are pinned according to the policy
+	/// registered under the pool's name in the ThreadAffinityRegistry.
+	///
+	/// Runnable objects are not owned by the pool and must stay valid
+	/// until they have run. Callables passed to startCallable() are copied.
+{
+public:
+	enum
+	{
+		DEFAULT_QUEUE_CAPACITY = 1024,
+		DEQUE_CAPACITY = 256
+	};
+
+	WorkStealingThreadPool(int threads = 0, std::size_t queueCapacity = DEFAULT_QUEUE_CAPACITY, const std::string& name = "");
+		/// Creates the pool with the given number of worker threads,
+		/// or one per processor if threads is 0, and a shared queue
+		/// holding up to queueCapacity tasks.
+
+	~WorkStealingThreadPool();
+		/// Waits for the queued tasks to finish and stops the workers.
+
+	int capacity() const;
+		/// Returns the number of worker threads.
+
+	int used() const;
+		/// Returns the number of tasks started and not yet finished.
+
+	int available() const;
+		/// Returns the number of idle worker threads.
+
+	void start(Runnable& target);
+		/// Queues target, blocking while the shared queue is full.
+
+	void start(Runnable& target, const std::string& name);
+		/// Same as start(target). The name is ignored.
+
+	void startWithPriority(Thread::Priority priority, Runnable& target);
+		/// Same as start(target). The priority is ignored.
+
+	bool tryStart(Runnable& target);
+		/// Queues target and returns true, or returns false
+		/// if the shared queue is full.
+
+	bool tryStart(Runnable& target, long milliseconds);
+		/// Queues target, waiting up to the given time for room
+		/// in the shared queue. Returns false if the queue stayed full.
+
+	template <class Callable>
+	void startCallable(const Callable& callable)
+		/// Queues a copy of callable, which must be callable
+		/// without arguments (a functor, a function pointer, or
+		/// a lambda).
+	{
+		start(*new CallableRunnable<Callable>(callable));
+	}
+
+	void joinAll();
+		/// Waits until all started tasks have finished.
+
+	const std::string& name() const;
+		/// Returns the name of the pool.
+
+	static WorkStealingThreadPool& defaultPool();
+		/// Returns a reference to the default pool.
+
+private:
+	template <class Callable>
+	class CallableRunnable: public Runnable
+	{
+	public:
+		CallableRunnable(const Callable& callable): _callable(callable)
+		{
+		}
+
+		void run()
+		{
+			try
+			{
+				_callable();
+			}
+			catch (...)
+			{
+				delete this;
+				throw;
+			}
+			delete this;
+		}
+
+	private:
+		Callable _callable;
+	};
+
+	class Worker: public Runnable
+	{
+	public:
+		Worker(WorkStealingThreadPool& pool, int index):
+			_pool(pool), _index(index), _deque(DEQUE_CAPACITY)
+		{
+		}
+
+		void run()
+		{
+			_pool.work(*this);
+		}
+
+		WorkStealingThreadPool& _pool;
+		int _index;
+		WorkStealingDeque<Runnable> _deque;
+		Thread _thread;
+	};
+
+	WorkStealingThreadPool(const WorkStealingThreadPool&);
+	WorkStealingThreadPool& operator = (const WorkStealingThreadPool&);
+
+	Worker* currentWorker() const;
+	bool enqueue(Runnable& target, long milliseconds);
+	Runnable* take(Worker& worker);
+	void run(Runnable* pTarget);
+	void work(Worker& worker);
+
+	std::string            _name;
+	std::vector<Worker*>   _workers;
+	std::deque<Runnable*>  _queue;
+	std::size_t            _queueCapacity;
+	AtomicCounter          _pending;
+	AtomicCounter          _idle;
+	bool                   _stop;
+	mutable FastMutex      _mutex;
+	Condition              _taskAvailable;
+	Condition              _roomAvailable;
+	Condition              _allDone;
+};
+
+
+template <class OwnerType>
+class WorkStealingStarter
+	/// A StarterType policy for ActiveMethod that starts the
+	/// method on the default WorkStealingThreadPool.
+	///
+	///     ActiveMethod<std::string, std::string, ActiveObject, WorkStealingStarter<ActiveObject> > method;
+{
+public:
+	static void start(OwnerType* /*pOwner*/, ActiveRunnableBase::Ptr pRunnable)
+	{
+		WorkStealingThreadPool::defaultPool().start(*pRunnable);
+		pRunnable->duplicate(); // The runnable will release itself.
+	}
+};
+
+
+//
+// inlines
+//
+inline WorkStealingThreadPool::WorkStealingThreadPool(int threads, std::size_t queueCapacity, const std::string& name):
+	_name(name),
+	_queueCapacity(queueCapacity > 0 ? queueCapacity : 1),
+	_stop(false)
+{
+	if (threads <= 0) threads = Environment::processorCount();
+	if (threads <= 0) threads = 1;
+	for (int i = 0; i < threads; ++i)
+	{
+		_workers.push_back(new Worker(*this, i));
+	}
+	for (int i = 0; i < threads; ++i)
+	{
+		std::string threadName(_name.empty() ? "WorkStealingThreadPool" : _name);
+		threadName += "[#";
+		threadName += NumberFormatter::format(i);
+		threadName += "]";
+		_workers[i]->_thread.setName(threadName);
+		_workers[i]->_thread.start(*_workers[i]);
+		poco_instrument_count("WorkStealingThreadPool.threads");
+	}
+}
+
+
+inline WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+	joinAll();
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_stop = true;
+	}
+	_taskAvailable.broadcast();
+	for (std::vector<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+	{
+		(*it)->_thread.join();
+		delete *it;
+	}
+}
+
+
+inline int WorkStealingThreadPool::capacity() const
+{
+	return static_cast<int>(_workers.size());
+}
+
+
+inline int WorkStealingThreadPool::used() const
+{
+	return _pending.value();
+}
+
+
+inline int WorkStealingThreadPool::available() const
+{
+	return _idle.value();
+}
+
+
+inline void WorkStealingThreadPool::start(Runnable& target)
+{
+	enqueue(target, -1);
+}
+
+
+inline void WorkStealingThreadPool::start(Runnable& target, const std::string& /*name*/)
+{
+	enqueue(target, -1);
+}
+
+
+inline void WorkStealingThreadPool::startWithPriority(Thread::Priority /*priority*/, Runnable& target)
+{
+	enqueue(target, -1);
+}
+
+
+inline bool WorkStealingThreadPool::tryStart(Runnable& target)
+{
+	return enqueue(target, 0);
+}
+
+
+inline bool WorkStealingThreadPool::tryStart(Runnable& target, long milliseconds)
+{
+	return enqueue(target, milliseconds);
+}
+
+
+inline void WorkStealingThreadPool::joinAll()
+{
+	FastMutex::ScopedLock lock(_mutex);
+	while (_pending.value() > 0) _allDone.wait(_mutex);
+}
+
+
+inline const std::string& WorkStealingThreadPool::name() const
+{
+	return _name;
+}
+
+
+inline WorkStealingThreadPool& WorkStealingThreadPool::defaultPool()
+{
+	static SingletonHolder<WorkStealingThreadPool> sh;
+	return *sh.get();
+}
+
+
+inline WorkStealingThreadPool::Worker* WorkStealingThreadPool::currentWorker() const
+{
+	Thread* pThread = Thread::current();
+	if (!pThread) return 0;
+	for (std::vector<Worker*>::const_iterator it = _workers.begin(); it != _workers.end(); ++it)
+	{
+		if (&(*it)->_thread == pThread) return *it;
+	}
+	return 0;
+}
+
+
+inline bool WorkStealingThreadPool::enqueue(Runnable& target, long milliseconds)
+{
+	++_pending;
+	Worker* pWorker = currentWorker();
+	if (pWorker && pWorker->_deque.push(&target))
+	{
+		if (_idle.value() > 0)
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_taskAvailable.signal();
+		}
+		return true;
+	}
+	FastMutex::ScopedLock lock(_mutex);
+	while (_queue.size() >= _queueCapacity)
+	{
+		// a worker must not block on the queue it drains
+		if (milliseconds == 0 || pWorker)
+		{
+			if (pWorker) break;
+			--_pending;
+			return false;
+		}
+		if (milliseconds < 0)
+		{
+			_roomAvailable.wait(_mutex);
+		}
+		else if (!_roomAvailable.tryWait(_mutex, milliseconds))
+		{
+			if (_queue.size() < _queueCapacity) break;
+			--_pending;
+			return false;
+		}
+	}
+	_queue.push_back(&target);
+	_taskAvailable.signal();
+	return true;
+}
+
+
+inline Runnable* WorkStealingThreadPool::take(Worker& worker)
+{
+	Runnable* pTarget = worker._deque.pop();
+	if (pTarget) return pTarget;
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_queue.empty())
+		{
+			pTarget = _queue.front();
+			_queue.pop_front();
+			_roomAvailable.signal();
+			return pTarget;
+		}
+	}
+	const std::size_t n = _workers.size();
+	for (std::size_t i = 1; i < n; ++i)
+	{
+		pTarget = _workers[(worker._index + i) % n]->_deque.steal();
+		if (pTarget) return pTarget;
+	}
+	return 0;
+}
+
+
+inline void WorkStealingThreadPool::run(Runnable* pTarget)
+{
+	try
+	{
+		pTarget->run();
+	}
+	catch (Exception& exc)
+	{
+		ErrorHandler::handle(exc);
+	}
+	catch (std::exception& exc)
+	{
+		ErrorHandler::handle(exc);
+	}
+	catch (...)
+	{
+		ErrorHandler::handle();
+	}
+	if (--_pending == 0)
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_allDone.broadcast();
+	}
+}
+
+
+inline void WorkStealingThreadPool::work(Worker& worker)
+{
+	if (!_name.empty()) ThreadAffinityRegistry::instance().pinCurrentThread(_name);
+	for (;;)
+	{
+		Runnable* pTarget = take(worker);
+		if (pTarget)
+		{
+			run(pTarget);
+			continue;
+		}
+		FastMutex::ScopedLock lock(_mutex);
+		if (_stop) return;
+		if (!_queue.empty()) continue;
+		++_idle;
+		// tasks pushed onto other workers' deques are only signalled
+		// while a worker is idle, so look again after a short while
+		_taskAvailable.tryWait(_mutex, 10);
+		--_idle;
+	}
+}
+
+
+} // namespace Poco
+
+
+#endif // Foundation_WorkStealingThreadPool_INCLUDED
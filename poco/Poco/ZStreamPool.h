@@ -0,0 +1,292 @@
+//
+// ZStreamPool.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Streams
+// Module:  ZStreamPool
+//
+// Definition of the ZStream and ZStreamPool classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_ZStreamPool_INCLUDED
+#define Foundation_ZStreamPool_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/InflatingStream.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <cstring>
+#if defined(POCO_UNBUNDLED)
+#include <zlib.h>
+#else
+#include "Poco/zlib.h"
+#endif
+
+
+namespace Poco {
+
+
+class ZStream
+	/// A ZStream owns a zlib z_stream, initialized for either
+	/// compression (deflateInit2()) or decompression (inflateInit2()),
+	/// together with a buffer for the compressed data.
+	///
+	/// Unlike DeflatingStreamBuf and InflatingStreamBuf, which initialize
+	/// and release their z_stream (and its window and hash tables, which
+	/// are several hundred KB for deflate) for every stream, a ZStream can
+	/// be reset() and reused for any number of streams with the same
+	/// parameters. ZStream objects are usually obtained from a ZStreamPool.
+{
+public:
+	enum Mode
+	{
+		ZSTREAM_DEFLATE, /// Compress with deflate().
+		ZSTREAM_INFLATE  /// Decompress with inflate().
+	};
+
+	enum
+	{
+		BUFFER_SIZE = 32768
+	};
+
+	ZStream(Mode mode, int windowBits, int level):
+		_mode(mode),
+		_windowBits(windowBits),
+		_level(level),
+		_buffer(new char[BUFFER_SIZE])
+		/// Creates and initializes the ZStream.
+		///
+		/// Please refer to the zlib documentation of deflateInit2() and
+		/// inflateInit2() for a description of the windowBits and level
+		/// parameters. The level is ignored for ZSTREAM_INFLATE.
+		///
+		/// Throws an IOException if zlib cannot be initialized.
+	{
+		std::memset(&_zstr, 0, sizeof(_zstr));
+		int rc;
+		if (mode == ZSTREAM_DEFLATE)
+			rc = deflateInit2(&_zstr, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+		else
+			rc = inflateInit2(&_zstr, windowBits);
+		if (rc != Z_OK)
+		{
+			delete [] _buffer;
+			throw IOException(zError(rc));
+		}
+	}
+
+	~ZStream()
+		/// Releases the z_stream.
+	{
+		if (_mode == ZSTREAM_DEFLATE)
+			deflateEnd(&_zstr);
+		else
+			inflateEnd(&_zstr);
+		delete [] _buffer;
+	}
+
+	void reset()
+		/// Resets the z_stream for a new stream with the same parameters,
+		/// using deflateReset() or inflateReset(), which keeps the
+		/// allocated state.
+	{
+		int rc = (_mode == ZSTREAM_DEFLATE) ? deflateReset(&_zstr) : inflateReset(&_zstr);
+		if (rc != Z_OK) throw IOException(zError(rc));
+		_zstr.next_in = 0;
+		_zstr.avail_in = 0;
+	}
+
+	z_stream& zstr()
+		/// Returns the z_stream.
+	{
+		return _zstr;
+	}
+
+	char* buffer()
+		/// Returns the buffer of BUFFER_SIZE bytes, for the
+		/// output of deflate() or the input of inflate().
+	{
+		return _buffer;
+	}
+
+	Mode mode() const
+	{
+		return _mode;
+	}
+
+	int windowBits() const
+	{
+		return _windowBits;
+	}
+
+	int level() const
+	{
+		return _level;
+	}
+
+private:
+	ZStream(const ZStream&);
+	ZStream& operator = (const ZStream&);
+
+	Mode _mode;
+	int _windowBits;
+	int _level;
+	char* _buffer;
+	z_stream _zstr;
+};
+
+
+class ZStreamPool
+	/// A ZStreamPool keeps idle ZStream objects with the same
+	/// parameters for reuse, so that compressing or decompressing a
+	/// small message (e.g., a RemotingNG request) does not have
+	/// to pay for the initialization of zlib.
+	///
+	/// At most capacity idle ZStream objects are kept. If no idle
+	/// ZStream is available, acquire() creates a new one.
+	///
+	/// For the common parameters, shared pools are available with
+	/// deflaters() and inflaters(). All member functions are thread-safe.
+{
+public:
+	ZStreamPool(ZStream::Mode mode, int windowBits, int level = Z_DEFAULT_COMPRESSION, std::size_t capacity = 16):
+		_mode(mode),
+		_windowBits(windowBits),
+		_level(level),
+		_capacity(capacity)
+		/// Creates the ZStreamPool.
+	{
+	}
+
+	~ZStreamPool()
+		/// Destroys the ZStreamPool and all idle ZStream objects.
+		/// All ZStream objects must have been released.
+	{
+		for (std::vector<ZStream*>::iterator it = _idle.begin(); it != _idle.end(); ++it)
+		{
+			delete *it;
+		}
+	}
+
+	ZStream* acquire()
+		/// Returns an idle ZStream, or a new one if none is available.
+		/// The ZStream must be given back with release().
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (!_idle.empty())
+			{
+				ZStream* pZStream = _idle.back();
+				_idle.pop_back();
+				return pZStream;
+			}
+		}
+		return new ZStream(_mode, _windowBits, _level);
+	}
+
+	void release(ZStream* pZStream)
+		/// Resets the given ZStream and keeps it for reuse,
+		/// or deletes it if the pool is full.
+	{
+		if (!pZStream) return;
+		try
+		{
+			pZStream->reset();
+			FastMutex::ScopedLock lock(_mutex);
+			if (_idle.size() < _capacity)
+			{
+				_idle.push_back(pZStream);
+				return;
+			}
+		}
+		catch (Exception&)
+		{
+		}
+		delete pZStream;
+	}
+
+	void trim(std::size_t maxIdle)
+		/// Deletes idle ZStream objects until at most
+		/// maxIdle are left.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		while (_idle.size() > maxIdle)
+		{
+			delete _idle.back();
+			_idle.pop_back();
+		}
+	}
+
+	std::size_t idle() const
+		/// Returns the number of idle ZStream objects.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _idle.size();
+	}
+
+	std::size_t capacity() const
+	{
+		return _capacity;
+	}
+
+	ZStream::Mode mode() const
+	{
+		return _mode;
+	}
+
+	static ZStreamPool& deflaters(DeflatingStreamBuf::StreamType type = DeflatingStreamBuf::STREAM_ZLIB)
+		/// Returns the shared pool for compressing zlib or gzip
+		/// streams with the default compression level.
+	{
+		static ZStreamPool* pZlib = new ZStreamPool(ZStream::ZSTREAM_DEFLATE, MAX_WBITS);
+		static ZStreamPool* pGzip = new ZStreamPool(ZStream::ZSTREAM_DEFLATE, MAX_WBITS + 16);
+		return type == DeflatingStreamBuf::STREAM_GZIP ? *pGzip : *pZlib;
+	}
+
+	static ZStreamPool& inflaters(InflatingStreamBuf::StreamType type = InflatingStreamBuf::STREAM_ZLIB)
+		/// Returns the shared pool for decompressing zlib or gzip
+		/// streams. For STREAM_ZIP, the pool decompresses raw
+		/// deflate data, without a header.
+	{
+		static ZStreamPool* pZlib = new ZStreamPool(ZStream::ZSTREAM_INFLATE, MAX_WBITS);
+		static ZStreamPool* pGzip = new ZStreamPool(ZStream::ZSTREAM_INFLATE, MAX_WBITS + 16);
+		static ZStreamPool* pRaw = new ZStreamPool(ZStream::ZSTREAM_INFLATE, -MAX_WBITS);
+		switch (type)
+		{
+		case InflatingStreamBuf::STREAM_GZIP:
+			return *pGzip;
+		case InflatingStreamBuf::STREAM_ZIP:
+			return *pRaw;
+		default:
+			return *pZlib;
+		}
+	}
+
+private:
+	ZStreamPool(const ZStreamPool&);
+	ZStreamPool& operator = (const ZStreamPool&);
+
+	ZStream::Mode _mode;
+	int _windowBits;
+	int _level;
+	std::size_t _capacity;
+	std::vector<ZStream*> _idle;
+	mutable FastMutex _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_ZStreamPool_INCLUDED
@@ -0,0 +1,230 @@
+//
+// OrderedTaskRunner.h
+//
+// $Id$
+//
+// Library: Zip
+// Package: Zip
+// Module:  OrderedTaskRunner
+//
+// Definition of the OrderedTaskRunner class.
+//
+// Copyright (c) 2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Zip_OrderedTaskRunner_INCLUDED
+#define Zip_OrderedTaskRunner_INCLUDED
+
+
+#include "Poco/Zip/Zip.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/Runnable.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/ScopedUnlock.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+namespace Poco {
+namespace Zip {
+
+
+class OrderedTaskRunner
+	/// OrderedTaskRunner processes a number of independent items, like
+	/// the entries of a Zip archive, with threads from a ThreadPool,
+	/// and completes them in their original order on the calling thread.
+	///
+	/// Subclasses implement process(), which is called for every
+	/// item on an arbitrary thread, and complete(), which is called
+	/// for every processed item on the thread calling run(), in order
+	/// of the items. The calling thread processes items as well, so
+	/// run() also works when the pool has no threads available.
+	///
+	/// The number of items that have been processed, but not yet been
+	/// completed, is limited by the window given to run(), which bounds
+	/// the memory used for buffered results.
+{
+public:
+	OrderedTaskRunner():
+		_count(0),
+		_window(0),
+		_next(0),
+		_completed(0),
+		_running(0),
+		_stop(false)
+	{
+	}
+
+	virtual ~OrderedTaskRunner()
+	{
+	}
+
+	void run(std::size_t count, Poco::ThreadPool& pool, int maxThreads, std::size_t window)
+		/// Processes items 0 to count - 1, using up to maxThreads threads
+		/// from the given pool in addition to the calling thread, and
+		/// at most window items ahead of the first item not completed.
+		///
+		/// If complete() throws, no more items are started and the
+		/// exception is rethrown once all threads have finished.
+		/// process() must not throw.
+	{
+		poco_assert (window > 0);
+
+		_count = count;
+		_window = window;
+		_next = 0;
+		_completed = 0;
+		_running = 0;
+		_stop = false;
+		_done.assign(count, false);
+
+		std::size_t threads = maxThreads > 0 ? static_cast<std::size_t>(maxThreads) : 0;
+		if (threads > count) threads = count;
+		if (threads > window) threads = window;
+		std::vector<Worker> workers(threads, Worker(*this));
+		for (std::size_t i = 0; i < threads; ++i)
+		{
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				++_running;
+			}
+			try
+			{
+				pool.start(workers[i]);
+			}
+			catch (Poco::NoThreadAvailableException&)
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				--_running;
+				break;
+			}
+		}
+
+		try
+		{
+			drain();
+		}
+		catch (...)
+		{
+			stop();
+			throw;
+		}
+		stop();
+	}
+
+protected:
+	virtual void process(std::size_t index) = 0;
+		/// Processes the item with the given index. Called on
+		/// an arbitrary thread. Must not throw.
+
+	virtual void complete(std::size_t index) = 0;
+		/// Completes the item with the given index, after it has
+		/// been processed. Called on the thread calling run(),
+		/// in order of the items.
+
+	class Worker: public Poco::Runnable
+	{
+	public:
+		Worker(OrderedTaskRunner& runner):
+			_pRunner(&runner)
+		{
+		}
+
+		void run()
+		{
+			_pRunner->work();
+		}
+
+	private:
+		OrderedTaskRunner* _pRunner;
+	};
+
+	bool canStart() const
+	{
+		return !_stop && _next < _count && _next < _completed + _window;
+	}
+
+	void work()
+		/// Processes items until all items have been started.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (;;)
+		{
+			while (!_stop && _next < _count && !canStart()) _condition.wait(_mutex);
+			if (!canStart()) break;
+			std::size_t index = _next++;
+			{
+				Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+				process(index);
+			}
+			_done[index] = true;
+			_condition.broadcast();
+		}
+		--_running;
+		_condition.broadcast();
+	}
+
+	void drain()
+		/// Completes all items in order, processing
+		/// items while none can be completed.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		while (_completed < _count)
+		{
+			if (_done[_completed])
+			{
+				std::size_t index = _completed;
+				{
+					Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+					complete(index);
+				}
+				++_completed;
+				_condition.broadcast();
+			}
+			else if (canStart())
+			{
+				std::size_t index = _next++;
+				{
+					Poco::ScopedUnlock<Poco::FastMutex> unlock(_mutex);
+					process(index);
+				}
+				_done[index] = true;
+			}
+			else _condition.wait(_mutex);
+		}
+	}
+
+	void stop()
+		/// Stops starting new items and waits for all threads.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_stop = true;
+		_condition.broadcast();
+		while (_running > 0) _condition.wait(_mutex);
+	}
+
+private:
+	OrderedTaskRunner(const OrderedTaskRunner&);
+	OrderedTaskRunner& operator = (const OrderedTaskRunner&);
+
+	std::size_t _count;
+	std::size_t _window;
+	std::size_t _next;
+	std::size_t _completed;
+	std::size_t _running;
+	bool _stop;
+	std::vector<bool> _done;
+	Poco::FastMutex _mutex;
+	Poco::Condition _condition;
+};
+
+
+} } // namespace Poco::Zip
+
+
+#endif // Zip_OrderedTaskRunner_INCLUDED
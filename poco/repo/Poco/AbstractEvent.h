@@ -24,7 +24,13 @@
 #include "Poco/SingletonHolder.h"
 #include "Poco/SharedPtr.h"
 #include "Poco/Mutex.h"
+#include "Poco/Instrumentation.h"
+#include "Poco/Tracer.h"
 #include "Poco/AbstractEventMonitor.h"
+#if defined(POCO_BATCHED_NOTIFY_ASYNC)
+#include "Poco/BatchingActiveDispatcher.h"
+#endif
+#include <typeinfo>
 
 namespace Poco {
 
@@ -240,15 +246,13 @@ public:
 		// copy should be faster and safer than blocking until
 		// execution ends
 		TStrategy strategy(_strategy);
+		poco_instrument_scope("AbstractEvent.notify");
+		poco_trace_scope("event", typeid(TArgs).name());
 		if(monitored){
-			Thread monitorThread;
 			AbstractEventMonitor monitor(timeout);
-			monitorThread.start(monitor);
 			lock.unlock();
 			strategy.notify(pSender, args);
 			monitor.finished();
-			monitorThread.wakeUp();
-			monitorThread.join();
 		} else {
 			lock.unlock();
 			strategy.notify(pSender, args);
@@ -381,13 +385,9 @@ protected:
 		TArgs retArgs(params.args);
 
 		if(params.timeout > 0){
-			Thread monitorThread;
 			AbstractEventMonitor monitor(params.timeout);
-			monitorThread.start(monitor);
 			params.ptrStrat->notify(params.pSender, retArgs);
 			monitor.finished();
-			monitorThread.wakeUp();
-			monitorThread.join();
 		} else {
 			params.ptrStrat->notify(params.pSender, retArgs);
 		}
@@ -499,15 +499,13 @@ public:
 		// copy should be faster and safer than blocking until
 		// execution ends
 		TStrategy strategy(_strategy);
+		poco_instrument_scope("AbstractEvent.notify");
+		poco_trace_scope("event", "void");
 		if(monitored){
-			Thread monitorThread;
 			AbstractEventMonitor monitor(timeout);
-			monitorThread.start(monitor);
 			lock.unlock();
 			strategy.notify(pSender);
 			monitor.finished();
-			monitorThread.wakeUp();
-			monitorThread.join();
 		} else {
 			lock.unlock();
 			strategy.notify(pSender);
@@ -633,13 +631,9 @@ protected:
 		NotifyAsyncParams params = par;
 
 		if(params.timeout > 0){
-			Thread monitorThread;
 			AbstractEventMonitor monitor(params.timeout);
-			monitorThread.start(monitor);
 			params.ptrStrat->notify(params.pSender);
 			monitor.finished();
-			monitorThread.wakeUp();
-			monitorThread.join();
 		} else {
 			params.ptrStrat->notify(params.pSender);
 		}
@@ -657,6 +651,27 @@ private:
 };
 
 
+#if defined(POCO_BATCHED_NOTIFY_ASYNC)
+
+
+template <class TArgs, class TStrategy, class TDelegate, class TMutex>
+class ActiveStarter<AbstractEvent<TArgs, TStrategy, TDelegate, TMutex> >
+	/// Runs notifyAsync() on the default BatchingActiveDispatcher,
+	/// so that a burst of asynchronous notifications is delivered
+	/// with a single wakeup, in the order they were fired, instead
+	/// of each taking a thread from the default ThreadPool.
+{
+public:
+	static void start(AbstractEvent<TArgs, TStrategy, TDelegate, TMutex>* /*pOwner*/, ActiveRunnableBase::Ptr pRunnable)
+	{
+		BatchingActiveDispatcher::defaultDispatcher().start(pRunnable);
+	}
+};
+
+
+#endif // POCO_BATCHED_NOTIFY_ASYNC
+
+
 } // namespace Poco
 
 
@@ -4,30 +4,125 @@
 #include "Poco/ActiveResult.h"
 #include "Poco/ActiveMethod.h"
 #include "Poco/Logger.h"
+#include "Poco/LoggerCache.h"
+#include "Poco/Clock.h"
+#include "Poco/Event.h"
+#include "Poco/Thread.h"
+#include "Poco/SingletonHolder.h"
 #include <stdlib.h>
 
-class AbstractEventMonitor: public Poco::Runnable{
+class AbstractEventWatchdog: public Poco::Runnable{
+    /// A single, process-wide watchdog thread tracking the deadlines of
+    /// all in-flight monitored notifications.
+    ///
+    /// Monitored notifications link an Entry (owned by the notifying
+    /// thread, no allocation) into an intrusive list. The watchdog thread
+    /// wakes up once per tick and aborts the process if any entry has
+    /// passed its deadline, which preserves the abort-on-timeout semantics
+    /// of the former thread-per-notification monitor.
 public:
-    AbstractEventMonitor(const long& timeout): _finished(false), _timeout(timeout), _logger(Poco::Logger::get("EMON")){}
-    ~AbstractEventMonitor(){}
-    void run(){
-        Poco::Thread::trySleep(_timeout);
+    struct Entry{
+        Poco::Clock deadline;
+        Entry* prev;
+        Entry* next;
+        Entry(): prev(0), next(0){}
+    };
+
+    enum{
+        DEFAULT_TICK = 100 /// Scan interval in milliseconds.
+    };
+
+    AbstractEventWatchdog(): _tick(DEFAULT_TICK), _started(false), _stop(false){
+        _head.prev = &_head;
+        _head.next = &_head;
+    }
+
+    ~AbstractEventWatchdog(){
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            if(!_started) return;
+            _stop = true;
+        }
+        _wakeUp.set();
+        _thread.join();
+    }
+
+    static AbstractEventWatchdog& instance(){
+        static Poco::SingletonHolder<AbstractEventWatchdog> sh;
+        return *sh.get();
+    }
+
+    void add(Entry& entry, long timeout){
+        entry.deadline += static_cast<Poco::Clock::ClockDiff>(timeout)*1000;
         Poco::FastMutex::ScopedLock lock(_mutex);
-        if(!_finished) {
-		_logger.error("Aborting. Reason: Event timeout!");
-		abort();
+        entry.prev = _head.prev;
+        entry.next = &_head;
+        _head.prev->next = &entry;
+        _head.prev = &entry;
+        if(!_started){
+            _started = true;
+            _thread.setName("EMON");
+            _thread.start(*this);
         }
     }
 
-    void finished(){
+    void remove(Entry& entry){
         Poco::FastMutex::ScopedLock lock(_mutex);
-        _finished = true;
+        if(!entry.next) return;
+        entry.prev->next = entry.next;
+        entry.next->prev = entry.prev;
+        entry.prev = 0;
+        entry.next = 0;
     }
+
+    void run(){
+        for(;;){
+            _wakeUp.tryWait(_tick);
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            if(_stop) return;
+            Poco::Clock now;
+            for(Entry* e = _head.next; e != &_head; e = e->next){
+                if(e->deadline < now){
+                    Poco::LoggerCache::get("EMON").error("Aborting. Reason: Event timeout!");
+                    abort();
+                }
+            }
+        }
+    }
+
 private:
-    volatile bool _finished;
-    const long& _timeout;
+    AbstractEventWatchdog(const AbstractEventWatchdog&);
+    AbstractEventWatchdog& operator = (const AbstractEventWatchdog&);
+
+    long _tick;
+    bool _started;
+    bool _stop;
+    Entry _head;
     Poco::FastMutex _mutex;
-    Poco::Logger& _logger;
+    Poco::Event _wakeUp;
+    Poco::Thread _thread;
+};
+
+class AbstractEventMonitor{
+    /// Scoped registration of a monitored notification with the shared
+    /// AbstractEventWatchdog. The deadline is armed on construction and
+    /// disarmed by finished() or, if a delegate throws, by the destructor.
+public:
+    AbstractEventMonitor(long timeout){
+        AbstractEventWatchdog::instance().add(_entry, timeout);
+    }
+    ~AbstractEventMonitor(){
+        finished();
+    }
+
+    void finished(){
+        AbstractEventWatchdog::instance().remove(_entry);
+    }
+private:
+    AbstractEventMonitor(const AbstractEventMonitor&);
+    AbstractEventMonitor& operator = (const AbstractEventMonitor&);
+
+    AbstractEventWatchdog::Entry _entry;
 };
 
 #endif // ABSTRACTEVENTMONITOR_H
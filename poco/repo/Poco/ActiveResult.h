@@ -25,12 +25,132 @@
 #include "Poco/Event.h"
 #include "Poco/RefCountedObject.h"
 #include "Poco/Exception.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/AtomicCounter.h"
 #include <algorithm>
+#include <vector>
+#include <map>
 
 
 namespace Poco {
 
 
+class ActiveContinuation: public RefCountedObject
+	/// The base class for functions registered with
+	/// ActiveResult::then().
+{
+public:
+	typedef AutoPtr<ActiveContinuation> Ptr;
+
+	virtual void invoke() = 0;
+		/// Invoked once the result is available.
+
+protected:
+	~ActiveContinuation()
+	{
+	}
+};
+
+
+class ActiveContinuations
+	/// The continuations registered with ActiveResult::then(), for
+	/// all ActiveResultHolder objects of the process.
+	///
+	/// The continuations are kept in a table keyed by the address of the
+	/// holder, not in the holder itself, so that the layout of the
+	/// ActiveResultHolder class, which is shared with the compiled
+	/// libraries (e.g. by Statement::executeAsync()), does not change.
+	/// A registered continuation keeps a reference to its holder, so
+	/// the holder cannot be destroyed and its address reused while an
+	/// entry for it exists. As long as no continuation is pending,
+	/// complete() does not acquire the mutex.
+{
+public:
+	template <class Holder>
+	static void add(Holder* pHolder, const ActiveContinuation::Ptr& pContinuation)
+		/// Registers the continuation for the given holder, or invokes
+		/// it immediately if the result is available.
+	{
+		ActiveContinuations& table = instance();
+		++table._pending;
+		{
+			FastMutex::ScopedLock lock(table._mutex);
+			if (!pHolder->tryWait(0))
+			{
+				table._map[pHolder].push_back(pContinuation);
+				return;
+			}
+		}
+		--table._pending;
+		ActiveContinuation::Ptr pInvoke(pContinuation);
+		invoke(*pInvoke);
+	}
+
+	static void complete(const void* pHolder)
+		/// Invokes all continuations registered for the given
+		/// holder. Must be called after the result has been made
+		/// available.
+	{
+		ActiveContinuations& table = instance();
+		if (table._pending.value() == 0) return;
+		std::vector<ActiveContinuation::Ptr> continuations;
+		{
+			FastMutex::ScopedLock lock(table._mutex);
+			Map::iterator it = table._map.find(pHolder);
+			if (it == table._map.end()) return;
+			continuations.swap(it->second);
+			table._map.erase(it);
+		}
+		for (std::vector<ActiveContinuation::Ptr>::iterator it = continuations.begin(); it != continuations.end(); ++it)
+		{
+			--table._pending;
+			invoke(**it);
+		}
+	}
+
+private:
+	typedef std::map<const void*, std::vector<ActiveContinuation::Ptr> > Map;
+
+	ActiveContinuations()
+	{
+	}
+
+	ActiveContinuations(const ActiveContinuations&);
+	ActiveContinuations& operator = (const ActiveContinuations&);
+
+	static ActiveContinuations& instance()
+	{
+		static ActiveContinuations table;
+		return table;
+	}
+
+	static void invoke(ActiveContinuation& continuation)
+	{
+		try
+		{
+			continuation.invoke();
+		}
+		catch (Exception& exc)
+		{
+			ErrorHandler::handle(exc);
+		}
+		catch (std::exception& exc)
+		{
+			ErrorHandler::handle(exc);
+		}
+		catch (...)
+		{
+			ErrorHandler::handle();
+		}
+	}
+
+	AtomicCounter _pending;
+	Map           _map;
+	FastMutex     _mutex;
+};
+
+
 template <class ResultType>
 class ActiveResultHolder: public RefCountedObject
 	/// This class holds the result of an asynchronous method
@@ -84,9 +204,11 @@ public:
 	}
 	
 	void notify()
-		/// Notifies the invoking thread that the result became available.
+		/// Notifies the invoking thread that the result became available,
+		/// and invokes the registered continuations.
 	{
 		_event.set();
+		ActiveContinuations::complete(this);
 	}
 	
 	bool failed() const
@@ -177,9 +299,11 @@ public:
 	}
 	
 	void notify()
-		/// Notifies the invoking thread that the result became available.
+		/// Notifies the invoking thread that the result became available,
+		/// and invokes the registered continuations.
 	{
 		_event.set();
+		ActiveContinuations::complete(this);
 	}
 	
 	bool failed() const
@@ -233,6 +357,85 @@ private:
 };
 
 
+template <class TResult, class Fn>
+class ActiveResultContinuation: public ActiveContinuation
+	/// The continuation registered by ActiveResult::then(fn).
+{
+public:
+	ActiveResultContinuation(const TResult& result, const Fn& fn):
+		_result(result),
+		_fn(fn)
+	{
+	}
+
+	void invoke()
+	{
+		_fn(_result);
+	}
+
+protected:
+	~ActiveResultContinuation()
+	{
+	}
+
+private:
+	TResult _result;
+	Fn _fn;
+};
+
+
+template <class TResult, class TNext, class Fn>
+class ActiveResultMapping: public ActiveContinuation
+	/// The continuation registered by ActiveResult::then<NRT>(fn).
+{
+public:
+	ActiveResultMapping(const TResult& result, const TNext& next, const Fn& fn):
+		_result(result),
+		_next(next),
+		_fn(fn)
+	{
+	}
+
+	void invoke()
+	{
+		if (_result.failed())
+		{
+			_next.error(*_result.exception());
+		}
+		else
+		{
+			try
+			{
+				_next.data(new typename TNext::ResultType(_fn(_result)));
+			}
+			catch (Exception& exc)
+			{
+				_next.error(exc);
+			}
+			catch (std::exception& exc)
+			{
+				_next.error(std::string(exc.what()));
+			}
+			catch (...)
+			{
+				_next.error(std::string("unknown exception"));
+			}
+		}
+		_next.notify();
+	}
+
+protected:
+	~ActiveResultMapping()
+	{
+	}
+
+private:
+	TResult _result;
+	TNext _next;
+	Fn _fn;
+};
+
+
 template <class RT>
 class ActiveResult
 	/// This class holds the result of an asynchronous method
@@ -364,6 +567,36 @@ public:
 		_pHolder->error(exc);
 	}
 	
+	template <class Fn>
+	void then(const Fn& fn)
+		/// Calls fn(result), where result is a copy of this ActiveResult,
+		/// once the result is available, successfully or not. fn is
+		/// called in the thread that completes the method, or in the
+		/// calling thread if the result is already available, and must
+		/// not block. Exceptions thrown by fn go to the ErrorHandler.
+		///
+		/// Unlike wait(), then() does not block a thread until the
+		/// result is available. fn is only called for a result that
+		/// is completed by code compiled with this version of
+		/// ActiveResult.h.
+	{
+		ActiveContinuations::add(_pHolder, new ActiveResultContinuation<ActiveResult, Fn>(*this, fn));
+	}
+
+	template <class NRT, class Fn>
+	ActiveResult<NRT> then(const Fn& fn)
+		/// Returns an ActiveResult<NRT> holding fn(result), computed as
+		/// with then(fn) once this result is available. If this result
+		/// failed, fn is not called and the returned result fails with
+		/// the same exception. NRT must not be void.
+		///
+		///     activeObject.compute(42).then<std::string>(&format);
+	{
+		ActiveResult<NRT> next(new ActiveResultHolder<NRT>());
+		ActiveContinuations::add(_pHolder, new ActiveResultMapping<ActiveResult, ActiveResult<NRT>, Fn>(*this, next, fn));
+		return next;
+	}
+
 private:
 	ActiveResult();
 
@@ -484,6 +717,36 @@ public:
 		_pHolder->error(exc);
 	}
 	
+	template <class Fn>
+	void then(const Fn& fn)
+		/// Calls fn(result), where result is a copy of this ActiveResult,
+		/// once the result is available, successfully or not. fn is
+		/// called in the thread that completes the method, or in the
+		/// calling thread if the result is already available, and must
+		/// not block. Exceptions thrown by fn go to the ErrorHandler.
+		///
+		/// Unlike wait(), then() does not block a thread until the
+		/// result is available. fn is only called for a result that
+		/// is completed by code compiled with this version of
+		/// ActiveResult.h.
+	{
+		ActiveContinuations::add(_pHolder, new ActiveResultContinuation<ActiveResult, Fn>(*this, fn));
+	}
+
+	template <class NRT, class Fn>
+	ActiveResult<NRT> then(const Fn& fn)
+		/// Returns an ActiveResult<NRT> holding fn(result), computed as
+		/// with then(fn) once this result is available. If this result
+		/// failed, fn is not called and the returned result fails with
+		/// the same exception. NRT must not be void.
+		///
+		///     activeObject.compute(42).then<std::string>(&format);
+	{
+		ActiveResult<NRT> next(new ActiveResultHolder<NRT>());
+		ActiveContinuations::add(_pHolder, new ActiveResultMapping<ActiveResult, ActiveResult<NRT>, Fn>(*this, next, fn));
+		return next;
+	}
+
 private:
 	ActiveResult();
 
@@ -7,7 +7,7 @@
 // Package: Threading
 // Module:  ActiveObjects
 //
-// Definition of the ActiveStarter class.
+// Definition of the ActiveStarter and RetainingActiveStarter classes.
 //
 // Copyright (c) 2006-2007, Applied Informatics Software Engineering GmbH.
 // and Contributors.
@@ -23,6 +23,7 @@
 #include "Poco/Foundation.h"
 #include "Poco/ThreadPool.h"
 #include "Poco/ActiveRunnable.h"
+#include "Poco/AutoPtr.h"
 
 
 namespace Poco {
@@ -44,6 +45,49 @@ public:
 };
 
 
+template <class OwnerType>
+class RetainingActiveStarter
+	/// An implementation of the StarterType policy for ActiveMethod
+	/// that, like ActiveStarter, starts the method in a thread of the
+	/// default thread pool, but keeps a reference to the owner, which
+	/// must be a RefCountedObject, until the method has completed.
+	///
+	/// The owner therefore cannot be destroyed while an invocation is
+	/// still running. If the last reference to the owner is released
+	/// by the invocation, the owner is destroyed in the pool thread.
+{
+public:
+	static void start(OwnerType* pOwner, ActiveRunnableBase::Ptr pRunnable)
+	{
+		ActiveRunnableBase::Ptr pRetaining = new Runnable(pOwner, pRunnable);
+		ThreadPool::defaultPool().start(*pRetaining);
+		pRetaining->duplicate(); // The runnable will release itself.
+	}
+
+private:
+	class Runnable: public ActiveRunnableBase
+	{
+	public:
+		Runnable(OwnerType* pOwner, ActiveRunnableBase::Ptr pRunnable):
+			_pOwner(pOwner, true),
+			_pRunnable(pRunnable)
+		{
+		}
+
+		void run()
+		{
+			ActiveRunnableBase::Ptr guard(this, false); // ensure automatic release when done
+			_pRunnable->duplicate(); // The runnable will release itself.
+			_pRunnable->run();
+		}
+
+	private:
+		AutoPtr<OwnerType> _pOwner;
+		ActiveRunnableBase::Ptr _pRunnable;
+	};
+};
+
+
 } // namespace Poco
 
 
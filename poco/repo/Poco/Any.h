@@ -41,7 +41,7 @@ template <class> class VarHolderImpl;
 
 #ifndef POCO_NO_SOO
 
-#ifndef POCO_ENABLE_CPP11
+#if !defined(POCO_ENABLE_CPP11) && __cplusplus < 201103L
 	// C++11 needed for std::aligned_storage
 	#error "Any SOO can only be enabled with C++11 support"
 #endif
@@ -191,13 +191,7 @@ public:
 		/// Destructor. If Any is locally held, calls ValueHolder destructor;
 		/// otherwise, deletes the placeholder from the heap.
 	{
-		if (!empty())
-		{
-			if (_valueHolder.isLocal())
-				destruct();
-			else
-				delete content();
-		}
+		clear();
 	}
 
 	Any& swap(Any& other)
@@ -218,12 +212,13 @@ public:
 			Any tmp(*this);
 			try
 			{
-				if (_valueHolder.isLocal()) destruct();
+				clear();
 				construct(other);
 				other = tmp;
 			}
 			catch (...)
 			{
+				clear();
 				construct(tmp);
 				throw;
 			}
@@ -240,18 +235,19 @@ public:
 		///   Any a = 13; 
 		///   Any a = string("12345");
 	{
-		construct(rhs);
+		Any tmp(rhs);
+		swap(tmp);
 		return *this;
 	}
 	
 	Any& operator = (const Any& rhs)
 		/// Assignment operator for Any.
 	{
-		if ((this != &rhs) && !rhs.empty())
+		if (this != &rhs)
+		{
+			clear();
 			construct(rhs);
-		else if ((this != &rhs) && rhs.empty())
-			_valueHolder.erase();
-
+		}
 		return *this;
 	}
 	
@@ -351,6 +347,20 @@ private:
 		content()->~ValueHolder();
 	}
 
+	void clear()
+		/// Destroys the held value, wherever it is allocated,
+		/// and leaves the Any empty.
+	{
+		if (!empty())
+		{
+			if (_valueHolder.isLocal())
+				destruct();
+			else
+				delete content();
+			_valueHolder.erase();
+		}
+	}
+
 	Placeholder<ValueHolder> _valueHolder;
 
 
@@ -0,0 +1,412 @@
+//
+// AsyncDLTChannel.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  AsyncDLTChannel
+//
+// Definition of the AsyncDLTChannel class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_AsyncDLTChannel_INCLUDED
+#define Foundation_AsyncDLTChannel_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Channel.h"
+#include "Poco/Message.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Mutex.h"
+#include "Poco/NumberParser.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/RingNotificationQueue.h"
+#include "Poco/Exception.h"
+#include <dlt.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+
+
+namespace Poco {
+
+
+class AsyncDLTChannel: public Channel, public Runnable
+	/// A DLT channel for logging from time critical threads.
+	///
+	/// Unlike DLTChannel, log() does not write to DLT itself, but
+	/// copies the message text into a bounded, lock-free ring of
+	/// records, from which a dedicated writer thread passes them to
+	/// DLT. The DltContext for a message source is looked up in a
+	/// lock-free hash table, so it is only derived from the logger
+	/// name and registered on the first message of each logger, and
+	/// priorities are mapped with a fixed table.
+	///
+	/// If the ring is full, messages are dropped rather than blocking
+	/// the logging thread; dropped() returns the number of messages
+	/// lost that way. Messages longer than the maximum length are
+	/// truncated.
+	///
+	/// The context ID is derived like DLTChannel does: logger names
+	/// containing a period (bundle names) use the default context
+	/// "AFW", other names are truncated to four characters.
+	///
+	/// The following properties are supported:
+	///   * appid:     The DLT application ID (default "APP").
+	///   * capacity:  The number of records in the ring (default 1024),
+	///                must be set before the channel is opened.
+	///   * maxLength: The maximum length of a message (default 512),
+	///                must be set before the channel is opened.
+	///
+	/// A process should either use DLTChannel or AsyncDLTChannel,
+	/// since both register the DLT application.
+{
+public:
+	typedef AutoPtr<AsyncDLTChannel> Ptr;
+
+	enum
+	{
+		DEFAULT_CAPACITY   = 1024,
+		DEFAULT_MAX_LENGTH = 512,
+		CONTEXT_SLOTS      = 256
+	};
+
+	AsyncDLTChannel():
+		_appID("APP"),
+		_capacity(DEFAULT_CAPACITY),
+		_maxLength(DEFAULT_MAX_LENGTH),
+		_mask(0),
+		_enqueuePos(0),
+		_dequeuePos(0),
+		_dropped(0),
+		_open(false),
+		_stop(false)
+		/// Creates the AsyncDLTChannel.
+	{
+		for (int i = 0; i < CONTEXT_SLOTS; ++i) _slots[i] = 0;
+	}
+
+	void open()
+		/// Registers the DLT application and starts the writer thread.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (_open) return;
+		std::size_t capacity = 2;
+		while (capacity < _capacity) capacity <<= 1;
+		_records.assign(capacity, Record());
+		_text.assign(capacity*(_maxLength + 1), '\0');
+		for (std::size_t i = 0; i < capacity; ++i)
+		{
+			_records[i].sequence = static_cast<long>(i);
+		}
+		_mask = capacity - 1;
+		_enqueuePos = _dequeuePos = 0;
+		dlt_register_app(_appID.c_str(), _appID.c_str());
+		_stop = false;
+		_thread.setName("AsyncDLTChannel");
+		_thread.start(*this);
+		_open = true;
+	}
+
+	void close()
+		/// Writes the queued messages, stops the writer thread and
+		/// unregisters all contexts and the DLT application.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_open) return;
+		_open = false;
+		_stop = true;
+		_notEmpty.notify(true);
+		_thread.join();
+		for (int i = 0; i < CONTEXT_SLOTS; ++i)
+		{
+			delete _slots[i];
+			_slots[i] = 0;
+		}
+		for (ContextMap::iterator it = _contexts.begin(); it != _contexts.end(); ++it)
+		{
+			dlt_unregister_context(it->second);
+			delete it->second;
+		}
+		_contexts.clear();
+		dlt_unregister_app();
+	}
+
+	void log(const Message& msg)
+		/// Queues the message for the writer thread, or drops it
+		/// if the ring is full or the channel is not open.
+	{
+		if (!_open)
+		{
+			__sync_fetch_and_add(&_dropped, 1);
+			return;
+		}
+		DltContext* pContext = context(msg.getSource());
+		long pos = _enqueuePos;
+		Record* pRecord;
+		for (;;)
+		{
+			pRecord = &_records[pos & _mask];
+			long sequence = pRecord->sequence;
+			__sync_synchronize();
+			long diff = sequence - pos;
+			if (diff == 0)
+			{
+				if (__sync_bool_compare_and_swap(&_enqueuePos, pos, pos + 1)) break;
+				pos = _enqueuePos;
+			}
+			else if (diff < 0)
+			{
+				__sync_fetch_and_add(&_dropped, 1);
+				return;
+			}
+			else pos = _enqueuePos;
+		}
+		const std::string& text = msg.getText();
+		std::size_t length = text.size() < _maxLength ? text.size() : _maxLength;
+		char* pText = &_text[(pos & _mask)*(_maxLength + 1)];
+		std::memcpy(pText, text.data(), length);
+		pText[length] = '\0';
+		pRecord->pContext = pContext;
+		pRecord->level    = logLevel(msg.getPriority());
+		__sync_synchronize();
+		pRecord->sequence = pos + 1;
+		_notEmpty.notify();
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+		/// Sets the property with the given name to the given value.
+	{
+		if (name == "appid")
+			_appID = value;
+		else if (name == "capacity")
+			_capacity = NumberParser::parseUnsigned(value);
+		else if (name == "maxLength")
+			_maxLength = NumberParser::parseUnsigned(value);
+		else
+			Channel::setProperty(name, value);
+	}
+
+	std::string getProperty(const std::string& name) const
+		/// Returns the value of the property with the given name.
+	{
+		if (name == "appid")
+			return _appID;
+		else if (name == "capacity")
+			return NumberFormatter::format(_capacity);
+		else if (name == "maxLength")
+			return NumberFormatter::format(_maxLength);
+		else
+			return Channel::getProperty(name);
+	}
+
+	long dropped() const
+		/// Returns the number of messages dropped because
+		/// the ring was full or the channel was not open.
+	{
+		return _dropped;
+	}
+
+	static DltLogLevelType logLevel(Message::Priority prio)
+		/// Returns the DLT log level for the given priority.
+	{
+		static const DltLogLevelType levels[] =
+		{
+			DLT_LOG_OFF,     // unused
+			DLT_LOG_FATAL,   // PRIO_FATAL
+			DLT_LOG_FATAL,   // PRIO_CRITICAL
+			DLT_LOG_ERROR,   // PRIO_ERROR
+			DLT_LOG_WARN,    // PRIO_WARNING
+			DLT_LOG_INFO,    // PRIO_NOTICE
+			DLT_LOG_INFO,    // PRIO_INFORMATION
+			DLT_LOG_DEBUG,   // PRIO_DEBUG
+			DLT_LOG_VERBOSE  // PRIO_TRACE
+		};
+		int i = static_cast<int>(prio);
+		return (i > 0 && i <= Message::PRIO_TRACE) ? levels[i] : DLT_LOG_INFO;
+	}
+
+	static std::string contextID(const std::string& source)
+		/// Returns the DLT context ID for the given logger name.
+	{
+		if (source.find('.') != std::string::npos)
+			return "AFW";
+		else
+			return source.substr(0, 4);
+	}
+
+protected:
+	~AsyncDLTChannel()
+		/// Destroys the AsyncDLTChannel.
+	{
+		try
+		{
+			close();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void run()
+	{
+		for (;;)
+		{
+			if (!writeNext())
+			{
+				if (_stop) break;
+				EventCount::Key key = _notEmpty.prepareWait();
+				if (_stop || recordReady())
+				{
+					_notEmpty.cancelWait();
+					continue;
+				}
+				_notEmpty.wait(key);
+			}
+		}
+	}
+
+private:
+	struct Record
+	{
+		Record():
+			sequence(0),
+			pContext(0),
+			level(DLT_LOG_INFO)
+		{
+		}
+
+		volatile long   sequence;
+		DltContext*     pContext;
+		DltLogLevelType level;
+	};
+
+	struct ContextEntry
+	{
+		ContextEntry(const std::string& src, DltContext* pCtx):
+			source(src),
+			pContext(pCtx)
+		{
+		}
+
+		std::string source;
+		DltContext* pContext;
+	};
+
+	typedef std::map<std::string, DltContext*> ContextMap;
+
+	AsyncDLTChannel(const AsyncDLTChannel&);
+	AsyncDLTChannel& operator = (const AsyncDLTChannel&);
+
+	static unsigned hash(const std::string& source)
+	{
+		unsigned h = 2166136261u;
+		for (std::string::const_iterator it = source.begin(); it != source.end(); ++it)
+		{
+			h = (h ^ static_cast<unsigned char>(*it))*16777619u;
+		}
+		return h;
+	}
+
+	DltContext* context(const std::string& source)
+	{
+		unsigned h = hash(source);
+		for (int i = 0; i < CONTEXT_SLOTS; ++i)
+		{
+			ContextEntry* pEntry = _slots[(h + i) % CONTEXT_SLOTS];
+			__sync_synchronize();
+			if (!pEntry) break;
+			if (pEntry->source == source) return pEntry->pContext;
+		}
+		return registerContext(source, h);
+	}
+
+	DltContext* registerContext(const std::string& source, unsigned h)
+	{
+		FastMutex::ScopedLock lock(_contextMutex);
+		std::string id = contextID(source);
+		DltContext*& pContext = _contexts[id];
+		if (!pContext)
+		{
+			pContext = new DltContext;
+			std::memset(pContext, 0, sizeof(DltContext));
+			dlt_register_context(pContext, id.c_str(), id.c_str());
+		}
+		for (int i = 0; i < CONTEXT_SLOTS; ++i)
+		{
+			ContextEntry* volatile& pSlot = _slots[(h + i) % CONTEXT_SLOTS];
+			if (!pSlot)
+			{
+				ContextEntry* pEntry = new ContextEntry(source, pContext);
+				__sync_synchronize();
+				pSlot = pEntry;
+				break;
+			}
+			if (pSlot->source == source) break;
+		}
+		// If the table is full, further sources of the
+		// context always take this path.
+		return pContext;
+	}
+
+	bool recordReady() const
+	{
+		const Record& record = _records[_dequeuePos & _mask];
+		return record.sequence == _dequeuePos + 1;
+	}
+
+	bool writeNext()
+	{
+		// Only the writer thread dequeues.
+		long pos = _dequeuePos;
+		Record& record = _records[pos & _mask];
+		long sequence = record.sequence;
+		__sync_synchronize();
+		if (sequence != pos + 1) return false;
+		const char* pText = &_text[(pos & _mask)*(_maxLength + 1)];
+		DltContextData data;
+		if (dlt_user_log_write_start(record.pContext, &data, record.level) > 0)
+		{
+			dlt_user_log_write_string(&data, pText);
+			dlt_user_log_write_finish(&data);
+		}
+		_dequeuePos = pos + 1;
+		__sync_synchronize();
+		record.sequence = pos + static_cast<long>(_mask) + 1;
+		return true;
+	}
+
+	std::string _appID;
+	std::size_t _capacity;
+	std::size_t _maxLength;
+	std::vector<Record> _records;
+	std::vector<char> _text;
+	std::size_t _mask;
+	volatile long _enqueuePos;
+	volatile long _dequeuePos;
+	volatile long _dropped;
+	volatile bool _open;
+	volatile bool _stop;
+	EventCount _notEmpty;
+	ContextEntry* volatile _slots[CONTEXT_SLOTS];
+	ContextMap _contexts;
+	Thread _thread;
+	FastMutex _mutex;
+	FastMutex _contextMutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_AsyncDLTChannel_INCLUDED
@@ -0,0 +1,398 @@
+//
+// Atom.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  Atom
+//
+// Definition of the Atom class.
+//
+// Copyright (c) 2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_Atom_INCLUDED
+#define Foundation_Atom_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Hash.h"
+#include "Poco/FlatHashTable.h"
+#include "Poco/Mutex.h"
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstring>
+
+
+namespace Poco {
+
+
+class Atom
+	/// An Atom is a handle for an interned string.
+	///
+	/// All Atoms for equal strings refer to the same entry in a
+	/// global table, so that Atoms are compared, copied and hashed
+	/// by comparing, copying and hashing a pointer, which makes
+	/// them cheap keys for maps of object IDs, type IDs, service
+	/// and method names.
+	///
+	///     static const Poco::Atom SERVICE_NAME("com.appinf.osp.connmanager");
+	///     ...
+	///     if (Poco::Atom(name) == SERVICE_NAME) ...
+	///
+	/// Interned strings are never freed. Strings received from
+	/// peers should therefore not be interned, but looked up
+	/// with find(), which never adds a string to the table.
+	///
+	/// The table is thread-safe. Lookups, including the lookups
+	/// done when creating an Atom for a string already interned,
+	/// take no lock. Only interning a new string locks a mutex.
+	///
+	/// The order defined by operator < is the order in which the
+	/// entries happen to be stored in memory, and is therefore
+	/// only suitable for ordered containers whose order does not
+	/// matter, not for sorting names.
+{
+public:
+	Atom():
+		_pEntry(Registry::instance().empty())
+		/// Creates the Atom for the empty string.
+	{
+	}
+
+	explicit Atom(const std::string& str):
+		_pEntry(Registry::instance().intern(str.data(), str.size()))
+		/// Creates the Atom for the given string,
+		/// interning the string, if necessary.
+	{
+	}
+
+	explicit Atom(const char* str):
+		_pEntry(Registry::instance().intern(str, std::strlen(str)))
+		/// Creates the Atom for the given string,
+		/// interning the string, if necessary.
+	{
+	}
+
+	Atom(const Atom& atom):
+		_pEntry(atom._pEntry)
+		/// Creates the Atom by copying another one.
+	{
+	}
+
+	~Atom()
+		/// Destroys the Atom.
+	{
+	}
+
+	Atom& operator = (const Atom& atom)
+		/// Assigns another Atom.
+	{
+		_pEntry = atom._pEntry;
+		return *this;
+	}
+
+	void swap(Atom& atom)
+		/// Swaps the Atom with another one.
+	{
+		std::swap(_pEntry, atom._pEntry);
+	}
+
+	static bool find(const std::string& str, Atom& atom)
+		/// If the given string has been interned, assigns its
+		/// Atom to atom and returns true. Otherwise, returns
+		/// false and leaves atom unchanged.
+	{
+		return find(str.data(), str.size(), atom);
+	}
+
+	static bool find(const char* str, Atom& atom)
+		/// If the given string has been interned, assigns its
+		/// Atom to atom and returns true. Otherwise, returns
+		/// false and leaves atom unchanged.
+	{
+		return find(str, std::strlen(str), atom);
+	}
+
+	static bool find(const char* data, std::size_t length, Atom& atom)
+		/// If the given string has been interned, assigns its
+		/// Atom to atom and returns true. Otherwise, returns
+		/// false and leaves atom unchanged.
+	{
+		const Entry* pEntry = Registry::instance().find(data, length, hashOf(data, length));
+		if (pEntry)
+		{
+			atom._pEntry = pEntry;
+			return true;
+		}
+		else return false;
+	}
+
+	static std::size_t count()
+		/// Returns the number of interned strings.
+	{
+		return Registry::instance().count();
+	}
+
+	const std::string& str() const
+		/// Returns the string.
+	{
+		return _pEntry->str;
+	}
+
+	const char* c_str() const
+		/// Returns the string as a zero-terminated C string.
+	{
+		return _pEntry->str.c_str();
+	}
+
+	std::size_t length() const
+		/// Returns the length of the string.
+	{
+		return _pEntry->str.size();
+	}
+
+	bool empty() const
+		/// Returns true iff the string is empty.
+	{
+		return _pEntry->str.empty();
+	}
+
+	std::size_t hash() const
+		/// Returns the hash value of the string.
+	{
+		return _pEntry->hash;
+	}
+
+	bool operator == (const Atom& atom) const
+	{
+		return _pEntry == atom._pEntry;
+	}
+
+	bool operator != (const Atom& atom) const
+	{
+		return _pEntry != atom._pEntry;
+	}
+
+	bool operator < (const Atom& atom) const
+	{
+		return _pEntry < atom._pEntry;
+	}
+
+private:
+	struct Entry
+	{
+		Entry(const char* data, std::size_t length, std::size_t h):
+			str(data, length),
+			hash(h)
+		{
+		}
+
+		std::string str;
+		std::size_t hash;
+	};
+
+	class Registry
+		/// The global table of interned strings, which is only ever
+		/// added to, like the table of LoggerCache: readers take no
+		/// lock, and when the table grows, a copy is published and
+		/// the old one is kept, so readers still using it are not
+		/// affected.
+	{
+	public:
+		static Registry& instance()
+		{
+			// Never destroyed, so that Atoms can still
+			// be used by destructors of static objects.
+			static Registry* pRegistry = new Registry;
+			return *pRegistry;
+		}
+
+		const Entry* empty() const
+		{
+			return _pEmpty;
+		}
+
+		const Entry* find(const char* data, std::size_t length, std::size_t hash) const
+		{
+			Table* pTable = _pTable;
+			__sync_synchronize();
+			return lookup(*pTable, data, length, hash);
+		}
+
+		const Entry* intern(const char* data, std::size_t length)
+		{
+			std::size_t hash = hashOf(data, length);
+			const Entry* pEntry = find(data, length, hash);
+			if (pEntry) return pEntry;
+
+			FastMutex::ScopedLock lock(_mutex);
+			return add(data, length, hash);
+		}
+
+		std::size_t count() const
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			return _entries.size();
+		}
+
+	private:
+		struct Table
+		{
+			Table(std::size_t n):
+				slots(new Entry*[n]),
+				size(n),
+				mask(n - 1)
+			{
+				for (std::size_t i = 0; i < size; ++i) slots[i] = 0;
+			}
+
+			~Table()
+			{
+				delete [] slots;
+			}
+
+			Entry* volatile* slots;
+			std::size_t size;
+			std::size_t mask;
+
+		private:
+			Table(const Table&);
+			Table& operator = (const Table&);
+		};
+
+		enum
+		{
+			INITIAL_SIZE = 256
+		};
+
+		Registry()
+		{
+			Table* pTable = new Table(INITIAL_SIZE);
+			_tables.push_back(pTable);
+			_pTable = pTable;
+			FastMutex::ScopedLock lock(_mutex);
+			_pEmpty = add("", 0, hashOf("", 0));
+		}
+
+		~Registry()
+		{
+			for (std::vector<Entry*>::iterator it = _entries.begin(); it != _entries.end(); ++it)
+			{
+				delete *it;
+			}
+			for (std::vector<Table*>::iterator it = _tables.begin(); it != _tables.end(); ++it)
+			{
+				delete *it;
+			}
+		}
+
+		Registry(const Registry&);
+		Registry& operator = (const Registry&);
+
+		static const Entry* lookup(const Table& table, const char* data, std::size_t length, std::size_t hash)
+		{
+			for (std::size_t i = hash; ; ++i)
+			{
+				const Entry* pEntry = table.slots[i & table.mask];
+				__sync_synchronize();
+				if (!pEntry) return 0;
+				if (pEntry->hash == hash && pEntry->str.size() == length && std::memcmp(pEntry->str.data(), data, length) == 0)
+					return pEntry;
+			}
+		}
+
+		static void insert(Table& table, Entry* pEntry)
+		{
+			for (std::size_t i = pEntry->hash; ; ++i)
+			{
+				Entry* volatile& slot = table.slots[i & table.mask];
+				if (!slot)
+				{
+					__sync_synchronize();
+					slot = pEntry;
+					return;
+				}
+			}
+		}
+
+		const Entry* add(const char* data, std::size_t length, std::size_t hash)
+			/// Adds the string, unless it has been added by another
+			/// thread in the meantime. Must be called with the mutex locked.
+		{
+			const Entry* pFound = lookup(*_pTable, data, length, hash);
+			if (pFound) return pFound;
+			Entry* pEntry = new Entry(data, length, hash);
+			if (2*(_entries.size() + 1) > _pTable->size)
+			{
+				// Keep the load factor below one half, so that
+				// lookups of strings not interned end quickly.
+				Table* pNewTable = new Table(2*_pTable->size);
+				for (std::vector<Entry*>::iterator it = _entries.begin(); it != _entries.end(); ++it)
+				{
+					insert(*pNewTable, *it);
+				}
+				insert(*pNewTable, pEntry);
+				__sync_synchronize();
+				_pTable = pNewTable;
+				_tables.push_back(pNewTable);
+			}
+			else insert(*_pTable, pEntry);
+			_entries.push_back(pEntry);
+			return pEntry;
+		}
+
+		Table* volatile _pTable;
+		std::vector<Table*> _tables;
+		std::vector<Entry*> _entries;
+		const Entry* _pEmpty;
+		mutable FastMutex _mutex;
+	};
+
+	static std::size_t hashOf(const char* data, std::size_t length)
+	{
+		return FlatHashFunction<std::string>::hashBytes(data, length);
+	}
+
+	const Entry* _pEntry;
+};
+
+
+template <>
+struct Hash<Atom>
+	/// The hash function for Atoms, for HashMap and HashSet.
+{
+	std::size_t operator () (const Atom& atom) const
+	{
+		return atom.hash();
+	}
+};
+
+
+template <>
+struct FlatHashFunction<Atom>
+	/// The hash function for Atoms, for FlatHashMap and FlatHashSet.
+{
+	std::size_t operator () (const Atom& atom) const
+	{
+		return atom.hash();
+	}
+};
+
+
+inline void swap(Atom& a1, Atom& a2)
+{
+	a1.swap(a2);
+}
+
+
+} // namespace Poco
+
+
+#endif // Foundation_Atom_INCLUDED
@@ -0,0 +1,120 @@
+//
+// AtomicPointer.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  AtomicPointer
+//
+// Definition of the AtomicPointer class template.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_AtomicPointer_INCLUDED
+#define Foundation_AtomicPointer_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#if __cplusplus >= 201103L
+#include <atomic>
+#elif defined(__GNUC__)
+// __sync builtins
+#elif defined(POCO_OS_FAMILY_WINDOWS)
+#include "Poco/UnWindows.h"
+#else
+#include "Poco/Mutex.h"
+#endif
+
+
+namespace Poco {
+
+
+template <class T>
+class AtomicPointer
+	/// A pointer that is published by one thread and read by
+	/// other threads without a lock.
+	///
+	/// All memory operations done by a thread before it store()s a
+	/// pointer are visible to threads that load() the pointer. Both
+	/// operations are sequentially consistent, so that a thread
+	/// storing a pointer and then reading an AtomicCounter, and a
+	/// thread changing the AtomicCounter and then loading the pointer,
+	/// cannot both miss the other thread's change.
+	///
+	/// The implementation uses std::atomic with C++11, and GCC's
+	/// __sync builtins or the Windows interlocked functions otherwise.
+	/// On other platforms, a mutex shared by all AtomicPointer objects
+	/// is used.
+{
+public:
+	AtomicPointer(T* p = 0):
+		_p(p)
+		/// Creates the AtomicPointer.
+	{
+	}
+
+	T* load() const
+		/// Returns the pointer.
+	{
+#if __cplusplus >= 201103L
+		return _p.load();
+#elif defined(__GNUC__)
+		__sync_synchronize();
+		T* p = _p;
+		__sync_synchronize();
+		return p;
+#elif defined(POCO_OS_FAMILY_WINDOWS)
+		return static_cast<T*>(InterlockedCompareExchangePointer(const_cast<PVOID volatile*>(reinterpret_cast<const PVOID volatile*>(&_p)), 0, 0));
+#else
+		FastMutex::ScopedLock lock(mutex());
+		return _p;
+#endif
+	}
+
+	void store(T* p)
+		/// Replaces the pointer.
+	{
+#if __cplusplus >= 201103L
+		_p.store(p);
+#elif defined(__GNUC__)
+		__sync_synchronize();
+		_p = p;
+		__sync_synchronize();
+#elif defined(POCO_OS_FAMILY_WINDOWS)
+		InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&_p), p);
+#else
+		FastMutex::ScopedLock lock(mutex());
+		_p = p;
+#endif
+	}
+
+private:
+	AtomicPointer(const AtomicPointer&);
+	AtomicPointer& operator = (const AtomicPointer&);
+
+#if __cplusplus >= 201103L
+	std::atomic<T*> _p;
+#elif defined(__GNUC__) || defined(POCO_OS_FAMILY_WINDOWS)
+	T* volatile _p;
+#else
+	static FastMutex& mutex()
+	{
+		static FastMutex m;
+		return m;
+	}
+
+	T* _p;
+#endif
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_AtomicPointer_INCLUDED
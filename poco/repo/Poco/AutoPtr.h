@@ -91,6 +91,21 @@ public:
 		if (_ptr) _ptr->duplicate();
 	}
 
+#if __cplusplus >= 201103L
+	AutoPtr(AutoPtr&& ptr) noexcept: _ptr(ptr._ptr)
+		/// Takes over the object of ptr, which becomes null,
+		/// without touching its reference count.
+	{
+		ptr._ptr = 0;
+	}
+
+	template <class Other>
+	AutoPtr(AutoPtr<Other>&& ptr) noexcept: _ptr(ptr._ptr)
+	{
+		ptr._ptr = 0;
+	}
+#endif
+
 	~AutoPtr()
 	{
 		if (_ptr) _ptr->release();
@@ -156,6 +171,28 @@ public:
 		return assign<Other>(ptr);
 	}
 
+#if __cplusplus >= 201103L
+	AutoPtr& operator = (AutoPtr&& ptr) noexcept
+	{
+		if (&ptr != this)
+		{
+			if (_ptr) _ptr->release();
+			_ptr = ptr._ptr;
+			ptr._ptr = 0;
+		}
+		return *this;
+	}
+
+	template <class Other>
+	AutoPtr& operator = (AutoPtr<Other>&& ptr) noexcept
+	{
+		if (_ptr) _ptr->release();
+		_ptr = ptr._ptr;
+		ptr._ptr = 0;
+		return *this;
+	}
+#endif
+
 	void swap(AutoPtr& ptr)
 	{
 		std::swap(_ptr, ptr._ptr);
@@ -346,6 +383,8 @@ public:
 
 private:
 	C* _ptr;
+
+	template <class Other> friend class AutoPtr;
 };
 
 
@@ -0,0 +1,242 @@
+//
+// BatchingActiveDispatcher.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  ActiveObjects
+//
+// Definition of the BatchingActiveDispatcher class.
+//
+// Copyright (c) 2006-2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_BatchingActiveDispatcher_INCLUDED
+#define Foundation_BatchingActiveDispatcher_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Runnable.h"
+#include "Poco/ActiveStarter.h"
+#include "Poco/ActiveRunnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/SingletonHolder.h"
+#include <vector>
+
+
+namespace Poco {
+
+
+class BatchingActiveDispatcher: protected Runnable
+	/// An ActiveDispatcher that executes queued methods in batches.
+	///
+	/// Like ActiveDispatcher, BatchingActiveDispatcher executes all
+	/// methods in a single thread, in the order they were started.
+	/// Instead of a NotificationQueue, it keeps a vector of pending
+	/// methods and wakes up its thread only when the vector was empty.
+	/// The thread then takes all pending methods at once and executes
+	/// them without taking the lock again, so a burst of calls is
+	/// served with a single wakeup and no per-call queue allocation.
+	///
+	/// Use ActiveStarter<BatchingActiveDispatcher> as StarterType,
+	/// as with ActiveDispatcher. With POCO_BATCHED_NOTIFY_ASYNC defined,
+	/// AbstractEvent::notifyAsync() runs on defaultDispatcher() instead
+	/// of starting a thread from the default ThreadPool per call.
+{
+public:
+	BatchingActiveDispatcher();
+		/// Creates the BatchingActiveDispatcher.
+
+	explicit BatchingActiveDispatcher(Thread::Priority prio);
+		/// Creates the BatchingActiveDispatcher and sets
+		/// the priority of its thread.
+
+	virtual ~BatchingActiveDispatcher();
+		/// Executes the pending methods and stops the thread.
+
+	void start(ActiveRunnableBase::Ptr pRunnable);
+		/// Adds the Runnable to the pending methods.
+
+	void cancel();
+		/// Discards all pending methods.
+
+	std::size_t batches() const;
+		/// Returns the number of batches executed so far.
+
+	std::size_t methods() const;
+		/// Returns the number of methods executed so far.
+
+	static BatchingActiveDispatcher& defaultDispatcher();
+		/// Returns the default BatchingActiveDispatcher.
+
+protected:
+	void run();
+
+private:
+	BatchingActiveDispatcher(const BatchingActiveDispatcher&);
+	BatchingActiveDispatcher& operator = (const BatchingActiveDispatcher&);
+
+	void init();
+
+	std::vector<ActiveRunnableBase::Ptr> _pending;
+	std::size_t       _batches;
+	std::size_t       _methods;
+	bool              _stop;
+	mutable FastMutex _mutex;
+	Condition         _available;
+	Thread            _thread;
+};
+
+
+template <>
+class ActiveStarter<BatchingActiveDispatcher>
+	/// A specialization of ActiveStarter
+	/// for BatchingActiveDispatcher.
+{
+public:
+	static void start(BatchingActiveDispatcher* pOwner, ActiveRunnableBase::Ptr pRunnable)
+	{
+		pOwner->start(pRunnable);
+	}
+};
+
+
+//
+// inlines
+//
+inline BatchingActiveDispatcher::BatchingActiveDispatcher():
+	_batches(0),
+	_methods(0),
+	_stop(false)
+{
+	init();
+}
+
+
+inline BatchingActiveDispatcher::BatchingActiveDispatcher(Thread::Priority prio):
+	_batches(0),
+	_methods(0),
+	_stop(false)
+{
+	_thread.setPriority(prio);
+	init();
+}
+
+
+inline BatchingActiveDispatcher::~BatchingActiveDispatcher()
+{
+	try
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_stop = true;
+		}
+		_available.signal();
+		_thread.join();
+	}
+	catch (...)
+	{
+		poco_unexpected();
+	}
+}
+
+
+inline void BatchingActiveDispatcher::init()
+{
+	_thread.setName("BatchingActiveDispatcher");
+	_thread.start(*this);
+}
+
+
+inline void BatchingActiveDispatcher::start(ActiveRunnableBase::Ptr pRunnable)
+{
+	poco_check_ptr (pRunnable);
+
+	bool wakeUp;
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		wakeUp = _pending.empty();
+		_pending.push_back(pRunnable);
+	}
+	if (wakeUp) _available.signal();
+}
+
+
+inline void BatchingActiveDispatcher::cancel()
+{
+	FastMutex::ScopedLock lock(_mutex);
+	_pending.clear();
+}
+
+
+inline std::size_t BatchingActiveDispatcher::batches() const
+{
+	FastMutex::ScopedLock lock(_mutex);
+	return _batches;
+}
+
+
+inline std::size_t BatchingActiveDispatcher::methods() const
+{
+	FastMutex::ScopedLock lock(_mutex);
+	return _methods;
+}
+
+
+inline BatchingActiveDispatcher& BatchingActiveDispatcher::defaultDispatcher()
+{
+	static SingletonHolder<BatchingActiveDispatcher> sh;
+	return *sh.get();
+}
+
+
+inline void BatchingActiveDispatcher::run()
+{
+	std::vector<ActiveRunnableBase::Ptr> batch;
+	for (;;)
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_methods += batch.size();
+			batch.clear();
+			while (_pending.empty() && !_stop) _available.wait(_mutex);
+			if (_pending.empty()) return;
+			batch.swap(_pending);
+			++_batches;
+		}
+		for (std::vector<ActiveRunnableBase::Ptr>::iterator it = batch.begin(); it != batch.end(); ++it)
+		{
+			try
+			{
+				(*it)->duplicate(); // run() will release it
+				(*it)->run();
+			}
+			catch (Exception& exc)
+			{
+				ErrorHandler::handle(exc);
+			}
+			catch (std::exception& exc)
+			{
+				ErrorHandler::handle(exc);
+			}
+			catch (...)
+			{
+				ErrorHandler::handle();
+			}
+		}
+	}
+}
+
+
+} // namespace Poco
+
+
+#endif // Foundation_BatchingActiveDispatcher_INCLUDED
@@ -0,0 +1,531 @@
+//
+// CachedPatternFormatter.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  CachedPatternFormatter
+//
+// Definition of the CachedPatternFormatter class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_CachedPatternFormatter_INCLUDED
+#define Foundation_CachedPatternFormatter_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Formatter.h"
+#include "Poco/PatternFormatter.h"
+#include "Poco/Message.h"
+#include "Poco/Timestamp.h"
+#include "Poco/LocalTimeCache.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/Environment.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <string>
+#include <cstddef>
+
+
+namespace Poco {
+
+
+class CachedPatternFormatter: public Formatter
+	/// A Formatter supporting the same format patterns, and
+	/// producing the same output, as PatternFormatter, but
+	/// optimized for formatting many messages.
+	///
+	/// The pattern is compiled once into a list of fields.
+	/// Consecutive date/time fields with a resolution of a second,
+	/// together with the text between them, are joined into a
+	/// prefix that is rendered only once per second and then taken
+	/// from a cache. Sub-second fields (%i, %c, %F) and all other
+	/// fields are appended directly to the result, without
+	/// temporary strings. Local times are computed with
+	/// LocalTimeCache, without calling localtime() every second.
+	///
+	/// See PatternFormatter for the supported format specifiers
+	/// and properties.
+{
+public:
+	CachedPatternFormatter():
+		_localTime(false),
+		_sizeHint(0),
+		_utcValid(false),
+		_localValid(false),
+		_pNodeName(0)
+		/// Creates a CachedPatternFormatter.
+		/// The format pattern must be specified with
+		/// a call to setProperty.
+	{
+	}
+
+	CachedPatternFormatter(const std::string& format):
+		_localTime(false),
+		_pattern(format),
+		_sizeHint(0),
+		_utcValid(false),
+		_localValid(false),
+		_pNodeName(0)
+		/// Creates a CachedPatternFormatter that uses the
+		/// given format pattern.
+	{
+		compile();
+	}
+
+	~CachedPatternFormatter()
+		/// Destroys the CachedPatternFormatter.
+	{
+		delete _pNodeName;
+	}
+
+	void format(const Message& msg, std::string& text)
+		/// Formats the message according to the format
+		/// pattern and appends the result to text.
+	{
+		text.reserve(text.size() + _sizeHint + msg.getText().size());
+		Timestamp::TimeVal micros = msg.getTime().epochMicroseconds();
+		Timestamp::TimeVal seconds = micros/Timestamp::resolution();
+		int fraction = static_cast<int>(micros - seconds*Timestamp::resolution());
+		if (fraction < 0)
+		{
+			fraction += static_cast<int>(Timestamp::resolution());
+			--seconds;
+		}
+		for (std::vector<Field>::const_iterator it = _fields.begin(); it != _fields.end(); ++it)
+		{
+			switch (it->kind)
+			{
+			case FIELD_LITERAL:
+				text.append(it->text);
+				break;
+			case FIELD_GROUP:
+				appendGroup(text, it->group, seconds);
+				break;
+			case FIELD_SUBSECOND:
+				appendSubsecond(text, it->key, fraction);
+				break;
+			default:
+				appendMessageField(text, *it, msg);
+				break;
+			}
+		}
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+		/// Sets the property with the given name to the given value.
+		///
+		/// The following properties are supported:
+		///
+		///     * pattern: The format pattern. See the PatternFormatter class
+		///       for details.
+		///     * times: Specifies whether times are adjusted for local time
+		///       or taken as they are in UTC. Supported values are "local" and "UTC".
+		///
+		/// If any other property name is given, a PropertyNotSupported
+		/// exception is thrown.
+	{
+		if (name == PatternFormatter::PROP_PATTERN)
+		{
+			_pattern = value;
+			compile();
+		}
+		else if (name == PatternFormatter::PROP_TIMES)
+		{
+			_localTime = (value == "local");
+			compile();
+		}
+		else
+		{
+			Formatter::setProperty(name, value);
+		}
+	}
+
+	std::string getProperty(const std::string& name) const
+		/// Returns the value of the property with the given name or
+		/// throws a PropertyNotSupported exception if the given
+		/// name is not recognized.
+	{
+		if (name == PatternFormatter::PROP_PATTERN)
+			return _pattern;
+		else if (name == PatternFormatter::PROP_TIMES)
+			return _localTime ? "local" : "UTC";
+		else
+			return Formatter::getProperty(name);
+	}
+
+private:
+	enum FieldKind
+	{
+		FIELD_LITERAL,
+		FIELD_MESSAGE,
+		FIELD_TIME,
+		FIELD_SUBSECOND,
+		FIELD_GROUP
+	};
+
+	struct Field
+	{
+		Field(FieldKind k, char c = 0):
+			kind(k),
+			key(c),
+			length(0),
+			local(false),
+			group(0)
+		{
+		}
+
+		FieldKind   kind;
+		char        key;
+		int         length;
+		bool        local;
+		std::size_t group;
+		std::string text; /// The literal text or the parameter name.
+	};
+
+	struct Group
+		/// A run of second resolution date/time fields and
+		/// literals, and its rendering for the cached second.
+	{
+		Group():
+			valid(false),
+			seconds(0)
+		{
+		}
+
+		std::vector<Field> fields;
+		bool valid;
+		Timestamp::TimeVal seconds;
+		std::string cached;
+	};
+
+	struct Calendar
+		/// The calendar fields of a second.
+	{
+		int year;
+		int month;
+		int day;
+		int dayOfWeek;
+		int hour;
+		int hourAMPM;
+		bool am;
+		int minute;
+		int second;
+		int tzd;
+		Timestamp::TimeVal seconds;
+	};
+
+	CachedPatternFormatter(const CachedPatternFormatter&);
+	CachedPatternFormatter& operator = (const CachedPatternFormatter&);
+
+	static bool isTimeKey(char key)
+	{
+		switch (key)
+		{
+		case 'w': case 'W': case 'b': case 'B': case 'd': case 'e': case 'f':
+		case 'm': case 'n': case 'o': case 'y': case 'Y': case 'H': case 'h':
+		case 'a': case 'A': case 'M': case 'S': case 'z': case 'Z': case 'E':
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void compile()
+		/// Compiles _pattern into _fields and _groups.
+	{
+		FastMutex::ScopedLock lock(_cacheMutex);
+		std::vector<Field> fields;
+		bool local = _localTime;
+		std::string::const_iterator it  = _pattern.begin();
+		std::string::const_iterator end = _pattern.end();
+		std::string literal;
+		while (it != end)
+		{
+			if (*it != '%')
+			{
+				literal += *it++;
+				continue;
+			}
+			if (++it == end) break;
+			char key = *it++;
+			if (key == '%')
+			{
+				literal += '%';
+				continue;
+			}
+			if (!literal.empty())
+			{
+				Field field(FIELD_LITERAL);
+				field.text.swap(literal);
+				fields.push_back(field);
+			}
+			if (key == 'L')
+			{
+				local = true;
+				continue;
+			}
+			Field field(FIELD_MESSAGE, key);
+			field.local = local;
+			if (key == '[')
+			{
+				while (it != end && *it != ']') field.text += *it++;
+				if (it != end) ++it;
+			}
+			else if (key == 'v' && it != end && *it == '[')
+			{
+				++it;
+				while (it != end && *it != ']') field.length = field.length*10 + (*it++ - '0');
+				if (it != end) ++it;
+			}
+			else if (isTimeKey(key))
+			{
+				field.kind = FIELD_TIME;
+			}
+			else if (key == 'i' || key == 'c' || key == 'F')
+			{
+				field.kind = FIELD_SUBSECOND;
+			}
+			fields.push_back(field);
+		}
+		if (!literal.empty())
+		{
+			Field field(FIELD_LITERAL);
+			field.text.swap(literal);
+			fields.push_back(field);
+		}
+
+		// Join runs of time fields and the literals between them.
+		_fields.clear();
+		_groups.clear();
+		_sizeHint = 0;
+		for (std::size_t i = 0; i < fields.size(); ++i)
+		{
+			if (fields[i].kind == FIELD_TIME)
+			{
+				Group group;
+				std::size_t last = i;
+				for (std::size_t j = i; j < fields.size(); ++j)
+				{
+					if (fields[j].kind == FIELD_TIME && fields[j].local == fields[i].local)
+						last = j;
+					else if (fields[j].kind != FIELD_LITERAL)
+						break;
+				}
+				group.fields.assign(fields.begin() + i, fields.begin() + last + 1);
+				Field field(FIELD_GROUP);
+				field.local = fields[i].local;
+				field.group = _groups.size();
+				_groups.push_back(group);
+				_fields.push_back(field);
+				_sizeHint += 32;
+				i = last;
+			}
+			else
+			{
+				_sizeHint += fields[i].kind == FIELD_LITERAL ? fields[i].text.size() : 16;
+				_fields.push_back(fields[i]);
+			}
+		}
+		_utc.seconds = _local.seconds = 0;
+		_utcValid = _localValid = false;
+	}
+
+	void appendGroup(std::string& text, std::size_t index, Timestamp::TimeVal seconds)
+	{
+		FastMutex::ScopedLock lock(_cacheMutex);
+		Group& group = _groups[index];
+		if (!group.valid || group.seconds != seconds)
+		{
+			const Calendar& cal = calendar(seconds, group.fields.front().local);
+			group.cached.clear();
+			for (std::vector<Field>::const_iterator it = group.fields.begin(); it != group.fields.end(); ++it)
+			{
+				if (it->kind == FIELD_LITERAL)
+					group.cached.append(it->text);
+				else
+					appendTimeField(group.cached, it->key, cal);
+			}
+			group.seconds = seconds;
+			group.valid   = true;
+		}
+		text.append(group.cached);
+	}
+
+	const Calendar& calendar(Timestamp::TimeVal seconds, bool local)
+		/// Returns the calendar fields for the given second.
+		/// Must be called with _cacheMutex locked.
+	{
+		Calendar& cal  = local ? _local : _utc;
+		bool& valid    = local ? _localValid : _utcValid;
+		if (valid && cal.seconds == seconds) return cal;
+		LocalTimeCache::Fields fields;
+		if (local)
+		{
+			LocalTimeCache::localFields(seconds, fields);
+			cal.tzd = fields.tzd;
+		}
+		else
+		{
+			LocalTimeCache::utcFields(seconds, fields);
+			cal.tzd = DateTimeFormatter::UTC;
+		}
+		int hourAMPM = fields.hour < 1 ? 12 : (fields.hour > 12 ? fields.hour - 12 : fields.hour);
+		set(cal, fields.year, fields.month, fields.day, fields.dayOfWeek, fields.hour, hourAMPM, fields.hour < 12, fields.minute, fields.second);
+		cal.seconds = seconds;
+		valid = true;
+		return cal;
+	}
+
+	static void set(Calendar& cal, int year, int month, int day, int dayOfWeek, int hour, int hourAMPM, bool am, int minute, int second)
+	{
+		cal.year      = year;
+		cal.month     = month;
+		cal.day       = day;
+		cal.dayOfWeek = dayOfWeek;
+		cal.hour      = hour;
+		cal.hourAMPM  = hourAMPM;
+		cal.am        = am;
+		cal.minute    = minute;
+		cal.second    = second;
+	}
+
+	static void appendNumber(std::string& text, int value, int width, char pad)
+		/// Appends a non-negative number, padded to width.
+	{
+		char buffer[16];
+		int n = 0;
+		do
+		{
+			buffer[n++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		}
+		while (value > 0 && n < 16);
+		for (int i = n; i < width; ++i) text += pad;
+		while (n > 0) text += buffer[--n];
+	}
+
+	static void appendTimeField(std::string& text, char key, const Calendar& cal)
+	{
+		switch (key)
+		{
+		case 'w': text.append(DateTimeFormat::WEEKDAY_NAMES[cal.dayOfWeek], 0, 3); break;
+		case 'W': text.append(DateTimeFormat::WEEKDAY_NAMES[cal.dayOfWeek]); break;
+		case 'b': text.append(DateTimeFormat::MONTH_NAMES[cal.month - 1], 0, 3); break;
+		case 'B': text.append(DateTimeFormat::MONTH_NAMES[cal.month - 1]); break;
+		case 'd': appendNumber(text, cal.day, 2, '0'); break;
+		case 'e': appendNumber(text, cal.day, 0, ' '); break;
+		case 'f': appendNumber(text, cal.day, 2, ' '); break;
+		case 'm': appendNumber(text, cal.month, 2, '0'); break;
+		case 'n': appendNumber(text, cal.month, 0, ' '); break;
+		case 'o': appendNumber(text, cal.month, 2, ' '); break;
+		case 'y': appendNumber(text, cal.year % 100, 2, '0'); break;
+		case 'Y': appendNumber(text, cal.year, 4, '0'); break;
+		case 'H': appendNumber(text, cal.hour, 2, '0'); break;
+		case 'h': appendNumber(text, cal.hourAMPM, 2, '0'); break;
+		case 'a': text.append(cal.am ? "am" : "pm"); break;
+		case 'A': text.append(cal.am ? "AM" : "PM"); break;
+		case 'M': appendNumber(text, cal.minute, 2, '0'); break;
+		case 'S': appendNumber(text, cal.second, 2, '0'); break;
+		case 'z': DateTimeFormatter::tzdISO(text, cal.tzd); break;
+		case 'Z': DateTimeFormatter::tzdRFC(text, cal.tzd); break;
+		case 'E': NumberFormatter::append(text, static_cast<Int64>(cal.seconds)); break;
+		}
+	}
+
+	static void appendSubsecond(std::string& text, char key, int fraction)
+	{
+		switch (key)
+		{
+		case 'i': appendNumber(text, fraction/1000, 3, '0'); break;
+		case 'c': appendNumber(text, fraction/100000, 0, '0'); break;
+		case 'F': appendNumber(text, fraction, 6, '0'); break;
+		}
+	}
+
+	void appendMessageField(std::string& text, const Field& field, const Message& msg)
+	{
+		switch (field.key)
+		{
+		case 's': text.append(msg.getSource()); break;
+		case 't': text.append(msg.getText()); break;
+		case 'l': appendNumber(text, static_cast<int>(msg.getPriority()), 0, '0'); break;
+		case 'p': text.append(priorityName(msg.getPriority())); break;
+		case 'q': if (*priorityName(msg.getPriority())) text += priorityName(msg.getPriority())[0]; break;
+		case 'P': NumberFormatter::append(text, msg.getPid()); break;
+		case 'T': text.append(msg.getThread()); break;
+		case 'I': NumberFormatter::append(text, msg.getTid()); break;
+		case 'N': text.append(nodeName()); break;
+		case 'U': if (msg.getSourceFile()) text.append(msg.getSourceFile()); break;
+		case 'u': NumberFormatter::append(text, msg.getSourceLine()); break;
+		case 'v':
+			if (field.length > 0 && msg.getSource().size() > static_cast<std::size_t>(field.length))
+			{
+				text.append(msg.getSource(), msg.getSource().size() - field.length, field.length);
+			}
+			else
+			{
+				text.append(msg.getSource());
+				if (static_cast<std::size_t>(field.length) > msg.getSource().size())
+					text.append(field.length - msg.getSource().size(), ' ');
+			}
+			break;
+		case '[':
+			if (msg.has(field.text)) text.append(msg.get(field.text));
+			break;
+		}
+	}
+
+	static const char* priorityName(Message::Priority prio)
+	{
+		static const char* names[] =
+		{
+			"",
+			"Fatal",
+			"Critical",
+			"Error",
+			"Warning",
+			"Notice",
+			"Information",
+			"Debug",
+			"Trace"
+		};
+		int i = static_cast<int>(prio);
+		return (i > 0 && i <= Message::PRIO_TRACE) ? names[i] : "";
+	}
+
+	const std::string& nodeName()
+	{
+		FastMutex::ScopedLock lock(_cacheMutex);
+		if (!_pNodeName) _pNodeName = new std::string(Environment::nodeName());
+		return *_pNodeName;
+	}
+
+	bool _localTime;
+	std::string _pattern;
+	std::vector<Field> _fields;
+	std::vector<Group> _groups;
+	std::size_t _sizeHint;
+	Calendar _utc;
+	Calendar _local;
+	bool _utcValid;
+	bool _localValid;
+	std::string* _pNodeName;
+	FastMutex _cacheMutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_CachedPatternFormatter_INCLUDED
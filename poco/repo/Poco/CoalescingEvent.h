@@ -0,0 +1,324 @@
+//
+// CoalescingEvent.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Events
+// Module:  CoalescingEvent
+//
+// Implementation of the CoalescingEvent template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_CoalescingEvent_INCLUDED
+#define Foundation_CoalescingEvent_INCLUDED
+
+
+#include "Poco/AbstractEvent.h"
+#include "Poco/SnapshotStrategy.h"
+#include "Poco/AbstractDelegate.h"
+#include "Poco/MetaProgramming.h"
+#include "Poco/Mutex.h"
+#include "Poco/Event.h"
+#include "Poco/Thread.h"
+#include "Poco/Clock.h"
+#include "Poco/SingletonHolder.h"
+#include <vector>
+#include <algorithm>
+
+
+namespace Poco {
+
+
+class CoalescingSlot
+	/// The interface between a CoalescingEvent and the
+	/// CoalescingEventDispatcher.
+{
+public:
+	virtual ~CoalescingSlot()
+	{
+	}
+
+	virtual long dispatch(const Clock& now) = 0;
+		/// Delivers the pending value, if there is one and the
+		/// minimum interval has elapsed.
+		///
+		/// Returns the number of milliseconds after which
+		/// dispatch() should be called again, or -1 if
+		/// no value is pending.
+};
+
+
+class CoalescingEventDispatcher: public Runnable
+	/// The single, process-wide thread that drains the latest-value
+	/// slots of all CoalescingEvent instances.
+	///
+	/// The thread is started when the first CoalescingEvent is
+	/// created. It sleeps until either a slot receives a new value
+	/// or the minimum interval of a slot with a pending value expires.
+{
+public:
+	CoalescingEventDispatcher():
+		_started(false),
+		_stop(false)
+	{
+	}
+
+	~CoalescingEventDispatcher()
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (!_started) return;
+			_stop = true;
+		}
+		_wakeUp.set();
+		_thread.join();
+	}
+
+	static CoalescingEventDispatcher& instance()
+		/// Returns the default CoalescingEventDispatcher.
+	{
+		static SingletonHolder<CoalescingEventDispatcher> sh;
+		return *sh.get();
+	}
+
+	void add(CoalescingSlot* pSlot)
+		/// Registers a slot with the dispatcher.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_slots.push_back(pSlot);
+		if (!_started)
+		{
+			_started = true;
+			_thread.setName("CoalescingEventDispatcher");
+			_thread.start(*this);
+		}
+	}
+
+	void remove(CoalescingSlot* pSlot)
+		/// Unregisters a slot. If the slot is currently being
+		/// dispatched from another thread, waits until dispatching
+		/// has finished.
+	{
+		Mutex::ScopedLock dispatchLock(_dispatchMutex);
+		FastMutex::ScopedLock lock(_mutex);
+		_slots.erase(std::remove(_slots.begin(), _slots.end(), pSlot), _slots.end());
+	}
+
+	void wakeUp()
+		/// Signals the dispatcher that a slot has received a value.
+	{
+		_wakeUp.set();
+	}
+
+	void run()
+	{
+		std::vector<CoalescingSlot*> slots;
+		long wait = IDLE_INTERVAL;
+		for (;;)
+		{
+			_wakeUp.tryWait(wait);
+			wait = IDLE_INTERVAL;
+			Mutex::ScopedLock dispatchLock(_dispatchMutex);
+			{
+				FastMutex::ScopedLock lock(_mutex);
+				if (_stop) return;
+				slots = _slots;
+			}
+			Clock now;
+			for (std::vector<CoalescingSlot*>::iterator it = slots.begin(); it != slots.end(); ++it)
+			{
+				{
+					// a delegate may have destroyed the event
+					FastMutex::ScopedLock lock(_mutex);
+					if (std::find(_slots.begin(), _slots.end(), *it) == _slots.end()) continue;
+				}
+				long next = (*it)->dispatch(now);
+				if (next >= 0 && next < wait) wait = next;
+			}
+		}
+	}
+
+private:
+	enum
+	{
+		IDLE_INTERVAL = 60000
+	};
+
+	CoalescingEventDispatcher(const CoalescingEventDispatcher&);
+	CoalescingEventDispatcher& operator = (const CoalescingEventDispatcher&);
+
+	std::vector<CoalescingSlot*> _slots;
+	bool      _started;
+	bool      _stop;
+	FastMutex _mutex;
+	Mutex     _dispatchMutex;
+	Event     _wakeUp;
+	Thread    _thread;
+};
+
+
+template <class TArgs, class TMutex = FastMutex>
+class CoalescingEvent: public AbstractEvent <
+	TArgs, SnapshotStrategy<TArgs, AbstractDelegate<TArgs> >,
+	AbstractDelegate<TArgs>,
+	TMutex
+>, private CoalescingSlot
+	/// A CoalescingEvent is intended for events that report
+	/// state, where delegates only care about the latest value.
+	///
+	/// notify() does not invoke the delegates. Instead, it stores
+	/// the argument in a latest-value slot, overwriting any value
+	/// that has not been delivered yet. The CoalescingEventDispatcher
+	/// thread delivers the slot's value to all delegates, but not more
+	/// often than once per minimum interval. Intermediate values are
+	/// dropped, so the cost of a burst of notifications is bounded by
+	/// the delivery rate, not by the notification rate.
+	///
+	/// Delegates are therefore always invoked asynchronously, from the
+	/// dispatcher thread, in the order they have been registered.
+	/// Exceptions thrown by delegates are caught and discarded.
+	///
+	/// TArgs must be default constructible and assignable.
+	///
+	/// Please see the AbstractEvent class template documentation
+	/// for more information.
+{
+public:
+	typedef AbstractEvent<TArgs, SnapshotStrategy<TArgs, AbstractDelegate<TArgs> >, AbstractDelegate<TArgs>, TMutex> Base;
+	typedef typename TypeWrapper<TArgs>::TYPE Value;
+
+	CoalescingEvent(long minInterval = 0):
+		_pSender(0),
+		_pending(false),
+		_interval(static_cast<Clock::ClockDiff>(minInterval)*1000),
+		_lastDispatch(0)
+		/// Creates the CoalescingEvent. Values are delivered
+		/// at most once every minInterval milliseconds.
+	{
+		CoalescingEventDispatcher::instance().add(this);
+	}
+
+	~CoalescingEvent()
+	{
+		CoalescingEventDispatcher::instance().remove(this);
+	}
+
+	void setMinInterval(long minInterval)
+		/// Sets the minimum interval in milliseconds between two
+		/// deliveries, i.e. the maximum delivery rate is
+		/// 1000/minInterval per second.
+	{
+		FastMutex::ScopedLock lock(_slotMutex);
+		_interval = static_cast<Clock::ClockDiff>(minInterval)*1000;
+	}
+
+	long getMinInterval() const
+		/// Returns the minimum interval in milliseconds between two deliveries.
+	{
+		FastMutex::ScopedLock lock(_slotMutex);
+		return static_cast<long>(_interval/1000);
+	}
+
+	void operator () (const void* pSender, TArgs& args)
+		/// Shortcut for notify(pSender, args);
+	{
+		notify(pSender, args);
+	}
+
+	void operator () (TArgs& args)
+		/// Shortcut for notify(args).
+	{
+		notify(0, args);
+	}
+
+	void notify(const void* pSender, TArgs& args)
+		/// Stores args in the latest-value slot, replacing a value
+		/// that has not yet been delivered, and returns immediately.
+	{
+		bool signal;
+		{
+			FastMutex::ScopedLock lock(_slotMutex);
+			_latest  = args;
+			_pSender = pSender;
+			signal   = !_pending;
+			_pending = true;
+		}
+		if (signal) CoalescingEventDispatcher::instance().wakeUp();
+	}
+
+	bool hasPending() const
+		/// Returns true if a value is waiting to be delivered.
+	{
+		FastMutex::ScopedLock lock(_slotMutex);
+		return _pending;
+	}
+
+	void flush()
+		/// Delivers a pending value immediately, ignoring the minimum
+		/// interval. The delegates are invoked from the calling thread.
+		/// Exceptions thrown by delegates are propagated to the caller.
+	{
+		Value value;
+		const void* pSender;
+		{
+			FastMutex::ScopedLock lock(_slotMutex);
+			if (!_pending) return;
+			value   = _latest;
+			pSender = _pSender;
+			_pending = false;
+			_lastDispatch.update();
+		}
+		Base::notify(pSender, value);
+	}
+
+private:
+	long dispatch(const Clock& now)
+	{
+		Value value;
+		const void* pSender;
+		{
+			FastMutex::ScopedLock lock(_slotMutex);
+			if (!_pending) return -1;
+			Clock::ClockDiff elapsed = now - _lastDispatch;
+			if (elapsed < _interval)
+			{
+				return static_cast<long>((_interval - elapsed)/1000) + 1;
+			}
+			value   = _latest;
+			pSender = _pSender;
+			_pending = false;
+			_lastDispatch = now;
+		}
+		try
+		{
+			Base::notify(pSender, value);
+		}
+		catch (...)
+		{
+		}
+		return -1;
+	}
+
+	CoalescingEvent(const CoalescingEvent& e);
+	CoalescingEvent& operator = (const CoalescingEvent& e);
+
+	Value            _latest;
+	const void*      _pSender;
+	bool             _pending;
+	Clock::ClockDiff _interval;
+	Clock            _lastDispatch;
+	mutable FastMutex _slotMutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_CoalescingEvent_INCLUDED
@@ -0,0 +1,217 @@
+//
+// DirectStubWriter.h
+//
+// $Id$
+//
+// Library: CodeGeneration
+// Package: CodeGeneration
+// Module:  DirectStubWriter
+//
+// Definition of the DirectStubWriter class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef CodeGeneration_DirectStubWriter_INCLUDED
+#define CodeGeneration_DirectStubWriter_INCLUDED
+
+
+#include "Poco/CodeGeneration/CodeGeneration.h"
+#include "Poco/CodeGeneration/CodeGenerator.h"
+#include "Poco/CodeGeneration/GeneratorEngine.h"
+#include "Poco/CppParser/Function.h"
+#include "Poco/CppParser/Parameter.h"
+#include "Poco/CppParser/Symbol.h"
+#include "Poco/String.h"
+#include <string>
+
+
+namespace Poco {
+namespace CodeGeneration {
+
+
+class DirectStubWriter
+	/// DirectStubWriter writes the parameter serialization code
+	/// of Proxy and Skeleton methods generated in direct mode.
+	///
+	/// Direct mode is enabled for an interface or a method with the
+	/// property remoting.direct = true, and requires the concrete
+	/// Serializer and Deserializer classes of the transport to be
+	/// known at generation time, set with the properties
+	/// remoting.serializer and remoting.deserializer, e.g.:
+	///
+	///     //@ remote
+	///     //@ remoting.direct = true
+	///     //@ remoting.serializer = Poco::RemotingNG::FlatBinarySerializer
+	///     //@ remoting.deserializer = Poco::RemotingNG::FlatBinaryDeserializer
+	///     class Sensor
+	///
+	/// Instead of calling TypeSerializer<T>::serialize() with a name
+	/// string for every parameter, the generated code calls
+	/// DirectTypeSerializer<S, T>::serialize() and
+	/// DirectTypeDeserializer<D, T>::deserialize() (see
+	/// Poco/RemotingNG/DirectSerialization.h), which make non-virtual
+	/// calls to the concrete classes and use a shared empty name.
+	/// The generated stubs are only usable with the given serializer
+	/// classes, which the stubs check in debug builds.
+	///
+	/// All parameters of a method are part of the request. Parameters
+	/// passed by non-const reference are in/out parameters and are
+	/// also part of the reply, together with the return value.
+{
+public:
+	static bool isEnabled(const CodeGenerator::Properties& properties)
+		/// Returns true if direct mode is enabled by the
+		/// given (class or method) properties.
+	{
+		bool direct = false;
+		return GeneratorEngine::getBoolProperty(properties, "remoting.direct", direct) && direct;
+	}
+
+	static std::string serializerClass(const CodeGenerator::Properties& properties)
+		/// Returns the concrete Serializer class given by the properties,
+		/// or Poco::RemotingNG::BinarySerializer if none is given.
+	{
+		std::string cls;
+		if (!GeneratorEngine::getStringProperty(properties, "remoting.serializer", cls))
+			cls = "Poco::RemotingNG::BinarySerializer";
+		return cls;
+	}
+
+	static std::string deserializerClass(const CodeGenerator::Properties& properties)
+		/// Returns the concrete Deserializer class given by the properties,
+		/// or Poco::RemotingNG::BinaryDeserializer if none is given.
+	{
+		std::string cls;
+		if (!GeneratorEngine::getStringProperty(properties, "remoting.deserializer", cls))
+			cls = "Poco::RemotingNG::BinaryDeserializer";
+		return cls;
+	}
+
+	static void writeSerializeRequest(const Poco::CppParser::Function* pFunc, const std::string& serializerClass, const std::string& serVar, CodeGenerator& gen)
+		/// Writes the code serializing the parameters of pFunc with the
+		/// Serializer& variable serVar.
+	{
+		std::string ser = writeCast("Serializer", serializerClass, serVar, gen);
+		for (Poco::CppParser::Function::Iterator it = pFunc->begin(); it != pFunc->end(); ++it)
+		{
+			gen.writeMethodImplementation(serializeLine(serializerClass, (*it)->declType(), ser, (*it)->name()));
+		}
+	}
+
+	static void writeDeserializeRequest(const Poco::CppParser::Function* pFunc, const std::string& deserializerClass, const std::string& deserVar, CodeGenerator& gen)
+		/// Writes the code deserializing the parameters of pFunc, into
+		/// local variables of the same names, with the Deserializer&
+		/// variable deserVar.
+	{
+		std::string deser = writeCast("Deserializer", deserializerClass, deserVar, gen);
+		for (Poco::CppParser::Function::Iterator it = pFunc->begin(); it != pFunc->end(); ++it)
+		{
+			gen.writeMethodImplementation(deserializeLine(deserializerClass, (*it)->declType(), deser, (*it)->name()));
+		}
+	}
+
+	static void writeSerializeReply(const Poco::CppParser::Function* pFunc, const std::string& serializerClass, const std::string& serVar, const std::string& retVar, CodeGenerator& gen)
+		/// Writes the code serializing the return value in the variable
+		/// retVar, unless the method returns void, and the out parameters
+		/// of pFunc with the Serializer& variable serVar.
+	{
+		std::string ser = writeCast("Serializer", serializerClass, serVar, gen);
+		std::string retType = returnType(pFunc);
+		if (!retType.empty()) gen.writeMethodImplementation(serializeLine(serializerClass, retType, ser, retVar));
+		for (Poco::CppParser::Function::Iterator it = pFunc->begin(); it != pFunc->end(); ++it)
+		{
+			if (isOut(**it)) gen.writeMethodImplementation(serializeLine(serializerClass, (*it)->declType(), ser, (*it)->name()));
+		}
+	}
+
+	static void writeDeserializeReply(const Poco::CppParser::Function* pFunc, const std::string& deserializerClass, const std::string& deserVar, const std::string& retVar, CodeGenerator& gen)
+		/// Writes the code deserializing the return value into the variable
+		/// retVar, unless the method returns void, and the out parameters
+		/// of pFunc with the Deserializer& variable deserVar.
+	{
+		std::string deser = writeCast("Deserializer", deserializerClass, deserVar, gen);
+		std::string retType = returnType(pFunc);
+		if (!retType.empty()) gen.writeMethodImplementation(deserializeLine(deserializerClass, retType, deser, retVar));
+		for (Poco::CppParser::Function::Iterator it = pFunc->begin(); it != pFunc->end(); ++it)
+		{
+			if (isOut(**it)) gen.writeMethodImplementation(deserializeLine(deserializerClass, (*it)->declType(), deser, (*it)->name()));
+		}
+	}
+
+	static bool isOut(const Poco::CppParser::Parameter& param)
+		/// Returns true if the parameter is sent with the reply.
+	{
+		return param.isReference() && !param.isConst();
+	}
+
+	static std::string returnType(const Poco::CppParser::Function* pFunc)
+		/// Returns the return type of pFunc without const and &,
+		/// or an empty string if the method returns void.
+	{
+		std::string type = Poco::trim(pFunc->getReturnParameter());
+		if (type.compare(0, 6, "const ") == 0) type.erase(0, 6);
+		while (!type.empty() && (type[type.size() - 1] == '&' || type[type.size() - 1] == ' ')) type.erase(type.size() - 1);
+		if (type == "void") type.clear();
+		return type;
+	}
+
+private:
+	static std::string writeCast(const std::string& base, const std::string& cls, const std::string& var, CodeGenerator& gen)
+	{
+		std::string direct(var);
+		direct += "Direct";
+		std::string code(cls);
+		code += "& ";
+		code += direct;
+		code += " = Poco::RemotingNG::direct";
+		code += base;
+		code += "<";
+		code += cls;
+		code += " >(";
+		code += var;
+		code += ");";
+		gen.writeMethodImplementation(code);
+		return direct;
+	}
+
+	static std::string serializeLine(const std::string& cls, const std::string& type, const std::string& ser, const std::string& var)
+	{
+		std::string code("Poco::RemotingNG::DirectTypeSerializer<");
+		code += cls;
+		code += ", ";
+		code += type;
+		code += " >::serialize(";
+		code += ser;
+		code += ", ";
+		code += var;
+		code += ");";
+		return code;
+	}
+
+	static std::string deserializeLine(const std::string& cls, const std::string& type, const std::string& deser, const std::string& var)
+	{
+		std::string code("Poco::RemotingNG::DirectTypeDeserializer<");
+		code += cls;
+		code += ", ";
+		code += type;
+		code += " >::deserialize(";
+		code += deser;
+		code += ", true, ";
+		code += var;
+		code += ");";
+		return code;
+	}
+
+	DirectStubWriter();
+};
+
+
+} } // namespace Poco::CodeGeneration
+
+
+#endif // CodeGeneration_DirectStubWriter_INCLUDED
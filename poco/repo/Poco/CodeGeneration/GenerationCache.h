@@ -0,0 +1,227 @@
+//
+// GenerationCache.h
+//
+// $Id$
+//
+// Library: CodeGeneration
+// Package: CodeGeneration
+// Module:  GenerationCache
+//
+// Definition of the GenerationCache class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef CodeGeneration_GenerationCache_INCLUDED
+#define CodeGeneration_GenerationCache_INCLUDED
+
+
+#include "Poco/CodeGeneration/CodeGeneration.h"
+#include "Poco/SHA1Engine.h"
+#include "Poco/DigestStream.h"
+#include "Poco/DigestEngine.h"
+#include "Poco/HexBinary.h"
+#include "Poco/FileStream.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace CodeGeneration {
+
+
+class GenerationCache
+	/// GenerationCache remembers, across runs of a code generator,
+	/// the content hash of every input header together with the
+	/// files generated from it, so that the generator only parses
+	/// and regenerates the headers that have changed.
+	///
+	/// The hash of a header is the SHA1 digest of its content, of the
+	/// content of the headers it depends on (e.g. a header with the
+	/// //@ serialize types used by an interface) and of the generator
+	/// options. A header is up to date if its hash is unchanged and
+	/// all files generated from it still exist.
+	///
+	/// The cache is stored in a text file with one line per header,
+	/// containing the path of the header, its hash and the paths of
+	/// the generated files, separated by tabs. The file is replaced
+	/// atomically by save().
+	///
+	/// Within a run, headers included by several interfaces need
+	/// only be parsed once into the global symbol table; see
+	/// markParsed().
+	///
+	/// GenerationCache is thread-safe.
+	///
+	/// Usage example:
+	///
+	///     GenerationCache cache("RemoteGen.cache");
+	///     std::string hash = cache.hash(header, dependencies, options);
+	///     if (!cache.isUpToDate(header, hash))
+	///     {
+	///         // parse header and generate files
+	///         cache.update(header, hash, generatedFiles);
+	///     }
+	///     cache.save();
+{
+public:
+	typedef std::vector<std::string> Files;
+
+	explicit GenerationCache(const std::string& path):
+		_path(path),
+		_modified(false)
+		/// Creates the GenerationCache and loads the
+		/// given cache file, if it exists.
+	{
+		load();
+	}
+
+	~GenerationCache()
+		/// Destroys the GenerationCache without saving it.
+	{
+	}
+
+	static std::string hash(const std::string& header, const Files& dependencies, const std::string& options)
+		/// Returns the hash of the given header, its dependencies
+		/// and the generator options.
+		///
+		/// Throws a FileNotFoundException if a file does not exist.
+	{
+		Poco::SHA1Engine sha1;
+		Poco::DigestOutputStream ostr(sha1);
+		hashFile(header, ostr);
+		for (Files::const_iterator it = dependencies.begin(); it != dependencies.end(); ++it)
+		{
+			hashFile(*it, ostr);
+		}
+		ostr << options;
+		ostr.flush();
+		return Poco::HexBinary::encode(sha1.digest());
+	}
+
+	bool isUpToDate(const std::string& header, const std::string& hash) const
+		/// Returns true if the files generated from the header
+		/// with the given hash still exist.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		EntryMap::const_iterator it = _entries.find(header);
+		if (it == _entries.end() || it->second.hash != hash) return false;
+		for (Files::const_iterator itF = it->second.outputs.begin(); itF != it->second.outputs.end(); ++itF)
+		{
+			if (!Poco::File(*itF).exists()) return false;
+		}
+		return true;
+	}
+
+	void update(const std::string& header, const std::string& hash, const Files& outputs)
+		/// Records the hash of the header and the files generated from it.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Entry& entry = _entries[header];
+		entry.hash = hash;
+		entry.outputs = outputs;
+		_modified = true;
+	}
+
+	void remove(const std::string& header)
+		/// Removes the header from the cache, so that it
+		/// will be regenerated.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_modified = _entries.erase(header) > 0 || _modified;
+	}
+
+	bool markParsed(const std::string& header)
+		/// Returns true, and records the header as parsed, if it
+		/// has not been parsed yet in this run.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _parsed.insert(Poco::Path(header).absolute().toString()).second;
+	}
+
+	void save()
+		/// Writes the cache file, if the cache has been modified.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (!_modified) return;
+
+		std::string tmpPath(_path);
+		tmpPath += ".tmp";
+		{
+			Poco::FileOutputStream ostr(tmpPath);
+			for (EntryMap::const_iterator it = _entries.begin(); it != _entries.end(); ++it)
+			{
+				ostr << it->first << '\t' << it->second.hash;
+				for (Files::const_iterator itF = it->second.outputs.begin(); itF != it->second.outputs.end(); ++itF)
+				{
+					ostr << '\t' << *itF;
+				}
+				ostr << '\n';
+			}
+			ostr.close();
+			if (!ostr.good()) throw Poco::WriteFileException(tmpPath);
+		}
+		Poco::File(tmpPath).renameTo(_path);
+		_modified = false;
+	}
+
+protected:
+	struct Entry
+	{
+		std::string hash;
+		Files outputs;
+	};
+
+	typedef std::map<std::string, Entry> EntryMap;
+
+	void load()
+	{
+		if (!Poco::File(_path).exists()) return;
+
+		Poco::FileInputStream istr(_path);
+		std::string line;
+		while (std::getline(istr, line))
+		{
+			Poco::StringTokenizer tok(line, "\t", Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+			if (tok.count() < 2) continue;
+			Entry& entry = _entries[tok[0]];
+			entry.hash = tok[1];
+			for (std::size_t i = 2; i < tok.count(); i++) entry.outputs.push_back(tok[i]);
+		}
+	}
+
+	static void hashFile(const std::string& path, std::ostream& ostr)
+	{
+		Poco::FileInputStream istr(path);
+		Poco::StreamCopier::copyStream(istr, ostr);
+		ostr << '\0';
+	}
+
+private:
+	GenerationCache(const GenerationCache&);
+	GenerationCache& operator = (const GenerationCache&);
+
+	std::string _path;
+	EntryMap _entries;
+	std::set<std::string> _parsed;
+	bool _modified;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::CodeGeneration
+
+
+#endif // CodeGeneration_GenerationCache_INCLUDED
@@ -0,0 +1,456 @@
+//
+// ConcurrentCache.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Cache
+// Module:  ConcurrentCache
+//
+// Definition of the ConcurrentCache class.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_ConcurrentCache_INCLUDED
+#define Foundation_ConcurrentCache_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/FlatHashMap.h"
+#include "Poco/Hash.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/KeyValueArgs.h"
+#include "Poco/EventArgs.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include <vector>
+#include <utility>
+
+
+namespace Poco {
+
+
+template <class TKey, class TValue, class KeyHash = Poco::Hash<TKey> >
+class ConcurrentCache
+	/// ConcurrentCache is a size limited cache with optional expiration,
+	/// for caches used by many threads at the same time.
+	///
+	/// Unlike the caches based on AbstractCache, which serialize all
+	/// operations with a single mutex, ConcurrentCache divides its
+	/// entries into shards, selected by the hash of the key, each with
+	/// its own mutex. A shard's mutex is only held for a hash lookup
+	/// and a copy of the value.
+	///
+	/// Entries are evicted with the CLOCK algorithm: get() only marks
+	/// an entry as referenced, instead of moving the entry in a list.
+	/// When a shard is full, a clock hand sweeps over the entries,
+	/// giving referenced entries a second chance and evicting the first
+	/// entry not referenced since the last sweep. New entries start
+	/// unreferenced, so entries used only once are evicted before
+	/// entries used repeatedly.
+	///
+	/// If a time to live is given, entries expire after that time
+	/// from being added, and expired entries are evicted first.
+	///
+	/// get() returns a copy of the value. For large objects, use
+	/// a SharedPtr or AutoPtr as TValue.
+	///
+	/// Events are only fired if enabled with enableEvents(), and are
+	/// fired without holding a mutex, after the cache has been changed.
+	///
+	/// ConcurrentCache is thread-safe.
+{
+public:
+	typedef TKey KeyType;
+	typedef TValue ValueType;
+
+	struct Statistics
+	{
+		Statistics():
+			size(0),
+			hits(0),
+			misses(0),
+			evictions(0),
+			expirations(0)
+		{
+		}
+
+		std::size_t size;
+		Poco::UInt64 hits;
+		Poco::UInt64 misses;
+		Poco::UInt64 evictions;
+			/// Entries removed to make room for new entries.
+		Poco::UInt64 expirations;
+			/// Expired entries removed to make room for new entries.
+	};
+
+	enum
+	{
+		DEFAULT_CAPACITY = 1024,
+		DEFAULT_SHARDS = 16
+	};
+
+	Poco::BasicEvent<const KeyValueArgs<TKey, TValue> > Add;
+		/// Fired after an entry has been added or replaced.
+
+	Poco::BasicEvent<const TKey> Remove;
+		/// Fired after an entry has been removed or evicted.
+
+	Poco::BasicEvent<const Poco::EventArgs> Clear;
+		/// Fired after the cache has been cleared.
+
+	explicit ConcurrentCache(std::size_t capacity = DEFAULT_CAPACITY, const Poco::Timespan& ttl = Poco::Timespan(), std::size_t shards = DEFAULT_SHARDS):
+		_ttl(ttl),
+		_expire(ttl.totalMicroseconds() > 0),
+		_events(false)
+		/// Creates the ConcurrentCache for up to capacity entries,
+		/// rounded up to a multiple of the number of shards, which is
+		/// rounded up to a power of two. If ttl is not zero, entries
+		/// expire after the given time.
+	{
+		std::size_t n = 1;
+		while (n < shards) n <<= 1;
+		if (capacity < n) capacity = n;
+		_shardMask = n - 1;
+		_shardCapacity = (capacity + n - 1)/n;
+		_shards.reserve(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			_shards.push_back(new Shard);
+		}
+	}
+
+	~ConcurrentCache()
+		/// Destroys the ConcurrentCache.
+	{
+		for (typename ShardVec::iterator it = _shards.begin(); it != _shards.end(); ++it)
+		{
+			delete *it;
+		}
+	}
+
+	void enableEvents(bool enable = true)
+		/// Enables or disables the Add, Remove and Clear events.
+		/// Events are disabled by default.
+		///
+		/// Should be called before the cache is used by several threads.
+	{
+		_events = enable;
+	}
+
+	bool eventsEnabled() const
+		/// Returns true if events are enabled.
+	{
+		return _events;
+	}
+
+	void add(const TKey& key, const TValue& value)
+		/// Adds an entry, or replaces the value of an existing entry.
+		/// If the shard of the key is full, an entry is evicted.
+	{
+		Shard& shard = shardFor(key);
+		std::vector<TKey> evicted;
+		{
+			Poco::FastMutex::ScopedLock lock(shard.mutex);
+			typename IndexMap::Iterator it = shard.index.find(key);
+			if (it != shard.index.end())
+			{
+				Slot& slot = shard.slots[it->second];
+				slot.value = value;
+				slot.referenced = true;
+				if (_expire) slot.expires = Poco::Timestamp() + _ttl;
+			}
+			else
+			{
+				std::size_t n;
+				if (!shard.free.empty())
+				{
+					n = shard.free.back();
+					shard.free.pop_back();
+				}
+				else if (shard.slots.size() < _shardCapacity)
+				{
+					n = shard.slots.size();
+					shard.slots.push_back(Slot());
+				}
+				else
+				{
+					n = evict(shard);
+					if (_events) evicted.push_back(shard.slots[n].key);
+					shard.index.erase(shard.slots[n].key);
+				}
+				Slot& slot = shard.slots[n];
+				slot.key = key;
+				slot.value = value;
+				slot.used = true;
+				slot.referenced = false;
+				if (_expire) slot.expires = Poco::Timestamp() + _ttl;
+				shard.index.insert(std::make_pair(key, n));
+			}
+		}
+		if (_events)
+		{
+			fireRemove(evicted);
+			KeyValueArgs<TKey, TValue> args(key, value);
+			Add.notify(this, args);
+		}
+	}
+
+	bool get(const TKey& key, TValue& value) const
+		/// Copies the value of the entry with the given key to value
+		/// and returns true, or returns false if there is no such
+		/// entry, or the entry has expired.
+	{
+		Shard& shard = shardFor(key);
+		Poco::FastMutex::ScopedLock lock(shard.mutex);
+		typename IndexMap::Iterator it = shard.index.find(key);
+		if (it != shard.index.end())
+		{
+			Slot& slot = shard.slots[it->second];
+			if (!_expire || !(slot.expires < Poco::Timestamp()))
+			{
+				slot.referenced = true;
+				++shard.hits;
+				value = slot.value;
+				return true;
+			}
+		}
+		++shard.misses;
+		return false;
+	}
+
+	bool has(const TKey& key) const
+		/// Returns true if the cache contains an entry
+		/// for the given key, which has not expired.
+		/// Does not mark the entry as referenced.
+	{
+		Shard& shard = shardFor(key);
+		Poco::FastMutex::ScopedLock lock(shard.mutex);
+		typename IndexMap::Iterator it = shard.index.find(key);
+		return it != shard.index.end() && (!_expire || !(shard.slots[it->second].expires < Poco::Timestamp()));
+	}
+
+	bool remove(const TKey& key)
+		/// Removes the entry with the given key. Returns true
+		/// if the entry has been found.
+	{
+		Shard& shard = shardFor(key);
+		{
+			Poco::FastMutex::ScopedLock lock(shard.mutex);
+			typename IndexMap::Iterator it = shard.index.find(key);
+			if (it == shard.index.end()) return false;
+			std::size_t n = it->second;
+			shard.index.erase(it);
+			release(shard, n);
+		}
+		if (_events) Remove.notify(this, key);
+		return true;
+	}
+
+	template <class Predicate>
+	std::size_t removeIf(Predicate pred)
+		/// Removes all entries for which pred(key, value) returns true,
+		/// and returns the number of entries removed.
+		///
+		/// Visits all entries, one shard at a time.
+	{
+		std::size_t count = 0;
+		for (typename ShardVec::iterator itS = _shards.begin(); itS != _shards.end(); ++itS)
+		{
+			Shard& shard = **itS;
+			std::vector<TKey> removed;
+			{
+				Poco::FastMutex::ScopedLock lock(shard.mutex);
+				for (std::size_t n = 0; n < shard.slots.size(); ++n)
+				{
+					Slot& slot = shard.slots[n];
+					if (slot.used && pred(static_cast<const TKey&>(slot.key), static_cast<const TValue&>(slot.value)))
+					{
+						if (_events) removed.push_back(slot.key);
+						shard.index.erase(slot.key);
+						release(shard, n);
+						++count;
+					}
+				}
+			}
+			fireRemove(removed);
+		}
+		return count;
+	}
+
+	void clear()
+		/// Removes all entries.
+	{
+		for (typename ShardVec::iterator it = _shards.begin(); it != _shards.end(); ++it)
+		{
+			Shard& shard = **it;
+			Poco::FastMutex::ScopedLock lock(shard.mutex);
+			shard.index.clear();
+			shard.slots.clear();
+			shard.free.clear();
+			shard.hand = 0;
+		}
+		if (_events) Clear.notify(this, Poco::EventArgs());
+	}
+
+	std::size_t size() const
+		/// Returns the number of entries, including expired
+		/// entries not yet evicted.
+	{
+		std::size_t n = 0;
+		for (typename ShardVec::const_iterator it = _shards.begin(); it != _shards.end(); ++it)
+		{
+			Poco::FastMutex::ScopedLock lock((*it)->mutex);
+			n += (*it)->index.size();
+		}
+		return n;
+	}
+
+	std::size_t capacity() const
+		/// Returns the maximum number of entries.
+	{
+		return _shardCapacity*_shards.size();
+	}
+
+	Statistics statistics() const
+		/// Returns the size and the hit, miss and eviction
+		/// counts of the cache.
+	{
+		Statistics stats;
+		for (typename ShardVec::const_iterator it = _shards.begin(); it != _shards.end(); ++it)
+		{
+			const Shard& shard = **it;
+			Poco::FastMutex::ScopedLock lock(shard.mutex);
+			stats.size += shard.index.size();
+			stats.hits += shard.hits;
+			stats.misses += shard.misses;
+			stats.evictions += shard.evictions;
+			stats.expirations += shard.expirations;
+		}
+		return stats;
+	}
+
+protected:
+	struct Slot
+	{
+		Slot():
+			key(),
+			value(),
+			used(false),
+			referenced(false)
+		{
+		}
+
+		TKey key;
+		TValue value;
+		Poco::Timestamp expires;
+		bool used;
+		bool referenced;
+	};
+
+	typedef Poco::FlatHashMap<TKey, std::size_t, KeyHash> IndexMap;
+
+	struct Shard
+	{
+		Shard():
+			hand(0),
+			hits(0),
+			misses(0),
+			evictions(0),
+			expirations(0)
+		{
+		}
+
+		IndexMap index;
+		std::vector<Slot> slots;
+		std::vector<std::size_t> free;
+		std::size_t hand;
+		Poco::UInt64 hits;
+		Poco::UInt64 misses;
+		Poco::UInt64 evictions;
+		Poco::UInt64 expirations;
+		mutable Poco::FastMutex mutex;
+	};
+
+	typedef std::vector<Shard*> ShardVec;
+
+	Shard& shardFor(const TKey& key) const
+	{
+		std::size_t h = _hash(key);
+		// mix the bits, as the shard is selected by the low bits
+		h ^= h >> 16;
+		h *= 0x45d9f3b;
+		h ^= h >> 16;
+		return *_shards[h & _shardMask];
+	}
+
+	std::size_t evict(Shard& shard)
+		/// Returns the index of the slot to be reused, which is
+		/// an expired entry or the first unreferenced entry.
+		/// The shard must be full.
+	{
+		Poco::Timestamp now;
+		for (;;)
+		{
+			const std::size_t n = shard.hand;
+			shard.hand = (n + 1) % shard.slots.size();
+			Slot& slot = shard.slots[n];
+			if (_expire && slot.expires < now)
+			{
+				++shard.expirations;
+				return n;
+			}
+			if (slot.referenced)
+			{
+				slot.referenced = false;
+			}
+			else
+			{
+				++shard.evictions;
+				return n;
+			}
+		}
+	}
+
+	static void release(Shard& shard, std::size_t n)
+	{
+		Slot& slot = shard.slots[n];
+		slot.key = TKey();
+		slot.value = TValue();
+		slot.used = false;
+		slot.referenced = false;
+		shard.free.push_back(n);
+	}
+
+	void fireRemove(const std::vector<TKey>& keys)
+	{
+		for (typename std::vector<TKey>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+		{
+			Remove.notify(this, *it);
+		}
+	}
+
+private:
+	ConcurrentCache(const ConcurrentCache&);
+	ConcurrentCache& operator = (const ConcurrentCache&);
+
+	ShardVec _shards;
+	std::size_t _shardMask;
+	std::size_t _shardCapacity;
+	Poco::Timespan _ttl;
+	bool _expire;
+	bool _events;
+	KeyHash _hash;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_ConcurrentCache_INCLUDED
@@ -0,0 +1,278 @@
+//
+// EVPTransform.h
+//
+// Library: Crypto
+// Package: Cipher
+// Module:  EVPTransform
+//
+// Definition of the EVPTransform class.
+//
+// Copyright (c) 2008, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Crypto_EVPTransform_INCLUDED
+#define Crypto_EVPTransform_INCLUDED
+
+
+#include "Poco/Crypto/Crypto.h"
+#include "Poco/Crypto/CryptoTransform.h"
+#include "Poco/Crypto/CryptoException.h"
+#include "Poco/Exception.h"
+#include <openssl/evp.h>
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace Crypto {
+
+
+class EVPTransform: public CryptoTransform
+	/// An implementation of CryptoTransform for OpenSSL EVP ciphers,
+	/// with additional support for transforming contiguous buffers
+	/// in place and for authenticated encryption with associated data
+	/// (AEAD), such as AES-GCM and ChaCha20-Poly1305.
+	///
+	/// OpenSSL selects the fastest implementation of a cipher available
+	/// on the CPU at runtime, e.g. AES-NI and PCLMULQDQ on x86 or the
+	/// ARMv8 cryptography extensions. For best throughput, pass large
+	/// buffers to transform() and reuse an EVPTransform for several
+	/// messages with reset(), which keeps the key schedule.
+	///
+	/// In-place transformation requires that the output is never longer
+	/// than the input, which is the case for ciphers with a block size
+	/// of one (stream ciphers, CTR, GCM and ChaCha20-Poly1305), and for
+	/// block ciphers without padding if every buffer is a multiple of
+	/// the block size.
+	///
+	/// CCM mode is not supported.
+{
+public:
+	typedef std::vector<unsigned char> ByteVec;
+
+	enum Direction
+	{
+		DIR_ENCRYPT,
+		DIR_DECRYPT
+	};
+
+	EVPTransform(const EVP_CIPHER* pCipher, const ByteVec& key, const ByteVec& iv, Direction dir):
+		_pContext(0),
+		_pCipher(pCipher),
+		_encrypt(dir == DIR_ENCRYPT),
+		_aead(false),
+		_padding(true)
+		/// Creates the EVPTransform for the given cipher, key and
+		/// initialization vector (or nonce, for AEAD ciphers).
+	{
+		poco_check_ptr (pCipher);
+
+		_pContext = EVP_CIPHER_CTX_new();
+		if (!_pContext) throw OpenSSLException("EVP_CIPHER_CTX_new");
+		const int mode = EVP_CIPHER_mode(pCipher);
+		_aead = mode == EVP_CIPH_GCM_MODE || (EVP_CIPHER_flags(pCipher) & EVP_CIPH_FLAG_AEAD_CIPHER) != 0;
+		if (mode == EVP_CIPH_CCM_MODE)
+		{
+			EVP_CIPHER_CTX_free(_pContext);
+			throw Poco::NotImplementedException("CCM mode is not supported by EVPTransform");
+		}
+		if (!EVP_CipherInit_ex(_pContext, pCipher, 0, 0, 0, _encrypt ? 1 : 0))
+		{
+			EVP_CIPHER_CTX_free(_pContext);
+			throw OpenSSLException("EVP_CipherInit_ex");
+		}
+		try
+		{
+			init(key.empty() ? 0 : &key[0], iv.empty() ? 0 : &iv[0], iv.size());
+		}
+		catch (...)
+		{
+			EVP_CIPHER_CTX_free(_pContext);
+			throw;
+		}
+	}
+
+	~EVPTransform()
+		/// Destroys the EVPTransform.
+	{
+		EVP_CIPHER_CTX_free(_pContext);
+	}
+
+	bool isAEAD() const
+		/// Returns true if the cipher provides authenticated encryption.
+	{
+		return _aead;
+	}
+
+	void reset(const unsigned char* iv, std::size_t ivLength)
+		/// Starts a new message with the given initialization vector,
+		/// keeping the key. With AEAD ciphers, every message encrypted
+		/// with the same key must use a different IV (nonce).
+	{
+		init(0, iv, ivLength);
+	}
+
+	void reset(const ByteVec& iv)
+		/// Starts a new message with the given initialization vector,
+		/// keeping the key.
+	{
+		reset(iv.empty() ? 0 : &iv[0], iv.size());
+	}
+
+	void setAAD(const unsigned char* data, std::size_t length)
+		/// Adds additional authenticated data, which is authenticated, but
+		/// not encrypted. Must be called before transform().
+	{
+		if (!_aead) throw Poco::InvalidAccessException("Cipher does not support additional authenticated data");
+		while (length > 0)
+		{
+			int n = chunk(length);
+			int outLength = 0;
+			if (!EVP_CipherUpdate(_pContext, 0, &outLength, data, n)) throw OpenSSLException("EVP_CipherUpdate");
+			data += n;
+			length -= n;
+		}
+	}
+
+	bool canTransformInPlace(std::size_t length) const
+		/// Returns true if a buffer of the given length can be
+		/// transformed in place.
+	{
+		const std::size_t size = blockSize();
+		return size == 1 || (!_padding && length % size == 0);
+	}
+
+	std::size_t transform(unsigned char* buffer, std::size_t length)
+		/// Transforms the contents of the given buffer in place, without
+		/// copying. Returns length.
+		///
+		/// See canTransformInPlace() for the requirements.
+	{
+		if (!canTransformInPlace(length)) throw Poco::InvalidArgumentException("Buffer cannot be transformed in place");
+		std::size_t remaining = length;
+		while (remaining > 0)
+		{
+			int n = chunk(remaining);
+			int outLength = 0;
+			if (!EVP_CipherUpdate(_pContext, buffer, &outLength, buffer, n)) throw OpenSSLException("EVP_CipherUpdate");
+			poco_assert (outLength == n);
+			buffer += n;
+			remaining -= n;
+		}
+		return length;
+	}
+
+	std::size_t finalize()
+		/// Finalizes the transformation of buffers transformed in place,
+		/// and, when decrypting with an AEAD cipher, verifies the tag.
+		/// Returns 0.
+		///
+		/// Throws a CryptoException if the tag does not match.
+	{
+		unsigned char block[EVP_MAX_BLOCK_LENGTH];
+		std::streamsize n = finalize(block, static_cast<std::streamsize>(sizeof(block)));
+		if (n != 0) throw Poco::IllegalStateException("Data left after in-place transformation");
+		return 0;
+	}
+
+	// CryptoTransform
+	std::size_t blockSize() const
+	{
+		return static_cast<std::size_t>(EVP_CIPHER_block_size(_pCipher));
+	}
+
+	int setPadding(int padding)
+	{
+		_padding = padding != 0;
+		return EVP_CIPHER_CTX_set_padding(_pContext, padding);
+	}
+
+	std::string getTag(std::size_t tagSize = 16)
+	{
+		if (!_aead) throw Poco::InvalidAccessException("Cipher does not support authentication tags");
+		std::string tag(tagSize, '\0');
+		if (!EVP_CIPHER_CTX_ctrl(_pContext, EVP_CTRL_GCM_GET_TAG, static_cast<int>(tagSize), &tag[0])) throw OpenSSLException("EVP_CIPHER_CTX_ctrl");
+		return tag;
+	}
+
+	void setTag(const std::string& tag)
+	{
+		if (!_aead) throw Poco::InvalidAccessException("Cipher does not support authentication tags");
+		if (!EVP_CIPHER_CTX_ctrl(_pContext, EVP_CTRL_GCM_SET_TAG, static_cast<int>(tag.size()), const_cast<char*>(tag.data()))) throw OpenSSLException("EVP_CIPHER_CTX_ctrl");
+	}
+
+	std::streamsize transform(const unsigned char* input, std::streamsize inputLength, unsigned char* output, std::streamsize outputLength)
+	{
+		poco_assert (outputLength >= static_cast<std::streamsize>(inputLength + blockSize() - 1));
+
+		std::streamsize total = 0;
+		std::size_t remaining = static_cast<std::size_t>(inputLength);
+		while (remaining > 0)
+		{
+			int n = chunk(remaining);
+			int outLength = 0;
+			if (!EVP_CipherUpdate(_pContext, output + total, &outLength, input, n)) throw OpenSSLException("EVP_CipherUpdate");
+			input += n;
+			remaining -= n;
+			total += outLength;
+		}
+		return total;
+	}
+
+	std::streamsize finalize(unsigned char* output, std::streamsize length)
+	{
+		poco_assert (length >= static_cast<std::streamsize>(2*blockSize()));
+
+		int outLength = 0;
+		if (!EVP_CipherFinal_ex(_pContext, output, &outLength))
+		{
+			if (_aead && !_encrypt) throw CryptoException("Authentication failed");
+			throw OpenSSLException("EVP_CipherFinal_ex");
+		}
+		return outLength;
+	}
+
+protected:
+	enum
+	{
+		MAX_CHUNK = 0x40000000
+	};
+
+	void init(const unsigned char* key, const unsigned char* iv, std::size_t ivLength)
+	{
+		if (iv && _aead && ivLength != static_cast<std::size_t>(EVP_CIPHER_iv_length(_pCipher)))
+		{
+			if (!EVP_CIPHER_CTX_ctrl(_pContext, EVP_CTRL_GCM_SET_IVLEN, static_cast<int>(ivLength), 0)) throw OpenSSLException("EVP_CIPHER_CTX_ctrl");
+		}
+		else if (iv && ivLength != static_cast<std::size_t>(EVP_CIPHER_iv_length(_pCipher)))
+		{
+			throw Poco::InvalidArgumentException("Invalid IV length");
+		}
+		if (!EVP_CipherInit_ex(_pContext, 0, 0, key, iv, _encrypt ? 1 : 0)) throw OpenSSLException("EVP_CipherInit_ex");
+	}
+
+	static int chunk(std::size_t length)
+	{
+		return length > MAX_CHUNK ? static_cast<int>(MAX_CHUNK) : static_cast<int>(length);
+	}
+
+private:
+	EVPTransform(const EVPTransform&);
+	EVPTransform& operator = (const EVPTransform&);
+
+	EVP_CIPHER_CTX* _pContext;
+	const EVP_CIPHER* _pCipher;
+	bool _encrypt;
+	bool _aead;
+	bool _padding;
+};
+
+
+} } // namespace Poco::Crypto
+
+
+#endif // Crypto_EVPTransform_INCLUDED
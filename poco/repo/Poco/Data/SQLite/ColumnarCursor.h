@@ -0,0 +1,325 @@
+//
+// ColumnarCursor.h
+//
+// $Id$
+//
+// Library: Data/SQLite
+// Package: SQLite
+// Module:  ColumnarCursor
+//
+// Definition of the ColumnarCursor class.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Data_SQLite_ColumnarCursor_INCLUDED
+#define Data_SQLite_ColumnarCursor_INCLUDED
+
+
+#include "Poco/Data/SQLite/SQLite.h"
+#include "Poco/Data/SQLite/StatementCache.h"
+#include "Poco/Data/DataException.h"
+#include "Poco/Data/LOB.h"
+#include "Poco/Types.h"
+#include <vector>
+#include "sqlite3.h"
+
+
+namespace Poco {
+namespace Data {
+namespace SQLite {
+
+
+template <class T>
+struct ColumnTraits
+	/// Reads a value of type T from a result column of an SQLite
+	/// statement. The default reads integers.
+{
+	static T get(sqlite3_stmt* pStmt, int col)
+	{
+		return static_cast<T>(sqlite3_column_int64(pStmt, col));
+	}
+};
+
+
+template <>
+struct ColumnTraits<bool>
+{
+	static bool get(sqlite3_stmt* pStmt, int col)
+	{
+		return sqlite3_column_int64(pStmt, col) != 0;
+	}
+};
+
+
+template <>
+struct ColumnTraits<float>
+{
+	static float get(sqlite3_stmt* pStmt, int col)
+	{
+		return static_cast<float>(sqlite3_column_double(pStmt, col));
+	}
+};
+
+
+template <>
+struct ColumnTraits<double>
+{
+	static double get(sqlite3_stmt* pStmt, int col)
+	{
+		return sqlite3_column_double(pStmt, col);
+	}
+};
+
+
+template <>
+struct ColumnTraits<std::string>
+{
+	static std::string get(sqlite3_stmt* pStmt, int col)
+	{
+		const char* p = reinterpret_cast<const char*>(sqlite3_column_text(pStmt, col));
+		return p ? std::string(p, static_cast<std::size_t>(sqlite3_column_bytes(pStmt, col))) : std::string();
+	}
+};
+
+
+template <>
+struct ColumnTraits<Poco::Data::BLOB>
+{
+	static Poco::Data::BLOB get(sqlite3_stmt* pStmt, int col)
+	{
+		const unsigned char* p = static_cast<const unsigned char*>(sqlite3_column_blob(pStmt, col));
+		return p ? Poco::Data::BLOB(p, static_cast<std::size_t>(sqlite3_column_bytes(pStmt, col))) : Poco::Data::BLOB();
+	}
+};
+
+
+class ColumnarCursor
+	/// ColumnarCursor reads the result of a query column by column into
+	/// contiguous, typed std::vectors, one per result column, directly
+	/// from the SQLite statement. Unlike a RecordSet, values are not
+	/// held in Dynamic::Var or Any and no Row objects are created, which
+	/// makes aggregating large numbers of numeric rows much faster and
+	/// the memory used proportional to the column types.
+	///
+	/// Rows can be read all at once with fetchAll(), or in batches of
+	/// bounded size with fetch(), which replaces the content of the
+	/// vectors with the next batch:
+	///
+	///     CachedStatement::Ptr pStmt = cache.prepare("SELECT time, rsrp, snr FROM lte WHERE time >= ?");
+	///     pStmt->bind(1, since);
+	///     std::vector<Poco::Int64> time;
+	///     std::vector<Poco::Int16> rsrp;
+	///     std::vector<Poco::Int16> snr;
+	///     ColumnarCursor cursor(pStmt, 4096);
+	///     cursor.column(time).column(rsrp).column(snr);
+	///     while (cursor.fetch() > 0)
+	///     {
+	///         sum += std::accumulate(rsrp.begin(), rsrp.end(), 0L);
+	///     }
+	///
+	/// Result columns are assigned to vectors in the order of the
+	/// column() calls; skip() leaves out a result column. NULL values
+	/// are stored as the null value given to column().
+	///
+	/// Supported types are integers, bool, float, double, std::string
+	/// and BLOB. ColumnTraits can be specialized for other types.
+{
+public:
+	enum
+	{
+		DEFAULT_BATCH_SIZE = 4096
+	};
+
+	explicit ColumnarCursor(CachedStatement::Ptr pStmt, std::size_t batchSize = DEFAULT_BATCH_SIZE):
+		_pStmt(pStmt),
+		_batchSize(batchSize > 0 ? batchSize : 1),
+		_nextColumn(0),
+		_rows(0),
+		_done(false)
+		/// Creates the ColumnarCursor for the given statement, which
+		/// must have been bound, reading at most batchSize rows with
+		/// each fetch().
+	{
+		poco_check_ptr (_pStmt);
+	}
+
+	~ColumnarCursor()
+		/// Destroys the ColumnarCursor.
+	{
+		for (ColumnVec::iterator it = _columns.begin(); it != _columns.end(); ++it)
+		{
+			delete *it;
+		}
+	}
+
+	template <class T>
+	ColumnarCursor& column(std::vector<T>& values, const T& nullValue = T())
+		/// Assigns the next result column to the given vector, which
+		/// must stay valid as long as the ColumnarCursor is used.
+	{
+		checkColumn(_nextColumn);
+		_columns.push_back(new Column<T>(values, _nextColumn++, nullValue));
+		return *this;
+	}
+
+	ColumnarCursor& skip()
+		/// Leaves out the next result column.
+	{
+		++_nextColumn;
+		return *this;
+	}
+
+	std::size_t fetch()
+		/// Replaces the content of the vectors with the next batch of at most
+		/// batchSize rows, and returns the number of rows read, which is 0
+		/// if there are no more rows.
+	{
+		for (ColumnVec::iterator it = _columns.begin(); it != _columns.end(); ++it)
+		{
+			(*it)->clear();
+			(*it)->reserve(_batchSize);
+		}
+		return read(_batchSize);
+	}
+
+	std::size_t fetchAll()
+		/// Appends all remaining rows to the vectors, and returns
+		/// the number of rows read.
+	{
+		std::size_t total = 0;
+		std::size_t n;
+		do
+		{
+			n = read(_batchSize);
+			total += n;
+		}
+		while (n > 0);
+		return total;
+	}
+
+	bool done() const
+		/// Returns true if all rows have been read.
+	{
+		return _done;
+	}
+
+	Poco::UInt64 rows() const
+		/// Returns the number of rows read so far.
+	{
+		return _rows;
+	}
+
+	void reset()
+		/// Resets the statement for another execution, e.g. after
+		/// new values have been bound to it. The column assignments
+		/// are kept.
+	{
+		_pStmt->reset();
+		_rows = 0;
+		_done = false;
+	}
+
+	CachedStatement& statement()
+		/// Returns the statement.
+	{
+		return *_pStmt;
+	}
+
+protected:
+	class AbstractColumn
+	{
+	public:
+		virtual ~AbstractColumn()
+		{
+		}
+
+		virtual void clear() = 0;
+		virtual void reserve(std::size_t n) = 0;
+		virtual void append(sqlite3_stmt* pStmt) = 0;
+	};
+
+	template <class T>
+	class Column: public AbstractColumn
+	{
+	public:
+		Column(std::vector<T>& values, int index, const T& nullValue):
+			_values(values),
+			_index(index),
+			_nullValue(nullValue)
+		{
+		}
+
+		void clear()
+		{
+			_values.clear();
+		}
+
+		void reserve(std::size_t n)
+		{
+			_values.reserve(n);
+		}
+
+		void append(sqlite3_stmt* pStmt)
+		{
+			if (sqlite3_column_type(pStmt, _index) == SQLITE_NULL)
+				_values.push_back(_nullValue);
+			else
+				_values.push_back(ColumnTraits<T>::get(pStmt, _index));
+		}
+
+	private:
+		std::vector<T>& _values;
+		int _index;
+		T _nullValue;
+	};
+
+	typedef std::vector<AbstractColumn*> ColumnVec;
+
+	std::size_t read(std::size_t maxRows)
+	{
+		std::size_t n = 0;
+		sqlite3_stmt* pStmt = _pStmt->handle();
+		while (n < maxRows && !_done)
+		{
+			if (_pStmt->step())
+			{
+				for (ColumnVec::iterator it = _columns.begin(); it != _columns.end(); ++it)
+				{
+					(*it)->append(pStmt);
+				}
+				++n;
+			}
+			else _done = true;
+		}
+		_rows += n;
+		return n;
+	}
+
+	void checkColumn(int index)
+	{
+		if (index >= _pStmt->columnCount())
+			throw Poco::Data::ExtractException("Result column index out of range");
+	}
+
+private:
+	ColumnarCursor(const ColumnarCursor&);
+	ColumnarCursor& operator = (const ColumnarCursor&);
+
+	CachedStatement::Ptr _pStmt;
+	std::size_t _batchSize;
+	int _nextColumn;
+	ColumnVec _columns;
+	Poco::UInt64 _rows;
+	bool _done;
+};
+
+
+} } } // namespace Poco::Data::SQLite
+
+
+#endif // Data_SQLite_ColumnarCursor_INCLUDED
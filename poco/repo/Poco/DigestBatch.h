@@ -0,0 +1,266 @@
+//
+// DigestBatch.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Crypt
+// Module:  DigestBatch
+//
+// Definition of the DigestBatch class template.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_DigestBatch_INCLUDED
+#define Foundation_DigestBatch_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/DigestEngine.h"
+#include "Poco/MappedFile.h"
+#include "Poco/File.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+
+
+template <class Engine>
+class DigestBatch
+	/// DigestBatch computes the message digests of a number of files
+	/// with the given DigestEngine class, like SHA256Engine, on several
+	/// threads at the same time.
+	///
+	///     DigestBatch<SHA256Engine> batch;
+	///     batch.add("/opt/osp/codeCache/libFoo.so");
+	///     batch.add("/opt/osp/codeCache/libBar.so");
+	///     batch.compute();
+	///     for (std::size_t i = 0; i < batch.size(); ++i)
+	///     {
+	///         if (batch.succeeded(i))
+	///             std::cout << batch.path(i) << ": " << DigestEngine::digestToHex(batch.digest(i)) << std::endl;
+	///     }
+	///
+	/// Every thread uses its own Engine, and files are mapped into
+	/// memory with MappedFile and digested without being copied,
+	/// largest files first, so that the threads finish at about
+	/// the same time.
+	///
+	/// The Engine class must be default constructible.
+{
+public:
+	enum
+	{
+		DEFAULT_THREADS = 4
+	};
+
+	DigestBatch():
+		_next(0)
+		/// Creates an empty DigestBatch.
+	{
+	}
+
+	~DigestBatch()
+		/// Destroys the DigestBatch.
+	{
+	}
+
+	std::size_t add(const std::string& path)
+		/// Adds the file with the given path and returns its index.
+	{
+		Item item;
+		item.path = path;
+		_items.push_back(item);
+		return _items.size() - 1;
+	}
+
+	std::size_t size() const
+		/// Returns the number of files added.
+	{
+		return _items.size();
+	}
+
+	void clear()
+		/// Removes all files.
+	{
+		_items.clear();
+	}
+
+	std::size_t compute(int threads = DEFAULT_THREADS)
+		/// Computes the digests of all files, on up to the given
+		/// number of threads, including the calling thread.
+		///
+		/// Returns the number of files whose digest could not be
+		/// computed. See succeeded() and error().
+	{
+		std::vector<std::pair<Poco::UInt64, std::size_t> > order;
+		order.reserve(_items.size());
+		for (std::size_t i = 0; i < _items.size(); ++i)
+		{
+			Item& item = _items[i];
+			item.done = false;
+			item.digest.clear();
+			item.error.clear();
+			Poco::UInt64 size = 0;
+			try
+			{
+				size = Poco::File(item.path).getSize();
+			}
+			catch (Poco::Exception&)
+			{
+			}
+			order.push_back(std::make_pair(size, i));
+		}
+		std::sort(order.begin(), order.end(), std::greater<std::pair<Poco::UInt64, std::size_t> >());
+		_order.clear();
+		for (std::size_t i = 0; i < order.size(); ++i) _order.push_back(order[i].second);
+		_next = 0;
+
+		Worker worker(*this);
+		std::vector<Poco::Thread*> workers;
+		int n = static_cast<int>(_items.size()) < threads ? static_cast<int>(_items.size()) : threads;
+		for (int i = 1; i < n; ++i)
+		{
+			Poco::Thread* pThread = new Poco::Thread("DigestBatch");
+			try
+			{
+				pThread->start(worker);
+			}
+			catch (Poco::Exception&)
+			{
+				// continue with the threads already started
+				delete pThread;
+				break;
+			}
+			workers.push_back(pThread);
+		}
+		work();
+		for (std::vector<Poco::Thread*>::iterator it = workers.begin(); it != workers.end(); ++it)
+		{
+			(*it)->join();
+			delete *it;
+		}
+
+		std::size_t failed = 0;
+		for (typename ItemVec::const_iterator it = _items.begin(); it != _items.end(); ++it)
+		{
+			if (!it->done) ++failed;
+		}
+		return failed;
+	}
+
+	const std::string& path(std::size_t index) const
+		/// Returns the path of the file with the given index.
+	{
+		return _items.at(index).path;
+	}
+
+	bool succeeded(std::size_t index) const
+		/// Returns true if the digest of the file with
+		/// the given index has been computed.
+	{
+		return _items.at(index).done;
+	}
+
+	const DigestEngine::Digest& digest(std::size_t index) const
+		/// Returns the digest of the file with the given index,
+		/// or an empty digest if it could not be computed.
+	{
+		return _items.at(index).digest;
+	}
+
+	const std::string& error(std::size_t index) const
+		/// Returns the error message for the file with the given
+		/// index, if its digest could not be computed.
+	{
+		return _items.at(index).error;
+	}
+
+protected:
+	struct Item
+	{
+		Item():
+			done(false)
+		{
+		}
+
+		std::string path;
+		DigestEngine::Digest digest;
+		std::string error;
+		bool done;
+	};
+
+	typedef std::vector<Item> ItemVec;
+
+	class Worker: public Poco::Runnable
+	{
+	public:
+		explicit Worker(DigestBatch& batch):
+			_batch(batch)
+		{
+		}
+
+		void run()
+		{
+			_batch.work();
+		}
+
+	private:
+		DigestBatch& _batch;
+	};
+
+	void work()
+	{
+		Engine engine;
+		for (;;)
+		{
+			std::size_t index;
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				if (_next == _order.size()) return;
+				index = _order[_next++];
+			}
+			Item& item = _items[index];
+			try
+			{
+				engine.reset();
+				Poco::MappedFile file(item.path, Poco::MappedFile::ADVICE_SEQUENTIAL);
+				engine.update(file.data(), file.size());
+				item.digest = engine.digest();
+				item.done = true;
+			}
+			catch (Poco::Exception& exc)
+			{
+				item.error = exc.displayText();
+			}
+		}
+	}
+
+private:
+	DigestBatch(const DigestBatch&);
+	DigestBatch& operator = (const DigestBatch&);
+
+	ItemVec _items;
+	std::vector<std::size_t> _order;
+	std::size_t _next;
+	Poco::FastMutex _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_DigestBatch_INCLUDED
@@ -0,0 +1,355 @@
+//
+// FlatStruct.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Dynamic
+// Module:  Struct
+//
+// Definition of the FlatStruct class.
+//
+// Copyright (c) 2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FlatStruct_INCLUDED
+#define Foundation_FlatStruct_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Dynamic/Var.h"
+#include "Poco/Dynamic/VarHolder.h"
+#include "Poco/Dynamic/Struct.h"
+#include "Poco/FlatMap.h"
+#include "Poco/SharedPtr.h"
+#include <set>
+
+
+namespace Poco {
+namespace Dynamic {
+
+
+template <typename K>
+class FlatStruct
+	/// FlatStruct is a named collection of Var objects, like Struct,
+	/// but its members are stored in a Poco::FlatMap, i.e. a single
+	/// sorted vector, instead of a std::map.
+	///
+	/// For the small structs typical of JSON objects and request
+	/// attributes, a FlatStruct needs a single allocation instead of
+	/// one per member:
+	///
+	///     Poco::FlatDynamicStruct ds;
+	///     ds.reserve(4);
+	///     ds["id"] = 42;
+	///
+	/// FlatStruct is a separate type, so that Struct, and the code
+	/// using it in the compiled libraries, is not affected. It can be
+	/// constructed from a Struct and converted to one with toStruct().
+	/// Var supports indexing by name (Var::operator []) only for a
+	/// DynamicStruct, so a FlatStruct stored in a Var must be extracted
+	/// before its members can be accessed.
+{
+public:
+	typedef Poco::FlatMap<K, Var> Data;
+	typedef typename std::set<K> NameSet;
+	typedef typename Data::Iterator Iterator;
+	typedef typename Data::ConstIterator ConstIterator;
+	typedef typename Data::ValueType ValueType;
+	typedef typename Data::SizeType SizeType;
+	typedef typename std::pair<Iterator, bool> InsRetVal;
+	typedef typename Poco::SharedPtr<FlatStruct<K> > Ptr;
+
+	FlatStruct(): _data()
+		/// Creates an empty FlatStruct.
+	{
+	}
+
+	FlatStruct(const Data& val): _data(val)
+		/// Creates the FlatStruct from the given value.
+	{
+	}
+
+	explicit FlatStruct(const Struct<K>& val):
+		_data(val.begin(), val.end())
+		/// Creates the FlatStruct from a Struct.
+	{
+	}
+
+	template <typename T>
+	FlatStruct(const std::map<K, T>& val)
+	{
+		typedef typename std::map<K, T>::const_iterator MapConstIterator;
+
+		_data.reserve(val.size());
+		MapConstIterator it = val.begin();
+		MapConstIterator end = val.end();
+		for (; it != end; ++it) _data.insert(ValueType(it->first, Var(it->second)));
+	}
+
+	virtual ~FlatStruct()
+		/// Destroys the FlatStruct.
+	{
+	}
+
+	inline Var& operator [] (const K& name)
+		/// Returns the Var with the given name, creates an entry if not found.
+	{
+		return _data[name];
+	}
+
+	const Var& operator [] (const K& name) const
+		/// Returns the Var with the given name, throws a
+		/// NotFoundException if the data member is not found.
+	{
+		ConstIterator it = find(name);
+		if (it == end()) throw NotFoundException(name);
+		return it->second;
+	}
+
+	inline bool contains(const K& name) const
+		/// Returns true if the FlatStruct contains a member with the given name
+	{
+		return find(name) != end();
+	}
+
+	inline Iterator find(const K& name)
+		/// Returns an iterator, pointing to the <name,Var> pair containing
+		/// the element, or it returns end() if the member was not found
+	{
+		return _data.find(name);
+	}
+
+	inline ConstIterator find(const K& name) const
+		/// Returns a const iterator, pointing to the <name,Var> pair containing
+		/// the element, or it returns end() if the member was not found
+	{
+		return _data.find(name);
+	}
+
+	inline Iterator end()
+		/// Returns the end iterator for the FlatStruct
+	{
+		return _data.end();
+	}
+
+	inline ConstIterator end() const
+		/// Returns the end const iterator for the FlatStruct
+	{
+		return _data.end();
+	}
+
+	inline Iterator begin()
+		/// Returns the begin iterator for the FlatStruct
+	{
+		return _data.begin();
+	}
+
+	inline ConstIterator begin() const
+		/// Returns the begin const iterator for the FlatStruct
+	{
+		return _data.begin();
+	}
+
+	template <typename T>
+	inline InsRetVal insert(const K& key, const T& value)
+		/// Inserts a <name, Var> pair into the FlatStruct,
+		/// returns a pair containing the iterator and a boolean which
+		/// indicates success or not (is true, when insert succeeded, false,
+		/// when already another element was present, in this case Iterator
+		/// points to that other element)
+	{
+		ValueType valueType(key, value);
+		return insert(valueType);
+	}
+
+	inline InsRetVal insert(const ValueType& aPair)
+		/// Inserts a <name, Var> pair into the FlatStruct,
+		/// returns a pair containing the iterator and a boolean which
+		/// indicates success or not (is true, when insert succeeded, false,
+		/// when already another element was present, in this case Iterator
+		/// points to that other element)
+	{
+		return _data.insert(aPair);
+	}
+
+	inline SizeType erase(const K& key)
+		/// Erases the element if found, returns number of elements deleted
+	{
+		return _data.erase(key);
+	}
+
+	inline void erase(Iterator& it)
+		/// Erases the element at the given position
+	{
+		_data.erase(it);
+	}
+
+	inline bool empty() const
+		/// Returns true if the FlatStruct doesn't contain any members
+	{
+		return _data.empty();
+	}
+
+	SizeType size() const
+		/// Returns the number of members the FlatStruct contains
+	{
+		return _data.size();
+	}
+
+	void reserve(SizeType size)
+		/// Reserves room for the given number of members.
+	{
+		_data.reserve(size);
+	}
+
+	inline NameSet members() const
+		/// Returns a sorted collection containing all member names
+	{
+		NameSet keys;
+		ConstIterator it = begin();
+		ConstIterator itEnd = end();
+		for (; it != itEnd; ++it) keys.insert(it->first);
+		return keys;
+	}
+
+	Struct<K> toStruct() const
+		/// Returns a Struct with the members of the FlatStruct.
+	{
+		Struct<K> result;
+		for (ConstIterator it = begin(); it != end(); ++it) result.insert(*it);
+		return result;
+	}
+
+	std::string toString()
+	{
+		std::string str;
+		Var(*this).convert<std::string>(str);
+		return str;
+	}
+
+private:
+	Data _data;
+};
+
+
+template <>
+class VarHolderImpl<FlatStruct<std::string> >: public VarHolder
+	/// The VarHolder for a FlatDynamicStruct. It converts to a
+	/// string like the VarHolder for a DynamicStruct; all other
+	/// conversions throw a BadCastException. isStruct() returns
+	/// false, as the compiled Var and JSON code expects a
+	/// DynamicStruct in a Var for which isStruct() is true.
+{
+public:
+	VarHolderImpl(const FlatStruct<std::string>& val): _val(val)
+	{
+	}
+
+	~VarHolderImpl()
+	{
+	}
+
+	const std::type_info& type() const
+	{
+		return typeid(FlatStruct<std::string>);
+	}
+
+	void convert(std::string& val) const
+	{
+		val.append("{ ");
+		FlatStruct<std::string>::ConstIterator it = _val.begin();
+		FlatStruct<std::string>::ConstIterator itEnd = _val.end();
+		if (!_val.empty())
+		{
+			Var key(it->first);
+			Impl::appendJSONKey(val, key);
+			val.append(" : ");
+			Impl::appendJSONValue(val, it->second);
+			++it;
+		}
+		for (; it != itEnd; ++it)
+		{
+			val.append(", ");
+			Var key(it->first);
+			Impl::appendJSONKey(val, key);
+			val.append(" : ");
+			Impl::appendJSONValue(val, it->second);
+		}
+		val.append(" }");
+	}
+
+	VarHolder* clone(Placeholder<VarHolder>* pVarHolder = 0) const
+	{
+		return cloneHolder(pVarHolder, _val);
+	}
+
+	const FlatStruct<std::string>& value() const
+	{
+		return _val;
+	}
+
+	bool isArray() const
+	{
+		return false;
+	}
+
+	bool isStruct() const
+	{
+		return false;
+	}
+
+	bool isInteger() const
+	{
+		return false;
+	}
+
+	bool isSigned() const
+	{
+		return false;
+	}
+
+	bool isNumeric() const
+	{
+		return false;
+	}
+
+	bool isString() const
+	{
+		return false;
+	}
+
+	std::size_t size() const
+	{
+		return _val.size();
+	}
+
+	Var& operator [] (const std::string& name)
+	{
+		return _val[name];
+	}
+
+	const Var& operator [] (const std::string& name) const
+	{
+		return _val[name];
+	}
+
+private:
+	FlatStruct<std::string> _val;
+};
+
+
+} // namespace Dynamic
+
+
+typedef Dynamic::FlatStruct<std::string> FlatDynamicStruct;
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FlatStruct_INCLUDED
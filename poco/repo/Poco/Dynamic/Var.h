@@ -229,12 +229,8 @@ public:
 	Var& operator = (const T& other)
 		/// Assignment operator for assigning POD to Var
 	{
-#ifdef POCO_NO_SOO
 		Var tmp(other);
 		swap(tmp);
-#else
-		construct(other);
-#endif
 		return *this;
 	}
 
@@ -688,12 +684,15 @@ inline void Var::swap(Var& other)
 		Var tmp(*this);
 		try
 		{
-			if (_placeholder.isLocal()) destruct();
+			destruct();
+			_placeholder.erase();
 			construct(other);
 			other = tmp;
 		}
 		catch (...)
 		{
+			destruct();
+			_placeholder.erase();
 			construct(tmp);
 			throw;
 		}
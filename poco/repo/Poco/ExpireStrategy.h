@@ -61,7 +61,7 @@ public:
 
 	void onAdd(const void*, const KeyValueArgs <TKey, TValue>& args)
 	{
-		Timestamp now;
+		Timestamp now = Timestamp::fast();
 		typename TimeIndex::value_type tiValue(now, args.key());
 		IndexIterator it = _keyIndex.insert(tiValue);
 		typename Keys::value_type kValue(args.key(), it);
@@ -99,7 +99,7 @@ public:
 		Iterator it = _keys.find(args.key());
 		if (it != _keys.end())
 		{
-			if (it->second->first.isElapsed(_expireTime))
+			if (Timestamp::fast() - it->second->first >= _expireTime)
 			{
 				args.invalidate();
 			}
@@ -113,8 +113,9 @@ public:
 		// Note: replace only informs the cache which elements
 		// it would like to remove!
 		// it does not remove them on its own!
+		Timestamp now = Timestamp::fast();
 		IndexIterator it = _keyIndex.begin();
-		while (it != _keyIndex.end() && it->first.isElapsed(_expireTime))
+		while (it != _keyIndex.end() && now - it->first >= _expireTime)
 		{
 			elemsToRemove.insert(it->second);
 			++it;
@@ -0,0 +1,289 @@
+//
+// FastNotificationCenter.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Notifications
+// Module:  FastNotificationCenter
+//
+// Definition of the FastNotificationCenter class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FastNotificationCenter_INCLUDED
+#define Foundation_FastNotificationCenter_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Notification.h"
+#include "Poco/AbstractObserver.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/AtomicPointer.h"
+#include "Poco/Mutex.h"
+#include <vector>
+#include <typeinfo>
+#include <cstddef>
+
+
+namespace Poco {
+
+
+class FastNotificationCenter
+	/// FastNotificationCenter delivers notifications to observers
+	/// like NotificationCenter, and is used in the same way, with
+	/// Observer and NObserver, but posting a notification neither
+	/// takes a lock nor copies the list of observers.
+	///
+	/// NotificationCenter::postNotification() copies the list of
+	/// all observers under a mutex, and asks every observer, with
+	/// a dynamic_cast, whether it accepts the notification.
+	/// FastNotificationCenter keeps an immutable snapshot of the
+	/// observers, which is replaced whenever an observer is added
+	/// or removed. For every class of notification posted, the
+	/// snapshot holds a bucket with the observers that accept it,
+	/// which is determined with accepts() the first time a
+	/// notification of that class is posted, so that posting
+	/// only visits the matching observers.
+	///
+	/// Therefore, the accepts() member function of the observers
+	/// must only depend on the class of the notification, as is
+	/// the case with Observer and NObserver.
+	///
+	/// Observers added during a dispatch cycle will not receive
+	/// the current notification. Observers removed during a dispatch
+	/// cycle are disabled, and receive no further notifications.
+	///
+	/// Snapshots that have been replaced are deleted as soon as no
+	/// thread is posting a notification, either by the change replacing
+	/// them, or by the last thread to finish posting.
+{
+public:
+	FastNotificationCenter():
+		_pSnapshot(new Snapshot)
+		/// Creates the FastNotificationCenter.
+	{
+	}
+
+	~FastNotificationCenter()
+		/// Destroys the FastNotificationCenter.
+	{
+		reclaim();
+		delete _pSnapshot.load();
+	}
+
+	void addObserver(const AbstractObserver& observer)
+		/// Registers an observer with the FastNotificationCenter.
+		/// See NotificationCenter::addObserver().
+	{
+		FastMutex::ScopedLock lock(_mutex);
+
+		Snapshot* pNew = new Snapshot;
+		pNew->observers = _pSnapshot.load()->observers;
+		pNew->observers.push_back(AbstractObserverPtr(observer.clone()));
+		publish(pNew);
+	}
+
+	void removeObserver(const AbstractObserver& observer)
+		/// Unregisters an observer with the FastNotificationCenter.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+
+		const ObserverList& observers = _pSnapshot.load()->observers;
+		for (ObserverList::const_iterator it = observers.begin(); it != observers.end(); ++it)
+		{
+			if (observer.equals(**it))
+			{
+				AbstractObserverPtr pObserver = *it;
+				pObserver->disable();
+				Snapshot* pNew = new Snapshot;
+				pNew->observers.reserve(observers.size() - 1);
+				pNew->observers.insert(pNew->observers.end(), observers.begin(), it);
+				pNew->observers.insert(pNew->observers.end(), it + 1, observers.end());
+				publish(pNew);
+				return;
+			}
+		}
+	}
+
+	bool hasObserver(const AbstractObserver& observer) const
+		/// Returns true if the observer is registered with this FastNotificationCenter.
+	{
+		Reader reader(*this);
+
+		const ObserverList& observers = reader.snapshot().observers;
+		for (ObserverList::const_iterator it = observers.begin(); it != observers.end(); ++it)
+		{
+			if (observer.equals(**it)) return true;
+		}
+		return false;
+	}
+
+	void postNotification(Notification::Ptr pNotification)
+		/// Posts a notification to the FastNotificationCenter, which
+		/// delivers the notification to all observers accepting it.
+		/// If an observer throws an exception, dispatching terminates
+		/// and the exception is rethrown to the caller.
+		/// Ownership of the notification object is claimed and the
+		/// notification is released before returning.
+	{
+		poco_check_ptr (pNotification);
+
+		Reader reader(*this);
+
+		const std::type_info& type = typeid(*pNotification);
+		const Bucket* pBucket = reader.snapshot().find(type);
+		if (!pBucket) pBucket = addBucket(type, pNotification);
+		for (std::vector<const AbstractObserver*>::const_iterator it = pBucket->observers.begin(); it != pBucket->observers.end(); ++it)
+		{
+			(*it)->notify(pNotification);
+		}
+	}
+
+	bool hasObservers() const
+		/// Returns true iff there is at least one registered observer.
+	{
+		Reader reader(*this);
+
+		return !reader.snapshot().observers.empty();
+	}
+
+	std::size_t countObservers() const
+		/// Returns the number of registered observers.
+	{
+		Reader reader(*this);
+
+		return reader.snapshot().observers.size();
+	}
+
+private:
+	typedef SharedPtr<AbstractObserver> AbstractObserverPtr;
+	typedef std::vector<AbstractObserverPtr> ObserverList;
+
+	struct Bucket
+	{
+		const std::type_info* pType;
+		std::vector<const AbstractObserver*> observers;
+	};
+
+	struct Snapshot
+	{
+		ObserverList observers;
+		std::vector<Bucket> buckets;
+
+		const Bucket* find(const std::type_info& type) const
+		{
+			for (std::vector<Bucket>::const_iterator it = buckets.begin(); it != buckets.end(); ++it)
+			{
+				if (it->pType == &type || *it->pType == type) return &*it;
+			}
+			return 0;
+		}
+	};
+
+	class Reader
+		/// Announces a thread reading the current snapshot,
+		/// so that it is not deleted while being read.
+	{
+	public:
+		explicit Reader(const FastNotificationCenter& center):
+			_center(center)
+		{
+			++_center._readers;
+		}
+
+		~Reader()
+		{
+			if (--_center._readers == 0 && _center._retiredCount.value() != 0) _center.tryReclaim();
+		}
+
+		const Snapshot& snapshot() const
+		{
+			return *_center._pSnapshot.load();
+		}
+
+	private:
+		Reader(const Reader&);
+		Reader& operator = (const Reader&);
+
+		const FastNotificationCenter& _center;
+	};
+
+	const Bucket* addBucket(const std::type_info& type, Notification* pNotification)
+		/// Creates a snapshot with a bucket for the given class of
+		/// notification, and returns the bucket.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+
+		const Snapshot* pCurrent = _pSnapshot.load();
+		const Bucket* pBucket = pCurrent->find(type);
+		if (pBucket) return pBucket;
+
+		Snapshot* pNew = new Snapshot(*pCurrent);
+		Bucket bucket;
+		bucket.pType = &type;
+		for (ObserverList::const_iterator it = pNew->observers.begin(); it != pNew->observers.end(); ++it)
+		{
+			if ((*it)->accepts(pNotification)) bucket.observers.push_back(it->get());
+		}
+		pNew->buckets.push_back(bucket);
+		publish(pNew);
+		return &pNew->buckets.back();
+	}
+
+	void publish(Snapshot* pNew)
+		/// Replaces the current snapshot. Must be called
+		/// with the mutex held.
+	{
+		Snapshot* pOld = _pSnapshot.load();
+		_pSnapshot.store(pNew);
+		_retired.push_back(pOld);
+		_retiredCount = static_cast<AtomicCounter::ValueType>(_retired.size());
+		if (_readers.value() == 0) reclaim();
+	}
+
+	void tryReclaim() const
+		/// Deletes the snapshots that have been replaced, if
+		/// no thread is reading a snapshot. Does nothing if the
+		/// mutex is held, e.g. by a thread changing the observers;
+		/// the next thread to finish posting tries again.
+	{
+		if (!_mutex.tryLock()) return;
+		if (_readers.value() == 0) reclaim();
+		_mutex.unlock();
+	}
+
+	void reclaim() const
+		/// Deletes the snapshots that have been replaced.
+		/// Must be called with the mutex held, or from
+		/// the destructor.
+	{
+		for (std::vector<Snapshot*>::iterator it = _retired.begin(); it != _retired.end(); ++it)
+		{
+			delete *it;
+		}
+		_retired.clear();
+		_retiredCount = 0;
+	}
+
+	FastNotificationCenter(const FastNotificationCenter&);
+	FastNotificationCenter& operator = (const FastNotificationCenter&);
+
+	AtomicPointer<Snapshot> _pSnapshot;
+	mutable std::vector<Snapshot*> _retired;
+	mutable AtomicCounter _retiredCount;
+	mutable AtomicCounter _readers;
+	mutable FastMutex _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FastNotificationCenter_INCLUDED
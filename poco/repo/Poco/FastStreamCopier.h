@@ -0,0 +1,313 @@
+//
+// FastStreamCopier.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Streams
+// Module:  StreamCopier
+//
+// Definition of class FastStreamCopier.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FastStreamCopier_INCLUDED
+#define Foundation_FastStreamCopier_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Buffer.h"
+#include "Poco/Error.h"
+#include "Poco/Exception.h"
+#include <istream>
+#include <ostream>
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#define POCO_HAVE_SENDFILE_SPLICE 1
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define POCO_HAVE_COPY_FILE_RANGE 1
+#endif
+#endif
+#endif
+
+
+namespace Poco {
+
+
+class FastStreamCopier
+	/// This class provides static methods to copy data like StreamCopier,
+	/// but with a large heap buffer instead of an 8 KB stack buffer, and,
+	/// between file descriptors, in the kernel where possible, so that
+	/// the data is not copied through user space:
+	///   * copy_file_range() between regular files (Linux 4.5 and glibc 2.27
+	///     or newer), which may share the blocks on copy-on-write file systems,
+	///   * sendfile() from a regular file, e.g. to a socket,
+	///   * splice() from or to a pipe, or through a pipe, e.g. from a socket
+	///     to a file.
+	/// Where none of these can be used, the data is copied with read()
+	/// and write().
+	///
+	/// All methods return the number of bytes copied.
+	///
+	/// SocketStreamCopier (Net) uses copyDescriptor() for streams
+	/// on sockets.
+{
+public:
+	enum
+	{
+		DEFAULT_BUFFER_SIZE = 256*1024,
+			/// The default buffer size for copying through user space.
+		MAX_CHUNK = 0x40000000
+			/// The maximum number of bytes copied with a single system call.
+	};
+
+	static Poco::UInt64 copyStream(std::istream& istr, std::ostream& ostr, std::size_t bufferSize = DEFAULT_BUFFER_SIZE)
+		/// Writes all bytes readable from istr to ostr, using an internal
+		/// buffer of the given size allocated on the heap.
+		///
+		/// Returns the number of bytes copied.
+	{
+		Poco::Buffer<char> buffer(bufferSize > 0 ? bufferSize : 1);
+		Poco::UInt64 len = 0;
+		while (istr.good() && ostr.good())
+		{
+			istr.read(buffer.begin(), static_cast<std::streamsize>(buffer.size()));
+			std::streamsize n = istr.gcount();
+			if (n <= 0) break;
+			ostr.write(buffer.begin(), n);
+			len += static_cast<Poco::UInt64>(n);
+		}
+		return len;
+	}
+
+#if defined(POCO_OS_FAMILY_UNIX)
+
+	static Poco::UInt64 copyDescriptor(int fdIn, int fdOut, Poco::UInt64 length = ~Poco::UInt64(0), std::size_t bufferSize = DEFAULT_BUFFER_SIZE)
+		/// Copies length bytes, or up to the end of the input, from fdIn,
+		/// starting at its current position, to fdOut, in the kernel where
+		/// possible. The positions of both descriptors are advanced by the
+		/// number of bytes copied.
+		///
+		/// Returns the number of bytes copied. Throws an IOException
+		/// if reading or writing fails.
+	{
+		Poco::UInt64 total = 0;
+#if defined(POCO_HAVE_SENDFILE_SPLICE)
+		struct stat in;
+		struct stat out;
+		if (::fstat(fdIn, &in) != 0 || ::fstat(fdOut, &out) != 0) throwError("Cannot copy data");
+#if defined(POCO_HAVE_COPY_FILE_RANGE)
+		if (S_ISREG(in.st_mode) && S_ISREG(out.st_mode) && transfer(METHOD_COPY_FILE_RANGE, fdIn, fdOut, length, total)) return total;
+#endif
+		if (S_ISREG(in.st_mode) && transfer(METHOD_SENDFILE, fdIn, fdOut, length, total)) return total;
+		if ((S_ISFIFO(in.st_mode) || S_ISFIFO(out.st_mode)) && transfer(METHOD_SPLICE, fdIn, fdOut, length, total)) return total;
+		if (!S_ISFIFO(in.st_mode) && !S_ISFIFO(out.st_mode) && spliceThroughPipe(fdIn, fdOut, length, total)) return total;
+#endif
+		Poco::Buffer<char> buffer(bufferSize > 0 ? bufferSize : 1);
+		while (total < length)
+		{
+			std::size_t chunk = static_cast<std::size_t>(length - total < buffer.size() ? length - total : buffer.size());
+			ssize_t n = ::read(fdIn, buffer.begin(), chunk);
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				throwError("Cannot read data");
+			}
+			if (n == 0) break;
+			writeDescriptor(fdOut, buffer.begin(), static_cast<std::size_t>(n));
+			total += static_cast<Poco::UInt64>(n);
+		}
+		return total;
+	}
+
+	static Poco::UInt64 copyFile(const std::string& source, const std::string& destination)
+		/// Copies the content of the file source to the file destination,
+		/// which is created, with the permissions of source, or truncated.
+		///
+		/// Returns the number of bytes copied.
+	{
+		Descriptor in(::open(source.c_str(), O_RDONLY | O_CLOEXEC));
+		if (in.fd < 0) throw Poco::OpenFileException(source, Poco::Error::getMessage(errno));
+		struct stat st;
+		if (::fstat(in.fd, &st) != 0) throw Poco::ReadFileException(source, Poco::Error::getMessage(errno));
+		Descriptor out(::open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 0777));
+		if (out.fd < 0) throw Poco::CreateFileException(destination, Poco::Error::getMessage(errno));
+		Poco::UInt64 n = copyDescriptor(in.fd, out.fd);
+		int fd = out.fd;
+		out.fd = -1;
+		if (::close(fd) != 0) throw Poco::WriteFileException(destination, Poco::Error::getMessage(errno));
+		return n;
+	}
+
+	static void writeDescriptor(int fd, const char* buffer, std::size_t length)
+		/// Writes length bytes from buffer to fd, with as
+		/// many calls to write() as needed.
+	{
+		while (length > 0)
+		{
+			ssize_t n = ::write(fd, buffer, length);
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				throwError("Cannot write data");
+			}
+			buffer += n;
+			length -= static_cast<std::size_t>(n);
+		}
+	}
+
+protected:
+	enum Method
+	{
+		METHOD_COPY_FILE_RANGE,
+		METHOD_SENDFILE,
+		METHOD_SPLICE
+	};
+
+	struct Descriptor
+	{
+		explicit Descriptor(int f): fd(f)
+		{
+		}
+
+		~Descriptor()
+		{
+			if (fd >= 0) ::close(fd);
+		}
+
+		int fd;
+	};
+
+	static void throwError(const std::string& msg)
+	{
+		int err = errno;
+		throw Poco::IOException(msg, Poco::Error::getMessage(err), err);
+	}
+
+#if defined(POCO_HAVE_SENDFILE_SPLICE)
+
+	static bool isUnsupported(int err)
+		/// Returns true if err tells that a method cannot be used for
+		/// the given descriptors, so that the next one must be tried.
+	{
+		return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP || err == EBADF;
+	}
+
+	static bool transfer(Method method, int fdIn, int fdOut, Poco::UInt64 length, Poco::UInt64& total)
+		/// Copies with the given method until length bytes or the end of
+		/// the input have been reached, and returns true, or returns false
+		/// if the method cannot be used (any more) for the descriptors.
+	{
+		while (total < length)
+		{
+			std::size_t chunk = static_cast<std::size_t>(length - total < Poco::UInt64(MAX_CHUNK) ? length - total : Poco::UInt64(MAX_CHUNK));
+			ssize_t n;
+			switch (method)
+			{
+#if defined(POCO_HAVE_COPY_FILE_RANGE)
+			case METHOD_COPY_FILE_RANGE:
+				n = ::copy_file_range(fdIn, 0, fdOut, 0, chunk, 0);
+				break;
+#endif
+			case METHOD_SENDFILE:
+				n = ::sendfile(fdOut, fdIn, 0, chunk);
+				break;
+			default:
+				n = ::splice(fdIn, 0, fdOut, 0, chunk, SPLICE_F_MOVE);
+				break;
+			}
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				if (isUnsupported(errno)) return false;
+				throwError("Cannot copy data");
+			}
+			if (n == 0) break;
+			total += static_cast<Poco::UInt64>(n);
+		}
+		return true;
+	}
+
+	static bool spliceThroughPipe(int fdIn, int fdOut, Poco::UInt64 length, Poco::UInt64& total)
+		/// Copies with splice() from fdIn into a pipe and from the pipe to
+		/// fdOut. Returns false if splice() cannot be used, after writing
+		/// any data already in the pipe to fdOut.
+	{
+		int fds[2];
+		if (::pipe2(fds, O_CLOEXEC) != 0) return false;
+		Descriptor pipeOut(fds[0]);
+		Descriptor pipeIn(fds[1]);
+		while (total < length)
+		{
+			std::size_t chunk = static_cast<std::size_t>(length - total < Poco::UInt64(MAX_CHUNK) ? length - total : Poco::UInt64(MAX_CHUNK));
+			ssize_t n = ::splice(fdIn, 0, pipeIn.fd, 0, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				if (isUnsupported(errno)) return false;
+				throwError("Cannot copy data");
+			}
+			if (n == 0) break;
+			while (n > 0)
+			{
+				ssize_t m = ::splice(pipeOut.fd, 0, fdOut, 0, static_cast<std::size_t>(n), SPLICE_F_MOVE | SPLICE_F_MORE);
+				if (m < 0)
+				{
+					if (errno == EINTR) continue;
+					if (!isUnsupported(errno)) throwError("Cannot copy data");
+					total += drainPipe(pipeOut.fd, fdOut, static_cast<std::size_t>(n));
+					return false;
+				}
+				n -= m;
+				total += static_cast<Poco::UInt64>(m);
+			}
+		}
+		return true;
+	}
+
+	static Poco::UInt64 drainPipe(int fdPipe, int fdOut, std::size_t length)
+	{
+		char buffer[8192];
+		Poco::UInt64 total = 0;
+		while (length > 0)
+		{
+			ssize_t n = ::read(fdPipe, buffer, length < sizeof(buffer) ? length : sizeof(buffer));
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				throwError("Cannot read data");
+			}
+			if (n == 0) break;
+			writeDescriptor(fdOut, buffer, static_cast<std::size_t>(n));
+			length -= static_cast<std::size_t>(n);
+			total += static_cast<Poco::UInt64>(n);
+		}
+		return total;
+	}
+
+#endif // POCO_HAVE_SENDFILE_SPLICE
+
+#endif // POCO_OS_FAMILY_UNIX
+
+private:
+	FastStreamCopier();
+	FastStreamCopier(const FastStreamCopier&);
+	FastStreamCopier& operator = (const FastStreamCopier&);
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FastStreamCopier_INCLUDED
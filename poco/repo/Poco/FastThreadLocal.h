@@ -0,0 +1,258 @@
+//
+// FastThreadLocal.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  Thread
+//
+// Definition of the FastThreadLocal template and related classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FastThreadLocal_INCLUDED
+#define Foundation_FastThreadLocal_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/ThreadLocal.h"
+#include <cstddef>
+#if __cplusplus >= 201103L
+#include "Poco/Mutex.h"
+#include <vector>
+#define POCO_FAST_THREADLOCAL_NATIVE 1
+#endif
+
+
+namespace Poco {
+
+
+#if defined(POCO_FAST_THREADLOCAL_NATIVE)
+
+
+class TLSNativeStorage
+	/// This class manages the local storage for each thread
+	/// in native thread_local storage, where the slots of the
+	/// FastThreadLocal objects are found by index, without the
+	/// map lookup performed by ThreadLocalStorage.
+	/// Never use this class directly, always use the
+	/// FastThreadLocal template for managing thread local storage.
+	///
+	/// Every FastThreadLocal object is assigned an index, which is
+	/// reused after the FastThreadLocal has been destroyed, and a
+	/// unique id, so that a slot left behind by a destroyed
+	/// FastThreadLocal is never handed out to another one.
+	/// The slots are deleted when the thread terminates.
+{
+public:
+	TLSNativeStorage()
+		/// Creates the TLS.
+	{
+	}
+
+	~TLSNativeStorage()
+		/// Deletes the TLS.
+	{
+		for (std::vector<Entry>::iterator it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			delete it->pSlot;
+		}
+	}
+
+	TLSAbstractSlot*& get(std::size_t index, UInt64 id)
+		/// Returns the slot for the given index and id.
+	{
+		if (index >= _entries.size()) _entries.resize(index + 1);
+		Entry& entry = _entries[index];
+		if (entry.id != id)
+		{
+			delete entry.pSlot;
+			entry.pSlot = 0;
+			entry.id = id;
+		}
+		return entry.pSlot;
+	}
+
+	static TLSNativeStorage& current()
+		/// Returns the TLS object for the current thread
+		/// (which may also be the main thread).
+	{
+		TLSNativeStorage*& pStorage = pointer();
+		if (!pStorage)
+		{
+			pStorage = new TLSNativeStorage;
+			static thread_local Cleanup cleanup;
+		}
+		return *pStorage;
+	}
+
+	static void allocate(std::size_t& index, UInt64& id)
+		/// Assigns an index and an id to a new FastThreadLocal.
+	{
+		Registry& registry = theRegistry();
+		FastMutex::ScopedLock lock(registry.mutex);
+		if (registry.free.empty())
+		{
+			index = registry.nextIndex++;
+		}
+		else
+		{
+			index = registry.free.back();
+			registry.free.pop_back();
+		}
+		id = ++registry.lastId;
+	}
+
+	static void release(std::size_t index)
+		/// Makes the index of a destroyed FastThreadLocal available
+		/// for reuse.
+	{
+		Registry& registry = theRegistry();
+		FastMutex::ScopedLock lock(registry.mutex);
+		registry.free.push_back(index);
+	}
+
+private:
+	struct Entry
+	{
+		Entry():
+			pSlot(0),
+			id(0)
+		{
+		}
+
+		TLSAbstractSlot* pSlot;
+		UInt64 id;
+	};
+
+	struct Registry
+	{
+		Registry():
+			nextIndex(0),
+			lastId(0)
+		{
+		}
+
+		FastMutex mutex;
+		std::vector<std::size_t> free;
+		std::size_t nextIndex;
+		UInt64 lastId;
+	};
+
+	struct Cleanup
+	{
+		~Cleanup()
+		{
+			// a FastThreadLocal used by the destructors of the slots,
+			// or later during thread termination, gets a new TLS,
+			// which is leaked
+			TLSNativeStorage*& pStorage = pointer();
+			TLSNativeStorage* pDone = pStorage;
+			pStorage = 0;
+			delete pDone;
+		}
+	};
+
+	static TLSNativeStorage*& pointer()
+	{
+		static thread_local TLSNativeStorage* pStorage = 0;
+		return pStorage;
+	}
+
+	static Registry& theRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	TLSNativeStorage(const TLSNativeStorage&);
+	TLSNativeStorage& operator = (const TLSNativeStorage&);
+
+	std::vector<Entry> _entries;
+};
+
+
+#endif // POCO_FAST_THREADLOCAL_NATIVE
+
+
+template <class C>
+class FastThreadLocal
+	/// FastThreadLocal is used like ThreadLocal, and references
+	/// a different object in every thread, which is created when
+	/// it is referenced for the first time.
+	///
+	/// With C++11, the data is kept in native thread_local
+	/// storage (see TLSNativeStorage), where it is found by
+	/// index instead of by a Thread::current() call and a map
+	/// lookup, and is deleted when the thread terminates.
+	/// Otherwise, it is kept in the ThreadLocalStorage of the
+	/// current Thread, like the data of a ThreadLocal.
+	///
+	/// FastThreadLocal is a separate template, so that the
+	/// ThreadLocal objects of the compiled libraries, e.g.
+	/// the one of RemotingNG::Context, are not affected.
+{
+	typedef TLSSlot<C> Slot;
+
+public:
+	FastThreadLocal():
+		_index(0),
+		_id(0)
+	{
+#if defined(POCO_FAST_THREADLOCAL_NATIVE)
+		TLSNativeStorage::allocate(_index, _id);
+#endif
+	}
+
+	~FastThreadLocal()
+	{
+#if defined(POCO_FAST_THREADLOCAL_NATIVE)
+		TLSNativeStorage::release(_index);
+#endif
+	}
+
+	C* operator -> ()
+	{
+		return &get();
+	}
+
+	C& operator * ()
+		/// "Dereferences" the smart pointer and returns a reference
+		/// to the underlying data object. The reference can be used
+		/// to modify the object.
+	{
+		return get();
+	}
+
+	C& get()
+		/// Returns a reference to the underlying data object.
+		/// The reference can be used to modify the object.
+	{
+#if defined(POCO_FAST_THREADLOCAL_NATIVE)
+		TLSAbstractSlot*& p = TLSNativeStorage::current().get(_index, _id);
+#else
+		TLSAbstractSlot*& p = ThreadLocalStorage::current().get(this);
+#endif
+		if (!p) p = new Slot;
+		return static_cast<Slot*>(p)->value();
+	}
+
+private:
+	FastThreadLocal(const FastThreadLocal&);
+	FastThreadLocal& operator = (const FastThreadLocal&);
+
+	std::size_t _index;
+	UInt64 _id;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FastThreadLocal_INCLUDED
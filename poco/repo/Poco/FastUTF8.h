@@ -0,0 +1,324 @@
+//
+// FastUTF8.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Text
+// Module:  FastUTF8
+//
+// Definition of the FastUTF8 class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FastUTF8_INCLUDED
+#define Foundation_FastUTF8_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/UTFString.h"
+#include <cstddef>
+#include <string>
+#if defined(__SSE2__) && !defined(POCO_FASTUTF8_NO_SIMD)
+#include <emmintrin.h>
+#define POCO_FASTUTF8_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(POCO_FASTUTF8_NO_SIMD)
+#include <arm_neon.h>
+#define POCO_FASTUTF8_NEON 1
+#endif
+
+
+namespace Poco {
+
+
+class FastUTF8
+	/// This class contains functions for validating UTF-8 and
+	/// converting between UTF-8 and UTF-16, which work on whole
+	/// buffers instead of one character at a time through the
+	/// virtual functions of TextEncoding, as UTF8Encoding,
+	/// TextConverter and UnicodeConverter do.
+	///
+	/// Runs of ASCII characters, which make up most of typical
+	/// JSON and XML payloads, are processed 16 characters at a
+	/// time with SSE2 or NEON (on AArch64); other characters are
+	/// decoded one sequence at a time.
+	///
+	/// Validation follows RFC 3629: overlong sequences, surrogates
+	/// (U+D800 to U+DFFF) and code points above U+10FFFF are invalid,
+	/// as with UTF8Encoding::isLegal().
+{
+public:
+	enum
+	{
+		BLOCK_SIZE = 16
+	};
+
+	static bool isValid(const char* p, std::size_t n)
+		/// Returns true if the given characters are valid UTF-8.
+	{
+		return validLength(p, n) == n;
+	}
+
+	static bool isValid(const std::string& str)
+		/// Returns true if the given string is valid UTF-8.
+	{
+		return validLength(str.data(), str.size()) == str.size();
+	}
+
+	static std::size_t validLength(const char* p, std::size_t n)
+		/// Returns the length of the longest prefix of the given
+		/// characters that is valid UTF-8, i.e. n if all are valid,
+		/// or the offset of the first invalid (or incomplete) sequence.
+	{
+		const unsigned char* begin = reinterpret_cast<const unsigned char*>(p);
+		const unsigned char* it = begin;
+		const unsigned char* end = begin + n;
+		while (it != end)
+		{
+			it = skipAscii(it, end);
+			const unsigned char* stop = (end - it > BLOCK_SIZE) ? it + BLOCK_SIZE : end;
+			while (it < stop)
+			{
+				if (*it < 0x80)
+				{
+					++it;
+					continue;
+				}
+				Poco::UInt32 cp;
+				int length = sequence(it, end, cp);
+				if (length == 0) return static_cast<std::size_t>(it - begin);
+				it += length;
+			}
+		}
+		return n;
+	}
+
+	static bool toUTF16(const char* p, std::size_t n, UTF16Char* out, std::size_t& length)
+		/// Converts the given UTF-8 characters to UTF-16. The output
+		/// buffer must have room for n UTF-16 code units. Stores the
+		/// number of code units written in length.
+		///
+		/// Returns false, after converting the valid prefix, if the
+		/// input is not valid UTF-8.
+	{
+		const unsigned char* it = reinterpret_cast<const unsigned char*>(p);
+		const unsigned char* end = it + n;
+		UTF16Char* q = out;
+		bool valid = true;
+		while (it != end && valid)
+		{
+#if defined(POCO_FASTUTF8_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			for (; end - it >= BLOCK_SIZE; it += BLOCK_SIZE, q += BLOCK_SIZE)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+				if (_mm_movemask_epi8(x)) break;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(q), _mm_unpacklo_epi8(x, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(q + 8), _mm_unpackhi_epi8(x, zero));
+			}
+#elif defined(POCO_FASTUTF8_NEON)
+			for (; end - it >= BLOCK_SIZE; it += BLOCK_SIZE, q += BLOCK_SIZE)
+			{
+				uint8x16_t x = vld1q_u8(it);
+				if (vmaxvq_u8(x) >= 0x80) break;
+				vst1q_u16(q, vmovl_u8(vget_low_u8(x)));
+				vst1q_u16(q + 8, vmovl_high_u8(x));
+			}
+#endif
+			const unsigned char* stop = (end - it > BLOCK_SIZE) ? it + BLOCK_SIZE : end;
+			while (it < stop)
+			{
+				if (*it < 0x80)
+				{
+					*q++ = *it++;
+					continue;
+				}
+				Poco::UInt32 cp;
+				int len = sequence(it, end, cp);
+				if (len == 0)
+				{
+					valid = false;
+					break;
+				}
+				it += len;
+				if (cp < 0x10000)
+				{
+					*q++ = static_cast<UTF16Char>(cp);
+				}
+				else
+				{
+					cp -= 0x10000;
+					*q++ = static_cast<UTF16Char>(0xD800 | (cp >> 10));
+					*q++ = static_cast<UTF16Char>(0xDC00 | (cp & 0x3FF));
+				}
+			}
+		}
+		length = static_cast<std::size_t>(q - out);
+		return valid;
+	}
+
+	static bool toUTF8(const UTF16Char* p, std::size_t n, char* out, std::size_t& length)
+		/// Converts the given UTF-16 code units to UTF-8. The output
+		/// buffer must have room for 3*n characters. Stores the
+		/// number of characters written in length.
+		///
+		/// Returns false, after converting the valid prefix, if the
+		/// input contains an unpaired surrogate.
+	{
+		const UTF16Char* it = p;
+		const UTF16Char* end = p + n;
+		unsigned char* q = reinterpret_cast<unsigned char*>(out);
+		bool valid = true;
+		while (it != end && valid)
+		{
+#if defined(POCO_FASTUTF8_SSE2)
+			const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+			const __m128i zero = _mm_setzero_si128();
+			for (; end - it >= BLOCK_SIZE; it += BLOCK_SIZE, q += BLOCK_SIZE)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it + 8));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(a, b), high), zero)) != 0xFFFF) break;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(q), _mm_packus_epi16(a, b));
+			}
+#elif defined(POCO_FASTUTF8_NEON)
+			for (; end - it >= BLOCK_SIZE; it += BLOCK_SIZE, q += BLOCK_SIZE)
+			{
+				uint16x8_t a = vld1q_u16(it);
+				uint16x8_t b = vld1q_u16(it + 8);
+				if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80) break;
+				vst1q_u8(q, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+			}
+#endif
+			const UTF16Char* stop = (end - it > BLOCK_SIZE) ? it + BLOCK_SIZE : end;
+			while (it < stop)
+			{
+				Poco::UInt32 cp = *it++;
+				if (cp < 0x80)
+				{
+					*q++ = static_cast<unsigned char>(cp);
+					continue;
+				}
+				if (cp >= 0xD800 && cp <= 0xDFFF)
+				{
+					if (cp > 0xDBFF || it == end || *it < 0xDC00 || *it > 0xDFFF)
+					{
+						--it;
+						valid = false;
+						break;
+					}
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (*it++ - 0xDC00);
+				}
+				if (cp < 0x800)
+				{
+					*q++ = static_cast<unsigned char>(0xC0 | (cp >> 6));
+				}
+				else
+				{
+					if (cp < 0x10000)
+					{
+						*q++ = static_cast<unsigned char>(0xE0 | (cp >> 12));
+					}
+					else
+					{
+						*q++ = static_cast<unsigned char>(0xF0 | (cp >> 18));
+						*q++ = static_cast<unsigned char>(0x80 | ((cp >> 12) & 0x3F));
+					}
+					*q++ = static_cast<unsigned char>(0x80 | ((cp >> 6) & 0x3F));
+				}
+				*q++ = static_cast<unsigned char>(0x80 | (cp & 0x3F));
+			}
+		}
+		length = static_cast<std::size_t>(q - reinterpret_cast<unsigned char*>(out));
+		return valid;
+	}
+
+	static bool convert(const std::string& utf8, UTF16String& utf16)
+		/// Converts a UTF-8 string to UTF-16, like UnicodeConverter::convert(),
+		/// and returns true, or returns false, after converting the valid
+		/// prefix, if the string is not valid UTF-8.
+	{
+		utf16.resize(utf8.size());
+		std::size_t length = 0;
+		bool valid = utf8.empty() || toUTF16(utf8.data(), utf8.size(), &utf16[0], length);
+		utf16.resize(length);
+		return valid;
+	}
+
+	static bool convert(const UTF16String& utf16, std::string& utf8)
+		/// Converts a UTF-16 string to UTF-8, like UnicodeConverter::convert(),
+		/// and returns true, or returns false, after converting the valid
+		/// prefix, if the string contains an unpaired surrogate.
+	{
+		utf8.resize(3*utf16.size());
+		std::size_t length = 0;
+		bool valid = utf16.empty() || toUTF8(utf16.data(), utf16.size(), &utf8[0], length);
+		utf8.resize(length);
+		return valid;
+	}
+
+private:
+	static const unsigned char* skipAscii(const unsigned char* it, const unsigned char* end)
+		/// Skips blocks of ASCII characters.
+	{
+#if defined(POCO_FASTUTF8_SSE2)
+		for (; end - it >= BLOCK_SIZE; it += BLOCK_SIZE)
+		{
+			if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(it)))) break;
+		}
+#elif defined(POCO_FASTUTF8_NEON)
+		for (; end - it >= BLOCK_SIZE; it += BLOCK_SIZE)
+		{
+			if (vmaxvq_u8(vld1q_u8(it)) >= 0x80) break;
+		}
+#endif
+		return it;
+	}
+
+	static int sequence(const unsigned char* p, const unsigned char* end, Poco::UInt32& cp)
+		/// Decodes the multi-byte sequence at p, and returns its
+		/// length, or 0 if it is invalid or incomplete.
+	{
+		unsigned char c = *p;
+		std::ptrdiff_t avail = end - p;
+		if (c < 0xC2)
+		{
+			return 0;
+		}
+		else if (c < 0xE0)
+		{
+			if (avail < 2 || (p[1] & 0xC0) != 0x80) return 0;
+			cp = ((c & 0x1F) << 6) | (p[1] & 0x3F);
+			return 2;
+		}
+		else if (c < 0xF0)
+		{
+			if (avail < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80) return 0;
+			if ((c == 0xE0 && p[1] < 0xA0) || (c == 0xED && p[1] > 0x9F)) return 0;
+			cp = ((c & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+			return 3;
+		}
+		else if (c < 0xF5)
+		{
+			if (avail < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80) return 0;
+			if ((c == 0xF0 && p[1] < 0x90) || (c == 0xF4 && p[1] > 0x8F)) return 0;
+			cp = ((c & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+			return 4;
+		}
+		return 0;
+	}
+
+	FastUTF8();
+	~FastUTF8();
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FastUTF8_INCLUDED
@@ -0,0 +1,159 @@
+//
+// FilteredDelegate.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Events
+// Module:  FilteredDelegate
+//
+// Implementation of the FilteredDelegate template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FilteredDelegate_INCLUDED
+#define Foundation_FilteredDelegate_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/AbstractDelegate.h"
+#include "Poco/MetaProgramming.h"
+#include "Poco/Mutex.h"
+
+
+namespace Poco {
+
+
+template <class TArgs>
+class AbstractDelegateFilter
+	/// Base class for filters used with FilteredDelegate.
+	///
+	/// A filter decides, for every notification, whether the
+	/// decorated delegate is invoked. Filters may keep state,
+	/// e.g. the last value that has been accepted, to implement
+	/// thresholds or hysteresis. Every registration of a
+	/// FilteredDelegate owns its own copy of the filter.
+{
+public:
+	typedef typename TypeWrapper<TArgs>::CONSTREFTYPE ArgsRef;
+
+	AbstractDelegateFilter()
+	{
+	}
+
+	virtual ~AbstractDelegateFilter()
+	{
+	}
+
+	virtual bool accept(ArgsRef arguments) = 0;
+		/// Returns true if the delegate shall be invoked with
+		/// the given arguments.
+
+	virtual AbstractDelegateFilter* clone() const = 0;
+		/// Returns a deep copy of the filter.
+};
+
+
+template <class TArgs>
+class FilteredDelegate: public AbstractDelegate<TArgs>
+	/// Decorator for AbstractDelegate that invokes the decorated
+	/// delegate only if the notification is accepted by a filter.
+	///
+	/// The filter is evaluated in the notifying thread, so delegates
+	/// are not woken up for notifications they are not interested in.
+	///
+	///     event += filtered(delegate(this, &MyController::onDataChanged), MyFilter(...));
+	///
+	/// For removal, a FilteredDelegate compares equal to the
+	/// decorated delegate, so the filter does not need to be specified:
+	///
+	///     event -= delegate(this, &MyController::onDataChanged);
+{
+public:
+	FilteredDelegate(const AbstractDelegate<TArgs>& delegate, const AbstractDelegateFilter<TArgs>& filter):
+		_pDelegate(delegate.clone()),
+		_pFilter(filter.clone())
+	{
+	}
+
+	FilteredDelegate(const FilteredDelegate& delegate):
+		AbstractDelegate<TArgs>(delegate),
+		_pDelegate(delegate._pDelegate->clone()),
+		_pFilter(delegate._pFilter->clone())
+	{
+	}
+
+	~FilteredDelegate()
+	{
+		delete _pFilter;
+		delete _pDelegate;
+	}
+
+	FilteredDelegate& operator = (const FilteredDelegate& delegate)
+	{
+		if (&delegate != this)
+		{
+			delete this->_pFilter;
+			delete this->_pDelegate;
+			this->_pDelegate = delegate._pDelegate->clone();
+			this->_pFilter   = delegate._pFilter->clone();
+		}
+		return *this;
+	}
+
+	bool notify(const void* sender, TArgs& arguments)
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (!_pFilter->accept(arguments)) return true;
+		}
+		return this->_pDelegate->notify(sender, arguments);
+	}
+
+	bool equals(const AbstractDelegate<TArgs>& other) const
+	{
+		return other.equals(*_pDelegate);
+	}
+
+	AbstractDelegate<TArgs>* clone() const
+	{
+		return new FilteredDelegate(*this);
+	}
+
+	void disable()
+	{
+		_pDelegate->disable();
+	}
+
+	const AbstractDelegate<TArgs>* unwrap() const
+	{
+		return this->_pDelegate;
+	}
+
+protected:
+	AbstractDelegate<TArgs>*       _pDelegate;
+	AbstractDelegateFilter<TArgs>* _pFilter;
+	FastMutex                      _mutex;
+
+private:
+	FilteredDelegate();
+};
+
+
+template <class TArgs>
+inline FilteredDelegate<TArgs> filtered(const AbstractDelegate<TArgs>& delegate, const AbstractDelegateFilter<TArgs>& filter)
+	/// Decorates delegate with the given filter.
+{
+	return FilteredDelegate<TArgs>(delegate, filter);
+}
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FilteredDelegate_INCLUDED
@@ -0,0 +1,73 @@
+//
+// FixedPriorityEvent.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Events
+// Module:  FixedPriorityEvent
+//
+// Implementation of the FixedPriorityEvent template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FixedPriorityEvent_INCLUDED
+#define Foundation_FixedPriorityEvent_INCLUDED
+
+
+#include "Poco/AbstractEvent.h"
+#include "Poco/FixedPriorityStrategy.h"
+#include "Poco/AbstractPriorityDelegate.h"
+
+
+namespace Poco {
+
+
+template <class TArgs, int LEVELS, class TMutex = FastMutex> 
+class FixedPriorityEvent: public AbstractEvent < 
+	TArgs,
+	FixedPriorityStrategy<TArgs, AbstractPriorityDelegate<TArgs>, LEVELS>,
+	AbstractPriorityDelegate<TArgs>,
+	TMutex
+>
+	/// A FixedPriorityEvent is a PriorityEvent for a fixed
+	/// number of priority levels, from 0 (invoked first) to
+	/// LEVELS - 1. Delegates with the same priority are invoked
+	/// in the order in which they have been registered.
+	///
+	/// The delegates are registered with priorityDelegate(),
+	/// as for PriorityEvent, e.g.:
+	///
+	///     Poco::FixedPriorityEvent<const int, 3> ev;
+	///     ev += Poco::priorityDelegate(&target, &Target::onEvent, 1);
+	///
+	/// Registering a delegate with a priority outside of the
+	/// range throws an InvalidArgumentException.
+	///
+	/// notify() costs the same as for a SnapshotEvent,
+	/// see FixedPriorityStrategy.
+{
+public:
+	FixedPriorityEvent()
+	{
+	}
+
+	~FixedPriorityEvent()
+	{
+	}
+
+private:
+	FixedPriorityEvent(const FixedPriorityEvent&);
+	FixedPriorityEvent& operator = (const FixedPriorityEvent&);
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FixedPriorityEvent_INCLUDED
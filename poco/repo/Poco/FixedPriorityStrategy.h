@@ -0,0 +1,335 @@
+//
+// FixedPriorityStrategy.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Events
+// Module:  FixedPriorityStrategy
+//
+// Implementation of the FixedPriorityStrategy template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FixedPriorityStrategy_INCLUDED
+#define Foundation_FixedPriorityStrategy_INCLUDED
+
+
+#include "Poco/NotificationStrategy.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+namespace Poco {
+
+
+template <class TArgs, class TDelegate, int LEVELS>
+class FixedPriorityStrategy: public NotificationStrategy<TArgs, TDelegate>
+	/// NotificationStrategy for FixedPriorityEvent.
+	///
+	/// Like PriorityStrategy, but for priorities from 0 to
+	/// LEVELS - 1 only. The delegates are kept in a single,
+	/// immutable and reference-counted std::vector<>, grouped
+	/// by priority, together with the end offset of every
+	/// priority level, so add() finds its insertion position
+	/// without a search, and notify() walks the same flat
+	/// vector of delegates as SnapshotStrategy does, making
+	/// prioritized events exactly as cheap as unprioritized ones.
+	///
+	/// add() throws an InvalidArgumentException for priorities
+	/// outside of the range.
+{
+public:
+	typedef TDelegate*                   DelegateHandle;
+	typedef SharedPtr<TDelegate>         DelegatePtr;
+	typedef std::vector<DelegatePtr>     Delegates;
+	typedef typename Delegates::iterator Iterator;
+
+	struct Table
+	{
+		Table()
+		{
+			for (int i = 0; i < LEVELS; ++i) ends[i] = 0;
+		}
+
+		Delegates delegates;
+		std::size_t ends[LEVELS];
+	};
+
+	typedef SharedPtr<Table> TablePtr;
+
+public:
+	FixedPriorityStrategy():
+		_pTable(new Table)
+	{
+	}
+
+	FixedPriorityStrategy(const FixedPriorityStrategy& s):
+		_pTable(s._pTable)
+	{
+	}
+
+	~FixedPriorityStrategy()
+	{
+	}
+
+	void notify(const void* sender, TArgs& arguments)
+	{
+		Delegates& delegates = _pTable->delegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			(*it)->notify(sender, arguments);
+		}
+	}
+
+	DelegateHandle add(const TDelegate& delegate)
+	{
+		int level = delegate.priority();
+		if (level < 0 || level >= LEVELS) throw InvalidArgumentException("Priority out of range");
+		DelegatePtr pDelegate(static_cast<TDelegate*>(delegate.clone()));
+		const Delegates& delegates = _pTable->delegates;
+		typename Delegates::const_iterator pos = delegates.begin() + _pTable->ends[level];
+		TablePtr pTable(new Table(*_pTable));
+		pTable->delegates.clear();
+		pTable->delegates.reserve(delegates.size() + 1);
+		pTable->delegates.assign(delegates.begin(), pos);
+		pTable->delegates.push_back(pDelegate);
+		pTable->delegates.insert(pTable->delegates.end(), pos, delegates.end());
+		for (int i = level; i < LEVELS; ++i) ++pTable->ends[i];
+		_pTable = pTable;
+		return pDelegate.get();
+	}
+
+	void remove(const TDelegate& delegate)
+	{
+		Delegates& delegates = _pTable->delegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			if (delegate.equals(**it))
+			{
+				erase(it);
+				return;
+			}
+		}
+	}
+
+	void remove(DelegateHandle delegateHandle)
+	{
+		Delegates& delegates = _pTable->delegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			if (*it == delegateHandle)
+			{
+				erase(it);
+				return;
+			}
+		}
+	}
+
+	FixedPriorityStrategy& operator = (const FixedPriorityStrategy& s)
+	{
+		_pTable = s._pTable;
+		return *this;
+	}
+
+	void clear()
+	{
+		Delegates& delegates = _pTable->delegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			(*it)->disable();
+		}
+		_pTable = new Table;
+	}
+
+	bool empty() const
+	{
+		return _pTable->delegates.empty();
+	}
+
+protected:
+	void erase(Iterator pos)
+		/// Disables the delegate at pos and publishes a new
+		/// table without it. Snapshots held by notifications
+		/// in progress are not modified, but will skip the disabled
+		/// delegate.
+	{
+		(*pos)->disable();
+		const Delegates& delegates = _pTable->delegates;
+		std::size_t index = pos - _pTable->delegates.begin();
+		TablePtr pTable(new Table(*_pTable));
+		pTable->delegates.clear();
+		pTable->delegates.reserve(delegates.size() - 1);
+		pTable->delegates.assign(delegates.begin(), delegates.begin() + index);
+		pTable->delegates.insert(pTable->delegates.end(), delegates.begin() + index + 1, delegates.end());
+		for (int i = 0; i < LEVELS; ++i)
+		{
+			if (pTable->ends[i] > index) --pTable->ends[i];
+		}
+		_pTable = pTable;
+	}
+
+	TablePtr _pTable;
+};
+
+
+template <class TDelegate, int LEVELS>
+class FixedPriorityStrategy<void, TDelegate, LEVELS>: public NotificationStrategy<void, TDelegate>
+	/// NotificationStrategy for FixedPriorityEvent.
+	///
+	/// Like PriorityStrategy, but for priorities from 0 to
+	/// LEVELS - 1 only. The delegates are kept in a single,
+	/// immutable and reference-counted std::vector<>, grouped
+	/// by priority, together with the end offset of every
+	/// priority level, so add() finds its insertion position
+	/// without a search, and notify() walks the same flat
+	/// vector of delegates as SnapshotStrategy does, making
+	/// prioritized events exactly as cheap as unprioritized ones.
+	///
+	/// add() throws an InvalidArgumentException for priorities
+	/// outside of the range.
+{
+public:
+	typedef TDelegate*                   DelegateHandle;
+	typedef SharedPtr<TDelegate>         DelegatePtr;
+	typedef std::vector<DelegatePtr>     Delegates;
+	typedef typename Delegates::iterator Iterator;
+
+	struct Table
+	{
+		Table()
+		{
+			for (int i = 0; i < LEVELS; ++i) ends[i] = 0;
+		}
+
+		Delegates delegates;
+		std::size_t ends[LEVELS];
+	};
+
+	typedef SharedPtr<Table> TablePtr;
+
+public:
+	FixedPriorityStrategy():
+		_pTable(new Table)
+	{
+	}
+
+	FixedPriorityStrategy(const FixedPriorityStrategy& s):
+		_pTable(s._pTable)
+	{
+	}
+
+	~FixedPriorityStrategy()
+	{
+	}
+
+	void notify(const void* sender)
+	{
+		Delegates& delegates = _pTable->delegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			(*it)->notify(sender);
+		}
+	}
+
+	DelegateHandle add(const TDelegate& delegate)
+	{
+		int level = delegate.priority();
+		if (level < 0 || level >= LEVELS) throw InvalidArgumentException("Priority out of range");
+		DelegatePtr pDelegate(static_cast<TDelegate*>(delegate.clone()));
+		const Delegates& delegates = _pTable->delegates;
+		typename Delegates::const_iterator pos = delegates.begin() + _pTable->ends[level];
+		TablePtr pTable(new Table(*_pTable));
+		pTable->delegates.clear();
+		pTable->delegates.reserve(delegates.size() + 1);
+		pTable->delegates.assign(delegates.begin(), pos);
+		pTable->delegates.push_back(pDelegate);
+		pTable->delegates.insert(pTable->delegates.end(), pos, delegates.end());
+		for (int i = level; i < LEVELS; ++i) ++pTable->ends[i];
+		_pTable = pTable;
+		return pDelegate.get();
+	}
+
+	void remove(const TDelegate& delegate)
+	{
+		Delegates& delegates = _pTable->delegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			if (delegate.equals(**it))
+			{
+				erase(it);
+				return;
+			}
+		}
+	}
+
+	void remove(DelegateHandle delegateHandle)
+	{
+		Delegates& delegates = _pTable->delegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			if (*it == delegateHandle)
+			{
+				erase(it);
+				return;
+			}
+		}
+	}
+
+	FixedPriorityStrategy& operator = (const FixedPriorityStrategy& s)
+	{
+		_pTable = s._pTable;
+		return *this;
+	}
+
+	void clear()
+	{
+		Delegates& delegates = _pTable->delegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			(*it)->disable();
+		}
+		_pTable = new Table;
+	}
+
+	bool empty() const
+	{
+		return _pTable->delegates.empty();
+	}
+
+protected:
+	void erase(Iterator pos)
+		/// Disables the delegate at pos and publishes a new
+		/// table without it. Snapshots held by notifications
+		/// in progress are not modified, but will skip the disabled
+		/// delegate.
+	{
+		(*pos)->disable();
+		const Delegates& delegates = _pTable->delegates;
+		std::size_t index = pos - _pTable->delegates.begin();
+		TablePtr pTable(new Table(*_pTable));
+		pTable->delegates.clear();
+		pTable->delegates.reserve(delegates.size() - 1);
+		pTable->delegates.assign(delegates.begin(), delegates.begin() + index);
+		pTable->delegates.insert(pTable->delegates.end(), delegates.begin() + index + 1, delegates.end());
+		for (int i = 0; i < LEVELS; ++i)
+		{
+			if (pTable->ends[i] > index) --pTable->ends[i];
+		}
+		_pTable = pTable;
+	}
+
+	TablePtr _pTable;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FixedPriorityStrategy_INCLUDED
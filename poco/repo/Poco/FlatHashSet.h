@@ -0,0 +1,206 @@
+//
+// FlatHashSet.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Hashing
+// Module:  FlatHashSet
+//
+// Definition of the FlatHashSet class.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_FlatHashSet_INCLUDED
+#define Foundation_FlatHashSet_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/FlatHashTable.h"
+
+
+namespace Poco {
+
+
+template <class Value>
+struct FlatHashSetKeyOf
+	/// This class template is used internally by FlatHashSet.
+{
+	const Value& operator () (const Value& value) const
+	{
+		return value;
+	}
+};
+
+
+template <class Value, class HashFunc = FlatHashFunction<Value> >
+class FlatHashSet
+	/// This class implements a set using a FlatHashTable.
+	///
+	/// A FlatHashSet can be used just like a HashSet, except
+	/// that inserts and erases invalidate all iterators.
+	/// A FlatHashSet of std::string can be searched with
+	/// a C string, without constructing a std::string.
+	///
+	/// See FlatHashTable for more information.
+{
+public:
+	typedef Value        ValueType;
+	typedef Value&       Reference;
+	typedef const Value& ConstReference;
+	typedef Value*       Pointer;
+	typedef const Value* ConstPointer;
+	typedef HashFunc     Hash;
+
+	typedef FlatHashTable<ValueType, ValueType, FlatHashSetKeyOf<Value>, HashFunc> HashTable;
+
+	typedef typename HashTable::Iterator      Iterator;
+	typedef typename HashTable::ConstIterator ConstIterator;
+
+	FlatHashSet()
+		/// Creates an empty FlatHashSet.
+	{
+	}
+
+	FlatHashSet(std::size_t initialReserve):
+		_table(initialReserve)
+		/// Creates the FlatHashSet with room for the
+		/// given number of elements.
+	{
+	}
+
+	FlatHashSet(const FlatHashSet& set):
+		_table(set._table)
+		/// Creates the FlatHashSet by copying another one.
+	{
+	}
+
+	~FlatHashSet()
+		/// Destroys the FlatHashSet.
+	{
+	}
+
+	FlatHashSet& operator = (const FlatHashSet& set)
+		/// Assigns another FlatHashSet.
+	{
+		FlatHashSet tmp(set);
+		swap(tmp);
+		return *this;
+	}
+
+	void swap(FlatHashSet& set)
+		/// Swaps the FlatHashSet with another one.
+	{
+		_table.swap(set._table);
+	}
+
+	ConstIterator begin() const
+		/// Returns an iterator pointing to the first entry, if one exists.
+	{
+		return _table.begin();
+	}
+
+	ConstIterator end() const
+		/// Returns an iterator pointing to the end of the table.
+	{
+		return _table.end();
+	}
+
+	Iterator begin()
+		/// Returns an iterator pointing to the first entry, if one exists.
+	{
+		return _table.begin();
+	}
+
+	Iterator end()
+		/// Returns an iterator pointing to the end of the table.
+	{
+		return _table.end();
+	}
+
+	template <class K>
+	ConstIterator find(const K& value) const
+		/// Finds an entry in the set.
+	{
+		return _table.find(value);
+	}
+
+	template <class K>
+	std::size_t count(const K& value) const
+		/// Returns the number of elements with the given
+		/// value, which is either 1 or 0.
+	{
+		return _table.count(value);
+	}
+
+	std::pair<Iterator, bool> insert(const ValueType& value)
+		/// Inserts an element into the set.
+		///
+		/// If the element already exists in the set,
+		/// a pair(iterator, false) with iterator pointing to the
+		/// existing element is returned.
+		/// Otherwise, the element is inserted an a
+		/// pair(iterator, true) with iterator
+		/// pointing to the new element is returned.
+	{
+		return _table.insert(value);
+	}
+
+	void erase(Iterator it)
+		/// Erases the element pointed to by it.
+	{
+		_table.erase(it);
+	}
+
+	template <class K>
+	std::size_t erase(const K& value)
+		/// Erases the element with the given value, if it exists,
+		/// and returns the number of elements erased.
+	{
+		return _table.erase(value);
+	}
+
+	void clear()
+		/// Erases all elements.
+	{
+		_table.clear();
+	}
+
+	void reserve(std::size_t size)
+		/// Makes room for at least the given number of elements.
+	{
+		_table.reserve(size);
+	}
+
+	std::size_t size() const
+		/// Returns the number of elements in the set.
+	{
+		return _table.size();
+	}
+
+	bool empty() const
+		/// Returns true iff the set is empty.
+	{
+		return _table.empty();
+	}
+
+	HashStatistic currentState(bool details = false) const
+		/// Returns the current internal state.
+	{
+		return _table.currentState(details);
+	}
+
+private:
+	HashTable _table;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_FlatHashSet_INCLUDED
@@ -0,0 +1,204 @@
+//
+// GrowOnlyHashTable.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  GrowOnlyHashTable
+//
+// Definition of the GrowOnlyHashTable class template.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_GrowOnlyHashTable_INCLUDED
+#define Foundation_GrowOnlyHashTable_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/AtomicPointer.h"
+#include "Poco/Bugcheck.h"
+#include <vector>
+
+
+namespace Poco {
+
+
+template <class E>
+class GrowOnlyHashTable
+	/// A hash table of entries that is only ever added to, so that
+	/// entries can be looked up without a lock. Used by LoggerCache
+	/// and OSP::ServiceIndex.
+	///
+	/// The entries are kept in an open addressing table with linear
+	/// probing, whose load factor is kept below one half, so that
+	/// lookups of missing keys end quickly. When the table grows, a
+	/// copy is published, and the old one is kept until clear() or
+	/// the destruction of the GrowOnlyHashTable, so that readers still
+	/// using it are not affected.
+	///
+	/// find() may be called concurrently with add(). Calls to add()
+	/// must be serialized by the caller, e.g. with a mutex.
+	///
+	/// E must have a public Poco::UInt32 member named hash, and a
+	/// member function bool equals(const K& key) const for every
+	/// type of key K passed to find(). The GrowOnlyHashTable takes
+	/// ownership of the entries.
+{
+public:
+	typedef typename std::vector<E*>::const_iterator Iterator;
+
+	explicit GrowOnlyHashTable(std::size_t initialSize)
+		/// Creates the GrowOnlyHashTable with the given
+		/// initial size, which must be a power of two.
+	{
+		poco_assert (initialSize > 0 && (initialSize & (initialSize - 1)) == 0);
+
+		Table* pTable = new Table(initialSize);
+		_tables.push_back(pTable);
+		_pTable.store(pTable);
+	}
+
+	~GrowOnlyHashTable()
+		/// Destroys the GrowOnlyHashTable and all entries.
+	{
+		clear();
+		delete _pTable.load();
+	}
+
+	template <class K>
+	E* find(const K& key, UInt32 hash) const
+		/// Returns the entry for the given key and its hash,
+		/// or null if there is none. Takes no lock.
+	{
+		const Table& table = *_pTable.load();
+		for (std::size_t i = hash; ; ++i)
+		{
+			E* pEntry = table.slots[i & table.mask].load();
+			if (!pEntry) return 0;
+			if (pEntry->hash == hash && pEntry->equals(key)) return pEntry;
+		}
+	}
+
+	void add(E* pEntry)
+		/// Adds the entry, whose key must not be in the table yet,
+		/// and takes ownership of it. The entry must not be changed
+		/// afterwards, except through members that are safe to
+		/// change while being read, e.g. AtomicPointer members.
+	{
+		Table* pTable = _pTable.load();
+		if (2*(_entries.size() + 1) > pTable->size)
+		{
+			Table* pNewTable = new Table(2*pTable->size);
+			for (Iterator it = _entries.begin(); it != _entries.end(); ++it)
+			{
+				insert(*pNewTable, *it);
+			}
+			insert(*pNewTable, pEntry);
+			_tables.push_back(pNewTable);
+			_pTable.store(pNewTable);
+		}
+		else insert(*pTable, pEntry);
+		_entries.push_back(pEntry);
+	}
+
+	Iterator begin() const
+		/// Returns an iterator to the first entry,
+		/// in the order the entries have been added.
+		/// Must be serialized with add().
+	{
+		return _entries.begin();
+	}
+
+	Iterator end() const
+		/// Returns the end iterator of the entries.
+	{
+		return _entries.end();
+	}
+
+	std::size_t size() const
+		/// Returns the number of entries.
+	{
+		return _entries.size();
+	}
+
+	void clear()
+		/// Deletes all entries and the tables replaced by a copy.
+		///
+		/// Must not be called while other threads use the table.
+	{
+		for (Iterator it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			delete *it;
+		}
+		_entries.clear();
+		Table* pTable = _pTable.load();
+		for (typename std::vector<Table*>::iterator it = _tables.begin(); it != _tables.end(); ++it)
+		{
+			if (*it != pTable) delete *it;
+		}
+		_tables.clear();
+		pTable->clear();
+		_tables.push_back(pTable);
+	}
+
+private:
+	struct Table
+	{
+		Table(std::size_t n):
+			slots(new AtomicPointer<E>[n]),
+			size(n),
+			mask(n - 1)
+		{
+		}
+
+		~Table()
+		{
+			delete [] slots;
+		}
+
+		void clear()
+		{
+			for (std::size_t i = 0; i < size; ++i) slots[i].store(0);
+		}
+
+		AtomicPointer<E>* slots;
+		std::size_t size;
+		std::size_t mask;
+
+	private:
+		Table(const Table&);
+		Table& operator = (const Table&);
+	};
+
+	static void insert(Table& table, E* pEntry)
+	{
+		for (std::size_t i = pEntry->hash; ; ++i)
+		{
+			AtomicPointer<E>& slot = table.slots[i & table.mask];
+			if (!slot.load())
+			{
+				slot.store(pEntry);
+				return;
+			}
+		}
+	}
+
+	GrowOnlyHashTable(const GrowOnlyHashTable&);
+	GrowOnlyHashTable& operator = (const GrowOnlyHashTable&);
+
+	AtomicPointer<Table> _pTable;
+	std::vector<Table*> _tables;
+	std::vector<E*> _entries;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_GrowOnlyHashTable_INCLUDED
@@ -22,6 +22,7 @@
 
 #include "Poco/JSON/JSON.h"
 #include "Poco/SharedPtr.h"
+#include "Poco/BufferStream.h"
 #include "Poco/Dynamic/Var.h"
 #include <vector>
 #include <sstream>
@@ -326,9 +327,9 @@ public:
 
 	void convert(std::string& s) const
 	{
-		std::ostringstream oss;
+		Poco::BufferOutputStream oss;
 		_val->stringify(oss, 2);
-		s = oss.str();
+		s.assign(oss.data(), oss.size());
 	}
 
 	void convert(DateTime& /*val*/) const
@@ -465,9 +466,9 @@ public:
 
 	void convert(std::string& s) const
 	{
-		std::ostringstream oss;
+		Poco::BufferOutputStream oss;
 		_val.stringify(oss, 2);
-		s = oss.str();
+		s.assign(oss.data(), oss.size());
 	}
 
 	void convert(DateTime& /*val*/) const
@@ -0,0 +1,191 @@
+//
+// CompiledTemplateCache.h
+//
+// $Id$
+//
+// Library: JSON
+// Package: JSON
+// Module:  CompiledTemplateCache
+//
+// Definition of the CompiledTemplateCache class.
+//
+// Copyright (c) 2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef JSON_CompiledTemplateCache_INCLUDED
+#define JSON_CompiledTemplateCache_INCLUDED
+
+
+#include "Poco/JSON/JSON.h"
+#include "Poco/JSON/CompiledTemplate.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <map>
+
+
+namespace Poco {
+namespace JSON {
+
+
+class CompiledTemplateCache: public CompiledTemplate::Loader
+	/// CompiledTemplateCache keeps compiled templates, like TemplateCache
+	/// does for Template. Relative template paths are resolved against
+	/// the paths added with addPath().
+	///
+	/// TemplateCache checks the modification time of a template file on
+	/// every getTemplate() call. CompiledTemplateCache checks it at most
+	/// once per check interval (default 2 seconds), so that frequently
+	/// rendered pages don't access the file system for every request.
+	/// A changed file is compiled again; a zero interval checks on every
+	/// call.
+	///
+	/// CompiledTemplateCache is thread-safe. The templates it returns can
+	/// be rendered concurrently.
+{
+public:
+	CompiledTemplateCache(const Timespan& checkInterval = Timespan(2, 0)):
+		_checkInterval(checkInterval)
+		/// Creates an empty CompiledTemplateCache.
+	{
+	}
+
+	~CompiledTemplateCache()
+		/// Destroys the CompiledTemplateCache.
+	{
+	}
+
+	void addPath(const Path& path)
+		/// Adds a path for resolving relative template paths.
+		/// Paths are checked in the order they have been added.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_includePaths.push_back(path);
+	}
+
+	void setCheckInterval(const Timespan& interval)
+		/// Sets the minimum interval between two checks of the
+		/// modification time of a template file.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_checkInterval = interval;
+	}
+
+	Timespan getCheckInterval() const
+		/// Returns the check interval.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _checkInterval;
+	}
+
+	CompiledTemplate::Ptr getTemplate(const Path& path)
+		/// Returns the compiled template with the given path. The template
+		/// is read and compiled if it is not in the cache yet, or if its
+		/// file has changed since it has been compiled. Throws a
+		/// FileNotFoundException if the file does not exist.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		Timestamp now;
+		const std::string key = path.toString();
+		Entries::iterator it = _entries.find(key);
+		if (it != _entries.end() && now - it->second.checked < _checkInterval.totalMicroseconds())
+			return it->second.pTemplate;
+
+		Path resolved = it != _entries.end() ? it->second.path : resolvePath(path);
+		File file(resolved);
+		if (!file.exists())
+		{
+			if (it != _entries.end()) _entries.erase(it);
+			throw FileNotFoundException(resolved.toString());
+		}
+		Timestamp modified = file.getLastModified();
+		if (it != _entries.end() && it->second.modified == modified)
+		{
+			it->second.checked = now;
+			return it->second.pTemplate;
+		}
+
+		CompiledTemplate::Ptr pTemplate = new CompiledTemplate(resolved);
+		pTemplate->parse();
+		Entry& entry = _entries[key];
+		entry.pTemplate = pTemplate;
+		entry.path = resolved;
+		entry.modified = modified;
+		entry.checked = now;
+		return pTemplate;
+	}
+
+	void render(const Path& path, const Dynamic::Var& data, std::string& out)
+		/// Renders the template with the given path, appending the output
+		/// to out. Included templates are obtained from the cache.
+	{
+		getTemplate(path)->render(data, out, this);
+	}
+
+	void clear()
+		/// Removes all templates from the cache.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_entries.clear();
+	}
+
+	std::size_t size() const
+		/// Returns the number of cached templates.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _entries.size();
+	}
+
+	// CompiledTemplate::Loader
+	CompiledTemplate::Ptr load(const Path& path)
+	{
+		return getTemplate(path);
+	}
+
+protected:
+	Path resolvePath(const Path& path) const
+	{
+		if (path.isAbsolute()) return path;
+		for (std::vector<Path>::const_iterator it = _includePaths.begin(); it != _includePaths.end(); ++it)
+		{
+			Path templatePath(*it, path);
+			File templateFile(templatePath);
+			if (templateFile.exists()) return templatePath;
+		}
+		return path;
+	}
+
+private:
+	struct Entry
+	{
+		CompiledTemplate::Ptr pTemplate;
+		Path path;
+		Timestamp modified;
+		Timestamp checked;
+	};
+
+	typedef std::map<std::string, Entry> Entries;
+
+	CompiledTemplateCache(const CompiledTemplateCache&);
+	CompiledTemplateCache& operator = (const CompiledTemplateCache&);
+
+	std::vector<Path> _includePaths;
+	Entries _entries;
+	Timespan _checkInterval;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::JSON
+
+
+#endif // JSON_CompiledTemplateCache_INCLUDED
@@ -0,0 +1,276 @@
+//
+// QueryPath.h
+//
+// $Id$
+//
+// Library: JSON
+// Package: JSON
+// Module:  QueryPath
+//
+// Definition of the QueryPath and QueryPathCache classes.
+//
+// Copyright (c) 2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef JSON_QueryPath_INCLUDED
+#define JSON_QueryPath_INCLUDED
+
+
+#include "Poco/JSON/JSON.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/Dynamic/Var.h"
+#include "Poco/LRUCache.h"
+#include "Poco/SharedPtr.h"
+#include <string>
+#include <vector>
+
+
+namespace Poco {
+namespace JSON {
+
+
+class QueryPath
+	/// A QueryPath is a path like "person.children[0].name", as used
+	/// by Query, split into object member names and array indexes
+	/// once, so that it can be applied to many JSON values without
+	/// parsing the path again:
+	///
+	///     static const QueryPath rsrp("lte.cells[0].rsrp");
+	///     for (...)
+	///         int value = Query(message).findValue(rsrp, 0);
+	///
+	/// The path syntax is that of Query::find(): segments are separated
+	/// by dots, and a segment consists of an optional member name and
+	/// any number of [n] array indexes. Unlike Query::find(), an index
+	/// applied to a value that is not an array yields an empty value.
+	///
+	/// Copying a QueryPath is cheap, as the segments are shared.
+{
+public:
+	struct Segment
+		/// An object member name or an array index.
+	{
+		std::string name;     /// The member name; empty for an index.
+		unsigned index;       /// The array index.
+
+		bool isIndex() const
+		{
+			return name.empty();
+		}
+	};
+
+	typedef std::vector<Segment> Segments;
+
+	QueryPath():
+		_pSegments(new Segments)
+		/// Creates an empty QueryPath, which selects the value itself.
+	{
+	}
+
+	explicit QueryPath(const std::string& path):
+		_pSegments(new Segments),
+		_path(path)
+		/// Creates the QueryPath by splitting the given path.
+	{
+		split(path, *_pSegments);
+	}
+
+	~QueryPath()
+		/// Destroys the QueryPath.
+	{
+	}
+
+	const std::string& toString() const
+		/// Returns the path.
+	{
+		return _path;
+	}
+
+	const Segments& segments() const
+		/// Returns the segments of the path.
+	{
+		return *_pSegments;
+	}
+
+	Dynamic::Var find(const Dynamic::Var& source, std::size_t first = 0) const
+		/// Returns the value selected by the path in source, which
+		/// should hold an Object, Array, Object::Ptr or Array::Ptr.
+		/// When the value can't be found, an empty value is returned.
+		///
+		/// If first is given, the path is applied starting with the
+		/// segment at that position, e.g. to resolve
+		/// "item.name" relative to a value bound to "item".
+	{
+		Dynamic::Var holder;
+		const Dynamic::Var* pCurrent = &source;
+		Segments::const_iterator it = _pSegments->begin() + (first < _pSegments->size() ? first : _pSegments->size());
+		for (; it != _pSegments->end(); ++it)
+		{
+			if (pCurrent->isEmpty()) break;
+			if (it->isIndex())
+			{
+				const Array* pArray = array(*pCurrent);
+				if (!pArray || it->index >= pArray->size()) return Dynamic::Var();
+				pCurrent = &*(pArray->begin() + it->index);
+			}
+			else
+			{
+				const Object* pObject = object(*pCurrent);
+				if (!pObject) return Dynamic::Var();
+				Dynamic::Var next(pObject->get(it->name));
+				holder.swap(next);
+				pCurrent = &holder;
+			}
+		}
+		return *pCurrent;
+	}
+
+	static void split(const std::string& path, Segments& segments)
+		/// Splits the path into segments.
+	{
+		std::string::size_type pos = 0;
+		for (;;)
+		{
+			std::string::size_type dot = path.find('.', pos);
+			if (dot == std::string::npos) dot = path.size();
+			splitToken(path, pos, dot, segments);
+			if (dot == path.size()) break;
+			pos = dot + 1;
+		}
+	}
+
+	static const Object* object(const Dynamic::Var& value)
+		/// Returns the Object held by value, or null if value does
+		/// not hold an Object or Object::Ptr.
+	{
+		if (value.type() == typeid(Object::Ptr))
+			return value.extract<Object::Ptr>().get();
+		else if (value.type() == typeid(Object))
+			return &value.extract<Object>();
+		return 0;
+	}
+
+	static const Array* array(const Dynamic::Var& value)
+		/// Returns the Array held by value, or null if value does
+		/// not hold an Array or Array::Ptr.
+	{
+		if (value.type() == typeid(Array::Ptr))
+			return value.extract<Array::Ptr>().get();
+		else if (value.type() == typeid(Array))
+			return &value.extract<Array>();
+		return 0;
+	}
+
+protected:
+	static void splitToken(const std::string& path, std::string::size_type begin, std::string::size_type end, Segments& segments)
+		/// Splits one dot-separated token into an optional name
+		/// and [n] indexes. As with Query::find(), the name ends at
+		/// the first [n], and brackets not enclosing digits are part
+		/// of the name.
+	{
+		std::vector<unsigned> indexes;
+		std::string::size_type nameEnd = end;
+		std::string::size_type pos = begin;
+		while (pos < end)
+		{
+			if (path[pos] == '[')
+			{
+				std::string::size_type digit = pos + 1;
+				unsigned index = 0;
+				while (digit < end && path[digit] >= '0' && path[digit] <= '9')
+				{
+					index = index*10 + static_cast<unsigned>(path[digit] - '0');
+					++digit;
+				}
+				if (digit > pos + 1 && digit < end && path[digit] == ']')
+				{
+					if (nameEnd == end) nameEnd = pos;
+					indexes.push_back(index);
+					pos = digit + 1;
+					continue;
+				}
+			}
+			++pos;
+		}
+		if (nameEnd > begin)
+		{
+			Segment segment;
+			segment.name.assign(path, begin, nameEnd - begin);
+			segment.index = 0;
+			segments.push_back(segment);
+		}
+		for (std::vector<unsigned>::const_iterator it = indexes.begin(); it != indexes.end(); ++it)
+		{
+			Segment segment;
+			segment.index = *it;
+			segments.push_back(segment);
+		}
+	}
+
+private:
+	SharedPtr<Segments> _pSegments;
+	std::string _path;
+};
+
+
+class QueryPathCache
+	/// A thread-safe LRU cache of compiled QueryPath objects, so that
+	/// paths given as strings are only split the first time they are
+	/// used. Query::compile() uses a shared instance.
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY = 128
+	};
+
+	explicit QueryPathCache(long capacity = DEFAULT_CAPACITY):
+		_cache(capacity)
+		/// Creates a QueryPathCache holding up to capacity paths.
+	{
+	}
+
+	~QueryPathCache()
+		/// Destroys the QueryPathCache.
+	{
+	}
+
+	QueryPath compile(const std::string& path)
+		/// Returns the compiled path, from the cache if possible.
+	{
+		SharedPtr<QueryPath> pPath = _cache.get(path);
+		if (pPath) return *pPath;
+		QueryPath compiled(path);
+		_cache.add(path, compiled);
+		return compiled;
+	}
+
+	void clear()
+		/// Removes all paths from the cache.
+	{
+		_cache.clear();
+	}
+
+	std::size_t size()
+		/// Returns the number of cached paths.
+	{
+		return _cache.size();
+	}
+
+private:
+	QueryPathCache(const QueryPathCache&);
+	QueryPathCache& operator = (const QueryPathCache&);
+
+	LRUCache<std::string, QueryPath> _cache;
+};
+
+
+} } // namespace Poco::JSON
+
+
+#endif // JSON_QueryPath_INCLUDED
@@ -0,0 +1,587 @@
+//
+// Writer.h
+//
+// $Id$
+//
+// Library: JSON
+// Package: JSON
+// Module:  Writer
+//
+// Definition of the Writer class and the TypeWriter class template.
+//
+// Copyright (c) 2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef JSON_Writer_INCLUDED
+#define JSON_Writer_INCLUDED
+
+
+#include "Poco/JSON/JSON.h"
+#include "Poco/JSON/JSONException.h"
+#include "Poco/NumericString.h"
+#include "Poco/Nullable.h"
+#include "Poco/Types.h"
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cmath>
+
+
+namespace Poco {
+namespace JSON {
+
+
+class Writer;
+
+
+template <typename T>
+class TypeWriter
+	/// TypeWriter writes a value of type T with a Writer.
+	///
+	/// Like RemotingNG's TypeSerializer, the default template simply
+	/// forwards to Writer::value(), which supports bool, integers,
+	/// floating point numbers and strings. Other types, e.g. structs,
+	/// are written by providing specializations:
+	///
+	///     template <>
+	///     class TypeWriter<Point>
+	///     {
+	///     public:
+	///         static void write(Writer& writer, const Point& value)
+	///         {
+	///             writer.beginObject();
+	///             writer.member("x", value.x);
+	///             writer.member("y", value.y);
+	///             writer.endObject();
+	///         }
+	///     };
+{
+public:
+	static void write(Writer& writer, const T& value);
+
+private:
+	TypeWriter();
+	~TypeWriter();
+
+	TypeWriter(const TypeWriter&);
+	TypeWriter& operator = (const TypeWriter&);
+};
+
+
+class Writer
+	/// Writer writes JSON directly into an output stream or a string
+	/// buffer, without building Object and Array instances first:
+	///
+	///     Writer writer(ostr);
+	///     writer.beginObject();
+	///     writer.key("apn").value("Public");
+	///     writer.member("mtu", 1500);
+	///     writer.key("neighbours").beginArray();
+	///     for (...) writer.value(pci);
+	///     writer.endArray();
+	///     writer.endObject();
+	///     writer.flush();
+	///
+	/// Output is collected in an internal buffer, which is written to the
+	/// stream when it exceeds the flush threshold, by flush() and by the
+	/// destructor. Without a stream, the buffer grows as needed and
+	/// its content is returned by str().
+	///
+	/// Integers are formatted without locale and stream overhead, and
+	/// floating point numbers with the shortest representation that reads
+	/// back to the same value; NaN and infinity are written as null.
+	/// Strings must be UTF-8 and are escaped as required by RFC 8259.
+	///
+	/// The Writer checks the structure of the output: a JSONException
+	/// is thrown for a value in an object without a preceding key(),
+	/// a key() outside an object, or unbalanced end calls.
+	///
+	/// Values of other types, e.g. structs, are written with write() or
+	/// member(), using TypeWriter specializations.
+{
+public:
+	enum
+	{
+		DEFAULT_FLUSH_THRESHOLD = 8192
+	};
+
+	Writer(unsigned indent = 0):
+		_pStream(0),
+		_indent(indent),
+		_flushThreshold(DEFAULT_FLUSH_THRESHOLD),
+		_first(true),
+		_afterKey(false)
+		/// Creates a Writer that writes into its internal buffer. If indent
+		/// is not 0, the output is formatted with the given number of spaces
+		/// per level of nesting.
+	{
+	}
+
+	explicit Writer(std::ostream& ostr, unsigned indent = 0):
+		_pStream(&ostr),
+		_indent(indent),
+		_flushThreshold(DEFAULT_FLUSH_THRESHOLD),
+		_first(true),
+		_afterKey(false)
+		/// Creates a Writer that writes to the given stream.
+	{
+		_buffer.reserve(_flushThreshold + 256);
+	}
+
+	~Writer()
+		/// Writes buffered output to the stream, if any.
+	{
+		try
+		{
+			flush();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	Writer& beginObject()
+		/// Starts an object.
+	{
+		beforeValue();
+		_buffer += '{';
+		_stack.push_back('{');
+		_first = true;
+		_afterKey = false;
+		return *this;
+	}
+
+	Writer& endObject()
+		/// Ends the current object.
+	{
+		end('{', '}');
+		return *this;
+	}
+
+	Writer& beginArray()
+		/// Starts an array.
+	{
+		beforeValue();
+		_buffer += '[';
+		_stack.push_back('[');
+		_first = true;
+		_afterKey = false;
+		return *this;
+	}
+
+	Writer& endArray()
+		/// Ends the current array.
+	{
+		end('[', ']');
+		return *this;
+	}
+
+	Writer& key(const std::string& name)
+		/// Writes the name of the next member of the current object.
+	{
+		return key(name.data(), name.size());
+	}
+
+	Writer& key(const char* name)
+		/// Writes the name of the next member of the current object.
+	{
+		return key(name, std::strlen(name));
+	}
+
+	Writer& key(const char* name, std::size_t length)
+		/// Writes the name of the next member of the current object.
+	{
+		if (_stack.empty() || _stack.back() != '{' || _afterKey) throw JSONException("Writer: key() is only valid within an object, before a value");
+		separate();
+		appendString(name, length);
+		_buffer += ':';
+		if (_indent) _buffer += ' ';
+		_afterKey = true;
+		return *this;
+	}
+
+	Writer& value(bool b)
+	{
+		beforeValue();
+		if (b)
+			_buffer.append("true", 4);
+		else
+			_buffer.append("false", 5);
+		return afterValue();
+	}
+
+	Writer& value(Poco::Int32 n)
+	{
+		return value(static_cast<Poco::Int64>(n));
+	}
+
+	Writer& value(Poco::UInt32 n)
+	{
+		return value(static_cast<Poco::UInt64>(n));
+	}
+
+	Writer& value(Poco::Int64 n)
+	{
+		beforeValue();
+		Poco::UInt64 u = n < 0 ? ~static_cast<Poco::UInt64>(n) + 1 : static_cast<Poco::UInt64>(n);
+		if (n < 0) _buffer += '-';
+		appendUnsigned(u);
+		return afterValue();
+	}
+
+	Writer& value(Poco::UInt64 n)
+	{
+		beforeValue();
+		appendUnsigned(n);
+		return afterValue();
+	}
+
+#if !defined(POCO_LONG_IS_64_BIT)
+	Writer& value(long n)
+	{
+		return value(static_cast<Poco::Int64>(n));
+	}
+
+	Writer& value(unsigned long n)
+	{
+		return value(static_cast<Poco::UInt64>(n));
+	}
+#endif
+
+	Writer& value(double d)
+	{
+		beforeValue();
+		if (isFinite(d))
+		{
+			char buffer[POCO_MAX_FLT_STRING_LEN];
+			Poco::doubleToStr(buffer, POCO_MAX_FLT_STRING_LEN, d);
+			_buffer.append(buffer);
+		}
+		else
+		{
+			_buffer.append("null", 4);
+		}
+		return afterValue();
+	}
+
+	Writer& value(float f)
+	{
+		beforeValue();
+		if (isFinite(f))
+		{
+			char buffer[POCO_MAX_FLT_STRING_LEN];
+			Poco::floatToStr(buffer, POCO_MAX_FLT_STRING_LEN, f);
+			_buffer.append(buffer);
+		}
+		else
+		{
+			_buffer.append("null", 4);
+		}
+		return afterValue();
+	}
+
+	Writer& value(const std::string& str)
+	{
+		return value(str.data(), str.size());
+	}
+
+	Writer& value(const char* str)
+	{
+		if (!str) return null();
+		return value(str, std::strlen(str));
+	}
+
+	Writer& value(const char* str, std::size_t length)
+	{
+		beforeValue();
+		appendString(str, length);
+		return afterValue();
+	}
+
+	Writer& null()
+		/// Writes null.
+	{
+		beforeValue();
+		_buffer.append("null", 4);
+		return afterValue();
+	}
+
+	Writer& raw(const std::string& json)
+		/// Writes the given JSON text as a value, without checking it.
+	{
+		beforeValue();
+		_buffer += json;
+		return afterValue();
+	}
+
+	template <typename T>
+	Writer& write(const T& value)
+		/// Writes the value with TypeWriter<T>.
+	{
+		TypeWriter<T>::write(*this, value);
+		return *this;
+	}
+
+	template <typename T>
+	Writer& member(const char* name, const T& value)
+		/// Writes a member of the current object, with TypeWriter<T>.
+	{
+		key(name);
+		TypeWriter<T>::write(*this, value);
+		return *this;
+	}
+
+	template <typename T>
+	Writer& member(const std::string& name, const T& value)
+		/// Writes a member of the current object, with TypeWriter<T>.
+	{
+		key(name);
+		TypeWriter<T>::write(*this, value);
+		return *this;
+	}
+
+	void flush()
+		/// Writes buffered output to the stream, if any.
+	{
+		if (_pStream && !_buffer.empty())
+		{
+			_pStream->write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+			_buffer.clear();
+		}
+	}
+
+	const std::string& str() const
+		/// Returns the output of a Writer without a stream.
+	{
+		return _buffer;
+	}
+
+	void reset()
+		/// Discards buffered output and the current nesting, so that the
+		/// Writer can be reused for another document. The buffer keeps
+		/// its capacity.
+	{
+		_buffer.clear();
+		_stack.clear();
+		_first = true;
+		_afterKey = false;
+	}
+
+	std::size_t depth() const
+		/// Returns the number of open objects and arrays.
+	{
+		return _stack.size();
+	}
+
+	void setFlushThreshold(std::size_t threshold)
+		/// Sets the buffer size at which output is written to the stream.
+	{
+		_flushThreshold = threshold;
+	}
+
+	std::size_t getFlushThreshold() const
+		/// Returns the buffer size at which output is written to the stream.
+	{
+		return _flushThreshold;
+	}
+
+protected:
+	template <typename F>
+	static bool isFinite(F f)
+	{
+		return f == f && f - f == 0;
+	}
+
+	void beforeValue()
+	{
+		if (!_stack.empty())
+		{
+			if (_stack.back() == '{')
+			{
+				if (!_afterKey) throw JSONException("Writer: value in an object without key()");
+			}
+			else
+			{
+				separate();
+			}
+		}
+		else if (!_first)
+		{
+			throw JSONException("Writer: more than one top-level value");
+		}
+	}
+
+	Writer& afterValue()
+	{
+		_afterKey = false;
+		_first = false;
+		if (_pStream && _buffer.size() >= _flushThreshold) flush();
+		return *this;
+	}
+
+	void separate()
+		/// Writes the comma before a member or element, and
+		/// the line break and indentation if formatting.
+	{
+		if (!_first) _buffer += ',';
+		_first = false;
+		newLine(_stack.size());
+	}
+
+	void newLine(std::size_t level)
+	{
+		if (_indent)
+		{
+			_buffer += '\n';
+			_buffer.append(level*_indent, ' ');
+		}
+	}
+
+	void end(char open, char close)
+	{
+		if (_stack.empty() || _stack.back() != open || _afterKey) throw JSONException("Writer: unbalanced end of object or array");
+		_stack.pop_back();
+		if (!_first) newLine(_stack.size());
+		_buffer += close;
+		afterValue();
+	}
+
+	void appendUnsigned(Poco::UInt64 n)
+	{
+		char buffer[24];
+		char* p = buffer + sizeof(buffer);
+		do
+		{
+			*--p = static_cast<char>('0' + n%10);
+			n /= 10;
+		}
+		while (n);
+		_buffer.append(p, static_cast<std::size_t>(buffer + sizeof(buffer) - p));
+	}
+
+	void appendString(const char* str, std::size_t length)
+	{
+		static const char HEX[] = "0123456789abcdef";
+		_buffer += '"';
+		const char* end = str + length;
+		const char* run = str;
+		for (const char* p = str; p < end; ++p)
+		{
+			unsigned char c = static_cast<unsigned char>(*p);
+			if (c >= 0x20 && c != '"' && c != '\\') continue;
+			_buffer.append(run, static_cast<std::size_t>(p - run));
+			run = p + 1;
+			switch (c)
+			{
+			case '"':  _buffer.append("\\\"", 2); break;
+			case '\\': _buffer.append("\\\\", 2); break;
+			case '\b': _buffer.append("\\b", 2); break;
+			case '\f': _buffer.append("\\f", 2); break;
+			case '\n': _buffer.append("\\n", 2); break;
+			case '\r': _buffer.append("\\r", 2); break;
+			case '\t': _buffer.append("\\t", 2); break;
+			default:
+				_buffer.append("\\u00", 4);
+				_buffer += HEX[c >> 4];
+				_buffer += HEX[c & 0xF];
+				break;
+			}
+		}
+		_buffer.append(run, static_cast<std::size_t>(end - run));
+		_buffer += '"';
+	}
+
+private:
+	Writer(const Writer&);
+	Writer& operator = (const Writer&);
+
+	std::ostream* _pStream;
+	unsigned _indent;
+	std::size_t _flushThreshold;
+	std::string _buffer;
+	std::vector<char> _stack;
+	bool _first;
+	bool _afterKey;
+};
+
+
+//
+// TypeWriter
+//
+template <typename T>
+inline void TypeWriter<T>::write(Writer& writer, const T& value)
+{
+	writer.value(value);
+}
+
+
+template <typename T>
+class TypeWriter<std::vector<T> >
+{
+public:
+	static void write(Writer& writer, const std::vector<T>& value)
+	{
+		writer.beginArray();
+		for (typename std::vector<T>::const_iterator it = value.begin(); it != value.end(); ++it)
+		{
+			TypeWriter<T>::write(writer, *it);
+		}
+		writer.endArray();
+	}
+};
+
+
+template <typename T, std::size_t N>
+class TypeWriter<T[N]>
+{
+public:
+	static void write(Writer& writer, const T (&value)[N])
+	{
+		writer.beginArray();
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			TypeWriter<T>::write(writer, value[i]);
+		}
+		writer.endArray();
+	}
+};
+
+
+template <std::size_t N>
+class TypeWriter<char[N]>
+	/// Writes a fixed size character array as a string,
+	/// up to the first null character.
+{
+public:
+	static void write(Writer& writer, const char (&value)[N])
+	{
+		const void* pEnd = std::memchr(value, '\0', N);
+		writer.value(value, pEnd ? static_cast<std::size_t>(static_cast<const char*>(pEnd) - value) : N);
+	}
+};
+
+
+template <typename T>
+class TypeWriter<Poco::Nullable<T> >
+{
+public:
+	static void write(Writer& writer, const Poco::Nullable<T>& value)
+	{
+		if (value.isNull())
+			writer.null();
+		else
+			TypeWriter<T>::write(writer, value.value());
+	}
+};
+
+
+} } // namespace Poco::JSON
+
+
+#endif // JSON_Writer_INCLUDED
@@ -0,0 +1,94 @@
+//
+// LocalRefCountedObject.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  LocalRefCountedObject
+//
+// Definition of the LocalRefCountedObject class.
+//
+// Copyright (c) 2004-2009, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_LocalRefCountedObject_INCLUDED
+#define Foundation_LocalRefCountedObject_INCLUDED
+
+
+#include "Poco/Foundation.h"
+
+
+namespace Poco {
+
+
+class LocalRefCountedObject
+	/// A base class for reference counted objects confined to
+	/// a single thread, or otherwise never referenced by more
+	/// than one thread at a time.
+	///
+	/// LocalRefCountedObject has the interface of RefCountedObject,
+	/// and can therefore be used with AutoPtr, but keeps the
+	/// reference count in a plain int, so duplicate() and release()
+	/// do not need atomic read-modify-write operations.
+	///
+	/// Objects handed over to other threads, for instance through
+	/// a NotificationQueue, must derive from RefCountedObject.
+{
+public:
+	LocalRefCountedObject():
+		_counter(1)
+		/// Creates the LocalRefCountedObject.
+		/// The initial reference count is one.
+	{
+	}
+
+	void duplicate() const
+		/// Increments the object's reference count.
+	{
+		++_counter;
+	}
+
+	void release() const throw()
+		/// Decrements the object's reference count
+		/// and deletes the object if the count
+		/// reaches zero.
+	{
+		try
+		{
+			if (--_counter == 0) delete this;
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	int referenceCount() const
+		/// Returns the reference count.
+	{
+		return _counter;
+	}
+
+protected:
+	virtual ~LocalRefCountedObject()
+		/// Destroys the LocalRefCountedObject.
+	{
+	}
+
+private:
+	LocalRefCountedObject(const LocalRefCountedObject&);
+	LocalRefCountedObject& operator = (const LocalRefCountedObject&);
+
+	mutable int _counter;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_LocalRefCountedObject_INCLUDED
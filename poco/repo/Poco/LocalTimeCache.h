@@ -0,0 +1,290 @@
+//
+// LocalTimeCache.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: DateTime
+// Module:  LocalTimeCache
+//
+// Definition of the LocalTimeCache class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_LocalTimeCache_INCLUDED
+#define Foundation_LocalTimeCache_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Timestamp.h"
+#include "Poco/DateTime.h"
+#include "Poco/LocalDateTime.h"
+#include "Poco/AtomicCounter.h"
+#if __cplusplus < 201103L
+#include "Poco/FastThreadLocal.h"
+#endif
+#include <ctime>
+#include <time.h>
+
+
+namespace Poco {
+
+
+class LocalTimeCache
+	/// This class converts UTC times to local times without calling
+	/// into the C library for every conversion.
+	///
+	/// LocalDateTime, Timezone and DateTimeFormatter call localtime()
+	/// for every conversion. LocalTimeCache instead keeps, for every
+	/// thread, the time zone differential found for the last conversion,
+	/// together with the interval of time around it in which the
+	/// differential does not change, so that localtime() is only
+	/// called again when a conversion falls outside that interval,
+	/// i.e. about once a day, or when a daylight saving time
+	/// transition has been crossed.
+	///
+	/// Intervals are determined at a resolution of 15 minutes, the
+	/// granularity of all time zone transitions in use since 1970.
+	///
+	/// When the time zone of the process changes (for instance, after
+	/// the TZ environment variable has been changed, or the time zone
+	/// has been set from the cellular network), invalidate() must be
+	/// called; it re-reads the time zone and discards the cached
+	/// differentials of all threads.
+	///
+	/// The class also provides conversions between days since the
+	/// Unix epoch and Gregorian calendar dates, which, unlike DateTime,
+	/// only use integer arithmetic.
+{
+public:
+	struct Fields
+		/// The calendar fields of a time, as returned
+		/// by utcFields() and localFields().
+	{
+		int year;      /// 0 to 9999
+		int month;     /// 1 to 12
+		int day;       /// 1 to 31
+		int dayOfWeek; /// 0 to 6 (0 = Sunday)
+		int dayOfYear; /// 1 to 366
+		int hour;      /// 0 to 23
+		int minute;    /// 0 to 59
+		int second;    /// 0 to 59
+		int tzd;       /// the time zone differential in seconds
+	};
+
+	static int tzd(Timestamp::TimeVal epochSeconds)
+		/// Returns the time zone differential, in seconds, of the
+		/// current time zone at the given time, given in seconds
+		/// since the Unix epoch, including the daylight saving
+		/// time offset in effect at that time.
+		///     local time = UTC + tzd(time).
+	{
+		Cache& cache = threadCache();
+		int generation = generationCounter().value();
+		if (cache.generation != generation || epochSeconds < cache.validFrom || epochSeconds >= cache.validUntil)
+		{
+			refresh(cache, epochSeconds, generation);
+		}
+		return cache.tzd;
+	}
+
+	static int tzd(const Timestamp& timestamp)
+		/// Returns the time zone differential, in seconds, of the
+		/// current time zone at the given time.
+	{
+		return tzd(floorDiv(timestamp.epochMicroseconds(), Timestamp::resolution()));
+	}
+
+	static int tzd()
+		/// Returns the time zone differential, in seconds, of the
+		/// current time zone at the current time.
+	{
+		return tzd(Timestamp());
+	}
+
+	static LocalDateTime localDateTime(const Timestamp& timestamp)
+		/// Returns the LocalDateTime for the given time, like
+		/// LocalDateTime(timestamp), but using the cached time zone
+		/// differential.
+	{
+		return LocalDateTime(tzd(timestamp), DateTime(timestamp), true);
+	}
+
+	static void utcFields(Timestamp::TimeVal epochSeconds, Fields& fields)
+		/// Computes the calendar fields of the given time, given
+		/// in seconds since the Unix epoch, in UTC.
+	{
+		Timestamp::TimeVal days = floorDiv(epochSeconds, SECONDS_PER_DAY);
+		int seconds = static_cast<int>(epochSeconds - days*SECONDS_PER_DAY);
+		civilFromDays(days, fields.year, fields.month, fields.day);
+		fields.dayOfWeek = static_cast<int>(floorMod(days + 4, 7)); // 1970-01-01 was a Thursday
+		fields.dayOfYear = static_cast<int>(days - daysFromCivil(fields.year, 1, 1)) + 1;
+		fields.hour      = seconds/3600;
+		fields.minute    = (seconds/60) % 60;
+		fields.second    = seconds % 60;
+		fields.tzd       = 0;
+	}
+
+	static void localFields(Timestamp::TimeVal epochSeconds, Fields& fields)
+		/// Computes the calendar fields of the given time, given
+		/// in seconds since the Unix epoch, in local time.
+	{
+		int differential = tzd(epochSeconds);
+		utcFields(epochSeconds + differential, fields);
+		fields.tzd = differential;
+	}
+
+	static void civilFromDays(Timestamp::TimeVal days, int& year, int& month, int& day)
+		/// Converts the number of days since 1970-01-01 into
+		/// the Gregorian calendar date.
+	{
+		// see Howard Hinnant, "chrono-Compatible Low-Level Date Algorithms"
+		days += DAYS_TO_EPOCH;
+		Timestamp::TimeVal era = (days >= 0 ? days : days - 146096)/146097;
+		unsigned dayOfEra  = static_cast<unsigned>(days - era*146097);
+		unsigned yearOfEra = (dayOfEra - dayOfEra/1460 + dayOfEra/36524 - dayOfEra/146096)/365;
+		unsigned dayOfYear = dayOfEra - (365*yearOfEra + yearOfEra/4 - yearOfEra/100);
+		unsigned monthIndex = (5*dayOfYear + 2)/153; // March is 0
+		day   = static_cast<int>(dayOfYear - (153*monthIndex + 2)/5 + 1);
+		month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+		year  = static_cast<int>(yearOfEra + era*400) + (month <= 2 ? 1 : 0);
+	}
+
+	static Timestamp::TimeVal daysFromCivil(int year, int month, int day)
+		/// Converts the Gregorian calendar date into
+		/// the number of days since 1970-01-01.
+	{
+		if (month <= 2) --year;
+		Timestamp::TimeVal era = (year >= 0 ? year : year - 399)/400;
+		unsigned yearOfEra = static_cast<unsigned>(year - era*400);
+		unsigned dayOfYear = (153*(month > 2 ? month - 3 : month + 9) + 2)/5 + day - 1;
+		unsigned dayOfEra  = yearOfEra*365 + yearOfEra/4 - yearOfEra/100 + dayOfYear;
+		return era*146097 + static_cast<Timestamp::TimeVal>(dayOfEra) - DAYS_TO_EPOCH;
+	}
+
+	static void invalidate()
+		/// Re-reads the time zone of the process and discards the
+		/// cached time zone differentials of all threads.
+		///
+		/// Must be called whenever the time zone has been changed.
+	{
+#if defined(_WIN32)
+		_tzset();
+#else
+		tzset();
+#endif
+		++generationCounter();
+	}
+
+private:
+	enum
+	{
+		SECONDS_PER_DAY = 86400,
+		DAYS_TO_EPOCH   = 719468, /// days from 0000-03-01 to 1970-01-01
+		STEP            = 900,    /// the resolution of intervals, in seconds
+		SPAN            = 86400   /// the length of intervals checked at once, in seconds
+	};
+
+	struct Cache
+	{
+		Cache():
+			validFrom(0),
+			validUntil(0),
+			tzd(0),
+			generation(-1)
+		{
+		}
+
+		Timestamp::TimeVal validFrom;
+		Timestamp::TimeVal validUntil;
+		int tzd;
+		int generation;
+	};
+
+	static void refresh(Cache& cache, Timestamp::TimeVal epochSeconds, int generation)
+		/// Computes the differential for the given time, and the interval
+		/// around it in which it does not change, looking ahead one day
+		/// and searching for the exact transition, if there is one.
+	{
+		Timestamp::TimeVal from = floorDiv(epochSeconds, STEP)*STEP;
+		Timestamp::TimeVal until = from + SPAN;
+		int differential = computeTzd(from);
+		if (computeTzd(until) != differential)
+		{
+			// the transition is in (from, until]
+			Timestamp::TimeVal low = from;
+			while (until - low > STEP)
+			{
+				Timestamp::TimeVal mid = low + ((until - low)/STEP/2)*STEP;
+				if (computeTzd(mid) == differential)
+					low = mid;
+				else
+					until = mid;
+			}
+		}
+		cache.validFrom  = from;
+		cache.validUntil = until;
+		cache.tzd        = differential;
+		cache.generation = generation;
+	}
+
+	static int computeTzd(Timestamp::TimeVal epochSeconds)
+		/// Returns the differential at the given time, as
+		/// computed by the C library.
+	{
+		std::time_t time = static_cast<std::time_t>(epochSeconds);
+		struct std::tm local;
+#if defined(_WIN32)
+		if (localtime_s(&local, &time) != 0) return 0;
+#else
+		if (!localtime_r(&time, &local)) return 0;
+#endif
+		Timestamp::TimeVal localSeconds = daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday)*SECONDS_PER_DAY
+			+ local.tm_hour*3600 + local.tm_min*60 + local.tm_sec;
+		return static_cast<int>(localSeconds - epochSeconds);
+	}
+
+	static Timestamp::TimeVal floorDiv(Timestamp::TimeVal value, Timestamp::TimeVal divisor)
+	{
+		Timestamp::TimeVal quotient = value/divisor;
+		if (quotient*divisor > value) --quotient;
+		return quotient;
+	}
+
+	static Timestamp::TimeVal floorMod(Timestamp::TimeVal value, Timestamp::TimeVal divisor)
+	{
+		return value - floorDiv(value, divisor)*divisor;
+	}
+
+	static Cache& threadCache()
+	{
+#if __cplusplus >= 201103L
+		static thread_local Cache cache;
+		return cache;
+#else
+		static Poco::FastThreadLocal<Cache> cache;
+		return cache.get();
+#endif
+	}
+
+	static AtomicCounter& generationCounter()
+	{
+		static AtomicCounter counter;
+		return counter;
+	}
+
+	LocalTimeCache();
+	LocalTimeCache(const LocalTimeCache&);
+	LocalTimeCache& operator = (const LocalTimeCache&);
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_LocalTimeCache_INCLUDED
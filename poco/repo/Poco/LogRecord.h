@@ -0,0 +1,283 @@
+//
+// LogRecord.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  LogRecord
+//
+// Definition of the LogRecord and RecordChannel classes, and the
+// deferred formatting logging macros.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_LogRecord_INCLUDED
+#define Foundation_LogRecord_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Logger.h"
+#include "Poco/Channel.h"
+#include "Poco/Message.h"
+#include "Poco/Format.h"
+#include "Poco/Any.h"
+#include "Poco/Thread.h"
+#include "Poco/Timestamp.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+
+
+namespace Poco {
+
+
+class LogRecord
+	/// A log message that has not been formatted yet.
+	///
+	/// A LogRecord keeps the format string, the arguments and the
+	/// data describing where and when the message was logged, and
+	/// only renders the text, with Poco::format(), and creates the
+	/// Message when a channel needs it. Channels implementing
+	/// RecordChannel receive the LogRecord itself and can render it
+	/// later, e.g. on a background thread, or never, if they
+	/// discard the message.
+	///
+	/// The format string and the source file path must be static
+	/// strings, such as string literals and __FILE__, and the
+	/// Logger must outlive the LogRecord, since none of them are
+	/// copied.
+{
+public:
+	LogRecord():
+		_pSource(&emptySource()),
+		_prio(Message::PRIO_INFORMATION),
+		_fmt(""),
+		_file(0),
+		_line(0),
+		_tid(0)
+		/// Creates an empty LogRecord, to be assigned to.
+	{
+	}
+
+	LogRecord(const Logger& logger, Message::Priority prio, const char* fmt, const char* file = 0, int line = 0):
+		_pSource(&logger.name()),
+		_prio(prio),
+		_fmt(fmt),
+		_file(file),
+		_line(line),
+		_tid(Thread::currentTid())
+		/// Creates the LogRecord for a message logged now by
+		/// the current thread. Arguments are added with arg().
+	{
+		Thread* pThread = Thread::current();
+		if (pThread) _thread = pThread->getName();
+	}
+
+	LogRecord& arg(const Any& value)
+		/// Appends an argument for the format string.
+	{
+		_args.push_back(value);
+		return *this;
+	}
+
+	void swap(LogRecord& record)
+		/// Swaps the record with another one.
+	{
+		std::swap(_pSource, record._pSource);
+		std::swap(_prio, record._prio);
+		std::swap(_fmt, record._fmt);
+		std::swap(_file, record._file);
+		std::swap(_line, record._line);
+		_time.swap(record._time);
+		std::swap(_tid, record._tid);
+		_thread.swap(record._thread);
+		_args.swap(record._args);
+	}
+
+	const std::string& source() const
+		/// Returns the name of the logger.
+	{
+		return *_pSource;
+	}
+
+	Message::Priority priority() const
+		/// Returns the priority of the message.
+	{
+		return _prio;
+	}
+
+	const char* formatString() const
+		/// Returns the format string.
+	{
+		return _fmt;
+	}
+
+	const std::vector<Any>& args() const
+		/// Returns the arguments for the format string.
+	{
+		return _args;
+	}
+
+	const Timestamp& time() const
+		/// Returns the time the message was logged.
+	{
+		return _time;
+	}
+
+	std::string text() const
+		/// Renders and returns the text of the message.
+	{
+		std::string result;
+		if (_args.empty())
+			result = _fmt;
+		else
+			format(result, _fmt, _args);
+		return result;
+	}
+
+	Message message() const
+		/// Renders the text and returns the Message.
+	{
+		Message msg(*_pSource, text(), _prio, _file, _line);
+		msg.setTime(_time);
+		msg.setTid(static_cast<long>(_tid));
+		msg.setThread(_thread);
+		return msg;
+	}
+
+private:
+	static const std::string& emptySource()
+	{
+		static const std::string empty;
+		return empty;
+	}
+
+	const std::string* _pSource;
+	Message::Priority  _prio;
+	const char*        _fmt;
+	const char*        _file;
+	int                _line;
+	Timestamp          _time;
+	Thread::TID        _tid;
+	std::string        _thread;
+	std::vector<Any>   _args;
+};
+
+
+class RecordChannel
+	/// A mixin for channels that accept a LogRecord in place
+	/// of a Message and render it only when needed.
+	///
+	/// Used by logRecord() and the poco_*_fmt macros.
+{
+public:
+	virtual void log(const LogRecord& record) = 0;
+		/// Logs the given record.
+
+protected:
+	virtual ~RecordChannel()
+	{
+	}
+};
+
+
+inline void logRecord(const Logger& logger, const LogRecord& record)
+	/// Passes the record to the channel of the logger, as LogRecord
+	/// if the channel is a RecordChannel, otherwise as Message.
+{
+	Channel* pChannel = logger.getChannel();
+	if (!pChannel) return;
+	RecordChannel* pRecordChannel = dynamic_cast<RecordChannel*>(pChannel);
+	if (pRecordChannel)
+		pRecordChannel->log(record);
+	else
+		pChannel->log(record.message());
+}
+
+
+#if __cplusplus >= 201103L
+
+
+namespace Impl {
+
+
+inline void addRecordArgs(LogRecord&)
+{
+}
+
+
+template <typename T, typename... Args>
+void addRecordArgs(LogRecord& record, const T& value, const Args&... args)
+{
+	record.arg(Any(value));
+	addRecordArgs(record, args...);
+}
+
+
+template <typename... Args>
+void logFormatted(const Logger& logger, Message::Priority prio, const char* file, int line, const char* fmt, const Args&... args)
+{
+	LogRecord record(logger, prio, fmt, file, line);
+	addRecordArgs(record, args...);
+	logRecord(logger, record);
+}
+
+
+} // namespace Impl
+
+
+//
+// Deferred formatting macros.
+//
+// Nothing, not even the arguments, is evaluated if the logger's level
+// disables the message or the logger has no channel. The text is only
+// rendered if the channel is not a RecordChannel or asks for it.
+//
+//     poco_information_fmt(logger, "connected to %s, rssi %d", apn, rssi);
+//
+#define poco_log_fmt(logger, prio, fmt, ...) \
+	if ((logger).is(prio) && (logger).getChannel()) Poco::Impl::logFormatted((logger), (prio), __FILE__, __LINE__, (fmt), ##__VA_ARGS__); else (void) 0
+
+#define poco_fatal_fmt(logger, fmt, ...) \
+	poco_log_fmt(logger, Poco::Message::PRIO_FATAL, fmt, ##__VA_ARGS__)
+
+#define poco_critical_fmt(logger, fmt, ...) \
+	poco_log_fmt(logger, Poco::Message::PRIO_CRITICAL, fmt, ##__VA_ARGS__)
+
+#define poco_error_fmt(logger, fmt, ...) \
+	poco_log_fmt(logger, Poco::Message::PRIO_ERROR, fmt, ##__VA_ARGS__)
+
+#define poco_warning_fmt(logger, fmt, ...) \
+	poco_log_fmt(logger, Poco::Message::PRIO_WARNING, fmt, ##__VA_ARGS__)
+
+#define poco_notice_fmt(logger, fmt, ...) \
+	poco_log_fmt(logger, Poco::Message::PRIO_NOTICE, fmt, ##__VA_ARGS__)
+
+#define poco_information_fmt(logger, fmt, ...) \
+	poco_log_fmt(logger, Poco::Message::PRIO_INFORMATION, fmt, ##__VA_ARGS__)
+
+#if defined(_DEBUG) || defined(POCO_LOG_DEBUG)
+	#define poco_debug_fmt(logger, fmt, ...) \
+		poco_log_fmt(logger, Poco::Message::PRIO_DEBUG, fmt, ##__VA_ARGS__)
+
+	#define poco_trace_fmt(logger, fmt, ...) \
+		poco_log_fmt(logger, Poco::Message::PRIO_TRACE, fmt, ##__VA_ARGS__)
+#else
+	#define poco_debug_fmt(logger, fmt, ...)
+	#define poco_trace_fmt(logger, fmt, ...)
+#endif
+
+
+#endif // __cplusplus >= 201103L
+
+
+} // namespace Poco
+
+
+#endif // Foundation_LogRecord_INCLUDED
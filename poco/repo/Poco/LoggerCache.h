@@ -0,0 +1,239 @@
+//
+// LoggerCache.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  LoggerCache
+//
+// Definition of the LoggerName and LoggerCache classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_LoggerCache_INCLUDED
+#define Foundation_LoggerCache_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Logger.h"
+#include "Poco/GrowOnlyHashTable.h"
+#include "Poco/Mutex.h"
+#include <string>
+#include <cstring>
+
+
+namespace Poco {
+
+
+class LoggerName
+	/// The name of a logger, together with its hash.
+	///
+	/// With C++11, the hash of a LoggerName created from a string
+	/// literal is computed at compile time:
+	///
+	///     static const Poco::LoggerName EMON("EMON");
+	///     Poco::LoggerCache::get(EMON).error("...");
+	///
+	/// The name is not copied, so the string must outlive the
+	/// LoggerName.
+{
+public:
+#if __cplusplus >= 201103L
+	template <std::size_t N>
+	constexpr LoggerName(const char (&name)[N]):
+		_name(name),
+		_length(N - 1),
+		_hash(hashOf(name, N - 1))
+		/// Creates the LoggerName for a string literal.
+	{
+	}
+
+	static constexpr UInt32 hashOf(const char* name, std::size_t length, UInt32 hash = 2166136261u)
+		/// Returns the FNV-1a hash of the given name.
+	{
+		return length == 0 ? hash : hashOf(name + 1, length - 1, (hash ^ static_cast<unsigned char>(*name))*16777619u);
+	}
+#else
+	template <std::size_t N>
+	LoggerName(const char (&name)[N]):
+		_name(name),
+		_length(N - 1),
+		_hash(hashOf(name, N - 1))
+		/// Creates the LoggerName for a string literal.
+	{
+	}
+
+	static UInt32 hashOf(const char* name, std::size_t length, UInt32 hash = 2166136261u)
+		/// Returns the FNV-1a hash of the given name.
+	{
+		while (length-- > 0) hash = (hash ^ static_cast<unsigned char>(*name++))*16777619u;
+		return hash;
+	}
+#endif
+
+	LoggerName(const std::string& name):
+		_name(name.data()),
+		_length(name.size()),
+		_hash(hashOf(name.data(), name.size()))
+		/// Creates the LoggerName for the given string.
+	{
+	}
+
+	const char* data() const
+		/// Returns the characters of the name,
+		/// which are not necessarily zero-terminated.
+	{
+		return _name;
+	}
+
+	std::size_t length() const
+		/// Returns the length of the name.
+	{
+		return _length;
+	}
+
+	UInt32 hash() const
+		/// Returns the hash of the name.
+	{
+		return _hash;
+	}
+
+private:
+	const char* _name;
+	std::size_t _length;
+	UInt32      _hash;
+};
+
+
+class LoggerCache
+	/// A lock-free cache in front of Logger::get().
+	///
+	/// Logger::get() locks a global mutex and searches a map on every
+	/// call. LoggerCache::get() looks the logger up in a hash table
+	/// that is only ever added to: readers take no lock, and only the
+	/// first lookup of a name calls Logger::get() and inserts the
+	/// logger, under a mutex. When the table grows, a copy is published,
+	/// and the old one is kept until clear(), so readers still using it
+	/// are not affected.
+	///
+	/// The cache holds a reference to every logger it returns. Loggers
+	/// destroyed with Logger::destroy() or Logger::shutdown() therefore
+	/// stay valid, but are no longer connected to the logger hierarchy;
+	/// call clear() after destroying loggers, while no other thread
+	/// uses the cache.
+{
+public:
+	static Logger& get(const LoggerName& name)
+		/// Returns the logger with the given name.
+	{
+		return instance().find(name);
+	}
+
+	template <std::size_t N>
+	static Logger& get(const char (&name)[N])
+		/// Returns the logger with the given name.
+	{
+		return instance().find(LoggerName(name));
+	}
+
+	static Logger& get(const std::string& name)
+		/// Returns the logger with the given name.
+	{
+		return instance().find(LoggerName(name));
+	}
+
+	static void clear()
+		/// Releases all cached loggers.
+		///
+		/// Must not be called while other threads
+		/// use the cache.
+	{
+		instance().reset();
+	}
+
+private:
+	struct Entry
+	{
+		Entry(const std::string& n, UInt32 h, Logger* pL):
+			name(n),
+			hash(h),
+			pLogger(pL)
+		{
+		}
+
+		bool equals(const LoggerName& n) const
+		{
+			return name.size() == n.length() && std::memcmp(name.data(), n.data(), n.length()) == 0;
+		}
+
+		std::string name;
+		UInt32      hash;
+		Logger*     pLogger;
+	};
+
+	enum
+	{
+		INITIAL_SIZE = 64
+	};
+
+	LoggerCache():
+		_table(INITIAL_SIZE)
+	{
+	}
+
+	~LoggerCache()
+	{
+		reset();
+	}
+
+	LoggerCache(const LoggerCache&);
+	LoggerCache& operator = (const LoggerCache&);
+
+	static LoggerCache& instance()
+	{
+		// Never destroyed, so that loggers can still
+		// be looked up by destructors of static objects.
+		static LoggerCache* pCache = new LoggerCache;
+		return *pCache;
+	}
+
+	Logger& find(const LoggerName& name)
+	{
+		Entry* pEntry = _table.find(name, name.hash());
+		if (pEntry) return *pEntry->pLogger;
+
+		FastMutex::ScopedLock lock(_mutex);
+		pEntry = _table.find(name, name.hash());
+		if (pEntry) return *pEntry->pLogger;
+		std::string loggerName(name.data(), name.length());
+		Logger& logger = Logger::get(loggerName);
+		logger.duplicate();
+		_table.add(new Entry(loggerName, name.hash(), &logger));
+		return logger;
+	}
+
+	void reset()
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		for (GrowOnlyHashTable<Entry>::Iterator it = _table.begin(); it != _table.end(); ++it)
+		{
+			(*it)->pLogger->release();
+		}
+		_table.clear();
+	}
+
+	GrowOnlyHashTable<Entry> _table;
+	FastMutex _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_LoggerCache_INCLUDED
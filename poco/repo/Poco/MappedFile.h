@@ -0,0 +1,231 @@
+//
+// MappedFile.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Filesystem
+// Module:  MappedFile
+//
+// Definition of the MappedFile class.
+//
+// Copyright (c) 2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_MappedFile_INCLUDED
+#define Foundation_MappedFile_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/SharedMemory.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include <cstddef>
+#include <string>
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+namespace Poco {
+
+
+class MappedFile: public RefCountedObject
+	/// MappedFile maps the entire contents of a file into memory
+	/// for reading, using SharedMemory.
+	///
+	/// Unlike FileInputStream, which reads the file through a small
+	/// buffer and copies the contents into the buffers of the caller,
+	/// MappedFile gives direct access to the contents of the file,
+	/// from data() to data() + size(), without copying them.
+	/// For code that expects a stream, stream() returns an
+	/// std::istream reading the mapped contents.
+	///
+	/// Hints about the expected access pattern can be given to the
+	/// system with advise(); with ADVICE_SEQUENTIAL, for instance,
+	/// the system reads ahead more aggressively, and with
+	/// ADVICE_WILLNEED, it starts reading the entire file right away.
+	/// Hints are ignored on platforms not supporting them.
+	///
+	/// Empty files are not mapped; data() returns a valid pointer
+	/// and size() returns 0 for them.
+	///
+	/// The file must not be truncated while it is mapped.
+	///
+	/// MappedFile is reference counted, so that it can be shared by
+	/// the streams reading it. Streams returned by stream() keep the
+	/// MappedFile alive.
+{
+public:
+	typedef AutoPtr<MappedFile> Ptr;
+	typedef const char* ConstIterator;
+
+	enum Advice
+	{
+		ADVICE_NORMAL,     /// no special treatment
+		ADVICE_SEQUENTIAL, /// the file will be read sequentially
+		ADVICE_RANDOM,     /// the file will be read in random order
+		ADVICE_WILLNEED    /// the entire file will be read soon
+	};
+
+	explicit MappedFile(const std::string& path, Advice advice = ADVICE_NORMAL):
+		_pData(emptyData()),
+		_size(0)
+		/// Maps the file with the given path into memory and
+		/// gives the given hint about the expected access pattern.
+		///
+		/// Throws a FileNotFoundException if the file does not
+		/// exist, or another FileException if it cannot be mapped.
+	{
+		map(File(path), advice);
+	}
+
+	~MappedFile()
+		/// Unmaps the file.
+	{
+	}
+
+	const char* data() const
+		/// Returns the start of the mapped contents.
+	{
+		return _pData;
+	}
+
+	std::size_t size() const
+		/// Returns the size of the mapped contents, in bytes.
+	{
+		return _size;
+	}
+
+	bool empty() const
+		/// Returns true if the file is empty.
+	{
+		return _size == 0;
+	}
+
+	ConstIterator begin() const
+	{
+		return _pData;
+	}
+
+	ConstIterator end() const
+	{
+		return _pData + _size;
+	}
+
+	void advise(Advice advice) const
+		/// Gives a hint about the expected access pattern
+		/// of the whole file to the system.
+	{
+		advise(advice, 0, _size);
+	}
+
+	void advise(Advice advice, std::size_t offset, std::size_t length) const
+		/// Gives a hint about the expected access pattern of
+		/// the given range of the file to the system.
+	{
+		if (offset >= _size) return;
+		if (length > _size - offset) length = _size - offset;
+#if defined(POSIX_MADV_NORMAL)
+		int posixAdvice = POSIX_MADV_NORMAL;
+		switch (advice)
+		{
+		case ADVICE_SEQUENTIAL: posixAdvice = POSIX_MADV_SEQUENTIAL; break;
+		case ADVICE_RANDOM:     posixAdvice = POSIX_MADV_RANDOM; break;
+		case ADVICE_WILLNEED:   posixAdvice = POSIX_MADV_WILLNEED; break;
+		default: break;
+		}
+		// the range must start at a page boundary
+		static const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+		std::size_t start = offset - offset % pageSize;
+		posix_madvise(const_cast<char*>(_pData + start), length + (offset - start), posixAdvice);
+#else
+		(void) advice;
+#endif
+	}
+
+	std::string toString() const
+		/// Returns a copy of the contents.
+	{
+		return std::string(_pData, _size);
+	}
+
+	std::istream* stream() const
+		/// Returns a new std::istream reading the mapped contents.
+		/// The stream must be deleted by the caller, and keeps
+		/// the MappedFile alive.
+	{
+		return new Stream(Ptr(const_cast<MappedFile*>(this), true), _pData, _size);
+	}
+
+	std::istream* stream(std::size_t offset, std::size_t length) const
+		/// Returns a new std::istream reading the given range of the
+		/// mapped contents. The stream must be deleted by the caller,
+		/// and keeps the MappedFile alive.
+		///
+		/// Throws a RangeException if the range is outside the file.
+	{
+		if (offset > _size || length > _size - offset) throw RangeException("range outside of mapped file");
+		return new Stream(Ptr(const_cast<MappedFile*>(this), true), _pData + offset, length);
+	}
+
+	class Stream: public MemoryInputStream
+		/// An std::istream reading a MappedFile. The stream keeps
+		/// the MappedFile alive.
+	{
+	public:
+		Stream(MappedFile::Ptr pFile, const char* pData, std::size_t size):
+			MemoryInputStream(pData, static_cast<std::streamsize>(size)),
+			_pFile(pFile)
+		{
+		}
+
+		~Stream()
+		{
+		}
+
+	private:
+		MappedFile::Ptr _pFile;
+	};
+
+private:
+	void map(const File& file, Advice advice)
+	{
+		// mmap() fails for empty files
+		if (file.getSize() == 0) return;
+
+		SharedMemory memory(file, SharedMemory::AM_READ);
+		_memory.swap(memory);
+		_pData = _memory.begin();
+		_size = static_cast<std::size_t>(_memory.end() - _memory.begin());
+		if (advice != ADVICE_NORMAL) advise(advice);
+	}
+
+	static const char* emptyData()
+	{
+		static const char empty = 0;
+		return &empty;
+	}
+
+	MappedFile();
+	MappedFile(const MappedFile&);
+	MappedFile& operator = (const MappedFile&);
+
+	SharedMemory _memory;
+	const char* _pData;
+	std::size_t _size;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_MappedFile_INCLUDED
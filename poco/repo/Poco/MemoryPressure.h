@@ -0,0 +1,363 @@
+//
+// MemoryPressure.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  MemoryPressure
+//
+// Definition of the MemoryPressure, MemoryPressureHandler and
+// MemoryPressureRegistry classes.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_MemoryPressure_INCLUDED
+#define Foundation_MemoryPressure_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/Exception.h"
+#include "Poco/Mutex.h"
+#include "Poco/SingletonHolder.h"
+#include <vector>
+#include <cstddef>
+
+
+namespace Poco {
+
+
+class MemoryPressure
+	/// This class defines the levels of memory pressure
+	/// reported to MemoryPressureHandler objects.
+{
+public:
+	enum Level
+	{
+		PRESSURE_NONE = 0,
+			/// There is no memory pressure (any more). Handlers
+			/// may restore their normal limits.
+		PRESSURE_MODERATE,
+			/// The system is short of memory. Handlers should release
+			/// memory that is cheap to get back, e.g. expired cache
+			/// entries and most idle pooled objects.
+		PRESSURE_CRITICAL
+			/// The system is about to run out of memory. Handlers
+			/// should release all memory they can do without.
+	};
+
+	static const char* toString(Level level)
+		/// Returns "none", "moderate" or "critical".
+	{
+		switch (level)
+		{
+		case PRESSURE_MODERATE: return "moderate";
+		case PRESSURE_CRITICAL: return "critical";
+		default:                return "none";
+		}
+	}
+
+private:
+	MemoryPressure();
+};
+
+
+class MemoryPressureHandler: public RefCountedObject
+	/// The interface for objects that release memory, e.g. by
+	/// shrinking a cache or a pool, when the MemoryPressureRegistry
+	/// they have been added to reports memory pressure.
+	///
+	/// CacheMemoryPressureHandler, ClearMemoryPressureHandler and
+	/// TrimMemoryPressureHandler adapt the caches and pools of
+	/// the framework.
+{
+public:
+	typedef AutoPtr<MemoryPressureHandler> Ptr;
+
+	virtual void onMemoryPressure(MemoryPressure::Level level) = 0;
+		/// Called by the MemoryPressureRegistry when the level of
+		/// memory pressure changes, and repeatedly while the pressure
+		/// persists. Must be thread-safe, as it is called from the
+		/// thread reporting the memory pressure.
+
+protected:
+	virtual ~MemoryPressureHandler()
+	{
+	}
+};
+
+
+class MemoryPressureRegistry
+	/// The MemoryPressureRegistry keeps the MemoryPressureHandler
+	/// objects of an application and calls them, in the order of
+	/// their priorities, when memory pressure is reported to it, e.g.
+	/// by a MemoryPressureMonitor.
+	///
+	/// Handlers with a lower priority value are called first, so that
+	/// memory that is cheap to rebuild (caches) is released before memory
+	/// that is expensive to get back (pooled objects and buffers). Handlers
+	/// with the same priority are called in the order they have been added.
+	///
+	/// Usually, the registry returned by defaultRegistry() is used:
+	///
+	///     Poco::MemoryPressureRegistry::defaultRegistry().add(
+	///         new Poco::CacheMemoryPressureHandler<SessionCache>(cache),
+	///         Poco::MemoryPressureRegistry::PRIO_CACHES);
+	///
+	/// A handler refers to its cache or pool, so it must be removed
+	/// before the cache or pool is destroyed. All member functions are
+	/// thread-safe.
+{
+public:
+	enum Priority
+	{
+		PRIO_CACHES    = 100,
+			/// Caches of data that can be loaded or computed again,
+			/// e.g. AbstractCache and CompiledTemplateCache objects.
+		PRIO_RESOURCES = 200,
+			/// Caches of resource content, e.g. the WebResourceCache.
+		PRIO_POOLS     = 300,
+			/// Pools of idle objects, e.g. ObjectPool and ZStreamPool objects.
+		PRIO_BUFFERS   = 400
+			/// Pools of raw memory, e.g. the BufferPagePool.
+	};
+
+	BasicEvent<const MemoryPressure::Level> memoryPressure;
+		/// Fired by notify() after all handlers have been called.
+
+	MemoryPressureRegistry():
+		_level(MemoryPressure::PRESSURE_NONE)
+		/// Creates an empty MemoryPressureRegistry.
+	{
+	}
+
+	~MemoryPressureRegistry()
+		/// Destroys the MemoryPressureRegistry.
+	{
+	}
+
+	void add(MemoryPressureHandler::Ptr pHandler, int priority = PRIO_CACHES)
+		/// Adds a handler with the given priority.
+	{
+		poco_check_ptr (pHandler);
+
+		FastMutex::ScopedLock lock(_mutex);
+		HandlerVec::iterator it = _handlers.begin();
+		while (it != _handlers.end() && it->priority <= priority) ++it;
+		_handlers.insert(it, Entry(pHandler, priority));
+	}
+
+	void remove(MemoryPressureHandler::Ptr pHandler)
+		/// Removes the given handler. Does nothing if
+		/// the handler has not been added.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		for (HandlerVec::iterator it = _handlers.begin(); it != _handlers.end(); ++it)
+		{
+			if (it->pHandler == pHandler)
+			{
+				_handlers.erase(it);
+				return;
+			}
+		}
+	}
+
+	void notify(MemoryPressure::Level level)
+		/// Stores the level and passes it to all handlers, in the order of
+		/// their priorities, then fires the memoryPressure event.
+		///
+		/// Exceptions thrown by a handler are passed to the ErrorHandler,
+		/// and do not keep the remaining handlers from being called.
+	{
+		HandlerVec handlers;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_level = level;
+			handlers = _handlers;
+		}
+		for (HandlerVec::iterator it = handlers.begin(); it != handlers.end(); ++it)
+		{
+			try
+			{
+				it->pHandler->onMemoryPressure(level);
+			}
+			catch (Exception& exc)
+			{
+				ErrorHandler::handle(exc);
+			}
+			catch (std::exception& exc)
+			{
+				ErrorHandler::handle(exc);
+			}
+			catch (...)
+			{
+				ErrorHandler::handle();
+			}
+		}
+		memoryPressure(this, level);
+	}
+
+	MemoryPressure::Level level() const
+		/// Returns the level last passed to notify().
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _level;
+	}
+
+	std::size_t count() const
+		/// Returns the number of handlers.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _handlers.size();
+	}
+
+	static MemoryPressureRegistry& defaultRegistry()
+		/// Returns the default MemoryPressureRegistry.
+	{
+		static SingletonHolder<MemoryPressureRegistry> sh;
+		return *sh.get();
+	}
+
+private:
+	struct Entry
+	{
+		Entry(MemoryPressureHandler::Ptr pH, int prio):
+			pHandler(pH),
+			priority(prio)
+		{
+		}
+
+		MemoryPressureHandler::Ptr pHandler;
+		int priority;
+	};
+
+	typedef std::vector<Entry> HandlerVec;
+
+	MemoryPressureRegistry(const MemoryPressureRegistry&);
+	MemoryPressureRegistry& operator = (const MemoryPressureRegistry&);
+
+	HandlerVec _handlers;
+	MemoryPressure::Level _level;
+	mutable FastMutex _mutex;
+};
+
+
+template <class C>
+class CacheMemoryPressureHandler: public MemoryPressureHandler
+	/// A MemoryPressureHandler for a cache of the AbstractCache
+	/// family (LRUCache, ExpireCache, AccessExpireCache, etc.).
+	///
+	/// At moderate pressure, forceReplace() removes the entries the
+	/// strategy of the cache considers invalid, e.g. expired ones.
+	/// At critical pressure, the cache is cleared.
+{
+public:
+	explicit CacheMemoryPressureHandler(C& cache):
+		_cache(cache)
+	{
+	}
+
+	void onMemoryPressure(MemoryPressure::Level level)
+	{
+		if (level == MemoryPressure::PRESSURE_CRITICAL)
+			_cache.clear();
+		else if (level == MemoryPressure::PRESSURE_MODERATE)
+			_cache.forceReplace();
+	}
+
+protected:
+	~CacheMemoryPressureHandler()
+	{
+	}
+
+private:
+	C& _cache;
+};
+
+
+template <class C>
+class ClearMemoryPressureHandler: public MemoryPressureHandler
+	/// A MemoryPressureHandler for an object with a clear() member
+	/// function, e.g. a JSON::CompiledTemplateCache, that is called
+	/// when the pressure reaches the given level.
+{
+public:
+	explicit ClearMemoryPressureHandler(C& object, MemoryPressure::Level clearLevel = MemoryPressure::PRESSURE_CRITICAL):
+		_object(object),
+		_clearLevel(clearLevel)
+	{
+	}
+
+	void onMemoryPressure(MemoryPressure::Level level)
+	{
+		if (level != MemoryPressure::PRESSURE_NONE && level >= _clearLevel)
+			_object.clear();
+	}
+
+protected:
+	~ClearMemoryPressureHandler()
+	{
+	}
+
+private:
+	C& _object;
+	MemoryPressure::Level _clearLevel;
+};
+
+
+template <class C>
+class TrimMemoryPressureHandler: public MemoryPressureHandler
+	/// A MemoryPressureHandler for an object with a trim(std::size_t)
+	/// member function that releases memory down to the given limit,
+	/// e.g. ObjectPool (idle objects), ZStreamPool (idle streams),
+	/// BufferPagePool (idle pages per size) or WebResourceCache (bytes).
+	///
+	/// At moderate pressure, the object is trimmed to moderateLimit,
+	/// at critical pressure to criticalLimit. The object keeps its
+	/// normal limits, so that it grows again once the pressure is over.
+	///
+	///     Poco::MemoryPressureRegistry::defaultRegistry().add(
+	///         new Poco::TrimMemoryPressureHandler<Poco::BufferPagePool>(Poco::BufferPagePool::defaultPool(), 2, 0),
+	///         Poco::MemoryPressureRegistry::PRIO_BUFFERS);
+{
+public:
+	TrimMemoryPressureHandler(C& object, std::size_t moderateLimit, std::size_t criticalLimit = 0):
+		_object(object),
+		_moderateLimit(moderateLimit),
+		_criticalLimit(criticalLimit)
+	{
+	}
+
+	void onMemoryPressure(MemoryPressure::Level level)
+	{
+		if (level == MemoryPressure::PRESSURE_CRITICAL)
+			_object.trim(_criticalLimit);
+		else if (level == MemoryPressure::PRESSURE_MODERATE)
+			_object.trim(_moderateLimit);
+	}
+
+protected:
+	~TrimMemoryPressureHandler()
+	{
+	}
+
+private:
+	C& _object;
+	std::size_t _moderateLimit;
+	std::size_t _criticalLimit;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_MemoryPressure_INCLUDED
@@ -0,0 +1,493 @@
+//
+// MemoryPressureMonitor.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  MemoryPressure
+//
+// Definition of the MemoryPressureMonitor class.
+//
+// Copyright (c) 2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_MemoryPressureMonitor_INCLUDED
+#define Foundation_MemoryPressureMonitor_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/MemoryPressure.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/Clock.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/String.h"
+#include "Poco/Exception.h"
+#include <string>
+#if POCO_OS == POCO_OS_LINUX && !defined(POCO_NO_PSI)
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#define POCO_MPM_PSI 1
+#endif
+
+
+namespace Poco {
+
+
+class MemoryPressureMonitor: protected Runnable
+	/// This class watches the memory pressure of the system, or of
+	/// the cgroup of the process, in a background thread, and passes
+	/// the level of memory pressure to a MemoryPressureRegistry, which
+	/// calls the registered handlers to shrink caches and pools.
+	///
+	/// On Linux 5.2 or newer, the monitor uses pressure stall information
+	/// (PSI) triggers, which the kernel signals as soon as the tasks have
+	/// been stalled waiting for memory for longer than a threshold within
+	/// a time window:
+	///   * moderate pressure: some tasks stalled for more than
+	///     150 ms within 2 seconds (by default),
+	///   * critical pressure: all non-idle tasks stalled for more
+	///     than 100 ms within 2 seconds (by default).
+	/// The triggers are set on /proc/pressure/memory, or on the
+	/// memory.pressure file of a cgroup (v2), which reports the pressure
+	/// caused by the memory limit of the cgroup, e.g. of a container.
+	/// See cgroupPressureFile().
+	///
+	/// Where PSI is not available, the monitor reads the available memory
+	/// periodically, from memory.max and memory.current of the cgroup of
+	/// the pressure file, or from /proc/meminfo, and reports moderate
+	/// pressure below 10 percent and critical pressure below 5 percent of
+	/// available memory (by default). On other platforms than Linux,
+	/// no pressure is reported.
+	///
+	/// While there is pressure, the registry is notified whenever a
+	/// trigger fires (at most once per window), or, without PSI, at every
+	/// check. When no trigger has fired for the recovery time (10 seconds
+	/// by default), PRESSURE_NONE is reported.
+	///
+	///     Poco::MemoryPressureMonitor monitor;
+	///     monitor.setPressureFile(Poco::MemoryPressureMonitor::cgroupPressureFile());
+	///     monitor.start();
+{
+public:
+	enum
+	{
+		DEFAULT_WINDOW             = 2000000,
+			/// The time window of the PSI triggers in microseconds.
+			/// Unprivileged processes need a multiple of 2 seconds.
+		DEFAULT_MODERATE_STALL     = 150000,
+			/// The stall time of some tasks within the window,
+			/// in microseconds, that indicates moderate pressure.
+		DEFAULT_CRITICAL_STALL     = 100000,
+			/// The stall time of all tasks within the window,
+			/// in microseconds, that indicates critical pressure.
+		DEFAULT_MODERATE_AVAILABLE = 10,
+			/// The available memory in percent below which
+			/// moderate pressure is reported without PSI.
+		DEFAULT_CRITICAL_AVAILABLE = 5,
+			/// The available memory in percent below which
+			/// critical pressure is reported without PSI.
+		DEFAULT_RECOVERY_TIME      = 10000,
+			/// The time in milliseconds without triggers
+			/// after which the pressure is over.
+		DEFAULT_POLL_INTERVAL      = 1000
+			/// The interval in milliseconds for reading the
+			/// available memory without PSI.
+	};
+
+	explicit MemoryPressureMonitor(MemoryPressureRegistry& registry = MemoryPressureRegistry::defaultRegistry()):
+		_registry(registry),
+		_pressureFile("/proc/pressure/memory"),
+		_window(DEFAULT_WINDOW),
+		_moderateStall(DEFAULT_MODERATE_STALL),
+		_criticalStall(DEFAULT_CRITICAL_STALL),
+		_moderateAvailable(DEFAULT_MODERATE_AVAILABLE),
+		_criticalAvailable(DEFAULT_CRITICAL_AVAILABLE),
+		_recoveryTime(DEFAULT_RECOVERY_TIME),
+		_pollInterval(DEFAULT_POLL_INTERVAL),
+		_moderateFd(-1),
+		_criticalFd(-1),
+		_stopFd(-1),
+		_stop(false),
+		_level(MemoryPressure::PRESSURE_NONE)
+		/// Creates the MemoryPressureMonitor, which reports
+		/// to the given registry once started.
+	{
+	}
+
+	~MemoryPressureMonitor()
+		/// Stops and destroys the MemoryPressureMonitor.
+	{
+		try
+		{
+			stop();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void setPressureFile(const std::string& path)
+		/// Sets the PSI file to set the triggers on, e.g.
+		/// /sys/fs/cgroup/<group>/memory.pressure. An empty
+		/// path selects /proc/pressure/memory.
+		///
+		/// Must be called before start().
+	{
+		_pressureFile = path.empty() ? std::string("/proc/pressure/memory") : path;
+	}
+
+	const std::string& getPressureFile() const
+		/// Returns the PSI file.
+	{
+		return _pressureFile;
+	}
+
+	void setStallThresholds(long moderateStall, long criticalStall, long window = DEFAULT_WINDOW)
+		/// Sets the stall times, in microseconds within the given window,
+		/// for moderate and critical pressure. A stall time of 0 disables
+		/// the trigger. The kernel limits the window to 500 ms to 10 s.
+		///
+		/// Must be called before start().
+	{
+		if (moderateStall < 0 || criticalStall < 0 || moderateStall >= window || criticalStall >= window)
+			throw InvalidArgumentException("stall thresholds must be less than the window");
+		_moderateStall = moderateStall;
+		_criticalStall = criticalStall;
+		_window        = window;
+	}
+
+	void setAvailableThresholds(int moderatePercent, int criticalPercent)
+		/// Sets the percentages of available memory below which
+		/// moderate and critical pressure are reported without PSI.
+	{
+		if (criticalPercent < 0 || moderatePercent < criticalPercent || moderatePercent > 100)
+			throw InvalidArgumentException("invalid available memory thresholds");
+		_moderateAvailable = moderatePercent;
+		_criticalAvailable = criticalPercent;
+	}
+
+	void setRecoveryTime(long milliseconds)
+		/// Sets the time without triggers after which
+		/// PRESSURE_NONE is reported.
+	{
+		_recoveryTime = milliseconds;
+	}
+
+	void setPollInterval(long milliseconds)
+		/// Sets the interval for reading the available memory without PSI.
+	{
+		_pollInterval = milliseconds;
+	}
+
+	void start()
+		/// Sets the PSI triggers, if possible, and starts the thread.
+	{
+		if (_thread.isRunning()) return;
+		_stop = false;
+		_stopEvent.reset();
+#if defined(POCO_MPM_PSI)
+		_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (_stopFd != -1)
+		{
+			if (_moderateStall > 0) _moderateFd = openTrigger("some", _moderateStall);
+			if (_criticalStall > 0) _criticalFd = openTrigger("full", _criticalStall);
+			if (_moderateFd == -1 && _criticalFd == -1) closeDescriptors();
+		}
+#endif
+		_thread.start(*this);
+	}
+
+	void stop()
+		/// Stops the thread and removes the PSI triggers.
+	{
+		if (!_thread.isRunning()) return;
+		_stop = true;
+#if defined(POCO_MPM_PSI)
+		if (_stopFd != -1) eventfd_write(_stopFd, 1);
+#endif
+		_stopEvent.set();
+		_thread.join();
+		closeDescriptors();
+	}
+
+	bool isRunning() const
+		/// Returns true if the monitor has been started.
+	{
+		return _thread.isRunning();
+	}
+
+	bool usesPressureStall() const
+		/// Returns true iff the monitor has been started
+		/// with PSI triggers.
+	{
+		return _stopFd != -1;
+	}
+
+	MemoryPressure::Level level() const
+		/// Returns the level last reported.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _level;
+	}
+
+	static std::string cgroupPressureFile()
+		/// Returns the memory.pressure file of the cgroup (v2) of the
+		/// process, e.g. /sys/fs/cgroup/system.slice/app.service/memory.pressure,
+		/// or an empty string if the process is not in a cgroup v2
+		/// hierarchy with memory accounting.
+	{
+#if POCO_OS == POCO_OS_LINUX
+		try
+		{
+			FileInputStream istr("/proc/self/cgroup");
+			std::string line;
+			while (std::getline(istr, line))
+			{
+				if (line.compare(0, 3, "0::") == 0)
+				{
+					std::string path("/sys/fs/cgroup");
+					path += trim(line.substr(3));
+					if (path[path.size() - 1] != '/') path += '/';
+					path += "memory.pressure";
+					if (File(path).exists()) return path;
+				}
+			}
+		}
+		catch (Exception&)
+		{
+		}
+#endif
+		return std::string();
+	}
+
+protected:
+	void run()
+	{
+#if defined(POCO_MPM_PSI)
+		if (_stopFd != -1)
+		{
+			if (watchTriggers() || _stop) return;
+			// the pressure file has gone away, e.g. with its cgroup
+			closeDescriptors();
+		}
+#endif
+		while (!_stop)
+		{
+			int available = availablePercent();
+			MemoryPressure::Level level = MemoryPressure::PRESSURE_NONE;
+			if (available >= 0 && available < _criticalAvailable)
+				level = MemoryPressure::PRESSURE_CRITICAL;
+			else if (available >= 0 && available < _moderateAvailable)
+				level = MemoryPressure::PRESSURE_MODERATE;
+			if (level != MemoryPressure::PRESSURE_NONE || level != this->level()) report(level);
+			_stopEvent.tryWait(_pollInterval);
+		}
+	}
+
+#if defined(POCO_MPM_PSI)
+	bool watchTriggers()
+		/// Reports the pressure signalled by the PSI triggers until the
+		/// monitor is stopped, and returns true, or returns false
+		/// if the triggers cannot be used any more.
+	{
+		struct pollfd fds[3];
+		fds[0].fd = _moderateFd;
+		fds[0].events = POLLPRI;
+		fds[1].fd = _criticalFd;
+		fds[1].events = POLLPRI;
+		fds[2].fd = _stopFd;
+		fds[2].events = POLLIN;
+		Clock lastModerate;
+		Clock lastCritical;
+		bool moderate = false;
+		bool critical = false;
+		MemoryPressure::Level level = MemoryPressure::PRESSURE_NONE;
+		while (!_stop)
+		{
+			int timeout = -1;
+			if (level != MemoryPressure::PRESSURE_NONE)
+			{
+				const Clock& last = level == MemoryPressure::PRESSURE_CRITICAL ? lastCritical : lastModerate;
+				Clock::ClockDiff left = Clock::ClockDiff(_recoveryTime)*1000 - last.elapsed();
+				timeout = left > 0 ? static_cast<int>(left/1000) + 1 : 0;
+			}
+			for (int i = 0; i < 3; ++i) fds[i].revents = 0;
+			int rc = ::poll(fds, 3, timeout);
+			if (rc < 0)
+			{
+				if (errno == EINTR) continue;
+				return false;
+			}
+			if (_stop) break;
+			if ((fds[0].revents | fds[1].revents) & (POLLERR | POLLNVAL)) return false;
+			bool fired = false;
+			if (fds[1].revents & POLLPRI)
+			{
+				lastCritical.update();
+				critical = fired = true;
+			}
+			if (fds[0].revents & POLLPRI)
+			{
+				lastModerate.update();
+				moderate = fired = true;
+			}
+			Clock::ClockDiff recovery = Clock::ClockDiff(_recoveryTime)*1000;
+			MemoryPressure::Level newLevel = MemoryPressure::PRESSURE_NONE;
+			if (critical && !lastCritical.isElapsed(recovery))
+				newLevel = MemoryPressure::PRESSURE_CRITICAL;
+			else if (moderate && !lastModerate.isElapsed(recovery))
+				newLevel = MemoryPressure::PRESSURE_MODERATE;
+			if (fired || newLevel != level)
+			{
+				level = newLevel;
+				report(level);
+			}
+		}
+		return true;
+	}
+
+	int openTrigger(const char* kind, long stall)
+		/// Opens the pressure file and sets a trigger on it. Returns
+		/// the descriptor, or -1 if PSI is not available.
+	{
+		int fd = ::open(_pressureFile.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (fd == -1) return -1;
+		std::string trigger(kind);
+		trigger += ' ';
+		NumberFormatter::append(trigger, stall);
+		trigger += ' ';
+		NumberFormatter::append(trigger, _window);
+		if (::write(fd, trigger.c_str(), trigger.size() + 1) < 0)
+		{
+			::close(fd);
+			return -1;
+		}
+		return fd;
+	}
+#endif
+
+	void closeDescriptors()
+	{
+#if defined(POCO_MPM_PSI)
+		if (_moderateFd != -1) ::close(_moderateFd);
+		if (_criticalFd != -1) ::close(_criticalFd);
+		if (_stopFd != -1) ::close(_stopFd);
+#endif
+		_moderateFd = -1;
+		_criticalFd = -1;
+		_stopFd     = -1;
+	}
+
+	int availablePercent() const
+		/// Returns the percentage of available memory of the cgroup
+		/// of the pressure file, if it has a memory limit, or of the
+		/// system, or -1 if it cannot be determined.
+	{
+#if POCO_OS == POCO_OS_LINUX
+		try
+		{
+			std::string::size_type pos = _pressureFile.rfind("/memory.pressure");
+			if (pos != std::string::npos && _pressureFile.compare(0, 15, "/sys/fs/cgroup/") == 0)
+			{
+				std::string dir(_pressureFile, 0, pos + 1);
+				std::string max = readLine(dir + "memory.max");
+				Poco::UInt64 limit;
+				Poco::UInt64 current;
+				if (NumberParser::tryParseUnsigned64(max, limit) && limit > 0 && NumberParser::tryParseUnsigned64(readLine(dir + "memory.current"), current))
+				{
+					return current >= limit ? 0 : static_cast<int>((limit - current)*100/limit);
+				}
+			}
+			FileInputStream istr("/proc/meminfo");
+			std::string line;
+			Poco::UInt64 total = 0;
+			Poco::UInt64 available = 0;
+			bool haveAvailable = false;
+			while (std::getline(istr, line))
+			{
+				if (line.compare(0, 9, "MemTotal:") == 0)
+					total = parseKilobytes(line.substr(9));
+				else if (line.compare(0, 13, "MemAvailable:") == 0)
+				{
+					available = parseKilobytes(line.substr(13));
+					haveAvailable = true;
+				}
+			}
+			if (total > 0 && haveAvailable) return static_cast<int>(available*100/total);
+		}
+		catch (Exception&)
+		{
+		}
+#endif
+		return -1;
+	}
+
+	static std::string readLine(const std::string& path)
+	{
+		FileInputStream istr(path);
+		std::string line;
+		std::getline(istr, line);
+		return trim(line);
+	}
+
+	static Poco::UInt64 parseKilobytes(const std::string& value)
+	{
+		std::string number(trim(value));
+		std::string::size_type pos = number.find(' ');
+		if (pos != std::string::npos) number.resize(pos);
+		Poco::UInt64 kb = 0;
+		NumberParser::tryParseUnsigned64(number, kb);
+		return kb;
+	}
+
+	void report(MemoryPressure::Level level)
+	{
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_level = level;
+		}
+		_registry.notify(level);
+	}
+
+private:
+	MemoryPressureMonitor(const MemoryPressureMonitor&);
+	MemoryPressureMonitor& operator = (const MemoryPressureMonitor&);
+
+	MemoryPressureRegistry& _registry;
+	std::string _pressureFile;
+	long _window;
+	long _moderateStall;
+	long _criticalStall;
+	int _moderateAvailable;
+	int _criticalAvailable;
+	long _recoveryTime;
+	long _pollInterval;
+	int _moderateFd;
+	int _criticalFd;
+	int _stopFd;
+	volatile bool _stop;
+	MemoryPressure::Level _level;
+	Thread _thread;
+	Event _stopEvent;
+	mutable FastMutex _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_MemoryPressureMonitor_INCLUDED
@@ -23,6 +23,9 @@
 #include "Poco/Foundation.h"
 #include "Poco/Exception.h"
 #include "Poco/ScopedLock.h"
+#if defined(POCO_ENABLE_INSTRUMENTATION)
+#include "Poco/Instrumentation.h"
+#endif
 
 
 #if defined(POCO_OS_FAMILY_WINDOWS)
@@ -237,6 +240,11 @@ inline void Mutex::unlock()
 
 inline void FastMutex::lock()
 {
+#if defined(POCO_ENABLE_INSTRUMENTATION)
+	if (tryLockImpl()) return;
+	poco_instrument_count("FastMutex.contended");
+	poco_instrument_scope("FastMutex.wait");
+#endif
 	lockImpl();
 }
 
@@ -0,0 +1,343 @@
+//
+// DNSCache.h
+//
+// $Id$
+//
+// Library: Net
+// Package: NetCore
+// Module:  DNSCache
+//
+// Definition of the DNSCache class.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_DNSCache_INCLUDED
+#define Net_DNSCache_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/DNS.h"
+#include "Poco/Net/HostEntry.h"
+#include "Poco/Net/IPAddress.h"
+#include "Poco/ActiveMethod.h"
+#include "Poco/SingletonHolder.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Exception.h"
+#include "Poco/Condition.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include <map>
+
+
+namespace Poco {
+namespace Net {
+
+
+class DNSCache
+	/// DNSCache caches the results of DNS::hostByName() for a
+	/// configurable time to live, so that connecting repeatedly to the
+	/// same host does not require a lookup every time.
+	///
+	/// getaddrinfo() does not report the TTL of the records it returns,
+	/// so all entries are kept for the same configured time. After that,
+	/// an entry is still returned for a further grace period, while a
+	/// new lookup is done in the background (using resolveAsync), so
+	/// that callers are only blocked by lookups for hosts not resolved
+	/// before, or not resolved for a long time.
+	///
+	/// Failed lookups are cached as well, for a shorter time, and the
+	/// exception is rethrown for cached failures. Concurrent callers
+	/// resolving the same host share one lookup.
+	///
+	/// After a network change (e.g., a different interface or DNS server)
+	/// the cache should be flushed with flush(). Lookups in progress
+	/// during a flush() do not add their results to the cache.
+	///
+	/// Numeric addresses are not cached, as getaddrinfo() returns
+	/// them without a lookup.
+{
+public:
+	enum
+	{
+		DEFAULT_TTL          = 300,
+		DEFAULT_GRACE        = 60,
+		DEFAULT_NEGATIVE_TTL = 10,
+		DEFAULT_CAPACITY     = 256
+	};
+
+	DNSCache(const Poco::Timespan& ttl = Poco::Timespan(DEFAULT_TTL, 0), std::size_t capacity = DEFAULT_CAPACITY):
+		resolveAsync(this, &DNSCache::resolveImpl),
+		_ttl(ttl),
+		_grace(DEFAULT_GRACE, 0),
+		_negativeTTL(DEFAULT_NEGATIVE_TTL, 0),
+		_capacity(capacity > 0 ? capacity : 1),
+		_generation(0)
+		/// Creates the DNSCache with the given time to live
+		/// and maximum number of entries.
+	{
+	}
+
+	~DNSCache()
+		/// Destroys the DNSCache.
+		///
+		/// There must be no pending asynchronous lookups.
+	{
+	}
+
+	Poco::ActiveMethod<HostEntry, std::string, DNSCache> resolveAsync;
+		/// Looks up the given host name in the background,
+		/// and adds the result to the cache:
+		///
+		///     Poco::ActiveResult<HostEntry> result = cache.resolveAsync("example.com");
+		///     ...
+		///     result.wait();
+		///     if (!result.failed()) connect(result.data());
+		///
+		/// Lookups run in the default ThreadPool.
+
+	HostEntry resolve(const std::string& hostname)
+		/// Returns the HostEntry for the given host name or numeric address,
+		/// from the cache if possible. Throws the same exceptions as
+		/// DNS::hostByName() if the host cannot be resolved.
+	{
+		IPAddress address;
+		if (IPAddress::tryParse(hostname, address)) return DNS::hostByName(hostname);
+
+		bool refresh = false;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (;;)
+			{
+				EntryMap::iterator it = _entries.find(hostname);
+				if (it == _entries.end())
+				{
+					if (_entries.size() >= _capacity) evict();
+					_entries[hostname].resolving = true;
+					break;
+				}
+				Entry& e = it->second;
+				Poco::Timestamp now;
+				if (now < e.expires)
+				{
+					if (e.pError) e.pError->rethrow();
+					return e.entry;
+				}
+				else if (!e.pError && now < e.expires + _grace)
+				{
+					if (e.resolving) return e.entry;
+					e.resolving = true;
+					refresh = true;
+					break;
+				}
+				else if (e.resolving)
+				{
+					_resolved.wait(_mutex);
+				}
+				else
+				{
+					e.resolving = true;
+					break;
+				}
+			}
+		}
+		if (refresh)
+		{
+			HostEntry stale;
+			lookup(hostname, stale);
+			try
+			{
+				resolveAsync(hostname);
+			}
+			catch (Poco::Exception&)
+			{
+				return resolveImpl(hostname);
+			}
+			return stale;
+		}
+		return resolveImpl(hostname);
+	}
+
+	bool lookup(const std::string& hostname, HostEntry& entry) const
+		/// Returns the cached HostEntry for the given host name, even
+		/// if it has expired, without doing a DNS lookup. Returns false
+		/// if the host is not in the cache.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		EntryMap::const_iterator it = _entries.find(hostname);
+		if (it == _entries.end() || it->second.entry.addresses().empty()) return false;
+		entry = it->second.entry;
+		return true;
+	}
+
+	void remove(const std::string& hostname)
+		/// Removes the given host name from the cache.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_entries.erase(hostname);
+	}
+
+	void flush()
+		/// Removes all entries from the cache.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_entries.clear();
+		++_generation;
+		_resolved.broadcast();
+	}
+
+	void setTTL(const Poco::Timespan& ttl)
+		/// Sets the time to live for new entries.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_ttl = ttl;
+	}
+
+	Poco::Timespan getTTL() const
+		/// Returns the time to live for new entries.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _ttl;
+	}
+
+	void setGracePeriod(const Poco::Timespan& grace)
+		/// Sets the time after expiration during which an entry
+		/// is still returned while it is refreshed in the background.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_grace = grace;
+	}
+
+	Poco::Timespan getGracePeriod() const
+		/// Returns the grace period.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _grace;
+	}
+
+	void setNegativeTTL(const Poco::Timespan& ttl)
+		/// Sets the time a failed lookup is cached.
+		/// Zero disables negative caching.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_negativeTTL = ttl;
+	}
+
+	Poco::Timespan getNegativeTTL() const
+		/// Returns the time a failed lookup is cached.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _negativeTTL;
+	}
+
+	std::size_t size() const
+		/// Returns the number of cached entries.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _entries.size();
+	}
+
+	static DNSCache& defaultCache()
+		/// Returns a reference to the default DNSCache.
+	{
+		static Poco::SingletonHolder<DNSCache> sh;
+		return *sh.get();
+	}
+
+protected:
+	struct Entry
+	{
+		Entry():
+			expires(0),
+			resolving(false)
+		{
+		}
+
+		HostEntry entry;
+		Poco::SharedPtr<Poco::Exception> pError;
+		Poco::Timestamp expires;
+		bool resolving;
+	};
+
+	typedef std::map<std::string, Entry> EntryMap;
+
+	HostEntry resolveImpl(const std::string& hostname)
+	{
+		Poco::UInt64 generation;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			generation = _generation;
+		}
+		HostEntry entry;
+		try
+		{
+			entry = DNS::hostByName(hostname);
+		}
+		catch (Poco::Exception& exc)
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (generation == _generation)
+			{
+				Entry& e = _entries[hostname];
+				e.resolving = false;
+				// a failed refresh keeps the stale entry for the grace period
+				bool stale = !e.pError && !e.entry.addresses().empty() && Poco::Timestamp() < e.expires + _grace;
+				if (!stale && _negativeTTL > 0)
+				{
+					e.pError = exc.clone();
+					e.expires = Poco::Timestamp() + _negativeTTL;
+				}
+			}
+			_resolved.broadcast();
+			throw;
+		}
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (generation == _generation)
+		{
+			if (_entries.size() >= _capacity && _entries.find(hostname) == _entries.end()) evict();
+			Entry& e = _entries[hostname];
+			e.entry = entry;
+			e.pError = 0;
+			e.expires = Poco::Timestamp() + _ttl;
+			e.resolving = false;
+		}
+		_resolved.broadcast();
+		return entry;
+	}
+
+	void evict()
+		/// Removes the entry expiring first, preferring entries
+		/// not being resolved. Must be called with the mutex locked.
+	{
+		EntryMap::iterator oldest = _entries.end();
+		for (EntryMap::iterator it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			if (!it->second.resolving && (oldest == _entries.end() || it->second.expires < oldest->second.expires)) oldest = it;
+		}
+		if (oldest != _entries.end()) _entries.erase(oldest);
+	}
+
+private:
+	DNSCache(const DNSCache&);
+	DNSCache& operator = (const DNSCache&);
+
+	Poco::Timespan _ttl;
+	Poco::Timespan _grace;
+	Poco::Timespan _negativeTTL;
+	std::size_t _capacity;
+	Poco::UInt64 _generation;
+	EntryMap _entries;
+	Poco::Condition _resolved;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_DNSCache_INCLUDED
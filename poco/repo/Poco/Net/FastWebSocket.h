@@ -0,0 +1,433 @@
+//
+// FastWebSocket.h
+//
+// $Id$
+//
+// Library: Net
+// Package: WebSocket
+// Module:  FastWebSocket
+//
+// Definition of the FastWebSocket class.
+//
+// Copyright (c) 2012-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_FastWebSocket_INCLUDED
+#define Net_FastWebSocket_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/WebSocket.h"
+#include "Poco/Net/WebSocketImpl.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/Buffer.h"
+#include "Poco/RandomPool.h"
+#include <vector>
+#include <cstring>
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <sys/uio.h>
+#include <cerrno>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+class FastWebSocket: public WebSocket
+	/// FastWebSocket is a WebSocket with a frame API that avoids the
+	/// buffer size limit and the copies of WebSocket::receiveFrame():
+	///
+	///   - receiveFrame(Poco::Buffer<char>&, int&) receives a frame of
+	///     any size (up to a configurable maximum) into a buffer that
+	///     grows as needed and can be reused for all frames.
+	///   - Small frames are parsed from a read-ahead buffer, so that a
+	///     burst of frames is received with a single system call, and the
+	///     payload of larger frames is received directly into the
+	///     caller's buffer.
+	///   - Masking and unmasking work on 16 (SSE2) or 8 bytes at a time.
+	///   - sendFrames() sends several frames with a single system call
+	///     (writev() on POSIX platforms).
+	///
+	/// The handshake is done by WebSocket, as usual:
+	///
+	///     FastWebSocket ws(WebSocket(request, response));
+	///     Poco::Buffer<char> buffer(0);
+	///     int flags;
+	///     int n = ws.receiveFrame(buffer, flags);
+	///
+	/// Frames are read from and written to the socket directly, bypassing
+	/// WebSocketImpl. This is not possible for secure (wss) connections,
+	/// or for data received together with the handshake response
+	/// and buffered by WebSocketImpl; in these cases, the WebSocket
+	/// implementation is used. Sending frames with WebSocket::sendFrame()
+	/// is fine, but after receiveFrame(Poco::Buffer<char>&, int&), frames
+	/// must not be received with WebSocket::receiveFrame(), as they may
+	/// already be in the read-ahead buffer.
+{
+public:
+	struct Frame
+		/// A frame to be sent with sendFrames().
+	{
+		Frame():
+			data(0),
+			length(0),
+			flags(FRAME_TEXT)
+		{
+		}
+
+		Frame(const void* d, int l, int f = FRAME_TEXT):
+			data(d),
+			length(l),
+			flags(f)
+		{
+		}
+
+		const void* data;
+		int length;
+		int flags;
+	};
+
+	typedef std::vector<Frame> FrameVec;
+
+	enum
+	{
+		READ_AHEAD_SIZE      = 4096,
+		DEFAULT_MAX_PAYLOAD  = 16*1024*1024,
+		MAX_HEADER_LENGTH    = 14
+	};
+
+	explicit FastWebSocket(const WebSocket& ws):
+		WebSocket(ws),
+		_readAhead(READ_AHEAD_SIZE),
+		_begin(0),
+		_end(0),
+		_maxPayloadSize(DEFAULT_MAX_PAYLOAD),
+		_mustMask(false),
+		_direct(false),
+		_checkBuffered(true)
+		/// Creates the FastWebSocket from a connected WebSocket.
+	{
+		WebSocketImpl* pImpl = dynamic_cast<WebSocketImpl*>(impl());
+		if (!pImpl) throw InvalidArgumentException("Socket is not a WebSocket");
+		_mustMask = pImpl->mustMaskPayload();
+		_direct = !pImpl->secure();
+	}
+
+	~FastWebSocket()
+		/// Destroys the FastWebSocket.
+	{
+	}
+
+	using WebSocket::receiveFrame;
+	using WebSocket::sendFrame;
+
+	void setMaxPayloadSize(int size)
+		/// Sets the largest payload accepted by receiveFrame(Poco::Buffer<char>&, int&).
+	{
+		_maxPayloadSize = size;
+	}
+
+	int getMaxPayloadSize() const
+		/// Returns the largest payload accepted.
+	{
+		return _maxPayloadSize;
+	}
+
+	int receiveFrame(Poco::Buffer<char>& buffer, int& flags)
+		/// Receives a frame, resizing the buffer to the size of its payload,
+		/// and returns the payload size. The buffer's capacity is kept,
+		/// so reusing the buffer avoids memory allocations.
+		///
+		/// Returns 0 and sets flags to 0 if the peer has closed the
+		/// connection. Throws a WebSocketException (WS_ERR_PAYLOAD_TOO_BIG)
+		/// if the payload is larger than the maximum payload size.
+	{
+		if (!direct())
+		{
+			if (buffer.capacity() < static_cast<std::size_t>(READ_AHEAD_SIZE)) buffer.setCapacity(READ_AHEAD_SIZE, false);
+			int n = WebSocket::receiveFrame(buffer.begin(), static_cast<int>(buffer.capacity()), flags);
+			buffer.resize(n > 0 ? n : 0);
+			return n;
+		}
+
+		if (!fill(2))
+		{
+			flags = 0;
+			buffer.resize(0);
+			return 0;
+		}
+		const unsigned char* p = reinterpret_cast<const unsigned char*>(_readAhead.begin() + _begin);
+		int frameFlags = p[0];
+		bool masked = (p[1] & 0x80) != 0;
+		Poco::UInt64 length = p[1] & 0x7f;
+		std::size_t header = 2 + (length == 126 ? 2 : length == 127 ? 8 : 0) + (masked ? 4 : 0);
+		if (!fill(header)) throw WebSocketException("Incomplete frame received", WebSocket::WS_ERR_INCOMPLETE_FRAME);
+		p = reinterpret_cast<const unsigned char*>(_readAhead.begin() + _begin);
+		std::size_t pos = 2;
+		if (length == 126)
+		{
+			length = (Poco::UInt64(p[2]) << 8) | p[3];
+			pos = 4;
+		}
+		else if (length == 127)
+		{
+			length = 0;
+			for (int i = 0; i < 8; ++i) length = (length << 8) | p[2 + i];
+			pos = 10;
+		}
+		unsigned char mask[4] = {0, 0, 0, 0};
+		if (masked) std::memcpy(mask, p + pos, 4);
+		if (length > static_cast<Poco::UInt64>(_maxPayloadSize))
+		{
+			throw WebSocketException("Insufficient buffer for payload size", WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+		}
+		_begin += header;
+
+		std::size_t n = static_cast<std::size_t>(length);
+		buffer.resize(n, false);
+		std::size_t copied = _end - _begin < n ? _end - _begin : n;
+		std::memcpy(buffer.begin(), _readAhead.begin() + _begin, copied);
+		_begin += copied;
+		while (copied < n)
+		{
+			int rc = rawReceive(buffer.begin() + copied, static_cast<int>(n - copied));
+			if (rc <= 0) throw WebSocketException("Incomplete frame received", WebSocket::WS_ERR_INCOMPLETE_FRAME);
+			copied += static_cast<std::size_t>(rc);
+		}
+		if (masked) applyMask(buffer.begin(), n, mask);
+		flags = frameFlags;
+		return static_cast<int>(n);
+	}
+
+	int sendFrames(const FrameVec& frames)
+		/// Sends the given frames, with as few system calls as possible,
+		/// and returns the total number of payload bytes sent.
+	{
+		if (!direct())
+		{
+			int total = 0;
+			for (FrameVec::const_iterator it = frames.begin(); it != frames.end(); ++it)
+			{
+				total += WebSocket::sendFrame(it->data, it->length, it->flags);
+			}
+			return total;
+		}
+
+		std::vector<char> headers(frames.size()*MAX_HEADER_LENGTH);
+		std::size_t maskedSize = 0;
+		if (_mustMask)
+		{
+			for (FrameVec::const_iterator it = frames.begin(); it != frames.end(); ++it) maskedSize += static_cast<std::size_t>(it->length);
+		}
+		std::vector<char> masked(maskedSize);
+		std::vector<Chunk> chunks;
+		chunks.reserve(frames.size()*2);
+		std::size_t maskedPos = 0;
+		int total = 0;
+		for (std::size_t i = 0; i < frames.size(); ++i)
+		{
+			const Frame& frame = frames[i];
+			char* pHeader = &headers[i*MAX_HEADER_LENGTH];
+			unsigned char mask[4];
+			std::size_t headerLength = writeHeader(pHeader, frame, mask);
+			chunks.push_back(Chunk(pHeader, headerLength));
+			if (frame.length > 0)
+			{
+				if (_mustMask)
+				{
+					std::memcpy(&masked[maskedPos], frame.data, static_cast<std::size_t>(frame.length));
+					applyMask(&masked[maskedPos], static_cast<std::size_t>(frame.length), mask);
+					chunks.push_back(Chunk(&masked[maskedPos], static_cast<std::size_t>(frame.length)));
+					maskedPos += static_cast<std::size_t>(frame.length);
+				}
+				else chunks.push_back(Chunk(static_cast<const char*>(frame.data), static_cast<std::size_t>(frame.length)));
+			}
+			total += frame.length;
+		}
+		rawSend(chunks);
+		return total;
+	}
+
+	static void applyMask(char* data, std::size_t length, const unsigned char mask[4])
+		/// Masks or unmasks the given data with the given masking key.
+	{
+		std::size_t i = 0;
+		Poco::UInt32 m32;
+		std::memcpy(&m32, mask, 4);
+		Poco::UInt64 m64 = (Poco::UInt64(m32) << 32) | m32;
+#if defined(__SSE2__)
+		__m128i m128 = _mm_set_epi32(static_cast<int>(m32), static_cast<int>(m32), static_cast<int>(m32), static_cast<int>(m32));
+		for (; i + 16 <= length; i += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, m128));
+		}
+#endif
+		for (; i + 8 <= length; i += 8)
+		{
+			Poco::UInt64 v;
+			std::memcpy(&v, data + i, 8);
+			v ^= m64;
+			std::memcpy(data + i, &v, 8);
+		}
+		for (; i < length; ++i)
+		{
+			data[i] ^= static_cast<char>(mask[i & 3]);
+		}
+	}
+
+protected:
+	struct Chunk
+	{
+		Chunk(const char* d, std::size_t l):
+			data(d),
+			length(l)
+		{
+		}
+
+		const char* data;
+		std::size_t length;
+	};
+
+	typedef std::vector<Chunk> ChunkVec;
+
+	bool direct()
+		/// Returns true if frames can be read and written directly.
+		/// Data buffered by WebSocketImpl from the handshake must be
+		/// received through WebSocketImpl first.
+	{
+		if (_direct && _checkBuffered)
+		{
+			if (impl()->available() > impl()->SocketImpl::available()) return false;
+			_checkBuffered = false;
+		}
+		return _direct;
+	}
+
+	std::size_t writeHeader(char* pHeader, const Frame& frame, unsigned char mask[4])
+	{
+		std::size_t length = static_cast<std::size_t>(frame.length);
+		unsigned char* p = reinterpret_cast<unsigned char*>(pHeader);
+		std::size_t n = 0;
+		p[n++] = static_cast<unsigned char>(frame.flags);
+		unsigned char maskBit = _mustMask ? 0x80 : 0;
+		if (length < 126)
+		{
+			p[n++] = static_cast<unsigned char>(length | maskBit);
+		}
+		else if (length < 65536)
+		{
+			p[n++] = static_cast<unsigned char>(126 | maskBit);
+			p[n++] = static_cast<unsigned char>(length >> 8);
+			p[n++] = static_cast<unsigned char>(length);
+		}
+		else
+		{
+			p[n++] = static_cast<unsigned char>(127 | maskBit);
+			Poco::UInt64 l = length;
+			for (int i = 7; i >= 0; --i) p[n++] = static_cast<unsigned char>(l >> (i*8));
+		}
+		if (_mustMask)
+		{
+			Poco::UInt32 key = Poco::RandomPool::next32();
+			std::memcpy(mask, &key, 4);
+			std::memcpy(p + n, mask, 4);
+			n += 4;
+		}
+		return n;
+	}
+
+	bool fill(std::size_t n)
+		/// Makes sure the read-ahead buffer contains at least n bytes.
+		/// Returns false if the connection is closed before.
+	{
+		if (_end - _begin >= n) return true;
+		if (_begin > 0)
+		{
+			std::memmove(_readAhead.begin(), _readAhead.begin() + _begin, _end - _begin);
+			_end -= _begin;
+			_begin = 0;
+		}
+		while (_end < n)
+		{
+			int rc = rawReceive(_readAhead.begin() + _end, static_cast<int>(_readAhead.size() - _end));
+			if (rc <= 0) return false;
+			_end += static_cast<std::size_t>(rc);
+		}
+		return true;
+	}
+
+	int rawReceive(char* buffer, int length)
+	{
+		return impl()->SocketImpl::receiveBytes(buffer, length, 0);
+	}
+
+	void rawSend(const ChunkVec& chunks)
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		std::vector<struct iovec> iov(chunks.size());
+		for (std::size_t i = 0; i < chunks.size(); ++i)
+		{
+			iov[i].iov_base = const_cast<char*>(chunks[i].data);
+			iov[i].iov_len  = chunks[i].length;
+		}
+		std::size_t first = 0;
+		while (first < iov.size())
+		{
+			int count = static_cast<int>(iov.size() - first);
+			if (count > IOV_MAX) count = IOV_MAX;
+			ssize_t rc = ::writev(impl()->sockfd(), &iov[first], count);
+			if (rc < 0)
+			{
+				if (errno == EINTR) continue;
+				throw NetException("Cannot send WebSocket frames", errno);
+			}
+			std::size_t sent = static_cast<std::size_t>(rc);
+			while (first < iov.size() && sent >= iov[first].iov_len)
+			{
+				sent -= iov[first].iov_len;
+				++first;
+			}
+			if (sent > 0)
+			{
+				iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + sent;
+				iov[first].iov_len -= sent;
+			}
+		}
+#else
+		std::vector<char> data;
+		for (ChunkVec::const_iterator it = chunks.begin(); it != chunks.end(); ++it)
+		{
+			data.insert(data.end(), it->data, it->data + it->length);
+		}
+		std::size_t sent = 0;
+		while (sent < data.size())
+		{
+			sent += static_cast<std::size_t>(impl()->SocketImpl::sendBytes(&data[sent], static_cast<int>(data.size() - sent), 0));
+		}
+#endif
+	}
+
+private:
+	Poco::Buffer<char> _readAhead;
+	std::size_t _begin;
+	std::size_t _end;
+	int _maxPayloadSize;
+	bool _mustMask;
+	bool _direct;
+	bool _checkBuffered;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_FastWebSocket_INCLUDED
@@ -0,0 +1,611 @@
+//
+// HTTPSessionPool.h
+//
+// $Id$
+//
+// Library: NetSSL_OpenSSL
+// Package: HTTPSClient
+// Module:  HTTPSessionPool
+//
+// Definition of the HTTPSessionPool class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef NetSSL_HTTPSessionPool_INCLUDED
+#define NetSSL_HTTPSessionPool_INCLUDED
+
+
+#include "Poco/Net/NetSSL.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPSClientSession.h"
+#include "Poco/Net/SSLManager.h"
+#include "Poco/Net/Context.h"
+#include "Poco/Net/Session.h"
+#include "Poco/Net/DNSCache.h"
+#include "Poco/Net/TLSSessionCache.h"
+#include "Poco/Net/InterfaceBinder.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Timer.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include "Poco/URI.h"
+#include <map>
+#include <deque>
+#include <vector>
+
+
+namespace Poco {
+namespace Net {
+
+
+template <class Base>
+class PooledClientSession: public Base
+	/// The HTTPClientSession or HTTPSClientSession created by
+	/// HTTPSessionPool. It can be connected to an address
+	/// resolved by the pool, instead of resolving the host
+	/// name itself, and binds its socket to the network
+	/// interface given by an InterfaceBinder, also when
+	/// reconnecting.
+{
+public:
+	PooledClientSession(const std::string& host, Poco::UInt16 port):
+		Base(host, port)
+	{
+	}
+
+	PooledClientSession(const std::string& host, Poco::UInt16 port, Context::Ptr pContext, Session::Ptr pSession):
+		Base(host, port, pContext, pSession)
+	{
+	}
+
+	~PooledClientSession()
+	{
+	}
+
+	void setInterfaceBinder(const InterfaceBinder& binder)
+		/// Sets the InterfaceBinder used for new connections.
+	{
+		_binder = binder;
+	}
+
+	const InterfaceBinder& getInterfaceBinder() const
+		/// Returns the InterfaceBinder used for new connections.
+	{
+		return _binder;
+	}
+
+	void connectTo(const SocketAddress& address)
+		/// Connects the session to the given address.
+	{
+		this->connect(address);
+	}
+
+protected:
+	void connect(const SocketAddress& address)
+	{
+		_binder.bind(this->socket(), address.family());
+		Base::connect(address);
+	}
+
+private:
+	PooledClientSession(const PooledClientSession&);
+	PooledClientSession& operator = (const PooledClientSession&);
+
+	InterfaceBinder _binder;
+};
+
+
+class HTTPSessionPool
+	/// HTTPSessionPool keeps HTTPClientSession and HTTPSClientSession
+	/// objects for reuse, so that sending requests to the same server
+	/// repeatedly does not require a new connection, DNS lookup and TLS
+	/// handshake every time.
+	///
+	/// Sessions are pooled by scheme, host, port and proxy. A session is
+	/// obtained with acquire() and must be given back with release() once
+	/// the response has been read completely. Sessions that are no longer
+	/// connected, or have been idle for longer than the idle timeout
+	/// (or the session's keep-alive timeout), are closed instead of
+	/// being reused; idle sessions are also closed periodically.
+	///
+	/// Up to a given number of sessions per endpoint can be in use at the
+	/// same time. If all are in use, acquire() waits for one to be released.
+	///
+	/// Host names are resolved through a DNSCache. For HTTPS, the TLS
+	/// session of the last connection to an endpoint is stored in a
+	/// TLSSessionCache and used to resume the TLS session on new
+	/// connections, which saves a full handshake. Client session caching
+	/// is enabled on the Context for this.
+	///
+	/// If a proxy is used, the proxy connection is made by the session
+	/// as usual, without the DNSCache.
+	///
+	/// Sessions can be bound to a network interface with setInterface().
+	/// When the network path changes, setInterface() or interrupt() close
+	/// all connections made over the previous path, including those in
+	/// use, so that requests fail (and can be retried) immediately instead
+	/// of waiting for TCP retransmission timeouts.
+	///
+	/// Example:
+	///
+	///     HTTPSessionPool::SessionPtr pSession = pool.acquire(uri);
+	///     pSession->sendRequest(request) << body;
+	///     std::istream& rs = pSession->receiveResponse(response);
+	///     Poco::StreamCopier::copyToString(rs, reply);
+	///     pool.release(pSession);
+{
+public:
+	typedef Poco::SharedPtr<HTTPClientSession> SessionPtr;
+
+	enum
+	{
+		DEFAULT_MAX_PER_ENDPOINT = 4,
+		DEFAULT_IDLE_TIMEOUT     = 30,
+		DEFAULT_ACQUIRE_TIMEOUT  = 30
+	};
+
+	explicit HTTPSessionPool(std::size_t maxPerEndpoint = DEFAULT_MAX_PER_ENDPOINT, Context::Ptr pContext = 0, DNSCache& dnsCache = DNSCache::defaultCache(), TLSSessionCache& tlsSessionCache = TLSSessionCache::defaultCache()):
+		_maxPerEndpoint(maxPerEndpoint > 0 ? maxPerEndpoint : 1),
+		_pContext(pContext),
+		_dnsCache(dnsCache),
+		_tlsSessionCache(tlsSessionCache),
+		_idleTimeout(DEFAULT_IDLE_TIMEOUT, 0),
+		_acquireTimeout(DEFAULT_ACQUIRE_TIMEOUT, 0),
+		_generation(0),
+		_timer(DEFAULT_IDLE_TIMEOUT*500, DEFAULT_IDLE_TIMEOUT*500)
+		/// Creates the HTTPSessionPool with the given maximum number of
+		/// sessions per endpoint.
+		///
+		/// If no Context is given, the default client Context of the
+		/// SSLManager is used for HTTPS sessions.
+	{
+		TLSSessionCache::prepare(_pContext);
+		_timer.start(Poco::TimerCallback<HTTPSessionPool>(*this, &HTTPSessionPool::onTimer));
+	}
+
+	~HTTPSessionPool()
+		/// Closes all idle sessions and destroys the HTTPSessionPool.
+	{
+		try
+		{
+			_timer.stop();
+			clear();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void setIdleTimeout(const Poco::Timespan& timeout)
+		/// Sets the time after which an idle session is closed.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_idleTimeout = timeout;
+	}
+
+	Poco::Timespan getIdleTimeout() const
+		/// Returns the idle session timeout.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _idleTimeout;
+	}
+
+	void setAcquireTimeout(const Poco::Timespan& timeout)
+		/// Sets the time acquire() waits for a session if all sessions
+		/// for the endpoint are in use.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_acquireTimeout = timeout;
+	}
+
+	Poco::Timespan getAcquireTimeout() const
+		/// Returns the acquire timeout.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _acquireTimeout;
+	}
+
+	void setSessionTimeout(const Poco::Timespan& timeout)
+		/// Sets the socket timeout for new sessions.
+		/// If zero (the default), the HTTPSession default is used.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_sessionTimeout = timeout;
+	}
+
+	SessionPtr acquire(const Poco::URI& uri, const HTTPClientSession::ProxyConfig& proxyConfig = HTTPClientSession::getGlobalProxyConfig())
+		/// Returns a session for the scheme, host and port of the given URI.
+	{
+		return acquire(uri.getScheme(), uri.getHost(), uri.getPort(), proxyConfig);
+	}
+
+	SessionPtr acquire(const std::string& scheme, const std::string& host, Poco::UInt16 port, const HTTPClientSession::ProxyConfig& proxyConfig = HTTPClientSession::getGlobalProxyConfig())
+		/// Returns an idle session for the given endpoint, or a new one if
+		/// there is none and fewer than the maximum number of sessions for
+		/// the endpoint are in use. Otherwise, waits until a session is
+		/// released, and throws a TimeoutException if none is released
+		/// within the acquire timeout.
+	{
+		Key key(scheme, host, port, proxyConfig);
+		if (!key.secure && scheme != "http") throw Poco::InvalidArgumentException("Unsupported scheme", scheme);
+
+		std::vector<SessionPtr> stale;
+		InterfaceBinder binder;
+		Poco::UInt32 generation;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			Poco::Timestamp deadline;
+			deadline += _acquireTimeout;
+			for (;;)
+			{
+				Endpoint& endpoint = _endpoints[key];
+				while (!endpoint.idle.empty())
+				{
+					Idle idle = endpoint.idle.back();
+					endpoint.idle.pop_back();
+					if (reusable(*idle.pSession, idle.since))
+					{
+						++endpoint.active;
+						_inUse[idle.pSession.get()] = _generation;
+						return idle.pSession;
+					}
+					stale.push_back(idle.pSession);
+				}
+				if (endpoint.active < _maxPerEndpoint)
+				{
+					++endpoint.active;
+					binder = _binder;
+					generation = _generation;
+					break;
+				}
+				Poco::Timestamp now;
+				if (now >= deadline) throw Poco::TimeoutException("No session available for endpoint", host);
+				_released.tryWait(_mutex, static_cast<long>((deadline - now)/1000) + 1);
+			}
+		}
+		stale.clear();
+
+		try
+		{
+			SessionPtr pSession = create(key, proxyConfig, binder);
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_inUse[pSession.get()] = generation;
+			return pSession;
+		}
+		catch (...)
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			--_endpoints[key].active;
+			_released.signal();
+			throw;
+		}
+	}
+
+	void release(SessionPtr pSession)
+		/// Gives back a session obtained with acquire(). The session is
+		/// kept for reuse if it is still connected, has not failed and
+		/// has not been interrupted.
+		/// The response stream of the session must have been read
+		/// completely, otherwise the session must be given back with
+		/// discard().
+	{
+		poco_check_ptr (pSession.get());
+
+		Key key(*pSession);
+		if (key.secure && pSession->connected())
+		{
+			_tlsSessionCache.put(tlsSessionKey(key), static_cast<HTTPSClientSession&>(*pSession).sslSession());
+		}
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Endpoint& endpoint = _endpoints[key];
+		if (endpoint.active > 0) --endpoint.active;
+		InUseMap::iterator it = _inUse.find(pSession.get());
+		bool current = it != _inUse.end() && it->second == _generation;
+		if (it != _inUse.end()) _inUse.erase(it);
+		if (current && pSession->connected() && !pSession->networkException() && pSession->getKeepAlive())
+		{
+			Idle idle;
+			idle.pSession = pSession;
+			endpoint.idle.push_back(idle);
+		}
+		_released.signal();
+	}
+
+	void discard(SessionPtr pSession)
+		/// Gives back a session obtained with acquire()
+		/// without keeping it for reuse.
+	{
+		poco_check_ptr (pSession.get());
+
+		Key key(*pSession);
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			Endpoint& endpoint = _endpoints[key];
+			if (endpoint.active > 0) --endpoint.active;
+			_inUse.erase(pSession.get());
+			_released.signal();
+		}
+		pSession->reset();
+	}
+
+	void reap()
+		/// Closes all sessions that have been idle for
+		/// longer than the idle timeout. This is done
+		/// periodically by the HTTPSessionPool.
+	{
+		std::vector<SessionPtr> stale;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (EndpointMap::iterator it = _endpoints.begin(); it != _endpoints.end();)
+			{
+				Endpoint& endpoint = it->second;
+				std::deque<Idle>::iterator iit = endpoint.idle.begin();
+				while (iit != endpoint.idle.end())
+				{
+					if (reusable(*iit->pSession, iit->since))
+					{
+						++iit;
+					}
+					else
+					{
+						stale.push_back(iit->pSession);
+						iit = endpoint.idle.erase(iit);
+					}
+				}
+				if (endpoint.idle.empty() && endpoint.active == 0)
+					_endpoints.erase(it++);
+				else
+					++it;
+			}
+		}
+	}
+
+	void clear()
+		/// Closes all idle sessions.
+	{
+		EndpointMap endpoints;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (EndpointMap::iterator it = _endpoints.begin(); it != _endpoints.end(); ++it)
+			{
+				if (it->second.active > 0) endpoints[it->first].active = it->second.active;
+			}
+			std::swap(endpoints, _endpoints);
+		}
+	}
+
+	void setInterface(const InterfaceBinder& binder)
+		/// Sets the network interface that new sessions are bound to,
+		/// and closes or interrupts all existing sessions (see interrupt()).
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_binder = binder;
+		}
+		interrupt();
+	}
+
+	InterfaceBinder getInterface() const
+		/// Returns the network interface that new sessions are bound to.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _binder;
+	}
+
+	void interrupt()
+		/// Closes all idle sessions and interrupts the connections of all
+		/// sessions in use, e.g. because the network path has changed.
+		/// Requests in progress on these sessions fail immediately, and
+		/// the sessions are closed when they are given back.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			++_generation;
+			for (InUseMap::iterator it = _inUse.begin(); it != _inUse.end(); ++it)
+			{
+				InterfaceBinder::interrupt(it->first->socket());
+			}
+		}
+		clear();
+	}
+
+	std::size_t idleCount() const
+		/// Returns the number of idle sessions.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		std::size_t n = 0;
+		for (EndpointMap::const_iterator it = _endpoints.begin(); it != _endpoints.end(); ++it)
+		{
+			n += it->second.idle.size();
+		}
+		return n;
+	}
+
+	std::size_t activeCount() const
+		/// Returns the number of sessions in use.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		std::size_t n = 0;
+		for (EndpointMap::const_iterator it = _endpoints.begin(); it != _endpoints.end(); ++it)
+		{
+			n += it->second.active;
+		}
+		return n;
+	}
+
+protected:
+	struct Key
+	{
+		Key(const std::string& scheme, const std::string& h, Poco::UInt16 p, const HTTPClientSession::ProxyConfig& proxyConfig):
+			secure(scheme == "https"),
+			host(h),
+			port(p),
+			proxyHost(proxyConfig.host),
+			proxyPort(proxyConfig.host.empty() ? 0 : proxyConfig.port)
+		{
+		}
+
+		explicit Key(const HTTPClientSession& session):
+			secure(session.secure()),
+			host(session.getHost()),
+			port(session.getPort()),
+			proxyHost(session.getProxyHost()),
+			proxyPort(session.getProxyHost().empty() ? 0 : session.getProxyPort())
+		{
+		}
+
+		bool operator < (const Key& other) const
+		{
+			if (secure != other.secure) return secure < other.secure;
+			if (port != other.port) return port < other.port;
+			if (host != other.host) return host < other.host;
+			if (proxyPort != other.proxyPort) return proxyPort < other.proxyPort;
+			return proxyHost < other.proxyHost;
+		}
+
+		bool secure;
+		std::string host;
+		Poco::UInt16 port;
+		std::string proxyHost;
+		Poco::UInt16 proxyPort;
+	};
+
+	struct Idle
+	{
+		SessionPtr pSession;
+		Poco::Timestamp since;
+	};
+
+	struct Endpoint
+	{
+		Endpoint():
+			active(0)
+		{
+		}
+
+		std::deque<Idle> idle;
+		std::size_t active;
+	};
+
+	typedef std::map<Key, Endpoint> EndpointMap;
+	typedef std::map<HTTPClientSession*, Poco::UInt32> InUseMap;
+
+	bool reusable(HTTPClientSession& session, const Poco::Timestamp& since) const
+		/// Returns true if an idle session can be reused. Must be called
+		/// with the mutex locked.
+	{
+		Poco::Timespan timeout = session.getKeepAliveTimeout() < _idleTimeout ? session.getKeepAliveTimeout() : _idleTimeout;
+		if (since.isElapsed(timeout.totalMicroseconds())) return false;
+		try
+		{
+			// a readable idle connection has been closed by the server
+			return session.connected() && !session.socket().poll(Poco::Timespan(), Socket::SELECT_READ);
+		}
+		catch (Poco::Exception&)
+		{
+			return false;
+		}
+	}
+
+	std::string tlsSessionKey(const Key& key) const
+	{
+		Context::Ptr pContext = _pContext ? _pContext : SSLManager::instance().defaultClientContext();
+		return TLSSessionCache::key(key.host, key.port, pContext);
+	}
+
+	SessionPtr create(const Key& key, const HTTPClientSession::ProxyConfig& proxyConfig, const InterfaceBinder& binder)
+		/// Creates and connects a new session.
+	{
+		Poco::Timespan sessionTimeout;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			sessionTimeout = _sessionTimeout;
+		}
+		if (key.secure)
+		{
+			Context::Ptr pContext = _pContext ? _pContext : SSLManager::instance().defaultClientContext();
+			TLSSessionCache::prepare(pContext);
+			Session::Ptr pTLSSession = _tlsSessionCache.get(TLSSessionCache::key(key.host, key.port, pContext));
+			Poco::SharedPtr<PooledClientSession<HTTPSClientSession> > pSession = new PooledClientSession<HTTPSClientSession>(key.host, key.port, pContext, pTLSSession);
+			pSession->setInterfaceBinder(binder);
+			connect(*pSession, sessionTimeout, proxyConfig);
+			return pSession;
+		}
+		else
+		{
+			Poco::SharedPtr<PooledClientSession<HTTPClientSession> > pSession = new PooledClientSession<HTTPClientSession>(key.host, key.port);
+			pSession->setInterfaceBinder(binder);
+			connect(*pSession, sessionTimeout, proxyConfig);
+			return pSession;
+		}
+	}
+
+	template <class S>
+	void connect(PooledClientSession<S>& session, const Poco::Timespan& timeout, const HTTPClientSession::ProxyConfig& proxyConfig)
+		/// Configures the session and, unless a proxy is used, connects
+		/// it to one of the addresses of the host, in the order returned
+		/// by the DNSCache.
+	{
+		session.setProxyConfig(proxyConfig);
+		if (timeout != 0) session.setTimeout(timeout);
+		if (!session.getProxyHost().empty() && !session.bypassProxy()) return;
+
+		HostEntry entry = _dnsCache.resolve(session.getHost());
+		const HostEntry::AddressList& addresses = entry.addresses();
+		if (addresses.empty()) throw HostNotFoundException(session.getHost());
+		for (HostEntry::AddressList::const_iterator it = addresses.begin();; ++it)
+		{
+			try
+			{
+				session.connectTo(SocketAddress(*it, session.getPort()));
+				return;
+			}
+			catch (NetException&)
+			{
+				if (it + 1 == addresses.end()) throw;
+				session.reset();
+			}
+		}
+	}
+
+	void onTimer(Poco::Timer&)
+	{
+		reap();
+	}
+
+private:
+	HTTPSessionPool(const HTTPSessionPool&);
+	HTTPSessionPool& operator = (const HTTPSessionPool&);
+
+	std::size_t _maxPerEndpoint;
+	Context::Ptr _pContext;
+	DNSCache& _dnsCache;
+	TLSSessionCache& _tlsSessionCache;
+	Poco::Timespan _idleTimeout;
+	Poco::Timespan _acquireTimeout;
+	Poco::Timespan _sessionTimeout;
+	InterfaceBinder _binder;
+	Poco::UInt32 _generation;
+	EndpointMap _endpoints;
+	InUseMap _inUse;
+	Poco::Condition _released;
+	mutable Poco::FastMutex _mutex;
+	Poco::Timer _timer;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // NetSSL_HTTPSessionPool_INCLUDED
@@ -0,0 +1,152 @@
+//
+// InterfaceBinder.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Sockets
+// Module:  InterfaceBinder
+//
+// Definition of the InterfaceBinder class.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_InterfaceBinder_INCLUDED
+#define Net_InterfaceBinder_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/SocketImpl.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/NetworkInterface.h"
+#include "Poco/Exception.h"
+#include "Poco/Timespan.h"
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <sys/socket.h>
+#include <net/if.h>
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+class InterfaceBinder
+	/// InterfaceBinder binds client sockets to a network interface before
+	/// they are connected, so that the connection uses that interface
+	/// (e.g., a specific cellular APN or the WLAN), regardless of the
+	/// default route.
+	///
+	/// The socket is bound to the first address of the interface for the
+	/// address family of the peer. On Linux, it is additionally bound to
+	/// the device itself with SO_BINDTODEVICE, if the process has the
+	/// required privileges (CAP_NET_RAW before Linux 5.7); otherwise,
+	/// the source address determines the interface with policy routing.
+	///
+	/// A default-constructed InterfaceBinder does not bind sockets.
+	///
+	/// The interface is looked up every time a socket is bound, since its
+	/// addresses change when the link goes down and comes up again.
+{
+public:
+	InterfaceBinder()
+		/// Creates an InterfaceBinder that does not bind sockets.
+	{
+	}
+
+	explicit InterfaceBinder(const std::string& interfaceName):
+		_interfaceName(interfaceName)
+		/// Creates an InterfaceBinder for the interface with the given
+		/// name (e.g., "rmnet_data0" or "wlan0").
+	{
+	}
+
+	~InterfaceBinder()
+		/// Destroys the InterfaceBinder.
+	{
+	}
+
+	const std::string& interfaceName() const
+		/// Returns the name of the interface, or an empty string
+		/// if sockets are not bound.
+	{
+		return _interfaceName;
+	}
+
+	bool isNull() const
+		/// Returns true if sockets are not bound.
+	{
+		return _interfaceName.empty();
+	}
+
+	void bind(Socket& socket, IPAddress::Family family) const
+		/// Binds the unconnected socket to the interface, for connecting
+		/// to a peer with the given address family. Does nothing if the
+		/// InterfaceBinder is null.
+		///
+		/// Throws an InterfaceNotFoundException if the interface does
+		/// not exist, or a NotFoundException if it has no address of
+		/// the given family, e.g. because the link is down.
+	{
+		if (_interfaceName.empty()) return;
+
+#if defined(POCO_NET_HAS_INTERFACE)
+		NetworkInterface interfc = NetworkInterface::forName(_interfaceName, family == IPAddress::IPv6 ? NetworkInterface::IPv6_ONLY : NetworkInterface::IPv4_ONLY);
+		socket.impl()->bind(SocketAddress(interfc.firstAddress(family), 0));
+#if defined(SO_BINDTODEVICE)
+		// best effort; without privileges the source address is used for routing
+		::setsockopt(socket.impl()->sockfd(), SOL_SOCKET, SO_BINDTODEVICE, _interfaceName.c_str(), static_cast<poco_socklen_t>(_interfaceName.size() + 1));
+#endif
+#else
+		throw Poco::NotImplementedException("Network interfaces not supported");
+#endif
+	}
+
+	StreamSocket connect(const SocketAddress& address) const
+		/// Creates a StreamSocket bound to the interface
+		/// and connects it to the given address.
+	{
+		StreamSocket socket(address.family());
+		bind(socket, address.family());
+		socket.connect(address);
+		return socket;
+	}
+
+	StreamSocket connect(const SocketAddress& address, const Poco::Timespan& timeout) const
+		/// Creates a StreamSocket bound to the interface and connects
+		/// it to the given address, with the given connection timeout.
+	{
+		StreamSocket socket(address.family());
+		bind(socket, address.family());
+		socket.connect(address, timeout);
+		return socket;
+	}
+
+	static void interrupt(const Socket& socket)
+		/// Shuts down the connection of the socket in both directions at
+		/// the system level, so that all threads blocked sending or receiving
+		/// on it return immediately, with an error or end of stream.
+		///
+		/// Unlike Socket::shutdown(), no TLS close notify is sent, so this is
+		/// safe to call for a SecureStreamSocket used by another thread.
+		/// The socket must be closed by its owner afterwards.
+	{
+		poco_socket_t fd = socket.impl()->sockfd();
+		if (fd != POCO_INVALID_SOCKET) ::shutdown(fd, 2); // SHUT_RDWR, SD_BOTH
+	}
+
+private:
+	std::string _interfaceName;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_InterfaceBinder_INCLUDED
@@ -24,6 +24,7 @@
 #include "Poco/Net/StreamSocket.h"
 #include "Poco/Net/ServerSocket.h"
 #include "Poco/Environment.h"
+#include "Poco/Timestamp.h"
 #include "Poco/NObserver.h"
 #include "Poco/SharedPtr.h"
 #include <vector>
@@ -53,16 +54,37 @@ class ParallelSocketAcceptor
 	/// by event handler. See ParallelSocketAcceptor::onAccept and 
 	/// ParallelSocketAcceptor::createServiceHandler documentation and implementation for 
 	/// details.
+	///
+	/// Instead of round-robin, connections can be distributed to the reactor
+	/// handling the fewest connections (DISTRIBUTE_LEAST_CONNECTIONS), which
+	/// requires service handlers to call ParallelSocketReactor::connectionClosed(),
+	/// or to the reactor that has been least busy recently (DISTRIBUTE_LEAST_BUSY).
+	/// See setDistribution().
 {
 public:
 	typedef Poco::Net::ParallelSocketReactor<SR> ParallelReactor;
 
+	enum Distribution
+	{
+		DISTRIBUTE_ROUND_ROBIN,
+			/// Reactors are selected in turn (default).
+		DISTRIBUTE_LEAST_CONNECTIONS,
+			/// The reactor with the smallest number of connections
+			/// (ParallelSocketReactor::connections()) is selected.
+		DISTRIBUTE_LEAST_BUSY
+			/// The reactor with the fewest wakeups with sockets ready
+			/// (ParallelSocketReactor::busyCount()) during the last
+			/// second, plus the connections passed to it in that time,
+			/// is selected.
+	};
+
 	explicit ParallelSocketAcceptor(ServerSocket& socket,
 		unsigned threads = Poco::Environment::processorCount()):
 		_socket(socket),
 		_pReactor(0),
 		_threads(threads),
-		_next(0)
+		_next(0),
+		_distribution(DISTRIBUTE_ROUND_ROBIN)
 		/// Creates a ParallelSocketAcceptor using the given ServerSocket, 
 		/// sets number of threads and populates the reactors vector.
 	{
@@ -75,7 +97,8 @@ public:
 		_socket(socket),
 		_pReactor(&reactor),
 		_threads(threads),
-		_next(0)
+		_next(0),
+		_distribution(DISTRIBUTE_ROUND_ROBIN)
 		/// Creates a ParallelSocketAcceptor using the given ServerSocket, sets the 
 		/// number of threads, populates the reactors vector and registers itself 
 		/// with the given SocketReactor.
@@ -104,6 +127,20 @@ public:
 		}
 	}
 
+	void setDistribution(Distribution distribution)
+		/// Sets the strategy for selecting the reactor
+		/// for a new connection.
+	{
+		_distribution = distribution;
+	}
+
+	Distribution getDistribution() const
+		/// Returns the strategy for selecting the reactor
+		/// for a new connection.
+	{
+		return _distribution;
+	}
+
 	void setReactor(SocketReactor& reactor)
 		/// Sets the reactor for this acceptor.
 	{
@@ -166,12 +203,66 @@ protected:
 		///
 		/// Subclasses can override this method.
 	{
-		std::size_t next = _next++;
-		if (_next == _reactors.size()) _next = 0;
+		std::size_t next = selectReactor();
+		_reactors[next]->connectionOpened();
 		_reactors[next]->wakeUp();
 		return new ServiceHandler(socket, *_reactors[next]);
 	}
 
+	virtual std::size_t selectReactor()
+		/// Returns the index of the reactor for a new connection,
+		/// according to the distribution strategy.
+		///
+		/// Subclasses can override this method.
+	{
+		std::size_t n = _reactors.size();
+		if (_distribution == DISTRIBUTE_ROUND_ROBIN)
+		{
+			std::size_t next = _next++;
+			if (_next == n) _next = 0;
+			return next;
+		}
+
+		if (_distribution == DISTRIBUTE_LEAST_BUSY)
+		{
+			Poco::Timestamp now;
+			if (_busyBase.size() != n || now - _sampled >= SAMPLE_INTERVAL)
+			{
+				_busyBase.resize(n);
+				_assigned.assign(n, 0);
+				for (std::size_t i = 0; i < n; ++i) _busyBase[i] = _reactors[i]->busyCount();
+				_sampled = now;
+			}
+		}
+
+		// Ties are resolved in round-robin order.
+		std::size_t best = _next;
+		int bestLoad = load(best);
+		for (std::size_t i = 1; i < n; ++i)
+		{
+			std::size_t idx = (_next + i) % n;
+			int l = load(idx);
+			if (l < bestLoad)
+			{
+				best = idx;
+				bestLoad = l;
+			}
+		}
+		_next = (best + 1) % n;
+		if (_distribution == DISTRIBUTE_LEAST_BUSY) ++_assigned[best];
+		return best;
+	}
+
+	int load(std::size_t idx) const
+		/// Returns the load of the reactor with the given
+		/// index, according to the distribution strategy.
+	{
+		if (_distribution == DISTRIBUTE_LEAST_BUSY)
+			return _reactors[idx]->busyCount() - _busyBase[idx] + _assigned[idx];
+		else
+			return _reactors[idx]->connections();
+	}
+
 	SocketReactor* reactor()
 		/// Returns a pointer to the SocketReactor where
 		/// this SocketAcceptor is registered.
@@ -221,11 +312,20 @@ private:
 	ParallelSocketAcceptor(const ParallelSocketAcceptor&);
 	ParallelSocketAcceptor& operator = (const ParallelSocketAcceptor&);
 
+	enum
+	{
+		SAMPLE_INTERVAL = 1000000
+	};
+
 	ServerSocket   _socket;
 	SocketReactor* _pReactor;
 	unsigned       _threads;
 	ReactorVec     _reactors;
 	std::size_t    _next;
+	Distribution   _distribution;
+	std::vector<int> _busyBase;
+	std::vector<int> _assigned;
+	Poco::Timestamp _sampled;
 };
 
 
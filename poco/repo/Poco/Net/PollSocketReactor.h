@@ -0,0 +1,224 @@
+//
+// PollSocketReactor.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Reactor
+// Module:  PollSocketReactor
+//
+// Definition of the PollSocketReactor class.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_PollSocketReactor_INCLUDED
+#define Net_PollSocketReactor_INCLUDED
+
+
+#include "Poco/Net/SocketReactor.h"
+#include "Poco/Net/SocketNotification.h"
+#include "Poco/Net/PollSet.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/Exception.h"
+#include "Poco/Mutex.h"
+#include <map>
+
+
+namespace Poco {
+namespace Net {
+
+
+class PollSocketReactor: public SocketReactor
+	/// PollSocketReactor is a SocketReactor that waits for socket events
+	/// with a PollSet, i.e. epoll on Linux and kqueue on BSD platforms.
+	///
+	/// Sockets stay registered with the PollSet for as long as they
+	/// have event handlers, instead of being passed to Socket::select()
+	/// on every iteration, so a wakeup costs time proportional to the
+	/// number of sockets ready, not to the number of sockets handled.
+	/// Event handlers are dispatched by SocketReactor, as usual, and
+	/// receive the same notifications.
+	///
+	/// The interface is the same as SocketReactor's. However, since
+	/// SocketReactor::addEventHandler() and SocketReactor::removeEventHandler()
+	/// are not virtual, event handlers must be added and removed through a
+	/// PollSocketReactor (or a class derived from it, like
+	/// ParallelSocketReactor<PollSocketReactor>) reference, not a
+	/// SocketReactor reference, for the PollSet to see them. The same
+	/// applies to stop() and wakeUp(). Service handlers used with a
+	/// PollSocketReactor should therefore take a reference to the reactor
+	/// class they are used with, e.g. as a template parameter.
+{
+public:
+	PollSocketReactor():
+		_stop(false),
+		_pReadableNotification(new ReadableNotification(this)),
+		_pWritableNotification(new WritableNotification(this)),
+		_pErrorNotification(new ErrorNotification(this))
+		/// Creates the PollSocketReactor.
+	{
+	}
+
+	explicit PollSocketReactor(const Poco::Timespan& timeout):
+		SocketReactor(timeout),
+		_stop(false),
+		_pReadableNotification(new ReadableNotification(this)),
+		_pWritableNotification(new WritableNotification(this)),
+		_pErrorNotification(new ErrorNotification(this))
+		/// Creates the PollSocketReactor, using the given timeout.
+	{
+	}
+
+	~PollSocketReactor()
+		/// Destroys the PollSocketReactor.
+	{
+	}
+
+	void run()
+		/// Runs the PollSocketReactor. The reactor will run
+		/// until stop() is called (in a separate thread).
+	{
+		PollSet::SocketModeList ready;
+		while (!_stop)
+		{
+			try
+			{
+				if (_pollSet.empty())
+				{
+					onIdle();
+					_pollSet.poll(getTimeout(), ready);
+				}
+				else if (_pollSet.poll(getTimeout(), ready) > 0)
+				{
+					onBusy();
+					for (PollSet::SocketModeList::iterator it = ready.begin(); it != ready.end(); ++it)
+					{
+						if (it->second & Socket::SELECT_READ) dispatch(it->first, _pReadableNotification);
+						if (it->second & Socket::SELECT_WRITE) dispatch(it->first, _pWritableNotification);
+						if (it->second & Socket::SELECT_ERROR) dispatch(it->first, _pErrorNotification);
+					}
+				}
+				else if (!_stop) onTimeout();
+			}
+			catch (Poco::Exception& exc)
+			{
+				Poco::ErrorHandler::handle(exc);
+			}
+			catch (std::exception& exc)
+			{
+				Poco::ErrorHandler::handle(exc);
+			}
+			catch (...)
+			{
+				Poco::ErrorHandler::handle();
+			}
+		}
+		onShutdown();
+	}
+
+	void stop()
+		/// Stops the PollSocketReactor.
+		///
+		/// The reactor will be stopped when the next event
+		/// (including a timeout event) occurs.
+	{
+		_stop = true;
+		_pollSet.wakeUp();
+		SocketReactor::stop();
+	}
+
+	void wakeUp()
+		/// Wakes up the reactor thread waiting for events.
+	{
+		_pollSet.wakeUp();
+	}
+
+	void addEventHandler(const Socket& socket, const Poco::AbstractObserver& observer)
+		/// Registers an event handler with the PollSocketReactor.
+	{
+		bool known = SocketReactor::hasEventHandler(socket, observer);
+		SocketReactor::addEventHandler(socket, observer);
+		if (known) return;
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Interest& interest = _interests[socket];
+		if (observer.accepts(_pReadableNotification)) ++interest.read;
+		if (observer.accepts(_pWritableNotification)) ++interest.write;
+		if (observer.accepts(_pErrorNotification)) ++interest.error;
+		_pollSet.add(socket, interest.mode());
+	}
+
+	bool hasEventHandler(const Socket& socket, const Poco::AbstractObserver& observer)
+		/// Returns true if the observer is registered with the
+		/// PollSocketReactor for the given socket.
+	{
+		return SocketReactor::hasEventHandler(socket, observer);
+	}
+
+	void removeEventHandler(const Socket& socket, const Poco::AbstractObserver& observer)
+		/// Unregisters an event handler with the PollSocketReactor.
+	{
+		if (!SocketReactor::hasEventHandler(socket, observer)) return;
+		SocketReactor::removeEventHandler(socket, observer);
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		InterestMap::iterator it = _interests.find(socket);
+		if (it == _interests.end()) return;
+		if (observer.accepts(_pReadableNotification)) --it->second.read;
+		if (observer.accepts(_pWritableNotification)) --it->second.write;
+		if (observer.accepts(_pErrorNotification)) --it->second.error;
+		int mode = it->second.mode();
+		if (mode == 0)
+		{
+			_pollSet.remove(socket);
+			_interests.erase(it);
+		}
+		else _pollSet.add(socket, mode);
+	}
+
+protected:
+	struct Interest
+	{
+		Interest():
+			read(0),
+			write(0),
+			error(0)
+		{
+		}
+
+		int mode() const
+		{
+			return (read > 0 ? Socket::SELECT_READ : 0) | (write > 0 ? Socket::SELECT_WRITE : 0) | (error > 0 ? Socket::SELECT_ERROR : 0);
+		}
+
+		int read;
+		int write;
+		int error;
+	};
+
+	typedef Poco::AutoPtr<SocketNotification> NotificationPtr;
+	typedef std::map<Socket, Interest> InterestMap;
+
+private:
+	PollSocketReactor(const PollSocketReactor&);
+	PollSocketReactor& operator = (const PollSocketReactor&);
+
+	volatile bool _stop;
+	PollSet _pollSet;
+	InterestMap _interests;
+	NotificationPtr _pReadableNotification;
+	NotificationPtr _pWritableNotification;
+	NotificationPtr _pErrorNotification;
+	Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_PollSocketReactor_INCLUDED
@@ -0,0 +1,160 @@
+//
+// ReusePortSocketAcceptor.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Reactor
+// Module:  ReusePortSocketAcceptor
+//
+// Definition of the ReusePortSocketAcceptor class.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_ReusePortSocketAcceptor_INCLUDED
+#define Net_ReusePortSocketAcceptor_INCLUDED
+
+
+#include "Poco/Net/ParallelSocketReactor.h"
+#include "Poco/Net/SocketNotification.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Environment.h"
+#include "Poco/Observer.h"
+#include "Poco/SharedPtr.h"
+#include <vector>
+
+
+namespace Poco {
+namespace Net {
+
+
+template <class ServiceHandler, class SR>
+class ReusePortSocketAcceptor
+	/// ReusePortSocketAcceptor is a variant of ParallelSocketAcceptor
+	/// in which every reactor has its own listening socket, bound to the
+	/// same address with the SO_REUSEPORT option.
+	///
+	/// The operating system distributes incoming connections over the
+	/// listening sockets, and each connection is accepted and handled by
+	/// the reactor thread of the socket that received it, so there is no
+	/// single thread accepting all connections.
+	///
+	/// SO_REUSEPORT load balancing is available on Linux 3.9 and later.
+	/// On other platforms, the option may only allow binding multiple
+	/// sockets, with connections going to one of them.
+	///
+	/// As with ParallelSocketAcceptor, the ServiceHandler class must
+	/// provide a constructor that takes a StreamSocket and a SocketReactor:
+	///
+	///     ServiceHandler(const StreamSocket& socket, SocketReactor& reactor)
+{
+public:
+	typedef Poco::Net::ParallelSocketReactor<SR> ParallelReactor;
+
+	explicit ReusePortSocketAcceptor(const SocketAddress& address,
+		unsigned threads = Poco::Environment::processorCount(),
+		int backlog = 64)
+		/// Creates a ReusePortSocketAcceptor with the given number of
+		/// reactors, each listening on the given address.
+	{
+		poco_assert (threads > 0);
+
+		for (unsigned i = 0; i < threads; ++i)
+		{
+			ServerSocket socket;
+			socket.init(address.af());
+			socket.setReusePort(true);
+			socket.bind(address, true);
+			socket.listen(backlog);
+			_sockets.push_back(socket);
+			_reactors.push_back(new ParallelReactor);
+		}
+		for (std::size_t i = 0; i < _reactors.size(); ++i)
+		{
+			_reactors[i]->addEventHandler(_sockets[i],
+				Poco::Observer<ReusePortSocketAcceptor,
+				ReadableNotification>(*this, &ReusePortSocketAcceptor::onAccept));
+		}
+	}
+
+	virtual ~ReusePortSocketAcceptor()
+		/// Destroys the ReusePortSocketAcceptor.
+	{
+		try
+		{
+			for (std::size_t i = 0; i < _reactors.size(); ++i)
+			{
+				_reactors[i]->removeEventHandler(_sockets[i],
+					Poco::Observer<ReusePortSocketAcceptor,
+					ReadableNotification>(*this, &ReusePortSocketAcceptor::onAccept));
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void onAccept(ReadableNotification* pNotification)
+		/// Accepts a connection on the listening socket of the
+		/// notifying reactor and creates a service handler for it.
+	{
+		pNotification->release();
+		for (std::size_t i = 0; i < _reactors.size(); ++i)
+		{
+			if (&pNotification->source() == _reactors[i].get())
+			{
+				StreamSocket sock = _sockets[i].acceptConnection();
+				createServiceHandler(sock, i);
+				break;
+			}
+		}
+	}
+
+protected:
+	typedef std::vector<typename ParallelReactor::Ptr> ReactorVec;
+	typedef std::vector<ServerSocket> SocketVec;
+
+	virtual ServiceHandler* createServiceHandler(StreamSocket& socket, std::size_t idx)
+		/// Creates and initializes a new ServiceHandler instance
+		/// for a connection accepted by the reactor with the given index.
+		///
+		/// Subclasses can override this method.
+	{
+		_reactors[idx]->connectionOpened();
+		return new ServiceHandler(socket, *_reactors[idx]);
+	}
+
+	ReactorVec& reactors()
+		/// Returns reference to vector of reactors.
+	{
+		return _reactors;
+	}
+
+	SocketVec& sockets()
+		/// Returns reference to vector of listening sockets.
+	{
+		return _sockets;
+	}
+
+private:
+	ReusePortSocketAcceptor();
+	ReusePortSocketAcceptor(const ReusePortSocketAcceptor&);
+	ReusePortSocketAcceptor& operator = (const ReusePortSocketAcceptor&);
+
+	SocketVec  _sockets;
+	ReactorVec _reactors;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_ReusePortSocketAcceptor_INCLUDED
@@ -0,0 +1,642 @@
+//
+// StreamingMultipartReader.h
+//
+// $Id$
+//
+// Library: Net
+// Package: Messages
+// Module:  StreamingMultipartReader
+//
+// Definition of the MultipartPartHeader, MultipartPartHandler,
+// StreamingMultipartReader and SpoolingPartHandler classes.
+//
+// Copyright (c) 2005-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Net_StreamingMultipartReader_INCLUDED
+#define Net_StreamingMultipartReader_INCLUDED
+
+
+#include "Poco/Net/Net.h"
+#include "Poco/Net/MessageHeader.h"
+#include "Poco/Net/NameValueCollection.h"
+#include "Poco/Net/MediaType.h"
+#include "Poco/Net/HTMLForm.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/TemporaryFile.h"
+#include "Poco/FileStream.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Buffer.h"
+#include "Poco/String.h"
+#include "Poco/Ascii.h"
+#include <istream>
+#include <vector>
+#include <cstring>
+
+
+namespace Poco {
+namespace Net {
+
+
+class MultipartPartHeader
+	/// The header fields of a part of a multipart message, kept as
+	/// a vector of name/value pairs in the order received, with the
+	/// parameters of the Content-Disposition header (field name and
+	/// file name for multipart/form-data) readily available.
+{
+public:
+	typedef std::vector<std::pair<std::string, std::string> > FieldVec;
+
+	MultipartPartHeader():
+		_hasFileName(false)
+	{
+	}
+
+	~MultipartPartHeader()
+	{
+	}
+
+	const FieldVec& fields() const
+		/// Returns all header fields.
+	{
+		return _fields;
+	}
+
+	bool has(const std::string& name) const
+		/// Returns true if there is a header field with the given name
+		/// (compared case-insensitively).
+	{
+		return find(name) != 0;
+	}
+
+	const std::string& get(const std::string& name, const std::string& defaultValue) const
+		/// Returns the value of the first header field with the given name,
+		/// or defaultValue if there is none.
+	{
+		const std::string* pValue = find(name);
+		return pValue ? *pValue : defaultValue;
+	}
+
+	const std::string& contentType() const
+		/// Returns the value of the Content-Type header field,
+		/// or an empty string if there is none.
+	{
+		return _contentType;
+	}
+
+	const std::string& name() const
+		/// Returns the name parameter of the Content-Disposition
+		/// header field, i.e. the form field name.
+	{
+		return _name;
+	}
+
+	const std::string& fileName() const
+		/// Returns the filename parameter of the Content-Disposition
+		/// header field, or an empty string if there is none.
+	{
+		return _fileName;
+	}
+
+	bool isFile() const
+		/// Returns true if the part has a filename parameter,
+		/// i.e. it is a file upload.
+	{
+		return _hasFileName;
+	}
+
+	void clear()
+		/// Removes all header fields.
+	{
+		_fields.clear();
+		_contentType.clear();
+		_name.clear();
+		_fileName.clear();
+		_hasFileName = false;
+	}
+
+	void add(const std::string& name, const std::string& value)
+		/// Adds a header field. Content-Type and Content-Disposition
+		/// are parsed as they are added.
+	{
+		_fields.push_back(std::make_pair(name, value));
+		if (Poco::icompare(name, "Content-Type") == 0)
+		{
+			_contentType = value;
+		}
+		else if (Poco::icompare(name, "Content-Disposition") == 0)
+		{
+			std::string disposition;
+			NameValueCollection params;
+			MessageHeader::splitParameters(value, disposition, params);
+			_name = params.get("name", "");
+			_hasFileName = params.has("filename");
+			_fileName = params.get("filename", "");
+		}
+	}
+
+protected:
+	const std::string* find(const std::string& name) const
+	{
+		for (FieldVec::const_iterator it = _fields.begin(); it != _fields.end(); ++it)
+		{
+			if (Poco::icompare(it->first, name) == 0) return &it->second;
+		}
+		return 0;
+	}
+
+private:
+	FieldVec _fields;
+	std::string _contentType;
+	std::string _name;
+	std::string _fileName;
+	bool _hasFileName;
+};
+
+
+class MultipartPartHandler
+	/// The interface for receiving the parts of a multipart message
+	/// from a StreamingMultipartReader.
+	///
+	/// The content of a part is passed to partData() in pieces, which
+	/// point directly into the reader's buffer and are only valid
+	/// during the call.
+{
+public:
+	virtual void beginPart(const MultipartPartHeader& header) = 0;
+		/// Called with the header of each part, before its content.
+
+	virtual void partData(const char* data, std::size_t length) = 0;
+		/// Called with each piece of the content of the current part.
+
+	virtual void endPart() = 0;
+		/// Called after the complete content of the current part
+		/// has been passed to partData().
+
+protected:
+	virtual ~MultipartPartHandler()
+	{
+	}
+};
+
+
+class StreamingMultipartReader
+	/// StreamingMultipartReader splits a MIME multipart message (RFC 2046),
+	/// e.g. a multipart/form-data request body, into its parts, like
+	/// MultipartReader, with much less work per byte for large parts.
+	///
+	/// The message is read in large blocks, in which the boundary delimiter
+	/// is searched with memchr() (which is vectorized in common C libraries)
+	/// for its first character, followed by a memcmp() of the delimiter.
+	/// The content between delimiters is passed to a MultipartPartHandler
+	/// directly from the buffer, without a per-part stream.
+	///
+	/// Example:
+	///
+	///     SpoolingPartHandler handler(1024*1024);
+	///     StreamingMultipartReader reader(request.stream(), boundary);
+	///     reader.read(handler);
+	///
+	/// Use loadForm() to fill an HTMLForm from a request, like
+	/// HTMLForm::load(), with file uploads going to a MultipartPartHandler.
+{
+public:
+	enum
+	{
+		DEFAULT_BUFFER_SIZE     = 65536,
+		MAX_HEADER_SIZE         = 16384,
+		MAX_FIELD_VALUE_LENGTH  = 65536
+	};
+
+	StreamingMultipartReader(std::istream& istr, const std::string& boundary, std::size_t bufferSize = DEFAULT_BUFFER_SIZE):
+		_istr(istr),
+		_delimiter("\r\n--"),
+		_buffer(bufferSize > std::size_t(2*MAX_HEADER_SIZE) ? bufferSize : std::size_t(2*MAX_HEADER_SIZE)),
+		_begin(0),
+		_end(0)
+		/// Creates the StreamingMultipartReader for the given stream and
+		/// boundary. Reads are done in blocks of up to bufferSize bytes.
+	{
+		if (boundary.empty() || boundary.size() > 70) throw MultipartException("Invalid multipart boundary", boundary);
+		_delimiter += boundary;
+		// a delimiter at the very beginning has no preceding CRLF
+		_buffer[0] = '\r';
+		_buffer[1] = '\n';
+		_end = 2;
+	}
+
+	~StreamingMultipartReader()
+		/// Destroys the StreamingMultipartReader.
+	{
+	}
+
+	void read(MultipartPartHandler& handler)
+		/// Reads all parts of the message and passes them to the handler.
+		/// The preamble and epilogue are ignored; reading ends with the
+		/// close delimiter.
+		///
+		/// Throws a MultipartException if the message is malformed
+		/// or ends prematurely.
+	{
+		// skip the preamble
+		for (;;)
+		{
+			bool found;
+			std::size_t pos = search(found);
+			_begin = pos;
+			if (found)
+			{
+				_begin += _delimiter.size();
+				break;
+			}
+			if (fill() == 0) throw MultipartException("No boundary line found");
+		}
+		MultipartPartHeader header;
+		while (nextPart(header))
+		{
+			handler.beginPart(header);
+			for (;;)
+			{
+				bool found;
+				std::size_t pos = search(found);
+				if (pos > _begin) handler.partData(_buffer.begin() + _begin, pos - _begin);
+				_begin = pos;
+				if (found)
+				{
+					_begin += _delimiter.size();
+					break;
+				}
+				if (fill() == 0) throw MultipartException("Unexpected end of multipart message");
+			}
+			handler.endPart();
+		}
+	}
+
+	static void loadForm(HTMLForm& form, const HTTPRequest& request, std::istream& requestBody, MultipartPartHandler& fileHandler, std::size_t maxFieldValueLength = MAX_FIELD_VALUE_LENGTH)
+		/// Reads the form data from the given HTTP request, like HTMLForm::load().
+		///
+		/// For multipart/form-data requests, form fields are added to the form,
+		/// respecting its field limit, and file uploads are passed to fileHandler.
+		/// Other requests are handled by HTMLForm::load(). Throws an
+		/// HTMLFormException if a field value is longer than maxFieldValueLength.
+	{
+		MediaType mediaType(request.getContentType());
+		if (request.getMethod() == HTTPRequest::HTTP_POST && mediaType.matches("multipart", "form-data"))
+		{
+			form.setEncoding(HTMLForm::ENCODING_MULTIPART);
+			FormPartHandler handler(form, fileHandler, maxFieldValueLength);
+			StreamingMultipartReader reader(requestBody, mediaType.getParameter("boundary"));
+			reader.read(handler);
+		}
+		else form.load(request, requestBody);
+	}
+
+protected:
+	class FormPartHandler: public MultipartPartHandler
+		/// Adds form fields to an HTMLForm and passes
+		/// file uploads to another handler.
+	{
+	public:
+		FormPartHandler(HTMLForm& form, MultipartPartHandler& fileHandler, std::size_t maxValueLength):
+			_form(form),
+			_fileHandler(fileHandler),
+			_maxValueLength(maxValueLength),
+			_isFile(false)
+		{
+		}
+
+		void beginPart(const MultipartPartHeader& header)
+		{
+			_isFile = header.isFile();
+			if (_isFile)
+			{
+				_fileHandler.beginPart(header);
+			}
+			else
+			{
+				int limit = _form.getFieldLimit();
+				if (limit > 0 && _form.size() >= static_cast<std::size_t>(limit)) throw HTMLFormException("Too many form fields");
+				_name = header.name();
+				_value.clear();
+			}
+		}
+
+		void partData(const char* data, std::size_t length)
+		{
+			if (_isFile)
+			{
+				_fileHandler.partData(data, length);
+			}
+			else
+			{
+				if (_value.size() + length > _maxValueLength) throw HTMLFormException("Form field value too long", _name);
+				_value.append(data, length);
+			}
+		}
+
+		void endPart()
+		{
+			if (_isFile)
+				_fileHandler.endPart();
+			else
+				_form.add(_name, _value);
+		}
+
+	private:
+		HTMLForm& _form;
+		MultipartPartHandler& _fileHandler;
+		std::size_t _maxValueLength;
+		bool _isFile;
+		std::string _name;
+		std::string _value;
+	};
+
+	std::size_t fill()
+		/// Moves unprocessed data to the beginning of the buffer
+		/// and reads more data. Returns the number of bytes read.
+	{
+		if (_begin > 0)
+		{
+			std::memmove(_buffer.begin(), _buffer.begin() + _begin, _end - _begin);
+			_end -= _begin;
+			_begin = 0;
+		}
+		if (_end == _buffer.size() || !_istr.good()) return 0;
+		_istr.read(_buffer.begin() + _end, static_cast<std::streamsize>(_buffer.size() - _end));
+		std::size_t n = static_cast<std::size_t>(_istr.gcount());
+		_end += n;
+		return n;
+	}
+
+	bool ensure(std::size_t n)
+		/// Reads until at least n unprocessed bytes are buffered.
+		/// Returns false if the stream ends before.
+	{
+		while (_end - _begin < n)
+		{
+			if (fill() == 0) return false;
+		}
+		return true;
+	}
+
+	std::size_t search(bool& found) const
+		/// Searches the unprocessed data for the delimiter. If found,
+		/// returns its position. Otherwise, returns the position of
+		/// a partial delimiter at the end of the data, or the end.
+	{
+		const char* begin = _buffer.begin() + _begin;
+		const char* end = _buffer.begin() + _end;
+		const char* delim = _delimiter.data();
+		std::size_t delimLength = _delimiter.size();
+		const char* p = begin;
+		found = false;
+		while (p < end)
+		{
+			const char* q = static_cast<const char*>(std::memchr(p, delim[0], end - p));
+			if (!q) break;
+			std::size_t avail = end - q;
+			if (avail >= delimLength)
+			{
+				if (std::memcmp(q, delim, delimLength) == 0)
+				{
+					found = true;
+					return q - _buffer.begin();
+				}
+			}
+			else if (std::memcmp(q, delim, avail) == 0)
+			{
+				return q - _buffer.begin();
+			}
+			p = q + 1;
+		}
+		return _end;
+	}
+
+	bool nextPart(MultipartPartHeader& header)
+		/// Processes the rest of the boundary line following a delimiter,
+		/// and the header of the next part. Returns false after the close
+		/// delimiter.
+	{
+		if (!ensure(2)) throw MultipartException("Unexpected end of multipart message");
+		if (_buffer[_begin] == '-' && _buffer[_begin + 1] == '-') return false;
+
+		// skip transport padding up to and including CRLF
+		for (;;)
+		{
+			if (!ensure(2)) throw MultipartException("Unexpected end of multipart message");
+			char c = _buffer[_begin];
+			if (c == '\r' && _buffer[_begin + 1] == '\n')
+			{
+				_begin += 2;
+				break;
+			}
+			else if (c == ' ' || c == '\t')
+			{
+				++_begin;
+			}
+			else throw MultipartException("Malformed boundary line");
+		}
+
+		header.clear();
+		std::string name;
+		std::string value;
+		std::size_t headerSize = 0;
+		for (;;)
+		{
+			const char* begin = _buffer.begin() + _begin;
+			const char* eol = static_cast<const char*>(std::memchr(begin, '\n', _end - _begin));
+			if (!eol)
+			{
+				if (_end - _begin > MAX_HEADER_SIZE) throw MultipartException("Part header too long");
+				if (fill() == 0) throw MultipartException("Unexpected end of multipart message");
+				continue;
+			}
+			std::size_t lineLength = eol - begin + 1;
+			headerSize += lineLength;
+			if (headerSize > MAX_HEADER_SIZE) throw MultipartException("Part header too long");
+			const char* lineEnd = eol;
+			if (lineEnd > begin && *(lineEnd - 1) == '\r') --lineEnd;
+			_begin += lineLength;
+			if (lineEnd == begin) break;
+			if (*begin == ' ' || *begin == '\t')
+			{
+				// folded continuation of the previous field
+				if (name.empty()) throw MultipartException("Malformed part header");
+				value.append(begin, lineEnd);
+				continue;
+			}
+			if (!name.empty()) header.add(name, Poco::trim(value));
+			const char* colon = static_cast<const char*>(std::memchr(begin, ':', lineEnd - begin));
+			if (!colon) throw MultipartException("Malformed part header");
+			name.assign(begin, colon);
+			value.assign(colon + 1, lineEnd);
+		}
+		if (!name.empty()) header.add(name, Poco::trim(value));
+		return true;
+	}
+
+private:
+	StreamingMultipartReader(const StreamingMultipartReader&);
+	StreamingMultipartReader& operator = (const StreamingMultipartReader&);
+
+	std::istream& _istr;
+	std::string _delimiter;
+	Poco::Buffer<char> _buffer;
+	std::size_t _begin;
+	std::size_t _end;
+};
+
+
+class SpoolingPartHandler: public MultipartPartHandler
+	/// SpoolingPartHandler stores all parts received from a
+	/// StreamingMultipartReader, keeping the content of each part in
+	/// memory up to a maximum size, and in a temporary file beyond that.
+	/// The temporary files are deleted when the SpoolingPartHandler is
+	/// destroyed.
+{
+public:
+	enum
+	{
+		DEFAULT_MAX_MEMORY_SIZE = 65536
+	};
+
+	class Part
+		/// A part stored by the SpoolingPartHandler.
+	{
+	public:
+		Part():
+			_size(0)
+		{
+		}
+
+		const MultipartPartHeader& header() const
+			/// Returns the header of the part.
+		{
+			return _header;
+		}
+
+		Poco::UInt64 size() const
+			/// Returns the size of the part's content.
+		{
+			return _size;
+		}
+
+		bool inMemory() const
+			/// Returns true if the content is kept in memory.
+		{
+			return _pFile.isNull();
+		}
+
+		const std::string& data() const
+			/// Returns the content, if kept in memory.
+		{
+			return _data;
+		}
+
+		std::string path() const
+			/// Returns the path of the temporary file holding the
+			/// content, or an empty string if kept in memory.
+		{
+			return _pFile ? _pFile->path() : std::string();
+		}
+
+		Poco::SharedPtr<std::istream> open() const
+			/// Returns a stream for reading the content. The part
+			/// must not be destroyed before the stream.
+		{
+			if (_pFile)
+				return new Poco::FileInputStream(_pFile->path());
+			else
+				return new Poco::MemoryInputStream(_data.data(), _data.size());
+		}
+
+	private:
+		MultipartPartHeader _header;
+		std::string _data;
+		Poco::SharedPtr<Poco::TemporaryFile> _pFile;
+		Poco::UInt64 _size;
+
+		friend class SpoolingPartHandler;
+	};
+
+	typedef std::vector<Part> PartVec;
+
+	explicit SpoolingPartHandler(std::size_t maxMemorySize = DEFAULT_MAX_MEMORY_SIZE, Poco::UInt64 maxPartSize = 0, const std::string& tempDir = std::string()):
+		_maxMemorySize(maxMemorySize),
+		_maxPartSize(maxPartSize),
+		_tempDir(tempDir)
+		/// Creates the SpoolingPartHandler. Parts larger than maxMemorySize
+		/// are written to temporary files in the given directory (or the
+		/// default temporary directory). Parts larger than maxPartSize,
+		/// if not zero, are rejected with a MultipartException.
+	{
+	}
+
+	~SpoolingPartHandler()
+		/// Destroys the SpoolingPartHandler and deletes all temporary files.
+	{
+	}
+
+	const PartVec& parts() const
+		/// Returns the parts received so far.
+	{
+		return _parts;
+	}
+
+	void beginPart(const MultipartPartHeader& header)
+	{
+		_parts.push_back(Part());
+		_parts.back()._header = header;
+	}
+
+	void partData(const char* data, std::size_t length)
+	{
+		Part& part = _parts.back();
+		part._size += length;
+		if (_maxPartSize > 0 && part._size > _maxPartSize) throw MultipartException("Part too large", part._header.name());
+		if (!_pStream && part._data.size() + length > _maxMemorySize)
+		{
+			part._pFile = _tempDir.empty() ? new Poco::TemporaryFile : new Poco::TemporaryFile(_tempDir);
+			_pStream = new Poco::FileOutputStream(part._pFile->path());
+			_pStream->write(part._data.data(), static_cast<std::streamsize>(part._data.size()));
+			std::string().swap(part._data);
+		}
+		if (_pStream)
+		{
+			_pStream->write(data, static_cast<std::streamsize>(length));
+			if (!_pStream->good()) throw Poco::WriteFileException(part._pFile->path());
+		}
+		else part._data.append(data, length);
+	}
+
+	void endPart()
+	{
+		if (_pStream)
+		{
+			_pStream->close();
+			_pStream = 0;
+		}
+	}
+
+private:
+	SpoolingPartHandler(const SpoolingPartHandler&);
+	SpoolingPartHandler& operator = (const SpoolingPartHandler&);
+
+	std::size_t _maxMemorySize;
+	Poco::UInt64 _maxPartSize;
+	std::string _tempDir;
+	PartVec _parts;
+	Poco::SharedPtr<Poco::FileOutputStream> _pStream;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_StreamingMultipartReader_INCLUDED
@@ -0,0 +1,417 @@
+//
+// TLSSessionCache.h
+//
+// $Id$
+//
+// Library: NetSSL_OpenSSL
+// Package: SSLCore
+// Module:  TLSSessionCache
+//
+// Definition of the TLSSessionCache class.
+//
+// Copyright (c) 2010-2014, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef NetSSL_TLSSessionCache_INCLUDED
+#define NetSSL_TLSSessionCache_INCLUDED
+
+
+#include "Poco/Net/NetSSL.h"
+#include "Poco/Net/Context.h"
+#include "Poco/Net/Session.h"
+#include "Poco/Net/SecureStreamSocket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/InterfaceBinder.h"
+#include "Poco/SingletonHolder.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <list>
+
+
+namespace Poco {
+namespace Net {
+
+
+class TLSSessionCache
+	/// TLSSessionCache keeps the TLS sessions (including session tickets)
+	/// of client connections, so that new connections to the same server
+	/// can resume a session, instead of doing a full handshake, which saves
+	/// two round trips and the public key operations.
+	///
+	/// Each Context has its own OpenSSL session store, and client session
+	/// caching is disabled by default, so sessions are not reused across
+	/// Context objects, or by code creating a new Context per connection.
+	/// TLSSessionCache holds sessions independently of the Context, keyed
+	/// by server host, port and Context, for a configurable time and up
+	/// to a configurable number of sessions (least recently used sessions
+	/// are removed first). A framework-wide instance is available via
+	/// defaultCache().
+	///
+	/// A Context is identified by a serial number (see contextId()), not
+	/// by its address, which may be reused by a new Context. The Context
+	/// is kept until it is no longer used outside the cache; then it is
+	/// released, and its sessions are removed, with the next put() or
+	/// purge().
+	///
+	/// The easiest way to use the cache is connect(), which creates a
+	/// SecureStreamSocket for a server, resuming a cached session if
+	/// possible, and stores the negotiated session afterwards. With
+	/// TLS 1.3, the session ticket may only be received with the first
+	/// response, so update() should be called again after that.
+	///
+	/// For resumption to work on the server side, the server Context
+	/// must have session caching enabled; see configureServer().
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY = 128,
+		DEFAULT_TTL      = 3600
+	};
+
+	explicit TLSSessionCache(std::size_t capacity = DEFAULT_CAPACITY, const Poco::Timespan& ttl = Poco::Timespan(DEFAULT_TTL, 0)):
+		_capacity(capacity > 0 ? capacity : 1),
+		_ttl(ttl),
+		_hits(0),
+		_misses(0)
+		/// Creates the TLSSessionCache with the given capacity
+		/// and time to live of sessions.
+	{
+	}
+
+	~TLSSessionCache()
+		/// Destroys the TLSSessionCache.
+	{
+	}
+
+	Session::Ptr get(const std::string& key)
+		/// Returns the cached session for the given key,
+		/// or a null pointer if there is none.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		IndexMap::iterator it = _index.find(key);
+		if (it == _index.end() || it->second->stored.isElapsed(_ttl.totalMicroseconds()))
+		{
+			if (it != _index.end())
+			{
+				_lru.erase(it->second);
+				_index.erase(it);
+			}
+			++_misses;
+			return Session::Ptr();
+		}
+		_lru.splice(_lru.begin(), _lru, it->second);
+		++_hits;
+		return it->second->pSession;
+	}
+
+	void put(const std::string& key, Session::Ptr pSession)
+		/// Stores the session for the given key. A null
+		/// pointer removes the key from the cache.
+	{
+		purge();
+		if (!pSession)
+		{
+			remove(key);
+			return;
+		}
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		IndexMap::iterator it = _index.find(key);
+		if (it != _index.end())
+		{
+			it->second->pSession = pSession;
+			it->second->stored.update();
+			_lru.splice(_lru.begin(), _lru, it->second);
+			return;
+		}
+		if (_index.size() >= _capacity)
+		{
+			_index.erase(_lru.back().key);
+			_lru.pop_back();
+		}
+		Entry entry;
+		entry.key = key;
+		entry.contextId = contextIdOf(key);
+		entry.pSession = pSession;
+		_lru.push_front(entry);
+		_index[key] = _lru.begin();
+	}
+
+	void remove(const std::string& key)
+		/// Removes the session for the given key.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		IndexMap::iterator it = _index.find(key);
+		if (it != _index.end())
+		{
+			_lru.erase(it->second);
+			_index.erase(it);
+		}
+	}
+
+	void purge()
+		/// Releases the Context objects no longer used outside the
+		/// cache and removes the sessions of all released Context
+		/// objects from the cache.
+	{
+		std::vector<Poco::UInt64> ids;
+		contexts().releaseUnused(ids);
+		if (ids.empty()) return;
+		std::sort(ids.begin(), ids.end());
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		EntryList::iterator it = _lru.begin();
+		while (it != _lru.end())
+		{
+			if (std::binary_search(ids.begin(), ids.end(), it->contextId))
+			{
+				_index.erase(it->key);
+				it = _lru.erase(it);
+			}
+			else ++it;
+		}
+	}
+
+	void clear()
+		/// Removes all sessions.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_index.clear();
+		_lru.clear();
+	}
+
+	SecureStreamSocket connect(const SocketAddress& address, const std::string& hostName, Context::Ptr pContext, const InterfaceBinder& binder = InterfaceBinder())
+		/// Connects a SecureStreamSocket to the given address, using a
+		/// cached session for hostName and the port, if there is one,
+		/// and stores the negotiated session. The peer certificate is
+		/// verified as configured in the Context.
+		///
+		/// The socket is bound to the network interface of the given
+		/// InterfaceBinder before connecting.
+	{
+		prepare(pContext);
+		std::string k = key(hostName, address.port(), pContext);
+		SecureStreamSocket socket(pContext, get(k));
+		socket.setPeerHostName(hostName);
+		binder.bind(socket, address.family());
+		socket.connect(address);
+		socket.completeHandshake();
+		put(k, socket.currentSession());
+		return socket;
+	}
+
+	void update(const std::string& hostName, Poco::UInt16 port, Context::Ptr pContext, SecureStreamSocket& socket)
+		/// Stores the current session of the given socket.
+	{
+		put(key(hostName, port, pContext), socket.currentSession());
+	}
+
+	static std::string key(const std::string& hostName, Poco::UInt16 port, Context::Ptr pContext)
+		/// Returns the cache key for the given server and Context.
+	{
+		std::string k(hostName);
+		k += ':';
+		Poco::NumberFormatter::append(k, port);
+		k += '#';
+		Poco::NumberFormatter::append(k, contextId(pContext));
+		return k;
+	}
+
+	static Poco::UInt64 contextId(Context::Ptr pContext)
+		/// Returns the serial number identifying the given Context in
+		/// cache keys, or 0 for a null pointer. Serial numbers are never
+		/// reused.
+	{
+		if (!pContext) return 0;
+		return contexts().id(pContext);
+	}
+
+	static void prepare(Context::Ptr pContext)
+		/// Enables client session caching for the given
+		/// Context, which OpenSSL needs to hand out sessions.
+	{
+		if (pContext && !pContext->isForServerUse() && !pContext->sessionCacheEnabled())
+		{
+			pContext->enableSessionCache(true);
+		}
+	}
+
+	void configureServer(Context::Ptr pContext, const std::string& sessionIdContext) const
+		/// Enables session caching for the given server Context, with
+		/// the capacity and time to live of this cache, so that clients
+		/// can resume sessions. Session tickets (stateless resumption)
+		/// are left enabled.
+	{
+		poco_assert (pContext->isForServerUse());
+
+		pContext->enableSessionCache(true, sessionIdContext);
+		pContext->setSessionCacheSize(_capacity);
+		pContext->setSessionTimeout(static_cast<long>(_ttl.totalSeconds()));
+	}
+
+	void setCapacity(std::size_t capacity)
+		/// Sets the maximum number of cached sessions.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_capacity = capacity > 0 ? capacity : 1;
+		while (_index.size() > _capacity)
+		{
+			_index.erase(_lru.back().key);
+			_lru.pop_back();
+		}
+	}
+
+	std::size_t getCapacity() const
+		/// Returns the maximum number of cached sessions.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _capacity;
+	}
+
+	void setTTL(const Poco::Timespan& ttl)
+		/// Sets the time after which a cached session is
+		/// no longer used.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_ttl = ttl;
+	}
+
+	Poco::Timespan getTTL() const
+		/// Returns the time to live of cached sessions.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _ttl;
+	}
+
+	std::size_t size() const
+		/// Returns the number of cached sessions.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _index.size();
+	}
+
+	Poco::UInt64 hits() const
+		/// Returns the number of successful lookups.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _hits;
+	}
+
+	Poco::UInt64 misses() const
+		/// Returns the number of lookups without a usable session.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _misses;
+	}
+
+	static TLSSessionCache& defaultCache()
+		/// Returns the framework-wide TLSSessionCache.
+	{
+		static Poco::SingletonHolder<TLSSessionCache> sh;
+		return *sh.get();
+	}
+
+protected:
+	struct Entry
+	{
+		std::string key;
+		Poco::UInt64 contextId;
+		Session::Ptr pSession;
+		Poco::Timestamp stored;
+	};
+
+	class ContextRegistry
+		/// Assigns serial numbers to Context objects and keeps
+		/// a reference to them, so that their addresses are not
+		/// reused while they have a serial number.
+	{
+	public:
+		ContextRegistry():
+			_next(1)
+		{
+		}
+
+		Poco::UInt64 id(Context::Ptr pContext)
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			ContextMap::iterator it = _contexts.find(pContext.get());
+			if (it != _contexts.end()) return it->second.id;
+			Item& item = _contexts[pContext.get()];
+			item.pContext = pContext;
+			item.id = _next++;
+			return item.id;
+		}
+
+		void releaseUnused(std::vector<Poco::UInt64>& ids)
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			ContextMap::iterator it = _contexts.begin();
+			while (it != _contexts.end())
+			{
+				if (it->second.pContext->referenceCount() == 1)
+				{
+					ids.push_back(it->second.id);
+					_contexts.erase(it++);
+				}
+				else ++it;
+			}
+		}
+
+	private:
+		struct Item
+		{
+			Context::Ptr pContext;
+			Poco::UInt64 id;
+		};
+
+		typedef std::map<const Context*, Item> ContextMap;
+
+		ContextMap _contexts;
+		Poco::UInt64 _next;
+		Poco::FastMutex _mutex;
+	};
+
+	static ContextRegistry& contexts()
+	{
+		static Poco::SingletonHolder<ContextRegistry> sh;
+		return *sh.get();
+	}
+
+	static Poco::UInt64 contextIdOf(const std::string& key)
+	{
+		Poco::UInt64 id = 0;
+		std::string::size_type pos = key.rfind('#');
+		if (pos != std::string::npos) Poco::NumberParser::tryParseUnsigned64(key.substr(pos + 1), id);
+		return id;
+	}
+
+	typedef std::list<Entry> EntryList;
+	typedef std::map<std::string, EntryList::iterator> IndexMap;
+
+private:
+	TLSSessionCache(const TLSSessionCache&);
+	TLSSessionCache& operator = (const TLSSessionCache&);
+
+	std::size_t _capacity;
+	Poco::Timespan _ttl;
+	EntryList _lru;
+	IndexMap _index;
+	Poco::UInt64 _hits;
+	Poco::UInt64 _misses;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // NetSSL_TLSSessionCache_INCLUDED
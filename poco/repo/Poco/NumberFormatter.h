@@ -22,6 +22,7 @@
 
 #include "Poco/Foundation.h"
 #include "Poco/NumericString.h"
+#include <cstring>
 
 
 namespace Poco {
@@ -47,6 +48,7 @@ public:
 
 	static const unsigned NF_MAX_INT_STRING_LEN = 32; // increase for 64-bit binary formatting support
 	static const unsigned NF_MAX_FLT_STRING_LEN = POCO_MAX_FLT_STRING_LEN;
+	static const unsigned NF_MAX_SHORTEST_FLT_STRING_LEN = 40; // enough for "-0.00000000000001" followed by 17 digits
 
 	static std::string format(int value);
 		/// Formats an integer value in decimal notation.
@@ -239,6 +241,49 @@ public:
 		/// Formats a bool value in decimal/text notation,
 		/// according to format parameter.
 
+	static std::size_t format(char* buffer, int value);
+		/// Formats an integer value in decimal notation into the given
+		/// buffer, which must have room for NF_MAX_INT_STRING_LEN characters,
+		/// and returns the number of characters written, not counting
+		/// the terminating zero. No memory is allocated.
+
+	static std::size_t format(char* buffer, unsigned value);
+		/// Formats an unsigned int value in decimal notation into the
+		/// given buffer, like format(char*, int).
+
+	static std::size_t format(char* buffer, long value);
+		/// Formats a long value in decimal notation into the given
+		/// buffer, like format(char*, int).
+
+	static std::size_t format(char* buffer, unsigned long value);
+		/// Formats an unsigned long value in decimal notation into the
+		/// given buffer, like format(char*, int).
+
+#if defined(POCO_HAVE_INT64) && !defined(POCO_LONG_IS_64_BIT)
+
+	static std::size_t format(char* buffer, Int64 value);
+		/// Formats a 64-bit integer value in decimal notation into the
+		/// given buffer, like format(char*, int).
+
+	static std::size_t format(char* buffer, UInt64 value);
+		/// Formats an unsigned 64-bit integer value in decimal notation
+		/// into the given buffer, like format(char*, int).
+
+#endif // defined(POCO_HAVE_INT64) && !defined(POCO_LONG_IS_64_BIT)
+
+	static std::size_t format(char* buffer, float value);
+		/// Formats a float value like format(float), using the shortest
+		/// representation that converts back to the same value, into
+		/// the given buffer, which must have room for
+		/// NF_MAX_SHORTEST_FLT_STRING_LEN characters, and returns the
+		/// number of characters written, not counting the terminating
+		/// zero. No memory is allocated.
+
+	static std::size_t format(char* buffer, double value);
+		/// Formats a double value like format(double), using the shortest
+		/// representation that converts back to the same value, into
+		/// the given buffer, like format(char*, float).
+
 	static void append(std::string& str, int value);
 		/// Formats an integer value in decimal notation.
 
@@ -714,6 +759,74 @@ inline std::string NumberFormatter::format(const void* ptr)
 }
 
 
+inline std::size_t NumberFormatter::format(char* buffer, int value)
+{
+	std::size_t size = NF_MAX_INT_STRING_LEN;
+	intToStr(value, 10, buffer, size);
+	return size;
+}
+
+
+inline std::size_t NumberFormatter::format(char* buffer, unsigned value)
+{
+	std::size_t size = NF_MAX_INT_STRING_LEN;
+	uIntToStr(value, 10, buffer, size);
+	return size;
+}
+
+
+inline std::size_t NumberFormatter::format(char* buffer, long value)
+{
+	std::size_t size = NF_MAX_INT_STRING_LEN;
+	intToStr(value, 10, buffer, size);
+	return size;
+}
+
+
+inline std::size_t NumberFormatter::format(char* buffer, unsigned long value)
+{
+	std::size_t size = NF_MAX_INT_STRING_LEN;
+	uIntToStr(value, 10, buffer, size);
+	return size;
+}
+
+
+#if defined(POCO_HAVE_INT64) && !defined(POCO_LONG_IS_64_BIT)
+
+
+inline std::size_t NumberFormatter::format(char* buffer, Int64 value)
+{
+	std::size_t size = NF_MAX_INT_STRING_LEN;
+	intToStr(value, 10, buffer, size);
+	return size;
+}
+
+
+inline std::size_t NumberFormatter::format(char* buffer, UInt64 value)
+{
+	std::size_t size = NF_MAX_INT_STRING_LEN;
+	uIntToStr(value, 10, buffer, size);
+	return size;
+}
+
+
+#endif // defined(POCO_HAVE_INT64) && !defined(POCO_LONG_IS_64_BIT)
+
+
+inline std::size_t NumberFormatter::format(char* buffer, float value)
+{
+	floatToStr(buffer, NF_MAX_SHORTEST_FLT_STRING_LEN, value);
+	return std::strlen(buffer);
+}
+
+
+inline std::size_t NumberFormatter::format(char* buffer, double value)
+{
+	doubleToStr(buffer, NF_MAX_SHORTEST_FLT_STRING_LEN, value);
+	return std::strlen(buffer);
+}
+
+
 } // namespace Poco
 
 
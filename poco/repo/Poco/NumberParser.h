@@ -21,6 +21,7 @@
 
 
 #include "Poco/Foundation.h"
+#include "Poco/NumericString.h"
 #include <string>
 #undef min
 #undef max
@@ -149,9 +150,85 @@ public:
 		/// Returns true if a valid bool number has been found,
 		/// false otherwise.
 		/// If parsing was not successful, value is undefined.
+
+	static const char* tryParse(const char* first, const char* last, int& value);
+		/// Parses a decimal integer value from the beginning of the
+		/// characters in [first, last), which need not be zero-terminated,
+		/// without allocating memory, like std::from_chars().
+		/// Leading whitespace, a plus sign and thousand separators
+		/// are not accepted.
+		/// Returns a pointer to the first character after the number,
+		/// or a null pointer, leaving value unchanged, if the range
+		/// does not begin with a valid integer.
+
+	static const char* tryParse(const char* first, const char* last, unsigned& value);
+		/// Parses an unsigned decimal integer value from the beginning
+		/// of the characters in [first, last), like tryParse(const char*, const char*, int&).
+
+#if defined(POCO_HAVE_INT64)
+
+	static const char* tryParse(const char* first, const char* last, Int64& value);
+		/// Parses a 64-bit decimal integer value from the beginning
+		/// of the characters in [first, last), like tryParse(const char*, const char*, int&).
+
+	static const char* tryParse(const char* first, const char* last, UInt64& value);
+		/// Parses an unsigned 64-bit decimal integer value from the beginning
+		/// of the characters in [first, last), like tryParse(const char*, const char*, int&).
+
+#endif // defined(POCO_HAVE_INT64)
+
+	static const char* tryParseFloat(const char* first, const char* last, double& value);
+		/// Parses a double value in decimal floating point notation, with
+		/// '.' as decimal separator and without thousand separators, from
+		/// the beginning of the characters in [first, last), which need not
+		/// be zero-terminated, like std::from_chars().
+		/// Returns a pointer to the first character after the number,
+		/// or a null pointer, leaving value unchanged, if the range
+		/// does not begin with a valid floating point number.
 };
 
 
+//
+// inlines
+//
+
+
+inline const char* NumberParser::tryParse(const char* first, const char* last, int& value)
+{
+	return parseDecimal(first, last, value);
+}
+
+
+inline const char* NumberParser::tryParse(const char* first, const char* last, unsigned& value)
+{
+	return parseDecimal(first, last, value);
+}
+
+
+#if defined(POCO_HAVE_INT64)
+
+
+inline const char* NumberParser::tryParse(const char* first, const char* last, Int64& value)
+{
+	return parseDecimal(first, last, value);
+}
+
+
+inline const char* NumberParser::tryParse(const char* first, const char* last, UInt64& value)
+{
+	return parseDecimal(first, last, value);
+}
+
+
+#endif // defined(POCO_HAVE_INT64)
+
+
+inline const char* NumberParser::tryParseFloat(const char* first, const char* last, double& value)
+{
+	return parseDouble(first, last, value);
+}
+
+
 } // namespace Poco
 
 
@@ -0,0 +1,310 @@
+//
+// BootSnapshot.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Bundle
+// Module:  BootSnapshot
+//
+// Definition of the BootSnapshot class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_BootSnapshot_INCLUDED
+#define OSP_BootSnapshot_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/BundleLoader.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Glob.h"
+#include "Poco/FileStream.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class BootSnapshot
+	/// BootSnapshot records the bundles loaded from a bundle repository
+	/// at the end of a boot, so that the next boot can load the same
+	/// bundles without searching the repository.
+	///
+	/// A snapshot contains the repository paths with their modification
+	/// times, and the paths of all loaded bundles, in the order in which
+	/// they were loaded, with their modification times, symbolic names
+	/// and versions. The snapshot is valid as long as no repository
+	/// directory and no bundle has been modified, i.e. as long as no
+	/// bundle has been added, removed or replaced. For bundle
+	/// directories, the modification time of the manifest is also
+	/// checked.
+	///
+	/// restore() loads the bundles with BundleLoader::loadBundle(),
+	/// bypassing the repository scan, the glob expansion and the
+	/// selection of the latest bundle versions by BundleRepository.
+	/// Bundles are resolved and started as usual. Together with a
+	/// CodeCacheIndex, no per-library work is done on a warm boot
+	/// either.
+	///
+	/// Usage example:
+	///
+	///     BootSnapshot snapshot(snapshotPath);
+	///     bool restored = snapshot.isValid(repositoryPaths) && snapshot.restore(loader);
+	///     if (!restored) repository.loadBundles();
+	///     loader.resolveAllBundles();
+	///     if (!restored) snapshot.capture(loader, repositoryPaths);
+{
+public:
+	struct BundleEntry
+	{
+		std::string path;
+		Poco::Timestamp modified;
+		std::string symbolicName;
+		std::string version;
+	};
+
+	typedef std::vector<BundleEntry> Bundles;
+
+	explicit BootSnapshot(const std::string& path):
+		_path(path)
+		/// Creates the BootSnapshot and loads the snapshot
+		/// file with the given path, if it exists.
+	{
+		load();
+	}
+
+	~BootSnapshot()
+		/// Destroys the BootSnapshot.
+	{
+	}
+
+	bool isValid(const std::vector<std::string>& repositoryPaths) const
+		/// Returns true if the snapshot has been taken with the given
+		/// repository paths, and neither the repository nor any of
+		/// the recorded bundles has been modified since.
+	{
+		if (_bundles.empty()) return false;
+
+		Repositories repositories;
+		fingerprint(repositoryPaths, repositories);
+		if (repositories != _repositories) return false;
+		for (Bundles::const_iterator it = _bundles.begin(); it != _bundles.end(); ++it)
+		{
+			Poco::Timestamp modified;
+			if (!modifiedTime(it->path, modified) || modified != it->modified) return false;
+		}
+		return true;
+	}
+
+	bool restore(BundleLoader& loader) const
+		/// Loads the recorded bundles with the given BundleLoader.
+		///
+		/// Returns false, after unloading the bundles loaded so far,
+		/// if a bundle cannot be loaded or is not the recorded one.
+	{
+		std::vector<Bundle::Ptr> loaded;
+		try
+		{
+			for (Bundles::const_iterator it = _bundles.begin(); it != _bundles.end(); ++it)
+			{
+				Bundle::Ptr pBundle = loader.loadBundle(it->path);
+				loaded.push_back(pBundle);
+				if (pBundle->symbolicName() != it->symbolicName || pBundle->version().toString() != it->version)
+				{
+					throw Poco::DataException("Bundle does not match boot snapshot", it->path);
+				}
+			}
+			return true;
+		}
+		catch (Poco::Exception&)
+		{
+			for (std::vector<Bundle::Ptr>::reverse_iterator it = loaded.rbegin(); it != loaded.rend(); ++it)
+			{
+				try
+				{
+					loader.unloadBundle(*it);
+				}
+				catch (Poco::Exception&)
+				{
+				}
+			}
+			return false;
+		}
+	}
+
+	void capture(const BundleLoader& loader, const std::vector<std::string>& repositoryPaths)
+		/// Records the bundles currently loaded by the BundleLoader
+		/// and saves the snapshot.
+	{
+		std::vector<Bundle::Ptr> bundles;
+		loader.listBundles(bundles);
+		std::sort(bundles.begin(), bundles.end(), byId);
+
+		Bundles entries;
+		for (std::vector<Bundle::Ptr>::const_iterator it = bundles.begin(); it != bundles.end(); ++it)
+		{
+			BundleEntry entry;
+			entry.path = (*it)->path();
+			if (entry.path.empty() || !modifiedTime(entry.path, entry.modified)) continue;
+			entry.symbolicName = (*it)->symbolicName();
+			entry.version = (*it)->version().toString();
+			entries.push_back(entry);
+		}
+		Repositories repositories;
+		fingerprint(repositoryPaths, repositories);
+		_bundles.swap(entries);
+		_repositories.swap(repositories);
+		save();
+	}
+
+	void invalidate()
+		/// Removes the snapshot, e.g. after a bundle
+		/// has been installed or uninstalled.
+	{
+		_bundles.clear();
+		_repositories.clear();
+		Poco::File file(_path);
+		if (file.exists()) file.remove();
+	}
+
+	const Bundles& bundles() const
+		/// Returns the recorded bundles.
+	{
+		return _bundles;
+	}
+
+protected:
+	typedef std::vector<std::pair<std::string, Poco::Int64> > Repositories;
+
+	static bool byId(const Bundle::Ptr& p1, const Bundle::Ptr& p2)
+	{
+		return p1->id() < p2->id();
+	}
+
+	static bool modifiedTime(const std::string& path, Poco::Timestamp& modified)
+	{
+		try
+		{
+			Poco::File file(path);
+			modified = file.getLastModified();
+			if (file.isDirectory())
+			{
+				Poco::Path manifestPath(path);
+				manifestPath.makeDirectory();
+				manifestPath.append("META-INF/manifest.mf");
+				Poco::File manifest(manifestPath);
+				if (manifest.exists() && manifest.getLastModified() > modified) modified = manifest.getLastModified();
+			}
+			return true;
+		}
+		catch (Poco::FileException&)
+		{
+			return false;
+		}
+	}
+
+	static void fingerprint(const std::vector<std::string>& repositoryPaths, Repositories& repositories)
+	{
+		for (std::vector<std::string>::const_iterator it = repositoryPaths.begin(); it != repositoryPaths.end(); ++it)
+		{
+			std::set<std::string> paths;
+			if (it->find_first_of("*?[{") != std::string::npos)
+				Poco::Glob::glob(*it, paths);
+			else
+				paths.insert(*it);
+			// The pattern is recorded too, so that adding a
+			// matching directory invalidates the snapshot.
+			repositories.push_back(std::make_pair(*it, static_cast<Poco::Int64>(paths.size())));
+			for (std::set<std::string>::const_iterator itP = paths.begin(); itP != paths.end(); ++itP)
+			{
+				Poco::Timestamp modified(0);
+				modifiedTime(*itP, modified);
+				repositories.push_back(std::make_pair(*itP, modified.epochMicroseconds()));
+			}
+		}
+	}
+
+	void load()
+	{
+		if (!Poco::File(_path).exists()) return;
+
+		Poco::FileInputStream istr(_path);
+		std::string line;
+		if (!std::getline(istr, line) || line != "OSP-BOOT-SNAPSHOT 1") return;
+		while (std::getline(istr, line))
+		{
+			Poco::StringTokenizer tok(line, "\t");
+			Poco::Int64 value;
+			if (tok.count() == 3 && tok[0] == "R" && Poco::NumberParser::tryParse64(tok[2], value))
+			{
+				_repositories.push_back(std::make_pair(tok[1], value));
+			}
+			else if (tok.count() == 5 && tok[0] == "B" && Poco::NumberParser::tryParse64(tok[2], value))
+			{
+				BundleEntry entry;
+				entry.path = tok[1];
+				entry.modified = Poco::Timestamp(value);
+				entry.symbolicName = tok[3];
+				entry.version = tok[4];
+				_bundles.push_back(entry);
+			}
+			else
+			{
+				_bundles.clear();
+				_repositories.clear();
+				return;
+			}
+		}
+	}
+
+	void save() const
+	{
+		std::string tmpPath(_path);
+		tmpPath += ".tmp";
+		{
+			Poco::FileOutputStream ostr(tmpPath);
+			ostr << "OSP-BOOT-SNAPSHOT 1\n";
+			for (Repositories::const_iterator it = _repositories.begin(); it != _repositories.end(); ++it)
+			{
+				ostr << "R\t" << it->first << '\t' << it->second << '\n';
+			}
+			for (Bundles::const_iterator it = _bundles.begin(); it != _bundles.end(); ++it)
+			{
+				ostr << "B\t" << it->path << '\t' << it->modified.epochMicroseconds() << '\t' << it->symbolicName << '\t' << it->version << '\n';
+			}
+			ostr.close();
+			if (!ostr.good()) throw Poco::WriteFileException(tmpPath);
+		}
+		Poco::File(tmpPath).renameTo(_path);
+	}
+
+private:
+	BootSnapshot(const BootSnapshot&);
+	BootSnapshot& operator = (const BootSnapshot&);
+
+	std::string _path;
+	Repositories _repositories;
+	Bundles _bundles;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_BootSnapshot_INCLUDED
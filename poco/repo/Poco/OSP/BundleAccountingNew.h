@@ -0,0 +1,151 @@
+//
+// BundleAccountingNew.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  BundleAccountingNew
+//
+// Replacement of the global operator new for BundleAccounting.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_BundleAccountingNew_INCLUDED
+#define OSP_BundleAccountingNew_INCLUDED
+
+
+//
+// Replaces the global operator new and delete with versions that
+// charge every heap allocation to the bundle of the current thread
+// (see BundleAccounting::recordAllocation()), and allocate with malloc().
+//
+// Must be included in exactly one source file of the executable,
+// e.g. the one containing main(). The replacement applies to the
+// whole process, including the bundle libraries.
+//
+// Allocations by threads not owned by a bundle, and outside of
+// BundleAccounting Scopes, cost a thread-local load and a branch.
+// Aligned allocations (C++17) are not counted.
+//
+
+
+#include "Poco/OSP/BundleAccounting.h"
+#include <new>
+#include <cstdlib>
+
+
+#if __cplusplus >= 201103L
+#define POCO_OSP_ACCOUNTING_THROW
+#define POCO_OSP_ACCOUNTING_NOTHROW noexcept
+#else
+#define POCO_OSP_ACCOUNTING_THROW throw(std::bad_alloc)
+#define POCO_OSP_ACCOUNTING_NOTHROW throw()
+#endif
+
+
+namespace Poco {
+namespace OSP {
+namespace Impl {
+
+
+inline void* accountedAlloc(std::size_t size)
+{
+	Poco::OSP::BundleAccounting::recordAllocation(size);
+	return std::malloc(size ? size : 1);
+}
+
+
+inline void* accountedNew(std::size_t size)
+{
+	for (;;)
+	{
+		void* p = accountedAlloc(size);
+		if (p) return p;
+		std::new_handler handler = std::set_new_handler(0);
+		std::set_new_handler(handler);
+		if (!handler) throw std::bad_alloc();
+		handler();
+	}
+}
+
+
+} } } // namespace Poco::OSP::Impl
+
+
+void* operator new(std::size_t size) POCO_OSP_ACCOUNTING_THROW
+{
+	return Poco::OSP::Impl::accountedNew(size);
+}
+
+
+void* operator new[](std::size_t size) POCO_OSP_ACCOUNTING_THROW
+{
+	return Poco::OSP::Impl::accountedNew(size);
+}
+
+
+void* operator new(std::size_t size, const std::nothrow_t&) POCO_OSP_ACCOUNTING_NOTHROW
+{
+	return Poco::OSP::Impl::accountedAlloc(size);
+}
+
+
+void* operator new[](std::size_t size, const std::nothrow_t&) POCO_OSP_ACCOUNTING_NOTHROW
+{
+	return Poco::OSP::Impl::accountedAlloc(size);
+}
+
+
+void operator delete(void* p) POCO_OSP_ACCOUNTING_NOTHROW
+{
+	std::free(p);
+}
+
+
+void operator delete[](void* p) POCO_OSP_ACCOUNTING_NOTHROW
+{
+	std::free(p);
+}
+
+
+void operator delete(void* p, const std::nothrow_t&) POCO_OSP_ACCOUNTING_NOTHROW
+{
+	std::free(p);
+}
+
+
+void operator delete[](void* p, const std::nothrow_t&) POCO_OSP_ACCOUNTING_NOTHROW
+{
+	std::free(p);
+}
+
+
+#if defined(__cpp_sized_deallocation)
+
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+
+#endif // __cpp_sized_deallocation
+
+
+#undef POCO_OSP_ACCOUNTING_THROW
+#undef POCO_OSP_ACCOUNTING_NOTHROW
+
+
+#endif // OSP_BundleAccountingNew_INCLUDED
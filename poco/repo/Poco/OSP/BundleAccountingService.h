@@ -0,0 +1,282 @@
+//
+// BundleAccountingService.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  BundleAccountingService
+//
+// Definition of the BundleAccountingService class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_BundleAccountingService_INCLUDED
+#define OSP_BundleAccountingService_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/OSP/BundleAccounting.h"
+#include "Poco/OSP/BundleEvents.h"
+#include "Poco/OSP/BundleEvent.h"
+#include "Poco/OSP/SystemEvents.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Delegate.h"
+#include "Poco/Logger.h"
+#include "Poco/Mutex.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class BundleAccountingService: public Service
+	/// The BundleAccountingService gives access to the resources
+	/// used by every bundle, as collected by BundleAccounting.
+	///
+	/// The service charges the start and stop of every bundle,
+	/// i.e. the BundleActivator's start() and stop(), to the bundle,
+	/// and takes a snapshot of the usage when the system has
+	/// started (SystemEvents::systemStarted), which is passed
+	/// to the startupCompleted event. When the system shuts down
+	/// (SystemEvents::systemShuttingDown), the usage of all bundles
+	/// is written to the logger "osp.core.bundleaccounting".
+	///
+	/// To charge the start of all bundles, the service must be created
+	/// before the bundles are started, e.g. in a subclass of OSPSubsystem:
+	///
+	///     void startBundles(Poco::Util::Application& app)
+	///     {
+	///         _pAccounting = new BundleAccountingService(bundleLoader().events(), systemEvents());
+	///         serviceRegistry().registerService(BundleAccountingService::serviceName(), _pAccounting, Properties());
+	///         OSPSubsystem::startBundles(app);
+	///     }
+	///
+	/// Both the BundleEvents and the SystemEvents must outlive the
+	/// BundleAccountingService.
+{
+public:
+	typedef Poco::AutoPtr<BundleAccountingService> Ptr;
+
+	static const std::string& serviceName()
+		/// Returns the name under which the service
+		/// should be registered.
+	{
+		static const std::string name("osp.core.bundleaccounting");
+		return name;
+	}
+
+	Poco::BasicEvent<const BundleAccounting::UsageVec> startupCompleted;
+		/// Fired after the system has started, with the
+		/// usage of all bundles up to then.
+
+	BundleAccountingService(BundleEvents& events, SystemEvents& systemEvents):
+		_events(events),
+		_systemEvents(systemEvents)
+		/// Creates the BundleAccountingService, which subscribes
+		/// to the given BundleEvents and SystemEvents.
+	{
+		_events.bundleStarting += Poco::delegate(this, &BundleAccountingService::onBundleStarting);
+		_events.bundleStarted += Poco::delegate(this, &BundleAccountingService::onBundleStarted);
+		_events.bundleFailed += Poco::delegate(this, &BundleAccountingService::onBundleFailed);
+		_events.bundleStopping += Poco::delegate(this, &BundleAccountingService::onBundleStopping);
+		_events.bundleStopped += Poco::delegate(this, &BundleAccountingService::onBundleStopped);
+		_systemEvents.systemStarted += Poco::delegate(this, &BundleAccountingService::onSystemStarted);
+		_systemEvents.systemShuttingDown += Poco::delegate(this, &BundleAccountingService::onSystemShuttingDown);
+	}
+
+	void usage(BundleAccounting::UsageVec& usage) const
+		/// Appends the current usage of all bundles.
+	{
+		BundleAccounting::instance().usage(usage);
+	}
+
+	bool usage(const std::string& symbolicName, BundleAccounting::Usage& usage) const
+		/// Copies the current usage of the given bundle and returns
+		/// true, or returns false if nothing has been charged to it.
+	{
+		BundleAccounting::UsageVec all;
+		BundleAccounting::instance().usage(all);
+		for (BundleAccounting::UsageVec::const_iterator it = all.begin(); it != all.end(); ++it)
+		{
+			if (it->bundle == symbolicName)
+			{
+				usage = *it;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void top(std::size_t count, BundleAccounting::UsageVec& usage) const
+		/// Appends the usage of at most count bundles,
+		/// in descending order of CPU time.
+	{
+		BundleAccounting::UsageVec all;
+		BundleAccounting::instance().usage(all);
+		std::sort(all.begin(), all.end(), moreCpuTime);
+		if (all.size() > count) all.resize(count);
+		usage.insert(usage.end(), all.begin(), all.end());
+	}
+
+	void startupUsage(BundleAccounting::UsageVec& usage) const
+		/// Appends the usage of all bundles at the time the
+		/// system had started, or nothing if it has not yet.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		usage.insert(usage.end(), _startup.begin(), _startup.end());
+	}
+
+	void dump(std::ostream& ostr) const
+		/// Writes the current usage of all bundles, in descending
+		/// order of CPU time, one bundle per line.
+	{
+		BundleAccounting::UsageVec usage;
+		top(static_cast<std::size_t>(-1), usage);
+		BundleAccounting::dump(usage, ostr);
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(BundleAccountingService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(BundleAccountingService), otherType) || Service::isA(otherType);
+	}
+
+protected:
+	~BundleAccountingService()
+	{
+		try
+		{
+			_systemEvents.systemShuttingDown -= Poco::delegate(this, &BundleAccountingService::onSystemShuttingDown);
+			_systemEvents.systemStarted -= Poco::delegate(this, &BundleAccountingService::onSystemStarted);
+			_events.bundleStopped -= Poco::delegate(this, &BundleAccountingService::onBundleStopped);
+			_events.bundleStopping -= Poco::delegate(this, &BundleAccountingService::onBundleStopping);
+			_events.bundleFailed -= Poco::delegate(this, &BundleAccountingService::onBundleFailed);
+			_events.bundleStarted -= Poco::delegate(this, &BundleAccountingService::onBundleStarted);
+			_events.bundleStarting -= Poco::delegate(this, &BundleAccountingService::onBundleStarting);
+			for (ScopeMap::iterator it = _scopes.begin(); it != _scopes.end(); ++it)
+			{
+				delete it->second;
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void onBundleStarting(const void*, BundleEvent& ev)
+	{
+		begin(ev);
+	}
+
+	void onBundleStarted(const void*, BundleEvent& ev)
+	{
+		end(ev);
+	}
+
+	void onBundleFailed(const void*, BundleEvent& ev)
+	{
+		end(ev);
+	}
+
+	void onBundleStopping(const void*, BundleEvent& ev)
+	{
+		begin(ev);
+	}
+
+	void onBundleStopped(const void*, BundleEvent& ev)
+	{
+		end(ev);
+	}
+
+	void onSystemStarted(const void*, SystemEvents::EventKind&)
+	{
+		BundleAccounting::UsageVec usage;
+		BundleAccounting::instance().usage(usage);
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_startup = usage;
+		}
+		startupCompleted(this, usage);
+	}
+
+	void onSystemShuttingDown(const void*, SystemEvents::EventKind&)
+	{
+		Poco::Logger& logger = Poco::Logger::get("osp.core.bundleaccounting");
+		if (logger.information())
+		{
+			std::ostringstream ostr;
+			dump(ostr);
+			logger.information("Resources used by bundles:\n" + ostr.str());
+		}
+	}
+
+private:
+	typedef std::map<int, BundleAccounting::Scope*> ScopeMap;
+
+	void begin(BundleEvent& ev)
+		/// Opens a Scope for the bundle, which is closed by the
+		/// matching end(), called in the same thread.
+	{
+		BundleAccounting::Scope* pScope = new BundleAccounting::Scope(BundleAccounting::instance().account(*ev.bundle()));
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			BundleAccounting::Scope*& pEntry = _scopes[ev.bundle()->id()];
+			if (!pEntry)
+			{
+				pEntry = pScope;
+				return;
+			}
+		}
+		// already open, e.g. if the bundleStarted event has been missed
+		delete pScope;
+	}
+
+	void end(BundleEvent& ev)
+	{
+		BundleAccounting::Scope* pScope = 0;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			ScopeMap::iterator it = _scopes.find(ev.bundle()->id());
+			if (it == _scopes.end()) return;
+			pScope = it->second;
+			_scopes.erase(it);
+		}
+		delete pScope;
+	}
+
+	static bool moreCpuTime(const BundleAccounting::Usage& a, const BundleAccounting::Usage& b)
+	{
+		return a.cpuTime > b.cpuTime;
+	}
+
+	BundleAccountingService(const BundleAccountingService&);
+	BundleAccountingService& operator = (const BundleAccountingService&);
+
+	BundleEvents& _events;
+	SystemEvents& _systemEvents;
+	ScopeMap _scopes;
+	BundleAccounting::UsageVec _startup;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_BundleAccountingService_INCLUDED
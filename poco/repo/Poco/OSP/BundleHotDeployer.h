@@ -0,0 +1,256 @@
+//
+// BundleHotDeployer.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Bundle
+// Module:  BundleHotDeployer
+//
+// Definition of the BundleHotDeployer class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_BundleHotDeployer_INCLUDED
+#define OSP_BundleHotDeployer_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/BundleRepository.h"
+#include "Poco/OSP/BundleLoader.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/RecursiveDirectoryWatcher.h"
+#include "Poco/Delegate.h"
+#include "Poco/Path.h"
+#include "Poco/File.h"
+#include "Poco/Logger.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <set>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class BundleHotDeployer
+	/// BundleHotDeployer deploys bundles that are added to, replaced
+	/// in or removed from the directories of a BundleRepository while
+	/// the application is running.
+	///
+	/// Every repository directory is watched with a
+	/// RecursiveDirectoryWatcher, i.e. with inotify on Linux, without
+	/// periodically scanning the repository. Changes within bundle
+	/// directories are attributed to the bundle directory, and changes
+	/// are coalesced, so that a bundle that is being copied into the
+	/// repository is only deployed once the copy has been quiet for
+	/// the coalesce interval.
+	///
+	/// For every changed bundle file or bundle directory
+	/// ("*.bndl") directly in a repository directory:
+	///   * if it has been removed, the bundle loaded from it
+	///     is stopped and unloaded;
+	///   * otherwise, the bundle is created from it. If the bundle
+	///     or a bundle with the same symbolic name but an older version
+	///     is loaded, that bundle is stopped and unloaded first. The new
+	///     bundle is then loaded, resolved and started.
+	///
+	/// Repository paths containing Glob expressions, and paths that
+	/// reference a bundle directly, are not watched.
+	///
+	/// Errors are logged to the Logger "osp.core.BundleHotDeployer".
+	///
+	/// Usage example:
+	///
+	///     repository.loadBundles();
+	///     loader.resolveAllBundles();
+	///     loader.startAllBundles();
+	///     BundleHotDeployer hotDeployer(repository, loader);
+{
+public:
+	enum
+	{
+		DEFAULT_COALESCE_INTERVAL = 1000
+			/// Default coalesce interval in milliseconds.
+	};
+
+	BundleHotDeployer(BundleRepository& repository, BundleLoader& loader, long coalesceInterval = DEFAULT_COALESCE_INTERVAL):
+		_loader(loader),
+		_logger(Poco::Logger::get("osp.core.BundleHotDeployer"))
+		/// Creates the BundleHotDeployer and starts watching
+		/// the directories of the given repository.
+	{
+		const std::vector<std::string>& paths = repository.paths();
+		for (std::vector<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it)
+		{
+			if (it->find_first_of("*?[{") != std::string::npos) continue;
+			Poco::Path p(*it);
+			p.makeDirectory();
+			if (p.toString().size() > 1 && isBundlePath(p.toString().substr(0, p.toString().size() - 1))) continue;
+			Poco::File dir(p);
+			if (!dir.exists() || !dir.isDirectory()) continue;
+
+			try
+			{
+				Poco::RecursiveDirectoryWatcher* pWatcher = new Poco::RecursiveDirectoryWatcher(p.toString(), Poco::RecursiveDirectoryWatcher::ITEM_ALL, coalesceInterval);
+				_watchers.push_back(pWatcher);
+				pWatcher->changed += Poco::delegate(this, &BundleHotDeployer::onChanged);
+				pWatcher->scanError += Poco::delegate(this, &BundleHotDeployer::onScanError);
+			}
+			catch (Poco::Exception& exc)
+			{
+				_logger.error("Cannot watch bundle repository " + p.toString() + ": " + exc.displayText());
+			}
+		}
+	}
+
+	~BundleHotDeployer()
+		/// Stops watching and destroys the BundleHotDeployer.
+	{
+		for (std::vector<Poco::RecursiveDirectoryWatcher*>::iterator it = _watchers.begin(); it != _watchers.end(); ++it)
+		{
+			delete *it;
+		}
+	}
+
+	std::size_t watchedDirectories() const
+		/// Returns the number of repository directories watched.
+	{
+		return _watchers.size();
+	}
+
+protected:
+	void onChanged(const void* pSender, const Poco::RecursiveDirectoryWatcher::Changes& changes)
+	{
+		const std::string& root = static_cast<const Poco::RecursiveDirectoryWatcher*>(pSender)->directory();
+		std::set<std::string> bundlePaths;
+		for (Poco::RecursiveDirectoryWatcher::Changes::const_iterator it = changes.begin(); it != changes.end(); ++it)
+		{
+			if (it->path.compare(0, root.size(), root) != 0) continue;
+			std::string::size_type end = it->path.find(Poco::Path::separator(), root.size());
+			std::string path(it->path, 0, end);
+			if (isBundlePath(path)) bundlePaths.insert(path);
+		}
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (std::set<std::string>::const_iterator it = bundlePaths.begin(); it != bundlePaths.end(); ++it)
+		{
+			try
+			{
+				deploy(*it);
+			}
+			catch (Poco::Exception& exc)
+			{
+				_logger.error("Cannot deploy bundle " + *it + ": " + exc.displayText());
+			}
+		}
+	}
+
+	void onScanError(const void*, const Poco::Exception& exc)
+	{
+		_logger.error("Error watching bundle repository: " + exc.displayText());
+	}
+
+	void deploy(const std::string& path)
+		/// Deploys, redeploys or removes the bundle at the given path.
+	{
+		Bundle::Ptr pOld = findByPath(normalize(path));
+		if (!Poco::File(path).exists())
+		{
+			if (pOld)
+			{
+				_logger.information("Removing bundle " + pOld->symbolicName() + " (" + path + ").");
+				remove(pOld);
+			}
+			return;
+		}
+
+		Bundle::Ptr pNew = _loader.createBundle(path);
+		if (!pOld) pOld = findBySymbolicName(pNew->symbolicName());
+		if (pOld)
+		{
+			if (normalize(pOld->path()) != normalize(pNew->path()) && pNew->version() < pOld->version())
+			{
+				_logger.warning("Not deploying bundle " + pNew->symbolicName() + " " + pNew->version().toString() + " (" + path + "), since version " + pOld->version().toString() + " is loaded.");
+				return;
+			}
+			_logger.information("Replacing bundle " + pOld->symbolicName() + " " + pOld->version().toString() + " with version " + pNew->version().toString() + " (" + path + ").");
+			remove(pOld);
+		}
+		else
+		{
+			_logger.information("Deploying bundle " + pNew->symbolicName() + " " + pNew->version().toString() + " (" + path + ").");
+		}
+		_loader.loadBundle(pNew);
+		pNew->resolve();
+		pNew->start();
+	}
+
+	void remove(Bundle::Ptr pBundle)
+		/// Stops and unloads the given bundle.
+	{
+		if (pBundle->isActive()) pBundle->stop();
+		_loader.unloadBundle(pBundle);
+	}
+
+	Bundle::Ptr findByPath(const std::string& path) const
+	{
+		std::vector<Bundle::Ptr> bundles;
+		_loader.listBundles(bundles);
+		for (std::vector<Bundle::Ptr>::const_iterator it = bundles.begin(); it != bundles.end(); ++it)
+		{
+			if (normalize((*it)->path()) == path) return *it;
+		}
+		return Bundle::Ptr();
+	}
+
+	Bundle::Ptr findBySymbolicName(const std::string& symbolicName) const
+	{
+		std::vector<Bundle::Ptr> bundles;
+		_loader.listBundles(bundles);
+		for (std::vector<Bundle::Ptr>::const_iterator it = bundles.begin(); it != bundles.end(); ++it)
+		{
+			if ((*it)->symbolicName() == symbolicName) return *it;
+		}
+		return Bundle::Ptr();
+	}
+
+	static bool isBundlePath(const std::string& path)
+	{
+		static const std::string EXTENSION(".bndl");
+		return path.size() > EXTENSION.size() && path.compare(path.size() - EXTENSION.size(), EXTENSION.size(), EXTENSION) == 0;
+	}
+
+	static std::string normalize(const std::string& path)
+		/// Returns the absolute path, without a trailing
+		/// separator for bundle directories.
+	{
+		std::string result(Poco::Path(path).absolute().toString());
+		if (result.size() > 1 && result[result.size() - 1] == Poco::Path::separator())
+			result.resize(result.size() - 1);
+		return result;
+	}
+
+private:
+	BundleHotDeployer();
+	BundleHotDeployer(const BundleHotDeployer&);
+	BundleHotDeployer& operator = (const BundleHotDeployer&);
+
+	BundleLoader& _loader;
+	Poco::Logger& _logger;
+	std::vector<Poco::RecursiveDirectoryWatcher*> _watchers;
+	Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_BundleHotDeployer_INCLUDED
@@ -0,0 +1,464 @@
+//
+// CodeCacheIndex.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  CodeCacheIndex
+//
+// Definition of the CodeCacheIndex class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_CodeCacheIndex_INCLUDED
+#define OSP_CodeCacheIndex_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/CodeCache.h"
+#include "Poco/OSP/BundleStorage.h"
+#include "Poco/OSP/BundleDirectory.h"
+#include "Poco/OSP/MappedBundleFile.h"
+#include "Poco/OSP/LibraryPreloader.h"
+#include "Poco/SharedLibrary.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/SHA256Engine.h"
+#include "Poco/DigestBatch.h"
+#include "Poco/DigestStream.h"
+#include "Poco/DigestEngine.h"
+#include "Poco/HexBinary.h"
+#include "Poco/FileStream.h"
+#include "Poco/MappedFile.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Mutex.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Timestamp.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+#include <cstring>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class CodeCacheIndex
+	/// CodeCacheIndex keeps a persistent index of the libraries in a
+	/// CodeCache, with their timestamps and content hashes, so that
+	/// the code cache can be brought up to date with the libraries of
+	/// all bundles without a lookup, lock and stat per library.
+	///
+	/// The index is loaded from the file codecache.index in the cache
+	/// directory, and validated in bulk with a single pass over the
+	/// directory: libraries no longer present are removed from the
+	/// index. synchronize() compares the libraries of the given
+	/// bundles with the index, installs the changed libraries on
+	/// several threads, and saves the index.
+	///
+	/// To use the index, create the BundleLoader with
+	/// autoUpdateCodeCache set to false, and synchronize the code cache
+	/// before resolving the bundles:
+	///
+	///     CodeCacheIndex index(codeCache, loader.osName(), loader.osArchitecture());
+	///     index.synchronize(bundlePaths);
+	///     loader.resolveAllBundles();
+	///
+	/// verify() checks the content of all libraries in the code cache
+	/// against the index, hashing the libraries on several threads.
+	///
+	/// The index also records the dependencies of every library, so
+	/// that preload() can hand the libraries to a LibraryPreloader,
+	/// which loads them in dependency order before the bundles are
+	/// resolved.
+	///
+	/// Libraries are installed with CodeCache::installLibrary(), so
+	/// that the locking of a shared code cache still applies. The
+	/// index itself must not be shared by processes running
+	/// synchronize() at the same time.
+	///
+	/// CodeCacheIndex is thread-safe.
+{
+public:
+	struct Library
+	{
+		Library():
+			size(0)
+		{
+		}
+
+		Poco::Timestamp timestamp;
+			/// The last modification time of the library in the bundle.
+		Poco::UInt64 size;
+		std::string hash;
+			/// The SHA-256 digest of the library, as hex string.
+		std::vector<std::string> needed;
+			/// The libraries the library depends on (DT_NEEDED),
+			/// used by preload() to order the libraries.
+	};
+
+	enum
+	{
+		DEFAULT_THREADS = 4
+	};
+
+	CodeCacheIndex(CodeCache& codeCache, const std::string& osName, const std::string& osArch):
+		_codeCache(codeCache),
+		_osName(osName),
+		_osArch(osArch),
+		_modified(false)
+		/// Creates the CodeCacheIndex for the given CodeCache, and for
+		/// the libraries of the given operating system and architecture.
+	{
+		Poco::Path dir(_codeCache.pathFor("", false));
+		dir.makeDirectory();
+		_dir = dir.toString();
+		_indexPath = _dir + "codecache.index";
+		load();
+		validate();
+	}
+
+	~CodeCacheIndex()
+		/// Destroys the CodeCacheIndex.
+	{
+	}
+
+	bool hasLibrary(const std::string& name) const
+		/// Returns true if the library with the given name,
+		/// without extension, is in the index.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _libraries.find(name) != _libraries.end();
+	}
+
+	bool library(const std::string& name, Library& library) const
+		/// Copies the index entry of the library with the given name
+		/// and returns true, or returns false if the library is not
+		/// in the index.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		LibraryMap::const_iterator it = _libraries.find(name);
+		if (it == _libraries.end()) return false;
+		library = it->second;
+		return true;
+	}
+
+	void preload(LibraryPreloader& preloader) const
+		/// Adds all libraries in the index, with the dependencies
+		/// recorded in the index, to the given LibraryPreloader,
+		/// so that they can be loaded without reading the library
+		/// files for their dependencies.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (LibraryMap::const_iterator it = _libraries.begin(); it != _libraries.end(); ++it)
+		{
+			preloader.add(_codeCache.pathFor(it->first), it->second.needed);
+		}
+	}
+
+	std::size_t synchronize(const std::vector<std::string>& bundlePaths, int threads = DEFAULT_THREADS)
+		/// Installs the libraries of the bundles with the given paths
+		/// whose timestamps differ from the index, on up to the given
+		/// number of threads, and saves the index.
+		///
+		/// Returns the number of libraries installed.
+		///
+		/// If a library cannot be installed, the other libraries are
+		/// still installed, and a Poco::IOException with the message of
+		/// the first failure is thrown after the index has been saved.
+	{
+		_jobs.clear();
+		_failed.clear();
+		for (std::vector<std::string>::const_iterator it = bundlePaths.begin(); it != bundlePaths.end(); ++it)
+		{
+			addJobs(*it);
+		}
+		std::size_t installed = _jobs.size();
+		if (installed > 0)
+		{
+			Worker worker(*this);
+			std::vector<Poco::Thread*> workers;
+			int n = static_cast<int>(_jobs.size()) < threads ? static_cast<int>(_jobs.size()) : threads;
+			for (int i = 1; i < n; ++i)
+			{
+				Poco::Thread* pThread = new Poco::Thread("OSP.CodeCache");
+				workers.push_back(pThread);
+				pThread->start(worker);
+			}
+			work();
+			for (std::vector<Poco::Thread*>::iterator it = workers.begin(); it != workers.end(); ++it)
+			{
+				(*it)->join();
+				delete *it;
+			}
+		}
+		save();
+		if (!_failed.empty()) throw Poco::IOException("Cannot install library", _failed);
+		return installed;
+	}
+
+	std::vector<std::string> verify(int threads = DEFAULT_THREADS)
+		/// Computes the SHA-256 digests of all libraries in the index,
+		/// on up to the given number of threads, and removes the libraries
+		/// that cannot be read, or whose digest does not match the index,
+		/// from the index, so that synchronize() installs them again.
+		///
+		/// Returns the names of the removed libraries.
+	{
+		std::vector<std::string> names;
+		Poco::DigestBatch<Poco::SHA256Engine> batch;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (LibraryMap::const_iterator it = _libraries.begin(); it != _libraries.end(); ++it)
+			{
+				names.push_back(it->first);
+				batch.add(_codeCache.pathFor(it->first));
+			}
+		}
+		batch.compute(threads);
+
+		std::vector<std::string> removed;
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (std::size_t i = 0; i < names.size(); ++i)
+		{
+			LibraryMap::iterator it = _libraries.find(names[i]);
+			if (it == _libraries.end()) continue;
+			if (!batch.succeeded(i) || Poco::HexBinary::encode(batch.digest(i)) != it->second.hash)
+			{
+				_libraries.erase(it);
+				_modified = true;
+				removed.push_back(names[i]);
+			}
+		}
+		return removed;
+	}
+
+	void save()
+		/// Writes the index file, if the index has been modified.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (!_modified) return;
+
+		std::string tmpPath(_indexPath);
+		tmpPath += ".tmp";
+		{
+			Poco::FileOutputStream ostr(tmpPath);
+			for (LibraryMap::const_iterator it = _libraries.begin(); it != _libraries.end(); ++it)
+			{
+				ostr << it->first << '\t' << it->second.timestamp.epochMicroseconds() << '\t' << it->second.size << '\t' << it->second.hash << '\t';
+				const std::vector<std::string>& needed = it->second.needed;
+				if (needed.empty()) ostr << '-';
+				for (std::vector<std::string>::const_iterator itN = needed.begin(); itN != needed.end(); ++itN)
+				{
+					if (itN != needed.begin()) ostr << ',';
+					ostr << *itN;
+				}
+				ostr << '\n';
+			}
+			ostr.close();
+			if (!ostr.good()) throw Poco::WriteFileException(tmpPath);
+		}
+		Poco::File(tmpPath).renameTo(_indexPath);
+		_modified = false;
+	}
+
+protected:
+	typedef std::map<std::string, Library> LibraryMap;
+
+	struct Job
+	{
+		BundleStorage::Ptr pStorage;
+		std::string resource;
+		std::string name;
+		Poco::Timestamp timestamp;
+	};
+
+	class Worker: public Poco::Runnable
+	{
+	public:
+		explicit Worker(CodeCacheIndex& index):
+			_index(index)
+		{
+		}
+
+		void run()
+		{
+			_index.work();
+		}
+
+	private:
+		CodeCacheIndex& _index;
+	};
+
+	void load()
+	{
+		if (!Poco::File(_indexPath).exists()) return;
+
+		Poco::MappedFile index(_indexPath, Poco::MappedFile::ADVICE_SEQUENTIAL);
+		const char* it = index.begin();
+		const char* end = index.end();
+		std::string line;
+		while (it != end)
+		{
+			const char* eol = static_cast<const char*>(std::memchr(it, '\n', end - it));
+			if (!eol) eol = end;
+			line.assign(it, eol);
+			it = eol == end ? end : eol + 1;
+			Poco::StringTokenizer tok(line, "\t");
+			Poco::Int64 ts;
+			Poco::UInt64 size;
+			if (tok.count() < 4 || tok.count() > 5 || !Poco::NumberParser::tryParse64(tok[1], ts) || !Poco::NumberParser::tryParseUnsigned64(tok[2], size)) continue;
+			// entries with a SHA1 digest, written by earlier versions, are installed again
+			if (tok[3].size() != 2*Poco::SHA256Engine::DIGEST_SIZE) continue;
+			Library& library = _libraries[tok[0]];
+			library.timestamp = Poco::Timestamp(ts);
+			library.size = size;
+			library.hash = tok[3];
+			if (tok.count() == 5)
+			{
+				if (tok[4] != "-")
+				{
+					Poco::StringTokenizer names(tok[4], ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+					library.needed.assign(names.begin(), names.end());
+				}
+			}
+			else
+			{
+				// entries written by earlier versions have no dependencies
+				LibraryPreloader::readNeeded(_codeCache.pathFor(tok[0]), library.needed);
+				_modified = true;
+			}
+		}
+	}
+
+	void validate()
+	{
+		std::set<std::string> files;
+		Poco::DirectoryIterator end;
+		for (Poco::DirectoryIterator it(_dir); it != end; ++it)
+		{
+			files.insert(it.name());
+		}
+		LibraryMap::iterator it = _libraries.begin();
+		while (it != _libraries.end())
+		{
+			if (files.find(Poco::Path(_codeCache.pathFor(it->first)).getFileName()) == files.end())
+			{
+				_libraries.erase(it++);
+				_modified = true;
+			}
+			else ++it;
+		}
+	}
+
+	void addJobs(const std::string& bundlePath)
+	{
+		BundleStorage::Ptr pStorage;
+		if (Poco::File(bundlePath).isDirectory())
+			pStorage = new BundleDirectory(bundlePath);
+		else
+			pStorage = new MappedBundleFile(bundlePath);
+
+		std::string binPath("bin/");
+		binPath += _osName;
+		binPath += '/';
+		binPath += _osArch;
+		binPath += '/';
+		std::vector<std::string> files;
+		pStorage->list(binPath, files);
+		const std::string suffix = Poco::SharedLibrary::suffix();
+		for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it)
+		{
+			if (it->size() <= suffix.size() || it->compare(it->size() - suffix.size(), suffix.size(), suffix) != 0) continue;
+
+			Job job;
+			job.pStorage = pStorage;
+			job.resource = binPath + *it;
+			job.name = Poco::Path(*it).getBaseName();
+			job.timestamp = pStorage->lastModified(job.resource);
+			LibraryMap::const_iterator itL = _libraries.find(job.name);
+			if (itL == _libraries.end() || itL->second.timestamp != job.timestamp)
+			{
+				_jobs.push_back(job);
+			}
+		}
+	}
+
+	void work()
+	{
+		for (;;)
+		{
+			Job job;
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				if (_jobs.empty()) return;
+				job = _jobs.back();
+				_jobs.pop_back();
+			}
+			try
+			{
+				install(job);
+			}
+			catch (Poco::Exception& exc)
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				if (_failed.empty()) _failed = exc.displayText();
+			}
+		}
+	}
+
+	void install(const Job& job)
+	{
+		Poco::SharedPtr<std::istream> pStream(job.pStorage->getResource(job.resource));
+		if (!pStream) throw Poco::NotFoundException(job.resource);
+
+		Poco::SHA256Engine sha256;
+		Poco::DigestInputStream istr(sha256, *pStream);
+		_codeCache.installLibrary(job.name, istr);
+		Poco::File file(_codeCache.pathFor(job.name));
+		file.setLastModified(job.timestamp);
+
+		Library library;
+		library.timestamp = job.timestamp;
+		library.size = file.getSize();
+		library.hash = Poco::HexBinary::encode(sha256.digest());
+		LibraryPreloader::readNeeded(_codeCache.pathFor(job.name), library.needed);
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_libraries[job.name] = library;
+		_modified = true;
+	}
+
+private:
+	CodeCacheIndex(const CodeCacheIndex&);
+	CodeCacheIndex& operator = (const CodeCacheIndex&);
+
+	CodeCache& _codeCache;
+	std::string _osName;
+	std::string _osArch;
+	std::string _dir;
+	std::string _indexPath;
+	LibraryMap _libraries;
+	std::vector<Job> _jobs;
+	std::string _failed;
+	bool _modified;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_CodeCacheIndex_INCLUDED
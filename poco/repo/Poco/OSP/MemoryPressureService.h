@@ -0,0 +1,194 @@
+//
+// MemoryPressureService.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  MemoryPressureService
+//
+// Definition of the MemoryPressureService class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_MemoryPressureService_INCLUDED
+#define OSP_MemoryPressureService_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/MemoryPressure.h"
+#include "Poco/MemoryPressureMonitor.h"
+#include "Poco/PooledBufferAllocator.h"
+#include "Poco/ZStreamPool.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Delegate.h"
+#include <vector>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class MemoryPressureService: public Service
+	/// The MemoryPressureService watches the memory pressure of the
+	/// system, or of the cgroup of the process, with a MemoryPressureMonitor,
+	/// and broadcasts every change with the memoryPressure event, so that
+	/// bundles can shrink their caches and pools before the kernel's
+	/// out-of-memory killer ends the process.
+	///
+	/// Caches and pools are added, with a priority, to the registry of the
+	/// service (by default, the MemoryPressureRegistry::defaultRegistry()), and
+	/// are shrunk in the order of their priorities: caches first, then pools
+	/// of idle objects, then pooled buffers. The service adds the shared
+	/// pools of the framework (BufferPagePool::defaultPool() and the shared
+	/// ZStreamPool objects) itself; the TemplateCacheService adds its
+	/// template cache.
+	///
+	/// The service is created and started by the application:
+	///
+	///     MemoryPressureService::Ptr pService = new MemoryPressureService;
+	///     pService->start(Poco::MemoryPressureMonitor::cgroupPressureFile());
+	///     pContext->registry().registerService(MemoryPressureService::serviceName(), pService, Properties());
+	///
+	/// and used by bundles:
+	///
+	///     MemoryPressureService::Ptr pService = ServiceFinder::findByName<MemoryPressureService>(pContext, MemoryPressureService::serviceName());
+	///     pService->addHandler(new Poco::CacheMemoryPressureHandler<SessionCache>(_cache), Poco::MemoryPressureRegistry::PRIO_CACHES);
+{
+public:
+	typedef Poco::AutoPtr<MemoryPressureService> Ptr;
+
+	static const std::string& serviceName()
+		/// Returns the name under which the service
+		/// should be registered.
+	{
+		static const std::string name("osp.core.memorypressure");
+		return name;
+	}
+
+	Poco::BasicEvent<const Poco::MemoryPressure::Level> memoryPressure;
+		/// Fired after the handlers have been called, whenever memory
+		/// pressure is reported, and when the pressure is over.
+
+	explicit MemoryPressureService(Poco::MemoryPressureRegistry& registry = Poco::MemoryPressureRegistry::defaultRegistry()):
+		_registry(registry),
+		_monitor(registry)
+		/// Creates the MemoryPressureService, which reports to the
+		/// given registry, and adds the shared pools of the framework
+		/// to the registry.
+	{
+		addFrameworkHandler(new Poco::TrimMemoryPressureHandler<Poco::BufferPagePool>(Poco::BufferPagePool::defaultPool(), 2, 0), Poco::MemoryPressureRegistry::PRIO_BUFFERS);
+		addFrameworkHandler(new Poco::TrimMemoryPressureHandler<Poco::ZStreamPool>(Poco::ZStreamPool::deflaters(Poco::DeflatingStreamBuf::STREAM_ZLIB), 2, 0), Poco::MemoryPressureRegistry::PRIO_POOLS);
+		addFrameworkHandler(new Poco::TrimMemoryPressureHandler<Poco::ZStreamPool>(Poco::ZStreamPool::deflaters(Poco::DeflatingStreamBuf::STREAM_GZIP), 2, 0), Poco::MemoryPressureRegistry::PRIO_POOLS);
+		addFrameworkHandler(new Poco::TrimMemoryPressureHandler<Poco::ZStreamPool>(Poco::ZStreamPool::inflaters(Poco::InflatingStreamBuf::STREAM_ZLIB), 2, 0), Poco::MemoryPressureRegistry::PRIO_POOLS);
+		addFrameworkHandler(new Poco::TrimMemoryPressureHandler<Poco::ZStreamPool>(Poco::ZStreamPool::inflaters(Poco::InflatingStreamBuf::STREAM_GZIP), 2, 0), Poco::MemoryPressureRegistry::PRIO_POOLS);
+		addFrameworkHandler(new Poco::TrimMemoryPressureHandler<Poco::ZStreamPool>(Poco::ZStreamPool::inflaters(Poco::InflatingStreamBuf::STREAM_ZIP), 2, 0), Poco::MemoryPressureRegistry::PRIO_POOLS);
+		_registry.memoryPressure += Poco::delegate(this, &MemoryPressureService::onMemoryPressure);
+	}
+
+	void start(const std::string& pressureFile = std::string())
+		/// Starts watching the given PSI file, e.g. the one returned by
+		/// MemoryPressureMonitor::cgroupPressureFile(), or, if empty,
+		/// /proc/pressure/memory. Other settings can be changed
+		/// through monitor() before.
+	{
+		_monitor.setPressureFile(pressureFile);
+		_monitor.start();
+	}
+
+	void stop()
+		/// Stops watching the memory pressure.
+	{
+		_monitor.stop();
+	}
+
+	void addHandler(Poco::MemoryPressureHandler::Ptr pHandler, int priority)
+		/// Adds a handler to the registry. The handler must be
+		/// removed before the cache or pool it refers to is destroyed.
+	{
+		_registry.add(pHandler, priority);
+	}
+
+	void removeHandler(Poco::MemoryPressureHandler::Ptr pHandler)
+		/// Removes a handler from the registry.
+	{
+		_registry.remove(pHandler);
+	}
+
+	Poco::MemoryPressure::Level level() const
+		/// Returns the level last reported.
+	{
+		return _registry.level();
+	}
+
+	Poco::MemoryPressureMonitor& monitor()
+		/// Returns the monitor.
+	{
+		return _monitor;
+	}
+
+	Poco::MemoryPressureRegistry& registry()
+		/// Returns the registry.
+	{
+		return _registry;
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(MemoryPressureService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(MemoryPressureService), otherType) || Service::isA(otherType);
+	}
+
+protected:
+	~MemoryPressureService()
+	{
+		try
+		{
+			_monitor.stop();
+			_registry.memoryPressure -= Poco::delegate(this, &MemoryPressureService::onMemoryPressure);
+			for (HandlerVec::iterator it = _frameworkHandlers.begin(); it != _frameworkHandlers.end(); ++it)
+			{
+				_registry.remove(*it);
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void addFrameworkHandler(Poco::MemoryPressureHandler::Ptr pHandler, int priority)
+	{
+		_registry.add(pHandler, priority);
+		_frameworkHandlers.push_back(pHandler);
+	}
+
+	void onMemoryPressure(const void*, const Poco::MemoryPressure::Level& level)
+	{
+		memoryPressure(this, level);
+	}
+
+private:
+	typedef std::vector<Poco::MemoryPressureHandler::Ptr> HandlerVec;
+
+	Poco::MemoryPressureRegistry& _registry;
+	Poco::MemoryPressureMonitor _monitor;
+	HandlerVec _frameworkHandlers;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_MemoryPressureService_INCLUDED
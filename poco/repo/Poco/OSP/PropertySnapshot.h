@@ -0,0 +1,457 @@
+//
+// PropertySnapshot.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  PropertySnapshot
+//
+// Definition of the PropertyKey, PropertySnapshot and PropertyFilter classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_PropertySnapshot_INCLUDED
+#define OSP_PropertySnapshot_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Properties.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/NumberParser.h"
+#include "Poco/String.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class PropertyKey
+	/// PropertyKey is an interned, case-insensitive property key.
+	///
+	/// All PropertyKey objects for the same key, regardless of case,
+	/// refer to the same string, so that keys are compared by comparing
+	/// pointers. Interning a key takes a lock and may allocate memory;
+	/// therefore keys used repeatedly should be created once, e.g. as
+	/// static objects.
+{
+public:
+	PropertyKey():
+		_pKey(empty())
+		/// Creates the PropertyKey for the empty key.
+	{
+	}
+
+	PropertyKey(const std::string& key):
+		_pKey(intern(key))
+		/// Creates the PropertyKey for the given key.
+	{
+	}
+
+	PropertyKey(const char* key):
+		_pKey(intern(std::string(key)))
+		/// Creates the PropertyKey for the given key.
+	{
+	}
+
+	const std::string& str() const
+		/// Returns the key, converted to lower case.
+	{
+		return *_pKey;
+	}
+
+	const void* id() const
+		/// Returns a value identifying the key.
+	{
+		return _pKey;
+	}
+
+	bool operator == (const PropertyKey& other) const
+	{
+		return _pKey == other._pKey;
+	}
+
+	bool operator != (const PropertyKey& other) const
+	{
+		return _pKey != other._pKey;
+	}
+
+	bool operator < (const PropertyKey& other) const
+		/// Orders keys by identity, not alphabetically.
+	{
+		return _pKey < other._pKey;
+	}
+
+private:
+	static const std::string* empty()
+	{
+		static const std::string* pEmpty = intern(std::string());
+		return pEmpty;
+	}
+
+	static const std::string* intern(const std::string& key)
+	{
+		static Poco::FastMutex mutex;
+		static std::set<std::string> pool;
+
+		Poco::FastMutex::ScopedLock lock(mutex);
+		return &*pool.insert(Poco::toLower(key)).first;
+	}
+
+	const std::string* _pKey;
+};
+
+
+class PropertySnapshot: public Poco::RefCountedObject
+	/// PropertySnapshot is an immutable copy of a Properties object,
+	/// for evaluating filters repeatedly without locking, parsing
+	/// or allocating memory.
+	///
+	/// Keys are interned (see PropertyKey), and each value is parsed
+	/// as integer, floating-point number and boolean once, when the
+	/// snapshot is created. As a snapshot never changes, it can be
+	/// shared by any number of threads. Changes are made by creating a
+	/// modified copy with with() or without(), and replacing the
+	/// snapshot held by the owner (copy-on-write).
+{
+public:
+	typedef Poco::AutoPtr<PropertySnapshot> Ptr;
+
+	struct Value
+	{
+		Value():
+			intValue(0),
+			floatValue(0),
+			boolValue(false),
+			isInt(false),
+			isFloat(false)
+		{
+		}
+
+		PropertyKey key;
+		std::string str;
+		Poco::Int64 intValue;
+		double floatValue;
+		bool boolValue;
+			/// True if str is something other than "false",
+			/// as with Properties::getBool().
+		bool isInt;
+		bool isFloat;
+			/// True if str is a valid integer or
+			/// floating-point number.
+	};
+
+	PropertySnapshot()
+		/// Creates an empty PropertySnapshot.
+	{
+	}
+
+	explicit PropertySnapshot(const Properties& props)
+		/// Creates the PropertySnapshot from the given Properties.
+	{
+		std::vector<std::string> keys;
+		props.keys(keys);
+		_values.reserve(keys.size());
+		for (std::vector<std::string>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+		{
+			_values.push_back(makeValue(*it, props.get(*it)));
+		}
+		std::sort(_values.begin(), _values.end(), byKey);
+	}
+
+	const Value* find(const PropertyKey& key) const
+		/// Returns the value for the given key, or a null
+		/// pointer if the key does not exist.
+	{
+		Values::const_iterator it = std::lower_bound(_values.begin(), _values.end(), key, KeyLess());
+		if (it != _values.end() && it->key == key) return &*it;
+		return 0;
+	}
+
+	bool has(const PropertyKey& key) const
+		/// Returns true iff a property with the given key exists.
+	{
+		return find(key) != 0;
+	}
+
+	const std::string& get(const PropertyKey& key) const
+		/// Returns the value for the given key.
+		///
+		/// Throws a Poco::NotFoundException if the given key
+		/// does not exist.
+	{
+		return value(key).str;
+	}
+
+	Poco::Int64 getInt(const PropertyKey& key) const
+		/// Returns the given value as an integer.
+		///
+		/// Throws a Poco::NotFoundException if the given key
+		/// does not exist and a Poco::SyntaxException if
+		/// the property value is not a valid integer.
+	{
+		const Value& v = value(key);
+		if (!v.isInt) throw Poco::SyntaxException("Not a valid integer", v.str);
+		return v.intValue;
+	}
+
+	double getFloat(const PropertyKey& key) const
+		/// Returns the given value as a double.
+		///
+		/// Throws a Poco::NotFoundException if the given key
+		/// does not exist and a Poco::SyntaxException if
+		/// the property value is not a valid floating point number.
+	{
+		const Value& v = value(key);
+		if (!v.isFloat) throw Poco::SyntaxException("Not a valid floating-point number", v.str);
+		return v.floatValue;
+	}
+
+	bool getBool(const PropertyKey& key, bool deflt) const
+		/// Returns the given value as a boolean,
+		/// or deflt if the key does not exist.
+	{
+		const Value* pValue = find(key);
+		return pValue ? pValue->boolValue : deflt;
+	}
+
+	Ptr with(const std::string& key, const std::string& value) const
+		/// Returns a copy of the snapshot with the given property
+		/// added or updated.
+	{
+		Ptr pCopy = new PropertySnapshot(*this);
+		Value newValue = makeValue(key, value);
+		Values::iterator it = std::lower_bound(pCopy->_values.begin(), pCopy->_values.end(), newValue, byKey);
+		if (it != pCopy->_values.end() && it->key == newValue.key)
+			*it = newValue;
+		else
+			pCopy->_values.insert(it, newValue);
+		return pCopy;
+	}
+
+	Ptr without(const std::string& key) const
+		/// Returns a copy of the snapshot with the given property removed.
+	{
+		Ptr pCopy = new PropertySnapshot(*this);
+		PropertyKey k(key);
+		Values::iterator it = std::lower_bound(pCopy->_values.begin(), pCopy->_values.end(), k, KeyLess());
+		if (it != pCopy->_values.end() && it->key == k) pCopy->_values.erase(it);
+		return pCopy;
+	}
+
+	std::size_t size() const
+		/// Returns the number of properties.
+	{
+		return _values.size();
+	}
+
+	static Value makeValue(const std::string& key, const std::string& str)
+		/// Creates a Value, parsing the given string.
+	{
+		Value value;
+		value.key = PropertyKey(key);
+		value.str = str;
+		value.isInt = Poco::NumberParser::tryParse64(str, value.intValue);
+		if (value.isInt)
+		{
+			value.floatValue = static_cast<double>(value.intValue);
+			value.isFloat = true;
+		}
+		else
+		{
+			value.isFloat = Poco::NumberParser::tryParseFloat(str, value.floatValue);
+		}
+		value.boolValue = str != "false";
+		return value;
+	}
+
+protected:
+	typedef std::vector<Value> Values;
+
+	~PropertySnapshot()
+	{
+	}
+
+	PropertySnapshot(const PropertySnapshot& other):
+		Poco::RefCountedObject(),
+		_values(other._values)
+	{
+	}
+
+	struct KeyLess
+	{
+		bool operator () (const Value& v, const PropertyKey& key) const
+		{
+			return v.key < key;
+		}
+	};
+
+	static bool byKey(const Value& v1, const Value& v2)
+	{
+		return v1.key < v2.key;
+	}
+
+	const Value& value(const PropertyKey& key) const
+	{
+		const Value* pValue = find(key);
+		if (!pValue) throw Poco::NotFoundException(key.str());
+		return *pValue;
+	}
+
+private:
+	PropertySnapshot& operator = (const PropertySnapshot&);
+
+	Values _values;
+};
+
+
+class PropertyFilter
+	/// PropertyFilter is a conjunction of conditions on properties,
+	/// evaluated against a PropertySnapshot without parsing or
+	/// allocating memory.
+	///
+	/// A condition compares numerically if both the property value
+	/// and the operand are numbers, and as strings otherwise.
+	///
+	/// Usage example:
+	///
+	///     PropertyFilter filter;
+	///     filter.equals("type", "osp.connectivity").greaterEqual("priority", "10");
+	///     if (filter.matches(*pSnapshot)) ...
+{
+public:
+	enum Relation
+	{
+		REL_EXISTS,
+		REL_EQ,
+		REL_NE,
+		REL_LT,
+		REL_LE,
+		REL_GT,
+		REL_GE
+	};
+
+	PropertyFilter()
+		/// Creates an empty PropertyFilter, which matches
+		/// any snapshot.
+	{
+	}
+
+	~PropertyFilter()
+		/// Destroys the PropertyFilter.
+	{
+	}
+
+	PropertyFilter& add(const std::string& key, Relation relation, const std::string& operand = std::string())
+		/// Adds a condition.
+	{
+		Condition cond;
+		cond.relation = relation;
+		cond.operand = PropertySnapshot::makeValue(key, operand);
+		_conditions.push_back(cond);
+		return *this;
+	}
+
+	PropertyFilter& exists(const std::string& key)
+	{
+		return add(key, REL_EXISTS);
+	}
+
+	PropertyFilter& equals(const std::string& key, const std::string& operand)
+	{
+		return add(key, REL_EQ, operand);
+	}
+
+	PropertyFilter& notEquals(const std::string& key, const std::string& operand)
+	{
+		return add(key, REL_NE, operand);
+	}
+
+	PropertyFilter& less(const std::string& key, const std::string& operand)
+	{
+		return add(key, REL_LT, operand);
+	}
+
+	PropertyFilter& lessEqual(const std::string& key, const std::string& operand)
+	{
+		return add(key, REL_LE, operand);
+	}
+
+	PropertyFilter& greater(const std::string& key, const std::string& operand)
+	{
+		return add(key, REL_GT, operand);
+	}
+
+	PropertyFilter& greaterEqual(const std::string& key, const std::string& operand)
+	{
+		return add(key, REL_GE, operand);
+	}
+
+	bool matches(const PropertySnapshot& snapshot) const
+		/// Returns true if the snapshot satisfies all conditions.
+	{
+		for (Conditions::const_iterator it = _conditions.begin(); it != _conditions.end(); ++it)
+		{
+			const PropertySnapshot::Value* pValue = snapshot.find(it->operand.key);
+			if (!pValue)
+			{
+				if (it->relation == REL_NE) continue;
+				return false;
+			}
+			if (it->relation == REL_EXISTS) continue;
+
+			int cmp;
+			if (pValue->isFloat && it->operand.isFloat)
+			{
+				if (pValue->isInt && it->operand.isInt)
+					cmp = pValue->intValue < it->operand.intValue ? -1 : (pValue->intValue > it->operand.intValue ? 1 : 0);
+				else
+					cmp = pValue->floatValue < it->operand.floatValue ? -1 : (pValue->floatValue > it->operand.floatValue ? 1 : 0);
+			}
+			else cmp = pValue->str.compare(it->operand.str);
+
+			bool result = false;
+			switch (it->relation)
+			{
+			case REL_EQ: result = cmp == 0; break;
+			case REL_NE: result = cmp != 0; break;
+			case REL_LT: result = cmp < 0; break;
+			case REL_LE: result = cmp <= 0; break;
+			case REL_GT: result = cmp > 0; break;
+			case REL_GE: result = cmp >= 0; break;
+			default:     break;
+			}
+			if (!result) return false;
+		}
+		return true;
+	}
+
+private:
+	struct Condition
+	{
+		Relation relation;
+		PropertySnapshot::Value operand;
+	};
+
+	typedef std::vector<Condition> Conditions;
+
+	Conditions _conditions;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_PropertySnapshot_INCLUDED
@@ -24,6 +24,7 @@
 #include "Poco/RefCountedObject.h"
 #include "Poco/AutoPtr.h"
 #include <typeinfo>
+#include <cstring>
 
 
 namespace Poco {
@@ -64,17 +65,24 @@ public:
 		/// Returns true if the class is a subclass of the class
 		/// given by type. Comparison must always be done by
 		/// type name, not by simply comparing std::type_info object
-		/// references.
+		/// references. Use isSameType() for the comparison.
 		///
 		/// Subclasses must override this member function.
 		///
 		/// The implementation of isA() is always as follows:
 		///     bool MyService::isA(const std::type_info& otherType) const
 		///     {
-		///         std::string name(typeid(MyService).name());
-		///         return name == otherType.name() || MyBaseClass::isA(otherType);
+		///         return isSameType(typeid(MyService), otherType) || MyBaseClass::isA(otherType);
 		///     }   
 
+	static bool isSameType(const std::type_info& type, const std::type_info& otherType);
+		/// Returns true if both std::type_info objects denote the same type.
+		///
+		/// The objects are first compared by address, which is
+		/// sufficient if both come from the same shared library.
+		/// The type names are compared only if the addresses differ,
+		/// so the comparison never allocates memory.
+
 protected:
 	Service();
 		/// Creates the Service.
@@ -84,6 +92,15 @@ protected:
 };
 
 
+//
+// inlines
+//
+inline bool Service::isSameType(const std::type_info& type, const std::type_info& otherType)
+{
+	return &type == &otherType || std::strcmp(type.name(), otherType.name()) == 0;
+}
+
+
 } } // namespace Poco::OSP
 
 
@@ -0,0 +1,429 @@
+//
+// ServiceIndex.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Service
+// Module:  ServiceIndex
+//
+// Definition of the ServiceQuery and ServiceIndex classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_ServiceIndex_INCLUDED
+#define OSP_ServiceIndex_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/ServiceRegistry.h"
+#include "Poco/OSP/ServiceRef.h"
+#include "Poco/OSP/ServiceEvent.h"
+#include "Poco/OSP/QLParser.h"
+#include "Poco/OSP/QLExpr.h"
+#include "Poco/OSP/Properties.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/AtomicPointer.h"
+#include "Poco/GrowOnlyHashTable.h"
+#include "Poco/Delegate.h"
+#include "Poco/ScalableRWLock.h"
+#include "Poco/Mutex.h"
+#include "Poco/Ascii.h"
+#include <vector>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class ServiceQuery: public Poco::RefCountedObject
+	/// A query expression (see ServiceRegistry::find()),
+	/// parsed once, that can be evaluated any number of times.
+	///
+	/// If the query requires a specific service type, i.e. it has
+	/// the form type == "..." or type == "..." && ..., and contains
+	/// no || or ! operator, the type is available from indexType(),
+	/// so that ServiceIndex only has to evaluate the query for the
+	/// services of this type.
+{
+public:
+	typedef Poco::AutoPtr<ServiceQuery> Ptr;
+
+	explicit ServiceQuery(const std::string& query):
+		_query(query)
+		/// Parses the query.
+		///
+		/// Throws a Poco::SyntaxException if the query is not valid.
+	{
+		QLParser parser(query);
+		_pExpr = parser.parse();
+		_indexType = extractType(query);
+	}
+
+	const std::string& query() const
+		/// Returns the query string.
+	{
+		return _query;
+	}
+
+	const std::string& indexType() const
+		/// Returns the service type required by the query,
+		/// or an empty string if the query does not require
+		/// a specific type.
+	{
+		return _indexType;
+	}
+
+	bool matches(const ServiceRef& ref) const
+		/// Returns true if the properties of the service
+		/// match the query.
+	{
+		return _pExpr->evaluate(ref.properties());
+	}
+
+protected:
+	~ServiceQuery()
+	{
+	}
+
+	static std::string extractType(const std::string& query)
+	{
+		if (query.find("||") != std::string::npos || query.find('!') != std::string::npos) return std::string();
+
+		std::string::const_iterator it = query.begin();
+		std::string::const_iterator end = query.end();
+		skipSpace(it, end);
+		if (!skip(it, end, ServiceRegistry::PROP_TYPE)) return std::string();
+		skipSpace(it, end);
+		if (!skip(it, end, "==")) return std::string();
+		skipSpace(it, end);
+		if (it == end || *it != '"') return std::string();
+		std::string type;
+		for (++it; it != end && *it != '"'; ++it)
+		{
+			if (*it == '\\') return std::string();
+			type += *it;
+		}
+		if (it == end) return std::string();
+		++it;
+		skipSpace(it, end);
+		if (it == end || skip(it, end, "&&")) return type;
+		return std::string();
+	}
+
+	static void skipSpace(std::string::const_iterator& it, std::string::const_iterator end)
+	{
+		while (it != end && Poco::Ascii::isSpace(*it)) ++it;
+	}
+
+	static bool skip(std::string::const_iterator& it, std::string::const_iterator end, const std::string& token)
+	{
+		std::string::const_iterator p = it;
+		for (std::string::const_iterator t = token.begin(); t != token.end(); ++t, ++p)
+		{
+			if (p == end || *p != *t) return false;
+		}
+		if (Poco::Ascii::isAlphaNumeric(token[token.size() - 1]) && p != end && (Poco::Ascii::isAlphaNumeric(*p) || *p == '.' || *p == '_')) return false;
+		it = p;
+		return true;
+	}
+
+private:
+	ServiceQuery(const ServiceQuery&);
+	ServiceQuery& operator = (const ServiceQuery&);
+
+	std::string _query;
+	std::string _indexType;
+	QLExpr::Ptr _pExpr;
+};
+
+
+class ServiceIndex
+	/// ServiceIndex mirrors the services of a ServiceRegistry,
+	/// with indexes for faster lookups.
+	///
+	/// ServiceRegistry::find() parses the query on every call and
+	/// evaluates it for all services, and findByName() searches a map
+	/// under the registry's mutex. The registry is compiled into the
+	/// OSP library, so ServiceIndex subscribes to its events instead,
+	/// and provides:
+	///
+	///   - findByName(), which takes no lock. Names are kept in a hash
+	///     table that is only ever added to, so readers never see
+	///     freed entries. When the table grows, a copy is published
+	///     and the old one is kept until the index is destroyed.
+	///     ServiceRef objects of unregistered services are also
+	///     kept until then.
+	///   - an index of the services by type (see
+	///     ServiceRegistry::PROP_TYPE), used by find() for queries
+	///     requiring a type, and findByType().
+	///   - a cache of parsed queries (see query()).
+	///
+	/// The index must be created before services are registered
+	/// concurrently, e.g. by the bundle providing it, and must not
+	/// outlive the registry.
+	///
+	/// Usage example:
+	///
+	///     ServiceIndex index(context()->registry());
+	///     ServiceRef::Ptr pRef = index.findByName(CONNMANAGER_SERVICE_NAME);
+	///     std::vector<ServiceRef::Ptr> results;
+	///     index.find("type == \"http.requesthandler\" && path =~ \"/api/*\"", results);
+{
+public:
+	explicit ServiceIndex(ServiceRegistry& registry):
+		_registry(registry),
+		_names(INITIAL_SIZE)
+		/// Creates the ServiceIndex for the given ServiceRegistry,
+		/// and adds all services currently registered.
+	{
+		_registry.serviceRegistered += Poco::delegate(this, &ServiceIndex::onServiceRegistered);
+		_registry.serviceUnregistered += Poco::delegate(this, &ServiceIndex::onServiceUnregistered);
+
+		std::vector<ServiceRef::Ptr> services;
+		_registry.find(ServiceRegistry::PROP_NAME, services);
+		for (std::vector<ServiceRef::Ptr>::iterator it = services.begin(); it != services.end(); ++it)
+		{
+			add(*it);
+		}
+	}
+
+	~ServiceIndex()
+		/// Destroys the ServiceIndex.
+	{
+		try
+		{
+			_registry.serviceRegistered -= Poco::delegate(this, &ServiceIndex::onServiceRegistered);
+			_registry.serviceUnregistered -= Poco::delegate(this, &ServiceIndex::onServiceUnregistered);
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+		for (NameTable::Iterator it = _names.begin(); it != _names.end(); ++it)
+		{
+			ServiceRef* pRef = (*it)->pRef.load();
+			if (pRef) pRef->release();
+		}
+		for (std::vector<ServiceRef*>::iterator it = _retired.begin(); it != _retired.end(); ++it)
+		{
+			(*it)->release();
+		}
+	}
+
+	ServiceRef::Ptr findByName(const std::string& name) const
+		/// Returns the ServiceRef for the given service, or a NULL
+		/// pointer if no service with the given name is registered.
+		///
+		/// Takes no lock.
+	{
+		Entry* pEntry = _names.find(name, hashOf(name));
+		if (!pEntry) return ServiceRef::Ptr();
+		return ServiceRef::Ptr(pEntry->pRef.load(), true);
+	}
+
+	std::size_t findByType(const std::string& type, std::vector<ServiceRef::Ptr>& results) const
+		/// Adds all services with the given type to results and
+		/// returns the number of services found.
+	{
+		Poco::ScalableRWLock::ScopedReadLock lock(_typeLock);
+		TypeMap::const_iterator it = _types.find(type);
+		if (it == _types.end()) return 0;
+		results.insert(results.end(), it->second.begin(), it->second.end());
+		return it->second.size();
+	}
+
+	std::size_t find(const ServiceQuery& query, std::vector<ServiceRef::Ptr>& results) const
+		/// Adds all services matching the query to results and
+		/// returns the number of services found.
+		///
+		/// If the query requires a service type, only the services
+		/// of that type are evaluated, otherwise the query is passed
+		/// to ServiceRegistry::find().
+	{
+		if (query.indexType().empty()) return _registry.find(query.query(), results);
+
+		std::size_t n = 0;
+		Poco::ScalableRWLock::ScopedReadLock lock(_typeLock);
+		TypeMap::const_iterator it = _types.find(query.indexType());
+		if (it == _types.end()) return 0;
+		for (RefVec::const_iterator itR = it->second.begin(); itR != it->second.end(); ++itR)
+		{
+			if (query.matches(**itR))
+			{
+				results.push_back(*itR);
+				++n;
+			}
+		}
+		return n;
+	}
+
+	std::size_t find(const std::string& query, std::vector<ServiceRef::Ptr>& results)
+		/// Adds all services matching the query to results and
+		/// returns the number of services found.
+		///
+		/// The query is parsed only once, see query().
+	{
+		return find(*this->query(query), results);
+	}
+
+	ServiceQuery::Ptr query(const std::string& query)
+		/// Returns the parsed query for the given query string,
+		/// from a cache of up to MAX_CACHED_QUERIES recently used
+		/// queries.
+		///
+		/// Throws a Poco::SyntaxException if the query is not valid.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_queryMutex);
+			QueryMap::iterator it = _queries.find(query);
+			if (it != _queries.end()) return it->second;
+		}
+		ServiceQuery::Ptr pQuery = new ServiceQuery(query);
+		Poco::FastMutex::ScopedLock lock(_queryMutex);
+		if (_queries.size() >= MAX_CACHED_QUERIES) _queries.clear();
+		_queries[query] = pQuery;
+		return pQuery;
+	}
+
+	enum
+	{
+		MAX_CACHED_QUERIES = 256
+	};
+
+protected:
+	typedef std::vector<ServiceRef::Ptr> RefVec;
+	typedef std::map<std::string, RefVec> TypeMap;
+	typedef std::map<std::string, ServiceQuery::Ptr> QueryMap;
+
+	struct Entry
+	{
+		Entry(const std::string& n, Poco::UInt32 h):
+			name(n),
+			hash(h),
+			pRef(0)
+		{
+		}
+
+		bool equals(const std::string& n) const
+		{
+			return name == n;
+		}
+
+		std::string name;
+		Poco::UInt32 hash;
+		Poco::AtomicPointer<ServiceRef> pRef;
+	};
+
+	typedef Poco::GrowOnlyHashTable<Entry> NameTable;
+
+	enum
+	{
+		INITIAL_SIZE = 256
+	};
+
+	static Poco::UInt32 hashOf(const std::string& name)
+	{
+		Poco::UInt32 hash = 2166136261u;
+		for (std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+		{
+			hash = (hash ^ static_cast<unsigned char>(*it))*16777619u;
+		}
+		return hash;
+	}
+
+	void add(ServiceRef::Ptr pRef)
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			Poco::UInt32 hash = hashOf(pRef->name());
+			Entry* pEntry = _names.find(pRef->name(), hash);
+			if (!pEntry)
+			{
+				pEntry = new Entry(pRef->name(), hash);
+				_names.add(pEntry);
+			}
+			else if (pEntry->pRef.load() == pRef.get()) return;
+			ServiceRef* pOldRef = pEntry->pRef.load();
+			if (pOldRef) _retired.push_back(pOldRef);
+			pRef->duplicate();
+			pEntry->pRef.store(pRef.get());
+		}
+		std::string type = pRef->properties().get(ServiceRegistry::PROP_TYPE, std::string());
+		if (!type.empty())
+		{
+			Poco::ScalableRWLock::ScopedWriteLock lock(_typeLock);
+			_types[type].push_back(pRef);
+		}
+	}
+
+	void remove(ServiceRef::Ptr pRef)
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			Entry* pEntry = _names.find(pRef->name(), hashOf(pRef->name()));
+			if (pEntry && pEntry->pRef.load() == pRef.get())
+			{
+				// Readers may still be duplicating the ServiceRef,
+				// so it is released when the index is destroyed.
+				_retired.push_back(pRef.get());
+				pEntry->pRef.store(0);
+			}
+		}
+		std::string type = pRef->properties().get(ServiceRegistry::PROP_TYPE, std::string());
+		if (!type.empty())
+		{
+			Poco::ScalableRWLock::ScopedWriteLock lock(_typeLock);
+			TypeMap::iterator it = _types.find(type);
+			if (it != _types.end())
+			{
+				for (RefVec::iterator itR = it->second.begin(); itR != it->second.end(); ++itR)
+				{
+					if (*itR == pRef)
+					{
+						it->second.erase(itR);
+						break;
+					}
+				}
+				if (it->second.empty()) _types.erase(it);
+			}
+		}
+	}
+
+	void onServiceRegistered(const void*, ServiceEvent& event)
+	{
+		add(event.service());
+	}
+
+	void onServiceUnregistered(const void*, ServiceEvent& event)
+	{
+		remove(event.service());
+	}
+
+private:
+	ServiceIndex(const ServiceIndex&);
+	ServiceIndex& operator = (const ServiceIndex&);
+
+	ServiceRegistry& _registry;
+	NameTable _names;
+	std::vector<ServiceRef*> _retired;
+	TypeMap _types;
+	QueryMap _queries;
+	Poco::FastMutex _mutex;
+	mutable Poco::ScalableRWLock _typeLock;
+	Poco::FastMutex _queryMutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_ServiceIndex_INCLUDED
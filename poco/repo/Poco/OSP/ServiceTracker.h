@@ -0,0 +1,270 @@
+//
+// ServiceTracker.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Service
+// Module:  ServiceTracker
+//
+// Definition of the ServiceTracker class template.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_ServiceTracker_INCLUDED
+#define OSP_ServiceTracker_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/ServiceRegistry.h"
+#include "Poco/OSP/ServiceRef.h"
+#include "Poco/OSP/ServiceEvent.h"
+#include "Poco/OSP/ServiceIndex.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Delegate.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+template <class Svc>
+class ServiceTracker
+	/// ServiceTracker keeps track of the services of class Svc
+	/// with a given name, or matching a given query, so that the
+	/// current service can be obtained without looking it up in
+	/// the ServiceRegistry.
+	///
+	/// The tracker subscribes to the registry's events. When a
+	/// matching service is registered and no service is current,
+	/// the new service becomes current, and the serviceAdded event
+	/// is fired. When the current service is unregistered,
+	/// serviceRemoved is fired and the next matching service, if any,
+	/// becomes current.
+	///
+	/// The service instance is obtained (see ServiceRef::castedInstance())
+	/// once, when the service becomes current, and instance() returns
+	/// it with a single load of a pointer, without taking a lock.
+	/// Therefore, for a service registered with a ServiceFactory, all
+	/// callers share one instance. Instances that are no longer current
+	/// are kept until the tracker is destroyed, as other threads may still
+	/// be returning them.
+	///
+	/// Services that do not implement Svc are ignored.
+	///
+	/// Usage example:
+	///
+	///     ServiceTracker<IConnManagerService> tracker(context()->registry(), CONNMANAGER_SERVICE_NAME);
+	///     Poco::AutoPtr<IConnManagerService> pService = tracker.instance();
+	///     if (pService) ...
+{
+public:
+	typedef Poco::AutoPtr<Svc> SvcPtr;
+
+	Poco::BasicEvent<const ServiceRef::Ptr> serviceAdded;
+		/// Fired when a service has become current.
+
+	Poco::BasicEvent<const ServiceRef::Ptr> serviceRemoved;
+		/// Fired when the current service has been unregistered,
+		/// before the next matching service becomes current.
+
+	ServiceTracker(ServiceRegistry& registry, const std::string& name):
+		_registry(registry),
+		_name(name),
+		_pCurrent(0)
+		/// Creates the ServiceTracker for the service
+		/// with the given name.
+	{
+		start(_name);
+	}
+
+	ServiceTracker(ServiceRegistry& registry, ServiceQuery::Ptr pQuery):
+		_registry(registry),
+		_pQuery(pQuery),
+		_pCurrent(0)
+		/// Creates the ServiceTracker for the services
+		/// matching the given query.
+	{
+		start(_pQuery->query());
+	}
+
+	~ServiceTracker()
+		/// Destroys the ServiceTracker.
+	{
+		try
+		{
+			_registry.serviceRegistered -= Poco::delegate(this, &ServiceTracker::onServiceRegistered);
+			_registry.serviceUnregistered -= Poco::delegate(this, &ServiceTracker::onServiceUnregistered);
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+		for (typename std::vector<Svc*>::iterator it = _retired.begin(); it != _retired.end(); ++it)
+		{
+			(*it)->release();
+		}
+		Svc* pCurrent = _pCurrent;
+		if (pCurrent) pCurrent->release();
+	}
+
+	SvcPtr instance() const
+		/// Returns the instance of the current service,
+		/// or a NULL pointer if there is none.
+		///
+		/// Takes no lock.
+	{
+		Svc* pCurrent = _pCurrent;
+		__sync_synchronize();
+		return SvcPtr(pCurrent, true);
+	}
+
+	bool available() const
+		/// Returns true if a matching service is registered.
+	{
+		Svc* pCurrent = _pCurrent;
+		return pCurrent != 0;
+	}
+
+	ServiceRef::Ptr serviceRef() const
+		/// Returns the ServiceRef of the current service,
+		/// or a NULL pointer if there is none.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _candidates.empty() ? ServiceRef::Ptr() : _candidates.front();
+	}
+
+protected:
+	void start(const std::string& query)
+	{
+		_registry.serviceRegistered += Poco::delegate(this, &ServiceTracker::onServiceRegistered);
+		_registry.serviceUnregistered += Poco::delegate(this, &ServiceTracker::onServiceUnregistered);
+
+		if (_pQuery)
+		{
+			std::vector<ServiceRef::Ptr> services;
+			_registry.find(query, services);
+			for (std::vector<ServiceRef::Ptr>::iterator it = services.begin(); it != services.end(); ++it)
+			{
+				add(*it);
+			}
+		}
+		else
+		{
+			ServiceRef::Ptr pRef = _registry.findByName(query);
+			if (pRef) add(pRef);
+		}
+	}
+
+	bool matches(const ServiceRef& ref) const
+	{
+		return _pQuery ? _pQuery->matches(ref) : ref.name() == _name;
+	}
+
+	void add(ServiceRef::Ptr pRef)
+	{
+		if (!matches(*pRef)) return;
+
+		bool added = false;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			for (std::vector<ServiceRef::Ptr>::iterator it = _candidates.begin(); it != _candidates.end(); ++it)
+			{
+				if (*it == pRef) return;
+			}
+			if (_candidates.empty())
+			{
+				if (!publish(pRef)) return;
+				added = true;
+			}
+			_candidates.push_back(pRef);
+		}
+		if (added) serviceAdded(this, pRef);
+	}
+
+	void remove(ServiceRef::Ptr pRef)
+	{
+		ServiceRef::Ptr pNext;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			std::vector<ServiceRef::Ptr>::iterator it = _candidates.begin();
+			while (it != _candidates.end() && *it != pRef) ++it;
+			if (it == _candidates.end()) return;
+			bool current = it == _candidates.begin();
+			_candidates.erase(it);
+			if (!current) return;
+
+			retire();
+			while (!_candidates.empty() && !publish(_candidates.front()))
+			{
+				_candidates.erase(_candidates.begin());
+			}
+			if (!_candidates.empty()) pNext = _candidates.front();
+		}
+		serviceRemoved(this, pRef);
+		if (pNext) serviceAdded(this, pNext);
+	}
+
+	bool publish(ServiceRef::Ptr pRef)
+	{
+		SvcPtr pInstance;
+		try
+		{
+			pInstance = pRef->castedInstance<Svc>();
+		}
+		catch (Poco::Exception&)
+		{
+			return false;
+		}
+		if (!pInstance) return false;
+		Svc* pNew = pInstance.duplicate();
+		__sync_synchronize();
+		_pCurrent = pNew;
+		return true;
+	}
+
+	void retire()
+	{
+		Svc* pCurrent = _pCurrent;
+		_pCurrent = 0;
+		if (pCurrent) _retired.push_back(pCurrent);
+	}
+
+	void onServiceRegistered(const void*, ServiceEvent& event)
+	{
+		add(event.service());
+	}
+
+	void onServiceUnregistered(const void*, ServiceEvent& event)
+	{
+		remove(event.service());
+	}
+
+private:
+	ServiceTracker(const ServiceTracker&);
+	ServiceTracker& operator = (const ServiceTracker&);
+
+	ServiceRegistry& _registry;
+	std::string _name;
+	ServiceQuery::Ptr _pQuery;
+	Svc* volatile _pCurrent;
+	std::vector<ServiceRef::Ptr> _candidates;
+	std::vector<Svc*> _retired;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_ServiceTracker_INCLUDED
@@ -0,0 +1,342 @@
+//
+// StaticBundle.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Bundle
+// Module:  StaticBundle
+//
+// Definition of the StaticBundleStorage and StaticBundleRegistry classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_StaticBundle_INCLUDED
+#define OSP_StaticBundle_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/BundleStorage.h"
+#include "Poco/OSP/BundleLoader.h"
+#include "Poco/OSP/BundleActivator.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/OSP/LanguageTag.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/FlatHashMap.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <string>
+#include <cstring>
+
+
+namespace Poco {
+namespace OSP {
+
+
+struct StaticBundleResource
+	/// A resource embedded in the executable, e.g. a web page
+	/// or an extensions.xml file, for a StaticBundleInfo.
+{
+	const char* path;           /// The path of the resource in the bundle, e.g. "webapp/index.html".
+	const char* data;           /// The content of the resource.
+	std::size_t size;           /// The size of the content in bytes.
+};
+
+
+struct StaticBundleInfo
+	/// The description of a bundle linked into the executable.
+	///
+	/// StaticBundleInfo is an aggregate of pointers to string
+	/// literals and functions only, so that tables of bundles are
+	/// initialized by the compiler (constant initialization), without
+	/// any code running at startup. See POCO_OSP_STATIC_BUNDLE.
+{
+	const char* symbolicName;   /// The symbolic name of the bundle, e.g. "com.acme.connmgr".
+	const char* manifest;       /// The content of the bundle's META-INF/manifest.mf.
+	const char* activatorClass; /// The name of the activator class, as in the manifest, or 0.
+	BundleActivator* (*createActivator)(); /// Creates the activator, or 0 if the bundle has no activator.
+	const StaticBundleResource* resources; /// The other resources, terminated by an entry with a null path, or 0.
+};
+
+
+template <class BA>
+BundleActivator* createStaticBundleActivator()
+	/// Creates a BundleActivator of the given class, for
+	/// StaticBundleInfo::createActivator.
+{
+	return new BA;
+}
+
+
+//
+// POCO_OSP_STATIC_BUNDLE defines the StaticBundleInfo for a bundle with
+// an activator. activatorClass must be the fully qualified name of the
+// class, as given in the Bundle-Activator header of the manifest, and
+// resources a StaticBundleResource table or 0.
+//
+// POCO_OSP_STATIC_RESOURCE_BUNDLE defines the StaticBundleInfo for a
+// bundle without an activator.
+//
+// POCO_OSP_STATIC_BUNDLE_END terminates a table of StaticBundleInfo entries.
+//
+#define POCO_OSP_STATIC_BUNDLE(symbolicName, manifest, activatorClass, resources) \
+	{ symbolicName, manifest, #activatorClass, &Poco::OSP::createStaticBundleActivator<activatorClass>, resources }
+
+#define POCO_OSP_STATIC_RESOURCE_BUNDLE(symbolicName, manifest, resources) \
+	{ symbolicName, manifest, 0, 0, resources }
+
+#define POCO_OSP_STATIC_BUNDLE_END \
+	{ 0, 0, 0, 0, 0 }
+
+
+class StaticBundleStorage: public BundleStorage
+	/// StaticBundleStorage implements the BundleStorage interface
+	/// for a bundle embedded in the executable with a StaticBundleInfo.
+	///
+	/// The manifest and resources are read directly from the tables in
+	/// the executable, without copying. The path of the bundle is
+	/// "static:" followed by the symbolic name, which is not a file.
+	/// All resources have the time the storage has been created as
+	/// modification time.
+{
+public:
+	explicit StaticBundleStorage(const StaticBundleInfo& info):
+		_info(info),
+		_path("static:")
+		/// Creates the StaticBundleStorage for the given bundle,
+		/// which must remain valid and unchanged while the
+		/// StaticBundleStorage exists.
+	{
+		if (!info.symbolicName || !info.manifest) throw Poco::InvalidArgumentException("static bundle without symbolic name or manifest");
+		_path += info.symbolicName;
+		_resources.push_back(StaticBundleResource());
+		_resources.back().path = "META-INF/manifest.mf";
+		_resources.back().data = info.manifest;
+		_resources.back().size = std::strlen(info.manifest);
+		for (const StaticBundleResource* pRes = info.resources; pRes && pRes->path; ++pRes)
+		{
+			_resources.push_back(*pRes);
+		}
+		_index.reserve(_resources.size());
+		for (std::size_t i = 0; i < _resources.size(); ++i)
+		{
+			_index[std::string(_resources[i].path)] = i;
+			_sortedNames.push_back(_resources[i].path);
+		}
+		std::sort(_sortedNames.begin(), _sortedNames.end());
+	}
+
+	const StaticBundleInfo& info() const
+		/// Returns the StaticBundleInfo of the bundle.
+	{
+		return _info;
+	}
+
+	// BundleStorage
+	std::istream* getResource(const std::string& path) const
+	{
+		IndexMap::ConstIterator it = _index.find(path);
+		if (it == _index.end()) return 0;
+		const StaticBundleResource& res = _resources[it->second];
+		return new Poco::MemoryInputStream(res.data, static_cast<std::streamsize>(res.size));
+	}
+
+	void list(const std::string& path, std::vector<std::string>& files) const
+	{
+		files.clear();
+		std::string parent(path);
+		if (!parent.empty() && parent[parent.size() - 1] != '/') parent += '/';
+		std::set<std::string> names;
+		std::vector<std::string>::const_iterator it = std::lower_bound(_sortedNames.begin(), _sortedNames.end(), parent);
+		for (; it != _sortedNames.end() && it->compare(0, parent.size(), parent) == 0; ++it)
+		{
+			std::string::size_type pos = it->find('/', parent.size());
+			std::string name(*it, parent.size(), pos == std::string::npos ? std::string::npos : pos - parent.size());
+			if (!name.empty() && names.insert(name).second) files.push_back(name);
+		}
+	}
+
+	Poco::Timestamp lastModified(const std::string& path) const
+	{
+		if (_index.find(path) == _index.end())
+		{
+			std::vector<std::string> files;
+			list(path, files);
+			if (files.empty()) throw Poco::NotFoundException(path);
+		}
+		return _created;
+	}
+
+	std::string path() const
+	{
+		return _path;
+	}
+
+protected:
+	~StaticBundleStorage()
+		/// Destroys the StaticBundleStorage.
+	{
+	}
+
+private:
+	typedef Poco::FlatHashMap<std::string, std::size_t> IndexMap;
+
+	const StaticBundleInfo& _info;
+	std::string _path;
+	std::vector<StaticBundleResource> _resources;
+	IndexMap _index;
+	std::vector<std::string> _sortedNames;
+	Poco::Timestamp _created;
+};
+
+
+class StaticBundleRegistry
+	/// The StaticBundleRegistry installs the bundles linked into
+	/// the executable, described by a table of StaticBundleInfo
+	/// entries, with a BundleLoader.
+	///
+	/// For each bundle, the activator factory is registered with
+	/// BundleLoader::registerBundleActivator(), and a Bundle with a
+	/// StaticBundleStorage is loaded with BundleLoader::loadBundle().
+	/// No bundle repository is searched, no bundle archive is opened
+	/// or extracted, and no shared library is copied to the code cache
+	/// or loaded. Bundles are resolved and started as usual, by
+	/// run level and dependencies.
+	///
+	/// Activators can only be registered if OSP has been built with
+	/// POCO_OSP_STATIC defined (which is implied by POCO_NO_SHAREDLIBS).
+	/// Otherwise, only bundles without activators can be installed.
+	///
+	/// The table is defined in the executable, so that the linker keeps
+	/// all activators, even if they are linked from static libraries:
+	///
+	///     static const Poco::OSP::StaticBundleResource connMgrResources[] =
+	///     {
+	///         {"extensions.xml", connMgrExtensions, sizeof(connMgrExtensions) - 1},
+	///         {0, 0, 0}
+	///     };
+	///
+	///     static const Poco::OSP::StaticBundleInfo bundles[] =
+	///     {
+	///         POCO_OSP_STATIC_BUNDLE("com.acme.connmgr", connMgrManifest, ConnManager::BundleActivator, connMgrResources),
+	///         POCO_OSP_STATIC_BUNDLE_END
+	///     };
+	///
+	///     Poco::OSP::StaticBundleRegistry registry(bundles);
+	///     registry.install(loader, language);
+	///     loader.resolveAllBundles();
+	///     loader.startAllBundles();
+	///
+	/// StaticOSPSubsystem does this for an Application.
+{
+public:
+	explicit StaticBundleRegistry(const StaticBundleInfo* pBundles):
+		_pBundles(pBundles)
+		/// Creates the StaticBundleRegistry for the given table, which
+		/// is terminated by POCO_OSP_STATIC_BUNDLE_END.
+	{
+		poco_check_ptr (pBundles);
+	}
+
+	~StaticBundleRegistry()
+		/// Destroys the StaticBundleRegistry.
+	{
+	}
+
+	void install(BundleLoader& loader, const LanguageTag& language) const
+		/// Registers the activators of all bundles and loads
+		/// the bundles with the given BundleLoader.
+		///
+		/// Throws a Poco::NotImplementedException if a bundle has an
+		/// activator and OSP has been built without POCO_OSP_STATIC.
+	{
+		for (const StaticBundleInfo* pInfo = _pBundles; pInfo->symbolicName; ++pInfo)
+		{
+			if (pInfo->createActivator)
+			{
+#if defined(POCO_OSP_STATIC)
+				loader.registerBundleActivator(pInfo->activatorClass, new ActivatorFactory(pInfo->createActivator));
+#else
+				throw Poco::NotImplementedException("static bundle activators require POCO_OSP_STATIC", pInfo->symbolicName);
+#endif
+			}
+			BundleStorage::Ptr pStorage = new StaticBundleStorage(*pInfo);
+			Bundle::Ptr pBundle = new StaticBundle(loader.nextBundleId(), loader, pStorage, language);
+			loader.loadBundle(pBundle);
+		}
+	}
+
+	const StaticBundleInfo* find(const std::string& symbolicName) const
+		/// Returns the entry for the bundle with the
+		/// given symbolic name, or null if there is none.
+	{
+		for (const StaticBundleInfo* pInfo = _pBundles; pInfo->symbolicName; ++pInfo)
+		{
+			if (symbolicName == pInfo->symbolicName) return pInfo;
+		}
+		return 0;
+	}
+
+	std::size_t count() const
+		/// Returns the number of bundles in the table.
+	{
+		std::size_t n = 0;
+		for (const StaticBundleInfo* pInfo = _pBundles; pInfo->symbolicName; ++pInfo) ++n;
+		return n;
+	}
+
+	static bool isStatic(const Bundle& bundle)
+		/// Returns true if the given bundle has
+		/// been installed from a StaticBundleInfo.
+	{
+		return bundle.path().compare(0, 7, "static:") == 0;
+	}
+
+protected:
+	class StaticBundle: public Bundle
+	{
+	public:
+		StaticBundle(int id, BundleLoader& loader, BundleStorage::Ptr pStorage, const LanguageTag& language):
+			Bundle(id, loader, pStorage, language)
+		{
+		}
+	};
+
+#if defined(POCO_OSP_STATIC)
+	class ActivatorFactory: public BundleLoader::BundleActivatorFactory
+	{
+	public:
+		explicit ActivatorFactory(BundleActivator* (*create)()):
+			_create(create)
+		{
+		}
+
+		BundleActivator* createInstance() const
+		{
+			return _create();
+		}
+
+	private:
+		BundleActivator* (*_create)();
+	};
+#endif
+
+private:
+	StaticBundleRegistry();
+
+	const StaticBundleInfo* _pBundles;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_StaticBundle_INCLUDED
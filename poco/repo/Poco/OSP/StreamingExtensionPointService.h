@@ -0,0 +1,630 @@
+//
+// StreamingExtensionPointService.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: ExtensionPoint
+// Module:  StreamingExtensionPointService
+//
+// Definition of the ExtensionElement, StreamingExtensionPoint and
+// StreamingExtensionPointService classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_StreamingExtensionPointService_INCLUDED
+#define OSP_StreamingExtensionPointService_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/OSP/Bundle.h"
+#include "Poco/OSP/BundleEvents.h"
+#include "Poco/OSP/BundleEvent.h"
+#include "Poco/OSP/ExtensionPointService.h"
+#include "Poco/SAX/SAXParser.h"
+#include "Poco/SAX/DefaultHandler.h"
+#include "Poco/SAX/Attributes.h"
+#include "Poco/SAX/InputSource.h"
+#include "Poco/XML/XMLString.h"
+#include "Poco/BinaryWriter.h"
+#include "Poco/BinaryReader.h"
+#include "Poco/FileStream.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Timestamp.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Delegate.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class ExtensionElement
+	/// ExtensionElement is a compact view of an element in a
+	/// bundle's extensions.xml file, containing the element's name,
+	/// attributes, character data and child elements.
+	///
+	/// Unlike a Poco::XML::Element, an ExtensionElement does not
+	/// belong to a document and can be copied, cached and written
+	/// to a file.
+{
+public:
+	typedef std::vector<std::pair<std::string, std::string> > Attributes;
+	typedef std::vector<ExtensionElement> Children;
+
+	ExtensionElement()
+		/// Creates an empty ExtensionElement.
+	{
+	}
+
+	explicit ExtensionElement(const std::string& name):
+		_name(name)
+		/// Creates an ExtensionElement with the given name.
+	{
+	}
+
+	~ExtensionElement()
+		/// Destroys the ExtensionElement.
+	{
+	}
+
+	const std::string& name() const
+		/// Returns the name of the element.
+	{
+		return _name;
+	}
+
+	bool hasAttribute(const std::string& name) const
+		/// Returns true if the element has an attribute with the given name.
+	{
+		return findAttribute(name) != 0;
+	}
+
+	const std::string& getAttribute(const std::string& name) const
+		/// Returns the value of the attribute with the given name,
+		/// or an empty string if the element has no such attribute.
+	{
+		static const std::string EMPTY;
+		const std::string* pValue = findAttribute(name);
+		return pValue ? *pValue : EMPTY;
+	}
+
+	std::string getAttribute(const std::string& name, const std::string& deflt) const
+		/// Returns the value of the attribute with the given name,
+		/// or deflt if the element has no such attribute.
+	{
+		const std::string* pValue = findAttribute(name);
+		return pValue ? *pValue : deflt;
+	}
+
+	const Attributes& attributes() const
+		/// Returns the attributes of the element, in document order.
+	{
+		return _attributes;
+	}
+
+	const std::string& text() const
+		/// Returns the character data directly contained in the element.
+	{
+		return _text;
+	}
+
+	const Children& children() const
+		/// Returns the child elements, in document order.
+	{
+		return _children;
+	}
+
+	const ExtensionElement* getChildElement(const std::string& name) const
+		/// Returns the first child element with the given name,
+		/// or a null pointer if there is none.
+	{
+		for (Children::const_iterator it = _children.begin(); it != _children.end(); ++it)
+		{
+			if (it->_name == name) return &*it;
+		}
+		return 0;
+	}
+
+	void setAttribute(const std::string& name, const std::string& value)
+		/// Adds an attribute to the element.
+	{
+		_attributes.push_back(std::make_pair(name, value));
+	}
+
+	void appendText(const std::string& text)
+		/// Appends character data to the element.
+	{
+		_text += text;
+	}
+
+	ExtensionElement& appendChild(const std::string& name)
+		/// Appends a child element with the given name and returns it.
+	{
+		_children.push_back(ExtensionElement(name));
+		return _children.back();
+	}
+
+	void write(Poco::BinaryWriter& writer) const
+		/// Writes the element and its children.
+	{
+		writer << _name << _text;
+		writer.write7BitEncoded(static_cast<Poco::UInt32>(_attributes.size()));
+		for (Attributes::const_iterator it = _attributes.begin(); it != _attributes.end(); ++it)
+		{
+			writer << it->first << it->second;
+		}
+		writer.write7BitEncoded(static_cast<Poco::UInt32>(_children.size()));
+		for (Children::const_iterator it = _children.begin(); it != _children.end(); ++it)
+		{
+			it->write(writer);
+		}
+	}
+
+	void read(Poco::BinaryReader& reader)
+		/// Reads an element written with write().
+	{
+		reader >> _name >> _text;
+		Poco::UInt32 n;
+		reader.read7BitEncoded(n);
+		_attributes.resize(n);
+		for (Attributes::iterator it = _attributes.begin(); it != _attributes.end() && reader.good(); ++it)
+		{
+			reader >> it->first >> it->second;
+		}
+		reader.read7BitEncoded(n);
+		_children.resize(n);
+		for (Children::iterator it = _children.begin(); it != _children.end() && reader.good(); ++it)
+		{
+			it->read(reader);
+		}
+	}
+
+protected:
+	const std::string* findAttribute(const std::string& name) const
+	{
+		for (Attributes::const_iterator it = _attributes.begin(); it != _attributes.end(); ++it)
+		{
+			if (it->first == name) return &it->second;
+		}
+		return 0;
+	}
+
+private:
+	std::string _name;
+	Attributes _attributes;
+	std::string _text;
+	Children _children;
+};
+
+
+class StreamingExtensionPoint: public Poco::RefCountedObject
+	/// StreamingExtensionPoint is the interface for extension points
+	/// registered with the StreamingExtensionPointService.
+	///
+	/// It corresponds to ExtensionPoint, but receives extensions as
+	/// ExtensionElement instead of Poco::XML::Element.
+{
+public:
+	typedef Poco::AutoPtr<StreamingExtensionPoint> Ptr;
+
+	virtual void handleExtension(Bundle::ConstPtr pBundle, const ExtensionElement& extension) = 0;
+		/// Handles an extension element (<extension point="...">)
+		/// from the given bundle's extensions.xml file.
+
+	virtual void removeExtension(Bundle::ConstPtr pBundle) = 0;
+		/// Removes all extensions contributed by the given bundle,
+		/// after the bundle has been stopped.
+
+protected:
+	StreamingExtensionPoint()
+	{
+	}
+
+	~StreamingExtensionPoint()
+	{
+	}
+};
+
+
+class ExtensionDescriptorHandler: public Poco::XML::DefaultHandler
+	/// A SAX ContentHandler that collects the extension elements
+	/// of an extensions.xml file into ExtensionElement trees, without
+	/// building a DOM document.
+{
+public:
+	typedef std::vector<ExtensionElement> Extensions;
+
+	explicit ExtensionDescriptorHandler(Extensions& extensions):
+		_extensions(extensions),
+		_depth(0)
+	{
+	}
+
+	~ExtensionDescriptorHandler()
+	{
+	}
+
+	void startElement(const Poco::XML::XMLString&, const Poco::XML::XMLString&, const Poco::XML::XMLString& qname, const Poco::XML::Attributes& attributes)
+	{
+		++_depth;
+		ExtensionElement* pElement = 0;
+		if (_depth == 2)
+		{
+			if (Poco::XML::fromXMLString(qname) != ExtensionPointService::EXTENSION_ELEM) return;
+			_extensions.push_back(ExtensionElement(ExtensionPointService::EXTENSION_ELEM));
+			pElement = &_extensions.back();
+		}
+		else if (_depth > 2 && !_stack.empty() && _stack.size() == static_cast<std::size_t>(_depth - 2))
+		{
+			pElement = &_stack.back()->appendChild(Poco::XML::fromXMLString(qname));
+		}
+		else return;
+
+		for (int i = 0; i < attributes.getLength(); ++i)
+		{
+			pElement->setAttribute(Poco::XML::fromXMLString(attributes.getQName(i)), Poco::XML::fromXMLString(attributes.getValue(i)));
+		}
+		_stack.push_back(pElement);
+	}
+
+	void endElement(const Poco::XML::XMLString&, const Poco::XML::XMLString&, const Poco::XML::XMLString&)
+	{
+		if (!_stack.empty() && _stack.size() == static_cast<std::size_t>(_depth - 1)) _stack.pop_back();
+		--_depth;
+	}
+
+	void characters(const Poco::XML::XMLChar ch[], int start, int length)
+	{
+		if (!_stack.empty() && _stack.size() == static_cast<std::size_t>(_depth - 1))
+		{
+			_stack.back()->appendText(Poco::XML::fromXMLString(Poco::XML::XMLString(ch + start, length)));
+		}
+	}
+
+private:
+	Extensions& _extensions;
+	std::vector<ExtensionElement*> _stack;
+	int _depth;
+};
+
+
+class StreamingExtensionPointService: public Service
+	/// StreamingExtensionPointService processes the extensions.xml
+	/// files of bundles with a SAX parser, and passes the extension
+	/// elements to the StreamingExtensionPoint registered for their
+	/// point attribute.
+	///
+	/// The service runs alongside the ExtensionPointService, which
+	/// passes the same extensions as DOM elements to its ExtensionPoint
+	/// instances. An extension is handled by both services if extension
+	/// points for the same name are registered with both.
+	///
+	/// The parsed extensions of a bundle are kept in memory, so that a
+	/// bundle that is stopped and started again is not parsed again. If
+	/// a cache directory is given, the parsed extensions are also saved
+	/// there, and loaded on the next start of the application, as long
+	/// as the bundle's version, path and modification time are unchanged.
+	///
+	/// StreamingExtensionPointService is thread-safe. Extension points
+	/// are called without holding the service's lock.
+{
+public:
+	typedef Poco::AutoPtr<StreamingExtensionPointService> Ptr;
+	typedef std::vector<ExtensionElement> Extensions;
+	typedef Poco::SharedPtr<Extensions> ExtensionsPtr;
+
+	explicit StreamingExtensionPointService(BundleEvents& events, const std::string& cacheDirectory = std::string()):
+		_events(events)
+		/// Creates the StreamingExtensionPointService and subscribes
+		/// to the bundleStarted and bundleStopped events.
+		///
+		/// If cacheDirectory is not empty, parsed extensions are
+		/// saved to and loaded from the given directory.
+	{
+		if (!cacheDirectory.empty())
+		{
+			Poco::Path dir(cacheDirectory);
+			dir.makeDirectory();
+			_cacheDirectory = dir.toString();
+			Poco::File(_cacheDirectory).createDirectories();
+		}
+		_events.bundleStarted += Poco::delegate(this, &StreamingExtensionPointService::onBundleStarted);
+		_events.bundleStopped += Poco::delegate(this, &StreamingExtensionPointService::onBundleStopped);
+	}
+
+	void registerExtensionPoint(Bundle::ConstPtr pBundle, const std::string& id, StreamingExtensionPoint::Ptr pExtensionPoint)
+		/// Registers the extension point with the given id, provided
+		/// by the given bundle.
+		///
+		/// Throws a Poco::ExistsException if an extension point
+		/// with the same id has already been registered.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (_points.find(id) != _points.end()) throw Poco::ExistsException("Extension point", id);
+		PointInfo& info = _points[id];
+		info.pBundle = pBundle;
+		info.pPoint = pExtensionPoint;
+	}
+
+	void unregisterExtensionPoint(const std::string& id)
+		/// Unregisters the extension point with the given id.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_points.erase(id);
+	}
+
+	void unregisterBundle(Bundle::ConstPtr pBundle)
+		/// Unregisters all extension points provided by the given bundle.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		PointMap::iterator it = _points.begin();
+		while (it != _points.end())
+		{
+			if (it->second.pBundle == pBundle)
+				_points.erase(it++);
+			else
+				++it;
+		}
+	}
+
+	ExtensionsPtr extensions(Bundle::ConstPtr pBundle)
+		/// Returns the extension elements of the given bundle's
+		/// extensions.xml file, from the cache if possible.
+		///
+		/// The returned list is shared with the cache and
+		/// must not be modified.
+	{
+		Poco::Timestamp modified;
+		descriptorModified(*pBundle, modified);
+		std::string version = pBundle->version().toString();
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			DescriptorMap::const_iterator it = _descriptors.find(pBundle->symbolicName());
+			if (it != _descriptors.end() && it->second.matches(*pBundle, version, modified)) return it->second.pExtensions;
+		}
+
+		Descriptor descriptor;
+		descriptor.path = pBundle->path();
+		descriptor.version = version;
+		descriptor.modified = modified;
+		if (!loadDescriptor(pBundle->symbolicName(), descriptor))
+		{
+			descriptor.pExtensions = parse(*pBundle);
+			saveDescriptor(pBundle->symbolicName(), descriptor);
+		}
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_descriptors[pBundle->symbolicName()] = descriptor;
+		return descriptor.pExtensions;
+	}
+
+	void clearCache()
+		/// Removes all cached extensions from memory.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_descriptors.clear();
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(StreamingExtensionPointService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(StreamingExtensionPointService), otherType) || Service::isA(otherType);
+	}
+
+protected:
+	struct PointInfo
+	{
+		Bundle::Ptr pBundle;
+		StreamingExtensionPoint::Ptr pPoint;
+	};
+
+	struct Descriptor
+	{
+		bool matches(const Bundle& bundle, const std::string& bundleVersion, const Poco::Timestamp& bundleModified) const
+		{
+			return version == bundleVersion && modified == bundleModified && path == bundle.path();
+		}
+
+		std::string path;
+		std::string version;
+		Poco::Timestamp modified;
+		ExtensionsPtr pExtensions;
+	};
+
+	typedef std::map<std::string, PointInfo> PointMap;
+	typedef std::map<std::string, Descriptor> DescriptorMap;
+	typedef std::map<std::string, std::set<std::string> > ContributionMap;
+
+	~StreamingExtensionPointService()
+	{
+		try
+		{
+			_events.bundleStarted -= Poco::delegate(this, &StreamingExtensionPointService::onBundleStarted);
+			_events.bundleStopped -= Poco::delegate(this, &StreamingExtensionPointService::onBundleStopped);
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void onBundleStarted(const void*, BundleEvent& event)
+	{
+		Bundle::ConstPtr pBundle = event.bundle();
+		ExtensionsPtr pExtensions = extensions(pBundle);
+		for (Extensions::const_iterator it = pExtensions->begin(); it != pExtensions->end(); ++it)
+		{
+			const std::string& point = it->getAttribute(ExtensionPointService::POINT_ATTR);
+			StreamingExtensionPoint::Ptr pPoint;
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				PointMap::const_iterator itP = _points.find(point);
+				if (itP == _points.end()) continue;
+				pPoint = itP->second.pPoint;
+				_contributions[pBundle->symbolicName()].insert(point);
+			}
+			pPoint->handleExtension(pBundle, *it);
+		}
+	}
+
+	void onBundleStopped(const void*, BundleEvent& event)
+	{
+		Bundle::ConstPtr pBundle = event.bundle();
+		std::vector<StreamingExtensionPoint::Ptr> points;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			ContributionMap::iterator it = _contributions.find(pBundle->symbolicName());
+			if (it == _contributions.end()) return;
+			for (std::set<std::string>::const_iterator itC = it->second.begin(); itC != it->second.end(); ++itC)
+			{
+				PointMap::const_iterator itP = _points.find(*itC);
+				if (itP != _points.end()) points.push_back(itP->second.pPoint);
+			}
+			_contributions.erase(it);
+		}
+		for (std::vector<StreamingExtensionPoint::Ptr>::iterator it = points.begin(); it != points.end(); ++it)
+		{
+			(*it)->removeExtension(pBundle);
+		}
+	}
+
+	static void descriptorModified(const Bundle& bundle, Poco::Timestamp& modified)
+	{
+		try
+		{
+			Poco::File file(bundle.path());
+			modified = file.getLastModified();
+			if (file.isDirectory())
+			{
+				Poco::Path xmlPath(bundle.path());
+				xmlPath.makeDirectory();
+				xmlPath.setFileName(ExtensionPointService::EXTENSIONS_XML);
+				Poco::File xmlFile(xmlPath);
+				if (xmlFile.exists()) modified = xmlFile.getLastModified();
+			}
+		}
+		catch (Poco::FileException&)
+		{
+			modified = 0;
+		}
+	}
+
+	static ExtensionsPtr parse(const Bundle& bundle)
+	{
+		Poco::SharedPtr<Extensions> pExtensions = new Extensions;
+		Poco::SharedPtr<std::istream> pStream(bundle.getResource(ExtensionPointService::EXTENSIONS_XML));
+		if (pStream)
+		{
+			ExtensionDescriptorHandler handler(*pExtensions);
+			Poco::XML::InputSource source(*pStream);
+			Poco::XML::SAXParser parser;
+			parser.setFeature(Poco::XML::XMLReader::FEATURE_NAMESPACES, false);
+			parser.setContentHandler(&handler);
+			parser.parse(&source);
+		}
+		return pExtensions;
+	}
+
+	std::string cachePath(const std::string& symbolicName) const
+	{
+		std::string path(_cacheDirectory);
+		path += symbolicName;
+		path += ".xpc";
+		return path;
+	}
+
+	bool loadDescriptor(const std::string& symbolicName, Descriptor& descriptor) const
+	{
+		if (_cacheDirectory.empty()) return false;
+
+		std::string path = cachePath(symbolicName);
+		if (!Poco::File(path).exists()) return false;
+
+		Poco::FileInputStream istr(path);
+		Poco::BinaryReader reader(istr);
+		std::string magic;
+		std::string bundlePath;
+		std::string version;
+		Poco::Int64 modified;
+		Poco::UInt32 n;
+		reader >> magic >> bundlePath >> version >> modified;
+		reader.read7BitEncoded(n);
+		if (!reader.good() || magic != "OSP-XPC 1" || bundlePath != descriptor.path || version != descriptor.version || modified != descriptor.modified.epochMicroseconds()) return false;
+
+		Poco::SharedPtr<Extensions> pExtensions = new Extensions(n);
+		for (Extensions::iterator it = pExtensions->begin(); it != pExtensions->end() && reader.good(); ++it)
+		{
+			it->read(reader);
+		}
+		if (!reader.good()) return false;
+		descriptor.pExtensions = pExtensions;
+		return true;
+	}
+
+	void saveDescriptor(const std::string& symbolicName, const Descriptor& descriptor) const
+	{
+		if (_cacheDirectory.empty()) return;
+
+		std::string path = cachePath(symbolicName);
+		std::string tmpPath(path);
+		tmpPath += ".tmp";
+		try
+		{
+			{
+				Poco::FileOutputStream ostr(tmpPath);
+				Poco::BinaryWriter writer(ostr);
+				writer << std::string("OSP-XPC 1") << descriptor.path << descriptor.version << static_cast<Poco::Int64>(descriptor.modified.epochMicroseconds());
+				writer.write7BitEncoded(static_cast<Poco::UInt32>(descriptor.pExtensions->size()));
+				for (Extensions::const_iterator it = descriptor.pExtensions->begin(); it != descriptor.pExtensions->end(); ++it)
+				{
+					it->write(writer);
+				}
+				writer.flush();
+				ostr.close();
+				if (!ostr.good()) throw Poco::WriteFileException(tmpPath);
+			}
+			Poco::File(tmpPath).renameTo(path);
+		}
+		catch (Poco::Exception&)
+		{
+			// The cache is an optimization only; the
+			// extensions are parsed again next time.
+		}
+	}
+
+private:
+	StreamingExtensionPointService(const StreamingExtensionPointService&);
+	StreamingExtensionPointService& operator = (const StreamingExtensionPointService&);
+
+	BundleEvents& _events;
+	std::string _cacheDirectory;
+	PointMap _points;
+	DescriptorMap _descriptors;
+	ContributionMap _contributions;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_StreamingExtensionPointService_INCLUDED
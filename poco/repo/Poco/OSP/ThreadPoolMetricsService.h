@@ -0,0 +1,147 @@
+//
+// ThreadPoolMetricsService.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  ThreadPoolMetricsService
+//
+// Definition of the ThreadPoolMetricsService class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_ThreadPoolMetricsService_INCLUDED
+#define OSP_ThreadPoolMetricsService_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/ThreadPoolMetrics.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Mutex.h"
+#include <map>
+#include <vector>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class ThreadPoolMetricsService: public Service
+	/// The ThreadPoolMetricsService keeps the latest statistics
+	/// of all InstrumentedThreadPool objects that report to it,
+	/// so that bundles can query them, e.g. to size the pools
+	/// of a RemotingNG server from data collected in the field.
+	///
+	/// Register the service with the ServiceRegistry under
+	/// serviceName(), and add the sink returned by sink() to
+	/// the InstrumentedThreadPool objects to be reported.
+{
+public:
+	typedef Poco::AutoPtr<ThreadPoolMetricsService> Ptr;
+
+	static const std::string& serviceName()
+		/// Returns the name under which the service
+		/// should be registered.
+	{
+		static const std::string name("osp.core.threadpoolmetrics");
+		return name;
+	}
+
+	Poco::BasicEvent<const Poco::ThreadPoolStatistics> reported;
+		/// Fired whenever a pool reports its statistics.
+
+	ThreadPoolMetricsService()
+		/// Creates the ThreadPoolMetricsService.
+	{
+	}
+
+	Poco::ThreadPoolMetricsSink::Ptr sink()
+		/// Returns a sink for InstrumentedThreadPool::addSink()
+		/// that passes statistics to this service.
+	{
+		return new Sink(Ptr(this, true));
+	}
+
+	void update(const Poco::ThreadPoolStatistics& statistics)
+		/// Stores the statistics of a pool and fires the reported event.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_statistics[statistics.pool] = statistics;
+		}
+		reported(this, statistics);
+	}
+
+	bool statistics(const std::string& pool, Poco::ThreadPoolStatistics& statistics) const
+		/// Copies the latest statistics of the given pool and returns
+		/// true, or returns false if the pool has not reported yet.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Statistics::const_iterator it = _statistics.find(pool);
+		if (it == _statistics.end()) return false;
+		statistics = it->second;
+		return true;
+	}
+
+	void pools(std::vector<std::string>& names) const
+		/// Returns the names of all pools that have reported.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (Statistics::const_iterator it = _statistics.begin(); it != _statistics.end(); ++it)
+		{
+			names.push_back(it->first);
+		}
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(ThreadPoolMetricsService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(ThreadPoolMetricsService), otherType) || Service::isA(otherType);
+	}
+
+protected:
+	~ThreadPoolMetricsService()
+	{
+	}
+
+private:
+	class Sink: public Poco::ThreadPoolMetricsSink
+	{
+	public:
+		Sink(const ThreadPoolMetricsService::Ptr& pService):
+			_pService(pService)
+		{
+		}
+
+		void report(const Poco::ThreadPoolStatistics& statistics)
+		{
+			_pService->update(statistics);
+		}
+
+	private:
+		ThreadPoolMetricsService::Ptr _pService;
+	};
+
+	typedef std::map<std::string, Poco::ThreadPoolStatistics> Statistics;
+
+	Statistics _statistics;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_ThreadPoolMetricsService_INCLUDED
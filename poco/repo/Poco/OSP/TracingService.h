@@ -0,0 +1,294 @@
+//
+// TracingService.h
+//
+// $Id$
+//
+// Library: OSP
+// Package: Util
+// Module:  TracingService
+//
+// Definition of the TracingService class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_TracingService_INCLUDED
+#define OSP_TracingService_INCLUDED
+
+
+#include "Poco/OSP/OSP.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/OSP/BundleEvents.h"
+#include "Poco/OSP/BundleEvent.h"
+#include "Poco/OSP/ServiceRegistry.h"
+#include "Poco/OSP/ServiceEvent.h"
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/Tracer.h"
+#include "Poco/Delegate.h"
+#include "Poco/Mutex.h"
+#include "Poco/String.h"
+#include <map>
+
+
+namespace Poco {
+namespace OSP {
+
+
+class TracingService: public Service
+	/// The TracingService records the start and stop of bundles, and
+	/// the registration of services, with the Poco::Tracer, and switches
+	/// tracing on and off according to the application configuration,
+	/// so that the startup of a system can be traced without rebuilding
+	/// it.
+	///
+	/// Bundle starts and stops are recorded as spans named
+	/// "start <symbolic name>" and "stop <symbolic name>", service
+	/// registrations as instant events named after the service, all in
+	/// category "osp". Remoting calls (see TimedMethodHandler) and event
+	/// notifications are traced by the Tracer itself.
+	///
+	/// The following configuration properties are used by configure():
+	///   - osp.tracing.enable:      enable tracing (defaults to false)
+	///   - osp.tracing.bufferSize:  number of events kept per thread
+	///                              (defaults to Tracer::DEFAULT_BUFFER_SIZE)
+	///   - osp.tracing.path:        file the trace is written to by save()
+	///   - osp.tracing.format:      "binary" (default) or "json"
+	///   - osp.tracing.startupOnly: stop tracing and write the trace
+	///                              when startupComplete() is called
+	///
+	/// To trace the start of all bundles, the service must be created
+	/// before the bundles are started, e.g. in a subclass of OSPSubsystem:
+	///
+	///     void startBundles(Poco::Util::Application& app)
+	///     {
+	///         _pTracing = new TracingService(bundleLoader().events(), serviceRegistry());
+	///         _pTracing->configure(app.config());
+	///         serviceRegistry().registerService(TracingService::serviceName(), _pTracing, Properties());
+	///         OSPSubsystem::startBundles(app);
+	///         _pTracing->startupComplete();
+	///     }
+	///
+	/// Both the BundleEvents and the ServiceRegistry must outlive the
+	/// TracingService.
+{
+public:
+	typedef Poco::AutoPtr<TracingService> Ptr;
+
+	static const std::string& serviceName()
+		/// Returns the name under which the service
+		/// should be registered.
+	{
+		static const std::string name("osp.core.tracing");
+		return name;
+	}
+
+	TracingService(BundleEvents& events, ServiceRegistry& registry):
+		_events(events),
+		_registry(registry),
+		_format(Poco::Tracer::FORMAT_BINARY),
+		_startupOnly(false)
+		/// Creates the TracingService, which subscribes to the
+		/// given BundleEvents and ServiceRegistry.
+	{
+		_events.bundleStarting += Poco::delegate(this, &TracingService::onBundleStarting);
+		_events.bundleStarted += Poco::delegate(this, &TracingService::onBundleStarted);
+		_events.bundleFailed += Poco::delegate(this, &TracingService::onBundleFailed);
+		_events.bundleStopping += Poco::delegate(this, &TracingService::onBundleStopping);
+		_events.bundleStopped += Poco::delegate(this, &TracingService::onBundleStopped);
+		_registry.serviceRegistered += Poco::delegate(this, &TracingService::onServiceRegistered);
+	}
+
+	void configure(const Poco::Util::AbstractConfiguration& config)
+		/// Applies the osp.tracing configuration properties.
+	{
+		Poco::Tracer& tracer = Poco::Tracer::instance();
+		int bufferSize = config.getInt("osp.tracing.bufferSize", Poco::Tracer::DEFAULT_BUFFER_SIZE);
+		if (bufferSize > 0) tracer.setBufferSize(static_cast<std::size_t>(bufferSize));
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_path = config.getString("osp.tracing.path", "");
+			_format = Poco::icompare(config.getString("osp.tracing.format", "binary"), "json") == 0 ? Poco::Tracer::FORMAT_JSON : Poco::Tracer::FORMAT_BINARY;
+			_startupOnly = config.getBool("osp.tracing.startupOnly", false);
+		}
+		if (config.getBool("osp.tracing.enable", false))
+			tracer.enable();
+		else
+			tracer.disable();
+	}
+
+	void enable()
+		/// Enables tracing.
+	{
+		Poco::Tracer::instance().enable();
+	}
+
+	void disable()
+		/// Disables tracing.
+	{
+		Poco::Tracer::instance().disable();
+	}
+
+	bool isEnabled() const
+		/// Returns true if tracing is enabled.
+	{
+		return Poco::Tracer::isEnabled();
+	}
+
+	void collect(Poco::Tracer::Trace& trace) const
+		/// Copies the events recorded so far into trace.
+	{
+		Poco::Tracer::instance().collect(trace);
+	}
+
+	void save(const std::string& path, Poco::Tracer::Format format) const
+		/// Writes the events recorded so far to the given file.
+	{
+		Poco::Tracer::instance().save(path, format);
+	}
+
+	bool save() const
+		/// Writes the events recorded so far to the file given by
+		/// osp.tracing.path, and returns true, or returns false if
+		/// no path has been configured.
+	{
+		std::string path;
+		Poco::Tracer::Format format;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			path = _path;
+			format = _format;
+		}
+		if (path.empty()) return false;
+		Poco::Tracer::instance().save(path, format);
+		return true;
+	}
+
+	void startupComplete()
+		/// Stops tracing and writes the trace if osp.tracing.startupOnly
+		/// has been set and tracing is enabled. Otherwise, does nothing.
+	{
+		bool startupOnly;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			startupOnly = _startupOnly;
+		}
+		if (startupOnly && Poco::Tracer::isEnabled())
+		{
+			Poco::Tracer::instance().disable();
+			save();
+		}
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(TracingService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(TracingService), otherType) || Service::isA(otherType);
+	}
+
+protected:
+	~TracingService()
+	{
+		try
+		{
+			_registry.serviceRegistered -= Poco::delegate(this, &TracingService::onServiceRegistered);
+			_events.bundleStopped -= Poco::delegate(this, &TracingService::onBundleStopped);
+			_events.bundleStopping -= Poco::delegate(this, &TracingService::onBundleStopping);
+			_events.bundleFailed -= Poco::delegate(this, &TracingService::onBundleFailed);
+			_events.bundleStarted -= Poco::delegate(this, &TracingService::onBundleStarted);
+			_events.bundleStarting -= Poco::delegate(this, &TracingService::onBundleStarting);
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void onBundleStarting(const void*, BundleEvent& ev)
+	{
+		begin(ev, _starting);
+	}
+
+	void onBundleStarted(const void*, BundleEvent& ev)
+	{
+		end(ev, _starting, "start ");
+	}
+
+	void onBundleFailed(const void*, BundleEvent& ev)
+	{
+		end(ev, _starting, "start ");
+	}
+
+	void onBundleStopping(const void*, BundleEvent& ev)
+	{
+		begin(ev, _stopping);
+	}
+
+	void onBundleStopped(const void*, BundleEvent& ev)
+	{
+		end(ev, _stopping, "stop ");
+	}
+
+	void onServiceRegistered(const void*, ServiceEvent& ev)
+	{
+		if (Poco::Tracer::isEnabled())
+		{
+			Poco::Tracer::instant("osp", Poco::Tracer::instance().intern(ev.service()->name()));
+		}
+	}
+
+private:
+	typedef std::map<int, Poco::UInt64> StartMap;
+
+	void begin(BundleEvent& ev, StartMap& starts)
+	{
+		if (Poco::Tracer::isEnabled())
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			starts[ev.bundle()->id()] = Poco::Tracer::now();
+		}
+	}
+
+	void end(BundleEvent& ev, StartMap& starts, const char* prefix)
+		/// Records a span from the matching begin(), which
+		/// has been called in the same thread.
+	{
+		Poco::UInt64 start;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			StartMap::iterator it = starts.find(ev.bundle()->id());
+			if (it == starts.end()) return;
+			start = it->second;
+			starts.erase(it);
+		}
+		Poco::Tracer& tracer = Poco::Tracer::instance();
+		const char* name = tracer.intern(prefix + ev.bundle()->symbolicName());
+		tracer.record(Poco::Tracer::PHASE_COMPLETE, "osp", name, start, Poco::Tracer::now() - start);
+	}
+
+	TracingService(const TracingService&);
+	TracingService& operator = (const TracingService&);
+
+	BundleEvents& _events;
+	ServiceRegistry& _registry;
+	std::string _path;
+	Poco::Tracer::Format _format;
+	bool _startupOnly;
+	StartMap _starting;
+	StartMap _stopping;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::OSP
+
+
+#endif // OSP_TracingService_INCLUDED
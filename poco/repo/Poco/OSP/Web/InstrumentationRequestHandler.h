@@ -0,0 +1,100 @@
+//
+// InstrumentationRequestHandler.h
+//
+// $Id$
+//
+// Library: OSP/Web
+// Package: Web
+// Module:  InstrumentationRequestHandler
+//
+// Definition of the InstrumentationRequestHandler and
+// InstrumentationRequestHandlerFactory classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_Web_InstrumentationRequestHandler_INCLUDED
+#define OSP_Web_InstrumentationRequestHandler_INCLUDED
+
+
+#include "Poco/OSP/Web/Web.h"
+#include "Poco/OSP/Web/WebRequestHandlerFactory.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Instrumentation.h"
+#include <sstream>
+
+
+namespace Poco {
+namespace OSP {
+namespace Web {
+
+
+class InstrumentationRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Sends the probes of the Poco::Instrumentation registry,
+	/// as written by Poco::Instrumentation::dump(), as text/plain.
+{
+public:
+	InstrumentationRequestHandler()
+	{
+	}
+
+	~InstrumentationRequestHandler()
+	{
+	}
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+	{
+		std::ostringstream ostr;
+		Poco::Instrumentation::instance().dump(ostr);
+		std::string body = ostr.str();
+		response.setContentType("text/plain");
+		response.set("Cache-Control", "no-cache");
+		response.setContentLength(static_cast<std::streamsize>(body.size()));
+		if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_HEAD)
+			response.send();
+		else
+			response.sendBuffer(body.data(), body.size());
+	}
+
+private:
+	InstrumentationRequestHandler(const InstrumentationRequestHandler&);
+	InstrumentationRequestHandler& operator = (const InstrumentationRequestHandler&);
+};
+
+
+class InstrumentationRequestHandlerFactory: public WebRequestHandlerFactory
+	/// The factory for InstrumentationRequestHandler, to be exported
+	/// by a bundle and registered with the osp.web.server.requesthandler
+	/// extension point, e.g.:
+	///
+	///     <extension point="osp.web.server.requesthandler"
+	///                path="/instrumentation"
+	///                class="Poco::OSP::Web::InstrumentationRequestHandlerFactory"
+	///                permission="instrumentation"/>
+{
+public:
+	InstrumentationRequestHandlerFactory()
+	{
+	}
+
+	~InstrumentationRequestHandlerFactory()
+	{
+	}
+
+	Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest&)
+	{
+		return new InstrumentationRequestHandler;
+	}
+};
+
+
+} } } // namespace Poco::OSP::Web
+
+
+#endif // OSP_Web_InstrumentationRequestHandler_INCLUDED
@@ -0,0 +1,363 @@
+//
+// ShardedWebSessionManager.h
+//
+// $Id$
+//
+// Library: OSPWeb
+// Package: Web
+// Module:  ShardedWebSessionManager
+//
+// Definition of the ShardedWebSessionManager class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_Web_ShardedWebSessionManager_INCLUDED
+#define OSP_Web_ShardedWebSessionManager_INCLUDED
+
+
+#include "Poco/OSP/Web/Web.h"
+#include "Poco/OSP/Web/WebSession.h"
+#include "Poco/OSP/Web/WebSessionService.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/HTTPCookie.h"
+#include "Poco/Net/NameValueCollection.h"
+#include "Poco/RandomPool.h"
+#include "Poco/DigestEngine.h"
+#include "Poco/HexBinary.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Hash.h"
+#include "Poco/Mutex.h"
+#include <vector>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+namespace Web {
+
+
+class ShardedWebSessionManager: public WebSessionService<Poco::Net::HTTPServerRequest>
+	/// ShardedWebSessionManager is a WebSessionService managing HTTP
+	/// sessions using cookies, like WebSessionManager, for web servers
+	/// handling requests from many clients concurrently.
+	///
+	/// Sessions are distributed over a fixed number of shards by
+	/// session ID, each with its own mutex, so that requests for
+	/// different sessions rarely wait for each other. Session
+	/// attributes are protected by the WebSession's own mutex and
+	/// are never accessed with a shard locked.
+	///
+	/// Expired sessions are found with a timer wheel per shard, with
+	/// one bucket per second: a session is entered into the bucket for
+	/// its expiration time when it is created, and checked again only
+	/// when that bucket becomes due. A session that has been accessed
+	/// in the meantime is entered into the bucket for its new expiration
+	/// time. Expiring sessions therefore never requires a scan over all
+	/// sessions, and accessing a session never requires reordering.
+	///
+	/// Due buckets of a shard are processed when the shard is used.
+	/// To also remove sessions from shards that are not used for
+	/// a while, purge() can be called periodically, e.g. from a
+	/// Poco::Util::Timer task.
+	///
+	/// The ShardedWebSessionManager can be registered instead of the
+	/// WebSessionManager under the service name "osp.web.session".
+	/// Application names are handled the same way: they can contain
+	/// a cookie domain, separated by '@', and a cookie path, beginning
+	/// with a slash.
+{
+public:
+	typedef Poco::AutoPtr<ShardedWebSessionManager> Ptr;
+
+	enum CookiePersistence
+	{
+		COOKIE_TRANSIENT  = 1, /// Session cookies are transient (go away when browser is closed).
+		COOKIE_PERSISTENT = 2  /// Session cookies are persistent (kept in browser until they expire).
+	};
+
+	enum
+	{
+		SHARD_COUNT = 16,
+			/// Number of shards, must be a power of two.
+		WHEEL_SIZE = 512
+			/// Number of one-second buckets of the timer wheel.
+	};
+
+	ShardedWebSessionManager():
+		_cookiePersistence(COOKIE_PERSISTENT)
+		/// Creates the ShardedWebSessionManager.
+	{
+	}
+
+	~ShardedWebSessionManager()
+		/// Destroys the ShardedWebSessionManager.
+	{
+	}
+
+	void setDefaultDomain(const std::string& domain)
+		/// Sets the default domain for the session cookie.
+	{
+		_defaultDomain = domain;
+	}
+
+	const std::string& getDefaultDomain() const
+		/// Returns the default domain for the session cookie.
+	{
+		return _defaultDomain;
+	}
+
+	void setDefaultPath(const std::string& path)
+		/// Sets the default path for the session cookie.
+	{
+		_defaultPath = path;
+	}
+
+	const std::string& getDefaultPath() const
+		/// Returns the default path for the session cookie.
+	{
+		return _defaultPath;
+	}
+
+	void setCookiePersistence(CookiePersistence persistence)
+		/// Sets the cookie persistence, which controls whether
+		/// session cookies are transient (go away when the
+		/// browser is closed) or persistent (default).
+	{
+		_cookiePersistence = persistence;
+	}
+
+	CookiePersistence getCookiePersistence() const
+		/// Returns the cookie persistence.
+	{
+		return _cookiePersistence;
+	}
+
+	void purge()
+		/// Removes the expired sessions from all shards.
+	{
+		Poco::Timestamp now;
+		for (int i = 0; i < SHARD_COUNT; ++i)
+		{
+			std::vector<WebSession::Ptr> expired;
+			Poco::FastMutex::ScopedLock lock(_shards[i].mutex);
+			_shards[i].advance(now, expired);
+		}
+	}
+
+	std::size_t count() const
+		/// Returns the number of sessions, including
+		/// expired sessions not removed yet.
+	{
+		std::size_t n = 0;
+		for (int i = 0; i < SHARD_COUNT; ++i)
+		{
+			Poco::FastMutex::ScopedLock lock(_shards[i].mutex);
+			n += _shards[i].sessions.size();
+		}
+		return n;
+	}
+
+	// WebSessionService
+	WebSession::Ptr find(const std::string& appName, const Poco::Net::HTTPServerRequest& request)
+	{
+		std::string id = getId(appName, request);
+		if (id.empty()) return WebSession::Ptr();
+
+		Poco::Timestamp now;
+		std::vector<WebSession::Ptr> expired;
+		Shard& shard = shardFor(id);
+		Poco::FastMutex::ScopedLock lock(shard.mutex);
+		shard.advance(now, expired);
+		SessionMap::iterator it = shard.sessions.find(id);
+		if (it == shard.sessions.end()) return WebSession::Ptr();
+		WebSession::Ptr pSession = it->second;
+		if (pSession->getExpiration() <= now)
+		{
+			expired.push_back(pSession);
+			shard.sessions.erase(it);
+			return WebSession::Ptr();
+		}
+		pSession->access();
+		return pSession;
+	}
+
+	WebSession::Ptr get(const std::string& appName, const Poco::Net::HTTPServerRequest& request, int expireSeconds, BundleContext::Ptr pContext)
+	{
+		WebSession::Ptr pSession = find(appName, request);
+		if (!pSession) pSession = create(appName, request, expireSeconds, pContext);
+		return pSession;
+	}
+
+	WebSession::Ptr create(const std::string& appName, const Poco::Net::HTTPServerRequest& request, int expireSeconds, BundleContext::Ptr pContext)
+	{
+		std::string id = randomToken();
+		WebSession::Ptr pSession = new WebSession(id, expireSeconds, request.clientAddress().host(), pContext);
+		pSession->set(WebSession::CSRF_TOKEN, randomToken());
+		{
+			Poco::Timestamp now;
+			std::vector<WebSession::Ptr> expired;
+			Shard& shard = shardFor(id);
+			Poco::FastMutex::ScopedLock lock(shard.mutex);
+			shard.advance(now, expired);
+			shard.sessions[id] = pSession;
+			shard.schedule(id, pSession->getExpiration());
+		}
+		addCookie(appName, request, pSession);
+		return pSession;
+	}
+
+	void remove(WebSession::Ptr pSession)
+	{
+		Shard& shard = shardFor(pSession->id());
+		Poco::FastMutex::ScopedLock lock(shard.mutex);
+		shard.sessions.erase(pSession->id());
+		// The session's entry in the timer wheel is
+		// ignored when its bucket becomes due.
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(ShardedWebSessionManager);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(ShardedWebSessionManager), otherType) || WebSessionService<Poco::Net::HTTPServerRequest>::isA(otherType);
+	}
+
+protected:
+	typedef std::map<std::string, WebSession::Ptr> SessionMap;
+
+	struct Shard
+	{
+		Shard():
+			wheel(WHEEL_SIZE),
+			lastTick(0)
+		{
+		}
+
+		void schedule(const std::string& id, const Poco::Timestamp& expiration)
+		{
+			Poco::Int64 tick = expiration.epochTime() + 1;
+			if (tick <= lastTick) tick = lastTick + 1;
+			wheel[static_cast<std::size_t>(tick % WHEEL_SIZE)].push_back(id);
+		}
+
+		void advance(const Poco::Timestamp& now, std::vector<WebSession::Ptr>& expired)
+			/// Processes all buckets that have become due. Expired sessions
+			/// are moved to expired, so that they are destroyed, and their
+			/// sessionEnds event fired, after the shard has been unlocked.
+		{
+			Poco::Int64 nowTick = now.epochTime();
+			if (lastTick == 0) lastTick = nowTick;
+			if (nowTick <= lastTick) return;
+
+			Poco::Int64 steps = nowTick - lastTick;
+			if (steps > WHEEL_SIZE) steps = WHEEL_SIZE;
+			std::vector<std::string> due;
+			for (Poco::Int64 tick = nowTick - steps + 1; tick <= nowTick; ++tick)
+			{
+				std::vector<std::string>& bucket = wheel[static_cast<std::size_t>(tick % WHEEL_SIZE)];
+				due.insert(due.end(), bucket.begin(), bucket.end());
+				bucket.clear();
+			}
+			lastTick = nowTick;
+
+			for (std::vector<std::string>::const_iterator it = due.begin(); it != due.end(); ++it)
+			{
+				SessionMap::iterator itSession = sessions.find(*it);
+				if (itSession == sessions.end()) continue;
+				if (itSession->second->getExpiration() <= now)
+				{
+					expired.push_back(itSession->second);
+					sessions.erase(itSession);
+				}
+				else schedule(*it, itSession->second->getExpiration());
+			}
+		}
+
+		SessionMap sessions;
+		std::vector<std::vector<std::string> > wheel;
+		Poco::Int64 lastTick;
+		mutable Poco::FastMutex mutex;
+	};
+
+	Shard& shardFor(const std::string& id)
+	{
+		return _shards[Poco::hash(id) & (SHARD_COUNT - 1)];
+	}
+
+	std::string getId(const std::string& appName, const Poco::Net::HTTPServerRequest& request)
+	{
+		Poco::Net::NameValueCollection cookies;
+		request.getCookies(cookies);
+		return cookies.get(cookieName(appName), std::string());
+	}
+
+	void addCookie(const std::string& appName, const Poco::Net::HTTPServerRequest& request, WebSession::Ptr pSession)
+	{
+		Poco::Net::HTTPCookie cookie(cookieName(appName), pSession->id());
+		if (_cookiePersistence == COOKIE_PERSISTENT)
+		{
+			cookie.setMaxAge(pSession->timeout());
+		}
+		std::string domain = cookieDomain(appName);
+		if (!domain.empty()) cookie.setDomain(domain);
+		std::string path = cookiePath(appName);
+		if (!path.empty()) cookie.setPath(path);
+		cookie.setHttpOnly();
+		request.response().addCookie(cookie);
+	}
+
+	static std::string randomToken()
+	{
+		Poco::DigestEngine::Digest bytes(20);
+		Poco::RandomPool::fill(&bytes[0], bytes.size());
+		return Poco::HexBinary::encode(bytes);
+	}
+
+	std::string cookieName(const std::string& appName) const
+	{
+		std::string name("osp.web.session.");
+		name.append(appName, 0, appName.find_first_of("@/"));
+		return name;
+	}
+
+	std::string cookieDomain(const std::string& appName) const
+	{
+		std::string::size_type pos = appName.find('@');
+		if (pos == std::string::npos) return _defaultDomain;
+		std::string::size_type end = appName.find('/', pos);
+		return appName.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+	}
+
+	std::string cookiePath(const std::string& appName) const
+	{
+		std::string::size_type pos = appName.find('/');
+		if (pos == std::string::npos) return _defaultPath;
+		return appName.substr(pos);
+	}
+
+private:
+	ShardedWebSessionManager(const ShardedWebSessionManager&);
+	ShardedWebSessionManager& operator = (const ShardedWebSessionManager&);
+
+	Shard _shards[SHARD_COUNT];
+	std::string _defaultDomain;
+	std::string _defaultPath;
+	CookiePersistence _cookiePersistence;
+};
+
+
+} } } // namespace Poco::OSP::Web
+
+
+#endif // OSP_Web_ShardedWebSessionManager_INCLUDED
@@ -0,0 +1,390 @@
+//
+// StreamingWebFilter.h
+//
+// $Id$
+//
+// Library: OSPWeb
+// Package: Web
+// Module:  StreamingWebFilter
+//
+// Definition of the ChunkSink, ChunkFilter, ChunkFilterFactory,
+// GzipChunkFilter and StreamingWebFilter classes.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_Web_StreamingWebFilter_INCLUDED
+#define OSP_Web_StreamingWebFilter_INCLUDED
+
+
+#include "Poco/OSP/Web/Web.h"
+#include "Poco/OSP/Web/WebFilter.h"
+#include "Poco/OSP/Web/WebResourceCache.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/HTTPMessage.h"
+#include "Poco/PooledDeflatingStream.h"
+#include "Poco/SharedPtr.h"
+#include <streambuf>
+#include <ostream>
+#include <istream>
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+namespace Web {
+
+
+class ChunkSink
+	/// A ChunkSink receives the content of a response
+	/// in buffers of arbitrary size.
+{
+public:
+	virtual ~ChunkSink()
+		/// Destroys the ChunkSink.
+	{
+	}
+
+	virtual void write(const char* data, std::size_t length) = 0;
+		/// Receives the next part of the content.
+
+	virtual void close() = 0;
+		/// Receives the end of the content.
+};
+
+
+class ChunkSinkStreamBuf: public std::streambuf
+	/// An unbuffered stream buffer writing to a ChunkSink,
+	/// for passing filter output through stream-based code,
+	/// such as Poco::DeflatingOutputStream.
+{
+public:
+	explicit ChunkSinkStreamBuf(ChunkSink& sink):
+		_sink(sink)
+	{
+	}
+
+protected:
+	int overflow(int c)
+	{
+		if (c != traits_type::eof())
+		{
+			char ch = traits_type::to_char_type(c);
+			_sink.write(&ch, 1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	std::streamsize xsputn(const char* s, std::streamsize n)
+	{
+		_sink.write(s, static_cast<std::size_t>(n));
+		return n;
+	}
+
+private:
+	ChunkSink& _sink;
+};
+
+
+class ChunkFilter: public ChunkSink
+	/// A ChunkFilter is a stage of a StreamingWebFilter. It transforms
+	/// the content incrementally, as it is received through write(), and
+	/// passes the result to the next stage, either immediately or after
+	/// collecting as much content as the transformation requires.
+	///
+	/// The default implementation passes the content unchanged.
+	/// A ChunkFilter is used for a single response only.
+{
+public:
+	typedef Poco::SharedPtr<ChunkFilter> Ptr;
+
+	ChunkFilter():
+		_pNext(0)
+	{
+	}
+
+	~ChunkFilter()
+	{
+	}
+
+	void connect(ChunkSink& next)
+		/// Connects the ChunkFilter to the next stage.
+	{
+		_pNext = &next;
+	}
+
+	virtual void begin(Poco::Net::HTTPServerResponse&)
+		/// Called before the first part of the content is passed to the
+		/// filter. The filter can change the response headers, e.g., the
+		/// Content-Type or Content-Encoding, here.
+	{
+	}
+
+	void write(const char* data, std::size_t length)
+	{
+		next().write(data, length);
+	}
+
+	void close()
+	{
+		next().close();
+	}
+
+protected:
+	ChunkSink& next()
+		/// Returns the next stage.
+	{
+		poco_check_ptr (_pNext);
+
+		return *_pNext;
+	}
+
+private:
+	ChunkFilter(const ChunkFilter&);
+	ChunkFilter& operator = (const ChunkFilter&);
+
+	ChunkSink* _pNext;
+};
+
+
+class ChunkFilterFactory
+	/// A factory for ChunkFilter objects, creating
+	/// a new ChunkFilter for every response.
+{
+public:
+	typedef Poco::SharedPtr<ChunkFilterFactory> Ptr;
+
+	virtual ~ChunkFilterFactory()
+		/// Destroys the ChunkFilterFactory.
+	{
+	}
+
+	virtual ChunkFilter* createChunkFilter(const Poco::Net::HTTPServerRequest& request, const Poco::Net::HTTPServerResponse& response, const std::string& path) = 0;
+		/// Creates a ChunkFilter for the given request, or returns
+		/// a null pointer if the filter does not apply to the request.
+};
+
+
+class GzipChunkFilter: public ChunkFilter
+	/// GzipChunkFilter compresses the content with gzip content encoding.
+{
+public:
+	GzipChunkFilter():
+		_sink(*this),
+		_streamBuf(_sink),
+		_stream(&_streamBuf)
+	{
+	}
+
+	~GzipChunkFilter()
+	{
+	}
+
+	void begin(Poco::Net::HTTPServerResponse& response)
+	{
+		response.set("Content-Encoding", "gzip");
+		response.set("Vary", "Accept-Encoding");
+		_pDeflater = new Poco::PooledDeflatingOutputStream(_stream, Poco::ZStreamPool::deflaters(Poco::DeflatingStreamBuf::STREAM_GZIP));
+	}
+
+	void write(const char* data, std::size_t length)
+	{
+		_pDeflater->write(data, static_cast<std::streamsize>(length));
+	}
+
+	void close()
+	{
+		_pDeflater->close();
+		next().close();
+	}
+
+protected:
+	class ForwardSink: public ChunkSink
+		/// Passes the compressed content to the next stage.
+	{
+	public:
+		explicit ForwardSink(GzipChunkFilter& filter):
+			_filter(filter)
+		{
+		}
+
+		void write(const char* data, std::size_t length)
+		{
+			_filter.next().write(data, length);
+		}
+
+		void close()
+		{
+		}
+
+	private:
+		GzipChunkFilter& _filter;
+	};
+
+private:
+	ForwardSink _sink;
+	ChunkSinkStreamBuf _streamBuf;
+	std::ostream _stream;
+	Poco::SharedPtr<Poco::PooledDeflatingOutputStream> _pDeflater;
+};
+
+
+class GzipChunkFilterFactory: public ChunkFilterFactory
+	/// Creates a GzipChunkFilter for requests from clients
+	/// accepting gzip content encoding, if the media type
+	/// of the content benefits from compression.
+{
+public:
+	ChunkFilter* createChunkFilter(const Poco::Net::HTTPServerRequest& request, const Poco::Net::HTTPServerResponse& response, const std::string&)
+	{
+		if (request.has("Accept-Encoding") && request.get("Accept-Encoding").find("gzip") != std::string::npos && WebResourceCache::isCompressible(response.getContentType()))
+			return new GzipChunkFilter;
+		else
+			return 0;
+	}
+};
+
+
+class StreamingWebFilter: public WebFilter
+	/// StreamingWebFilter is a WebFilter that passes the resource
+	/// through a chain of ChunkFilter stages, in buffers of limited
+	/// size, and sends the output of the last stage as soon as it is
+	/// available, using chunked transfer encoding.
+	///
+	/// Unlike WebFilter implementations reading the entire resource
+	/// and writing the transformed content to the response, which
+	/// requires each filter in a chain to buffer the entire content,
+	/// the memory required by a StreamingWebFilter depends on the buffer
+	/// size and the stages only, and the client receives the first part
+	/// of the response before the resource has been read entirely.
+	///
+	/// For every request, a ChunkFilter is created by each of the
+	/// configured ChunkFilterFactory objects, in the order they have
+	/// been added. Clients not supporting HTTP/1.1 receive the content
+	/// without chunked transfer encoding, followed by a connection close.
+	///
+	/// StreamingWebFilter is usually created by a WebFilterFactory, e.g.:
+	///
+	///     WebFilter* createFilter(const WebFilter::Args& args)
+	///     {
+	///         StreamingWebFilter* pFilter = new StreamingWebFilter;
+	///         pFilter->addFactory(new TemplateChunkFilterFactory(args));
+	///         pFilter->addFactory(new GzipChunkFilterFactory);
+	///         return pFilter;
+	///     }
+{
+public:
+	enum
+	{
+		DEFAULT_BUFFER_SIZE = 8192
+	};
+
+	explicit StreamingWebFilter(std::size_t bufferSize = DEFAULT_BUFFER_SIZE):
+		_bufferSize(bufferSize)
+		/// Creates the StreamingWebFilter, reading the
+		/// resource in buffers of the given size.
+	{
+	}
+
+	~StreamingWebFilter()
+		/// Destroys the StreamingWebFilter.
+	{
+	}
+
+	void addFactory(ChunkFilterFactory::Ptr pFactory)
+		/// Appends a stage to the filter chain.
+	{
+		_factories.push_back(pFactory);
+	}
+
+	// WebFilter
+	void process(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const std::string& path, std::istream& resourceStream, Poco::OSP::Bundle::ConstPtr)
+	{
+		ResponseSink sink(response, request.getVersion() != Poco::Net::HTTPMessage::HTTP_1_0);
+		std::vector<ChunkFilter::Ptr> filters;
+		for (std::vector<ChunkFilterFactory::Ptr>::iterator it = _factories.begin(); it != _factories.end(); ++it)
+		{
+			ChunkFilter* pFilter = (*it)->createChunkFilter(request, response, path);
+			if (pFilter) filters.push_back(pFilter);
+		}
+		ChunkSink* pFirst = &sink;
+		for (std::vector<ChunkFilter::Ptr>::reverse_iterator it = filters.rbegin(); it != filters.rend(); ++it)
+		{
+			(*it)->connect(*pFirst);
+			pFirst = it->get();
+		}
+		for (std::vector<ChunkFilter::Ptr>::iterator it = filters.begin(); it != filters.end(); ++it)
+		{
+			(*it)->begin(response);
+		}
+
+		std::vector<char> buffer(_bufferSize);
+		while (resourceStream.read(&buffer[0], static_cast<std::streamsize>(buffer.size())) || resourceStream.gcount() > 0)
+		{
+			pFirst->write(&buffer[0], static_cast<std::size_t>(resourceStream.gcount()));
+		}
+		pFirst->close();
+	}
+
+protected:
+	class ResponseSink: public ChunkSink
+		/// The last stage, sending the content.
+	{
+	public:
+		ResponseSink(Poco::Net::HTTPServerResponse& response, bool chunked):
+			_response(response),
+			_chunked(chunked),
+			_pStream(0)
+		{
+		}
+
+		void write(const char* data, std::size_t length)
+		{
+			if (length == 0) return;
+			if (!_pStream)
+			{
+				_response.setContentLength(Poco::Net::HTTPMessage::UNKNOWN_CONTENT_LENGTH);
+				if (_chunked)
+					_response.setChunkedTransferEncoding(true);
+				else
+					_response.setKeepAlive(false);
+				_pStream = &_response.send();
+			}
+			_pStream->write(data, static_cast<std::streamsize>(length));
+		}
+
+		void close()
+		{
+			if (!_pStream)
+			{
+				_response.setContentLength(0);
+				_response.send();
+			}
+			else _pStream->flush();
+		}
+
+	private:
+		Poco::Net::HTTPServerResponse& _response;
+		bool _chunked;
+		std::ostream* _pStream;
+	};
+
+private:
+	StreamingWebFilter(const StreamingWebFilter&);
+	StreamingWebFilter& operator = (const StreamingWebFilter&);
+
+	std::size_t _bufferSize;
+	std::vector<ChunkFilterFactory::Ptr> _factories;
+};
+
+
+} } } // namespace Poco::OSP::Web
+
+
+#endif // OSP_Web_StreamingWebFilter_INCLUDED
@@ -0,0 +1,106 @@
+//
+// TemplateCacheService.h
+//
+// $Id$
+//
+// Library: OSPWeb
+// Package: Web
+// Module:  TemplateCacheService
+//
+// Definition of the TemplateCacheService class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_Web_TemplateCacheService_INCLUDED
+#define OSP_Web_TemplateCacheService_INCLUDED
+
+
+#include "Poco/OSP/Web/Web.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/JSON/CompiledTemplateCache.h"
+#include "Poco/MemoryPressure.h"
+#include "Poco/AutoPtr.h"
+
+
+namespace Poco {
+namespace OSP {
+namespace Web {
+
+
+class TemplateCacheService: public Poco::OSP::Service
+	/// TemplateCacheService makes a single JSON::CompiledTemplateCache
+	/// available to all bundles, so that templates used by several bundles,
+	/// e.g. shared page headers included by the pages of the web UI, are
+	/// compiled once and their files checked at most once per interval.
+	///
+	/// The service is registered by the bundle providing the templates:
+	///
+	///     TemplateCacheService::Ptr pService = new TemplateCacheService;
+	///     pService->cache().addPath(templateDirectory);
+	///     pContext->registry().registerService(TemplateCacheService::serviceName(), pService, Properties());
+	///
+	/// and used by request handlers:
+	///
+	///     TemplateCacheService::Ptr pService = ServiceFinder::findByName<TemplateCacheService>(pContext, TemplateCacheService::serviceName());
+	///     pService->cache().render(Path("status.tpl"), data, page);
+	///
+	/// The cache is cleared under critical memory pressure
+	/// reported to the MemoryPressureRegistry::defaultRegistry(),
+	/// e.g. by the MemoryPressureService.
+{
+public:
+	typedef Poco::AutoPtr<TemplateCacheService> Ptr;
+
+	static const std::string& serviceName()
+		/// Returns the name under which the service
+		/// should be registered.
+	{
+		static const std::string name("osp.web.templatecache");
+		return name;
+	}
+
+	TemplateCacheService():
+		_pHandler(new Poco::ClearMemoryPressureHandler<Poco::JSON::CompiledTemplateCache>(_cache))
+		/// Creates the TemplateCacheService with an empty cache.
+	{
+		Poco::MemoryPressureRegistry::defaultRegistry().add(_pHandler, Poco::MemoryPressureRegistry::PRIO_CACHES);
+	}
+
+	Poco::JSON::CompiledTemplateCache& cache()
+		/// Returns the shared template cache.
+	{
+		return _cache;
+	}
+
+	// Service
+	const std::type_info& type() const
+	{
+		return typeid(TemplateCacheService);
+	}
+
+	bool isA(const std::type_info& otherType) const
+	{
+		return isSameType(typeid(TemplateCacheService), otherType) || Service::isA(otherType);
+	}
+
+protected:
+	~TemplateCacheService()
+	{
+		Poco::MemoryPressureRegistry::defaultRegistry().remove(_pHandler);
+	}
+
+private:
+	Poco::JSON::CompiledTemplateCache _cache;
+	Poco::MemoryPressureHandler::Ptr _pHandler;
+};
+
+
+} } } // namespace Poco::OSP::Web
+
+
+#endif // OSP_Web_TemplateCacheService_INCLUDED
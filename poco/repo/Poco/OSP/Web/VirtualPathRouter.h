@@ -0,0 +1,267 @@
+//
+// VirtualPathRouter.h
+//
+// $Id$
+//
+// Library: OSPWeb
+// Package: Web
+// Module:  VirtualPathRouter
+//
+// Definition of the VirtualPathRouter class.
+//
+// Copyright (c) 2007-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef OSP_Web_VirtualPathRouter_INCLUDED
+#define OSP_Web_VirtualPathRouter_INCLUDED
+
+
+#include "Poco/OSP/Web/Web.h"
+#include "Poco/OSP/Web/WebServerDispatcher.h"
+#include "Poco/Mutex.h"
+#include <algorithm>
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace OSP {
+namespace Web {
+
+
+class VirtualPathRouter
+	/// VirtualPathRouter maps request paths to the VirtualPath
+	/// mappings of a WebServerDispatcher, using a trie of path
+	/// segments instead of a search over all registered paths.
+	///
+	/// The trie is compiled by rebuild() from the dispatcher's path
+	/// mappings, and must be rebuilt whenever mappings are added or
+	/// removed, e.g. in the bundleStarted and bundleStopped event
+	/// handlers. A new trie replaces the previous one atomically;
+	/// route() takes no lock and does not allocate memory, so the
+	/// cost of routing a request depends on the number of segments
+	/// in the request path, not on the number of mappings.
+	///
+	/// As with WebServerDispatcher::mapPath(), the longest prefix of
+	/// the request path with a mapping that allows the request method
+	/// is selected, and pattern mappings are tried if no prefix matches.
+	/// For each mapping, whether authorization is required is
+	/// determined when the trie is compiled.
+	///
+	/// Tries that have been replaced are kept until the router
+	/// is destroyed, so that pointers returned by route() remain
+	/// valid for the lifetime of the router.
+{
+public:
+	struct Route
+	{
+		Route():
+			requiresAuth(false),
+			requiresSecure(false)
+		{
+		}
+
+		WebServerDispatcher::VirtualPath vpath;
+		bool requiresAuth;
+			/// True if the mapping requires a permission or a session.
+		bool requiresSecure;
+			/// True if the mapping requires a secure connection.
+	};
+
+	VirtualPathRouter():
+		_pTrie(new Trie)
+		/// Creates an empty VirtualPathRouter.
+	{
+	}
+
+	explicit VirtualPathRouter(const WebServerDispatcher& dispatcher):
+		_pTrie(0)
+		/// Creates the VirtualPathRouter for the mappings
+		/// of the given dispatcher.
+	{
+		_pTrie = compile(dispatcher);
+	}
+
+	~VirtualPathRouter()
+		/// Destroys the VirtualPathRouter.
+	{
+		for (std::vector<Trie*>::iterator it = _retired.begin(); it != _retired.end(); ++it)
+		{
+			delete *it;
+		}
+		Trie* pTrie = _pTrie;
+		delete pTrie;
+	}
+
+	void rebuild(const WebServerDispatcher& dispatcher)
+		/// Compiles a new trie from the mappings
+		/// of the given dispatcher.
+	{
+		Trie* pNew = compile(dispatcher);
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		__sync_synchronize();
+		Trie* pOld = _pTrie;
+		_pTrie = pNew;
+		_retired.push_back(pOld);
+	}
+
+	const Route* route(const std::string& path, const std::string& method) const
+		/// Returns the Route for the given path, which must start with
+		/// a slash, and request method, or a null pointer if there is
+		/// no suitable mapping.
+		///
+		/// Takes no lock.
+	{
+		const Trie* pTrie = _pTrie;
+		__sync_synchronize();
+
+		static const std::size_t MAX_DEPTH = 64;
+		const Route* matches[MAX_DEPTH];
+		std::size_t nMatches = 0;
+
+		std::size_t node = 0;
+		if (pTrie->nodes[0].route >= 0) matches[nMatches++] = &pTrie->routes[pTrie->nodes[0].route];
+		std::string::size_type pos = 1;
+		while (pos < path.size() && nMatches < MAX_DEPTH)
+		{
+			std::string::size_type end = path.find('/', pos);
+			if (end == std::string::npos) end = path.size();
+			if (end > pos)
+			{
+				int child = pTrie->findChild(node, path.data() + pos, end - pos);
+				if (child < 0) break;
+				node = static_cast<std::size_t>(child);
+				if (pTrie->nodes[node].route >= 0) matches[nMatches++] = &pTrie->routes[pTrie->nodes[node].route];
+			}
+			pos = end + 1;
+		}
+		while (nMatches > 0)
+		{
+			const Route* pRoute = matches[--nMatches];
+			if (allows(pRoute->vpath, method)) return pRoute;
+		}
+		for (std::vector<Route>::const_iterator it = pTrie->patterns.begin(); it != pTrie->patterns.end(); ++it)
+		{
+			if (it->vpath.pPattern->match(path) && allows(it->vpath, method)) return &*it;
+		}
+		return 0;
+	}
+
+protected:
+	struct Node
+	{
+		Node():
+			route(-1)
+		{
+		}
+
+		int route;
+		std::vector<std::pair<std::string, int> > children;
+			/// Sorted by segment.
+	};
+
+	struct Trie
+	{
+		Trie():
+			nodes(1)
+		{
+		}
+
+		int findChild(std::size_t node, const char* segment, std::size_t length) const
+		{
+			const std::vector<std::pair<std::string, int> >& children = nodes[node].children;
+			std::size_t lo = 0;
+			std::size_t hi = children.size();
+			while (lo < hi)
+			{
+				std::size_t mid = (lo + hi)/2;
+				int cmp = children[mid].first.compare(0, std::string::npos, segment, length);
+				if (cmp == 0) return children[mid].second;
+				if (cmp < 0) lo = mid + 1; else hi = mid;
+			}
+			return -1;
+		}
+
+		std::vector<Node> nodes;
+		std::vector<Route> routes;
+		std::vector<Route> patterns;
+	};
+
+	static bool allows(const WebServerDispatcher::VirtualPath& vpath, const std::string& method)
+	{
+		return vpath.methods.empty() || vpath.methods.find(method) != vpath.methods.end();
+	}
+
+	static Route makeRoute(const WebServerDispatcher::VirtualPath& vpath)
+	{
+		Route route;
+		route.vpath = vpath;
+		route.requiresAuth = !vpath.security.permission.empty() || !vpath.security.session.empty();
+		route.requiresSecure = vpath.security.secure;
+		return route;
+	}
+
+	static bool bySegment(const std::pair<std::string, int>& c1, const std::pair<std::string, int>& c2)
+	{
+		return c1.first < c2.first;
+	}
+
+	static Trie* compile(const WebServerDispatcher& dispatcher)
+	{
+		WebServerDispatcher::PathMap mappings;
+		dispatcher.virtualPathMappings(mappings);
+
+		Trie* pTrie = new Trie;
+		for (WebServerDispatcher::PathMap::const_iterator it = mappings.begin(); it != mappings.end(); ++it)
+		{
+			if (it->second.pPattern)
+			{
+				pTrie->patterns.push_back(makeRoute(it->second));
+				continue;
+			}
+			std::size_t node = 0;
+			const std::string& path = it->first;
+			std::string::size_type pos = 1;
+			while (pos < path.size())
+			{
+				std::string::size_type end = path.find('/', pos);
+				if (end == std::string::npos) end = path.size();
+				if (end > pos)
+				{
+					std::string segment(path, pos, end - pos);
+					int child = pTrie->findChild(node, segment.data(), segment.size());
+					if (child < 0)
+					{
+						child = static_cast<int>(pTrie->nodes.size());
+						pTrie->nodes[node].children.push_back(std::make_pair(segment, child));
+						std::sort(pTrie->nodes[node].children.begin(), pTrie->nodes[node].children.end(), bySegment);
+						pTrie->nodes.push_back(Node());
+					}
+					node = static_cast<std::size_t>(child);
+				}
+				pos = end + 1;
+			}
+			pTrie->nodes[node].route = static_cast<int>(pTrie->routes.size());
+			pTrie->routes.push_back(makeRoute(it->second));
+		}
+		return pTrie;
+	}
+
+private:
+	VirtualPathRouter(const VirtualPathRouter&);
+	VirtualPathRouter& operator = (const VirtualPathRouter&);
+
+	Trie* volatile _pTrie;
+	std::vector<Trie*> _retired;
+	Poco::FastMutex _mutex;
+};
+
+
+} } } // namespace Poco::OSP::Web
+
+
+#endif // OSP_Web_VirtualPathRouter_INCLUDED
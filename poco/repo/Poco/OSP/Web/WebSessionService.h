@@ -75,8 +75,7 @@ public:
 	
 	bool isA(const std::type_info& otherType) const
 	{
-		std::string name(typeid(WebSessionService).name());
-		return name == otherType.name() || Service::isA(otherType);
+		return isSameType(typeid(WebSessionService), otherType) || Service::isA(otherType);
 	}
 
 protected:
@@ -24,6 +24,7 @@
 #include "Poco/Mutex.h"
 #include "Poco/AutoPtr.h"
 #include "Poco/SharedPtr.h"
+#include "Poco/Instrumentation.h"
 #include <vector>
 #include <cctype>
 
@@ -146,7 +147,7 @@ public:
 };
 
 
-template <class C, class P = C*, class F = PoolableObjectFactory<C, P> >
+template <class C, class P = C*, class F = PoolableObjectFactory<C, P>, class M = Poco::FastMutex>
 class ObjectPool
 	/// An ObjectPool manages a pool of objects of a certain class.
 	///
@@ -165,6 +166,10 @@ class ObjectPool
 	///     number of objects in the pool is below the capacity,
 	///     the object is added to the pool. Otherwise it is destroyed.
 	///   - If the object is not valid, it is destroyed immediately.
+	///
+	/// The pool is protected by a mutex of class M, which can be
+	/// any class satisfying the requirements of FastMutex, such as
+	/// SpinMutex.
 {
 public:
 	ObjectPool(std::size_t capacity, std::size_t peakCapacity):
@@ -216,7 +221,7 @@ public:
 		/// If activating the object fails, the object is destroyed and
 		/// the exception is passed on to the caller.
 	{
-		Poco::FastMutex::ScopedLock lock(_mutex);
+		typename M::ScopedLock lock(_mutex);
 		
 		if (!_pool.empty())
 		{
@@ -231,13 +236,58 @@ public:
 			_size++;
 			return pObject;
 		}
-		else return 0;
+		poco_instrument_count("ObjectPool.exhausted");
+		return 0;
 	}
-		
+
+	P tryBorrowObject()
+		/// Same as borrowObject(), but returns null instead of
+		/// waiting if another thread is currently using the pool.
+	{
+		if (!_mutex.tryLock()) return 0;
+		try
+		{
+			P pObject = 0;
+			if (!_pool.empty())
+			{
+				pObject = _pool.back();
+				_pool.pop_back();
+				activateObject(pObject);
+			}
+			else if (_size < _peakCapacity)
+			{
+				pObject = _factory.createObject();
+				activateObject(pObject);
+				_size++;
+			}
+			_mutex.unlock();
+			return pObject;
+		}
+		catch (...)
+		{
+			_mutex.unlock();
+			throw;
+		}
+	}
+
+	void trim(std::size_t highWaterMark)
+		/// Destroys idle objects until at most highWaterMark
+		/// objects are left in the pool.
+	{
+		typename M::ScopedLock lock(_mutex);
+
+		while (_pool.size() > highWaterMark)
+		{
+			_factory.destroyObject(_pool.back());
+			_pool.pop_back();
+			_size--;
+		}
+	}
+
 	void returnObject(P pObject)
 		/// Returns an object to the pool.
 	{
-		Poco::FastMutex::ScopedLock lock(_mutex);
+		typename M::ScopedLock lock(_mutex);
 
 		if (_factory.validateObject(pObject))
 		{
@@ -270,14 +320,14 @@ public:
 	
 	std::size_t size() const
 	{
-		Poco::FastMutex::ScopedLock lock(_mutex);
+		typename M::ScopedLock lock(_mutex);
 		
 		return _size;
 	}
 	
 	std::size_t available() const
 	{
-		Poco::FastMutex::ScopedLock lock(_mutex);
+		typename M::ScopedLock lock(_mutex);
 
 		return _pool.size() + _peakCapacity - _size;
 	}
@@ -307,7 +357,7 @@ private:
 	std::size_t _peakCapacity;
 	std::size_t _size;
 	std::vector<P> _pool;
-	mutable Poco::FastMutex _mutex;
+	mutable M _mutex;
 };
 
 
@@ -0,0 +1,312 @@
+//
+// ParallelSplitterChannel.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  ParallelSplitterChannel
+//
+// Definition of the ParallelSplitterChannel class.
+//
+// Copyright (c) 2004-2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_ParallelSplitterChannel_INCLUDED
+#define Foundation_ParallelSplitterChannel_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Channel.h"
+#include "Poco/BoundedAsyncChannel.h"
+#include "Poco/BatchChannel.h"
+#include "Poco/LogRecord.h"
+#include "Poco/LoggingRegistry.h"
+#include "Poco/Message.h"
+#include "Poco/RWLock.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <utility>
+
+
+namespace Poco {
+
+
+struct SinkStatistics
+	/// Counters of a channel attached to a ParallelSplitterChannel.
+{
+	SinkStatistics():
+		pChannel(0),
+		async(false),
+		queued(0),
+		lag(0)
+	{
+	}
+
+	Channel* pChannel;          /// The channel, valid while it is attached.
+	bool async;                 /// False if the channel is called synchronously.
+	AsyncChannelStatistics counters; /// Queue counters, including dropped messages.
+	std::size_t queued;         /// Messages currently waiting for the channel.
+	Timestamp::TimeDiff lag;    /// Age in microseconds of the oldest waiting message.
+};
+
+
+class ParallelSplitterChannel: public Channel, public RecordChannel, public BatchChannel
+	/// This channel sends a message to multiple channels, like
+	/// SplitterChannel, but every channel gets its own bounded queue
+	/// and writer thread (a BoundedAsyncChannel), so that a slow channel,
+	/// e.g. a RemoteSyslogChannel, an SQLChannel or a FileChannel while
+	/// it rotates, does not delay the logging thread or the other channels.
+	///
+	/// log() only queues the message for each channel. When the queue
+	/// of a channel is full, messages for that channel are dropped
+	/// according to the overflow policy of the queue (the oldest by
+	/// default), without affecting the other channels. POLICY_BLOCK
+	/// gives up this isolation, as the logging thread then waits for
+	/// the slowest channel.
+	///
+	/// Channels that are fast and must see messages without delay,
+	/// e.g. a DLTChannel, can be attached with async set to false;
+	/// they are called directly by the logging thread.
+	///
+	/// statistics() returns the drops, queue depth and lag of every
+	/// channel. Each queue also reports its drops to its channel, unless
+	/// the reportDrops property is false.
+	///
+	/// The following properties are supported:
+	///   * channel:       A comma-separated list of channel names, which
+	///                    are attached with a queue each (set-only). All
+	///                    property names starting with "channel" are
+	///                    treated as "channel".
+	///   * capacity, policy, threshold, batchSize, priority, reportDrops:
+	///                    The properties of the queues, which are applied
+	///                    to the channels attached afterwards. See
+	///                    BoundedAsyncChannel.
+{
+public:
+	typedef AutoPtr<ParallelSplitterChannel> Ptr;
+
+	ParallelSplitterChannel()
+		/// Creates the ParallelSplitterChannel.
+	{
+	}
+
+	void addChannel(Channel* pChannel, bool async = true)
+		/// Attaches a channel, which may not be null. Unless async is
+		/// false, the channel gets its own queue and writer thread.
+	{
+		poco_check_ptr (pChannel);
+
+		Sink sink;
+		sink.pChannel = pChannel;
+		pChannel->duplicate();
+		if (async)
+		{
+			PropertyVec properties;
+			{
+				RWLock::ScopedReadLock lock(_lock);
+				properties = _queueProperties;
+			}
+			try
+			{
+				sink.pQueue = new BoundedAsyncChannel(pChannel);
+				for (PropertyVec::const_iterator it = properties.begin(); it != properties.end(); ++it)
+				{
+					sink.pQueue->setProperty(it->first, it->second);
+				}
+				sink.pQueue->open();
+			}
+			catch (...)
+			{
+				pChannel->release();
+				throw;
+			}
+		}
+		RWLock::ScopedWriteLock lock(_lock);
+		_sinks.push_back(sink);
+	}
+
+	void removeChannel(Channel* pChannel)
+		/// Removes a channel, after passing the messages queued
+		/// for it to it.
+	{
+		Sink sink;
+		{
+			RWLock::ScopedWriteLock lock(_lock);
+			SinkVec::iterator it = _sinks.begin();
+			while (it != _sinks.end() && it->pChannel != pChannel) ++it;
+			if (it == _sinks.end()) return;
+			sink = *it;
+			_sinks.erase(it);
+		}
+		detach(sink);
+	}
+
+	void log(const Message& msg)
+		/// Sends the given Message to all attached channels.
+	{
+		RWLock::ScopedReadLock lock(_lock);
+		for (SinkVec::iterator it = _sinks.begin(); it != _sinks.end(); ++it)
+		{
+			if (it->pQueue)
+				it->pQueue->log(msg);
+			else
+				it->pChannel->log(msg);
+		}
+	}
+
+	void log(const LogRecord& record)
+		/// Sends the given record to all attached channels. Queued
+		/// records are formatted by the writer threads.
+	{
+		RWLock::ScopedReadLock lock(_lock);
+		for (SinkVec::iterator it = _sinks.begin(); it != _sinks.end(); ++it)
+		{
+			if (it->pQueue)
+			{
+				it->pQueue->log(record);
+			}
+			else
+			{
+				RecordChannel* pRecordChannel = dynamic_cast<RecordChannel*>(it->pChannel);
+				if (pRecordChannel)
+					pRecordChannel->log(record);
+				else
+					it->pChannel->log(record.message());
+			}
+		}
+	}
+
+	void logMany(const std::vector<Message>& messages)
+		/// Sends the given messages to all attached channels.
+	{
+		RWLock::ScopedReadLock lock(_lock);
+		for (SinkVec::iterator it = _sinks.begin(); it != _sinks.end(); ++it)
+		{
+			if (it->pQueue)
+				it->pQueue->logMany(messages);
+			else
+				Poco::logMany(it->pChannel, messages);
+		}
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+		/// Sets or changes a configuration property.
+		///
+		/// See the class documentation for the supported properties.
+	{
+		if (name.compare(0, 7, "channel") == 0)
+		{
+			StringTokenizer tokenizer(value, ",;", StringTokenizer::TOK_IGNORE_EMPTY | StringTokenizer::TOK_TRIM);
+			for (StringTokenizer::Iterator it = tokenizer.begin(); it != tokenizer.end(); ++it)
+			{
+				addChannel(LoggingRegistry::defaultRegistry().channelForName(*it));
+			}
+		}
+		else if (name == "capacity" || name == "policy" || name == "threshold" || name == "batchSize" || name == "priority" || name == "reportDrops")
+		{
+			RWLock::ScopedWriteLock lock(_lock);
+			_queueProperties.push_back(std::make_pair(name, value));
+		}
+		else Channel::setProperty(name, value);
+	}
+
+	void close()
+		/// Passes the queued messages to the channels
+		/// and removes all channels.
+	{
+		SinkVec sinks;
+		{
+			RWLock::ScopedWriteLock lock(_lock);
+			sinks.swap(_sinks);
+		}
+		for (SinkVec::iterator it = sinks.begin(); it != sinks.end(); ++it)
+		{
+			detach(*it);
+		}
+	}
+
+	int count() const
+		/// Returns the number of channels in the ParallelSplitterChannel.
+	{
+		RWLock::ScopedReadLock lock(_lock);
+		return static_cast<int>(_sinks.size());
+	}
+
+	std::vector<SinkStatistics> statistics() const
+		/// Returns the counters of all attached channels,
+		/// in the order they have been attached.
+	{
+		RWLock::ScopedReadLock lock(_lock);
+		std::vector<SinkStatistics> result(_sinks.size());
+		for (std::size_t i = 0; i < _sinks.size(); ++i)
+		{
+			result[i].pChannel = _sinks[i].pChannel;
+			if (_sinks[i].pQueue)
+			{
+				result[i].async    = true;
+				result[i].counters = _sinks[i].pQueue->statistics();
+				result[i].queued   = _sinks[i].pQueue->size();
+				result[i].lag      = _sinks[i].pQueue->lag();
+			}
+		}
+		return result;
+	}
+
+protected:
+	~ParallelSplitterChannel()
+		/// Destroys the ParallelSplitterChannel.
+	{
+		try
+		{
+			close();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+private:
+	struct Sink
+	{
+		Sink():
+			pChannel(0)
+		{
+		}
+
+		Channel* pChannel;
+		BoundedAsyncChannel::Ptr pQueue;
+	};
+
+	typedef std::vector<Sink> SinkVec;
+	typedef std::vector<std::pair<std::string, std::string> > PropertyVec;
+
+	ParallelSplitterChannel(const ParallelSplitterChannel&);
+	ParallelSplitterChannel& operator = (const ParallelSplitterChannel&);
+
+	static void detach(Sink& sink)
+		/// Stops the queue of the sink, which passes the remaining
+		/// messages to the channel, and releases the channel.
+	{
+		if (sink.pQueue) sink.pQueue->close();
+		sink.pQueue = 0;
+		sink.pChannel->release();
+	}
+
+	SinkVec _sinks;
+	PropertyVec _queueProperties;
+	mutable RWLock _lock;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_ParallelSplitterChannel_INCLUDED
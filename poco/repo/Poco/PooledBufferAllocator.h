@@ -0,0 +1,283 @@
+//
+// PooledBufferAllocator.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Streams
+// Module:  PooledBufferAllocator
+//
+// Definition of the BufferPagePool class and the PooledBufferAllocator class template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_PooledBufferAllocator_INCLUDED
+#define Foundation_PooledBufferAllocator_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/BufferedStreamBuf.h"
+#include "Poco/BufferedBidirectionalStreamBuf.h"
+#include "Poco/Mutex.h"
+#include "Poco/SingletonHolder.h"
+#include <vector>
+#include <ios>
+#include <cstddef>
+
+
+namespace Poco {
+
+
+struct BufferPageStatistics
+	/// The statistics of a page size of a BufferPagePool.
+{
+	std::size_t pageSize;  /// Size of the pages.
+	std::size_t idle;      /// Number of idle pages kept by the pool.
+	std::size_t inUse;     /// Number of pages currently allocated.
+	Poco::UInt64 hits;     /// Number of allocations served from idle pages.
+	Poco::UInt64 misses;   /// Number of allocations that created a new page.
+};
+
+
+class BufferPagePool
+	/// A pool of memory pages for stream buffers.
+	///
+	/// Buffer sizes from MIN_PAGE_SIZE up to the maximum page
+	/// size are rounded up to the next power of two, and freed
+	/// pages are kept for reuse, up to a configurable number of
+	/// pages per size. Buffers larger than the maximum page size
+	/// are not pooled.
+{
+public:
+	enum
+	{
+		MIN_PAGE_SIZE     = 256,
+		DEFAULT_MAX_PAGE  = 65536,
+		DEFAULT_MAX_IDLE  = 64
+	};
+
+	explicit BufferPagePool(std::size_t maxPageSize = DEFAULT_MAX_PAGE, std::size_t maxIdle = DEFAULT_MAX_IDLE):
+		_maxIdle(maxIdle),
+		_unpooled(0)
+		/// Creates the BufferPagePool for pages of up to maxPageSize
+		/// bytes, keeping up to maxIdle idle pages per size.
+	{
+		for (std::size_t size = MIN_PAGE_SIZE; size <= maxPageSize; size <<= 1)
+		{
+			_classes.push_back(new PageClass(size));
+		}
+	}
+
+	~BufferPagePool()
+		/// Destroys the BufferPagePool and releases all idle pages.
+	{
+		for (std::vector<PageClass*>::iterator it = _classes.begin(); it != _classes.end(); ++it)
+		{
+			for (std::vector<char*>::iterator itp = (*it)->idle.begin(); itp != (*it)->idle.end(); ++itp)
+			{
+				delete [] *itp;
+			}
+			delete *it;
+		}
+	}
+
+	char* allocate(std::size_t size)
+		/// Allocates a page of at least size bytes.
+	{
+		PageClass* pClass = pageClass(size);
+		if (!pClass)
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			++_unpooled;
+			return new char[size];
+		}
+		{
+			FastMutex::ScopedLock lock(pClass->mutex);
+			++pClass->inUse;
+			if (!pClass->idle.empty())
+			{
+				char* pPage = pClass->idle.back();
+				pClass->idle.pop_back();
+				++pClass->hits;
+				return pPage;
+			}
+			++pClass->misses;
+		}
+		try
+		{
+			return new char[pClass->pageSize];
+		}
+		catch (...)
+		{
+			FastMutex::ScopedLock lock(pClass->mutex);
+			--pClass->inUse;
+			throw;
+		}
+	}
+
+	void deallocate(char* ptr, std::size_t size)
+		/// Releases a page allocated with the given size.
+	{
+		if (!ptr) return;
+		PageClass* pClass = pageClass(size);
+		if (pClass)
+		{
+			FastMutex::ScopedLock lock(pClass->mutex);
+			--pClass->inUse;
+			if (pClass->idle.size() < _maxIdle)
+			{
+				try
+				{
+					pClass->idle.push_back(ptr);
+					return;
+				}
+				catch (...)
+				{
+				}
+			}
+		}
+		delete [] ptr;
+	}
+
+	void setMaxIdle(std::size_t maxIdle)
+		/// Sets the maximum number of idle pages kept per size,
+		/// releasing idle pages above the new limit.
+	{
+		_maxIdle = maxIdle;
+		trim(maxIdle);
+	}
+
+	void trim(std::size_t maxIdle)
+		/// Releases idle pages until at most maxIdle pages of each
+		/// size are left, without changing the maximum number
+		/// of idle pages kept.
+	{
+		for (std::vector<PageClass*>::iterator it = _classes.begin(); it != _classes.end(); ++it)
+		{
+			FastMutex::ScopedLock lock((*it)->mutex);
+			while ((*it)->idle.size() > maxIdle)
+			{
+				delete [] (*it)->idle.back();
+				(*it)->idle.pop_back();
+			}
+		}
+	}
+
+	std::size_t getMaxIdle() const
+		/// Returns the maximum number of idle pages kept per size.
+	{
+		return _maxIdle;
+	}
+
+	std::size_t maxPageSize() const
+		/// Returns the size of the largest pooled pages.
+	{
+		return _classes.empty() ? 0 : _classes.back()->pageSize;
+	}
+
+	void statistics(std::vector<BufferPageStatistics>& statistics) const
+		/// Returns the statistics of all page sizes.
+	{
+		for (std::vector<PageClass*>::const_iterator it = _classes.begin(); it != _classes.end(); ++it)
+		{
+			FastMutex::ScopedLock lock((*it)->mutex);
+			BufferPageStatistics s;
+			s.pageSize = (*it)->pageSize;
+			s.idle     = (*it)->idle.size();
+			s.inUse    = (*it)->inUse;
+			s.hits     = (*it)->hits;
+			s.misses   = (*it)->misses;
+			statistics.push_back(s);
+		}
+	}
+
+	Poco::UInt64 unpooled() const
+		/// Returns the number of allocations too large to be pooled.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _unpooled;
+	}
+
+	static BufferPagePool& defaultPool()
+		/// Returns the BufferPagePool used by PooledBufferAllocator.
+	{
+		static SingletonHolder<BufferPagePool> sh;
+		return *sh.get();
+	}
+
+private:
+	struct PageClass
+	{
+		explicit PageClass(std::size_t size):
+			pageSize(size),
+			inUse(0),
+			hits(0),
+			misses(0)
+		{
+		}
+
+		std::size_t        pageSize;
+		std::vector<char*> idle;
+		std::size_t        inUse;
+		Poco::UInt64       hits;
+		Poco::UInt64       misses;
+		mutable FastMutex  mutex;
+	};
+
+	BufferPagePool(const BufferPagePool&);
+	BufferPagePool& operator = (const BufferPagePool&);
+
+	PageClass* pageClass(std::size_t size) const
+	{
+		for (std::vector<PageClass*>::const_iterator it = _classes.begin(); it != _classes.end(); ++it)
+		{
+			if (size <= (*it)->pageSize) return *it;
+		}
+		return 0;
+	}
+
+	std::vector<PageClass*> _classes;
+	std::size_t _maxIdle;
+	Poco::UInt64 _unpooled;
+	mutable FastMutex _mutex;
+};
+
+
+template <typename ch>
+class PooledBufferAllocator
+	/// A BufferAllocator taking stream buffers from
+	/// the default BufferPagePool.
+	///
+	/// Stream buffers using PooledBufferAllocator must not
+	/// be released with another allocator, so it can only be
+	/// used with stream buffer classes instantiated with it,
+	/// such as PooledBufferedStreamBuf.
+{
+public:
+	typedef ch char_type;
+
+	static char_type* allocate(std::streamsize size)
+	{
+		return reinterpret_cast<char_type*>(BufferPagePool::defaultPool().allocate(static_cast<std::size_t>(size)*sizeof(char_type)));
+	}
+
+	static void deallocate(char_type* ptr, std::streamsize size) throw()
+	{
+		BufferPagePool::defaultPool().deallocate(reinterpret_cast<char*>(ptr), static_cast<std::size_t>(size)*sizeof(char_type));
+	}
+};
+
+
+typedef BasicBufferedStreamBuf<char, std::char_traits<char>, PooledBufferAllocator<char> > PooledBufferedStreamBuf;
+typedef BasicBufferedBidirectionalStreamBuf<char, std::char_traits<char>, PooledBufferAllocator<char> > PooledBufferedBidirectionalStreamBuf;
+
+
+} // namespace Poco
+
+
+#endif // Foundation_PooledBufferAllocator_INCLUDED
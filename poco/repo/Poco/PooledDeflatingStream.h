@@ -0,0 +1,251 @@
+//
+// PooledDeflatingStream.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Streams
+// Module:  ZStreamPool
+//
+// Definition of the PooledDeflatingStreamBuf, PooledDeflatingIOS
+// and PooledDeflatingOutputStream classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_PooledDeflatingStream_INCLUDED
+#define Foundation_PooledDeflatingStream_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/ZStreamPool.h"
+#include "Poco/BufferedStreamBuf.h"
+#include "Poco/Exception.h"
+#include <ostream>
+
+
+namespace Poco {
+
+
+class PooledDeflatingStreamBuf: public BufferedStreamBuf
+	/// This is the streambuf class used by PooledDeflatingOutputStream.
+	///
+	/// The z_stream and the buffer for the compressed data are taken
+	/// from a ZStreamPool, and given back to it by close().
+	///
+	/// Every sync() (e.g., std::ostream::flush()) compresses the data
+	/// written so far with Z_SYNC_FLUSH, writes it to the output stream
+	/// and flushes the output stream, so that the receiver can decompress
+	/// everything up to that point without waiting for more data. If a
+	/// flush interval is given, this is also done whenever that many
+	/// (uncompressed) bytes have been written since the last flush.
+{
+public:
+	PooledDeflatingStreamBuf(std::ostream& ostr, ZStreamPool& pool, std::streamsize flushInterval = 0):
+		BufferedStreamBuf(STREAM_BUFFER_SIZE, std::ios::out),
+		_pOstr(&ostr),
+		_pool(pool),
+		_pZStream(pool.acquire()),
+		_flushInterval(flushInterval),
+		_pending(0)
+		/// Creates a PooledDeflatingStreamBuf for compressing data passed
+		/// through and forwarding it to the given output stream, using a
+		/// ZStream from the given pool, which must be a ZSTREAM_DEFLATE pool.
+	{
+		poco_assert (pool.mode() == ZStream::ZSTREAM_DEFLATE);
+	}
+
+	~PooledDeflatingStreamBuf()
+		/// Destroys the PooledDeflatingStreamBuf, finishing
+		/// the stream if close() has not been called.
+	{
+		try
+		{
+			close();
+		}
+		catch (...)
+		{
+		}
+		_pool.release(_pZStream);
+	}
+
+	int close()
+		/// Finishes up the stream and gives the ZStream back to the pool.
+		///
+		/// Must be called to complete the compressed data.
+	{
+		if (!_pZStream) return 0;
+		BufferedStreamBuf::sync();
+		ZStream* pZStream = _pZStream;
+		_pZStream = 0;
+		try
+		{
+			pZStream->zstr().next_in = 0;
+			pZStream->zstr().avail_in = 0;
+			deflateBuffer(*pZStream, Z_FINISH);
+			_pOstr->flush();
+		}
+		catch (...)
+		{
+			_pool.release(pZStream);
+			throw;
+		}
+		_pool.release(pZStream);
+		return 0;
+	}
+
+protected:
+	int readFromDevice(char* /*buffer*/, std::streamsize /*length*/)
+	{
+		return -1;
+	}
+
+	int writeToDevice(const char* buffer, std::streamsize length)
+	{
+		if (length == 0 || !_pZStream) return 0;
+
+		z_stream& zstr = _pZStream->zstr();
+		zstr.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(buffer));
+		zstr.avail_in = static_cast<uInt>(length);
+		deflateBuffer(*_pZStream, Z_NO_FLUSH);
+		_pending += length;
+		if (_flushInterval > 0 && _pending >= _flushInterval)
+		{
+			deflateBuffer(*_pZStream, Z_SYNC_FLUSH);
+			_pending = 0;
+		}
+		return static_cast<int>(length);
+	}
+
+	int sync()
+	{
+		if (BufferedStreamBuf::sync()) return -1;
+
+		if (_pZStream && _pending > 0)
+		{
+			deflateBuffer(*_pZStream, Z_SYNC_FLUSH);
+			_pending = 0;
+			_pOstr->flush();
+		}
+		return 0;
+	}
+
+private:
+	enum
+	{
+		STREAM_BUFFER_SIZE = 1024
+	};
+
+	void deflateBuffer(ZStream& zs, int flush)
+		/// Compresses the pending input with the given flush mode
+		/// and writes the output to the output stream.
+	{
+		z_stream& zstr = zs.zstr();
+		for (;;)
+		{
+			zstr.next_out = reinterpret_cast<Bytef*>(zs.buffer());
+			zstr.avail_out = ZStream::BUFFER_SIZE;
+			int rc = deflate(&zstr, flush);
+			if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) throw IOException(zError(rc));
+			std::streamsize n = ZStream::BUFFER_SIZE - zstr.avail_out;
+			if (n > 0)
+			{
+				_pOstr->write(zs.buffer(), n);
+				if (!_pOstr->good()) throw IOException("Failed writing deflated data to output stream");
+			}
+			if (rc == Z_STREAM_END || rc == Z_BUF_ERROR) break;
+			if (flush != Z_FINISH && zstr.avail_in == 0 && zstr.avail_out != 0) break;
+		}
+	}
+
+	PooledDeflatingStreamBuf(const PooledDeflatingStreamBuf&);
+	PooledDeflatingStreamBuf& operator = (const PooledDeflatingStreamBuf&);
+
+	std::ostream* _pOstr;
+	ZStreamPool& _pool;
+	ZStream* _pZStream;
+	std::streamsize _flushInterval;
+	std::streamsize _pending;
+};
+
+
+class PooledDeflatingIOS: public virtual std::ios
+	/// The base class for PooledDeflatingOutputStream.
+	///
+	/// This class is needed to ensure the correct initialization
+	/// order of the stream buffer and base classes.
+{
+public:
+	PooledDeflatingIOS(std::ostream& ostr, ZStreamPool& pool, std::streamsize flushInterval):
+		_buf(ostr, pool, flushInterval)
+		/// Creates the basic stream.
+	{
+		poco_ios_init(&_buf);
+	}
+
+	~PooledDeflatingIOS()
+		/// Destroys the stream.
+	{
+	}
+
+	PooledDeflatingStreamBuf* rdbuf()
+		/// Returns a pointer to the underlying streambuf.
+	{
+		return &_buf;
+	}
+
+protected:
+	PooledDeflatingStreamBuf _buf;
+};
+
+
+class PooledDeflatingOutputStream: public PooledDeflatingIOS, public std::ostream
+	/// This stream compresses all data passing through it using
+	/// zlib's deflate algorithm, like DeflatingOutputStream, but
+	/// with a z_stream taken from a ZStreamPool, so that it can be
+	/// created for every message without initializing zlib.
+	///
+	/// After all data has been written to the stream, close()
+	/// must be called to ensure completion of compression.
+	/// Example:
+	///     Poco::PooledDeflatingOutputStream deflater(ostr, Poco::ZStreamPool::deflaters(Poco::DeflatingStreamBuf::STREAM_GZIP));
+	///     deflater << "Hello, world!" << std::endl;
+	///     deflater.close();
+	///
+	/// flush() completes a deflate block with Z_SYNC_FLUSH (see
+	/// PooledDeflatingStreamBuf), for request/response protocols
+	/// where the message must reach the peer before the stream ends.
+{
+public:
+	explicit PooledDeflatingOutputStream(std::ostream& ostr, ZStreamPool& pool = ZStreamPool::deflaters(), std::streamsize flushInterval = 0):
+		PooledDeflatingIOS(ostr, pool, flushInterval),
+		std::ostream(&_buf)
+		/// Creates a PooledDeflatingOutputStream for compressing data
+		/// passed through and forwarding it to the given output stream.
+		///
+		/// If flushInterval is greater than zero, a Z_SYNC_FLUSH is done
+		/// whenever flushInterval bytes have been written since the last one.
+	{
+	}
+
+	~PooledDeflatingOutputStream()
+		/// Destroys the PooledDeflatingOutputStream.
+	{
+	}
+
+	int close()
+		/// Finishes up the stream and gives the z_stream back to the pool.
+	{
+		return _buf.close();
+	}
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_PooledDeflatingStream_INCLUDED
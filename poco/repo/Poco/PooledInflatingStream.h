@@ -0,0 +1,208 @@
+//
+// PooledInflatingStream.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Streams
+// Module:  ZStreamPool
+//
+// Definition of the PooledInflatingStreamBuf, PooledInflatingIOS
+// and PooledInflatingInputStream classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_PooledInflatingStream_INCLUDED
+#define Foundation_PooledInflatingStream_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/ZStreamPool.h"
+#include "Poco/BufferedStreamBuf.h"
+#include "Poco/Exception.h"
+#include <istream>
+
+
+namespace Poco {
+
+
+class PooledInflatingStreamBuf: public BufferedStreamBuf
+	/// This is the streambuf class used by PooledInflatingInputStream.
+	///
+	/// The z_stream and the buffer for the compressed data are taken
+	/// from a ZStreamPool, and given back to it when the end of the
+	/// compressed data has been reached, or by close().
+	///
+	/// Decompressed data is made available as soon as it can be
+	/// produced: the compressed data available in the input stream is
+	/// consumed with std::istream::readsome(), and only if there is none,
+	/// a single character is read with a blocking read. A stream that
+	/// has been compressed with Z_SYNC_FLUSH points (see
+	/// PooledDeflatingStreamBuf) can therefore be read up to the last
+	/// such point, without waiting for the rest of the stream.
+	///
+	/// Note that compressed data is read ahead from the input stream,
+	/// so data following the end of the compressed data may have been
+	/// consumed as well.
+{
+public:
+	PooledInflatingStreamBuf(std::istream& istr, ZStreamPool& pool):
+		BufferedStreamBuf(STREAM_BUFFER_SIZE, std::ios::in),
+		_pIstr(&istr),
+		_pool(pool),
+		_pZStream(pool.acquire()),
+		_eof(false)
+		/// Creates a PooledInflatingStreamBuf for decompressing data read
+		/// from the given input stream, using a ZStream from the given
+		/// pool, which must be a ZSTREAM_INFLATE pool.
+	{
+		poco_assert (pool.mode() == ZStream::ZSTREAM_INFLATE);
+	}
+
+	~PooledInflatingStreamBuf()
+		/// Destroys the PooledInflatingStreamBuf.
+	{
+		close();
+	}
+
+	void close()
+		/// Gives the ZStream back to the pool. Nothing more
+		/// can be read from the stream afterwards.
+	{
+		_eof = true;
+		_pool.release(_pZStream);
+		_pZStream = 0;
+	}
+
+protected:
+	int readFromDevice(char* buffer, std::streamsize length)
+	{
+		if (_eof || !_pZStream) return 0;
+
+		z_stream& zstr = _pZStream->zstr();
+		zstr.next_out = reinterpret_cast<Bytef*>(buffer);
+		zstr.avail_out = static_cast<uInt>(length);
+		for (;;)
+		{
+			if (zstr.avail_in == 0)
+			{
+				std::streamsize n = _pIstr->readsome(_pZStream->buffer(), ZStream::BUFFER_SIZE);
+				if (n <= 0)
+				{
+					_pIstr->read(_pZStream->buffer(), 1);
+					n = _pIstr->gcount();
+				}
+				if (n <= 0)
+				{
+					_eof = true;
+					break;
+				}
+				zstr.next_in = reinterpret_cast<Bytef*>(_pZStream->buffer());
+				zstr.avail_in = static_cast<uInt>(n);
+			}
+			int rc = inflate(&zstr, Z_NO_FLUSH);
+			if (rc == Z_STREAM_END)
+			{
+				int n = static_cast<int>(length - zstr.avail_out);
+				close();
+				return n;
+			}
+			if (rc != Z_OK && rc != Z_BUF_ERROR) throw IOException(zError(rc));
+			if (zstr.avail_out == 0 || (zstr.avail_in == 0 && static_cast<std::streamsize>(zstr.avail_out) != length)) break;
+		}
+		return static_cast<int>(length - zstr.avail_out);
+	}
+
+	int writeToDevice(const char* /*buffer*/, std::streamsize /*length*/)
+	{
+		return -1;
+	}
+
+private:
+	enum
+	{
+		STREAM_BUFFER_SIZE = 1024
+	};
+
+	PooledInflatingStreamBuf(const PooledInflatingStreamBuf&);
+	PooledInflatingStreamBuf& operator = (const PooledInflatingStreamBuf&);
+
+	std::istream* _pIstr;
+	ZStreamPool& _pool;
+	ZStream* _pZStream;
+	bool _eof;
+};
+
+
+class PooledInflatingIOS: public virtual std::ios
+	/// The base class for PooledInflatingInputStream.
+	///
+	/// This class is needed to ensure the correct initialization
+	/// order of the stream buffer and base classes.
+{
+public:
+	PooledInflatingIOS(std::istream& istr, ZStreamPool& pool):
+		_buf(istr, pool)
+		/// Creates the basic stream.
+	{
+		poco_ios_init(&_buf);
+	}
+
+	~PooledInflatingIOS()
+		/// Destroys the stream.
+	{
+	}
+
+	PooledInflatingStreamBuf* rdbuf()
+		/// Returns a pointer to the underlying streambuf.
+	{
+		return &_buf;
+	}
+
+protected:
+	PooledInflatingStreamBuf _buf;
+};
+
+
+class PooledInflatingInputStream: public PooledInflatingIOS, public std::istream
+	/// This stream decompresses all data passing through it using
+	/// zlib's inflate algorithm, like InflatingInputStream, but
+	/// with a z_stream taken from a ZStreamPool, so that it can be
+	/// created for every message without initializing zlib.
+	/// Example:
+	///     Poco::PooledInflatingInputStream inflater(istr, Poco::ZStreamPool::inflaters(Poco::InflatingStreamBuf::STREAM_GZIP));
+	///     std::string data;
+	///     Poco::StreamCopier::copyToString(inflater, data);
+{
+public:
+	explicit PooledInflatingInputStream(std::istream& istr, ZStreamPool& pool = ZStreamPool::inflaters()):
+		PooledInflatingIOS(istr, pool),
+		std::istream(&_buf)
+		/// Creates a PooledInflatingInputStream for decompressing
+		/// data read from the given input stream.
+	{
+	}
+
+	~PooledInflatingInputStream()
+		/// Destroys the PooledInflatingInputStream.
+	{
+	}
+
+	void close()
+		/// Gives the z_stream back to the pool, e.g. if
+		/// the stream is not read to its end.
+	{
+		_buf.close();
+	}
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_PooledInflatingStream_INCLUDED
@@ -0,0 +1,398 @@
+//
+// PriorityThreadPool.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  PriorityThreadPool
+//
+// Definition of the PriorityThreadPool class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_PriorityThreadPool_INCLUDED
+#define Foundation_PriorityThreadPool_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Exception.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/Environment.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/ThreadAffinity.h"
+#include "Poco/Types.h"
+#include <vector>
+#include <queue>
+
+
+namespace Poco {
+
+
+class PriorityThreadPool
+	/// A thread pool that queues tasks by priority class and,
+	/// within a class, by deadline.
+	///
+	/// With ThreadPool, startWithPriority() only sets the OS priority
+	/// of whichever thread happens to be idle; when the pool is busy,
+	/// a NoThreadAvailableException is thrown regardless of priority.
+	/// PriorityThreadPool instead queues tasks and always runs the queued
+	/// task with the highest priority next. Tasks of the same priority
+	/// with a deadline run before tasks without one, earlier deadlines
+	/// first, otherwise tasks run in the order they were started.
+	///
+	/// reserve() adds threads that only run tasks of at least a given
+	/// priority, so that urgent work, such as handling a change of the
+	/// APN connection state, is started even while all other threads
+	/// are busy with bulk work such as a log upload.
+	///
+	/// Tasks run with their priority as OS thread priority.
+	///
+	/// start() throws a NoThreadAvailableException if the queue is full;
+	/// tryStart() returns false instead.
+	///
+	/// The threads of a named pool are pinned according to the policy
+	/// registered under the pool's name in the ThreadAffinityRegistry.
+	///
+	/// Runnable objects are not owned by the pool and must stay valid
+	/// until they have run.
+{
+public:
+	enum
+	{
+		DEFAULT_QUEUE_CAPACITY = 1024
+	};
+
+	PriorityThreadPool(int threads = 0, std::size_t queueCapacity = DEFAULT_QUEUE_CAPACITY, const std::string& name = "");
+		/// Creates the pool with the given number of general threads,
+		/// or one per processor if threads is 0, and a queue holding
+		/// up to queueCapacity tasks.
+
+	~PriorityThreadPool();
+		/// Waits for the queued tasks to finish and stops the threads.
+
+	void reserve(Thread::Priority priority, int threads);
+		/// Adds the given number of threads that only run tasks
+		/// with at least the given priority.
+
+	int capacity() const;
+		/// Returns the number of threads, including reserved ones.
+
+	int used() const;
+		/// Returns the number of tasks started and not yet finished.
+
+	int available() const;
+		/// Returns the number of idle threads.
+
+	int queued() const;
+		/// Returns the number of tasks waiting for a thread.
+
+	int missedDeadlines() const;
+		/// Returns the number of tasks that began to run
+		/// after their deadline.
+
+	void start(Runnable& target);
+		/// Queues target with normal priority.
+
+	void start(Runnable& target, const std::string& name);
+		/// Same as start(target). The name is ignored.
+
+	void startWithPriority(Thread::Priority priority, Runnable& target);
+		/// Queues target with the given priority.
+
+	void startWithPriority(Thread::Priority priority, Runnable& target, const std::string& name);
+		/// Same as startWithPriority(priority, target). The name is ignored.
+
+	void startWithDeadline(Thread::Priority priority, Runnable& target, const Clock& deadline);
+		/// Queues target with the given priority, ahead of tasks of
+		/// the same priority without a deadline or with a later one.
+
+	bool tryStart(Runnable& target, Thread::Priority priority = Thread::PRIO_NORMAL);
+		/// Queues target and returns true, or returns false
+		/// if the queue is full.
+
+	void joinAll();
+		/// Waits until all started tasks have finished.
+
+	const std::string& name() const;
+		/// Returns the name of the pool.
+
+private:
+	struct Task
+	{
+		int       priority;
+		bool      hasDeadline;
+		Clock     deadline;
+		UInt64    sequence;
+		Runnable* pTarget;
+
+		bool operator < (const Task& other) const
+			/// Returns true if this task runs after other.
+		{
+			if (priority != other.priority) return priority < other.priority;
+			if (hasDeadline != other.hasDeadline) return !hasDeadline;
+			if (hasDeadline && deadline != other.deadline) return other.deadline < deadline;
+			return sequence > other.sequence;
+		}
+	};
+
+	class Worker: public Runnable
+	{
+	public:
+		Worker(PriorityThreadPool& pool, int minPriority):
+			_pool(pool), _minPriority(minPriority)
+		{
+		}
+
+		void run()
+		{
+			_pool.work(*this);
+		}
+
+		PriorityThreadPool& _pool;
+		int _minPriority;
+		Thread _thread;
+	};
+
+	PriorityThreadPool(const PriorityThreadPool&);
+	PriorityThreadPool& operator = (const PriorityThreadPool&);
+
+	void addWorkers(int threads, int minPriority);
+	bool enqueue(Runnable& target, Thread::Priority priority, const Clock* pDeadline);
+	void work(Worker& worker);
+
+	std::string                _name;
+	std::vector<Worker*>       _workers;
+	std::priority_queue<Task>  _queue;
+	std::size_t                _queueCapacity;
+	UInt64                     _sequence;
+	AtomicCounter              _pending;
+	AtomicCounter              _idle;
+	AtomicCounter              _missed;
+	bool                       _stop;
+	mutable FastMutex          _mutex;
+	Condition                  _taskAvailable;
+	Condition                  _allDone;
+};
+
+
+//
+// inlines
+//
+inline PriorityThreadPool::PriorityThreadPool(int threads, std::size_t queueCapacity, const std::string& name):
+	_name(name),
+	_queueCapacity(queueCapacity > 0 ? queueCapacity : 1),
+	_sequence(0),
+	_stop(false)
+{
+	if (threads <= 0) threads = Environment::processorCount();
+	if (threads <= 0) threads = 1;
+	addWorkers(threads, Thread::PRIO_LOWEST);
+}
+
+
+inline PriorityThreadPool::~PriorityThreadPool()
+{
+	joinAll();
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_stop = true;
+	}
+	_taskAvailable.broadcast();
+	for (std::vector<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+	{
+		(*it)->_thread.join();
+		delete *it;
+	}
+}
+
+
+inline void PriorityThreadPool::reserve(Thread::Priority priority, int threads)
+{
+	addWorkers(threads, priority);
+}
+
+
+inline int PriorityThreadPool::capacity() const
+{
+	FastMutex::ScopedLock lock(_mutex);
+	return static_cast<int>(_workers.size());
+}
+
+
+inline int PriorityThreadPool::used() const
+{
+	return _pending.value();
+}
+
+
+inline int PriorityThreadPool::available() const
+{
+	return _idle.value();
+}
+
+
+inline int PriorityThreadPool::queued() const
+{
+	FastMutex::ScopedLock lock(_mutex);
+	return static_cast<int>(_queue.size());
+}
+
+
+inline int PriorityThreadPool::missedDeadlines() const
+{
+	return _missed.value();
+}
+
+
+inline void PriorityThreadPool::start(Runnable& target)
+{
+	if (!enqueue(target, Thread::PRIO_NORMAL, 0)) throw NoThreadAvailableException();
+}
+
+
+inline void PriorityThreadPool::start(Runnable& target, const std::string& /*name*/)
+{
+	start(target);
+}
+
+
+inline void PriorityThreadPool::startWithPriority(Thread::Priority priority, Runnable& target)
+{
+	if (!enqueue(target, priority, 0)) throw NoThreadAvailableException();
+}
+
+
+inline void PriorityThreadPool::startWithPriority(Thread::Priority priority, Runnable& target, const std::string& /*name*/)
+{
+	startWithPriority(priority, target);
+}
+
+
+inline void PriorityThreadPool::startWithDeadline(Thread::Priority priority, Runnable& target, const Clock& deadline)
+{
+	if (!enqueue(target, priority, &deadline)) throw NoThreadAvailableException();
+}
+
+
+inline bool PriorityThreadPool::tryStart(Runnable& target, Thread::Priority priority)
+{
+	return enqueue(target, priority, 0);
+}
+
+
+inline void PriorityThreadPool::joinAll()
+{
+	FastMutex::ScopedLock lock(_mutex);
+	while (_pending.value() > 0) _allDone.wait(_mutex);
+}
+
+
+inline const std::string& PriorityThreadPool::name() const
+{
+	return _name;
+}
+
+
+inline void PriorityThreadPool::addWorkers(int threads, int minPriority)
+{
+	FastMutex::ScopedLock lock(_mutex);
+	for (int i = 0; i < threads; ++i)
+	{
+		Worker* pWorker = new Worker(*this, minPriority);
+		std::string threadName(_name.empty() ? "PriorityThreadPool" : _name);
+		threadName += "[#";
+		threadName += NumberFormatter::format(_workers.size());
+		threadName += "]";
+		pWorker->_thread.setName(threadName);
+		_workers.push_back(pWorker);
+		pWorker->_thread.start(*pWorker);
+	}
+}
+
+
+inline bool PriorityThreadPool::enqueue(Runnable& target, Thread::Priority priority, const Clock* pDeadline)
+{
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (_queue.size() >= _queueCapacity) return false;
+		Task task;
+		task.priority    = priority;
+		task.hasDeadline = pDeadline != 0;
+		if (pDeadline) task.deadline = *pDeadline;
+		task.sequence    = _sequence++;
+		task.pTarget     = &target;
+		_queue.push(task);
+		++_pending;
+	}
+	// reserved threads only take some tasks, so wake up all of them
+	_taskAvailable.broadcast();
+	return true;
+}
+
+
+inline void PriorityThreadPool::work(Worker& worker)
+{
+	if (!_name.empty()) ThreadAffinityRegistry::instance().pinCurrentThread(_name);
+	Thread::Priority threadPriority = worker._thread.getPriority();
+	for (;;)
+	{
+		Task task;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			while (!_stop && (_queue.empty() || _queue.top().priority < worker._minPriority))
+			{
+				++_idle;
+				_taskAvailable.wait(_mutex);
+				--_idle;
+			}
+			if (_stop) return;
+			task = _queue.top();
+			_queue.pop();
+		}
+		if (task.hasDeadline && task.deadline < Clock()) ++_missed;
+		try
+		{
+			if (task.priority != threadPriority)
+			{
+				threadPriority = static_cast<Thread::Priority>(task.priority);
+				worker._thread.setPriority(threadPriority);
+			}
+			task.pTarget->run();
+		}
+		catch (Exception& exc)
+		{
+			ErrorHandler::handle(exc);
+		}
+		catch (std::exception& exc)
+		{
+			ErrorHandler::handle(exc);
+		}
+		catch (...)
+		{
+			ErrorHandler::handle();
+		}
+		if (--_pending == 0)
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			_allDone.broadcast();
+		}
+	}
+}
+
+
+} // namespace Poco
+
+
+#endif // Foundation_PriorityThreadPool_INCLUDED
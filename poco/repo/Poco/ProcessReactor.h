@@ -0,0 +1,607 @@
+//
+// ProcessReactor.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Processes
+// Module:  ProcessReactor
+//
+// Definition of the ProcessReactor class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_ProcessReactor_INCLUDED
+#define Foundation_ProcessReactor_INCLUDED
+
+
+#include "Poco/Foundation.h"
+
+
+#if defined(POCO_OS_FAMILY_UNIX)
+
+
+#include "Poco/Pipe.h"
+#include "Poco/Process.h"
+#include "Poco/AbstractDelegate.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Runnable.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include "Poco/Error.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/Exception.h"
+#include <map>
+#include <vector>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#if POCO_OS == POCO_OS_LINUX
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#define POCO_PROCESSREACTOR_EPOLL 1
+#endif
+
+
+namespace Poco {
+
+
+class ProcessReactor: public Runnable
+	/// ProcessReactor waits, in a single thread, for output from the
+	/// pipes of child processes and for the termination of child
+	/// processes, and calls a delegate for every such event, so that
+	/// one thread can manage many processes launched with
+	/// Process::launch(), instead of a thread per pipe blocked in a
+	/// PipeInputStream and a thread per process blocked in
+	/// ProcessHandle::wait().
+	///
+	/// The read end of a Pipe registered with addReadHandler() is put
+	/// into non-blocking mode. On Linux, the pipes are waited for with
+	/// epoll and processes with a pidfd (Linux 5.3 and later) in the
+	/// same epoll instance; elsewhere, poll() is used. Processes for
+	/// which no pidfd can be obtained are checked with waitpid() after
+	/// every wakeup, and at least every 100 milliseconds.
+	///
+	/// A terminated process is reaped by the ProcessReactor, so
+	/// ProcessHandle::wait() must not be called for it.
+	///
+	/// Example:
+	///     Poco::Pipe outPipe;
+	///     Poco::ProcessHandle ph = Poco::Process::launch(command, args, 0, &outPipe, 0);
+	///     reactor.addReadHandler(outPipe, Poco::delegate(this, &ToolRunner::onOutput));
+	///     reactor.addExitHandler(ph, Poco::delegate(this, &ToolRunner::onExit));
+	///     Poco::Thread thread;
+	///     thread.start(reactor);
+	///
+	///     void ToolRunner::onOutput(const void* pSender, Poco::ProcessReactor::ReadArgs& args)
+	///     {
+	///         if (args.length > 0) _output.append(args.data, args.length);
+	///     }
+	///
+	///     void ToolRunner::onExit(const void* pSender, Poco::ProcessReactor::ExitArgs& args)
+	///     {
+	///         _exitCode = args.exitCode;
+	///     }
+	///
+	/// Delegates are called by the thread calling run() or poll(),
+	/// and can add and remove handlers. Handlers can also be added and
+	/// removed from other threads while the reactor is running.
+{
+public:
+	struct ReadArgs
+		/// The arguments passed to a read handler.
+	{
+		ReadArgs(const Pipe& p, const char* d, std::size_t n):
+			pipe(p),
+			data(d),
+			length(n)
+		{
+		}
+
+		Pipe pipe;
+			/// The Pipe that has been read from.
+		const char* data;
+			/// The data read from the pipe.
+		std::size_t length;
+			/// The number of bytes read, or 0 at the end of the
+			/// data (or on an error), after which the handler
+			/// has been removed.
+	};
+
+	struct ExitArgs
+		/// The arguments passed to an exit handler.
+	{
+		ExitArgs(ProcessHandle::PID p, int code, int sig):
+			pid(p),
+			exitCode(code),
+			signal(sig)
+		{
+		}
+
+		ProcessHandle::PID pid;
+			/// The process ID of the terminated process.
+		int exitCode;
+			/// The exit code of the process, as returned by
+			/// ProcessHandle::wait(), or -1 if the process has been
+			/// terminated by a signal or reaped by someone else.
+		int signal;
+			/// The signal that terminated the process, or 0.
+	};
+
+	typedef AbstractDelegate<ReadArgs> ReadDelegate;
+	typedef AbstractDelegate<ExitArgs> ExitDelegate;
+
+	enum
+	{
+		DEFAULT_TIMEOUT = 250000,
+			/// The default timeout of run(), in microseconds.
+		CHILD_POLL_INTERVAL = 100,
+			/// The interval in which processes without a
+			/// pidfd are checked, in milliseconds.
+		BUFFER_SIZE = 4096
+	};
+
+	ProcessReactor():
+		_timeout(DEFAULT_TIMEOUT),
+		_stop(false),
+		_fd(-1)
+		/// Creates the ProcessReactor.
+	{
+		init();
+	}
+
+	explicit ProcessReactor(const Timespan& timeout):
+		_timeout(timeout),
+		_stop(false),
+		_fd(-1)
+		/// Creates the ProcessReactor, using the given timeout for run().
+	{
+		init();
+	}
+
+	~ProcessReactor()
+		/// Destroys the ProcessReactor. The registered pipes are
+		/// not closed; processes not yet terminated are not reaped.
+	{
+		for (ProcessMap::iterator it = _processes.begin(); it != _processes.end(); ++it)
+		{
+			if (it->second.fd >= 0) ::close(it->second.fd);
+		}
+#if defined(POCO_PROCESSREACTOR_EPOLL)
+		::close(_fd);
+#endif
+		::close(_wakeFd[0]);
+		::close(_wakeFd[1]);
+	}
+
+	void addReadHandler(const Pipe& pipe, const ReadDelegate& delegate)
+		/// Registers a delegate to be called with the data available
+		/// from the read end of the given pipe, which is put into
+		/// non-blocking mode and must only be read by the reactor.
+		///
+		/// The pipe should not be closed while it is registered.
+		/// Replaces the delegate if the pipe is already registered.
+	{
+		int fd = pipe.readHandle();
+		if (fd < 0) throw InvalidArgumentException("Pipe has no read end");
+		setBlocking(fd, false);
+
+		FastMutex::ScopedLock lock(_mutex);
+		bool known = _pipes.find(fd) != _pipes.end();
+		_pipes[fd] = new PipeEntry(pipe, delegate);
+#if defined(POCO_PROCESSREACTOR_EPOLL)
+		if (!known) control(EPOLL_CTL_ADD, fd);
+#else
+		if (!known) wakeUp();
+#endif
+	}
+
+	void removeReadHandler(const Pipe& pipe)
+		/// Unregisters the read handler for the given pipe.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		removePipe(pipe.readHandle());
+	}
+
+	void addExitHandler(const ProcessHandle& handle, const ExitDelegate& delegate)
+		/// Registers a delegate to be called once the process
+		/// given by handle has terminated.
+		///
+		/// Replaces the delegate if the process is already registered.
+	{
+		ProcessHandle::PID pid = handle.id();
+
+		FastMutex::ScopedLock lock(_mutex);
+		ProcessMap::iterator it = _processes.find(pid);
+		if (it != _processes.end())
+		{
+			it->second.pDelegate = delegate.clone();
+			return;
+		}
+		ProcessEntry& entry = _processes[pid];
+		entry.pDelegate = delegate.clone();
+#if defined(POCO_PROCESSREACTOR_EPOLL) && defined(SYS_pidfd_open)
+		entry.fd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+		if (entry.fd >= 0)
+		{
+			_pidfds[entry.fd] = pid;
+			control(EPOLL_CTL_ADD, entry.fd);
+			return;
+		}
+#endif
+		wakeUp();
+	}
+
+	void removeExitHandler(const ProcessHandle& handle)
+		/// Unregisters the exit handler for the process
+		/// given by handle.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		removeProcess(handle.id());
+	}
+
+	bool empty() const
+		/// Returns true if no handlers are registered.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _pipes.empty() && _processes.empty();
+	}
+
+	int poll(const Timespan& timeout)
+		/// Waits until data is available from a registered pipe, a
+		/// registered process has terminated, the timeout expires, or
+		/// wakeUp() is called, and calls the delegates for all pipes
+		/// and processes ready.
+		///
+		/// Returns the number of delegates called.
+	{
+		std::vector<int> readyFds;
+		bool checkChildren = false;
+		int ms = static_cast<int>(timeout.totalMilliseconds());
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			checkChildren = _pidfds.size() < _processes.size();
+		}
+		if (checkChildren && ms > CHILD_POLL_INTERVAL) ms = CHILD_POLL_INTERVAL;
+
+#if defined(POCO_PROCESSREACTOR_EPOLL)
+		struct epoll_event events[MAX_EVENTS];
+		int n = epoll_wait(_fd, events, MAX_EVENTS, ms);
+		if (n < 0)
+		{
+			if (errno != EINTR) throw IOException("epoll_wait failed", Error::getMessage(Error::last()));
+			n = 0;
+		}
+		for (int i = 0; i < n; ++i)
+		{
+			if (events[i].data.fd == _wakeFd[0]) drainWakeUp();
+			else readyFds.push_back(events[i].data.fd);
+		}
+#else
+		std::vector<struct pollfd> pollFds;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			pollFds.reserve(_pipes.size() + 1);
+			addPollFd(pollFds, _wakeFd[0]);
+			for (PipeMap::const_iterator it = _pipes.begin(); it != _pipes.end(); ++it)
+			{
+				addPollFd(pollFds, it->first);
+			}
+		}
+		int n = ::poll(&pollFds[0], static_cast<nfds_t>(pollFds.size()), ms);
+		if (n < 0)
+		{
+			if (errno != EINTR) throw IOException("poll failed", Error::getMessage(Error::last()));
+			n = 0;
+		}
+		for (std::size_t i = 0; n > 0 && i < pollFds.size(); ++i)
+		{
+			if (pollFds[i].revents == 0) continue;
+			if (pollFds[i].fd == _wakeFd[0]) drainWakeUp();
+			else readyFds.push_back(pollFds[i].fd);
+		}
+#endif
+
+		int count = 0;
+		for (std::vector<int>::const_iterator it = readyFds.begin(); it != readyFds.end(); ++it)
+		{
+			count += dispatch(*it);
+		}
+		if (checkChildren) count += checkProcesses();
+		return count;
+	}
+
+	void run()
+		/// Runs the ProcessReactor. The reactor will run
+		/// until stop() is called (in a separate thread).
+	{
+		while (!_stop)
+		{
+			try
+			{
+				poll(_timeout);
+			}
+			catch (Exception& exc)
+			{
+				ErrorHandler::handle(exc);
+			}
+			catch (std::exception& exc)
+			{
+				ErrorHandler::handle(exc);
+			}
+			catch (...)
+			{
+				ErrorHandler::handle();
+			}
+		}
+	}
+
+	void stop()
+		/// Stops the ProcessReactor.
+	{
+		_stop = true;
+		wakeUp();
+	}
+
+	void wakeUp()
+		/// Wakes up the thread waiting in poll().
+	{
+		char c = 1;
+		ssize_t rc = ::write(_wakeFd[1], &c, 1);
+		(void) rc;
+	}
+
+	void setTimeout(const Timespan& timeout)
+		/// Sets the timeout of run().
+	{
+		_timeout = timeout;
+	}
+
+	const Timespan& getTimeout() const
+		/// Returns the timeout of run().
+	{
+		return _timeout;
+	}
+
+	static void setBlocking(Pipe::Handle fd, bool flag)
+		/// Puts the given pipe handle into blocking or non-blocking
+		/// mode. Pipe::readBytes() and Pipe::writeBytes() throw an
+		/// exception instead of blocking for a non-blocking handle.
+	{
+		int flags = ::fcntl(fd, F_GETFL);
+		if (flags < 0) throw IOException("Cannot get pipe flags", Error::getMessage(Error::last()));
+		flags = flag ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+		if (::fcntl(fd, F_SETFL, flags) < 0) throw IOException("Cannot set pipe flags", Error::getMessage(Error::last()));
+	}
+
+protected:
+	enum
+	{
+		MAX_EVENTS = 64
+	};
+
+	struct PipeEntry
+	{
+		PipeEntry(const Pipe& p, const ReadDelegate& delegate):
+			pipe(p),
+			pDelegate(delegate.clone())
+		{
+		}
+
+		Pipe pipe;
+		SharedPtr<ReadDelegate> pDelegate;
+	};
+
+	struct ProcessEntry
+	{
+		ProcessEntry():
+			fd(-1)
+		{
+		}
+
+		int fd;
+		SharedPtr<ExitDelegate> pDelegate;
+	};
+
+	typedef std::map<int, SharedPtr<PipeEntry> > PipeMap;
+	typedef std::map<ProcessHandle::PID, ProcessEntry> ProcessMap;
+	typedef std::map<int, ProcessHandle::PID> PidfdMap;
+
+	int dispatch(int fd)
+		/// Reads from the pipe, or reaps the process,
+		/// for the given ready file descriptor.
+	{
+		SharedPtr<PipeEntry> pEntry;
+		ProcessHandle::PID pid = 0;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			PipeMap::iterator it = _pipes.find(fd);
+			if (it != _pipes.end())
+			{
+				pEntry = it->second;
+			}
+			else
+			{
+				PidfdMap::iterator itPid = _pidfds.find(fd);
+				if (itPid == _pidfds.end()) return 0;
+				pid = itPid->second;
+			}
+		}
+		if (!pEntry) return reap(pid) ? 1 : 0;
+
+		char buffer[BUFFER_SIZE];
+		ssize_t n;
+		do
+		{
+			n = ::read(fd, buffer, sizeof(buffer));
+		}
+		while (n < 0 && errno == EINTR);
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+		if (n <= 0)
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			PipeMap::iterator it = _pipes.find(fd);
+			if (it == _pipes.end() || it->second != pEntry) return 0;
+			removePipe(fd);
+		}
+		ReadArgs args(pEntry->pipe, buffer, n > 0 ? static_cast<std::size_t>(n) : 0);
+		pEntry->pDelegate->notify(this, args);
+		return 1;
+	}
+
+	int checkProcesses()
+		/// Reaps the processes that have no pidfd.
+	{
+		std::vector<ProcessHandle::PID> pids;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			for (ProcessMap::const_iterator it = _processes.begin(); it != _processes.end(); ++it)
+			{
+				if (it->second.fd < 0) pids.push_back(it->first);
+			}
+		}
+		int count = 0;
+		for (std::vector<ProcessHandle::PID>::const_iterator it = pids.begin(); it != pids.end(); ++it)
+		{
+			if (reap(*it)) ++count;
+		}
+		return count;
+	}
+
+	bool reap(ProcessHandle::PID pid)
+		/// Reaps the given process if it has terminated, and calls
+		/// its delegate. Returns true if the delegate has been called.
+	{
+		int status = 0;
+		pid_t rc;
+		do
+		{
+			rc = ::waitpid(pid, &status, WNOHANG);
+		}
+		while (rc < 0 && errno == EINTR);
+		if (rc == 0) return false;
+
+		SharedPtr<ExitDelegate> pDelegate;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			ProcessMap::iterator it = _processes.find(pid);
+			if (it == _processes.end()) return false;
+			pDelegate = it->second.pDelegate;
+			removeProcess(pid);
+		}
+		int exitCode = -1;
+		int sig = 0;
+		if (rc == pid)
+		{
+			if (WIFEXITED(status)) exitCode = WEXITSTATUS(status);
+			else if (WIFSIGNALED(status)) sig = WTERMSIG(status);
+		}
+		ExitArgs args(pid, exitCode, sig);
+		pDelegate->notify(this, args);
+		return true;
+	}
+
+	void removePipe(int fd)
+		/// Removes the pipe. The mutex must be locked.
+	{
+		if (_pipes.erase(fd) == 0) return;
+#if defined(POCO_PROCESSREACTOR_EPOLL)
+		epoll_ctl(_fd, EPOLL_CTL_DEL, fd, 0);
+#endif
+	}
+
+	void removeProcess(ProcessHandle::PID pid)
+		/// Removes the process. The mutex must be locked.
+	{
+		ProcessMap::iterator it = _processes.find(pid);
+		if (it == _processes.end()) return;
+		if (it->second.fd >= 0)
+		{
+#if defined(POCO_PROCESSREACTOR_EPOLL)
+			epoll_ctl(_fd, EPOLL_CTL_DEL, it->second.fd, 0);
+#endif
+			_pidfds.erase(it->second.fd);
+			::close(it->second.fd);
+		}
+		_processes.erase(it);
+	}
+
+private:
+	void init()
+	{
+		if (::pipe(_wakeFd) < 0) throw CreateFileException("Cannot create pipe", Error::getMessage(Error::last()));
+		for (int i = 0; i < 2; ++i)
+		{
+			::fcntl(_wakeFd[i], F_SETFD, FD_CLOEXEC);
+			::fcntl(_wakeFd[i], F_SETFL, ::fcntl(_wakeFd[i], F_GETFL) | O_NONBLOCK);
+		}
+#if defined(POCO_PROCESSREACTOR_EPOLL)
+		_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (_fd < 0)
+		{
+			::close(_wakeFd[0]);
+			::close(_wakeFd[1]);
+			throw IOException("Cannot create epoll instance", Error::getMessage(Error::last()));
+		}
+		control(EPOLL_CTL_ADD, _wakeFd[0]);
+#endif
+	}
+
+#if defined(POCO_PROCESSREACTOR_EPOLL)
+	void control(int op, int fd)
+	{
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u64 = 0;
+		ev.data.fd = fd;
+		if (epoll_ctl(_fd, op, fd, &ev) < 0)
+		{
+			throw IOException("Cannot register file descriptor with epoll", Error::getMessage(Error::last()));
+		}
+	}
+#else
+	static void addPollFd(std::vector<struct pollfd>& pollFds, int fd)
+	{
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		pollFds.push_back(pfd);
+	}
+#endif
+
+	void drainWakeUp()
+	{
+		char buffer[64];
+		while (::read(_wakeFd[0], buffer, sizeof(buffer)) > 0);
+	}
+
+	ProcessReactor(const ProcessReactor&);
+	ProcessReactor& operator = (const ProcessReactor&);
+
+	Timespan _timeout;
+	volatile bool _stop;
+	int _fd;
+	int _wakeFd[2];
+	PipeMap _pipes;
+	ProcessMap _processes;
+	PidfdMap _pidfds;
+	mutable FastMutex _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // POCO_OS_FAMILY_UNIX
+
+
+#endif // Foundation_ProcessReactor_INCLUDED
@@ -0,0 +1,209 @@
+//
+// RandomPool.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Crypt
+// Module:  RandomPool
+//
+// Definition of the RandomPool class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_RandomPool_INCLUDED
+#define Foundation_RandomPool_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/RandomStream.h"
+#include "Poco/AtomicCounter.h"
+#if __cplusplus < 201103L
+#include "Poco/FastThreadLocal.h"
+#endif
+#include <cstring>
+#include <cstddef>
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <pthread.h>
+#endif
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#if defined(SYS_getrandom)
+#define POCO_RANDOMPOOL_GETRANDOM 1
+#endif
+#endif
+
+
+namespace Poco {
+
+
+class RandomPool
+	/// RandomPool hands out cryptographically strong random
+	/// bytes and numbers from a per-thread pool, which is
+	/// refilled from the operating system's random number
+	/// generator in batches of POOL_SIZE bytes.
+	///
+	/// RandomInputStream reads the system's random device for
+	/// every buffer it fills, and Random must be protected by a
+	/// mutex when it is shared between threads. With RandomPool,
+	/// threads never contend with each other, and the system is
+	/// only called once per POOL_SIZE bytes per thread, so that
+	/// random session IDs, authentication tokens and UUIDs can
+	/// be generated at a high rate.
+	///
+	/// On Linux, the pool is filled with the getrandom() system
+	/// call. Elsewhere, or if getrandom() is not available,
+	/// RandomInputStream is used.
+	///
+	/// The pools of all threads are discarded in a child process
+	/// created with fork(), so that parent and child never hand
+	/// out the same bytes.
+{
+public:
+	enum
+	{
+		POOL_SIZE = 4096
+	};
+
+	static void fill(void* buffer, std::size_t length)
+		/// Fills the given buffer with random bytes.
+	{
+		char* p = static_cast<char*>(buffer);
+		Pool& pool = threadPool();
+		while (length > 0)
+		{
+			if (pool.pos == POOL_SIZE || pool.generation != generation().value()) refill(pool);
+			std::size_t n = POOL_SIZE - pool.pos;
+			if (n > length) n = length;
+			std::memcpy(p, pool.data + pool.pos, n);
+			pool.pos += n;
+			p += n;
+			length -= n;
+		}
+	}
+
+	static UInt32 next32()
+		/// Returns a random 32-bit number.
+	{
+		UInt32 value;
+		fill(&value, sizeof(value));
+		return value;
+	}
+
+	static UInt64 next64()
+		/// Returns a random 64-bit number.
+	{
+		UInt64 value;
+		fill(&value, sizeof(value));
+		return value;
+	}
+
+	static UInt32 next(UInt32 n)
+		/// Returns a random number in the range [0, n),
+		/// with all numbers being equally likely.
+		/// n must be greater than 0.
+	{
+		poco_assert (n > 0);
+
+		// reject the values that would make the remainder biased
+		UInt32 threshold = (0u - n) % n;
+		UInt32 value;
+		do
+		{
+			value = next32();
+		}
+		while (value < threshold);
+		return value % n;
+	}
+
+	static void getEntropy(void* buffer, std::size_t length)
+		/// Fills the given buffer with random bytes obtained
+		/// directly from the operating system.
+	{
+		char* p = static_cast<char*>(buffer);
+#if defined(POCO_RANDOMPOOL_GETRANDOM)
+		while (length > 0)
+		{
+			long n = syscall(SYS_getrandom, p, length, 0);
+			if (n < 0)
+			{
+				if (errno == EINTR) continue;
+				break;
+			}
+			p += n;
+			length -= static_cast<std::size_t>(n);
+		}
+		if (length == 0) return;
+#endif
+		RandomInputStream random;
+		random.read(p, static_cast<std::streamsize>(length));
+	}
+
+private:
+	struct Pool
+	{
+		Pool():
+			pos(POOL_SIZE),
+			generation(-1)
+		{
+		}
+
+		char data[POOL_SIZE];
+		std::size_t pos;
+		int generation;
+	};
+
+	static void refill(Pool& pool)
+	{
+		getEntropy(pool.data, POOL_SIZE);
+		pool.pos = 0;
+		pool.generation = generation().value();
+	}
+
+	static Pool& threadPool()
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		static const int registered = pthread_atfork(0, 0, &onFork);
+		(void) registered;
+#endif
+#if __cplusplus >= 201103L
+		static thread_local Pool pool;
+		return pool;
+#else
+		static Poco::FastThreadLocal<Pool> pool;
+		return pool.get();
+#endif
+	}
+
+	static AtomicCounter& generation()
+		/// Counts the fork() calls, to detect pools
+		/// inherited from the parent process.
+	{
+		static AtomicCounter counter;
+		return counter;
+	}
+
+#if defined(POCO_OS_FAMILY_UNIX)
+	static void onFork()
+	{
+		++generation();
+	}
+#endif
+
+	RandomPool();
+	RandomPool(const RandomPool&);
+	RandomPool& operator = (const RandomPool&);
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_RandomPool_INCLUDED
@@ -0,0 +1,349 @@
+//
+// RateLimitingChannel.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Logging
+// Module:  RateLimitingChannel
+//
+// Definition of the RateLimitingChannel class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_RateLimitingChannel_INCLUDED
+#define Foundation_RateLimitingChannel_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Channel.h"
+#include "Poco/LogRecord.h"
+#include "Poco/Logger.h"
+#include "Poco/LoggingRegistry.h"
+#include "Poco/LoggingFactory.h"
+#include "Poco/Instantiator.h"
+#include "Poco/Message.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include "Poco/NumberParser.h"
+#include "Poco/NumberFormatter.h"
+#include <map>
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+
+
+class RateLimitingChannel: public Channel, public RecordChannel
+	/// A channel that limits the rate of the messages of each
+	/// logger, before passing them on to its target channel.
+	///
+	/// The messages of every source (logger name) go through their
+	/// own token bucket, which allows a burst of messages and then
+	/// at most rate messages per second, and can be sampled, so
+	/// that only one in every N messages is passed on. Messages at
+	/// least as important as the threshold priority are never
+	/// suppressed.
+	///
+	/// The number of messages suppressed for a source is reported
+	/// to the target channel, as a warning from the same source, at
+	/// most once per report interval, in front of the next message
+	/// of the source passed on, or when report() is called.
+	///
+	/// For LoggingConfigurator to create RateLimitingChannels, the
+	/// class must be registered with registerChannel() first:
+	///
+	///     logging.channels.limited.class = RateLimitingChannel
+	///     logging.channels.limited.channel = dlt
+	///     logging.channels.limited.rate = 10
+	///     logging.channels.limited.burst = 50
+	///     logging.channels.limited.sample = 1
+	///     logging.loggers.lte.name = LTE
+	///     logging.loggers.lte.channel = limited
+	///
+	/// The following properties are supported:
+	///   * channel:        The name of the target channel (set-only).
+	///   * rate:           The number of messages per second a source
+	///                     may log in the long run, 0 for no limit
+	///                     (default 0).
+	///   * burst:          The number of messages a source may log at
+	///                     once (default 100).
+	///   * sample:         Pass on one in every N messages (default 1).
+	///   * threshold:      The least important priority that is never
+	///                     suppressed, as name or number (default error).
+	///   * reportInterval: The minimum number of seconds between two
+	///                     reports for a source (default 10).
+{
+public:
+	typedef AutoPtr<RateLimitingChannel> Ptr;
+
+	RateLimitingChannel(Channel* pChannel = 0):
+		_pChannel(pChannel),
+		_rate(0),
+		_burst(100),
+		_sample(1),
+		_threshold(Message::PRIO_ERROR),
+		_reportInterval(10*Clock::resolution())
+		/// Creates the RateLimitingChannel and connects it to
+		/// the given channel.
+	{
+		if (_pChannel) _pChannel->duplicate();
+	}
+
+	void setChannel(Channel* pChannel)
+		/// Connects the RateLimitingChannel to the given target channel.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (_pChannel) _pChannel->release();
+		_pChannel = pChannel;
+		if (_pChannel) _pChannel->duplicate();
+	}
+
+	Channel* getChannel() const
+		/// Returns the target channel.
+	{
+		return _pChannel;
+	}
+
+	void open()
+		/// Opens the target channel.
+	{
+		if (_pChannel) _pChannel->open();
+	}
+
+	void close()
+		/// Reports suppressed messages and closes the target channel.
+	{
+		report();
+		if (_pChannel) _pChannel->close();
+	}
+
+	void log(const Message& msg)
+		/// Passes the message on to the target channel,
+		/// unless its source exceeds its limits.
+	{
+		std::vector<Message> reports;
+		if (admit(msg.getSource(), msg.getPriority(), reports))
+		{
+			forward(reports);
+			if (_pChannel) _pChannel->log(msg);
+		}
+		else forward(reports);
+	}
+
+	void log(const LogRecord& record)
+		/// Passes the record on to the target channel, unless its
+		/// source exceeds its limits, in which case it is not
+		/// even formatted.
+	{
+		std::vector<Message> reports;
+		if (admit(record.source(), record.priority(), reports))
+		{
+			forward(reports);
+			RecordChannel* pRecordChannel = dynamic_cast<RecordChannel*>(_pChannel);
+			if (pRecordChannel)
+				pRecordChannel->log(record);
+			else if (_pChannel)
+				_pChannel->log(record.message());
+		}
+		else forward(reports);
+	}
+
+	void report()
+		/// Reports the messages suppressed for all sources
+		/// since their last report.
+	{
+		std::vector<Message> reports;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			Clock now;
+			for (SourceMap::iterator it = _sources.begin(); it != _sources.end(); ++it)
+			{
+				if (it->second.suppressed > 0) reports.push_back(takeReport(it->first, it->second, now));
+			}
+		}
+		forward(reports);
+	}
+
+	UInt64 suppressed() const
+		/// Returns the total number of suppressed messages.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		UInt64 total = 0;
+		for (SourceMap::const_iterator it = _sources.begin(); it != _sources.end(); ++it)
+		{
+			total += it->second.total;
+		}
+		return total;
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+		/// Sets or changes a configuration property.
+		///
+		/// See the class documentation for the supported properties.
+	{
+		if (name == "channel")
+		{
+			setChannel(LoggingRegistry::defaultRegistry().channelForName(value));
+		}
+		else
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (name == "rate")
+				_rate = NumberParser::parseFloat(value);
+			else if (name == "burst")
+				_burst = NumberParser::parseFloat(value);
+			else if (name == "sample")
+				_sample = NumberParser::parseUnsigned(value);
+			else if (name == "threshold")
+				_threshold = static_cast<Message::Priority>(Logger::parseLevel(value));
+			else if (name == "reportInterval")
+				_reportInterval = static_cast<Clock::ClockDiff>(NumberParser::parseFloat(value)*Clock::resolution());
+			else
+				Channel::setProperty(name, value);
+		}
+	}
+
+	std::string getProperty(const std::string& name) const
+		/// Returns the value of the property with the given name.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (name == "rate")
+			return NumberFormatter::format(_rate);
+		else if (name == "burst")
+			return NumberFormatter::format(_burst);
+		else if (name == "sample")
+			return NumberFormatter::format(_sample);
+		else if (name == "threshold")
+			return NumberFormatter::format(static_cast<int>(_threshold));
+		else if (name == "reportInterval")
+			return NumberFormatter::format(static_cast<double>(_reportInterval)/Clock::resolution());
+		else
+			return Channel::getProperty(name);
+	}
+
+	static void registerChannel(LoggingFactory& factory = LoggingFactory::defaultFactory())
+		/// Registers the RateLimitingChannel class with the given
+		/// LoggingFactory, so that it can be used with
+		/// LoggingConfigurator.
+	{
+		factory.registerChannelClass("RateLimitingChannel", new Instantiator<RateLimitingChannel, Channel>);
+	}
+
+protected:
+	~RateLimitingChannel()
+		/// Destroys the RateLimitingChannel.
+	{
+		try
+		{
+			if (_pChannel) _pChannel->release();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+private:
+	struct SourceState
+	{
+		SourceState():
+			tokens(-1),
+			count(0),
+			suppressed(0),
+			total(0)
+		{
+		}
+
+		double tokens;
+		Clock  refilled;
+		Clock  reported;
+		UInt64 count;
+		UInt64 suppressed;
+		UInt64 total;
+	};
+
+	typedef std::map<std::string, SourceState> SourceMap;
+
+	RateLimitingChannel(const RateLimitingChannel&);
+	RateLimitingChannel& operator = (const RateLimitingChannel&);
+
+	bool admit(const std::string& source, Message::Priority prio, std::vector<Message>& reports)
+		/// Returns true if the message may be passed on. Adds a
+		/// report to reports if one is due for the source.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (prio <= _threshold || (_rate <= 0 && _sample <= 1)) return true;
+		SourceState& state = _sources[source];
+		Clock now;
+		bool pass = _sample <= 1 || state.count++ % _sample == 0;
+		if (pass && _rate > 0)
+		{
+			if (state.tokens < 0)
+			{
+				state.tokens   = _burst;
+				state.reported = now;
+			}
+			else
+			{
+				state.tokens += static_cast<double>(now - state.refilled)*_rate/Clock::resolution();
+				if (state.tokens > _burst) state.tokens = _burst;
+			}
+			state.refilled = now;
+			if (state.tokens >= 1)
+				state.tokens -= 1;
+			else
+				pass = false;
+		}
+		if (!pass)
+		{
+			++state.suppressed;
+			++state.total;
+		}
+		else if (state.suppressed > 0 && now - state.reported >= _reportInterval)
+		{
+			reports.push_back(takeReport(source, state, now));
+		}
+		return pass;
+	}
+
+	static Message takeReport(const std::string& source, SourceState& state, const Clock& now)
+	{
+		std::string text;
+		NumberFormatter::append(text, state.suppressed);
+		text += " message(s) suppressed by rate limit";
+		state.suppressed = 0;
+		state.reported   = now;
+		return Message(source, text, Message::PRIO_WARNING);
+	}
+
+	void forward(const std::vector<Message>& reports)
+	{
+		if (!_pChannel) return;
+		for (std::vector<Message>::const_iterator it = reports.begin(); it != reports.end(); ++it)
+		{
+			_pChannel->log(*it);
+		}
+	}
+
+	Channel* _pChannel;
+	double _rate;
+	double _burst;
+	unsigned _sample;
+	Message::Priority _threshold;
+	Clock::ClockDiff _reportInterval;
+	SourceMap _sources;
+	mutable FastMutex _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_RateLimitingChannel_INCLUDED
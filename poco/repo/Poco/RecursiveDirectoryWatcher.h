@@ -0,0 +1,638 @@
+//
+// RecursiveDirectoryWatcher.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Filesystem
+// Module:  RecursiveDirectoryWatcher
+//
+// Definition of the RecursiveDirectoryWatcher class.
+//
+// Copyright (c) 2012, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_RecursiveDirectoryWatcher_INCLUDED
+#define Foundation_RecursiveDirectoryWatcher_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Exception.h"
+#include <map>
+#include <vector>
+#include <string>
+#if POCO_OS == POCO_OS_LINUX && !defined(POCO_NO_INOTIFY)
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#define POCO_RDW_INOTIFY 1
+#endif
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#else
+#include "Poco/DirectoryIterator.h"
+#endif
+
+
+namespace Poco {
+
+
+class RecursiveDirectoryWatcher: protected Runnable
+	/// This class watches a directory and all its subdirectories
+	/// for changes, and reports the changes in batches.
+	///
+	/// On Linux, the class uses inotify, with one watch for every
+	/// directory in the tree. Watches for new subdirectories are
+	/// added as soon as they are created, and items created in them
+	/// before the watch was in place are found by scanning the new
+	/// directory. No periodic scanning is done.
+	///
+	/// The class keeps a snapshot of the tree (modification time and
+	/// size of every item). If the kernel's event queue overflows,
+	/// the watched directories are rescanned, and only the items that
+	/// differ from the snapshot are reported, so that no change is
+	/// lost. On platforms without inotify, or if inotify cannot be
+	/// initialized, the tree is rescanned the same way every
+	/// scanInterval seconds.
+	///
+	/// Changes are coalesced: a batch is reported when no further
+	/// change has occurred for coalesceInterval milliseconds (but at
+	/// the latest after ten times that interval), with one Change per
+	/// item, holding all kinds of changes seen for the item. A file
+	/// that is being copied into the tree is thus reported once, and
+	/// a file created and removed within a batch is reported as both
+	/// added and removed, so that receivers should check whether the
+	/// item still exists.
+	///
+	/// Batches are reported in the context of the watcher thread,
+	/// which is started by the constructor and stopped by the
+	/// destructor.
+	///
+	/// Symbolic links are reported, but not followed. When a
+	/// directory is removed or moved away, only the directory
+	/// itself is reported, not the items it contained.
+{
+public:
+	enum ChangeType
+		/// The kinds of changes, with the same values as the
+		/// corresponding DirectoryWatcher::DirectoryEventType.
+	{
+		ITEM_ADDED = 1,
+			/// An item has been created and added to the tree.
+
+		ITEM_REMOVED = 2,
+			/// An item has been removed from the tree.
+
+		ITEM_MODIFIED = 4,
+			/// An item has been modified.
+
+		ITEM_MOVED_FROM = 8,
+			/// An item has been renamed or moved away (inotify only).
+
+		ITEM_MOVED_TO = 16
+			/// An item has been renamed or moved here (inotify only).
+	};
+
+	enum
+	{
+		ITEM_ALL = 31,
+			/// Enables all kinds of changes.
+
+		DEFAULT_COALESCE_INTERVAL = 250,
+			/// Default coalesce interval in milliseconds.
+
+		DEFAULT_SCAN_INTERVAL = 5
+			/// Default scan interval in seconds, for platforms without inotify.
+	};
+
+	struct Change
+	{
+		std::string path;  /// The path of the item.
+		int changes;       /// The kinds of changes (ChangeType values OR-ed together).
+	};
+
+	typedef std::vector<Change> Changes;
+
+	BasicEvent<const Changes> changed;
+		/// Fired with a batch of changes.
+
+	BasicEvent<const Exception> scanError;
+		/// Fired when an error occurs while watching or scanning.
+
+	RecursiveDirectoryWatcher(const std::string& path, int eventMask = ITEM_ALL, long coalesceInterval = DEFAULT_COALESCE_INTERVAL, int scanInterval = DEFAULT_SCAN_INTERVAL):
+		_directory(path),
+		_eventMask(eventMask),
+		_coalesceInterval(coalesceInterval),
+		_scanInterval(scanInterval),
+		_stop(false),
+		_fd(-1),
+		_stopFd(-1),
+		_overflows(0)
+		/// Creates the RecursiveDirectoryWatcher for the directory given
+		/// in path and starts watching it.
+		///
+		/// To enable only specific changes, an eventMask can be
+		/// specified by OR-ing the desired ChangeType values.
+	{
+		if (_directory.empty() || _directory[_directory.size() - 1] != Path::separator()) _directory += Path::separator();
+		Entry entry;
+		if (!stat(_directory, entry)) throw FileNotFoundException(path);
+		if (!entry.directory) throw InvalidArgumentException("not a directory", path);
+#if defined(POCO_RDW_INOTIFY)
+		_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (_fd != -1)
+		{
+			_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (_stopFd == -1)
+			{
+				::close(_fd);
+				_fd = -1;
+			}
+		}
+#endif
+		if (_fd != -1) addWatches(_directory);
+		scan(_directory, _snapshot, 0);
+		_thread.start(*this);
+	}
+
+	~RecursiveDirectoryWatcher()
+		/// Stops watching and destroys the RecursiveDirectoryWatcher.
+	{
+		try
+		{
+			_stop = true;
+#if defined(POCO_RDW_INOTIFY)
+			if (_stopFd != -1)
+			{
+				eventfd_write(_stopFd, 1);
+			}
+			else
+#endif
+			{
+				_stopEvent.set();
+			}
+			_thread.join();
+#if defined(POCO_RDW_INOTIFY)
+			if (_fd != -1) ::close(_fd);
+			if (_stopFd != -1) ::close(_stopFd);
+#endif
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	const std::string& directory() const
+		/// Returns the path of the directory being watched.
+	{
+		return _directory;
+	}
+
+	int eventMask() const
+		/// Returns the value of the eventMask passed to the constructor.
+	{
+		return _eventMask;
+	}
+
+	bool usesNotifications() const
+		/// Returns true iff the tree is watched using inotify,
+		/// and false if it is scanned periodically.
+	{
+		return _fd != -1;
+	}
+
+	int overflows() const
+		/// Returns the number of times the event queue has
+		/// overflowed, each of which caused a rescan.
+	{
+		return _overflows;
+	}
+
+protected:
+	struct Entry
+	{
+		Entry():
+			modified(0),
+			size(0),
+			directory(false)
+		{
+		}
+
+		bool operator != (const Entry& entry) const
+		{
+			return modified != entry.modified || size != entry.size || directory != entry.directory;
+		}
+
+		Timestamp::TimeVal modified;
+		File::FileSize size;
+		bool directory;
+	};
+
+	typedef std::map<std::string, Entry> Snapshot;
+	typedef std::map<std::string, int> Pending;
+	typedef std::map<int, std::string> Watches;
+
+	void run()
+	{
+		Pending pending;
+		Timestamp first(0);
+		Timestamp last(0);
+		while (!_stop)
+		{
+			try
+			{
+				if (_fd != -1)
+				{
+					long timeout = -1;
+					if (!pending.empty())
+					{
+						Timestamp::TimeDiff remaining = _coalesceInterval*1000 - last.elapsed();
+						Timestamp::TimeDiff maxRemaining = 10*_coalesceInterval*1000 - first.elapsed();
+						if (maxRemaining < remaining) remaining = maxRemaining;
+						timeout = remaining > 0 ? static_cast<long>(remaining/1000) : 0;
+					}
+					if (wait(timeout))
+					{
+						if (pending.empty()) first.update();
+						readEvents(pending);
+						last.update();
+					}
+					if (!pending.empty() && (last.elapsed() >= _coalesceInterval*1000 || first.elapsed() >= 10*_coalesceInterval*1000))
+					{
+						flush(pending);
+					}
+				}
+				else
+				{
+					if (_stopEvent.tryWait(1000*_scanInterval)) break;
+					Snapshot snapshot;
+					scan(_directory, snapshot, 0);
+					diff(snapshot, pending);
+					_snapshot.swap(snapshot);
+					report(pending);
+				}
+			}
+			catch (Exception& exc)
+			{
+				scanError.notify(this, exc);
+			}
+			catch (std::exception& exc)
+			{
+				scanError.notify(this, SystemException(exc.what()));
+			}
+		}
+	}
+
+	bool wait(long timeout)
+		/// Waits for events for at most timeout milliseconds, or
+		/// forever, if timeout is -1. Returns true if events are
+		/// available.
+	{
+#if defined(POCO_RDW_INOTIFY)
+		struct pollfd fds[2];
+		fds[0].fd = _fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = _stopFd;
+		fds[1].events = POLLIN;
+		int rc;
+		do
+		{
+			rc = ::poll(fds, 2, static_cast<int>(timeout));
+		}
+		while (rc < 0 && errno == EINTR);
+		if (rc < 0) throw SystemException("cannot poll inotify descriptor");
+		return rc > 0 && !_stop && (fds[0].revents & POLLIN);
+#else
+		(void) timeout;
+		return false;
+#endif
+	}
+
+	void readEvents(Pending& pending)
+		/// Reads all available inotify events and records
+		/// them in pending.
+	{
+#if defined(POCO_RDW_INOTIFY)
+		union
+		{
+			struct inotify_event event;
+			char buffer[16384];
+		} u;
+		ssize_t n;
+		while ((n = ::read(_fd, u.buffer, sizeof(u.buffer))) > 0)
+		{
+			for (const char* p = u.buffer; p < u.buffer + n; )
+			{
+				const struct inotify_event* pEvent = reinterpret_cast<const struct inotify_event*>(p);
+				handleEvent(*pEvent, pending);
+				p += sizeof(struct inotify_event) + pEvent->len;
+			}
+		}
+		if (n < 0 && errno != EAGAIN && errno != EINTR) throw SystemException("cannot read inotify events");
+#else
+		(void) pending;
+#endif
+	}
+
+#if defined(POCO_RDW_INOTIFY)
+
+	void handleEvent(const struct inotify_event& event, Pending& pending)
+	{
+		if (event.mask & IN_Q_OVERFLOW)
+		{
+			recover(pending);
+			return;
+		}
+		Watches::iterator it = _watches.find(event.wd);
+		if (it == _watches.end()) return;
+		if (event.mask & IN_IGNORED)
+		{
+			_watches.erase(it);
+			return;
+		}
+		if (event.len == 0) return;
+
+		std::string path(it->second);
+		path.append(event.name);
+		bool isDir = (event.mask & IN_ISDIR) != 0;
+		int changes = 0;
+		if (event.mask & IN_CREATE) changes |= ITEM_ADDED;
+		if (event.mask & IN_DELETE) changes |= ITEM_REMOVED;
+		if (event.mask & (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB)) changes |= ITEM_MODIFIED;
+		if (event.mask & IN_MOVED_FROM) changes |= ITEM_MOVED_FROM;
+		if (event.mask & IN_MOVED_TO) changes |= ITEM_MOVED_TO;
+		if (isDir && (changes & (ITEM_ADDED | ITEM_MOVED_TO)))
+		{
+			// Items may have been created in the new directory
+			// before the watch was added, so scan it.
+			std::string dirPath(path);
+			dirPath += Path::separator();
+			addWatches(dirPath);
+			Snapshot snapshot;
+			scan(dirPath, snapshot, 0);
+			for (Snapshot::const_iterator sit = snapshot.begin(); sit != snapshot.end(); ++sit)
+			{
+				if (_snapshot.find(sit->first) == _snapshot.end()) pending[sit->first] |= ITEM_ADDED;
+			}
+		}
+		if (isDir && (changes & (ITEM_REMOVED | ITEM_MOVED_FROM)))
+		{
+			removeWatches(path + Path::separator());
+		}
+		if (changes) pending[path] |= changes;
+	}
+
+	void recover(Pending& pending)
+		/// Rescans the tree after the event queue has overflowed,
+		/// and records all differences to the snapshot.
+	{
+		++_overflows;
+		flush(pending);
+		for (Watches::const_iterator it = _watches.begin(); it != _watches.end(); ++it)
+		{
+			inotify_rm_watch(_fd, it->first);
+		}
+		_watches.clear();
+		addWatches(_directory);
+		Snapshot snapshot;
+		scan(_directory, snapshot, 0);
+		diff(snapshot, pending);
+		_snapshot.swap(snapshot);
+	}
+
+#endif // POCO_RDW_INOTIFY
+
+	void addWatches(const std::string& dirPath)
+		/// Adds watches for the given directory and all its
+		/// subdirectories.
+	{
+#if defined(POCO_RDW_INOTIFY)
+		const uint32_t mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW;
+		int wd = inotify_add_watch(_fd, dirPath.c_str(), mask);
+		if (wd == -1)
+		{
+			if (errno == ENOSPC) scanError.notify(this, SystemException("inotify watch limit reached", dirPath));
+			return;
+		}
+		_watches[wd] = dirPath;
+		std::vector<std::string> names;
+		list(dirPath, names);
+		for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+		{
+			Entry entry;
+			std::string path(dirPath + *it);
+			if (stat(path, entry) && entry.directory) addWatches(path + Path::separator());
+		}
+#else
+		(void) dirPath;
+#endif
+	}
+
+	void removeWatches(const std::string& dirPath)
+		/// Removes the watches for the given directory and all
+		/// its subdirectories, and their items from the snapshot.
+	{
+#if defined(POCO_RDW_INOTIFY)
+		for (Watches::iterator it = _watches.begin(); it != _watches.end(); )
+		{
+			if (it->second.compare(0, dirPath.size(), dirPath) == 0)
+			{
+				inotify_rm_watch(_fd, it->first);
+				_watches.erase(it++);
+			}
+			else ++it;
+		}
+#endif
+		Snapshot::iterator it = _snapshot.lower_bound(dirPath);
+		while (it != _snapshot.end() && it->first.compare(0, dirPath.size(), dirPath) == 0)
+		{
+			_snapshot.erase(it++);
+		}
+	}
+
+	void scan(const std::string& dirPath, Snapshot& snapshot, int depth)
+		/// Adds all items of the given directory and its
+		/// subdirectories to the snapshot.
+	{
+		if (depth > MAX_DEPTH) return;
+		std::vector<std::string> names;
+		list(dirPath, names);
+		for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+		{
+			std::string path(dirPath + *it);
+			Entry entry;
+			if (!stat(path, entry)) continue;
+			snapshot[path] = entry;
+			if (entry.directory) scan(path + Path::separator(), snapshot, depth + 1);
+		}
+	}
+
+	static void list(const std::string& dirPath, std::vector<std::string>& names)
+		/// Returns the names of all items in the given directory,
+		/// or no names, if the directory cannot be read (for
+		/// instance, because it has been removed in the meantime).
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		DIR* pDir = ::opendir(dirPath.c_str());
+		if (!pDir) return;
+		while (struct dirent* pEntry = ::readdir(pDir))
+		{
+			const char* name = pEntry->d_name;
+			if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+			names.push_back(name);
+		}
+		::closedir(pDir);
+#else
+		try
+		{
+			DirectoryIterator end;
+			for (DirectoryIterator it(dirPath); it != end; ++it)
+			{
+				names.push_back(it.name());
+			}
+		}
+		catch (FileException&)
+		{
+		}
+#endif
+	}
+
+	void diff(const Snapshot& snapshot, Pending& pending)
+		/// Records the differences between the stored snapshot
+		/// and the given new one.
+	{
+		Snapshot::const_iterator itOld = _snapshot.begin();
+		Snapshot::const_iterator itNew = snapshot.begin();
+		while (itOld != _snapshot.end() || itNew != snapshot.end())
+		{
+			if (itNew == snapshot.end() || (itOld != _snapshot.end() && itOld->first < itNew->first))
+			{
+				pending[itOld->first] |= ITEM_REMOVED;
+				++itOld;
+			}
+			else if (itOld == _snapshot.end() || itNew->first < itOld->first)
+			{
+				pending[itNew->first] |= ITEM_ADDED;
+				++itNew;
+			}
+			else
+			{
+				if (itOld->second != itNew->second && !itNew->second.directory) pending[itNew->first] |= ITEM_MODIFIED;
+				++itOld;
+				++itNew;
+			}
+		}
+	}
+
+	void flush(Pending& pending)
+		/// Updates the snapshot for all pending items
+		/// and reports them.
+	{
+		for (Pending::const_iterator it = pending.begin(); it != pending.end(); ++it)
+		{
+			Entry entry;
+			if (stat(it->first, entry))
+				_snapshot[it->first] = entry;
+			else
+				_snapshot.erase(it->first);
+		}
+		report(pending);
+	}
+
+	void report(Pending& pending)
+		/// Fires the changed event for the pending changes
+		/// enabled in the event mask, and clears pending.
+	{
+		Changes changes;
+		changes.reserve(pending.size());
+		for (Pending::const_iterator it = pending.begin(); it != pending.end(); ++it)
+		{
+			int enabled = it->second & _eventMask;
+			if (enabled)
+			{
+				Change change;
+				change.path = it->first;
+				change.changes = enabled;
+				changes.push_back(change);
+			}
+		}
+		pending.clear();
+		if (!changes.empty()) changed.notify(this, changes);
+	}
+
+	static bool stat(const std::string& path, Entry& entry)
+		/// Gets the modification time, size and type of the given
+		/// item, without following symbolic links. Returns false
+		/// if the item does not exist.
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		struct stat st;
+		if (::lstat(path.c_str(), &st) != 0) return false;
+		entry.modified  = static_cast<Timestamp::TimeVal>(st.st_mtime)*Timestamp::resolution();
+#if POCO_OS == POCO_OS_LINUX
+		entry.modified += st.st_mtim.tv_nsec/1000;
+#endif
+		entry.size      = static_cast<File::FileSize>(st.st_size);
+		entry.directory = S_ISDIR(st.st_mode);
+		return true;
+#else
+		try
+		{
+			File file(path);
+			entry.directory = file.isDirectory();
+			entry.modified  = file.getLastModified().epochMicroseconds();
+			entry.size      = entry.directory ? 0 : file.getSize();
+			return true;
+		}
+		catch (FileException&)
+		{
+			return false;
+		}
+#endif
+	}
+
+private:
+	enum
+	{
+		MAX_DEPTH = 64
+	};
+
+	RecursiveDirectoryWatcher();
+	RecursiveDirectoryWatcher(const RecursiveDirectoryWatcher&);
+	RecursiveDirectoryWatcher& operator = (const RecursiveDirectoryWatcher&);
+
+	std::string _directory;
+	int _eventMask;
+	long _coalesceInterval;
+	int _scanInterval;
+	volatile bool _stop;
+	int _fd;
+	int _stopFd;
+	int _overflows;
+	Watches _watches;
+	Snapshot _snapshot;
+	Event _stopEvent;
+	Thread _thread;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_RecursiveDirectoryWatcher_INCLUDED
@@ -0,0 +1,162 @@
+//
+// RegularExpressionCache.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: RegExp
+// Module:  RegularExpressionCache
+//
+// Definition of the RegularExpressionCache class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_RegularExpressionCache_INCLUDED
+#define Foundation_RegularExpressionCache_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/RegularExpression.h"
+#include "Poco/ConcurrentCache.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/NumberFormatter.h"
+#include <string>
+
+
+namespace Poco {
+
+
+class RegularExpressionCache
+	/// RegularExpressionCache keeps compiled (and studied) regular
+	/// expressions, keyed by pattern and compile options, so that code
+	/// matching against patterns given as strings, e.g. from a
+	/// configuration or a request, compiles every pattern only once.
+	///
+	/// A RegularExpression can be used by multiple threads at the same
+	/// time, as all matching functions are const and keep their state
+	/// on the stack, so the cached objects are shared.
+	///
+	/// When the cache is full, patterns that have not been used
+	/// recently are evicted (see ConcurrentCache).
+	/// RegularExpressionCache is thread-safe.
+	///
+	/// Example:
+	///     Poco::RegularExpressionCache::Ptr pRE = Poco::RegularExpressionCache::defaultCache().get("^/api/v[0-9]+/");
+	///     if (pRE->match(path)) ...
+	///
+	///     if (Poco::RegularExpressionCache::match(path, "^/static/", Poco::RegularExpression::RE_ANCHORED)) ...
+{
+public:
+	typedef SharedPtr<RegularExpression> Ptr;
+	typedef ConcurrentCache<std::string, Ptr>::Statistics Statistics;
+
+	enum
+	{
+		DEFAULT_CAPACITY = 256
+	};
+
+	explicit RegularExpressionCache(std::size_t capacity = DEFAULT_CAPACITY):
+		_cache(capacity)
+		/// Creates a RegularExpressionCache for up to
+		/// capacity compiled patterns.
+	{
+	}
+
+	~RegularExpressionCache()
+		/// Destroys the RegularExpressionCache.
+	{
+	}
+
+	Ptr get(const std::string& pattern, int options = 0)
+		/// Returns the compiled regular expression for the given
+		/// pattern and compile options, compiling it if it is not
+		/// (or no longer) in the cache.
+		///
+		/// Throws a RegularExpressionException if the pattern
+		/// cannot be compiled.
+	{
+		std::string key(keyOf(pattern, options));
+		Ptr pRE;
+		if (!_cache.get(key, pRE))
+		{
+			pRE = new RegularExpression(pattern, options, true);
+			_cache.add(key, pRE);
+		}
+		return pRE;
+	}
+
+	void clear()
+		/// Removes all compiled patterns.
+	{
+		_cache.clear();
+	}
+
+	std::size_t size() const
+		/// Returns the number of compiled patterns.
+	{
+		return _cache.size();
+	}
+
+	Statistics statistics() const
+		/// Returns the hits, misses and evictions of the cache.
+	{
+		return _cache.statistics();
+	}
+
+	static bool match(const std::string& subject, const std::string& pattern, int options = 0)
+		/// Matches the given subject string against the given pattern,
+		/// like RegularExpression::match(subject, pattern, options), but
+		/// with the pattern taken from (or compiled into) the default cache,
+		/// instead of compiling it for every call.
+	{
+		int ctorOptions = options & CTOR_OPTIONS;
+		int mtchOptions = options & MATCH_OPTIONS;
+		return defaultCache().get(pattern, ctorOptions)->match(subject, 0, mtchOptions);
+	}
+
+	static RegularExpressionCache& defaultCache()
+		/// Returns the process-wide RegularExpressionCache.
+	{
+		static RegularExpressionCache* pCache = new RegularExpressionCache;
+		return *pCache;
+	}
+
+private:
+	enum
+	{
+		MATCH_OPTIONS = RegularExpression::RE_ANCHORED | RegularExpression::RE_NOTBOL | RegularExpression::RE_NOTEOL
+		              | RegularExpression::RE_NOTEMPTY | RegularExpression::RE_NO_AUTO_CAPTURE | RegularExpression::RE_NO_UTF8_CHECK,
+			/// Options passed to RegularExpression::match().
+		CTOR_OPTIONS = RegularExpression::RE_CASELESS | RegularExpression::RE_MULTILINE | RegularExpression::RE_DOTALL
+		             | RegularExpression::RE_EXTENDED | RegularExpression::RE_ANCHORED | RegularExpression::RE_DOLLAR_ENDONLY
+		             | RegularExpression::RE_EXTRA | RegularExpression::RE_UNGREEDY | RegularExpression::RE_UTF8
+		             | RegularExpression::RE_NO_AUTO_CAPTURE
+			/// Options passed to the RegularExpression constructor.
+	};
+
+	static std::string keyOf(const std::string& pattern, int options)
+	{
+		std::string key;
+		key.reserve(pattern.size() + 9);
+		NumberFormatter::appendHex(key, static_cast<unsigned>(options), 8);
+		key += ':';
+		key += pattern;
+		return key;
+	}
+
+	RegularExpressionCache(const RegularExpressionCache&);
+	RegularExpressionCache& operator = (const RegularExpressionCache&);
+
+	ConcurrentCache<std::string, Ptr> _cache;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_RegularExpressionCache_INCLUDED
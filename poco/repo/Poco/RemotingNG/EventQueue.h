@@ -0,0 +1,420 @@
+//
+// EventQueue.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: ORB
+// Module:  EventQueue
+//
+// Definition of the EventQueue class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_EventQueue_INCLUDED
+#define RemotingNG_EventQueue_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Transport.h"
+#include "Poco/IsolatingStrategy.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Mutex.h"
+#include "Poco/Clock.h"
+#include <deque>
+#include <map>
+#include <string>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class EventTask: public Poco::RefCountedObject
+	/// An event message to be sent to a subscriber.
+{
+public:
+	typedef Poco::AutoPtr<EventTask> Ptr;
+
+	virtual void send(Transport& transport) = 0;
+		/// Sends the event message using the given Transport.
+		///
+		/// Called with the Transport locked.
+
+protected:
+	EventTask()
+	{
+	}
+
+	~EventTask()
+	{
+	}
+};
+
+
+template <class C, class A>
+class EventTaskImpl: public EventTask
+	/// An EventTask that holds a copy of the event argument and
+	/// sends it by calling a member function of the EventDispatcher.
+{
+public:
+	typedef void (C::*Callback)(Transport&, const A&);
+
+	EventTaskImpl(C& dispatcher, Callback method, const A& arg):
+		_pDispatcher(&dispatcher, true),
+		_method(method),
+		_arg(arg)
+	{
+	}
+
+	void send(Transport& transport)
+	{
+		((*_pDispatcher).*_method)(transport, _arg);
+	}
+
+protected:
+	~EventTaskImpl()
+	{
+	}
+
+private:
+	Poco::AutoPtr<C> _pDispatcher;
+	Callback _method;
+	A _arg;
+};
+
+
+class EventSubscriberQueue: public Poco::IsolatedSubscriber
+	/// The bounded queue of event messages for a subscriber,
+	/// served by the IsolatingEventDispatcher's workers.
+	///
+	/// Every time the subscriber is served, up to a batch of queued
+	/// messages is sent with the Transport held locked, so that the
+	/// messages follow each other on the connection without other
+	/// senders interleaving. If the queue is full, the oldest message
+	/// is dropped. A message queued with a coalescing key replaces a
+	/// queued message having the same key, so that a state event that
+	/// has not been sent yet is superseded by a newer one.
+{
+public:
+	typedef Poco::AutoPtr<EventSubscriberQueue> Ptr;
+
+	struct Statistics
+	{
+		Statistics():
+			depth(0),
+			sent(0),
+			dropped(0),
+			coalesced(0),
+			failed(0),
+			totalLatency(0),
+			maxLatency(0)
+		{
+		}
+
+		Poco::Int64 averageLatency() const
+			/// Returns the average time from queuing to sending,
+			/// in microseconds.
+		{
+			return sent > 0 ? totalLatency/static_cast<Poco::Int64>(sent) : 0;
+		}
+
+		std::size_t  depth;        /// Queued messages.
+		Poco::UInt64 sent;         /// Messages sent.
+		Poco::UInt64 dropped;      /// Messages dropped because the queue was full.
+		Poco::UInt64 coalesced;    /// Messages replaced by newer ones.
+		Poco::UInt64 failed;       /// Messages that could not be sent.
+		Poco::Int64  totalLatency; /// Sum of queuing to sending times, in microseconds.
+		Poco::Int64  maxLatency;   /// Maximum queuing to sending time, in microseconds.
+	};
+
+	EventSubscriberQueue(Transport::Ptr pTransport, std::size_t capacity, std::size_t batchSize):
+		Poco::IsolatedSubscriber(Poco::IsolatingEventDispatcher::NORMAL_PRIORITY),
+		_pTransport(pTransport),
+		_capacity(capacity > 0 ? capacity : 1),
+		_batchSize(batchSize > 0 ? batchSize : 1),
+		_scheduled(false),
+		_disabled(false)
+	{
+	}
+
+	void enqueue(const std::string& key, EventTask::Ptr pTask)
+		/// Queues the message, replacing a queued message with
+		/// the same non-empty key, and schedules the subscriber.
+	{
+		bool schedule = false;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (_disabled) return;
+			if (!key.empty())
+			{
+				for (EntryDeque::iterator it = _queue.begin(); it != _queue.end(); ++it)
+				{
+					if (it->key == key)
+					{
+						it->pTask = pTask;
+						++_statistics.coalesced;
+						return;
+					}
+				}
+			}
+			if (_queue.size() >= _capacity)
+			{
+				_queue.pop_front();
+				++_statistics.dropped;
+			}
+			_queue.push_back(Entry(key, pTask));
+			schedule = !_scheduled;
+			_scheduled = true;
+		}
+		if (schedule) Poco::IsolatingEventDispatcher::instance().schedule(this);
+	}
+
+	void disable()
+		/// Discards all queued messages and stops queuing.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_disabled = true;
+		_queue.clear();
+	}
+
+	Statistics statistics() const
+		/// Returns the queue statistics.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		Statistics statistics(_statistics);
+		statistics.depth = _queue.size();
+		return statistics;
+	}
+
+	// IsolatedSubscriber
+	bool serve()
+	{
+		EntryDeque batch;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			while (!_queue.empty() && batch.size() < _batchSize)
+			{
+				batch.push_back(_queue.front());
+				_queue.pop_front();
+			}
+		}
+		Poco::UInt64 sent = 0;
+		Poco::UInt64 failed = 0;
+		Poco::Int64 totalLatency = 0;
+		Poco::Int64 maxLatency = 0;
+		if (!batch.empty())
+		{
+			_pTransport->lock();
+			for (EntryDeque::iterator it = batch.begin(); it != batch.end(); ++it)
+			{
+				try
+				{
+					it->pTask->send(*_pTransport);
+					Poco::Int64 latency = it->queued.elapsed();
+					totalLatency += latency;
+					if (latency > maxLatency) maxLatency = latency;
+					++sent;
+				}
+				catch (...)
+				{
+					++failed;
+				}
+			}
+			_pTransport->unlock();
+		}
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_statistics.sent += sent;
+		_statistics.failed += failed;
+		_statistics.totalLatency += totalLatency;
+		if (maxLatency > _statistics.maxLatency) _statistics.maxLatency = maxLatency;
+		if (_queue.empty())
+		{
+			_scheduled = false;
+			return false;
+		}
+		return true;
+	}
+
+protected:
+	~EventSubscriberQueue()
+	{
+	}
+
+private:
+	struct Entry
+	{
+		Entry(const std::string& k, EventTask::Ptr pT):
+			key(k),
+			pTask(pT)
+		{
+		}
+
+		std::string key;
+		EventTask::Ptr pTask;
+		Poco::Clock queued;
+	};
+
+	typedef std::deque<Entry> EntryDeque;
+
+	Transport::Ptr _pTransport;
+	std::size_t _capacity;
+	std::size_t _batchSize;
+	EntryDeque _queue;
+	bool _scheduled;
+	bool _disabled;
+	Statistics _statistics;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+class EventQueue
+	/// EventQueue decouples firing an event from sending the
+	/// event messages to the remote subscribers.
+	///
+	/// EventDispatcher sends an event to all subscribers one after
+	/// the other, on the thread firing the event, and with its mutex
+	/// held, so that a slow or unreachable subscriber delays the events
+	/// to all other subscribers, as well as the service firing them.
+	/// An EventDispatcher using an EventQueue instead queues an EventTask
+	/// per subscriber, which is sent later from a worker thread of the
+	/// IsolatingEventDispatcher. Every subscriber has its own bounded
+	/// queue (see EventSubscriberQueue), and is served by one worker at
+	/// a time.
+	///
+	/// Usage example, in an EventDispatcher subclass:
+	///
+	///     void event__onStateChanged(const void* pSender, const State& state)
+	///     {
+	///         Poco::FastMutex::ScopedLock lock(_mutex);
+	///         for (SubscriberMap::iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+	///         {
+	///             if (accept(it->second->filters, "onStateChanged", state))
+	///             {
+	///                 _queue.enqueue(it->first, it->second->pTransport, "onStateChanged",
+	///                     new EventTaskImpl<ServiceEventDispatcher, State>(*this, &ServiceEventDispatcher::sendStateChanged, state));
+	///             }
+	///         }
+	///     }
+	///
+	/// where sendStateChanged() serializes and sends the event message
+	/// with the given Transport, like the generated event__onStateChangedImpl().
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY = 256,
+		DEFAULT_BATCH_SIZE = 16
+	};
+
+	explicit EventQueue(std::size_t capacity = DEFAULT_CAPACITY, std::size_t batchSize = DEFAULT_BATCH_SIZE):
+		_capacity(capacity),
+		_batchSize(batchSize)
+		/// Creates the EventQueue, with the given capacity and batch
+		/// size for every subscriber queue.
+	{
+	}
+
+	~EventQueue()
+		/// Discards all queued messages and destroys the EventQueue.
+	{
+		try
+		{
+			clear();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void enqueue(const std::string& subscriberURI, Transport::Ptr pTransport, const std::string& key, EventTask::Ptr pTask)
+		/// Queues the task for the subscriber.
+		///
+		/// If key is not empty, a queued task for the subscriber
+		/// with the same key is replaced.
+	{
+		EventSubscriberQueue::Ptr pQueue;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			QueueMap::iterator it = _queues.find(subscriberURI);
+			if (it == _queues.end())
+			{
+				pQueue = new EventSubscriberQueue(pTransport, _capacity, _batchSize);
+				_queues[subscriberURI] = pQueue;
+			}
+			else pQueue = it->second;
+		}
+		pQueue->enqueue(key, pTask);
+	}
+
+	void remove(const std::string& subscriberURI)
+		/// Discards the queue of the given subscriber, e.g.
+		/// after the subscriber has unsubscribed.
+	{
+		EventSubscriberQueue::Ptr pQueue;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			QueueMap::iterator it = _queues.find(subscriberURI);
+			if (it == _queues.end()) return;
+			pQueue = it->second;
+			_queues.erase(it);
+		}
+		pQueue->disable();
+	}
+
+	void clear()
+		/// Discards all subscriber queues.
+	{
+		QueueMap queues;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			queues.swap(_queues);
+		}
+		for (QueueMap::iterator it = queues.begin(); it != queues.end(); ++it)
+		{
+			it->second->disable();
+		}
+	}
+
+	EventSubscriberQueue::Statistics statistics(const std::string& subscriberURI) const
+		/// Returns the statistics for the given subscriber.
+		///
+		/// Throws a Poco::NotFoundException if the subscriber has no queue.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		QueueMap::const_iterator it = _queues.find(subscriberURI);
+		if (it == _queues.end()) throw Poco::NotFoundException("No event queue for subscriber", subscriberURI);
+		return it->second->statistics();
+	}
+
+	std::size_t size() const
+		/// Returns the number of subscriber queues.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _queues.size();
+	}
+
+private:
+	typedef std::map<std::string, EventSubscriberQueue::Ptr> QueueMap;
+
+	EventQueue(const EventQueue&);
+	EventQueue& operator = (const EventQueue&);
+
+	std::size_t _capacity;
+	std::size_t _batchSize;
+	QueueMap _queues;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_EventQueue_INCLUDED
@@ -0,0 +1,509 @@
+//
+// FlatBinaryDeserializer.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Serialization
+// Module:  FlatBinaryDeserializer
+//
+// Definition of the FlatBinaryDeserializer class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_FlatBinaryDeserializer_INCLUDED
+#define RemotingNG_FlatBinaryDeserializer_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Deserializer.h"
+#include "Poco/RemotingNG/FlatBinarySerializer.h"
+#include "Poco/RemotingNG/BulkSerialization.h"
+#include "Poco/RemotingNG/OrdinalSerialization.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include <istream>
+#include <vector>
+#include <cstring>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class FlatBinaryDeserializer: public Deserializer, public BulkDeserializer, public OrdinalDeserializer
+	/// A Deserializer for the format written by FlatBinarySerializer,
+	/// reading from a contiguous span of memory.
+	///
+	/// The span is either given directly with setup(const char*, std::size_t),
+	/// e.g. the payload of a received frame, or, if the deserializer is
+	/// set up with an input stream, filled with the complete message,
+	/// read from the stream with bulk reads.
+	///
+	/// Values are loaded with inlined little-endian loads, and sequences
+	/// of fixed-size arithmetic types and blobs with a single memcpy()
+	/// (see BulkDeserializer).
+	///
+	/// Messages in compact mode, with variable-length integers (see
+	/// FlatBinarySerializer::setCompact()), are recognized by their
+	/// format version, and read as well.
+{
+public:
+	FlatBinaryDeserializer():
+		_pCur(0),
+		_pEnd(0),
+		_messageType(SerializerBase::MESSAGE_REQUEST),
+		_messageOrdinal(NO_ORDINAL),
+		_headerRead(false),
+		_compact(false),
+		_level(0),
+		_skipCount(false)
+		/// Creates a FlatBinaryDeserializer.
+	{
+	}
+
+	~FlatBinaryDeserializer()
+		/// Destroys the FlatBinaryDeserializer.
+	{
+	}
+
+	using Deserializer::setup;
+
+	void setup(const char* pData, std::size_t size)
+		/// Set up the FlatBinaryDeserializer for reading the
+		/// message in the given memory, which must remain valid
+		/// until deserialization is complete.
+	{
+		reset();
+		_pCur = pData;
+		_pEnd = pData + size;
+	}
+
+	void deserializeEndPoint(std::string& oid, std::string& tid)
+		/// Deserializes the object and type ID of the service object.
+	{
+		readString(oid);
+		readString(tid);
+	}
+
+	template <typename T>
+	T deserializeToken()
+		/// Deserializes a value, which must be an arithmetic type.
+	{
+		return read<T>();
+	}
+
+	// Deserializer
+	SerializerBase::MessageType findMessage(std::string& name)
+	{
+		if (!_headerRead) readHeader();
+		name = _messageName;
+		return _messageType;
+	}
+
+	void deserializeMessageBegin(const std::string& /*name*/, SerializerBase::MessageType type)
+	{
+		if (!_headerRead) readHeader();
+		if (_messageType == SerializerBase::MESSAGE_FAULT && type != SerializerBase::MESSAGE_FAULT)
+		{
+			std::string exceptionName;
+			std::string message;
+			readString(exceptionName);
+			readString(message);
+			Poco::Int32 code = readSigned<Poco::Int32>();
+			throw RemoteException(exceptionName, message, code);
+		}
+		if (_messageType != type) throw UnexpectedMessageException(_messageName);
+	}
+
+	void deserializeMessageEnd(const std::string& /*name*/, SerializerBase::MessageType /*type*/)
+	{
+		_headerRead = false;
+	}
+
+	bool deserializeStructBegin(const std::string& /*name*/, bool /*isMandatory*/)
+	{
+		if (!consume()) return false;
+		++_level;
+		return true;
+	}
+
+	void deserializeStructEnd(const std::string& /*name*/)
+	{
+		--_level;
+	}
+
+	bool deserializeSequenceBegin(const std::string& /*name*/, bool /*isMandatory*/, Poco::UInt32& lengthHint)
+	{
+		if (!consume()) return false;
+		lengthHint = readUnsigned<Poco::UInt32>();
+		_sequences.push_back(Sequence(lengthHint, ++_level));
+		return true;
+	}
+
+	void deserializeSequenceEnd(const std::string& /*name*/)
+	{
+		if (!_sequences.empty()) _sequences.pop_back();
+		--_level;
+	}
+
+	bool deserializeNullableBegin(const std::string& /*name*/, bool /*isMandatory*/, bool& isNull)
+	{
+		if (!consume()) return false;
+		isNull = read<Poco::UInt8>() != 0;
+		// The value follows as part of the same element.
+		if (!isNull) _skipCount = true;
+		return true;
+	}
+
+	void deserializeNullableEnd(const std::string& /*name*/)
+	{
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, Poco::Int8& value)
+	{
+		return readValue(value);
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, Poco::UInt8& value)
+	{
+		return readValue(value);
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, Poco::Int16& value)
+	{
+		if (!consume()) return false;
+		value = readSigned<Poco::Int16>();
+		return true;
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, Poco::UInt16& value)
+	{
+		if (!consume()) return false;
+		value = readUnsigned<Poco::UInt16>();
+		return true;
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, Poco::Int32& value)
+	{
+		if (!consume()) return false;
+		value = readSigned<Poco::Int32>();
+		return true;
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, Poco::UInt32& value)
+	{
+		if (!consume()) return false;
+		value = readUnsigned<Poco::UInt32>();
+		return true;
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, long& value)
+	{
+		if (!consume()) return false;
+		value = static_cast<long>(readSigned<Poco::Int64>());
+		return true;
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, unsigned long& value)
+	{
+		if (!consume()) return false;
+		value = static_cast<unsigned long>(readUnsigned<Poco::UInt64>());
+		return true;
+	}
+
+#ifndef POCO_LONG_IS_64_BIT
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, Poco::Int64& value)
+	{
+		if (!consume()) return false;
+		value = readSigned<Poco::Int64>();
+		return true;
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, Poco::UInt64& value)
+	{
+		if (!consume()) return false;
+		value = readUnsigned<Poco::UInt64>();
+		return true;
+	}
+#endif
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, float& value)
+	{
+		return readValue(value);
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, double& value)
+	{
+		return readValue(value);
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, bool& value)
+	{
+		if (!consume()) return false;
+		value = read<Poco::UInt8>() != 0;
+		return true;
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, char& value)
+	{
+		return readValue(value);
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, std::string& value)
+	{
+		if (!consume()) return false;
+		readString(value);
+		return true;
+	}
+
+	bool deserialize(const std::string& /*name*/, bool /*isMandatory*/, std::vector<char>& value)
+	{
+		if (!consume()) return false;
+		Poco::UInt32 length = readUnsigned<Poco::UInt32>();
+		const char* p = take(length);
+		value.assign(p, p + length);
+		return true;
+	}
+
+	// OrdinalDeserializer
+	int messageOrdinal()
+	{
+		return _messageOrdinal;
+	}
+
+	// BulkDeserializer
+	void checkBulkSize(const std::string& name, std::size_t count, std::size_t elementSize)
+	{
+		if (static_cast<std::size_t>(_pEnd - _pCur)/elementSize < count) throw DeserializerException("sequence too long", name);
+	}
+
+	void deserializeBulk(const std::string& /*name*/, void* pData, std::size_t count, BulkType type)
+	{
+		checkBulk(count);
+		std::size_t elementSize = bulkElementSize(type);
+		if (elementSize == 0) throw DeserializerException("unsupported bulk element type");
+		std::size_t length = bulkLength(count, elementSize);
+		const char* pSrc = take(length);
+#if defined(POCO_ARCH_LITTLE_ENDIAN)
+		std::memcpy(pData, pSrc, length);
+#else
+		char* pDest = static_cast<char*>(pData);
+		for (std::size_t i = 0; i < count; ++i, pSrc += elementSize, pDest += elementSize)
+		{
+			for (std::size_t k = 0; k < elementSize; ++k) pDest[k] = pSrc[elementSize - 1 - k];
+		}
+#endif
+		_sequences.back().remaining = 0;
+	}
+
+	void deserializeBlob(const std::string& /*name*/, void* pData, std::size_t count, std::size_t elementSize)
+	{
+		checkBulk(count);
+		if (readUnsigned<Poco::UInt32>() != elementSize) throw DeserializerException("blob element size mismatch");
+		std::size_t length = bulkLength(count, elementSize);
+		std::memcpy(pData, take(length), length);
+		_sequences.back().remaining = 0;
+	}
+
+	template <typename T>
+	static T load(const char* pSrc)
+		/// Loads a value stored in little-endian byte order at pSrc.
+	{
+		T value;
+#if defined(POCO_ARCH_LITTLE_ENDIAN)
+		std::memcpy(&value, pSrc, sizeof(T));
+#else
+		char* pDest = reinterpret_cast<char*>(&value);
+		for (std::size_t k = 0; k < sizeof(T); ++k) pDest[k] = pSrc[sizeof(T) - 1 - k];
+#endif
+		return value;
+	}
+
+protected:
+	void resetImpl()
+	{
+		_pCur = _pEnd = 0;
+		_messageName.clear();
+		_messageType = SerializerBase::MESSAGE_REQUEST;
+		_messageOrdinal = NO_ORDINAL;
+		_headerRead = false;
+		_compact = false;
+		_sequences.clear();
+		_level = 0;
+		_skipCount = false;
+	}
+
+	void setupImpl(std::istream& istr)
+	{
+		std::size_t size = 0;
+		std::streambuf* pBuf = istr.rdbuf();
+		for (;;)
+		{
+			if (_storage.size() < size + READ_SIZE) _storage.resize(size + READ_SIZE);
+			std::streamsize n = pBuf->sgetn(&_storage[size], static_cast<std::streamsize>(_storage.size() - size));
+			if (n <= 0) break;
+			size += static_cast<std::size_t>(n);
+		}
+		_pCur = &_storage[0];
+		_pEnd = _pCur + size;
+	}
+
+private:
+	enum
+	{
+		READ_SIZE = 4096
+	};
+
+	struct Sequence
+	{
+		Sequence(Poco::UInt32 n, int l):
+			remaining(n),
+			level(l)
+		{
+		}
+
+		std::size_t remaining;
+		int level;
+	};
+
+	bool consume()
+		/// Accounts for the next element and returns true, or
+		/// returns false if the current sequence has no more
+		/// elements.
+	{
+		if (_skipCount)
+		{
+			_skipCount = false;
+			return true;
+		}
+		if (!_sequences.empty() && _sequences.back().level == _level)
+		{
+			if (_sequences.back().remaining == 0) return false;
+			--_sequences.back().remaining;
+		}
+		return true;
+	}
+
+	void checkBulk(std::size_t count) const
+	{
+		if (_sequences.empty() || _sequences.back().level != _level || _sequences.back().remaining != count)
+			throw DeserializerException("bulk deserialization outside of sequence");
+	}
+
+	static std::size_t bulkLength(std::size_t count, std::size_t elementSize)
+	{
+		std::size_t length = count*elementSize;
+		if (count > 0 && length/count != elementSize) throw DeserializerException("sequence too long");
+		return length;
+	}
+
+	const char* take(std::size_t length)
+	{
+		if (static_cast<std::size_t>(_pEnd - _pCur) < length)
+			throw DeserializerException("unexpected end of message");
+		const char* p = _pCur;
+		_pCur += length;
+		return p;
+	}
+
+	template <typename T>
+	T read()
+	{
+		return load<T>(take(sizeof(T)));
+	}
+
+	template <typename T>
+	bool readValue(T& value)
+	{
+		if (!consume()) return false;
+		value = read<T>();
+		return true;
+	}
+
+	template <typename T>
+	T readUnsigned()
+		/// Reads an unsigned integer, variable-length in compact mode.
+	{
+		if (!_compact) return read<T>();
+		Poco::UInt64 value = readVarint();
+		if (value > static_cast<Poco::UInt64>(static_cast<T>(-1))) throw DeserializerException("integer out of range");
+		return static_cast<T>(value);
+	}
+
+	template <typename T>
+	T readSigned()
+		/// Reads a signed integer, zigzag-encoded and variable-length
+		/// in compact mode.
+	{
+		if (!_compact) return read<T>();
+		Poco::UInt64 zigzag = readVarint();
+		Poco::Int64 value = static_cast<Poco::Int64>(zigzag >> 1) ^ -static_cast<Poco::Int64>(zigzag & 1);
+		T result = static_cast<T>(value);
+		if (static_cast<Poco::Int64>(result) != value) throw DeserializerException("integer out of range");
+		return result;
+	}
+
+	Poco::UInt64 readVarint()
+	{
+		Poco::UInt64 value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (_pCur == _pEnd) throw DeserializerException("unexpected end of message");
+			unsigned char c = static_cast<unsigned char>(*_pCur++);
+			// The tenth byte carries only the top bit of the value.
+			if (shift == 63 && (c & 0x7E)) throw DeserializerException("invalid variable-length integer");
+			value |= static_cast<Poco::UInt64>(c & 0x7F) << shift;
+			if (c < 0x80) return value;
+		}
+		throw DeserializerException("invalid variable-length integer");
+	}
+
+	void readString(std::string& value)
+	{
+		Poco::UInt32 length = readUnsigned<Poco::UInt32>();
+		const char* p = take(length);
+		value.assign(p, length);
+	}
+
+	void readHeader()
+	{
+		const char* p = take(4);
+		if (p[0] != 'F' || p[1] != 'B')
+			throw DeserializerException("not a flat binary message");
+		int version = static_cast<unsigned char>(p[2]);
+		_compact = (version & FlatBinarySerializer::FORMAT_COMPACT) != 0;
+		version &= ~FlatBinarySerializer::FORMAT_COMPACT;
+		if (version < 1 || version > FlatBinarySerializer::FORMAT_VERSION)
+			throw DeserializerException("unsupported flat binary format version");
+		int type = static_cast<unsigned char>(p[3]);
+		if (type > SerializerBase::MESSAGE_FAULT)
+			throw DeserializerException("invalid message type");
+		_messageType = static_cast<SerializerBase::MessageType>(type);
+		_messageOrdinal = version >= 2 ? static_cast<int>(read<Poco::UInt16>()) : static_cast<int>(NO_ORDINAL);
+		readString(_messageName);
+		_headerRead = true;
+	}
+
+	const char* _pCur;
+	const char* _pEnd;
+	std::vector<char> _storage;
+	std::string _messageName;
+	SerializerBase::MessageType _messageType;
+	int _messageOrdinal;
+	bool _headerRead;
+	bool _compact;
+	std::vector<Sequence> _sequences;
+	int _level;
+	bool _skipCount;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_FlatBinaryDeserializer_INCLUDED
@@ -0,0 +1,432 @@
+//
+// FlatBinarySerializer.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Serialization
+// Module:  FlatBinarySerializer
+//
+// Definition of the FlatBinarySerializer class.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_FlatBinarySerializer_INCLUDED
+#define RemotingNG_FlatBinarySerializer_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Serializer.h"
+#include "Poco/RemotingNG/BulkSerialization.h"
+#include "Poco/RemotingNG/OrdinalSerialization.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/Exception.h"
+#include <ostream>
+#include <vector>
+#include <cstring>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class FlatBinarySerializer: public Serializer, public BulkSerializer, public OrdinalSerializer
+	/// A Serializer for a compact binary format that writes
+	/// directly into a contiguous buffer.
+	///
+	/// Unlike BinarySerializer, which writes every value through
+	/// a Poco::BinaryWriter onto the output stream, FlatBinarySerializer
+	/// appends values to an in-memory buffer with inlined
+	/// little-endian stores, and writes the complete message to the
+	/// output stream with a single write() in serializeMessageEnd(),
+	/// so that a transport's ChannelOutputStream copies the payload
+	/// into its frames in bulk. Vectors of fixed-size arithmetic types
+	/// are serialized with a single memcpy(), as are vectors, arrays and
+	/// buffers of types declared with REMOTING_BLOB_SERIALIZABLE() (see
+	/// BulkSerializer).
+	///
+	/// The format is not compatible with BinarySerializer and must be
+	/// read with FlatBinaryDeserializer. A message starts with the
+	/// bytes 'F', 'B', the format version, the message type and the
+	/// message name, with format version 2 preceded by the method
+	/// ordinal as UInt16 (see OrdinalSerializer). Version 1 is written
+	/// for messages without ordinal, so that peers understanding only
+	/// version 1 can still read them. All values are little-endian;
+	/// long and unsigned long are always written with 64 bits, strings
+	/// and sequences are preceded by their length as UInt32, and
+	/// nullables by a flag byte.
+	/// Blobs are preceded by their element size as UInt32.
+	///
+	/// In compact mode (see setCompact()), which sets the FORMAT_COMPACT
+	/// bit of the format version, 16, 32 and 64 bit integers, and
+	/// the lengths, element sizes and fault codes, are written as
+	/// variable-length integers instead: seven bits per byte, least
+	/// significant group first, with the high bit set on all bytes
+	/// but the last, and signed values zigzag-encoded first, so that
+	/// small negative values stay short. Enumeration values, counters
+	/// and lengths then mostly take a single byte. Bulk sequences and
+	/// blobs keep their fixed-size representation. Only peers that
+	/// have agreed on compact mode, e.g. with the TCP capability
+	/// CAPA_REMOTING_COMPACT_INTEGERS, can read such messages.
+	///
+	/// If the serializer has not been set up with an output stream,
+	/// the message remains in the buffer, see data() and size().
+{
+public:
+	enum
+	{
+		FORMAT_VERSION = 2,
+		FORMAT_COMPACT = 0x80
+			/// Bit set in the format version of messages in compact mode.
+	};
+
+	FlatBinarySerializer():
+		_pStream(0),
+		_size(0),
+		_ordinal(-1),
+		_compact(false)
+		/// Creates a FlatBinarySerializer.
+	{
+	}
+
+	~FlatBinarySerializer()
+		/// Destroys the FlatBinarySerializer.
+	{
+	}
+
+	void serializeEndPoint(const std::string& oid, const std::string& tid)
+		/// Serializes the object and type ID of the service object.
+	{
+		writeString(oid);
+		writeString(tid);
+	}
+
+	template <typename T>
+	void serializeToken(T t)
+		/// Serializes the given value, which must be an
+		/// arithmetic type.
+	{
+		write(t);
+	}
+
+	void setCompact(bool compact)
+		/// Enables or disables compact mode, with variable-length
+		/// integers, for the following messages.
+	{
+		_compact = compact;
+	}
+
+	bool isCompact() const
+		/// Returns true if compact mode is enabled.
+	{
+		return _compact;
+	}
+
+	const char* data() const
+		/// Returns the serialized data not yet written
+		/// to the output stream.
+	{
+		return _size > 0 ? &_storage[0] : 0;
+	}
+
+	std::size_t size() const
+		/// Returns the size of the serialized data not yet
+		/// written to the output stream.
+	{
+		return _size;
+	}
+
+	// Serializer
+	void serializeMessageBegin(const std::string& name, SerializerBase::MessageType type)
+	{
+		writeHeader(name, type);
+	}
+
+	void serializeMessageEnd(const std::string& /*name*/, SerializerBase::MessageType /*type*/)
+	{
+		flush();
+	}
+
+	void serializeFaultMessage(const std::string& name, Poco::Exception& exc)
+	{
+		writeHeader(name, SerializerBase::MESSAGE_FAULT);
+		writeString(exc.name());
+		writeString(exc.message());
+		writeSigned(static_cast<Poco::Int32>(exc.code()));
+		flush();
+	}
+
+	void serializeStructBegin(const std::string& /*name*/)
+	{
+	}
+
+	void serializeStructEnd(const std::string& /*name*/)
+	{
+	}
+
+	void serializeSequenceBegin(const std::string& /*name*/, Poco::UInt32 length)
+	{
+		writeUnsigned(length);
+	}
+
+	void serializeSequenceEnd(const std::string& /*name*/)
+	{
+	}
+
+	void serializeNullableBegin(const std::string& /*name*/, bool isNull)
+	{
+		write(static_cast<Poco::UInt8>(isNull ? 1 : 0));
+	}
+
+	void serializeNullableEnd(const std::string& /*name*/)
+	{
+	}
+
+	void serialize(const std::string& /*name*/, Poco::Int8 value)
+	{
+		write(value);
+	}
+
+	void serialize(const std::string& /*name*/, Poco::UInt8 value)
+	{
+		write(value);
+	}
+
+	void serialize(const std::string& /*name*/, Poco::Int16 value)
+	{
+		writeSigned(value);
+	}
+
+	void serialize(const std::string& /*name*/, Poco::UInt16 value)
+	{
+		writeUnsigned(value);
+	}
+
+	void serialize(const std::string& /*name*/, Poco::Int32 value)
+	{
+		writeSigned(value);
+	}
+
+	void serialize(const std::string& /*name*/, Poco::UInt32 value)
+	{
+		writeUnsigned(value);
+	}
+
+	void serialize(const std::string& /*name*/, long value)
+	{
+		writeSigned(static_cast<Poco::Int64>(value));
+	}
+
+	void serialize(const std::string& /*name*/, unsigned long value)
+	{
+		writeUnsigned(static_cast<Poco::UInt64>(value));
+	}
+
+#ifndef POCO_LONG_IS_64_BIT
+	void serialize(const std::string& /*name*/, Poco::Int64 value)
+	{
+		writeSigned(value);
+	}
+
+	void serialize(const std::string& /*name*/, Poco::UInt64 value)
+	{
+		writeUnsigned(value);
+	}
+#endif
+
+	void serialize(const std::string& /*name*/, float value)
+	{
+		write(value);
+	}
+
+	void serialize(const std::string& /*name*/, double value)
+	{
+		write(value);
+	}
+
+	void serialize(const std::string& /*name*/, bool value)
+	{
+		write(static_cast<Poco::UInt8>(value ? 1 : 0));
+	}
+
+	void serialize(const std::string& /*name*/, char value)
+	{
+		write(value);
+	}
+
+	void serialize(const std::string& /*name*/, const std::string& value)
+	{
+		writeString(value);
+	}
+
+	void serialize(const std::string& /*name*/, const std::vector<char>& value)
+	{
+		writeUnsigned(static_cast<Poco::UInt32>(value.size()));
+		if (!value.empty()) std::memcpy(reserve(value.size()), &value[0], value.size());
+	}
+
+	// OrdinalSerializer
+	void setMessageOrdinal(Poco::UInt16 ordinal)
+	{
+		_ordinal = ordinal;
+	}
+
+	// BulkSerializer
+	void serializeBulk(const std::string& /*name*/, const void* pData, std::size_t count, BulkType type)
+	{
+		std::size_t elementSize = bulkElementSize(type);
+		if (elementSize == 0) throw SerializerException("unsupported bulk element type");
+		std::size_t length = count*elementSize;
+		char* pDest = reserve(length);
+#if defined(POCO_ARCH_LITTLE_ENDIAN)
+		std::memcpy(pDest, pData, length);
+#else
+		const char* pSrc = static_cast<const char*>(pData);
+		for (std::size_t i = 0; i < count; ++i, pSrc += elementSize, pDest += elementSize)
+		{
+			for (std::size_t k = 0; k < elementSize; ++k) pDest[k] = pSrc[elementSize - 1 - k];
+		}
+#endif
+	}
+
+	void serializeBlob(const std::string& /*name*/, const void* pData, std::size_t count, std::size_t elementSize)
+	{
+		writeUnsigned(static_cast<Poco::UInt32>(elementSize));
+		std::size_t length = count*elementSize;
+		std::memcpy(reserve(length), pData, length);
+	}
+
+	template <typename T>
+	static void store(char* pDest, T value)
+		/// Stores value in little-endian byte order at pDest.
+	{
+#if defined(POCO_ARCH_LITTLE_ENDIAN)
+		std::memcpy(pDest, &value, sizeof(T));
+#else
+		const char* pSrc = reinterpret_cast<const char*>(&value);
+		for (std::size_t k = 0; k < sizeof(T); ++k) pDest[k] = pSrc[sizeof(T) - 1 - k];
+#endif
+	}
+
+protected:
+	void resetImpl()
+	{
+		_size = 0;
+		_ordinal = -1;
+	}
+
+	void setupImpl(std::ostream& ostr)
+	{
+		_pStream = &ostr;
+		_size = 0;
+	}
+
+private:
+	enum
+	{
+		INITIAL_CAPACITY = 1024,
+		MAX_VARINT_SIZE = 10
+	};
+
+	char* reserve(std::size_t length)
+	{
+		if (_size + length > _storage.size())
+		{
+			std::size_t capacity = _storage.empty() ? static_cast<std::size_t>(INITIAL_CAPACITY) : 2*_storage.size();
+			while (capacity < _size + length) capacity *= 2;
+			_storage.resize(capacity);
+		}
+		char* p = &_storage[0] + _size;
+		_size += length;
+		return p;
+	}
+
+	template <typename T>
+	void write(T value)
+	{
+		store(reserve(sizeof(T)), value);
+	}
+
+	template <typename T>
+	void writeUnsigned(T value)
+		/// Writes an unsigned integer, variable-length in compact mode.
+	{
+		if (_compact)
+			writeVarint(value);
+		else
+			write(value);
+	}
+
+	template <typename T>
+	void writeSigned(T value)
+		/// Writes a signed integer, zigzag-encoded and variable-length
+		/// in compact mode.
+	{
+		if (_compact)
+			writeVarint((static_cast<Poco::UInt64>(value) << 1) ^ static_cast<Poco::UInt64>(static_cast<Poco::Int64>(value) >> 63));
+		else
+			write(value);
+	}
+
+	void writeVarint(Poco::UInt64 value)
+	{
+		if (value < 0x80)
+		{
+			*reserve(1) = static_cast<char>(value);
+			return;
+		}
+		char buffer[MAX_VARINT_SIZE];
+		std::size_t n = 0;
+		while (value >= 0x80)
+		{
+			buffer[n++] = static_cast<char>(value | 0x80);
+			value >>= 7;
+		}
+		buffer[n++] = static_cast<char>(value);
+		std::memcpy(reserve(n), buffer, n);
+	}
+
+	void writeString(const std::string& value)
+	{
+		writeUnsigned(static_cast<Poco::UInt32>(value.size()));
+		if (!value.empty()) std::memcpy(reserve(value.size()), value.data(), value.size());
+	}
+
+	void writeHeader(const std::string& name, SerializerBase::MessageType type)
+	{
+		char* p = reserve(4);
+		p[0] = 'F';
+		p[1] = 'B';
+		p[2] = static_cast<char>((_ordinal < 0 ? 1 : 2) | (_compact ? FORMAT_COMPACT : 0));
+		p[3] = static_cast<char>(type);
+		if (_ordinal >= 0) write(static_cast<Poco::UInt16>(_ordinal));
+		_ordinal = -1;
+		writeString(name);
+	}
+
+	void flush()
+	{
+		if (_pStream && _size > 0)
+		{
+			_pStream->write(&_storage[0], static_cast<std::streamsize>(_size));
+			_size = 0;
+		}
+	}
+
+	std::ostream* _pStream;
+	std::vector<char> _storage;
+	std::size_t _size;
+	int _ordinal;
+	bool _compact;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_FlatBinarySerializer_INCLUDED
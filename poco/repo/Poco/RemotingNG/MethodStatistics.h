@@ -0,0 +1,352 @@
+//
+// MethodStatistics.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: ORB
+// Module:  MethodStatistics
+//
+// Definition of the LatencyHistogram and MethodStatistics classes.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_MethodStatistics_INCLUDED
+#define RemotingNG_MethodStatistics_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Context.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/FastUUIDGenerator.h"
+#include "Poco/SingletonHolder.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include <map>
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class LatencyHistogram
+	/// A histogram of durations in microseconds, with
+	/// power-of-two buckets.
+	///
+	/// Bucket 0 counts durations below 1 microsecond, bucket i
+	/// counts durations from 2^(i-1) up to 2^i microseconds, and
+	/// the last bucket counts all longer durations.
+{
+public:
+	enum
+	{
+		BUCKETS = 32
+	};
+
+	LatencyHistogram():
+		_count(0),
+		_total(0),
+		_max(0)
+	{
+		for (int i = 0; i < BUCKETS; i++) _buckets[i] = 0;
+	}
+
+	void record(Poco::Clock::ClockDiff duration)
+		/// Adds a duration, given in microseconds.
+	{
+		if (duration < 0) duration = 0;
+		int bucket = 0;
+		while (bucket < BUCKETS - 1 && (Poco::Clock::ClockDiff(1) << bucket) <= duration) ++bucket;
+		++_buckets[bucket];
+		++_count;
+		_total += duration;
+		if (duration > _max) _max = duration;
+	}
+
+	Poco::UInt64 count() const
+		/// Returns the number of recorded durations.
+	{
+		return _count;
+	}
+
+	Poco::Clock::ClockDiff total() const
+		/// Returns the sum of all recorded durations.
+	{
+		return _total;
+	}
+
+	Poco::Clock::ClockDiff max() const
+		/// Returns the longest recorded duration.
+	{
+		return _max;
+	}
+
+	Poco::Clock::ClockDiff average() const
+		/// Returns the average recorded duration.
+	{
+		return _count ? static_cast<Poco::Clock::ClockDiff>(_total/_count) : 0;
+	}
+
+	Poco::Clock::ClockDiff percentile(double p) const
+		/// Returns the upper bound of the bucket containing the
+		/// given percentile (0.0 - 1.0) of the recorded durations.
+	{
+		if (_count == 0) return 0;
+		Poco::UInt64 rank = static_cast<Poco::UInt64>(p*_count);
+		if (rank >= _count) rank = _count - 1;
+		Poco::UInt64 n = 0;
+		for (int i = 0; i < BUCKETS - 1; i++)
+		{
+			n += _buckets[i];
+			if (n > rank) return Poco::Clock::ClockDiff(1) << i;
+		}
+		return _max;
+	}
+
+	Poco::UInt64 bucket(int i) const
+		/// Returns the number of durations in the given bucket.
+	{
+		poco_assert (i >= 0 && i < BUCKETS);
+
+		return _buckets[i];
+	}
+
+private:
+	Poco::UInt64 _buckets[BUCKETS];
+	Poco::UInt64 _count;
+	Poco::Clock::ClockDiff _total;
+	Poco::Clock::ClockDiff _max;
+};
+
+
+class MethodStatistics
+	/// MethodStatistics collects call counters and latency histograms
+	/// for remote methods, separately for the client and server side,
+	/// and for the phases of a call.
+	///
+	/// Statistics are recorded by TimingTransport on the client side
+	/// and by TimedMethodHandler on the server side.
+	///
+	/// Calls executed while the thread's Context carries a trace ID
+	/// (see startTrace()) are also reported with the callCompleted event,
+	/// so that individual slow calls, and the calls nested in them, can
+	/// be correlated. Calls without a trace ID never fire the event.
+	///
+	/// MethodStatistics is thread-safe.
+{
+public:
+	enum Side
+	{
+		SIDE_CLIENT,
+			/// Calls made by a Proxy.
+
+		SIDE_SERVER,
+			/// Calls served by a Skeleton.
+
+		SIDE_COUNT
+	};
+
+	enum Phase
+	{
+		PHASE_SERIALIZE,
+			/// Serialization of the request (client) or reply (server).
+
+		PHASE_DESERIALIZE,
+			/// Deserialization of the reply (client only).
+
+		PHASE_INVOKE,
+			/// Deserialization of the request and invocation of the
+			/// service method (server only).
+
+		PHASE_ROUNDTRIP,
+			/// Sending the request and waiting for the reply (client),
+			/// or processing the complete request (server).
+
+		PHASE_COUNT
+	};
+
+	struct Snapshot
+		/// The statistics of a method.
+	{
+		Snapshot():
+			calls(0),
+			failed(0)
+		{
+		}
+
+		Poco::UInt64 calls;
+		Poco::UInt64 failed;
+		LatencyHistogram phases[PHASE_COUNT];
+	};
+
+	struct CallRecord
+		/// The measurements of a single call.
+	{
+		CallRecord(Side s, const std::string& m):
+			side(s),
+			method(m),
+			failed(false)
+		{
+			for (int i = 0; i < PHASE_COUNT; i++) durations[i] = -1;
+		}
+
+		Side side;
+		std::string method;
+			/// The qualified method name (TypeId::method).
+		std::string traceId;
+		bool failed;
+		Poco::Clock::ClockDiff durations[PHASE_COUNT];
+			/// Phase durations in microseconds, or -1 if
+			/// the phase has not been measured.
+	};
+
+	Poco::BasicEvent<const CallRecord> callCompleted;
+		/// Fired after a call with a trace ID has been recorded.
+
+	MethodStatistics():
+		_enabled(true)
+		/// Creates the MethodStatistics.
+	{
+	}
+
+	~MethodStatistics()
+		/// Destroys the MethodStatistics.
+	{
+	}
+
+	void record(const CallRecord& call)
+		/// Adds the measurements of a call.
+	{
+		poco_assert (call.side >= 0 && call.side < SIDE_COUNT);
+
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (!_enabled) return;
+			Snapshot& snapshot = _methods[call.side][call.method];
+			++snapshot.calls;
+			if (call.failed) ++snapshot.failed;
+			for (int i = 0; i < PHASE_COUNT; i++)
+			{
+				if (call.durations[i] >= 0) snapshot.phases[i].record(call.durations[i]);
+			}
+		}
+		if (!call.traceId.empty()) callCompleted(this, call);
+	}
+
+	bool statistics(Side side, const std::string& method, Snapshot& snapshot) const
+		/// Copies the statistics of the given method and returns true,
+		/// or returns false if no call of the method has been recorded.
+	{
+		poco_assert (side >= 0 && side < SIDE_COUNT);
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		MethodMap::const_iterator it = _methods[side].find(method);
+		if (it == _methods[side].end()) return false;
+		snapshot = it->second;
+		return true;
+	}
+
+	void methods(Side side, std::vector<std::string>& names) const
+		/// Returns the names of all methods with recorded calls.
+	{
+		poco_assert (side >= 0 && side < SIDE_COUNT);
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (MethodMap::const_iterator it = _methods[side].begin(); it != _methods[side].end(); ++it)
+		{
+			names.push_back(it->first);
+		}
+	}
+
+	void reset()
+		/// Removes all recorded statistics.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		for (int i = 0; i < SIDE_COUNT; i++) _methods[i].clear();
+	}
+
+	void enable(bool enabled)
+		/// Enables or disables recording.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_enabled = enabled;
+	}
+
+	bool isEnabled() const
+		/// Returns true if recording is enabled.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _enabled;
+	}
+
+	static std::string method(const std::string& typeId, const std::string& methodName)
+		/// Returns the qualified name of a method.
+	{
+		std::string result(typeId);
+		result += "::";
+		result += methodName;
+		return result;
+	}
+
+	static const std::string& traceIdAttribute()
+		/// Returns the name of the Context attribute holding the trace ID.
+	{
+		static const std::string name("remoting.traceId");
+		return name;
+	}
+
+	static std::string currentTraceId()
+		/// Returns the trace ID of the current thread's Context,
+		/// or an empty string if there is none.
+	{
+		Context::Ptr pContext = Context::get();
+		if (pContext) return pContext->getValue<std::string>(traceIdAttribute(), std::string());
+		return std::string();
+	}
+
+	static std::string startTrace()
+		/// Creates a new trace ID and stores it in the current thread's
+		/// Context, which must exist (see ScopedContext). All calls
+		/// made or served by the thread until the Context is removed
+		/// carry the trace ID.
+		///
+		/// Returns the trace ID.
+	{
+		Context::Ptr pContext = Context::get();
+		poco_check_ptr (pContext);
+
+		std::string traceId = Poco::FastUUIDGenerator::defaultGenerator().createRandom().toString();
+		pContext->setValue(traceIdAttribute(), traceId);
+		return traceId;
+	}
+
+	static MethodStatistics& defaultStatistics()
+		/// Returns the process-wide MethodStatistics.
+	{
+		static Poco::SingletonHolder<MethodStatistics> sh;
+		return *sh.get();
+	}
+
+private:
+	MethodStatistics(const MethodStatistics&);
+	MethodStatistics& operator = (const MethodStatistics&);
+
+	typedef std::map<std::string, Snapshot> MethodMap;
+
+	MethodMap _methods[SIDE_COUNT];
+	bool _enabled;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_MethodStatistics_INCLUDED
@@ -0,0 +1,81 @@
+//
+// OrdinalSerialization.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Serialization
+// Module:  OrdinalSerialization
+//
+// Definition of the OrdinalSerializer and OrdinalDeserializer interfaces.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_OrdinalSerialization_INCLUDED
+#define RemotingNG_OrdinalSerialization_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class OrdinalSerializer
+	/// A mixin for Serializers that can send the ordinal of a
+	/// method along with its name.
+	///
+	/// Method ordinals are dense numbers, starting at 0, assigned to the
+	/// methods of an interface in the order of their declaration. A
+	/// Proxy sets the ordinal of the method with setMessageOrdinal()
+	/// before serializing the request message, if its Serializer
+	/// implements OrdinalSerializer, so that an OrdinalSkeleton can find
+	/// the MethodHandler without looking up the method name.
+{
+public:
+	virtual void setMessageOrdinal(Poco::UInt16 ordinal) = 0;
+		/// Sets the method ordinal sent with the next message.
+
+protected:
+	virtual ~OrdinalSerializer()
+	{
+	}
+};
+
+
+class OrdinalDeserializer
+	/// A mixin for Deserializers that can receive the ordinal
+	/// of a method along with its name.
+	///
+	/// See OrdinalSerializer.
+{
+public:
+	enum
+	{
+		NO_ORDINAL = -1
+	};
+
+	virtual int messageOrdinal() = 0;
+		/// Returns the method ordinal of the current message,
+		/// or NO_ORDINAL if it has none, e.g. because it was
+		/// sent by an older peer.
+		///
+		/// Must be called after findMessage().
+
+protected:
+	virtual ~OrdinalDeserializer()
+	{
+	}
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_OrdinalSerialization_INCLUDED
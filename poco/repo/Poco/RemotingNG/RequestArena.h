@@ -0,0 +1,402 @@
+//
+// RequestArena.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Transport
+// Module:  RequestArena
+//
+// Definition of the RequestArena class and the ArenaAllocator class template.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_RequestArena_INCLUDED
+#define RemotingNG_RequestArena_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/FastThreadLocal.h"
+#include <vector>
+#include <string>
+#include <new>
+#include <cstddef>
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class RequestArena
+	/// A monotonic buffer for the temporaries needed while
+	/// processing a single request.
+	///
+	/// Memory is carved from chunks of CHUNK_SIZE bytes (or
+	/// larger, for large requests) by bumping a pointer, and
+	/// freeing memory does nothing. All memory is released
+	/// at once by reset(), which keeps the first chunk, so a
+	/// thread processing requests of similar size stops
+	/// allocating memory after the first few requests.
+	///
+	/// The arena for the request being processed by the current
+	/// thread is available through current(), similar to
+	/// Context::get(). Transports install an arena for the
+	/// duration of a request with a RequestArena::Scope, typically
+	/// around the call to ORB::invoke(), thus ending right after
+	/// ServerTransport::endRequest():
+	///
+	///     RequestArena::Scope arenaScope(RequestArena::threadArena());
+	///     orb.invoke(listener, uri, transport);
+	///
+	/// Skeletons and TypeDeserializer specializations use the
+	/// arena for containers of temporaries (using ArenaAllocator)
+	/// and for temporary strings (using ScratchString).
+	/// Neither must outlive the request.
+{
+public:
+	enum
+	{
+		CHUNK_SIZE = 16384,
+		ALIGNMENT  = sizeof(double) > sizeof(void*) ? sizeof(double) : sizeof(void*)
+	};
+
+	RequestArena():
+		_pos(0),
+		_end(0),
+		_chunkSize(CHUNK_SIZE),
+		_allocated(0),
+		_highWater(0),
+		_allocations(0)
+		/// Creates an empty RequestArena.
+	{
+	}
+
+	~RequestArena()
+		/// Destroys the RequestArena and releases all memory.
+	{
+		for (std::vector<char*>::iterator it = _chunks.begin(); it != _chunks.end(); ++it)
+		{
+			delete [] *it;
+		}
+		for (std::vector<std::string*>::iterator it = _strings.begin(); it != _strings.end(); ++it)
+		{
+			delete *it;
+		}
+	}
+
+	void* allocate(std::size_t size)
+		/// Allocates size bytes suitably aligned for any
+		/// scalar type. Throws a std::bad_alloc if no memory
+		/// is available.
+	{
+		size = (size + ALIGNMENT - 1) & ~std::size_t(ALIGNMENT - 1);
+		if (static_cast<std::size_t>(_end - _pos) < size) grow(size);
+		void* p = _pos;
+		_pos += size;
+		_allocated += size;
+		++_allocations;
+		return p;
+	}
+
+	void reset()
+		/// Releases all memory allocated from the arena.
+	{
+		if (_allocated > _highWater) _highWater = _allocated;
+		if (_chunks.size() > 1)
+		{
+			std::size_t total = 0;
+			for (std::size_t i = 0; i < _chunks.size(); ++i)
+			{
+				total += _chunkSizes[i];
+				delete [] _chunks[i];
+			}
+			_chunks.clear();
+			_chunkSizes.clear();
+			_chunkSize = total;
+			_pos = _end = 0;
+		}
+		else if (!_chunks.empty())
+		{
+			_pos = _chunks[0];
+			_end = _chunks[0] + _chunkSizes[0];
+		}
+		_allocated = 0;
+	}
+
+	std::size_t allocated() const
+		/// Returns the number of bytes allocated since
+		/// the last reset().
+	{
+		return _allocated;
+	}
+
+	std::size_t highWater() const
+		/// Returns the largest number of bytes allocated
+		/// for a single request.
+	{
+		return _allocated > _highWater ? _allocated : _highWater;
+	}
+
+	Poco::UInt64 allocations() const
+		/// Returns the total number of allocations.
+	{
+		return _allocations;
+	}
+
+	std::string* takeString()
+		/// Returns an empty string, keeping the capacity it had
+		/// when it was given back. Used by ScratchString.
+	{
+		if (_strings.empty()) return new std::string;
+		std::string* pString = _strings.back();
+		_strings.pop_back();
+		return pString;
+	}
+
+	void giveString(std::string* pString)
+		/// Gives back a string obtained from takeString().
+	{
+		pString->clear();
+		try
+		{
+			_strings.push_back(pString);
+		}
+		catch (...)
+		{
+			delete pString;
+		}
+	}
+
+	static RequestArena* current()
+		/// Returns the arena of the request processed by the
+		/// current thread, or null if no arena is installed.
+	{
+		return currentHolder();
+	}
+
+	static RequestArena& threadArena()
+		/// Returns the arena owned by the current thread.
+	{
+#if __cplusplus >= 201103L
+		static thread_local RequestArena arena;
+		return arena;
+#else
+		static Poco::FastThreadLocal<RequestArena> arena;
+		return arena.get();
+#endif
+	}
+
+	class Scope
+		/// Installs a RequestArena as the current arena of the
+		/// calling thread, and resets it when the Scope ends.
+	{
+	public:
+		explicit Scope(RequestArena& arena):
+			_arena(arena),
+			_pPrevious(currentHolder())
+		{
+			currentHolder() = &_arena;
+		}
+
+		~Scope()
+		{
+			currentHolder() = _pPrevious;
+			if (_pPrevious != &_arena) _arena.reset();
+		}
+
+	private:
+		Scope(const Scope&);
+		Scope& operator = (const Scope&);
+
+		RequestArena& _arena;
+		RequestArena* _pPrevious;
+	};
+
+private:
+	RequestArena(const RequestArena&);
+	RequestArena& operator = (const RequestArena&);
+
+	static RequestArena*& currentHolder()
+	{
+#if __cplusplus >= 201103L
+		static thread_local RequestArena* pArena = 0;
+		return pArena;
+#else
+		static Poco::FastThreadLocal<RequestArena*> pArena;
+		return pArena.get();
+#endif
+	}
+
+	void grow(std::size_t size)
+	{
+		std::size_t chunkSize = size > _chunkSize ? size : _chunkSize;
+		char* pChunk = new char[chunkSize];
+		try
+		{
+			_chunks.push_back(pChunk);
+			_chunkSizes.push_back(chunkSize);
+		}
+		catch (...)
+		{
+			if (_chunks.size() > _chunkSizes.size()) _chunks.pop_back();
+			delete [] pChunk;
+			throw;
+		}
+		_pos = pChunk;
+		_end = pChunk + chunkSize;
+	}
+
+	char* _pos;
+	char* _end;
+	std::size_t _chunkSize;
+	std::vector<char*> _chunks;
+	std::vector<std::size_t> _chunkSizes;
+	std::vector<std::string*> _strings;
+	std::size_t _allocated;
+	std::size_t _highWater;
+	Poco::UInt64 _allocations;
+};
+
+
+template <class T>
+class ArenaAllocator
+	/// A std::allocator compatible allocator using the
+	/// RequestArena current when the allocator was created,
+	/// or operator new if there was none.
+	///
+	///     std::vector<Item, ArenaAllocator<Item> > items;
+{
+public:
+	typedef T              value_type;
+	typedef T*             pointer;
+	typedef const T*       const_pointer;
+	typedef T&             reference;
+	typedef const T&       const_reference;
+	typedef std::size_t    size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U> other;
+	};
+
+	ArenaAllocator():
+		_pArena(RequestArena::current())
+	{
+	}
+
+	explicit ArenaAllocator(RequestArena* pArena):
+		_pArena(pArena)
+	{
+	}
+
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& alloc):
+		_pArena(alloc.arena())
+	{
+	}
+
+	pointer allocate(size_type n, const void* = 0)
+	{
+		if (_pArena) return static_cast<pointer>(_pArena->allocate(n*sizeof(T)));
+		return static_cast<pointer>(::operator new(n*sizeof(T)));
+	}
+
+	void deallocate(pointer p, size_type)
+	{
+		if (!_pArena) ::operator delete(p);
+	}
+
+	void construct(pointer p, const T& value)
+	{
+		new (p) T(value);
+	}
+
+	void destroy(pointer p)
+	{
+		p->~T();
+	}
+
+	pointer address(reference r) const
+	{
+		return &r;
+	}
+
+	const_pointer address(const_reference r) const
+	{
+		return &r;
+	}
+
+	size_type max_size() const
+	{
+		return static_cast<size_type>(-1)/sizeof(T);
+	}
+
+	RequestArena* arena() const
+	{
+		return _pArena;
+	}
+
+	template <class U>
+	bool operator == (const ArenaAllocator<U>& alloc) const
+	{
+		return _pArena == alloc.arena();
+	}
+
+	template <class U>
+	bool operator != (const ArenaAllocator<U>& alloc) const
+	{
+		return _pArena != alloc.arena();
+	}
+
+private:
+	RequestArena* _pArena;
+};
+
+
+class ScratchString
+	/// A temporary std::string taken from the current RequestArena,
+	/// which keeps its capacity from request to request, so filling
+	/// it usually does not allocate memory. Without a current arena,
+	/// a local string is used.
+	///
+	///     ScratchString str;
+	///     deser.deserialize(name, isMandatory, str.value());
+{
+public:
+	ScratchString():
+		_pArena(RequestArena::current()),
+		_pString(_pArena ? _pArena->takeString() : &_local)
+	{
+	}
+
+	~ScratchString()
+	{
+		if (_pArena) _pArena->giveString(_pString);
+	}
+
+	std::string& value()
+	{
+		return *_pString;
+	}
+
+private:
+	ScratchString(const ScratchString&);
+	ScratchString& operator = (const ScratchString&);
+
+	RequestArena* _pArena;
+	std::string   _local;
+	std::string*  _pString;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_RequestArena_INCLUDED
@@ -0,0 +1,75 @@
+//
+// CompactIntegers.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  CompactIntegers
+//
+// Negotiation of the compact mode of FlatBinarySerializer.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_CompactIntegers_INCLUDED
+#define RemotingNG_TCP_CompactIntegers_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/FlatBinarySerializer.h"
+
+
+//
+// Compact integer encoding.
+//
+// An endpoint that reads FlatBinarySerializer messages in compact mode
+// advertises the CAPA_REMOTING_COMPACT_INTEGERS capability before the
+// connection handshake. Once the connection is established, a sender
+// enables compact mode on the serializers of the connection only if
+// both endpoints have the capability, so older peers keep receiving
+// fixed-size integers.
+//
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+inline void advertiseCompactIntegers(Connection& connection)
+	/// Adds the CAPA_REMOTING_COMPACT_INTEGERS capability
+	/// to the connection, before it is established.
+{
+	connection.addCapability(Frame::CAPA_REMOTING_COMPACT_INTEGERS);
+}
+
+
+inline bool compactIntegersEnabled(Connection& connection)
+	/// Returns true if both endpoints of the established
+	/// connection read messages in compact mode.
+{
+	return connection.hasCapability(Frame::CAPA_REMOTING_COMPACT_INTEGERS)
+	    && connection.peerHasCapability(Frame::CAPA_REMOTING_COMPACT_INTEGERS);
+}
+
+
+inline void setupCompactIntegers(FlatBinarySerializer& serializer, Connection& connection)
+	/// Enables compact mode on the serializer if both endpoints
+	/// of the established connection support it, and disables
+	/// it otherwise.
+{
+	serializer.setCompact(compactIntegersEnabled(connection));
+}
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_CompactIntegers_INCLUDED
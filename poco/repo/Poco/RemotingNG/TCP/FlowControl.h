@@ -0,0 +1,353 @@
+//
+// FlowControl.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  FlowControl
+//
+// Definition of the FlowControlledFrameQueue and ChannelCredit classes.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_FlowControl_INCLUDED
+#define RemotingNG_TCP_FlowControl_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/FrameHandler.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/ByteOrder.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Timespan.h"
+#include "Poco/Clock.h"
+#include <deque>
+#include <cstring>
+
+
+//
+// Per-channel flow control.
+//
+// On connections where both endpoints have the CAPA_REMOTING_FLOW_CONTROL
+// capability, the sender of frames of a given type on a channel may send
+// at most a window of payload bytes that have not yet been consumed by
+// the receiver. Every window starts with FLOW_CONTROL_WINDOW bytes. The
+// receiver grants more credit with FRAME_TYPE_WNDU frames on the same
+// channel, once the consumer has taken frames from the queue.
+//
+// The receiving FlowControlledFrameQueue therefore never has to block the
+// connection's reader, as a slow consumer only stalls its own channel's
+// sender, waiting for credit in ChannelCredit::acquire(), and not the other
+// channels multiplexed on the connection.
+//
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+enum
+{
+	FLOW_CONTROL_WINDOW = 65536
+		/// The initial window of every channel, in payload bytes.
+};
+
+
+inline bool flowControlEnabled(Connection& connection)
+	/// Returns true if both endpoints of the established
+	/// connection support flow control.
+{
+	return connection.hasCapability(Frame::CAPA_REMOTING_FLOW_CONTROL)
+	    && connection.peerHasCapability(Frame::CAPA_REMOTING_FLOW_CONTROL);
+}
+
+
+class FlowControlledFrameQueue: public FrameHandler
+	/// A queue of frames for a channel, like FrameQueue, that grants
+	/// its sender credit as frames are dequeued, instead of limiting
+	/// the number of queued frames.
+	///
+	/// handleFrame() never blocks. A sender exceeding its window is
+	/// counted as an overrun.
+	///
+	/// The consumed bytes are returned to the sender once half of the
+	/// window has been consumed, or as soon as the credit left to the
+	/// sender is less than the largest frame payload, so that a sender
+	/// waiting for credit for a large frame never waits for frames
+	/// it cannot send. The window must therefore be at least as large
+	/// as the largest frame payload.
+	///
+	/// Frames returned by dequeueFrame() must be returned to the
+	/// Connection with Connection::returnFrame().
+{
+public:
+	typedef Poco::AutoPtr<FlowControlledFrameQueue> Ptr;
+
+	struct Statistics
+	{
+		Statistics():
+			queued(0),
+			highWaterMark(0),
+			overruns(0),
+			windowUpdates(0)
+		{
+		}
+
+		Poco::UInt64 queued;        /// Frames queued.
+		std::size_t  highWaterMark; /// Maximum number of queued frames.
+		Poco::UInt64 overruns;      /// Frames received beyond the window.
+		Poco::UInt64 windowUpdates; /// Window update frames sent.
+	};
+
+	FlowControlledFrameQueue(Connection::Ptr pConnection, Poco::UInt32 frameType, Poco::UInt32 channel, Poco::UInt32 window = FLOW_CONTROL_WINDOW):
+		_pConnection(pConnection),
+		_frameType(frameType),
+		_channel(channel),
+		_window(window),
+		_outstanding(0),
+		_consumed(0)
+		/// Creates the FlowControlledFrameQueue, accepting frames
+		/// having the given type and channel.
+	{
+	}
+
+	~FlowControlledFrameQueue()
+		/// Destroys the FlowControlledFrameQueue.
+	{
+		try
+		{
+			for (FrameDeque::iterator it = _queue.begin(); it != _queue.end(); ++it)
+			{
+				_pConnection->returnFrame(*it);
+			}
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	Frame::Ptr dequeueFrame(Poco::Timespan timeout)
+		/// If there is at least one frame in the queue, removes
+		/// it from the queue and returns it.
+		/// Otherwise waits until a frame arrives or the
+		/// timeout expires, and returns null in the latter case.
+	{
+		Frame::Ptr pFrame;
+		Poco::UInt32 credit = 0;
+		bool enabled = flowControlEnabled(*_pConnection);
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			Poco::Clock start;
+			while (_queue.empty())
+			{
+				long remaining = static_cast<long>((timeout.totalMicroseconds() - start.elapsed())/1000);
+				if (remaining <= 0 || !_notEmpty.tryWait(_mutex, remaining))
+				{
+					if (_queue.empty()) return pFrame;
+				}
+			}
+			pFrame = _queue.front();
+			_queue.pop_front();
+			Poco::UInt32 size = pFrame->getPayloadSize();
+			_outstanding -= size < _outstanding ? size : _outstanding;
+			if (enabled)
+			{
+				_consumed += size;
+				Poco::UInt32 used = _outstanding + _consumed;
+				Poco::UInt32 available = used < _window ? _window - used : 0;
+				if (_consumed >= _window/2 || available < Frame::FRAME_LARGE_MAX_PAYLOAD_SIZE)
+				{
+					credit = _consumed;
+					_consumed = 0;
+				}
+			}
+		}
+		if (credit > 0)
+		{
+			sendWindowUpdate(credit);
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			++_statistics.windowUpdates;
+		}
+		return pFrame;
+	}
+
+	Statistics statistics() const
+		/// Returns the queue statistics.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _statistics;
+	}
+
+	std::size_t depth() const
+		/// Returns the number of queued frames.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _queue.size();
+	}
+
+	// FrameHandler
+	bool handleFrame(Connection::Ptr /*pConnection*/, Frame::Ptr pFrame)
+	{
+		if (pFrame->type() != _frameType || pFrame->channel() != _channel) return false;
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_queue.push_back(pFrame);
+		_outstanding += pFrame->getPayloadSize();
+		if (_outstanding > _window) ++_statistics.overruns;
+		++_statistics.queued;
+		if (_queue.size() > _statistics.highWaterMark) _statistics.highWaterMark = _queue.size();
+		_notEmpty.signal();
+		return true;
+	}
+
+protected:
+	void sendWindowUpdate(Poco::UInt32 credit)
+	{
+		Frame::Ptr pFrame = new Frame(Frame::FRAME_TYPE_WNDU, _channel, 0, Frame::FRAME_HEADER_SIZE + 8);
+		Poco::UInt32 payload[2];
+		payload[0] = Poco::ByteOrder::toNetwork(_frameType);
+		payload[1] = Poco::ByteOrder::toNetwork(credit);
+		std::memcpy(pFrame->payloadBegin(), payload, sizeof(payload));
+		pFrame->setPayloadSize(sizeof(payload));
+		_pConnection->sendFrame(pFrame);
+	}
+
+private:
+	typedef std::deque<Frame::Ptr> FrameDeque;
+
+	Connection::Ptr _pConnection;
+	Poco::UInt32 _frameType;
+	Poco::UInt32 _channel;
+	Poco::UInt32 _window;
+	Poco::UInt32 _outstanding;
+	Poco::UInt32 _consumed;
+	FrameDeque _queue;
+	Statistics _statistics;
+	Poco::Condition _notEmpty;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+class ChannelCredit: public FrameHandler
+	/// The sender's side of the flow control of a channel.
+	///
+	/// Receives the FRAME_TYPE_WNDU frames for the channel and frame
+	/// type, and lets the sender wait in acquire() until the receiver
+	/// has granted enough credit for the next frame.
+	///
+	/// If flow control has not been negotiated for the connection,
+	/// acquire() never waits.
+{
+public:
+	typedef Poco::AutoPtr<ChannelCredit> Ptr;
+
+	struct Statistics
+	{
+		Statistics():
+			stalls(0),
+			stallTime(0)
+		{
+		}
+
+		Poco::UInt64 stalls;    /// Calls to acquire() that had to wait.
+		Poco::Int64  stallTime; /// Total time spent waiting, in microseconds.
+	};
+
+	ChannelCredit(Connection::Ptr pConnection, Poco::UInt32 frameType, Poco::UInt32 channel, Poco::UInt32 window = FLOW_CONTROL_WINDOW):
+		_pConnection(pConnection),
+		_frameType(frameType),
+		_channel(channel),
+		_credit(window)
+		/// Creates the ChannelCredit for frames of the given
+		/// type and channel.
+	{
+	}
+
+	~ChannelCredit()
+		/// Destroys the ChannelCredit.
+	{
+	}
+
+	bool acquire(Poco::UInt32 bytes, Poco::Timespan timeout)
+		/// Waits until the receiver has granted credit for the
+		/// given number of payload bytes, and takes it.
+		///
+		/// Returns false if the timeout expires first.
+	{
+		if (!flowControlEnabled(*_pConnection)) return true;
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (_credit < bytes)
+		{
+			++_statistics.stalls;
+			Poco::Clock start;
+			while (_credit < bytes)
+			{
+				long remaining = static_cast<long>((timeout.totalMicroseconds() - start.elapsed())/1000);
+				if (remaining <= 0 || !_granted.tryWait(_mutex, remaining))
+				{
+					if (_credit < bytes)
+					{
+						_statistics.stallTime += start.elapsed();
+						return false;
+					}
+				}
+			}
+			_statistics.stallTime += start.elapsed();
+		}
+		_credit -= bytes;
+		return true;
+	}
+
+	Poco::UInt32 credit() const
+		/// Returns the available credit.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _credit;
+	}
+
+	Statistics statistics() const
+		/// Returns the credit statistics.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _statistics;
+	}
+
+	// FrameHandler
+	bool handleFrame(Connection::Ptr pConnection, Frame::Ptr pFrame)
+	{
+		if (pFrame->type() != Frame::FRAME_TYPE_WNDU || pFrame->channel() != _channel || pFrame->getPayloadSize() < 8) return false;
+		Poco::UInt32 payload[2];
+		std::memcpy(payload, pFrame->payloadBegin(), sizeof(payload));
+		if (Poco::ByteOrder::fromNetwork(payload[0]) != _frameType) return false;
+		Poco::UInt32 credit = Poco::ByteOrder::fromNetwork(payload[1]);
+		pConnection->returnFrame(pFrame);
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_credit += credit;
+		_granted.broadcast();
+		return true;
+	}
+
+private:
+	Connection::Ptr _pConnection;
+	Poco::UInt32 _frameType;
+	Poco::UInt32 _channel;
+	Poco::UInt32 _credit;
+	Statistics _statistics;
+	Poco::Condition _granted;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_FlowControl_INCLUDED
@@ -121,6 +121,15 @@ public:
 			
 		FRAME_TYPE_EVUN = 0x4556554E,
 			/// "EVUN" - A Remoting NG event unsubscribe message.
+
+		FRAME_TYPE_WNDU = 0x574E4455,
+			/// "WNDU" - A window update, granting the peer credit for
+			/// sending more payload bytes on the frame's channel.
+			/// Only sent if both endpoints have CAPA_REMOTING_FLOW_CONTROL.
+			///
+			/// Payload:
+			///   - frame type the credit applies to: UInt32
+			///   - credit in bytes: UInt32
 	};
 
 	enum Flags
@@ -141,6 +150,10 @@ public:
 
 		FRAME_FLAG_AUTH    = 0x0010,
 			/// Frame contains authentication token.
+
+		FRAME_FLAG_CODEC   = 0x0020,
+			/// Frame/message payload is a compressed block (see Compression.h),
+			/// using a codec both endpoints have a capability for.
 			
 		FRAME_FLAG_EXTHDR  = 0x8000
 			/// Extended header - reserved for future use.
@@ -154,8 +167,16 @@ public:
 		FRAME_MAX_SIZE = 1024,
 			/// Maximum frame size (header + payload) currently used by protocol.
 			
-		FRAME_MAX_PAYLOAD_SIZE = FRAME_MAX_SIZE - FRAME_HEADER_SIZE
+		FRAME_MAX_PAYLOAD_SIZE = FRAME_MAX_SIZE - FRAME_HEADER_SIZE,
 			/// Maximum frame payload size currently used by protocol.
+
+		FRAME_LARGE_MAX_SIZE = 65535,
+			/// Maximum frame size (header + payload) on connections
+			/// where both endpoints have CAPA_REMOTING_LARGE_FRAMES.
+
+		FRAME_LARGE_MAX_PAYLOAD_SIZE = FRAME_LARGE_MAX_SIZE - FRAME_HEADER_SIZE
+			/// Maximum frame payload size on connections where both
+			/// endpoints have CAPA_REMOTING_LARGE_FRAMES.
 	};
 	
 	enum Version
@@ -172,6 +193,23 @@ public:
 		CAPA_REMOTING_PROTOCOL_1_1 = 0x524D0101,
 			/// The endpoint understands the Remoting NG binary protocol, version 1.1
 			/// (including authentication)
+
+		CAPA_REMOTING_LARGE_FRAMES = 0x524D4C46,
+			/// The endpoint accepts frames of up to FRAME_LARGE_MAX_SIZE bytes.
+
+		CAPA_REMOTING_FLOW_CONTROL = 0x524D4643,
+			/// The endpoint supports per-channel credit-based flow control
+			/// with FRAME_TYPE_WNDU frames (see FlowControl.h).
+
+		CAPA_REMOTING_CODEC_LZ4 = 0x524D4C34,
+			/// The endpoint accepts LZ4 compressed blocks (FRAME_FLAG_CODEC).
+
+		CAPA_REMOTING_CODEC_ZSTD = 0x524D5A53,
+			/// The endpoint accepts zstd compressed blocks (FRAME_FLAG_CODEC).
+
+		CAPA_REMOTING_COMPACT_INTEGERS = 0x524D5649
+			/// The endpoint reads FlatBinarySerializer messages in compact
+			/// mode, with variable-length integers (see CompactIntegers.h).
 	};
 
 	Frame(Poco::UInt32 type, Poco::UInt32 channel, Poco::UInt16 flags, Poco::UInt16 bufferSize);
@@ -0,0 +1,99 @@
+//
+// FrameSize.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  FrameSize
+//
+// Definition of the FrameSize class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_FrameSize_INCLUDED
+#define RemotingNG_TCP_FrameSize_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class FrameSize
+	/// Negotiation of the maximum frame size of a Connection.
+	///
+	/// An endpoint that accepts frames of up to Frame::FRAME_LARGE_MAX_SIZE
+	/// bytes announces this with the Frame::CAPA_REMOTING_LARGE_FRAMES
+	/// capability in its HELO frame, next to CAPA_REMOTING_PROTOCOL_1_1
+	/// (see advertise()). Frames larger than Frame::FRAME_MAX_SIZE may
+	/// only be sent on connections where both endpoints have announced
+	/// it; all other connections keep using Frame::FRAME_MAX_SIZE, so
+	/// that older peers are not affected.
+	///
+	/// A large frame carries up to 65523 bytes of payload, a standard
+	/// frame 1012 bytes, so a 64 KB reply needs 2 frames, each with a
+	/// pool borrow, header and send, instead of 65.
+{
+public:
+	static void advertise(Connection& connection)
+		/// Adds the CAPA_REMOTING_LARGE_FRAMES capability to the
+		/// connection, which must be done before the handshake.
+		///
+		/// Must only be called for connections whose receiver
+		/// accepts frames of up to Frame::FRAME_LARGE_MAX_SIZE bytes.
+	{
+		connection.addCapability(Frame::CAPA_REMOTING_LARGE_FRAMES);
+	}
+
+	static bool large(Connection& connection)
+		/// Returns true if both endpoints of the established
+		/// connection accept large frames.
+	{
+		return connection.hasCapability(Frame::CAPA_REMOTING_LARGE_FRAMES)
+		    && connection.peerHasCapability(Frame::CAPA_REMOTING_LARGE_FRAMES);
+	}
+
+	static Poco::UInt16 maxFrameSize(Connection& connection)
+		/// Returns the maximum size (header + payload) of
+		/// frames sent on the established connection.
+	{
+		return large(connection) ? static_cast<Poco::UInt16>(Frame::FRAME_LARGE_MAX_SIZE) : static_cast<Poco::UInt16>(Frame::FRAME_MAX_SIZE);
+	}
+
+	static Poco::UInt16 maxPayloadSize(Connection& connection)
+		/// Returns the maximum payload size of frames
+		/// sent on the established connection.
+	{
+		return static_cast<Poco::UInt16>(maxFrameSize(connection) - Frame::FRAME_HEADER_SIZE);
+	}
+
+	static Frame::Ptr createFrame(Connection& connection, Poco::UInt32 type, Poco::UInt32 channel, Poco::UInt16 flags, std::size_t payloadSize)
+		/// Creates a frame with a buffer for the given payload
+		/// size, limited to the maximum payload size of the
+		/// connection.
+	{
+		std::size_t maxPayload = maxPayloadSize(connection);
+		if (payloadSize > maxPayload) payloadSize = maxPayload;
+		return new Frame(type, channel, flags, static_cast<Poco::UInt16>(payloadSize + Frame::FRAME_HEADER_SIZE));
+	}
+
+private:
+	FrameSize();
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_FrameSize_INCLUDED
@@ -0,0 +1,292 @@
+//
+// PipelinedTransport.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  PipelinedTransport
+//
+// Definition of the PipelinedTransport class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_PipelinedTransport_INCLUDED
+#define RemotingNG_TCP_PipelinedTransport_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/RemotingNG/TCP/FrameHandler.h"
+#include "Poco/RemotingNG/TCP/FrameSize.h"
+#include "Poco/RemotingNG/TCP/ChannelRouter.h"
+#include "Poco/RemotingNG/RemotingException.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Timespan.h"
+#include <map>
+#include <string>
+#include <cstring>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class PipelinedTransport
+	/// PipelinedTransport sends requests over a Connection without
+	/// waiting for the replies to previous requests.
+	///
+	/// TCP::Transport has a single channel and request/reply stream,
+	/// so a Proxy using it can only have one outstanding request.
+	/// PipelinedTransport allocates a channel for every request, and
+	/// returns a Reply that completes when the reply frames for the
+	/// channel have been received. Replies can be waited for, or
+	/// handled in the replyReceived event, which is fired from the
+	/// Connection's thread.
+	///
+	/// Requests and replies are serialized messages, as written and read
+	/// by the Serializer and Deserializer of the TCP transport. The server
+	/// side needs no changes, as it already handles requests on different
+	/// channels of a connection concurrently.
+	///
+	/// Authentication and compression are not supported.
+{
+public:
+	class Reply: public FrameHandler
+		/// The pending reply to a request.
+	{
+	public:
+		typedef Poco::AutoPtr<Reply> Ptr;
+
+		Poco::UInt32 channel() const
+			/// Returns the channel of the request.
+		{
+			return _channel;
+		}
+
+		bool wait(Poco::Timespan timeout)
+			/// Waits until the reply has been received, or the timeout
+			/// expires. Returns true if the reply has been received.
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (!_done) _completed.tryWait(_mutex, static_cast<long>(timeout.totalMilliseconds()));
+			return _done;
+		}
+
+		bool done() const
+			/// Returns true if the reply has been received.
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			return _done;
+		}
+
+		const std::string& data() const
+			/// Returns the serialized reply message.
+			///
+			/// Must only be called once the reply has been received.
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (!_done) throw Poco::IllegalStateException("Reply has not been received");
+			return _data;
+		}
+
+		// FrameHandler
+		bool handleFrame(Connection::Ptr pConnection, Frame::Ptr pFrame)
+		{
+			if (pFrame->type() != Frame::FRAME_TYPE_REPL || pFrame->channel() != _channel) return false;
+			bool done = false;
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				if ((pFrame->flags() & Frame::FRAME_FLAG_CONT) == 0) _data.clear();
+				_data.append(pFrame->payloadBegin(), pFrame->getPayloadSize());
+				done = (pFrame->flags() & Frame::FRAME_FLAG_EOM) != 0;
+			}
+			pConnection->returnFrame(pFrame);
+			if (done) _transport.complete(Ptr(this, true));
+			return true;
+		}
+
+	protected:
+		Reply(PipelinedTransport& transport, Poco::UInt32 channel):
+			_transport(transport),
+			_channel(channel),
+			_done(false)
+		{
+		}
+
+		~Reply()
+		{
+		}
+
+		void complete()
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_done = true;
+			_completed.broadcast();
+		}
+
+	private:
+		PipelinedTransport& _transport;
+		Poco::UInt32 _channel;
+		bool _done;
+		std::string _data;
+		Poco::Condition _completed;
+		mutable Poco::FastMutex _mutex;
+
+		friend class PipelinedTransport;
+	};
+
+	Poco::BasicEvent<Reply::Ptr> replyReceived;
+		/// Fired when a reply has been received.
+
+	explicit PipelinedTransport(Connection::Ptr pConnection):
+		_pConnection(pConnection),
+		_pRouter(new ChannelRouter)
+		/// Creates the PipelinedTransport for the given Connection,
+		/// which must be established.
+	{
+		_pConnection->pushFrameHandler(_pRouter);
+	}
+
+	~PipelinedTransport()
+		/// Cancels all pending requests and destroys
+		/// the PipelinedTransport.
+	{
+		try
+		{
+			cancelAll();
+			_pConnection->popFrameHandler(_pRouter);
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	Reply::Ptr send(const std::string& request, bool oneWay = false)
+		/// Sends the serialized request message on a new channel.
+		///
+		/// Returns the pending Reply, or null for one-way requests.
+	{
+		Poco::UInt32 channel = _pConnection->allocChannel();
+		Reply::Ptr pReply;
+		if (!oneWay)
+		{
+			pReply = new Reply(*this, channel);
+			{
+				Poco::FastMutex::ScopedLock lock(_mutex);
+				_pending[channel] = pReply;
+			}
+			_pRouter->addHandler(channel, pReply);
+		}
+		try
+		{
+			sendMessage(channel, request, oneWay);
+		}
+		catch (...)
+		{
+			if (pReply) cancel(pReply);
+			else _pConnection->releaseChannel(channel);
+			throw;
+		}
+		if (oneWay) _pConnection->releaseChannel(channel);
+		return pReply;
+	}
+
+	void cancel(Reply::Ptr pReply)
+		/// Stops waiting for the reply and releases its channel.
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			if (_pending.erase(pReply->channel()) == 0) return;
+		}
+		_pRouter->removeHandler(pReply->channel(), pReply);
+		_pConnection->releaseChannel(pReply->channel());
+	}
+
+	void cancelAll()
+		/// Cancels all pending requests.
+	{
+		ReplyMap pending;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			pending.swap(_pending);
+		}
+		for (ReplyMap::iterator it = pending.begin(); it != pending.end(); ++it)
+		{
+			_pRouter->removeHandler(it->first, it->second);
+			_pConnection->releaseChannel(it->first);
+		}
+	}
+
+	std::size_t pending() const
+		/// Returns the number of requests waiting for a reply.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _pending.size();
+	}
+
+	Connection::Ptr connection() const
+		/// Returns the Connection.
+	{
+		return _pConnection;
+	}
+
+protected:
+	void sendMessage(Poco::UInt32 channel, const std::string& message, bool oneWay)
+	{
+		std::size_t maxPayload = FrameSize::maxPayloadSize(*_pConnection);
+		std::size_t offset = 0;
+		Poco::UInt16 flags = oneWay ? static_cast<Poco::UInt16>(Frame::FRAME_FLAG_ONEWAY) : 0;
+		do
+		{
+			std::size_t n = message.size() - offset;
+			if (n > maxPayload) n = maxPayload;
+			Poco::UInt16 frameFlags = flags;
+			if (offset > 0) frameFlags |= Frame::FRAME_FLAG_CONT;
+			if (offset + n == message.size()) frameFlags |= Frame::FRAME_FLAG_EOM;
+			Frame::Ptr pFrame = FrameSize::createFrame(*_pConnection, Frame::FRAME_TYPE_REQU, channel, frameFlags, n);
+			if (n > 0) std::memcpy(pFrame->payloadBegin(), message.data() + offset, n);
+			pFrame->setPayloadSize(static_cast<Poco::UInt16>(n));
+			_pConnection->sendFrame(pFrame);
+			offset += n;
+		}
+		while (offset < message.size());
+	}
+
+	void complete(Reply::Ptr pReply)
+	{
+		cancel(pReply);
+		pReply->complete();
+		replyReceived(this, pReply);
+	}
+
+private:
+	typedef std::map<Poco::UInt32, Reply::Ptr> ReplyMap;
+
+	PipelinedTransport();
+	PipelinedTransport(const PipelinedTransport&);
+	PipelinedTransport& operator = (const PipelinedTransport&);
+
+	Connection::Ptr _pConnection;
+	ChannelRouter::Ptr _pRouter;
+	ReplyMap _pending;
+	mutable Poco::FastMutex _mutex;
+
+	friend class Reply;
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_PipelinedTransport_INCLUDED
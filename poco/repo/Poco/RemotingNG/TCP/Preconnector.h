@@ -0,0 +1,170 @@
+//
+// Preconnector.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  Preconnector
+//
+// Definition of the Preconnector class.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_Preconnector_INCLUDED
+#define RemotingNG_TCP_Preconnector_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/Runnable.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Timespan.h"
+#include "Poco/Clock.h"
+#include "Poco/URI.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <string>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class Preconnector
+	/// Preconnector establishes the connections to a list of endpoints
+	/// in parallel, e.g. during startup, so that proxies created later
+	/// find an established connection in the ConnectionManager (or
+	/// ConnectionPool), instead of each waiting for the handshake with
+	/// its server one after the other.
+	///
+	/// Together with LazyTransport, which defers connecting a Proxy
+	/// until its first call, starting a bundle no longer includes the
+	/// connection handshakes with its servers.
+	///
+	/// Usage example:
+	///
+	///     std::vector<std::string> endpoints;
+	///     endpoints.push_back("remoting.tcp://localhost:7777");
+	///     Preconnector::preconnect(ConnectionManager::defaultManager(), endpoints, Poco::Timespan(5, 0));
+{
+public:
+	template <class M>
+	static std::size_t preconnect(M& manager, const std::vector<std::string>& endpoints, Poco::Timespan timeout, Poco::ThreadPool& threadPool = Poco::ThreadPool::defaultPool())
+		/// Connects to all endpoints in parallel, using threads from
+		/// the given thread pool, and waits up to the given timeout
+		/// for the connections to be established.
+		///
+		/// M can be ConnectionManager or ConnectionPool, which must
+		/// outlive the connection attempts.
+		///
+		/// Returns the number of connections established within
+		/// the timeout. Failed connection attempts are ignored.
+	{
+		Poco::AutoPtr<State> pState = new State(endpoints.size());
+		for (std::vector<std::string>::const_iterator it = endpoints.begin(); it != endpoints.end(); ++it)
+		{
+			Poco::AutoPtr<Task<M> > pTask = new Task<M>(manager, *it, pState);
+			pTask->duplicate(); // released by run()
+			try
+			{
+				threadPool.start(*pTask);
+			}
+			catch (Poco::Exception&)
+			{
+				// no thread available, connect on this thread
+				pTask->run();
+			}
+		}
+		return pState->wait(timeout);
+	}
+
+private:
+	class State: public Poco::RefCountedObject
+	{
+	public:
+		typedef Poco::AutoPtr<State> Ptr;
+
+		explicit State(std::size_t pending):
+			_pending(pending),
+			_established(0)
+		{
+		}
+
+		void done(bool established)
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			--_pending;
+			if (established) ++_established;
+			_completed.broadcast();
+		}
+
+		std::size_t wait(Poco::Timespan timeout)
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			Poco::Clock start;
+			while (_pending > 0)
+			{
+				long remaining = static_cast<long>((timeout.totalMicroseconds() - start.elapsed())/1000);
+				if (remaining <= 0 || !_completed.tryWait(_mutex, remaining)) break;
+			}
+			return _established;
+		}
+
+	private:
+		std::size_t _pending;
+		std::size_t _established;
+		Poco::Condition _completed;
+		Poco::FastMutex _mutex;
+	};
+
+	template <class M>
+	class Task: public Poco::Runnable, public Poco::RefCountedObject
+	{
+	public:
+		Task(M& manager, const std::string& endpoint, State::Ptr pState):
+			_manager(manager),
+			_endpoint(endpoint),
+			_pState(pState)
+		{
+		}
+
+		void run()
+		{
+			bool established = false;
+			try
+			{
+				Connection::Ptr pConnection = _manager.getConnection(Poco::URI(_endpoint));
+				established = pConnection && pConnection->state() == Connection::STATE_ESTABLISHED;
+			}
+			catch (Poco::Exception&)
+			{
+			}
+			_pState->done(established);
+			release();
+		}
+
+	private:
+		M& _manager;
+		std::string _endpoint;
+		State::Ptr _pState;
+	};
+
+	Preconnector();
+};
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_Preconnector_INCLUDED
@@ -0,0 +1,385 @@
+//
+// ReactorConnection.h
+//
+// $Id$
+//
+// Library: RemotingNG/TCP
+// Package: TCP
+// Module:  ReactorConnection
+//
+// Definition of the ReactorConnection and ConnectionReactor classes.
+//
+// Copyright (c) 2006-2012, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TCP_ReactorConnection_INCLUDED
+#define RemotingNG_TCP_ReactorConnection_INCLUDED
+
+
+#include "Poco/RemotingNG/TCP/TCP.h"
+#include "Poco/RemotingNG/TCP/Connection.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/Net/ParallelSocketReactor.h"
+#include "Poco/Net/SocketReactor.h"
+#include "Poco/Net/SocketNotification.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/NObserver.h"
+#include "Poco/RunnableAdapter.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/Timer.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+namespace Poco {
+namespace RemotingNG {
+namespace TCP {
+
+
+class ConnectionReactor;
+
+
+class ReactorConnection: public Connection
+	/// A Connection that does not need a thread of its own.
+	///
+	/// A Connection is normally run by a thread from the ConnectionManager's
+	/// thread pool, which polls the socket every 200 ms for the lifetime
+	/// of the connection. A ReactorConnection instead is attached to a
+	/// ConnectionReactor, which multiplexes the sockets of all its
+	/// connections on a few SocketReactor threads. When data arrives, a
+	/// worker thread from the ConnectionReactor's thread pool receives
+	/// all available frames and passes them to the FrameHandlers, then
+	/// returns to the pool. Frames of a connection are always processed
+	/// in order, by one worker at a time.
+	///
+	/// Client connections are created with ConnectionReactor::connect(),
+	/// and can be registered with a ConnectionManager so that Transports
+	/// use them.
+{
+public:
+	typedef Poco::AutoPtr<ReactorConnection> Ptr;
+
+	ReactorConnection(const Poco::Net::StreamSocket& socket, ConnectionMode mode):
+		Connection(socket, mode),
+		_pReactor(0),
+		_pNetReactor(0),
+		_readable(*this, &ReactorConnection::onReadable),
+		_error(*this, &ReactorConnection::onError),
+		_processor(*this, &ReactorConnection::process),
+		_attached(false)
+		/// Creates the ReactorConnection for the given socket and endpoint mode.
+	{
+	}
+
+	~ReactorConnection()
+		/// Destroys the ReactorConnection.
+	{
+	}
+
+	void run()
+		/// Does nothing, as frames are received by the
+		/// ConnectionReactor, so that the connection is not
+		/// also read by a thread if it is started on one.
+	{
+	}
+
+	Poco::Clock lastActivity() const
+		/// Returns the time the last frame has been received.
+	{
+		Poco::FastMutex::ScopedLock lock(_activityMutex);
+		return _lastActivity;
+	}
+
+protected:
+	void handshake()
+		/// Exchanges the HELO frames with the peer.
+	{
+		if (mode() == MODE_CLIENT)
+		{
+			sendHELO();
+			receiveHELO();
+		}
+		else
+		{
+			receiveHELO();
+			sendHELO();
+		}
+		touch();
+	}
+
+	void attach(ConnectionReactor& reactor, Poco::Net::SocketReactor& netReactor)
+	{
+		Poco::FastMutex::ScopedLock lock(_attachMutex);
+		_pReactor = &reactor;
+		_pNetReactor = &netReactor;
+		_attached = true;
+		_pNetReactor->addEventHandler(socket(), _error);
+		_pNetReactor->addEventHandler(socket(), _readable);
+	}
+
+	void detach()
+	{
+		Poco::FastMutex::ScopedLock lock(_attachMutex);
+		if (!_attached) return;
+		_attached = false;
+		_pNetReactor->removeEventHandler(socket(), _readable);
+		_pNetReactor->removeEventHandler(socket(), _error);
+	}
+
+	bool closed() const
+	{
+		ConnectionState s = state();
+		return s == STATE_CLOSED || s == STATE_ABORTED;
+	}
+
+	void onReadable(const Poco::AutoPtr<Poco::Net::ReadableNotification>& /*pNf*/)
+	{
+		// The socket stays readable until the frames have been
+		// received, so stop listening while a worker receives them.
+		_pNetReactor->removeEventHandler(socket(), _readable);
+		duplicate();
+		try
+		{
+			threadPool().start(_processor);
+		}
+		catch (Poco::NoThreadAvailableException&)
+		{
+			process();
+		}
+	}
+
+	void onError(const Poco::AutoPtr<Poco::Net::ErrorNotification>& /*pNf*/)
+	{
+		abort();
+	}
+
+	void process()
+		/// Receives and processes all available frames.
+	{
+		Ptr pThis(this); // takes over the reference from onReadable()
+		try
+		{
+			bool received = false;
+			do
+			{
+				Frame::Ptr pFrame = receiveFrame();
+				if (!pFrame) break;
+				received = true;
+				touch();
+				processFrame(pFrame);
+			}
+			while (!closed() && socket().available() > 0);
+
+			// A readable socket without data has been closed by the peer.
+			if (!received && !closed()) abort();
+		}
+		catch (Poco::Exception&)
+		{
+			if (!closed()) abort();
+		}
+		if (closed())
+		{
+			detach();
+		}
+		else
+		{
+			Poco::FastMutex::ScopedLock lock(_attachMutex);
+			if (_attached) _pNetReactor->addEventHandler(socket(), _readable);
+		}
+	}
+
+	void touch()
+	{
+		Poco::FastMutex::ScopedLock lock(_activityMutex);
+		_lastActivity.update();
+	}
+
+	Poco::ThreadPool& threadPool();
+
+private:
+	ConnectionReactor* _pReactor;
+	Poco::Net::SocketReactor* _pNetReactor;
+	Poco::NObserver<ReactorConnection, Poco::Net::ReadableNotification> _readable;
+	Poco::NObserver<ReactorConnection, Poco::Net::ErrorNotification> _error;
+	Poco::RunnableAdapter<ReactorConnection> _processor;
+	bool _attached;
+	Poco::Clock _lastActivity;
+	mutable Poco::FastMutex _activityMutex;
+	Poco::FastMutex _attachMutex;
+
+	friend class ConnectionReactor;
+};
+
+
+class ConnectionReactor
+	/// Multiplexes the sockets of ReactorConnections on a number
+	/// of SocketReactor threads, and receives and processes their
+	/// frames with a thread pool.
+	///
+	/// Once a second, connections that have been idle for longer
+	/// than their idle timeout are closed, and closed connections
+	/// are removed.
+	///
+	/// Usage example:
+	///
+	///     ConnectionReactor reactor(2);
+	///     ReactorConnection::Ptr pConnection = reactor.connect(address);
+	///     ConnectionManager::defaultManager().registerConnection(pConnection);
+{
+public:
+	typedef Poco::Net::ParallelSocketReactor<Poco::Net::SocketReactor> NetReactor;
+
+	explicit ConnectionReactor(int reactors = 1, Poco::ThreadPool& threadPool = Poco::ThreadPool::defaultPool()):
+		_threadPool(threadPool),
+		_next(0),
+		_timer(1000, 1000),
+		_housekeeping(*this, &ConnectionReactor::onTimer)
+		/// Creates the ConnectionReactor with the given number of
+		/// SocketReactor threads, processing frames with the given
+		/// thread pool.
+	{
+		if (reactors < 1) reactors = 1;
+		for (int i = 0; i < reactors; ++i)
+		{
+			_reactors.push_back(new NetReactor(Poco::Timespan(TIMEOUT_REACTOR), "remoting"));
+		}
+		_timer.start(_housekeeping);
+	}
+
+	~ConnectionReactor()
+		/// Closes all connections and destroys the ConnectionReactor.
+	{
+		try
+		{
+			_timer.stop();
+			shutdown();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	ReactorConnection::Ptr connect(const Poco::Net::SocketAddress& address, Poco::Timespan timeout = Poco::Timespan(10, 0))
+		/// Connects to the given server, performs the handshake
+		/// and attaches the connection.
+	{
+		Poco::Net::StreamSocket socket;
+		socket.connect(address, timeout);
+		ReactorConnection::Ptr pConnection = new ReactorConnection(socket, Connection::MODE_CLIENT);
+		pConnection->handshake();
+		attach(pConnection);
+		return pConnection;
+	}
+
+	void attach(ReactorConnection::Ptr pConnection)
+		/// Attaches the connection, which must have completed
+		/// the handshake.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		NetReactor& netReactor = *_reactors[_next++ % _reactors.size()];
+		pConnection->attach(*this, netReactor);
+		_connections.push_back(pConnection);
+	}
+
+	void shutdown()
+		/// Closes and removes all connections.
+	{
+		std::vector<ReactorConnection::Ptr> connections;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			connections.swap(_connections);
+		}
+		for (std::vector<ReactorConnection::Ptr>::iterator it = connections.begin(); it != connections.end(); ++it)
+		{
+			(*it)->detach();
+			if (!(*it)->closed()) (*it)->close();
+		}
+	}
+
+	std::size_t count() const
+		/// Returns the number of attached connections.
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		return _connections.size();
+	}
+
+	Poco::ThreadPool& threadPool()
+		/// Returns the thread pool processing the frames.
+	{
+		return _threadPool;
+	}
+
+protected:
+	void onTimer(Poco::Timer& /*timer*/)
+	{
+		std::vector<ReactorConnection::Ptr> idle;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			std::vector<ReactorConnection::Ptr>::iterator it = _connections.begin();
+			while (it != _connections.end())
+			{
+				if ((*it)->closed())
+				{
+					(*it)->detach();
+					it = _connections.erase(it);
+					continue;
+				}
+				Poco::Timespan timeout = (*it)->getIdleTimeout();
+				if (timeout.totalMicroseconds() > 0 && (*it)->lastActivity().isElapsed(timeout.totalMicroseconds()))
+					idle.push_back(*it);
+				++it;
+			}
+		}
+		for (std::vector<ReactorConnection::Ptr>::iterator it = idle.begin(); it != idle.end(); ++it)
+		{
+			try
+			{
+				(*it)->close();
+			}
+			catch (Poco::Exception&)
+			{
+				(*it)->abort();
+			}
+		}
+	}
+
+private:
+	enum
+	{
+		TIMEOUT_REACTOR = 250000
+	};
+
+	ConnectionReactor(const ConnectionReactor&);
+	ConnectionReactor& operator = (const ConnectionReactor&);
+
+	Poco::ThreadPool& _threadPool;
+	std::vector<Poco::SharedPtr<NetReactor> > _reactors;
+	std::vector<ReactorConnection::Ptr> _connections;
+	std::size_t _next;
+	Poco::Timer _timer;
+	Poco::TimerCallback<ConnectionReactor> _housekeeping;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+//
+// inlines
+//
+inline Poco::ThreadPool& ReactorConnection::threadPool()
+{
+	return _pReactor->threadPool();
+}
+
+
+} } } // namespace Poco::RemotingNG::TCP
+
+
+#endif // RemotingNG_TCP_ReactorConnection_INCLUDED
@@ -0,0 +1,218 @@
+//
+// TimingTransport.h
+//
+// $Id$
+//
+// Library: RemotingNG
+// Package: Transport
+// Module:  TimingTransport
+//
+// Definition of the TimingTransport and TimingTransportFactory classes.
+//
+// Copyright (c) 2006-2014, Applied Informatics Software Engineering GmbH.
+// All rights reserved.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+
+#ifndef RemotingNG_TimingTransport_INCLUDED
+#define RemotingNG_TimingTransport_INCLUDED
+
+
+#include "Poco/RemotingNG/RemotingNG.h"
+#include "Poco/RemotingNG/Transport.h"
+#include "Poco/RemotingNG/TransportFactory.h"
+#include "Poco/RemotingNG/TransportFactoryManager.h"
+#include "Poco/RemotingNG/MethodStatistics.h"
+#include "Poco/Clock.h"
+
+
+namespace Poco {
+namespace RemotingNG {
+
+
+class TimingTransport: public Transport
+	/// A Transport that measures the calls made through the
+	/// Transport it wraps, and records them with MethodStatistics
+	/// (side SIDE_CLIENT).
+	///
+	/// For a request, the time from beginRequest() to sendRequest()
+	/// is recorded as PHASE_SERIALIZE, the time spent in sendRequest()
+	/// as PHASE_ROUNDTRIP, and the time from sendRequest() to
+	/// endRequest() as PHASE_DESERIALIZE. For a one-way message,
+	/// the time spent in sendMessage() is recorded as PHASE_ROUNDTRIP.
+	///
+	/// Code that casts the Proxy's Transport to a specific Transport
+	/// class must use wrapped() instead.
+{
+public:
+	typedef Poco::AutoPtr<TimingTransport> Ptr;
+
+	explicit TimingTransport(Transport::Ptr pTransport, MethodStatistics& statistics = MethodStatistics::defaultStatistics()):
+		_pTransport(pTransport),
+		_statistics(statistics),
+		_call(MethodStatistics::SIDE_CLIENT, std::string())
+		/// Creates the TimingTransport for the given Transport.
+	{
+	}
+
+	~TimingTransport()
+		/// Destroys the TimingTransport.
+	{
+	}
+
+	Transport& wrapped()
+		/// Returns the wrapped Transport.
+	{
+		return *_pTransport;
+	}
+
+	// Transport
+	const std::string& endPoint() const
+	{
+		return _pTransport->endPoint();
+	}
+
+	void connect(const std::string& endPoint)
+	{
+		static_cast<AttributedObject&>(*_pTransport) = *this;
+		_pTransport->connect(endPoint);
+	}
+
+	void disconnect()
+	{
+		_pTransport->disconnect();
+	}
+
+	bool connected() const
+	{
+		return _pTransport->connected();
+	}
+
+	Serializer& beginMessage(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType messageType)
+	{
+		begin(tid, messageName);
+		return _pTransport->beginMessage(oid, tid, messageName, messageType);
+	}
+
+	void sendMessage(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType messageType)
+	{
+		_call.durations[MethodStatistics::PHASE_SERIALIZE] = _clock.elapsed();
+		Poco::Clock sent;
+		try
+		{
+			_pTransport->sendMessage(oid, tid, messageName, messageType);
+		}
+		catch (...)
+		{
+			_call.failed = true;
+			_statistics.record(_call);
+			throw;
+		}
+		_call.durations[MethodStatistics::PHASE_ROUNDTRIP] = sent.elapsed();
+		_statistics.record(_call);
+	}
+
+	Serializer& beginRequest(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType messageType)
+	{
+		begin(tid, messageName);
+		return _pTransport->beginRequest(oid, tid, messageName, messageType);
+	}
+
+	Deserializer& sendRequest(const Identifiable::ObjectId& oid, const Identifiable::TypeId& tid, const std::string& messageName, SerializerBase::MessageType messageType)
+	{
+		_call.durations[MethodStatistics::PHASE_SERIALIZE] = _clock.elapsed();
+		_clock.update();
+		try
+		{
+			Deserializer& deser = _pTransport->sendRequest(oid, tid, messageName, messageType);
+			_call.durations[MethodStatistics::PHASE_ROUNDTRIP] = _clock.elapsed();
+			_clock.update();
+			return deser;
+		}
+		catch (...)
+		{
+			_call.failed = true;
+			throw;
+		}
+	}
+
+	void endRequest()
+	{
+		if (!_call.failed && _call.durations[MethodStatistics::PHASE_ROUNDTRIP] >= 0)
+		{
+			_call.durations[MethodStatistics::PHASE_DESERIALIZE] = _clock.elapsed();
+		}
+		_statistics.record(_call);
+		_pTransport->endRequest();
+	}
+
+protected:
+	void begin(const Identifiable::TypeId& tid, const std::string& messageName)
+	{
+		_call = MethodStatistics::CallRecord(MethodStatistics::SIDE_CLIENT, MethodStatistics::method(tid, messageName));
+		_call.traceId = MethodStatistics::currentTraceId();
+		_clock.update();
+	}
+
+private:
+	TimingTransport();
+	TimingTransport(const TimingTransport&);
+	TimingTransport& operator = (const TimingTransport&);
+
+	Transport::Ptr _pTransport;
+	MethodStatistics& _statistics;
+	MethodStatistics::CallRecord _call;
+	Poco::Clock _clock;
+};
+
+
+class TimingTransportFactory: public TransportFactory
+	/// A TransportFactory creating TimingTransport objects that wrap
+	/// the Transports created by another TransportFactory.
+	///
+	/// Usage example:
+	///
+	///     TimingTransportFactory::registerFactory(Poco::RemotingNG::TCP::Transport::PROTOCOL, new Poco::RemotingNG::TCP::TransportFactory);
+{
+public:
+	explicit TimingTransportFactory(TransportFactory::Ptr pFactory, MethodStatistics& statistics = MethodStatistics::defaultStatistics()):
+		_pFactory(pFactory),
+		_statistics(statistics)
+		/// Creates the TimingTransportFactory for the given TransportFactory.
+	{
+	}
+
+	~TimingTransportFactory()
+		/// Destroys the TimingTransportFactory.
+	{
+	}
+
+	// TransportFactory
+	Transport* createTransport()
+	{
+		return new TimingTransport(Transport::Ptr(_pFactory->createTransport()), _statistics);
+	}
+
+	// Helpers
+	static void registerFactory(const std::string& protocol, TransportFactory::Ptr pFactory)
+		/// Helper function to register a TimingTransportFactory wrapping
+		/// the given factory for the given protocol with the
+		/// TransportFactoryManager, replacing the registered factory.
+	{
+		TransportFactoryManager& manager = TransportFactoryManager::instance();
+		if (manager.hasFactory(protocol)) manager.unregisterFactory(protocol);
+		manager.registerFactory(protocol, new TimingTransportFactory(pFactory));
+	}
+
+private:
+	TransportFactory::Ptr _pFactory;
+	MethodStatistics& _statistics;
+};
+
+
+} } // namespace Poco::RemotingNG
+
+
+#endif // RemotingNG_TimingTransport_INCLUDED
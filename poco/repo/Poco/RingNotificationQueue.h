@@ -0,0 +1,463 @@
+//
+// RingNotificationQueue.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Notifications
+// Module:  RingNotificationQueue
+//
+// Definition of the RingNotificationQueue class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_RingNotificationQueue_INCLUDED
+#define Foundation_RingNotificationQueue_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Notification.h"
+#include "Poco/NotificationCenter.h"
+#include "Poco/FastNotificationCenter.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Instrumentation.h"
+#include <vector>
+#include <climits>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+
+#if !defined(POCO_HAVE_GCC_ATOMICS) && !defined(__clang__)
+#error "RingNotificationQueue requires GCC atomic builtins"
+#endif
+
+
+namespace Poco {
+
+
+class EventCount
+	/// An event count lets threads wait for a condition that is
+	/// checked without a lock, without missing a notification
+	/// that happens between the check and the wait:
+	///
+	///     for (;;)
+	///     {
+	///         if (tryTake()) break;
+	///         EventCount::Key key = ec.prepareWait();
+	///         if (tryTake()) { ec.cancelWait(); break; }
+	///         ec.wait(key);
+	///     }
+	///
+	/// Notifying is a single memory fence and load if no thread
+	/// is waiting. On Linux, waiting threads block on a futex,
+	/// elsewhere on a Condition.
+{
+public:
+	typedef int Key;
+
+	EventCount():
+		_epoch(0),
+		_waiters(0)
+	{
+	}
+
+	Key prepareWait()
+		/// Announces the calling thread as waiter and returns
+		/// the key to pass to wait().
+	{
+		__sync_fetch_and_add(&_waiters, 1);
+		return _epoch;
+	}
+
+	void cancelWait()
+		/// Withdraws a prepareWait().
+	{
+		__sync_fetch_and_sub(&_waiters, 1);
+	}
+
+	bool wait(Key key, long milliseconds = -1)
+		/// Waits until notified after prepareWait() returned key,
+		/// or until the given time has elapsed if milliseconds is
+		/// not negative. Returns false on timeout.
+	{
+		poco_instrument_scope("RingNotificationQueue.wait");
+		bool notified = true;
+#if defined(__linux__)
+		if (_epoch == key)
+		{
+			struct timespec timeout;
+			timeout.tv_sec  = milliseconds/1000;
+			timeout.tv_nsec = (milliseconds % 1000)*1000000;
+			syscall(SYS_futex, &_epoch, FUTEX_WAIT_PRIVATE, key, milliseconds < 0 ? 0 : &timeout, 0, 0);
+			notified = _epoch != key;
+		}
+#else
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			if (_epoch == key)
+			{
+				if (milliseconds < 0) _condition.wait(_mutex);
+				else _condition.tryWait(_mutex, milliseconds);
+				notified = _epoch != key;
+			}
+		}
+#endif
+		__sync_fetch_and_sub(&_waiters, 1);
+		return notified;
+	}
+
+	void notify(bool all = false)
+		/// Wakes up one or all waiting threads.
+	{
+		__sync_synchronize();
+		if (_waiters == 0) return;
+#if defined(__linux__)
+		__sync_fetch_and_add(&_epoch, 1);
+		syscall(SYS_futex, &_epoch, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, 0, 0, 0);
+#else
+		FastMutex::ScopedLock lock(_mutex);
+		__sync_fetch_and_add(&_epoch, 1);
+		if (all) _condition.broadcast();
+		else _condition.signal();
+#endif
+	}
+
+	int waiters() const
+		/// Returns the number of waiting threads.
+	{
+		return _waiters;
+	}
+
+private:
+	EventCount(const EventCount&);
+	EventCount& operator = (const EventCount&);
+
+	volatile int _epoch;
+	volatile int _waiters;
+#if !defined(__linux__)
+	FastMutex _mutex;
+	Condition _condition;
+#endif
+};
+
+
+class RingNotificationQueue
+	/// A bounded, lock-free, multi-producer multi-consumer queue
+	/// of notifications (D. Vyukov's bounded MPMC queue), with the
+	/// interface of NotificationQueue.
+	///
+	/// Enqueueing and dequeueing only take a lock when a thread
+	/// has to wait because the queue is empty or full, and even then
+	/// not on Linux, where waiting threads block on a futex.
+	///
+	/// Unlike NotificationQueue, the queue has a fixed capacity.
+	/// enqueueNotification() waits while the queue is full, while
+	/// tryEnqueueNotification() returns false. Urgent notifications
+	/// are not supported: enqueueUrgentNotification() queues the
+	/// notification like enqueueNotification().
+	///
+	/// dequeueNotifications() takes a batch of notifications at once.
+{
+public:
+	enum
+	{
+		DEFAULT_CAPACITY = 1024
+	};
+
+	RingNotificationQueue(std::size_t capacity = DEFAULT_CAPACITY):
+		_cells(roundUp(capacity)),
+		_mask(_cells.size() - 1),
+		_enqueuePos(0),
+		_dequeuePos(0),
+		_wakeUps(0)
+		/// Creates the queue. The capacity is rounded up to
+		/// the next power of two.
+	{
+		for (std::size_t i = 0; i < _cells.size(); ++i)
+		{
+			_cells[i].sequence = static_cast<long>(i);
+			_cells[i].pNf      = 0;
+		}
+	}
+
+	~RingNotificationQueue()
+		/// Destroys the queue, releasing the notifications
+		/// still in it.
+	{
+		clear();
+	}
+
+	void enqueueNotification(Notification::Ptr pNotification)
+		/// Enqueues the given notification, waiting while
+		/// the queue is full. The queue takes a reference.
+	{
+		poco_check_ptr (pNotification);
+		while (!tryEnqueue(pNotification))
+		{
+			EventCount::Key key = _notFull.prepareWait();
+			if (tryEnqueue(pNotification))
+			{
+				_notFull.cancelWait();
+				break;
+			}
+			_notFull.wait(key);
+		}
+		_notEmpty.notify();
+	}
+
+	bool tryEnqueueNotification(Notification::Ptr pNotification)
+		/// Enqueues the given notification and returns true,
+		/// or returns false if the queue is full.
+	{
+		poco_check_ptr (pNotification);
+		if (!tryEnqueue(pNotification)) return false;
+		_notEmpty.notify();
+		return true;
+	}
+
+	void enqueueUrgentNotification(Notification::Ptr pNotification)
+		/// Same as enqueueNotification().
+	{
+		enqueueNotification(pNotification);
+	}
+
+	Notification* dequeueNotification()
+		/// Dequeues the next notification, or returns null
+		/// if the queue is empty. The caller gains ownership
+		/// of the notification and is expected to release it.
+	{
+		Notification* pNf = tryDequeue();
+		if (pNf) _notFull.notify();
+		return pNf;
+	}
+
+	Notification* waitDequeueNotification()
+		/// Dequeues the next notification, waiting for one if
+		/// the queue is empty. Returns null if wakeUpAll() has
+		/// been called. The caller gains ownership of the
+		/// notification and is expected to release it.
+	{
+		return waitDequeue(-1);
+	}
+
+	Notification* waitDequeueNotification(long milliseconds)
+		/// Dequeues the next notification, waiting up to the given
+		/// time for one if the queue is empty. Returns null on
+		/// timeout or if wakeUpAll() has been called. The caller
+		/// gains ownership of the notification and is expected to
+		/// release it.
+	{
+		return waitDequeue(milliseconds);
+	}
+
+	std::size_t dequeueNotifications(std::vector<Notification::Ptr>& batch, std::size_t max)
+		/// Dequeues up to max notifications without waiting and
+		/// appends them to batch. Returns the number of notifications
+		/// dequeued.
+	{
+		std::size_t n = 0;
+		while (n < max)
+		{
+			Notification* pNf = tryDequeue();
+			if (!pNf) break;
+			batch.push_back(Notification::Ptr(pNf));
+			++n;
+		}
+		if (n > 0) _notFull.notify(true);
+		return n;
+	}
+
+	void dispatch(NotificationCenter& notificationCenter)
+		/// Dispatches all queued notifications to the given
+		/// notification center.
+	{
+		Notification* pNf;
+		while ((pNf = dequeueNotification()) != 0)
+		{
+			Notification::Ptr pNotification(pNf);
+			notificationCenter.postNotification(pNotification);
+		}
+	}
+
+	void dispatch(FastNotificationCenter& notificationCenter)
+		/// Dispatches all queued notifications to the given
+		/// notification center.
+	{
+		Notification* pNf;
+		while ((pNf = dequeueNotification()) != 0)
+		{
+			Notification::Ptr pNotification(pNf);
+			notificationCenter.postNotification(pNotification);
+		}
+	}
+
+	void wakeUpAll()
+		/// Wakes up all threads waiting in waitDequeueNotification(),
+		/// which return null.
+	{
+		__sync_fetch_and_add(&_wakeUps, 1);
+		_notEmpty.notify(true);
+	}
+
+	bool empty() const
+		/// Returns true if the queue is empty. The result
+		/// may be outdated when it is returned.
+	{
+		return size() == 0;
+	}
+
+	int size() const
+		/// Returns the number of notifications in the queue.
+		/// The result may be outdated when it is returned.
+	{
+		long n = static_cast<long>(_enqueuePos - _dequeuePos);
+		return n > 0 ? static_cast<int>(n) : 0;
+	}
+
+	std::size_t capacity() const
+		/// Returns the capacity of the queue.
+	{
+		return _cells.size();
+	}
+
+	void clear()
+		/// Removes and releases all notifications from the queue.
+	{
+		Notification* pNf;
+		while ((pNf = tryDequeue()) != 0) pNf->release();
+		_notFull.notify(true);
+	}
+
+	bool hasIdleThreads() const
+		/// Returns true if threads are waiting for notifications.
+	{
+		return _notEmpty.waiters() > 0;
+	}
+
+private:
+	struct Cell
+	{
+		volatile long sequence;
+		Notification* pNf;
+	};
+
+	RingNotificationQueue(const RingNotificationQueue&);
+	RingNotificationQueue& operator = (const RingNotificationQueue&);
+
+	static std::size_t roundUp(std::size_t capacity)
+	{
+		std::size_t n = 2;
+		while (n < capacity) n <<= 1;
+		return n;
+	}
+
+	bool tryEnqueue(Notification::Ptr& pNotification)
+	{
+		Cell* pCell;
+		long pos = _enqueuePos;
+		for (;;)
+		{
+			pCell = &_cells[pos & _mask];
+			long sequence = pCell->sequence;
+			__sync_synchronize();
+			long diff = sequence - pos;
+			if (diff == 0)
+			{
+				if (__sync_bool_compare_and_swap(&_enqueuePos, pos, pos + 1)) break;
+				pos = _enqueuePos;
+			}
+			else if (diff < 0) return false;
+			else pos = _enqueuePos;
+		}
+		pCell->pNf = pNotification.duplicate();
+		__sync_synchronize();
+		pCell->sequence = pos + 1;
+		return true;
+	}
+
+	Notification* tryDequeue()
+	{
+		Cell* pCell;
+		long pos = _dequeuePos;
+		for (;;)
+		{
+			pCell = &_cells[pos & _mask];
+			long sequence = pCell->sequence;
+			__sync_synchronize();
+			long diff = sequence - (pos + 1);
+			if (diff == 0)
+			{
+				if (__sync_bool_compare_and_swap(&_dequeuePos, pos, pos + 1)) break;
+				pos = _dequeuePos;
+			}
+			else if (diff < 0) return 0;
+			else pos = _dequeuePos;
+		}
+		Notification* pNf = pCell->pNf;
+		pCell->pNf = 0;
+		__sync_synchronize();
+		pCell->sequence = pos + static_cast<long>(_mask) + 1;
+		return pNf;
+	}
+
+	Notification* waitDequeue(long milliseconds)
+	{
+		const int wakeUps = _wakeUps;
+		Clock start;
+		for (;;)
+		{
+			Notification* pNf = tryDequeue();
+			if (pNf)
+			{
+				_notFull.notify();
+				return pNf;
+			}
+			EventCount::Key key = _notEmpty.prepareWait();
+			pNf = tryDequeue();
+			if (pNf || _wakeUps != wakeUps)
+			{
+				_notEmpty.cancelWait();
+				if (pNf) _notFull.notify();
+				return pNf;
+			}
+			long remaining = -1;
+			if (milliseconds >= 0)
+			{
+				remaining = milliseconds - static_cast<long>(start.elapsed()/1000);
+				if (remaining <= 0)
+				{
+					_notEmpty.cancelWait();
+					return 0;
+				}
+			}
+			_notEmpty.wait(key, remaining);
+			if (_wakeUps != wakeUps) return 0;
+		}
+	}
+
+	std::vector<Cell> _cells;
+	std::size_t       _mask;
+	volatile long     _enqueuePos;
+	volatile long     _dequeuePos;
+	volatile int      _wakeUps;
+	EventCount        _notEmpty;
+	EventCount        _notFull;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_RingNotificationQueue_INCLUDED
@@ -0,0 +1,339 @@
+//
+// SHA256Engine.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Crypt
+// Module:  SHA256Engine
+//
+// Definition of class SHA256Engine.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_SHA256Engine_INCLUDED
+#define Foundation_SHA256Engine_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/DigestEngine.h"
+#include <cstring>
+
+
+#if defined(__GNUC__) && (POCO_ARCH == POCO_ARCH_AMD64 || POCO_ARCH == POCO_ARCH_IA32) && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+	#define POCO_SHA256_SHA_NI
+	#include <immintrin.h>
+	#include <cpuid.h>
+#elif defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+	#define POCO_SHA256_ARMV8
+	#include <arm_neon.h>
+#endif
+
+
+namespace Poco {
+
+
+class SHA256Engine: public DigestEngine
+	/// This class implements the SHA-256 message digest algorithm.
+	/// (FIPS 180-4, see http://csrc.nist.gov/publications/fips/fips180-4/fips-180-4.pdf)
+	///
+	/// On x86 and x86_64 processors with the SHA extensions, which are
+	/// detected at runtime, and on ARMv8 processors, if the code is
+	/// compiled with the cryptography extension enabled (for example,
+	/// with -march=armv8-a+crypto), the SHA-256 instructions of the
+	/// processor are used. Otherwise, a portable implementation is used.
+{
+public:
+	enum
+	{
+		BLOCK_SIZE  = 64,
+		DIGEST_SIZE = 32
+	};
+
+	SHA256Engine():
+		_digest(DIGEST_SIZE)
+	{
+		reset();
+	}
+
+	~SHA256Engine()
+	{
+	}
+
+	std::size_t digestLength() const
+	{
+		return DIGEST_SIZE;
+	}
+
+	void reset()
+	{
+		static const UInt32 INITIAL[8] =
+		{
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+			0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+		};
+		std::memcpy(_state, INITIAL, sizeof(_state));
+		_length = 0;
+		_slop = 0;
+	}
+
+	const DigestEngine::Digest& digest()
+	{
+		const UInt64 bits = _length*8;
+		_buffer[_slop++] = 0x80;
+		if (_slop > BLOCK_SIZE - 8)
+		{
+			std::memset(_buffer + _slop, 0, BLOCK_SIZE - _slop);
+			compress(_state, _buffer, 1);
+			_slop = 0;
+		}
+		std::memset(_buffer + _slop, 0, BLOCK_SIZE - 8 - _slop);
+		for (int i = 0; i < 8; ++i)
+		{
+			_buffer[BLOCK_SIZE - 1 - i] = static_cast<UInt8>(bits >> (8*i));
+		}
+		compress(_state, _buffer, 1);
+		for (int i = 0; i < 8; ++i)
+		{
+			_digest[4*i]     = static_cast<unsigned char>(_state[i] >> 24);
+			_digest[4*i + 1] = static_cast<unsigned char>(_state[i] >> 16);
+			_digest[4*i + 2] = static_cast<unsigned char>(_state[i] >> 8);
+			_digest[4*i + 3] = static_cast<unsigned char>(_state[i]);
+		}
+		reset();
+		return _digest;
+	}
+
+	static bool isAccelerated()
+		/// Returns true if the SHA-256 instructions of the processor are used.
+	{
+		return select() != compressPortable;
+	}
+
+protected:
+	typedef void (*CompressFunc)(UInt32* state, const UInt8* data, std::size_t blocks);
+
+	void updateImpl(const void* data, std::size_t length)
+	{
+		const UInt8* p = static_cast<const UInt8*>(data);
+		_length += length;
+		if (_slop > 0)
+		{
+			std::size_t n = BLOCK_SIZE - _slop;
+			if (n > length) n = length;
+			std::memcpy(_buffer + _slop, p, n);
+			_slop += n;
+			p += n;
+			length -= n;
+			if (_slop < BLOCK_SIZE) return;
+			compress(_state, _buffer, 1);
+			_slop = 0;
+		}
+		const std::size_t blocks = length/BLOCK_SIZE;
+		if (blocks > 0)
+		{
+			compress(_state, p, blocks);
+			p += blocks*BLOCK_SIZE;
+			length -= blocks*BLOCK_SIZE;
+		}
+		if (length > 0)
+		{
+			std::memcpy(_buffer, p, length);
+			_slop = length;
+		}
+	}
+
+	static const UInt32* constants()
+	{
+		static const UInt32 K[64] =
+		{
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+		return K;
+	}
+
+	static UInt32 rotr(UInt32 x, int n)
+	{
+		return (x >> n) | (x << (32 - n));
+	}
+
+	static void compressPortable(UInt32* state, const UInt8* data, std::size_t blocks)
+	{
+		const UInt32* K = constants();
+		UInt32 w[64];
+		while (blocks-- > 0)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				w[i] = (UInt32(data[4*i]) << 24) | (UInt32(data[4*i + 1]) << 16) | (UInt32(data[4*i + 2]) << 8) | UInt32(data[4*i + 3]);
+			}
+			for (int i = 16; i < 64; ++i)
+			{
+				const UInt32 s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+				const UInt32 s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+				w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+			}
+			UInt32 a = state[0], b = state[1], c = state[2], d = state[3];
+			UInt32 e = state[4], f = state[5], g = state[6], h = state[7];
+			for (int i = 0; i < 64; ++i)
+			{
+				const UInt32 t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+				const UInt32 t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+				h = g;
+				g = f;
+				f = e;
+				e = d + t1;
+				d = c;
+				c = b;
+				b = a;
+				a = t1 + t2;
+			}
+			state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+			state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+			data += BLOCK_SIZE;
+		}
+	}
+
+#if defined(POCO_SHA256_SHA_NI)
+
+	static bool hasSHAExtensions()
+	{
+		unsigned eax, ebx, ecx, edx;
+		if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_SSE4_1) == 0) return false;
+		if (__get_cpuid_max(0, 0) < 7) return false;
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+		return (ebx & (1u << 29)) != 0;
+	}
+
+	__attribute__((target("sha,sse4.1")))
+	static void compressSHANI(UInt32* state, const UInt8* data, std::size_t blocks)
+	{
+		const UInt32* K = constants();
+		const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+		__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+		__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+		__m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   // ABEF
+		state1 = _mm_blend_epi16(state1, tmp, 0xF0);        // CDGH
+		__m128i msg[4];
+		while (blocks-- > 0)
+		{
+			const __m128i abef = state0;
+			const __m128i cdgh = state1;
+			for (int i = 0; i < 16; ++i)
+			{
+				if (i < 4) msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16*i)), mask);
+				__m128i wk = _mm_add_epi32(msg[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(K + 4*i)));
+				state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+				if (i >= 3 && i < 15)
+				{
+					__m128i& next = msg[(i + 1) & 3];
+					next = _mm_add_epi32(next, _mm_alignr_epi8(msg[i & 3], msg[(i + 3) & 3], 4));
+					next = _mm_sha256msg2_epu32(next, msg[i & 3]);
+				}
+				wk = _mm_shuffle_epi32(wk, 0x0E);
+				state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+				if (i >= 1 && i < 13)
+				{
+					msg[(i + 3) & 3] = _mm_sha256msg1_epu32(msg[(i + 3) & 3], msg[i & 3]);
+				}
+			}
+			state0 = _mm_add_epi32(state0, abef);
+			state1 = _mm_add_epi32(state1, cdgh);
+			data += BLOCK_SIZE;
+		}
+		tmp = _mm_shuffle_epi32(state0, 0x1B);              // FEBA
+		state1 = _mm_shuffle_epi32(state1, 0xB1);           // DCHG
+		state0 = _mm_blend_epi16(tmp, state1, 0xF0);        // DCBA
+		state1 = _mm_alignr_epi8(state1, tmp, 8);           // HGFE
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+	}
+
+	static CompressFunc select()
+	{
+		return hasSHAExtensions() ? compressSHANI : compressPortable;
+	}
+
+#elif defined(POCO_SHA256_ARMV8)
+
+	static void compressARMv8(UInt32* state, const UInt8* data, std::size_t blocks)
+	{
+		const UInt32* K = constants();
+		uint32x4_t state0 = vld1q_u32(state);
+		uint32x4_t state1 = vld1q_u32(state + 4);
+		uint32x4_t msg[4];
+		while (blocks-- > 0)
+		{
+			const uint32x4_t abcd = state0;
+			const uint32x4_t efgh = state1;
+			for (int i = 0; i < 4; ++i)
+			{
+				msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16*i)));
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				const uint32x4_t wk = vaddq_u32(msg[i & 3], vld1q_u32(K + 4*i));
+				const uint32x4_t tmp = state0;
+				state0 = vsha256hq_u32(state0, state1, wk);
+				state1 = vsha256h2q_u32(state1, tmp, wk);
+				if (i < 12)
+				{
+					msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]), msg[(i + 2) & 3], msg[(i + 3) & 3]);
+				}
+			}
+			state0 = vaddq_u32(state0, abcd);
+			state1 = vaddq_u32(state1, efgh);
+			data += BLOCK_SIZE;
+		}
+		vst1q_u32(state, state0);
+		vst1q_u32(state + 4, state1);
+	}
+
+	static CompressFunc select()
+	{
+		return compressARMv8;
+	}
+
+#else
+
+	static CompressFunc select()
+	{
+		return compressPortable;
+	}
+
+#endif
+
+	static void compress(UInt32* state, const UInt8* data, std::size_t blocks)
+	{
+		static const CompressFunc func = select();
+		func(state, data, blocks);
+	}
+
+private:
+	UInt32 _state[8];
+	UInt64 _length;
+	UInt8 _buffer[BLOCK_SIZE];
+	std::size_t _slop;
+	DigestEngine::Digest _digest;
+
+	SHA256Engine(const SHA256Engine&);
+	SHA256Engine& operator = (const SHA256Engine&);
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_SHA256Engine_INCLUDED
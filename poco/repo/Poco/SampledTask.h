@@ -0,0 +1,191 @@
+//
+// SampledTask.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Tasks
+// Module:  Tasks
+//
+// Definition of the SampledTask class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_SampledTask_INCLUDED
+#define Foundation_SampledTask_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Task.h"
+#include "Poco/TimerWheel.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Timespan.h"
+#include "Poco/Clock.h"
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <time.h>
+#endif
+
+
+namespace Poco {
+
+
+class SampledTask: public Task
+	/// A Task whose progress is sampled instead of posted.
+	///
+	/// Task::setProgress() locks the task and, through the TaskManager,
+	/// posts a TaskProgressNotification to a NotificationCenter, which
+	/// locks again and copies its observer list. A task updating its
+	/// progress for every chunk of a download floods the observers.
+	///
+	/// A SampledTask updates its progress with updateProgress(), which
+	/// only stores the progress in an AtomicCounter. While the task runs,
+	/// a timer on the default TimerWheel passes the progress on to
+	/// setProgress() every sampling interval if it has changed, which
+	/// bounds the rate of TaskProgressNotifications.
+	///
+	/// The CPU time consumed by the task is accounted and available
+	/// via cpuTime(), also while the task is running.
+	///
+	/// Subclasses override execute() instead of runTask().
+{
+public:
+	enum
+	{
+		DEFAULT_SAMPLING_INTERVAL = 250,
+			/// Default sampling interval in milliseconds.
+		PROGRESS_SCALE = 1000000
+	};
+
+	explicit SampledTask(const std::string& name, long samplingInterval = DEFAULT_SAMPLING_INTERVAL):
+		Task(name),
+		_samplingInterval(samplingInterval > 0 ? samplingInterval : 1),
+		_sampledProgress(0),
+		_cpuTime(0),
+		_cpuStart(0)
+		/// Creates the SampledTask.
+	{
+	}
+
+	void updateProgress(float progress)
+		/// Stores the progress (0.0 to 1.0) of the task, without locking.
+		/// May only be called from execute().
+	{
+		_progress = static_cast<int>(progress*PROGRESS_SCALE);
+		_cpuTime = static_cast<int>((threadCpuTime() - _cpuStart)/1000);
+	}
+
+	float sampledProgress() const
+		/// Returns the progress last stored with updateProgress().
+	{
+		return static_cast<float>(_progress.value())/PROGRESS_SCALE;
+	}
+
+	Timespan cpuTime() const
+		/// Returns the CPU time consumed by execute(), with millisecond
+		/// resolution, as of the last call to updateProgress(), or in
+		/// total once the task has finished. Returns 0 on platforms
+		/// without per-thread CPU clocks.
+	{
+		return Timespan(static_cast<Timespan::TimeDiff>(_cpuTime.value())*1000);
+	}
+
+	long samplingInterval() const
+		/// Returns the sampling interval in milliseconds.
+	{
+		return _samplingInterval;
+	}
+
+	void runTask()
+	{
+		_cpuStart = threadCpuTime();
+		_cpuTime = 0;
+		TimerWheel::Timer::Ptr pTimer = TimerWheel::defaultWheel().schedule(
+			AutoPtr<Sampler>(new Sampler(*this)), _samplingInterval, _samplingInterval, _samplingInterval/4);
+		try
+		{
+			execute();
+		}
+		catch (...)
+		{
+			finish(pTimer);
+			throw;
+		}
+		finish(pTimer);
+	}
+
+protected:
+	virtual void execute() = 0;
+		/// Does the actual work of the task.
+
+	~SampledTask()
+	{
+	}
+
+private:
+	class Sampler: public RefCountedObject, public Runnable
+	{
+	public:
+		Sampler(SampledTask& task):
+			_task(task)
+		{
+		}
+
+		void run()
+		{
+			_task.sample();
+		}
+
+		bool isCancelled() const
+		{
+			return false;
+		}
+
+	private:
+		SampledTask& _task;
+	};
+
+	void sample()
+	{
+		int progress = _progress.value();
+		if (progress != _sampledProgress)
+		{
+			_sampledProgress = progress;
+			setProgress(static_cast<float>(progress)/PROGRESS_SCALE);
+		}
+	}
+
+	void finish(const TimerWheel::Timer::Ptr& pTimer)
+	{
+		TimerWheel::defaultWheel().cancel(pTimer);
+		_cpuTime = static_cast<int>((threadCpuTime() - _cpuStart)/1000);
+		sample();
+	}
+
+	static Timespan::TimeDiff threadCpuTime()
+		/// Returns the CPU time of the calling thread in microseconds.
+	{
+#if defined(POCO_OS_FAMILY_UNIX) && defined(CLOCK_THREAD_CPUTIME_ID)
+		struct timespec ts;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+			return static_cast<Timespan::TimeDiff>(ts.tv_sec)*1000000 + ts.tv_nsec/1000;
+#endif
+		return 0;
+	}
+
+	long               _samplingInterval;
+	AtomicCounter      _progress;
+	int                _sampledProgress;
+	AtomicCounter      _cpuTime;
+	Timespan::TimeDiff _cpuStart;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_SampledTask_INCLUDED
@@ -0,0 +1,347 @@
+//
+// ScalableRWLock.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  ScalableRWLock
+//
+// Definition of the ScalableRWLock class.
+//
+// Copyright (c) 2004-2008, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_ScalableRWLock_INCLUDED
+#define Foundation_ScalableRWLock_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/SpinMutex.h"
+#include "Poco/ScopedLock.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Environment.h"
+#include "Poco/Thread.h"
+#if !defined(POCO_SPINMUTEX_ATOMICS)
+#include "Poco/RWLock.h"
+#endif
+
+
+namespace Poco {
+
+
+class ScalableRWLock
+	/// A reader writer lock for read-mostly data, which, unlike
+	/// RWLock, does not slow down readers running on different
+	/// cores by making them modify the same memory location.
+	///
+	/// The reader count is distributed over a number of slots,
+	/// each one in its own cache line. Every thread is assigned
+	/// one slot when it first uses a ScalableRWLock, and readers
+	/// only modify their own slot, so that, as long as there are
+	/// at least as many slots as threads reading at the same time,
+	/// readers do not bounce cache lines between cores.
+	///
+	/// Writers take a SpinMutex, announce that a writer is waiting,
+	/// which makes new readers back off and wait for the writer,
+	/// and then wait for the readers of all slots to leave. Writing
+	/// is therefore more expensive than with RWLock, and writers
+	/// are preferred over readers.
+	///
+	/// lock(), tryLock() and unlock() acquire and release the write
+	/// lock, so that ScalableRWLock can be used wherever a template
+	/// takes a mutex class, such as AbstractEvent or ObjectPool.
+	/// ScopedLock is a write lock, ScopedReadLock a read lock.
+	///
+	/// Without C++11 atomics, ScalableRWLock uses a RWLock.
+	///
+	/// Readers must not acquire the lock recursively if writers
+	/// may be waiting, as with RWLock.
+{
+public:
+	typedef Poco::ScopedLock<ScalableRWLock> ScopedLock;
+
+	class ScopedReadLock
+		/// A variant of ScopedLock for reader locks.
+	{
+	public:
+		explicit ScopedReadLock(ScalableRWLock& lock):
+			_lock(lock)
+		{
+			_lock.readLock();
+		}
+
+		~ScopedReadLock()
+		{
+			try
+			{
+				_lock.unlock();
+			}
+			catch (...)
+			{
+				poco_unexpected();
+			}
+		}
+
+	private:
+		ScalableRWLock& _lock;
+
+		ScopedReadLock();
+		ScopedReadLock(const ScopedReadLock&);
+		ScopedReadLock& operator = (const ScopedReadLock&);
+	};
+
+	class ScopedWriteLock
+		/// A variant of ScopedLock for writer locks.
+	{
+	public:
+		explicit ScopedWriteLock(ScalableRWLock& lock):
+			_lock(lock)
+		{
+			_lock.writeLock();
+		}
+
+		~ScopedWriteLock()
+		{
+			try
+			{
+				_lock.unlock();
+			}
+			catch (...)
+			{
+				poco_unexpected();
+			}
+		}
+
+	private:
+		ScalableRWLock& _lock;
+
+		ScopedWriteLock();
+		ScopedWriteLock(const ScopedWriteLock&);
+		ScopedWriteLock& operator = (const ScopedWriteLock&);
+	};
+
+	enum
+	{
+		CACHE_LINE_SIZE = 64,
+		MAX_SLOTS       = 64
+	};
+
+	explicit ScalableRWLock(int slots = 0)
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		:
+		_state(NO_WRITER),
+		_mask(slotCount(slots) - 1),
+		_pSlots(new Slot[_mask + 1])
+#endif
+		/// Creates the ScalableRWLock with the given number of slots,
+		/// rounded up to a power of two, or, if slots is 0, with
+		/// one slot per processor.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		for (unsigned i = 0; i <= _mask; ++i)
+		{
+			_pSlots[i].readers.store(0, std::memory_order_relaxed);
+		}
+#else
+		(void) slots;
+#endif
+	}
+
+	~ScalableRWLock()
+		/// Destroys the ScalableRWLock.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		delete [] _pSlots;
+#endif
+	}
+
+	void readLock()
+		/// Acquires a read lock. If another thread currently holds
+		/// or waits for the write lock, waits until the write lock
+		/// has been released.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		std::atomic<int>& readers = slot();
+		for (;;)
+		{
+			readers.fetch_add(1, std::memory_order_seq_cst);
+			if (_state.load(std::memory_order_seq_cst) == NO_WRITER) return;
+			readers.fetch_sub(1, std::memory_order_release);
+
+			// wait for the writer
+			_writeMutex.lock();
+			_writeMutex.unlock();
+		}
+#else
+		_rwLock.readLock();
+#endif
+	}
+
+	bool tryReadLock()
+		/// Tries to acquire a read lock. Immediately returns true if
+		/// successful, or false if another thread currently holds or
+		/// waits for the write lock.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		std::atomic<int>& readers = slot();
+		readers.fetch_add(1, std::memory_order_seq_cst);
+		if (_state.load(std::memory_order_seq_cst) == NO_WRITER) return true;
+		readers.fetch_sub(1, std::memory_order_release);
+		return false;
+#else
+		return _rwLock.tryReadLock();
+#endif
+	}
+
+	void writeLock()
+		/// Acquires the write lock. If other threads currently hold
+		/// locks, waits until all locks are released.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		_writeMutex.lock();
+		_state.store(WRITER_WAITING, std::memory_order_seq_cst);
+		for (int i = 0; hasReaders(); ++i)
+		{
+			if (i < SpinMutex::MIN_SPINS)
+				SpinMutex::relax();
+			else
+				Thread::yield();
+		}
+		_state.store(WRITER_ACTIVE, std::memory_order_relaxed);
+#else
+		_rwLock.writeLock();
+#endif
+	}
+
+	bool tryWriteLock()
+		/// Tries to acquire the write lock. Immediately returns true
+		/// if successful, or false if other threads currently hold
+		/// locks.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		if (!_writeMutex.tryLock()) return false;
+		_state.store(WRITER_WAITING, std::memory_order_seq_cst);
+		if (hasReaders())
+		{
+			_state.store(NO_WRITER, std::memory_order_release);
+			_writeMutex.unlock();
+			return false;
+		}
+		_state.store(WRITER_ACTIVE, std::memory_order_relaxed);
+		return true;
+#else
+		return _rwLock.tryWriteLock();
+#endif
+	}
+
+	void unlock()
+		/// Releases the read or write lock.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		// readers cannot hold the lock while a writer is active
+		if (_state.load(std::memory_order_relaxed) == WRITER_ACTIVE)
+		{
+			_state.store(NO_WRITER, std::memory_order_release);
+			_writeMutex.unlock();
+		}
+		else slot().fetch_sub(1, std::memory_order_release);
+#else
+		_rwLock.unlock();
+#endif
+	}
+
+	void lock()
+		/// Acquires the write lock. Same as writeLock().
+	{
+		writeLock();
+	}
+
+	bool tryLock()
+		/// Tries to acquire the write lock. Same as tryWriteLock().
+	{
+		return tryWriteLock();
+	}
+
+	int slots() const
+		/// Returns the number of slots.
+	{
+#if defined(POCO_SPINMUTEX_ATOMICS)
+		return static_cast<int>(_mask + 1);
+#else
+		return 1;
+#endif
+	}
+
+private:
+	ScalableRWLock(const ScalableRWLock&);
+	ScalableRWLock& operator = (const ScalableRWLock&);
+
+#if defined(POCO_SPINMUTEX_ATOMICS)
+	enum State
+	{
+		NO_WRITER      = 0,
+		WRITER_WAITING = 1, /// readers may still hold the lock
+		WRITER_ACTIVE  = 2  /// no readers hold the lock
+	};
+
+	struct Slot
+	{
+		std::atomic<int> readers;
+		char padding[CACHE_LINE_SIZE - sizeof(std::atomic<int>)];
+	};
+
+	std::atomic<int>& slot() const
+	{
+		return _pSlots[threadIndex() & _mask].readers;
+	}
+
+	bool hasReaders() const
+	{
+		int readers = 0;
+		for (unsigned i = 0; i <= _mask; ++i)
+		{
+			readers += _pSlots[i].readers.load(std::memory_order_seq_cst);
+		}
+		return readers != 0;
+	}
+
+	static unsigned slotCount(int slots)
+	{
+		if (slots <= 0) slots = Environment::processorCount();
+		if (slots > MAX_SLOTS) slots = MAX_SLOTS;
+		unsigned count = 1;
+		while (count < static_cast<unsigned>(slots)) count <<= 1;
+		return count;
+	}
+
+	static unsigned threadIndex()
+		/// Returns the index assigned to the calling thread,
+		/// the same for all ScalableRWLocks.
+	{
+		static AtomicCounter next;
+		static thread_local int index = -1;
+		if (index < 0) index = (next++) & 0x7FFFFFFF;
+		return static_cast<unsigned>(index);
+	}
+
+	char _padding1[CACHE_LINE_SIZE];
+	std::atomic<int> _state;
+	unsigned _mask;
+	Slot* _pSlots;
+	char _padding2[CACHE_LINE_SIZE];
+	SpinMutex _writeMutex;
+#else
+	RWLock _rwLock;
+#endif
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_ScalableRWLock_INCLUDED
@@ -0,0 +1,220 @@
+//
+// SeqLock.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  SeqLock
+//
+// Definition of the SeqLock template.
+//
+// Copyright (c) 2004-2008, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_SeqLock_INCLUDED
+#define Foundation_SeqLock_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Mutex.h"
+#include <cstring>
+
+
+namespace Poco {
+
+
+template <class T>
+class SeqLock
+	/// A SeqLock protects a value of a trivially copyable type T
+	/// that is written rarely by one thread at a time and read
+	/// frequently by many threads.
+	///
+	/// Readers never block writers and never modify shared state.
+	/// A reader copies the value and retries if a write was in progress
+	/// or happened during the copy, detected by an even/odd sequence number.
+	/// Readers therefore always obtain a coherent copy, without
+	/// allocation and without taking a lock.
+	///
+	/// Writers are serialized using a FastMutex that readers
+	/// never touch.
+	///
+	/// On platforms without atomic primitives (see AtomicCounter),
+	/// readers fall back to taking the writer mutex.
+	///
+	/// T must be trivially copyable (copyable with memcpy()).
+{
+public:
+	class ScopedWrite
+		/// Gives a writer in-place access to the protected value,
+		/// for updating only some of its members.
+		///
+		///     SeqLock<State>::ScopedWrite write(seqLock);
+		///     write.value().counter++;
+	{
+	public:
+		ScopedWrite(SeqLock& seqLock):
+			_seqLock(seqLock)
+		{
+			_seqLock.beginWrite();
+		}
+
+		~ScopedWrite()
+		{
+			_seqLock.endWrite();
+		}
+
+		T& value()
+		{
+			return _seqLock._value;
+		}
+
+	private:
+		ScopedWrite();
+		ScopedWrite(const ScopedWrite&);
+		ScopedWrite& operator = (const ScopedWrite&);
+
+		SeqLock& _seqLock;
+	};
+
+	SeqLock():
+		_seq(0),
+		_value()
+		/// Creates the SeqLock with a default-constructed value.
+	{
+	}
+
+	explicit SeqLock(const T& value):
+		_seq(0),
+		_value(value)
+		/// Creates the SeqLock with the given initial value.
+	{
+	}
+
+	~SeqLock()
+	{
+	}
+
+	void write(const T& value)
+		/// Replaces the protected value.
+	{
+		ScopedWrite scopedWrite(*this);
+		scopedWrite.value() = value;
+	}
+
+	void read(T& value) const
+		/// Copies a coherent snapshot of the protected value into value.
+	{
+		while (!tryRead(value))
+		{
+		}
+	}
+
+	T read() const
+		/// Returns a coherent snapshot of the protected value.
+	{
+		T value;
+		read(value);
+		return value;
+	}
+
+	bool tryRead(T& value) const
+		/// Tries once to copy the protected value into value.
+		/// Returns false if a write was in progress or happened
+		/// during the copy, in which case the contents of value
+		/// are unspecified.
+	{
+#if defined(POCO_HAVE_STD_ATOMICS) || defined(POCO_HAVE_GCC_ATOMICS)
+		unsigned seq = loadAcquire();
+		if (seq & 1) return false;
+		std::memcpy(static_cast<void*>(&value), &_value, sizeof(T));
+		fence();
+		return loadAcquire() == seq;
+#else
+		FastMutex::ScopedLock lock(_writeMutex);
+		value = _value;
+		return true;
+#endif
+	}
+
+	unsigned sequence() const
+		/// Returns the current sequence number. The sequence number
+		/// is even while no write is in progress and is incremented
+		/// by two with every completed write.
+	{
+		return loadAcquire();
+	}
+
+private:
+	SeqLock(const SeqLock&);
+	SeqLock& operator = (const SeqLock&);
+
+	void beginWrite()
+	{
+		_writeMutex.lock();
+		store(_seq + 1);
+		fence();
+	}
+
+	void endWrite()
+	{
+		fence();
+		store(_seq + 1);
+		_writeMutex.unlock();
+	}
+
+#if defined(POCO_HAVE_STD_ATOMICS)
+	unsigned loadAcquire() const
+	{
+		return _seq.load(std::memory_order_acquire);
+	}
+
+	void store(unsigned seq)
+	{
+		_seq.store(seq, std::memory_order_release);
+	}
+
+	static void fence()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	std::atomic<unsigned> _seq;
+#else
+	unsigned loadAcquire() const
+	{
+		unsigned seq = _seq;
+		fence();
+		return seq;
+	}
+
+	void store(unsigned seq)
+	{
+		fence();
+		_seq = seq;
+	}
+
+	static void fence()
+	{
+	#if defined(POCO_HAVE_GCC_ATOMICS)
+		__sync_synchronize();
+	#endif
+	}
+
+	volatile unsigned _seq;
+#endif
+
+	T _value;
+	mutable FastMutex _writeMutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_SeqLock_INCLUDED
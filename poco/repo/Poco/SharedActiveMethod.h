@@ -0,0 +1,102 @@
+//
+// SharedActiveMethod.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  ActiveObjects
+//
+// Definition of the SharedActiveMethod class.
+//
+// Copyright (c) 2004-2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_SharedActiveMethod_INCLUDED
+#define Foundation_SharedActiveMethod_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/ActiveMethod.h"
+#include "Poco/Mutex.h"
+
+
+namespace Poco {
+
+
+template <class ResultType, class OwnerType, class StarterType = ActiveStarter<OwnerType> >
+class SharedActiveMethod
+	/// A SharedActiveMethod is an ActiveMethod without argument whose
+	/// concurrent invocations share a single execution.
+	///
+	/// If the method is invoked while a previous invocation has not
+	/// completed yet, the ActiveResult of the running invocation is
+	/// returned instead of starting a new one. This is useful for
+	/// getters backed by a slow device, where callers arriving at
+	/// the same time are all served by a single round trip.
+	///
+	///     class ActiveObject
+	///     {
+	///     public:
+	///         ActiveObject():
+	///             status(this, &ActiveObject::statusImpl)
+	///         {
+	///         }
+	///
+	///         SharedActiveMethod<Status, ActiveObject> status;
+	///
+	///     protected:
+	///         Status statusImpl();
+	///     };
+	///
+	/// All callers sharing an invocation get the same result, or the
+	/// same exception. The owner must outlive all pending invocations,
+	/// which a reference counted owner can ensure with the
+	/// RetainingActiveStarter policy.
+{
+public:
+	typedef ActiveMethod<ResultType, void, OwnerType, StarterType> ActiveMethodType;
+	typedef typename ActiveMethodType::Callback Callback;
+	typedef ActiveResult<ResultType> ActiveResultType;
+
+	SharedActiveMethod(OwnerType* pOwner, Callback method):
+		_method(pOwner, method),
+		_pending(new ActiveResultHolder<ResultType>()),
+		_started(false)
+		/// Creates a SharedActiveMethod object.
+	{
+	}
+
+	ActiveResultType operator () (void)
+		/// Invokes the method, or returns the result of the
+		/// invocation in progress.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_started || _pending.available())
+		{
+			_pending = _method();
+			_started = true;
+		}
+		return _pending;
+	}
+
+private:
+	SharedActiveMethod();
+	SharedActiveMethod(const SharedActiveMethod&);
+	SharedActiveMethod& operator = (const SharedActiveMethod&);
+
+	ActiveMethodType _method;
+	ActiveResultType _pending;
+	bool             _started;
+	FastMutex        _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_SharedActiveMethod_INCLUDED
@@ -0,0 +1,286 @@
+//
+// SnapshotStrategy.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Events
+// Module:  SnapshotStrategy
+//
+// Implementation of the SnapshotStrategy template.
+//
+// Copyright (c) 2006-2011, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_SnapshotStrategy_INCLUDED
+#define Foundation_SnapshotStrategy_INCLUDED
+
+
+#include "Poco/NotificationStrategy.h"
+#include "Poco/SharedPtr.h"
+#include <vector>
+
+
+namespace Poco {
+
+
+template <class TArgs, class TDelegate> 
+class SnapshotStrategy: public NotificationStrategy<TArgs, TDelegate>
+	/// Copy-on-write notification strategy.
+	///
+	/// Like DefaultStrategy, delegates are invoked in the
+	/// order in which they have been registered. Unlike
+	/// DefaultStrategy, the delegate list is stored in an
+	/// immutable, reference-counted std::vector<> that is
+	/// replaced as a whole by add(), remove() and clear().
+	///
+	/// Copying a SnapshotStrategy (which AbstractEvent does
+	/// for every notify()) therefore only copies a single
+	/// SharedPtr, instead of the whole delegate list with one
+	/// reference count update per delegate. This makes notify()
+	/// considerably cheaper for events with many delegates,
+	/// at the expense of more expensive add() and remove().
+{
+public:
+	typedef TDelegate*                         DelegateHandle;
+	typedef SharedPtr<TDelegate>               DelegatePtr;
+	typedef std::vector<DelegatePtr>           Delegates;
+	typedef SharedPtr<Delegates>               DelegatesPtr;
+	typedef typename Delegates::iterator       Iterator;
+
+public:
+	SnapshotStrategy():
+		_pDelegates(new Delegates)
+	{
+	}
+
+	SnapshotStrategy(const SnapshotStrategy& s):
+		_pDelegates(s._pDelegates)
+	{
+	}
+
+	~SnapshotStrategy()
+	{
+	}
+
+	void notify(const void* sender, TArgs& arguments)
+	{
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			(*it)->notify(sender, arguments);
+		}
+	}
+
+	DelegateHandle add(const TDelegate& delegate)
+	{
+		DelegatePtr pDelegate(static_cast<TDelegate*>(delegate.clone()));
+		DelegatesPtr pDelegates(new Delegates);
+		pDelegates->reserve(_pDelegates->size() + 1);
+		pDelegates->assign(_pDelegates->begin(), _pDelegates->end());
+		pDelegates->push_back(pDelegate);
+		_pDelegates = pDelegates;
+		return pDelegate.get();
+	}
+
+	void remove(const TDelegate& delegate)
+	{
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			if (delegate.equals(**it))
+			{
+				erase(it);
+				return;
+			}
+		}
+	}
+
+	void remove(DelegateHandle delegateHandle)
+	{
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			if (*it == delegateHandle)
+			{
+				erase(it);
+				return;
+			}
+		}
+	}
+
+	SnapshotStrategy& operator = (const SnapshotStrategy& s)
+	{
+		_pDelegates = s._pDelegates;
+		return *this;
+	}
+
+	void clear()
+	{
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			(*it)->disable();
+		}
+		_pDelegates = new Delegates;
+	}
+
+	bool empty() const
+	{
+		return _pDelegates->empty();
+	}
+
+protected:
+	void erase(Iterator pos)
+		/// Disables the delegate at pos and publishes a new
+		/// delegate list without it. Snapshots held by notifications
+		/// in progress are not modified, but will skip the disabled
+		/// delegate.
+	{
+		(*pos)->disable();
+		DelegatesPtr pDelegates(new Delegates);
+		pDelegates->reserve(_pDelegates->size() - 1);
+		Iterator begin = _pDelegates->begin();
+		pDelegates->assign(begin, pos);
+		pDelegates->insert(pDelegates->end(), pos + 1, _pDelegates->end());
+		_pDelegates = pDelegates;
+	}
+
+	DelegatesPtr _pDelegates;
+};
+
+
+template <class TDelegate>
+class SnapshotStrategy<void, TDelegate>: public NotificationStrategy<void, TDelegate>
+	/// Copy-on-write notification strategy.
+	///
+	/// Like DefaultStrategy, delegates are invoked in the
+	/// order in which they have been registered. Unlike
+	/// DefaultStrategy, the delegate list is stored in an
+	/// immutable, reference-counted std::vector<> that is
+	/// replaced as a whole by add(), remove() and clear().
+	///
+	/// Copying a SnapshotStrategy (which AbstractEvent does
+	/// for every notify()) therefore only copies a single
+	/// SharedPtr, instead of the whole delegate list with one
+	/// reference count update per delegate. This makes notify()
+	/// considerably cheaper for events with many delegates,
+	/// at the expense of more expensive add() and remove().
+{
+public:
+	typedef TDelegate*                         DelegateHandle;
+	typedef SharedPtr<TDelegate>               DelegatePtr;
+	typedef std::vector<DelegatePtr>           Delegates;
+	typedef SharedPtr<Delegates>               DelegatesPtr;
+	typedef typename Delegates::iterator       Iterator;
+
+public:
+	SnapshotStrategy():
+		_pDelegates(new Delegates)
+	{
+	}
+
+	SnapshotStrategy(const SnapshotStrategy& s):
+		_pDelegates(s._pDelegates)
+	{
+	}
+
+	~SnapshotStrategy()
+	{
+	}
+
+	void notify(const void* sender)
+	{
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			(*it)->notify(sender);
+		}
+	}
+
+	DelegateHandle add(const TDelegate& delegate)
+	{
+		DelegatePtr pDelegate(static_cast<TDelegate*>(delegate.clone()));
+		DelegatesPtr pDelegates(new Delegates);
+		pDelegates->reserve(_pDelegates->size() + 1);
+		pDelegates->assign(_pDelegates->begin(), _pDelegates->end());
+		pDelegates->push_back(pDelegate);
+		_pDelegates = pDelegates;
+		return pDelegate.get();
+	}
+
+	void remove(const TDelegate& delegate)
+	{
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			if (delegate.equals(**it))
+			{
+				erase(it);
+				return;
+			}
+		}
+	}
+
+	void remove(DelegateHandle delegateHandle)
+	{
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			if (*it == delegateHandle)
+			{
+				erase(it);
+				return;
+			}
+		}
+	}
+
+	SnapshotStrategy& operator = (const SnapshotStrategy& s)
+	{
+		_pDelegates = s._pDelegates;
+		return *this;
+	}
+
+	void clear()
+	{
+		Delegates& delegates = *_pDelegates;
+		for (Iterator it = delegates.begin(); it != delegates.end(); ++it)
+		{
+			(*it)->disable();
+		}
+		_pDelegates = new Delegates;
+	}
+
+	bool empty() const
+	{
+		return _pDelegates->empty();
+	}
+
+protected:
+	void erase(Iterator pos)
+		/// Disables the delegate at pos and publishes a new
+		/// delegate list without it. Snapshots held by notifications
+		/// in progress are not modified, but will skip the disabled
+		/// delegate.
+	{
+		(*pos)->disable();
+		DelegatesPtr pDelegates(new Delegates);
+		pDelegates->reserve(_pDelegates->size() - 1);
+		Iterator begin = _pDelegates->begin();
+		pDelegates->assign(begin, pos);
+		pDelegates->insert(pDelegates->end(), pos + 1, _pDelegates->end());
+		_pDelegates = pDelegates;
+	}
+
+	DelegatesPtr _pDelegates;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_SnapshotStrategy_INCLUDED
@@ -22,6 +22,7 @@
 
 #include "Poco/Foundation.h"
 #include "Poco/Ascii.h"
+#include "Poco/FastAscii.h"
 #include <cstring>
 #include <algorithm>
 
@@ -543,6 +544,216 @@ Foundation_API std::string& removeInPlace(std::string& str, const std::string::v
 #endif	
 
 
+//
+// std::string overloads, vectorized with FastAscii
+//
+
+
+inline std::string trimLeft(const std::string& str)
+	/// Returns a copy of str with all leading
+	/// whitespace removed.
+{
+	return std::string(str, FastAscii::findFirstNonSpace(str.data(), str.size()));
+}
+
+
+inline std::string& trimLeftInPlace(std::string& str)
+	/// Removes all leading whitespace in str.
+{
+	str.erase(0, FastAscii::findFirstNonSpace(str.data(), str.size()));
+	return str;
+}
+
+
+inline std::string trimRight(const std::string& str)
+	/// Returns a copy of str with all trailing
+	/// whitespace removed.
+{
+	return std::string(str, 0, FastAscii::findLastNonSpace(str.data(), str.size()));
+}
+
+
+inline std::string& trimRightInPlace(std::string& str)
+	/// Removes all trailing whitespace in str.
+{
+	str.resize(FastAscii::findLastNonSpace(str.data(), str.size()));
+	return str;
+}
+
+
+inline std::string trim(const std::string& str)
+	/// Returns a copy of str with all leading and
+	/// trailing whitespace removed.
+{
+	std::string::size_type last  = FastAscii::findLastNonSpace(str.data(), str.size());
+	std::string::size_type first = FastAscii::findFirstNonSpace(str.data(), last);
+	return std::string(str, first, last - first);
+}
+
+
+inline std::string& trimInPlace(std::string& str)
+	/// Removes all leading and trailing whitespace in str.
+{
+	std::string::size_type last  = FastAscii::findLastNonSpace(str.data(), str.size());
+	std::string::size_type first = FastAscii::findFirstNonSpace(str.data(), last);
+	str.resize(last);
+	str.erase(0, first);
+	return str;
+}
+
+
+inline std::string& toUpperInPlace(std::string& str)
+	/// Replaces all characters in str with their upper-case counterparts.
+{
+	if (!str.empty()) FastAscii::toUpperInPlace(&str[0], str.size());
+	return str;
+}
+
+
+inline std::string toUpper(const std::string& str)
+	/// Returns a copy of str containing all upper-case characters.
+{
+	std::string result(str);
+	return toUpperInPlace(result);
+}
+
+
+inline std::string& toLowerInPlace(std::string& str)
+	/// Replaces all characters in str with their lower-case counterparts.
+{
+	if (!str.empty()) FastAscii::toLowerInPlace(&str[0], str.size());
+	return str;
+}
+
+
+inline std::string toLower(const std::string& str)
+	/// Returns a copy of str containing all lower-case characters.
+{
+	std::string result(str);
+	return toLowerInPlace(result);
+}
+
+
+inline std::string translate(const std::string& str, const std::string& from, const std::string& to)
+	/// Returns a copy of str with all characters in
+	/// from replaced by the corresponding (by position)
+	/// characters in to. If there is no corresponding
+	/// character in to, the character is removed from
+	/// the copy.
+{
+	enum
+	{
+		KEEP   = -1,
+		REMOVE = -2
+	};
+	// a translation table, instead of searching from for every character
+	int table[256];
+	std::fill(table, table + 256, static_cast<int>(KEEP));
+	for (std::string::size_type i = from.size(); i-- > 0;)
+	{
+		table[static_cast<unsigned char>(from[i])] = i < to.size() ? static_cast<unsigned char>(to[i]) : static_cast<int>(REMOVE);
+	}
+	std::string result;
+	result.reserve(str.size());
+	for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+	{
+		int ch = table[static_cast<unsigned char>(*it)];
+		if (ch == KEEP)
+			result += *it;
+		else if (ch != REMOVE)
+			result += static_cast<char>(ch);
+	}
+	return result;
+}
+
+
+inline std::string translate(const std::string& str, const std::string::value_type* from, const std::string::value_type* to)
+{
+	poco_check_ptr (from);
+	poco_check_ptr (to);
+	return translate(str, std::string(from), std::string(to));
+}
+
+
+inline std::string& translateInPlace(std::string& str, const std::string& from, const std::string& to)
+	/// Replaces in str all occurences of characters in from
+	/// with the corresponding (by position) characters in to.
+	/// If there is no corresponding character, the character
+	/// is removed.
+{
+	str = translate(str, from, to);
+	return str;
+}
+
+
+inline std::string translateInPlace(std::string& str, const std::string::value_type* from, const std::string::value_type* to)
+{
+	poco_check_ptr (from);
+	poco_check_ptr (to);
+	str = translate(str, std::string(from), std::string(to));
+	return str;
+}
+
+
+#if !defined(POCO_NO_TEMPLATE_ICOMPARE)
+
+
+inline int icompare(const std::string& str1, const std::string& str2)
+	/// Case-insensitive string comparison
+{
+	return FastAscii::icompare(str1.data(), str1.size(), str2.data(), str2.size());
+}
+
+
+inline int icompare(const std::string& str, const std::string::value_type* ptr)
+	/// Case-insensitive string comparison
+{
+	poco_check_ptr (ptr);
+	return FastAscii::icompare(str.data(), str.size(), ptr, std::strlen(ptr));
+}
+
+
+inline std::string& replaceInPlace(std::string& str, const std::string::value_type from, const std::string::value_type to = 0, std::string::size_type start = 0)
+{
+	if (from == to || start >= str.size()) return str;
+
+	if (to)
+	{
+		FastAscii::replaceInPlace(&str[start], str.size() - start, from, to);
+	}
+	else
+	{
+		str.erase(std::remove(str.begin() + start, str.end(), from), str.end());
+	}
+	return str;
+}
+
+
+inline std::string& removeInPlace(std::string& str, const std::string::value_type ch, std::string::size_type start = 0)
+{
+	return replaceInPlace(str, ch, 0, start);
+}
+
+
+inline std::string replace(const std::string& str, const std::string::value_type from, const std::string::value_type to = 0, std::string::size_type start = 0)
+{
+	std::string result(str);
+	replaceInPlace(result, from, to, start);
+	return result;
+}
+
+
+inline std::string remove(const std::string& str, const std::string::value_type ch, std::string::size_type start = 0)
+{
+	std::string result(str);
+	replaceInPlace(result, ch, 0, start);
+	return result;
+}
+
+
+#endif
+
+
 template <class S>
 S cat(const S& s1, const S& s2)
 	/// Concatenates two strings.
@@ -0,0 +1,555 @@
+//
+// ThreadPoolMetrics.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  ThreadPoolMetrics
+//
+// Definition of the ThreadPoolMetrics and InstrumentedThreadPool classes.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_ThreadPoolMetrics_INCLUDED
+#define Foundation_ThreadPoolMetrics_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/TimerWheel.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Runnable.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include "Poco/Logger.h"
+#include "Poco/Format.h"
+#include "Poco/Types.h"
+#include <vector>
+
+
+namespace Poco {
+
+
+class TimeHistogram
+	/// A histogram of durations in microseconds, with
+	/// power-of-two buckets. Bucket i counts durations
+	/// below 2^i microseconds; the last bucket counts
+	/// all longer durations.
+{
+public:
+	enum
+	{
+		BUCKETS = 24
+	};
+
+	TimeHistogram()
+	{
+		reset();
+	}
+
+	void record(Clock::ClockDiff duration)
+		/// Records the given duration.
+	{
+		if (duration < 0) duration = 0;
+		int i = 0;
+		while (i < BUCKETS - 1 && duration >= (static_cast<Clock::ClockDiff>(1) << i)) ++i;
+		++_buckets[i];
+		++_count;
+		_total += duration;
+		if (duration > _max) _max = duration;
+	}
+
+	void reset()
+		/// Clears the histogram.
+	{
+		for (int i = 0; i < BUCKETS; ++i) _buckets[i] = 0;
+		_count = 0;
+		_total = 0;
+		_max   = 0;
+	}
+
+	UInt64 bucket(int i) const
+		/// Returns the number of durations in bucket i.
+	{
+		poco_assert (i >= 0 && i < BUCKETS);
+		return _buckets[i];
+	}
+
+	static Clock::ClockDiff limit(int i)
+		/// Returns the upper limit of bucket i in microseconds.
+	{
+		return static_cast<Clock::ClockDiff>(1) << i;
+	}
+
+	UInt64 count() const
+		/// Returns the number of recorded durations.
+	{
+		return _count;
+	}
+
+	Clock::ClockDiff total() const
+		/// Returns the sum of all recorded durations.
+	{
+		return _total;
+	}
+
+	Clock::ClockDiff max() const
+		/// Returns the longest recorded duration.
+	{
+		return _max;
+	}
+
+	Clock::ClockDiff percentile(double p) const
+		/// Returns the upper limit of the bucket containing the
+		/// given percentile (0 to 100), or 0 if the histogram is empty.
+	{
+		if (_count == 0) return 0;
+		UInt64 rank = static_cast<UInt64>(p*_count/100);
+		UInt64 n = 0;
+		for (int i = 0; i < BUCKETS - 1; ++i)
+		{
+			n += _buckets[i];
+			if (n > rank) return limit(i);
+		}
+		return _max;
+	}
+
+private:
+	UInt64 _buckets[BUCKETS];
+	UInt64 _count;
+	Clock::ClockDiff _total;
+	Clock::ClockDiff _max;
+};
+
+
+struct ThreadPoolStatistics
+	/// A snapshot of the metrics of a thread pool.
+{
+	ThreadPoolStatistics():
+		started(0),
+		rejected(0),
+		completed(0),
+		failed(0),
+		running(0),
+		peakConcurrency(0),
+		capacity(0),
+		used(0)
+	{
+	}
+
+	std::string   pool;            /// Name of the pool.
+	UInt64        started;         /// Tasks handed to a thread.
+	UInt64        rejected;        /// Tasks rejected with NoThreadAvailableException.
+	UInt64        completed;       /// Tasks that have returned.
+	UInt64        failed;          /// Tasks that have thrown.
+	int           running;         /// Tasks currently running.
+	int           peakConcurrency; /// Highest number of tasks running at a time.
+	int           capacity;        /// ThreadPool::capacity() at the time of the snapshot.
+	int           used;            /// ThreadPool::used() at the time of the snapshot.
+	TimeHistogram queueWait;       /// Time from start() until the task begins to run.
+	TimeHistogram runTime;         /// Time the task runs.
+};
+
+
+class ThreadPoolMetricsSink
+	/// The interface for receivers of ThreadPoolStatistics,
+	/// such as LoggerMetricsSink or the OSP ThreadPoolMetricsService.
+{
+public:
+	typedef SharedPtr<ThreadPoolMetricsSink> Ptr;
+
+	virtual ~ThreadPoolMetricsSink()
+	{
+	}
+
+	virtual void report(const ThreadPoolStatistics& statistics) = 0;
+		/// Receives a snapshot of the metrics of a pool.
+		/// May be called from the TimerWheel thread.
+};
+
+
+class LoggerMetricsSink: public ThreadPoolMetricsSink
+	/// A ThreadPoolMetricsSink that writes statistics to a Logger,
+	/// as a single information message. If tasks have been rejected
+	/// since the previous report, the message has warning priority.
+{
+public:
+	explicit LoggerMetricsSink(Logger& logger):
+		_logger(logger),
+		_rejected(0)
+	{
+	}
+
+	void report(const ThreadPoolStatistics& s)
+	{
+		Message::Priority prio = s.rejected > _rejected ? Message::PRIO_WARNING : Message::PRIO_INFORMATION;
+		_rejected = s.rejected;
+		if (!_logger.is(prio)) return;
+		std::string msg = format("Thread pool %s: started %Lu, rejected %Lu, failed %Lu, running %d, peak %d of %d",
+			s.pool, s.started, s.rejected, s.failed, s.running, s.peakConcurrency, s.capacity);
+		msg += format(", wait p50/p99/max %Ldus/%Ldus/%Ldus",
+			s.queueWait.percentile(50), s.queueWait.percentile(99), s.queueWait.max());
+		msg += format(", run p50/p99/max %Ldus/%Ldus/%Ldus",
+			s.runTime.percentile(50), s.runTime.percentile(99), s.runTime.max());
+		_logger.log(Message(_logger.name(), msg, prio));
+	}
+
+private:
+	Logger& _logger;
+	UInt64  _rejected;
+};
+
+
+class ThreadPoolMetrics: public RefCountedObject
+	/// The counters and histograms of an InstrumentedThreadPool.
+{
+public:
+	typedef AutoPtr<ThreadPoolMetrics> Ptr;
+
+	explicit ThreadPoolMetrics(const std::string& pool):
+		_pool(pool)
+	{
+		_statistics.pool = pool;
+	}
+
+	void taskStarted()
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		++_statistics.started;
+	}
+
+	void taskRejected()
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		++_statistics.rejected;
+	}
+
+	void taskBegins(Clock::ClockDiff wait)
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_statistics.queueWait.record(wait);
+		if (++_statistics.running > _statistics.peakConcurrency)
+			_statistics.peakConcurrency = _statistics.running;
+	}
+
+	void taskEnds(Clock::ClockDiff runTime, bool failed)
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_statistics.runTime.record(runTime);
+		--_statistics.running;
+		++_statistics.completed;
+		if (failed) ++_statistics.failed;
+	}
+
+	void statistics(ThreadPoolStatistics& statistics) const
+		/// Copies the current metrics to statistics.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		statistics = _statistics;
+	}
+
+	void reset()
+		/// Resets counters and histograms. The number of
+		/// running tasks is kept.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		int running = _statistics.running;
+		_statistics = ThreadPoolStatistics();
+		_statistics.pool = _pool;
+		_statistics.running = running;
+		_statistics.peakConcurrency = running;
+	}
+
+protected:
+	~ThreadPoolMetrics()
+	{
+	}
+
+private:
+	std::string          _pool;
+	ThreadPoolStatistics _statistics;
+	mutable FastMutex    _mutex;
+};
+
+
+class InstrumentedThreadPool
+	/// InstrumentedThreadPool starts tasks in a ThreadPool and
+	/// keeps ThreadPoolMetrics for them: the number of tasks started
+	/// and rejected, the time between start() and the task beginning
+	/// to run, the run time of tasks, and the peak number of tasks
+	/// running at a time.
+	///
+	/// Only tasks started through the InstrumentedThreadPool are
+	/// measured; tasks started directly in the underlying pool only
+	/// show up in the used() and capacity() values of a snapshot.
+	///
+	/// Statistics are passed to the registered sinks by report(),
+	/// or periodically after startReporting().
+	///
+	///     InstrumentedThreadPool pool(ThreadPool::defaultPool());
+	///     pool.addSink(new LoggerMetricsSink(Logger::get("ThreadPool")));
+	///     pool.startReporting(60000);
+	///     pool.start(runnable);
+	///
+	/// Every start() allocates a small wrapper object.
+{
+public:
+	explicit InstrumentedThreadPool(ThreadPool& pool):
+		_pool(pool),
+		_pMetrics(new ThreadPoolMetrics(pool.name()))
+		/// Creates the InstrumentedThreadPool for the given pool.
+	{
+	}
+
+	~InstrumentedThreadPool()
+		/// Stops reporting. Tasks still running are
+		/// measured until they complete.
+	{
+		try
+		{
+			stopReporting();
+		}
+		catch (...)
+		{
+			poco_unexpected();
+		}
+	}
+
+	void start(Runnable& target)
+		/// Starts the target in the pool. Throws a NoThreadAvailableException,
+		/// counted as rejection, if no thread is available.
+	{
+		MeasuredRunnable* pRunnable = new MeasuredRunnable(target, _pMetrics);
+		try
+		{
+			_pool.start(*pRunnable);
+		}
+		catch (...)
+		{
+			delete pRunnable;
+			_pMetrics->taskRejected();
+			throw;
+		}
+		_pMetrics->taskStarted();
+	}
+
+	void start(Runnable& target, const std::string& name)
+		/// Starts the target in a thread with the given name.
+	{
+		MeasuredRunnable* pRunnable = new MeasuredRunnable(target, _pMetrics);
+		try
+		{
+			_pool.start(*pRunnable, name);
+		}
+		catch (...)
+		{
+			delete pRunnable;
+			_pMetrics->taskRejected();
+			throw;
+		}
+		_pMetrics->taskStarted();
+	}
+
+	void startWithPriority(Thread::Priority priority, Runnable& target)
+		/// Starts the target in a thread with the given priority.
+	{
+		MeasuredRunnable* pRunnable = new MeasuredRunnable(target, _pMetrics);
+		try
+		{
+			_pool.startWithPriority(priority, *pRunnable);
+		}
+		catch (...)
+		{
+			delete pRunnable;
+			_pMetrics->taskRejected();
+			throw;
+		}
+		_pMetrics->taskStarted();
+	}
+
+	void startWithPriority(Thread::Priority priority, Runnable& target, const std::string& name)
+		/// Starts the target in a thread with the given priority and name.
+	{
+		MeasuredRunnable* pRunnable = new MeasuredRunnable(target, _pMetrics);
+		try
+		{
+			_pool.startWithPriority(priority, *pRunnable, name);
+		}
+		catch (...)
+		{
+			delete pRunnable;
+			_pMetrics->taskRejected();
+			throw;
+		}
+		_pMetrics->taskStarted();
+	}
+
+	bool tryStart(Runnable& target)
+		/// Starts the target and returns true, or counts a rejection
+		/// and returns false if no thread is available.
+	{
+		try
+		{
+			start(target);
+			return true;
+		}
+		catch (NoThreadAvailableException&)
+		{
+			return false;
+		}
+	}
+
+	ThreadPool& pool()
+		/// Returns the underlying pool.
+	{
+		return _pool;
+	}
+
+	void statistics(ThreadPoolStatistics& statistics) const
+		/// Returns a snapshot of the metrics.
+	{
+		_pMetrics->statistics(statistics);
+		statistics.capacity = _pool.capacity();
+		statistics.used     = _pool.used();
+	}
+
+	void reset()
+		/// Resets counters and histograms.
+	{
+		_pMetrics->reset();
+	}
+
+	void addSink(ThreadPoolMetricsSink::Ptr pSink)
+		/// Registers a sink for report().
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		_sinks.push_back(pSink);
+	}
+
+	void removeSink(ThreadPoolMetricsSink::Ptr pSink)
+		/// Unregisters a sink.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		for (std::vector<ThreadPoolMetricsSink::Ptr>::iterator it = _sinks.begin(); it != _sinks.end(); ++it)
+		{
+			if (it->get() == pSink.get())
+			{
+				_sinks.erase(it);
+				return;
+			}
+		}
+	}
+
+	void report()
+		/// Passes a snapshot of the metrics to all sinks.
+	{
+		ThreadPoolStatistics s;
+		statistics(s);
+		FastMutex::ScopedLock lock(_mutex);
+		for (std::vector<ThreadPoolMetricsSink::Ptr>::iterator it = _sinks.begin(); it != _sinks.end(); ++it)
+		{
+			(*it)->report(s);
+		}
+	}
+
+	void startReporting(long interval)
+		/// Calls report() every interval milliseconds
+		/// from the default TimerWheel.
+	{
+		stopReporting();
+		FastMutex::ScopedLock lock(_mutex);
+		_pReportTimer = TimerWheel::defaultWheel().schedule(AutoPtr<ReportTask>(new ReportTask(*this)), interval, interval, interval/10);
+	}
+
+	void stopReporting()
+		/// Stops periodic reporting.
+	{
+		TimerWheel::Timer::Ptr pTimer;
+		{
+			FastMutex::ScopedLock lock(_mutex);
+			pTimer = _pReportTimer;
+			_pReportTimer = 0;
+		}
+		if (pTimer) TimerWheel::defaultWheel().cancel(pTimer);
+	}
+
+private:
+	class MeasuredRunnable: public Runnable
+	{
+	public:
+		MeasuredRunnable(Runnable& target, const ThreadPoolMetrics::Ptr& pMetrics):
+			_target(target),
+			_pMetrics(pMetrics)
+		{
+		}
+
+		void run()
+		{
+			ThreadPoolMetrics::Ptr pMetrics(_pMetrics);
+			Runnable& target = _target;
+			pMetrics->taskBegins(_queued.elapsed());
+			delete this;
+			Clock begin;
+			try
+			{
+				target.run();
+			}
+			catch (...)
+			{
+				pMetrics->taskEnds(begin.elapsed(), true);
+				throw;
+			}
+			pMetrics->taskEnds(begin.elapsed(), false);
+		}
+
+	private:
+		Runnable&              _target;
+		ThreadPoolMetrics::Ptr _pMetrics;
+		Clock                  _queued;
+	};
+
+	class ReportTask: public RefCountedObject, public Runnable
+	{
+	public:
+		ReportTask(InstrumentedThreadPool& pool):
+			_pool(pool)
+		{
+		}
+
+		void run()
+		{
+			_pool.report();
+		}
+
+		bool isCancelled() const
+		{
+			return false;
+		}
+
+	private:
+		InstrumentedThreadPool& _pool;
+	};
+
+	InstrumentedThreadPool(const InstrumentedThreadPool&);
+	InstrumentedThreadPool& operator = (const InstrumentedThreadPool&);
+
+	ThreadPool&                            _pool;
+	ThreadPoolMetrics::Ptr                 _pMetrics;
+	std::vector<ThreadPoolMetricsSink::Ptr> _sinks;
+	TimerWheel::Timer::Ptr                 _pReportTimer;
+	FastMutex                              _mutex;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_ThreadPoolMetrics_INCLUDED
@@ -0,0 +1,574 @@
+//
+// TimerWheel.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Threading
+// Module:  TimerWheel
+//
+// Definition of the TimerWheel class.
+//
+// Copyright (c) 2004-2009, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_TimerWheel_INCLUDED
+#define Foundation_TimerWheel_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/RefCountedObject.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Clock.h"
+#include "Poco/Exception.h"
+#include "Poco/ErrorHandler.h"
+#include "Poco/SingletonHolder.h"
+#include "Poco/Types.h"
+#include <vector>
+
+
+namespace Poco {
+
+
+class TimerWheel: protected Runnable
+	/// A hierarchical timer wheel (Varghese and Lauck) with
+	/// its own thread, executing tasks after a delay and,
+	/// optionally, periodically.
+	///
+	/// Scheduling and cancelling a timer take constant time,
+	/// independent of the number of timers. Cancelling a timer
+	/// removes it from the wheel immediately.
+	///
+	/// Time is divided into ticks of a fixed resolution. The wheel
+	/// has LEVELS levels of SLOTS slots each; level n covers
+	/// SLOTS^(n+1) ticks. Timers further away than the wheel covers
+	/// are parked in the last level and moved down when it turns.
+	///
+	/// The thread sleeps until the next tick with an expiring timer.
+	/// Timers scheduled with a slack may be delayed by up to the slack
+	/// so that timers with similar deadlines expire in the same tick,
+	/// which saves wakeups.
+	///
+	/// Tasks are executed one after the other in the wheel's thread
+	/// and must not block. Exceptions thrown by tasks are passed to
+	/// the ErrorHandler.
+{
+public:
+	class Task: public RefCountedObject
+		/// The type-erased task executed by a timer.
+	{
+	public:
+		typedef AutoPtr<Task> Ptr;
+
+		virtual void execute() = 0;
+			/// Executes the task.
+
+		virtual bool isCancelled() const = 0;
+			/// Returns true if the task has been cancelled.
+			/// Cancelled tasks are no longer executed.
+
+	protected:
+		~Task()
+		{
+		}
+	};
+
+	template <class TTask>
+	class TaskAdapter: public Task
+		/// Adapts a reference counted Runnable with an isCancelled()
+		/// member function, such as Util::TimerTask, to Task.
+	{
+	public:
+		TaskAdapter(const AutoPtr<TTask>& pTask):
+			_pTask(pTask)
+		{
+		}
+
+		void execute()
+		{
+			_pTask->run();
+		}
+
+		bool isCancelled() const
+		{
+			return _pTask->isCancelled();
+		}
+
+	protected:
+		~TaskAdapter()
+		{
+		}
+
+	private:
+		AutoPtr<TTask> _pTask;
+	};
+
+	class Timer: public RefCountedObject
+		/// A scheduled timer, returned by schedule() and used
+		/// as handle for cancel().
+	{
+	public:
+		typedef AutoPtr<Timer> Ptr;
+
+		bool isScheduled() const
+			/// Returns true if the timer will expire, or is running and
+			/// will be rescheduled. The result may be outdated when it
+			/// is returned.
+		{
+			return _state == STATE_SCHEDULED || (_state == STATE_RUNNING && _interval > 0);
+		}
+
+	protected:
+		~Timer()
+		{
+		}
+
+	private:
+		enum State
+		{
+			STATE_SCHEDULED,
+			STATE_RUNNING,
+			STATE_DONE
+		};
+
+		Timer(const Task::Ptr& pTask, UInt64 interval, bool fixedRate):
+			_pPrev(0),
+			_pNext(0),
+			_ppHead(0),
+			_expiry(0),
+			_interval(interval),
+			_fixedRate(fixedRate),
+			_state(STATE_SCHEDULED),
+			_pTask(pTask)
+		{
+		}
+
+		Timer*    _pPrev;
+		Timer*    _pNext;
+		Timer**   _ppHead;
+		UInt64    _expiry;
+		UInt64    _interval;
+		bool      _fixedRate;
+		State     _state;
+		Task::Ptr _pTask;
+
+		friend class TimerWheel;
+	};
+
+	enum
+	{
+		LEVELS = 4,
+		SLOT_BITS = 6,
+		SLOTS = 1 << SLOT_BITS,
+		DEFAULT_RESOLUTION = 10
+			/// Default tick length in milliseconds.
+	};
+
+	explicit TimerWheel(long resolution = DEFAULT_RESOLUTION);
+		/// Creates the TimerWheel with the given tick length
+		/// in milliseconds. The thread is started when the
+		/// first timer is scheduled.
+
+	~TimerWheel();
+		/// Cancels all timers and stops the thread.
+
+	template <class TTask>
+	Timer::Ptr schedule(const AutoPtr<TTask>& pTask, long delay, long interval = 0, long slack = 0)
+		/// Schedules pTask for execution after delay milliseconds and
+		/// then, if interval is not 0, repeatedly with interval
+		/// milliseconds between the end of an execution and the start
+		/// of the next one. The task may be executed up to slack
+		/// milliseconds late.
+	{
+		Task::Ptr pAdapter(new TaskAdapter<TTask>(pTask));
+		return scheduleTask(pAdapter, delay, interval, false, slack);
+	}
+
+	template <class TTask>
+	Timer::Ptr scheduleAtFixedRate(const AutoPtr<TTask>& pTask, long delay, long interval, long slack = 0)
+		/// Schedules pTask for execution after delay milliseconds and
+		/// then repeatedly every interval milliseconds, measured from
+		/// the first execution. The task may be executed up to slack
+		/// milliseconds late.
+	{
+		Task::Ptr pAdapter(new TaskAdapter<TTask>(pTask));
+		return scheduleTask(pAdapter, delay, interval, true, slack);
+	}
+
+	Timer::Ptr scheduleTask(const Task::Ptr& pTask, long delay, long interval, bool fixedRate, long slack);
+		/// Schedules a Task, see schedule() and scheduleAtFixedRate().
+
+	bool cancel(const Timer::Ptr& pTimer);
+		/// Cancels the given timer. Returns true if the timer was
+		/// scheduled. If the task is currently being executed, waits
+		/// until the execution has finished.
+
+	void cancelAll();
+		/// Cancels all timers.
+
+	std::size_t size() const;
+		/// Returns the number of scheduled timers.
+
+	long resolution() const;
+		/// Returns the tick length in milliseconds.
+
+	static TimerWheel& defaultWheel();
+		/// Returns the process-wide default TimerWheel.
+
+protected:
+	void run();
+
+private:
+	TimerWheel(const TimerWheel&);
+	TimerWheel& operator = (const TimerWheel&);
+
+	UInt64 ticks() const;
+	void link(Timer* pTimer);
+	void unlink(Timer* pTimer);
+	void cascade(int level, UInt64 tick);
+	void advance(UInt64 to, std::vector<Timer::Ptr>& expired);
+	UInt64 nextExpiry() const;
+
+	static const UInt64 NEVER = ~static_cast<UInt64>(0);
+
+	Clock     _start;
+	long      _resolution;
+	UInt64    _current;
+	Timer*    _slots[LEVELS][SLOTS];
+	std::size_t _size;
+	Timer*    _pRunning;
+	bool      _started;
+	bool      _stop;
+	FastMutex _mutex;
+	Condition _wakeUp;
+	Condition _runningDone;
+	Thread    _thread;
+};
+
+
+//
+// inlines
+//
+inline TimerWheel::TimerWheel(long resolution):
+	_resolution(resolution > 0 ? resolution : 1),
+	_current(0),
+	_size(0),
+	_pRunning(0),
+	_started(false),
+	_stop(false)
+{
+	for (int l = 0; l < LEVELS; ++l)
+	{
+		for (int s = 0; s < SLOTS; ++s) _slots[l][s] = 0;
+	}
+}
+
+
+inline TimerWheel::~TimerWheel()
+{
+	cancelAll();
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_started) return;
+		_stop = true;
+	}
+	_wakeUp.signal();
+	_thread.join();
+}
+
+
+inline TimerWheel::Timer::Ptr TimerWheel::scheduleTask(const Task::Ptr& pTask, long delay, long interval, bool fixedRate, long slack)
+{
+	poco_check_ptr (pTask);
+	if (delay < 0) delay = 0;
+	const UInt64 intervalTicks = interval > 0 ? (static_cast<UInt64>(interval) + _resolution - 1)/_resolution : 0;
+	Timer::Ptr pTimer(new Timer(pTask, intervalTicks, fixedRate));
+
+	FastMutex::ScopedLock lock(_mutex);
+	UInt64 expiry = ticks() + (static_cast<UInt64>(delay) + _resolution - 1)/_resolution;
+	if (slack > 0)
+	{
+		// align to the largest power of two not exceeding the slack,
+		// so that timers with similar deadlines share a tick
+		UInt64 slackTicks = static_cast<UInt64>(slack)/_resolution;
+		UInt64 granularity = 1;
+		while (granularity*2 <= slackTicks + 1) granularity *= 2;
+		expiry = ((expiry + granularity - 1)/granularity)*granularity;
+	}
+	if (expiry <= _current) expiry = _current + 1;
+	const UInt64 next = nextExpiry();
+	pTimer->_expiry = expiry;
+	link(pTimer.get());
+	if (!_started)
+	{
+		_started = true;
+		_thread.setName("TimerWheel");
+		_thread.start(*this);
+	}
+	else if (expiry < next)
+	{
+		_wakeUp.signal();
+	}
+	return pTimer;
+}
+
+
+inline bool TimerWheel::cancel(const Timer::Ptr& ptr)
+{
+	Timer* pTimer = const_cast<Timer*>(ptr.get());
+	FastMutex::ScopedLock lock(_mutex);
+	if (pTimer->_state == Timer::STATE_SCHEDULED)
+	{
+		unlink(pTimer);
+		pTimer->_state = Timer::STATE_DONE;
+		return true;
+	}
+	if (pTimer->_state == Timer::STATE_RUNNING)
+	{
+		pTimer->_state = Timer::STATE_DONE;
+		if (_thread.isRunning() && Thread::current() != &_thread)
+		{
+			while (_pRunning == pTimer) _runningDone.wait(_mutex);
+		}
+		return true;
+	}
+	return false;
+}
+
+
+inline void TimerWheel::cancelAll()
+{
+	FastMutex::ScopedLock lock(_mutex);
+	for (int l = 0; l < LEVELS; ++l)
+	{
+		for (int s = 0; s < SLOTS; ++s)
+		{
+			while (_slots[l][s])
+			{
+				Timer* pTimer = _slots[l][s];
+				pTimer->_state = Timer::STATE_DONE;
+				unlink(pTimer);
+			}
+		}
+	}
+	if (_pRunning) _pRunning->_state = Timer::STATE_DONE;
+}
+
+
+inline std::size_t TimerWheel::size() const
+{
+	FastMutex::ScopedLock lock(const_cast<FastMutex&>(_mutex));
+	return _size;
+}
+
+
+inline long TimerWheel::resolution() const
+{
+	return _resolution;
+}
+
+
+inline TimerWheel& TimerWheel::defaultWheel()
+{
+	static SingletonHolder<TimerWheel> sh;
+	return *sh.get();
+}
+
+
+inline UInt64 TimerWheel::ticks() const
+{
+	return static_cast<UInt64>(_start.elapsed())/(static_cast<UInt64>(_resolution)*1000);
+}
+
+
+inline void TimerWheel::link(Timer* pTimer)
+{
+	const UInt64 expiry = pTimer->_expiry;
+	const UInt64 delta = expiry > _current ? expiry - _current : 0;
+	int level = 0;
+	UInt64 tick = expiry > _current ? expiry : _current;
+	while (level < LEVELS - 1 && delta >= (static_cast<UInt64>(1) << (SLOT_BITS*(level + 1)))) ++level;
+	if (level == LEVELS - 1)
+	{
+		const UInt64 range = static_cast<UInt64>(1) << (SLOT_BITS*LEVELS);
+		if (delta >= range) tick = _current + range - 1;
+	}
+	Timer*& head = _slots[level][(tick >> (SLOT_BITS*level)) & (SLOTS - 1)];
+	pTimer->duplicate();
+	pTimer->_pPrev = 0;
+	pTimer->_pNext = head;
+	pTimer->_ppHead = &head;
+	if (head) head->_pPrev = pTimer;
+	head = pTimer;
+	++_size;
+}
+
+
+inline void TimerWheel::unlink(Timer* pTimer)
+{
+	if (pTimer->_pPrev)
+		pTimer->_pPrev->_pNext = pTimer->_pNext;
+	else
+		*pTimer->_ppHead = pTimer->_pNext;
+	if (pTimer->_pNext) pTimer->_pNext->_pPrev = pTimer->_pPrev;
+	pTimer->_pPrev = 0;
+	pTimer->_pNext = 0;
+	pTimer->_ppHead = 0;
+	--_size;
+	pTimer->release();
+}
+
+
+inline void TimerWheel::cascade(int level, UInt64 tick)
+{
+	Timer*& head = _slots[level][(tick >> (SLOT_BITS*level)) & (SLOTS - 1)];
+	Timer* pTimer = head;
+	head = 0;
+	while (pTimer)
+	{
+		Timer* pNext = pTimer->_pNext;
+		pTimer->_pPrev = 0;
+		pTimer->_pNext = 0;
+		--_size;
+		link(pTimer);
+		pTimer->release();
+		pTimer = pNext;
+	}
+}
+
+
+inline void TimerWheel::advance(UInt64 to, std::vector<Timer::Ptr>& expired)
+{
+	while (_current < to)
+	{
+		++_current;
+		for (int level = 1; level < LEVELS; ++level)
+		{
+			if ((_current & ((static_cast<UInt64>(1) << (SLOT_BITS*level)) - 1)) != 0) break;
+			cascade(level, _current);
+		}
+		Timer*& head = _slots[0][_current & (SLOTS - 1)];
+		while (head)
+		{
+			Timer* pTimer = head;
+			expired.push_back(Timer::Ptr(pTimer, true));
+			unlink(pTimer);
+		}
+	}
+}
+
+
+inline UInt64 TimerWheel::nextExpiry() const
+{
+	UInt64 next = NEVER;
+	for (UInt64 t = 1; t <= SLOTS; ++t)
+	{
+		if (_slots[0][(_current + t) & (SLOTS - 1)])
+		{
+			next = _current + t;
+			break;
+		}
+	}
+	for (int level = 1; level < LEVELS; ++level)
+	{
+		const int shift = SLOT_BITS*level;
+		const UInt64 base = _current >> shift;
+		for (UInt64 k = 1; k <= SLOTS; ++k)
+		{
+			if (_slots[level][(base + k) & (SLOTS - 1)])
+			{
+				const UInt64 tick = (base + k) << shift;
+				if (tick < next) next = tick;
+				break;
+			}
+		}
+	}
+	return next;
+}
+
+
+inline void TimerWheel::run()
+{
+	std::vector<Timer::Ptr> expired;
+	FastMutex::ScopedLock lock(_mutex);
+	while (!_stop)
+	{
+		advance(ticks(), expired);
+		if (!expired.empty())
+		{
+			for (std::vector<Timer::Ptr>::iterator it = expired.begin(); it != expired.end(); ++it)
+			{
+				Timer* pTimer = it->get();
+				if (pTimer->_state != Timer::STATE_SCHEDULED) continue;
+				pTimer->_state = Timer::STATE_RUNNING;
+				_pRunning = pTimer;
+				_mutex.unlock();
+				try
+				{
+					if (!pTimer->_pTask->isCancelled()) pTimer->_pTask->execute();
+				}
+				catch (Exception& exc)
+				{
+					ErrorHandler::handle(exc);
+				}
+				catch (std::exception& exc)
+				{
+					ErrorHandler::handle(exc);
+				}
+				catch (...)
+				{
+					ErrorHandler::handle();
+				}
+				_mutex.lock();
+				_pRunning = 0;
+				_runningDone.broadcast();
+				if (pTimer->_state == Timer::STATE_RUNNING && pTimer->_interval > 0 && !pTimer->_pTask->isCancelled())
+				{
+					if (pTimer->_fixedRate)
+					{
+						pTimer->_expiry += pTimer->_interval;
+						const UInt64 now = ticks();
+						if (pTimer->_expiry <= now) pTimer->_expiry = now + 1;
+					}
+					else
+					{
+						pTimer->_expiry = ticks() + pTimer->_interval;
+					}
+					if (pTimer->_expiry <= _current) pTimer->_expiry = _current + 1;
+					pTimer->_state = Timer::STATE_SCHEDULED;
+					link(pTimer);
+				}
+				else
+				{
+					pTimer->_state = Timer::STATE_DONE;
+				}
+			}
+			expired.clear();
+			continue;
+		}
+		const UInt64 next = nextExpiry();
+		if (next == NEVER)
+		{
+			_wakeUp.wait(_mutex);
+		}
+		else
+		{
+			const UInt64 now = ticks();
+			if (next > now) _wakeUp.tryWait(_mutex, static_cast<long>((next - now)*_resolution));
+		}
+	}
+}
+
+
+} // namespace Poco
+
+
+#endif // Foundation_TimerWheel_INCLUDED
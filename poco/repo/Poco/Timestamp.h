@@ -22,6 +22,12 @@
 
 #include "Poco/Foundation.h"
 #include <ctime>
+#if defined(__linux__)
+#include <time.h>
+#if defined(CLOCK_MONOTONIC_COARSE) && defined(CLOCK_REALTIME_COARSE)
+#define POCO_HAVE_COARSE_CLOCK 1
+#endif
+#endif
 
 
 namespace Poco {
@@ -84,6 +90,10 @@ public:
 	void update();
 		/// Updates the Timestamp with the current time.
 
+	void updateFast();
+		/// Updates the Timestamp with the current time, with the
+		/// accuracy of the system timer tick, like fast().
+
 	bool operator == (const Timestamp& ts) const;
 	bool operator != (const Timestamp& ts) const;
 	bool operator >  (const Timestamp& ts) const;
@@ -141,6 +151,15 @@ public:
 		/// Since the timestamp has microsecond resolution,
 		/// the returned value is always 1000000.
 
+	static Timestamp fast();
+		/// Returns the current time with the accuracy of the system
+		/// timer tick (typically 1 to 10 milliseconds), for hot paths
+		/// where millisecond accuracy suffices.
+		///
+		/// On Linux, the time is read with CLOCK_REALTIME_COARSE, and
+		/// can lag behind Timestamp() by up to one tick. On other
+		/// platforms, fast() is equivalent to Timestamp().
+
 #if defined(_WIN32)
 	static Timestamp fromFileTimeNP(UInt32 fileTimeLow, UInt32 fileTimeHigh);
 	void toFileTimeNP(UInt32& fileTimeLow, UInt32& fileTimeHigh) const;
@@ -261,6 +280,28 @@ inline Timestamp::TimeDiff Timestamp::resolution()
 }
 
 
+inline void Timestamp::updateFast()
+{
+#if defined(POCO_HAVE_COARSE_CLOCK)
+	struct timespec ts;
+	if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0)
+	{
+		_ts = TimeVal(ts.tv_sec)*resolution() + ts.tv_nsec/1000;
+		return;
+	}
+#endif
+	update();
+}
+
+
+inline Timestamp Timestamp::fast()
+{
+	Timestamp ts(0);
+	ts.updateFast();
+	return ts;
+}
+
+
 inline void swap(Timestamp& s1, Timestamp& s2)
 {
 	s1.swap(s2);
@@ -0,0 +1,759 @@
+//
+// Tracer.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: Core
+// Module:  Tracer
+//
+// Definition of the Tracer class and the tracing macros.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_Tracer_INCLUDED
+#define Foundation_Tracer_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/Mutex.h"
+#include "Poco/Thread.h"
+#include "Poco/Process.h"
+#include "Poco/Clock.h"
+#include "Poco/BinaryWriter.h"
+#include "Poco/BinaryReader.h"
+#include "Poco/FileStream.h"
+#include "Poco/Exception.h"
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <ostream>
+#include <istream>
+#include <cstdio>
+#if __cplusplus >= 201103L
+#include <atomic>
+#else
+#include "Poco/FastThreadLocal.h"
+#endif
+#if defined(POCO_OS_FAMILY_UNIX)
+#include <time.h>
+#endif
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+
+namespace Poco {
+
+
+class Tracer
+	/// Tracer records spans (events with a start time and a duration)
+	/// and instant events on a timeline, e.g. the start of bundles, the
+	/// registration of services, Remoting calls and event notifications,
+	/// so that the startup and the interaction of components can be
+	/// analysed with a trace viewer.
+	///
+	/// Tracing is switched on and off at run time with enable() and
+	/// disable(). While tracing is disabled, a span costs a single
+	/// relaxed load of the enabled flag.
+	///
+	/// Every thread records into a ring buffer of its own, so recording
+	/// takes no lock. When a ring buffer is full, the oldest events of
+	/// the thread are overwritten. Buffers are allocated when a thread
+	/// records its first event, and are kept after the thread terminates,
+	/// until clear() is called.
+	///
+	/// collect() copies the recorded events into a Trace, which can
+	/// be written in a compact binary format (write(), read()) or in the
+	/// JSON trace event format (writeJSON()) understood by Perfetto
+	/// (ui.perfetto.dev) and chrome://tracing. Binary traces can be
+	/// converted to JSON later on, e.g. on a development host.
+	///
+	/// Category and event names are not copied, and must stay valid
+	/// until the Tracer has been cleared. Use string literals, or names
+	/// returned by intern().
+	///
+	/// Usage:
+	///
+	///     Poco::Tracer::instance().enable();
+	///     {
+	///         poco_trace_scope("app", "initialize");
+	///         ...
+	///     }
+	///     Poco::Tracer::instance().save("startup.json", Poco::Tracer::FORMAT_JSON);
+	///
+	/// The tracing macros expand to nothing if POCO_NO_TRACING is defined.
+{
+public:
+	enum
+	{
+		DEFAULT_BUFFER_SIZE = 16384
+			/// Default number of events per thread.
+	};
+
+	enum Phase
+	{
+		PHASE_COMPLETE = 'X',
+			/// A span with start time and duration.
+		PHASE_INSTANT = 'i'
+			/// An event without duration.
+	};
+
+	enum Format
+	{
+		FORMAT_BINARY,
+			/// The compact binary format written by write().
+		FORMAT_JSON
+			/// The JSON trace event format written by writeJSON().
+	};
+
+	struct Event
+		/// An event of a Trace.
+	{
+		UInt64 start;
+			/// Monotonic clock value, in nanoseconds.
+		UInt64 duration;
+			/// Duration of a span, in nanoseconds.
+		UInt32 category;
+			/// Index of the category in Trace::strings.
+		UInt32 name;
+			/// Index of the name in Trace::strings.
+		char phase;
+			/// PHASE_COMPLETE or PHASE_INSTANT.
+	};
+
+	struct ThreadTrace
+		/// The events recorded by one thread, ordered by end time.
+	{
+		UInt64 tid;
+		std::string name;
+		std::vector<Event> events;
+	};
+
+	struct Trace
+		/// The events recorded by all threads of a process.
+	{
+		Trace():
+			pid(0)
+		{
+		}
+
+		UInt64 pid;
+		std::vector<std::string> strings;
+		std::vector<ThreadTrace> threads;
+	};
+
+	class Span
+		/// Records a span from the construction until the
+		/// destruction of the Span, if tracing is enabled
+		/// when the Span is created.
+	{
+	public:
+		Span(const char* category, const char* name):
+			_category(category),
+			_name(name),
+			_start(isEnabled() ? now() : 0)
+		{
+		}
+
+		~Span()
+		{
+			if (_start) instance().record(PHASE_COMPLETE, _category, _name, _start, now() - _start);
+		}
+
+	private:
+		Span();
+		Span(const Span&);
+		Span& operator = (const Span&);
+
+		const char* _category;
+		const char* _name;
+		UInt64 _start;
+	};
+
+	static bool isEnabled()
+		/// Returns true if tracing is enabled.
+	{
+#if __cplusplus >= 201103L
+		return enabledFlag().load(std::memory_order_relaxed);
+#else
+		return enabledFlag() != 0;
+#endif
+	}
+
+	void enable()
+		/// Enables tracing.
+	{
+#if __cplusplus >= 201103L
+		enabledFlag().store(true, std::memory_order_relaxed);
+#else
+		enabledFlag() = 1;
+#endif
+	}
+
+	void disable()
+		/// Disables tracing. Spans that are open stay recorded
+		/// when they end.
+	{
+#if __cplusplus >= 201103L
+		enabledFlag().store(false, std::memory_order_relaxed);
+#else
+		enabledFlag() = 0;
+#endif
+	}
+
+	void setBufferSize(std::size_t events)
+		/// Sets the number of events kept per thread, which is rounded
+		/// up to a power of two. Only affects threads that record their
+		/// first event after the call.
+	{
+		poco_assert (events > 0);
+
+		std::size_t size = 1;
+		while (size < events) size <<= 1;
+		FastMutex::ScopedLock lock(_mutex);
+		_bufferSize = size;
+	}
+
+	std::size_t getBufferSize() const
+		/// Returns the number of events kept per thread.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _bufferSize;
+	}
+
+	static void instant(const char* category, const char* name)
+		/// Records an instant event, if tracing is enabled.
+	{
+		if (isEnabled()) instance().record(PHASE_INSTANT, category, name, now(), 0);
+	}
+
+	void record(Phase phase, const char* category, const char* name, UInt64 start, UInt64 duration)
+		/// Records an event in the calling thread's ring buffer.
+	{
+		Buffer& buffer = threadBuffer();
+		UInt64 head = load(buffer.head);
+		Record& record = buffer.records[static_cast<std::size_t>(head) & buffer.mask];
+		record.start = start;
+		record.duration = duration;
+		record.category = category;
+		record.name = name;
+		record.phase = static_cast<char>(phase);
+		publish(buffer.head, head + 1);
+	}
+
+	const char* intern(const std::string& name)
+		/// Returns a copy of the given name that stays valid
+		/// for the lifetime of the process, e.g. for the names
+		/// of bundles or services.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		return _names.insert(name).first->c_str();
+	}
+
+	void clear()
+		/// Discards all recorded events, and releases the
+		/// buffers of terminated threads.
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		std::vector<Buffer*>::iterator it = _buffers.begin();
+		while (it != _buffers.end())
+		{
+			if ((*it)->terminated)
+			{
+				delete *it;
+				it = _buffers.erase(it);
+			}
+			else
+			{
+				(*it)->cleared = acquire((*it)->head);
+				++it;
+			}
+		}
+	}
+
+	void collect(Trace& trace) const
+		/// Copies the events recorded so far into trace.
+		///
+		/// Events that are being overwritten by their thread
+		/// while they are copied are left out, as is the oldest
+		/// event of a full buffer, whose slot the thread may be
+		/// writing to.
+	{
+		trace.pid = static_cast<UInt64>(Process::id());
+		trace.strings.clear();
+		trace.threads.clear();
+		std::map<std::string, UInt32> indexes;
+		FastMutex::ScopedLock lock(_mutex);
+		for (std::vector<Buffer*>::const_iterator it = _buffers.begin(); it != _buffers.end(); ++it)
+		{
+			const Buffer& buffer = **it;
+			UInt64 capacity = buffer.mask + 1;
+			UInt64 end = acquire(buffer.head);
+			UInt64 begin = end > capacity ? end - capacity : 0;
+			if (begin < buffer.cleared) begin = buffer.cleared;
+			std::vector<Record> records;
+			records.reserve(static_cast<std::size_t>(end - begin));
+			for (UInt64 i = begin; i < end; ++i)
+			{
+				records.push_back(buffer.records[static_cast<std::size_t>(i) & buffer.mask]);
+			}
+			UInt64 after = acquire(buffer.head);
+			UInt64 valid = after >= capacity ? after + 1 - capacity : 0; // the slot of record after may be being written
+			std::size_t skip = valid > begin ? static_cast<std::size_t>(valid - begin) : 0;
+			if (skip > records.size()) skip = records.size();
+			if (records.size() == skip) continue;
+
+			trace.threads.push_back(ThreadTrace());
+			ThreadTrace& thread = trace.threads.back();
+			thread.tid = buffer.tid;
+			thread.name = buffer.name;
+			thread.events.reserve(records.size() - skip);
+			for (std::vector<Record>::const_iterator itR = records.begin() + skip; itR != records.end(); ++itR)
+			{
+				Event event;
+				event.start = itR->start;
+				event.duration = itR->duration;
+				event.category = index(itR->category, indexes, trace.strings);
+				event.name = index(itR->name, indexes, trace.strings);
+				event.phase = itR->phase;
+				thread.events.push_back(event);
+			}
+		}
+	}
+
+	void save(const std::string& path, Format format = FORMAT_BINARY) const
+		/// Collects the recorded events and writes them
+		/// to the file with the given path.
+	{
+		Trace trace;
+		collect(trace);
+		Poco::FileOutputStream ostr(path, std::ios::out | std::ios::trunc | std::ios::binary);
+		if (format == FORMAT_JSON)
+			writeJSON(trace, ostr);
+		else
+			write(trace, ostr);
+		ostr.close();
+	}
+
+	static void write(const Trace& trace, std::ostream& ostr)
+		/// Writes the trace in binary format. All numbers are
+		/// written in little endian byte order:
+		///
+		///     "PTRC" version:UInt32 pid:UInt64
+		///     stringCount:UInt32 { length:UInt32 bytes }
+		///     threadCount:UInt32 { tid:UInt64 length:UInt32 name eventCount:UInt32
+		///         { start:UInt64 duration:UInt64 category:UInt32 name:UInt32 phase:UInt8 } }
+	{
+		BinaryWriter writer(ostr, BinaryWriter::LITTLE_ENDIAN_BYTE_ORDER);
+		writer.writeRaw("PTRC", 4);
+		writer << static_cast<UInt32>(FORMAT_VERSION) << trace.pid;
+		writer << static_cast<UInt32>(trace.strings.size());
+		for (std::vector<std::string>::const_iterator it = trace.strings.begin(); it != trace.strings.end(); ++it)
+		{
+			writeString(writer, *it);
+		}
+		writer << static_cast<UInt32>(trace.threads.size());
+		for (std::vector<ThreadTrace>::const_iterator it = trace.threads.begin(); it != trace.threads.end(); ++it)
+		{
+			writer << it->tid;
+			writeString(writer, it->name);
+			writer << static_cast<UInt32>(it->events.size());
+			for (std::vector<Event>::const_iterator itE = it->events.begin(); itE != it->events.end(); ++itE)
+			{
+				writer << itE->start << itE->duration << itE->category << itE->name << static_cast<UInt8>(itE->phase);
+			}
+		}
+		writer.flush();
+	}
+
+	static void read(std::istream& istr, Trace& trace)
+		/// Reads a trace written by write().
+		///
+		/// Throws a DataFormatException if the stream does
+		/// not contain a valid trace.
+	{
+		BinaryReader reader(istr, BinaryReader::LITTLE_ENDIAN_BYTE_ORDER);
+		std::string magic;
+		reader.readRaw(4, magic);
+		UInt32 version = 0;
+		reader >> version;
+		if (magic != "PTRC" || version != FORMAT_VERSION) throw DataFormatException("not a trace");
+		reader >> trace.pid;
+		UInt32 stringCount = 0;
+		reader >> stringCount;
+		trace.strings.clear();
+		for (UInt32 i = 0; i < stringCount && reader.good(); ++i)
+		{
+			trace.strings.push_back(readString(reader));
+		}
+		UInt32 threadCount = 0;
+		reader >> threadCount;
+		trace.threads.clear();
+		for (UInt32 i = 0; i < threadCount && reader.good(); ++i)
+		{
+			trace.threads.push_back(ThreadTrace());
+			ThreadTrace& thread = trace.threads.back();
+			reader >> thread.tid;
+			thread.name = readString(reader);
+			UInt32 eventCount = 0;
+			reader >> eventCount;
+			for (UInt32 k = 0; k < eventCount && reader.good(); ++k)
+			{
+				Event event;
+				UInt8 phase = 0;
+				reader >> event.start >> event.duration >> event.category >> event.name >> phase;
+				event.phase = static_cast<char>(phase);
+				if (event.category >= stringCount || event.name >= stringCount) throw DataFormatException("invalid string index in trace");
+				thread.events.push_back(event);
+			}
+		}
+		if (!reader.good()) throw DataFormatException("truncated trace");
+	}
+
+	static void writeJSON(const Trace& trace, std::ostream& ostr)
+		/// Writes the trace in the JSON trace event format.
+		/// Times are given in microseconds, relative to the
+		/// earliest event.
+	{
+		UInt64 origin = 0;
+		bool first = true;
+		for (std::vector<ThreadTrace>::const_iterator it = trace.threads.begin(); it != trace.threads.end(); ++it)
+		{
+			for (std::vector<Event>::const_iterator itE = it->events.begin(); itE != it->events.end(); ++itE)
+			{
+				if (first || itE->start < origin) origin = itE->start;
+				first = false;
+			}
+		}
+
+		ostr << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		first = true;
+		for (std::vector<ThreadTrace>::const_iterator it = trace.threads.begin(); it != trace.threads.end(); ++it)
+		{
+			if (!first) ostr << ',';
+			first = false;
+			ostr << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << trace.pid << ",\"tid\":" << it->tid << ",\"args\":{\"name\":";
+			writeJSONString(it->name, ostr);
+			ostr << "}}";
+			for (std::vector<Event>::const_iterator itE = it->events.begin(); itE != it->events.end(); ++itE)
+			{
+				ostr << ",\n{\"ph\":\"" << itE->phase << "\",\"cat\":";
+				writeJSONString(stringAt(trace, itE->category), ostr);
+				ostr << ",\"name\":";
+				writeJSONString(stringAt(trace, itE->name), ostr);
+				ostr << ",\"pid\":" << trace.pid << ",\"tid\":" << it->tid << ",\"ts\":";
+				writeMicroseconds(itE->start - origin, ostr);
+				if (itE->phase == PHASE_COMPLETE)
+				{
+					ostr << ",\"dur\":";
+					writeMicroseconds(itE->duration, ostr);
+				}
+				else
+				{
+					ostr << ",\"s\":\"t\"";
+				}
+				ostr << '}';
+			}
+		}
+		ostr << "\n]}\n";
+	}
+
+	static UInt64 now()
+		/// Returns the value of a monotonic clock, in nanoseconds.
+	{
+#if defined(POCO_OS_FAMILY_UNIX)
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<UInt64>(ts.tv_sec)*1000000000 + static_cast<UInt64>(ts.tv_nsec);
+#else
+		return static_cast<UInt64>(Poco::Clock().raw())*1000;
+#endif
+	}
+
+	static Tracer& instance()
+		/// Returns the Tracer.
+	{
+		// never destroyed, as threads may record during static destruction
+		static Tracer* pInstance = new Tracer;
+		return *pInstance;
+	}
+
+private:
+	enum
+	{
+		FORMAT_VERSION = 1
+	};
+
+#if __cplusplus >= 201103L
+	typedef std::atomic<UInt64> Head;
+
+	static UInt64 load(const Head& head)
+	{
+		return head.load(std::memory_order_relaxed);
+	}
+
+	static UInt64 acquire(const Head& head)
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return head.load(std::memory_order_acquire);
+	}
+
+	static void publish(Head& head, UInt64 value)
+	{
+		head.store(value, std::memory_order_release);
+	}
+
+	static std::atomic<bool>& enabledFlag()
+	{
+		static std::atomic<bool> flag(false);
+		return flag;
+	}
+#else
+	typedef volatile UInt64 Head;
+
+	static UInt64 load(const Head& head)
+	{
+		return head;
+	}
+
+	static UInt64 acquire(const Head& head)
+	{
+		__sync_synchronize();
+		UInt64 value = head;
+		__sync_synchronize();
+		return value;
+	}
+
+	static void publish(Head& head, UInt64 value)
+	{
+		__sync_synchronize();
+		head = value;
+	}
+
+	static volatile int& enabledFlag()
+	{
+		static volatile int flag = 0;
+		return flag;
+	}
+#endif
+
+	struct Record
+	{
+		UInt64 start;
+		UInt64 duration;
+		const char* category;
+		const char* name;
+		char phase;
+	};
+
+	struct Buffer
+		/// The ring buffer of one thread. Only the owning
+		/// thread writes records and advances head.
+	{
+		Buffer(std::size_t size, UInt64 threadId, const std::string& threadName):
+			records(size),
+			mask(size - 1),
+			head(0),
+			cleared(0),
+			tid(threadId),
+			name(threadName),
+			terminated(false)
+		{
+		}
+
+		std::vector<Record> records;
+		std::size_t mask;
+		Head head;
+		UInt64 cleared;
+		UInt64 tid;
+		std::string name;
+		bool terminated;
+	};
+
+#if __cplusplus < 201103L
+	struct Holder
+	{
+		Holder():
+			pBuffer(0)
+		{
+		}
+
+		~Holder()
+		{
+			if (pBuffer) instance().detach(pBuffer);
+		}
+
+		Buffer* pBuffer;
+	};
+#else
+	struct Cleanup
+	{
+		~Cleanup()
+		{
+			Buffer*& pBuffer = threadBufferPointer();
+			Buffer* pDone = pBuffer;
+			pBuffer = 0;
+			if (pDone) instance().detach(pDone);
+		}
+	};
+
+	static Buffer*& threadBufferPointer()
+	{
+		static thread_local Buffer* pBuffer = 0;
+		return pBuffer;
+	}
+#endif
+
+	Tracer():
+		_bufferSize(DEFAULT_BUFFER_SIZE)
+	{
+	}
+
+	~Tracer()
+	{
+	}
+
+	static Buffer& threadBuffer()
+	{
+#if __cplusplus >= 201103L
+		Buffer*& pBuffer = threadBufferPointer();
+		if (!pBuffer)
+		{
+			pBuffer = instance().attach();
+			static thread_local Cleanup cleanup;
+		}
+		return *pBuffer;
+#else
+		static Poco::FastThreadLocal<Holder> holder;
+		Buffer*& pBuffer = holder->pBuffer;
+		if (!pBuffer) pBuffer = instance().attach();
+		return *pBuffer;
+#endif
+	}
+
+	Buffer* attach()
+	{
+		Thread* pThread = Thread::current();
+		std::string name(pThread ? pThread->getName() : std::string());
+#if defined(__linux__)
+		UInt64 tid = static_cast<UInt64>(syscall(SYS_gettid));
+#else
+		UInt64 tid = static_cast<UInt64>(pThread ? pThread->id() : 0);
+#endif
+		FastMutex::ScopedLock lock(_mutex);
+		Buffer* pBuffer = new Buffer(_bufferSize, tid, name);
+		_buffers.push_back(pBuffer);
+		return pBuffer;
+	}
+
+	void detach(Buffer* pBuffer)
+		/// Keeps the events of a terminating thread until clear().
+	{
+		FastMutex::ScopedLock lock(_mutex);
+		pBuffer->terminated = true;
+	}
+
+	static UInt32 index(const char* str, std::map<std::string, UInt32>& indexes, std::vector<std::string>& strings)
+	{
+		std::string s(str ? str : "");
+		std::map<std::string, UInt32>::const_iterator it = indexes.find(s);
+		if (it != indexes.end()) return it->second;
+		UInt32 i = static_cast<UInt32>(strings.size());
+		indexes[s] = i;
+		strings.push_back(s);
+		return i;
+	}
+
+	static const std::string& stringAt(const Trace& trace, UInt32 index)
+	{
+		static const std::string empty;
+		return index < trace.strings.size() ? trace.strings[index] : empty;
+	}
+
+	static void writeString(BinaryWriter& writer, const std::string& str)
+	{
+		writer << static_cast<UInt32>(str.size());
+		writer.writeRaw(str);
+	}
+
+	static std::string readString(BinaryReader& reader)
+	{
+		UInt32 length = 0;
+		reader >> length;
+		std::string str;
+		if (length > MAX_STRING_LENGTH) throw DataFormatException("invalid string length in trace");
+		reader.readRaw(length, str);
+		return str;
+	}
+
+	static void writeJSONString(const std::string& str, std::ostream& ostr)
+	{
+		ostr << '"';
+		for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+		{
+			unsigned char c = static_cast<unsigned char>(*it);
+			if (c == '"' || c == '\\')
+			{
+				ostr << '\\' << *it;
+			}
+			else if (c < 0x20)
+			{
+				char buffer[8];
+				std::sprintf(buffer, "\\u%04x", c);
+				ostr << buffer;
+			}
+			else
+			{
+				ostr << *it;
+			}
+		}
+		ostr << '"';
+	}
+
+	static void writeMicroseconds(UInt64 ns, std::ostream& ostr)
+	{
+		char buffer[8];
+		std::sprintf(buffer, ".%03u", static_cast<unsigned>(ns % 1000));
+		ostr << ns/1000 << buffer;
+	}
+
+	enum
+	{
+		MAX_STRING_LENGTH = 65536
+	};
+
+	Tracer(const Tracer&);
+	Tracer& operator = (const Tracer&);
+
+	std::size_t _bufferSize;
+	std::vector<Buffer*> _buffers;
+	std::set<std::string> _names;
+	mutable FastMutex _mutex;
+};
+
+
+} // namespace Poco
+
+
+#if !defined(POCO_NO_TRACING)
+	#define POCO_TRACE_JOIN_(a, b) a##b
+	#define POCO_TRACE_JOIN(a, b) POCO_TRACE_JOIN_(a, b)
+	#define poco_trace_scope(category, name) \
+		Poco::Tracer::Span POCO_TRACE_JOIN(pocoTraceSpan, __LINE__)(category, name)
+	#define poco_trace_instant(category, name) \
+		Poco::Tracer::instant(category, name)
+#else
+	#define poco_trace_scope(category, name)
+	#define poco_trace_instant(category, name)
+#endif
+
+
+#endif // Foundation_Tracer_INCLUDED
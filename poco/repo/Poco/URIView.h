@@ -0,0 +1,414 @@
+//
+// URIView.h
+//
+// $Id$
+//
+// Library: Foundation
+// Package: URI
+// Module:  URIView
+//
+// Definition of the URIView class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Foundation_URIView_INCLUDED
+#define Foundation_URIView_INCLUDED
+
+
+#include "Poco/Foundation.h"
+#include "Poco/URI.h"
+#include "Poco/Exception.h"
+#include <cstring>
+#include <string>
+
+
+namespace Poco {
+
+
+class URIView
+	/// URIView splits a URI into its components, like URI, but
+	/// without copying, decoding or normalizing them. Every component
+	/// refers to the characters of the original string, which must
+	/// therefore outlive the URIView. Decoding of percent-encoded
+	/// characters is only done on request, with Component::decoded().
+	///
+	/// URIView is meant for code that looks at the parts of a URI
+	/// for every request, e.g. to find an object by its path or a
+	/// connection by its scheme, host and port, where constructing a
+	/// URI (and its strings) would cost more than the actual work:
+	///
+	///     Poco::URIView uri(objectURI);
+	///     if (uri.scheme() == "remoting.tcp" && uri.port() == 7777) ...
+	///
+	/// The syntax accepted is the one of RFC 3986. Scheme and host are
+	/// not converted to lowercase, but compareIgnoreCase() can be
+	/// used for them.
+{
+public:
+	class Component
+		/// A component of a URI, i.e. a sequence of characters
+		/// in the string given to the URIView.
+	{
+	public:
+		Component():
+			_data(0),
+			_size(0)
+		{
+		}
+
+		Component(const char* data, std::size_t size):
+			_data(data),
+			_size(size)
+		{
+		}
+
+		const char* data() const
+			/// Returns a pointer to the first character,
+			/// which is not zero-terminated.
+		{
+			return _data;
+		}
+
+		std::size_t size() const
+		{
+			return _size;
+		}
+
+		bool empty() const
+		{
+			return _size == 0;
+		}
+
+		std::string str() const
+			/// Returns the component as it appears in the URI.
+		{
+			return std::string(_data ? _data : "", _size);
+		}
+
+		std::string decoded(bool plusAsSpace = false) const
+			/// Returns the component with percent-encoded
+			/// characters decoded, like URI does.
+		{
+			std::string result;
+			if (_size > 0 && (std::memchr(_data, '%', _size) || (plusAsSpace && std::memchr(_data, '+', _size))))
+				URI::decode(str(), result, plusAsSpace);
+			else
+				result.assign(_data ? _data : "", _size);
+			return result;
+		}
+
+		bool equals(const char* str, std::size_t length) const
+		{
+			return _size == length && (length == 0 || std::memcmp(_data, str, length) == 0);
+		}
+
+		bool operator == (const std::string& str) const
+		{
+			return equals(str.data(), str.size());
+		}
+
+		bool operator != (const std::string& str) const
+		{
+			return !equals(str.data(), str.size());
+		}
+
+		bool operator == (const char* str) const
+		{
+			return equals(str, std::strlen(str));
+		}
+
+		bool operator != (const char* str) const
+		{
+			return !equals(str, std::strlen(str));
+		}
+
+		bool compareIgnoreCase(const char* str, std::size_t length) const
+			/// Returns true if the component is equal to str,
+			/// ignoring the case of ASCII letters.
+		{
+			if (_size != length) return false;
+			for (std::size_t i = 0; i < _size; ++i)
+			{
+				if (toLower(_data[i]) != toLower(str[i])) return false;
+			}
+			return true;
+		}
+
+		bool compareIgnoreCase(const std::string& str) const
+		{
+			return compareIgnoreCase(str.data(), str.size());
+		}
+
+		bool startsWith(const std::string& prefix) const
+		{
+			return _size >= prefix.size() && (prefix.empty() || std::memcmp(_data, prefix.data(), prefix.size()) == 0);
+		}
+
+	private:
+		static char toLower(char c)
+		{
+			return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+		}
+
+		const char* _data;
+		std::size_t _size;
+	};
+
+	URIView():
+		_pData(0),
+		_size(0),
+		_port(0)
+		/// Creates an empty URIView.
+	{
+	}
+
+	explicit URIView(const std::string& uri):
+		_pData(0),
+		_size(0),
+		_port(0)
+		/// Creates a URIView for the given URI, which must not
+		/// be changed or destroyed while the URIView is in use.
+		///
+		/// Throws a SyntaxException if the port number is invalid.
+	{
+		parse(uri.data(), uri.size());
+	}
+
+	URIView(const char* uri, std::size_t length):
+		_pData(0),
+		_size(0),
+		_port(0)
+		/// Creates a URIView for the given characters, which must
+		/// not be changed or destroyed while the URIView is in use.
+		///
+		/// Throws a SyntaxException if the port number is invalid.
+	{
+		parse(uri, length);
+	}
+
+	void parse(const char* uri, std::size_t length)
+		/// Splits the given characters into the components of a URI.
+		///
+		/// Throws a SyntaxException if the port number is invalid.
+	{
+		_pData = uri;
+		_size = length;
+		_scheme = _authority = _userInfo = _host = _path = _query = _fragment = Component();
+		_port = 0;
+
+		const char* it = uri;
+		const char* end = uri + length;
+		if (it != end && isAlpha(*it))
+		{
+			const char* p = it + 1;
+			while (p != end && (isAlpha(*p) || (*p >= '0' && *p <= '9') || *p == '+' || *p == '-' || *p == '.')) ++p;
+			if (p != end && *p == ':')
+			{
+				_scheme = Component(it, p - it);
+				it = p + 1;
+			}
+		}
+		if (end - it >= 2 && it[0] == '/' && it[1] == '/')
+		{
+			it += 2;
+			const char* p = it;
+			while (p != end && *p != '/' && *p != '?' && *p != '#') ++p;
+			_authority = Component(it, p - it);
+			parseAuthority(it, p);
+			it = p;
+		}
+		const char* p = it;
+		while (p != end && *p != '?' && *p != '#') ++p;
+		_path = Component(it, p - it);
+		it = p;
+		if (it != end && *it == '?')
+		{
+			++p;
+			while (p != end && *p != '#') ++p;
+			_query = Component(it + 1, p - it - 1);
+			it = p;
+		}
+		if (it != end)
+		{
+			_fragment = Component(it + 1, end - it - 1);
+		}
+	}
+
+	const Component& scheme() const
+		/// Returns the scheme, without the colon.
+	{
+		return _scheme;
+	}
+
+	const Component& authority() const
+		/// Returns the authority, i.e. user info, host and port.
+	{
+		return _authority;
+	}
+
+	const Component& userInfo() const
+		/// Returns the user info, without the '@'.
+	{
+		return _userInfo;
+	}
+
+	const Component& host() const
+		/// Returns the host. An IPv6 address is
+		/// returned without the square brackets.
+	{
+		return _host;
+	}
+
+	unsigned short port() const
+		/// Returns the port number, or the well-known port of the
+		/// scheme (as URI::getPort() does) if none is given, or 0 if
+		/// the scheme has no well-known port.
+	{
+		return _port ? _port : wellKnownPort(_scheme);
+	}
+
+	unsigned short specifiedPort() const
+		/// Returns the port number given in the URI, or 0.
+	{
+		return _port;
+	}
+
+	const Component& path() const
+		/// Returns the (encoded) path.
+	{
+		return _path;
+	}
+
+	const Component& query() const
+		/// Returns the (encoded) query, without the '?'.
+	{
+		return _query;
+	}
+
+	const Component& fragment() const
+		/// Returns the (encoded) fragment, without the '#'.
+	{
+		return _fragment;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	bool isRelative() const
+		/// Returns true if the URI has no scheme.
+	{
+		return _scheme.empty();
+	}
+
+	std::string toString() const
+		/// Returns the URI as given.
+	{
+		return std::string(_pData ? _pData : "", _size);
+	}
+
+	URI toURI() const
+		/// Parses the URI into a URI object.
+	{
+		return URI(toString());
+	}
+
+	static unsigned short wellKnownPort(const Component& scheme)
+		/// Returns the well-known port number for the
+		/// given scheme, or 0 if there is none.
+	{
+		struct WellKnown
+		{
+			const char* scheme;
+			unsigned short port;
+		};
+		static const WellKnown wellKnown[] =
+		{
+			{"ftp", 21},
+			{"ssh", 22},
+			{"telnet", 23},
+			{"http", 80},
+			{"nntp", 119},
+			{"ldap", 389},
+			{"https", 443},
+			{"rtsp", 554},
+			{"sip", 5060},
+			{"sips", 5061},
+			{"xmpp", 5222}
+		};
+		for (std::size_t i = 0; i < sizeof(wellKnown)/sizeof(wellKnown[0]); ++i)
+		{
+			if (scheme.compareIgnoreCase(wellKnown[i].scheme, std::strlen(wellKnown[i].scheme))) return wellKnown[i].port;
+		}
+		return 0;
+	}
+
+private:
+	void parseAuthority(const char* it, const char* end)
+	{
+		const char* at = end;
+		for (const char* p = it; p != end; ++p)
+		{
+			if (*p == '@') at = p;
+		}
+		if (at != end)
+		{
+			_userInfo = Component(it, at - it);
+			it = at + 1;
+		}
+		const char* portBegin = end;
+		if (it != end && *it == '[')
+		{
+			const char* p = it + 1;
+			while (p != end && *p != ']') ++p;
+			_host = Component(it + 1, p - it - 1);
+			if (p != end) ++p;
+			if (p != end && *p == ':') portBegin = p + 1;
+		}
+		else
+		{
+			const char* p = it;
+			while (p != end && *p != ':') ++p;
+			_host = Component(it, p - it);
+			if (p != end) portBegin = p + 1;
+		}
+		if (portBegin != end)
+		{
+			unsigned port = 0;
+			for (const char* p = portBegin; p != end; ++p)
+			{
+				if (*p < '0' || *p > '9' || (port = port*10 + (*p - '0')) > 65535)
+					throw SyntaxException("bad or invalid port number", std::string(portBegin, end - portBegin));
+			}
+			_port = static_cast<unsigned short>(port);
+		}
+	}
+
+	static bool isAlpha(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	const char* _pData;
+	std::size_t _size;
+	Component _scheme;
+	Component _authority;
+	Component _userInfo;
+	Component _host;
+	unsigned short _port;
+	Component _path;
+	Component _query;
+	Component _fragment;
+};
+
+
+} // namespace Poco
+
+
+#endif // Foundation_URIView_INCLUDED
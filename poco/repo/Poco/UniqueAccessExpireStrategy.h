@@ -71,7 +71,7 @@ public:
 	{
 		// the expire value defines how many millisecs in the future the
 		// value will expire, even insert negative values!
-		Timestamp expire;
+		Timestamp expire = Timestamp::fast();
 		expire += args.value().getTimeout().totalMicroseconds();
 		
 		IndexIterator it = _keyIndex.insert(std::make_pair(expire, std::make_pair(args.key(), args.value().getTimeout())));
@@ -101,7 +101,7 @@ public:
 		{
 			KeyExpire ke = it->second->second;
 			// gen new absolute expire value
-			Timestamp expire;
+			Timestamp expire = Timestamp::fast();
 			expire += ke.second.totalMicroseconds();
 			// delete old index
 			_keyIndex.erase(it->second);
@@ -122,7 +122,7 @@ public:
 		Iterator it = _keys.find(args.key());
 		if (it != _keys.end())
 		{
-			Timestamp now;
+			Timestamp now = Timestamp::fast();
 			if (it->second->first <= now)
 			{
 				args.invalidate();
@@ -138,7 +138,7 @@ public:
 		// it would like to remove!
 		// it does not remove them on its own!
 		IndexIterator it = _keyIndex.begin();
-		Timestamp now;
+		Timestamp now = Timestamp::fast();
 		while (it != _keyIndex.end() && it->first < now)
 		{
 			elemsToRemove.insert(it->second.first);
@@ -104,7 +104,7 @@ public:
 		Iterator it = _keys.find(args.key());
 		if (it != _keys.end())
 		{
-			Timestamp now;
+			Timestamp now = Timestamp::fast();
 			if (it->second->first <= now)
 			{
 				args.invalidate();
@@ -120,7 +120,7 @@ public:
 		// it would like to remove!
 		// it does not remove them on its own!
 		IndexIterator it = _keyIndex.begin();
-		Timestamp now;
+		Timestamp now = Timestamp::fast();
 		while (it != _keyIndex.end() && it->first < now)
 		{
 			elemsToRemove.insert(it->second);
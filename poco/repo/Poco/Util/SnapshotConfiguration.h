@@ -0,0 +1,385 @@
+//
+// SnapshotConfiguration.h
+//
+// $Id$
+//
+// Library: Util
+// Package: Configuration
+// Module:  SnapshotConfiguration
+//
+// Definition of the SnapshotConfiguration class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Util_SnapshotConfiguration_INCLUDED
+#define Util_SnapshotConfiguration_INCLUDED
+
+
+#include "Poco/Util/Util.h"
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/Util/LayeredConfiguration.h"
+#include "Poco/Util/PropertyFileConfiguration.h"
+#include "Poco/Util/IniFileConfiguration.h"
+#include "Poco/Util/XMLConfiguration.h"
+#include "Poco/Util/JSONConfiguration.h"
+#include "Poco/SharedMemory.h"
+#include "Poco/FileStream.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/String.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <set>
+
+
+namespace Poco {
+namespace Util {
+
+
+class SnapshotConfiguration: public AbstractConfiguration
+	/// SnapshotConfiguration is a read-only configuration stored in a
+	/// binary snapshot file. The file contains a table of all keys,
+	/// sorted, and their raw values. It is mapped into memory, and
+	/// properties are found with a binary search, without parsing
+	/// anything when the configuration is loaded.
+	///
+	/// Every snapshot records a hash of the files it has been created
+	/// from (see hash()). The load() function uses it to create a snapshot
+	/// of a set of configuration files once, and then use it as long
+	/// as the files do not change:
+	///
+	///     std::vector<std::string> files;
+	///     files.push_back("/etc/app/app.properties");
+	///     files.push_back("/etc/app/bundles.xml");
+	///     AutoPtr<AbstractConfiguration> pConfig = SnapshotConfiguration::load(files, "/var/cache/app/config.snapshot");
+	///     config().add(pConfig, PRIO_APPLICATION);
+	///
+	/// Values are stored without expanding references to other
+	/// properties (${<property>}), so these are still expanded when
+	/// read.
+	///
+	/// The snapshot file uses the byte order of the host that created it.
+	/// Snapshots created on a host with a different byte order, by a different
+	/// version of the class or from different files are rejected by load()
+	/// and replaced.
+{
+public:
+	typedef Poco::AutoPtr<SnapshotConfiguration> Ptr;
+
+	explicit SnapshotConfiguration(const std::string& path):
+		_memory(Poco::File(path), Poco::SharedMemory::AM_READ)
+		/// Maps the snapshot file with the given path.
+		///
+		/// Throws a DataFormatException if the file is not a valid
+		/// snapshot.
+	{
+		open();
+	}
+
+	Poco::UInt64 sourceHash() const
+		/// Returns the hash of the source files stored in the snapshot.
+	{
+		return _pHeader->sourceHash;
+	}
+
+	std::size_t count() const
+		/// Returns the number of properties in the snapshot.
+	{
+		return _pHeader->count;
+	}
+
+	static Poco::UInt64 hash(const std::vector<std::string>& paths)
+		/// Computes the hash identifying the given files, based on their
+		/// paths, sizes and modification times.
+	{
+		Poco::UInt64 h = FNV_OFFSET;
+		for (std::vector<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it)
+		{
+			h = hashBytes(h, it->data(), it->size() + 1);
+			Poco::File file(*it);
+			Poco::UInt64 info[2] = {0, 0};
+			if (file.exists())
+			{
+				info[0] = static_cast<Poco::UInt64>(file.getSize());
+				info[1] = static_cast<Poco::UInt64>(file.getLastModified().epochMicroseconds());
+			}
+			h = hashBytes(h, reinterpret_cast<const char*>(info), sizeof(info));
+		}
+		return h;
+	}
+
+	static void save(const AbstractConfiguration& config, Poco::UInt64 sourceHash, const std::string& path)
+		/// Writes all properties of the given configuration, with
+		/// their raw values, to a snapshot file with the given path.
+		///
+		/// The snapshot is written to a temporary file first, which
+		/// then replaces the snapshot file.
+	{
+		std::map<std::string, std::string> properties;
+		collect(config, std::string(), properties);
+
+		Header header;
+		std::memcpy(header.magic, "PSNP", 4);
+		header.version = VERSION;
+		header.byteOrder = BYTE_ORDER_MARK;
+		header.count = static_cast<Poco::UInt32>(properties.size());
+		header.sourceHash = sourceHash;
+		header.dataSize = 0;
+
+		std::vector<Entry> entries;
+		entries.reserve(properties.size());
+		for (std::map<std::string, std::string>::const_iterator it = properties.begin(); it != properties.end(); ++it)
+		{
+			Entry entry;
+			entry.keyOffset = static_cast<Poco::UInt32>(header.dataSize);
+			entry.keyLength = static_cast<Poco::UInt32>(it->first.size());
+			entry.valueOffset = entry.keyOffset + entry.keyLength;
+			entry.valueLength = static_cast<Poco::UInt32>(it->second.size());
+			header.dataSize += entry.keyLength + entry.valueLength;
+			entries.push_back(entry);
+		}
+
+		std::string tempPath(path);
+		tempPath += ".tmp";
+		{
+			Poco::FileOutputStream ostr(tempPath);
+			ostr.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			if (!entries.empty()) ostr.write(reinterpret_cast<const char*>(&entries[0]), static_cast<std::streamsize>(entries.size()*sizeof(Entry)));
+			for (std::map<std::string, std::string>::const_iterator it = properties.begin(); it != properties.end(); ++it)
+			{
+				ostr << it->first << it->second;
+			}
+			ostr.close();
+			if (!ostr.good()) throw Poco::WriteFileException(tempPath);
+		}
+		Poco::File(tempPath).renameTo(path);
+	}
+
+	static Poco::AutoPtr<AbstractConfiguration> load(const std::vector<std::string>& paths, const std::string& snapshotPath)
+		/// Returns the configuration stored in the given snapshot file,
+		/// if the snapshot is valid and has been created from the given
+		/// configuration files in their current state.
+		///
+		/// Otherwise, loads the configuration files into a
+		/// LayeredConfiguration, where properties of earlier files take
+		/// precedence, and saves a new snapshot of it. The type of
+		/// each file is determined by its extension, as in
+		/// Application::loadConfiguration(). Failure to save the snapshot is
+		/// not an error.
+	{
+		Poco::UInt64 sourceHash = hash(paths);
+		try
+		{
+			if (Poco::File(snapshotPath).exists())
+			{
+				Poco::AutoPtr<SnapshotConfiguration> pSnapshot = new SnapshotConfiguration(snapshotPath);
+				if (pSnapshot->sourceHash() == sourceHash) return pSnapshot;
+			}
+		}
+		catch (Poco::Exception&)
+		{
+		}
+
+		Poco::AutoPtr<LayeredConfiguration> pConfig = new LayeredConfiguration;
+		for (std::vector<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it)
+		{
+			pConfig->add(parse(*it), 0, false);
+		}
+		try
+		{
+			save(*pConfig, sourceHash, snapshotPath);
+		}
+		catch (Poco::Exception&)
+		{
+		}
+		return pConfig;
+	}
+
+protected:
+	enum
+	{
+		VERSION = 1,
+		BYTE_ORDER_MARK = 0x01020304
+	};
+
+	struct Header
+	{
+		char magic[4];
+		Poco::UInt32 version;
+		Poco::UInt32 byteOrder;
+		Poco::UInt32 count;
+		Poco::UInt64 sourceHash;
+		Poco::UInt64 dataSize;
+	};
+
+	struct Entry
+		/// Offsets are relative to the start of the string data,
+		/// which follows the entries.
+	{
+		Poco::UInt32 keyOffset;
+		Poco::UInt32 keyLength;
+		Poco::UInt32 valueOffset;
+		Poco::UInt32 valueLength;
+	};
+
+	bool getRaw(const std::string& key, std::string& value) const
+	{
+		const Entry* pEntry = find(key);
+		if (pEntry != _pEnd && compare(*pEntry, key.data(), key.size()) == 0)
+		{
+			value.assign(_pData + pEntry->valueOffset, pEntry->valueLength);
+			return true;
+		}
+		return false;
+	}
+
+	void setRaw(const std::string& key, const std::string&)
+	{
+		throw Poco::InvalidAccessException("Attempt to modify a configuration snapshot", key);
+	}
+
+	void removeRaw(const std::string& key)
+	{
+		throw Poco::InvalidAccessException("Attempt to modify a configuration snapshot", key);
+	}
+
+	void enumerate(const std::string& key, Keys& range) const
+	{
+		std::string prefix(key);
+		if (!prefix.empty()) prefix += '.';
+		std::set<std::string> keys;
+		for (const Entry* pEntry = find(prefix); pEntry != _pEnd; ++pEntry)
+		{
+			const char* pKey = _pData + pEntry->keyOffset;
+			if (pEntry->keyLength < prefix.size() || std::memcmp(pKey, prefix.data(), prefix.size()) != 0) break;
+			const char* pBegin = pKey + prefix.size();
+			const char* pEnd = pKey + pEntry->keyLength;
+			const char* pDot = std::find(pBegin, pEnd, '.');
+			if (pDot != pBegin && keys.insert(std::string(pBegin, pDot)).second)
+			{
+				range.push_back(std::string(pBegin, pDot));
+			}
+		}
+	}
+
+	void open()
+	{
+		std::size_t size = static_cast<std::size_t>(_memory.end() - _memory.begin());
+		if (size < sizeof(Header)) throw Poco::DataFormatException("Configuration snapshot too short");
+		_pHeader = reinterpret_cast<const Header*>(_memory.begin());
+		if (std::memcmp(_pHeader->magic, "PSNP", 4) != 0 || _pHeader->version != VERSION || _pHeader->byteOrder != BYTE_ORDER_MARK)
+			throw Poco::DataFormatException("Not a configuration snapshot");
+		const Poco::UInt64 entriesSize = static_cast<Poco::UInt64>(_pHeader->count)*sizeof(Entry);
+		if (size != sizeof(Header) + entriesSize + _pHeader->dataSize)
+			throw Poco::DataFormatException("Configuration snapshot has invalid size");
+		_pBegin = reinterpret_cast<const Entry*>(_memory.begin() + sizeof(Header));
+		_pEnd = _pBegin + _pHeader->count;
+		_pData = reinterpret_cast<const char*>(_pEnd);
+		for (const Entry* pEntry = _pBegin; pEntry != _pEnd; ++pEntry)
+		{
+			if (static_cast<Poco::UInt64>(pEntry->keyOffset) + pEntry->keyLength > _pHeader->dataSize ||
+			    static_cast<Poco::UInt64>(pEntry->valueOffset) + pEntry->valueLength > _pHeader->dataSize)
+				throw Poco::DataFormatException("Configuration snapshot has invalid entry");
+		}
+	}
+
+	const Entry* find(const std::string& key) const
+		/// Returns the first entry with a key not less than key.
+	{
+		const Entry* pFirst = _pBegin;
+		std::size_t n = static_cast<std::size_t>(_pEnd - _pBegin);
+		while (n > 0)
+		{
+			std::size_t half = n/2;
+			const Entry* pMiddle = pFirst + half;
+			if (compare(*pMiddle, key.data(), key.size()) < 0)
+			{
+				pFirst = pMiddle + 1;
+				n -= half + 1;
+			}
+			else n = half;
+		}
+		return pFirst;
+	}
+
+	int compare(const Entry& entry, const char* key, std::size_t length) const
+	{
+		std::size_t n = entry.keyLength < length ? entry.keyLength : length;
+		int rc = std::memcmp(_pData + entry.keyOffset, key, n);
+		if (rc != 0) return rc;
+		if (entry.keyLength < length) return -1;
+		return entry.keyLength > length ? 1 : 0;
+	}
+
+	static void collect(const AbstractConfiguration& config, const std::string& key, std::map<std::string, std::string>& properties)
+	{
+		Keys keys;
+		config.keys(key, keys);
+		for (Keys::const_iterator it = keys.begin(); it != keys.end(); ++it)
+		{
+			std::string fullKey(key);
+			if (!fullKey.empty()) fullKey += '.';
+			fullKey += *it;
+			if (properties.find(fullKey) != properties.end()) continue;
+			if (config.hasProperty(fullKey)) properties[fullKey] = config.getRawString(fullKey);
+			collect(config, fullKey, properties);
+		}
+	}
+
+	static AbstractConfiguration* parse(const std::string& path)
+	{
+		std::string ext = Poco::toLower(Poco::Path(path).getExtension());
+		if (ext == "properties")
+			return new PropertyFileConfiguration(path);
+		else if (ext == "ini")
+			return new IniFileConfiguration(path);
+		else if (ext == "xml")
+			return new XMLConfiguration(path);
+		else if (ext == "json")
+			return new JSONConfiguration(path);
+		else
+			throw Poco::InvalidArgumentException("Unsupported configuration file type", ext);
+	}
+
+	static Poco::UInt64 hashBytes(Poco::UInt64 h, const char* data, std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			h ^= static_cast<unsigned char>(data[i]);
+			h *= FNV_PRIME;
+		}
+		return h;
+	}
+
+	~SnapshotConfiguration()
+	{
+	}
+
+private:
+	SnapshotConfiguration(const SnapshotConfiguration&);
+	SnapshotConfiguration& operator = (const SnapshotConfiguration&);
+
+	static const Poco::UInt64 FNV_OFFSET = 14695981039346656037ULL;
+	static const Poco::UInt64 FNV_PRIME = 1099511628211ULL;
+
+	Poco::SharedMemory _memory;
+	const Header* _pHeader;
+	const Entry* _pBegin;
+	const Entry* _pEnd;
+	const char* _pData;
+};
+
+
+} } // namespace Poco::Util
+
+
+#endif // Util_SnapshotConfiguration_INCLUDED
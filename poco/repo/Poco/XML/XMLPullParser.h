@@ -0,0 +1,651 @@
+//
+// XMLPullParser.h
+//
+// $Id$
+//
+// Library: XML
+// Package: XML
+// Module:  XMLPullParser
+//
+// Definition of the XMLPullParser class.
+//
+// Copyright (c) 2004-2006, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef XML_XMLPullParser_INCLUDED
+#define XML_XMLPullParser_INCLUDED
+
+
+#include "Poco/XML/XML.h"
+#if defined(POCO_UNBUNDLED)
+#include <expat.h>
+#else
+#include "Poco/XML/expat.h"
+#endif
+#include "Poco/XML/XMLString.h"
+#include "Poco/SAX/Locator.h"
+#include "Poco/SAX/SAXException.h"
+#include "Poco/Types.h"
+#include <istream>
+#include <vector>
+#include <deque>
+#include <cstring>
+
+
+#if !defined(XML_UNICODE)
+
+
+namespace Poco {
+namespace XML {
+
+
+class XMLPullParser: public Locator
+	/// XMLPullParser is a pull parser based on Expat. Instead of calling
+	/// handler objects, like SAXParser does, it returns one token at a
+	/// time from next(), so that the application drives the parser:
+	///
+	///     XMLPullParser parser(istr);
+	///     while (parser.next() != XMLPullParser::END_DOCUMENT)
+	///     {
+	///         if (parser.token() == XMLPullParser::START_ELEMENT && parser.name().localName() == "bundle")
+	///         {
+	///             const char* id = parser.attributeValue("id");
+	///             ...
+	///         }
+	///     }
+	///
+	/// Expat is suspended after every event and resumed by the following
+	/// next() call. Consecutive character data are returned as a single
+	/// CHARACTERS token.
+	///
+	/// Element and attribute names are interned: name() and attributeName()
+	/// return references to Name objects that are created once per distinct
+	/// name and stay valid as long as the parser, so they can be compared by
+	/// address. Attribute values, character data and comments are returned
+	/// as pointers into buffers that are reused for every token, so that
+	/// parsing a document does not allocate memory per element or
+	/// attribute; strings are only created if the application asks for
+	/// them. Pointers returned for a token are valid until next() is called.
+	///
+	/// The parser reads UTF-8 output from Expat and is therefore only
+	/// available if XMLChar is char (XML_UNICODE is not defined). A SAX
+	/// XMLReader based on XMLPullParser is available in XMLPullReader.
+{
+public:
+	enum Token
+	{
+		START_DOCUMENT,         /// No token has been read yet.
+		START_ELEMENT,          /// Start of an element; see name() and attribute*().
+		END_ELEMENT,            /// End of an element; see name().
+		CHARACTERS,             /// Character data; see text().
+		START_CDATA,            /// Start of a CDATA section.
+		END_CDATA,              /// End of a CDATA section.
+		PROCESSING_INSTRUCTION, /// A processing instruction; see target() and text().
+		COMMENT,                /// A comment; see text().
+		END_DOCUMENT            /// The end of the document has been reached.
+	};
+
+	class Name
+		/// An interned element or attribute name.
+	{
+	public:
+		const XMLString& namespaceURI() const
+			/// Returns the namespace URI, or an empty string.
+		{
+			return _namespaceURI;
+		}
+
+		const XMLString& localName() const
+			/// Returns the local name.
+		{
+			return _localName;
+		}
+
+		const XMLString& prefix() const
+			/// Returns the namespace prefix, or an empty string.
+		{
+			return _prefix;
+		}
+
+		const XMLString& qname() const
+			/// Returns the qualified name.
+		{
+			return _qname;
+		}
+
+	private:
+		XMLString _key;
+		Poco::UInt32 _hash;
+		XMLString _namespaceURI;
+		XMLString _localName;
+		XMLString _prefix;
+		XMLString _qname;
+
+		friend class XMLPullParser;
+	};
+
+	enum
+	{
+		BUFFER_SIZE = 16384
+	};
+
+	explicit XMLPullParser(std::istream& istr, bool namespaces = true, const XMLString& encoding = XMLString()):
+		_pInput(&istr),
+		_pBuffer(0),
+		_size(0),
+		_offset(0)
+		/// Creates the XMLPullParser for reading the document from the given
+		/// stream. If namespaces is true, namespace processing is enabled.
+		/// If encoding is given, it overrides the encoding declared in the
+		/// document.
+	{
+		init(namespaces, encoding);
+	}
+
+	XMLPullParser(const char* pBuffer, std::size_t size, bool namespaces = true, const XMLString& encoding = XMLString()):
+		_pInput(0),
+		_pBuffer(pBuffer),
+		_size(size),
+		_offset(0)
+		/// Creates the XMLPullParser for reading the document from the given
+		/// buffer, which must stay valid until the document has been parsed.
+	{
+		init(namespaces, encoding);
+	}
+
+	~XMLPullParser()
+		/// Destroys the XMLPullParser.
+	{
+		XML_ParserFree(_parser);
+	}
+
+	Token next()
+		/// Reads and returns the next token. Throws a SAXParseException
+		/// if the document is not well-formed.
+	{
+		if (_token == END_ELEMENT) _elements.pop_back();
+		if (_pendingPos == _pending.size())
+		{
+			if (_token == END_DOCUMENT) return _token;
+			_pending.clear();
+			_pendingPos = 0;
+			// Expat may report character data after the last
+			// token of a round; it belongs to the next round.
+			_text.erase(0, _textMark);
+			_textMark = 0;
+			parse();
+		}
+		_pCurrent = &_pending[_pendingPos++];
+		_token = _pCurrent->token;
+		if (_token == START_ELEMENT) _elements.push_back(_pElement);
+		return _token;
+	}
+
+	Token token() const
+		/// Returns the current token.
+	{
+		return _token;
+	}
+
+	const Name& name() const
+		/// Returns the name of the element for START_ELEMENT and END_ELEMENT.
+	{
+		poco_assert (_token == START_ELEMENT || _token == END_ELEMENT);
+
+		return *_elements.back();
+	}
+
+	int depth() const
+		/// Returns the number of open elements, including the current
+		/// element for START_ELEMENT and END_ELEMENT.
+	{
+		return static_cast<int>(_elements.size());
+	}
+
+	std::size_t attributeCount() const
+		/// Returns the number of attributes of the element for START_ELEMENT.
+	{
+		return _token == START_ELEMENT ? _attributes.size() : 0;
+	}
+
+	const Name& attributeName(std::size_t index) const
+		/// Returns the name of the attribute with the given index.
+	{
+		poco_assert (index < attributeCount());
+
+		return *_attributes[index].pName;
+	}
+
+	const char* attributeValue(std::size_t index) const
+		/// Returns the zero-terminated value of the attribute with the
+		/// given index.
+	{
+		poco_assert (index < attributeCount());
+
+		return &_values[_attributes[index].offset];
+	}
+
+	std::size_t attributeLength(std::size_t index) const
+		/// Returns the length of the value of the attribute with the given index.
+	{
+		poco_assert (index < attributeCount());
+
+		return _attributes[index].length;
+	}
+
+	bool isAttributeSpecified(std::size_t index) const
+		/// Returns true if the attribute with the given index has been
+		/// specified in the document, or false if it has been defaulted
+		/// by the DTD.
+	{
+		poco_assert (index < attributeCount());
+
+		return _attributes[index].specified;
+	}
+
+	const char* attributeValue(const XMLString& qname) const
+		/// Returns the value of the attribute with the given qualified
+		/// name, or null if the element has no such attribute.
+	{
+		for (std::size_t i = 0; i < attributeCount(); ++i)
+		{
+			if (_attributes[i].pName->_qname == qname) return attributeValue(i);
+		}
+		return 0;
+	}
+
+	const char* attributeValue(const XMLString& namespaceURI, const XMLString& localName) const
+		/// Returns the value of the attribute with the given namespace
+		/// URI and local name, or null if the element has no such attribute.
+	{
+		for (std::size_t i = 0; i < attributeCount(); ++i)
+		{
+			const Name& name = *_attributes[i].pName;
+			if (name._localName == localName && name._namespaceURI == namespaceURI) return attributeValue(i);
+		}
+		return 0;
+	}
+
+	std::size_t namespaceCount() const
+		/// Returns the number of namespace declarations of the element
+		/// for START_ELEMENT.
+	{
+		return _token == START_ELEMENT ? _namespaces.size()/2 : 0;
+	}
+
+	const XMLString& namespacePrefix(std::size_t index) const
+		/// Returns the prefix of the namespace declaration with the given
+		/// index; empty for the default namespace.
+	{
+		poco_assert (index < namespaceCount());
+
+		return _namespaces[2*index];
+	}
+
+	const XMLString& namespaceURI(std::size_t index) const
+		/// Returns the URI of the namespace declaration with the given index.
+	{
+		poco_assert (index < namespaceCount());
+
+		return _namespaces[2*index + 1];
+	}
+
+	const char* text() const
+		/// Returns the character data for CHARACTERS, the text of a COMMENT
+		/// or the data of a PROCESSING_INSTRUCTION. The text is not
+		/// zero-terminated; see textLength().
+	{
+		return _token == CHARACTERS ? _text.data() + _pCurrent->begin : _data.data();
+	}
+
+	std::size_t textLength() const
+		/// Returns the length of text().
+	{
+		return _token == CHARACTERS ? _pCurrent->end - _pCurrent->begin : _data.size();
+	}
+
+	XMLString textString() const
+		/// Returns text() as a string.
+	{
+		return XMLString(text(), textLength());
+	}
+
+	const XMLString& target() const
+		/// Returns the target of a PROCESSING_INSTRUCTION.
+	{
+		return _target;
+	}
+
+	// Locator
+	XMLString getPublicId() const
+	{
+		return XMLString();
+	}
+
+	XMLString getSystemId() const
+	{
+		return XMLString();
+	}
+
+	int getLineNumber() const
+	{
+		return static_cast<int>(XML_GetCurrentLineNumber(_parser));
+	}
+
+	int getColumnNumber() const
+	{
+		return static_cast<int>(XML_GetCurrentColumnNumber(_parser));
+	}
+
+protected:
+	struct Pending
+	{
+		Token token;
+		std::size_t begin;   /// Start of the character data in _text.
+		std::size_t end;     /// End of the character data in _text.
+	};
+
+	struct Attribute
+	{
+		const Name* pName;
+		std::size_t offset;
+		std::size_t length;
+		bool specified;
+	};
+
+	void init(bool namespaces, const XMLString& encoding)
+	{
+		_namespaceProcessing = namespaces;
+		_token = START_DOCUMENT;
+		_pendingPos = 0;
+		_pCurrent = 0;
+		_textMark = 0;
+		_haveEvent = false;
+		_suspended = false;
+		_final = false;
+		_pElement = 0;
+		const XML_Char* pEncoding = encoding.empty() ? 0 : encoding.c_str();
+		_parser = namespaces ? XML_ParserCreateNS(pEncoding, '\t') : XML_ParserCreate(pEncoding);
+		if (!_parser) throw XMLException("Cannot create Expat parser");
+		if (namespaces) XML_SetReturnNSTriplet(_parser, 1);
+		XML_SetUserData(_parser, this);
+		XML_SetElementHandler(_parser, handleStartElement, handleEndElement);
+		XML_SetCharacterDataHandler(_parser, handleCharacterData);
+		XML_SetProcessingInstructionHandler(_parser, handleProcessingInstruction);
+		XML_SetCommentHandler(_parser, handleComment);
+		XML_SetCdataSectionHandler(_parser, handleStartCdataSection, handleEndCdataSection);
+		XML_SetNamespaceDeclHandler(_parser, handleStartNamespaceDecl, 0);
+		XML_SetParamEntityParsing(_parser, XML_PARAM_ENTITY_PARSING_NEVER);
+		_buckets.resize(64, 0);
+		_values.reserve(1024);
+		_pending.reserve(4);
+	}
+
+	void parse()
+		/// Runs Expat until it has reported at least one token.
+	{
+		_haveEvent = false;
+		while (!_haveEvent)
+		{
+			XML_Status status;
+			if (_suspended)
+			{
+				_suspended = false;
+				status = XML_ResumeParser(_parser);
+			}
+			else if (_final)
+			{
+				queue(END_DOCUMENT);
+				return;
+			}
+			else
+			{
+				status = feed();
+			}
+			if (status == XML_STATUS_ERROR)
+				handleError();
+			else if (status == XML_STATUS_SUSPENDED)
+				_suspended = true;
+		}
+	}
+
+	XML_Status feed()
+		/// Passes the next chunk of input to Expat.
+	{
+		if (_pInput)
+		{
+			void* pBuffer = XML_GetBuffer(_parser, BUFFER_SIZE);
+			if (!pBuffer) handleError();
+			_pInput->read(static_cast<char*>(pBuffer), BUFFER_SIZE);
+			std::streamsize n = _pInput->gcount();
+			_final = !*_pInput;
+			return XML_ParseBuffer(_parser, static_cast<int>(n), _final);
+		}
+		else
+		{
+			const std::size_t chunk = BUFFER_SIZE;
+			std::size_t n = _size - _offset < chunk ? _size - _offset : chunk;
+			const char* pChunk = _pBuffer + _offset;
+			_offset += n;
+			_final = _offset == _size;
+			return XML_Parse(_parser, pChunk, static_cast<int>(n), _final);
+		}
+	}
+
+	void handleError()
+	{
+		XML_Error error = XML_GetErrorCode(_parser);
+		throw SAXParseException(XML_ErrorString(error), XMLString(), XMLString(), getLineNumber(), getColumnNumber());
+	}
+
+	void endEvent(Token token)
+		/// Queues the token, preceded by the collected character data,
+		/// and suspends Expat. For an empty element, Expat reports the
+		/// start and the end before it suspends.
+	{
+		if (!_haveEvent)
+		{
+			_haveEvent = true;
+			XML_StopParser(_parser, XML_TRUE);
+		}
+		queue(token);
+	}
+
+	void queue(Token token)
+		/// Queues the token, preceded by the character data collected
+		/// since the last queued token.
+	{
+		Pending pending;
+		if (_text.size() > _textMark)
+		{
+			pending.token = CHARACTERS;
+			pending.begin = _textMark;
+			pending.end = _text.size();
+			_pending.push_back(pending);
+			_textMark = _text.size();
+		}
+		pending.token = token;
+		pending.begin = pending.end = 0;
+		_pending.push_back(pending);
+	}
+
+	const Name& intern(const XML_Char* name)
+		/// Returns the interned Name for the given Expat name.
+	{
+		const std::size_t length = std::strlen(name);
+		Poco::UInt32 hash = 2166136261U;
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			hash = (hash ^ static_cast<unsigned char>(name[i]))*16777619U;
+		}
+		std::size_t mask = _buckets.size() - 1;
+		std::size_t bucket = hash & mask;
+		while (_buckets[bucket] != 0)
+		{
+			const Name& candidate = _names[_buckets[bucket] - 1];
+			if (candidate._hash == hash && candidate._key.size() == length && std::memcmp(candidate._key.data(), name, length) == 0)
+				return candidate;
+			bucket = (bucket + 1) & mask;
+		}
+
+		_names.push_back(Name());
+		Name& result = _names.back();
+		result._key.assign(name, length);
+		result._hash = hash;
+		split(result);
+		_buckets[bucket] = _names.size();
+		if (2*_names.size() > _buckets.size()) rehash();
+		return result;
+	}
+
+	void split(Name& name) const
+		/// Splits an Expat name of the form uri\tlocalName\tprefix.
+	{
+		const XMLString& key = name._key;
+		XMLString::size_type first = _namespaceProcessing ? key.find('\t') : XMLString::npos;
+		if (first == XMLString::npos)
+		{
+			name._localName = key;
+			name._qname = key;
+			return;
+		}
+		XMLString::size_type second = key.find('\t', first + 1);
+		name._namespaceURI.assign(key, 0, first);
+		if (second == XMLString::npos)
+		{
+			name._localName.assign(key, first + 1, XMLString::npos);
+			name._qname = name._localName;
+		}
+		else
+		{
+			name._localName.assign(key, first + 1, second - first - 1);
+			name._prefix.assign(key, second + 1, XMLString::npos);
+			name._qname = name._prefix;
+			name._qname += ':';
+			name._qname += name._localName;
+		}
+	}
+
+	void rehash()
+		/// Doubles the size of the name table. Buckets hold the index
+		/// of a name plus one; zero marks an empty bucket.
+	{
+		std::vector<std::size_t> buckets(2*_buckets.size(), 0);
+		std::size_t mask = buckets.size() - 1;
+		for (std::size_t i = 0; i < _names.size(); ++i)
+		{
+			std::size_t bucket = _names[i]._hash & mask;
+			while (buckets[bucket] != 0) bucket = (bucket + 1) & mask;
+			buckets[bucket] = i + 1;
+		}
+		_buckets.swap(buckets);
+	}
+
+	static void handleStartElement(void* userData, const XML_Char* name, const XML_Char** atts)
+	{
+		XMLPullParser* pThis = reinterpret_cast<XMLPullParser*>(userData);
+		pThis->_pElement = &pThis->intern(name);
+		pThis->_attributes.clear();
+		pThis->_values.clear();
+		const int specified = XML_GetSpecifiedAttributeCount(pThis->_parser);
+		for (int i = 0; atts[i]; i += 2)
+		{
+			Attribute attribute;
+			attribute.pName = &pThis->intern(atts[i]);
+			attribute.offset = pThis->_values.size();
+			attribute.length = std::strlen(atts[i + 1]);
+			attribute.specified = i < specified;
+			pThis->_values.insert(pThis->_values.end(), atts[i + 1], atts[i + 1] + attribute.length + 1);
+			pThis->_attributes.push_back(attribute);
+		}
+		pThis->_namespaces.swap(pThis->_pendingNamespaces);
+		pThis->_pendingNamespaces.clear();
+		pThis->endEvent(START_ELEMENT);
+	}
+
+	static void handleEndElement(void* userData, const XML_Char*)
+	{
+		reinterpret_cast<XMLPullParser*>(userData)->endEvent(END_ELEMENT);
+	}
+
+	static void handleCharacterData(void* userData, const XML_Char* s, int len)
+	{
+		reinterpret_cast<XMLPullParser*>(userData)->_text.append(s, len);
+	}
+
+	static void handleProcessingInstruction(void* userData, const XML_Char* target, const XML_Char* data)
+	{
+		XMLPullParser* pThis = reinterpret_cast<XMLPullParser*>(userData);
+		pThis->_target.assign(target);
+		pThis->_data.assign(data);
+		pThis->endEvent(PROCESSING_INSTRUCTION);
+	}
+
+	static void handleComment(void* userData, const XML_Char* data)
+	{
+		XMLPullParser* pThis = reinterpret_cast<XMLPullParser*>(userData);
+		pThis->_data.assign(data);
+		pThis->endEvent(COMMENT);
+	}
+
+	static void handleStartCdataSection(void* userData)
+	{
+		reinterpret_cast<XMLPullParser*>(userData)->endEvent(START_CDATA);
+	}
+
+	static void handleEndCdataSection(void* userData)
+	{
+		reinterpret_cast<XMLPullParser*>(userData)->endEvent(END_CDATA);
+	}
+
+	static void handleStartNamespaceDecl(void* userData, const XML_Char* prefix, const XML_Char* uri)
+	{
+		XMLPullParser* pThis = reinterpret_cast<XMLPullParser*>(userData);
+		pThis->_pendingNamespaces.push_back(prefix ? XMLString(prefix) : XMLString());
+		pThis->_pendingNamespaces.push_back(uri ? XMLString(uri) : XMLString());
+	}
+
+private:
+	XMLPullParser();
+	XMLPullParser(const XMLPullParser&);
+	XMLPullParser& operator = (const XMLPullParser&);
+
+	XML_Parser _parser;
+	std::istream* _pInput;
+	const char* _pBuffer;
+	std::size_t _size;
+	std::size_t _offset;
+	bool _namespaceProcessing;
+	Token _token;
+	std::vector<Pending> _pending;
+	std::size_t _pendingPos;
+	const Pending* _pCurrent;
+	std::size_t _textMark;
+	bool _haveEvent;
+	bool _suspended;
+	bool _final;
+	std::deque<Name> _names;
+	std::vector<std::size_t> _buckets;
+	std::vector<const Name*> _elements;
+	const Name* _pElement;
+	std::vector<Attribute> _attributes;
+	std::vector<char> _values;
+	std::vector<XMLString> _namespaces;
+	std::vector<XMLString> _pendingNamespaces;
+	XMLString _text;
+	XMLString _data;
+	XMLString _target;
+};
+
+
+} } // namespace Poco::XML
+
+
+#endif // !XML_UNICODE
+
+
+#endif // XML_XMLPullParser_INCLUDED
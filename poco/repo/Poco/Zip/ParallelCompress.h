@@ -0,0 +1,454 @@
+//
+// ParallelCompress.h
+//
+// $Id$
+//
+// Library: Zip
+// Package: Zip
+// Module:  ParallelCompress
+//
+// Definition of the ParallelCompress class.
+//
+// Copyright (c) 2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Zip_ParallelCompress_INCLUDED
+#define Zip_ParallelCompress_INCLUDED
+
+
+#include "Poco/Zip/Zip.h"
+#include "Poco/Zip/ZipCommon.h"
+#include "Poco/Zip/OrderedTaskRunner.h"
+#include "Poco/Zip/ZipUtil.h"
+#include "Poco/Zip/ZipException.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/FIFOEvent.h"
+#include "Poco/CRC32.h"
+#include "Poco/DateTime.h"
+#include "Poco/Path.h"
+#include "Poco/File.h"
+#include "Poco/String.h"
+#include "Poco/Exception.h"
+#if defined(POCO_OS_FAMILY_WINDOWS)
+#include "Poco/UnicodeConverter.h"
+#endif
+#if defined(POCO_UNBUNDLED)
+#include <zlib.h>
+#else
+#include "Poco/zlib.h"
+#endif
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <set>
+
+
+namespace Poco {
+namespace Zip {
+
+
+class ParallelCompress: protected OrderedTaskRunner
+	/// ParallelCompress creates a Zip file from files, like Compress,
+	/// but compresses several files at the same time, using threads
+	/// from a ThreadPool.
+	///
+	/// Files are only recorded by addFile(), addDirectory() and
+	/// addRecursive(). They are read and compressed by close(), every
+	/// file with a single read into memory and a single call to deflate,
+	/// and written to the Zip file in the order they have been added.
+	/// The Zip file is written with the C stdio functions instead of
+	/// a file stream.
+	///
+	/// The EDone event is fired for every entry when it has been written,
+	/// on the thread calling close(), in order of the entries.
+	///
+	///     ParallelCompress comp("bundle.zip");
+	///     comp.addRecursive(Poco::Path("bundle/"), ZipCommon::CM_AUTO);
+	///     comp.close();
+	///
+	/// Every file is kept in memory while it is compressed, and
+	/// archives larger than 4 GB (Zip64) are not supported. The number
+	/// of compressed files waiting to be written is limited to twice
+	/// the number of threads.
+{
+public:
+	Poco::FIFOEvent<const std::string> EDone;
+		/// Fired with the name of each entry written to the Zip file.
+
+	explicit ParallelCompress(const std::string& zipPath):
+		_zipPath(zipPath),
+		_pFile(openFile(zipPath)),
+		_offset(0)
+		/// Creates the ParallelCompress and the Zip file with the given path.
+	{
+		if (!_pFile) throw Poco::CreateFileException(zipPath);
+		_storeExtensions.insert("gif");
+		_storeExtensions.insert("jpg");
+		_storeExtensions.insert("jpeg");
+		_storeExtensions.insert("png");
+	}
+
+	~ParallelCompress()
+		/// Destroys the ParallelCompress. If close() has not been called,
+		/// the incomplete Zip file is closed, but not removed.
+	{
+		if (_pFile) std::fclose(_pFile);
+	}
+
+	void addFile(const Poco::Path& file, const Poco::Path& fileName, ZipCommon::CompressionMethod cm = ZipCommon::CM_DEFLATE, ZipCommon::CompressionLevel cl = ZipCommon::CL_MAXIMUM)
+		/// Adds a single file to the Zip file. fileName must not be a
+		/// directory name. The file must exist when close() is called.
+	{
+		if (fileName.isDirectory()) throw ZipException("Not a file: " + fileName.toString());
+		Poco::File aFile(file);
+		Entry entry;
+		entry.source = file.toString();
+		entry.name = ZipUtil::validZipEntryFileName(fileName);
+		entry.method = static_cast<Poco::UInt16>(compressionMethod(cm, fileName));
+		entry.level = compressionLevel(cl);
+		entry.lastModified = aFile.getLastModified();
+		_entries.push_back(entry);
+	}
+
+	void addDirectory(const Poco::Path& entryName, const Poco::DateTime& lastModifiedAt)
+		/// Adds a directory entry, excluding all children, to the Zip file.
+	{
+		if (entryName.toString().empty()) throw ZipException("Cannot add empty directory name");
+		Poco::Path dir(entryName);
+		dir.makeDirectory();
+		Entry entry;
+		entry.name = ZipUtil::validZipEntryFileName(dir);
+		if (entry.name.empty() || entry.name[entry.name.size() - 1] != '/') entry.name += '/';
+		entry.method = ZipCommon::CM_STORE;
+		entry.lastModified = lastModifiedAt;
+		entry.directory = true;
+		_entries.push_back(entry);
+	}
+
+	void addRecursive(const Poco::Path& entry, ZipCommon::CompressionMethod cm = ZipCommon::CM_DEFLATE, ZipCommon::CompressionLevel cl = ZipCommon::CL_MAXIMUM, bool excludeRoot = true, const Poco::Path& name = Poco::Path())
+		/// Adds a directory recursively to the Zip file, as
+		/// Compress::addRecursive() does.
+	{
+		Poco::File aFile(entry);
+		if (!aFile.isDirectory()) throw ZipException("Not a directory: " + entry.toString());
+		Poco::Path aName(name);
+		aName.makeDirectory();
+		if (!excludeRoot)
+		{
+			if (aName.depth() == 0)
+			{
+				Poco::Path tmp(entry);
+				tmp.makeAbsolute();
+				aName = Poco::Path(tmp[tmp.depth() - 1]);
+				aName.makeDirectory();
+			}
+			addDirectory(aName, aFile.getLastModified());
+		}
+
+		std::vector<std::string> children;
+		aFile.list(children);
+		for (std::vector<std::string>::const_iterator it = children.begin(); it != children.end(); ++it)
+		{
+			Poco::Path realFile(entry, *it);
+			Poco::Path renamedFile(aName, *it);
+			if (Poco::File(realFile).isDirectory())
+			{
+				realFile.makeDirectory();
+				renamedFile.makeDirectory();
+				addRecursive(realFile, cm, cl, false, renamedFile);
+			}
+			else
+			{
+				realFile.makeFile();
+				renamedFile.makeFile();
+				addFile(realFile, renamedFile, cm, cl);
+			}
+		}
+	}
+
+	void setZipComment(const std::string& comment)
+		/// Sets the Zip file comment.
+	{
+		_comment = comment;
+	}
+
+	const std::string& getZipComment() const
+		/// Returns the Zip file comment.
+	{
+		return _comment;
+	}
+
+	void setStoreExtensions(const std::set<std::string>& extensions)
+		/// Sets the file extensions for which the CM_STORE compression
+		/// method is used if CM_AUTO is specified. See
+		/// Compress::setStoreExtensions().
+	{
+		_storeExtensions.clear();
+		for (std::set<std::string>::const_iterator it = extensions.begin(); it != extensions.end(); ++it)
+		{
+			_storeExtensions.insert(Poco::toLower(*it));
+		}
+	}
+
+	const std::set<std::string>& getStoreExtensions() const
+		/// Returns the file extensions for which the CM_STORE
+		/// compression method is used if CM_AUTO is specified.
+	{
+		return _storeExtensions;
+	}
+
+	void close(Poco::ThreadPool& pool = Poco::ThreadPool::defaultPool(), int maxThreads = 4)
+		/// Compresses all files, using up to maxThreads threads from the
+		/// given pool in addition to the calling thread, writes them to
+		/// the Zip file and closes it.
+		///
+		/// Throws an exception if a file cannot be read.
+	{
+		if (!_pFile) throw Poco::IllegalStateException("Zip file already closed", _zipPath);
+		if (_entries.size() > 0xFFFF) throw ZipException("Too many entries for a Zip file", _zipPath);
+		std::size_t threads = maxThreads > 0 ? static_cast<std::size_t>(maxThreads) : 0;
+		run(_entries.size(), pool, maxThreads, 2*threads + 1);
+		writeDirectory();
+		std::FILE* pFile = _pFile;
+		_pFile = 0;
+		if (std::fclose(pFile) != 0) throw Poco::WriteFileException(_zipPath);
+	}
+
+protected:
+	enum
+	{
+		LOCAL_HEADER_SIZE = 30,
+		CENTRAL_HEADER_SIZE = 46,
+		END_OF_CENTRAL_DIR_SIZE = 22,
+		VERSION_NEEDED = 20,
+		ATTRIBUTE_DIRECTORY = 0x10
+	};
+
+	struct Entry
+	{
+		Entry():
+			method(ZipCommon::CM_STORE),
+			level(Z_DEFAULT_COMPRESSION),
+			directory(false),
+			crc(0),
+			size(0),
+			compressedSize(0),
+			offset(0)
+		{
+		}
+
+		std::string source;
+		std::string name;
+		Poco::UInt16 method;
+		int level;
+		Poco::DateTime lastModified;
+		bool directory;
+		Poco::UInt32 crc;
+		Poco::UInt32 size;
+		Poco::UInt32 compressedSize;
+		Poco::UInt32 offset;
+		std::vector<char> data;
+		std::string error;
+	};
+
+	ZipCommon::CompressionMethod compressionMethod(ZipCommon::CompressionMethod cm, const Poco::Path& fileName) const
+	{
+		if (cm == ZipCommon::CM_AUTO)
+		{
+			std::string ext = Poco::toLower(fileName.getExtension());
+			return _storeExtensions.find(ext) != _storeExtensions.end() ? ZipCommon::CM_STORE : ZipCommon::CM_DEFLATE;
+		}
+		if (cm != ZipCommon::CM_STORE && cm != ZipCommon::CM_DEFLATE) throw ZipException("Unsupported compression method");
+		return cm;
+	}
+
+	static int compressionLevel(ZipCommon::CompressionLevel cl)
+	{
+		switch (cl)
+		{
+		case ZipCommon::CL_MAXIMUM:   return Z_BEST_COMPRESSION;
+		case ZipCommon::CL_FAST:      return 3;
+		case ZipCommon::CL_SUPERFAST: return Z_BEST_SPEED;
+		default:                      return Z_DEFAULT_COMPRESSION;
+		}
+	}
+
+	void process(std::size_t index)
+	{
+		Entry& entry = _entries[index];
+		if (entry.directory) return;
+		try
+		{
+			compress(entry);
+		}
+		catch (Poco::Exception& exc)
+		{
+			entry.error = exc.displayText();
+		}
+		catch (std::exception& exc)
+		{
+			entry.error = exc.what();
+		}
+		catch (...)
+		{
+			entry.error = "unknown exception";
+		}
+	}
+
+	void complete(std::size_t index)
+	{
+		Entry& entry = _entries[index];
+		if (!entry.error.empty()) throw ZipException(entry.error, entry.source);
+
+		entry.offset = _offset;
+		char header[LOCAL_HEADER_SIZE];
+		std::memset(header, 0, sizeof(header));
+		ZipUtil::set32BitValue(0x04034b50, header, 0);
+		ZipUtil::set16BitValue(VERSION_NEEDED, header, 4);
+		ZipUtil::set16BitValue(entry.method, header, 8);
+		ZipUtil::setDateTime(entry.lastModified, header, 10, 12);
+		ZipUtil::set32BitValue(entry.crc, header, 14);
+		ZipUtil::set32BitValue(entry.compressedSize, header, 18);
+		ZipUtil::set32BitValue(entry.size, header, 22);
+		ZipUtil::set16BitValue(static_cast<Poco::UInt16>(entry.name.size()), header, 26);
+		write(header, sizeof(header));
+		write(entry.name.data(), entry.name.size());
+		if (!entry.data.empty()) write(&entry.data[0], entry.data.size());
+		std::vector<char>().swap(entry.data);
+
+		EDone.notify(this, entry.name);
+	}
+
+	void compress(Entry& entry)
+		/// Reads and compresses the source file of the entry.
+	{
+		std::vector<char> input;
+		read(entry.source, input);
+		if (input.size() > 0xFFFFFFFFu) throw ZipException("File too large for a Zip file", entry.source);
+		entry.size = static_cast<Poco::UInt32>(input.size());
+		entry.crc = Poco::CRC32::compute(Poco::CRC32::TYPE_CRC32, input.empty() ? 0 : &input[0], input.size());
+		if (entry.method == ZipCommon::CM_DEFLATE && !input.empty())
+		{
+			z_stream stream;
+			stream.zalloc = Z_NULL;
+			stream.zfree = Z_NULL;
+			stream.opaque = Z_NULL;
+			if (deflateInit2(&stream, entry.level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) throw ZipException("Cannot initialize deflater", entry.source);
+			entry.data.resize(deflateBound(&stream, static_cast<uLong>(input.size())));
+			stream.next_in = reinterpret_cast<Bytef*>(&input[0]);
+			stream.avail_in = static_cast<uInt>(input.size());
+			stream.next_out = reinterpret_cast<Bytef*>(&entry.data[0]);
+			stream.avail_out = static_cast<uInt>(entry.data.size());
+			int rc = deflate(&stream, Z_FINISH);
+			deflateEnd(&stream);
+			if (rc != Z_STREAM_END) throw ZipException("Cannot compress file", entry.source);
+			entry.data.resize(entry.data.size() - stream.avail_out);
+			// store files that do not get smaller
+			if (entry.data.size() >= input.size()) entry.method = ZipCommon::CM_STORE;
+		}
+		else entry.method = ZipCommon::CM_STORE;
+		if (entry.method == ZipCommon::CM_STORE) entry.data.swap(input);
+		entry.compressedSize = static_cast<Poco::UInt32>(entry.data.size());
+	}
+
+	void writeDirectory()
+		/// Writes the central directory and the end of
+		/// central directory record.
+	{
+		Poco::UInt64 dirOffset = _offset;
+		for (std::vector<Entry>::const_iterator it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			char header[CENTRAL_HEADER_SIZE];
+			std::memset(header, 0, sizeof(header));
+			ZipUtil::set32BitValue(0x02014b50, header, 0);
+			ZipUtil::set16BitValue(VERSION_NEEDED, header, 4);
+			ZipUtil::set16BitValue(VERSION_NEEDED, header, 6);
+			ZipUtil::set16BitValue(it->method, header, 10);
+			ZipUtil::setDateTime(it->lastModified, header, 12, 14);
+			ZipUtil::set32BitValue(it->crc, header, 16);
+			ZipUtil::set32BitValue(it->compressedSize, header, 20);
+			ZipUtil::set32BitValue(it->size, header, 24);
+			ZipUtil::set16BitValue(static_cast<Poco::UInt16>(it->name.size()), header, 28);
+			ZipUtil::set32BitValue(it->directory ? ATTRIBUTE_DIRECTORY : 0, header, 38);
+			ZipUtil::set32BitValue(it->offset, header, 42);
+			write(header, sizeof(header));
+			write(it->name.data(), it->name.size());
+		}
+		Poco::UInt64 dirSize = _offset - dirOffset;
+
+		char eocd[END_OF_CENTRAL_DIR_SIZE];
+		std::memset(eocd, 0, sizeof(eocd));
+		ZipUtil::set32BitValue(0x06054b50, eocd, 0);
+		ZipUtil::set16BitValue(static_cast<Poco::UInt16>(_entries.size()), eocd, 8);
+		ZipUtil::set16BitValue(static_cast<Poco::UInt16>(_entries.size()), eocd, 10);
+		ZipUtil::set32BitValue(static_cast<Poco::UInt32>(dirSize), eocd, 12);
+		ZipUtil::set32BitValue(static_cast<Poco::UInt32>(dirOffset), eocd, 16);
+		std::string comment(_comment, 0, 0xFFFF);
+		ZipUtil::set16BitValue(static_cast<Poco::UInt16>(comment.size()), eocd, 20);
+		write(eocd, sizeof(eocd));
+		write(comment.data(), comment.size());
+	}
+
+	void write(const char* pData, std::size_t size)
+	{
+		if (size == 0) return;
+		if (_offset + size > 0xFFFFFFFFu) throw ZipException("Zip file too large", _zipPath);
+		if (std::fwrite(pData, 1, size, _pFile) != size) throw Poco::WriteFileException(_zipPath);
+		_offset += size;
+	}
+
+	static void read(const std::string& path, std::vector<char>& data)
+		/// Reads the whole file into data, with a single read.
+	{
+		Poco::File file(path);
+		data.resize(static_cast<std::size_t>(file.getSize()));
+#if defined(POCO_OS_FAMILY_WINDOWS)
+		std::wstring upath;
+		Poco::UnicodeConverter::convert(path, upath);
+		std::FILE* pFile = _wfopen(upath.c_str(), L"rb");
+#else
+		std::FILE* pFile = std::fopen(path.c_str(), "rb");
+#endif
+		if (!pFile) throw Poco::OpenFileException(path);
+		std::setvbuf(pFile, 0, _IONBF, 0);
+		std::size_t n = data.empty() ? 0 : std::fread(&data[0], 1, data.size(), pFile);
+		bool eof = std::fgetc(pFile) == EOF;
+		std::fclose(pFile);
+		if (n != data.size() || !eof) throw Poco::ReadFileException("File changed while reading", path);
+	}
+
+	static std::FILE* openFile(const std::string& path)
+	{
+#if defined(POCO_OS_FAMILY_WINDOWS)
+		std::wstring upath;
+		Poco::UnicodeConverter::convert(path, upath);
+		std::FILE* pFile = _wfopen(upath.c_str(), L"wb");
+#else
+		std::FILE* pFile = std::fopen(path.c_str(), "wb");
+#endif
+		// entries are written in large blocks, so bypass stdio buffering
+		if (pFile) std::setvbuf(pFile, 0, _IONBF, 0);
+		return pFile;
+	}
+
+private:
+	ParallelCompress(const ParallelCompress&);
+	ParallelCompress& operator = (const ParallelCompress&);
+
+	std::string _zipPath;
+	std::FILE* _pFile;
+	Poco::UInt64 _offset;
+	std::vector<Entry> _entries;
+	std::set<std::string> _storeExtensions;
+	std::string _comment;
+};
+
+
+} } // namespace Poco::Zip
+
+
+#endif // Zip_ParallelCompress_INCLUDED
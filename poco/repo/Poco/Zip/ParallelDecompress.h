@@ -0,0 +1,430 @@
+//
+// ParallelDecompress.h
+//
+// $Id$
+//
+// Library: Zip
+// Package: Zip
+// Module:  ParallelDecompress
+//
+// Definition of the ParallelDecompress class.
+//
+// Copyright (c) 2007, Applied Informatics Software Engineering GmbH.
+// and Contributors.
+//
+// SPDX-License-Identifier:	BSL-1.0
+//
+
+
+#ifndef Zip_ParallelDecompress_INCLUDED
+#define Zip_ParallelDecompress_INCLUDED
+
+
+#include "Poco/Zip/Zip.h"
+#include "Poco/Zip/OrderedTaskRunner.h"
+#include "Poco/Zip/ZipUtil.h"
+#include "Poco/Zip/ZipException.h"
+#include "Poco/SharedMemory.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/FIFOEvent.h"
+#include "Poco/Buffer.h"
+#include "Poco/CRC32.h"
+#include "Poco/Path.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#if defined(POCO_OS_FAMILY_WINDOWS)
+#include "Poco/UnicodeConverter.h"
+#endif
+#if defined(POCO_UNBUNDLED)
+#include <zlib.h>
+#else
+#include "Poco/zlib.h"
+#endif
+#include <cstdio>
+#include <vector>
+#include <map>
+#include <set>
+
+
+namespace Poco {
+namespace Zip {
+
+
+class ParallelDecompress: protected OrderedTaskRunner
+	/// ParallelDecompress extracts all files from a Zip file, like
+	/// Decompress, but extracts several files at the same time, using
+	/// threads from a ThreadPool.
+	///
+	/// The Zip file is mapped into memory, and the entries are found
+	/// through the central directory, so that every entry can be read
+	/// independently. Stored entries are written directly from the mapped
+	/// file, deflated entries are inflated into a large buffer that is
+	/// written directly to the output file, using the C stdio functions
+	/// instead of file streams.
+	///
+	/// The EOk and EError events are fired on the thread calling
+	/// decompressAllFiles(), in order of the entries in the Zip file.
+	///
+	///     ParallelDecompress dec("bundle.zip", Poco::Path("bundles/com.acme.bundle"));
+	///     dec.decompressAllFiles();
+	///
+	/// Encrypted entries, entries that use other compression methods
+	/// than store and deflate, and Zip64 archives are not supported.
+{
+public:
+	typedef std::map<std::string, Poco::Path> ZipMapping;
+		/// Maps the names of the entries to the extracted files.
+
+	enum
+	{
+		DEFAULT_BUFFER_SIZE = 262144
+	};
+
+	Poco::FIFOEvent<std::pair<const std::string, const std::string> > EError;
+		/// Fired for every entry that could not be extracted, with
+		/// the name of the entry and an error message.
+
+	Poco::FIFOEvent<std::pair<const std::string, const Poco::Path> > EOk;
+		/// Fired for every file that has been extracted, with the name
+		/// of the entry and the path of the file.
+
+	ParallelDecompress(const std::string& zipPath, const Poco::Path& outputDir, bool flattenDirs = false, bool keepIncompleteFiles = false):
+		_memory(Poco::File(zipPath), Poco::SharedMemory::AM_READ),
+		_zipPath(zipPath),
+		_outDir(outputDir),
+		_flattenDirs(flattenDirs),
+		_keepIncompleteFiles(keepIncompleteFiles),
+		_bufferSize(DEFAULT_BUFFER_SIZE)
+		/// Creates the ParallelDecompress for the Zip file with the given
+		/// path. If outputDir does not exist, it is created.
+		/// If flattenDirs is true, all files are extracted into outputDir.
+		/// If keepIncompleteFiles is false, files that could not be
+		/// extracted completely are removed.
+	{
+		_outDir.makeDirectory();
+	}
+
+	~ParallelDecompress()
+		/// Destroys the ParallelDecompress.
+	{
+	}
+
+	void setBufferSize(std::size_t size)
+		/// Sets the size of the buffer used by each thread
+		/// for inflating and writing.
+	{
+		poco_assert (size > 0);
+
+		_bufferSize = size;
+	}
+
+	void decompressAllFiles(Poco::ThreadPool& pool = Poco::ThreadPool::defaultPool(), int maxThreads = 4)
+		/// Extracts all files, using up to maxThreads threads from the given
+		/// pool in addition to the calling thread.
+	{
+		readDirectory();
+		createDirectories();
+		run(_entries.size(), pool, maxThreads, _entries.size() > 0 ? _entries.size() : 1);
+	}
+
+	const ZipMapping& mapping() const
+		/// Maps the names of all successfully extracted files
+		/// to their paths.
+	{
+		return _mapping;
+	}
+
+protected:
+	enum
+	{
+		METHOD_STORED = 0,
+		METHOD_DEFLATED = 8
+	};
+
+	struct Entry
+	{
+		Entry():
+			method(0),
+			flags(0),
+			crc(0),
+			compressedSize(0),
+			size(0),
+			offset(0),
+			directory(false)
+		{
+		}
+
+		std::string name;
+		Poco::UInt16 method;
+		Poco::UInt16 flags;
+		Poco::UInt32 crc;
+		std::size_t compressedSize;
+		std::size_t size;
+		std::size_t offset;
+		bool directory;
+		Poco::Path path;
+		std::string error;
+	};
+
+	void readDirectory()
+	{
+		const char* pBegin = _memory.begin();
+		std::size_t size = static_cast<std::size_t>(_memory.end() - _memory.begin());
+		if (size < 22) throw ZipException("Not a Zip file", _zipPath);
+
+		// The end of central directory record is followed
+		// by a comment of up to 65535 bytes.
+		std::size_t eocd = size - 22;
+		std::size_t limit = size > 22 + 65535 ? size - 22 - 65535 : 0;
+		while (ZipUtil::get32BitValue(pBegin, static_cast<Poco::UInt32>(eocd)) != 0x06054b50)
+		{
+			if (eocd == limit) throw ZipException("No Zip central directory", _zipPath);
+			--eocd;
+		}
+		const char* pEocd = pBegin + eocd;
+		std::size_t count = ZipUtil::get16BitValue(pEocd, 10);
+		std::size_t dirSize = ZipUtil::get32BitValue(pEocd, 12);
+		std::size_t dirOffset = ZipUtil::get32BitValue(pEocd, 16);
+		if (dirOffset + dirSize > eocd) throw ZipException("Invalid Zip central directory", _zipPath);
+
+		_entries.clear();
+		_entries.reserve(count);
+		std::size_t pos = dirOffset;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const char* p = pBegin + pos;
+			if (pos + 46 > eocd || ZipUtil::get32BitValue(p, 0) != 0x02014b50) throw ZipException("Invalid Zip central directory entry", _zipPath);
+			Entry entry;
+			entry.flags = ZipUtil::get16BitValue(p, 8);
+			entry.method = ZipUtil::get16BitValue(p, 10);
+			entry.crc = ZipUtil::get32BitValue(p, 16);
+			entry.compressedSize = ZipUtil::get32BitValue(p, 20);
+			entry.size = ZipUtil::get32BitValue(p, 24);
+			std::size_t nameLength = ZipUtil::get16BitValue(p, 28);
+			std::size_t extraLength = ZipUtil::get16BitValue(p, 30);
+			std::size_t commentLength = ZipUtil::get16BitValue(p, 32);
+			std::size_t localOffset = ZipUtil::get32BitValue(p, 42);
+			if (pos + 46 + nameLength > eocd) throw ZipException("Invalid Zip central directory entry", _zipPath);
+			entry.name.assign(p + 46, nameLength);
+			entry.directory = !entry.name.empty() && (entry.name[entry.name.size() - 1] == '/' || entry.name[entry.name.size() - 1] == '\\');
+			pos += 46 + nameLength + extraLength + commentLength;
+
+			try
+			{
+				ZipUtil::verifyZipEntryFileName(entry.name);
+				if (entry.flags & 0x0001) throw ZipException("Encrypted entries are not supported", entry.name);
+				if (entry.method != METHOD_STORED && entry.method != METHOD_DEFLATED) throw ZipException("Unsupported compression method", entry.name);
+				if (localOffset + 30 > size || ZipUtil::get32BitValue(pBegin, static_cast<Poco::UInt32>(localOffset)) != 0x04034b50) throw ZipException("Invalid Zip local header", entry.name);
+				entry.offset = localOffset + 30 + ZipUtil::get16BitValue(pBegin, static_cast<Poco::UInt32>(localOffset + 26)) + ZipUtil::get16BitValue(pBegin, static_cast<Poco::UInt32>(localOffset + 28));
+				if (entry.offset + entry.compressedSize > size) throw ZipException("Invalid Zip entry size", entry.name);
+				entry.path = outputPath(entry);
+			}
+			catch (Poco::Exception& exc)
+			{
+				entry.error = exc.displayText();
+			}
+			_entries.push_back(entry);
+		}
+	}
+
+	Poco::Path outputPath(const Entry& entry) const
+	{
+		Poco::Path path(entry.name, Poco::Path::PATH_UNIX);
+		if (_flattenDirs)
+		{
+			if (entry.directory) return _outDir;
+			Poco::Path result(_outDir);
+			result.setFileName(path.getFileName());
+			return result;
+		}
+		Poco::Path result(_outDir);
+		result.append(path);
+		return result;
+	}
+
+	void createDirectories()
+		/// Creates all directories before extracting files, so that the
+		/// threads do not need to create them concurrently.
+	{
+		Poco::File(_outDir).createDirectories();
+		if (_flattenDirs) return;
+		std::set<std::string> created;
+		for (std::vector<Entry>::iterator it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			if (!it->error.empty()) continue;
+			Poco::Path dir(it->path);
+			if (!it->directory) dir.makeParent();
+			std::string dirPath = dir.toString();
+			if (created.insert(dirPath).second)
+			{
+				try
+				{
+					Poco::File(dir).createDirectories();
+				}
+				catch (Poco::Exception& exc)
+				{
+					it->error = exc.displayText();
+				}
+			}
+		}
+	}
+
+	void process(std::size_t index)
+	{
+		Entry& entry = _entries[index];
+		if (!entry.error.empty() || entry.directory) return;
+		try
+		{
+			extract(entry);
+		}
+		catch (Poco::Exception& exc)
+		{
+			entry.error = exc.displayText();
+		}
+		catch (std::exception& exc)
+		{
+			entry.error = exc.what();
+		}
+		catch (...)
+		{
+			entry.error = "unknown exception";
+		}
+		if (!entry.error.empty() && !_keepIncompleteFiles)
+		{
+			try
+			{
+				Poco::File file(entry.path);
+				if (file.exists()) file.remove();
+			}
+			catch (...)
+			{
+			}
+		}
+	}
+
+	void complete(std::size_t index)
+	{
+		Entry& entry = _entries[index];
+		if (entry.error.empty())
+		{
+			if (!entry.directory) _mapping[entry.name] = entry.path;
+			std::pair<const std::string, const Poco::Path> ok(entry.name, entry.path);
+			EOk.notify(this, ok);
+		}
+		else
+		{
+			std::pair<const std::string, const std::string> error(entry.name, entry.error);
+			EError.notify(this, error);
+		}
+	}
+
+	void extract(Entry& entry)
+	{
+		const std::string path = entry.path.toString();
+		std::FILE* pFile = openFile(path);
+		if (!pFile) throw Poco::CreateFileException(path);
+		try
+		{
+			const char* pData = _memory.begin() + entry.offset;
+			Poco::UInt32 crc;
+			if (entry.method == METHOD_STORED)
+			{
+				if (entry.compressedSize != entry.size) throw ZipException("Invalid size of stored entry", entry.name);
+				write(pFile, pData, entry.size, path);
+				crc = calculateCRC(pData, entry.size);
+			}
+			else crc = inflate(entry, pData, pFile, path);
+			if (crc != entry.crc) throw ZipException("CRC mismatch", entry.name);
+		}
+		catch (...)
+		{
+			std::fclose(pFile);
+			throw;
+		}
+		if (std::fclose(pFile) != 0) throw Poco::WriteFileException(path);
+	}
+
+	Poco::UInt32 inflate(const Entry& entry, const char* pData, std::FILE* pFile, const std::string& path)
+		/// Inflates the entry from the mapped file and writes it
+		/// to the given file. Returns the CRC of the data.
+	{
+		Poco::Buffer<char> buffer(_bufferSize);
+		z_stream stream;
+		stream.zalloc = Z_NULL;
+		stream.zfree = Z_NULL;
+		stream.opaque = Z_NULL;
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pData));
+		stream.avail_in = static_cast<uInt>(entry.compressedSize);
+		if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) throw ZipException("Cannot initialize inflater", entry.name);
+		Poco::UInt32 crc = 0;
+		std::size_t total = 0;
+		int rc = Z_OK;
+		try
+		{
+			while (rc != Z_STREAM_END)
+			{
+				stream.next_out = reinterpret_cast<Bytef*>(buffer.begin());
+				stream.avail_out = static_cast<uInt>(buffer.size());
+				rc = ::inflate(&stream, Z_NO_FLUSH);
+				if (rc != Z_OK && rc != Z_STREAM_END) throw ZipException("Invalid compressed data", entry.name);
+				std::size_t n = buffer.size() - stream.avail_out;
+				if (n == 0 && rc != Z_STREAM_END) throw ZipException("Truncated compressed data", entry.name);
+				total += n;
+				if (total > entry.size) throw ZipException("Invalid uncompressed size", entry.name);
+				crc = Poco::CRC32::compute(Poco::CRC32::TYPE_CRC32, buffer.begin(), n, crc);
+				write(pFile, buffer.begin(), n, path);
+			}
+		}
+		catch (...)
+		{
+			inflateEnd(&stream);
+			throw;
+		}
+		inflateEnd(&stream);
+		if (total != entry.size) throw ZipException("Invalid uncompressed size", entry.name);
+		return crc;
+	}
+
+	static Poco::UInt32 calculateCRC(const char* pData, std::size_t size)
+	{
+		return Poco::CRC32::compute(Poco::CRC32::TYPE_CRC32, pData, size);
+	}
+
+	static void write(std::FILE* pFile, const char* pData, std::size_t size, const std::string& path)
+	{
+		if (size > 0 && std::fwrite(pData, 1, size, pFile) != size) throw Poco::WriteFileException(path);
+	}
+
+	static std::FILE* openFile(const std::string& path)
+	{
+#if defined(POCO_OS_FAMILY_WINDOWS)
+		std::wstring upath;
+		Poco::UnicodeConverter::convert(path, upath);
+		std::FILE* pFile = _wfopen(upath.c_str(), L"wb");
+#else
+		std::FILE* pFile = std::fopen(path.c_str(), "wb");
+#endif
+		// writes are done in large blocks, so bypass stdio buffering
+		if (pFile) std::setvbuf(pFile, 0, _IONBF, 0);
+		return pFile;
+	}
+
+private:
+	ParallelDecompress(const ParallelDecompress&);
+	ParallelDecompress& operator = (const ParallelDecompress&);
+
+	Poco::SharedMemory _memory;
+	std::string _zipPath;
+	Poco::Path _outDir;
+	bool _flattenDirs;
+	bool _keepIncompleteFiles;
+	std::size_t _bufferSize;
+	std::vector<Entry> _entries;
+	ZipMapping _mapping;
+};
+
+
+} } // namespace Poco::Zip
+
+
+#endif // Zip_ParallelDecompress_INCLUDED
@@ -0,0 +1,49 @@
+/**
+ * \file
+ *         StaticBundles.h
+ * \brief
+ *         Table of the bundles linked into the monolithic OSP image (osp_static_image)
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Every bundle of the image gets one entry, with its manifest, its activator
+ * class and its resources, all embedded as constant tables. The sources of
+ * the activators are added to the image with OSP_STATIC_BUNDLE_SOURCES or
+ * OSP_STATIC_BUNDLE_LIBRARIES (see CMakeLists.txt). For example:
+ *
+ *     #include "ConnManagerBundleActivator.h"
+ *
+ *     static const char connMgrManifest[] =
+ *         "Manifest-Version: 1.0\n"
+ *         "Bundle-Name: Connection Manager\n"
+ *         "Bundle-SymbolicName: com.stellantis.connmgr\n"
+ *         "Bundle-Version: 1.0.0\n"
+ *         "Bundle-Activator: ConnManager::BundleActivator\n"
+ *         "Require-Bundle: osp.core;version=[1.0,2.0)\n";
+ *
+ *     static const Poco::OSP::StaticBundleInfo staticBundles[] =
+ *     {
+ *         POCO_OSP_STATIC_BUNDLE("com.stellantis.connmgr", connMgrManifest, ConnManager::BundleActivator, 0),
+ *         POCO_OSP_STATIC_BUNDLE_END
+ *     };
+ */
+
+#ifndef StaticBundles_INCLUDED
+#define StaticBundles_INCLUDED
+
+#include "Poco/OSP/StaticBundle.h"
+
+static const Poco::OSP::StaticBundleInfo staticBundles[] =
+{
+	POCO_OSP_STATIC_BUNDLE_END
+};
+
+#endif // StaticBundles_INCLUDED
@@ -0,0 +1,61 @@
+/**
+ * \file
+ *         StaticImage.cpp
+ * \brief
+ *         Entry point of the monolithic OSP image, with OSP and all bundles linked into one executable
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: osp_static_image [--daemon] [options]
+ *
+ * The bundles listed in StaticBundles.h are installed from their embedded
+ * manifests and resources with a StaticOSPSubsystem, and their activators
+ * are created from the factories registered at startup, so that no bundle
+ * repository is scanned, no bundle archive is extracted and no shared
+ * library is loaded. Bundles are then resolved and started by run level
+ * and dependencies, as in a dynamic build. The configuration is read
+ * from osp_static_image.properties next to the executable, if present.
+ */
+
+#include "Poco/OSP/StaticOSPSubsystem.h"
+#include "Poco/Util/ServerApplication.h"
+#include <iostream>
+#include "StaticBundles.h"
+
+#if !defined(POCO_OSP_STATIC)
+#error "osp_static_image must be built with POCO_OSP_STATIC"
+#endif
+
+
+class StaticImageApplication: public Poco::Util::ServerApplication
+{
+public:
+	StaticImageApplication()
+	{
+		addSubsystem(new Poco::OSP::StaticOSPSubsystem(staticBundles));
+	}
+
+protected:
+	void initialize(Poco::Util::Application& self)
+	{
+		loadConfiguration();
+		Poco::Util::ServerApplication::initialize(self);
+	}
+
+	int main(const std::vector<std::string>&)
+	{
+		waitForTerminationRequest();
+		return Poco::Util::Application::EXIT_OK;
+	}
+};
+
+
+POCO_SERVER_MAIN(StaticImageApplication)
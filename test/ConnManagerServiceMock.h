@@ -0,0 +1,278 @@
+/**
+ * \file
+ *         ConnManagerServiceMock.h
+ * \brief
+ *         X86 stub implementation of IConnManagerService for benchmarks and bundle tests
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef CONNMANAGERSERVICEMOCK_H
+#define CONNMANAGERSERVICEMOCK_H
+
+#include "IConnManagerService.h"
+#include "Poco/SeqLock.h"
+#include "Poco/Mutex.h"
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * ConnManagerServiceMock keeps the connectivity state in memory.
+ *
+ * The getters return the state under a mutex, as a typical implementation does.
+ * The set* methods update the state and notify the corresponding event, like the
+ * modem thread of the real service.
+ */
+class ConnManagerServiceMock : public IConnManagerService
+{
+public:
+    typedef Poco::AutoPtr<ConnManagerServiceMock> Ptr;
+
+    ConnManagerServiceMock() {}
+
+    ConMgrErrno getCellularNetworkType(ConMgrNetworkType& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.network_type;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getApnConState(ConApnName interface, bool& result)
+    {
+        if (interface < 0 || interface >= MAX_APN_COUNT) return ConMgrErr_InvalidArgument;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.apn_state[interface].available;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getApnConStates(uint32_t& mask)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        mask = apnMask();
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getCellularMCC(int& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.mcc;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getWiFiDataConState(bool& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.wifi_data_con_state;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getCellularSignalStrength(unsigned char& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.signal_strength;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getCellularModemAvailability(bool& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.modem_available;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getGsmMetrics(GsmMetrics& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.gsm;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getUmtsMetrics(UmtsMetrics& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.umts;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getLteMetrics(LteMetrics& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.lte;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getCellularNbCells(CellularNbCells& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.nb_cells;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getRegistrationStatus(RegistrationStatus& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.registration;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getCellularTime(DateTime& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.cellular_time;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getSystemTime(time_t& result)
+    {
+        result = time(0);
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getDataPathType(ConMgrDataPath& result)
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        result = _state.data_path;
+        return ConMgrErr_OK;
+    }
+
+    ConMgrErrno getConnectivitySnapshot(ConnectivitySnapshot& result)
+    {
+        _snapshot.read(result);
+        return ConMgrErr_OK;
+    }
+
+    void setLteMetrics(const LteMetrics& metrics)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            _state.lte = metrics;
+            publish();
+        }
+        onLteMetrics.notify(this, metrics);
+    }
+
+    void setUmtsMetrics(const UmtsMetrics& metrics)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            _state.umts = metrics;
+            publish();
+        }
+        onUmtsMetrics.notify(this, metrics);
+    }
+
+    void setGsmMetrics(const GsmMetrics& metrics)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            _state.gsm = metrics;
+            publish();
+        }
+        onGsmMetrics.notify(this, metrics);
+    }
+
+    void setCellularSignalStrength(unsigned char signalStrength)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            _state.signal_strength = signalStrength;
+            publish();
+        }
+        onCellularSignalStrengthChanged.notify(this, signalStrength);
+    }
+
+    void setApnConState(ConApnName interface, bool available)
+    {
+        uint32_t mask;
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            mask = apnMask();
+        }
+        if (available) mask |= ConMgrApnBit(interface);
+        else mask &= ~ConMgrApnBit(interface);
+        setApnConStates(mask);
+    }
+
+    void setApnConStates(uint32_t mask)
+    {
+        ApnConStates states;
+        states.available = mask;
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            states.changed = apnMask() ^ mask;
+            for (int i = 0; i < MAX_APN_COUNT; ++i)
+            {
+                _state.apn_state[i].available = states.isAvailable(static_cast<ConApnName>(i));
+            }
+            publish();
+        }
+        if (!states.changed) return;
+        for (int i = 0; i < MAX_APN_COUNT; ++i)
+        {
+            ConApnName interface = static_cast<ConApnName>(i);
+            if (!states.hasChanged(interface)) continue;
+            APNConnState state;
+            state.interface = interface;
+            state.available = states.isAvailable(interface);
+            onApnConStateChanged.notify(this, state);
+        }
+        onApnStatesChanged.notify(this, states);
+    }
+
+    void setRegistrationStatus(const RegistrationStatus& status)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            _state.registration = status;
+            publish();
+        }
+        onRegistrationStatusChanged.notify(this, status);
+    }
+
+    void setDataPath(ConMgrDataPath dataPath)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(_mutex);
+            _state.data_path = dataPath;
+            publish();
+        }
+        onDataPathTypeChanged.notify(this, dataPath);
+    }
+
+private:
+    uint32_t apnMask() const
+        // Called with _mutex held.
+    {
+        uint32_t mask = 0;
+        for (int i = 0; i < MAX_APN_COUNT; ++i)
+        {
+            if (_state.apn_state[i].available) mask |= ConMgrApnBit(static_cast<ConApnName>(i));
+        }
+        return mask;
+    }
+
+    void publish()
+        // Called with _mutex held.
+    {
+        ++_state.sequence;
+        _snapshot.write(_state);
+    }
+
+    ConnectivitySnapshot _state;
+    Poco::SeqLock<ConnectivitySnapshot> _snapshot;
+    Poco::FastMutex _mutex;
+};
+
+}
+}
+
+#endif // CONNMANAGERSERVICEMOCK_H
@@ -0,0 +1,430 @@
+/**
+ * \file
+ *         ConnManagerServiceReplay.h
+ * \brief
+ *         X86 stub implementation of IConnManagerService replaying recorded modem events
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#ifndef CONNMANAGERSERVICEREPLAY_H
+#define CONNMANAGERSERVICEREPLAY_H
+
+#include "ConnManagerServiceMock.h"
+#include "Poco/AbstractDelegate.h"
+#include "Poco/Clock.h"
+#include "Poco/Thread.h"
+#include "Poco/Types.h"
+#include "Poco/Mutex.h"
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <cstring>
+
+namespace Stla {
+namespace Connectivity {
+
+/**
+ * @brief Magic number of a connectivity trace ("CMTR")
+ */
+const Poco::UInt32 CONNMANAGER_TRACE_MAGIC = 0x434D5452;
+
+/**
+ * @brief Format version of a connectivity trace
+ */
+const Poco::UInt32 CONNMANAGER_TRACE_VERSION = 1;
+
+/**
+ * @brief The ConMgrTraceEvent defines the events a connectivity trace can contain.
+ * The payload of a record is the raw event argument.
+ */
+enum ConMgrTraceEvent
+{
+    ConMgrTrace_RegistrationStatus = 0, /**< Payload RegistrationStatus */
+    ConMgrTrace_LteMetrics,             /**< Payload LteMetrics */
+    ConMgrTrace_UmtsMetrics,            /**< Payload UmtsMetrics */
+    ConMgrTrace_GsmMetrics,             /**< Payload GsmMetrics */
+    ConMgrTrace_ApnConState,            /**< Payload APNConnState */
+    ConMgrTrace_SignalStrength,         /**< Payload unsigned char */
+    ConMgrTrace_DataPath,               /**< Payload ConMgrDataPath */
+    ConMgrTrace_Last                    /**< Guard, add events before this line */
+};
+
+/**
+ * @brief Header of a connectivity trace file:
+ * - magic (CONNMANAGER_TRACE_MAGIC)
+ * - version (CONNMANAGER_TRACE_VERSION)
+ *
+ * The header is followed by records, each one a ConMgrTraceRecord followed by size bytes of payload.
+ * All fields are in the byte order of the recording target.
+ */
+struct ConMgrTraceHeader
+{
+    Poco::UInt32 magic;
+    Poco::UInt32 version;
+};
+
+/**
+ * @brief Header of a trace record:
+ * - time (Microseconds since the start of the recording)
+ * - event (\link ConMgrTraceEvent \endlink)
+ * - size (Size of the payload in bytes)
+ */
+struct ConMgrTraceRecord
+{
+    Poco::UInt64 time;
+    Poco::UInt16 event;
+    Poco::UInt16 size;
+    Poco::UInt32 reserved;
+};
+
+/**
+ * @brief Writes connectivity traces, used to convert field logs.
+ */
+class ConnManagerTraceWriter
+{
+public:
+    ConnManagerTraceWriter(std::ostream& ostr): _ostr(ostr)
+    {
+        ConMgrTraceHeader header = {CONNMANAGER_TRACE_MAGIC, CONNMANAGER_TRACE_VERSION};
+        _ostr.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    template <class T>
+    void write(Poco::UInt64 time, ConMgrTraceEvent event, const T& payload)
+    {
+        ConMgrTraceRecord record = {time, static_cast<Poco::UInt16>(event), static_cast<Poco::UInt16>(sizeof(T)), 0};
+        _ostr.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        _ostr.write(reinterpret_cast<const char*>(&payload), sizeof(T));
+    }
+
+private:
+    std::ostream& _ostr;
+};
+
+/**
+ * @brief Histogram of latencies in microseconds, with power of two buckets.
+ *
+ * Bucket 0 counts latencies below 1 us, bucket n latencies in [2^(n-1), 2^n[,
+ * the last bucket everything above.
+ */
+class LatencyHistogram
+{
+public:
+    enum
+    {
+        BUCKETS = 24
+    };
+
+    LatencyHistogram(): _count(0), _sum(0), _min(0), _max(0)
+    {
+        std::memset(_buckets, 0, sizeof(_buckets));
+    }
+
+    void record(Poco::Clock::ClockDiff latency)
+    {
+        int bucket = 0;
+        for (Poco::Clock::ClockDiff l = latency; l > 0 && bucket < BUCKETS - 1; l >>= 1) ++bucket;
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        ++_buckets[bucket];
+        if (_count == 0 || latency < _min) _min = latency;
+        if (latency > _max) _max = latency;
+        _sum += latency;
+        ++_count;
+    }
+
+    /**
+     * @brief Prints the histogram as a JSON object.
+     */
+    void print(std::ostream& ostr) const
+    {
+        Poco::FastMutex::ScopedLock lock(_mutex);
+        ostr << "\"count\":" << _count << ",\"min_us\":" << _min << ",\"max_us\":" << _max
+             << ",\"mean_us\":" << (_count ? static_cast<double>(_sum)/_count : 0.0) << ",\"buckets\":[";
+        for (int i = 0; i < BUCKETS; ++i) ostr << (i ? "," : "") << _buckets[i];
+        ostr << "]";
+    }
+
+private:
+    Poco::UInt64 _buckets[BUCKETS];
+    Poco::UInt64 _count;
+    Poco::Clock::ClockDiff _sum;
+    Poco::Clock::ClockDiff _min;
+    Poco::Clock::ClockDiff _max;
+    mutable Poco::FastMutex _mutex;
+};
+
+/**
+ * @brief Decorator for a delegate recording the time spent in the decorated delegate.
+ * Compares equal to the decorated delegate for removal.
+ */
+template <class TArgs>
+class TimedDelegate : public Poco::AbstractDelegate<TArgs>
+{
+public:
+    TimedDelegate(const Poco::AbstractDelegate<TArgs>& delegate, LatencyHistogram& histogram):
+        _pDelegate(delegate.clone()), _pHistogram(&histogram)
+    {
+    }
+
+    TimedDelegate(const TimedDelegate& delegate):
+        Poco::AbstractDelegate<TArgs>(delegate),
+        _pDelegate(delegate._pDelegate->clone()),
+        _pHistogram(delegate._pHistogram)
+    {
+    }
+
+    ~TimedDelegate()
+    {
+        delete _pDelegate;
+    }
+
+    bool notify(const void* sender, TArgs& arguments)
+    {
+        Poco::Clock start;
+        bool result = _pDelegate->notify(sender, arguments);
+        _pHistogram->record(start.elapsed());
+        return result;
+    }
+
+    bool equals(const Poco::AbstractDelegate<TArgs>& other) const
+    {
+        return other.equals(*_pDelegate);
+    }
+
+    Poco::AbstractDelegate<TArgs>* clone() const
+    {
+        return new TimedDelegate(*this);
+    }
+
+    void disable()
+    {
+        _pDelegate->disable();
+    }
+
+    const Poco::AbstractDelegate<TArgs>* unwrap() const
+    {
+        return _pDelegate;
+    }
+
+private:
+    TimedDelegate& operator = (const TimedDelegate&);
+
+    Poco::AbstractDelegate<TArgs>* _pDelegate;
+    LatencyHistogram* _pHistogram;
+};
+
+/**
+ * ConnManagerServiceReplay replays a connectivity trace through the events of
+ * IConnManagerService, to load test subscribers with recorded burst patterns.
+ *
+ * Subscribers registered through timed() get a latency histogram each:
+ *
+ *     ConnManagerServiceReplay::Ptr pReplay(new ConnManagerServiceReplay);
+ *     pReplay->load(trace);
+ *     pReplay->onLteMetrics += pReplay->timed("routing", Poco::delegate(&routing, &Routing::onLte));
+ *     pReplay->replay(10.0);
+ *     pReplay->report(std::cout);
+ *
+ * Coalescing events are flushed after every record, so every recorded value
+ * is delivered and the replay is deterministic.
+ */
+class ConnManagerServiceReplay : public ConnManagerServiceMock
+{
+public:
+    typedef Poco::AutoPtr<ConnManagerServiceReplay> Ptr;
+
+    ConnManagerServiceReplay() {}
+
+    ~ConnManagerServiceReplay()
+    {
+        for (std::list<Entry>::iterator it = _histograms.begin(); it != _histograms.end(); ++it) delete it->pHistogram;
+    }
+
+    /**
+     * @brief Loads the records of the trace in istr, replacing the ones loaded before.
+     *
+     * @return ConMgrErr_InvalidArgument if the trace is malformed, ConMgrErr_OK otherwise.
+     */
+    ConMgrErrno load(std::istream& istr)
+    {
+        _records.clear();
+        _payload.clear();
+        ConMgrTraceHeader header;
+        if (!istr.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || header.magic != CONNMANAGER_TRACE_MAGIC || header.version != CONNMANAGER_TRACE_VERSION)
+        {
+            return ConMgrErr_InvalidArgument;
+        }
+        ConMgrTraceRecord record;
+        while (istr.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        {
+            if (record.event >= ConMgrTrace_Last || record.size != payloadSize(record.event)) return ConMgrErr_InvalidArgument;
+            Loaded loaded = {record, _payload.size()};
+            _payload.resize(_payload.size() + record.size);
+            if (!istr.read(&_payload[loaded.offset], record.size)) return ConMgrErr_InvalidArgument;
+            _records.push_back(loaded);
+        }
+        return ConMgrErr_OK;
+    }
+
+    /**
+     * @brief Returns the number of loaded records.
+     */
+    std::size_t size() const
+    {
+        return _records.size();
+    }
+
+    /**
+     * @brief Replays the loaded records from the calling thread.
+     *
+     * @param [in] speed Replay speed relative to the recording, 1.0 for real time, 0 for max speed
+     */
+    void replay(double speed = 1.0)
+    {
+        Poco::Clock start;
+        for (std::vector<Loaded>::const_iterator it = _records.begin(); it != _records.end(); ++it)
+        {
+            if (speed > 0)
+            {
+                Poco::Clock::ClockDiff due = static_cast<Poco::Clock::ClockDiff>(it->record.time/speed);
+                Poco::Clock::ClockDiff wait = due - start.elapsed();
+                if (wait >= 1000) Poco::Thread::sleep(static_cast<long>(wait/1000));
+                while (start.elapsed() < due) Poco::Thread::yield();
+                _lag.record(start.elapsed() - due);
+            }
+            dispatch(it->record, &_payload[it->offset]);
+        }
+    }
+
+    /**
+     * @brief Decorates delegate to record its latency in the histogram named name.
+     * Delegates sharing a name share the histogram.
+     */
+    template <class TArgs>
+    TimedDelegate<TArgs> timed(const std::string& name, const Poco::AbstractDelegate<TArgs>& delegate)
+    {
+        return TimedDelegate<TArgs>(delegate, histogram(name));
+    }
+
+    /**
+     * @brief Prints one JSON object per histogram, plus the scheduling lag of the replay.
+     */
+    void report(std::ostream& ostr) const
+    {
+        Poco::FastMutex::ScopedLock lock(_histogramMutex);
+        for (std::list<Entry>::const_iterator it = _histograms.begin(); it != _histograms.end(); ++it)
+        {
+            ostr << "{\"delegate\":\"" << it->name << "\",";
+            it->pHistogram->print(ostr);
+            ostr << "}\n";
+        }
+        ostr << "{\"delegate\":\"(replay lag)\",";
+        _lag.print(ostr);
+        ostr << "}\n";
+    }
+
+private:
+    struct Loaded
+    {
+        ConMgrTraceRecord record;
+        std::size_t offset;
+    };
+
+    struct Entry
+    {
+        std::string name;
+        LatencyHistogram* pHistogram;
+    };
+
+    static std::size_t payloadSize(Poco::UInt16 event)
+    {
+        switch (event)
+        {
+        case ConMgrTrace_RegistrationStatus: return sizeof(RegistrationStatus);
+        case ConMgrTrace_LteMetrics:         return sizeof(LteMetrics);
+        case ConMgrTrace_UmtsMetrics:        return sizeof(UmtsMetrics);
+        case ConMgrTrace_GsmMetrics:         return sizeof(GsmMetrics);
+        case ConMgrTrace_ApnConState:        return sizeof(APNConnState);
+        case ConMgrTrace_SignalStrength:     return sizeof(unsigned char);
+        case ConMgrTrace_DataPath:           return sizeof(ConMgrDataPath);
+        default:                             return 0;
+        }
+    }
+
+    template <class T>
+    static T payloadAs(const char* pPayload)
+    {
+        T value;
+        std::memcpy(static_cast<void*>(&value), pPayload, sizeof(T));
+        return value;
+    }
+
+    void dispatch(const ConMgrTraceRecord& record, const char* pPayload)
+    {
+        switch (record.event)
+        {
+        case ConMgrTrace_RegistrationStatus:
+            setRegistrationStatus(payloadAs<RegistrationStatus>(pPayload));
+            break;
+        case ConMgrTrace_LteMetrics:
+            setLteMetrics(payloadAs<LteMetrics>(pPayload));
+            onLteMetrics.flush();
+            break;
+        case ConMgrTrace_UmtsMetrics:
+            setUmtsMetrics(payloadAs<UmtsMetrics>(pPayload));
+            onUmtsMetrics.flush();
+            break;
+        case ConMgrTrace_GsmMetrics:
+            setGsmMetrics(payloadAs<GsmMetrics>(pPayload));
+            onGsmMetrics.flush();
+            break;
+        case ConMgrTrace_ApnConState:
+            {
+                APNConnState state = payloadAs<APNConnState>(pPayload);
+                if (state.interface >= 0 && state.interface < MAX_APN_COUNT) setApnConState(state.interface, state.available);
+            }
+            break;
+        case ConMgrTrace_SignalStrength:
+            setCellularSignalStrength(payloadAs<unsigned char>(pPayload));
+            break;
+        case ConMgrTrace_DataPath:
+            setDataPath(payloadAs<ConMgrDataPath>(pPayload));
+            break;
+        }
+    }
+
+    LatencyHistogram& histogram(const std::string& name)
+    {
+        Poco::FastMutex::ScopedLock lock(_histogramMutex);
+        for (std::list<Entry>::iterator it = _histograms.begin(); it != _histograms.end(); ++it)
+        {
+            if (it->name == name) return *it->pHistogram;
+        }
+        Entry entry = {name, new LatencyHistogram};
+        _histograms.push_back(entry);
+        return *entry.pHistogram;
+    }
+
+    std::vector<Loaded> _records;
+    std::vector<char> _payload;
+    std::list<Entry> _histograms;
+    LatencyHistogram _lag;
+    mutable Poco::FastMutex _histogramMutex;
+};
+
+}
+}
+
+#endif // CONNMANAGERSERVICEREPLAY_H
@@ -0,0 +1,66 @@
+/**
+ * \file
+ *         AllocCounter.cpp
+ * \brief
+ *         Global operator new and operator delete counting the allocations of every thread
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ */
+
+#include "AllocCounter.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+/**
+ * @brief Number of heap allocations done by the current thread.
+ */
+__thread unsigned long allocationCount = 0;
+
+}
+
+namespace Bench {
+
+unsigned long allocations()
+{
+    return allocationCount;
+}
+
+}
+
+#if __cplusplus >= 201103L
+void* operator new(std::size_t size)
+#else
+void* operator new(std::size_t size) throw(std::bad_alloc)
+#endif
+{
+    ++allocationCount;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+#if __cplusplus >= 201103L
+void operator delete(void* p) noexcept
+#else
+void operator delete(void* p) throw()
+#endif
+{
+    std::free(p);
+}
+
+#if __cpp_sized_deallocation
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
@@ -0,0 +1,38 @@
+/**
+ * \file
+ *         AllocCounter.h
+ * \brief
+ *         Per-thread heap allocation counter for the benchmarks
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * AllocCounter.cpp replaces the global operator new and operator delete with
+ * versions that count the allocations of every thread. It must be linked once
+ * into every benchmark using Bench::allocations():
+ *
+ *     const unsigned long allocs = Bench::allocations();
+ *     ...
+ *     report(..., Bench::allocations() - allocs);
+ */
+
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+namespace Bench {
+
+/**
+ * @brief Returns the number of heap allocations done by the current thread.
+ */
+unsigned long allocations();
+
+}
+
+#endif // ALLOCCOUNTER_H
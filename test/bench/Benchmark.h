@@ -0,0 +1,293 @@
+/**
+ * \file
+ *         Benchmark.h
+ * \brief
+ *         Minimal benchmark harness with automatic iteration counts and JSON output
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Benchmarks are functions taking a Bench::State, registered with BENCHMARK()
+ * or BENCHMARK_ARG(), which run the measured code while State::keepRunning()
+ * returns true:
+ *
+ *     void benchNotify(Bench::State& state)
+ *     {
+ *         Poco::BasicEvent<int> event;
+ *         ...
+ *         int value = 0;
+ *         while (state.keepRunning()) event.notify(0, value);
+ *     }
+ *     BENCHMARK_ARG(benchNotify, 10);
+ *
+ *     int main(int argc, char** argv)
+ *     {
+ *         return Bench::runAll(argc, argv);
+ *     }
+ *
+ * Every benchmark is first run with increasing iteration counts until a run
+ * takes at least the minimum time, then every repetition is printed on stdout
+ * as one JSON object per line, like the other benchmarks in this folder:
+ *
+ *     {"benchmark":"benchNotify","arg":10,"repetition":0,"iterations":2097152,"ns_per_op":95.3,"ops_per_s":10493179}
+ *
+ * Options:
+ *   - --filter=text:     only run benchmarks whose name contains text
+ *   - --min-time=s:      minimum duration of a measured run, in seconds (default 0.2)
+ *   - --repetitions=n:   number of measured runs per benchmark (default 3)
+ *   - --list:            print the names of the benchmarks and exit
+ *
+ * Results of two builds are compared with compare_bench.py.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "Poco/Stopwatch.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Bench {
+
+/**
+ * State is passed to a benchmark function. It controls the number of
+ * iterations and takes the time of the measured loop.
+ */
+class State
+{
+public:
+    State(long iterations, long arg):
+        _iterations(iterations), _remaining(iterations), _arg(arg), _bytes(0), _started(false)
+    {
+    }
+
+    /**
+     * @brief Returns true while the measured loop has to run another iteration.
+     *
+     * Starts the time with the first call and stops it with the last one.
+     */
+    bool keepRunning()
+    {
+        if (!_started)
+        {
+            _started = true;
+            _stopwatch.start();
+        }
+        if (_remaining-- > 0) return true;
+        _stopwatch.stop();
+        return false;
+    }
+
+    /**
+     * @brief Stops the time, e.g. while the next iteration is being prepared.
+     */
+    void pauseTiming()
+    {
+        _stopwatch.stop();
+    }
+
+    /**
+     * @brief Continues the time after pauseTiming().
+     */
+    void resumeTiming()
+    {
+        _stopwatch.start();
+    }
+
+    /**
+     * @brief Returns the number of iterations of this run.
+     */
+    long iterations() const
+    {
+        return _iterations;
+    }
+
+    /**
+     * @brief Returns the argument given with BENCHMARK_ARG(), or -1.
+     */
+    long arg() const
+    {
+        return _arg;
+    }
+
+    /**
+     * @brief Sets the number of bytes processed by all iterations, reported as bytes_per_s.
+     */
+    void setBytesProcessed(Poco::UInt64 bytes)
+    {
+        _bytes = bytes;
+    }
+
+    Poco::UInt64 bytesProcessed() const
+    {
+        return _bytes;
+    }
+
+    /**
+     * @brief Returns the measured time in microseconds.
+     */
+    Poco::Clock::ClockDiff elapsed() const
+    {
+        return _stopwatch.elapsed();
+    }
+
+private:
+    long _iterations;
+    long _remaining;
+    long _arg;
+    Poco::UInt64 _bytes;
+    bool _started;
+    Poco::Stopwatch _stopwatch;
+};
+
+typedef void (*Function)(State&);
+
+/**
+ * @brief A registered benchmark.
+ */
+struct Entry
+{
+    std::string name;
+    Function function;
+    long arg;
+};
+
+/**
+ * @brief Returns all registered benchmarks, in registration order.
+ */
+inline std::vector<Entry>& entries()
+{
+    static std::vector<Entry> theEntries;
+    return theEntries;
+}
+
+/**
+ * Registers a benchmark at static initialization time. Used by BENCHMARK() and BENCHMARK_ARG().
+ */
+class Registrar
+{
+public:
+    Registrar(const char* name, Function function, long arg = -1)
+    {
+        Entry entry;
+        entry.name = name;
+        entry.function = function;
+        entry.arg = arg;
+        entries().push_back(entry);
+    }
+};
+
+/**
+ * @brief Runs a benchmark with the given number of iterations and returns the elapsed microseconds.
+ */
+inline Poco::Clock::ClockDiff run(const Entry& entry, long iterations, Poco::UInt64& bytes)
+{
+    State state(iterations, entry.arg);
+    entry.function(state);
+    bytes = state.bytesProcessed();
+    return state.elapsed();
+}
+
+/**
+ * @brief Prints one measured run as a JSON line.
+ */
+inline void report(const Entry& entry, int repetition, long iterations, Poco::Clock::ClockDiff elapsedUs, Poco::UInt64 bytes)
+{
+    double seconds = elapsedUs > 0 ? elapsedUs/1e6 : 1e-6;
+    std::printf("{\"benchmark\":\"%s\"", entry.name.c_str());
+    if (entry.arg >= 0) std::printf(",\"arg\":%ld", entry.arg);
+    std::printf(",\"repetition\":%d,\"iterations\":%ld,\"ns_per_op\":%.1f,\"ops_per_s\":%.0f",
+        repetition, iterations, 1e9*seconds/iterations, iterations/seconds);
+    if (bytes) std::printf(",\"bytes_per_s\":%.0f", bytes/seconds);
+    std::printf("}\n");
+    std::fflush(stdout);
+}
+
+/**
+ * @brief Runs all registered benchmarks selected by the command line options. Returns the exit status.
+ */
+inline int runAll(int argc, char** argv)
+{
+    std::string filter;
+    double minTime = 0.2;
+    int repetitions = 3;
+    bool list = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], "--filter=", 9) == 0)
+            filter = argv[i] + 9;
+        else if (std::strncmp(argv[i], "--min-time=", 11) == 0)
+            minTime = std::atof(argv[i] + 11);
+        else if (std::strncmp(argv[i], "--repetitions=", 14) == 0)
+            repetitions = std::atoi(argv[i] + 14);
+        else if (std::strcmp(argv[i], "--list") == 0)
+            list = true;
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--filter=text] [--min-time=seconds] [--repetitions=n] [--list]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (repetitions < 1) repetitions = 1;
+
+    const std::vector<Entry>& all = entries();
+    for (std::vector<Entry>::const_iterator it = all.begin(); it != all.end(); ++it)
+    {
+        if (!filter.empty() && it->name.find(filter) == std::string::npos) continue;
+        if (list)
+        {
+            if (it->arg >= 0) std::printf("%s/%ld\n", it->name.c_str(), it->arg);
+            else std::printf("%s\n", it->name.c_str());
+            continue;
+        }
+
+        // grow the iteration count until a run takes at least minTime
+        long iterations = 1;
+        Poco::UInt64 bytes = 0;
+        const double minUs = minTime*1e6;
+        for (;;)
+        {
+            Poco::Clock::ClockDiff elapsed = run(*it, iterations, bytes);
+            if (elapsed >= minUs || iterations >= 1000000000L) break;
+            double factor = elapsed > 0 ? 1.4*minUs/elapsed : 10.0;
+            if (factor > 10.0) factor = 10.0;
+            long next = static_cast<long>(iterations*factor);
+            iterations = next > iterations ? next : iterations + 1;
+        }
+        for (int r = 0; r < repetitions; ++r)
+        {
+            Poco::Clock::ClockDiff elapsed = run(*it, iterations, bytes);
+            report(*it, r, iterations, elapsed, bytes);
+        }
+    }
+    return 0;
+}
+
+} // namespace Bench
+
+#define BENCHMARK_JOIN_(a, b) a##b
+#define BENCHMARK_JOIN(a, b) BENCHMARK_JOIN_(a, b)
+
+/**
+ * @brief Registers a benchmark function.
+ */
+#define BENCHMARK(function) \
+    static Bench::Registrar BENCHMARK_JOIN(benchmarkRegistrar, __LINE__)(#function, function)
+
+/**
+ * @brief Registers a benchmark function, to be run with the given argument (see State::arg()).
+ */
+#define BENCHMARK_ARG(function, argument) \
+    static Bench::Registrar BENCHMARK_JOIN(benchmarkRegistrar, __LINE__)(#function, function, argument)
+
+#endif // BENCHMARK_H
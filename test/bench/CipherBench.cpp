@@ -0,0 +1,167 @@
+/**
+ * \file
+ *         CipherBench.cpp
+ * \brief
+ *         Benchmarks encryption throughput of CryptoOutputStream compared with in-place EVPTransform and AEADCipher
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: cipher_bench [megabytes] [message size]
+ *
+ * The given amount of data (default 64 MB) is encrypted as messages of the
+ * given size (default 16384 bytes), each with its own IV, with every cipher:
+ *
+ *   - "stream": a new encryptor per message, through a CryptoOutputStream
+ *   - "inplace": one EVPTransform, reset() for every message
+ *   - "seal": AEADCipher::seal(), for AEAD ciphers only
+ *
+ * Every result is printed on stdout as one JSON object per line:
+ *
+ *     {"benchmark":"inplace","cipher":"aes-128-gcm","message_size":16384,"messages":4096,"ms":21.4,"mb_per_s":3135.9}
+ */
+
+#include "Poco/Crypto/Cipher.h"
+#include "Poco/Crypto/CipherKey.h"
+#include "Poco/Crypto/CipherFactory.h"
+#include "Poco/Crypto/AEADCipher.h"
+#include "Poco/Crypto/EVPTransform.h"
+#include "Poco/Crypto/CryptoStream.h"
+#include "Poco/Crypto/OpenSSLInitializer.h"
+#include "Poco/NullStream.h"
+#include "Poco/Stopwatch.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::vector<unsigned char> ByteVec;
+
+/**
+ * @brief Prints the result of one benchmark as a JSON line.
+ */
+void report(const char* benchmark, const std::string& cipher, std::size_t messageSize, long messages, Poco::Clock::ClockDiff elapsedUs)
+{
+    const double mbs = elapsedUs > 0 ? static_cast<double>(messageSize)*messages/elapsedUs : 0.0;
+    std::printf("{\"benchmark\":\"%s\",\"cipher\":\"%s\",\"message_size\":%lu,\"messages\":%ld,\"ms\":%.1f,\"mb_per_s\":%.1f}\n",
+        benchmark, cipher.c_str(), static_cast<unsigned long>(messageSize), messages, elapsedUs/1000.0, mbs);
+}
+
+/**
+ * @brief Stores the message number in the first bytes of the IV.
+ */
+void nextIV(ByteVec& iv, long message)
+{
+    for (std::size_t i = 0; i < sizeof(message) && i < iv.size(); ++i)
+    {
+        iv[i] = static_cast<unsigned char>(message >> (8*i));
+    }
+}
+
+/**
+ * @brief Encrypts every message with a new encryptor through a CryptoOutputStream.
+ */
+void benchStream(const std::string& name, const ByteVec& key, ByteVec iv, ByteVec& data, long messages)
+{
+    Poco::NullOutputStream sink;
+    Poco::Stopwatch sw;
+    sw.start();
+    for (long m = 0; m < messages; ++m)
+    {
+        nextIV(iv, m);
+        Poco::Crypto::Cipher::Ptr pCipher = Poco::Crypto::CipherFactory::defaultFactory().createCipher(Poco::Crypto::CipherKey(name, key, iv));
+        Poco::Crypto::CryptoOutputStream encryptor(sink, pCipher->createEncryptor());
+        encryptor.write(reinterpret_cast<const char*>(&data[0]), static_cast<std::streamsize>(data.size()));
+        encryptor.close();
+    }
+    sw.stop();
+    report("stream", name, data.size(), messages, sw.elapsed());
+}
+
+/**
+ * @brief Encrypts every message in place with one EVPTransform.
+ */
+void benchInPlace(const std::string& name, const EVP_CIPHER* pCipher, const ByteVec& key, ByteVec iv, ByteVec& data, long messages)
+{
+    Poco::Crypto::EVPTransform transform(pCipher, key, iv, Poco::Crypto::EVPTransform::DIR_ENCRYPT);
+    if (!transform.isAEAD()) transform.setPadding(0);
+    Poco::Stopwatch sw;
+    sw.start();
+    for (long m = 0; m < messages; ++m)
+    {
+        nextIV(iv, m);
+        transform.reset(iv);
+        transform.transform(&data[0], data.size());
+        transform.finalize();
+        if (transform.isAEAD()) transform.getTag();
+    }
+    sw.stop();
+    report("inplace", name, data.size(), messages, sw.elapsed());
+}
+
+/**
+ * @brief Encrypts and authenticates every message in place with AEADCipher::seal().
+ */
+void benchSeal(const std::string& name, const ByteVec& key, ByteVec iv, ByteVec& data, long messages)
+{
+    Poco::Crypto::AEADCipher::Ptr pCipher = Poco::Crypto::CipherFactory::defaultFactory().createAEADCipher(Poco::Crypto::CipherKey(name, key, iv));
+    const unsigned char header[] = "VF3XXXXXXXX000000";
+    unsigned char tag[Poco::Crypto::AEADCipher::TAG_SIZE];
+    Poco::Stopwatch sw;
+    sw.start();
+    for (long m = 0; m < messages; ++m)
+    {
+        nextIV(iv, m);
+        pCipher->seal(iv, header, sizeof(header) - 1, &data[0], data.size(), tag);
+    }
+    sw.stop();
+    report("seal", name, data.size(), messages, sw.elapsed());
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    long megabytes = argc > 1 ? std::atol(argv[1]) : 64;
+    if (megabytes <= 0) megabytes = 64;
+    long messageSize = argc > 2 ? std::atol(argv[2]) : 16384;
+    // a multiple of the AES block size, as CBC is used without padding in place
+    messageSize -= messageSize % 16;
+    if (messageSize <= 0) messageSize = 16384;
+    const long messages = megabytes*1024*1024/messageSize;
+
+    Poco::Crypto::OpenSSLInitializer openSSLInitializer;
+    const char* ciphers[] = {"aes-128-cbc", "aes-256-cbc", "aes-128-gcm", "aes-256-gcm", "chacha20-poly1305"};
+    ByteVec data(static_cast<std::size_t>(messageSize));
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<unsigned char>(i);
+
+    for (std::size_t c = 0; c < sizeof(ciphers)/sizeof(ciphers[0]); ++c)
+    {
+        const EVP_CIPHER* pCipher = EVP_get_cipherbyname(ciphers[c]);
+        if (!pCipher)
+        {
+            std::printf("{\"cipher\":\"%s\",\"error\":\"not supported\"}\n", ciphers[c]);
+            continue;
+        }
+        const ByteVec key(static_cast<std::size_t>(EVP_CIPHER_key_length(pCipher)), 0x5a);
+        const ByteVec iv(static_cast<std::size_t>(EVP_CIPHER_iv_length(pCipher)), 0);
+
+        benchStream(ciphers[c], key, iv, data, messages);
+        benchInPlace(ciphers[c], pCipher, key, iv, data, messages);
+        if (EVP_CIPHER_mode(pCipher) == EVP_CIPH_GCM_MODE || (EVP_CIPHER_flags(pCipher) & EVP_CIPH_FLAG_AEAD_CIPHER) != 0)
+        {
+            benchSeal(ciphers[c], key, iv, data, messages);
+        }
+    }
+    return 0;
+}
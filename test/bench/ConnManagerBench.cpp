@@ -0,0 +1,381 @@
+/**
+ * \file
+ *         ConnManagerBench.cpp
+ * \brief
+ *         Micro benchmarks for the IConnManagerService event and getter hot paths
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: connmgr_bench [iterations]
+ *
+ * Every result is printed on stdout as one JSON object per line:
+ *
+ *     {"benchmark":"notify","event":"onLteMetrics","delegates":10,"monitored":false,"threads":1,"iterations":100000,"ns_per_op":152.3,"ops_per_s":6565988,"allocs_per_op":0}
+ *
+ * allocs_per_op counts the heap allocations done by the measuring thread. Notifying an event
+ * with trivially copyable arguments must not allocate; the benchmark exits with status 1
+ * if it does.
+ *
+ * Coalescing events (onGsmMetrics, onUmtsMetrics, onLteMetrics, onCellularNbCellsChanged)
+ * are measured as notify() followed by flush(), i.e. the cost of one delivered value.
+ * Isolating events (onDataPathChanged) are measured as the cost of queueing the notification.
+ *
+ * ConnectivityHistory::queryHistory() is measured for a window crossing the wrap point of
+ * the ring buffer; the benchmark exits with status 1 if the window is not aggregated correctly.
+ */
+
+#include "AllocCounter.h"
+#include "../ConnManagerServiceMock.h"
+#include "IConnManagerServiceHistory.h"
+#include "Poco/Delegate.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Stla::Connectivity;
+
+namespace {
+
+/**
+ * @brief Set if a notification expected not to allocate did allocate.
+ */
+bool allocationFailure = false;
+
+/**
+ * @brief Set if a history query did not report the expected aggregate.
+ */
+bool historyFailure = false;
+
+}
+
+namespace {
+
+/**
+ * @brief Delegate target, counts the notifications it receives.
+ */
+class Sink
+{
+public:
+    Sink(): count(0) {}
+
+    template <class TArgs>
+    void on(const void* /*pSender*/, TArgs& /*args*/)
+    {
+        ++count;
+    }
+
+    volatile unsigned long count;
+};
+
+void report(const char* benchmark, const char* name, int delegates, bool monitored, int threads, long iterations, Poco::Clock::ClockDiff elapsedUs, unsigned long allocs)
+{
+    double ns = elapsedUs > 0 ? (elapsedUs*1000.0)/iterations : 0;
+    double ops = elapsedUs > 0 ? (iterations*1000000.0)/elapsedUs : 0;
+    std::printf("{\"benchmark\":\"%s\",\"event\":\"%s\",\"delegates\":%d,\"monitored\":%s,\"threads\":%d,\"iterations\":%ld,\"ns_per_op\":%.1f,\"ops_per_s\":%.0f,\"allocs_per_op\":%g}\n",
+        benchmark, name, delegates, monitored ? "true" : "false", threads, iterations, ns, ops, static_cast<double>(allocs)/iterations);
+    std::fflush(stdout);
+}
+
+template <class TArgs>
+void subscribe(Poco::SnapshotEvent<TArgs>& event, Sink& sink)
+{
+    event += Poco::delegate(&sink, &Sink::on<TArgs>);
+}
+
+template <class TArgs>
+void subscribe(Poco::CoalescingEvent<TArgs>& event, Sink& sink)
+{
+    event += Poco::delegate(&sink, &Sink::on<TArgs>);
+}
+
+template <class TArgs>
+void subscribe(Poco::IsolatingEvent<TArgs>& event, Sink& sink)
+{
+    event += Poco::delegate(&sink, &Sink::on<TArgs>);
+}
+
+template <class TArgs, class TValue>
+void fire(Poco::SnapshotEvent<TArgs>& event, const void* pSender, TValue& value, bool monitored)
+{
+    event.notify(pSender, value, monitored);
+}
+
+template <class TArgs, class TValue>
+void fire(Poco::CoalescingEvent<TArgs>& event, const void* pSender, TValue& value, bool /*monitored*/)
+{
+    event.notify(pSender, value);
+    event.flush();
+}
+
+template <class TArgs, class TValue>
+void fire(Poco::IsolatingEvent<TArgs>& event, const void* pSender, TValue& value, bool monitored)
+{
+    event.notify(pSender, value, monitored);
+}
+
+template <class TEvent, class TValue>
+void benchNotify(const char* name, TEvent& event, TValue& value, long iterations, bool monitored, bool allocationFree)
+{
+    static const int DELEGATES[] = {1, 10, 100};
+    for (unsigned d = 0; d < sizeof(DELEGATES)/sizeof(DELEGATES[0]); ++d)
+    {
+        std::vector<Sink> sinks(DELEGATES[d]);
+        for (int i = 0; i < DELEGATES[d]; ++i)
+            subscribe(event, sinks[i]);
+
+        // warm up, e.g. start the event monitor thread
+        fire(event, &event, value, monitored);
+
+        Poco::Stopwatch sw;
+        const unsigned long allocs = Bench::allocations();
+        sw.start();
+        for (long n = 0; n < iterations; ++n)
+            fire(event, &event, value, monitored);
+        sw.stop();
+        report("notify", name, DELEGATES[d], monitored, 1, iterations, sw.elapsed(), Bench::allocations() - allocs);
+        if (allocationFree && Bench::allocations() != allocs) allocationFailure = true;
+
+        event.clear();
+    }
+}
+
+template <class TEvent, class TValue>
+void benchEvent(const char* name, TEvent& event, TValue value, long iterations, bool allocationFree = true)
+{
+    benchNotify(name, event, value, iterations, false, allocationFree);
+    benchNotify(name, event, value, iterations, true, allocationFree);
+}
+
+/**
+ * @brief Calls a getter of the mock in a loop, measured by the thread itself.
+ */
+class GetterRunner : public Poco::Runnable
+{
+public:
+    enum Getter
+    {
+        GETTER_LTE_METRICS,
+        GETTER_REGISTRATION_STATUS,
+        GETTER_SNAPSHOT
+    };
+
+    GetterRunner(ConnManagerServiceMock& service, Getter getter, long iterations):
+        _service(service), _getter(getter), _iterations(iterations), _elapsed(0), _allocations(0)
+    {
+    }
+
+    void run()
+    {
+        LteMetrics lte;
+        RegistrationStatus registration;
+        ConnectivitySnapshot snapshot;
+        Poco::Stopwatch sw;
+        const unsigned long allocs = Bench::allocations();
+        sw.start();
+        for (long n = 0; n < _iterations; ++n)
+        {
+            switch (_getter)
+            {
+            case GETTER_LTE_METRICS:
+                _service.getLteMetrics(lte);
+                break;
+            case GETTER_REGISTRATION_STATUS:
+                _service.getRegistrationStatus(registration);
+                break;
+            case GETTER_SNAPSHOT:
+                _service.getConnectivitySnapshot(snapshot);
+                break;
+            }
+        }
+        sw.stop();
+        _elapsed = sw.elapsed();
+        _allocations = Bench::allocations() - allocs;
+    }
+
+    Poco::Clock::ClockDiff elapsed() const
+    {
+        return _elapsed;
+    }
+
+    unsigned long allocs() const
+    {
+        return _allocations;
+    }
+
+private:
+    ConnManagerServiceMock& _service;
+    Getter _getter;
+    long _iterations;
+    Poco::Clock::ClockDiff _elapsed;
+    unsigned long _allocations;
+};
+
+/**
+ * @brief Updates the LTE metrics of the mock until stopped, to contend with the getters.
+ */
+class WriterRunner : public Poco::Runnable
+{
+public:
+    WriterRunner(ConnManagerServiceMock& service): _service(service), _stop(false) {}
+
+    void run()
+    {
+        LteMetrics metrics;
+        while (!_stop)
+        {
+            ++metrics.rsrp;
+            _service.setLteMetrics(metrics);
+            _service.onLteMetrics.flush();
+        }
+    }
+
+    void stop()
+    {
+        _stop = true;
+    }
+
+private:
+    ConnManagerServiceMock& _service;
+    volatile bool _stop;
+};
+
+void benchGetter(const char* name, ConnManagerServiceMock& service, GetterRunner::Getter getter, long iterations)
+{
+    static const int THREADS[] = {1, 2, 4};
+    for (unsigned t = 0; t < sizeof(THREADS)/sizeof(THREADS[0]); ++t)
+    {
+        WriterRunner writer(service);
+        Poco::Thread writerThread;
+        writerThread.start(writer);
+
+        std::vector<GetterRunner> runners(THREADS[t], GetterRunner(service, getter, iterations));
+        std::vector<Poco::Thread*> threads;
+        for (int i = 0; i < THREADS[t]; ++i)
+        {
+            threads.push_back(new Poco::Thread);
+            threads.back()->start(runners[i]);
+        }
+        Poco::Clock::ClockDiff total = 0;
+        unsigned long allocs = 0;
+        for (int i = 0; i < THREADS[t]; ++i)
+        {
+            threads[i]->join();
+            total += runners[i].elapsed();
+            allocs += runners[i].allocs();
+            delete threads[i];
+        }
+        writer.stop();
+        writerThread.join();
+
+        report("getter", name, 0, false, THREADS[t], iterations, total/THREADS[t], allocs/THREADS[t]);
+    }
+}
+
+/**
+ * @brief History callback, keeps the aggregate of the last query.
+ */
+class HistorySink : public ConnectivityHistoryCallback
+{
+public:
+    HistorySink(): samples(0) {}
+
+    void onSample(Poco::Timestamp::TimeVal /*time*/, int /*value*/)
+    {
+        ++samples;
+    }
+
+    void onAggregate(const ConnectivityHistoryAggregate& result)
+    {
+        aggregate = result;
+    }
+
+    std::size_t samples;
+    ConnectivityHistoryAggregate aggregate;
+};
+
+void benchHistory(long iterations)
+{
+    typedef ConnectivityHistory<256> History;
+    static History history;
+
+    // One and a half rings, so that the oldest sample is in the middle of the
+    // ring, and samples 200 to 300 are stored on both sides of the wrap point.
+    const Poco::Timestamp::TimeVal base = Poco::Timestamp().epochMicroseconds();
+    for (int i = 0; i < 384; ++i)
+        history.record(ConMgrHistory_LteRsrp, Poco::Timestamp(base + i), i);
+    // A late sample for an earlier time, recorded after samples past the window.
+    history.record(ConMgrHistory_LteRsrp, Poco::Timestamp(base + 250), 1000);
+
+    const Poco::Timestamp from(base + 200);
+    const Poco::Timestamp to(base + 300);
+    HistorySink sink;
+    history.queryHistory(ConMgrHistory_LteRsrp, from, to, sink);
+    if (sink.samples != 102 || sink.aggregate.count != 102 || sink.aggregate.min != 200 || sink.aggregate.max != 1000)
+        historyFailure = true;
+
+    Poco::Stopwatch sw;
+    const unsigned long allocs = Bench::allocations();
+    sw.start();
+    for (long n = 0; n < iterations; ++n)
+        history.queryHistory(ConMgrHistory_LteRsrp, from, to, sink);
+    sw.stop();
+    report("query", "ConnectivityHistory", 0, false, 1, iterations, sw.elapsed(), Bench::allocations() - allocs);
+    if (Bench::allocations() != allocs) allocationFailure = true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = argc > 1 ? std::atol(argv[1]) : 100000;
+    if (iterations <= 0) iterations = 100000;
+
+    ConnManagerServiceMock::Ptr pService(new ConnManagerServiceMock);
+    ConnManagerServiceMock& service = *pService;
+
+    benchEvent("onCellularNetworkTypeChanged", service.onCellularNetworkTypeChanged, ConMgrNtwType_LTE, iterations);
+    APNConnState apn = {ApnName_Public, true};
+    benchEvent("onApnConStateChanged", service.onApnConStateChanged, apn, iterations);
+    benchEvent("onApnStatesChanged", service.onApnStatesChanged, ApnConStates(), iterations);
+    benchEvent("onCellularMCCChanged", service.onCellularMCCChanged, 208, iterations);
+    benchEvent("onWifiDataConStateChanged", service.onWifiDataConStateChanged, true, iterations);
+    benchEvent("onCellularSignalStrengthChanged", service.onCellularSignalStrengthChanged, static_cast<unsigned char>(3), iterations);
+    benchEvent("onCellularModemAvailabilityChanged", service.onCellularModemAvailabilityChanged, true, iterations);
+    benchEvent("onGsmMetrics", service.onGsmMetrics, GsmMetrics(), iterations);
+    benchEvent("onUmtsMetrics", service.onUmtsMetrics, UmtsMetrics(), iterations);
+    benchEvent("onLteMetrics", service.onLteMetrics, LteMetrics(), iterations);
+    benchEvent("onCellularNbCellsChanged", service.onCellularNbCellsChanged, CellularNbCells(), iterations);
+    benchEvent("onRegistrationStatusChanged", service.onRegistrationStatusChanged, RegistrationStatus(), iterations);
+    benchEvent("onCellularTime", service.onCellularTime, DateTime(), iterations);
+    benchEvent("onDataPathTypeChanged", service.onDataPathTypeChanged, ConMgrDataPath_Cellular, iterations);
+    benchEvent("onDataPathChanged", service.onDataPathChanged, std::string("Cellular"), iterations, false);
+
+    benchGetter("getLteMetrics", service, GetterRunner::GETTER_LTE_METRICS, iterations);
+    benchGetter("getRegistrationStatus", service, GetterRunner::GETTER_REGISTRATION_STATUS, iterations);
+    benchGetter("getConnectivitySnapshot", service, GetterRunner::GETTER_SNAPSHOT, iterations);
+
+    benchHistory(iterations);
+
+    if (allocationFailure)
+    {
+        std::fprintf(stderr, "notify allocated memory for trivially copyable arguments\n");
+        return 1;
+    }
+    if (historyFailure)
+    {
+        std::fprintf(stderr, "history query across the wrap point returned a wrong aggregate\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,619 @@
+/**
+ * \file
+ *         FrameworkBench.cpp
+ * \brief
+ *         Benchmarks of the POCO, RemotingNG and OSP primitives used by the services
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: framework_bench [--filter=text] [--min-time=seconds] [--repetitions=n] [--list]
+ *
+ * Covers AbstractEvent notify, NotificationQueue, ThreadPool, the RemotingNG
+ * BinarySerializer, TCP::Frame round trips, JSON::Parser, ServiceRegistry
+ * lookups and Logger. See Benchmark.h for the output format, and
+ * compare_bench.py for comparing the results of two builds.
+ *
+ * Before the benchmarks, the events collected by Poco::Tracer from exactly full and
+ * overwritten ring buffers are checked; the program exits with status 1 if they are wrong.
+ */
+
+#include "Benchmark.h"
+#include "Poco/BasicEvent.h"
+#include "Poco/PriorityEvent.h"
+#include "Poco/FixedPriorityEvent.h"
+#include "Poco/Delegate.h"
+#include "Poco/PriorityDelegate.h"
+#include "Poco/NotificationQueue.h"
+#include "Poco/Notification.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Logger.h"
+#include "Poco/NullChannel.h"
+#include "Poco/RemotingNG/BinarySerializer.h"
+#include "Poco/RemotingNG/BinaryDeserializer.h"
+#include "Poco/RemotingNG/TypeSerializer.h"
+#include "Poco/RemotingNG/TypeDeserializer.h"
+#include "Poco/RemotingNG/TCP/Frame.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/OSP/ServiceRegistry.h"
+#include "Poco/OSP/Service.h"
+#include "Poco/OSP/Properties.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Base64.h"
+#include "Poco/Base64Encoder.h"
+#include "Poco/HexBinary.h"
+#include "Poco/FastUTF8.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/PooledDeflatingStream.h"
+#include "Poco/Tracer.h"
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Keeps the compiler from optimizing the benchmarked calls away.
+ */
+volatile long sink = 0;
+
+// AbstractEvent
+
+class Listener
+{
+public:
+    void onEvent(const void*, int& value)
+    {
+        sink += value;
+    }
+};
+
+void notify(Bench::State& state)
+{
+    Poco::BasicEvent<int> event;
+    std::vector<Listener> listeners(static_cast<std::size_t>(state.arg()));
+    for (std::size_t i = 0; i < listeners.size(); ++i) event += Poco::delegate(&listeners[i], &Listener::onEvent);
+    int value = 1;
+    while (state.keepRunning()) event.notify(0, value);
+    for (std::size_t i = 0; i < listeners.size(); ++i) event -= Poco::delegate(&listeners[i], &Listener::onEvent);
+}
+BENCHMARK_ARG(notify, 1);
+BENCHMARK_ARG(notify, 10);
+
+template <class E>
+void notifyPriority(Bench::State& state, E& event)
+{
+    std::vector<Listener> listeners(static_cast<std::size_t>(state.arg()));
+    for (std::size_t i = 0; i < listeners.size(); ++i) event += Poco::priorityDelegate(&listeners[i], &Listener::onEvent, static_cast<int>(i % 3));
+    int value = 1;
+    while (state.keepRunning()) event.notify(0, value);
+    for (std::size_t i = 0; i < listeners.size(); ++i) event -= Poco::priorityDelegate(&listeners[i], &Listener::onEvent, static_cast<int>(i % 3));
+}
+
+void priorityNotify(Bench::State& state)
+{
+    Poco::PriorityEvent<int> event;
+    notifyPriority(state, event);
+}
+BENCHMARK_ARG(priorityNotify, 10);
+
+void fixedPriorityNotify(Bench::State& state)
+{
+    Poco::FixedPriorityEvent<int, 3> event;
+    notifyPriority(state, event);
+}
+BENCHMARK_ARG(fixedPriorityNotify, 10);
+
+// NotificationQueue
+
+void notificationQueue(Bench::State& state)
+{
+    Poco::NotificationQueue queue;
+    while (state.keepRunning())
+    {
+        queue.enqueueNotification(new Poco::Notification);
+        Poco::Notification::Ptr pNf(queue.dequeueNotification());
+        sink += pNf ? 1 : 0;
+    }
+}
+BENCHMARK(notificationQueue);
+
+class QueueConsumer: public Poco::Runnable
+{
+public:
+    explicit QueueConsumer(Poco::NotificationQueue& queue):
+        _queue(queue)
+    {
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            Poco::Notification::Ptr pNf(_queue.waitDequeueNotification());
+            if (!pNf || pNf.cast<StopNotification>()) break;
+            ++sink;
+        }
+    }
+
+    class StopNotification: public Poco::Notification
+    {
+    };
+
+private:
+    Poco::NotificationQueue& _queue;
+};
+
+void notificationQueueThread(Bench::State& state)
+{
+    Poco::NotificationQueue queue;
+    QueueConsumer consumer(queue);
+    Poco::Thread thread;
+    thread.start(consumer);
+    while (state.keepRunning()) queue.enqueueNotification(new Poco::Notification);
+    queue.enqueueNotification(new QueueConsumer::StopNotification);
+    thread.join();
+}
+BENCHMARK(notificationQueueThread);
+
+// ThreadPool
+
+class Task: public Poco::Runnable
+{
+public:
+    void run()
+    {
+        ++_count;
+    }
+
+    Poco::AtomicCounter _count;
+};
+
+void threadPool(Bench::State& state)
+{
+    const int CAPACITY = 16;
+    Poco::ThreadPool pool(CAPACITY, CAPACITY);
+    Task task;
+    int started = 0;
+    while (state.keepRunning())
+    {
+        pool.start(task);
+        if (++started == CAPACITY)
+        {
+            pool.joinAll();
+            started = 0;
+        }
+    }
+    pool.joinAll();
+    sink += task._count.value();
+}
+BENCHMARK(threadPool);
+
+// RemotingNG BinarySerializer
+
+void binarySerializer(Bench::State& state)
+{
+    Poco::RemotingNG::BinarySerializer ser;
+    Poco::RemotingNG::BinaryDeserializer deser;
+    const std::string method("getLteMetrics");
+    const std::string text("cellular.lte.serving");
+    std::vector<Poco::Int32> values(16, 42);
+    std::stringstream stream;
+    while (state.keepRunning())
+    {
+        stream.str(std::string());
+        stream.clear();
+        ser.setup(stream);
+        ser.serializeMessageBegin(method, Poco::RemotingNG::SerializerBase::MESSAGE_REQUEST);
+        Poco::RemotingNG::TypeSerializer<Poco::UInt32>::serialize("id", 4711, ser);
+        Poco::RemotingNG::TypeSerializer<std::string>::serialize("name", text, ser);
+        Poco::RemotingNG::TypeSerializer<double>::serialize("value", -97.5, ser);
+        Poco::RemotingNG::TypeSerializer<std::vector<Poco::Int32> >::serialize("cells", values, ser);
+        ser.serializeMessageEnd(method, Poco::RemotingNG::SerializerBase::MESSAGE_REQUEST);
+        stream.flush();
+
+        deser.setup(stream);
+        std::string name;
+        deser.findMessage(name);
+        deser.deserializeMessageBegin(name, Poco::RemotingNG::SerializerBase::MESSAGE_REQUEST);
+        Poco::UInt32 id = 0;
+        std::string str;
+        double value = 0;
+        std::vector<Poco::Int32> cells;
+        Poco::RemotingNG::TypeDeserializer<Poco::UInt32>::deserialize("id", true, deser, id);
+        Poco::RemotingNG::TypeDeserializer<std::string>::deserialize("name", true, deser, str);
+        Poco::RemotingNG::TypeDeserializer<double>::deserialize("value", true, deser, value);
+        Poco::RemotingNG::TypeDeserializer<std::vector<Poco::Int32> >::deserialize("cells", true, deser, cells);
+        deser.deserializeMessageEnd(name, Poco::RemotingNG::SerializerBase::MESSAGE_REQUEST);
+        sink += static_cast<long>(id + cells.size() + str.size());
+    }
+}
+BENCHMARK(binarySerializer);
+
+// RemotingNG TCP::Frame
+
+void frameRoundTrip(Bench::State& state)
+{
+    using Poco::RemotingNG::TCP::Frame;
+    const Poco::UInt16 payloadSize = static_cast<Poco::UInt16>(state.arg());
+    std::vector<char> payload(payloadSize, 'x');
+    std::vector<char> wire(Frame::FRAME_MAX_SIZE);
+    while (state.keepRunning())
+    {
+        Frame::Ptr pOut = new Frame(Frame::FRAME_TYPE_REQU, 1, 0, static_cast<Poco::UInt16>(payloadSize + 12));
+        std::memcpy(pOut->payloadBegin(), &payload[0], payloadSize);
+        pOut->setPayloadSize(payloadSize);
+        std::size_t size = pOut->frameSize();
+        std::memcpy(&wire[0], pOut->bufferBegin(), size);
+
+        Frame::Ptr pIn = new Frame(0, 0, 0, static_cast<Poco::UInt16>(size));
+        std::memcpy(pIn->bufferBegin(), &wire[0], size);
+        sink += static_cast<long>(pIn->type() + pIn->channel() + pIn->getPayloadSize() + pIn->payloadBegin()[0]);
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*payloadSize);
+}
+BENCHMARK_ARG(frameRoundTrip, 64);
+BENCHMARK_ARG(frameRoundTrip, 1012);
+
+// JSON::Parser
+
+std::string jsonDocument(int records)
+{
+    std::string json("{\"cells\":[");
+    for (int i = 0; i < records; ++i)
+    {
+        if (i) json += ',';
+        json += "{\"pci\":";
+        json += Poco::NumberFormatter::format(i);
+        json += ",\"rsrp\":-97.5,\"rsrq\":-11,\"band\":\"B20\",\"serving\":";
+        json += i == 0 ? "true" : "false";
+        json += '}';
+    }
+    json += "],\"registration\":{\"status\":1,\"mcc\":208,\"mnc\":\"01\"}}";
+    return json;
+}
+
+void jsonParser(Bench::State& state)
+{
+    const std::string json(jsonDocument(static_cast<int>(state.arg())));
+    Poco::JSON::Parser parser;
+    while (state.keepRunning())
+    {
+        parser.reset();
+        Poco::Dynamic::Var result = parser.parse(json);
+        sink += result.isEmpty() ? 0 : 1;
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*json.size());
+}
+BENCHMARK_ARG(jsonParser, 10);
+BENCHMARK_ARG(jsonParser, 1000);
+
+// OSP ServiceRegistry
+
+class BenchService: public Poco::OSP::Service
+{
+public:
+    const std::type_info& type() const
+    {
+        return typeid(BenchService);
+    }
+
+    bool isA(const std::type_info& otherType) const
+    {
+        return isSameType(typeid(BenchService), otherType) || Poco::OSP::Service::isA(otherType);
+    }
+};
+
+void registerServices(Poco::OSP::ServiceRegistry& registry, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        Poco::OSP::Properties props;
+        props.set("index", Poco::NumberFormatter::format(i));
+        registry.registerService("bench.service." + Poco::NumberFormatter::format(i), new BenchService, props);
+    }
+}
+
+void serviceRegistryFind(Bench::State& state)
+{
+    Poco::OSP::ServiceRegistry registry;
+    int count = static_cast<int>(state.arg());
+    registerServices(registry, count);
+    const std::string query("name == \"bench.service." + Poco::NumberFormatter::format(count/2) + "\"");
+    std::vector<Poco::OSP::ServiceRef::Ptr> results;
+    while (state.keepRunning())
+    {
+        results.clear();
+        sink += static_cast<long>(registry.find(query, results));
+    }
+}
+BENCHMARK_ARG(serviceRegistryFind, 100);
+
+void serviceRegistryFindByName(Bench::State& state)
+{
+    Poco::OSP::ServiceRegistry registry;
+    int count = static_cast<int>(state.arg());
+    registerServices(registry, count);
+    const std::string name("bench.service." + Poco::NumberFormatter::format(count/2));
+    while (state.keepRunning())
+    {
+        sink += registry.findByName(name) ? 1 : 0;
+    }
+}
+BENCHMARK_ARG(serviceRegistryFindByName, 100);
+
+// Base64 and HexBinary
+
+std::string benchData(std::size_t size)
+{
+    std::string data(size, '\0');
+    for (std::size_t i = 0; i < size; ++i) data[i] = static_cast<char>(i*7 + 3);
+    return data;
+}
+
+void base64Encode(Bench::State& state)
+{
+    std::string data = benchData(static_cast<std::size_t>(state.arg()));
+    std::string encoded(Poco::Base64::encodedLength(data.size()), '\0');
+    while (state.keepRunning())
+    {
+        sink += static_cast<long>(Poco::Base64::encode(data.data(), data.size(), &encoded[0]));
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*data.size());
+}
+BENCHMARK_ARG(base64Encode, 1024);
+
+void base64EncoderStream(Bench::State& state)
+{
+    std::string data = benchData(static_cast<std::size_t>(state.arg()));
+    while (state.keepRunning())
+    {
+        std::ostringstream ostr;
+        Poco::Base64Encoder encoder(ostr);
+        encoder.rdbuf()->setLineLength(0);
+        encoder.write(data.data(), static_cast<std::streamsize>(data.size()));
+        encoder.close();
+        sink += static_cast<long>(ostr.str().size());
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*data.size());
+}
+BENCHMARK_ARG(base64EncoderStream, 1024);
+
+void base64Decode(Bench::State& state)
+{
+    std::string encoded = Poco::Base64::encode(benchData(static_cast<std::size_t>(state.arg())));
+    std::string decoded(Poco::Base64::maxDecodedLength(encoded.size()), '\0');
+    while (state.keepRunning())
+    {
+        sink += static_cast<long>(Poco::Base64::decode(encoded.data(), encoded.size(), &decoded[0]));
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*encoded.size());
+}
+BENCHMARK_ARG(base64Decode, 1024);
+
+void hexEncode(Bench::State& state)
+{
+    std::string data = benchData(static_cast<std::size_t>(state.arg()));
+    std::string encoded(2*data.size(), '\0');
+    while (state.keepRunning())
+    {
+        sink += static_cast<long>(Poco::HexBinary::encode(data.data(), data.size(), &encoded[0]));
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*data.size());
+}
+BENCHMARK_ARG(hexEncode, 32);
+BENCHMARK_ARG(hexEncode, 1024);
+
+void hexDecode(Bench::State& state)
+{
+    std::string encoded = Poco::HexBinary::encode(benchData(static_cast<std::size_t>(state.arg())));
+    std::string decoded(encoded.size()/2, '\0');
+    while (state.keepRunning())
+    {
+        sink += static_cast<long>(Poco::HexBinary::decode(encoded.data(), encoded.size(), &decoded[0]));
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*encoded.size());
+}
+BENCHMARK_ARG(hexDecode, 1024);
+
+// FastUTF8
+
+std::string utf8BenchData(std::size_t size)
+{
+    static const char* words[] = {"value", "Gr\xC3\xBC\xC3\x9F" "e", "\xE2\x82\xAC", "name", "\xF0\x9F\x98\x80"};
+    std::string data;
+    for (std::size_t i = 0; data.size() < size; ++i)
+    {
+        data += words[i % 5];
+        data += ' ';
+    }
+    return data;
+}
+
+void utf8Validate(Bench::State& state)
+{
+    std::string data = utf8BenchData(static_cast<std::size_t>(state.arg()));
+    while (state.keepRunning())
+    {
+        sink += Poco::FastUTF8::isValid(data) ? 1 : 0;
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*data.size());
+}
+BENCHMARK_ARG(utf8Validate, 1024);
+
+void utf8ToUTF16(Bench::State& state)
+{
+    std::string data = utf8BenchData(static_cast<std::size_t>(state.arg()));
+    Poco::UTF16String utf16;
+    while (state.keepRunning())
+    {
+        Poco::FastUTF8::convert(data, utf16);
+        sink += static_cast<long>(utf16.size());
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*data.size());
+}
+BENCHMARK_ARG(utf8ToUTF16, 1024);
+
+// DeflatingOutputStream and PooledDeflatingOutputStream
+
+void deflatingStream(Bench::State& state)
+{
+    std::string data = benchData(static_cast<std::size_t>(state.arg()));
+    while (state.keepRunning())
+    {
+        std::ostringstream ostr;
+        Poco::DeflatingOutputStream deflater(ostr);
+        deflater.write(data.data(), static_cast<std::streamsize>(data.size()));
+        deflater.close();
+        sink += static_cast<long>(ostr.tellp());
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*data.size());
+}
+BENCHMARK_ARG(deflatingStream, 256);
+
+void pooledDeflatingStream(Bench::State& state)
+{
+    std::string data = benchData(static_cast<std::size_t>(state.arg()));
+    while (state.keepRunning())
+    {
+        std::ostringstream ostr;
+        Poco::PooledDeflatingOutputStream deflater(ostr);
+        deflater.write(data.data(), static_cast<std::streamsize>(data.size()));
+        deflater.close();
+        sink += static_cast<long>(ostr.tellp());
+    }
+    state.setBytesProcessed(static_cast<Poco::UInt64>(state.iterations())*data.size());
+}
+BENCHMARK_ARG(pooledDeflatingStream, 256);
+
+// Logger
+
+Poco::Logger& benchLogger(int level)
+{
+    Poco::Logger& logger = Poco::Logger::get("bench");
+    logger.setChannel(new Poco::NullChannel);
+    logger.setLevel(level);
+    return logger;
+}
+
+void loggerFiltered(Bench::State& state)
+{
+    Poco::Logger& logger = benchLogger(Poco::Message::PRIO_ERROR);
+    while (state.keepRunning())
+    {
+        poco_information(logger, "signal strength changed");
+    }
+}
+BENCHMARK(loggerFiltered);
+
+void loggerLogged(Bench::State& state)
+{
+    Poco::Logger& logger = benchLogger(Poco::Message::PRIO_INFORMATION);
+    while (state.keepRunning())
+    {
+        poco_information(logger, "signal strength changed");
+    }
+}
+BENCHMARK(loggerLogged);
+
+void loggerFormatted(Bench::State& state)
+{
+    Poco::Logger& logger = benchLogger(Poco::Message::PRIO_INFORMATION);
+    int value = 0;
+    while (state.keepRunning())
+    {
+        logger.information("signal strength changed to %d", ++value);
+    }
+}
+BENCHMARK(loggerFormatted);
+
+// Tracer
+
+/**
+ * @brief Records a number of instant events in a thread of its own, i.e. into a new ring buffer.
+ */
+class TracerRunner : public Poco::Runnable
+{
+public:
+    TracerRunner(int events): _events(events) {}
+
+    void run()
+    {
+        static const char* names[] = {"e0", "e1", "e2", "e3", "e4", "e5", "e6", "e7", "e8", "e9"};
+        for (int i = 0; i < _events; ++i)
+        {
+            Poco::Tracer::instant("bench", names[i % 10]);
+        }
+    }
+
+private:
+    int _events;
+};
+
+/**
+ * @brief Returns true if collecting a ring buffer of 8 events, after the given number
+ * of events has been recorded, yields the expected number of events, starting with
+ * the expected event.
+ */
+bool checkTracer(int events, std::size_t expected, const char* first)
+{
+    Poco::Tracer& tracer = Poco::Tracer::instance();
+    tracer.clear();
+    tracer.setBufferSize(8);
+    TracerRunner runner(events);
+    Poco::Thread thread;
+    const std::string name = "tracer-" + Poco::NumberFormatter::format(events);
+    thread.setName(name);
+    thread.start(runner);
+    thread.join();
+
+    Poco::Tracer::Trace trace;
+    tracer.collect(trace);
+    for (std::vector<Poco::Tracer::ThreadTrace>::const_iterator it = trace.threads.begin(); it != trace.threads.end(); ++it)
+    {
+        if (it->name == name)
+        {
+            return it->events.size() == expected && trace.strings[it->events.front().name] == first;
+        }
+    }
+    return expected == 0;
+}
+
+/**
+ * @brief Checks the events collected from an exactly full ring buffer and
+ * from a ring buffer overwritten once; the oldest event of a full buffer
+ * is left out, as its thread may be writing to its slot.
+ */
+bool checkTracer()
+{
+    Poco::Tracer& tracer = Poco::Tracer::instance();
+    tracer.enable();
+    bool ok = checkTracer(7, 7, "e0") && checkTracer(8, 7, "e1") && checkTracer(9, 7, "e2");
+    tracer.disable();
+    tracer.clear();
+    tracer.setBufferSize(Poco::Tracer::DEFAULT_BUFFER_SIZE);
+    return ok;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if (!checkTracer())
+    {
+        std::fprintf(stderr, "Tracer collected wrong events from a full ring buffer\n");
+        return 1;
+    }
+    return Bench::runAll(argc, argv);
+}
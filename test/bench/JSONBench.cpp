@@ -0,0 +1,158 @@
+/**
+ * \file
+ *         JSONBench.cpp
+ * \brief
+ *         Benchmarks parsing large JSON payloads with JSON::Parser and JSON::OnDemandParser
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: json_bench [records] [iterations]
+ *
+ * A telemetry document with the given number of records (default 20000,
+ * about 4 MB) is parsed iterations times (default 10) with both parsers,
+ * once reading a single value ("lookup") and once summing a value of every
+ * record ("walk"). Every result is printed on stdout as one JSON object
+ * per line:
+ *
+ *     {"benchmark":"ondemand","access":"lookup","bytes":4194304,"iterations":10,"ms_per_doc":1.9,"mb_per_s":2105.3,"allocs_per_doc":0}
+ */
+
+#include "AllocCounter.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/JSON/OnDemandParser.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Stopwatch.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+/**
+ * @brief Builds a document with the given number of telemetry records.
+ */
+std::string payload(long records)
+{
+    std::string json("{\"vin\":\"VF3XXXXXXXX000000\",\"version\":3,\"records\":[");
+    for (long i = 0; i < records; ++i)
+    {
+        if (i > 0) json += ',';
+        json += "{\"time\":";
+        Poco::NumberFormatter::append(json, 1600000000 + i);
+        json += ",\"apn\":{\"name\":\"Public\",\"connected\":true,\"mtu\":1500},\"lte\":{\"rsrp\":";
+        Poco::NumberFormatter::append(json, static_cast<int>(-80 - i%60));
+        json += ",\"rsrq\":-11,\"sinr\":12.5,\"band\":20,\"cellId\":27446017},"
+            "\"neighbours\":[{\"pci\":101,\"rsrp\":-101},{\"pci\":214,\"rsrp\":-108}],"
+            "\"flags\":[true,false,true,true],\"operator\":null,\"note\":\"rsrp \\\"dB\\\"m\"}";
+    }
+    json += "]}";
+    return json;
+}
+
+/**
+ * @brief Prints the result of one benchmark as a JSON line.
+ */
+void report(const char* benchmark, const char* access, std::size_t bytes, long iterations, Poco::Clock::ClockDiff elapsedUs, unsigned long allocs)
+{
+    const double ms  = elapsedUs/1000.0/iterations;
+    const double mbs = elapsedUs > 0 ? static_cast<double>(bytes)*iterations/elapsedUs : 0.0;
+    std::printf("{\"benchmark\":\"%s\",\"access\":\"%s\",\"bytes\":%lu,\"iterations\":%ld,\"ms_per_doc\":%.2f,\"mb_per_s\":%.1f,\"allocs_per_doc\":%g}\n",
+        benchmark, access, static_cast<unsigned long>(bytes), iterations, ms, mbs, static_cast<double>(allocs)/iterations);
+}
+
+/**
+ * @brief Parses the document into Object/Array/Var with JSON::Parser.
+ */
+void benchParser(const std::string& json, long iterations, bool walk)
+{
+    Poco::JSON::Parser parser;
+    long sum = 0;
+    Poco::Stopwatch sw;
+    const unsigned long allocs = Bench::allocations();
+    sw.start();
+    for (long i = 0; i < iterations; ++i)
+    {
+        parser.reset();
+        Poco::Dynamic::Var result = parser.parse(json);
+        Poco::JSON::Array::Ptr pRecords = result.extract<Poco::JSON::Object::Ptr>()->getArray("records");
+        if (walk)
+        {
+            for (std::size_t r = 0; r < pRecords->size(); ++r)
+            {
+                sum += pRecords->getObject(static_cast<unsigned>(r))->getObject("lte")->getValue<int>("rsrp");
+            }
+        }
+        else
+        {
+            sum += pRecords->getObject(static_cast<unsigned>(pRecords->size() - 1))->getObject("lte")->getValue<int>("rsrp");
+        }
+    }
+    sw.stop();
+    report("parser", walk ? "walk" : "lookup", json.size(), iterations, sw.elapsed(), Bench::allocations() - allocs);
+    if (sum == 0) std::printf("{\"error\":\"unexpected sum\"}\n");
+}
+
+/**
+ * @brief Indexes the document with JSON::OnDemandParser and reads values on demand.
+ */
+void benchOnDemand(const std::string& json, long iterations, bool walk)
+{
+    Poco::JSON::OnDemandParser parser;
+    long sum = 0;
+    Poco::Stopwatch sw;
+    const unsigned long allocs = Bench::allocations();
+    sw.start();
+    for (long i = 0; i < iterations; ++i)
+    {
+        Poco::JSON::OnDemandValue records = parser.parse(json)["records"];
+        if (walk)
+        {
+            for (Poco::JSON::OnDemandValue::Iterator it = records.begin(); it.valid(); ++it)
+            {
+                sum += static_cast<long>(it.value()["lte"]["rsrp"].getInt64());
+            }
+        }
+        else
+        {
+            Poco::JSON::OnDemandValue last;
+            for (Poco::JSON::OnDemandValue::Iterator it = records.begin(); it.valid(); ++it)
+            {
+                last = it.value();
+            }
+            sum += static_cast<long>(last["lte"]["rsrp"].getInt64());
+        }
+    }
+    sw.stop();
+    report("ondemand", walk ? "walk" : "lookup", json.size(), iterations, sw.elapsed(), Bench::allocations() - allocs);
+    if (sum == 0) std::printf("{\"error\":\"unexpected sum\"}\n");
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    long records = argc > 1 ? std::atol(argv[1]) : 20000;
+    if (records <= 0) records = 20000;
+    long iterations = argc > 2 ? std::atol(argv[2]) : 10;
+    if (iterations <= 0) iterations = 10;
+
+    const std::string json = payload(records);
+
+    benchParser(json, iterations, false);
+    benchParser(json, iterations, true);
+    // the first parse sizes the index buffers of the parser
+    benchOnDemand(json, 1, false);
+    benchOnDemand(json, iterations, false);
+    benchOnDemand(json, iterations, true);
+    return 0;
+}
@@ -0,0 +1,888 @@
+/**
+ * \file
+ *         RemotingLoadBench.cpp
+ * \brief
+ *         Load generator and latency benchmark for the RemotingNG TCP transport
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: remoting_load [--mode=both|server|client] [--endpoint=host:port] [--uri=uri]
+ *                      [--proxies=n] [--connections=m] [--traffic=request|oneway|event|all]
+ *                      [--duration=seconds] [--rate=n] [--payload=bytes] [--events=n]
+ *
+ * Drives a test service registered with a TCP::Listener from n clients sharing
+ * m connections (one ConnectionManager per connection):
+ *
+ *   - request: request/reply calls of echo(payload), paced at --rate calls per second
+ *     and client (0: as fast as possible), for --duration seconds.
+ *   - oneway:  oneway calls of post(payload) (FRAME_FLAG_ONEWAY), paced and timed like
+ *     request. The phase ends when the server has received all posted messages.
+ *   - event:   every client subscribes to the tick event, then the server fires --events
+ *     oneway events (FRAME_TYPE_EVNT) at --rate events per second, each delivered to all
+ *     subscribers.
+ *
+ * Every phase is printed on stdout as one JSON object per line:
+ *
+ *     {"benchmark":"remoting_load","traffic":"request","proxies":8,"connections":2,"payload":64,"rate":0,"seconds":5.00,"operations":412345,"errors":0,"ops_per_s":82469,"ns_per_op":12125.7,"p50_us":92.0,"p99_us":240.0,"p999_us":720.0,"max_us":3904.0,"server_cpu_percent":143.2}
+ *
+ * Latencies are measured from the time a call was scheduled (not from the time it
+ * was actually sent), so a server that cannot keep up with the configured rate shows
+ * up in the percentiles. Event latencies compare the clocks of client and server and
+ * are only meaningful if both run on the same host. server_cpu_percent is the CPU time
+ * of the server process during the phase, relative to the wall time; with --mode=both
+ * it includes the clients.
+ *
+ * --mode=server registers the service at --endpoint, prints its URI and runs until
+ * SIGINT or SIGTERM; --mode=client runs the clients against the given --uri.
+ *
+ * The service is written the way the RemotingNG code generator writes a service: a
+ * RemoteObject, a Skeleton with one MethodHandler per method, and an EventDispatcher.
+ * The client mirrors the generated Proxy and EventSubscriber, but owns its Transport,
+ * so that it can be bound to a given ConnectionManager.
+ */
+
+#include "Poco/RemotingNG/ORB.h"
+#include "Poco/RemotingNG/RemoteObject.h"
+#include "Poco/RemotingNG/Skeleton.h"
+#include "Poco/RemotingNG/MethodHandler.h"
+#include "Poco/RemotingNG/EventDispatcher.h"
+#include "Poco/RemotingNG/EventSubscriber.h"
+#include "Poco/RemotingNG/ServerTransport.h"
+#include "Poco/RemotingNG/TypeSerializer.h"
+#include "Poco/RemotingNG/TypeDeserializer.h"
+#include "Poco/RemotingNG/URIUtility.h"
+#include "Poco/RemotingNG/TCP/Listener.h"
+#include "Poco/RemotingNG/TCP/Transport.h"
+#include "Poco/RemotingNG/TCP/TransportFactory.h"
+#include "Poco/RemotingNG/TCP/ConnectionManager.h"
+#include "Poco/LatencyHistogram.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Clock.h"
+#include "Poco/Mutex.h"
+#include "Poco/Exception.h"
+#include <sys/resource.h>
+#include <signal.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Poco::RemotingNG;
+
+namespace {
+
+const std::string TYPE_ID("Stla.Bench.LoadTestService");
+const std::string OBJECT_ID("load");
+
+const std::string METHOD_ENABLE_EVENTS("remoting__enableEvents");
+const std::string METHOD_ECHO("echo");
+const std::string METHOD_POST("post");
+const std::string METHOD_EMIT("emit");
+const std::string METHOD_STATS("stats");
+const std::string EVENT_TICK("tick");
+
+/**
+ * @brief Returns the CPU time (user and system) of this process in microseconds.
+ */
+Poco::Int64 processCpuTime()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<Poco::Int64>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)*1000000
+        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/**
+ * @brief Waits until the given time, sleeping for longer waits and spinning for the rest.
+ */
+void waitUntil(const Poco::Clock& time)
+{
+    for (;;)
+    {
+        Poco::Clock::ClockDiff remaining = time - Poco::Clock();
+        if (remaining <= 0) return;
+        if (remaining > 2000) Poco::Thread::sleep(static_cast<long>(remaining/1000 - 1));
+        else Poco::Thread::yield();
+    }
+}
+
+// server
+
+class LoadTestRemoteObject;
+
+/**
+ * Sends the tick event of the test service to all subscribers.
+ */
+class LoadTestEventDispatcher: public EventDispatcher
+{
+public:
+    LoadTestEventDispatcher(LoadTestRemoteObject* pRemoteObject, const std::string& protocol);
+
+    /**
+     * @brief Sends a tick event to every subscriber. Returns the number of subscribers reached.
+     */
+    int tick(Poco::Int64 sentAt, const std::string& payload);
+
+private:
+    void tickImpl(const std::string& subscriberURI, Poco::Int64 sentAt, const std::string& payload);
+
+    LoadTestRemoteObject* _pRemoteObject;
+};
+
+/**
+ * The test service. Holds the counters queried by the clients with stats().
+ */
+class LoadTestRemoteObject: public RemoteObject
+{
+public:
+    typedef Poco::AutoPtr<LoadTestRemoteObject> Ptr;
+
+    LoadTestRemoteObject():
+        RemoteObject(OBJECT_ID)
+    {
+    }
+
+    const Identifiable::TypeId& remoting__typeId() const
+    {
+        return TYPE_ID;
+    }
+
+    bool remoting__hasEvents() const
+    {
+        return true;
+    }
+
+    void remoting__enableRemoteEvents(const std::string& protocol)
+    {
+        EventDispatcher::Ptr pDispatcher = new LoadTestEventDispatcher(this, protocol);
+        ORB::instance().registerEventDispatcher(remoting__getURI().toString(), pDispatcher);
+    }
+
+    std::string echo(const std::string& payload)
+    {
+        return payload;
+    }
+
+    void post(const std::string& /*payload*/)
+    {
+        ++_posted;
+    }
+
+    /**
+     * @brief Fires count tick events at the given rate per second (0: as fast as possible).
+     */
+    void emit(Poco::Int32 count, Poco::Int32 payloadSize, Poco::Int32 rate)
+    {
+        EventDispatcher::Ptr pDispatcher = ORB::instance().findEventDispatcher(remoting__getURI().toString(), TCP::Transport::PROTOCOL);
+        LoadTestEventDispatcher* pTicks = static_cast<LoadTestEventDispatcher*>(pDispatcher.get());
+        const std::string payload(static_cast<std::size_t>(payloadSize), 'e');
+        const Poco::Clock start;
+        const Poco::Clock::ClockDiff interval = rate > 0 ? 1000000/rate : 0;
+        for (Poco::Int32 i = 0; i < count; ++i)
+        {
+            if (interval) waitUntil(start + i*interval);
+            pTicks->tick(Poco::Clock().raw(), payload);
+        }
+    }
+
+    Poco::Int64 posted() const
+    {
+        return _posted.value();
+    }
+
+private:
+    Poco::AtomicCounter _posted;
+};
+
+LoadTestEventDispatcher::LoadTestEventDispatcher(LoadTestRemoteObject* pRemoteObject, const std::string& protocol):
+    EventDispatcher(protocol),
+    _pRemoteObject(pRemoteObject)
+{
+}
+
+int LoadTestEventDispatcher::tick(Poco::Int64 sentAt, const std::string& payload)
+{
+    Poco::FastMutex::ScopedLock lock(_mutex);
+    int reached = 0;
+    for (SubscriberMap::iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+    {
+        try
+        {
+            tickImpl(it->first, sentAt, payload);
+            ++reached;
+        }
+        catch (Poco::Exception& exc)
+        {
+            std::fprintf(stderr, "tick to %s failed: %s\n", it->first.c_str(), exc.displayText().c_str());
+        }
+    }
+    return reached;
+}
+
+void LoadTestEventDispatcher::tickImpl(const std::string& subscriberURI, Poco::Int64 sentAt, const std::string& payload)
+{
+    Transport& trans = transportForSubscriber(subscriberURI);
+    Poco::ScopedLock<Transport> lock(trans);
+    Serializer& ser = trans.beginMessage(_pRemoteObject->remoting__objectId(), _pRemoteObject->remoting__typeId(), EVENT_TICK, SerializerBase::MESSAGE_EVENT);
+    ser.serializeMessageBegin(EVENT_TICK, SerializerBase::MESSAGE_EVENT);
+    TypeSerializer<Poco::Int64>::serialize("sentAt", sentAt, ser);
+    TypeSerializer<std::string>::serialize("payload", payload, ser);
+    ser.serializeMessageEnd(EVENT_TICK, SerializerBase::MESSAGE_EVENT);
+    trans.sendMessage(_pRemoteObject->remoting__objectId(), _pRemoteObject->remoting__typeId(), EVENT_TICK, SerializerBase::MESSAGE_EVENT);
+}
+
+/**
+ * @brief Sends an empty reply, or the value of a method returning something.
+ */
+template <typename T>
+void reply(ServerTransport& trans, const std::string& method, const T* pValue)
+{
+    const std::string name(method + "Reply");
+    Serializer& ser = trans.sendReply(SerializerBase::MESSAGE_REPLY);
+    ser.serializeMessageBegin(name, SerializerBase::MESSAGE_REPLY);
+    if (pValue) TypeSerializer<T>::serialize("return", *pValue, ser);
+    ser.serializeMessageEnd(name, SerializerBase::MESSAGE_REPLY);
+}
+
+class EnableEventsMethodHandler: public MethodHandler
+{
+public:
+    void invoke(ServerTransport& trans, Deserializer& deser, RemoteObject::Ptr pRemoteObject)
+    {
+        bool enable = false;
+        std::string eventURI;
+        deser.deserializeMessageBegin(METHOD_ENABLE_EVENTS, SerializerBase::MESSAGE_REQUEST);
+        TypeDeserializer<bool>::deserialize("enable", true, deser, enable);
+        TypeDeserializer<std::string>::deserialize("eventURI", true, deser, eventURI);
+        deser.deserializeMessageEnd(METHOD_ENABLE_EVENTS, SerializerBase::MESSAGE_REQUEST);
+        EventDispatcher::Ptr pDispatcher = ORB::instance().findEventDispatcher(pRemoteObject->remoting__getURI().toString(), TCP::Transport::PROTOCOL);
+        if (enable)
+            pDispatcher->subscribe(eventURI, eventURI);
+        else
+            pDispatcher->unsubscribe(eventURI);
+        reply<bool>(trans, METHOD_ENABLE_EVENTS, 0);
+    }
+};
+
+class EchoMethodHandler: public MethodHandler
+{
+public:
+    void invoke(ServerTransport& trans, Deserializer& deser, RemoteObject::Ptr pRemoteObject)
+    {
+        std::string payload;
+        deser.deserializeMessageBegin(METHOD_ECHO, SerializerBase::MESSAGE_REQUEST);
+        TypeDeserializer<std::string>::deserialize("payload", true, deser, payload);
+        deser.deserializeMessageEnd(METHOD_ECHO, SerializerBase::MESSAGE_REQUEST);
+        std::string result = static_cast<LoadTestRemoteObject*>(pRemoteObject.get())->echo(payload);
+        reply(trans, METHOD_ECHO, &result);
+    }
+};
+
+class PostMethodHandler: public MethodHandler
+{
+public:
+    void invoke(ServerTransport& /*trans*/, Deserializer& deser, RemoteObject::Ptr pRemoteObject)
+    {
+        std::string payload;
+        deser.deserializeMessageBegin(METHOD_POST, SerializerBase::MESSAGE_REQUEST);
+        TypeDeserializer<std::string>::deserialize("payload", true, deser, payload);
+        deser.deserializeMessageEnd(METHOD_POST, SerializerBase::MESSAGE_REQUEST);
+        static_cast<LoadTestRemoteObject*>(pRemoteObject.get())->post(payload);
+    }
+};
+
+class EmitMethodHandler: public MethodHandler
+{
+public:
+    void invoke(ServerTransport& /*trans*/, Deserializer& deser, RemoteObject::Ptr pRemoteObject)
+    {
+        Poco::Int32 count = 0;
+        Poco::Int32 payloadSize = 0;
+        Poco::Int32 rate = 0;
+        deser.deserializeMessageBegin(METHOD_EMIT, SerializerBase::MESSAGE_REQUEST);
+        TypeDeserializer<Poco::Int32>::deserialize("count", true, deser, count);
+        TypeDeserializer<Poco::Int32>::deserialize("payloadSize", true, deser, payloadSize);
+        TypeDeserializer<Poco::Int32>::deserialize("rate", true, deser, rate);
+        deser.deserializeMessageEnd(METHOD_EMIT, SerializerBase::MESSAGE_REQUEST);
+        static_cast<LoadTestRemoteObject*>(pRemoteObject.get())->emit(count, payloadSize, rate);
+    }
+};
+
+class StatsMethodHandler: public MethodHandler
+{
+public:
+    void invoke(ServerTransport& trans, Deserializer& deser, RemoteObject::Ptr pRemoteObject)
+    {
+        deser.deserializeMessageBegin(METHOD_STATS, SerializerBase::MESSAGE_REQUEST);
+        deser.deserializeMessageEnd(METHOD_STATS, SerializerBase::MESSAGE_REQUEST);
+        std::vector<Poco::Int64> stats;
+        stats.push_back(static_cast<LoadTestRemoteObject*>(pRemoteObject.get())->posted());
+        stats.push_back(processCpuTime());
+        reply(trans, METHOD_STATS, &stats);
+    }
+};
+
+class LoadTestSkeleton: public Skeleton
+{
+public:
+    LoadTestSkeleton()
+    {
+        addMethodHandler(METHOD_ENABLE_EVENTS, new EnableEventsMethodHandler);
+        addMethodHandler(METHOD_ECHO, new EchoMethodHandler);
+        addMethodHandler(METHOD_POST, new PostMethodHandler);
+        addMethodHandler(METHOD_EMIT, new EmitMethodHandler);
+        addMethodHandler(METHOD_STATS, new StatsMethodHandler);
+    }
+};
+
+/**
+ * @brief Registers the test service with a new TCP::Listener at endpoint. Returns the URI of the service.
+ */
+std::string startServer(const std::string& endpoint)
+{
+    TCP::TransportFactory::registerFactory();
+    std::string listenerId = ORB::instance().registerListener(new TCP::Listener(endpoint));
+    ORB::instance().registerSkeleton(TYPE_ID, new LoadTestSkeleton);
+    return ORB::instance().registerObject(new LoadTestRemoteObject, listenerId);
+}
+
+// client
+
+/**
+ * Results of one phase, shared by all clients.
+ */
+struct Results
+{
+    Results():
+        errors(0)
+    {
+    }
+
+    Poco::LatencyHistogram latency;
+    Poco::AtomicCounter operations;
+    Poco::AtomicCounter errors;
+    Poco::FastMutex mutex;
+    std::string firstError;
+
+    void error(const Poco::Exception& exc)
+    {
+        if (++errors == 1)
+        {
+            Poco::FastMutex::ScopedLock lock(mutex);
+            firstError = exc.displayText();
+        }
+    }
+};
+
+class TickMethodHandler: public MethodHandler
+{
+public:
+    explicit TickMethodHandler(Results*& pResults):
+        _pResults(pResults)
+    {
+    }
+
+    void invoke(ServerTransport& /*trans*/, Deserializer& deser, RemoteObject::Ptr /*pRemoteObject*/)
+    {
+        Poco::Int64 sentAt = 0;
+        std::string payload;
+        deser.deserializeMessageBegin(EVENT_TICK, SerializerBase::MESSAGE_EVENT);
+        TypeDeserializer<Poco::Int64>::deserialize("sentAt", true, deser, sentAt);
+        TypeDeserializer<std::string>::deserialize("payload", true, deser, payload);
+        deser.deserializeMessageEnd(EVENT_TICK, SerializerBase::MESSAGE_EVENT);
+        Poco::Int64 latency = Poco::Clock().raw() - sentAt;
+        if (Results* pResults = _pResults)
+        {
+            pResults->latency.record(latency > 0 ? static_cast<Poco::UInt64>(latency)*1000 : 0);
+            ++pResults->operations;
+        }
+    }
+
+private:
+    Results*& _pResults;
+};
+
+class LoadTestEventSubscriber: public EventSubscriber
+{
+public:
+    typedef Poco::AutoPtr<LoadTestEventSubscriber> Ptr;
+
+    LoadTestEventSubscriber(const std::string& uri, Results*& pResults):
+        EventSubscriber(uri)
+    {
+        addMethodHandler(EVENT_TICK, new TickMethodHandler(pResults));
+    }
+};
+
+/**
+ * A client of the test service, with its own Transport on the given ConnectionManager.
+ */
+class LoadTestClient
+{
+public:
+    LoadTestClient(TCP::ConnectionManager& connectionManager, const std::string& uri):
+        _uri(uri),
+        _pTransport(new TCP::Transport(connectionManager)),
+        _pResults(0)
+    {
+        std::string protocol;
+        URIUtility::parseURIPath(Poco::URI(uri).getPath(), _oid, _tid, protocol);
+        _pTransport->connect(uri);
+    }
+
+    ~LoadTestClient()
+    {
+        try
+        {
+            _pTransport->disconnect();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    std::string echo(const std::string& payload)
+    {
+        Poco::ScopedLock<Transport> lock(*_pTransport);
+        Serializer& ser = _pTransport->beginRequest(_oid, _tid, METHOD_ECHO, SerializerBase::MESSAGE_REQUEST);
+        ser.serializeMessageBegin(METHOD_ECHO, SerializerBase::MESSAGE_REQUEST);
+        TypeSerializer<std::string>::serialize("payload", payload, ser);
+        ser.serializeMessageEnd(METHOD_ECHO, SerializerBase::MESSAGE_REQUEST);
+        std::string result;
+        receiveReply(METHOD_ECHO, &result);
+        return result;
+    }
+
+    void post(const std::string& payload)
+    {
+        Poco::ScopedLock<Transport> lock(*_pTransport);
+        Serializer& ser = _pTransport->beginMessage(_oid, _tid, METHOD_POST, SerializerBase::MESSAGE_REQUEST);
+        ser.serializeMessageBegin(METHOD_POST, SerializerBase::MESSAGE_REQUEST);
+        TypeSerializer<std::string>::serialize("payload", payload, ser);
+        ser.serializeMessageEnd(METHOD_POST, SerializerBase::MESSAGE_REQUEST);
+        _pTransport->sendMessage(_oid, _tid, METHOD_POST, SerializerBase::MESSAGE_REQUEST);
+    }
+
+    void emit(Poco::Int32 count, Poco::Int32 payloadSize, Poco::Int32 rate)
+    {
+        Poco::ScopedLock<Transport> lock(*_pTransport);
+        Serializer& ser = _pTransport->beginMessage(_oid, _tid, METHOD_EMIT, SerializerBase::MESSAGE_REQUEST);
+        ser.serializeMessageBegin(METHOD_EMIT, SerializerBase::MESSAGE_REQUEST);
+        TypeSerializer<Poco::Int32>::serialize("count", count, ser);
+        TypeSerializer<Poco::Int32>::serialize("payloadSize", payloadSize, ser);
+        TypeSerializer<Poco::Int32>::serialize("rate", rate, ser);
+        ser.serializeMessageEnd(METHOD_EMIT, SerializerBase::MESSAGE_REQUEST);
+        _pTransport->sendMessage(_oid, _tid, METHOD_EMIT, SerializerBase::MESSAGE_REQUEST);
+    }
+
+    /**
+     * @brief Returns the number of posted messages received by the server, and its CPU time in microseconds.
+     */
+    void stats(Poco::Int64& posted, Poco::Int64& cpuTime)
+    {
+        Poco::ScopedLock<Transport> lock(*_pTransport);
+        Serializer& ser = _pTransport->beginRequest(_oid, _tid, METHOD_STATS, SerializerBase::MESSAGE_REQUEST);
+        ser.serializeMessageBegin(METHOD_STATS, SerializerBase::MESSAGE_REQUEST);
+        ser.serializeMessageEnd(METHOD_STATS, SerializerBase::MESSAGE_REQUEST);
+        std::vector<Poco::Int64> result;
+        receiveReply(METHOD_STATS, &result);
+        posted = result.size() > 0 ? result[0] : 0;
+        cpuTime = result.size() > 1 ? result[1] : 0;
+    }
+
+    /**
+     * @brief Subscribes to or unsubscribes from the tick event. Ticks are recorded in the Results set with setResults().
+     */
+    void enableEvents(TCP::Listener::Ptr pListener, bool enable)
+    {
+        if (enable && !_pSubscriber)
+        {
+            _pSubscriber = new LoadTestEventSubscriber(_uri, _pResults);
+            _eventURI = pListener->subscribeToEvents(_pSubscriber);
+        }
+        if (!_pSubscriber) return;
+        {
+            Poco::ScopedLock<Transport> lock(*_pTransport);
+            Serializer& ser = _pTransport->beginRequest(_oid, _tid, METHOD_ENABLE_EVENTS, SerializerBase::MESSAGE_REQUEST);
+            ser.serializeMessageBegin(METHOD_ENABLE_EVENTS, SerializerBase::MESSAGE_REQUEST);
+            TypeSerializer<bool>::serialize("enable", enable, ser);
+            TypeSerializer<std::string>::serialize("eventURI", _eventURI, ser);
+            ser.serializeMessageEnd(METHOD_ENABLE_EVENTS, SerializerBase::MESSAGE_REQUEST);
+            receiveReply<bool>(METHOD_ENABLE_EVENTS, 0);
+        }
+        if (!enable)
+        {
+            pListener->unsubscribeFromEvents(_pSubscriber);
+            _pSubscriber = 0;
+        }
+    }
+
+    void setResults(Results* pResults)
+    {
+        _pResults = pResults;
+    }
+
+private:
+    template <typename T>
+    void receiveReply(const std::string& method, T* pValue)
+    {
+        const std::string name(method + "Reply");
+        try
+        {
+            Deserializer& deser = _pTransport->sendRequest(_oid, _tid, method, SerializerBase::MESSAGE_REQUEST);
+            deser.deserializeMessageBegin(name, SerializerBase::MESSAGE_REPLY);
+            if (pValue) TypeDeserializer<T>::deserialize("return", true, deser, *pValue);
+            deser.deserializeMessageEnd(name, SerializerBase::MESSAGE_REPLY);
+        }
+        catch (...)
+        {
+            _pTransport->endRequest();
+            throw;
+        }
+        _pTransport->endRequest();
+    }
+
+    LoadTestClient(const LoadTestClient&);
+    LoadTestClient& operator = (const LoadTestClient&);
+
+    std::string _uri;
+    Identifiable::ObjectId _oid;
+    Identifiable::TypeId _tid;
+    Poco::AutoPtr<TCP::Transport> _pTransport;
+    LoadTestEventSubscriber::Ptr _pSubscriber;
+    std::string _eventURI;
+    Results* _pResults;
+};
+
+struct Options
+{
+    Options():
+        mode("both"),
+        endpoint("127.0.0.1:7979"),
+        proxies(8),
+        connections(2),
+        traffic("all"),
+        duration(5.0),
+        rate(0),
+        payload(64),
+        events(100000)
+    {
+    }
+
+    std::string mode;
+    std::string endpoint;
+    std::string uri;
+    int proxies;
+    int connections;
+    std::string traffic;
+    double duration;
+    int rate;
+    int payload;
+    int events;
+};
+
+/**
+ * Calls echo() or post() on one client until the deadline, paced at the configured rate.
+ */
+class Worker: public Poco::Runnable
+{
+public:
+    Worker(LoadTestClient& client, const Options& options, bool oneway, Results& results):
+        _client(client),
+        _options(options),
+        _oneway(oneway),
+        _results(results)
+    {
+    }
+
+    void run()
+    {
+        const std::string payload(static_cast<std::size_t>(_options.payload), 'p');
+        const Poco::Clock start;
+        const Poco::Clock deadline(start + static_cast<Poco::Clock::ClockDiff>(_options.duration*1000000));
+        const Poco::Clock::ClockDiff interval = _options.rate > 0 ? 1000000/_options.rate : 0;
+        for (Poco::Int64 i = 0; ; ++i)
+        {
+            Poco::Clock scheduled(start + i*interval);
+            if (interval) waitUntil(scheduled);
+            else scheduled.update();
+            if (scheduled >= deadline) break;
+            try
+            {
+                if (_oneway) _client.post(payload);
+                else _client.echo(payload);
+                ++_results.operations;
+            }
+            catch (Poco::Exception& exc)
+            {
+                _results.error(exc);
+            }
+            Poco::Clock::ClockDiff latency = Poco::Clock() - scheduled;
+            _results.latency.record(latency > 0 ? static_cast<Poco::UInt64>(latency)*1000 : 0);
+        }
+    }
+
+private:
+    LoadTestClient& _client;
+    const Options& _options;
+    bool _oneway;
+    Results& _results;
+};
+
+void report(const Options& options, const std::string& traffic, const Results& results, double seconds, double serverCpuSeconds)
+{
+    double operations = static_cast<double>(results.operations.value());
+    if (seconds <= 0) seconds = 1e-6;
+    std::printf("{\"benchmark\":\"remoting_load\",\"traffic\":\"%s\",\"proxies\":%d,\"connections\":%d,\"payload\":%d,\"rate\":%d"
+        ",\"seconds\":%.2f,\"operations\":%.0f,\"errors\":%d,\"ops_per_s\":%.0f,\"ns_per_op\":%.1f"
+        ",\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f,\"server_cpu_percent\":%.1f}\n",
+        traffic.c_str(), options.proxies, options.connections, options.payload, options.rate,
+        seconds, operations, results.errors.value(), operations/seconds, operations > 0 ? 1e9*seconds/operations : 0.0,
+        results.latency.percentile(0.5)/1000.0, results.latency.percentile(0.99)/1000.0,
+        results.latency.percentile(0.999)/1000.0, results.latency.max()/1000.0,
+        100.0*serverCpuSeconds/seconds);
+    std::fflush(stdout);
+    if (results.errors.value()) std::fprintf(stderr, "%s: %d errors, first: %s\n", traffic.c_str(), results.errors.value(), results.firstError.c_str());
+}
+
+/**
+ * @brief Waits until get() returns expected, or stops changing for two seconds. Returns the time of the last change.
+ */
+template <typename Get>
+Poco::Clock waitForCompletion(Get get, Poco::Int64 expected)
+{
+    Poco::Int64 last = get();
+    Poco::Clock lastChange;
+    while (last < expected && lastChange.elapsed() < 2000000)
+    {
+        Poco::Thread::sleep(10);
+        Poco::Int64 current = get();
+        if (current != last)
+        {
+            last = current;
+            lastChange.update();
+        }
+    }
+    return lastChange;
+}
+
+class Clients
+{
+public:
+    Clients(const Options& options, const std::string& uri):
+        _options(options)
+    {
+        for (int i = 0; i < options.connections; ++i)
+        {
+            _managers.push_back(new TCP::ConnectionManager);
+            _listeners.push_back(new TCP::Listener(*_managers.back()));
+        }
+        for (int i = 0; i < options.proxies; ++i)
+        {
+            _clients.push_back(new LoadTestClient(*_managers[i % options.connections], uri));
+        }
+    }
+
+    ~Clients()
+    {
+        for (std::size_t i = 0; i < _clients.size(); ++i) delete _clients[i];
+        for (std::size_t i = 0; i < _managers.size(); ++i)
+        {
+            _managers[i]->shutdown();
+            delete _managers[i];
+        }
+    }
+
+    void runCalls(bool oneway)
+    {
+        Results results;
+        Poco::Int64 postedBefore = 0;
+        Poco::Int64 cpuBefore = 0;
+        _clients[0]->stats(postedBefore, cpuBefore);
+
+        std::vector<Worker*> workers;
+        std::vector<Poco::Thread*> threads;
+        const Poco::Clock start;
+        for (std::size_t i = 0; i < _clients.size(); ++i)
+        {
+            workers.push_back(new Worker(*_clients[i], _options, oneway, results));
+            threads.push_back(new Poco::Thread);
+            threads.back()->start(*workers.back());
+        }
+        for (std::size_t i = 0; i < threads.size(); ++i)
+        {
+            threads[i]->join();
+            delete threads[i];
+            delete workers[i];
+        }
+        Poco::Clock end;
+        if (oneway)
+        {
+            PostedCount posted(*_clients[0], postedBefore);
+            end = waitForCompletion(posted, results.operations.value());
+        }
+
+        Poco::Int64 postedAfter = 0;
+        Poco::Int64 cpuAfter = 0;
+        _clients[0]->stats(postedAfter, cpuAfter);
+        report(_options, oneway ? "oneway" : "request", results, (end - start)/1e6, (cpuAfter - cpuBefore)/1e6);
+    }
+
+    void runEvents()
+    {
+        Results results;
+        for (std::size_t i = 0; i < _clients.size(); ++i)
+        {
+            _clients[i]->setResults(&results);
+            _clients[i]->enableEvents(_listeners[i % _listeners.size()], true);
+        }
+        Poco::Int64 posted = 0;
+        Poco::Int64 cpuBefore = 0;
+        _clients[0]->stats(posted, cpuBefore);
+
+        const Poco::Clock start;
+        _clients[0]->emit(_options.events, _options.payload, _options.rate);
+        ReceivedCount received(results);
+        Poco::Clock end = waitForCompletion(received, static_cast<Poco::Int64>(_options.events)*_options.proxies);
+
+        Poco::Int64 cpuAfter = 0;
+        _clients[0]->stats(posted, cpuAfter);
+        for (std::size_t i = 0; i < _clients.size(); ++i)
+        {
+            _clients[i]->enableEvents(_listeners[i % _listeners.size()], false);
+            _clients[i]->setResults(0);
+        }
+        report(_options, "event", results, (end - start)/1e6, (cpuAfter - cpuBefore)/1e6);
+    }
+
+private:
+    struct PostedCount
+    {
+        PostedCount(LoadTestClient& client, Poco::Int64 before):
+            pClient(&client),
+            postedBefore(before)
+        {
+        }
+
+        Poco::Int64 operator () () const
+        {
+            Poco::Int64 posted = 0;
+            Poco::Int64 cpuTime = 0;
+            pClient->stats(posted, cpuTime);
+            return posted - postedBefore;
+        }
+
+        LoadTestClient* pClient;
+        Poco::Int64 postedBefore;
+    };
+
+    struct ReceivedCount
+    {
+        explicit ReceivedCount(const Results& r):
+            pResults(&r)
+        {
+        }
+
+        Poco::Int64 operator () () const
+        {
+            return pResults->operations.value();
+        }
+
+        const Results* pResults;
+    };
+
+    Clients(const Clients&);
+    Clients& operator = (const Clients&);
+
+    const Options& _options;
+    std::vector<TCP::ConnectionManager*> _managers;
+    std::vector<TCP::Listener::Ptr> _listeners;
+    std::vector<LoadTestClient*> _clients;
+};
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = std::strchr(arg, '=');
+        if (std::strncmp(arg, "--", 2) != 0 || !value) return false;
+        std::string name(arg + 2, value++);
+        if (name == "mode") options.mode = value;
+        else if (name == "endpoint") options.endpoint = value;
+        else if (name == "uri") options.uri = value;
+        else if (name == "proxies") options.proxies = std::atoi(value);
+        else if (name == "connections") options.connections = std::atoi(value);
+        else if (name == "traffic") options.traffic = value;
+        else if (name == "duration") options.duration = std::atof(value);
+        else if (name == "rate") options.rate = std::atoi(value);
+        else if (name == "payload") options.payload = std::atoi(value);
+        else if (name == "events") options.events = std::atoi(value);
+        else return false;
+    }
+    if (options.mode != "both" && options.mode != "server" && options.mode != "client") return false;
+    if (options.mode == "client" && options.uri.empty()) return false;
+    if (options.proxies < 1 || options.connections < 1 || options.payload < 0 || options.rate < 0) return false;
+    if (options.connections > options.proxies) options.connections = options.proxies;
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr,
+            "usage: %s [--mode=both|server|client] [--endpoint=host:port] [--uri=uri]\n"
+            "       [--proxies=n] [--connections=m] [--traffic=request|oneway|event|all]\n"
+            "       [--duration=seconds] [--rate=n] [--payload=bytes] [--events=n]\n", argv[0]);
+        return 2;
+    }
+
+    try
+    {
+        // block the signals before the server threads are started, so that they inherit the mask
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        if (options.mode == "server") pthread_sigmask(SIG_BLOCK, &signals, 0);
+
+        std::string uri(options.uri);
+        if (options.mode != "client") uri = startServer(options.endpoint);
+        if (options.mode == "server")
+        {
+            std::printf("%s\n", uri.c_str());
+            std::fflush(stdout);
+            int signal = 0;
+            sigwait(&signals, &signal);
+        }
+        else
+        {
+            Clients clients(options, uri);
+            if (options.traffic == "all" || options.traffic == "request") clients.runCalls(false);
+            if (options.traffic == "all" || options.traffic == "oneway") clients.runCalls(true);
+            if (options.traffic == "all" || options.traffic == "event") clients.runEvents();
+        }
+        ORB::instance().shutdown();
+    }
+    catch (Poco::Exception& exc)
+    {
+        std::fprintf(stderr, "%s\n", exc.displayText().c_str());
+        return 1;
+    }
+    return 0;
+}
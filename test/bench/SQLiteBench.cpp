@@ -0,0 +1,180 @@
+/**
+ * \file
+ *         SQLiteBench.cpp
+ * \brief
+ *         Benchmarks reading stored LteMetrics rows with RecordSet and ColumnarCursor
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: sqlite_bench [rows]
+ *
+ * An in-memory table with one LteMetrics sample per row is filled, and the
+ * average RSRP is computed by reading all rows through a RecordSet (boxed in
+ * Dynamic::Var), with ColumnarCursor::fetchAll() into typed vectors, and with
+ * ColumnarCursor::fetch() in bounded batches. Every result is printed on
+ * stdout as one JSON object per line:
+ *
+ *     {"benchmark":"columnar_batch","rows":100000,"ns_per_row":52.3,"rows_per_s":19120458,"allocs_per_row":0.001,"resident_rows":4096}
+ *
+ * resident_rows is the number of rows held in memory at most.
+ */
+
+#include "AllocCounter.h"
+#include "IConnManagerServiceTypes.h"
+#include "Poco/Data/Session.h"
+#include "Poco/Data/Statement.h"
+#include "Poco/Data/RecordSet.h"
+#include "Poco/Data/SQLite/Connector.h"
+#include "Poco/Data/SQLite/StatementCache.h"
+#include "Poco/Data/SQLite/BulkInserter.h"
+#include "Poco/Data/SQLite/ColumnarCursor.h"
+#include "Poco/Stopwatch.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Stla::Connectivity::LteMetrics;
+
+namespace {
+
+const char* const SELECT = "SELECT time, rssi, rsrq, rsrp, snr FROM lte ORDER BY time";
+
+/**
+ * @brief Rows read at once by the batched ColumnarCursor.
+ */
+const std::size_t BATCH_SIZE = 4096;
+
+/**
+ * @brief Prints the result of one benchmark as a JSON line.
+ */
+void report(const char* benchmark, long rows, Poco::Clock::ClockDiff elapsedUs, unsigned long allocs, long residentRows, double average)
+{
+    const double ns  = elapsedUs*1000.0/rows;
+    const double rps = elapsedUs > 0 ? rows*1000000.0/elapsedUs : 0.0;
+    std::printf("{\"benchmark\":\"%s\",\"rows\":%ld,\"ns_per_row\":%.1f,\"rows_per_s\":%.0f,\"allocs_per_row\":%g,\"resident_rows\":%ld,\"avg_rsrp\":%.2f}\n",
+        benchmark, rows, ns, rps, static_cast<double>(allocs)/rows, residentRows, average);
+}
+
+/**
+ * @brief Fills the lte table with rows samples, one per second.
+ */
+void fill(Poco::Data::SQLite::StatementCache& cache, long rows)
+{
+    cache.session() << "CREATE TABLE lte (time INTEGER, rssi INTEGER, rsrq INTEGER, rsrp INTEGER, snr INTEGER)", Poco::Data::Keywords::now;
+    Poco::Data::SQLite::BulkInserter inserter(cache, "INSERT INTO lte VALUES (?, ?, ?, ?, ?)");
+    for (long i = 0; i < rows; ++i)
+    {
+        LteMetrics metrics;
+        metrics.raw_rssi = static_cast<signed char>(-60 - i%40);
+        metrics.rsrq = static_cast<signed char>(-3 - i%17);
+        metrics.rsrp = static_cast<short int>(-80 - i%60);
+        metrics.snr = static_cast<short int>(i%30);
+        inserter.row()
+            .bind(1, static_cast<Poco::Int64>(1600000000 + i))
+            .bind(2, static_cast<Poco::Int32>(metrics.raw_rssi))
+            .bind(3, static_cast<Poco::Int32>(metrics.rsrq))
+            .bind(4, static_cast<Poco::Int32>(metrics.rsrp))
+            .bind(5, static_cast<Poco::Int32>(metrics.snr));
+        inserter.insert();
+    }
+    inserter.commit();
+}
+
+/**
+ * @brief Reads all rows through a RecordSet, accessing values as Dynamic::Var.
+ */
+void benchRecordSet(Poco::Data::Session& session, long rows)
+{
+    Poco::Stopwatch sw;
+    const unsigned long allocs = Bench::allocations();
+    sw.start();
+    Poco::Data::Statement select(session);
+    select << SELECT, Poco::Data::Keywords::now;
+    Poco::Data::RecordSet rs(select);
+    long sum = 0;
+    const std::size_t count = rs.rowCount();
+    for (std::size_t row = 0; row < count; ++row)
+    {
+        sum += rs.value(3, row).convert<int>();
+    }
+    sw.stop();
+    report("recordset", rows, sw.elapsed(), Bench::allocations() - allocs, static_cast<long>(count), count ? static_cast<double>(sum)/count : 0.0);
+}
+
+/**
+ * @brief Reads all rows at once into typed column vectors.
+ */
+void benchColumnar(Poco::Data::SQLite::StatementCache& cache, long rows)
+{
+    Poco::Stopwatch sw;
+    const unsigned long allocs = Bench::allocations();
+    sw.start();
+    std::vector<Poco::Int64> time;
+    std::vector<Poco::Int16> rsrp;
+    Poco::Data::SQLite::ColumnarCursor cursor(cache.prepare(SELECT), BATCH_SIZE);
+    cursor.column(time).skip().skip().column(rsrp);
+    const std::size_t count = cursor.fetchAll();
+    long sum = 0;
+    for (std::vector<Poco::Int16>::const_iterator it = rsrp.begin(); it != rsrp.end(); ++it)
+    {
+        sum += *it;
+    }
+    sw.stop();
+    report("columnar", rows, sw.elapsed(), Bench::allocations() - allocs, static_cast<long>(count), count ? static_cast<double>(sum)/count : 0.0);
+}
+
+/**
+ * @brief Reads the rows in batches of BATCH_SIZE into typed column vectors.
+ */
+void benchColumnarBatch(Poco::Data::SQLite::StatementCache& cache, long rows)
+{
+    Poco::Stopwatch sw;
+    const unsigned long allocs = Bench::allocations();
+    sw.start();
+    std::vector<Poco::Int64> time;
+    std::vector<Poco::Int16> rsrp;
+    Poco::Data::SQLite::ColumnarCursor cursor(cache.prepare(SELECT), BATCH_SIZE);
+    cursor.column(time).skip().skip().column(rsrp);
+    long sum = 0;
+    std::size_t count = 0;
+    std::size_t n;
+    while ((n = cursor.fetch()) > 0)
+    {
+        count += n;
+        for (std::vector<Poco::Int16>::const_iterator it = rsrp.begin(); it != rsrp.end(); ++it)
+        {
+            sum += *it;
+        }
+    }
+    sw.stop();
+    report("columnar_batch", rows, sw.elapsed(), Bench::allocations() - allocs, static_cast<long>(BATCH_SIZE), count ? static_cast<double>(sum)/count : 0.0);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    long rows = argc > 1 ? std::atol(argv[1]) : 100000;
+    if (rows <= 0) rows = 100000;
+
+    Poco::Data::SQLite::Connector::registerConnector();
+    {
+        Poco::Data::Session session(Poco::Data::SQLite::Connector::KEY, ":memory:");
+        Poco::Data::SQLite::StatementCache cache(session);
+        fill(cache, rows);
+
+        benchRecordSet(session, rows);
+        benchColumnar(cache, rows);
+        benchColumnarBatch(cache, rows);
+    }
+    Poco::Data::SQLite::Connector::unregisterConnector();
+    return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * \file
+ *         StringBench.cpp
+ * \brief
+ *         Benchmarks the vectorized std::string functions of Poco/String.h against the generic templates
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: string_bench [iterations]
+ *
+ * Every function is called iterations times (default 1000000) on typical
+ * HTTP header names and values, once through the std::string overloads
+ * using FastAscii ("fast") and once through the generic templates using
+ * Ascii ("generic"). Every result is printed on stdout as one JSON object
+ * per line:
+ *
+ *     {"benchmark":"icompare","impl":"fast","simd":true,"iterations":1000000,"ns_per_call":4.1}
+ */
+
+#include "Poco/String.h"
+#include "Poco/FastAscii.h"
+#include "Poco/Stopwatch.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+const bool SIMD =
+#if defined(POCO_FASTASCII_SSE2) || defined(POCO_FASTASCII_NEON)
+    true;
+#else
+    false;
+#endif
+
+/**
+ * @brief Keeps the compiler from optimizing the benchmarked calls away.
+ */
+volatile std::size_t sink = 0;
+
+/**
+ * @brief Prints the result of one benchmark as a JSON line.
+ */
+void report(const char* benchmark, const char* impl, long iterations, Poco::Clock::ClockDiff elapsedUs)
+{
+    std::printf("{\"benchmark\":\"%s\",\"impl\":\"%s\",\"simd\":%s,\"iterations\":%ld,\"ns_per_call\":%.1f}\n",
+        benchmark, impl, SIMD ? "true" : "false", iterations, 1000.0*elapsedUs/iterations);
+}
+
+void benchToLower(const std::string& value, long iterations)
+{
+    Poco::Stopwatch sw;
+    sw.start();
+    for (long i = 0; i < iterations; ++i) sink += Poco::toLower(value).size();
+    sw.stop();
+    report("toLower", "fast", iterations, sw.elapsed());
+
+    sw.restart();
+    for (long i = 0; i < iterations; ++i) sink += Poco::toLower<std::string>(value).size();
+    sw.stop();
+    report("toLower", "generic", iterations, sw.elapsed());
+}
+
+void benchICompare(const std::string& s1, const std::string& s2, long iterations)
+{
+    Poco::Stopwatch sw;
+    sw.start();
+    for (long i = 0; i < iterations; ++i) sink += Poco::icompare(s1, s2);
+    sw.stop();
+    report("icompare", "fast", iterations, sw.elapsed());
+
+    sw.restart();
+    for (long i = 0; i < iterations; ++i) sink += Poco::icompare<std::string>(s1, s2);
+    sw.stop();
+    report("icompare", "generic", iterations, sw.elapsed());
+}
+
+void benchTrim(const std::string& value, long iterations)
+{
+    Poco::Stopwatch sw;
+    sw.start();
+    for (long i = 0; i < iterations; ++i) sink += Poco::trim(value).size();
+    sw.stop();
+    report("trim", "fast", iterations, sw.elapsed());
+
+    sw.restart();
+    for (long i = 0; i < iterations; ++i) sink += Poco::trim<std::string>(value).size();
+    sw.stop();
+    report("trim", "generic", iterations, sw.elapsed());
+}
+
+void benchReplace(const std::string& value, long iterations)
+{
+    Poco::Stopwatch sw;
+    sw.start();
+    for (long i = 0; i < iterations; ++i) sink += Poco::replace(value, ';', ',').size();
+    sw.stop();
+    report("replace", "fast", iterations, sw.elapsed());
+
+    sw.restart();
+    for (long i = 0; i < iterations; ++i) sink += Poco::replace<std::string>(value, ';', ',').size();
+    sw.stop();
+    report("replace", "generic", iterations, sw.elapsed());
+}
+
+void benchTranslate(const std::string& value, long iterations)
+{
+    const std::string from("/.;-");
+    const std::string to("____");
+    Poco::Stopwatch sw;
+    sw.start();
+    for (long i = 0; i < iterations; ++i) sink += Poco::translate(value, from, to).size();
+    sw.stop();
+    report("translate", "fast", iterations, sw.elapsed());
+
+    sw.restart();
+    for (long i = 0; i < iterations; ++i) sink += Poco::translate<std::string>(value, from, to).size();
+    sw.stop();
+    report("translate", "generic", iterations, sw.elapsed());
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = argc > 1 ? std::atol(argv[1]) : 1000000;
+    if (iterations <= 0) iterations = 1000000;
+
+    const std::string name("Content-Security-Policy-Report-Only");
+    const std::string lowerName("content-security-policy-report-only");
+    const std::string value("   text/html; charset=utf-8; boundary=----WebKitFormBoundary7MA4YWxkTrZu0gW   ");
+
+    benchToLower(name, iterations);
+    benchICompare(name, lowerName, iterations);
+    benchTrim(value, iterations);
+    benchReplace(value, iterations);
+    benchTranslate(value, iterations);
+    return 0;
+}
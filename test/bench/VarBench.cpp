@@ -0,0 +1,129 @@
+/**
+ * \file
+ *         VarBench.cpp
+ * \brief
+ *         Allocation benchmarks for Poco::Any, Poco::Dynamic::Var and JSON parsing
+ *
+ * \par Copyright Notice:
+ * \verbatim
+ * Copyright (c) 2021 Stellantis N.V.
+ * All Rights Reserved.
+ * The reproduction, transmission or use of this document or its contents is
+ * not permitted without express written authority.
+ * Offenders will be liable for damages. All rights, including rights created
+ * by patent grant or registration of a utility model or design, are reserved.
+ * \endverbatim
+ *
+ * Usage: var_bench [iterations]
+ *
+ * Every result is printed on stdout as one JSON object per line:
+ *
+ *     {"benchmark":"var","type":"int","soo":true,"iterations":100000,"ns_per_op":4.1,"ops_per_s":243902439,"allocs_per_op":0}
+ *
+ * soo tells whether the benchmark was built with small object optimization
+ * (POCO_ENABLE_SOO). Build var_bench and var_bench_soo to compare both; the
+ * POCO libraries must be built with the same setting as the benchmark, since
+ * it changes the layout of Any and Var.
+ */
+
+#include "AllocCounter.h"
+#include "Poco/Any.h"
+#include "Poco/Dynamic/Var.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/Stopwatch.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+#ifdef POCO_NO_SOO
+const bool SOO = false;
+#else
+const bool SOO = true;
+#endif
+
+/**
+ * @brief A configuration and telemetry payload typical for our targets.
+ */
+const char* const PAYLOAD =
+    "{\"apn\":{\"name\":\"Public\",\"connected\":true,\"mtu\":1500},"
+    "\"lte\":{\"rsrp\":-95,\"rsrq\":-11,\"sinr\":12.5,\"band\":20,\"cellId\":27446017},"
+    "\"neighbours\":[{\"pci\":101,\"rsrp\":-101},{\"pci\":214,\"rsrp\":-108},{\"pci\":330,\"rsrp\":-112}],"
+    "\"flags\":[true,false,true,true],\"uptime\":86400,\"ratio\":0.25,\"operator\":null}";
+
+/**
+ * @brief Prints the result of one benchmark as a JSON line.
+ */
+void report(const char* benchmark, const char* type, long iterations, Poco::Clock::ClockDiff elapsedUs, unsigned long allocs)
+{
+    const double ns  = elapsedUs*1000.0/iterations;
+    const double ops = elapsedUs > 0 ? iterations*1000000.0/elapsedUs : 0.0;
+    std::printf("{\"benchmark\":\"%s\",\"type\":\"%s\",\"soo\":%s,\"iterations\":%ld,\"ns_per_op\":%.1f,\"ops_per_s\":%.0f,\"allocs_per_op\":%g}\n",
+        benchmark, type, SOO ? "true" : "false", iterations, ns, ops, static_cast<double>(allocs)/iterations);
+}
+
+/**
+ * @brief Measures constructing, copying and destroying an Any and a Var holding value.
+ */
+template <class T>
+void benchValue(const char* type, const T& value, long iterations)
+{
+    Poco::Stopwatch sw;
+    unsigned long allocs = Bench::allocations();
+    sw.start();
+    for (long i = 0; i < iterations; ++i)
+    {
+        Poco::Any any(value);
+        Poco::Any copy(any);
+    }
+    sw.stop();
+    report("any", type, iterations, sw.elapsed(), Bench::allocations() - allocs);
+
+    sw.reset();
+    allocs = Bench::allocations();
+    sw.start();
+    for (long i = 0; i < iterations; ++i)
+    {
+        Poco::Dynamic::Var var(value);
+        Poco::Dynamic::Var copy(var);
+    }
+    sw.stop();
+    report("var", type, iterations, sw.elapsed(), Bench::allocations() - allocs);
+}
+
+/**
+ * @brief Measures parsing PAYLOAD into a Var with the default ParseHandler.
+ */
+void benchParse(long iterations)
+{
+    const std::string json(PAYLOAD);
+    Poco::JSON::Parser parser;
+    Poco::Stopwatch sw;
+    const unsigned long allocs = Bench::allocations();
+    sw.start();
+    for (long i = 0; i < iterations; ++i)
+    {
+        parser.reset();
+        Poco::Dynamic::Var result = parser.parse(json);
+    }
+    sw.stop();
+    report("json_parse", "payload", iterations, sw.elapsed(), Bench::allocations() - allocs);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = argc > 1 ? std::atol(argv[1]) : 100000;
+    if (iterations <= 0) iterations = 100000;
+
+    benchValue("bool", true, iterations);
+    benchValue("int", 42, iterations);
+    benchValue("double", 0.25, iterations);
+    benchValue("Int64", static_cast<Poco::Int64>(27446017), iterations);
+    benchValue("string", std::string("Public"), iterations);
+
+    benchParse(iterations/10 > 0 ? iterations/10 : 1);
+    return 0;
+}
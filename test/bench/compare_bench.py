@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+#
+# compare_bench.py
+#
+# Compares the JSON line output of two benchmark runs, e.g.
+#
+#     ./framework_bench > baseline.json
+#     (rebuild)
+#     ./framework_bench > current.json
+#     test/bench/compare_bench.py baseline.json current.json --threshold=5
+#
+# Lines are grouped by all fields that are not measurements (benchmark, arg,
+# variant, ...), the median time per operation of every group is compared,
+# and the exit status is 1 if any benchmark got slower by more than the
+# threshold (in percent, default 10).
+#
+# Copyright (c) 2021 Stellantis N.V.
+# All Rights Reserved.
+#
+
+import json
+import statistics
+import sys
+
+TIME_FIELDS = ("ns_per_op", "ns_per_call", "ns_per_iteration", "ns")
+IGNORED_FIELDS = ("repetition", "iterations", "ops_per_s", "bytes_per_s", "mb_per_s")
+
+
+def load(path):
+    groups = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            try:
+                record = json.loads(line)
+            except ValueError:
+                continue
+            field = next((name for name in TIME_FIELDS if name in record), None)
+            if field is None:
+                continue
+            key = tuple(sorted((k, str(v)) for k, v in record.items()
+                               if k not in TIME_FIELDS and k not in IGNORED_FIELDS))
+            groups.setdefault(key, []).append(float(record[field]))
+    return {key: statistics.median(values) for key, values in groups.items()}
+
+
+def name(key):
+    fields = dict(key)
+    label = fields.pop("benchmark", fields.pop("name", "?"))
+    rest = ",".join("%s=%s" % item for item in sorted(fields.items()))
+    return "%s(%s)" % (label, rest) if rest else label
+
+
+def main(argv):
+    threshold = 10.0
+    paths = []
+    for arg in argv[1:]:
+        if arg.startswith("--threshold="):
+            threshold = float(arg[len("--threshold="):])
+        else:
+            paths.append(arg)
+    if len(paths) != 2:
+        sys.stderr.write("usage: %s baseline.json current.json [--threshold=percent]\n" % argv[0])
+        return 2
+
+    baseline = load(paths[0])
+    current = load(paths[1])
+    regressions = 0
+    print("%-60s %12s %12s %9s" % ("benchmark", "baseline ns", "current ns", "delta"))
+    for key in sorted(baseline, key=name):
+        if key not in current:
+            print("%-60s %12.1f %12s %9s" % (name(key), baseline[key], "-", "missing"))
+            continue
+        before = baseline[key]
+        after = current[key]
+        delta = 100.0*(after - before)/before if before > 0 else 0.0
+        mark = ""
+        if delta > threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        print("%-60s %12.1f %12.1f %+8.1f%%%s" % (name(key), before, after, delta, mark))
+    for key in sorted(set(current) - set(baseline), key=name):
+        print("%-60s %12s %12.1f %9s" % (name(key), "-", current[key], "new"))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))